@@ -0,0 +1,742 @@
+/**
+ * @file ntrip_bench.c
+ * @brief Throughput benchmarks of the decode, framing, sky and PNG paths.
+ *
+ * `ntrip-bench` generates its RTCM corpora in memory from a fixed seed,
+ * so every run on every machine measures the same bytes:
+ *
+ *   - msm4_sN / msm7_sN: GPS MSM4 (1074) and MSM7 (1077) epochs with N
+ *     satellites on two signals, one epoch per second,
+ *   - eph:      1019 GPS ephemerides for 32 satellites, re-broadcast
+ *               with a new IODE every pass (the ephemeris-heavy case),
+ *   - corrupt:  MSM7 + 1019 with a flipped byte, a cut frame or a run
+ *               of garbage (with stray 0xD3 preambles) every few frames,
+ *   - ubx:      a raw u-blox stream (RAWX-sized UBX frames, payloads full
+ *               of 0xD3), which the framer must recognise, not resync on.
+ *
+ * Each case runs until --min-time has passed (at least three
+ * repetitions) and reports the best repetition as ns per item and
+ * items per second; --json writes the same as one JSON object for
+ * tracking regressions between builds.  --write-corpus DIR saves the
+ * corpora as raw .rtcm files, which the analyser replays with --replay.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "cli_help.h"
+#include "perf_probe.h"
+#include "rtcm3x_parser.h"
+#include "rtcm_framer.h"
+#include "rtcm_unpack.h"
+#include "sky_collect.h"
+#include "sky_render.h"
+#include "stream_clock.h"
+#include "sv_ephemeris.h"
+#include "sv_orbit.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef _WIN32
+#define BENCH_SEP '\\'
+#else
+#define BENCH_SEP '/'
+#endif
+
+#define BENCH_EPOCHS      600           /* epochs per MSM corpus (10 min at 1 Hz) */
+#define BENCH_EPH_PASSES  40            /* 32-SV ephemeris sets in the eph corpus */
+#define BENCH_N_SV        32
+#define BENCH_TOE_S       345600.0      /* Thursday 00:00 GPS, a multiple of 16 s */
+#define BENCH_N_SECTORS   (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+
+/* Reference station near Enschede (ECEF, metres). */
+#define BENCH_ARP_X  3880000.0
+#define BENCH_ARP_Y   452000.0
+#define BENCH_ARP_Z  5040000.0
+
+/* ── Deterministic input ─────────────────────────────────────────────── */
+
+static uint64_t s_rng = 0x9E3779B97F4A7C15ull;
+
+static uint32_t bench_rand(void)
+{
+    /* xorshift64* */
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static int64_t bench_rand_range(int64_t lo, int64_t hi)
+{
+    return lo + (int64_t)(bench_rand() % (uint32_t)(hi - lo + 1));
+}
+
+/* ── Corpus: frames back to back, plus where each one starts ──────────── */
+
+typedef struct {
+    const char    *name;
+    unsigned char *buf;
+    size_t         len, cap;
+    size_t        *off;             /* start of each frame */
+    int            n, n_cap;
+} Corpus;
+
+static void corpus_reserve(Corpus *c, size_t extra)
+{
+    if (c->len + extra <= c->cap) return;
+    size_t cap = c->cap ? c->cap : 65536;
+    while (cap < c->len + extra) cap *= 2;
+    unsigned char *p = (unsigned char *)realloc(c->buf, cap);
+    if (!p) { fprintf(stderr, "ntrip-bench: out of memory\n"); exit(1); }
+    c->buf = p;
+    c->cap = cap;
+}
+
+static void corpus_mark(Corpus *c)
+{
+    if (c->n == c->n_cap) {
+        int cap = c->n_cap ? c->n_cap * 2 : 1024;
+        size_t *p = (size_t *)realloc(c->off, (size_t)cap * sizeof(*p));
+        if (!p) { fprintf(stderr, "ntrip-bench: out of memory\n"); exit(1); }
+        c->off = p;
+        c->n_cap = cap;
+    }
+    c->off[c->n++] = c->len;
+}
+
+static void corpus_free(Corpus *c)
+{
+    free(c->buf);
+    free(c->off);
+    memset(c, 0, sizeof(*c));
+}
+
+static size_t corpus_frame_len(const Corpus *c, int i)
+{
+    return (i + 1 < c->n ? c->off[i + 1] : c->len) - c->off[i];
+}
+
+/* ── MSB-first bit writer, the inverse of rtcm_bitreader.h ────────────── */
+
+typedef struct {
+    unsigned char buf[1024];
+    int pos;                        /* bits written */
+} BitWriter;
+
+static void bw_put(BitWriter *w, int nbits, uint64_t v)
+{
+    for (int i = nbits - 1; i >= 0; i--, w->pos++)
+        if ((v >> i) & 1)
+            w->buf[w->pos >> 3] |= (unsigned char)(0x80u >> (w->pos & 7));
+}
+
+static void bw_put_signed(BitWriter *w, int nbits, int64_t v)
+{
+    bw_put(w, nbits, (uint64_t)v & ((nbits == 64) ? ~0ull : ((1ull << nbits) - 1)));
+}
+
+/* Append the payload in @p w as one framed message with its CRC. */
+static void corpus_put_frame(Corpus *c, const BitWriter *w)
+{
+    int plen = (w->pos + 7) / 8;
+    corpus_reserve(c, (size_t)plen + 6);
+    corpus_mark(c);
+    unsigned char *f = c->buf + c->len;
+    f[0] = 0xD3;
+    f[1] = (unsigned char)((plen >> 8) & 0x03);
+    f[2] = (unsigned char)(plen & 0xFF);
+    memcpy(f + 3, w->buf, (size_t)plen);
+    uint32_t crc = crc24q(f, (size_t)plen + 3);
+    f[plen + 3] = (unsigned char)(crc >> 16);
+    f[plen + 4] = (unsigned char)(crc >> 8);
+    f[plen + 5] = (unsigned char)crc;
+    c->len += (size_t)plen + 6;
+}
+
+/* ── MSM generator ───────────────────────────────────────────────────── */
+
+/* Field widths of MSM4 and MSM7 (RTCM 10403.3 Tables 3.5-78 .. 3.5-95). */
+typedef struct {
+    int msg_type;
+    int sat_ext, sat_rate;          /* 0 = not present */
+    int pr, ph, lock, cnr, rate;
+} MsmGen;
+
+static const MsmGen k_msm4 = { 1074, 0, 0,  15, 22,  4,  6,  0 };
+static const MsmGen k_msm7 = { 1077, 4, 14, 20, 24, 10, 10, 15 };
+
+/* One epoch of @p n_sats GPS satellites (PRN 1..n_sats) on L1C and L2W. */
+static void put_msm(Corpus *c, const MsmGen *g, int n_sats, uint32_t tow_ms, bool multi)
+{
+    BitWriter w;
+    memset(&w, 0, sizeof(w));
+    const int n_sigs = 2;
+
+    bw_put(&w, 12, (uint64_t)g->msg_type);
+    bw_put(&w, 12, 1234);               /* reference station id */
+    bw_put(&w, 30, tow_ms);
+    bw_put(&w, 1, multi ? 1 : 0);
+    bw_put(&w, 3, 0);                   /* IODS */
+    bw_put(&w, 7, 0);                   /* reserved */
+    bw_put(&w, 2, 0);                   /* clock steering */
+    bw_put(&w, 2, 0);                   /* external clock */
+    bw_put(&w, 1, 0);                   /* divergence-free smoothing */
+    bw_put(&w, 3, 0);                   /* smoothing interval */
+    uint64_t sat_mask = 0;
+    for (int s = 0; s < n_sats; s++) sat_mask |= 1ull << (63 - s);
+    bw_put(&w, 64, sat_mask);
+    bw_put(&w, 32, (1u << (31 - 1)) | (1u << (31 - 15)));   /* 1C, 2W */
+    for (int i = 0; i < n_sats * n_sigs; i++) bw_put(&w, 1, 1);
+
+    for (int s = 0; s < n_sats; s++) bw_put(&w, 8, (uint64_t)bench_rand_range(66, 86));
+    if (g->sat_ext)
+        for (int s = 0; s < n_sats; s++) bw_put(&w, g->sat_ext, 0);
+    for (int s = 0; s < n_sats; s++) bw_put(&w, 10, bench_rand() & 0x3FF);
+    if (g->sat_rate)
+        for (int s = 0; s < n_sats; s++) bw_put_signed(&w, g->sat_rate, bench_rand_range(-800, 800));
+
+    const int nc = n_sats * n_sigs;
+    for (int i = 0; i < nc; i++) bw_put_signed(&w, g->pr, bench_rand_range(-(1 << (g->pr - 2)), 1 << (g->pr - 2)));
+    for (int i = 0; i < nc; i++) bw_put_signed(&w, g->ph, bench_rand_range(-(1 << (g->ph - 2)), 1 << (g->ph - 2)));
+    for (int i = 0; i < nc; i++) bw_put(&w, g->lock, (uint64_t)bench_rand_range(1, (1 << g->lock) - 1));
+    for (int i = 0; i < nc; i++) bw_put(&w, 1, 0);
+    for (int i = 0; i < nc; i++)
+        bw_put(&w, g->cnr, (uint64_t)(bench_rand_range(30, 52) * (g->cnr == 10 ? 16 : 1)));
+    if (g->rate)
+        for (int i = 0; i < nc; i++) bw_put_signed(&w, g->rate, bench_rand_range(-2000, 2000));
+
+    corpus_put_frame(c, &w);
+}
+
+static void gen_msm(Corpus *c, const MsmGen *g, int n_sats)
+{
+    for (int e = 0; e < BENCH_EPOCHS; e++)
+        put_msm(c, g, n_sats, (uint32_t)((BENCH_TOE_S + 60.0 + e) * 1000.0), false);
+}
+
+/* ── 1019 GPS ephemeris generator ────────────────────────────────────── */
+
+/* A plausible GPS orbit for @p prn: six planes, 55 deg inclination. */
+static void put_1019(Corpus *c, int prn, int iode)
+{
+    const double sc = 1.0 / M_PI;       /* radians -> semi-circles */
+    const int plane = (prn - 1) % 6, slot = (prn - 1) / 6;
+    BitWriter w;
+    memset(&w, 0, sizeof(w));
+
+    bw_put(&w, 12, 1019);
+    bw_put(&w, 6, (uint64_t)prn);
+    bw_put(&w, 10, 2400 % 1024);                            /* week */
+    bw_put(&w, 4, 0);                                       /* URA */
+    bw_put(&w, 2, 1);                                       /* code on L2 */
+    bw_put_signed(&w, 14, bench_rand_range(-200, 200));     /* IDOT */
+    bw_put(&w, 8, (uint64_t)iode);
+    bw_put(&w, 16, (uint64_t)(BENCH_TOE_S / 16.0));         /* toc */
+    bw_put_signed(&w, 8, 0);                                /* af2 */
+    bw_put_signed(&w, 16, bench_rand_range(-500, 500));     /* af1 */
+    bw_put_signed(&w, 22, bench_rand_range(-200000, 200000)); /* af0 */
+    bw_put(&w, 10, (uint64_t)iode);                         /* IODC */
+    bw_put_signed(&w, 16, bench_rand_range(-3000, 3000));   /* crs */
+    bw_put_signed(&w, 16, bench_rand_range(10000, 14000));  /* delta n */
+    double m0 = fmod(slot * 90.0 + plane * 15.0, 360.0) - 180.0;
+    bw_put_signed(&w, 32, (int64_t)(m0 / 180.0 * 2147483648.0));
+    bw_put_signed(&w, 16, bench_rand_range(-3000, 3000));   /* cuc */
+    bw_put(&w, 32, (uint64_t)(bench_rand_range(1000, 20000) * 1e-6 * 8589934592.0)); /* e */
+    bw_put_signed(&w, 16, bench_rand_range(-3000, 3000));   /* cus */
+    bw_put(&w, 32, (uint64_t)(5153.6 * 524288.0));          /* sqrt(A) */
+    bw_put(&w, 16, (uint64_t)(BENCH_TOE_S / 16.0));         /* toe */
+    bw_put_signed(&w, 16, bench_rand_range(-100, 100));     /* cic */
+    double omega0 = plane * 60.0 - 180.0 + 30.0;
+    bw_put_signed(&w, 32, (int64_t)(omega0 / 180.0 * 2147483648.0));
+    bw_put_signed(&w, 16, bench_rand_range(-100, 100));     /* cis */
+    bw_put_signed(&w, 32, (int64_t)(55.0 * M_PI / 180.0 * sc * 2147483648.0));
+    bw_put_signed(&w, 16, bench_rand_range(4000, 8000));    /* crc */
+    bw_put_signed(&w, 32, (int64_t)bench_rand_range(-2000000000, 2000000000)); /* omega */
+    bw_put_signed(&w, 24, bench_rand_range(-20000, -10000)); /* omega dot */
+    bw_put_signed(&w, 8, bench_rand_range(-20, 20));        /* TGD */
+    bw_put(&w, 6, 0);                                       /* health */
+    bw_put(&w, 1, 0);                                       /* L2 P flag */
+    bw_put(&w, 1, 0);                                       /* fit interval */
+
+    corpus_put_frame(c, &w);
+}
+
+static void gen_eph(Corpus *c)
+{
+    for (int p = 0; p < BENCH_EPH_PASSES; p++)
+        for (int prn = 1; prn <= BENCH_N_SV; prn++)
+            put_1019(c, prn, p & 0xFF);
+}
+
+/* MSM7 epochs with ephemerides in between, damaged every few frames. */
+static void gen_corrupt(Corpus *c)
+{
+    Corpus clean = { "clean", NULL, 0, 0, NULL, 0, 0 };
+    for (int e = 0; e < BENCH_EPOCHS; e++) {
+        put_msm(&clean, &k_msm7, 16, (uint32_t)((BENCH_TOE_S + 60.0 + e) * 1000.0), false);
+        if (e % 4 == 0) put_1019(&clean, 1 + e / 4 % BENCH_N_SV, e & 0xFF);
+    }
+    for (int i = 0; i < clean.n; i++) {
+        size_t len = corpus_frame_len(&clean, i);
+        const unsigned char *f = clean.buf + clean.off[i];
+        corpus_reserve(c, len + 64);
+        corpus_mark(c);
+        memcpy(c->buf + c->len, f, len);
+        switch (i % 7 == 3 ? bench_rand() % 3 : 3) {
+        case 0:                                 /* bit error: CRC fails */
+            c->buf[c->len + 3 + bench_rand() % (uint32_t)(len - 6)] ^= 0x10;
+            c->len += len;
+            break;
+        case 1:                                 /* connection cut mid-frame */
+            c->len += len / 2;
+            break;
+        case 2: {                               /* garbage with stray preambles */
+            c->len += len;
+            int junk = 8 + (int)(bench_rand() % 48);
+            for (int k = 0; k < junk; k++)
+                c->buf[c->len++] = (k % 9 == 0) ? 0xD3 : (unsigned char)bench_rand();
+            break;
+        }
+        default:
+            c->len += len;
+            break;
+        }
+    }
+    corpus_free(&clean);
+}
+
+/* UBX RXM-RAWX-sized frames of random measurements: 16 + 32 per signal. */
+static void gen_ubx(Corpus *c)
+{
+    for (int e = 0; e < BENCH_EPOCHS; e++) {
+        size_t plen = 16 + 32 * (size_t)bench_rand_range(16, 40);
+        corpus_reserve(c, plen + 8);
+        corpus_mark(c);
+        unsigned char *f = c->buf + c->len;
+        f[0] = 0xB5;
+        f[1] = 0x62;
+        f[2] = 0x02;                            /* RXM */
+        f[3] = 0x15;                            /* RAWX */
+        f[4] = (unsigned char)(plen & 0xFF);
+        f[5] = (unsigned char)(plen >> 8);
+        for (size_t k = 0; k < plen; k++)
+            f[6 + k] = (k % 9 == 0) ? 0xD3 : (unsigned char)bench_rand();
+        unsigned ck_a = 0, ck_b = 0;
+        for (size_t k = 2; k < plen + 6; k++) {
+            ck_a += f[k];
+            ck_b += ck_a;
+        }
+        f[plen + 6] = (unsigned char)ck_a;
+        f[plen + 7] = (unsigned char)ck_b;
+        c->len += plen + 8;
+    }
+}
+
+/* ── Timing ──────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const char *name;               /* case */
+    const char *corpus;
+    const char *unit;               /* what an item is */
+    long long   items;              /* per repetition */
+    long long   bytes;              /* per repetition, 0 = n/a */
+    int         reps;
+    double      ns_min, ns_mean;    /* per item */
+    char        note[80];
+} BenchResult;
+
+typedef long long (*BenchFn)(void *arg);
+
+static double s_min_time = 0.5;     /* seconds per case */
+
+static void bench_run(BenchResult *r, BenchFn fn, void *arg)
+{
+    uint64_t best = UINT64_MAX, total = 0;
+    r->reps = 0;
+    fn(arg);                                    /* warm up caches and tables */
+    do {
+        uint64_t t0 = perf_now_ns();
+        r->items = fn(arg);
+        uint64_t dt = perf_now_ns() - t0;
+        if (dt < best) best = dt;
+        total += dt;
+        r->reps++;
+    } while (r->reps < 3 || total < (uint64_t)(s_min_time * 1e9));
+    double items = r->items > 0 ? (double)r->items : 1.0;
+    r->ns_min  = (double)best / items;
+    r->ns_mean = (double)total / r->reps / items;
+}
+
+/* ── Cases ───────────────────────────────────────────────────────────── */
+
+static volatile uint32_t s_sink;    /* keeps results observable */
+
+static long long case_crc(void *arg)
+{
+    const Corpus *c = (const Corpus *)arg;
+    uint32_t acc = 0;
+    for (int i = 0; i < c->n; i++)
+        acc ^= crc24q(c->buf + c->off[i], corpus_frame_len(c, i) - 3);
+    s_sink = acc;
+    return c->n;
+}
+
+static long long case_msm_parse(void *arg)
+{
+    const Corpus *c = (const Corpus *)arg;
+    static RtcmMsmObs obs;
+    int cells = 0;
+    for (int i = 0; i < c->n; i++) {
+        const unsigned char *f = c->buf + c->off[i];
+        if (rtcm_decode_msm(f + 3, (int)corpus_frame_len(c, i) - 6, &obs))
+            cells += obs.num_cells;
+    }
+    s_sink = (uint32_t)cells;
+    return c->n;
+}
+
+/* Full text decode, as the analyser does for every frame it prints. */
+static RtcmStrBuf s_text;
+
+static long long case_text_decode(void *arg)
+{
+    const Corpus *c = (const Corpus *)arg;
+    static RtcmDecoderCtx ctx;
+    rtcm_decoder_ctx_init(&ctx);
+    ctx.out = &s_text;
+    for (int i = 0; i < c->n; i++) {
+        rtcm_strbuf_clear(&s_text);
+        analyze_rtcm_message_ctx(&ctx, c->buf + c->off[i], (int)corpus_frame_len(c, i),
+                                 false, NULL);
+    }
+    return c->n;
+}
+
+/* 1019 -> sv_eph_store(), through the dispatch table without text. */
+static long long case_eph_decode(void *arg)
+{
+    const Corpus *c = (const Corpus *)arg;
+    rtcm_set_output_buffer(&s_text);
+    for (int i = 0; i < c->n; i++) {
+        const unsigned char *f = c->buf + c->off[i];
+        int plen = (int)corpus_frame_len(c, i) - 6;
+        int mt = (f[3] << 4) | (f[4] >> 4);
+        const RtcmMsgInfo *info = rtcm_msg_info(mt);
+        rtcm_strbuf_clear(&s_text);
+        if (info && info->decode) info->decode(NULL, f + 3, plen, NULL);
+    }
+    rtcm_set_output_buffer(NULL);
+    return c->n;
+}
+
+typedef struct {
+    const Corpus *c;
+    size_t        chunk;            /* bytes per read, as a socket delivers them */
+    RtcmFramer    framer;
+    long long     frames;
+} FramerArg;
+
+static void framer_count(const unsigned char *frame, int frame_len, void *user)
+{
+    (void)frame;
+    (void)frame_len;
+    ((FramerArg *)user)->frames++;
+}
+
+static long long case_framer(void *arg)
+{
+    FramerArg *a = (FramerArg *)arg;
+    rtcm_framer_init(&a->framer, framer_count, a);
+    a->frames = 0;
+    for (size_t o = 0; o < a->c->len; o += a->chunk) {
+        size_t n = a->c->len - o < a->chunk ? a->c->len - o : a->chunk;
+        rtcm_framer_push(&a->framer, a->c->buf + o, n);
+    }
+    return a->c->n;
+}
+
+static SkyRenderSector s_sectors[BENCH_N_SECTORS];
+
+static long long case_sky(void *arg)
+{
+    const Corpus *c = (const Corpus *)arg;
+    stream_clock_set_virtual(true);
+    sky_collect_reset(s_sectors);
+    int svs = 0;
+    for (int i = 0; i < c->n; i++) {
+        const unsigned char *f = c->buf + c->off[i];
+        int flen = (int)corpus_frame_len(c, i);
+        int mt = (f[3] << 4) | (f[4] >> 4);
+        stream_clock_feed(f, flen);
+        svs += sky_collect_feed_msm(s_sectors, f + 3, flen - 6, mt,
+                                    BENCH_ARP_X, BENCH_ARP_Y, BENCH_ARP_Z);
+    }
+    svs += sky_collect_flush(s_sectors);
+    s_sink = (uint32_t)svs;
+    return c->n;
+}
+
+/* Orbit propagation of every stored SV over one hour at 1 s steps. */
+#define BENCH_ORBIT_STEPS 3600
+
+typedef struct {
+    const SvEphemeris *eph[BENCH_N_SV];
+    int n;
+    int mode;                       /* 0 scalar, 1 batch, 2 cached batch */
+} OrbitArg;
+
+static long long case_orbit(void *arg)
+{
+    OrbitArg *a = (OrbitArg *)arg;
+    double x[BENCH_N_SV], y[BENCH_N_SV], z[BENCH_N_SV], acc = 0.0;
+    bool ok[BENCH_N_SV];
+    for (int s = 0; s < BENCH_ORBIT_STEPS; s++) {
+        double tow = BENCH_TOE_S + s;
+        if (a->mode == 0) {
+            for (int k = 0; k < a->n; k++)
+                sv_to_ecef(a->eph[k], 2400, tow, &x[k], &y[k], &z[k]);
+        } else if (a->mode == 1) {
+            sv_to_ecef_batch(a->eph, a->n, 2400, tow, x, y, z, ok);
+        } else {
+            sv_to_ecef_cached_batch(a->eph, a->n, 2400, tow, x, y, z, ok);
+        }
+        acc += x[0];
+    }
+    s_sink = (uint32_t)acc;
+    return (long long)BENCH_ORBIT_STEPS * a->n;
+}
+
+static char s_png_path[512];
+
+static long long case_png(void *arg)
+{
+    (void)arg;
+    if (!sky_render_heatmap_png(s_png_path, s_sectors, 800, 800, true,
+                                52.22, 6.89, 50.0, "BENCH", "2026-01-01 00:00:00 UTC"))
+        return 0;
+    return 1;
+}
+
+/* ── Driver ──────────────────────────────────────────────────────────── */
+
+#define BENCH_MAX_RESULTS 32
+
+static BenchResult s_results[BENCH_MAX_RESULTS];
+static int         s_n_results;
+static const char *s_filter;
+
+static BenchResult *bench_case(const char *name, const Corpus *c, const char *corpus,
+                               const char *unit, BenchFn fn, void *arg)
+{
+    char full[96];
+    snprintf(full, sizeof(full), "%s/%s", name, corpus);
+    if (s_filter && !strstr(full, s_filter)) return NULL;
+    if (s_n_results == BENCH_MAX_RESULTS) return NULL;
+    BenchResult *r = &s_results[s_n_results++];
+    memset(r, 0, sizeof(*r));
+    r->name   = name;
+    r->corpus = corpus;
+    r->unit   = unit;
+    bench_run(r, fn, arg);
+    r->bytes  = c ? (long long)c->len : 0;
+    return r;
+}
+
+static bool corpus_write(const Corpus *c, const char *dir)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s%c%s.rtcm", dir, BENCH_SEP, c->name);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ntrip-bench: cannot write %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(c->buf, 1, c->len, f) == c->len;
+    ok = (fclose(f) == 0) && ok;
+    if (ok) printf("%-10s %6d frames %9zu bytes  %s\n", c->name, c->n, c->len, path);
+    return ok;
+}
+
+static void print_text(void)
+{
+    printf("%-14s %-9s %10s %12s %12s %10s  %s\n",
+           "case", "corpus", "items", "ns/item", "items/s", "MB/s", "note");
+    for (int i = 0; i < s_n_results; i++) {
+        const BenchResult *r = &s_results[i];
+        double per_s = r->ns_min > 0.0 ? 1e9 / r->ns_min : 0.0;
+        double mb_s  = r->bytes && r->items
+                     ? (double)r->bytes / (r->ns_min * (double)r->items) * 1e3 : 0.0;
+        printf("%-14s %-9s %10lld %12.1f %12.0f %10.1f  %s%s%s\n",
+               r->name, r->corpus, r->items, r->ns_min, per_s, mb_s, r->unit,
+               r->note[0] ? ", " : "", r->note);
+    }
+}
+
+static void print_json(void)
+{
+    printf("{\"tool\":\"ntrip-bench\",\"version\":\"%s\",\"unpack\":\"%s\",\"crc\":\"%s\","
+           "\"min_time_s\":%.3f,\"results\":[", NTRIP_ANALYSER_VERSION, rtcm_unpack_impl(),
+           crc24q_impl(), s_min_time);
+    for (int i = 0; i < s_n_results; i++) {
+        const BenchResult *r = &s_results[i];
+        double mb_s = r->bytes && r->items
+                    ? (double)r->bytes / (r->ns_min * (double)r->items) * 1e3 : 0.0;
+        printf("%s\n{\"case\":\"%s\",\"corpus\":\"%s\",\"unit\":\"%s\",\"items\":%lld,"
+               "\"bytes\":%lld,\"reps\":%d,\"ns_per_item\":%.2f,\"ns_per_item_mean\":%.2f,"
+               "\"items_per_s\":%.1f,\"mb_per_s\":%.2f,\"note\":\"%s\"}",
+               i ? "," : "", r->name, r->corpus, r->unit, r->items, r->bytes, r->reps,
+               r->ns_min, r->ns_mean, r->ns_min > 0.0 ? 1e9 / r->ns_min : 0.0, mb_s,
+               r->note);
+    }
+    printf("\n]}\n");
+}
+
+static void usage(void)
+{
+    printf("Usage: ntrip-bench [--json] [--min-time SECONDS] [--filter TEXT]\n"
+           "                   [--write-corpus DIR]\n"
+           "\n"
+           "  --json              Print the results as one JSON object\n"
+           "  --min-time S        Run each case for at least S seconds (default 0.5)\n"
+           "  --filter TEXT       Only run cases whose case/corpus name contains TEXT\n"
+           "  --write-corpus DIR  Save the generated corpora as DIR/<name>.rtcm and exit\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool json = false;
+    const char *corpus_dir = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            json = true;
+        } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+            s_min_time = atof(argv[++i]);
+            if (s_min_time < 0.0) s_min_time = 0.0;
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            s_filter = argv[++i];
+        } else if (!strcmp(argv[i], "--write-corpus") && i + 1 < argc) {
+            corpus_dir = argv[++i];
+        } else {
+            usage();
+            return strcmp(argv[i], "--help") && strcmp(argv[i], "-h") ? 1 : 0;
+        }
+    }
+
+    static const int k_sats[] = { 8, 16, 32 };
+    static const char *const k_msm4_names[] = { "msm4_s8", "msm4_s16", "msm4_s32" };
+    static const char *const k_msm7_names[] = { "msm7_s8", "msm7_s16", "msm7_s32" };
+    Corpus msm4[3], msm7[3], eph, corrupt, ubx;
+    memset(msm4, 0, sizeof(msm4));
+    memset(msm7, 0, sizeof(msm7));
+    memset(&eph, 0, sizeof(eph));
+    memset(&corrupt, 0, sizeof(corrupt));
+    memset(&ubx, 0, sizeof(ubx));
+    for (int k = 0; k < 3; k++) {
+        msm4[k].name = k_msm4_names[k];
+        msm7[k].name = k_msm7_names[k];
+        gen_msm(&msm4[k], &k_msm4, k_sats[k]);
+        gen_msm(&msm7[k], &k_msm7, k_sats[k]);
+    }
+    eph.name = "eph";
+    gen_eph(&eph);
+    corrupt.name = "corrupt";
+    gen_corrupt(&corrupt);
+    ubx.name = "ubx";
+    gen_ubx(&ubx);
+
+    if (corpus_dir) {
+        bool ok = true;
+        for (int k = 0; k < 3; k++)
+            ok = corpus_write(&msm4[k], corpus_dir) && corpus_write(&msm7[k], corpus_dir) && ok;
+        ok = corpus_write(&eph, corpus_dir) && ok;
+        ok = corpus_write(&corrupt, corpus_dir) && corpus_write(&ubx, corpus_dir) && ok;
+        return ok ? 0 : 1;
+    }
+
+    rtcm_strbuf_init(&s_text, 4096);
+    sv_eph_init();
+
+    for (int k = 0; k < 3; k++)
+        bench_case("crc24q", &msm7[k], msm7[k].name, "frames", case_crc, &msm7[k]);
+    for (int k = 0; k < 3; k++)
+        bench_case("msm_parse", &msm4[k], msm4[k].name, "frames", case_msm_parse, &msm4[k]);
+    for (int k = 0; k < 3; k++)
+        bench_case("msm_parse", &msm7[k], msm7[k].name, "frames", case_msm_parse, &msm7[k]);
+    bench_case("text_decode", &msm4[2], msm4[2].name, "frames", case_text_decode, &msm4[2]);
+    bench_case("text_decode", &msm7[2], msm7[2].name, "frames", case_text_decode, &msm7[2]);
+    bench_case("text_decode", &eph, eph.name, "frames", case_text_decode, &eph);
+    bench_case("eph_decode", &eph, eph.name, "frames", case_eph_decode, &eph);
+
+    static FramerArg fa[3];
+    const Corpus *framed[3] = { &msm7[2], &corrupt, &ubx };
+    for (int k = 0; k < 3; k++) {
+        fa[k].c = framed[k];
+        fa[k].chunk = 1460;                     /* one TCP segment */
+        BenchResult *r = bench_case("framer", framed[k], framed[k]->name, "frames",
+                                    case_framer, &fa[k]);
+        if (r && fa[k].framer.format != STREAM_FMT_RTCM3)
+            snprintf(r->note, sizeof(r->note), "%s, %lu checked, %lld delivered",
+                     stream_format_name(fa[k].framer.format), fa[k].framer.frames,
+                     fa[k].frames);
+        else if (r)
+            snprintf(r->note, sizeof(r->note), "%lld delivered, %lu crc errors, %lu resyncs",
+                     fa[k].frames, fa[k].framer.crc_errors, fa[k].framer.resyncs);
+    }
+
+    /* The sky, orbit and PNG cases need the ephemerides in the store. */
+    case_eph_decode(&eph);
+    BenchResult *sky = bench_case("sky_feed", &msm4[2], msm4[2].name, "frames",
+                                  case_sky, &msm4[2]);
+    if (sky)
+        snprintf(sky->note, sizeof(sky->note), "%u SV updates", (unsigned)s_sink);
+
+    static OrbitArg oa[3];
+    static const char *const k_orbit_names[] = { "orbit_scalar", "orbit_batch", "orbit_cached" };
+    for (int m = 0; m < 3; m++) {
+        oa[m].mode = m;
+        for (int prn = 1; prn <= BENCH_N_SV; prn++) {
+            const SvEphemeris *e = sv_eph_get(1, prn);
+            if (e) oa[m].eph[oa[m].n++] = e;
+        }
+        bench_case(k_orbit_names[m], NULL, "eph", "positions", case_orbit, &oa[m]);
+    }
+
+    const char *tmp = getenv("TMPDIR");
+    if (!tmp) tmp = getenv("TEMP");
+#ifdef _WIN32
+    if (!tmp) tmp = ".";
+#else
+    if (!tmp) tmp = "/tmp";
+#endif
+    snprintf(s_png_path, sizeof(s_png_path), "%s%cntrip_bench_heatmap.png", tmp, BENCH_SEP);
+    /* Fill the heatmap first so the PNG has every sector coloured. */
+    case_sky(&msm4[2]);
+    BenchResult *png = bench_case("png_render", NULL, "sky", "images", case_png, NULL);
+    if (png && png->items == 0)
+        snprintf(png->note, sizeof(png->note), "cannot write the PNG");
+    remove(s_png_path);
+
+    if (json) print_json();
+    else      print_text();
+
+    rtcm_strbuf_free(&s_text);
+    for (int k = 0; k < 3; k++) {
+        corpus_free(&msm4[k]);
+        corpus_free(&msm7[k]);
+    }
+    corpus_free(&eph);
+    corpus_free(&corrupt);
+    corpus_free(&ubx);
+    return 0;
+}
@@ -13,11 +13,11 @@ if ($LASTEXITCODE -ne 0) {
 Write-Host "Building GUI executable..." -ForegroundColor Cyan
 & 'C:/Program Files/CodeBlocks/MinGW/bin/gcc.exe' -g -mwindows -std=c99 -D_USE_MATH_DEFINES `
     -o bin/ntrip-analyser-gui.exe `
-    gui/gui_main.c gui/gui_layout.c gui/gui_events.c gui/gui_thread.c gui/gui_log.c gui/gui_parsers.c gui/gui_detail.c gui/gui_sky_window.c gui/gui_snapshot.c gui/gui_sv_detail.c `
-    src/ntrip_handler.c src/rtcm3x_parser.c src/config.c src/nmea_parser.c src/sv_ephemeris.c src/sv_orbit.c src/rinex_nav.c `
+    gui/gui_main.c gui/gui_layout.c gui/gui_events.c gui/gui_thread.c gui/gui_frame_queue.c gui/gui_type_map.c gui/gui_log.c gui/gui_parsers.c gui/gui_detail.c gui/gui_sky_window.c gui/gui_sky_track.c gui/gui_cnr_history.c gui/gui_snapshot.c gui/gui_sv_detail.c gui/gui_history.c gui/gui_ui_lag.c gui/gui_list_model.c `
+    src/ntrip_handler.c src/rtcm3x_parser.c src/rtcm_fmt.c src/rtcm_unpack.c src/sat_vis.c src/geo_index.c src/sourcetable_cache.c src/ntrip_session.c src/ntrip_connect.c src/ntrip_http.c src/ntrip_tls.c src/perf_probe.c src/corr_age.c src/obs_quality.c src/quantile_sketch.c src/event_out.c src/stats_snapshot.c src/live_view.c src/load_governor.c src/bw_meter.c src/rollup.c src/anomaly_ring.c src/rtcm_framer.c src/stream_format.c src/config.c src/nmea_parser.c src/sv_ephemeris.c src/sv_orbit.c src/sky_epoch.c src/sky_grid.c src/sky_render.c src/raster.c src/file_map.c src/rtcm_replay.c src/rtcm_capture.c src/rtcm_recorder.c src/lz_block.c src/stream_clock.c src/rinex_nav.c src/rinex_obs.c src/obs_columns.c `
     lib/cJSON/cJSON.c gui/resource.o `
     -Isrc -Ilib/cJSON -Igui `
-    -lws2_32 -lcomctl32 -lcomdlg32 -lgdiplus -lm -Wall
+    -lws2_32 -lcomctl32 -lcomdlg32 -lm -Wall
 
 if ($LASTEXITCODE -ne 0) {
     Write-Host "Build failed!" -ForegroundColor Red
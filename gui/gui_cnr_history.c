@@ -0,0 +1,130 @@
+/**
+ * @file gui_cnr_history.c
+ * @brief Per-signal CNR history with rolling statistics.
+ *
+ * An observation updates the means and extremes of its series; it goes
+ * into the ring only when CNR_HIST_INTERVAL_S has passed since the last
+ * sample, so a 10 Hz stream fills the ring no faster than a 1 Hz one.
+ * The means use alpha = 1 - exp(-dt / tau) with dt the time since the
+ * observation before; the first observation sets them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_cnr_history.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static CnrSeries *series_get(CnrHistory *h, int g, int prn, int sig)
+{
+    CnrSvHistory **sv = &h->sv[g][prn - 1];
+    if (!*sv) {
+        *sv = (CnrSvHistory *)calloc(1, sizeof(**sv));
+        if (!*sv) return NULL;
+    }
+    CnrSeries **s = &(*sv)->sig[sig];
+    if (!*s) {
+        *s = (CnrSeries *)malloc(sizeof(**s));
+        if (!*s) return NULL;
+        (*s)->n = 0;
+        h->n_series++;
+    }
+    return *s;
+}
+
+static float ewma(float mean, float x, double dt, double tau)
+{
+    return mean + (float)(1.0 - exp(-dt / tau)) * (x - mean);
+}
+
+bool cnr_history_add(CnrHistory *h, int gnss_id, int prn, int sig_idx,
+                     double ts, float cnr_dbhz)
+{
+    if (gnss_id < 0 || gnss_id >= RTCM_CNR_MAX_GNSS) return false;
+    if (prn < 1 || prn > RTCM_CNR_MAX_PRN)           return false;
+    if (sig_idx < 0 || sig_idx >= RTCM_CNR_MAX_SIGS) return false;
+    if (!(cnr_dbhz > 0.0f)) return true;
+
+    CnrSeries *s = series_get(h, gnss_id, prn, sig_idx);
+    if (!s) return false;
+    if (!h->has_t0) {
+        h->t0     = ts;
+        h->has_t0 = true;
+    }
+
+    if (s->n == 0) {
+        s->t_first = ts;
+        s->fast = s->slow = s->min = s->max = cnr_dbhz;
+    } else {
+        double dt = ts - s->t_obs;
+        if (dt < 0.0) dt = 0.0;
+        s->fast = ewma(s->fast, cnr_dbhz, dt, CNR_HIST_FAST_TAU_S);
+        s->slow = ewma(s->slow, cnr_dbhz, dt, CNR_HIST_SLOW_TAU_S);
+        if (cnr_dbhz < s->min) s->min = cnr_dbhz;
+        if (cnr_dbhz > s->max) s->max = cnr_dbhz;
+    }
+    s->t_obs = ts;
+
+    if (s->n > 0 && ts - s->t_sample < CNR_HIST_INTERVAL_S)
+        return true;
+
+    long q  = lround(cnr_dbhz * CNR_HIST_Q);
+    double dts = (ts - h->t0) * 10.0;
+    uint32_t i = s->n % CNR_HIST_PTS;
+    s->q[i]    = (uint8_t)(q < 1 ? 1 : q > 255 ? 255 : q);
+    s->t_ds[i] = dts > 0.0 ? (uint32_t)(dts + 0.5) : 0;
+    s->t_sample = ts;
+    s->n++;
+    return true;
+}
+
+void cnr_history_add_obs(CnrHistory *h, const RtcmMsmObs *obs, double ts)
+{
+    if (!obs || obs->msm_subtype < 4) return;   /* MSM1..3 carry no CNR */
+    for (int c = 0; c < obs->num_cells; c++) {
+        const RtcmMsmCell *cell = &obs->cells[c];
+        (void)cnr_history_add(h, obs->gnss_id, obs->sats[cell->sat].prn,
+                              cell->sig_idx, ts, cell->cnr_dbhz);
+    }
+}
+
+const CnrSeries *cnr_history_series(const CnrHistory *h, int gnss_id, int prn,
+                                    int sig_idx)
+{
+    if (gnss_id < 0 || gnss_id >= RTCM_CNR_MAX_GNSS) return NULL;
+    if (prn < 1 || prn > RTCM_CNR_MAX_PRN)           return NULL;
+    if (sig_idx < 0 || sig_idx >= RTCM_CNR_MAX_SIGS) return NULL;
+    const CnrSvHistory *sv = h->sv[gnss_id][prn - 1];
+    return sv ? sv->sig[sig_idx] : NULL;
+}
+
+float cnr_series_at(const CnrHistory *h, const CnrSeries *s, unsigned k,
+                    double *ts_out)
+{
+    unsigned count = cnr_series_count(s);
+    if (k >= count) {
+        if (ts_out) *ts_out = 0.0;
+        return 0.0f;
+    }
+    uint32_t i = (s->n - count + k) % CNR_HIST_PTS;
+    if (ts_out) *ts_out = h->t0 + s->t_ds[i] / 10.0;
+    return (float)s->q[i] / CNR_HIST_Q;
+}
+
+void cnr_history_free(CnrHistory *h)
+{
+    for (int g = 0; g < RTCM_CNR_MAX_GNSS; g++) {
+        for (int p = 0; p < RTCM_CNR_MAX_PRN; p++) {
+            CnrSvHistory *sv = h->sv[g][p];
+            if (!sv) continue;
+            for (int i = 0; i < RTCM_CNR_MAX_SIGS; i++)
+                free(sv->sig[i]);
+            free(sv);
+        }
+    }
+    memset(h, 0, sizeof(*h));
+}
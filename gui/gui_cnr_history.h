@@ -0,0 +1,141 @@
+/**
+ * @file gui_cnr_history.h
+ * @brief Per-signal CNR history with rolling statistics for the SV
+ *        detail window.
+ *
+ * Each (gnss_id, prn, signal) pair seen in an MSM4..MSM7 frame gets a
+ * @ref CnrSeries: a ring of the last @ref CNR_HIST_PTS samples, one per
+ * @ref CNR_HIST_INTERVAL_S, and statistics that are updated on every
+ * observation so reading them costs nothing:
+ *
+ *   - a fast and a slow exponentially weighted mean (time constants
+ *     @ref CNR_HIST_FAST_TAU_S and @ref CNR_HIST_SLOW_TAU_S, weighted by
+ *     the time since the observation before, so a gap in the stream
+ *     does not skew them)
+ *   - minimum and maximum since the series started
+ *
+ * A sample is 5 bytes: the CNR in 1/@ref CNR_HIST_Q dB-Hz (MSM7 has
+ * 1/16 dB-Hz, the plot and the thresholds need far less) and the time in
+ * tenths of a second since the history started.  With the defaults that
+ * is 17 minutes at 1 Hz in about 5 KB per signal.
+ *
+ * Nothing is allocated for pairs never seen: a PRN takes a small table
+ * of series pointers when it first shows up, a signal its series when it
+ * first carries a CNR.  A GPS + Galileo + BeiDou stream on three signals
+ * each stays well under 1 MB.
+ *
+ * UI thread only.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_CNR_HISTORY_H
+#define GUI_CNR_HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rtcm3x_parser.h"
+
+/** @brief Samples kept per signal (17 min at 1 Hz). */
+#define CNR_HIST_PTS         1024
+
+/** @brief Minimum seconds between two ring samples of one signal; the
+ *         statistics still take every observation in between. */
+#define CNR_HIST_INTERVAL_S  1.0
+
+/** @brief Ring samples are in 1/CNR_HIST_Q dB-Hz (0..63.75 dB-Hz). */
+#define CNR_HIST_Q           4
+
+/** @brief Time constant of the fast mean: the current level. */
+#define CNR_HIST_FAST_TAU_S  10.0
+
+/** @brief Time constant of the slow mean: the usual level of the pass. */
+#define CNR_HIST_SLOW_TAU_S  600.0
+
+/** @brief Fast mean this far under the slow mean flags a degradation. */
+#define CNR_HIST_DEGRADE_DB  6.0f
+
+/** @brief Seconds a series must run before it can be flagged. */
+#define CNR_HIST_WARMUP_S    60.0
+
+/**
+ * @struct CnrSeries
+ * @brief History and statistics of one (gnss_id, prn, signal).
+ *
+ * Sample k (0 = oldest) of the ring sits at index (n - count + k) %
+ * CNR_HIST_PTS; use cnr_series_at().
+ */
+typedef struct {
+    uint32_t t_ds[CNR_HIST_PTS];  /**< Tenths of a second since CnrHistory::t0 */
+    uint8_t  q[CNR_HIST_PTS];     /**< CNR * CNR_HIST_Q, clamped to 1..255 */
+    uint32_t n;                   /**< Samples ever written to the ring */
+    double   t_first;             /**< First observation (gui_get_time_seconds()) */
+    double   t_obs;               /**< Newest observation */
+    double   t_sample;            /**< Newest ring sample */
+    float    fast;                /**< EWMA, CNR_HIST_FAST_TAU_S */
+    float    slow;                /**< EWMA, CNR_HIST_SLOW_TAU_S */
+    float    min;
+    float    max;
+} CnrSeries;
+
+/** @brief Series of one PRN, indexed by MSM signal-mask position. */
+typedef struct {
+    CnrSeries *sig[RTCM_CNR_MAX_SIGS];
+} CnrSvHistory;
+
+/**
+ * @struct CnrHistory
+ * @brief All series of one stream.  All zero is empty.
+ */
+typedef struct {
+    double        t0;             /**< Time origin of CnrSeries::t_ds */
+    bool          has_t0;
+    unsigned      n_series;       /**< Series allocated */
+    CnrSvHistory *sv[RTCM_CNR_MAX_GNSS][RTCM_CNR_MAX_PRN];
+} CnrHistory;
+
+/**
+ * @brief Record one CNR observation at time @p ts.
+ *
+ * Values <= 0 (no CNR) are ignored.
+ * @return false on a bad index or when out of memory.
+ */
+bool cnr_history_add(CnrHistory *h, int gnss_id, int prn, int sig_idx,
+                     double ts, float cnr_dbhz);
+
+/** @brief cnr_history_add() for every cell of a decoded MSM4..MSM7 frame. */
+void cnr_history_add_obs(CnrHistory *h, const RtcmMsmObs *obs, double ts);
+
+/** @brief Series of (gnss_id, prn, sig_idx); NULL when it was never seen. */
+const CnrSeries *cnr_history_series(const CnrHistory *h, int gnss_id, int prn,
+                                    int sig_idx);
+
+/** @brief Samples held in the ring. */
+static inline unsigned cnr_series_count(const CnrSeries *s)
+{
+    return s->n < CNR_HIST_PTS ? s->n : CNR_HIST_PTS;
+}
+
+/**
+ * @brief Sample @p k of @p s, 0 = oldest.
+ * @param ts_out   Time in gui_get_time_seconds() units.
+ * @return The CNR in dB-Hz, 0 past the end.
+ */
+float cnr_series_at(const CnrHistory *h, const CnrSeries *s, unsigned k,
+                    double *ts_out);
+
+/** @brief Whether the fast mean of @p s has dropped
+ *         CNR_HIST_DEGRADE_DB under its slow mean. */
+static inline bool cnr_series_degraded(const CnrSeries *s)
+{
+    return s->t_obs - s->t_first >= CNR_HIST_WARMUP_S &&
+           s->slow - s->fast >= CNR_HIST_DEGRADE_DB;
+}
+
+/** @brief Free every series and clear @p h (new stream). */
+void cnr_history_free(CnrHistory *h);
+
+#endif /* GUI_CNR_HISTORY_H */
@@ -18,7 +18,7 @@
 #include <stdio.h>
 
 /* ── Private message for the detail window ─────────────────── */
-#define WM_DETAIL_UPDATE  (WM_USER + 1)   /* lParam = heap-allocated char* */
+#define WM_DETAIL_UPDATE  (WM_USER + 1)   /* lParam = const char*, owned by the sender */
 
 /* Top-strip dimensions reserved for the Copy button.
  * Strip is taller than the button so it sits centred vertically. */
@@ -97,13 +97,13 @@ static LRESULT CALLBACK DetailWndProc(HWND hwnd, UINT msg,
     }
 
     case WM_DETAIL_UPDATE: {
-        /* lParam = heap-allocated char* with decoded text (we free it) */
-        char *text = (char *)lParam;
+        /* lParam = decoded text in the main window's scratch buffer,
+         * sent (not posted): SetWindowText copies it before we return */
+        const char *text = (const char *)lParam;
         if (text) {
             HWND hEdit = GetDlgItem(hwnd, IDC_DETAIL_EDIT);
             if (hEdit)
                 SetWindowText(hEdit, text);
-            HeapFree(GetProcessHeap(), 0, text);
         }
         return 0;
     }
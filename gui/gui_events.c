@@ -14,8 +14,13 @@
 #include "gui_state.h"
 #include "gui_sky_window.h"
 #include "gui_vrs_window.h"
+#include "gui_history.h"
 #include "rtcm3x_parser.h"
 #include "rinex_nav.h"
+#include "rtcm_capture.h"
+#include "stream_clock.h"
+#include "stream_format.h"
+#include "sky_grid.h"
 #include "config.h"
 #include "cJSON.h"
 
@@ -40,57 +45,30 @@ static void OnGetMountpoints(HWND hwnd, AppState *state);
 static void OnOpenStream(HWND hwnd, AppState *state);
 static void OnCloseStream(HWND hwnd, AppState *state);
 static void OnStreamDone(HWND hwnd, AppState *state);
-static void OnStatUpdate(AppState *state, int msg_type, int count);
+static void OnStatUpdate(AppState *state, int k);
 static void OnSatUpdate(AppState *state);
+static void UiStatsReset(AppState *state);
+static void DrainUiQueue(AppState *state);
+static void UiFreeLastFrames(AppState *state);
+static void UiTypesReset(AppState *state);
+static void FinishUiQueue(AppState *state);
 static void close_rtcm_capture_if_active(AppState *state);
 
-/* ── Generic ListView sort state ──────────────────────────── */
-static int  g_sortColumn    = -1;   /* currently sorted column (-1 = none) */
-static BOOL g_sortAscending = TRUE; /* TRUE = A→Z / ascending */
-static HWND g_sortListView  = NULL; /* ListView handle for compare callback */
-static BOOL g_sortNumeric   = FALSE;/* TRUE = compare as numbers */
+/* ── ListView sorting ────────────────────────────────────── */
 
 /**
- * @brief Comparison callback for ListView_SortItemsEx.
- *
- * Uses g_sortNumeric to decide between numeric (atof) and text (_stricmp)
- * comparison.  Works for any ListView that sets the globals before calling
- * ListView_SortItemsEx.
- */
-static int CALLBACK LvCompareFunc(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
-{
-    (void)lParamSort;
-
-    char buf1[256], buf2[256];
-    ListView_GetItemText(g_sortListView, (int)lParam1, g_sortColumn, buf1, sizeof(buf1));
-    ListView_GetItemText(g_sortListView, (int)lParam2, g_sortColumn, buf2, sizeof(buf2));
-
-    int result;
-
-    if (g_sortNumeric) {
-        double v1 = atof(buf1);
-        double v2 = atof(buf2);
-        if (v1 < v2)      result = -1;
-        else if (v1 > v2) result =  1;
-        else               result =  0;
-    } else {
-        result = _stricmp(buf1, buf2);
-    }
-
-    return g_sortAscending ? result : -result;
-}
-
-/**
- * @brief Sort a ListView by a column and update the header sort arrows.
+ * @brief Work out the sort direction for a click on a column header and
+ *        update the header sort arrows.
  *
  * Tracks per-ListView sort state using two static pairs so that the Msg
  * Stats and Mountpoint ListViews each remember their own column+direction.
+ * The lists are owner-data, so the caller reorders its own rows.
  *
- * @param hLv       ListView handle.
- * @param col       Column index that was clicked.
- * @param isNumeric TRUE if the column should be sorted numerically.
+ * @param hLv  ListView handle.
+ * @param col  Column index that was clicked.
+ * @return TRUE to sort ascending, FALSE for descending.
  */
-static void SortListView(HWND hLv, int col, BOOL isNumeric)
+static BOOL LvNextSortOrder(HWND hLv, int col)
 {
     /* ── Per-ListView sort state (two tracked ListViews) ──── */
     static HWND savedHwnd[2]  = { NULL, NULL };
@@ -117,14 +95,6 @@ static void SortListView(HWND hLv, int col, BOOL isNumeric)
         savedAsc[slot] = TRUE;
     }
 
-    /* Set globals for the compare callback */
-    g_sortListView = hLv;
-    g_sortColumn   = col;
-    g_sortAscending = savedAsc[slot];
-    g_sortNumeric   = isNumeric;
-
-    ListView_SortItemsEx(hLv, LvCompareFunc, 0);
-
     /* Update header sort arrows */
     HWND hHeader = ListView_GetHeader(hLv);
     int nCols = Header_GetItemCount(hHeader);
@@ -138,6 +108,300 @@ static void SortListView(HWND hLv, int col, BOOL isNumeric)
         }
         Header_SetItem(hHeader, c, &hdi);
     }
+    return savedAsc[slot];
+}
+
+/**
+ * @brief Sort the mountpoint list, keeping the selected rows selected.
+ *
+ * An owner-data ListView tracks selection by index, so the selected
+ * rows are noted before the table is reordered and selected again at
+ * their new positions.
+ */
+static void SortMountList(AppState *state, int col, BOOL ascending)
+{
+    GuiMountTable *t = &state->mountTable;
+    HWND hLv = state->hLvMountpoints;
+    int n = t->count;
+    if (n == 0) return;
+
+    int nSel = ListView_GetSelectedCount(hLv);
+    unsigned char *selRows = NULL;
+    if (nSel > 0 && nSel < n) {
+        selRows = (unsigned char *)calloc((size_t)n, 1);
+        int i = -1;
+        while (selRows && (i = ListView_GetNextItem(hLv, i, LVNI_SELECTED)) >= 0)
+            selRows[t->order[i]] = 1;
+    }
+
+    MountTableSort(t, col, ascending);
+
+    if (selRows) {
+        ListView_SetItemState(hLv, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+        for (int i = 0; i < n; i++)
+            if (selRows[t->order[i]])
+                ListView_SetItemState(hLv, i, LVIS_SELECTED, LVIS_SELECTED);
+        free(selRows);
+    }
+    ListView_RedrawItems(hLv, 0, n - 1);
+}
+
+/* Value of column col of a Msg Stats row, as the list shows it. */
+/**
+ * @brief Median age of corrections of an MSM type in seconds; -1 if none.
+ */
+static double StatAgeSeconds(const AppState *state, int mt)
+{
+    const CorrAgeStat *a = corr_age_stat(&state->corrAge, mt);
+    if (!a || a->hist.count == 0) return -1.0;
+    return perf_hist_quantile(&a->hist, 0.50) / 1e9;
+}
+
+static double StatColumnValue(const AppState *state, int k, int col)
+{
+    const GuiMsgStat *s = &state->msgStats[k];
+    int mt = state->msgTypes.type[k];
+    switch (col) {
+    case 0:  return mt;
+    case 1:  return s->count;
+    case 2:  return s->min_dt;
+    case 3:  return s->max_dt;
+    case 5:  return qsketch_quantile(&s->dt, 0.50);
+    case 6:  return qsketch_quantile(&s->dt, 0.95);
+    case 7:  return qsketch_quantile(&s->dt, 0.99);
+    case 8:  return qsketch_quantile(&s->dt, 0.999);
+    case 9:  return StatAgeSeconds(state, mt);
+    case 10: return (double)s->bwRates.bytes;
+    case 11: return s->bwRates.bytes_s[BW_WIN_1S];
+    case 12: return s->bwRates.bytes_s[BW_WIN_10S];
+    case 13: return s->bwRates.bytes_s[BW_WIN_60S];
+    case 14: return s->bwRates.peak_1s;
+    case 15: return s->bwRates.burst_peak;
+    default: return (s->count > 1) ? s->sum_dt / (s->count - 1) : 0.0;
+    }
+}
+
+/* qsort has no context argument; sorting only happens on the UI thread. */
+static const AppState *s_statSortState;
+static int             s_statSortCol;
+static BOOL            s_statSortAsc;
+
+static int StatRowCompare(const void *a, const void *b)
+{
+    int k1 = *(const int *)a, k2 = *(const int *)b;
+    int mt1 = s_statSortState->msgTypes.type[k1];
+    int mt2 = s_statSortState->msgTypes.type[k2];
+    int result;
+
+    if (s_statSortCol <= 15) {
+        /* Columns 0–15 are numeric */
+        double v1 = StatColumnValue(s_statSortState, k1, s_statSortCol);
+        double v2 = StatColumnValue(s_statSortState, k2, s_statSortCol);
+        result = (v1 < v2) ? -1 : (v1 > v2);
+    } else {
+        result = _stricmp(RtcmMsgDescription(mt1), RtcmMsgDescription(mt2));
+    }
+    if (result == 0) result = (mt1 > mt2) - (mt1 < mt2);
+    return s_statSortAsc ? result : -result;
+}
+
+/**
+ * @brief Sort the Msg Stats rows by a column.
+ *
+ * Rows keep the new order while the counters change; types seen later
+ * are appended at the bottom, as before a sort.
+ */
+static void SortStatList(AppState *state, int col, BOOL ascending)
+{
+    int n = state->statRows;
+    if (n == 0) return;
+
+    int sel = ListView_GetNextItem(state->hLvMsgStats, -1, LVNI_SELECTED);
+    int selIdx = (sel >= 0 && sel < n) ? state->statRowIdx[sel] : -1;
+
+    s_statSortState = state;
+    s_statSortCol   = col;
+    s_statSortAsc   = ascending;
+    qsort(state->statRowIdx, (size_t)n, sizeof(int), StatRowCompare);
+    for (int i = 0; i < n; i++)
+        state->statRowOf[state->statRowIdx[i]] = i + 1;
+
+    if (selIdx >= 0) {
+        int row = state->statRowOf[selIdx] - 1;
+        ListView_SetItemState(state->hLvMsgStats, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+        ListView_SetItemState(state->hLvMsgStats, row,
+                              LVIS_SELECTED | LVIS_FOCUSED,
+                              LVIS_SELECTED | LVIS_FOCUSED);
+    }
+    gui_list_model_invalidate(&state->statModel);
+    ListView_RedrawItems(state->hLvMsgStats, 0, n - 1);
+}
+
+/**
+ * @brief Empty the Msg Stats, Satellites and Signal Quality lists (new
+ *        stream or replay).
+ */
+static void StatListsReset(AppState *state)
+{
+    for (int k = 0; k < state->msgTypes.n; k++)
+        state->statRowOf[k] = 0;
+    state->statRows = 0;
+    ListView_DeleteAllItems(state->hLvMsgStats);
+    ListView_DeleteAllItems(state->hLvSatellites);
+    gui_list_model_reset(&state->statModel);
+    gui_list_model_reset(&state->satModel);
+    ListView_DeleteAllItems(state->hLvQuality);
+    perf_stream_reset(&state->perf);
+    ui_lag_reset(&state->uiLag);
+    memset(&state->corrAge, 0, sizeof(state->corrAge));
+    memset(&state->qualityStats, 0, sizeof(state->qualityStats));
+}
+
+/* ── Owner-data ListView cells ────────────────────────────── */
+
+/**
+ * @brief Text of one Msg Stats cell.
+ */
+static void StatCellText(const AppState *state, int item, int col,
+                         char *out, int outLen)
+{
+    if (item < 0 || item >= state->statRows) { out[0] = '\0'; return; }
+    int k  = state->statRowIdx[item];
+    int mt = state->msgTypes.type[k];
+    const GuiMsgStat *s = &state->msgStats[k];
+
+    switch (col) {
+    case 0:  snprintf(out, outLen, "%d", mt);        break;
+    case 1:  snprintf(out, outLen, "%d", s->count);  break;
+    case 9: {
+        double age = StatAgeSeconds(state, mt);
+        if (age < 0.0) out[0] = '\0';
+        else           snprintf(out, outLen, "%.3f", age);
+        break;
+    }
+    case 10: snprintf(out, outLen, "%llu", (unsigned long long)s->bwRates.bytes); break;
+    case 11:
+    case 12:
+    case 13: snprintf(out, outLen, "%.0f", StatColumnValue(state, k, col)); break;
+    case 14: snprintf(out, outLen, "%u", (unsigned)s->bwRates.peak_1s); break;
+    case 15: snprintf(out, outLen, "%u", (unsigned)s->bwRates.burst_peak); break;
+    case 16: snprintf(out, outLen, "%s", RtcmMsgDescription(mt)); break;
+    default: snprintf(out, outLen, "%.3f", StatColumnValue(state, k, col)); break;
+    }
+}
+
+/**
+ * @brief Text of one Satellites cell: GNSS name, satellites seen, in
+ *        view at the latest epoch, dropouts, or the RINEX IDs of the
+ *        satellites seen.
+ */
+static void SatCellText(const AppState *state, int item, int col,
+                        char *out, int outLen)
+{
+    const SatStatsSummary *sat = &state->satStats;
+    out[0] = '\0';
+    if (item < 0 || item >= sat->gnss_count || outLen <= 0) return;
+    const GnssSatStats *gs = &sat->gnss[item];
+
+    if (col == 0) {
+        snprintf(out, outLen, "%s", gnss_name_from_id(gs->gnss_id));
+    } else if (col == 1) {
+        snprintf(out, outLen, "%d", sat_mask_count(gs->seen));
+    } else if (col == 2) {
+        snprintf(out, outLen, "%d", sat_mask_count(sat_vis_now(&gs->vis)));
+    } else if (col == 3) {
+        snprintf(out, outLen, "%u", sat_vis_dropouts(&gs->vis, 0));
+    } else if (col == 4) {
+        int pos = 0;
+        SatMask seen = gs->seen;
+        for (int s; (s = sat_mask_next(&seen)) != 0; ) {
+            char id[8];
+            rinex_id_from_gnss(gs->gnss_id, s, id, sizeof(id));
+            if (pos > 0 && pos < outLen - 6)
+                out[pos++] = ' ';
+            int wrote = snprintf(out + pos, outLen - pos, "%s", id);
+            if (wrote < 0 || wrote >= outLen - pos) break;
+            pos += wrote;
+        }
+    }
+}
+
+/* Columns and cell sizes of the lists behind a GuiListModel; a
+ * Satellites row lists every satellite seen in its last column. */
+#define STAT_LIST_COLS      17
+#define STAT_LIST_CELL_LEN  64
+#define SAT_LIST_COLS       5
+#define SAT_LIST_CELL_LEN   260
+
+static void StatModelCell(const void *ctx, int row, int col, char *out, int outLen)
+{
+    StatCellText((const AppState *)ctx, row, col, out, outLen);
+}
+
+static void SatModelCell(const void *ctx, int row, int col, char *out, int outLen)
+{
+    SatCellText((const AppState *)ctx, row, col, out, outLen);
+}
+
+/**
+ * @brief Text of one Signal Quality cell: station, GNSS, signal and the
+ *        counts of one ObsQualityRow.
+ */
+static void QualityCellText(const AppState *state, int item, int col,
+                            char *out, int outLen)
+{
+    const ObsQualityStats *q = &state->qualityStats;
+    out[0] = '\0';
+    if (item < 0 || item >= q->n_rows || outLen <= 0) return;
+    const ObsQualityRow *r = &q->row[item];
+
+    switch (col) {
+    case 0: snprintf(out, outLen, "%u", (unsigned)r->station); break;
+    case 1: snprintf(out, outLen, "%s", gnss_name_from_id(r->gnss_id)); break;
+    case 2: snprintf(out, outLen, "%s", msm_signal_label(r->gnss_id, r->sig_idx)); break;
+    case 3: snprintf(out, outLen, "%llu", (unsigned long long)r->obs); break;
+    case 4: snprintf(out, outLen, "%u", r->tracks); break;
+    case 5: snprintf(out, outLen, "%u", r->slips); break;
+    case 6: snprintf(out, outLen, "%u", r->gaps); break;
+    case 7: snprintf(out, outLen, "%u", r->missed); break;
+    case 8: snprintf(out, outLen, "%u", r->cnr_drops); break;
+    case 9: snprintf(out, outLen, "%u", r->half_cycles); break;
+    }
+}
+
+/**
+ * @brief Text of one Performance cell (µs): one row per PerfStage, then
+ *        the UI thread's queue, handler and paint rows (gui_ui_lag.h).
+ */
+static void PerfCellText(const AppState *state, int item, int col,
+                         char *out, int outLen)
+{
+    out[0] = '\0';
+    if (item < 0 || item >= PERF_STAGE_COUNT + UI_LAG_ROWS || outLen <= 0) return;
+    char name[48];
+    const PerfHist *h;
+    if (item < PERF_STAGE_COUNT) {
+        h = &state->perf.stage[item];
+        snprintf(name, sizeof(name), "%s", perf_stage_name((PerfStage)item));
+    } else {
+        h = ui_lag_row(&state->uiLag, item - PERF_STAGE_COUNT, name, sizeof(name));
+    }
+
+    if (col == 0) {
+        snprintf(out, outLen, "%s", name);
+        return;
+    }
+    uint64_t count = h->count;
+    if (count == 0) return;
+    switch (col) {
+    case 1: snprintf(out, outLen, "%llu", (unsigned long long)count); break;
+    case 2: snprintf(out, outLen, "%.1f", (double)h->sum_ns / (double)count / 1e3); break;
+    case 3: snprintf(out, outLen, "%.1f", perf_hist_quantile(h, 0.50)  / 1e3); break;
+    case 4: snprintf(out, outLen, "%.1f", perf_hist_quantile(h, 0.90)  / 1e3); break;
+    case 5: snprintf(out, outLen, "%.1f", perf_hist_quantile(h, 0.99)  / 1e3); break;
+    case 6: snprintf(out, outLen, "%.1f", perf_hist_quantile(h, 0.999) / 1e3); break;
+    case 7: snprintf(out, outLen, "%.1f", h->max_ns / 1e3); break;
+    }
 }
 
 /* ── ListView clipboard helpers ──────────────────────────── */
@@ -147,9 +411,8 @@ static void SortListView(HWND hLv, int col, BOOL isNumeric)
  */
 static void LvSelectAll(HWND hLv)
 {
-    int count = ListView_GetItemCount(hLv);
-    for (int i = 0; i < count; i++)
-        ListView_SetItemState(hLv, i, LVIS_SELECTED, LVIS_SELECTED);
+    /* Index -1 selects every item in one call (owner-data friendly) */
+    ListView_SetItemState(hLv, -1, LVIS_SELECTED, LVIS_SELECTED);
 }
 
 /**
@@ -257,6 +520,46 @@ static void LvShowContextMenu(HWND hwnd, HWND hLv)
     }
 }
 
+/**
+ * @brief Performance tab context menu: the histograms as JSON, or a reset
+ *        to measure from now on.
+ */
+static void PerfShowContextMenu(HWND hwnd, AppState *state)
+{
+    HMENU hMenu = CreatePopupMenu();
+    if (!hMenu) return;
+    AppendMenu(hMenu, MF_STRING, IDM_CTX_COPY_JSON, "Copy &JSON");
+    AppendMenu(hMenu, MF_STRING, IDM_CTX_PERF_RESET, "&Reset");
+
+    POINT pt;
+    GetCursorPos(&pt);
+    int cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_RIGHTBUTTON,
+                             pt.x, pt.y, 0, hwnd, NULL);
+    DestroyMenu(hMenu);
+
+    if (cmd == IDM_CTX_PERF_RESET) {
+        perf_stream_reset(&state->perf);
+        ui_lag_reset(&state->uiLag);
+        InvalidateRect(state->hLvPerf, NULL, FALSE);
+    } else if (cmd == IDM_CTX_COPY_JSON) {
+        char *json = ui_lag_json(&state->uiLag, &state->perf);
+        if (!json) return;
+        size_t len = strlen(json);
+        if (OpenClipboard(hwnd)) {
+            EmptyClipboard();
+            HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, len + 1);
+            if (hMem) {
+                char *dst = (char *)GlobalLock(hMem);
+                memcpy(dst, json, len + 1);
+                GlobalUnlock(hMem);
+                if (!SetClipboardData(CF_TEXT, hMem)) GlobalFree(hMem);
+            }
+            CloseClipboard();
+        }
+        free(json);
+    }
+}
+
 /**
  * @brief Get the Y range (in client coords) of the splitter hit zone.
  *
@@ -284,6 +587,8 @@ static void OnTabSelChange(AppState *state)
     ShowWindow(state->hEditLog,      (sel == 0) ? SW_SHOW : SW_HIDE);
     ShowWindow(state->hLvMsgStats,   (sel == 1) ? SW_SHOW : SW_HIDE);
     ShowWindow(state->hLvSatellites, (sel == 2) ? SW_SHOW : SW_HIDE);
+    ShowWindow(state->hLvPerf,       (sel == 3) ? SW_SHOW : SW_HIDE);
+    ShowWindow(state->hLvQuality,    (sel == 4) ? SW_SHOW : SW_HIDE);
 }
 
 /**
@@ -291,9 +596,7 @@ static void OnTabSelChange(AppState *state)
  */
 static void AppendLog(HWND hLog, const char *text)
 {
-    int len = GetWindowTextLength(hLog);
-    SendMessage(hLog, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-    SendMessage(hLog, EM_REPLACESEL, FALSE, (LPARAM)text);
+    LogAppend(hLog, text);
 }
 
 /* ── Config ↔ GUI helpers ─────────────────────────────────── */
@@ -469,11 +772,21 @@ static void OnSaveConfig(HWND hwnd, AppState *state)
     cJSON_AddStringToObject(json, "PASSWORD",       state->config.PASSWORD);
     cJSON_AddNumberToObject(json, "LATITUDE",       state->config.LATITUDE);
     cJSON_AddNumberToObject(json, "LONGITUDE",      state->config.LONGITUDE);
+    cJSON_AddNumberToObject(json, "SOURCETABLE_TTL", state->config.SOURCETABLE_TTL);
+    cJSON_AddNumberToObject(json, "RECONNECT_DELAY_MAX", state->config.RECONNECT_DELAY_MAX);
+    if (state->config.TLS)
+        cJSON_AddBoolToObject(json, "TLS", state->config.TLS > 0);
+    if (state->config.TLS_INSECURE)
+        cJSON_AddBoolToObject(json, "TLS_INSECURE", 1);
+    if (state->config.GGA_INTERVAL)
+        cJSON_AddNumberToObject(json, "GGA_INTERVAL", state->config.GGA_INTERVAL);
     cJSON_AddStringToObject(json, "EPH_CASTER",     state->config.EPH_CASTER);
     cJSON_AddNumberToObject(json, "EPH_PORT",       state->config.EPH_PORT);
     cJSON_AddStringToObject(json, "EPH_MOUNTPOINT", state->config.EPH_MOUNTPOINT);
     cJSON_AddStringToObject(json, "EPH_USERNAME",   state->config.EPH_USERNAME);
     cJSON_AddStringToObject(json, "EPH_PASSWORD",   state->config.EPH_PASSWORD);
+    if (state->config.EPH_TLS)
+        cJSON_AddBoolToObject(json, "EPH_TLS", state->config.EPH_TLS > 0);
 
     char *jsonStr = cJSON_Print(json);
     cJSON_Delete(json);
@@ -542,6 +855,7 @@ static void OnGenerateConfig(HWND hwnd, AppState *state)
         "    \"PASSWORD\": \"your_password\",\n"
         "    \"LATITUDE\": 0.0,\n"
         "    \"LONGITUDE\": 0.0,\n"
+        "    \"SOURCETABLE_TTL\": 300,\n"
         "    \"EPH_CASTER\": \"products.igs-ip.net\",\n"
         "    \"EPH_PORT\": 2101,\n"
         "    \"EPH_MOUNTPOINT\": \"BCEP00BKG0\",\n"
@@ -581,6 +895,7 @@ static void OnGetMountpoints(HWND hwnd, AppState *state)
 
     state->bWorkerRunning = TRUE;
     state->bStopRequested = FALSE;
+    state->mountStreaming = FALSE;
     EnableWindow(state->hBtnCloseStream, TRUE);
 
     AppendLog(state->hEditLog, "[INFO] Requesting mountpoint list...\r\n");
@@ -625,13 +940,16 @@ static void OnOpenStream(HWND hwnd, AppState *state)
     EnableWindow(state->hBtnCloseStream, TRUE);
 
     /* Clear previous stats, ListViews, and last-decoded-text cache */
-    memset(state->msgStats, 0, sizeof(state->msgStats));
-    memset(&state->satStats, 0, sizeof(state->satStats));
+    gui_fq_reset(&state->uiQueue);
+    state->uiKickPending = 0;
+    UiStatsReset(state);
     /* Reset the heatmap accumulator and per-SV track buffers -- both
      * are "since connect" data so any prior session must be cleared.
      * Also clear the per-GNSS legend filter so a new mountpoint starts
      * with all constellations visible. */
     memset(state->skyState.sectors, 0, sizeof(state->skyState.sectors));
+    sky_track_arena_reset(&state->skyState.tracks);
+    cnr_history_free(&state->cnrHistory);
     memset(state->skyState.sats,    0, sizeof(state->skyState.sats));
     state->skyState.filter_gnss_id = 0;
 
@@ -651,14 +969,9 @@ static void OnOpenStream(HWND hwnd, AppState *state)
     InterlockedExchange(&state->ggaSendCount,    0);
     InterlockedExchange(&state->ggaLastSendUnix, 0);
     InterlockedExchange(&state->ggaShiftRequestedAtCount, -1);
-    ListView_DeleteAllItems(state->hLvMsgStats);
-    ListView_DeleteAllItems(state->hLvSatellites);
-    for (int i = 0; i < GUI_MAX_MSG_TYPES; i++) {
-        if (state->lastDecodedText[i]) {
-            HeapFree(GetProcessHeap(), 0, state->lastDecodedText[i]);
-            state->lastDecodedText[i] = NULL;
-        }
-    }
+    StatListsReset(state);
+    UiFreeLastFrames(state);
+    UiTypesReset(state);
 
     /* Reset stream info */
     InterlockedExchange(&state->streamBytes, 0);
@@ -681,33 +994,26 @@ static void OnOpenStream(HWND hwnd, AppState *state)
         const char *mpName = state->config.MOUNTPOINT;
         if (mpName[0] == '/') mpName++;   /* skip leading '/' */
 
+        GuiMountTable *t = &state->mountTable;
         int found = -1;
 
         /* Fast path: check focused/selected row first */
         int sel = ListView_GetNextItem(state->hLvMountpoints, -1, LVNI_SELECTED);
         if (sel >= 0) {
-            char mp[256] = "";
-            ListView_GetItemText(state->hLvMountpoints, sel, 0, mp, sizeof(mp));
-            const char *c = (mp[0] == '/') ? mp + 1 : mp;
+            const char *c = MountTableCell(t, sel, 0);
+            if (c[0] == '/') c++;
             if (_stricmp(c, mpName) == 0) found = sel;
         }
 
         /* Fallback: search all rows */
-        if (found < 0) {
-            int count = ListView_GetItemCount(state->hLvMountpoints);
-            for (int i = 0; i < count; i++) {
-                char mp[256] = "";
-                ListView_GetItemText(state->hLvMountpoints, i, 0, mp, sizeof(mp));
-                const char *c = (mp[0] == '/') ? mp + 1 : mp;
-                if (_stricmp(c, mpName) == 0) { found = i; break; }
-            }
-        }
+        if (found < 0)
+            found = MountTableFind(t, mpName);
 
         if (found >= 0) {
-            ListView_GetItemText(state->hLvMountpoints, found, 2,
-                                 state->sourceFormat, sizeof(state->sourceFormat));
-            ListView_GetItemText(state->hLvMountpoints, found, 3,
-                                 state->sourceDetails, sizeof(state->sourceDetails));
+            snprintf(state->sourceFormat, sizeof(state->sourceFormat), "%s",
+                     MountTableCell(t, found, 2));
+            snprintf(state->sourceDetails, sizeof(state->sourceDetails), "%s",
+                     MountTableCell(t, found, 3));
         }
     }
 
@@ -729,11 +1035,15 @@ static void OnOpenStream(HWND hwnd, AppState *state)
     /* Start a timer for status bar updates (data rate, activity) */
     SetTimer(hwnd, IDT_STATUS_UPDATE, 1000, NULL);  /* 1 s interval */
 
+    /* Start a timer that drains worker -> UI updates in batches */
+    SetTimer(hwnd, IDT_UI_BATCH, UI_BATCH_INTERVAL_MS, NULL);
+
     /* Launch worker thread */
     state->hWorkerThread = CreateThread(NULL, 0, WorkerOpenStream, state, 0, NULL);
     if (!state->hWorkerThread) {
         KillTimer(hwnd, IDT_LOG_PUMP);
         KillTimer(hwnd, IDT_STATUS_UPDATE);
+        KillTimer(hwnd, IDT_UI_BATCH);
         LogRedirectStop(state);
         state->bWorkerRunning = FALSE;
         EnableWindow(state->hBtnCloseStream, FALSE);
@@ -743,7 +1053,15 @@ static void OnOpenStream(HWND hwnd, AppState *state)
     }
 
     /* ── Optional ephemeris worker — runs in parallel ──────── */
+    /* Not for the obs stream itself: the obs worker decodes its
+     * ephemerides (worker_obs_eph()). */
     if (state->config.EPH_MOUNTPOINT[0] != '\0' &&
+        state->config.EPH_CASTER[0]     != '\0' &&
+        config_eph_is_obs_stream(&state->config)) {
+        AppendLog(state->hEditLog,
+                  "[INFO] The ephemeris stream is the obs stream; decoding its "
+                  "ephemerides from the obs connection\r\n");
+    } else if (state->config.EPH_MOUNTPOINT[0] != '\0' &&
         state->config.EPH_CASTER[0]     != '\0' &&
         !state->bWorkerRunningEph) {
         char ephMsg[2 * sizeof(state->config.EPH_CASTER) + 64];
@@ -775,7 +1093,7 @@ static void OnCloseStream(HWND hwnd, AppState *state)
     if (!state->bWorkerRunning) return;
 
     /* Close all open detail windows */
-    for (int i = 0; i < GUI_MAX_MSG_TYPES; i++) {
+    for (int i = 0; i < state->msgTypes.n; i++) {
         if (state->hDetailWnds[i]) {
             DestroyWindow(state->hDetailWnds[i]);
             state->hDetailWnds[i] = NULL;
@@ -803,9 +1121,12 @@ static void OnCloseStream(HWND hwnd, AppState *state)
     }
     state->bWorkerRunningEph = FALSE;
 
-    /* Clean up — stop timers, restore stdout/stderr */
+    /* Clean up — stop timers, apply the last queued updates,
+     * restore stdout/stderr */
     KillTimer(hwnd, IDT_LOG_PUMP);
     KillTimer(hwnd, IDT_STATUS_UPDATE);
+    KillTimer(hwnd, IDT_UI_BATCH);
+    FinishUiQueue(state);
     LogRedirectStop(state);
 
     state->bWorkerRunning = FALSE;
@@ -819,35 +1140,54 @@ static void OnCloseStream(HWND hwnd, AppState *state)
 
 /* ── Stream Done (worker finished naturally) ──────────────── */
 
-/* Close any active RTCM capture (called from OnCloseStream / OnStreamDone). */
-static void close_rtcm_capture_if_active(AppState *state)
+/* Detach the running RTCM capture under the critical section, then close
+ * it outside: closing drains the recorder's queue and, for a native
+ * capture, writes the last index block and footer.  Logs the result
+ * with @p how ("stopped", ...).  Returns FALSE if none was running. */
+static BOOL stop_rtcm_capture(AppState *state, const char *how)
 {
-    FILE *f_to_close = NULL;
-    LONG  total = 0;
-    char  path[MAX_PATH] = "";
+    RtcmRecorder *rec;
+    char path[MAX_PATH];
     EnterCriticalSection(&state->csRtcmDump);
-    if (state->hRtcmDump) {
-        f_to_close = state->hRtcmDump;
-        total = state->rtcmDumpBytes;
-        strncpy(path, state->rtcmDumpPath, sizeof(path) - 1);
-        path[sizeof(path) - 1] = '\0';
-        state->hRtcmDump = NULL;
-    }
+    rec = state->hRtcmDump;
+    state->hRtcmDump = NULL;
+    strncpy(path, state->rtcmDumpPath, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
     LeaveCriticalSection(&state->csRtcmDump);
-    if (f_to_close) {
-        fclose(f_to_close);
-        char msg[MAX_PATH + 96];
+    if (!rec) return FALSE;
+
+    RtcmRecorderStats st;
+    bool ok = rtcm_recorder_close(rec, &st);
+    char msg[MAX_PATH + 160];
+    snprintf(msg, sizeof(msg),
+        "[%s] RTCM capture %s: %lu frames, %lu bytes -> %s%s\r\n",
+        ok ? "INFO" : "ERROR", how, (unsigned long)st.frames,
+        (unsigned long)st.bytes, path, ok ? "" : " (write failed)");
+    AppendLog(state->hEditLog, msg);
+    if (st.dropped) {
         snprintf(msg, sizeof(msg),
-            "[INFO] RTCM capture auto-stopped on stream close: %ld bytes -> %s\r\n",
-            (long)total, path);
+            "[WARN] RTCM capture: %lu frames dropped (writer fell behind)\r\n",
+            (unsigned long)st.dropped);
         AppendLog(state->hEditLog, msg);
     }
+    return TRUE;
+}
+
+/* Close any active RTCM capture (called from OnCloseStream / OnStreamDone). */
+static void close_rtcm_capture_if_active(AppState *state)
+{
+    stop_rtcm_capture(state, "auto-stopped on stream close");
 }
 
 static void OnStreamDone(HWND hwnd, AppState *state)
 {
+    /* Apply the worker's last queued updates while the detail
+     * windows can still receive them */
+    KillTimer(hwnd, IDT_UI_BATCH);
+    FinishUiQueue(state);
+
     /* Close all open detail windows */
-    for (int i = 0; i < GUI_MAX_MSG_TYPES; i++) {
+    for (int i = 0; i < state->msgTypes.n; i++) {
         if (state->hDetailWnds[i]) {
             DestroyWindow(state->hDetailWnds[i]);
             state->hDetailWnds[i] = NULL;
@@ -1048,6 +1388,41 @@ static void OnMapPick(HWND hwnd, AppState *state)
         "then press \"<<\" to paste coordinates.\r\n");
 }
 
+/**
+ * @brief Measure the mountpoint list from a new user position and log
+ *        the closest mountpoints.
+ *
+ * The nearest rows come from the sourcetable's spatial index; only the
+ * visible Distance cells are recomputed when the list repaints.
+ */
+static void UiUpdateNearest(AppState *state, double lat, double lon)
+{
+    GuiMountTable *t = &state->mountTable;
+    if (t->count == 0) return;
+
+    MountTableSetOrigin(t, lat, lon);
+    InvalidateRect(state->hLvMountpoints, NULL, FALSE);
+
+    GeoIndexHit hits[3];
+    int n = MountTableNearest(t, 3, 0.0, hits);
+    if (n == 0) return;
+
+    char logmsg[512];
+    int pos = snprintf(logmsg, sizeof(logmsg), "[INFO] Nearest mountpoints:");
+    for (int i = 0; i < n && pos > 0 && pos < (int)sizeof(logmsg); i++) {
+        const GuiMountRow *r = &t->rows[hits[i].id];
+        pos += snprintf(logmsg + pos, sizeof(logmsg) - pos, "%s %s (%.1f km)",
+                        i ? "," : "", t->pool + r->cell[0], hits[i].km);
+    }
+    if (pos > 0 && pos < (int)sizeof(logmsg))
+        snprintf(logmsg + pos, sizeof(logmsg) - pos, "\r\n");
+    AppendLog(state->hEditLog, logmsg);
+
+    int item = MountTableItemOfRow(t, hits[0].id);
+    if (item >= 0)
+        ListView_EnsureVisible(state->hLvMountpoints, item, FALSE);
+}
+
 /**
  * @brief Read "lat,lon" from the clipboard and populate the Lat/Lon edit controls.
  */
@@ -1115,6 +1490,8 @@ static void OnMapPaste(HWND hwnd, AppState *state)
     snprintf(logmsg, sizeof(logmsg),
              "[INFO] Pasted coordinates: %.6f, %.6f\r\n", lat, lon);
     AppendLog(state->hEditLog, logmsg);
+
+    UiUpdateNearest(state, lat, lon);
 }
 
 /* ── RTCM message type description lookup ─────────────────── */
@@ -1198,115 +1575,478 @@ const char* RtcmMsgDescription(int msg_type)
     }
 }
 
-/* ── Stat Update (real-time, per-message) ─────────────────── */
+/* ── Stat Update (from the statistics snapshot) ───────────── */
 
-static void OnStatUpdate(AppState *state, int msg_type, int count)
+static void OnStatUpdate(AppState *state, int k)
 {
-    if (msg_type <= 0 || msg_type >= GUI_MAX_MSG_TYPES) return;
+    /* Add a row the first time a type is seen; the ListView gets it,
+     * and the changed cells of the rows on screen, from
+     * gui_list_model_update() once the whole snapshot is applied */
+    if (state->statRowOf[k] == 0) {
+        int row = state->statRows++;
+        state->statRowIdx[row] = k;
+        state->statRowOf[k] = row + 1;
+    }
+}
 
-    GuiMsgStat *s = &state->msgStats[msg_type];
-    char buf[64];
+/* ── Satellite Update (from the statistics snapshot) ──────── */
 
-    /* Search for existing row with this message type */
-    int nItems = ListView_GetItemCount(state->hLvMsgStats);
-    int row = -1;
+static void OnSatUpdate(AppState *state)
+{
+    /* One row per entry of satStats.gnss[], which only ever grows
+     * during a stream */
+    gui_list_model_update(&state->satModel, state->satStats.gnss_count);
+}
 
-    for (int i = 0; i < nItems; i++) {
-        char existing[32];
-        ListView_GetItemText(state->hLvMsgStats, i, 0, existing, sizeof(existing));
-        if (atoi(existing) == msg_type) {
-            row = i;
-            break;
+/* Signal Quality rows only ever grow during a stream, as satStats.gnss[] */
+static void OnQualityUpdate(AppState *state)
+{
+    int n = state->qualityStats.n_rows;
+    if (ListView_GetItemCount(state->hLvQuality) != n)
+        ListView_SetItemCountEx(state->hLvQuality, n,
+                                LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+    if (n > 0 && IsWindowVisible(state->hLvQuality))
+        ListView_RedrawItems(state->hLvQuality, 0, n - 1);
+}
+
+/* ── Worker -> UI statistics ──────────────────────────────── */
+
+/* Take the newest statistics the producer published, if any: spread
+ * them into the UI's copies and repaint the cells whose text changed.
+ * Never waits -- a read that raced the producer is retried next tick. */
+static void UiApplyStats(AppState *state)
+{
+    GuiStats *st = &state->statsRead;
+    if (!stats_snapshot_read(&state->statsSnap, st, &state->statsSeen))
+        return;
+    ui_lag_queued(&state->uiLag, UI_LAG_STATS, st->t_publish_ns);
+    uint64_t t_lag = ui_lag_now();
+
+    for (int k = 0; k < st->n_types && k < GUI_STAT_TYPES; k++) {
+        int mt = st->type[k];
+        if (mt <= 0 || mt >= GUI_MAX_MSG_TYPES) continue;
+        int i = gui_type_map_add(&state->msgTypes, mt);
+        if (i < 0) continue;
+        if (state->msgStats[i].count == st->stat[k].count &&
+            memcmp(&state->msgStats[i].bwRates, &st->stat[k].bwRates, sizeof(BwRates)) == 0)
+            continue;
+        state->msgStats[i] = st->stat[k];
+        OnStatUpdate(state, i);
+    }
+    gui_list_model_update(&state->statModel, state->statRows);
+    state->satStats = st->sats;
+    state->corrAge  = st->corrAge;
+    state->burstPeak = st->burst.peak;
+    state->qualityStats = st->quality;
+    OnSatUpdate(state);
+    OnQualityUpdate(state);
+    ui_lag_end(&state->uiLag, UI_LAG_STATS, t_lag);
+}
+
+/* UI copies back to empty; snapshots published before now are ignored.
+ * Only called while no producer runs. */
+static void UiStatsReset(AppState *state)
+{
+    for (int k = 0; k < state->msgTypes.n; k++)
+        memset(&state->msgStats[k], 0, sizeof(state->msgStats[k]));
+    memset(&state->satStats, 0, sizeof(state->satStats));
+    memset(&state->corrAge, 0, sizeof(state->corrAge));
+    memset(&state->qualityStats, 0, sizeof(state->qualityStats));
+    state->burstPeak = 0;
+    state->statsSeen = stats_snapshot_version(&state->statsSnap);
+
+    rollup_store_clear(state->rollup);
+    memset(state->rollFrames, 0, sizeof(state->rollFrames));
+    memset(&state->rollAge, 0, sizeof(state->rollAge));
+    memset(state->rollCnrId, 0, sizeof(state->rollCnrId));
+    state->rollBytes = 0;
+}
+
+/* ── Rollup history (History window) ──────────────────────── */
+
+/* Once a second from the status-bar timer: the counters' growth since
+ * the last tick, the satellites of the newest epoch per GNSS and the
+ * age quantiles of the MSM frames in between -- the CorrAge histograms
+ * are totals, so their growth is the last second. */
+static void UiRollupTick(AppState *state)
+{
+    RollupStore *r = state->rollup;
+    if (!r) return;
+    double t = (double)stream_clock_utc_ns() / 1e9;
+    char name[ROLLUP_NAME_MAX];
+
+    LONG bytes = InterlockedCompareExchange(&state->streamBytes, 0, 0);
+    rollup_add(r, rollup_series(r, "bytes", ROLLUP_COUNTER), t,
+               (double)(bytes - state->rollBytes));
+    state->rollBytes = bytes;
+
+    int frames_id = rollup_series(r, "frames", ROLLUP_COUNTER);
+    int frames = 0;
+    for (int k = 0; k < state->msgTypes.n && k < GUI_STAT_TYPES; k++) {
+        int d = state->msgStats[k].count - state->rollFrames[k];
+        state->rollFrames[k] = state->msgStats[k].count;
+        frames += d;
+        snprintf(name, sizeof(name), "frames.%d", state->msgTypes.type[k]);
+        rollup_add(r, rollup_series(r, name, ROLLUP_COUNTER), t, d);
+    }
+    rollup_add(r, frames_id, t, frames);
+
+    for (int i = 0; i < state->satStats.gnss_count && i < MAX_GNSS; i++) {
+        const GnssSatStats *gs = &state->satStats.gnss[i];
+        snprintf(name, sizeof(name), "sats.%s", gnss_name_from_id(gs->gnss_id));
+        rollup_add(r, rollup_series(r, name, ROLLUP_GAUGE), t,
+                   sat_mask_count(sat_vis_now(&gs->vis)));
+    }
+
+    static PerfHist total, delta;
+    memset(&total, 0, sizeof(total));
+    for (int k = 0; k < CORR_AGE_SLOTS; k++)
+        perf_hist_merge(&total, &state->corrAge.type[k].hist);
+    if (total.count > state->rollAge.count) {
+        memset(&delta, 0, sizeof(delta));
+        for (int b = 0; b < PERF_HIST_BUCKETS; b++)
+            delta.bucket[b] = total.bucket[b] - state->rollAge.bucket[b];
+        delta.count  = total.count - state->rollAge.count;
+        delta.max_ns = UINT64_MAX;              /* no clamping: buckets only */
+        rollup_add(r, rollup_series(r, "age_ms.p50", ROLLUP_GAUGE), t,
+                   perf_hist_quantile(&delta, 0.50) / 1e6);
+        rollup_add(r, rollup_series(r, "age_ms.p99", ROLLUP_GAUGE), t,
+                   perf_hist_quantile(&delta, 0.99) / 1e6);
+    }
+    state->rollAge = total;
+}
+
+/* Every CNR of a decoded MSM4..MSM7 frame into the gauge of its GNSS. */
+static void UiRollupCnr(AppState *state, const RtcmMsmObs *obs)
+{
+    int g = obs->gnss_id;
+    if (!state->rollup || obs->msm_subtype < 4 || g < 1 || g >= 8) return;
+    if (!state->rollCnrId[g]) {
+        char name[ROLLUP_NAME_MAX];
+        snprintf(name, sizeof(name), "cnr.%s", gnss_name_from_id(g));
+        state->rollCnrId[g] = rollup_series(state->rollup, name, ROLLUP_GAUGE) + 1;
+    }
+    double t = (double)stream_clock_utc_ns() / 1e9;
+    for (int c = 0; c < obs->num_cells; c++)
+        if (obs->cells[c].cnr_dbhz > 0.0f)
+            rollup_add(state->rollup, state->rollCnrId[g] - 1, t, obs->cells[c].cnr_dbhz);
+}
+
+/* ── Worker -> UI batch drain ─────────────────────────────── */
+
+/* Empty UI decode scratch buffer, allocated on first use. */
+static RtcmStrBuf *UiScratch(RtcmStrBuf *sb, int initial_cap)
+{
+    if (!sb->buf) rtcm_strbuf_init(sb, initial_cap);
+    else          rtcm_strbuf_clear(sb);
+    return sb->buf ? sb : NULL;
+}
+
+/* Format a stored frame as text for the detail window's EDIT control
+ * (\r\n line endings).  Returns state->uiDetailText, valid until the
+ * next call, or NULL if the decoder printed nothing. */
+static const char *UiFormatFrame(AppState *state, const UiLastFrame *lf)
+{
+    RtcmStrBuf *sb = UiScratch(&state->uiDecodeText, 4096);
+    if (!sb) return NULL;
+    rtcm_set_output_buffer(sb);
+    if (lf->has_msm)
+        rtcm_print_msm(&lf->msm);   /* already decoded by the worker */
+    else
+        analyze_rtcm_message(lf->frame, lf->frame_len, false, &state->config);
+    rtcm_set_output_buffer(NULL);
+    if (sb->len == 0) return NULL;
+
+    /* Convert \n → \r\n for the Win32 EDIT control */
+    int nlCount = 0;
+    for (int i = 0; i < sb->len; i++)
+        if (sb->buf[i] == '\n') nlCount++;
+
+    RtcmStrBuf *out = UiScratch(&state->uiDetailText, 8192);
+    if (!out) return NULL;
+    int need = sb->len + nlCount + 1;
+    if (out->cap < need) {
+        char *nb = (char *)realloc(out->buf, (size_t)need);
+        if (!nb) return NULL;
+        out->buf = nb;
+        out->cap = need;
+    }
+    int j = 0;
+    for (int i = 0; i < sb->len; i++) {
+        if (sb->buf[i] == '\n')
+            out->buf[j++] = '\r';
+        out->buf[j++] = sb->buf[i];
+    }
+    out->buf[j] = '\0';
+    out->len = j;
+    return out->buf;
+}
+
+/* Keep the newest frame of its type for the detail window.  Station
+ * descriptions are still decoded at once: decoding 1005/1006 is what
+ * sets the station ARP the sky plot is computed from. */
+static void UiStoreFrame(AppState *state, const UiFrameRec *hdr,
+                         const unsigned char *frame)
+{
+    int msg_type = hdr->msg_type;
+    if (hdr->frame_len <= 0 || hdr->frame_len > RTCM_FRAME_MAX) return;
+    int k = gui_type_map_add(&state->msgTypes, msg_type);
+    if (k < 0) return;
+
+    UiLastFrame *lf = state->lastFrame[k];
+    if (!lf) {
+        lf = (UiLastFrame *)HeapAlloc(GetProcessHeap(), 0, sizeof(*lf));
+        if (!lf) return;
+        state->lastFrame[k] = lf;
+    }
+    lf->frame_len = hdr->frame_len;
+    lf->has_msm   = hdr->has_msm;
+    lf->dirty     = TRUE;
+    memcpy(lf->frame, frame, (size_t)hdr->frame_len);
+    /* The record is only 4-byte aligned: copy the struct out. */
+    if (hdr->has_msm)
+        memcpy(&lf->msm, frame + hdr->frame_len, sizeof(lf->msm));
+
+    if (msg_type == 1005 || msg_type == 1006) {
+        RtcmStrBuf *sb = UiScratch(&state->uiDecodeText, 4096);
+        if (sb) {
+            rtcm_set_output_buffer(sb);
+            analyze_rtcm_message(lf->frame, lf->frame_len, false, &state->config);
+            rtcm_set_output_buffer(NULL);
         }
     }
+}
 
-    /* Insert new row if not found */
-    if (row < 0) {
-        row = nItems;
-        snprintf(buf, sizeof(buf), "%d", msg_type);
-        LVITEM lvi;
-        ZeroMemory(&lvi, sizeof(lvi));
-        lvi.mask    = LVIF_TEXT;
-        lvi.iItem   = row;
-        lvi.pszText = buf;
-        ListView_InsertItem(state->hLvMsgStats, &lvi);
+/* Send the stored frame of type index k, formatted, to its open detail
+ * window. */
+static void UiRefreshDetail(AppState *state, int k)
+{
+    UiLastFrame *lf = state->lastFrame[k];
+    HWND hDet = state->hDetailWnds[k];
+    if (!lf || !hDet) return;
+    lf->dirty = FALSE;
+
+    /* The detail window lives on this thread: a SendMessage is a plain
+     * call, and the EDIT control copies the text before it returns. */
+    const char *text = UiFormatFrame(state, lf);
+    if (text)
+        SendMessage(hDet, WM_USER + 1, 0, (LPARAM)text);
+}
 
-        /* Column 5: Description (set once on insert) */
-        const char *desc = RtcmMsgDescription(msg_type);
-        ListView_SetItemText(state->hLvMsgStats, row, 5, (LPSTR)desc);
+/* Redraw every open detail window whose type has a newer frame, at most
+ * once per UI_DETAIL_REFRESH_MS unless force is set. */
+static void UiRefreshDetails(AppState *state, BOOL force)
+{
+    double now = gui_get_time_seconds();
+    if (!force && now - state->detailRefreshTime < UI_DETAIL_REFRESH_MS / 1000.0)
+        return;
+    state->detailRefreshTime = now;
+
+    for (int k = 0; k < state->msgTypes.n; k++) {
+        if (state->hDetailWnds[k] && state->lastFrame[k] &&
+            state->lastFrame[k]->dirty) {
+            uint64_t t_lag = ui_lag_now();
+            UiRefreshDetail(state, k);
+            ui_lag_paint(&state->uiLag, UI_LAG_WND_DETAIL, t_lag);
+        }
     }
+}
 
-    /* Column 1: Count */
-    snprintf(buf, sizeof(buf), "%d", count);
-    ListView_SetItemText(state->hLvMsgStats, row, 1, buf);
+/* Drop the stored frames (new stream, or exit). */
+static void UiFreeLastFrames(AppState *state)
+{
+    for (int i = 0; i < state->msgTypes.n; i++) {
+        if (state->lastFrame[i]) {
+            HeapFree(GetProcessHeap(), 0, state->lastFrame[i]);
+            state->lastFrame[i] = NULL;
+        }
+    }
+}
 
-    /* Column 2: Min dt */
-    snprintf(buf, sizeof(buf), "%.3f", s->min_dt);
-    ListView_SetItemText(state->hLvMsgStats, row, 2, buf);
+/* Start the type map afresh for a new stream or replay, after the stats,
+ * rows and frames have been cleared.  A detail window can still be open
+ * (one opened after the last stream ended); its type keeps an entry so
+ * the window picks up the new stream's frames. */
+static void UiTypesReset(AppState *state)
+{
+    GuiTypeMap *m = &state->msgTypes;
+    int n_old = m->n;
+    int types[GUI_STAT_TYPES];
+    HWND wnds[GUI_STAT_TYPES];
+    int n_keep = 0;
+    for (int k = 0; k < n_old; k++) {
+        if (!state->hDetailWnds[k]) continue;
+        types[n_keep] = m->type[k];
+        wnds[n_keep]  = state->hDetailWnds[k];
+        n_keep++;
+        state->hDetailWnds[k] = NULL;
+    }
+
+    gui_type_map_clear(m);
+    for (int i = 0; i < n_keep; i++) {
+        int k = gui_type_map_add(m, types[i]);
+        state->hDetailWnds[k] = wnds[i];
+    }
+}
 
-    /* Column 3: Max dt */
-    snprintf(buf, sizeof(buf), "%.3f", s->max_dt);
-    ListView_SetItemText(state->hLvMsgStats, row, 3, buf);
+/* Apply one UI_REC_SKY record to the sky-plot model. */
+static void UiApplySkyUpdate(AppState *state, const SkySatUpdate *upd,
+                             int count, double now)
+{
+    for (int i = 0; i < count; i++) {
+        int g = upd[i].gnss_id;
+        int p = upd[i].prn;
+        if (g < 0 || g >= SV_EPH_MAX_GNSS)         continue;
+        if (p < 1 || p > SV_EPH_MAX_SATS_PER_GNSS) continue;
+
+        /* Markers: only update SkySat when the SV was actually
+         * observed in this MSM frame.  Expected-only entries keep
+         * their last observed timestamp -- so an SV that drops out
+         * of the receiver's tracking will dim and then disappear
+         * from the marker view per the existing stale logic. */
+        if (upd[i].observed_flag) {
+            SkySat *s = &state->skyState.sats[g][p - 1];
+            s->az_deg       = upd[i].az_deg;
+            s->el_deg       = upd[i].el_deg;
+            s->cnr_dbhz     = upd[i].cnr_dbhz;
+            s->last_seen_ts = now;
+            s->valid        = true;
+
+            /* Append a track point if SKY_TRACK_INTERVAL_S has
+             * elapsed since the last sample.  With the polyline
+             * renderer in gui_sky_window.c, a tighter interval
+             * makes any ephemeris-update step show up as a long
+             * straight line between two close-in-time samples --
+             * which is exactly the kind of glitch we want to see. */
+            SkyTrack *tr = &s->track;
+            if (sky_track_count(tr) == 0 ||
+                (now - sky_track_last_ts(tr)) >= SKY_TRACK_INTERVAL_S)
+                sky_track_append(&state->skyState.tracks, tr, now,
+                                 upd[i].az_deg, upd[i].el_deg);
+        }
 
-    /* Column 4: Avg dt */
-    double avg = (s->count > 1) ? s->sum_dt / (s->count - 1) : 0.0;
-    snprintf(buf, sizeof(buf), "%.3f", avg);
-    ListView_SetItemText(state->hLvMsgStats, row, 4, buf);
+        /* Heatmap: index sector from (az, el) and bump counters.
+         * Every entry contributes to expected; observed_flag=1
+         * also bumps observed. */
+        SkySector *sec = &state->skyState.sectors[0][0] +
+                         sky_grid_sector(upd[i].az_deg, upd[i].el_deg);
+        sec->expected++;
+        if (upd[i].observed_flag)
+            sec->observed++;
+    }
 }
 
-/* ── Satellite Update (real-time, per-message) ────────────── */
-
-static void OnSatUpdate(AppState *state)
+/* Per-batch bound on distinct message types; a batch that sees more
+ * (never in practice) flushes the table early. */
+#define UI_BATCH_MAX_TYPES  64
+
+/* Drain everything the worker has queued since the last call.  Sky
+ * records are applied in order (the heatmap counts every one); for
+ * frame records only the newest frame of each message type is kept for
+ * the detail window, so the cost per batch is bounded by the number of
+ * distinct types, not by the frame rate.  The stats rows come from the
+ * newest statistics snapshot.
+ * Called from IDT_UI_BATCH, WM_APP_UI_BATCH and at stream end. */
+static void DrainUiQueue(AppState *state)
 {
-    SatStatsSummary *sat = &state->satStats;
-    char buf[2048];
-
-    for (int g = 0; g < sat->gnss_count; g++) {
-        GnssSatStats *gs = &sat->gnss[g];
-        const char *name = gnss_name_from_id(gs->gnss_id);
-
-        /* Search for existing row with this GNSS name */
-        int nItems = ListView_GetItemCount(state->hLvSatellites);
-        int row = -1;
-
-        for (int i = 0; i < nItems; i++) {
-            char existing[32];
-            ListView_GetItemText(state->hLvSatellites, i, 0, existing, sizeof(existing));
-            if (strcmp(existing, name) == 0) {
-                row = i;
-                break;
-            }
+    struct {
+        const UiFrameRec    *hdr;
+        const unsigned char *frame;
+    } last[UI_BATCH_MAX_TYPES];
+    int  n_last = 0;
+    bool any_sky = false;
+    double now = gui_get_time_seconds();
+    /* One stamp per batch: a frame counts as delivered when its batch is drained */
+    unsigned int now_us = perf_probes_on ? (unsigned int)(perf_now_ns() / 1000) : 0;
+
+    /* Clear first: a record pushed after this point posts a new kick. */
+    InterlockedExchange(&state->uiKickPending, 0);
+    uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_RECORDS);
+
+    GuiFqCursor cur;
+    gui_fq_begin(&state->uiQueue, &cur);
+
+    const unsigned char *p;
+    int len, tag;
+    while ((p = gui_fq_next(&state->uiQueue, &cur, &len, &tag)) != NULL) {
+        if (tag == UI_REC_SKY) {
+            /* copy for alignment; at most one GNSS worth of SVs */
+            SkySatUpdate upd[SV_EPH_MAX_SATS_PER_GNSS];
+            int count = len / (int)sizeof(SkySatUpdate);
+            if (count > SV_EPH_MAX_SATS_PER_GNSS)
+                count = SV_EPH_MAX_SATS_PER_GNSS;
+            memcpy(upd, p, (size_t)count * sizeof(SkySatUpdate));
+            UiApplySkyUpdate(state, upd, count, now);
+            any_sky = true;
+            continue;
+        }
+        if (tag != UI_REC_FRAME || len < (int)sizeof(UiFrameRec))
+            continue;
+
+        const UiFrameRec *hdr = (const UiFrameRec *)p;
+        if (hdr->msg_type <= 0 || hdr->msg_type >= GUI_MAX_MSG_TYPES)
+            continue;
+        if (hdr->has_msm && len >= (int)sizeof(UiFrameRec) + hdr->frame_len +
+                                    (int)sizeof(RtcmMsmObs)) {
+            /* Every frame, not just the newest per type: copy for alignment */
+            RtcmMsmObs obs;
+            memcpy(&obs, p + sizeof(UiFrameRec) + hdr->frame_len, sizeof(obs));
+            cnr_history_add_obs(&state->cnrHistory, &obs, now);
+            UiRollupCnr(state, &obs);
+        }
+        if (now_us && hdr->t_push_us) {
+            perf_hist_add(&state->perf.stage[PERF_STAGE_OUTPUT],
+                          (uint64_t)(now_us - hdr->t_push_us) * 1000);
+            if (hdr->t_recv_us)
+                perf_hist_add(&state->perf.stage[PERF_STAGE_TOTAL],
+                              (uint64_t)(now_us - hdr->t_recv_us) * 1000);
         }
 
-        /* Insert new row if not found */
-        if (row < 0) {
-            row = nItems;
-            LVITEM lvi;
-            ZeroMemory(&lvi, sizeof(lvi));
-            lvi.mask    = LVIF_TEXT;
-            lvi.iItem   = row;
-            lvi.pszText = (LPSTR)name;
-            ListView_InsertItem(state->hLvSatellites, &lvi);
+        int k = 0;
+        while (k < n_last && last[k].hdr->msg_type != hdr->msg_type) k++;
+        if (k == UI_BATCH_MAX_TYPES) {
+            for (k = 0; k < n_last; k++)
+                UiStoreFrame(state, last[k].hdr, last[k].frame);
+            n_last = k = 0;
         }
+        if (k == n_last) n_last++;
+        last[k].hdr   = hdr;
+        last[k].frame = p + sizeof(UiFrameRec);
+    }
+
+    for (int k = 0; k < n_last; k++)
+        UiStoreFrame(state, last[k].hdr, last[k].frame);
+    gui_fq_release(&state->uiQueue, &cur);
+    UiRefreshDetails(state, FALSE);
+
+    UiApplyStats(state);
+    /* Empty sky records are status-refresh pings: the repaint picks up
+     * new ARP/ephemeris availability. */
+    if (any_sky && state->hSkyWnd)
+        InvalidateRect(state->hSkyWnd, NULL, FALSE);
+    ui_lag_end(&state->uiLag, UI_LAG_RECORDS, t_lag);
+
+    /* WM_TIMER (IDT_LOG_PUMP) is low priority — Windows only posts it
+     * when the queue is otherwise empty.  At high MSM rates that may
+     * not happen for a while, so worker-thread printf output would sit
+     * in the pipe.  Pump it here too so log lines keep up with data. */
+    LogPumpTimer(state);
+}
 
-        /* Column 1: Sats Seen count */
-        snprintf(buf, sizeof(buf), "%d", gs->count);
-        ListView_SetItemText(state->hLvSatellites, row, 1, buf);
+/* Stream end: apply whatever the worker queued last and report any
+ * updates the live stream had to drop because the UI fell behind. */
+static void FinishUiQueue(AppState *state)
+{
+    DrainUiQueue(state);
+    UiRefreshDetails(state, TRUE);
 
-        /* Column 2: RINEX satellite IDs */
-        buf[0] = '\0';
-        int pos = 0;
-        for (int s = 1; s <= MAX_SATS_PER_GNSS; s++) {
-            if (gs->sat_seen[s - 1]) {
-                char id[8];
-                rinex_id_from_gnss(gs->gnss_id, s, id, sizeof(id));
-                if (pos > 0 && pos < (int)sizeof(buf) - 6)
-                    buf[pos++] = ' ';
-                int wrote = snprintf(buf + pos, sizeof(buf) - pos, "%s", id);
-                if (wrote > 0) pos += wrote;
-            }
-        }
-        ListView_SetItemText(state->hLvSatellites, row, 2, buf);
+    LONG dropped = InterlockedExchange(&state->uiQueue.dropped, 0);
+    if (dropped > 0) {
+        char m[96];
+        snprintf(m, sizeof(m),
+            "[INFO] UI queue: %ld display updates dropped (UI too slow)\r\n",
+            (long)dropped);
+        AppendLog(state->hEditLog, m);
     }
 }
 
@@ -1327,6 +2067,10 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
         /* Create all child controls */
         CreateControls(hwnd, state);
+        gui_list_model_init(&state->statModel, state->hLvMsgStats,
+                            STAT_LIST_COLS, STAT_LIST_CELL_LEN, StatModelCell, state);
+        gui_list_model_init(&state->satModel, state->hLvSatellites,
+                            SAT_LIST_COLS, SAT_LIST_CELL_LEN, SatModelCell, state);
 
         /* Show the log tab by default */
         OnTabSelChange(state);
@@ -1437,12 +2181,80 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             OnTabSelChange(state);
         }
 
+        /* Owner-data ListViews ask for the text of the cells they paint */
+        if (nmh->code == LVN_GETDISPINFO) {
+            NMLVDISPINFO *di = (NMLVDISPINFO *)lParam;
+            if ((di->item.mask & LVIF_TEXT) && di->item.pszText &&
+                di->item.cchTextMax > 0) {
+                if (nmh->idFrom == IDC_LV_MOUNTPOINTS) {
+                    lstrcpyn(di->item.pszText,
+                             MountTableCell(&state->mountTable, di->item.iItem,
+                                            di->item.iSubItem),
+                             di->item.cchTextMax);
+                } else if (nmh->idFrom == IDC_LV_MSG_STATS) {
+                    gui_list_model_text(&state->statModel, di->item.iItem,
+                                        di->item.iSubItem, di->item.pszText,
+                                        di->item.cchTextMax);
+                } else if (nmh->idFrom == IDC_LV_SATELLITES) {
+                    gui_list_model_text(&state->satModel, di->item.iItem,
+                                        di->item.iSubItem, di->item.pszText,
+                                        di->item.cchTextMax);
+                } else if (nmh->idFrom == IDC_LV_PERF) {
+                    PerfCellText(state, di->item.iItem, di->item.iSubItem,
+                                 di->item.pszText, di->item.cchTextMax);
+                } else if (nmh->idFrom == IDC_LV_QUALITY) {
+                    QualityCellText(state, di->item.iItem, di->item.iSubItem,
+                                    di->item.pszText, di->item.cchTextMax);
+                }
+            }
+            return 0;
+        }
+
+        /* Time the paint of the main window's ListViews: custom draw
+         * brackets each one with a pre- and a post-paint notification. */
+        if (nmh->code == NM_CUSTOMDRAW &&
+            (nmh->idFrom == IDC_LV_MOUNTPOINTS || nmh->idFrom == IDC_LV_MSG_STATS ||
+             nmh->idFrom == IDC_LV_SATELLITES  || nmh->idFrom == IDC_LV_PERF ||
+             nmh->idFrom == IDC_LV_QUALITY)) {
+            NMCUSTOMDRAW *cd = (NMCUSTOMDRAW *)lParam;
+            if (cd->dwDrawStage == CDDS_PREPAINT) {
+                state->uiLag.main_paint_t0 = ui_lag_now();
+                return CDRF_NOTIFYPOSTPAINT;
+            }
+            if (cd->dwDrawStage == CDDS_POSTPAINT) {
+                ui_lag_paint(&state->uiLag, UI_LAG_WND_MAIN, state->uiLag.main_paint_t0);
+                state->uiLag.main_paint_t0 = 0;
+            }
+            return CDRF_DODEFAULT;
+        }
+
+        /* Type-ahead in the mountpoint list: find the next mountpoint
+         * starting with the typed text */
+        if (nmh->idFrom == IDC_LV_MOUNTPOINTS && nmh->code == LVN_ODFINDITEM) {
+            NMLVFINDITEM *fi = (NMLVFINDITEM *)lParam;
+            int n = state->mountTable.count;
+            if (!(fi->lvfi.flags & LVFI_STRING) || !fi->lvfi.psz || n == 0)
+                return -1;
+            size_t len = strlen(fi->lvfi.psz);
+            BOOL partial = (fi->lvfi.flags & LVFI_PARTIAL) != 0;
+            int start = (fi->iStart >= 0 && fi->iStart < n) ? fi->iStart : 0;
+            for (int k = 0; k < n; k++) {
+                int i = (start + k) % n;
+                const char *c = MountTableCell(&state->mountTable, i, 0);
+                if (partial ? _strnicmp(c, fi->lvfi.psz, len) == 0
+                            : _stricmp(c, fi->lvfi.psz) == 0)
+                    return i;
+            }
+            return -1;
+        }
+
         /* Double-click on mountpoint ListView → copy mountpoint to config */
         if (nmh->idFrom == IDC_LV_MOUNTPOINTS && nmh->code == NM_DBLCLK) {
             int sel = ListView_GetNextItem(state->hLvMountpoints, -1, LVNI_SELECTED);
             if (sel >= 0) {
                 char mount[256] = "";
-                ListView_GetItemText(state->hLvMountpoints, sel, 0, mount, sizeof(mount));
+                snprintf(mount, sizeof(mount), "%s",
+                         MountTableCell(&state->mountTable, sel, 0));
                 if (mount[0]) {
                     SetWindowText(state->hEditMountpoint, mount);
                     GuiToConfig(state);
@@ -1459,45 +2271,31 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         if (nmh->idFrom == IDC_LV_MSG_STATS && nmh->code == NM_DBLCLK) {
             NMITEMACTIVATE *nmia = (NMITEMACTIVATE *)lParam;
             int sel = nmia->iItem;
-            if (sel >= 0) {
-                char typeBuf[32];
-                ListView_GetItemText(state->hLvMsgStats, sel, 0,
-                                     typeBuf, sizeof(typeBuf));
-                int mt = atoi(typeBuf);
+            if (sel >= 0 && sel < state->statRows) {
+                int k  = state->statRowIdx[sel];
+                int mt = state->msgTypes.type[k];
                 if (mt > 0 && mt < GUI_MAX_MSG_TYPES) {
                     /* Belt-and-braces: if the cached HWND points at a
                      * destroyed window (e.g. WM_APP_DETAIL_CLOSED was lost
                      * for some reason), treat the slot as empty so we
                      * recreate the window instead of calling
                      * SetForegroundWindow on a dead HWND. */
-                    if (state->hDetailWnds[mt] && !IsWindow(state->hDetailWnds[mt]))
-                        state->hDetailWnds[mt] = NULL;
+                    if (state->hDetailWnds[k] && !IsWindow(state->hDetailWnds[k]))
+                        state->hDetailWnds[k] = NULL;
 
-                    if (state->hDetailWnds[mt]) {
+                    if (state->hDetailWnds[k]) {
                         /* Already open — bring to front */
-                        SetForegroundWindow(state->hDetailWnds[mt]);
+                        SetForegroundWindow(state->hDetailWnds[k]);
                     } else {
                         /* Create new detail window */
                         HINSTANCE hInst = (HINSTANCE)GetWindowLongPtr(
                             hwnd, GWLP_HINSTANCE);
                         HWND hDet = CreateDetailWindow(hInst, hwnd, mt);
                         if (hDet) {
-                            state->hDetailWnds[mt] = hDet;
-
-                            /* Populate immediately with cached last message */
-                            if (state->lastDecodedText[mt]) {
-                                int tlen = (int)strlen(
-                                    state->lastDecodedText[mt]) + 1;
-                                char *dup = (char *)HeapAlloc(
-                                    GetProcessHeap(), 0, tlen);
-                                if (dup) {
-                                    memcpy(dup, state->lastDecodedText[mt],
-                                           tlen);
-                                    if (!PostMessage(hDet, WM_USER + 1,
-                                                     0, (LPARAM)dup))
-                                        HeapFree(GetProcessHeap(), 0, dup);
-                                }
-                            }
+                            state->hDetailWnds[k] = hDet;
+
+                            /* Populate immediately from the last frame */
+                            UiRefreshDetail(state, k);
                         }
                     }
                 }
@@ -1508,8 +2306,8 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         if (nmh->idFrom == IDC_LV_MSG_STATS && nmh->code == LVN_COLUMNCLICK) {
             NMLISTVIEW *nmlv = (NMLISTVIEW *)lParam;
             int col = nmlv->iSubItem;
-            /* Columns 0–4 are numeric, column 5 (Description) is text */
-            SortListView(state->hLvMsgStats, col, (col <= 4));
+            /* Columns 0–15 are numeric, column 16 (Description) is text */
+            SortStatList(state, col, LvNextSortOrder(state->hLvMsgStats, col));
         }
 
         /* Column header click on Mountpoint ListView → sort rows */
@@ -1517,7 +2315,7 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             NMLISTVIEW *nmlv = (NMLISTVIEW *)lParam;
             int col = nmlv->iSubItem;
             /* Columns 8 (Lat), 9 (Lon), 10 (Distance) are numeric; rest is text */
-            SortListView(state->hLvMountpoints, col, (col >= 8));
+            SortMountList(state, col, LvNextSortOrder(state->hLvMountpoints, col));
         }
 
         /* Keyboard shortcuts for mountpoint ListView: Ctrl+A, Ctrl+C */
@@ -1536,6 +2334,11 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             LvShowContextMenu(hwnd, state->hLvMountpoints);
         }
 
+        /* ... and on the Performance tab */
+        if (nmh->idFrom == IDC_LV_PERF && nmh->code == NM_RCLICK) {
+            PerfShowContextMenu(hwnd, state);
+        }
+
         return 0;
     }
 
@@ -1590,15 +2393,16 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 return 0;
             }
             char filename[512] = "";
-            /* Default filename: YYYYMMDDHHmmss_<mountpoint>.rtcm3.  The
-             * buffer is generous so a 255-char mountpoint doesn't trigger
-             * a snprintf truncation warning. */
+            /* Default filename: YYYYMMDDHHmmss_<mountpoint>.nacap (native
+             * capture with receive timestamps); the second filter writes
+             * it compressed, saving as .rtcm3 writes a raw dump instead.  The buffer is generous so a 255-char
+             * mountpoint doesn't trigger a snprintf truncation warning. */
             {
                 time_t now_t = time(NULL);
                 struct tm *lt = localtime(&now_t);
                 char ts[16] = "00000000000000";
                 if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
-                snprintf(filename, sizeof(filename), "%s_%s.rtcm3", ts,
+                snprintf(filename, sizeof(filename), "%s_%s" RTCM_CAPTURE_EXT, ts,
                          state->config.MOUNTPOINT[0]
                              ? state->config.MOUNTPOINT : "capture");
             }
@@ -1607,16 +2411,20 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             ofn.lStructSize  = sizeof(ofn);
             ofn.hwndOwner    = hwnd;
             ofn.lpstrFilter  =
-                "RTCM 3 capture (*.rtcm3)\0*.rtcm3\0All Files (*.*)\0*.*\0";
+                "Native capture with timestamps (*.nacap)\0*.nacap\0"
+                "Compressed native capture (*.nacap)\0*.nacap\0"
+                "Raw RTCM 3 (*.rtcm3)\0*.rtcm3\0All Files (*.*)\0*.*\0";
             ofn.lpstrFile    = filename;
             ofn.nMaxFile     = MAX_PATH;
             ofn.lpstrTitle   = "Start RTCM Capture";
             ofn.Flags        = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
-            ofn.lpstrDefExt  = "rtcm3";
+            ofn.lpstrDefExt  = "nacap";
             if (!GetSaveFileName(&ofn)) return 0;
 
-            FILE *f = fopen(filename, "wb");
-            if (!f) {
+            RtcmRecorderOptions ropt = { 0 };
+            ropt.compress = ofn.nFilterIndex == 2;
+            RtcmRecorder *rec = rtcm_recorder_open(filename, &ropt);
+            if (!rec) {
                 char err[600];
                 snprintf(err, sizeof(err),
                     "[ERROR] Failed to open RTCM dump for writing:\r\n  %s\r\n",
@@ -1625,8 +2433,7 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 return 0;
             }
             EnterCriticalSection(&state->csRtcmDump);
-            state->hRtcmDump      = f;
-            state->rtcmDumpBytes  = 0;
+            state->hRtcmDump      = rec;
             strncpy(state->rtcmDumpPath, filename,
                     sizeof(state->rtcmDumpPath) - 1);
             state->rtcmDumpPath[sizeof(state->rtcmDumpPath) - 1] = '\0';
@@ -1634,7 +2441,9 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
             char msg[600];
             snprintf(msg, sizeof(msg),
-                "[INFO] RTCM capture started -> %s\r\n", filename);
+                "[INFO] RTCM capture started -> %s%s\r\n", filename,
+                ropt.compress && rtcm_capture_is_native_path(filename)
+                    ? " (compressed)" : "");
             AppendLog(state->hEditLog, msg);
             return 0;
         }
@@ -1653,7 +2462,8 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             ofn.lStructSize  = sizeof(ofn);
             ofn.hwndOwner    = hwnd;
             ofn.lpstrFilter  =
-                "RTCM 3 capture (*.rtcm3)\0*.rtcm3\0All Files (*.*)\0*.*\0";
+                "RTCM 3 capture (*.rtcm3;*.nacap)\0*.rtcm3;*.nacap\0"
+                "All Files (*.*)\0*.*\0";
             ofn.lpstrFile    = filename;
             ofn.nMaxFile     = MAX_PATH;
             ofn.lpstrTitle   = "Replay RTCM File";
@@ -1663,19 +2473,17 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
             /* Mirror the OnOpenStream stat-reset block so replay starts
              * with a clean slate (same as a fresh connection). */
-            memset(state->msgStats, 0, sizeof(state->msgStats));
-            memset(&state->satStats, 0, sizeof(state->satStats));
+            gui_fq_reset(&state->uiQueue);
+            state->uiKickPending = 0;
+            UiStatsReset(state);
             memset(state->skyState.sectors, 0, sizeof(state->skyState.sectors));
+            sky_track_arena_reset(&state->skyState.tracks);
+            cnr_history_free(&state->cnrHistory);
             memset(state->skyState.sats,    0, sizeof(state->skyState.sats));
             state->skyState.filter_gnss_id = 0;
-            ListView_DeleteAllItems(state->hLvMsgStats);
-            ListView_DeleteAllItems(state->hLvSatellites);
-            for (int i = 0; i < GUI_MAX_MSG_TYPES; i++) {
-                if (state->lastDecodedText[i]) {
-                    HeapFree(GetProcessHeap(), 0, state->lastDecodedText[i]);
-                    state->lastDecodedText[i] = NULL;
-                }
-            }
+            StatListsReset(state);
+            UiFreeLastFrames(state);
+            UiTypesReset(state);
             InterlockedExchange(&state->streamBytes, 0);
             InterlockedExchange(&state->streamFormat, 0);
             state->streamBytesLast = 0;
@@ -1701,12 +2509,14 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             LogRedirectStart(state);
             SetTimer(hwnd, IDT_LOG_PUMP,      100,  NULL);
             SetTimer(hwnd, IDT_STATUS_UPDATE, 1000, NULL);
+            SetTimer(hwnd, IDT_UI_BATCH,      UI_BATCH_INTERVAL_MS, NULL);
 
             state->hWorkerThread = CreateThread(NULL, 0, WorkerReplayRtcm,
                                                 state, 0, NULL);
             if (!state->hWorkerThread) {
                 KillTimer(hwnd, IDT_LOG_PUMP);
                 KillTimer(hwnd, IDT_STATUS_UPDATE);
+                KillTimer(hwnd, IDT_UI_BATCH);
                 LogRedirectStop(state);
                 state->bWorkerRunning = FALSE;
                 EnableWindow(state->hBtnCloseStream, FALSE);
@@ -1717,30 +2527,59 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
 
         case IDM_FILE_RTCM_STOP: {
-            FILE *f_to_close = NULL;
-            LONG  total_bytes = 0;
-            char  path[MAX_PATH] = "";
-
-            EnterCriticalSection(&state->csRtcmDump);
-            if (state->hRtcmDump) {
-                f_to_close = state->hRtcmDump;
-                total_bytes = state->rtcmDumpBytes;
-                strncpy(path, state->rtcmDumpPath, sizeof(path) - 1);
-                path[sizeof(path) - 1] = '\0';
-                state->hRtcmDump = NULL;
-            }
-            LeaveCriticalSection(&state->csRtcmDump);
-
-            if (!f_to_close) {
+            if (!stop_rtcm_capture(state, "stopped"))
                 AppendLog(state->hEditLog,
                     "[INFO] No RTCM capture is running.\r\n");
+            return 0;
+        }
+
+        case IDM_FILE_ANOMALY_DUMP: {
+            if (!anomaly_ring_count(&state->anomalies)) {
+                AppendLog(state->hEditLog,
+                    "[INFO] No CRC failures or sync losses recorded.\r\n");
                 return 0;
             }
-            fclose(f_to_close);
-            char msg[MAX_PATH + 96];
-            snprintf(msg, sizeof(msg),
-                "[INFO] RTCM capture stopped: %ld bytes -> %s\r\n",
-                (long)total_bytes, path);
+            char filename[512] = "";
+            {
+                time_t now_t = time(NULL);
+                struct tm *lt = localtime(&now_t);
+                char ts[16] = "00000000000000";
+                if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
+                snprintf(filename, sizeof(filename), "%s_%s_anomalies.txt", ts,
+                         state->config.MOUNTPOINT[0]
+                             ? state->config.MOUNTPOINT : "stream");
+            }
+            OPENFILENAME ofn;
+            ZeroMemory(&ofn, sizeof(ofn));
+            ofn.lStructSize  = sizeof(ofn);
+            ofn.hwndOwner    = hwnd;
+            ofn.lpstrFilter  = "Text (*.txt)\0*.txt\0All Files (*.*)\0*.*\0";
+            ofn.lpstrFile    = filename;
+            ofn.nMaxFile     = MAX_PATH;
+            ofn.lpstrTitle   = "Save Anomaly Dump";
+            ofn.Flags        = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST;
+            ofn.lpstrDefExt  = "txt";
+            if (!GetSaveFileName(&ofn)) return 0;
+
+            /* The stream thread keeps writing the ring; the dump reads it
+             * without stopping it. */
+            char msg[600];
+            FILE *f = fopen(filename, "w");
+            if (f) {
+                int n = anomaly_ring_dump(f, &state->anomalies,
+                                          state->config.MOUNTPOINT[0]
+                                              ? state->config.MOUNTPOINT : "stream");
+                bool ok = !ferror(f);
+                if (fclose(f) != 0) ok = false;
+                if (ok)
+                    snprintf(msg, sizeof(msg), "[INFO] %d anomalies saved to %s\r\n",
+                             n, filename);
+                else
+                    snprintf(msg, sizeof(msg), "[ERROR] Failed to write %s\r\n", filename);
+            } else {
+                snprintf(msg, sizeof(msg), "[ERROR] Failed to open %s for writing\r\n",
+                         filename);
+            }
             AppendLog(state->hEditLog, msg);
             return 0;
         }
@@ -1843,6 +2682,14 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             }
             return 0;
 
+        case IDM_VIEW_HISTORY: {
+            HINSTANCE hInst = (HINSTANCE)GetWindowLongPtr(hwnd, GWLP_HINSTANCE);
+            if (!ShowHistoryWindow(hInst, hwnd, state))
+                MessageBox(hwnd, "Failed to create History window.",
+                           APP_TITLE, MB_ICONERROR | MB_OK);
+            return 0;
+        }
+
         /* ── Tools menu (VRS tests) ─────────────────────────── */
         case IDM_TOOLS_VRS_GGA_TOGGLE: {
             BOOL was = state->ggaSendEnabled;
@@ -1895,7 +2742,17 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             LogPumpTimer(state);
         }
 
+        if (wParam == IDT_UI_BATCH) {
+            DrainUiQueue(state);
+        }
+
+        /* Performance tab: repaint the stage table once a second */
+        if (wParam == IDT_STATUS_UPDATE && IsWindowVisible(state->hLvPerf))
+            InvalidateRect(state->hLvPerf, NULL, FALSE);
+
         if (wParam == IDT_STATUS_UPDATE && state->bWorkerRunning) {
+            UiRollupTick(state);
+
             /* ── Compute data rate and update status bar ──── */
             double now = gui_get_time_seconds();
             double dt  = now - state->streamRateTime;
@@ -1915,6 +2772,34 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                 else
                     snprintf(statusBuf, sizeof(statusBuf),
                              "Streaming  %.0f B/s", rate);
+                /* Largest epoch burst, for sizing a radio link. */
+                if (state->burstPeak > 0) {
+                    size_t bl = strlen(statusBuf);
+                    snprintf(statusBuf + bl, sizeof(statusBuf) - bl,
+                             ", epoch burst %.1f kB", state->burstPeak / 1024.0);
+                }
+
+                /* Decode backlog: only shown once the decode thread
+                 * falls behind or the queue has overflowed. */
+                LONG qBytes = InterlockedCompareExchange(&state->decodeQueueBytes, 0, 0);
+                LONG qDrops = InterlockedCompareExchange(&state->decodeQueueDrops, 0, 0);
+                size_t sl = strlen(statusBuf);
+                if (qDrops > 0)
+                    snprintf(statusBuf + sl, sizeof(statusBuf) - sl,
+                             "  backlog %ld kB, %ld dropped",
+                             (long)(qBytes / 1024), (long)qDrops);
+                else if (qBytes >= 16384)
+                    snprintf(statusBuf + sl, sizeof(statusBuf) - sl,
+                             "  backlog %ld kB", (long)(qBytes / 1024));
+                /* Load shedding level (see load_governor.h). */
+                int load = load_gov_level(&state->loadGov);
+                sl = strlen(statusBuf);
+                if (load == LOAD_SHED_SKY)
+                    snprintf(statusBuf + sl, sizeof(statusBuf) - sl,
+                             "  load: sky/detail 1:%d", LOAD_GOV_DECIMATE);
+                else if (load == LOAD_SHED_TEXT)
+                    snprintf(statusBuf + sl, sizeof(statusBuf) - sl,
+                             "  load: sky/detail 1:%d, no trace", LOAD_GOV_DECIMATE);
                 SendMessage(state->hStatusBar, SB_SETTEXT, 0, (LPARAM)statusBuf);
             }
 
@@ -2020,81 +2905,13 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
     case WM_APP_STREAM_INFO: {
         state = GetAppState(hwnd);
         if (!state) break;
+        uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_MSG_STREAM_INFO);
 
         /* Show detected stream format in status bar part 1 */
         LONG fmt = InterlockedCompareExchange(&state->streamFormat, 0, 0);
-        const char *fmtStr;
-        switch (fmt) {
-        case 1:  fmtStr = "RTCM 3.x";           break;
-        case 2:  fmtStr = "UBX";                 break;
-        case 3:  fmtStr = "Septentrio SBF";      break;
-        case 4:  fmtStr = "RAW Trimble RT27";    break;
-        case 5:  fmtStr = "RAW Leica LB2";       break;
-        case 6:  fmtStr = "Unknown";              break;
-        default: fmtStr = "";                     break;
-        }
+        const char *fmtStr = stream_format_name((StreamFormat)fmt);
         SendMessage(state->hStatusBar, SB_SETTEXT, 1, (LPARAM)fmtStr);
-        return 0;
-    }
-
-    case WM_APP_MSG_RAW: {
-        state = GetAppState(hwnd);
-        if (!state) break;
-
-        int msg_type = (int)wParam;
-        RtcmRawMsg *raw = (RtcmRawMsg *)lParam;
-
-        if (raw && msg_type > 0 && msg_type < GUI_MAX_MSG_TYPES) {
-            /* ── Decode on the UI thread ─────────────────────── */
-            RtcmStrBuf sb;
-            rtcm_strbuf_init(&sb, 4096);
-            rtcm_set_output_buffer(&sb);
-            analyze_rtcm_message(raw->data, raw->length,
-                                 false, &state->config);
-            rtcm_set_output_buffer(NULL);
-
-            if (sb.len > 0) {
-                /* Convert \n → \r\n for the Win32 EDIT control */
-                int nlCount = 0;
-                for (int i = 0; i < sb.len; i++)
-                    if (sb.buf[i] == '\n') nlCount++;
-
-                int textLen = sb.len + nlCount + 1;
-                char *text = (char *)HeapAlloc(GetProcessHeap(), 0, textLen);
-                if (text) {
-                    int j = 0;
-                    for (int i = 0; i < sb.len; i++) {
-                        if (sb.buf[i] == '\n')
-                            text[j++] = '\r';
-                        text[j++] = sb.buf[i];
-                    }
-                    text[j] = '\0';
-
-                    /* ── Cache: replace previous decoded text ── */
-                    if (state->lastDecodedText[msg_type])
-                        HeapFree(GetProcessHeap(), 0,
-                                 state->lastDecodedText[msg_type]);
-                    state->lastDecodedText[msg_type] = text;
-
-                    /* ── Forward to open detail window ──────── */
-                    if (state->hDetailWnds[msg_type] != NULL) {
-                        /* Detail window frees its copy; send a duplicate */
-                        char *dup = (char *)HeapAlloc(GetProcessHeap(),
-                                                      0, textLen);
-                        if (dup) {
-                            memcpy(dup, text, textLen);
-                            if (!PostMessage(state->hDetailWnds[msg_type],
-                                             WM_USER + 1, 0, (LPARAM)dup))
-                                HeapFree(GetProcessHeap(), 0, dup);
-                        }
-                    }
-                }
-            }
-            rtcm_strbuf_free(&sb);
-        }
-
-        /* Always free the raw message */
-        if (raw) HeapFree(GetProcessHeap(), 0, raw);
+        ui_lag_end(&state->uiLag, UI_LAG_MSG_STREAM_INFO, t_lag);
         return 0;
     }
 
@@ -2102,103 +2919,27 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         state = GetAppState(hwnd);
         if (!state) break;
         int msg_type = (int)wParam;
-        if (msg_type > 0 && msg_type < GUI_MAX_MSG_TYPES)
-            state->hDetailWnds[msg_type] = NULL;
-        return 0;
-    }
-
-    case WM_APP_SKY_UPDATE: {
-        state = GetAppState(hwnd);
-        if (!state) break;
-
-        int count = (int)wParam;
-        SkySatUpdate *upd = (SkySatUpdate *)lParam;
-
-        if (upd) {
-            double now = gui_get_time_seconds();
-            for (int i = 0; i < count; i++) {
-                int g = upd[i].gnss_id;
-                int p = upd[i].prn;
-                if (g < 0 || g >= SV_EPH_MAX_GNSS)         continue;
-                if (p < 1 || p > SV_EPH_MAX_SATS_PER_GNSS) continue;
-
-                /* Markers: only update SkySat when the SV was actually
-                 * observed in this MSM frame.  Expected-only entries keep
-                 * their last observed timestamp -- so an SV that drops out
-                 * of the receiver's tracking will dim and then disappear
-                 * from the marker view per the existing stale logic. */
-                if (upd[i].observed_flag) {
-                    SkySat *s = &state->skyState.sats[g][p - 1];
-                    s->az_deg       = upd[i].az_deg;
-                    s->el_deg       = upd[i].el_deg;
-                    s->cnr_dbhz     = upd[i].cnr_dbhz;
-                    s->last_seen_ts = now;
-                    s->valid        = true;
-
-                    /* Append a track point if SKY_TRACK_INTERVAL_S has
-                     * elapsed since the last sample.  With the polyline
-                     * renderer in gui_sky_window.c, a tighter interval
-                     * makes any ephemeris-update step show up as a long
-                     * straight line between two close-in-time samples --
-                     * which is exactly the kind of glitch we want to see. */
-                    SkyTrackBuffer *tb = &s->track;
-                    double last_ts = 0.0;
-                    if (tb->count > 0) {
-                        int last_idx = (tb->head + SKY_TRACK_CAP - 1)
-                                       % SKY_TRACK_CAP;
-                        last_ts = tb->pts[last_idx].ts;
-                    }
-                    if (tb->count == 0 || (now - last_ts) >= SKY_TRACK_INTERVAL_S) {
-                        tb->pts[tb->head].az_deg = upd[i].az_deg;
-                        tb->pts[tb->head].el_deg = upd[i].el_deg;
-                        tb->pts[tb->head].ts     = now;
-                        tb->head = (tb->head + 1) % SKY_TRACK_CAP;
-                        if (tb->count < SKY_TRACK_CAP) tb->count++;
-                    }
-                }
-
-                /* Heatmap: index sector from (az, el) and bump counters.
-                 * Every entry contributes to expected; observed_flag=1
-                 * also bumps observed. */
-                int el_band = (int)(upd[i].el_deg / 10.0);
-                if (el_band < 0) el_band = 0;
-                if (el_band >= SKY_N_EL_BANDS) el_band = SKY_N_EL_BANDS - 1;
-                int n_az = sky_az_bins_per_band[el_band];
-                if (n_az < 1) n_az = 1;
-                int az_bin = (int)((upd[i].az_deg / 360.0) * n_az);
-                if (az_bin < 0) az_bin = 0;
-                if (az_bin >= n_az) az_bin = n_az - 1;
-
-                state->skyState.sectors[el_band][az_bin].expected++;
-                if (upd[i].observed_flag)
-                    state->skyState.sectors[el_band][az_bin].observed++;
-            }
-            HeapFree(GetProcessHeap(), 0, upd);
-        }
-        /* upd==NULL with count==0 is a status-refresh ping: just repaint
-         * so the status line picks up new ARP/ephemeris availability. */
-        if (state->hSkyWnd)
-            InvalidateRect(state->hSkyWnd, NULL, FALSE);
+        int k = gui_type_map_find(&state->msgTypes, msg_type);
+        if (k >= 0)
+            state->hDetailWnds[k] = NULL;
         return 0;
     }
 
     case WM_APP_STREAM_DONE: {
         state = GetAppState(hwnd);
-        if (state) OnStreamDone(hwnd, state);
+        if (!state) return 0;
+        uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_MSG_STREAM_DONE);
+        OnStreamDone(hwnd, state);
+        ui_lag_end(&state->uiLag, UI_LAG_MSG_STREAM_DONE, t_lag);
         return 0;
     }
 
-    case WM_APP_STAT_UPDATE: {
+    case WM_APP_UI_BATCH: {
         state = GetAppState(hwnd);
-        if (state) {
-            OnStatUpdate(state, (int)wParam, (int)lParam);
-            /* WM_TIMER (IDT_LOG_PUMP) is low priority — Windows only posts
-             * it when the queue is otherwise empty.  At high MSM rates the
-             * queue is never empty long enough, so worker-thread printf
-             * output sits in the pipe indefinitely.  Pump it here too so
-             * log lines surface as fast as messages arrive. */
-            LogPumpTimer(state);
-        }
+        if (!state) return 0;
+        uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_MSG_UI_BATCH);
+        DrainUiQueue(state);
+        ui_lag_end(&state->uiLag, UI_LAG_MSG_UI_BATCH, t_lag);
         return 0;
     }
 
@@ -2214,15 +2955,40 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         return 0;
     }
 
-    case WM_APP_SAT_UPDATE: {
+    case WM_APP_MOUNT_ROWS: {
+        /* A batch of STR lines while the sourcetable downloads */
         state = GetAppState(hwnd);
-        if (state) OnSatUpdate(state);
+        char *rows = (char *)lParam;
+        if (!state) {
+            free(rows);
+            break;
+        }
+        uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_MSG_MOUNT_ROWS);
+        if (!state->mountStreaming) {
+            state->mountStreaming = TRUE;
+            GuiToConfig(state);  /* ensure latest lat/lon from GUI */
+            ListView_SetItemState(state->hLvMountpoints, -1, 0,
+                                  LVIS_SELECTED | LVIS_FOCUSED);
+            MountTableBegin(&state->mountTable,
+                            state->config.LATITUDE, state->config.LONGITUDE);
+        }
+        MountTableAppend(&state->mountTable, rows);
+        free(rows);
+
+        int count = state->mountTable.count;
+        ListView_SetItemCountEx(state->hLvMountpoints, count, LVSICF_NOSCROLL);
+        InvalidateRect(state->hLvMountpoints, NULL, FALSE);
+        char text[64];
+        snprintf(text, sizeof(text), "%d mountpoints...", count);
+        SendMessage(state->hStatusBar, SB_SETTEXT, 1, (LPARAM)text);
+        ui_lag_end(&state->uiLag, UI_LAG_MSG_MOUNT_ROWS, t_lag);
         return 0;
     }
 
     case WM_APP_MOUNT_RESULT: {
         state = GetAppState(hwnd);
         if (!state) break;
+        uint64_t t_lag = ui_lag_begin(&state->uiLag, UI_LAG_MSG_MOUNT_RESULT);
 
         state->bWorkerRunning = FALSE;
         EnableWindow(state->hBtnCloseStream, FALSE);
@@ -2234,13 +3000,25 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
         char *mount_table = (char *)lParam;
 
+        /* Rows streamed in by WM_APP_MOUNT_ROWS only need indexing */
+        BOOL streamed = state->mountStreaming;
+        state->mountStreaming = FALSE;
+        if (streamed)
+            MountTableFinish(&state->mountTable);
+
         if (wParam == 0 && mount_table) {
             /* Success — parse and populate the ListView */
-            GuiToConfig(state);  /* ensure latest lat/lon from GUI */
-            ParseMountTable(mount_table, state->hLvMountpoints,
-                            state->config.LATITUDE, state->config.LONGITUDE);
+            if (!streamed) {
+                GuiToConfig(state);  /* ensure latest lat/lon from GUI */
+                ListView_SetItemState(state->hLvMountpoints, -1, 0,
+                                      LVIS_SELECTED | LVIS_FOCUSED);
+                ParseMountTable(mount_table, &state->mountTable,
+                                state->config.LATITUDE, state->config.LONGITUDE);
+            }
 
-            int count = ListView_GetItemCount(state->hLvMountpoints);
+            int count = state->mountTable.count;
+            ListView_SetItemCountEx(state->hLvMountpoints, count, 0);
+            InvalidateRect(state->hLvMountpoints, NULL, TRUE);
             char logmsg[128];
             snprintf(logmsg, sizeof(logmsg),
                      "[INFO] Received %d mountpoint(s).\r\n", count);
@@ -2249,6 +3027,8 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
             snprintf(logmsg, sizeof(logmsg), "%d mountpoints", count);
             SendMessage(state->hStatusBar, SB_SETTEXT, 1, (LPARAM)logmsg);
+
+            UiUpdateNearest(state, state->config.LATITUDE, state->config.LONGITUDE);
         } else {
             /* Error */
             AppendLog(state->hEditLog,
@@ -2258,19 +3038,20 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
 
         free(mount_table);  /* safe even if NULL */
+        ui_lag_end(&state->uiLag, UI_LAG_MSG_MOUNT_RESULT, t_lag);
         return 0;
     }
 
     case WM_DESTROY: {
-        /* Free the last-decoded-text cache */
+        /* Free the last-frame cache, decode scratch and the sourcetable */
         state = GetAppState(hwnd);
         if (state) {
-            for (int i = 0; i < GUI_MAX_MSG_TYPES; i++) {
-                if (state->lastDecodedText[i]) {
-                    HeapFree(GetProcessHeap(), 0, state->lastDecodedText[i]);
-                    state->lastDecodedText[i] = NULL;
-                }
-            }
+            UiFreeLastFrames(state);
+            rtcm_strbuf_free(&state->uiDecodeText);
+            rtcm_strbuf_free(&state->uiDetailText);
+            MountTableFree(&state->mountTable);
+            gui_list_model_free(&state->statModel);
+            gui_list_model_free(&state->satModel);
         }
         PostQuitMessage(0);
         return 0;
@@ -0,0 +1,175 @@
+/**
+ * @file gui_frame_queue.c
+ * @brief Bounded single-producer / single-consumer frame queue.
+ *
+ * Record layout in the ring: a 4-byte header (16-bit length, 16-bit tag)
+ * followed by the payload, padded to a multiple of 4 bytes.  A record
+ * never wraps; if it does not fit before the end of the ring, the
+ * producer writes a header with length GFQ_WRAP and continues at offset 0.
+ *
+ * head is only written by the producer and tail only by the consumer.
+ * Both are published with InterlockedExchange() (a full barrier), so a
+ * record's bytes are visible before the index that exposes them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_frame_queue.h"
+
+#include <string.h>
+
+#define GFQ_HDR        4
+#define GFQ_WRAP       0xFFFF
+#define GFQ_ALIGN(n)   (((DWORD)(n) + 3u) & ~3u)
+
+static LONG gfq_load(volatile LONG *p)
+{
+    return InterlockedCompareExchange(p, 0, 0);
+}
+
+static void gfq_put_hdr(unsigned char *p, int len, int tag)
+{
+    p[0] = (unsigned char)(len & 0xFF);
+    p[1] = (unsigned char)(len >> 8);
+    p[2] = (unsigned char)(tag & 0xFF);
+    p[3] = (unsigned char)(tag >> 8);
+}
+
+bool gui_fq_init(GuiFrameQueue *q, DWORD size)
+{
+    memset(q, 0, sizeof(*q));
+    if (size < 4096 || (size & (size - 1)) != 0) return false;
+
+    q->buf    = (unsigned char *)HeapAlloc(GetProcessHeap(), 0, size);
+    q->hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!q->buf || !q->hEvent) {
+        gui_fq_free(q);
+        return false;
+    }
+    q->size = size;
+    return true;
+}
+
+void gui_fq_free(GuiFrameQueue *q)
+{
+    if (q->buf)    HeapFree(GetProcessHeap(), 0, q->buf);
+    if (q->hEvent) CloseHandle(q->hEvent);
+    q->buf    = NULL;
+    q->hEvent = NULL;
+    q->size   = 0;
+}
+
+bool gui_fq_push(GuiFrameQueue *q, const void *data, int len, int tag)
+{
+    if (len < 0 || len >= GFQ_WRAP) return false;
+
+    DWORD need  = GFQ_ALIGN(GFQ_HDR + len);
+    DWORD head  = (DWORD)q->head;
+    DWORD tail  = (DWORD)gfq_load(&q->tail);
+    DWORD off   = head & (q->size - 1);
+    DWORD to_end = q->size - off;
+    DWORD pad   = to_end < need ? to_end : 0;
+
+    if (q->size - (head - tail) < pad + need) {
+        InterlockedIncrement(&q->dropped);
+        return false;
+    }
+    if (pad) {
+        /* to_end is a multiple of 4, so the marker always fits. */
+        gfq_put_hdr(q->buf + off, GFQ_WRAP, 0);
+        head += pad;
+        off   = 0;
+    }
+    gfq_put_hdr(q->buf + off, len, tag);
+    memcpy(q->buf + off + GFQ_HDR, data, (size_t)len);
+    head += need;
+    InterlockedExchange(&q->head, (LONG)head);
+
+    LONG depth = (LONG)(head - tail);
+    if (depth > q->peak) InterlockedExchange(&q->peak, depth);
+    InterlockedIncrement(&q->pushed);
+    return true;
+}
+
+const unsigned char *gui_fq_peek(GuiFrameQueue *q, int *len, int *tag)
+{
+    DWORD tail = (DWORD)q->tail;
+    DWORD head = (DWORD)gfq_load(&q->head);
+
+    while (tail != head) {
+        DWORD off = tail & (q->size - 1);
+        const unsigned char *p = q->buf + off;
+        int l = p[0] | (p[1] << 8);
+        if (l == GFQ_WRAP) {
+            tail += q->size - off;
+            InterlockedExchange(&q->tail, (LONG)tail);
+            continue;
+        }
+        q->peek_len = l;
+        *len = l;
+        if (tag) *tag = p[2] | (p[3] << 8);
+        return p + GFQ_HDR;
+    }
+    return NULL;
+}
+
+void gui_fq_pop(GuiFrameQueue *q)
+{
+    DWORD tail = (DWORD)q->tail + GFQ_ALIGN(GFQ_HDR + q->peek_len);
+    InterlockedExchange(&q->tail, (LONG)tail);
+}
+
+void gui_fq_begin(GuiFrameQueue *q, GuiFqCursor *c)
+{
+    c->pos = (DWORD)q->tail;
+    c->end = (DWORD)gfq_load(&q->head);
+}
+
+const unsigned char *gui_fq_next(GuiFrameQueue *q, GuiFqCursor *c,
+                                 int *len, int *tag)
+{
+    while (c->pos != c->end) {
+        DWORD off = c->pos & (q->size - 1);
+        const unsigned char *p = q->buf + off;
+        int l = p[0] | (p[1] << 8);
+        if (l == GFQ_WRAP) {
+            c->pos += q->size - off;
+            continue;
+        }
+        c->pos += GFQ_ALIGN(GFQ_HDR + l);
+        *len = l;
+        if (tag) *tag = p[2] | (p[3] << 8);
+        return p + GFQ_HDR;
+    }
+    return NULL;
+}
+
+void gui_fq_release(GuiFrameQueue *q, const GuiFqCursor *c)
+{
+    InterlockedExchange(&q->tail, (LONG)c->pos);
+}
+
+void gui_fq_reset(GuiFrameQueue *q)
+{
+    InterlockedExchange(&q->tail, gfq_load(&q->head));
+    InterlockedExchange(&q->pushed,  0);
+    InterlockedExchange(&q->dropped, 0);
+    InterlockedExchange(&q->peak,    0);
+}
+
+LONG gui_fq_depth(GuiFrameQueue *q)
+{
+    return (LONG)((DWORD)gfq_load(&q->head) - (DWORD)gfq_load(&q->tail));
+}
+
+void gui_fq_signal(GuiFrameQueue *q)
+{
+    SetEvent(q->hEvent);
+}
+
+void gui_fq_wait(GuiFrameQueue *q, DWORD timeout_ms)
+{
+    WaitForSingleObject(q->hEvent, timeout_ms);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file gui_frame_queue.h
+ * @brief Bounded single-producer / single-consumer frame queue.
+ *
+ * A lock-free ring of variable-length records used to hand RTCM frames
+ * from one worker thread to another without a heap allocation or a lock
+ * per frame.  Each record carries a length and a small integer tag (the
+ * message type for RTCM frames).
+ *
+ * Exactly one thread may push and exactly one thread may consume, either a
+ * record at a time (gui_fq_peek() / gui_fq_pop()) or a batch at a time
+ * (gui_fq_begin() / gui_fq_next() / gui_fq_release()).  The
+ * producer never blocks: when the queue is full the record is dropped and
+ * counted, so a slow consumer cannot stall the socket reader.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_FRAME_QUEUE_H
+#define GUI_FRAME_QUEUE_H
+
+#define _WIN32_WINNT 0x0601
+#include <windows.h>
+#include <stdbool.h>
+
+/**
+ * @struct GuiFrameQueue
+ * @brief Queue state.  Treat as opaque; read the counters with
+ *        gui_fq_depth() / the Interlocked API.
+ *
+ * Fields:
+ *   - buf, size:  Ring storage; size is a power of two.
+ *   - head:       Producer index (free-running byte offset).
+ *   - tail:       Consumer index (free-running byte offset).
+ *   - pushed:     Records accepted.
+ *   - dropped:    Records rejected because the queue was full.
+ *   - peak:       High-water mark of queued bytes.
+ *   - hEvent:     Auto-reset event set by gui_fq_signal().
+ *   - peek_len:   Consumer-side length of the record returned by gui_fq_peek().
+ */
+typedef struct {
+    unsigned char *buf;
+    DWORD          size;
+    volatile LONG  head;
+    volatile LONG  tail;
+    volatile LONG  pushed;
+    volatile LONG  dropped;
+    volatile LONG  peak;
+    HANDLE         hEvent;
+    int            peek_len;
+} GuiFrameQueue;
+
+/**
+ * @brief Allocate a queue of @p size bytes (power of two, >= 4096).
+ * @return true on success.
+ */
+bool gui_fq_init(GuiFrameQueue *q, DWORD size);
+
+/** @brief Free the ring and the event.  Both threads must be done with it. */
+void gui_fq_free(GuiFrameQueue *q);
+
+/**
+ * @brief Producer: append one record.
+ *
+ * @param q     Queue.
+ * @param data  Record bytes.
+ * @param len   Record length (0 .. 65534).
+ * @param tag   Caller-defined value returned by gui_fq_peek() (0 .. 65535).
+ * @return false if the record did not fit (counted in @c dropped).
+ */
+bool gui_fq_push(GuiFrameQueue *q, const void *data, int len, int tag);
+
+/**
+ * @brief Consumer: get the oldest record without removing it.
+ *
+ * The returned pointer stays valid until gui_fq_pop().
+ *
+ * @param q    Queue.
+ * @param len  Receives the record length.
+ * @param tag  Receives the record tag (may be NULL).
+ * @return Record bytes, or NULL if the queue is empty.
+ */
+const unsigned char *gui_fq_peek(GuiFrameQueue *q, int *len, int *tag);
+
+/** @brief Consumer: release the record returned by the last gui_fq_peek(). */
+void gui_fq_pop(GuiFrameQueue *q);
+
+/**
+ * @struct GuiFqCursor
+ * @brief Consumer-side batch read position (see gui_fq_begin()).
+ */
+typedef struct {
+    DWORD pos;   /**< Next record to return. */
+    DWORD end;   /**< Producer index when the batch was opened. */
+} GuiFqCursor;
+
+/**
+ * @brief Consumer: open a batch covering every record queued right now.
+ *
+ * Records pushed after this call belong to the next batch, so a fast
+ * producer cannot keep one batch open indefinitely.
+ */
+void gui_fq_begin(GuiFrameQueue *q, GuiFqCursor *c);
+
+/**
+ * @brief Consumer: return the next record of the batch and advance @p c.
+ *
+ * Unlike gui_fq_peek(), the space is not given back, so every pointer
+ * returned for this batch stays valid until gui_fq_release().
+ *
+ * @return Record bytes, or NULL at the end of the batch.
+ */
+const unsigned char *gui_fq_next(GuiFrameQueue *q, GuiFqCursor *c,
+                                 int *len, int *tag);
+
+/** @brief Consumer: free every record up to the cursor position. */
+void gui_fq_release(GuiFrameQueue *q, const GuiFqCursor *c);
+
+/**
+ * @brief Discard everything queued and zero the counters.
+ *
+ * Only valid while no producer is running (e.g. between two streams).
+ */
+void gui_fq_reset(GuiFrameQueue *q);
+
+/** @brief Bytes currently queued (callable from any thread). */
+LONG gui_fq_depth(GuiFrameQueue *q);
+
+/** @brief Producer: wake a consumer blocked in gui_fq_wait(). */
+void gui_fq_signal(GuiFrameQueue *q);
+
+/** @brief Consumer: sleep until signalled or @p timeout_ms elapses. */
+void gui_fq_wait(GuiFrameQueue *q, DWORD timeout_ms);
+
+#endif /* GUI_FRAME_QUEUE_H */
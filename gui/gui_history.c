@@ -0,0 +1,396 @@
+/**
+ * @file gui_history.c
+ * @brief History window: the rollup series of the stream as charts.
+ *
+ * Follows the gui_sv_detail.c pattern: a strip of controls at the top
+ * (series, resolution, Copy JSON), a double-buffered GDI plot below,
+ * redrawn by a 1-Hz timer.  The series list is rebuilt when the store
+ * gains a series, keeping the selection by name.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_history.h"
+#include "resource.h"
+#include "gui_state.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define IDC_HIST_SERIES  4201
+#define IDC_HIST_RES     4202
+#define IDC_HIST_COPY    4203
+#define IDT_HIST_TICK    4002
+
+#define HIST_BTN_H       24
+#define HIST_PAD         6
+#define HIST_STRIP_H     (HIST_BTN_H + 2 * HIST_PAD)
+#define HIST_MARGIN_L    58
+#define HIST_MARGIN      10
+/* Points further apart than this many steps are not joined (a gap) */
+#define HIST_GAP_STEPS   1.5
+
+static const char *const g_histResNames[ROLLUP_TIERS] = {
+    "1 s  (last hour)", "1 min  (last day)", "15 min  (last 30 days)"
+};
+
+static BOOL      g_historyClassRegistered = FALSE;
+static AppState *g_appState = NULL;
+static int       g_histSeriesShown = -1;    /* series in the combo list */
+static RollupPoint g_histPts[3600];         /* the longest ring (1 s) */
+
+/* ── Controls ──────────────────────────────────────────────── */
+
+static RollupTier hist_tier(HWND hwnd)
+{
+    LRESULT sel = SendDlgItemMessage(hwnd, IDC_HIST_RES, CB_GETCURSEL, 0, 0);
+    return sel >= 0 && sel < ROLLUP_TIERS ? (RollupTier)sel : ROLLUP_1M;
+}
+
+/* Name of the selected series; false when there is none. */
+static BOOL hist_selected(HWND hwnd, char name[ROLLUP_NAME_MAX])
+{
+    HWND hCombo = GetDlgItem(hwnd, IDC_HIST_SERIES);
+    LRESULT sel = SendMessage(hCombo, CB_GETCURSEL, 0, 0);
+    if (sel < 0 || SendMessage(hCombo, CB_GETLBTEXTLEN, (WPARAM)sel, 0) >= ROLLUP_NAME_MAX)
+        return FALSE;
+    SendMessage(hCombo, CB_GETLBTEXT, (WPARAM)sel, (LPARAM)name);
+    return TRUE;
+}
+
+/* Rebuild the series list when the store has gained (or, on a new
+ * stream, lost) series; the selection stays on the same name. */
+static void hist_refresh_series(HWND hwnd, RollupStore *r)
+{
+    int n = rollup_count(r);
+    if (n == g_histSeriesShown) return;
+    g_histSeriesShown = n;
+
+    char keep[ROLLUP_NAME_MAX] = "";
+    if (!hist_selected(hwnd, keep)) snprintf(keep, sizeof(keep), "frames");
+    HWND hCombo = GetDlgItem(hwnd, IDC_HIST_SERIES);
+    SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
+    for (int id = 0; id < n; id++) {
+        char name[ROLLUP_NAME_MAX];
+        if (rollup_info(r, id, name, NULL))
+            SendMessage(hCombo, CB_ADDSTRING, 0, (LPARAM)name);
+    }
+    LRESULT sel = SendMessage(hCombo, CB_FINDSTRINGEXACT, (WPARAM)-1, (LPARAM)keep);
+    SendMessage(hCombo, CB_SETCURSEL, (WPARAM)(sel >= 0 ? sel : 0), 0);
+}
+
+/* Every series at the shown resolution to the clipboard as JSON. */
+static void hist_copy_json(HWND hwnd, RollupStore *r)
+{
+    RollupTier tier = hist_tier(hwnd);
+    size_t len = 0;
+    char *json = rollup_json(r, "", tier, 0.0, &len);
+    if (!json) return;
+    char head[96];
+    int hl = snprintf(head, sizeof(head), "{\"res\":\"%s\",\"step\":%d,\"series\":",
+                      rollup_tier_name(tier), rollup_tier_step(tier));
+    HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, (SIZE_T)hl + len + 3);
+    if (hMem) {
+        char *p = (char *)GlobalLock(hMem);
+        memcpy(p, head, (size_t)hl);
+        memcpy(p + hl, json, len);
+        memcpy(p + hl + len, "}\n", 3);
+        GlobalUnlock(hMem);
+        if (OpenClipboard(hwnd)) {
+            EmptyClipboard();
+            if (!SetClipboardData(CF_TEXT, hMem)) GlobalFree(hMem);
+            CloseClipboard();
+        } else {
+            GlobalFree(hMem);
+        }
+    }
+    free(json);
+}
+
+/* ── Plot ──────────────────────────────────────────────────── */
+
+/* 1, 2 or 5 times a power of ten at or above v. */
+static double hist_nice_ceil(double v)
+{
+    if (!(v > 0.0)) return 1.0;
+    double p = pow(10.0, floor(log10(v)));
+    double m = v / p;
+    return (m <= 1.0 ? 1.0 : m <= 2.0 ? 2.0 : m <= 5.0 ? 5.0 : 10.0) * p;
+}
+
+static void hist_plot_rect(HWND hwnd, RECT *rc)
+{
+    GetClientRect(hwnd, rc);
+    rc->top = HIST_STRIP_H;
+}
+
+/* The series over the whole ring of its resolution, oldest left: a
+ * counter as a rate per second, a gauge as its mean plus a light
+ * min / max line. */
+static void hist_plot_draw(HDC hdc, const RECT *rc, RollupStore *r,
+                           const char *name, RollupTier tier)
+{
+    FillRect(hdc, rc, (HBRUSH)(COLOR_WINDOW + 1));
+    SetBkMode(hdc, TRANSPARENT);
+
+    RECT pr = { rc->left + HIST_MARGIN_L, rc->top + HIST_MARGIN + 14,
+                rc->right - HIST_MARGIN,  rc->bottom - HIST_MARGIN - 14 };
+    int pw = pr.right - pr.left, ph = pr.bottom - pr.top;
+    if (pw < 40 || ph < 40) return;
+
+    int id = name ? rollup_find(r, name) : -1;
+    RollupKind kind = ROLLUP_COUNTER;
+    rollup_info(r, id, NULL, &kind);
+    int step = rollup_tier_step(tier);
+    double span = (double)step * rollup_tier_length(tier);
+    double now  = (double)time(NULL);
+    double t_left = now - span;
+    int n = id >= 0 ? rollup_read(r, id, tier, t_left, g_histPts, 3600) : 0;
+
+    double scale = kind == ROLLUP_COUNTER ? 1.0 / step : 1.0;
+    double vmax = 0.0;
+    for (int i = 0; i < n; i++) {
+        double v = kind == ROLLUP_GAUGE ? g_histPts[i].max : g_histPts[i].value * scale;
+        if (v > vmax) vmax = v;
+    }
+    vmax = hist_nice_ceil(vmax * 1.05);
+
+    /* Grid: five bands, labelled on the left */
+    HPEN penGrid = CreatePen(PS_DOT, 1, RGB(200, 200, 200));
+    HPEN penOld  = (HPEN)SelectObject(hdc, penGrid);
+    SetTextColor(hdc, RGB(96, 96, 96));
+    for (int k = 0; k <= 5; k++) {
+        int y = pr.bottom - k * ph / 5;
+        MoveToEx(hdc, pr.left, y, NULL);
+        LineTo(hdc, pr.right, y);
+        char lbl[24];
+        snprintf(lbl, sizeof(lbl), "%.6g", vmax * k / 5);
+        SIZE sz;
+        GetTextExtentPoint32(hdc, lbl, (int)strlen(lbl), &sz);
+        TextOut(hdc, pr.left - sz.cx - 4, y - 7, lbl, (int)strlen(lbl));
+    }
+    static const char *const spans[ROLLUP_TIERS] = { "-1 h", "-24 h", "-30 d" };
+    TextOut(hdc, pr.left, pr.bottom + 2, spans[tier], (int)strlen(spans[tier]));
+    TextOut(hdc, pr.right - 20, pr.bottom + 2, "now", 3);
+    SelectObject(hdc, penOld);
+    DeleteObject(penGrid);
+
+    char title[96];
+    if (id < 0)
+        snprintf(title, sizeof(title), "(no history yet -- open a stream)");
+    else
+        snprintf(title, sizeof(title), "%s   %s", name,
+                 kind == ROLLUP_COUNTER ? "per second, mean of each bucket"
+                                        : "mean (dark), min / max (light)");
+    TextOut(hdc, pr.left, rc->top + HIST_MARGIN - 2, title, (int)strlen(title));
+
+    static POINT pts[3600], lo[3600], hi[3600];
+    HPEN penBand = CreatePen(PS_SOLID, 1, RGB(170, 200, 235));
+    HPEN penLine = CreatePen(PS_SOLID, 2, RGB(0, 102, 204));
+    int run = 0;
+    for (int i = 0; i <= n; i++) {
+        BOOL brk = i == n || (run > 0 &&
+                   g_histPts[i].t - g_histPts[i - 1].t > HIST_GAP_STEPS * step);
+        if (brk && run > 0) {
+            if (kind == ROLLUP_GAUGE) {
+                SelectObject(hdc, penBand);
+                if (run > 1) { Polyline(hdc, lo, run); Polyline(hdc, hi, run); }
+            }
+            SelectObject(hdc, penLine);
+            if (run > 1) Polyline(hdc, pts, run);
+            else         Ellipse(hdc, pts[0].x - 2, pts[0].y - 2, pts[0].x + 2, pts[0].y + 2);
+            run = 0;
+        }
+        if (i == n) break;
+        const RollupPoint *p = &g_histPts[i];
+        int x = pr.left + (int)((p->t + step / 2.0 - t_left) * pw / span);
+        double v = p->value * scale;
+        pts[run].x = lo[run].x = hi[run].x = x;
+        pts[run].y = pr.bottom - (int)(v * ph / vmax);
+        lo[run].y  = pr.bottom - (int)(p->min * ph / vmax);
+        hi[run].y  = pr.bottom - (int)(p->max * ph / vmax);
+        run++;
+    }
+    SelectObject(hdc, penOld);
+    DeleteObject(penBand);
+    DeleteObject(penLine);
+
+    HPEN penEdge = CreatePen(PS_SOLID, 1, RGB(140, 140, 140));
+    SelectObject(hdc, penEdge);
+    SelectObject(hdc, GetStockObject(NULL_BRUSH));
+    Rectangle(hdc, pr.left, pr.top, pr.right + 1, pr.bottom + 1);
+    SelectObject(hdc, penOld);
+    DeleteObject(penEdge);
+}
+
+/* ── Window procedure ──────────────────────────────────────── */
+
+static LRESULT CALLBACK HistoryWndProc(HWND hwnd, UINT msg,
+                                       WPARAM wParam, LPARAM lParam)
+{
+    AppState *state = g_appState;
+
+    switch (msg) {
+
+    case WM_CREATE: {
+        HINSTANCE hInst = (HINSTANCE)GetWindowLongPtr(hwnd, GWLP_HINSTANCE);
+        HFONT hGui = (HFONT)GetStockObject(DEFAULT_GUI_FONT);
+
+        HWND hSeries = CreateWindowEx(
+            0, "COMBOBOX", "",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | WS_VSCROLL | CBS_DROPDOWNLIST | CBS_SORT,
+            8, HIST_PAD, 180, 300, hwnd,
+            (HMENU)(intptr_t)IDC_HIST_SERIES, hInst, NULL);
+        HWND hRes = CreateWindowEx(
+            0, "COMBOBOX", "",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | CBS_DROPDOWNLIST,
+            196, HIST_PAD, 170, 200, hwnd,
+            (HMENU)(intptr_t)IDC_HIST_RES, hInst, NULL);
+        HWND hCopy = CreateWindowEx(
+            0, "BUTTON", "Copy JSON",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | BS_PUSHBUTTON,
+            374, HIST_PAD, 90, HIST_BTN_H, hwnd,
+            (HMENU)(intptr_t)IDC_HIST_COPY, hInst, NULL);
+        if (hSeries) SendMessage(hSeries, WM_SETFONT, (WPARAM)hGui, TRUE);
+        if (hCopy)   SendMessage(hCopy,   WM_SETFONT, (WPARAM)hGui, TRUE);
+        if (hRes) {
+            SendMessage(hRes, WM_SETFONT, (WPARAM)hGui, TRUE);
+            for (int k = 0; k < ROLLUP_TIERS; k++)
+                SendMessage(hRes, CB_ADDSTRING, 0, (LPARAM)g_histResNames[k]);
+            SendMessage(hRes, CB_SETCURSEL, ROLLUP_1S, 0);
+        }
+
+        g_histSeriesShown = -1;
+        if (state) hist_refresh_series(hwnd, state->rollup);
+        SetTimer(hwnd, IDT_HIST_TICK, 1000, NULL);
+        return 0;
+    }
+
+    case WM_PAINT: {
+        uint64_t t_lag = ui_lag_now();
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(hwnd, &ps);
+        RECT rc;
+        hist_plot_rect(hwnd, &rc);
+        int w = rc.right - rc.left, h = rc.bottom - rc.top;
+        if (state && w > 0 && h > 0) {
+            /* Double buffer: the plot redraws every second */
+            HDC     hdcMem = CreateCompatibleDC(hdc);
+            HBITMAP bmp    = CreateCompatibleBitmap(hdc, w, h);
+            HBITMAP bmpOld = (HBITMAP)SelectObject(hdcMem, bmp);
+            HFONT   fntOld = (HFONT)SelectObject(hdcMem,
+                                                 GetStockObject(DEFAULT_GUI_FONT));
+            RECT local = { 0, 0, w, h };
+            char name[ROLLUP_NAME_MAX];
+            hist_plot_draw(hdcMem, &local, state->rollup,
+                           hist_selected(hwnd, name) ? name : NULL, hist_tier(hwnd));
+            BitBlt(hdc, rc.left, rc.top, w, h, hdcMem, 0, 0, SRCCOPY);
+            SelectObject(hdcMem, fntOld);
+            SelectObject(hdcMem, bmpOld);
+            DeleteObject(bmp);
+            DeleteDC(hdcMem);
+        }
+        EndPaint(hwnd, &ps);
+        if (state) ui_lag_paint(&state->uiLag, UI_LAG_WND_HISTORY, t_lag);
+        return 0;
+    }
+
+    case WM_COMMAND: {
+        int id = LOWORD(wParam);
+        if (id == IDC_HIST_COPY && state) {
+            hist_copy_json(hwnd, state->rollup);
+            return 0;
+        }
+        if ((id == IDC_HIST_SERIES || id == IDC_HIST_RES) &&
+            HIWORD(wParam) == CBN_SELCHANGE) {
+            RECT rc;
+            hist_plot_rect(hwnd, &rc);
+            InvalidateRect(hwnd, &rc, FALSE);
+            return 0;
+        }
+        break;
+    }
+
+    case WM_TIMER:
+        if (wParam == IDT_HIST_TICK && state) {
+            RECT rc;
+            hist_refresh_series(hwnd, state->rollup);
+            hist_plot_rect(hwnd, &rc);
+            InvalidateRect(hwnd, &rc, FALSE);
+        }
+        return 0;
+
+    case WM_SIZE: {
+        RECT rc;
+        hist_plot_rect(hwnd, &rc);
+        InvalidateRect(hwnd, &rc, FALSE);
+        return 0;
+    }
+
+    case WM_CLOSE:
+        DestroyWindow(hwnd);
+        return 0;
+
+    case WM_DESTROY:
+        KillTimer(hwnd, IDT_HIST_TICK);
+        if (state && state->hHistoryWnd == hwnd) state->hHistoryWnd = NULL;
+        return 0;
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+/* ── Register the class once ──────────────────────────────── */
+
+static void ensure_history_class(HINSTANCE hInst)
+{
+    if (g_historyClassRegistered) return;
+
+    WNDCLASSEX wc;
+    ZeroMemory(&wc, sizeof(wc));
+    wc.cbSize        = sizeof(WNDCLASSEX);
+    wc.style         = CS_HREDRAW | CS_VREDRAW;
+    wc.lpfnWndProc   = HistoryWndProc;
+    wc.hInstance     = hInst;
+    wc.hIcon         = LoadIcon(NULL, IDI_APPLICATION);
+    wc.hCursor       = LoadCursor(NULL, IDC_ARROW);
+    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+    wc.lpszClassName = HISTORY_CLASS_NAME;
+    wc.hIconSm       = LoadIcon(NULL, IDI_APPLICATION);
+
+    if (RegisterClassEx(&wc) ||
+        GetLastError() == ERROR_CLASS_ALREADY_EXISTS) {
+        g_historyClassRegistered = TRUE;
+    }
+}
+
+HWND ShowHistoryWindow(HINSTANCE hInst, HWND hOwner, AppState *state)
+{
+    if (!state) return NULL;
+    g_appState = state;
+
+    if (state->hHistoryWnd) {
+        if (IsIconic(state->hHistoryWnd)) ShowWindow(state->hHistoryWnd, SW_RESTORE);
+        SetForegroundWindow(state->hHistoryWnd);
+        return state->hHistoryWnd;
+    }
+
+    ensure_history_class(hInst);
+
+    HWND hwnd = CreateWindowEx(
+        0, HISTORY_CLASS_NAME, "History  (rollups)",
+        WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, CW_USEDEFAULT,
+        760, 420,
+        hOwner, NULL, hInst, NULL);
+    if (!hwnd) return NULL;
+
+    state->hHistoryWnd = hwnd;
+    ShowWindow(hwnd, SW_SHOW);
+    UpdateWindow(hwnd);
+    return hwnd;
+}
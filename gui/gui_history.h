@@ -0,0 +1,33 @@
+/**
+ * @file gui_history.h
+ * @brief History window: the rollup series of the stream as charts.
+ *
+ * Plots one series of AppState.rollup (rollup.h) -- bytes, frames in all
+ * or per type, satellites or CNR per GNSS, age of corrections -- over
+ * the last hour at 1 s, the last day at 1 min or the last 30 days at
+ * 15 min.  Counters are drawn as a rate per second, gauges as their
+ * mean with the minimum and maximum of each bucket.  "Copy JSON" puts
+ * every series at the chosen resolution on the clipboard, in the format
+ * of `GET /rollup` (metrics_http.h).  Refreshed every second.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_HISTORY_H
+#define GUI_HISTORY_H
+
+#include "gui_state.h"
+
+/**
+ * @brief Open the History window, or bring it to the front if it is open.
+ *
+ * @param hInst   Application instance.
+ * @param hOwner  Owner window (the main window).
+ * @param state   AppState; the window reads state->rollup on a timer.
+ * @return Window handle on success, NULL on failure.
+ */
+HWND ShowHistoryWindow(HINSTANCE hInst, HWND hOwner, AppState *state);
+
+#endif /* GUI_HISTORY_H */
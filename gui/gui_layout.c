@@ -258,7 +258,7 @@ void CreateControls(HWND hwnd, AppState *state)
     y += bh + 14;
     state->hLvMountpoints = CreateWindowEx(WS_EX_CLIENTEDGE,
         WC_LISTVIEW, "",
-        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SHOWSELALWAYS,
+        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
         m, y, 700, 140, hwnd, (HMENU)(intptr_t)IDC_LV_MOUNTPOINTS, hInst, NULL);
     ListView_SetExtendedListViewStyle(state->hLvMountpoints,
         LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
@@ -275,7 +275,7 @@ void CreateControls(HWND hwnd, AppState *state)
     LvAddColumn(state->hLvMountpoints, 9,  "Lon",            60);
     LvAddColumn(state->hLvMountpoints, 10, "Distance (km)",  90);
 
-    /* ── Tab control (Log / Message Stats / Satellites) ─────── */
+    /* ── Tab control (Log / Message Stats / Satellites / ...) ─── */
     y += 145;
     state->hTabOutput = CreateWindowEx(0,
         WC_TABCONTROL, "",
@@ -289,6 +289,8 @@ void CreateControls(HWND hwnd, AppState *state)
     tci.pszText = "Log";       TabCtrl_InsertItem(state->hTabOutput, 0, &tci);
     tci.pszText = "Msg Stats"; TabCtrl_InsertItem(state->hTabOutput, 1, &tci);
     tci.pszText = "Satellites"; TabCtrl_InsertItem(state->hTabOutput, 2, &tci);
+    tci.pszText = "Performance"; TabCtrl_InsertItem(state->hTabOutput, 3, &tci);
+    tci.pszText = "Signal Quality"; TabCtrl_InsertItem(state->hTabOutput, 4, &tci);
 
     /* Child controls inside the tab area */
     RECT tabRC;
@@ -315,7 +317,7 @@ void CreateControls(HWND hwnd, AppState *state)
     /* Message Stats ListView (hidden by default — shown on tab switch) */
     state->hLvMsgStats = CreateWindowEx(WS_EX_CLIENTEDGE,
         WC_LISTVIEW, "",
-        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS,
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
         tx, ty, tw, th, hwnd, (HMENU)(intptr_t)IDC_LV_MSG_STATS, hInst, NULL);
     ListView_SetExtendedListViewStyle(state->hLvMsgStats,
         LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
@@ -325,19 +327,70 @@ void CreateControls(HWND hwnd, AppState *state)
     LvAddColumn(state->hLvMsgStats, 2, "Min dt (s)",   100);
     LvAddColumn(state->hLvMsgStats, 3, "Max dt (s)",   100);
     LvAddColumn(state->hLvMsgStats, 4, "Avg dt (s)",   100);
-    LvAddColumn(state->hLvMsgStats, 5, "Description",  220);
+    LvAddColumn(state->hLvMsgStats, 5, "p50 (s)",       70);
+    LvAddColumn(state->hLvMsgStats, 6, "p95 (s)",       70);
+    LvAddColumn(state->hLvMsgStats, 7, "p99 (s)",       70);
+    LvAddColumn(state->hLvMsgStats, 8, "p99.9 (s)",     70);
+    LvAddColumn(state->hLvMsgStats, 9, "Age p50 (s)",   90);
+    LvAddColumn(state->hLvMsgStats, 10, "Bytes",        80);
+    LvAddColumn(state->hLvMsgStats, 11, "B/s 1 s",      70);
+    LvAddColumn(state->hLvMsgStats, 12, "B/s 10 s",     70);
+    LvAddColumn(state->hLvMsgStats, 13, "B/s 60 s",     70);
+    LvAddColumn(state->hLvMsgStats, 14, "Peak B/s",     70);
+    LvAddColumn(state->hLvMsgStats, 15, "Burst (B)",    70);
+    LvAddColumn(state->hLvMsgStats, 16, "Description", 220);
 
     /* Satellites ListView (hidden by default) */
     state->hLvSatellites = CreateWindowEx(WS_EX_CLIENTEDGE,
         WC_LISTVIEW, "",
-        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS,
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
         tx, ty, tw, th, hwnd, (HMENU)(intptr_t)IDC_LV_SATELLITES, hInst, NULL);
     ListView_SetExtendedListViewStyle(state->hLvSatellites,
         LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
 
     LvAddColumn(state->hLvSatellites, 0, "GNSS",        90);
     LvAddColumn(state->hLvSatellites, 1, "Sats Seen",   80);
-    LvAddColumn(state->hLvSatellites, 2, "Satellites",  400);
+    LvAddColumn(state->hLvSatellites, 2, "In View",     70);
+    LvAddColumn(state->hLvSatellites, 3, "Dropouts",    70);
+    LvAddColumn(state->hLvSatellites, 4, "Satellites",  400);
+
+    /* Performance ListView (hidden by default): one row per probe stage */
+    state->hLvPerf = CreateWindowEx(WS_EX_CLIENTEDGE,
+        WC_LISTVIEW, "",
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
+        tx, ty, tw, th, hwnd, (HMENU)(intptr_t)IDC_LV_PERF, hInst, NULL);
+    ListView_SetExtendedListViewStyle(state->hLvPerf,
+        LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+    LvAddColumn(state->hLvPerf, 0, "Stage",        130);
+    LvAddColumn(state->hLvPerf, 1, "Count",        80);
+    LvAddColumn(state->hLvPerf, 2, "Mean (us)",    80);
+    LvAddColumn(state->hLvPerf, 3, "p50 (us)",     80);
+    LvAddColumn(state->hLvPerf, 4, "p90 (us)",     80);
+    LvAddColumn(state->hLvPerf, 5, "p99 (us)",     80);
+    LvAddColumn(state->hLvPerf, 6, "p99.9 (us)",   80);
+    LvAddColumn(state->hLvPerf, 7, "Max (us)",     80);
+    ListView_SetItemCountEx(state->hLvPerf, PERF_STAGE_COUNT + UI_LAG_ROWS, LVSICF_NOSCROLL);
+
+    /* Signal Quality ListView (hidden by default): one row per station,
+     * GNSS and signal, in first-seen order */
+    state->hLvQuality = CreateWindowEx(WS_EX_CLIENTEDGE,
+        WC_LISTVIEW, "",
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
+        tx, ty, tw, th, hwnd, (HMENU)(intptr_t)IDC_LV_QUALITY, hInst, NULL);
+    ListView_SetExtendedListViewStyle(state->hLvQuality,
+        LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+    LvAddColumn(state->hLvQuality, 0, "Station",      60);
+    LvAddColumn(state->hLvQuality, 1, "GNSS",         70);
+    LvAddColumn(state->hLvQuality, 2, "Signal",       55);
+    LvAddColumn(state->hLvQuality, 3, "Obs",          70);
+    LvAddColumn(state->hLvQuality, 4, "Tracks",       55);
+    LvAddColumn(state->hLvQuality, 5, "Slips",        55);
+    LvAddColumn(state->hLvQuality, 6, "Gaps",         55);
+    LvAddColumn(state->hLvQuality, 7, "Missed",       60);
+    LvAddColumn(state->hLvQuality, 8, "CNR Drops",    70);
+    LvAddColumn(state->hLvQuality, 9, "Half-cycle",   70);
 
     /* ── Status bar ─────────────────────────────────────────── */
     state->hStatusBar = CreateWindowEx(0,
@@ -419,6 +472,8 @@ void ResizeControls(HWND hwnd, AppState *state, int width, int height)
     MoveWindow(state->hEditLog,      tx, ty, tw, th, TRUE);
     MoveWindow(state->hLvMsgStats,   tx, ty, tw, th, TRUE);
     MoveWindow(state->hLvSatellites, tx, ty, tw, th, TRUE);
+    MoveWindow(state->hLvPerf,       tx, ty, tw, th, TRUE);
+    MoveWindow(state->hLvQuality,    tx, ty, tw, th, TRUE);
 
     /* Update status bar parts proportionally (4 parts: rate, format,
      * bytes, VRS distance). */
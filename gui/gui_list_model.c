@@ -0,0 +1,153 @@
+/**
+ * @file gui_list_model.c
+ * @brief Last rendered text of the cells of an owner-data ListView.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_list_model.h"
+
+#include <commctrl.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *cell_at(const GuiListModel *m, int row, int col)
+{
+    return m->text + ((size_t)row * m->cols + col) * m->cellLen;
+}
+
+static void next_gen(GuiListModel *m)
+{
+    if (++m->gen == 0) m->gen = 1;
+}
+
+/* Room for @p rows; FALSE if there is none, and cells are then
+ * formatted uncached. */
+static BOOL model_reserve(GuiListModel *m, int rows)
+{
+    size_t rowLen = (size_t)m->cols * m->cellLen;
+    if (!m->scratch && !(m->scratch = (char *)malloc(rowLen)))
+        return FALSE;
+    if (rows <= m->rowsCap)
+        return TRUE;
+
+    int cap = m->rowsCap ? m->rowsCap : 16;
+    while (cap < rows) cap *= 2;
+    char *t = (char *)realloc(m->text, (size_t)cap * rowLen);
+    if (!t) return FALSE;
+    m->text = t;
+    uint32_t *g = (uint32_t *)realloc(m->rowGen, (size_t)cap * sizeof(*g));
+    if (!g) return FALSE;
+    memset(g + m->rowsCap, 0, (size_t)(cap - m->rowsCap) * sizeof(*g));
+    m->rowGen  = g;
+    m->rowsCap = cap;
+    return TRUE;
+}
+
+static void format_row(const GuiListModel *m, int row, char *dst)
+{
+    for (int c = 0; c < m->cols; c++)
+        m->cell(m->ctx, row, c, dst + (size_t)c * m->cellLen, m->cellLen);
+}
+
+void gui_list_model_init(GuiListModel *m, HWND hwnd, int cols, int cellLen,
+                         GuiListCellFn cell, const void *ctx)
+{
+    memset(m, 0, sizeof(*m));
+    m->hwnd    = hwnd;
+    m->cols    = cols;
+    m->cellLen = cellLen;
+    m->cell    = cell;
+    m->ctx     = ctx;
+    m->gen     = 1;
+}
+
+void gui_list_model_free(GuiListModel *m)
+{
+    free(m->text);
+    free(m->rowGen);
+    free(m->scratch);
+    memset(m, 0, sizeof(*m));
+}
+
+void gui_list_model_reset(GuiListModel *m)
+{
+    m->rows = 0;
+    next_gen(m);
+}
+
+void gui_list_model_invalidate(GuiListModel *m)
+{
+    next_gen(m);
+}
+
+void gui_list_model_text(GuiListModel *m, int row, int col,
+                         char *out, int outLen)
+{
+    if (outLen <= 0) return;
+    out[0] = '\0';
+    if (!m->cell || row < 0 || col < 0 || col >= m->cols) return;
+    if (row >= m->rowsCap) {
+        m->cell(m->ctx, row, col, out, outLen);
+        return;
+    }
+    if (m->rowGen[row] != m->gen) {
+        format_row(m, row, cell_at(m, row, 0));
+        m->rowGen[row] = m->gen;
+    }
+    lstrcpyn(out, cell_at(m, row, col), outLen);
+}
+
+void gui_list_model_update(GuiListModel *m, int rows)
+{
+    if (!m->hwnd || !m->cell) return;
+    BOOL cached = model_reserve(m, rows);
+
+    /* A new message type or GNSS: the one repaint of the whole list */
+    if (rows != m->rows) {
+        SendMessage(m->hwnd, WM_SETREDRAW, FALSE, 0);
+        ListView_SetItemCountEx(m->hwnd, rows,
+                                LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+        SendMessage(m->hwnd, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(m->hwnd, NULL, TRUE);
+        m->rows = rows;
+    }
+
+    uint32_t shown = m->gen;    /* rows painted since the last tick carry it */
+    next_gen(m);
+    if (rows <= 0 || !IsWindowVisible(m->hwnd))
+        return;
+
+    int top = ListView_GetTopIndex(m->hwnd);
+    int end = top + ListView_GetCountPerPage(m->hwnd) + 1;
+    if (top < 0) top = 0;
+    if (end > rows) end = rows;
+    if (!cached) {
+        if (top < end) ListView_RedrawItems(m->hwnd, top, end - 1);
+        return;
+    }
+
+    size_t rowLen = (size_t)m->cols * m->cellLen;
+    for (int r = top; r < end; r++) {
+        char *old = cell_at(m, r, 0);
+        format_row(m, r, m->scratch);
+        if (m->rowGen[r] != shown) {
+            /* Not painted from the cache yet: the whole row */
+            memcpy(old, m->scratch, rowLen);
+            ListView_RedrawItems(m->hwnd, r, r);
+        } else {
+            for (int c = 0; c < m->cols; c++) {
+                char *was = old + (size_t)c * m->cellLen;
+                const char *now = m->scratch + (size_t)c * m->cellLen;
+                if (strcmp(was, now) == 0) continue;
+                memcpy(was, now, (size_t)m->cellLen);
+                RECT rc;
+                if (ListView_GetSubItemRect(m->hwnd, r, c, LVIR_LABEL, &rc))
+                    InvalidateRect(m->hwnd, &rc, TRUE);
+            }
+        }
+        m->rowGen[r] = m->gen;
+    }
+}
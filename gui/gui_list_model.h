@@ -0,0 +1,84 @@
+/**
+ * @file gui_list_model.h
+ * @brief Last rendered text of the cells of an owner-data ListView.
+ *
+ * The Msg Stats and Satellites lists used to repaint every row whose
+ * statistics moved, and every repaint formatted all of the row's cells
+ * again in LVN_GETDISPINFO -- once per message type or GNSS and
+ * snapshot, whether the text had changed or not, and more of them the
+ * more types and satellites a stream carries.
+ *
+ * A GuiListModel keeps the text each cell was last rendered with.  Once
+ * per applied statistics snapshot gui_list_model_update() formats the
+ * rows on screen only, compares them with that text and invalidates the
+ * cells that differ; Windows merges those into one WM_PAINT, which asks
+ * LVN_GETDISPINFO for the cached text (gui_list_model_text()).  The work
+ * per tick is bounded by the rows on screen, not by the rows the list
+ * holds, and a list on a hidden tab costs nothing until it is shown.
+ *
+ * The cache is valid for one generation: every update starts a new one,
+ * so rows that were not on screen are formatted again when they scroll
+ * into view.  A change of the row count goes to the ListView between
+ * WM_SETREDRAW FALSE and TRUE.  Without memory for the cache the model
+ * formats every cell when it is asked for, as before.
+ *
+ * UI thread only.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_LIST_MODEL_H
+#define GUI_LIST_MODEL_H
+
+#define _WIN32_WINNT 0x0601
+#include <windows.h>
+#include <stdint.h>
+
+/** @brief Writes the text of cell (@p row, @p col) to @p out. */
+typedef void (*GuiListCellFn)(const void *ctx, int row, int col,
+                              char *out, int outLen);
+
+/**
+ * @struct GuiListModel
+ * @brief Cell cache of one owner-data ListView.  All zero is detached.
+ */
+typedef struct {
+    HWND          hwnd;
+    GuiListCellFn cell;
+    const void   *ctx;
+    int           cols;
+    int           cellLen;      /**< bytes per cell, NUL included */
+    int           rows;         /**< item count last given to the ListView */
+    int           rowsCap;      /**< rows text[] and rowGen[] hold */
+    char         *text;         /**< rowsCap * cols cells, row-major */
+    uint32_t     *rowGen;       /**< generation a row was formatted in; 0 = never */
+    uint32_t      gen;          /**< current generation, never 0 */
+    char         *scratch;      /**< one row, formatted for comparison */
+} GuiListModel;
+
+/** @brief Attach @p m to the ListView @p hwnd with @p cols columns. */
+void gui_list_model_init(GuiListModel *m, HWND hwnd, int cols, int cellLen,
+                         GuiListCellFn cell, const void *ctx);
+
+/** @brief Free the cache; @p m is detached. */
+void gui_list_model_free(GuiListModel *m);
+
+/** @brief The ListView was emptied: no rows, nothing cached. */
+void gui_list_model_reset(GuiListModel *m);
+
+/** @brief Rows changed places (a sort): the cached text is stale. */
+void gui_list_model_invalidate(GuiListModel *m);
+
+/** @brief LVN_GETDISPINFO: the text of a cell, formatted only if stale. */
+void gui_list_model_text(GuiListModel *m, int row, int col,
+                         char *out, int outLen);
+
+/**
+ * @brief The repaint tick: give the ListView @p rows items, format the
+ *        rows on screen and invalidate the cells whose text changed.
+ */
+void gui_list_model_update(GuiListModel *m, int rows);
+
+#endif /* GUI_LIST_MODEL_H */
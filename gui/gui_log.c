@@ -1,10 +1,19 @@
 /**
  * @file gui_log.c
- * @brief stdout/stderr redirection to GUI log panel via pipe.
+ * @brief Worker log rings and stdout/stderr redirection to the GUI log panel.
  *
- * Before a worker thread starts, stdout and stderr are redirected to
- * a pipe. A WM_TIMER callback reads from the pipe and appends text
- * to the log EDIT control. Restored when the worker finishes.
+ * The GUI workers log through WorkerLog() into a lock-free ring of
+ * their own (GuiLogRing, one producer each), rate limited per ring; the
+ * running message-number trace is collected into lines first.  Shared
+ * code that still prints (ntrip_handler.c, ...) reaches the panel the
+ * old way: before a worker thread starts, stdout and stderr are
+ * redirected to a pipe, restored when the worker finishes.
+ *
+ * LogPumpTimer() (WM_TIMER and every UI batch) drains the pipe and the
+ * rings, merging the rings in sequence order, and appends each batch
+ * to the log EDIT control in one go.  The control is kept below
+ * GUI_LOG_MAX_CHARS by dropping the oldest lines, so a long session
+ * does not grow it without bound.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -15,9 +24,264 @@
 #include "gui_state.h"
 
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 #include <io.h>
 #include <fcntl.h>
 
+/* ── Log panel ────────────────────────────────────────────── */
+
+/**
+ * @brief Append text to the log EDIT control, dropping the oldest lines
+ *        first if the control would grow past GUI_LOG_MAX_CHARS.
+ */
+void LogAppend(HWND hLog, const char *text)
+{
+    int len = GetWindowTextLength(hLog);
+    int add = (int)strlen(text);
+    if (len + add > GUI_LOG_MAX_CHARS) {
+        /* Cut down to 3/4 of the limit at a line start, so the trim
+         * happens once per quarter of the limit, not on every append */
+        int cut  = len + add - GUI_LOG_MAX_CHARS / 4 * 3;
+        if (cut > len) cut = len;
+        int line = (int)SendMessage(hLog, EM_LINEFROMCHAR, (WPARAM)cut, 0);
+        int from = (int)SendMessage(hLog, EM_LINEINDEX, (WPARAM)(line + 1), 0);
+        if (from < cut || from > len) from = cut;
+        SendMessage(hLog, EM_SETSEL, 0, (LPARAM)from);
+        SendMessage(hLog, EM_REPLACESEL, FALSE, (LPARAM)"");
+        len = GetWindowTextLength(hLog);
+    }
+    SendMessage(hLog, EM_SETSEL, (WPARAM)len, (LPARAM)len);
+    SendMessage(hLog, EM_REPLACESEL, FALSE, (LPARAM)text);
+}
+
+/* ── Worker log rings ─────────────────────────────────────── */
+
+/* Ring of the calling worker thread, set by WorkerLogBind(). */
+static __thread AppState   *t_log_state;
+static __thread GuiLogRing *t_log_ring;
+
+/**
+ * @brief Allocate the per-worker log rings (once, at startup).
+ * @return false if memory runs out.
+ */
+bool LogRingsInit(AppState *state)
+{
+    for (int i = 0; i < GUI_LOG_SRC_COUNT; i++) {
+        if (!gui_fq_init(&state->logRings[i].q, GUI_LOG_RING_SIZE)) {
+            while (--i >= 0) gui_fq_free(&state->logRings[i].q);
+            return false;
+        }
+    }
+    state->logRingsInit = TRUE;
+    return true;
+}
+
+/** @brief Free the log rings.  No worker may be running. */
+void LogRingsFree(AppState *state)
+{
+    if (!state->logRingsInit) return;
+    for (int i = 0; i < GUI_LOG_SRC_COUNT; i++)
+        gui_fq_free(&state->logRings[i].q);
+    state->logRingsInit = FALSE;
+}
+
+/* Producer: one record, the sequence number then the text. */
+static void log_push(GuiLogRing *r, GuiLogLevel level, const char *text, int len)
+{
+    unsigned char rec[sizeof(LONG) + 1024];
+    if (len > 1024) len = 1024;
+    LONG seq = InterlockedIncrement(&t_log_state->logSeq);
+    memcpy(rec, &seq, sizeof(seq));
+    memcpy(rec + sizeof(seq), text, (size_t)len);
+    gui_fq_push(&r->q, rec, (int)sizeof(seq) + len, (int)level);
+}
+
+/* Rate limit: GUI_LOG_RATE_LINES per second; warnings and errors always
+ * pass.  The count of dropped lines goes out ahead of the next line that
+ * passes. */
+static bool log_admit(GuiLogRing *r, GuiLogLevel level)
+{
+    DWORD now = GetTickCount();
+    if (now - r->rate_tick >= 1000) {
+        r->rate_tick  = now;
+        r->rate_lines = 0;
+    }
+    if (level < GUI_LOG_WARN) {
+        if (r->rate_lines >= GUI_LOG_RATE_LINES) {
+            r->suppressed++;
+            return false;
+        }
+        r->rate_lines++;
+    }
+    if (r->suppressed > 0) {
+        char m[96];
+        int n = snprintf(m, sizeof(m),
+                         "[WARN] %ld log lines dropped (over %d lines/s)\n",
+                         r->suppressed, GUI_LOG_RATE_LINES);
+        r->suppressed = 0;
+        log_push(r, GUI_LOG_WARN, m, n);
+    }
+    return true;
+}
+
+/* Push the pending message-number trace as one line. */
+static void log_flush_trace(GuiLogRing *r)
+{
+    if (r->trace_len == 0) return;
+    r->trace[r->trace_len++] = '\n';
+    if (log_admit(r, GUI_LOG_TRACE))
+        log_push(r, GUI_LOG_TRACE, r->trace, r->trace_len);
+    r->trace_len = 0;
+}
+
+/**
+ * @brief Send the calling thread's log lines to ring @p src.
+ *
+ * Called first thing by each worker thread; without it (or before
+ * LogRingsInit()) WorkerLog() prints to stdout as before.
+ */
+void WorkerLogBind(AppState *state, int src)
+{
+    t_log_state = NULL;
+    t_log_ring  = NULL;
+    if (!state->logRingsInit || src < 0 || src >= GUI_LOG_SRC_COUNT) return;
+
+    GuiLogRing *r = &state->logRings[src];
+    r->rate_tick  = GetTickCount();
+    r->rate_lines = 0;
+    r->suppressed = 0;
+    r->trace_len  = 0;
+    t_log_state = state;
+    t_log_ring  = r;
+}
+
+/** @brief Flush the thread's pending trace and stop using its ring. */
+void WorkerLogUnbind(void)
+{
+    GuiLogRing *r = t_log_ring;
+    if (r) {
+        log_flush_trace(r);
+        if (r->suppressed > 0) log_admit(r, GUI_LOG_WARN);
+    }
+    t_log_state = NULL;
+    t_log_ring  = NULL;
+}
+
+/**
+ * @brief printf-style log line from a worker thread.
+ *
+ * Formats into a stack buffer and queues it: no lock, no allocation, no
+ * flush.  Lines over the rate limit are dropped and counted.
+ */
+void WorkerLog(GuiLogLevel level, const char *fmt, ...)
+{
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return;
+    if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
+
+    GuiLogRing *r = t_log_ring;
+    if (!r) {
+        fputs(buf, stdout);
+        fflush(stdout);
+        return;
+    }
+    log_flush_trace(r);     /* keep the trace ahead of this line */
+    if (log_admit(r, level))
+        log_push(r, level, buf, n);
+}
+
+/**
+ * @brief Add a message number to the running trace ("1005 1077 1087 ...").
+ *
+ * The numbers are collected into a line, pushed when it is full or
+ * GUI_LOG_TRACE_MS after its first number.
+ */
+void WorkerLogTrace(int msg_type)
+{
+    GuiLogRing *r = t_log_ring;
+    if (!r) {
+        printf("%d ", msg_type);
+        return;
+    }
+    if ((unsigned)msg_type > 9999) return;
+
+    DWORD now = GetTickCount();
+    if (r->trace_len == 0) r->trace_tick = now;
+
+    char num[6];
+    int  n = 0;
+    do {
+        num[n++] = (char)('0' + msg_type % 10);
+        msg_type /= 10;
+    } while (msg_type);
+    while (n > 0) r->trace[r->trace_len++] = num[--n];
+    r->trace[r->trace_len++] = ' ';
+
+    if (r->trace_len > (int)sizeof(r->trace) - 8 ||
+        now - r->trace_tick >= GUI_LOG_TRACE_MS)
+        log_flush_trace(r);
+}
+
+/* UI side: merge every ring in sequence order into the log panel, one
+ * EDIT update per (up to) 16 kB of text. */
+static void LogDrainRings(AppState *state)
+{
+    if (!state->logRingsInit) return;
+
+    char out[16384];
+    int  o = 0;
+    for (;;) {
+        int best = -1;
+        LONG best_seq = 0;
+        const unsigned char *best_p = NULL;
+        int best_len = 0;
+        for (int i = 0; i < GUI_LOG_SRC_COUNT; i++) {
+            int len;
+            const unsigned char *p = gui_fq_peek(&state->logRings[i].q, &len, NULL);
+            if (!p) continue;
+            LONG seq = 0;
+            if (len >= (int)sizeof(seq)) memcpy(&seq, p, sizeof(seq));
+            if (best < 0 || (LONG)(seq - best_seq) < 0) {
+                best = i; best_seq = seq; best_p = p; best_len = len;
+            }
+        }
+        if (best < 0) break;
+
+        /* \n -> \r\n for the EDIT control (worst case doubles) */
+        int tlen = best_len - (int)sizeof(LONG);
+        if (tlen < 0) tlen = 0;
+        if (o + 2 * tlen + 1 > (int)sizeof(out)) {
+            out[o] = '\0';
+            LogAppend(state->hEditLog, out);
+            o = 0;
+        }
+        const char *t = (const char *)best_p + sizeof(LONG);
+        for (int k = 0; k < tlen && o < (int)sizeof(out) - 2; k++) {
+            if (t[k] == '\n' && (k == 0 || t[k - 1] != '\r'))
+                out[o++] = '\r';
+            out[o++] = t[k];
+        }
+        gui_fq_pop(&state->logRings[best].q);
+    }
+
+    for (int i = 0; i < GUI_LOG_SRC_COUNT; i++) {
+        LONG lost = InterlockedExchange(&state->logRings[i].q.dropped, 0);
+        if (lost > 0 && o + 80 < (int)sizeof(out))
+            o += snprintf(out + o, sizeof(out) - o,
+                          "[WARN] %ld log lines lost (log ring full)\r\n",
+                          (long)lost);
+    }
+    if (o > 0) {
+        out[o] = '\0';
+        LogAppend(state->hEditLog, out);
+    }
+}
+
 /**
  * @brief Redirect stdout and stderr to a pipe for GUI capture.
  *
@@ -81,25 +345,28 @@ void LogRedirectStop(AppState *state)
             if (n <= 0) break;
             buf[n] = '\0';
 
-            /* Append to log */
-            int len = GetWindowTextLength(state->hEditLog);
-            SendMessage(state->hEditLog, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-            SendMessage(state->hEditLog, EM_REPLACESEL, FALSE, (LPARAM)buf);
+            LogAppend(state->hEditLog, buf);
         }
 
         _close(state->pipeFds[0]);
         state->pipeFds[0] = -1;
     }
+
+    /* And whatever the workers logged last */
+    LogDrainRings(state);
 }
 
 /**
- * @brief Timer callback: read available data from the pipe and append to log.
+ * @brief Timer callback: read available data from the pipe and the worker
+ *        log rings and append it to the log.
  *
- * Called from WM_TIMER with IDT_LOG_PUMP. Non-blocking: uses PeekNamedPipe
- * to check for available data before reading.
+ * Called from WM_TIMER with IDT_LOG_PUMP and after every UI batch.
+ * Non-blocking: uses PeekNamedPipe to check for available data before
+ * reading.
  */
 void LogPumpTimer(AppState *state)
 {
+    LogDrainRings(state);
     if (state->pipeFds[0] < 0) return;
 
     HANDLE hRead = (HANDLE)_get_osfhandle(state->pipeFds[0]);
@@ -112,10 +379,7 @@ void LogPumpTimer(AppState *state)
         if (n <= 0) break;
         buf[n] = '\0';
 
-        /* Append to log edit control */
-        int len = GetWindowTextLength(state->hEditLog);
-        SendMessage(state->hEditLog, EM_SETSEL, (WPARAM)len, (LPARAM)len);
-        SendMessage(state->hEditLog, EM_REPLACESEL, FALSE, (LPARAM)buf);
+        LogAppend(state->hEditLog, buf);
 
         /* Re-check for more data */
         avail = 0;
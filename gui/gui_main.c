@@ -28,6 +28,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     icex.dwICC  = ICC_LISTVIEW_CLASSES | ICC_TAB_CLASSES | ICC_BAR_CLASSES;
     InitCommonControlsEx(&icex);
 
+    /* The UI thread decodes ephemeris frames only to show them; the
+     * store is written by the stream's workers (gui_thread.c). */
+    rtcm_set_eph_store(false);
+
     /* ── Initialize Winsock ───────────────────────────────────── */
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -49,6 +53,43 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     InitializeCriticalSection(&state->csRtcmDump);
     state->csRtcmDumpInit = TRUE;
 
+    /* Worker -> UI update channel (decoded frames, sky updates). */
+    if (!gui_fq_init(&state->uiQueue, UI_QUEUE_SIZE)) {
+        MessageBox(NULL, "Out of memory.", APP_TITLE, MB_ICONERROR | MB_OK);
+        DeleteCriticalSection(&state->csRtcmDump);
+        free(state);
+        WSACleanup();
+        return 1;
+    }
+    state->uiQueueInit = TRUE;
+
+    /* Worker -> UI statistics snapshot. */
+    if (!stats_snapshot_init(&state->statsSnap, sizeof(GuiStats))) {
+        MessageBox(NULL, "Out of memory.", APP_TITLE, MB_ICONERROR | MB_OK);
+        gui_fq_free(&state->uiQueue);
+        DeleteCriticalSection(&state->csRtcmDump);
+        free(state);
+        WSACleanup();
+        return 1;
+    }
+
+    /* History window store; without it the window just stays empty. */
+    state->rollup = rollup_store_new();
+
+    /* Stage latency probes feed the Performance tab. */
+    perf_enable(true);
+
+    /* Worker -> UI log lines. */
+    if (!LogRingsInit(state)) {
+        MessageBox(NULL, "Out of memory.", APP_TITLE, MB_ICONERROR | MB_OK);
+        stats_snapshot_free(&state->statsSnap);
+        gui_fq_free(&state->uiQueue);
+        DeleteCriticalSection(&state->csRtcmDump);
+        free(state);
+        WSACleanup();
+        return 1;
+    }
+
     /* ── Register window class ────────────────────────────────── */
     WNDCLASSEX wc;
     ZeroMemory(&wc, sizeof(wc));
@@ -111,12 +152,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     if (state->csRtcmDumpInit) {
         EnterCriticalSection(&state->csRtcmDump);
         if (state->hRtcmDump) {
-            fclose(state->hRtcmDump);
+            rtcm_recorder_close(state->hRtcmDump, NULL);
             state->hRtcmDump = NULL;
         }
         LeaveCriticalSection(&state->csRtcmDump);
         DeleteCriticalSection(&state->csRtcmDump);
     }
+    if (state->uiQueueInit) gui_fq_free(&state->uiQueue);
+    sky_track_arena_reset(&state->skyState.tracks);
+    cnr_history_free(&state->cnrHistory);
+    obs_quality_free(&state->obsQuality);
+    stats_snapshot_free(&state->statsSnap);
+    rollup_store_free(state->rollup);
+    LogRingsFree(state);
     free(state);
     WSACleanup();
 
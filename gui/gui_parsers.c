@@ -2,8 +2,8 @@
  * @file gui_parsers.c
  * @brief Data parsers for populating GUI list views.
  *
- * Converts raw NTRIP sourcetable strings and analysis result structures
- * into Win32 ListView rows.
+ * Converts raw NTRIP sourcetable strings into the table behind the
+ * owner-data mountpoint ListView, and sorts it.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -16,49 +16,91 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
+/* Append n bytes of s plus a NUL to the pool; returns the offset of the
+ * copy, or (unsigned)-1 if the pool cannot grow. */
+static unsigned pool_add(GuiMountTable *t, const char *s, size_t n)
+{
+    if (t->pool_len + n + 1 > t->pool_cap) {
+        size_t cap = t->pool_cap ? t->pool_cap : 4096;
+        while (t->pool_len + n + 1 > cap) cap *= 2;
+        char *np = (char *)realloc(t->pool, cap);
+        if (!np) return (unsigned)-1;
+        t->pool     = np;
+        t->pool_cap = cap;
+    }
+    unsigned off = (unsigned)t->pool_len;
+    memcpy(t->pool + off, s, n);
+    t->pool[off + n] = '\0';
+    t->pool_len += n + 1;
+    return off;
+}
 
 /**
- * @brief Compute the Haversine distance in kilometres between two WGS-84 points.
+ * @brief Release the rows, text and sort orders of a mountpoint table.
  */
-static double haversine_km(double lat1, double lon1, double lat2, double lon2)
+void MountTableFree(GuiMountTable *table)
 {
-    const double R = 6371.0;  /* Earth mean radius in km */
-    double dLat = (lat2 - lat1) * M_PI / 180.0;
-    double dLon = (lon2 - lon1) * M_PI / 180.0;
-    double rLat1 = lat1 * M_PI / 180.0;
-    double rLat2 = lat2 * M_PI / 180.0;
+    if (!table) return;
+    free(table->pool);
+    free(table->rows);
+    free(table->order);
+    for (int c = 0; c < GUI_MOUNT_COLS; c++)
+        free(table->sorted[c]);
+    geo_index_free(table->geo);
+    memset(table, 0, sizeof(*table));
+    table->sortCol = -1;
+}
 
-    double a = sin(dLat / 2.0) * sin(dLat / 2.0) +
-               cos(rLat1) * cos(rLat2) *
-               sin(dLon / 2.0) * sin(dLon / 2.0);
-    double c = 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
-    return R * c;
+/**
+ * @brief Empty the mountpoint table before rows are added with
+ *        MountTableAppend().
+ *
+ * @param userLat   User latitude from config (for distance calculation).
+ * @param userLon   User longitude from config (for distance calculation).
+ */
+void MountTableBegin(GuiMountTable *table, double userLat, double userLon)
+{
+    if (!table) return;
+    MountTableFree(table);
+    table->originLat = userLat;
+    table->originLon = userLon;
+}
+
+/* Room for one more row in rows[] and order[]. */
+static BOOL reserve_row(GuiMountTable *t)
+{
+    if (t->count < t->cap) return TRUE;
+    int cap = t->cap ? t->cap * 2 : 256;
+    GuiMountRow *nr = (GuiMountRow *)realloc(t->rows, cap * sizeof(*nr));
+    if (!nr) return FALSE;
+    t->rows = nr;
+    int *no = (int *)realloc(t->order, cap * sizeof(int));
+    if (!no) return FALSE;
+    t->order = no;
+    t->cap   = cap;
+    return TRUE;
 }
 
 /**
- * @brief Parse a raw NTRIP sourcetable and populate a ListView with STR entries.
+ * @brief Add the STR lines of @p text to the mountpoint table.
  *
  * Each STR line has semicolon-separated fields:
  *   STR;Mountpoint;Identifier;Format;Details;Carrier;NavSys;Network;Country;Lat;Lon;...
  *
- * @param raw       Full sourcetable response (may include HTTP headers).
- * @param listview  Handle to the mountpoint ListView control.
- * @param userLat   User latitude from config (for distance calculation).
- * @param userLon   User longitude from config (for distance calculation).
+ * Other lines are skipped, so @p text may be a whole reply (headers
+ * included) or a part of it cut at line ends, as the sourcetable worker
+ * posts while the download runs.  New rows follow the current sort
+ * order; the caller sets the ListView item count.
+ *
+ * @return Number of rows added.
  */
-void ParseMountTable(const char *raw, HWND listview, double userLat, double userLon)
+int MountTableAppend(GuiMountTable *table, const char *text)
 {
-    if (!raw || !listview) return;
-
-    ListView_DeleteAllItems(listview);
+    if (!table || !text) return 0;
 
-    const char *p = raw;
-    int row = 0;
+    int first = table->count;
+    const char *p = text;
 
     while (*p) {
         /* Find end of current line */
@@ -70,65 +112,38 @@ void ParseMountTable(const char *raw, HWND listview, double userLat, double user
 
         /* Only process STR lines */
         if (lineLen > 4 && strncmp(p, "STR;", 4) == 0) {
-            /* Copy line into a temporary buffer for tokenizing */
-            char *buf = (char *)malloc(lineLen + 1);
-            if (buf) {
-                memcpy(buf, p, lineLen);
-                buf[lineLen] = '\0';
-
-                /* Split by ';' into fields */
-                char *fields[20];
-                int nFields = 0;
-                char *tok = buf;
-
-                while (nFields < 20) {
-                    fields[nFields++] = tok;
-                    char *sep = strchr(tok, ';');
-                    if (!sep) break;
-                    *sep = '\0';
-                    tok = sep + 1;
-                }
+            /* Split by ';' into fields (pointers into the raw line) */
+            const char *fields[20];
+            int fieldLen[20];
+            int nFields = 0;
+            const char *tok = p;
 
-                /* Need at least 11 fields: STR + 10 data columns */
-                if (nFields >= 11) {
-                    LVITEM lvi;
-                    ZeroMemory(&lvi, sizeof(lvi));
-                    lvi.mask    = LVIF_TEXT;
-                    lvi.iItem   = row;
-                    lvi.pszText = fields[1];  /* Mountpoint */
-                    ListView_InsertItem(listview, &lvi);
-
-                    ListView_SetItemText(listview, row, 1, fields[2]);   /* Identifier */
-                    ListView_SetItemText(listview, row, 2, fields[3]);   /* Format */
-                    ListView_SetItemText(listview, row, 3, fields[4]);   /* Details */
-                    ListView_SetItemText(listview, row, 4, fields[5]);   /* Carrier */
-                    ListView_SetItemText(listview, row, 5, fields[6]);   /* Nav Sys */
-                    ListView_SetItemText(listview, row, 6, fields[7]);   /* Network */
-                    ListView_SetItemText(listview, row, 7, fields[8]);   /* Country */
-                    ListView_SetItemText(listview, row, 8, fields[9]);   /* Lat */
-                    ListView_SetItemText(listview, row, 9, fields[10]);  /* Lon */
-
-                    /* Column 10: Distance (km) from user position */
-                    double mpLat = atof(fields[9]);
-                    double mpLon = atof(fields[10]);
-                    char distBuf[32];
-
-                    if (userLat == 0.0 && userLon == 0.0) {
-                        /* No user position configured */
-                        snprintf(distBuf, sizeof(distBuf), "-");
-                    } else if (mpLat == 0.0 && mpLon == 0.0) {
-                        /* Mountpoint has no coordinates */
-                        snprintf(distBuf, sizeof(distBuf), "-");
-                    } else {
-                        double dist = haversine_km(userLat, userLon, mpLat, mpLon);
-                        snprintf(distBuf, sizeof(distBuf), "%.1f", dist);
-                    }
-                    ListView_SetItemText(listview, row, 10, distBuf);
-
-                    row++;
+            while (nFields < 20) {
+                const char *sep = memchr(tok, ';', (size_t)(lineEnd - tok));
+                fields[nFields] = tok;
+                fieldLen[nFields++] = (int)((sep ? sep : lineEnd) - tok);
+                if (!sep) break;
+                tok = sep + 1;
+            }
+
+            /* Need at least 11 fields: STR + 10 data columns */
+            if (nFields >= 11) {
+                if (!reserve_row(table)) break;
+                GuiMountRow *r = &table->rows[table->count];
+                BOOL ok = TRUE;
+
+                /* Columns 0..9: Mountpoint .. Lon; column 10 (Distance)
+                 * is computed when it is shown */
+                for (int c = 0; c < GUI_MOUNT_COL_DIST && ok; c++) {
+                    r->cell[c] = pool_add(table, fields[c + 1], (size_t)fieldLen[c + 1]);
+                    ok = (r->cell[c] != (unsigned)-1);
                 }
+                if (!ok) break;
 
-                free(buf);
+                r->num[0] = atof(table->pool + r->cell[8]);
+                r->num[1] = atof(table->pool + r->cell[9]);
+                table->order[table->count] = table->count;
+                table->count++;
             }
         }
 
@@ -136,4 +151,236 @@ void ParseMountTable(const char *raw, HWND listview, double userLat, double user
         p = lineEnd;
         while (*p == '\r' || *p == '\n') p++;
     }
+
+    int added = table->count - first;
+    if (added > 0) {
+        /* Cached sort orders no longer cover every row */
+        for (int c = 0; c < GUI_MOUNT_COLS; c++) {
+            free(table->sorted[c]);
+            table->sorted[c] = NULL;
+        }
+        if (table->sortCol >= 0)
+            MountTableSort(table, table->sortCol, table->sortAsc);
+    }
+    return added;
+}
+
+/**
+ * @brief Index the positions of the rows added since MountTableBegin()
+ *        for nearest queries.
+ */
+void MountTableFinish(GuiMountTable *table)
+{
+    if (!table) return;
+    geo_index_free(table->geo);
+    table->geo = NULL;
+
+    /* Mountpoints at 0/0 have no coordinates; the index skips them */
+    double *lat = (double *)malloc((table->count ? table->count : 1) * sizeof(double));
+    double *lon = (double *)malloc((table->count ? table->count : 1) * sizeof(double));
+    if (lat && lon) {
+        for (int i = 0; i < table->count; i++) {
+            lat[i] = table->rows[i].num[0];
+            lon[i] = table->rows[i].num[1];
+        }
+        table->geo = geo_index_build(lat, lon, table->count);
+    }
+    free(lat);
+    free(lon);
+}
+
+/**
+ * @brief Parse a raw NTRIP sourcetable into the mountpoint table.
+ *
+ * MountTableBegin(), MountTableAppend() and MountTableFinish() in one:
+ * the previous contents of @p table are released, rows are kept in
+ * sourcetable order and their positions are indexed.
+ *
+ * @param raw       Full sourcetable response (may include HTTP headers).
+ * @param table     Mountpoint table to fill.
+ * @param userLat   User latitude from config (for distance calculation).
+ * @param userLon   User longitude from config (for distance calculation).
+ */
+void ParseMountTable(const char *raw, GuiMountTable *table, double userLat, double userLon)
+{
+    if (!table) return;
+    MountTableBegin(table, userLat, userLon);
+    MountTableAppend(table, raw);
+    MountTableFinish(table);
+}
+
+/* Distance of a row from the user position, or -1 if either end has
+ * no position (shown as "-"). */
+static double row_distance_km(const GuiMountTable *t, int row)
+{
+    const GuiMountRow *r = &t->rows[row];
+    if (t->originLat == 0.0 && t->originLon == 0.0) return -1.0;
+    if (r->num[0] == 0.0 && r->num[1] == 0.0)       return -1.0;
+    return geo_distance_km(t->originLat, t->originLon, r->num[0], r->num[1]);
+}
+
+/**
+ * @brief Text of column @p col of the row shown at ListView index @p item.
+ *
+ * @return The cell text, or "" if @p item or @p col is out of range.
+ *         The Distance text lives in a static buffer (UI thread only)
+ *         that the next call for that column overwrites.
+ */
+const char *MountTableCell(const GuiMountTable *table, int item, int col)
+{
+    if (!table || item < 0 || item >= table->count ||
+        col < 0 || col >= GUI_MOUNT_COLS)
+        return "";
+    int row = table->order[item];
+    if (col == GUI_MOUNT_COL_DIST) {
+        static char distBuf[32];
+        double km = row_distance_km(table, row);
+        if (km < 0.0) snprintf(distBuf, sizeof(distBuf), "-");
+        else          snprintf(distBuf, sizeof(distBuf), "%.1f", km);
+        return distBuf;
+    }
+    return table->pool + table->rows[row].cell[col];
+}
+
+/**
+ * @brief ListView index of a mountpoint, matched case-insensitively and
+ *        with or without a leading '/'.
+ *
+ * @return The index, or -1 if the sourcetable has no such mountpoint.
+ */
+int MountTableFind(const GuiMountTable *table, const char *mountpoint)
+{
+    if (!table || !mountpoint) return -1;
+    if (mountpoint[0] == '/') mountpoint++;
+    for (int i = 0; i < table->count; i++) {
+        const char *c = MountTableCell(table, i, 0);
+        if (c[0] == '/') c++;
+        if (_stricmp(c, mountpoint) == 0) return i;
+    }
+    return -1;
+}
+
+/* qsort has no context argument; sorting only happens on the UI thread. */
+static const GuiMountTable *s_sortTable;
+static int                  s_sortCol;
+
+static int mount_row_compare(const void *a, const void *b)
+{
+    int ra = *(const int *)a, rb = *(const int *)b;
+    const GuiMountRow *x = &s_sortTable->rows[ra];
+    const GuiMountRow *y = &s_sortTable->rows[rb];
+    int result;
+
+    if (s_sortCol == 8 || s_sortCol == 9) {
+        /* Columns 8 (Lat), 9 (Lon) are numeric */
+        double v1 = x->num[s_sortCol - 8];
+        double v2 = y->num[s_sortCol - 8];
+        result = (v1 < v2) ? -1 : (v1 > v2);
+    } else {
+        result = _stricmp(s_sortTable->pool + x->cell[s_sortCol],
+                          s_sortTable->pool + y->cell[s_sortCol]);
+    }
+    /* Equal cells keep sourcetable order */
+    return result ? result : (ra > rb) - (ra < rb);
+}
+
+/* Ascending Distance order: every row's distance once, rows shown as
+ * "-" first (as distance 0). */
+static const double *s_sortKey;
+
+static int dist_compare(const void *a, const void *b)
+{
+    int ra = *(const int *)a, rb = *(const int *)b;
+    double v1 = s_sortKey[ra], v2 = s_sortKey[rb];
+    int result = (v1 < v2) ? -1 : (v1 > v2);
+    return result ? result : (ra > rb) - (ra < rb);
+}
+
+static BOOL dist_order(const GuiMountTable *t, int *idx)
+{
+    double *key = (double *)malloc((t->count ? t->count : 1) * sizeof(double));
+    if (!key) return FALSE;
+    for (int i = 0; i < t->count; i++) {
+        double km = row_distance_km(t, i);
+        key[i] = km < 0.0 ? 0.0 : km;
+    }
+    s_sortKey = key;
+    qsort(idx, (size_t)t->count, sizeof(int), dist_compare);
+    free(key);
+    return TRUE;
+}
+
+/**
+ * @brief Order the table by column @p col.
+ *
+ * The ascending order of the column is computed once per sourcetable;
+ * later clicks on the same column only copy it into order[].
+ */
+void MountTableSort(GuiMountTable *table, int col, BOOL ascending)
+{
+    if (!table || col < 0 || col >= GUI_MOUNT_COLS || table->count == 0)
+        return;
+
+    int n = table->count;
+    if (!table->sorted[col]) {
+        int *idx = (int *)malloc(n * sizeof(int));
+        if (!idx) return;
+        for (int i = 0; i < n; i++) idx[i] = i;
+        if (col == GUI_MOUNT_COL_DIST) {
+            if (!dist_order(table, idx)) { free(idx); return; }
+        } else {
+            s_sortTable = table;
+            s_sortCol   = col;
+            qsort(idx, (size_t)n, sizeof(int), mount_row_compare);
+        }
+        table->sorted[col] = idx;
+    }
+    for (int i = 0; i < n; i++)
+        table->order[i] = table->sorted[col][ascending ? i : n - 1 - i];
+    table->sortCol = col;
+    table->sortAsc = ascending;
+}
+
+/**
+ * @brief Set the user position the Distance column is measured from.
+ *
+ * Only the rows on screen are recomputed (when they are repainted),
+ * unless the list is sorted by distance, which needs every row.
+ */
+void MountTableSetOrigin(GuiMountTable *table, double lat, double lon)
+{
+    if (!table) return;
+    if (table->originLat == lat && table->originLon == lon) return;
+    table->originLat = lat;
+    table->originLon = lon;
+    free(table->sorted[GUI_MOUNT_COL_DIST]);
+    table->sorted[GUI_MOUNT_COL_DIST] = NULL;
+    if (table->sortCol == GUI_MOUNT_COL_DIST)
+        MountTableSort(table, GUI_MOUNT_COL_DIST, table->sortAsc);
+}
+
+/**
+ * @brief The @p k mountpoints nearest to the user position.
+ *
+ * @param maxKm  Only mountpoints within this distance; <= 0 for no limit.
+ * @param hits   [out] Room for @p k hits; hits[i].id is a table row.
+ * @return Number of hits, 0 if no user position is set.
+ */
+int MountTableNearest(const GuiMountTable *table, int k, double maxKm, GeoIndexHit *hits)
+{
+    if (!table || (table->originLat == 0.0 && table->originLon == 0.0))
+        return 0;
+    return geo_index_nearest(table->geo, table->originLat, table->originLon,
+                             k, maxKm, hits);
+}
+
+/**
+ * @brief ListView index at which table row @p row is shown, or -1.
+ */
+int MountTableItemOfRow(const GuiMountTable *table, int row)
+{
+    if (!table) return -1;
+    for (int i = 0; i < table->count; i++)
+        if (table->order[i] == row) return i;
+    return -1;
 }
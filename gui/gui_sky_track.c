@@ -0,0 +1,207 @@
+/**
+ * @file gui_sky_track.c
+ * @brief Compact per-SV track history for the sky plot.
+ *
+ * Thinning works a block at a time: once the full-rate chain holds a
+ * whole block more than SKY_TRACK_FINE_PTS, its oldest block is walked,
+ * every SKY_TRACK_DECIMATE-th sample is appended to the thinned chain and
+ * the block is freed.  The thinned chain in turn drops its oldest block
+ * when it is over SKY_TRACK_COARSE_PTS.  A delta that does not fit in 16
+ * bits (an SV gone for over 18 hours) starts a new block.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_sky_track.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* Blocks per malloc(); ~13 KB, enough for a few SVs */
+#define SKY_TRACK_CHUNK_BLOCKS  32
+
+typedef struct SkyTrackChunk {
+    struct SkyTrackChunk *next;
+    SkyTrackBlock         blocks[SKY_TRACK_CHUNK_BLOCKS];
+} SkyTrackChunk;
+
+static SkyTrackBlock *arena_get(SkyTrackArena *a)
+{
+    if (!a->free_list) {
+        SkyTrackChunk *c = (SkyTrackChunk *)malloc(sizeof(*c));
+        if (!c) return NULL;
+        c->next   = (SkyTrackChunk *)a->chunks;
+        a->chunks = c;
+        for (int i = SKY_TRACK_CHUNK_BLOCKS - 1; i >= 0; i--) {
+            c->blocks[i].next = a->free_list;
+            a->free_list = &c->blocks[i];
+        }
+        a->blocks += SKY_TRACK_CHUNK_BLOCKS;
+    }
+    SkyTrackBlock *b = a->free_list;
+    a->free_list = b->next;
+    b->next = NULL;
+    b->n    = 0;
+    a->in_use++;
+    return b;
+}
+
+static void arena_put(SkyTrackArena *a, SkyTrackBlock *b)
+{
+    b->next = a->free_list;
+    a->free_list = b;
+    a->in_use--;
+}
+
+void sky_track_arena_reset(SkyTrackArena *a)
+{
+    SkyTrackChunk *c = (SkyTrackChunk *)a->chunks;
+    while (c) {
+        SkyTrackChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    a->chunks    = NULL;
+    a->free_list = NULL;
+    a->blocks    = 0;
+    a->in_use    = 0;
+}
+
+/* Append one quantised sample to @p c at time @p ts. */
+static bool chain_push(SkyTrackArena *a, SkyTrackChain *c, double ts,
+                       uint16_t az_cdeg, int16_t el_cdeg)
+{
+    SkyTrackBlock *b = c->tail;
+    double dt = (b && b->n > 0) ? floor(ts - c->t_last + 0.5) : 0.0;
+    if (dt < 0.0) dt = 0.0;
+
+    if (!b || b->n == SKY_TRACK_BLOCK_PTS || dt > 65535.0) {
+        SkyTrackBlock *nb = arena_get(a);
+        if (!nb) return false;
+        nb->t0 = ts;
+        if (b) b->next = nb;
+        else   c->head = nb;
+        c->tail = b = nb;
+        dt = 0.0;
+    }
+
+    SkyTrackSample *s = &b->pts[b->n++];
+    s->az_cdeg = az_cdeg;
+    s->el_cdeg = el_cdeg;
+    s->dt_s    = (uint16_t)dt;
+    /* The decoded time, so rounding does not add up along the block */
+    c->t_last  = (b->n == 1) ? ts : c->t_last + dt;
+    c->count++;
+    return true;
+}
+
+/* Unlink and return the oldest block of @p c. */
+static SkyTrackBlock *chain_pop(SkyTrackChain *c)
+{
+    SkyTrackBlock *b = c->head;
+    c->head = b->next;
+    if (!c->head) c->tail = NULL;
+    c->count -= (unsigned)b->n;
+    return b;
+}
+
+bool sky_track_append(SkyTrackArena *a, SkyTrack *t,
+                      double ts, double az_deg, double el_deg)
+{
+    double az = fmod(az_deg, 360.0);
+    if (az < 0.0) az += 360.0;
+    long az_c = lround(az * 100.0);
+    if (az_c >= 36000) az_c -= 36000;
+    long el_c = lround(el_deg * 100.0);
+    if (el_c >  9000) el_c =  9000;
+    if (el_c < -9000) el_c = -9000;
+
+    if (!chain_push(a, &t->fine, ts, (uint16_t)az_c, (int16_t)el_c))
+        return false;
+    t->total++;
+
+    /* Thin the oldest full-rate block once it is not needed for the
+     * full-rate window any more. */
+    while (t->fine.head && t->fine.head != t->fine.tail &&
+           t->fine.count - (unsigned)t->fine.head->n >= SKY_TRACK_FINE_PTS) {
+        SkyTrackBlock *b = chain_pop(&t->fine);
+        double bt = b->t0;
+        for (int i = 0; i < b->n; i++) {
+            bt += b->pts[i].dt_s;
+            if (t->phase++ % SKY_TRACK_DECIMATE != 0) continue;
+            /* Out of blocks: the sample is lost, the track stays usable */
+            (void)chain_push(a, &t->coarse, bt,
+                             b->pts[i].az_cdeg, b->pts[i].el_cdeg);
+        }
+        arena_put(a, b);
+    }
+
+    while (t->coarse.head &&
+           t->coarse.count > SKY_TRACK_COARSE_PTS) {
+        SkyTrackBlock *b = chain_pop(&t->coarse);
+        t->dropped += (unsigned)b->n;
+        arena_put(a, b);
+    }
+    return true;
+}
+
+void sky_track_iter_init(SkyTrackIter *it, const SkyTrack *t, unsigned from)
+{
+    unsigned first_fine = t->total - t->fine.count;
+
+    it->track = t;
+    it->i     = 0;
+    it->ts    = 0.0;
+    if (from < first_fine || t->fine.count == 0) {
+        it->blk     = t->coarse.head ? t->coarse.head : t->fine.head;
+        it->in_fine = !t->coarse.head;
+        it->index   = first_fine;
+        return;
+    }
+
+    /* Skip whole blocks, then the samples before @p from in the block
+     * it falls in (their deltas still make up the time). */
+    unsigned skip = from - first_fine;
+    const SkyTrackBlock *b = t->fine.head;
+    while (b && skip >= (unsigned)b->n) {
+        skip -= (unsigned)b->n;
+        b = b->next;
+    }
+    it->blk     = b;
+    it->in_fine = true;
+    it->index   = from;
+    if (b) {
+        it->ts = b->t0;
+        for (unsigned i = 0; i < skip; i++)
+            it->ts += b->pts[i].dt_s;
+        it->i = (int)skip;
+    }
+}
+
+bool sky_track_iter_next(SkyTrackIter *it, SkyTrackPoint *out)
+{
+    while (it->blk && it->i >= it->blk->n) {
+        if (it->blk->next) {
+            it->blk = it->blk->next;
+        } else if (!it->in_fine) {
+            it->blk     = it->track->fine.head;
+            it->in_fine = true;
+        } else {
+            it->blk = NULL;
+        }
+        it->i = 0;
+    }
+    if (!it->blk) return false;
+
+    const SkyTrackSample *s = &it->blk->pts[it->i];
+    it->ts = (it->i == 0) ? it->blk->t0 : it->ts + s->dt_s;
+    it->i++;
+
+    out->az_deg = s->az_cdeg / 100.0;
+    out->el_deg = s->el_cdeg / 100.0;
+    out->ts     = it->ts;
+    out->index  = it->in_fine ? it->index++ : (unsigned)-1;
+    return true;
+}
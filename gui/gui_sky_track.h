@@ -0,0 +1,173 @@
+/**
+ * @file gui_sky_track.h
+ * @brief Compact per-SV track history for the sky plot.
+ *
+ * Every (gnss_id, prn) slot in the sky plot keeps the positions it was
+ * seen at, for the trails.  A fixed ring per slot costs the same for the
+ * hundreds of PRNs that never show up as for the few dozen that do, so
+ * the samples live in blocks from a shared @ref SkyTrackArena and a slot
+ * takes its first block when its SV is first seen:
+ *
+ *   - a sample is 6 bytes: azimuth and elevation in centidegrees and the
+ *     whole seconds since the sample before it; a block holds
+ *     @ref SKY_TRACK_BLOCK_PTS of them after the absolute time of its
+ *     first one
+ *   - the newest @ref SKY_TRACK_FINE_PTS samples are kept as taken, one
+ *     per @ref SKY_TRACK_INTERVAL_S; older ones are thinned to one in
+ *     @ref SKY_TRACK_DECIMATE and kept for @ref SKY_TRACK_COARSE_PTS more
+ *     before the oldest block is dropped
+ *
+ * With the defaults that is 24 hours at 60 s plus 6 days at 4 min, about
+ * 22 KB per SV for the full week.  A centidegree is well under a pixel on
+ * any plot size and the 4-min spacing stays inside
+ * @ref SKY_TRACK_GAP_BREAK_S, so the thinned part still draws as one arc.
+ *
+ * UI thread only.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_SKY_TRACK_H
+#define GUI_SKY_TRACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Sampling interval (seconds) between track points.
+ *
+ * Tighter = denser dots / smoother line; coarser = longer history per
+ * SV.  The polyline renderer in gui_sky_window.c connects consecutive
+ * samples into a smooth arc regardless of the dot spacing; at GLONASS
+ * orbital speed (~4 km/s) 60-s dots land ~7 pixels apart on an 800-px
+ * plot, which reads as continuous. */
+#define SKY_TRACK_INTERVAL_S    60.0
+
+/** @brief Break the polyline if two consecutive samples are this many
+ * seconds apart -- protects against drawing a straight chord across
+ * the plot when an SV sets and rises hours later. */
+#define SKY_TRACK_GAP_BREAK_S   300.0
+
+/** @brief Samples kept at full rate: 24 hours at 60 s/point. */
+#define SKY_TRACK_FINE_PTS      1440
+
+/** @brief Older samples keep one in this many (4 min at 60 s/point). */
+#define SKY_TRACK_DECIMATE      4
+
+/** @brief Thinned samples kept behind the full-rate ones: 6 days at 4 min. */
+#define SKY_TRACK_COARSE_PTS    2160
+
+/** @brief Samples per arena block. */
+#define SKY_TRACK_BLOCK_PTS     64
+
+/** @brief One stored sample, 6 bytes. */
+typedef struct {
+    uint16_t az_cdeg;     /**< 0..35999 = 0..359.99 deg, clockwise from north */
+    int16_t  el_cdeg;     /**< -9000..9000 */
+    uint16_t dt_s;        /**< seconds since the sample before it in the block; 0 for the first */
+} SkyTrackSample;
+
+/** @brief A run of samples; t0 is the time of pts[0]. */
+typedef struct SkyTrackBlock {
+    struct SkyTrackBlock *next;
+    double                t0;
+    int                   n;
+    SkyTrackSample        pts[SKY_TRACK_BLOCK_PTS];
+} SkyTrackBlock;
+
+/** @brief Blocks oldest to newest plus the time of the newest sample. */
+typedef struct {
+    SkyTrackBlock *head;
+    SkyTrackBlock *tail;
+    unsigned       count;
+    double         t_last;
+} SkyTrackChain;
+
+/**
+ * @struct SkyTrack
+ * @brief History of one SV.  All zero is an empty track.
+ *
+ * Samples are numbered 0, 1, ... in the order they were appended since
+ * the last reset; the newest @c fine.count of them (up to @c total - 1)
+ * are in @c fine, a thinned selection of the older ones in @c coarse.
+ */
+typedef struct {
+    SkyTrackChain coarse;
+    SkyTrackChain fine;
+    unsigned      total;    /**< samples appended */
+    unsigned      dropped;  /**< thinned samples dropped off the old end */
+    unsigned      phase;    /**< samples thinned so far, picks the one in SKY_TRACK_DECIMATE kept */
+} SkyTrack;
+
+/**
+ * @struct SkyTrackArena
+ * @brief Block allocator shared by all tracks.  All zero is empty.
+ *
+ * Blocks come from malloc()ed chunks and go back on a free list when a
+ * track thins or drops them; sky_track_arena_reset() frees the chunks.
+ */
+typedef struct {
+    void          *chunks;      /**< chunk list, first word links them */
+    SkyTrackBlock *free_list;
+    unsigned long  blocks;      /**< blocks in all chunks */
+    unsigned long  in_use;
+} SkyTrackArena;
+
+/** @brief A decoded sample. */
+typedef struct {
+    double   az_deg;
+    double   el_deg;
+    double   ts;
+    unsigned index;       /**< sample number; (unsigned)-1 for a thinned one */
+} SkyTrackPoint;
+
+/** @brief Walks a track oldest to newest; see sky_track_iter_init(). */
+typedef struct {
+    const SkyTrack      *track;
+    const SkyTrackBlock *blk;
+    int                  i;
+    bool                 in_fine;
+    double               ts;      /**< time of the sample before the next one in blk */
+    unsigned             index;   /**< sample number of the next fine one */
+} SkyTrackIter;
+
+/** @brief Samples stored. */
+static inline unsigned sky_track_count(const SkyTrack *t)
+{
+    return t->coarse.count + t->fine.count;
+}
+
+/** @brief Time of the newest sample; only meaningful when the track is not empty. */
+static inline double sky_track_last_ts(const SkyTrack *t)
+{
+    return t->fine.t_last;
+}
+
+/**
+ * @brief Append a sample taken at @p ts, thinning and dropping the old
+ *        end as needed.
+ *
+ * @return false if no block could be allocated (the sample is not kept).
+ */
+bool sky_track_append(SkyTrackArena *a, SkyTrack *t,
+                      double ts, double az_deg, double el_deg);
+
+/**
+ * @brief Start a walk at sample @p from.
+ *
+ * When @p from has been thinned already the walk starts at the oldest
+ * sample kept, so walking from 0 gives the whole track.
+ */
+void sky_track_iter_init(SkyTrackIter *it, const SkyTrack *t, unsigned from);
+
+/** @brief Next sample into @p out; false at the end. */
+bool sky_track_iter_next(SkyTrackIter *it, SkyTrackPoint *out);
+
+/**
+ * @brief Free every block of every track.  The tracks using the arena
+ *        must be zeroed along with it.
+ */
+void sky_track_arena_reset(SkyTrackArena *a);
+
+#endif /* GUI_SKY_TRACK_H */
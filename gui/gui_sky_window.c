@@ -7,9 +7,9 @@
  * subsequent phases plot SV markers fed from cached RTCM 1019/1045/1046
  * ephemerides combined with MSM observations.
  *
- * Threading: lives entirely on the UI thread.  Worker thread will post
- * WM_APP_SKY_UPDATE to the main window, which copies the payload into
- * AppState->skyState and InvalidateRect()s this window.
+ * Threading: lives entirely on the UI thread.  The worker queues sky
+ * updates on AppState->uiQueue; the main window's batch drain copies
+ * them into AppState->skyState and InvalidateRect()s this window.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -23,6 +23,8 @@
 #include "gui_snapshot.h"
 #include "rtcm3x_parser.h"
 #include "sv_ephemeris.h"
+#include "sky_grid.h"
+#include "sky_render.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -42,7 +44,11 @@
 
 /* Sector grid: band 0 = 0..10 deg elevation (horizon), band 8 = 80..90 deg
  * (zenith).  Widest bands at low elevation get the most azimuth slices so
- * each sector covers a comparable solid angle. */
+ * each sector covers a comparable solid angle.  SVs are binned into it with
+ * sky_grid_sector(), which holds the same table. */
+#if SKY_N_EL_BANDS != SKY_GRID_N_EL_BANDS || SKY_MAX_AZ_BINS != SKY_GRID_MAX_AZ_BINS
+#error "gui_state.h and sky_grid.h sector geometry differ"
+#endif
 const int sky_az_bins_per_band[SKY_N_EL_BANDS] = {
     33,  /* 0..10  deg */
     30,  /* 10..20 deg */
@@ -173,34 +179,14 @@ static void DrawSkyGrid(HDC hdc, int cx, int cy, int radius)
 /**
  * @brief Map an observed/expected ratio to a colour on the red->green ramp.
  *
- * Expected == 0 sectors return a pale grey ("nothing was supposed to be
- * here -- polar hole or below horizon").  Otherwise the ratio drives a
- * smooth red->yellow->green gradient.  Values >1 (more observed than
- * expected -- shouldn't happen with the current accumulator) are clamped.
+ * The CLI's ramp (sky_render_heatmap_rgb()), so the legend matches the
+ * disc and the `--sky` PNGs: pale grey where nothing was expected (polar
+ * hole or below horizon), otherwise red -> yellow -> green.
  */
 static COLORREF heatmap_color(int observed, int expected)
 {
-    if (expected == 0) return RGB(240, 240, 240);   /* polar hole */
-
-    double ratio = (double)observed / (double)expected;
-    if (ratio > 1.0) ratio = 1.0;
-    if (ratio < 0.0) ratio = 0.0;
-
-    int r, g, b;
-    if (ratio < 0.5) {
-        /* Red (220,60,60) -> Yellow (230,220,70) */
-        double t = ratio * 2.0;
-        r = (int)(220 + t * (230 - 220));
-        g = (int)( 60 + t * (220 -  60));
-        b = (int)( 60 + t * ( 70 -  60));
-    } else {
-        /* Yellow (230,220,70) -> Green (70,170,70) */
-        double t = (ratio - 0.5) * 2.0;
-        r = (int)(230 + t * ( 70 - 230));
-        g = (int)(220 + t * (170 - 220));
-        b = (int)( 70 + t * ( 70 -  70));
-    }
-    return RGB(r, g, b);
+    uint32_t c = sky_render_heatmap_rgb(observed, expected);
+    return RGB(RASTER_R(c), RASTER_G(c), RASTER_B(c));
 }
 
 /**
@@ -367,91 +353,26 @@ static void DrawSkyLegend(HDC hdc, int x, int y, SkyPlotMode mode,
     }
 }
 
+/* SkySector sectors[SKY_N_EL_BANDS][SKY_MAX_AZ_BINS] is read as the flat
+ * SkyRenderSector array of sky_render.h. */
+#if SKY_N_EL_BANDS != SKY_RENDER_N_EL_BANDS || SKY_MAX_AZ_BINS != SKY_RENDER_MAX_AZ_BINS
+#error "gui_state.h and sky_render.h sector geometry differ"
+#endif
+
 /**
  * @brief Draw the sector heatmap (observed/expected per sector).
  *
- * For each sector with a non-zero counter, draws an annular wedge in the
- * colour from heatmap_color().  The wedge is approximated by a polygon
- * with arc-segment vertices.  The zenith cap (band 8) is drawn as a
- * solid disc since it has only one azimuth slice.
+ * Fills the disc straight into the back buffer's DIB bits with the CLI
+ * renderer's cached span map (sky_render_heatmap_disc()): for the same
+ * centre and radius the pixels of a `--sky` PNG, and no brush and
+ * polygon per sector.
  */
-static void DrawSkyHeatmap(HDC hdc, const AppState *state,
+static void DrawSkyHeatmap(SnapshotDib *buf, const AppState *state,
                            int cx, int cy, int radius)
 {
-    HPEN penEdge = CreatePen(PS_SOLID, 1, RGB(140, 140, 140));
-    HPEN penOld  = (HPEN)SelectObject(hdc, penEdge);
-
-    /* Arc-segment granularity: ~3 deg of azimuth per segment. */
-    const double seg_step_deg = 3.0;
-
-    for (int band = 0; band < SKY_N_EL_BANDS; band++) {
-        int n_az = sky_az_bins_per_band[band];
-        if (n_az < 1) continue;
-
-        double el_lo = (double)band * 10.0;
-        double el_hi = el_lo + 10.0;
-
-        /* radius increases with decreasing elevation, so r_outer is at el_lo */
-        double r_outer = (90.0 - el_lo) / 90.0 * (double)radius;
-        double r_inner = (90.0 - el_hi) / 90.0 * (double)radius;
-
-        double az_width = 360.0 / (double)n_az;
-
-        for (int az_bin = 0; az_bin < n_az; az_bin++) {
-            const SkySector *sec = &state->skyState.sectors[band][az_bin];
-
-            HBRUSH br = CreateSolidBrush(
-                heatmap_color(sec->observed, sec->expected));
-            HBRUSH brOld = (HBRUSH)SelectObject(hdc, br);
-
-            double az_lo = (double)az_bin * az_width;
-            double az_hi = az_lo + az_width;
-
-            if (n_az == 1) {
-                /* Zenith cap: just a disc of radius r_outer */
-                Ellipse(hdc,
-                        cx - (int)r_outer, cy - (int)r_outer,
-                        cx + (int)r_outer, cy + (int)r_outer);
-            } else {
-                /* Build the polygon: inner arc az_lo->az_hi, then outer arc
-                 * az_hi->az_lo (reversed) to close the wedge. */
-                int   n_seg = (int)((az_hi - az_lo) / seg_step_deg);
-                if (n_seg < 2) n_seg = 2;
-                int   pts_cap = (n_seg + 1) * 2 + 2;
-                POINT *pts = (POINT *)HeapAlloc(GetProcessHeap(), 0,
-                                                 sizeof(POINT) * (size_t)pts_cap);
-                int   n_pts = 0;
-                if (pts) {
-                    /* Inner arc, az_lo -> az_hi (sweep clockwise) */
-                    for (int s = 0; s <= n_seg; s++) {
-                        double t = (double)s / (double)n_seg;
-                        double az = az_lo + t * (az_hi - az_lo);
-                        double az_rad = az * M_PI / 180.0;
-                        pts[n_pts].x = cx + (int)(r_inner * sin(az_rad) + 0.5);
-                        pts[n_pts].y = cy - (int)(r_inner * cos(az_rad) + 0.5);
-                        n_pts++;
-                    }
-                    /* Outer arc, az_hi -> az_lo */
-                    for (int s = n_seg; s >= 0; s--) {
-                        double t = (double)s / (double)n_seg;
-                        double az = az_lo + t * (az_hi - az_lo);
-                        double az_rad = az * M_PI / 180.0;
-                        pts[n_pts].x = cx + (int)(r_outer * sin(az_rad) + 0.5);
-                        pts[n_pts].y = cy - (int)(r_outer * cos(az_rad) + 0.5);
-                        n_pts++;
-                    }
-                    Polygon(hdc, pts, n_pts);
-                    HeapFree(GetProcessHeap(), 0, pts);
-                }
-            }
-
-            SelectObject(hdc, brOld);
-            DeleteObject(br);
-        }
-    }
-
-    SelectObject(hdc, penOld);
-    DeleteObject(penEdge);
+    GdiFlush();                 /* the background fill must land first */
+    sky_render_heatmap_disc(&buf->img, cx, cy, radius,
+                            (const SkyRenderSector *)state->skyState.sectors);
 }
 
 /**
@@ -482,13 +403,250 @@ static COLORREF cnr_shade(COLORREF fresh, float cnr_dbhz)
 }
 
 /**
- * @brief Draw all tracked satellites onto the polar grid.
+ * @brief Map a GNSS id to its PRN prefix and marker colour.
+ *
+ * @return false for the ids the sky plot does not draw (0, 6 = SBAS).
+ */
+static bool sky_gnss_style(int g, char *sys, COLORREF *color)
+{
+    switch (g) {
+    case 1: *sys = 'G'; *color = SKY_GPS_COLOR;   return true;
+    case 2: *sys = 'R'; *color = SKY_GLO_COLOR;   return true;
+    case 3: *sys = 'E'; *color = SKY_GAL_COLOR;   return true;
+    case 4: *sys = 'J'; *color = SKY_QZS_COLOR;   return true;
+    case 5: *sys = 'C'; *color = SKY_BDS_COLOR;   return true;
+    case 7: *sys = 'I'; *color = SKY_NAVIC_COLOR; return true;
+    default: return false;
+    }
+}
+
+/**
+ * @brief Draw track samples @p from .. total-1 of @p tr.
+ *
+ * Projects each (az, el) sample to pixels and joins consecutive samples
+ * with a 1-px polyline in @p trail_color, starting at sample @p from - 1
+ * when that one is still kept at full rate so an appended piece
+ * continues the arc already on screen; a @p from that has been thinned
+ * already draws the whole track.  Az-wrap (e.g. 359° -> 1° across north)
+ * and time gaps split the line:
+ *   (a) az-wrap   -- |dAz| > 180° (crossing N/S axis)
+ *   (b) time gap  -- consecutive samples more than SKY_TRACK_GAP_BREAK_S
+ *                    apart, which means the SV had set or otherwise
+ *                    dropped out of tracking, and the correct visual is
+ *                    two arcs separated by empty space, not a straight
+ *                    chord across the plot.
+ * A small 3x3 dot is overlaid at each new sample too, so genuine
+ * eph-update steps show up as a straight line linking two visibly-spaced
+ * dots.
+ */
+static void DrawSkyTrack(HDC hdc, const SkyTrack *tr, unsigned from,
+                         COLORREF trail_color, int cx, int cy, int radius)
+{
+    if (from >= tr->total) return;
+    unsigned start = (from > 0) ? from - 1 : 0;
+
+    /* Lines pass: the polyline goes out in pieces of up to
+     * SKY_TRACK_RUN_PTS points, each starting where the last ended. */
+    enum { SKY_TRACK_RUN_PTS = 256 };
+    POINT  run[SKY_TRACK_RUN_PTS];
+    int    n_run   = 0;
+    double prev_az = 0.0, prev_ts = 0.0;
+
+    HPEN penTrail = CreatePen(PS_SOLID, 1, trail_color);
+    HPEN oldP     = (HPEN)SelectObject(hdc, penTrail);
+    SkyTrackIter  it;
+    SkyTrackPoint tp;
+    sky_track_iter_init(&it, tr, start);
+    while (sky_track_iter_next(&it, &tp)) {
+        double az_r = tp.az_deg * M_PI / 180.0;
+        double r_t  = (90.0 - tp.el_deg) / 90.0 * (double)radius;
+        POINT pt = { cx + (int)(r_t * sin(az_r) + 0.5),
+                     cy - (int)(r_t * cos(az_r) + 0.5) };
+        if (n_run > 0) {
+            bool wrap = fabs(tp.az_deg - prev_az) > 180.0;
+            bool gap  = (tp.ts - prev_ts) > SKY_TRACK_GAP_BREAK_S;
+            if (wrap || gap || n_run == SKY_TRACK_RUN_PTS) {
+                if (n_run >= 2)
+                    Polyline(hdc, run, n_run);
+                if (wrap || gap) {
+                    n_run = 0;
+                } else {
+                    run[0] = run[n_run - 1];
+                    n_run  = 1;
+                }
+            }
+        }
+        run[n_run++] = pt;
+        prev_az = tp.az_deg;
+        prev_ts = tp.ts;
+    }
+    if (n_run >= 2)
+        Polyline(hdc, run, n_run);
+    SelectObject(hdc, oldP);
+    DeleteObject(penTrail);
+
+    /* Sample-point dots: 3x3 px in the same hue so individual
+     * snapshots are still discernible against the line.  The join
+     * sample already has its dot. */
+    HBRUSH brTrail = CreateSolidBrush(trail_color);
+    HBRUSH oldB    = (HBRUSH)SelectObject(hdc, brTrail);
+    HPEN   oldP2   = (HPEN)SelectObject(hdc, GetStockObject(NULL_PEN));
+    sky_track_iter_init(&it, tr, start);
+    while (sky_track_iter_next(&it, &tp)) {
+        if (from > 0 && tp.index == start) continue;
+        double az_r = tp.az_deg * M_PI / 180.0;
+        double r_t  = (90.0 - tp.el_deg) / 90.0 * (double)radius;
+        int x = cx + (int)(r_t * sin(az_r) + 0.5);
+        int y = cy - (int)(r_t * cos(az_r) + 0.5);
+        Ellipse(hdc, x - 1, y - 1, x + 2, y + 2);
+    }
+    SelectObject(hdc, oldP2);
+    SelectObject(hdc, oldB);
+    DeleteObject(brTrail);
+}
+
+/**
+ * @brief Retained background for marker mode: the fill, the compass rose
+ *        and every track sample drawn so far.
+ *
+ * A long session holds some 100 SVs x 3600 samples; projecting and
+ * drawing all of them on every 1-Hz repaint is what made the window
+ * slow.  The layer keeps them on an off-screen bitmap instead, WM_PAINT
+ * draws only the samples appended since the last paint onto it
+ * (sky_layer_update()), copies it to the back buffer and draws the live
+ * markers on top.  It is redrawn from scratch when what it shows no
+ * longer matches the model: a resize, a filter or mode change, a track
+ * reset (new stream or replay), an SV dropping out of view, or a track
+ * dropping its oldest block.  Samples thinned since they were drawn stay
+ * on the layer until then; they lie on the same arc.
+ *
+ * UI thread only, like the legend hit cache.
+ */
+typedef struct {
+    HDC      hdc;
+    HBITMAP  bmp;
+    HBITMAP  bmp_old;
+    HFONT    font_old;
+    int      w, h;
+    int      filter;     /**< filter_gnss_id the layer was drawn for */
+    bool     valid;
+    bool     shown[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS]; /**< trail is on the layer */
+    unsigned next   [SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS]; /**< first sample not on it */
+    unsigned dropped[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS]; /**< track .dropped when drawn */
+} SkyTrackLayer;
+
+static SkyTrackLayer g_track_layer;
+
+/** @brief Release the layer bitmap; the next marker-mode paint rebuilds it. */
+static void sky_layer_free(void)
+{
+    SkyTrackLayer *L = &g_track_layer;
+    if (L->hdc) {
+        SelectObject(L->hdc, L->font_old);
+        SelectObject(L->hdc, L->bmp_old);
+        DeleteObject(L->bmp);
+        DeleteDC(L->hdc);
+    }
+    memset(L, 0, sizeof(*L));
+}
+
+/**
+ * @brief Bring the track layer up to date with @p state.
+ *
+ * @param hdcRef  DC the layer bitmap is made compatible with.
+ * @return The layer DC, or NULL if the bitmap could not be created.
+ */
+static HDC sky_layer_update(HDC hdcRef, const AppState *state, int w, int h)
+{
+    SkyTrackLayer *L = &g_track_layer;
+    const int filter = state->skyState.filter_gnss_id;
+    double now = gui_get_time_seconds();
+
+    bool rebuild = !L->valid || L->w != w || L->h != h || L->filter != filter;
+    for (int g = 0; g < SV_EPH_MAX_GNSS && !rebuild; g++) {
+        for (int p = 0; p < SV_EPH_MAX_SATS_PER_GNSS; p++) {
+            if (!L->shown[g][p]) continue;
+            const SkySat *s = &state->skyState.sats[g][p];
+            if (!s->valid || (now - s->last_seen_ts) > SKY_DROP_S ||
+                s->track.total < L->next[g][p] ||
+                s->track.dropped != L->dropped[g][p]) {
+                rebuild = true;
+                break;
+            }
+        }
+    }
+
+    int cx, cy, radius;
+    if (rebuild) {
+        if (!L->hdc || L->w != w || L->h != h) {
+            sky_layer_free();
+            L->hdc = CreateCompatibleDC(hdcRef);
+            L->bmp = CreateCompatibleBitmap(hdcRef, w, h);
+            if (!L->hdc || !L->bmp) {
+                if (L->bmp) DeleteObject(L->bmp);
+                if (L->hdc) DeleteDC(L->hdc);
+                memset(L, 0, sizeof(*L));
+                return NULL;
+            }
+            L->bmp_old  = (HBITMAP)SelectObject(L->hdc, L->bmp);
+            L->font_old = (HFONT)SelectObject(L->hdc,
+                                              GetStockObject(DEFAULT_GUI_FONT));
+            L->w = w;
+            L->h = h;
+        }
+        DrawSkyFill(L->hdc, w, h, &cx, &cy, &radius);
+        DrawSkyGrid(L->hdc, cx, cy, radius);
+        memset(L->shown, 0, sizeof(L->shown));
+        L->filter = filter;
+        L->valid  = true;
+    } else {
+        sky_compute_geometry(w, h, &cx, &cy, &radius);
+    }
+
+    for (int g = 0; g < SV_EPH_MAX_GNSS; g++) {
+        char sys;
+        COLORREF color_fresh;
+        if (!sky_gnss_style(g, &sys, &color_fresh)) continue;
+
+        /* Apply per-GNSS legend filter.  Tracks remain in state->skyState
+         * so deselecting the filter restores the full history immediately. */
+        if (filter != 0 && filter != g) continue;
+
+        /* Trail dots: keep the GNSS hue but lighten ~30% toward white so
+         * they read as "history" without competing visually with the live
+         * marker. */
+        int tr_r = (GetRValue(color_fresh) * 7 + 255 * 3) / 10;
+        int tr_g = (GetGValue(color_fresh) * 7 + 255 * 3) / 10;
+        int tr_b = (GetBValue(color_fresh) * 7 + 255 * 3) / 10;
+        COLORREF trail_color = RGB(tr_r, tr_g, tr_b);
+
+        for (int p = 0; p < SV_EPH_MAX_SATS_PER_GNSS; p++) {
+            const SkySat *s = &state->skyState.sats[g][p];
+            if (!s->valid || (now - s->last_seen_ts) > SKY_DROP_S) continue;
+
+            if (!L->shown[g][p]) {
+                L->shown[g][p]   = true;
+                L->next[g][p]    = 0;
+                L->dropped[g][p] = s->track.dropped;
+            }
+            if (s->track.total == L->next[g][p]) continue;
+            DrawSkyTrack(L->hdc, &s->track, L->next[g][p], trail_color,
+                         cx, cy, radius);
+            L->next[g][p] = s->track.total;
+        }
+    }
+    return L->hdc;
+}
+
+/**
+ * @brief Draw the live satellite markers onto the polar grid.
  *
  * Reads SkyPlotState from the AppState, projects each (az, el) to pixels
  * using radius = (90 - el)/90 * outer_radius and angle = az clockwise
  * from north, and draws a coloured disc + PRN label per SV.  Stale
  * markers (>SKY_STALE_S since last update) are drawn grey; otherwise
- * the fresh GNSS colour is shaded toward grey by the SV's CNR.
+ * the fresh GNSS colour is shaded toward grey by the SV's CNR.  The
+ * track trails underneath come from the track layer.
  */
 static int DrawSkyMarkers(HDC hdc, const AppState *state,
                           int cx, int cy, int radius)
@@ -509,28 +667,9 @@ static int DrawSkyMarkers(HDC hdc, const AppState *state,
     for (int g = 0; g < SV_EPH_MAX_GNSS; g++) {
         char sys;
         COLORREF color_fresh;
-        switch (g) {
-        case 1: sys = 'G'; color_fresh = SKY_GPS_COLOR;   break;
-        case 2: sys = 'R'; color_fresh = SKY_GLO_COLOR;   break;
-        case 3: sys = 'E'; color_fresh = SKY_GAL_COLOR;   break;
-        case 4: sys = 'J'; color_fresh = SKY_QZS_COLOR;   break;
-        case 5: sys = 'C'; color_fresh = SKY_BDS_COLOR;   break;
-        case 7: sys = 'I'; color_fresh = SKY_NAVIC_COLOR; break;
-        default: continue;
-        }
-
-        /* Apply per-GNSS legend filter.  Tracks remain in state->skyState
-         * so deselecting the filter restores the full history immediately. */
+        if (!sky_gnss_style(g, &sys, &color_fresh)) continue;
         if (filter != 0 && filter != g) continue;
 
-        /* Trail dots: keep the GNSS hue but lighten ~30% toward white so
-         * they read as "history" without competing visually with the live
-         * marker. */
-        int tr_r = (GetRValue(color_fresh) * 7 + 255 * 3) / 10;
-        int tr_g = (GetGValue(color_fresh) * 7 + 255 * 3) / 10;
-        int tr_b = (GetBValue(color_fresh) * 7 + 255 * 3) / 10;
-        COLORREF trail_color = RGB(tr_r, tr_g, tr_b);
-
         for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
             const SkySat *s = &state->skyState.sats[g][p - 1];
             if (!s->valid) continue;
@@ -538,82 +677,6 @@ static int DrawSkyMarkers(HDC hdc, const AppState *state,
             double age = now - s->last_seen_ts;
             if (age > SKY_DROP_S) continue;
 
-            /* ── Track trail (since stream open / last reset) ──
-             * Walk oldest->newest, project each (az, el) sample to pixels,
-             * then draw a connected polyline so the trail reads as a
-             * continuous arc.  Az-wrap (e.g. 359° -> 1° across north) is
-             * detected and the polyline is split so we don't draw a long
-             * chord across the plot.  A small 3x3 dot is overlaid at each
-             * sample point too, so genuine eph-update steps show up as a
-             * straight line linking two visibly-spaced dots. */
-            if (s->track.count > 0) {
-                int start_idx = (s->track.count < SKY_TRACK_CAP)
-                                ? 0
-                                : s->track.head;
-
-                /* Project all sample points into a local POINT[] array,
-                 * tagged with their (az, el) for wrap detection and ts
-                 * for gap detection.  At the 24-hour default cap these
-                 * arrays sum to ~33 KB on the stack -- well within the
-                 * UI thread's 1 MB. */
-                POINT  pts[SKY_TRACK_CAP];
-                double azs[SKY_TRACK_CAP];
-                double tss[SKY_TRACK_CAP];
-                for (int i = 0; i < s->track.count; i++) {
-                    int idx = (start_idx + i) % SKY_TRACK_CAP;
-                    const SkyTrackPoint *tp = &s->track.pts[idx];
-                    double az_r = tp->az_deg * M_PI / 180.0;
-                    double r_t  = (90.0 - tp->el_deg) / 90.0 * (double)radius;
-                    pts[i].x = cx + (int)(r_t * sin(az_r) + 0.5);
-                    pts[i].y = cy - (int)(r_t * cos(az_r) + 0.5);
-                    azs[i]   = tp->az_deg;
-                    tss[i]   = tp->ts;
-                }
-
-                /* Polyline pass: 1-px line in the desaturated GNSS hue.
-                 * Walk runs of consecutive samples.  Split the run at:
-                 *   (a) az-wrap   -- |dAz| > 180° (crossing N/S axis)
-                 *   (b) time gap  -- consecutive samples more than
-                 *                    SKY_TRACK_GAP_BREAK_S apart, which
-                 *                    means the SV had set or otherwise
-                 *                    dropped out of tracking, and the
-                 *                    correct visual is two arcs separated
-                 *                    by empty space, not a straight chord
-                 *                    across the plot. */
-                HPEN penTrail = CreatePen(PS_SOLID, 1, trail_color);
-                HPEN oldP     = (HPEN)SelectObject(hdc, penTrail);
-                int run_start = 0;
-                for (int i = 1; i < s->track.count; i++) {
-                    bool wrap = fabs(azs[i] - azs[i - 1]) > 180.0;
-                    bool gap  = (tss[i] - tss[i - 1]) > SKY_TRACK_GAP_BREAK_S;
-                    if (wrap || gap) {
-                        int run_len = i - run_start;
-                        if (run_len >= 2)
-                            Polyline(hdc, &pts[run_start], run_len);
-                        run_start = i;
-                    }
-                }
-                int tail_len = s->track.count - run_start;
-                if (tail_len >= 2)
-                    Polyline(hdc, &pts[run_start], tail_len);
-                SelectObject(hdc, oldP);
-                DeleteObject(penTrail);
-
-                /* Sample-point dots: 3x3 px in the same hue so individual
-                 * snapshots are still discernible against the line. */
-                HBRUSH brTrail = CreateSolidBrush(trail_color);
-                HBRUSH oldB    = (HBRUSH)SelectObject(hdc, brTrail);
-                HPEN   penNull = (HPEN)GetStockObject(NULL_PEN);
-                HPEN   oldP2   = (HPEN)SelectObject(hdc, penNull);
-                for (int i = 0; i < s->track.count; i++) {
-                    Ellipse(hdc, pts[i].x - 1, pts[i].y - 1,
-                                 pts[i].x + 2, pts[i].y + 2);
-                }
-                SelectObject(hdc, oldP2);
-                SelectObject(hdc, oldB);
-                DeleteObject(brTrail);
-            }
-
             COLORREF c = (age > SKY_STALE_S)
                          ? SKY_DIM_COLOR
                          : cnr_shade(color_fresh, s->cnr_dbhz);
@@ -704,6 +767,171 @@ static BOOL sky_hit_test(const AppState *state, int w, int h,
     return TRUE;
 }
 
+/**
+ * @brief Paint the whole sky window -- rose, heatmap or markers, header,
+ *        legend and footer -- into @p buf.
+ *
+ * WM_PAINT blits the result to the screen; the PNG snapshot saves it, so
+ * the file holds exactly what the window shows whether or not the window
+ * is covered.
+ *
+ * @param hdcRef  DC the track layer is made compatible with.
+ */
+static void SkyPaint(SnapshotDib *buf, HDC hdcRef, AppState *state, int w, int h)
+{
+    HDC   hdcMem   = buf->hdc;
+    HFONT hFontOld = (HFONT)SelectObject(hdcMem, GetStockObject(DEFAULT_GUI_FONT));
+
+    int cx = 0, cy = 0, radius = 0;
+    int drawn = 0;
+    HDC hdcLayer = (state && state->skyState.mode == SKY_MODE_MARKERS)
+                   ? sky_layer_update(hdcRef, state, w, h)
+                   : NULL;
+    if (hdcLayer) {
+        /* Rose and trails from the track layer, live markers on top */
+        BitBlt(hdcMem, 0, 0, w, h, hdcLayer, 0, 0, SRCCOPY);
+        sky_compute_geometry(w, h, &cx, &cy, &radius);
+        drawn = DrawSkyMarkers(hdcMem, state, cx, cy, radius);
+    } else {
+        /* The heatmap changes every epoch: draw it straight into the
+         * back buffer, between background fill and foreground grid so
+         * the compass rose, rings and labels stay legible.  The layer
+         * is dropped so the next marker-mode paint starts clean. */
+        g_track_layer.valid = false;
+        DrawSkyFill(hdcMem, w, h, &cx, &cy, &radius);
+        if (state && state->skyState.mode == SKY_MODE_HEATMAP)
+            DrawSkyHeatmap(buf, state, cx, cy, radius);
+        DrawSkyGrid(hdcMem, cx, cy, radius);
+        if (state && state->skyState.mode == SKY_MODE_MARKERS)
+            drawn = DrawSkyMarkers(hdcMem, state, cx, cy, radius);
+    }
+
+    /* ── Diagnostic status line ────────────────────────────────
+     * Distinguishes the two prerequisites so the user knows what
+     * to look for in their RTCM stream. */
+    bool   have_arp = false;
+    double arp_lat = 0, arp_lon = 0;
+    rtcm_get_station_arp(&have_arp, NULL, NULL, NULL,
+                         &arp_lat, &arp_lon, NULL);
+
+    int eph_gps = 0, eph_glo = 0, eph_gal = 0, eph_qzs = 0, eph_bds = 0;
+    for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
+        if (sv_eph_get(1, p)) eph_gps++;
+        if (sv_eph_get(2, p)) eph_glo++;
+        if (sv_eph_get(3, p)) eph_gal++;
+        if (sv_eph_get(4, p)) eph_qzs++;
+        if (sv_eph_get(5, p)) eph_bds++;
+    }
+    int eph_total = eph_gps + eph_glo + eph_gal + eph_qzs + eph_bds;
+
+    SetTextAlign(hdcMem, TA_LEFT | TA_TOP);
+    SetTextColor(hdcMem, SKY_STATUS_COLOR);
+
+    char line1[160];
+    if (drawn > 0) {
+        snprintf(line1, sizeof(line1),
+                 "Tracking %d sat%s  (eph G:%d R:%d E:%d J:%d C:%d)",
+                 drawn, drawn == 1 ? "" : "s",
+                 eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
+    } else if (!have_arp && eph_total == 0) {
+        snprintf(line1, sizeof(line1),
+                 "Waiting: no RTCM 1005/1006 + no 1019/1020/1042/1044/1045 yet");
+    } else if (!have_arp) {
+        snprintf(line1, sizeof(line1),
+                 "Have %d eph (G:%d R:%d E:%d J:%d C:%d); need RTCM 1005/1006",
+                 eph_total, eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
+    } else if (eph_total == 0) {
+        snprintf(line1, sizeof(line1),
+                 "Have station ARP; need RTCM 1019/1020/1042/1044/1045/1046");
+    } else {
+        snprintf(line1, sizeof(line1),
+                 "ARP + eph G:%d R:%d E:%d J:%d C:%d; awaiting next MSM frame",
+                 eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
+    }
+    TextOut(hdcMem, 8, 6, line1, (int)strlen(line1));
+
+    /* Second line: mode + hint + keyboard / mouse shortcuts.  In marker
+     * mode we also surface the per-GNSS legend filter when active so it
+     * is obvious why some constellations are hidden. */
+    char mode_label[160];
+    if (state && state->skyState.mode == SKY_MODE_HEATMAP) {
+        snprintf(mode_label, sizeof(mode_label),
+                 "Mode: Heatmap (observed/expected per sector)  [M=toggle  S=save]");
+    } else {
+        int f = state ? state->skyState.filter_gnss_id : 0;
+        const char *fname = "";
+        switch (f) {
+        case 1: fname = "GPS";   break;
+        case 2: fname = "GLO";   break;
+        case 3: fname = "GAL";   break;
+        case 4: fname = "QZS";   break;
+        case 5: fname = "BDS";   break;
+        case 6: fname = "SBAS";  break;
+        case 7: fname = "NAVIC"; break;
+        default: break;
+        }
+        if (f && fname[0]) {
+            snprintf(mode_label, sizeof(mode_label),
+                     "Mode: Live SVs  [Filter: %s only -- click chip to clear  |  M=toggle  S=save]",
+                     fname);
+        } else {
+            snprintf(mode_label, sizeof(mode_label),
+                     "Mode: Live SVs (brightness ~ CNR; click SV for detail, click legend chip to filter)  [M=toggle  S=save]");
+        }
+    }
+    TextOut(hdcMem, 8, 22, mode_label, (int)strlen(mode_label));
+
+    /* Third line: mode-specific colour legend */
+    SkyPlotMode legend_mode =
+        (state) ? state->skyState.mode : SKY_MODE_MARKERS;
+    int legend_filter = (state) ? state->skyState.filter_gnss_id : 0;
+    DrawSkyLegend(hdcMem, 8, 38, legend_mode, legend_filter);
+
+    /* Footer:  live local time on the left, station identity on the right.
+     * The right side shows the mountpoint + ARP coords so PNG snapshots
+     * make it obvious which station the plot is centred on. */
+    {
+        time_t now_t = time(NULL);
+        struct tm *lt = localtime(&now_t);
+        char tbuf[40] = "";
+        if (lt)
+            strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M:%S local", lt);
+        SetTextAlign(hdcMem, TA_LEFT | TA_BOTTOM);
+        SetTextColor(hdcMem, SKY_AXIS_COLOR);
+        TextOut(hdcMem, 8, h - 6, tbuf, (int)strlen(tbuf));
+
+        /* Right side: "MountPoint | lat lon alt"  */
+        bool   have_arp = false;
+        double lat = 0, lon = 0, alt = 0;
+        rtcm_get_station_arp(&have_arp, NULL, NULL, NULL, &lat, &lon, &alt);
+
+        const char *mp = (state) ? state->config.MOUNTPOINT : "";
+        if (!mp) mp = "";
+
+        char rbuf[512];   /* MOUNTPOINT is up to 256 bytes */
+        if (have_arp) {
+            snprintf(rbuf, sizeof(rbuf),
+                     "%s   ARP: %.6f, %.6f, %.1f m",
+                     mp[0] ? mp : "(none)", lat, lon, alt);
+        } else if (mp[0]) {
+            snprintf(rbuf, sizeof(rbuf),
+                     "%s   ARP: (waiting for RTCM 1005/1006)", mp);
+        } else {
+            rbuf[0] = '\0';
+        }
+
+        if (rbuf[0]) {
+            SetTextAlign(hdcMem, TA_RIGHT | TA_BOTTOM);
+            TextOut(hdcMem, w - 8, h - 6, rbuf, (int)strlen(rbuf));
+        }
+
+        /* restore default alignment so subsequent draws are predictable */
+        SetTextAlign(hdcMem, TA_LEFT | TA_TOP);
+    }
+
+    SelectObject(hdcMem, hFontOld);
+}
+
 /**
  * @brief Prompt the user for a PNG path and save the sky-window snapshot.
  *
@@ -743,7 +971,21 @@ BOOL SkySavePngWithPrompt(HWND hSky, AppState *state)
     if (!GetSaveFileNameA(&ofn))
         return FALSE;   /* user cancelled */
 
-    BOOL ok = save_window_as_png(hSky, filename);
+    /* Paint a fresh frame off screen and encode it with the CLI's PNG
+     * writer: what the window shows, even where it is covered. */
+    BOOL ok = FALSE;
+    RECT rc;
+    HDC  hdcRef = GetDC(hSky);
+    if (hdcRef && GetClientRect(hSky, &rc)) {
+        SnapshotDib buf;
+        if (snapshot_dib_begin(&buf, hdcRef, rc.right - rc.left, rc.bottom - rc.top)) {
+            SkyPaint(&buf, hdcRef, (AppState *)GetWindowLongPtr(hSky, GWLP_USERDATA),
+                     buf.img.w, buf.img.h);
+            ok = snapshot_dib_save_png(&buf, filename);
+            snapshot_dib_end(&buf);
+        }
+    }
+    if (hdcRef) ReleaseDC(hSky, hdcRef);
 
     if (state && state->hEditLog) {
         char msg[MAX_PATH + 64];
@@ -768,7 +1010,8 @@ static LRESULT CALLBACK SkyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
         CREATESTRUCT *cs = (CREATESTRUCT *)lParam;
         SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)cs->lpCreateParams);
         /* 1-Hz heartbeat for the footer clock.  Repaints the whole window
-         * — double-buffered draw keeps it cheap. */
+         * — double-buffered draw on top of the retained track layer
+         * keeps it cheap. */
         SetTimer(hwnd, IDT_SKY_CLOCK, 1000, NULL);
         return 0;
     }
@@ -784,6 +1027,7 @@ static LRESULT CALLBACK SkyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 
     case WM_PAINT: {
         AppState *state = (AppState *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+        uint64_t t_lag = ui_lag_now();
 
         PAINTSTRUCT ps;
         HDC hdcScreen = BeginPaint(hwnd, &ps);
@@ -793,161 +1037,20 @@ static LRESULT CALLBACK SkyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
         int w = rc.right - rc.left;
         int h = rc.bottom - rc.top;
 
-        HDC     hdcMem  = CreateCompatibleDC(hdcScreen);
-        HBITMAP bmpMem  = CreateCompatibleBitmap(hdcScreen, w, h);
-        HBITMAP bmpOld  = (HBITMAP)SelectObject(hdcMem, bmpMem);
-        HFONT   hFont   = (HFONT)GetStockObject(DEFAULT_GUI_FONT);
-        HFONT   hFontOld = (HFONT)SelectObject(hdcMem, hFont);
-
-        int cx = 0, cy = 0, radius = 0;
-        DrawSkyFill(hdcMem, w, h, &cx, &cy, &radius);
-
-        /* Heatmap goes between background fill and foreground grid so the
-         * compass rose, rings and labels stay legible. */
-        if (state && state->skyState.mode == SKY_MODE_HEATMAP)
-            DrawSkyHeatmap(hdcMem, state, cx, cy, radius);
-
-        DrawSkyGrid(hdcMem, cx, cy, radius);
-
-        int drawn = (state && state->skyState.mode == SKY_MODE_MARKERS)
-                    ? DrawSkyMarkers(hdcMem, state, cx, cy, radius)
-                    : 0;
-
-        /* ── Diagnostic status line ────────────────────────────────
-         * Distinguishes the two prerequisites so the user knows what
-         * to look for in their RTCM stream. */
-        bool   have_arp = false;
-        double arp_lat = 0, arp_lon = 0;
-        rtcm_get_station_arp(&have_arp, NULL, NULL, NULL,
-                             &arp_lat, &arp_lon, NULL);
-
-        int eph_gps = 0, eph_glo = 0, eph_gal = 0, eph_qzs = 0, eph_bds = 0;
-        for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
-            if (sv_eph_get(1, p)) eph_gps++;
-            if (sv_eph_get(2, p)) eph_glo++;
-            if (sv_eph_get(3, p)) eph_gal++;
-            if (sv_eph_get(4, p)) eph_qzs++;
-            if (sv_eph_get(5, p)) eph_bds++;
+        SnapshotDib buf;
+        if (snapshot_dib_begin(&buf, hdcScreen, w, h)) {
+            SkyPaint(&buf, hdcScreen, state, w, h);
+            BitBlt(hdcScreen, 0, 0, w, h, buf.hdc, 0, 0, SRCCOPY);
+            snapshot_dib_end(&buf);
         }
-        int eph_total = eph_gps + eph_glo + eph_gal + eph_qzs + eph_bds;
-
-        SetTextAlign(hdcMem, TA_LEFT | TA_TOP);
-        SetTextColor(hdcMem, SKY_STATUS_COLOR);
-
-        char line1[160];
-        if (drawn > 0) {
-            snprintf(line1, sizeof(line1),
-                     "Tracking %d sat%s  (eph G:%d R:%d E:%d J:%d C:%d)",
-                     drawn, drawn == 1 ? "" : "s",
-                     eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
-        } else if (!have_arp && eph_total == 0) {
-            snprintf(line1, sizeof(line1),
-                     "Waiting: no RTCM 1005/1006 + no 1019/1020/1042/1044/1045 yet");
-        } else if (!have_arp) {
-            snprintf(line1, sizeof(line1),
-                     "Have %d eph (G:%d R:%d E:%d J:%d C:%d); need RTCM 1005/1006",
-                     eph_total, eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
-        } else if (eph_total == 0) {
-            snprintf(line1, sizeof(line1),
-                     "Have station ARP; need RTCM 1019/1020/1042/1044/1045/1046");
-        } else {
-            snprintf(line1, sizeof(line1),
-                     "ARP + eph G:%d R:%d E:%d J:%d C:%d; awaiting next MSM frame",
-                     eph_gps, eph_glo, eph_gal, eph_qzs, eph_bds);
-        }
-        TextOut(hdcMem, 8, 6, line1, (int)strlen(line1));
-
-        /* Second line: mode + hint + keyboard / mouse shortcuts.  In marker
-         * mode we also surface the per-GNSS legend filter when active so it
-         * is obvious why some constellations are hidden. */
-        char mode_label[160];
-        if (state && state->skyState.mode == SKY_MODE_HEATMAP) {
-            snprintf(mode_label, sizeof(mode_label),
-                     "Mode: Heatmap (observed/expected per sector)  [M=toggle  S=save]");
-        } else {
-            int f = state ? state->skyState.filter_gnss_id : 0;
-            const char *fname = "";
-            switch (f) {
-            case 1: fname = "GPS";   break;
-            case 2: fname = "GLO";   break;
-            case 3: fname = "GAL";   break;
-            case 4: fname = "QZS";   break;
-            case 5: fname = "BDS";   break;
-            case 6: fname = "SBAS";  break;
-            case 7: fname = "NAVIC"; break;
-            default: break;
-            }
-            if (f && fname[0]) {
-                snprintf(mode_label, sizeof(mode_label),
-                         "Mode: Live SVs  [Filter: %s only -- click chip to clear  |  M=toggle  S=save]",
-                         fname);
-            } else {
-                snprintf(mode_label, sizeof(mode_label),
-                         "Mode: Live SVs (brightness ~ CNR; click SV for detail, click legend chip to filter)  [M=toggle  S=save]");
-            }
-        }
-        TextOut(hdcMem, 8, 22, mode_label, (int)strlen(mode_label));
-
-        /* Third line: mode-specific colour legend */
-        SkyPlotMode legend_mode =
-            (state) ? state->skyState.mode : SKY_MODE_MARKERS;
-        int legend_filter = (state) ? state->skyState.filter_gnss_id : 0;
-        DrawSkyLegend(hdcMem, 8, 38, legend_mode, legend_filter);
-
-        /* Footer:  live local time on the left, station identity on the right.
-         * The right side shows the mountpoint + ARP coords so PNG snapshots
-         * make it obvious which station the plot is centred on. */
-        {
-            time_t now_t = time(NULL);
-            struct tm *lt = localtime(&now_t);
-            char tbuf[40] = "";
-            if (lt)
-                strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M:%S local", lt);
-            SetTextAlign(hdcMem, TA_LEFT | TA_BOTTOM);
-            SetTextColor(hdcMem, SKY_AXIS_COLOR);
-            TextOut(hdcMem, 8, h - 6, tbuf, (int)strlen(tbuf));
-
-            /* Right side: "MountPoint | lat lon alt"  */
-            bool   have_arp = false;
-            double lat = 0, lon = 0, alt = 0;
-            rtcm_get_station_arp(&have_arp, NULL, NULL, NULL, &lat, &lon, &alt);
-
-            const char *mp = (state) ? state->config.MOUNTPOINT : "";
-            if (!mp) mp = "";
-
-            char rbuf[512];   /* MOUNTPOINT is up to 256 bytes */
-            if (have_arp) {
-                snprintf(rbuf, sizeof(rbuf),
-                         "%s   ARP: %.6f, %.6f, %.1f m",
-                         mp[0] ? mp : "(none)", lat, lon, alt);
-            } else if (mp[0]) {
-                snprintf(rbuf, sizeof(rbuf),
-                         "%s   ARP: (waiting for RTCM 1005/1006)", mp);
-            } else {
-                rbuf[0] = '\0';
-            }
-
-            if (rbuf[0]) {
-                SetTextAlign(hdcMem, TA_RIGHT | TA_BOTTOM);
-                TextOut(hdcMem, w - 8, h - 6, rbuf, (int)strlen(rbuf));
-            }
-
-            /* restore default alignment so subsequent draws are predictable */
-            SetTextAlign(hdcMem, TA_LEFT | TA_TOP);
-        }
-
-        BitBlt(hdcScreen, 0, 0, w, h, hdcMem, 0, 0, SRCCOPY);
-
-        SelectObject(hdcMem, hFontOld);
-        SelectObject(hdcMem, bmpOld);
-        DeleteObject(bmpMem);
-        DeleteDC(hdcMem);
 
         EndPaint(hwnd, &ps);
+        if (state) ui_lag_paint(&state->uiLag, UI_LAG_WND_SKY, t_lag);
         return 0;
     }
 
     case WM_SIZE:
+        g_track_layer.valid = false;
         InvalidateRect(hwnd, NULL, FALSE);
         return 0;
 
@@ -1013,6 +1116,7 @@ static LRESULT CALLBACK SkyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 
     case WM_DESTROY: {
         KillTimer(hwnd, IDT_SKY_CLOCK);
+        sky_layer_free();
         AppState *state = (AppState *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
         if (state && state->hSkyWnd == hwnd) {
             /* Capture the un-minimised screen rect so the next open
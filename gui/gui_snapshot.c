@@ -1,10 +1,9 @@
 /**
  * @file gui_snapshot.c
- * @brief Window-to-PNG capture via GDI+ flat C API.
+ * @brief DIB-section back buffers; PNG snapshots through raster.c.
  *
- * MinGW's <gdiplus.h> requires C++; we sidestep that by forward-declaring
- * just the half-dozen GDI+ flat functions we need from gdiplus.dll.  Link
- * line gets `-lgdiplus`.
+ * The DIB section is top-down 32 bpp BI_RGB: B, G, R, 0 per pixel, which
+ * read as a little-endian uint32_t is the 0x00RRGGBB of a RasterImage.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -13,123 +12,53 @@
 
 #include "gui_snapshot.h"
 
-#include <objbase.h>    /* GUID / CLSID */
-#include <stdio.h>
+#include <string.h>
 
-/* ── GDI+ flat C API (gdiplus.dll exports) ───────────────────────────── */
-
-typedef int          GpStatus;
-#define GDIP_OK      0
-
-typedef struct {
-    UINT32   GdiplusVersion;
-    void    *DebugEventCallback;
-    BOOL     SuppressBackgroundThread;
-    BOOL     SuppressExternalCodecs;
-} GdiplusStartupInput;
-
-typedef void GpImage;
-typedef void GpBitmap;
-
-WINAPI GpStatus GdiplusStartup(ULONG_PTR *token,
-                               const GdiplusStartupInput *input,
-                               void *output);
-WINAPI void     GdiplusShutdown(ULONG_PTR token);
-
-WINAPI GpStatus GdipCreateBitmapFromHBITMAP(HBITMAP hbm, HPALETTE hpal,
-                                            GpBitmap **bitmap);
-WINAPI GpStatus GdipSaveImageToFile(GpImage *image, const WCHAR *filename,
-                                    const CLSID *clsidEncoder,
-                                    const void *encoderParams);
-WINAPI GpStatus GdipDisposeImage(GpImage *image);
-
-/* PNG encoder CLSID, per Microsoft Image Format CLSIDs documentation:
- * {557CF406-1A04-11D3-9A73-0000F81EF32E} */
-static const CLSID PNG_ENCODER_CLSID = {
-    0x557CF406, 0x1A04, 0x11D3,
-    { 0x9A, 0x73, 0x00, 0x00, 0xF8, 0x1E, 0xF3, 0x2E }
-};
-
-static ULONG_PTR g_gdiplus_token = 0;
-static BOOL      g_gdiplus_initialised = FALSE;
-
-static BOOL ensure_gdiplus(void)
+BOOL snapshot_dib_begin(SnapshotDib *d, HDC hdcRef, int w, int h)
 {
-    if (g_gdiplus_initialised) return TRUE;
-    GdiplusStartupInput in = { 1, NULL, FALSE, FALSE };
-    if (GdiplusStartup(&g_gdiplus_token, &in, NULL) != GDIP_OK)
+    memset(d, 0, sizeof(*d));
+    if (w <= 0 || h <= 0) return FALSE;
+
+    BITMAPINFO bi;
+    ZeroMemory(&bi, sizeof(bi));
+    bi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth       = w;
+    bi.bmiHeader.biHeight      = -h;        /* negative: top-down rows */
+    bi.bmiHeader.biPlanes      = 1;
+    bi.bmiHeader.biBitCount    = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    void *bits = NULL;
+    d->hdc = CreateCompatibleDC(hdcRef);
+    d->bmp = d->hdc ? CreateDIBSection(d->hdc, &bi, DIB_RGB_COLORS, &bits, NULL, 0)
+                    : NULL;
+    if (!d->hdc || !d->bmp || !bits) {
+        if (d->bmp) DeleteObject(d->bmp);
+        if (d->hdc) DeleteDC(d->hdc);
+        memset(d, 0, sizeof(*d));
         return FALSE;
-    g_gdiplus_initialised = TRUE;
+    }
+    d->bmp_old    = (HBITMAP)SelectObject(d->hdc, d->bmp);
+    d->img.px     = (uint32_t *)bits;
+    d->img.w      = w;
+    d->img.h      = h;
+    d->img.stride = w;                      /* 32-bpp rows need no padding */
     return TRUE;
 }
 
-void gui_snapshot_shutdown(void)
+void snapshot_dib_end(SnapshotDib *d)
 {
-    if (g_gdiplus_initialised) {
-        GdiplusShutdown(g_gdiplus_token);
-        g_gdiplus_initialised = FALSE;
-        g_gdiplus_token = 0;
+    if (d->hdc) {
+        SelectObject(d->hdc, d->bmp_old);
+        DeleteObject(d->bmp);
+        DeleteDC(d->hdc);
     }
+    memset(d, 0, sizeof(*d));
 }
 
-BOOL save_window_as_png(HWND hwnd, const char *filename)
+BOOL snapshot_dib_save_png(SnapshotDib *d, const char *filename)
 {
-    if (!hwnd || !filename) return FALSE;
-    if (!ensure_gdiplus()) return FALSE;
-
-    /* ── Capture the window's client area via BitBlt ────────────── */
-    RECT rc;
-    if (!GetClientRect(hwnd, &rc)) return FALSE;
-    int w = rc.right  - rc.left;
-    int h = rc.bottom - rc.top;
-    if (w <= 0 || h <= 0) return FALSE;
-
-    HDC hdcSrc = GetDC(hwnd);
-    if (!hdcSrc) return FALSE;
-
-    HDC     hdcMem = CreateCompatibleDC(hdcSrc);
-    HBITMAP hbm    = CreateCompatibleBitmap(hdcSrc, w, h);
-    if (!hdcMem || !hbm) {
-        if (hbm)    DeleteObject(hbm);
-        if (hdcMem) DeleteDC(hdcMem);
-        ReleaseDC(hwnd, hdcSrc);
-        return FALSE;
-    }
-
-    HBITMAP hbmOld = (HBITMAP)SelectObject(hdcMem, hbm);
-    BOOL    blt_ok = BitBlt(hdcMem, 0, 0, w, h, hdcSrc, 0, 0, SRCCOPY);
-    SelectObject(hdcMem, hbmOld);
-    DeleteDC(hdcMem);
-    ReleaseDC(hwnd, hdcSrc);
-
-    if (!blt_ok) {
-        DeleteObject(hbm);
-        return FALSE;
-    }
-
-    /* ── Convert filename to UTF-16 for GDI+ ─────────────────────── */
-    WCHAR wfilename[1024];
-    int   wlen = MultiByteToWideChar(CP_ACP, 0, filename, -1,
-                                     wfilename,
-                                     (int)(sizeof(wfilename) / sizeof(WCHAR)));
-    if (wlen <= 0) {
-        DeleteObject(hbm);
-        return FALSE;
-    }
-
-    /* ── Wrap HBITMAP, save as PNG ──────────────────────────────── */
-    GpBitmap *bmp = NULL;
-    GpStatus  status = GdipCreateBitmapFromHBITMAP(hbm, NULL, &bmp);
-    if (status != GDIP_OK || !bmp) {
-        DeleteObject(hbm);
-        return FALSE;
-    }
-
-    status = GdipSaveImageToFile((GpImage *)bmp, wfilename,
-                                 &PNG_ENCODER_CLSID, NULL);
-
-    GdipDisposeImage((GpImage *)bmp);
-    DeleteObject(hbm);
-
-    return (status == GDIP_OK);
+    if (!d->hdc || !filename) return FALSE;
+    GdiFlush();                             /* finish the GDI drawing first */
+    return raster_write_png(&d->img, filename) ? TRUE : FALSE;
 }
@@ -1,9 +1,12 @@
 /**
  * @file gui_snapshot.h
- * @brief Window-to-PNG snapshot helper for NTRIP-Analyser GUI.
+ * @brief DIB-section back buffers and PNG snapshots for NTRIP-Analyser GUI.
  *
- * Uses the GDI+ flat C API (gdiplus.dll exports) to encode an HBITMAP
- * as PNG without needing C++.  Initialised lazily on first save.
+ * A SnapshotDib is a memory DC on a top-down 32-bpp DIB section whose
+ * bits are also a RasterImage (raster.h): GDI draws on the DC, the shared
+ * software rasteriser writes the pixels, and the result is blitted to the
+ * screen or saved with raster_write_png() -- the CLI's PNG writer, so no
+ * GDI+ is involved.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -16,16 +19,36 @@
 #define _WIN32_WINNT 0x0601
 #include <windows.h>
 
+#include "raster.h"
+
 /**
- * @brief Capture the client area of @p hwnd and save it as a PNG.
+ * @struct SnapshotDib
+ * @brief A memory DC and the DIB section selected into it.
+ */
+typedef struct {
+    HDC         hdc;
+    HBITMAP     bmp;
+    HBITMAP     bmp_old;
+    RasterImage img;        /**< the DIB bits; GdiFlush() before touching them */
+} SnapshotDib;
+
+/**
+ * @brief Create a @p w x @p h DIB section and a DC on it.
  *
- * @param hwnd     The window whose client area should be captured.
- * @param filename Output path (UTF-8 / ANSI; converted to UTF-16 inside).
- * @return TRUE on success, FALSE on any failure.
+ * @param hdcRef  DC the memory DC is made compatible with (NULL = screen).
+ * @return TRUE on success; on failure @p d is zeroed.
  */
-BOOL save_window_as_png(HWND hwnd, const char *filename);
+BOOL snapshot_dib_begin(SnapshotDib *d, HDC hdcRef, int w, int h);
 
-/** @brief Shutdown GDI+ if it was initialised.  Optional; call on app exit. */
-void gui_snapshot_shutdown(void);
+/** @brief Release the DC and the DIB section (a zeroed @p d is ignored). */
+void snapshot_dib_end(SnapshotDib *d);
+
+/**
+ * @brief Save what has been drawn on @p d as a PNG.
+ *
+ * @param filename Output path.
+ * @return TRUE on success, FALSE on any failure.
+ */
+BOOL snapshot_dib_save_png(SnapshotDib *d, const char *filename);
 
 #endif /* GUI_SNAPSHOT_H */
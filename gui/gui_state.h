@@ -19,7 +19,27 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include "ntrip_handler.h"
+#include "rtcm3x_parser.h"
+#include "anomaly_ring.h"
+#include "rtcm_framer.h"
 #include "sv_ephemeris.h"
+#include "sky_epoch.h"
+#include "rtcm_recorder.h"
+#include "geo_index.h"
+#include "gui_frame_queue.h"
+#include "gui_sky_track.h"
+#include "gui_cnr_history.h"
+#include "gui_type_map.h"
+#include "gui_list_model.h"
+#include "gui_ui_lag.h"
+#include "perf_probe.h"
+#include "bw_meter.h"
+#include "corr_age.h"
+#include "obs_quality.h"
+#include "quantile_sketch.h"
+#include "rollup.h"
+#include "stats_snapshot.h"
+#include "load_governor.h"
 
 /* ── Application constants ────────────────────────────────── */
 #define APP_TITLE       "NTRIP-Analyser"
@@ -48,29 +68,197 @@
 /* ── Sky-SV detail window class ─────────────────────────── */
 #define SV_DETAIL_CLASS_NAME    "NtripSkySvDetailClass"
 
+/* ── History window class ───────────────────────────────── */
+#define HISTORY_CLASS_NAME      "NtripHistoryClass"
+
+/* ── Worker -> UI update channel ─────────────────────────────
+ * Per-frame results travel from the decode / replay worker to the UI
+ * thread through AppState::uiQueue instead of one HeapAlloc'd
+ * PostMessage per frame.  The UI drains the queue on IDT_UI_BATCH, or
+ * sooner when the worker posts WM_APP_UI_BATCH because a batch filled. */
+#define UI_QUEUE_SIZE        (1u << 21)   /* ring bytes (~300 MSM frames) */
+#define UI_BATCH_KICK_BYTES  (64 * 1024)  /* queued bytes that trigger a kick */
+#define UI_BATCH_INTERVAL_MS 50           /* IDT_UI_BATCH period */
+#define UI_DETAIL_REFRESH_MS 100          /* open detail windows redraw at most this often */
+
+/* ── Worker -> UI statistics snapshot ────────────────────────
+ * The producer (decode or replay worker) keeps the message, satellite
+ * and age-of-corrections statistics in AppState::statsWork and publishes
+ * a copy to AppState::statsSnap every UI_STATS_PUBLISH_MS and at stream
+ * end; the UI thread copies the newest one out on IDT_UI_BATCH. */
+#define GUI_STAT_TYPES       GUI_TYPE_MAP_CAP  /* distinct message types per stream */
+#define UI_STATS_PUBLISH_MS  200
+
+/* Record tags on AppState::uiQueue. */
+#define UI_REC_FRAME  1   /* UiFrameRec, frame bytes, then RtcmMsmObs if has_msm */
+#define UI_REC_SKY    2   /* SkySatUpdate[n], n = len / sizeof(SkySatUpdate) */
+
 /**
- * @struct RtcmRawMsg
- * @brief Heap-allocated copy of a raw RTCM frame, posted from worker to UI.
+ * @struct UiFrameRec
+ * @brief Header of a UI_REC_FRAME record: one CRC-valid RTCM frame.
+ *
+ * The frame bytes follow the header.  For MSM frames the worker also
+ * appends the RtcmMsmObs it already decoded, so the UI thread formats
+ * the detail text without parsing the payload a second time.  Record
+ * storage is only 4-byte aligned; copy the RtcmMsmObs out before use.
+ *
+ * The perf stamps are perf_now_ns() / 1000 cut to 32 bits: the UI only
+ * takes differences, which stay exact across the 71-minute wrap.
  */
 typedef struct {
     int msg_type;
-    int length;
-    unsigned char data[GUI_BUFFER_SIZE];
-} RtcmRawMsg;
+    int frame_len;
+    int has_msm;                /**< an RtcmMsmObs follows the frame bytes */
+    unsigned int t_recv_us;     /**< recv() that delivered the frame; 0 = not timed */
+    unsigned int t_push_us;     /**< pushed to the UI queue; 0 = not timed */
+} UiFrameRec;
+
+/**
+ * @struct UiLastFrame
+ * @brief Newest frame of one message type, kept raw for the detail window.
+ *
+ * The UI batch only copies the frame here; it is formatted to text when
+ * the type's detail window opens, and for an open window at most once
+ * per UI_DETAIL_REFRESH_MS, so types nobody is looking at cost a memcpy.
+ */
+typedef struct {
+    int           frame_len;
+    int           has_msm;              /**< @c msm holds the worker's decode */
+    BOOL          dirty;                /**< newer than the window's text */
+    unsigned char frame[RTCM_FRAME_MAX];
+    RtcmMsmObs    msm;
+} UiLastFrame;
+
+/* ── Worker log rings (gui_log.c) ─────────────────────────── */
+#define GUI_LOG_RING_SIZE   (64 * 1024)  /* bytes per ring */
+#define GUI_LOG_RATE_LINES  50           /* lines per second per ring; more are dropped */
+#define GUI_LOG_TRACE_MS    500          /* message-number trace line flushed this often */
+#define GUI_LOG_MAX_CHARS   (768 * 1024) /* log panel trimmed to 3/4 beyond this */
+
+/** @brief Log line levels; warnings and errors are never rate limited. */
+typedef enum {
+    GUI_LOG_TRACE,   /**< running message-number trace */
+    GUI_LOG_INFO,
+    GUI_LOG_WARN,
+    GUI_LOG_ERROR
+} GuiLogLevel;
+
+/** @brief One ring per worker thread role (a ring has one producer). */
+enum {
+    GUI_LOG_SRC_STREAM,   /* obs I/O worker or replay worker */
+    GUI_LOG_SRC_DECODE,   /* obs decode thread */
+    GUI_LOG_SRC_EPH,      /* eph worker */
+    GUI_LOG_SRC_COUNT
+};
+
+/**
+ * @struct GuiLogRing
+ * @brief Log lines of one worker thread on their way to the log panel.
+ *
+ * A record is a LONG sequence number (so the UI can merge the rings in
+ * order) followed by the text; the tag is the GuiLogLevel.  Everything
+ * but the queue is touched only by the producing thread.
+ *
+ * Fields:
+ *   - q:           The ring (gui_frame_queue.h).
+ *   - rate_tick:   GetTickCount() at the start of the rate window.
+ *   - rate_lines:  Lines accepted in the window.
+ *   - suppressed:  Lines dropped by the rate limit, reported with the
+ *                  next line that passes.
+ *   - trace, trace_len, trace_tick: Message numbers not yet pushed, and
+ *                  when the first of them arrived.
+ */
+typedef struct {
+    GuiFrameQueue q;
+    DWORD         rate_tick;
+    int           rate_lines;
+    long          suppressed;
+    char          trace[160];
+    int           trace_len;
+    DWORD         trace_tick;
+} GuiLogRing;
 
 /**
  * @struct GuiMsgStat
  * @brief Per-message-type statistics collected during stream reception.
  */
 typedef struct {
-    int    count;
-    double min_dt;
-    double max_dt;
-    double sum_dt;
-    double last_time;
-    bool   seen;
+    int     count;
+    double  min_dt;
+    double  max_dt;
+    double  sum_dt;
+    double  last_time;
+    bool    seen;
+    QSketch dt;             /**< interval distribution (p50 .. p99.9 columns) */
+    BwMeter bw;             /**< producer: bytes over the 1 s / 10 s / 60 s windows */
+    BwRates bwRates;        /**< ... as of the publish (Bytes .. Burst columns) */
 } GuiMsgStat;
 
+/**
+ * @struct GuiStats
+ * @brief The statistics block the producer publishes to the UI.
+ *
+ * @c stat[k] belongs to message type @c type[k]; slots are taken in
+ * first-seen order and never move during a stream.  Types beyond
+ * GUI_STAT_TYPES get no row.
+ */
+typedef struct {
+    int             n_types;
+    int             type[GUI_STAT_TYPES];
+    GuiMsgStat      stat[GUI_STAT_TYPES];
+    BwBurst         burst;      /**< epoch bursts of the stream (status bar) */
+    SatStatsSummary sats;
+    CorrAge         corrAge;
+    ObsQualityStats quality;    /**< signal quality counts (Signal Quality tab) */
+    uint64_t        t_publish_ns; /**< perf_now_ns() of the publish; 0 = not timed */
+} GuiStats;
+
+/** @brief Columns of the mountpoint ListView (Mountpoint .. Distance). */
+#define GUI_MOUNT_COLS  11
+
+/** @brief The Distance column, computed from the user position on demand. */
+#define GUI_MOUNT_COL_DIST  10
+
+/**
+ * @struct GuiMountRow
+ * @brief One STR entry of the mountpoint table.
+ *
+ * cell[c] is the offset of the text of column c (Mountpoint .. Lon) in
+ * GuiMountTable::pool; num[] holds Lat and Lon as numbers.
+ */
+typedef struct {
+    unsigned cell[GUI_MOUNT_COL_DIST];
+    double   num[2];
+} GuiMountRow;
+
+/**
+ * @struct GuiMountTable
+ * @brief The sourcetable behind the owner-data mountpoint ListView.
+ *
+ * The ListView stores no text: it asks for the cells of the rows it
+ * paints (LVN_GETDISPINFO) and they are looked up through order[].
+ * The ascending row order of a column is built the first time the
+ * column is sorted and kept until more rows arrive; a descending sort
+ * reads it backwards.  Rows are added while the sourcetable downloads
+ * (MountTableAppend()), so the list fills before the transfer ends.
+ *
+ * geo indexes the row positions (geo_index.h) for "nearest mountpoints"
+ * queries, so a new user position needs no pass over every row: only
+ * the distances of the rows on screen are computed.
+ */
+typedef struct {
+    char        *pool;                   /* NUL-terminated cell text */
+    size_t       pool_len, pool_cap;
+    GuiMountRow *rows;
+    int          count, cap;
+    int         *order;                  /* display index -> row */
+    int         *sorted[GUI_MOUNT_COLS]; /* ascending row order, NULL until sorted */
+    int          sortCol;                /* -1 = sourcetable order */
+    BOOL         sortAsc;
+    GeoIndex    *geo;                    /* row positions; NULL if none */
+    double       originLat, originLon;   /* user position; 0/0 = unset */
+} GuiMountTable;
+
 /**
  * @brief High-resolution monotonic timer (seconds).
  */
@@ -86,55 +274,12 @@ static inline double gui_get_time_seconds(void) {
     return (double)now.QuadPart / freq.QuadPart;
 }
 
-/** @brief A single past (az, el) sample for a satellite's track trail. */
-typedef struct {
-    float  az_deg;
-    float  el_deg;
-    double ts;            /**< gui_get_time_seconds() when the point was added */
-} SkyTrackPoint;
-
-/** @brief Sampling interval (seconds) between track-buffer points.
- *
- * Tighter = denser dots / smoother line; coarser = longer history per SV.
- * Window per SV = SKY_TRACK_CAP * SKY_TRACK_INTERVAL_S seconds.
- * Default 60 s × 1440 = 86400 s = 24 hours of trail per SV -- enough
- * for a typical long-running session to keep the trail for the whole
- * capture.  The polyline renderer in gui_sky_window.c connects
- * consecutive samples into a smooth arc regardless of the dot
- * spacing; at GLONASS orbital speed (~4 km/s) 60-s dots land ~7
- * pixels apart on an 800-px plot, which reads as continuous.  Runs
- * are split where consecutive samples are more than
- * SKY_TRACK_GAP_BREAK_S apart in time, so a satellite that sets and
- * later rises again is drawn as two separate arcs rather than a
- * straight chord across the plot.
- *
- * Memory cost: SKY_TRACK_CAP * sizeof(SkyTrackPoint) per SV slot
- *            = SKY_TRACK_CAP * 24 B * 8 GNSS * 64 PRN
- *            = 17.7 MB at the default 1440 entries.  Lower
- * SKY_TRACK_CAP if you want a tighter memory footprint at the cost
- * of shorter trails.
- */
-#define SKY_TRACK_INTERVAL_S    60.0
-
-/** @brief Break the polyline if two consecutive samples are this many
- * seconds apart -- protects against drawing a straight chord across
- * the plot when an SV sets and rises hours later. */
-#define SKY_TRACK_GAP_BREAK_S   300.0
-
-/** @brief Ring buffer of past positions for one satellite (since stream open). */
-#define SKY_TRACK_CAP   1440    /* 24 hours at SKY_TRACK_INTERVAL_S = 60 s/point */
-typedef struct {
-    SkyTrackPoint pts[SKY_TRACK_CAP];
-    int           head;   /**< next write index */
-    int           count;  /**< 0..SKY_TRACK_CAP */
-} SkyTrackBuffer;
-
 /**
  * @struct SkySat
  * @brief Last-known sky position of a single satellite + its track trail.
  *
  * One slot per (gnss_id, prn) in @ref SkyPlotState.  Updated each MSM
- * epoch by WM_APP_SKY_UPDATE from the worker thread.  Stale entries
+ * epoch from the worker's UI_REC_SKY records.  Stale entries
  * (last_seen_ts older than ~30 s) are filtered out at paint time.
  */
 typedef struct {
@@ -143,7 +288,7 @@ typedef struct {
     double last_seen_ts;  /**< gui_get_time_seconds() at last update */
     float  cnr_dbhz;      /**< best CNR this epoch (0 = unknown) */
     bool   valid;
-    SkyTrackBuffer track; /**< history of observed positions since stream open */
+    SkyTrack track;       /**< history of observed positions since stream open */
 } SkySat;
 
 /* ── Sky-plot sector grid (Onocoy-style observed-vs-expected heatmap) ─────
@@ -182,7 +327,11 @@ typedef enum {
 typedef struct {
     SkySat sats[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
 
-    /* Sector grid for heatmap mode.  Filled by WM_APP_SKY_UPDATE handler
+    /* Blocks behind every sats[][].track.  Reset with the tracks when a
+     * new stream is opened; SVs that never appear take none. */
+    SkyTrackArena tracks;
+
+    /* Sector grid for heatmap mode.  Filled by the UI batch drain
      * as SkySatUpdate entries arrive (observed_flag picks observed++ vs
      * expected++).  Reset to zero when a new stream is opened. */
     SkySector sectors[SKY_N_EL_BANDS][SKY_MAX_AZ_BINS];
@@ -201,10 +350,10 @@ extern const int sky_az_bins_per_band[SKY_N_EL_BANDS];
 
 /**
  * @struct SkySatUpdate
- * @brief One-shot update payload posted from the worker thread per MSM epoch.
+ * @brief Per-SV sky update produced by the worker thread per MSM frame.
  *
- * Allocated with HeapAlloc(GetProcessHeap(), 0, count*sizeof(SkySatUpdate)).
- * Worker passes pointer + count via WM_APP_SKY_UPDATE; UI handler frees it.
+ * The worker pushes an array of these as one UI_REC_SKY record on
+ * AppState::uiQueue; an empty record just refreshes the sky status line.
  */
 typedef struct {
     int   gnss_id;
@@ -242,14 +391,18 @@ typedef struct {
     HWND hBtnMapPick;       /* "Map" button: open browser map */
     HWND hBtnMapPaste;      /* "<<" button: paste coords from clipboard */
 
-    /* ── Mountpoint ListView ──────────────────────────────── */
+    /* ── Mountpoint ListView (owner-data, rows in mountTable) */
     HWND hLvMountpoints;
+    GuiMountTable mountTable;
+    BOOL mountStreaming;    /* WM_APP_MOUNT_ROWS seen for the current fetch */
 
     /* ── Tab control + child panels ───────────────────────── */
     HWND hTabOutput;
     HWND hEditLog;
     HWND hLvMsgStats;
     HWND hLvSatellites;
+    HWND hLvPerf;               /* Performance tab: stage latency */
+    HWND hLvQuality;            /* Signal Quality tab: slips, gaps, CNR drops */
 
     /* ── Status bar ───────────────────────────────────────── */
     HWND hStatusBar;
@@ -293,19 +446,101 @@ typedef struct {
     int savedStderr;
 
     /* ── Real-time message statistics ─────────────────────── */
-    GuiMsgStat msgStats[GUI_MAX_MSG_TYPES];
+    /* Producer side: statsWork and statsTypes (type -> slot) belong to
+     * the decode / replay thread, which publishes statsWork to statsSnap
+     * (statsPublishTick = GetTickCount() of the last publish).  UI side:
+     * the newest snapshot is read into statsRead and, if consistent,
+     * spread into msgStats / satStats / corrAge / qualityStats, the UI's
+     * own copies the lists draw from; statsSeen is the snapshot version
+     * they hold.  obsQuality is the producer's signal quality engine,
+     * its counts go out in statsWork.quality. */
+    GuiStats      statsWork;
+    GuiTypeMap    statsTypes;
+    ObsQuality    obsQuality;
+    /* Constellations the obs stream observes and carries ephemerides
+     * for; also the producer's (worker_obs_eph()). */
+    NtripEphCoverage ephCoverage;
+    DWORD         statsPublishTick;
+    StatsSnapshot statsSnap;
+    GuiStats      statsRead;
+    uint32_t      statsSeen;
+
+    /* UI per-type state: msgTypes gives each message type seen the
+     * index k its msgStats / statRowOf / hDetailWnds / lastFrame entries
+     * live at; msgTypes.type[0 .. n-1] lists the live ones.  Rebuilt
+     * when a new stream or replay starts (UiTypesReset()). */
+    GuiTypeMap msgTypes;
+    GuiMsgStat msgStats[GUI_STAT_TYPES];
+    CorrAge    corrAge;         /* MSM age of corrections */
+    uint32_t   burstPeak;       /* largest epoch burst (bytes), status bar */
+    ObsQualityStats qualityStats; /* Signal Quality tab: one row per station, GNSS, signal */
+
+    /* Rows of the owner-data Msg Stats ListView: statRowIdx[row] is
+     * the type index shown in a row, statRowOf[k] is row + 1 (0 = no
+     * row yet).  The Satellites ListView shows satStats.gnss[] in order,
+     * one row per GNSS. */
+    int statRowIdx[GUI_STAT_TYPES];
+    int statRowOf[GUI_STAT_TYPES];
+    int statRows;
+
+    /* Last rendered cell text of the Msg Stats and Satellites lists;
+     * only the cells that changed are repainted (gui_list_model.h). */
+    GuiListModel statModel;
+    GuiListModel satModel;
 
     /* ── Real-time satellite statistics ───────────────────── */
     SatStatsSummary satStats;
 
     /* ── Stream info (set by worker, read by UI) ─────────── */
     volatile LONG  streamBytes;       /* total data bytes received */
-    volatile LONG  streamFormat;      /* 0=none, 1=RTCM3, 2=UBX, 3=SBF, 4=RT27, 5=LB2, 6=Unknown */
+    volatile LONG  streamFormat;      /* StreamFormat (stream_format.h): 0=none, 1=RTCM3, 2=UBX, ... */
     char           sourceFormat[32];  /* Format string from sourcetable (e.g. "RTCM 3.2", "RT27") */
     char           sourceDetails[128]; /* Details string from sourcetable */
     LONG           streamBytesLast;   /* snapshot for rate calc (UI side) */
     double         streamRateTime;    /* timestamp of last rate calc */
 
+    /* ── Obs decode queue (set by stream I/O thread, read by UI) ── */
+    volatile LONG  decodeQueueBytes;  /* frames waiting for the decode thread */
+    volatile LONG  decodeQueuePeak;   /* high-water mark of decodeQueueBytes */
+    volatile LONG  decodeQueueDrops;  /* frames dropped because the queue was full */
+    /* Load shedding of the live stream: written by the decode thread,
+     * its level read by the status bar (load_gov_level()). */
+    LoadGovernor   loadGov;
+    double         loadSampleTime;    /* decode thread: last load_gov_sample() */
+
+    /* ── Per-stage frame latency (Performance tab) ────────── */
+    /* FRAME is written by the I/O thread; QUEUE, DECODE and SKY by the
+     * decode (or replay) thread; OUTPUT and TOTAL by the UI thread as it
+     * drains uiQueue.  The tab reads it without a lock. */
+    PerfStream     perf;
+
+    /* How long the UI thread lets each worker hand-over wait, its
+     * handlers and its paints (gui_ui_lag.h); also on the Performance
+     * tab.  Stamps from any thread, histograms on the UI thread. */
+    UiLag          uiLag;
+
+    /* ── Worker -> UI update channel (see UI_REC_*) ──────── */
+    /* Producer: the obs decode thread or the replay worker (never both
+     * at once).  Consumer: the UI thread.  uiKickPending is set by the
+     * producer when it posts WM_APP_UI_BATCH and cleared by the drain,
+     * so at most one kick is ever queued. */
+    GuiFrameQueue  uiQueue;
+    BOOL           uiQueueInit;       /* TRUE after gui_fq_init() */
+    volatile LONG  uiKickPending;
+
+    /* ── Worker log rings (see GuiLogRing) ───────────────── */
+    /* Consumer: the UI thread, in LogPumpTimer().  logSeq orders the
+     * lines of all rings. */
+    GuiLogRing     logRings[GUI_LOG_SRC_COUNT];
+    BOOL           logRingsInit;      /* TRUE after LogRingsInit() */
+    volatile LONG  logSeq;
+
+    /* Sky update state, touched only by the producer thread above:
+     * the MSM epoch assembler (reset when a producer starts) and the
+     * station frame, rebuilt only when the ARP moves. */
+    SkyEpochAssembler skyEpochs;
+    StationFrame   skyFrame;
+
     /* ── Splitter between mountpoint list and tab control ── */
     int  splitterLvH;         /* current mountpoint ListView height (pixels) */
     BOOL splitterDragging;    /* TRUE while the user is dragging */
@@ -313,15 +548,25 @@ typedef struct {
     int  splitterDragStartH;  /* lvH at start of drag */
 
     /* ── Detail windows (one per open message type) ──────── */
-    HWND hDetailWnds[GUI_MAX_MSG_TYPES]; /* NULL if not open */
+    HWND hDetailWnds[GUI_STAT_TYPES];   /* by type index; NULL if not open */
 
-    /* ── Last decoded text per message type ──────────────── */
-    /* HeapAlloc'd string with \r\n line endings, ready for the
-     * EDIT control.  Replaced on every new frame; freed when a
-     * new stream is started or the application exits.
+    /* ── Last frame per message type ─────────────────────── */
+    /* HeapAlloc'd on the first frame of a type and overwritten by the
+     * newest frame of it in every UI batch; freed when a new stream is
+     * started or the application exits.  detailRefreshTime is when the
+     * open detail windows were last redrawn.
      * Only ever touched on the UI thread (message handlers),
      * so no locking is needed. */
-    char *lastDecodedText[GUI_MAX_MSG_TYPES];
+    UiLastFrame *lastFrame[GUI_STAT_TYPES];    /* by type index */
+    double       detailRefreshTime;
+
+    /* UI-thread decode scratch: uiDecodeText collects the decoder's
+     * output for a detail window or a 1005/1006, uiDetailText holds it
+     * with \r\n line ends for the EDIT control.  Reused for every
+     * decode, so they grow to the largest text once instead of being
+     * allocated per refresh; freed on exit. */
+    RtcmStrBuf   uiDecodeText;
+    RtcmStrBuf   uiDetailText;
 
     /* ── Sky-plot window (floating, optional) ────────────── */
     /* hSkyWnd is NULL when closed; cleared by the sky window's
@@ -332,7 +577,7 @@ typedef struct {
     RECT skyWndRect;
     BOOL skyWndRectValid;
 
-    /* Live sky-plot model.  Written by WM_APP_SKY_UPDATE on the UI
+    /* Live sky-plot model.  Written by the UI batch drain on the UI
      * thread; read on the UI thread during WM_PAINT of hSkyWnd. */
     SkyPlotState skyState;
 
@@ -340,15 +585,41 @@ typedef struct {
      * when a window opens, cleared by the window's WM_CLOSE handler. */
     HWND hSvDetailWnds[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
 
-    /* RTCM stream capture.  When @ref hRtcmDump is non-NULL the worker
-     * thread writes each raw frame to the file.  Access serialised
-     * through @ref csRtcmDump so the UI thread can fclose() safely
-     * even while a write is in flight. */
-    FILE             *hRtcmDump;
+    /* Per-signal CNR history of every MSM4..MSM7 frame, for the plot
+     * and the rolling statistics of the SV-detail popups.  Fed by the
+     * UI batch drain; "since connect" like skyState, freed on reset. */
+    CnrHistory cnrHistory;
+
+    /* Bounded-memory history of the stream for the History window
+     * (rollup.h): bytes, frames in all and per type, satellites and CNR
+     * per GNSS, p50 / p99 age of corrections, at 1 s / 1 min / 15 min.
+     * Fed by the status-bar timer, CNR by the UI batch drain; cleared
+     * with the other "since connect" data.  rollFrames[k] (msgStats
+     * index), rollBytes and rollAge are what is already in it;
+     * rollCnrId[gnss] is the CNR series id + 1 (looked up per frame). */
+    RollupStore *rollup;
+    int          rollFrames[GUI_STAT_TYPES];
+    LONG         rollBytes;
+    PerfHist     rollAge;
+    int          rollCnrId[8];
+    HWND         hHistoryWnd;       /* NULL when closed */
+
+    /* RTCM stream capture.  When @ref hRtcmDump is non-NULL the stream
+     * I/O thread queues each CRC-valid frame to it; the recorder's own
+     * thread does the disk writes (rtcm_recorder.h), so a slow disk
+     * cannot stall recv().  .nacap files are native captures with
+     * receive timestamps, anything else raw frames.  Access serialised
+     * through @ref csRtcmDump so the UI thread can close the recorder
+     * safely even while a push is in flight. */
+    RtcmRecorder     *hRtcmDump;
     CRITICAL_SECTION  csRtcmDump;
     BOOL              csRtcmDumpInit;       /* TRUE after InitializeCS */
     char              rtcmDumpPath[MAX_PATH];
-    LONG              rtcmDumpBytes;        /* updated under the CS */
+
+    /* The last CRC failures and sync losses of the stream with the bytes
+     * around them (anomaly_ring.h).  Written by the stream I/O thread's
+     * framer, read lock-free by File > Save Anomaly Dump. */
+    AnomalyRing       anomalies;
 
     /* RTCM file replay.  Set by the File menu before launching
      * WorkerReplayRtcm; the worker reads frames from this path. */
@@ -447,9 +718,26 @@ DWORD WINAPI WorkerReplayRtcm(LPVOID param);
 void LogRedirectStart(AppState *state);
 void LogRedirectStop(AppState *state);
 void LogPumpTimer(AppState *state);
+bool LogRingsInit(AppState *state);
+void LogRingsFree(AppState *state);
+void LogAppend(HWND hLog, const char *text);
+void WorkerLogBind(AppState *state, int src);
+void WorkerLogUnbind(void);
+void WorkerLog(GuiLogLevel level, const char *fmt, ...);
+void WorkerLogTrace(int msg_type);
 
 /* gui_parsers.c */
-void ParseMountTable(const char *raw, HWND listview, double userLat, double userLon);
+void ParseMountTable(const char *raw, GuiMountTable *table, double userLat, double userLon);
+void MountTableBegin(GuiMountTable *table, double userLat, double userLon);
+int  MountTableAppend(GuiMountTable *table, const char *text);
+void MountTableFinish(GuiMountTable *table);
+void MountTableFree(GuiMountTable *table);
+const char *MountTableCell(const GuiMountTable *table, int item, int col);
+int  MountTableFind(const GuiMountTable *table, const char *mountpoint);
+void MountTableSort(GuiMountTable *table, int col, BOOL ascending);
+void MountTableSetOrigin(GuiMountTable *table, double lat, double lon);
+int  MountTableNearest(const GuiMountTable *table, int k, double maxKm, GeoIndexHit *hits);
+int  MountTableItemOfRow(const GuiMountTable *table, int row);
 
 /* gui_events.c — config helpers */
 void GuiToConfig(AppState *state);
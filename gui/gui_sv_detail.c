@@ -4,7 +4,10 @@
  *
  * Mirrors the gui_detail.c pattern (read-only multiline EDIT, Consolas
  * monospace font, refresh via posted messages) but driven by a 1-Hz
- * timer that re-reads AppState.skyState.sats[g][prn-1].
+ * timer that re-reads AppState.skyState.sats[g][prn-1].  A strip under
+ * the buttons plots the per-signal CNR of AppState.cnrHistory over the
+ * length of its ring; the text lists the rolling statistics of the same
+ * series.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -37,6 +40,22 @@
 #define SV_STRIP_H   (SV_BTN_H + 2 * SV_BTN_PAD)
 #define SV_BTN_Y     SV_BTN_PAD
 
+/* CNR plot between the button strip and the EDIT control */
+#define SV_PLOT_H        150
+#define SV_PLOT_MARGIN_L 34
+#define SV_PLOT_MARGIN   8
+#define SV_PLOT_CNR_MIN  10.0f      /* dB-Hz at the bottom edge */
+#define SV_PLOT_CNR_MAX  60.0f      /* dB-Hz at the top edge */
+#define SV_PLOT_SPAN_S   (CNR_HIST_PTS * CNR_HIST_INTERVAL_S)
+/* Samples further apart than this are not joined (SV set and rose) */
+#define SV_PLOT_GAP_S    (10.0 * CNR_HIST_INTERVAL_S)
+
+static const COLORREF g_svPlotColors[] = {
+    RGB(  0, 102, 204), RGB(204,  51,   0), RGB(  0, 153,  51),
+    RGB(153,  51, 204), RGB(204, 153,   0), RGB(  0, 153, 153),
+};
+#define SV_PLOT_N_COLORS ((int)(sizeof(g_svPlotColors) / sizeof(g_svPlotColors[0])))
+
 static BOOL      g_svDetailClassRegistered = FALSE;
 /* The app has a single AppState; cache it here so the WndProc can find
  * it without a Set/GetProp dance that races with WM_CREATE. */
@@ -101,7 +120,7 @@ static void sv_detail_refresh(HWND hwnd)
     char wall[40] = "";
     if (lt) strftime(wall, sizeof(wall), "%Y-%m-%d %H:%M:%S local", lt);
 
-    char body[2048];
+    char body[4096];
     int  n = 0;
     n += snprintf(body + n, sizeof(body) - n,
                   "Satellite %c%02d   (%s)\r\n"
@@ -116,20 +135,36 @@ static void sv_detail_refresh(HWND hwnd)
                   "  Last seen    : %s\r\n\r\n",
                   s->az_deg, s->el_deg, cnr_str, age_str);
 
-    /* Per-band CNR section (only populated for MSM7 streams) */
+    /* Per-band CNR section: the latest value from the MSM7 cache, the
+     * rolling statistics from the history (MSM4..MSM7). */
     float per_band[32];
     get_sv_per_band_cnr(g, p, per_band);
     int any_band = 0;
-    for (int i = 0; i < 32; i++) if (per_band[i] > 0.0f) { any_band = 1; break; }
+    for (int i = 0; i < 32; i++)
+        if (per_band[i] > 0.0f || cnr_history_series(&state->cnrHistory, g, p, i)) {
+            any_band = 1;
+            break;
+        }
     if (any_band) {
         n += snprintf(body + n, sizeof(body) - n,
-                      "Signals tracked (per-band CNR)\r\n");
+                      "Signals tracked (per-band CNR, dB-Hz)\r\n"
+                      "  Signal     now   10 s  10 min    min    max\r\n");
         for (int i = 0; i < 32; i++) {
-            if (per_band[i] <= 0.0f) continue;
+            const CnrSeries *cs = cnr_history_series(&state->cnrHistory, g, p, i);
+            if (per_band[i] <= 0.0f && !cs) continue;
             const char *lbl = msm_signal_label(g, i);
+            char now_str[16] = "     -";
+            if (per_band[i] > 0.0f)
+                snprintf(now_str, sizeof(now_str), "%6.2f", per_band[i]);
+            if (!cs) {
+                n += snprintf(body + n, sizeof(body) - n,
+                              "  %-5s    %s\r\n", lbl, now_str);
+                continue;
+            }
             n += snprintf(body + n, sizeof(body) - n,
-                          "  %-5s        : %6.2f dB-Hz\r\n",
-                          lbl, per_band[i]);
+                          "  %-5s    %s %6.1f %6.1f %6.1f %6.1f%s\r\n",
+                          lbl, now_str, cs->fast, cs->slow, cs->min, cs->max,
+                          cnr_series_degraded(cs) ? "  DEGRADED" : "");
         }
         n += snprintf(body + n, sizeof(body) - n, "\r\n");
     }
@@ -156,6 +191,103 @@ static void sv_detail_refresh(HWND hwnd)
     if (hEdit) SetWindowText(hEdit, body);
 }
 
+/* ── CNR history plot ──────────────────────────────────────── */
+
+static void sv_plot_rect(HWND hwnd, RECT *rc)
+{
+    GetClientRect(hwnd, rc);
+    rc->top    = SV_STRIP_H;
+    rc->bottom = SV_STRIP_H + SV_PLOT_H;
+}
+
+/* One polyline per signal over the last SV_PLOT_SPAN_S, oldest left.
+ * A signal whose fast mean is flagged gets a '!' in the legend. */
+static void sv_plot_draw(HDC hdc, const RECT *rc, const CnrHistory *hist,
+                         int g, int p, double now)
+{
+    FillRect(hdc, rc, (HBRUSH)(COLOR_WINDOW + 1));
+    SetBkMode(hdc, TRANSPARENT);
+
+    RECT pr = { rc->left + SV_PLOT_MARGIN_L, rc->top + SV_PLOT_MARGIN + 14,
+                rc->right - SV_PLOT_MARGIN,  rc->bottom - SV_PLOT_MARGIN - 12 };
+    int pw = pr.right - pr.left, ph = pr.bottom - pr.top;
+    if (pw < 20 || ph < 20) return;
+
+    HPEN penGrid = CreatePen(PS_DOT, 1, RGB(200, 200, 200));
+    HPEN penOld  = (HPEN)SelectObject(hdc, penGrid);
+    SetTextColor(hdc, RGB(96, 96, 96));
+    for (int db = (int)SV_PLOT_CNR_MIN; db <= (int)SV_PLOT_CNR_MAX; db += 10) {
+        int y = pr.bottom - (int)((db - SV_PLOT_CNR_MIN) * ph /
+                                  (SV_PLOT_CNR_MAX - SV_PLOT_CNR_MIN));
+        MoveToEx(hdc, pr.left, y, NULL);
+        LineTo(hdc, pr.right, y);
+        char lbl[8];
+        snprintf(lbl, sizeof(lbl), "%d", db);
+        TextOut(hdc, rc->left + 6, y - 7, lbl, (int)strlen(lbl));
+    }
+    char span[24];
+    snprintf(span, sizeof(span), "-%.0f min", SV_PLOT_SPAN_S / 60.0);
+    TextOut(hdc, pr.left, pr.bottom + 1, span, (int)strlen(span));
+    TextOut(hdc, pr.right - 20, pr.bottom + 1, "now", 3);
+    SelectObject(hdc, penOld);
+    DeleteObject(penGrid);
+
+    static POINT pts[CNR_HIST_PTS];
+    int lx = pr.left, k = 0;
+    double t_left = now - SV_PLOT_SPAN_S;
+    for (int i = 0; i < RTCM_CNR_MAX_SIGS; i++) {
+        const CnrSeries *cs = cnr_history_series(hist, g, p, i);
+        if (!cs) continue;
+        COLORREF col = g_svPlotColors[k++ % SV_PLOT_N_COLORS];
+
+        HPEN pen = CreatePen(PS_SOLID, 1, col);
+        SelectObject(hdc, pen);
+        int    n_run  = 0;
+        double t_prev = 0.0;
+        unsigned count = cnr_series_count(cs);
+        for (unsigned j = 0; j < count; j++) {
+            double ts;
+            float  v = cnr_series_at(hist, cs, j, &ts);
+            if (ts < t_left) continue;
+            if (n_run > 0 && ts - t_prev > SV_PLOT_GAP_S) {
+                if (n_run > 1) Polyline(hdc, pts, n_run);
+                n_run = 0;
+            }
+            if (v < SV_PLOT_CNR_MIN) v = SV_PLOT_CNR_MIN;
+            if (v > SV_PLOT_CNR_MAX) v = SV_PLOT_CNR_MAX;
+            pts[n_run].x = pr.left + (int)((ts - t_left) * pw / SV_PLOT_SPAN_S);
+            pts[n_run].y = pr.bottom - (int)((v - SV_PLOT_CNR_MIN) * ph /
+                                             (SV_PLOT_CNR_MAX - SV_PLOT_CNR_MIN));
+            n_run++;
+            t_prev = ts;
+        }
+        if (n_run > 1) Polyline(hdc, pts, n_run);
+        SelectObject(hdc, penOld);
+        DeleteObject(pen);
+
+        char lbl[16];
+        snprintf(lbl, sizeof(lbl), "%s%s", msm_signal_label(g, i),
+                 cnr_series_degraded(cs) ? "!" : "");
+        SetTextColor(hdc, col);
+        TextOut(hdc, lx, rc->top + SV_PLOT_MARGIN - 2, lbl, (int)strlen(lbl));
+        SIZE sz;
+        GetTextExtentPoint32(hdc, lbl, (int)strlen(lbl), &sz);
+        lx += sz.cx + 10;
+    }
+    if (k == 0) {
+        SetTextColor(hdc, RGB(96, 96, 96));
+        const char *msg = "(no CNR yet -- needs MSM4..MSM7)";
+        TextOut(hdc, pr.left, rc->top + SV_PLOT_MARGIN - 2, msg, (int)strlen(msg));
+    }
+
+    HPEN penEdge = CreatePen(PS_SOLID, 1, RGB(140, 140, 140));
+    SelectObject(hdc, penEdge);
+    SelectObject(hdc, GetStockObject(NULL_BRUSH));
+    Rectangle(hdc, pr.left, pr.top, pr.right + 1, pr.bottom + 1);
+    SelectObject(hdc, penOld);
+    DeleteObject(penEdge);
+}
+
 /* ── Window procedure ──────────────────────────────────────── */
 
 static LRESULT CALLBACK SvDetailWndProc(HWND hwnd, UINT msg,
@@ -183,7 +315,7 @@ static LRESULT CALLBACK SvDetailWndProc(HWND hwnd, UINT msg,
             WS_EX_CLIENTEDGE, "EDIT", "",
             WS_CHILD | WS_VISIBLE | WS_VSCROLL | WS_HSCROLL |
             ES_MULTILINE | ES_AUTOVSCROLL | ES_AUTOHSCROLL | ES_READONLY,
-            0, SV_STRIP_H, 100, 100, hwnd,
+            0, SV_STRIP_H + SV_PLOT_H, 100, 100, hwnd,
             (HMENU)(intptr_t)IDC_SV_DETAIL_EDIT, hInst, NULL);
 
         if (hEdit) {
@@ -204,7 +336,38 @@ static LRESULT CALLBACK SvDetailWndProc(HWND hwnd, UINT msg,
         int w = LOWORD(lParam), h = HIWORD(lParam);
         HWND hEdit = GetDlgItem(hwnd, IDC_SV_DETAIL_EDIT);
         if (hEdit)
-            MoveWindow(hEdit, 0, SV_STRIP_H, w, h - SV_STRIP_H, TRUE);
+            MoveWindow(hEdit, 0, SV_STRIP_H + SV_PLOT_H, w,
+                       h - SV_STRIP_H - SV_PLOT_H, TRUE);
+        return 0;
+    }
+
+    case WM_PAINT: {
+        uint64_t t_lag = ui_lag_now();
+        PAINTSTRUCT ps;
+        HDC hdc = BeginPaint(hwnd, &ps);
+        AppState *state = g_appState;
+        int packed = (int)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+        RECT rc;
+        sv_plot_rect(hwnd, &rc);
+        int w = rc.right - rc.left, h = rc.bottom - rc.top;
+        if (state && w > 0 && h > 0) {
+            /* Double buffer: the plot redraws every second */
+            HDC     hdcMem = CreateCompatibleDC(hdc);
+            HBITMAP bmp    = CreateCompatibleBitmap(hdc, w, h);
+            HBITMAP bmpOld = (HBITMAP)SelectObject(hdcMem, bmp);
+            HFONT   fntOld = (HFONT)SelectObject(hdcMem,
+                                                 GetStockObject(DEFAULT_GUI_FONT));
+            RECT local = { 0, 0, w, h };
+            sv_plot_draw(hdcMem, &local, &state->cnrHistory,
+                         SV_GNSS(packed), SV_PRN(packed), gui_get_time_seconds());
+            BitBlt(hdc, rc.left, rc.top, w, h, hdcMem, 0, 0, SRCCOPY);
+            SelectObject(hdcMem, fntOld);
+            SelectObject(hdcMem, bmpOld);
+            DeleteObject(bmp);
+            DeleteDC(hdcMem);
+        }
+        EndPaint(hwnd, &ps);
+        if (state) ui_lag_paint(&state->uiLag, UI_LAG_WND_SV_DETAIL, t_lag);
         return 0;
     }
 
@@ -223,8 +386,12 @@ static LRESULT CALLBACK SvDetailWndProc(HWND hwnd, UINT msg,
     }
 
     case WM_TIMER:
-        if (wParam == IDT_SV_DETAIL_TICK)
+        if (wParam == IDT_SV_DETAIL_TICK) {
+            RECT rc;
+            sv_plot_rect(hwnd, &rc);
             sv_detail_refresh(hwnd);
+            InvalidateRect(hwnd, &rc, FALSE);
+        }
         return 0;
 
     case WM_CLOSE: {
@@ -307,7 +474,7 @@ HWND ShowSkySvDetailWindow(HINSTANCE hInst, HWND hOwner, AppState *state,
         0, SV_DETAIL_CLASS_NAME, title,
         WS_OVERLAPPEDWINDOW,
         CW_USEDEFAULT, CW_USEDEFAULT,
-        420, 360,
+        480, 520,
         hOwner, NULL, hInst,
         (LPVOID)(intptr_t)SV_PACK(g, prn));
 
@@ -3,7 +3,8 @@
  * @brief Worker thread entry points for NTRIP-Analyser GUI.
  *
  * Each function runs on a background thread and communicates results
- * back to the UI thread via PostMessage with WM_APP+n messages.
+ * back to the UI thread via PostMessage with WM_APP+n messages, posted
+ * through ui_lag_post() so the UI can time how long they wait.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -13,9 +14,16 @@
 #include "resource.h"
 #include "gui_state.h"
 #include "rtcm3x_parser.h"
+#include "rtcm_framer.h"
+#include "rtcm_replay.h"
+#include "gui_frame_queue.h"
 #include "nmea_parser.h"
 #include "sv_ephemeris.h"
 #include "sv_orbit.h"
+#include "sky_epoch.h"
+#include "stream_clock.h"
+#include "ntrip_session.h"
+#include "load_governor.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -23,40 +31,6 @@
 #include <time.h>
 #include <ctype.h>
 
-/**
- * @brief Coarse GPS time of day for sky-plot orbit propagation.
- *
- * The sky plot only needs second-level precision (an error of 10 s shifts
- * an SV by ~37 km along its orbit, well below sky-plot pixel resolution),
- * so we ignore leap seconds and simply derive GPS week + ToW from the
- * system clock using the GPS epoch (1980-01-06 00:00:00 UTC).
- */
-static void sky_get_gps_time(int *week, double *tow_s)
-{
-    const time_t GPS_EPOCH_UNIX = 315964800;   /* 1980-01-06 UTC */
-    time_t now = time(NULL);
-    double delta = (double)(now - GPS_EPOCH_UNIX);
-    int w = (int)(delta / 604800.0);
-    if (week)  *week  = w;
-    if (tow_s) *tow_s = delta - (double)w * 604800.0;
-}
-
-/**
- * @brief Moscow seconds-of-day for GLONASS orbit propagation.
- *
- * GLONASS time = UTC + 3 h (no leap-second offset vs UTC).  We use the
- * system clock directly, add 10800 seconds, and wrap into [0, 86400).
- */
-static double sky_get_glo_tod(void)
-{
-    time_t now = time(NULL);
-    double utc_sod = (double)(now % 86400);
-    double msk = utc_sod + 10800.0;
-    while (msk >= 86400.0) msk -= 86400.0;
-    while (msk <    0.0)   msk += 86400.0;
-    return msk;
-}
-
 /**
  * @brief Case-insensitive substring search (like strstr but ignores case).
  */
@@ -71,16 +45,601 @@ static const char *stristr(const char *haystack, const char *needle)
     return NULL;
 }
 
+/* ── Worker -> UI update channel ─────────────────────────────────────
+ * Per-frame results go to the UI thread as records on state->uiQueue
+ * (see UI_REC_* in gui_state.h).  The UI drains the queue every
+ * UI_BATCH_INTERVAL_MS and coalesces each batch: one ListView refresh
+ * and one detail-text format per message type, one sky repaint.  Once
+ * UI_BATCH_KICK_BYTES are waiting a single WM_APP_UI_BATCH is posted so
+ * a burst is drained before the next tick; uiKickPending keeps it to one
+ * message in the queue.
+ *
+ * The live stream is lossy: if the UI falls behind, records are dropped
+ * (and counted) rather than stalling the decode thread.  Replay passes
+ * @p lossless and waits for room instead, since it has no deadline. */
+static void ui_kick(AppState *state)
+{
+    if (InterlockedExchange(&state->uiKickPending, 1) == 0 &&
+        !ui_lag_post(&state->uiLag, UI_LAG_MSG_UI_BATCH, state->hMain, WM_APP_UI_BATCH, 0, 0))
+        InterlockedExchange(&state->uiKickPending, 0);
+}
+
+static void ui_push(AppState *state, int tag, const void *data, int len,
+                    bool lossless)
+{
+    GuiFrameQueue *q = &state->uiQueue;
+
+    /* Twice the record size covers the worst-case wrap padding. */
+    LONG room = (LONG)q->size - 2 * (LONG)(len + 8);
+    while (lossless && gui_fq_depth(q) > room && !state->bStopRequested) {
+        ui_kick(state);
+        Sleep(1);
+    }
+    gui_fq_push(q, data, len, tag);
+    ui_lag_stamp(&state->uiLag, UI_LAG_RECORDS);
+    if (gui_fq_depth(q) >= UI_BATCH_KICK_BYTES)
+        ui_kick(state);
+}
+
+/* ── Per-epoch sky update ────────────────────────────────────────────
+ * Runs once per assembled (GNSS, epoch), however many MSM frames carried
+ * it.  Sky-plot inputs: a station ARP and a valid ephemeris per SV.  Many
+ * casters (e.g. Onocoy observation streams) omit 1005/1006/1019/1045/1046
+ * entirely.  Fall back to the user-configured rover lat/lon for the ARP
+ * when no 1005/1006 has arrived.  Ephemeris has no fallback — without
+ * 1019/1045/1046 we can't position SVs, and no update is produced.
+ *
+ * We emit one SkySatUpdate for EVERY above-horizon SV that has a valid
+ * cached ephemeris in the epoch's GNSS, not only the SVs that the receiver
+ * tracked.  The flag observed_flag=1 marks the ones in any of the epoch's
+ * sat masks; =0 means "expected by ephemeris but not in the MSM".  The UI
+ * batch drain uses both flags to drive the heatmap's observed/expected
+ * counters.  Returns the number of entries written to @p upd. */
+static int worker_sky_epoch(AppState *state, const SkyEpoch *ep,
+                            SkySatUpdate *upd)
+{
+    int gnss_id = ep->gnss_id;
+    if (ep->obs_mask == 0 ||
+        !(gnss_id == 1 || gnss_id == 2 || gnss_id == 3 ||
+          gnss_id == 4 || gnss_id == 5 || gnss_id == 7))
+        return 0;
+
+    bool   arp_valid = false;
+    double sx = 0, sy = 0, sz = 0;
+    rtcm_get_station_arp(&arp_valid, &sx, &sy, &sz, NULL, NULL, NULL);
+    if (!arp_valid &&
+        (state->config.LATITUDE != 0.0 || state->config.LONGITUDE != 0.0)) {
+        geodetic_to_ecef(state->config.LATITUDE, state->config.LONGITUDE,
+                         0.0, &sx, &sy, &sz);
+        arp_valid = true;
+    }
+    if (!arp_valid) return 0;
+
+    int    gps_week;
+    double gps_tow;
+    stream_clock_gps_time(&gps_week, &gps_tow);
+    double glo_tod = stream_clock_glo_tod();
+    double t_prop  = (gnss_id == 2) ? glo_tod : gps_tow;
+
+    /* Every SV with a usable ephemeris, propagated in one batch. */
+    const SvEphemeris *ephs[SV_EPH_MAX_SATS_PER_GNSS];
+    int    eph_prn[SV_EPH_MAX_SATS_PER_GNSS];
+    double svx[SV_EPH_MAX_SATS_PER_GNSS], svy[SV_EPH_MAX_SATS_PER_GNSS];
+    double svz[SV_EPH_MAX_SATS_PER_GNSS];
+    bool   sv_ok[SV_EPH_MAX_SATS_PER_GNSS];
+    int    n_eph = 0;
+    for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
+        const SvEphemeris *eph = sv_eph_get_at(gnss_id, p, gps_week, t_prop);
+        if (!eph) continue;
+        ephs[n_eph]    = eph;
+        eph_prn[n_eph] = p;
+        n_eph++;
+    }
+    sv_to_ecef_cached_batch(ephs, n_eph, gps_week, t_prop,
+                            svx, svy, svz, sv_ok);
+    station_frame_set(&state->skyFrame, sx, sy, sz);
+
+    int upd_count = 0;
+    for (int k = 0; k < n_eph; k++) {
+        if (!sv_ok[k]) continue;
+        int p = eph_prn[k];
+        double az_d, el_d;
+        azel_from_ecef_frame(&state->skyFrame, svx[k], svy[k], svz[k],
+                             &az_d, &el_d);
+        if (el_d <= 0.0) continue;
+
+        int observed_flag = (p >= 1 && p <= 64)
+            ? ((ep->obs_mask >> (p - 1)) & 1ULL) ? 1 : 0
+            : 0;
+
+        upd[upd_count].gnss_id       = gnss_id;
+        upd[upd_count].prn           = p;
+        upd[upd_count].az_deg        = (float)az_d;
+        upd[upd_count].el_deg        = (float)el_d;
+        upd[upd_count].cnr_dbhz      = observed_flag ? ep->cnr_dbhz[p] : 0.0f;
+        upd[upd_count].observed_flag = observed_flag;
+        upd_count++;
+    }
+    return upd_count;
+}
+
+/* ── Statistics snapshot (see UI_STATS_PUBLISH_MS) ───────────────────
+ * Only the producer thread touches statsWork; the UI sees it through
+ * the copies published here. */
+static void worker_stats_reset(AppState *state)
+{
+    memset(&state->statsWork, 0, sizeof(state->statsWork));
+    memset(&state->ephCoverage, 0, sizeof(state->ephCoverage));
+    /* Replay never samples the governor, so it stays at LOAD_FULL. */
+    load_gov_init(&state->loadGov, perf_now_ns() / 1e9);
+    state->loadSampleTime = 0.0;
+    gui_type_map_clear(&state->statsTypes);
+    obs_quality_free(&state->obsQuality);
+    state->statsPublishTick = GetTickCount();
+}
+
+/* Publish statsWork if UI_STATS_PUBLISH_MS have passed, or now with
+ * @p force (end of stream). */
+static void worker_stats_publish(AppState *state, bool force)
+{
+    DWORD now = GetTickCount();
+    if (!force && now - state->statsPublishTick < UI_STATS_PUBLISH_MS) return;
+    state->statsPublishTick = now;
+    state->statsWork.quality = state->obsQuality.stats;
+    GuiStats *w = &state->statsWork;
+    double t = stream_clock_seconds();
+    for (int k = 0; k < w->n_types; k++)
+        bw_meter_rates(&w->stat[k].bw, t, &w->stat[k].bwRates);
+    w->t_publish_ns = perf_probes_on ? perf_now_ns() : 0;
+    stats_snapshot_publish(&state->statsSnap, &state->statsWork);
+}
+
+/* Working stats of @p msg_type; NULL once GUI_STAT_TYPES types are in use. */
+static GuiMsgStat *worker_stat_of(AppState *state, int msg_type)
+{
+    GuiStats *w = &state->statsWork;
+    int slot = gui_type_map_add(&state->statsTypes, msg_type);
+    if (slot < 0) return NULL;
+    if (slot == w->n_types) {
+        w->type[slot] = msg_type;
+        w->n_types++;
+    }
+    return &w->stat[slot];
+}
+
+/* ── Per-frame MSM consumers ─────────────────────────────────────────
+ * Shared by the obs and replay workers.  @p msm is the frame decoded
+ * once by the caller, or NULL for non-MSM frames.  MSM4..7 frames go
+ * into state->skyEpochs; the sky update runs when a frame closes the
+ * previous epoch of its GNSS.  A sky record is queued for every frame,
+ * empty if no epoch closed, so the sky status line refreshes.  While the
+ * live stream sheds load, only the epochs load_gov_keep() picks are
+ * propagated; the others still count in the satellite statistics. */
+static void worker_msm_update(AppState *state, const RtcmMsmObs *msm,
+                              bool lossless)
+{
+    if (msm) {
+        extract_satellites_obs(msm, &state->statsWork.sats);
+        obs_quality_add(&state->obsQuality, msm);
+    }
+
+    /* Per-band CNR cache for the SV detail windows. */
+    if (msm && msm->msm_subtype == 7)
+        rtcm_msm_obs_update_per_band_cnr(msm);
+
+    int upd_count = 0;
+    SkySatUpdate upd[SV_EPH_MAX_SATS_PER_GNSS];
+
+    if (msm && msm->msm_subtype >= 4) {
+        /* For MSM7, also pull per-SV best CNR (same PRN order). */
+        int   prns[64];
+        float cnr[64];
+        int   n_prns;
+        bool  has_cnr = msm->msm_subtype == 7;
+        if (has_cnr)
+            n_prns = rtcm_msm_obs_best_cnr(msm, prns, cnr, 64);
+        else
+            n_prns = rtcm_msm_obs_prns(msm, prns, 64);
+
+        SkyEpoch done;
+        if (n_prns > 0 &&
+            sky_epoch_add(&state->skyEpochs, msm->gnss_id,
+                          msm->ref_station_id, msm->epoch_time,
+                          prns, has_cnr ? cnr : NULL, n_prns, &done) &&
+            load_gov_keep(&state->loadGov, LOAD_WORK_SKY, done.epoch_time / 1000))
+            upd_count = worker_sky_epoch(state, &done, upd);
+    }
+
+    ui_push(state, UI_REC_SKY, upd,
+            upd_count * (int)sizeof(SkySatUpdate), lossless);
+}
+
+/* End of stream: run the sky update for every epoch still open. */
+static void worker_sky_flush(AppState *state, bool lossless)
+{
+    SkyEpoch eps[SKY_EPOCH_MAX_GNSS];
+    int n = sky_epoch_flush(&state->skyEpochs, eps, SKY_EPOCH_MAX_GNSS);
+    for (int i = 0; i < n; i++) {
+        SkySatUpdate upd[SV_EPH_MAX_SATS_PER_GNSS];
+        int upd_count = worker_sky_epoch(state, &eps[i], upd);
+        if (upd_count > 0)
+            ui_push(state, UI_REC_SKY, upd,
+                    upd_count * (int)sizeof(SkySatUpdate), lossless);
+    }
+}
+
+/* An ephemeris or MSM frame of the obs stream.  The ephemerides are
+ * decoded into the store here, once, whenever the ephemeris worker is
+ * not running; while it is they are only counted, and once they cover
+ * every constellation the stream observes it is asked to close its
+ * connection (WorkerOpenEphStream polls bStopRequestedEph). */
+static void worker_obs_eph(AppState *state, const unsigned char *frame,
+                           int frame_len, int msg_type, double now)
+{
+    ntrip_eph_coverage_add(&state->ephCoverage, msg_type, now);
+    if (!rtcm_msg_is_eph(msg_type)) return;
+    HANDLE eph = state->hWorkerThreadEph;
+    if (state->bWorkerRunningEph && eph && WaitForSingleObject(eph, 0) == WAIT_TIMEOUT) {
+        if (!state->bStopRequestedEph &&
+            ntrip_eph_coverage_full(&state->ephCoverage, now)) {
+            state->bStopRequestedEph = TRUE;
+            WorkerLog(GUI_LOG_INFO, "[EPH] The obs stream carries the ephemerides of every "
+                                    "constellation it observes; closing the ephemeris stream\n");
+        }
+        return;
+    }
+    SvEphemeris out;
+    rtcm_decode_eph(frame + 3, frame_len - 6, &out);
+}
+
+/* Per-frame bookkeeping shared by the stream and replay workers:
+ * message-type statistics, the MSM consumers and the frame record for
+ * the UI (stats row, detail window pipeline).  @p pf carries the frame's
+ * stage timing into the UI record. */
+static void worker_handle_frame(AppState *state, const unsigned char *frame,
+                                int frame_len, int msg_type, bool lossless,
+                                PerfFrame *pf)
+{
+    /* Update message type stats.  The stream clock is the wall clock
+     * for a live stream and the capture's MSM time during replay. */
+    stream_clock_feed(frame, frame_len);
+    double now = stream_clock_seconds();
+    GuiMsgStat *s = worker_stat_of(state, msg_type);
+    bw_burst_frame(&state->statsWork.burst, frame, frame_len, now);
+
+    if (s && !s->seen) {
+        s->seen = true;
+        s->last_time = now;
+        s->min_dt = s->max_dt = s->sum_dt = 0.0;
+    } else if (s) {
+        double dt = now - s->last_time;
+        s->last_time = now;
+        s->sum_dt += dt;
+        if (dt < s->min_dt || s->min_dt == 0.0)
+            s->min_dt = dt;
+        if (dt > s->max_dt)
+            s->max_dt = dt;
+        qsketch_add(&s->dt, dt);
+    }
+    if (s) {
+        s->count++;
+        bw_meter_add(&s->bw, now, frame_len, &state->statsWork.burst);
+    }
+
+    if (rtcm_msg_is_eph(msg_type) || rtcm_msg_is_msm(msg_type, 4, 7))
+        worker_obs_eph(state, frame, frame_len, msg_type, now);
+
+    /* Decode MSM frames once; every consumer below
+     * (satellite stats, CNR caches, sky plot, detail
+     * window) works from the same RtcmMsmObs. */
+    int msg_length = frame_len - 6;
+    RtcmMsmObs msm;
+    bool has_msm = rtcm_msg_is_msm(msg_type, 1, 7) &&
+        rtcm_decode_msm(frame + 3, msg_length, &msm);
+    perf_frame_stage(&state->perf, pf, PERF_STAGE_DECODE);
+
+    worker_msm_update(state, has_msm ? &msm : NULL, lossless);
+    perf_frame_stage(&state->perf, pf, PERF_STAGE_SKY);
+
+    worker_stats_publish(state, false);
+
+    /* Queue the frame for the UI thread: it keeps the newest frame of
+     * each type so that detail windows opened later still show content.
+     * Under load only every LOAD_GOV_DECIMATE-th frame of a type goes;
+     * the station position (1005/1006) always does. */
+    if (frame_len > GUI_BUFFER_SIZE) return;
+    if (msg_type != 1005 && msg_type != 1006 &&
+        !load_gov_keep(&state->loadGov, LOAD_WORK_DETAIL, s ? (uint32_t)s->count : 0))
+        return;
+    struct {
+        UiFrameRec    hdr;
+        unsigned char data[GUI_BUFFER_SIZE + sizeof(RtcmMsmObs)];
+    } rec;
+    rec.hdr.msg_type  = msg_type;
+    rec.hdr.frame_len = frame_len;
+    rec.hdr.has_msm   = has_msm;
+    rec.hdr.t_recv_us = 0;
+    rec.hdr.t_push_us = 0;
+    if (perf_probes_on) {
+        rec.hdr.t_recv_us = (unsigned int)(pf->t_recv / 1000);
+        rec.hdr.t_push_us = (unsigned int)(perf_now_ns() / 1000);
+    }
+    memcpy(rec.data, frame, (size_t)frame_len);
+    int rec_len = (int)sizeof(rec.hdr) + frame_len;
+    if (has_msm) {
+        memcpy(rec.data + frame_len, &msm, sizeof(msm));
+        rec_len += (int)sizeof(msm);
+    }
+    ui_push(state, UI_REC_FRAME, &rec, rec_len, lossless);
+}
+
+/* ── Obs stream decode stage ─────────────────────────────────────────
+ * WorkerOpenStream() only reads the socket and frames the bytes; every
+ * CRC-valid frame goes through a GuiFrameQueue to a decode thread that
+ * runs the analysis (stats, MSM decode, sky propagation, UI updates).  A slow consumer therefore no longer stops recv(): the
+ * queue absorbs bursts and, if it ever fills, frames are dropped and
+ * counted instead of letting the TCP window close.
+ *
+ * There is one decode thread rather than a pool: the decoders share
+ * process-wide caches (ephemerides, station ARP, per-band CNR) and the
+ * UI expects frames in stream order. */
+#define DECODE_QUEUE_SIZE  (1u << 20)   /* ~1000 max-size frames */
+
+typedef struct {
+    AppState      *state;
+    GuiFrameQueue  queue;
+    HANDLE         hThread;
+    volatile BOOL  done;      /* set by the I/O thread: drain and exit */
+} DecodeStage;
+
+/* Decode-queue records carry the frame's perf stamps ahead of its bytes. */
+typedef struct {
+    uint64_t t_recv;          /* recv() that delivered the frame; 0 = not timed */
+    uint64_t t_push;          /* pushed to the decode queue */
+    int64_t  rx_utc_ns;       /* UTC receive time, for the age of corrections */
+} DecodeStamp;
+
+/* Sample the load governor from the decode queue fill and, with --perf
+ * stamps, the age of the frame about to be decoded (@p t_recv, 0 = none).
+ * Called per frame and when the queue runs empty, at most every
+ * LOAD_GOV_SAMPLE_S. */
+static void decode_load_sample(DecodeStage *ds, uint64_t t_recv)
+{
+    AppState *state = ds->state;
+    uint64_t now_ns = perf_now_ns();
+    double now = now_ns / 1e9;
+    if (now - state->loadSampleTime < LOAD_GOV_SAMPLE_S) return;
+    state->loadSampleTime = now;
+
+    double fill = (double)gui_fq_depth(&ds->queue) / DECODE_QUEUE_SIZE;
+    double lag  = t_recv && now_ns > t_recv ? (now_ns - t_recv) / 1e9 : -1.0;
+    int before  = state->loadGov.level;
+    int level   = load_gov_sample(&state->loadGov,
+                                  load_gov_pressure(fill, lag, -1.0), now);
+    if (level > before)
+        WorkerLog(GUI_LOG_INFO, "[INFO] Decode falling behind (queue %.0f%%): %s\n",
+                                fill * 100.0,
+                                level == LOAD_SHED_SKY ? "sky and detail windows at 1 frame in 4"
+                                                       : "message trace paused");
+    else if (level < before)
+        WorkerLog(GUI_LOG_INFO, "[INFO] Decode caught up: %s\n",
+                                level == LOAD_FULL ? "full analysis again"
+                                                   : "message trace resumed");
+}
+
+/* Decode-thread half of a frame: everything that used to run inline in
+ * the receive loop.  @p rec is a DecodeStamp followed by the frame. */
+static void decode_frame(DecodeStage *ds, const unsigned char *rec, int rec_len)
+{
+    AppState *state = ds->state;
+    if (rec_len <= (int)sizeof(DecodeStamp)) return;
+    DecodeStamp st;
+    memcpy(&st, rec, sizeof(st));     /* queue storage is only 4-byte aligned */
+    const unsigned char *frame = rec + sizeof(st);
+    int frame_len = rec_len - (int)sizeof(st);
+    decode_load_sample(ds, st.t_recv);
+
+    PerfFrame pf;
+    perf_frame_start_at(&pf, st.t_recv);
+    if (perf_probes_on && st.t_push)
+        perf_hist_add(&state->perf.stage[PERF_STAGE_QUEUE], pf.t_mark - st.t_push);
+
+    corr_age_add(&state->statsWork.corrAge, frame, frame_len, st.rx_utc_ns);
+
+    /* Analyze the RTCM message */
+    int msg_type = analyze_rtcm_message(frame, frame_len, true, &state->config);
+    if (msg_type <= 0 || msg_type >= GUI_MAX_MSG_TYPES) return;
+
+    worker_handle_frame(state, frame, frame_len, msg_type, false, &pf);
+
+    if (load_gov_keep(&state->loadGov, LOAD_WORK_TEXT, 0))
+        WorkerLogTrace(msg_type);
+}
+
+static DWORD WINAPI WorkerDecodeStream(LPVOID param)
+{
+    DecodeStage *ds = (DecodeStage *)param;
+    AppState *state = ds->state;
+
+    WorkerLogBind(state, GUI_LOG_SRC_DECODE);
+    sky_epoch_init(&state->skyEpochs);
+    worker_stats_reset(state);
+
+    while (!state->bStopRequested) {
+        /* Sample done before draining so frames queued just before
+         * the I/O thread finished are still decoded. */
+        BOOL done = ds->done;
+        const unsigned char *frame;
+        int frame_len;
+        while (!state->bStopRequested &&
+               (frame = gui_fq_peek(&ds->queue, &frame_len, NULL)) != NULL) {
+            decode_frame(ds, frame, frame_len);
+            gui_fq_pop(&ds->queue);
+        }
+        decode_load_sample(ds, 0);              /* idle: let the level fall */
+        worker_stats_publish(state, false);     /* the last frames before a pause */
+        if (done) break;
+        gui_fq_wait(&ds->queue, 200);
+    }
+    worker_sky_flush(state, false);
+    worker_stats_publish(state, true);
+    WorkerLogUnbind();
+    return 0;
+}
+
+static bool decode_stage_start(DecodeStage *ds, AppState *state)
+{
+    ds->state = state;
+    ds->done  = FALSE;
+    if (!gui_fq_init(&ds->queue, DECODE_QUEUE_SIZE)) return false;
+    ds->hThread = CreateThread(NULL, 0, WorkerDecodeStream, ds, 0, NULL);
+    if (!ds->hThread) {
+        gui_fq_free(&ds->queue);
+        return false;
+    }
+    InterlockedExchange(&state->decodeQueueBytes, 0);
+    InterlockedExchange(&state->decodeQueuePeak, 0);
+    InterlockedExchange(&state->decodeQueueDrops, 0);
+    return true;
+}
+
+/* Publish the queue counters for the status bar. */
+static void decode_stage_publish(DecodeStage *ds)
+{
+    InterlockedExchange(&ds->state->decodeQueueBytes, gui_fq_depth(&ds->queue));
+    InterlockedExchange(&ds->state->decodeQueuePeak, ds->queue.peak);
+    InterlockedExchange(&ds->state->decodeQueueDrops, ds->queue.dropped);
+}
+
+static void decode_stage_stop(DecodeStage *ds)
+{
+    ds->done = TRUE;
+    gui_fq_signal(&ds->queue);
+    WaitForSingleObject(ds->hThread, INFINITE);
+    CloseHandle(ds->hThread);
+    decode_stage_publish(ds);
+    if (ds->queue.dropped > 0 || ds->queue.peak > (LONG)(DECODE_QUEUE_SIZE / 4)) {
+        WorkerLog(GUI_LOG_INFO, "[INFO] Decode queue: %ld frames, peak %ld kB, %ld dropped\n",
+                                (long)ds->queue.pushed, (long)(ds->queue.peak / 1024),
+                                (long)ds->queue.dropped);
+    }
+    gui_fq_free(&ds->queue);
+}
+
+/* WorkerOpenStream() framer context. */
+typedef struct {
+    AppState    *state;
+    DecodeStage *decode;
+    const NtripSession *session;    /* receive time of the current read */
+} StreamFrameCtx;
+
+/* I/O-thread half of a frame: queue the frame for the capture file and
+ * for the decode thread. */
+static void stream_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    StreamFrameCtx *ctx = (StreamFrameCtx *)user;
+    AppState *state = ctx->state;
+
+    if (frame_len < 8) return;      /* no room for a message number */
+    int msg_type = (frame[3] << 4) | (frame[4] >> 4);
+    if (msg_type <= 0 || msg_type >= GUI_MAX_MSG_TYPES) return;
+
+    /* RTCM stream capture, if enabled from the File menu.  Queued here
+     * on the I/O thread rather than after the decode queue so a native
+     * capture stamps the receive time; the recorder thread does the
+     * writing.  The critical section guards against the UI thread
+     * closing the recorder mid-push. */
+    if (state->csRtcmDumpInit) {
+        EnterCriticalSection(&state->csRtcmDump);
+        if (state->hRtcmDump)
+            rtcm_recorder_push(state->hRtcmDump, frame, frame_len);
+        LeaveCriticalSection(&state->csRtcmDump);
+    }
+
+    /* FRAME (recv -> CRC-valid frame) is timed here on the I/O thread;
+     * the stamps travel with the frame to the decode thread. */
+    if (frame_len > GUI_BUFFER_SIZE) return;
+    struct {
+        DecodeStamp   st;
+        unsigned char data[GUI_BUFFER_SIZE];
+    } rec;
+    PerfFrame pf;
+    perf_frame_begin(&state->perf, &pf);
+    rec.st.t_recv = pf.t_recv;
+    rec.st.t_push = perf_probes_on ? pf.t_mark : 0;
+    rec.st.rx_utc_ns = ctx->session->rx_utc_ns;
+    memcpy(rec.data, frame, (size_t)frame_len);
+    gui_fq_push(&ctx->decode->queue, &rec, (int)sizeof(rec.st) + frame_len, msg_type);
+}
+
 /* ── Get Mountpoints worker ──────────────────────────────── */
 
+/* STR lines collected while the sourcetable arrives, posted to the UI
+ * thread in batches so the list fills during the download. */
+#define MOUNT_ROWS_BATCH  200
+
+typedef struct {
+    AppState *state;
+    char     *buf;
+    size_t    len, cap;
+    int       lines;
+} MountRowBatch;
+
+static void mount_rows_flush(MountRowBatch *b)
+{
+    if (b->lines == 0) return;
+    /* The UI thread takes ownership of the string */
+    ui_lag_post(&b->state->uiLag, UI_LAG_MSG_MOUNT_ROWS, b->state->hMain,
+                WM_APP_MOUNT_ROWS, 0, (LPARAM)b->buf);
+    b->buf   = NULL;
+    b->len   = b->cap = 0;
+    b->lines = 0;
+}
+
+static void mount_rows_line(const char *line, size_t len, void *user)
+{
+    MountRowBatch *b = (MountRowBatch *)user;
+    if (len < 4 || strncmp(line, "STR;", 4) != 0) return;
+
+    if (b->len + len + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 16384;
+        while (b->len + len + 1 > cap) cap *= 2;
+        char *nb = (char *)realloc(b->buf, cap);
+        if (!nb) return;
+        b->buf = nb;
+        b->cap = cap;
+    }
+    memcpy(b->buf + b->len, line, len);
+    b->len += len;
+    b->buf[b->len] = '\0';
+    if (++b->lines >= MOUNT_ROWS_BATCH) mount_rows_flush(b);
+}
+
 DWORD WINAPI WorkerGetMountpoints(LPVOID param)
 {
     AppState *state = (AppState *)param;
 
-    char *mount_table = receive_mount_table(&state->config);
+    /* Shares the stream ring: hWorkerThread runs one of the two at a time */
+    WorkerLogBind(state, GUI_LOG_SRC_STREAM);
+
+    MountRowBatch batch = { state, NULL, 0, 0, 0 };
+    MountTableInfo info;
+    char *mount_table = receive_mount_table_ex(&state->config, mount_rows_line,
+                                               &batch, &info);
+    mount_rows_flush(&batch);
+    free(batch.buf);
+
+    if (mount_table && info.source == MOUNT_TABLE_STALE)
+        WorkerLog(GUI_LOG_WARN, "[WARN] Caster unreachable, using the cached sourcetable (%ld s old)\n",
+                  info.age_s);
+    else if (mount_table && info.source != MOUNT_TABLE_NETWORK)
+        WorkerLog(GUI_LOG_INFO, "[INFO] Sourcetable from cache (%s, %ld s old)\n",
+                  info.source == MOUNT_TABLE_REVALIDATED ? "not modified" : "within TTL",
+                  info.age_s);
+    WorkerLogUnbind();
 
     /* Post result to UI thread: wParam=0 success, 1 error; lParam=heap string */
-    PostMessage(state->hMain, WM_APP_MOUNT_RESULT,
+    ui_lag_post(&state->uiLag, UI_LAG_MSG_MOUNT_RESULT, state->hMain, WM_APP_MOUNT_RESULT,
                 (WPARAM)(mount_table ? 0 : 1),
                 (LPARAM)mount_table);
 
@@ -89,81 +648,41 @@ DWORD WINAPI WorkerGetMountpoints(LPVOID param)
 
 /* ── Open Stream worker (custom recv loop with real-time stats) ── */
 
-DWORD WINAPI WorkerOpenStream(LPVOID param)
+/* ntrip_session_resume() stop check: the user pressed Stop. */
+static int stream_stop_requested(void *user)
 {
-    AppState *state = (AppState *)param;
-
-    /* ── DNS resolve ─────────────────────────────────────── */
-    struct addrinfo hints, *result = NULL;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family   = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    if (getaddrinfo(state->config.NTRIP_CASTER, NULL, &hints, &result) != 0) {
-        printf("[ERROR] DNS resolution failed for %s\n", state->config.NTRIP_CASTER);
-        fflush(stdout);
-        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
-        return 1;
-    }
+    return ((AppState *)user)->bStopRequested ? 1 : 0;
+}
 
-    /* ── Create socket ───────────────────────────────────── */
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock == INVALID_SOCKET) {
-        printf("[ERROR] Failed to create socket\n");
-        fflush(stdout);
-        freeaddrinfo(result);
-        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
-        return 1;
-    }
+static DWORD worker_open_stream(LPVOID param)
+{
+    AppState *state = (AppState *)param;
 
-    /* ── Connect ─────────────────────────────────────────── */
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port   = htons(state->config.NTRIP_PORT);
-    server.sin_addr   = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&server.sin_zero, 0, 8);
-    freeaddrinfo(result);
-
-    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) == SOCKET_ERROR) {
-        printf("[ERROR] Connection failed to %s:%d\n",
-               state->config.NTRIP_CASTER, state->config.NTRIP_PORT);
-        fflush(stdout);
-        closesocket(sock);
-        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
+    /* ── Connect and send the NTRIP GET request ─────────────
+     * The session keeps the resolved addresses so a dropped stream is
+     * re-opened below; the 200 ms receive timeout lets the loop poll
+     * bStopRequested. */
+    NtripSession session;
+    if (!ntrip_session_open(&session, state->config.NTRIP_CASTER,
+                            state->config.NTRIP_PORT, state->config.MOUNTPOINT,
+                            state->config.AUTH_BASIC, state->config.RECONNECT_DELAY_MAX,
+                            200, "[STREAM]",
+                            ntrip_config_session_flags(&state->config, false))) {
+        WorkerLog(GUI_LOG_ERROR, "[ERROR] Connection failed to %s:%d\n",
+                                 state->config.NTRIP_CASTER, state->config.NTRIP_PORT);
+        ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
         return 1;
     }
 
-    /* ── Set receive timeout for clean stop ──────────────── */
-    DWORD timeout_ms = 200;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
-               (const char *)&timeout_ms, sizeof(timeout_ms));
-
-    /* ── Send NTRIP GET request ──────────────────────────── */
-    char request[1024];
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             state->config.MOUNTPOINT,
-             state->config.NTRIP_CASTER,
-             state->config.AUTH_BASIC);
-
-    if (send(sock, request, (int)strlen(request), 0) <= 0) {
-        printf("[ERROR] Failed to send NTRIP request\n");
-        fflush(stdout);
-        closesocket(sock);
-        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
-        return 1;
+    WorkerLog(GUI_LOG_INFO, "[INFO] Connected to %s:%d/%s\n",
+                            state->config.NTRIP_CASTER, state->config.NTRIP_PORT,
+                            state->config.MOUNTPOINT);
+    if (session.tls) {
+        char tls[96];
+        WorkerLog(GUI_LOG_INFO, "[INFO] TLS: %s\n",
+                                ntrip_tls_describe(session.tls, tls, sizeof(tls)));
     }
 
-    printf("[INFO] Connected to %s:%d/%s\n",
-           state->config.NTRIP_CASTER, state->config.NTRIP_PORT,
-           state->config.MOUNTPOINT);
-    fflush(stdout);
-
     /* ── Prepare initial GGA sentence ───────────────────────────
      * The position used is taken from the AppState's ggaOverride*
      * fields if a VRS position-shift test is active, otherwise from
@@ -189,9 +708,8 @@ DWORD WINAPI WorkerOpenStream(LPVOID param)
      * -- unless the user has explicitly disabled auto-send GGA via the
      * Tools menu (used to verify GGA-gated VRS behaviour). */
     if (state->ggaSendEnabled &&
-        send(sock, gga_with_crlf, (int)strlen(gga_with_crlf), 0) > 0) {
-        printf("[GGA] Sent initial GGA: %s\n", gga);
-        fflush(stdout);
+        ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf)) > 0) {
+        WorkerLog(GUI_LOG_INFO, "[GGA] Sent initial GGA: %s\n", gga);
         InterlockedIncrement(&state->ggaSendCount);
         InterlockedExchange(&state->ggaLastSendUnix, (LONG)time(NULL));
     }
@@ -200,32 +718,29 @@ DWORD WINAPI WorkerOpenStream(LPVOID param)
     InterlockedExchange(&state->streamBytes, 0);
     InterlockedExchange(&state->streamFormat, 0);
 
-    /* ── Stream format IDs (matches gui_state.h / gui_events.c) ── */
-    #define FMT_NONE     0
-    #define FMT_RTCM3    1
-    #define FMT_UBX      2
-    #define FMT_SBF      3
-    #define FMT_RT27     4
-    #define FMT_LB2      5
-    #define FMT_UNKNOWN  6
-
     /* ── Receive loop ────────────────────────────────────────── */
     unsigned char recv_buf[GUI_BUFFER_SIZE];
-    unsigned char msg_buf[GUI_BUFFER_SIZE];
-    int msg_pos = 0;
-    int msg_target = 0;   /* expected full frame length once known */
-    bool header_done = false;
-    char header_buf[4096];
-    int header_pos = 0;
-    int  detected_format = FMT_NONE;
-    bool decode_active   = false;   /* true once a supported format is confirmed */
-    bool unsupported_logged = false;
-    bool first_data_check = true;   /* true until first data byte is checked */
+    StreamFormat raw_format = STREAM_FMT_NONE;  /* RT27 / LB2 named by the sourcetable */
+
+    DecodeStage decode;
+    if (!decode_stage_start(&decode, state)) {
+        WorkerLog(GUI_LOG_ERROR, "[ERROR] Failed to start decode thread\n");
+        ntrip_session_close(&session);
+        ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
+        return 1;
+    }
+
+    StreamFrameCtx frame_ctx = { state, &decode, &session };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, stream_frame, &frame_ctx);
+    framer.anomalies = &state->anomalies;
 
     /* ── Pre-seed format from sourcetable if available ──────── */
     /* The sourcetable Format + Details columns identify the stream type.
      * RAW streams (RT27, LB2) are wrapped inside RTCM 3.x framing, so
      * byte-level sync detection alone would mis-identify them as RTCM.
+     * For the others the name is shown until the framer's sniffer
+     * (stream_format.h) has looked at the bytes.
      *
      * We search both Format and Details for known keywords using
      * case-insensitive substring matching to handle variations like
@@ -234,42 +749,33 @@ DWORD WINAPI WorkerOpenStream(LPVOID param)
         const char *fmt = state->sourceFormat;
         const char *det = state->sourceDetails;
 
-        printf("[INFO] Sourcetable — Format: \"%s\", Details: \"%s\"\n", fmt, det);
-        fflush(stdout);
+        WorkerLog(GUI_LOG_INFO, "[INFO] Sourcetable — Format: \"%s\", Details: \"%s\"\n", fmt, det);
 
         /* Helper: case-insensitive substring search */
         #define CONTAINS_CI(haystack, needle) (stristr((haystack), (needle)) != NULL)
 
         if (CONTAINS_CI(fmt, "RT27") || CONTAINS_CI(det, "RT27")) {
-            detected_format = FMT_RT27;
-            decode_active = true;
-            InterlockedExchange(&state->streamFormat, FMT_RT27);
-            PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-            printf("[INFO] RAW Trimble RT27 stream (RTCM framing) — decoding active\n");
-            fflush(stdout);
+            raw_format = STREAM_FMT_RT27;
+            InterlockedExchange(&state->streamFormat, STREAM_FMT_RT27);
+            ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
+            WorkerLog(GUI_LOG_INFO, "[INFO] RAW Trimble RT27 stream (RTCM framing) — decoding active\n");
         } else if (CONTAINS_CI(fmt, "LB2") || CONTAINS_CI(det, "LB2")) {
-            detected_format = FMT_LB2;
-            decode_active = true;
-            InterlockedExchange(&state->streamFormat, FMT_LB2);
-            PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-            printf("[INFO] RAW Leica LB2 stream (RTCM framing) — decoding active\n");
-            fflush(stdout);
+            raw_format = STREAM_FMT_LB2;
+            InterlockedExchange(&state->streamFormat, STREAM_FMT_LB2);
+            ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
+            WorkerLog(GUI_LOG_INFO, "[INFO] RAW Leica LB2 stream (RTCM framing) — decoding active\n");
         } else if (CONTAINS_CI(fmt, "SBF") || CONTAINS_CI(det, "SBF") ||
                    CONTAINS_CI(fmt, "Septentrio")) {
-            detected_format = FMT_SBF;
-            InterlockedExchange(&state->streamFormat, FMT_SBF);
-            PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-            printf("[INFO] Septentrio SBF stream detected\n");
-            fflush(stdout);
+            InterlockedExchange(&state->streamFormat, STREAM_FMT_SBF);
+            ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
+            WorkerLog(GUI_LOG_INFO, "[INFO] Sourcetable says Septentrio SBF\n");
         } else if (CONTAINS_CI(fmt, "UBX") || CONTAINS_CI(det, "UBX") ||
                    CONTAINS_CI(fmt, "BINEX")) {
-            detected_format = FMT_UBX;
-            InterlockedExchange(&state->streamFormat, FMT_UBX);
-            PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-            printf("[INFO] UBX stream detected\n");
-            fflush(stdout);
+            InterlockedExchange(&state->streamFormat, STREAM_FMT_UBX);
+            ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
+            WorkerLog(GUI_LOG_INFO, "[INFO] Sourcetable says UBX\n");
         }
-        /* else: RTCM or unknown — let byte-level + frame decode identify */
+        /* else: RTCM or unknown — the framer's sniffer identifies it */
 
         #undef CONTAINS_CI
     }
@@ -296,13 +802,11 @@ DWORD WINAPI WorkerOpenStream(LPVOID param)
                 create_gngga_sentence(cur_lat, cur_lon, gga);
                 snprintf(gga_with_crlf, sizeof(gga_with_crlf),
                          "%s\r\n", gga);
-                printf("[GGA] Position changed -> %s\n", gga);
-                fflush(stdout);
+                WorkerLog(GUI_LOG_INFO, "[GGA] Position changed -> %s\n", gga);
             }
-            if (send(sock, gga_with_crlf,
-                     (int)strlen(gga_with_crlf), 0) > 0) {
-                printf("[GGA] Sent GGA\n");
-                fflush(stdout);
+            if (ntrip_session_send(&session, gga_with_crlf,
+                                   (int)strlen(gga_with_crlf)) > 0) {
+                WorkerLog(GUI_LOG_INFO, "[GGA] Sent GGA\n");
                 InterlockedIncrement(&state->ggaSendCount);
                 InterlockedExchange(&state->ggaLastSendUnix,
                                     (LONG)time(NULL));
@@ -310,499 +814,142 @@ DWORD WINAPI WorkerOpenStream(LPVOID param)
             last_gga_time = now_t;
         }
 
-        int n = recv(sock, (char *)recv_buf, sizeof(recv_buf), 0);
-
-        if (n == 0) {
-            /* Server closed connection */
-            printf("\n[INFO] Server closed connection\n");
-            fflush(stdout);
-            break;
-        }
+        int n = ntrip_session_recv(&session, recv_buf, (int)sizeof(recv_buf));
 
-        if (n < 0) {
-            int err = WSAGetLastError();
-            if (err == WSAETIMEDOUT) {
+        if (n <= 0) {
+            int err = n < 0 ? WSAGetLastError() : 0;
+            if (n < 0 && err == WSAETIMEDOUT) {
                 /* Timeout — check stop flag and loop */
                 continue;
             }
-            printf("\n[ERROR] recv error %d\n", err);
-            fflush(stdout);
-            break;
+            /* Lost the connection: re-open it.  The decode stage, stats,
+             * sky sectors and the ephemeris store are left as they are;
+             * only the HTTP header skip and the framer start over. */
+            if (n == 0)
+                WorkerLog(GUI_LOG_WARN, "[WARN] Server closed connection; reconnecting\n");
+            else
+                WorkerLog(GUI_LOG_WARN, "[WARN] recv error %d; reconnecting\n", err);
+            if (!ntrip_session_resume(&session, n == 0 ? "caster closed the connection"
+                                                       : "receive error",
+                                      stream_stop_requested, state))
+                break;
+            const NtripSessionGap *gap =
+                &session.gaps[(session.gap_count - 1) % NTRIP_SESSION_MAX_GAPS];
+            WorkerLog(GUI_LOG_WARN, "[WARN] Reconnected after a %.1f s gap (reconnect %d)\n",
+                                    gap->seconds, session.reconnects);
+            rtcm_framer_reset(&framer);
+            last_gga_time = 0;
+            continue;
         }
 
-        /* ── Skip HTTP response header ───────────────────── */
+        perf_recv(&state->perf);
+
+        /* ── Strip HTTP header and chunk framing ─────────── */
+        /* The session's reply decoder works in place: afterwards only
+         * stream bytes are left at the front of recv_buf. */
         int start = 0;
-        if (!header_done) {
-            for (int i = 0; i < n && !header_done; i++) {
-                if (header_pos < (int)sizeof(header_buf) - 1)
-                    header_buf[header_pos++] = recv_buf[i];
-
-                /* Look for \r\n\r\n end of header */
-                if (header_pos >= 4 &&
-                    header_buf[header_pos - 4] == '\r' &&
-                    header_buf[header_pos - 3] == '\n' &&
-                    header_buf[header_pos - 2] == '\r' &&
-                    header_buf[header_pos - 1] == '\n') {
-                    header_done = true;
-                    start = i + 1;
-
-                    /* Check for ICY 200 OK or HTTP/1.x 200 */
-                    header_buf[header_pos] = '\0';
-                    if (!strstr(header_buf, "200") &&
-                        !strstr(header_buf, "ICY")) {
-                        printf("[ERROR] Server response:\n%s\n", header_buf);
-                        fflush(stdout);
-                        closesocket(sock);
-                        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
-                        return 1;
-                    }
-                    printf("[INFO] Stream started\n");
-                    fflush(stdout);
-                }
-            }
-            if (!header_done)
+        bool in_header = !ntrip_http_head_done(&session.http);
+        n = (int)ntrip_http_decode(&session.http, recv_buf, (size_t)n);
+        if (in_header) {
+            if (!ntrip_http_head_done(&session.http))
                 continue;
+
+            /* ICY 200 OK or HTTP/1.x 200 */
+            if (!ntrip_http_ok(&session.http)) {
+                WorkerLog(GUI_LOG_ERROR, "[ERROR] Server response:\n%s\n",
+                          session.http.status_line);
+                decode_stage_stop(&decode);
+                ntrip_session_close(&session);
+                ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
+                return 1;
+            }
+            WorkerLog(GUI_LOG_INFO, session.http.chunked
+                                    ? "[INFO] Stream started (chunked transfer)\n"
+                                    : "[INFO] Stream started\n");
         }
+        if (n == 0)
+            continue;
 
         /* ── Track received data bytes ───────────────────── */
         int dataBytes = n - start;
         if (dataBytes > 0)
             InterlockedExchangeAdd(&state->streamBytes, dataBytes);
 
-        /* ═══════════════════════════════════════════════════════
-         *  PHASE 1 — Format detection
-         *
-         *  Identify the stream format from sync/header bytes.
-         *  RTCM 3.x is confirmed later by a successful frame decode.
-         *
-         *  Distinctive 2-byte sync patterns (scanned anywhere in data):
-         *    Septentrio SBF : 0x24 0x40  ("$@")
-         *    UBX (u-blox)   : 0xB5 0x62
-         *
-         *  Weaker patterns (checked only at start of stream data):
-         *    Trimble RT27   : first byte 0x10, second ≠ 0x10/0x03
-         *    Leica LB2      : first byte 0x01, second ≤ 0x80 & > 0
-         *
-         *  These weaker patterns must only match the very first data
-         *  bytes after the HTTP header, not arbitrary mid-stream bytes,
-         *  to avoid false positives inside RTCM payload data.
-         * ═══════════════════════════════════════════════════════ */
-        if (detected_format == FMT_NONE && dataBytes > 0) {
-            /* RTCM 3.x first.  Scan for the 0xD3 preamble at any position
-             * and verify the next two bytes encode a plausible length
-             * (RTCM 10403.3 message length is 10 bits, range 0..1023; the
-             * top 6 bits of byte 1 must be zero).  This is a much stronger
-             * signal than the 2-byte SBF/UBX syncs, and pre-empts the
-             * false-positive case where an RTCM payload happens to
-             * contain `$@` (0x24 0x40) or another sync sequence. */
-            int rtcm_pos = -1;
-            for (int j = start; j + 2 < n; j++) {
-                if (recv_buf[j] == 0xD3 &&
-                    (recv_buf[j + 1] & 0xFC) == 0x00) {
-                    int rtcm_len = ((recv_buf[j + 1] & 0x03) << 8) |
-                                    recv_buf[j + 2];
-                    if (rtcm_len >= 2 && rtcm_len <= 1023) {
-                        rtcm_pos = j;
-                        break;
-                    }
-                }
-            }
-            if (rtcm_pos >= 0) {
-                detected_format = FMT_RTCM3;
-                /* Leave the slower in-loop framer to confirm via CRC --
-                 * we've already pinned the format so the rest of the
-                 * receive path goes straight to RTCM decoding. */
-            }
-            /* Only fall back to SBF/UBX 2-byte heuristic when RTCM didn't
-             * latch.  This prevents `$@` or `0xB5 0x62` appearing inside
-             * a perfectly valid RTCM payload from hijacking the stream. */
-            if (detected_format == FMT_NONE) {
-                for (int j = start; j < n - 1; j++) {
-                    /* Septentrio SBF: sync "$@" (0x24 0x40) */
-                    if (recv_buf[j] == 0x24 && recv_buf[j + 1] == 0x40) {
-                        detected_format = FMT_SBF;
-                        break;
-                    }
-                    /* UBX (u-blox): sync 0xB5 0x62 */
-                    if (recv_buf[j] == 0xB5 && recv_buf[j + 1] == 0x62) {
-                        detected_format = FMT_UBX;
-                        break;
-                    }
-                }
-            }
-
-            /* Check weaker patterns only at the very first data byte
-             * of the stream (first recv after HTTP header). */
-            if (detected_format == FMT_NONE && first_data_check) {
-                unsigned char b0 = recv_buf[start];
-                /* Trimble RT27: DLE-stuffed framing starts with 0x10
-                 * followed by a record type byte (not DLE/ETX). */
-                if (b0 == 0x10 && dataBytes >= 4 &&
-                    recv_buf[start + 1] != 0x10 &&
-                    recv_buf[start + 1] != 0x03) {
-                    detected_format = FMT_RT27;
-                }
-                /* Leica LB2: starts with 0x01, second byte is length. */
-                else if (b0 == 0x01 && dataBytes >= 3 &&
-                         recv_buf[start + 1] <= 0x80 &&
-                         recv_buf[start + 1] > 0 &&
-                         recv_buf[start + 2] < 0x40) {
-                    detected_format = FMT_LB2;
-                }
-                /* If the very first byte is 0xD3 (RTCM preamble), don't
-                 * flag any weak-pattern format — let the RTCM framing
-                 * loop confirm it via successful decode. */
-                first_data_check = false;
-            }
-
-            /* If a non-RTCM format was identified, publish it and decide
-             * whether to activate decoding. */
-            if (detected_format != FMT_NONE) {
-                InterlockedExchange(&state->streamFormat, detected_format);
-                PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-
-                /* Currently only RTCM 3.x has a decoder — mark others
-                 * as detected-but-unsupported so the receive loop keeps
-                 * counting bytes without trying to frame/decode. */
-                switch (detected_format) {
-                case FMT_RTCM3:
-                    decode_active = true;
-                    printf("[INFO] RTCM 3.x stream detected — decoding active\n");
-                    fflush(stdout);
-                    break;
-                default:
-                    /* Future decoders: add case FMT_xxx: decode_active = true; break; */
-                    decode_active = false;
-                    break;
-                }
-            }
-        }
-
-        /* ═══════════════════════════════════════════════════════
-         *  Log once when an unsupported format is detected.
-         * ═══════════════════════════════════════════════════════ */
-        if (detected_format != FMT_NONE && !decode_active && !unsupported_logged) {
-            const char *name = "Unknown";
-            switch (detected_format) {
-            case FMT_UBX:  name = "UBX (u-blox)";     break;
-            case FMT_SBF:  name = "Septentrio SBF";    break;
-            case FMT_RT27: name = "Trimble RT27";       break;
-            case FMT_LB2:  name = "Leica LB2";          break;
-            }
-            printf("[INFO] %s stream detected — decoding not yet supported\n", name);
-            fflush(stdout);
-            unsupported_logged = true;
-        }
-
-        /* If a non-RTCM format was detected and decoding is not
-         * active for it, keep receiving to update byte counter and
-         * data rate but skip the framing/decode loop. */
-        if (detected_format != FMT_NONE && !decode_active) {
-            continue;
-        }
-
-        /* ═══════════════════════════════════════════════════════
-         *  PHASE 2 — Stream decoding
-         *
-         *  When detected_format == FMT_NONE the RTCM framing loop
-         *  runs speculatively; a successful decode confirms RTCM 3.x.
-         *  When detected_format == FMT_RTCM3, decoding is active.
-         *
-         *  Future formats: add additional decode branches here,
-         *  guarded by detected_format == FMT_xxx.
-         * ═══════════════════════════════════════════════════════ */
-        for (int i = start; i < n; i++) {
-            unsigned char b = recv_buf[i];
-
-            /* Looking for RTCM 3.x preamble */
-            if (msg_pos == 0) {
-                if (b == 0xD3) {
-                    msg_buf[msg_pos++] = b;
-                }
-                continue;
-            }
-
-            msg_buf[msg_pos++] = b;
-
-            /* Once we have 3 bytes, compute expected frame length */
-            if (msg_pos == 3) {
-                int msg_length = ((msg_buf[1] & 0x03) << 8) | msg_buf[2];
-                msg_target = msg_length + 6;  /* preamble(1) + len(2) + payload + crc(3) */
-
-                if (msg_target > GUI_BUFFER_SIZE) {
-                    /* Invalid — reset */
-                    msg_pos = 0;
-                    msg_target = 0;
-                    continue;
-                }
-            }
-
-            /* Check if full frame received */
-            if (msg_target > 0 && msg_pos >= msg_target) {
-                /* Analyze the RTCM message */
-                int msg_type = analyze_rtcm_message(msg_buf, msg_target,
-                                                     true, &state->config);
-
-                if (msg_type > 0 && msg_type < GUI_MAX_MSG_TYPES) {
-                    /* RTCM stream capture: write the raw frame bytes to
-                     * disk if the user enabled capture from the File menu.
-                     * The critical section guards against the UI thread
-                     * closing the FILE* mid-write. */
-                    if (state->csRtcmDumpInit) {
-                        EnterCriticalSection(&state->csRtcmDump);
-                        if (state->hRtcmDump) {
-                            size_t w = fwrite(msg_buf, 1, (size_t)msg_target,
-                                              state->hRtcmDump);
-                            state->rtcmDumpBytes += (LONG)w;
-                        }
-                        LeaveCriticalSection(&state->csRtcmDump);
-                    }
-
-                    /* Confirm RTCM 3.x format on first successful decode */
-                    if (detected_format == FMT_NONE) {
-                        detected_format = FMT_RTCM3;
-                        decode_active = true;
-                        InterlockedExchange(&state->streamFormat, FMT_RTCM3);
-                        PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-                        printf("[INFO] RTCM 3.x stream confirmed — decoding active\n");
-                        fflush(stdout);
-                    }
-
-                    /* Update message type stats */
-                    double now = gui_get_time_seconds();
-                    GuiMsgStat *s = &state->msgStats[msg_type];
-
-                    if (!s->seen) {
-                        s->seen = true;
-                        s->last_time = now;
-                        s->min_dt = s->max_dt = s->sum_dt = 0.0;
-                    } else {
-                        double dt = now - s->last_time;
-                        s->last_time = now;
-                        s->sum_dt += dt;
-                        if (dt < s->min_dt || s->min_dt == 0.0)
-                            s->min_dt = dt;
-                        if (dt > s->max_dt)
-                            s->max_dt = dt;
-                    }
-                    s->count++;
-
-                    /* Notify UI thread — message stats */
-                    PostMessage(state->hMain, WM_APP_STAT_UPDATE,
-                                (WPARAM)msg_type, (LPARAM)s->count);
-
-                    /* Extract satellite info from MSM messages (1070-1139) */
-                    int msg_length = ((msg_buf[1] & 0x03) << 8) | msg_buf[2];
-                    extract_satellites(msg_buf + 3, msg_length,
-                                       msg_type, &state->satStats);
-
-                    /* Notify UI thread — satellite update */
-                    PostMessage(state->hMain, WM_APP_SAT_UPDATE, 0, 0);
-
-                    /* ── Sky-plot update for MSM4/5/6/7 frames ──────────
-                     * Two inputs needed: a station ARP and a valid
-                     * ephemeris per SV.  Many casters (e.g. Onocoy
-                     * observation streams) omit 1005/1006/1019/1045/1046
-                     * entirely.  Fall back to the user-configured rover
-                     * lat/lon for the ARP when no 1005/1006 has arrived.
-                     * Ephemeris has no fallback — without 1019/1045/1046
-                     * we can't position SVs, but we still post an empty
-                     * update so the status line refreshes. */
-                    {
-                        bool   arp_valid = false;
-                        double sx = 0, sy = 0, sz = 0;
-                        rtcm_get_station_arp(&arp_valid, &sx, &sy, &sz,
-                                             NULL, NULL, NULL);
-
-                        if (!arp_valid &&
-                            (state->config.LATITUDE != 0.0 ||
-                             state->config.LONGITUDE != 0.0)) {
-                            geodetic_to_ecef(state->config.LATITUDE,
-                                             state->config.LONGITUDE,
-                                             0.0, &sx, &sy, &sz);
-                            arp_valid = true;
-                        }
-
-                        int prns[64];
-                        float cnr_prns[64];
-                        int gnss_id = 0;
-                        int n_prns = arp_valid
-                            ? msm_extract_prns(msg_buf + 3, msg_length,
-                                               msg_type, prns,
-                                               (int)(sizeof(prns) / sizeof(prns[0])),
-                                               &gnss_id)
-                            : 0;
-
-                        /* For MSM7, also pull per-SV best CNR.  Use the
-                         * PRN list from msm_extract_prns as authoritative;
-                         * the CNR extractor returns the same PRN order. */
-                        int   cnr_n = 0;
-                        int   cnr_prn_list[64];
-                        if (n_prns > 0 && (msg_type % 10) == 7) {
-                            cnr_n = msm7_extract_cnr(msg_buf + 3, msg_length,
-                                                     msg_type,
-                                                     cnr_prn_list, cnr_prns,
-                                                     64, NULL);
-                            /* Also populate the per-band CNR cache used by
-                             * the SV detail window. */
-                            msm7_update_per_band_cnr(msg_buf + 3, msg_length,
-                                                     msg_type);
-                        } else {
-                            for (int i = 0; i < 64; i++) cnr_prns[i] = 0.0f;
-                        }
-
-                        /* Build a PRN->CNR lookup for fast access below. */
-                        float cnr_by_prn[SV_EPH_MAX_SATS_PER_GNSS + 1];
-                        for (int i = 0; i <= SV_EPH_MAX_SATS_PER_GNSS; i++)
-                            cnr_by_prn[i] = 0.0f;
-                        for (int i = 0; i < cnr_n; i++) {
-                            int p = cnr_prn_list[i];
-                            if (p >= 1 && p <= SV_EPH_MAX_SATS_PER_GNSS)
-                                cnr_by_prn[p] = cnr_prns[i];
-                        }
-
-                        int upd_count = 0;
-                        SkySatUpdate *upd = NULL;
-
-                        /* Per-MSM-frame sky update.  We emit one SkySatUpdate
-                         * for EVERY above-horizon SV that has a valid cached
-                         * ephemeris in the same GNSS as this MSM frame, not
-                         * only the SVs that the receiver tracked.  The flag
-                         * observed_flag=1 marks the ones in this frame's sat
-                         * mask; =0 means "expected by ephemeris but not in the
-                         * MSM".  The UI handler uses both flags to drive the
-                         * heatmap's observed/expected counters. */
-                        if (n_prns > 0 &&
-                            (gnss_id == 1 || gnss_id == 2 ||
-                             gnss_id == 3 || gnss_id == 4 || gnss_id == 5 ||
-                             gnss_id == 7)) {
-                            int    gps_week;
-                            double gps_tow;
-                            sky_get_gps_time(&gps_week, &gps_tow);
-                            double glo_tod = sky_get_glo_tod();
-                            double t_prop  = (gnss_id == 2) ? glo_tod : gps_tow;
-
-                            /* O(1) membership test for "was this PRN in the
-                             * MSM frame" -- build a bitset over PRN [1..64]. */
-                            uint64_t obs_mask = 0;
-                            for (int i = 0; i < n_prns; i++) {
-                                int p = prns[i];
-                                if (p >= 1 && p <= 64) obs_mask |= 1ULL << (p - 1);
-                            }
-
-                            /* Allocate worst-case (all PRNs in this GNSS). */
-                            upd = (SkySatUpdate *)HeapAlloc(
-                                GetProcessHeap(), 0,
-                                sizeof(SkySatUpdate) *
-                                (size_t)SV_EPH_MAX_SATS_PER_GNSS);
-
-                            if (upd) {
-                                for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
-                                    const SvEphemeris *eph = sv_eph_get(gnss_id, p);
-                                    if (!eph) continue;
-                                    if (!sv_eph_is_valid_at(eph, gps_week, t_prop))
-                                        continue;
-
-                                    double svx, svy, svz;
-                                    if (!sv_to_ecef(eph, gps_week, t_prop,
-                                                    &svx, &svy, &svz))
-                                        continue;
-
-                                    double az_d, el_d;
-                                    azel_from_ecef(sx, sy, sz,
-                                                   svx, svy, svz,
-                                                   &az_d, &el_d);
-
-                                    if (el_d <= 0.0) continue;
-
-                                    int observed_flag = (p >= 1 && p <= 64)
-                                        ? ((obs_mask >> (p - 1)) & 1ULL) ? 1 : 0
-                                        : 0;
-
-                                    float cnr_dbhz = 0.0f;
-                                    if (observed_flag &&
-                                        p >= 1 && p <= SV_EPH_MAX_SATS_PER_GNSS)
-                                        cnr_dbhz = cnr_by_prn[p];
-
-                                    upd[upd_count].gnss_id       = gnss_id;
-                                    upd[upd_count].prn           = p;
-                                    upd[upd_count].az_deg        = (float)az_d;
-                                    upd[upd_count].el_deg        = (float)el_d;
-                                    upd[upd_count].cnr_dbhz      = cnr_dbhz;
-                                    upd[upd_count].observed_flag = observed_flag;
-                                    upd_count++;
-                                }
-                            }
-                        }
-
-                        /* Post even when upd_count == 0 so the status line
-                         * in the sky window refreshes (shows "waiting for
-                         * ephemeris..." etc.).  UI handler frees @c upd. */
-                        if (!PostMessage(state->hMain, WM_APP_SKY_UPDATE,
-                                         (WPARAM)upd_count, (LPARAM)upd)) {
-                            if (upd) HeapFree(GetProcessHeap(), 0, upd);
-                        }
-                    }
-
-                    /* Post raw RTCM frame to UI thread for decoding and
-                     * caching.  The UI handler stores the decoded text so
-                     * that detail windows opened later still show content. */
-                    RtcmRawMsg *raw = (RtcmRawMsg *)HeapAlloc(
-                        GetProcessHeap(), 0, sizeof(RtcmRawMsg));
-                    if (raw) {
-                        raw->msg_type = msg_type;
-                        raw->length   = msg_target;
-                        memcpy(raw->data, msg_buf, msg_target);
-                        if (!PostMessage(state->hMain, WM_APP_MSG_RAW,
-                                         (WPARAM)msg_type, (LPARAM)raw)) {
-                            HeapFree(GetProcessHeap(), 0, raw);
-                        }
-                    }
-
-                    printf("%d ", msg_type);
-                    fflush(stdout);
-                }
-
-                /* Reset for next frame */
-                msg_pos = 0;
-                msg_target = 0;
+        /* The framer sniffs the format first (stream_format.h) and
+         * hands on RTCM 3.x frames only; a UBX or SBF stream is framed
+         * and counted without reaching the decode thread. */
+        rtcm_framer_push(&framer, recv_buf + start, (size_t)(n - start));
+        StreamFormat new_fmt = rtcm_framer_new_format(&framer);
+        if (new_fmt != STREAM_FMT_NONE) {
+            if (new_fmt == STREAM_FMT_RTCM3 && raw_format != STREAM_FMT_NONE) {
+                new_fmt = raw_format;       /* announced with the sourcetable */
+            } else if (new_fmt == STREAM_FMT_RTCM3) {
+                WorkerLog(GUI_LOG_INFO, "[INFO] RTCM 3.x stream confirmed — decoding active\n");
+            } else if (new_fmt == STREAM_FMT_UNKNOWN) {
+                WorkerLog(GUI_LOG_WARN, "[WARN] No RTCM 3.x, UBX or SBF frame in %d bytes; "
+                                        "still looking\n", STREAM_SNIFF_WINDOW);
+            } else {
+                WorkerLog(GUI_LOG_INFO, "[INFO] %s stream detected — decoding not yet supported\n",
+                          stream_format_name(new_fmt));
             }
+            InterlockedExchange(&state->streamFormat, new_fmt);
+            ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
         }
+        gui_fq_signal(&decode.queue);
+        decode_stage_publish(&decode);
     }
 
-    closesocket(sock);
-
-    printf("\n[INFO] Stream worker finished\n");
-    fflush(stdout);
-
-    PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
+    decode_stage_stop(&decode);
+    ntrip_session_close(&session);
+    if (session.gap_count > 0)
+        WorkerLog(GUI_LOG_INFO, "[INFO] %d reconnect(s), %d outage(s), %.1f s without data\n",
+                                session.reconnects, session.gap_count, session.gap_total_s);
+    if (session.tls_full + session.tls_resumed > 0)
+        WorkerLog(GUI_LOG_INFO, "[INFO] TLS handshakes: %d full (%.1f ms avg), %d resumed (%.1f ms avg)\n",
+                                session.tls_full,
+                                session.tls_full ? session.tls_full_ms / session.tls_full : 0.0,
+                                session.tls_resumed,
+                                session.tls_resumed ? session.tls_resumed_ms / session.tls_resumed
+                                                    : 0.0);
+
+    WorkerLog(GUI_LOG_INFO, "[INFO] Stream worker finished\n");
+
+    ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
     return 0;
 }
 
-/**
- * @brief Post a log line to the UI thread, bypassing the stdout pipe.
- *
- * The stdout->pipe->LogPumpTimer chain depends on WM_TIMER (low priority).
- * Worker threads can post lines directly into the UI's message queue so
- * they show up reliably even when the queue is busy with WM_APP_* updates.
- */
-static void eph_log(AppState *state, const char *fmt, ...)
+/* Thread entry: log lines go to the worker's own ring (gui_log.c). */
+DWORD WINAPI WorkerOpenStream(LPVOID param)
 {
-    char buf[512];
-    va_list ap;
-    va_start(ap, fmt);
-    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
-    va_end(ap);
-    if (n <= 0) return;
-    if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
-
-    size_t copy_sz = (size_t)n + 1;
-    char *dup = (char *)HeapAlloc(GetProcessHeap(), 0, copy_sz);
-    if (!dup) return;
-    memcpy(dup, buf, copy_sz);
-
-    if (!PostMessage(state->hMain, WM_APP_LOG_LINE, 0, (LPARAM)dup)) {
-        HeapFree(GetProcessHeap(), 0, dup);
+    WorkerLogBind((AppState *)param, GUI_LOG_SRC_STREAM);
+    DWORD rc = worker_open_stream(param);
+    WorkerLogUnbind();
+    return rc;
+}
+
+/* WorkerOpenEphStream() framer context. */
+typedef struct {
+    AppState *state;
+    int       eph_count;   /* total ephemerides cached so far */
+} EphFrameCtx;
+
+static void eph_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    EphFrameCtx *ctx = (EphFrameCtx *)user;
+
+    /* Peek message number (first 12 bits of payload, which
+     * starts at byte index 3 of the frame).  RTCM packs the
+     * 12-bit field across bytes 3 and 4. */
+    int payload_len = frame_len - 6;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+
+    /* Ephemeris types only.  Everything else is dropped --
+     * including 1005/1006, which we must not let overwrite
+     * the obs ARP. */
+    if (rtcm_msg_is_eph(mt)) {
+        rtcm_msg_info(mt)->decode(NULL, &frame[3], payload_len,
+                                  &ctx->state->config);
+        ctx->eph_count++;
     }
 }
 
@@ -816,64 +963,62 @@ static void eph_log(AppState *state, const char *fmt, ...)
  * Deliberately does NOT:
  *   - send GGA (eph streams don't need a rover position),
  *   - process 1005/1006 (would overwrite the obs caster's ARP),
- *   - update msgStats / satStats / Msg Stats ListView,
- *   - post WM_APP_MSG_RAW (detail-window machinery is for the obs stream),
+ *   - update the message / satellite statistics or the Msg Stats ListView,
+ *   - queue UI frame records (detail-window machinery is for the obs stream),
  *   - touch the byte-rate / status-bar counters.
  *
  * Lifetime is controlled via state->bStopRequestedEph; cleanup is via
  * WM_APP_STREAM_DONE from the obs worker tearing both down at once.
  */
-DWORD WINAPI WorkerOpenEphStream(LPVOID param)
+static DWORD worker_open_eph_stream(LPVOID param)
 {
     AppState *state = (AppState *)param;
 
     /* Beacon: first thing every worker invocation does, even before the
-     * gate check.  Posted via WM_APP_LOG_LINE (not printf) because the
-     * stdout pipe pump can be starved by high message-queue traffic. */
-    eph_log(state,
-            "[EPH] Worker entered: caster=\"%s\" port=%d mp=\"%s\"\r\n",
-            state->config.EPH_CASTER,
-            state->config.EPH_PORT,
-            state->config.EPH_MOUNTPOINT);
+     * gate check. */
+    WorkerLog(GUI_LOG_INFO,
+                     "[EPH] Worker entered: caster=\"%s\" port=%d mp=\"%s\"\r\n",
+                     state->config.EPH_CASTER,
+                     state->config.EPH_PORT,
+                     state->config.EPH_MOUNTPOINT);
 
     /* Refuse to start if no mountpoint is configured */
     if (state->config.EPH_MOUNTPOINT[0] == '\0' ||
         state->config.EPH_CASTER[0]     == '\0') {
-        eph_log(state, "[EPH] Disabled (no caster/mountpoint configured)\r\n");
+        WorkerLog(GUI_LOG_INFO, "[EPH] Disabled (no caster/mountpoint configured)\r\n");
         return 0;
     }
 
-    /* ── DNS resolve ─────────────────────────────────────── */
-    struct addrinfo hints, *result = NULL;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family   = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    if (getaddrinfo(state->config.EPH_CASTER, NULL, &hints, &result) != 0) {
-        eph_log(state, "[EPH] DNS resolution failed for %s\r\n",
-                state->config.EPH_CASTER);
+    /* ── DNS resolve + connect ───────────────────────────── */
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];
+    int n_addrs = ntrip_dns_lookup(state->config.EPH_CASTER, state->config.EPH_PORT,
+                                   addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+    if (n_addrs == 0) {
+        WorkerLog(GUI_LOG_ERROR, "[EPH] DNS resolution failed for %s\r\n",
+                          state->config.EPH_CASTER);
         return 1;
     }
 
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    SOCKET sock = ntrip_connect_race(addrs, n_addrs, 0, 0, NULL);
     if (sock == INVALID_SOCKET) {
-        eph_log(state, "[EPH] Failed to create socket\r\n");
-        freeaddrinfo(result);
+        WorkerLog(GUI_LOG_ERROR, "[EPH] Connection failed to %s:%d\r\n",
+                          state->config.EPH_CASTER, state->config.EPH_PORT);
         return 1;
     }
 
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port   = htons(state->config.EPH_PORT);
-    server.sin_addr   = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&server.sin_zero, 0, 8);
-    freeaddrinfo(result);
-
-    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) == SOCKET_ERROR) {
-        eph_log(state, "[EPH] Connection failed to %s:%d\r\n",
-                state->config.EPH_CASTER, state->config.EPH_PORT);
-        closesocket(sock);
-        return 1;
+    NtripTls *tls = NULL;
+    unsigned flags = ntrip_config_session_flags(&state->config, true);
+    if (flags & NTRIP_SESSION_TLS) {
+        tls = ntrip_tls_new(sock, state->config.EPH_CASTER, state->config.EPH_PORT,
+                            !(flags & NTRIP_SESSION_TLS_NOVERIFY));
+        if (!tls || !ntrip_tls_handshake(tls, NTRIP_SESSION_CONNECT_MS)) {
+            WorkerLog(GUI_LOG_ERROR, "[EPH] TLS handshake with %s:%d failed: %s\r\n",
+                              state->config.EPH_CASTER, state->config.EPH_PORT,
+                              tls ? ntrip_tls_error(tls) : "this build has no TLS support");
+            ntrip_tls_free(tls);
+            closesocket(sock);
+            return 1;
+        }
     }
 
     DWORD timeout_ms = 200;
@@ -893,367 +1038,186 @@ DWORD WINAPI WorkerOpenEphStream(LPVOID param)
              state->config.EPH_CASTER,
              state->config.EPH_AUTH_BASIC);
 
-    if (send(sock, request, (int)strlen(request), 0) <= 0) {
-        eph_log(state, "[EPH] Failed to send NTRIP request\r\n");
+    if (ntrip_io_send(sock, tls, request, (int)strlen(request)) <= 0) {
+        WorkerLog(GUI_LOG_ERROR, "[EPH] Failed to send NTRIP request\r\n");
+        ntrip_tls_free(tls);
         closesocket(sock);
         return 1;
     }
 
-    eph_log(state, "[EPH] HTTP GET sent to %s:%d/%s; awaiting response...\r\n",
-            state->config.EPH_CASTER, state->config.EPH_PORT,
-            state->config.EPH_MOUNTPOINT);
+    WorkerLog(GUI_LOG_INFO, "[EPH] HTTP GET sent to %s:%d/%s; awaiting response...\r\n",
+                     state->config.EPH_CASTER, state->config.EPH_PORT,
+                     state->config.EPH_MOUNTPOINT);
 
     /* ── Receive loop (RTCM 3.x framing only) ────────────── */
-    unsigned char recv_buf[GUI_BUFFER_SIZE];
-    unsigned char msg_buf[GUI_BUFFER_SIZE];
-    int  msg_pos    = 0;
-    int  msg_target = 0;
-    bool header_done = false;
-    char header_buf[4096];
-    int  header_pos = 0;
-    int  eph_count = 0;   /* total ephemerides cached so far */
+    /* Bytes go straight into the framer ring; the reply decoder drops
+     * the HTTP header and any chunk framing in place. */
+    NtripHttp http;
+    ntrip_http_init(&http);
+    EphFrameCtx frame_ctx = { state, 0 };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, eph_frame, &frame_ctx);
 
     while (!state->bStopRequestedEph) {
-        int n = recv(sock, (char *)recv_buf, sizeof(recv_buf), 0);
+        size_t avail;
+        unsigned char *dst = rtcm_framer_write_ptr(&framer, &avail);
+        int n = ntrip_io_recv(sock, tls, dst, (int)avail);
         if (n == 0) {
-            eph_log(state, "[EPH] Server closed connection\r\n");
+            WorkerLog(GUI_LOG_INFO, "[EPH] Server closed connection\r\n");
             break;
         }
         if (n < 0) {
             int err = WSAGetLastError();
             if (err == WSAETIMEDOUT) continue;
-            eph_log(state, "[EPH] recv error %d\r\n", err);
+            WorkerLog(GUI_LOG_ERROR, "[EPH] recv error %d\r\n", err);
             break;
         }
 
-        int start = 0;
-        if (!header_done) {
-            for (int i = 0; i < n && !header_done; i++) {
-                if (header_pos < (int)sizeof(header_buf) - 1)
-                    header_buf[header_pos++] = recv_buf[i];
-                if (header_pos >= 4 &&
-                    header_buf[header_pos - 4] == '\r' &&
-                    header_buf[header_pos - 3] == '\n' &&
-                    header_buf[header_pos - 2] == '\r' &&
-                    header_buf[header_pos - 1] == '\n') {
-                    header_done = true;
-                    start = i + 1;
-                    header_buf[header_pos] = '\0';
-                    if (!strstr(header_buf, "200") &&
-                        !strstr(header_buf, "ICY")) {
-                        eph_log(state, "[EPH] Server response:\r\n%s\r\n",
-                                header_buf);
-                        closesocket(sock);
-                        return 1;
-                    }
-                    eph_log(state,
-                            "[EPH] Stream accepted by %s/%s -- decoding ephemerides\r\n",
-                            state->config.EPH_CASTER,
-                            state->config.EPH_MOUNTPOINT);
-                }
+        bool in_header = !ntrip_http_head_done(&http);
+        size_t body = ntrip_http_decode(&http, dst, (size_t)n);
+        if (in_header) {
+            if (!ntrip_http_head_done(&http)) continue;
+            if (!ntrip_http_ok(&http)) {
+                WorkerLog(GUI_LOG_INFO, "[EPH] Server response:\r\n%s\r\n",
+                                 http.status_line);
+                ntrip_tls_free(tls);
+                closesocket(sock);
+                return 1;
             }
-            if (!header_done) continue;
+            WorkerLog(GUI_LOG_INFO,
+                             "[EPH] Stream accepted by %s/%s -- decoding ephemerides%s\r\n",
+                             state->config.EPH_CASTER,
+                             state->config.EPH_MOUNTPOINT,
+                             http.chunked ? " (chunked)" : "");
         }
 
-        for (int i = start; i < n; i++) {
-            unsigned char b = recv_buf[i];
-
-            if (msg_pos == 0) {
-                if (b == 0xD3) msg_buf[msg_pos++] = b;
-                continue;
-            }
-            msg_buf[msg_pos++] = b;
-
-            if (msg_pos == 3) {
-                int msg_length = ((msg_buf[1] & 0x03) << 8) | msg_buf[2];
-                msg_target = msg_length + 6;
-                if (msg_target > GUI_BUFFER_SIZE) {
-                    msg_pos = 0; msg_target = 0;
-                    continue;
-                }
-            }
-
-            if (msg_target > 0 && msg_pos >= msg_target) {
-                /* Peek message number (first 12 bits of payload, which
-                 * starts at byte index 3 of the frame).  RTCM packs the
-                 * 12-bit field across bytes 3 and 4. */
-                int payload_len = msg_target - 6;
-                int mt = ((int)msg_buf[3] << 4) | ((int)msg_buf[4] >> 4);
-
-                switch (mt) {
-                case 1019:
-                    decode_rtcm_1019(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1020:
-                    decode_rtcm_1020(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1041:
-                    decode_rtcm_1041(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1042:
-                    decode_rtcm_1042(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1044:
-                    decode_rtcm_1044(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1045:
-                    decode_rtcm_1045(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                case 1046:
-                    decode_rtcm_1046(&msg_buf[3], payload_len);
-                    eph_count++;
-                    break;
-                default:
-                    /* Silently drop everything else -- including 1005/1006
-                     * which we must not let overwrite the obs ARP. */
-                    break;
-                }
-
-                msg_pos = 0; msg_target = 0;
-            }
-        }
+        rtcm_framer_commit(&framer, body);
     }
 
+    ntrip_tls_free(tls);
     closesocket(sock);
 
-    eph_log(state, "[EPH] Stream worker finished (%d ephemerides processed)\r\n",
-            eph_count);
+    WorkerLog(GUI_LOG_INFO, "[EPH] Stream worker finished (%d ephemerides processed)\r\n",
+                     frame_ctx.eph_count);
 
     return 0;
 }
 
+/* Thread entry: log lines go to the worker's own ring (gui_log.c). */
+DWORD WINAPI WorkerOpenEphStream(LPVOID param)
+{
+    WorkerLogBind((AppState *)param, GUI_LOG_SRC_EPH);
+    DWORD rc = worker_open_eph_stream(param);
+    WorkerLogUnbind();
+    return rc;
+}
+
+/* WorkerReplayRtcm() framer context. */
+typedef struct {
+    AppState *state;
+    int       frames_decoded;
+    long      total_bytes;
+} ReplayFrameCtx;
+
+static void replay_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    ReplayFrameCtx *ctx = (ReplayFrameCtx *)user;
+    AppState *state = ctx->state;
+
+    int msg_type = analyze_rtcm_message(frame, frame_len, true, &state->config);
+    if (msg_type <= 0 || msg_type >= GUI_MAX_MSG_TYPES) return;
+
+    ctx->frames_decoded++;
+    ctx->total_bytes += frame_len;
+    InterlockedExchangeAdd(&state->streamBytes, (LONG)frame_len);
+
+    /* Stats, satellite stats, CNR caches, sky plot and the UI frame
+     * record (same logic as the obs worker).  Lossless: replay waits
+     * for the UI instead of dropping updates. */
+    PerfFrame pf;
+    perf_frame_start_at(&pf, 0);
+    worker_handle_frame(state, frame, frame_len, msg_type, true, &pf);
+
+    /* No pacing: replay parses frames as fast as the disk + CPU
+     * allow.  Intervals and sky positions come from the virtual
+     * stream clock, so they don't depend on the playback speed. */
+}
+
 /* ── RTCM replay worker ───────────────────────────────────────────────────
  *
- * Reads a .rtcm3 capture file (raw RTCM frames concatenated) and feeds
- * each frame through the same UI-update pipeline the obs worker uses --
- * stats, satellites, raw-msg detail, sky-plot updates.  Pacing comes from
- * the 30-bit GPS epoch_time field in MSM headers: between consecutive
- * frames carrying a valid epoch_time we sleep by the diff, capped at 1 s
- * to skip over recording gaps.  Non-MSM frames advance the cursor without
- * sleeping.
+ * Maps a .rtcm3 capture file (raw RTCM frames concatenated) or a native
+ * .nacap capture, indexes its frames (rtcm_replay.h; a raw file's index
+ * is cached next to it) and feeds
+ * each frame straight from the mapping through the same UI-update
+ * pipeline the obs worker uses -- stats, satellites, raw-msg detail,
+ * sky-plot updates.  There is no pacing: the stream clock
+ * (stream_clock.h) is switched to virtual time for the replay, driven by
+ * the MSM epoch times, so message intervals and sky positions are those
+ * of the recording however fast the frames go through.
  *
  * Lifetime is shared with WorkerOpenStream via hWorkerThread /
  * bWorkerRunning / bStopRequested so Close Stream stops replay.  The eph
  * worker and capture-to-disk are not started during replay.
  */
-DWORD WINAPI WorkerReplayRtcm(LPVOID param)
+static DWORD worker_replay_rtcm(LPVOID param)
 {
     AppState *state = (AppState *)param;
 
-    printf("[INFO] Replay: opening %s\n", state->replayPath);
-    fflush(stdout);
+    WorkerLog(GUI_LOG_INFO, "[INFO] Replay: opening %s\n", state->replayPath);
 
-    FILE *f = fopen(state->replayPath, "rb");
-    if (!f) {
-        printf("[ERROR] Replay: cannot open file\n");
-        fflush(stdout);
-        PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
+    RtcmReplay rp;
+    if (!rtcm_replay_open(&rp, state->replayPath)) {
+        WorkerLog(GUI_LOG_ERROR, "[ERROR] Replay: cannot open file\n");
+        ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
         return 1;
     }
+    WorkerLog(GUI_LOG_INFO, "[INFO] Replay: %lu frames, %.2f h of %s time (index %s)\n",
+                            (unsigned long)rp.n_frames, rtcm_replay_duration_ms(&rp) / 3600000.0,
+                            rp.native ? "receive" : "MSM",
+                            rp.native ? "native" : rp.index_cached ? "cached" : "built");
 
     /* Tell the UI we're decoding "RTCM 3.x" so the status bar gets a sane
-     * label even though no caster is involved. */
-    InterlockedExchange(&state->streamFormat, 1 /* FMT_RTCM3 */);
-    PostMessage(state->hMain, WM_APP_STREAM_INFO, 0, 0);
-
-    unsigned char msg_buf[GUI_BUFFER_SIZE];
-    int  frames_decoded = 0;
-    long total_bytes    = 0;
-
-    while (!state->bStopRequested) {
-        /* Find the next 0xD3 preamble.  Re-sync if the file ends or has
-         * stray bytes between frames. */
-        int b;
-        do {
-            b = fgetc(f);
-            if (b == EOF) goto eof;
-        } while (b != 0xD3);
-
-        msg_buf[0] = (unsigned char)b;
-        int got = (int)fread(msg_buf + 1, 1, 2, f);   /* length bytes */
-        if (got < 2) break;
-
-        int msg_length = ((msg_buf[1] & 0x03) << 8) | msg_buf[2];
-        int frame_len  = msg_length + 6;              /* preamble + len + crc */
-        if (frame_len > GUI_BUFFER_SIZE) {
-            /* Bogus length -- try to resync from next byte. */
-            continue;
-        }
-
-        got = (int)fread(msg_buf + 3, 1, frame_len - 3, f);
-        if (got < frame_len - 3) break;
-
-        /* ── Process the frame ── */
-        int msg_type = analyze_rtcm_message(msg_buf, frame_len, true,
-                                            &state->config);
-        if (msg_type > 0 && msg_type < GUI_MAX_MSG_TYPES) {
-            frames_decoded++;
-            total_bytes += frame_len;
-            InterlockedExchangeAdd(&state->streamBytes, (LONG)frame_len);
-
-            /* Per-MSM-type stats */
-            double now = gui_get_time_seconds();
-            GuiMsgStat *s = &state->msgStats[msg_type];
-            if (!s->seen) {
-                s->seen = true;
-                s->last_time = now;
-                s->min_dt = s->max_dt = s->sum_dt = 0.0;
-            } else {
-                double dt = now - s->last_time;
-                s->last_time = now;
-                s->sum_dt += dt;
-                if (dt < s->min_dt || s->min_dt == 0.0) s->min_dt = dt;
-                if (dt > s->max_dt) s->max_dt = dt;
-            }
-            s->count++;
-            PostMessage(state->hMain, WM_APP_STAT_UPDATE,
-                        (WPARAM)msg_type, (LPARAM)s->count);
-
-            /* Satellite stats + sky-plot update (same logic as obs worker) */
-            int payload_len_inner = msg_length;
-            extract_satellites(msg_buf + 3, payload_len_inner,
-                               msg_type, &state->satStats);
-            PostMessage(state->hMain, WM_APP_SAT_UPDATE, 0, 0);
-
-            /* Update per-band CNR cache for MSM7 frames so SV detail
-             * windows show live per-signal values from the replay. */
-            if ((msg_type % 10) == 7)
-                msm7_update_per_band_cnr(msg_buf + 3, payload_len_inner, msg_type);
-
-            /* Sky-plot pipeline: same gate as the obs worker. */
-            {
-                bool   arp_valid = false;
-                double sx = 0, sy = 0, sz = 0;
-                rtcm_get_station_arp(&arp_valid, &sx, &sy, &sz,
-                                     NULL, NULL, NULL);
-                if (!arp_valid &&
-                    (state->config.LATITUDE != 0.0 ||
-                     state->config.LONGITUDE != 0.0)) {
-                    geodetic_to_ecef(state->config.LATITUDE,
-                                     state->config.LONGITUDE,
-                                     0.0, &sx, &sy, &sz);
-                    arp_valid = true;
-                }
-
-                int prns[64];
-                int gnss_id = 0;
-                int n_prns = arp_valid
-                    ? msm_extract_prns(msg_buf + 3, payload_len_inner,
-                                       msg_type, prns, 64, &gnss_id)
-                    : 0;
-
-                int   cnr_n = 0, cnr_prn_list[64];
-                float cnr_prns[64];
-                if (n_prns > 0 && (msg_type % 10) == 7)
-                    cnr_n = msm7_extract_cnr(msg_buf + 3, payload_len_inner,
-                                             msg_type,
-                                             cnr_prn_list, cnr_prns, 64, NULL);
-                else
-                    for (int i = 0; i < 64; i++) cnr_prns[i] = 0.0f;
-
-                float cnr_by_prn[SV_EPH_MAX_SATS_PER_GNSS + 1];
-                for (int i = 0; i <= SV_EPH_MAX_SATS_PER_GNSS; i++)
-                    cnr_by_prn[i] = 0.0f;
-                for (int i = 0; i < cnr_n; i++) {
-                    int p = cnr_prn_list[i];
-                    if (p >= 1 && p <= SV_EPH_MAX_SATS_PER_GNSS)
-                        cnr_by_prn[p] = cnr_prns[i];
-                }
-
-                int upd_count = 0;
-                SkySatUpdate *upd = NULL;
-
-                if (n_prns > 0 &&
-                    (gnss_id == 1 || gnss_id == 2 ||
-                     gnss_id == 3 || gnss_id == 4 || gnss_id == 5 ||
-                     gnss_id == 7)) {
-                    int    gps_week;
-                    double gps_tow;
-                    sky_get_gps_time(&gps_week, &gps_tow);
-                    double glo_tod = sky_get_glo_tod();
-                    double t_prop  = (gnss_id == 2) ? glo_tod : gps_tow;
-
-                    uint64_t obs_mask = 0;
-                    for (int i = 0; i < n_prns; i++) {
-                        int p = prns[i];
-                        if (p >= 1 && p <= 64) obs_mask |= 1ULL << (p - 1);
-                    }
-
-                    upd = (SkySatUpdate *)HeapAlloc(GetProcessHeap(), 0,
-                        sizeof(SkySatUpdate) * SV_EPH_MAX_SATS_PER_GNSS);
-                    if (upd) {
-                        for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
-                            const SvEphemeris *eph = sv_eph_get(gnss_id, p);
-                            if (!eph) continue;
-                            if (!sv_eph_is_valid_at(eph, gps_week, t_prop))
-                                continue;
-                            double svx, svy, svz;
-                            if (!sv_to_ecef(eph, gps_week, t_prop,
-                                            &svx, &svy, &svz))
-                                continue;
-                            double az_d, el_d;
-                            azel_from_ecef(sx, sy, sz,
-                                           svx, svy, svz, &az_d, &el_d);
-                            if (el_d <= 0.0) continue;
-
-                            int observed_flag = (p >= 1 && p <= 64)
-                                ? ((obs_mask >> (p - 1)) & 1ULL) ? 1 : 0
-                                : 0;
-                            float cnr_dbhz = 0.0f;
-                            if (observed_flag &&
-                                p <= SV_EPH_MAX_SATS_PER_GNSS)
-                                cnr_dbhz = cnr_by_prn[p];
-
-                            upd[upd_count].gnss_id       = gnss_id;
-                            upd[upd_count].prn           = p;
-                            upd[upd_count].az_deg        = (float)az_d;
-                            upd[upd_count].el_deg        = (float)el_d;
-                            upd[upd_count].cnr_dbhz      = cnr_dbhz;
-                            upd[upd_count].observed_flag = observed_flag;
-                            upd_count++;
-                        }
-                    }
-                }
-
-                if (!PostMessage(state->hMain, WM_APP_SKY_UPDATE,
-                                 (WPARAM)upd_count, (LPARAM)upd)) {
-                    if (upd) HeapFree(GetProcessHeap(), 0, upd);
-                }
-            }
-
-            /* Raw-frame post for the detail window pipeline. */
-            RtcmRawMsg *raw = (RtcmRawMsg *)HeapAlloc(
-                GetProcessHeap(), 0, sizeof(RtcmRawMsg));
-            if (raw) {
-                raw->msg_type = msg_type;
-                raw->length   = frame_len;
-                memcpy(raw->data, msg_buf, frame_len);
-                if (!PostMessage(state->hMain, WM_APP_MSG_RAW,
-                                 (WPARAM)msg_type, (LPARAM)raw)) {
-                    HeapFree(GetProcessHeap(), 0, raw);
-                }
-            }
-
-            /* No pacing: replay parses frames as fast as the disk + CPU
-             * allow.  Real-time playback is only useful when the file
-             * has gaps we want to honour; for analysis we want to get
-             * the full picture into the UI immediately. */
-        }
+     * label even though no caster is involved -- or what the file is
+     * when it holds no RTCM at all. */
+    if (rp.format != STREAM_FMT_RTCM3)
+        WorkerLog(GUI_LOG_WARN, "[WARN] Replay: no RTCM 3.x frames in the file (%s)\n",
+                  stream_format_name(rp.format));
+    InterlockedExchange(&state->streamFormat, rp.format);
+    ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_INFO, state->hMain, WM_APP_STREAM_INFO, 0, 0);
+
+    sky_epoch_init(&state->skyEpochs);
+    worker_stats_reset(state);
+    stream_clock_set_virtual(true);
+    ReplayFrameCtx ctx = { state, 0, 0 };
+
+    /* The index already resynced on stray bytes and dropped frames that
+     * fail the CRC; every entry is a whole frame inside the mapping. */
+    for (size_t i = 0; i < rp.n_frames && !state->bStopRequested; i++) {
+        int len;
+        const unsigned char *frame = rtcm_replay_frame(&rp, i, &len);
+        if (frame) replay_frame(frame, len, &ctx);
     }
 
-eof:
-    fclose(f);
+    worker_sky_flush(state, true);
+    worker_stats_publish(state, true);
+    stream_clock_set_virtual(false);
 
-    printf("\n[INFO] Replay finished: %d frames, %ld bytes from %s\n",
-           frames_decoded, total_bytes, state->replayPath);
-    fflush(stdout);
+    WorkerLog(GUI_LOG_INFO, "[INFO] Replay finished: %d frames, %ld bytes from %s\n",
+                            ctx.frames_decoded, ctx.total_bytes, state->replayPath);
+    if (rp.skipped_bytes || rp.crc_errors)
+        WorkerLog(GUI_LOG_INFO, "[INFO] Replay: %lu CRC errors, %lu bytes skipped\n",
+                                rp.crc_errors, rp.skipped_bytes);
+    rtcm_replay_close(&rp);
 
-    PostMessage(state->hMain, WM_APP_STREAM_DONE, 0, 0);
+    ui_lag_post(&state->uiLag, UI_LAG_MSG_STREAM_DONE, state->hMain, WM_APP_STREAM_DONE, 0, 0);
     return 0;
 }
+
+/* Thread entry: log lines go to the worker's own ring (gui_log.c). */
+DWORD WINAPI WorkerReplayRtcm(LPVOID param)
+{
+    WorkerLogBind((AppState *)param, GUI_LOG_SRC_STREAM);
+    DWORD rc = worker_replay_rtcm(param);
+    WorkerLogUnbind();
+    return rc;
+}
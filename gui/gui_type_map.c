@@ -0,0 +1,51 @@
+/**
+ * @file gui_type_map.c
+ * @brief Small open-addressed map from RTCM message type to a dense index.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_type_map.h"
+
+#include <string.h>
+
+/* Fibonacci hashing: types come in runs (1074..1127, 1230), which the
+ * multiply spreads over the table. */
+static unsigned type_hash(int type)
+{
+    return ((uint32_t)type * 2654435761u) >> 24;
+}
+
+/* Slot holding @p type, or the empty slot where it would go. */
+static unsigned type_probe(const GuiTypeMap *m, int type)
+{
+    unsigned i = type_hash(type) & (GUI_TYPE_MAP_SLOTS - 1);
+    while (m->slot[i] != 0 && m->type[m->slot[i] - 1] != type)
+        i = (i + 1) & (GUI_TYPE_MAP_SLOTS - 1);
+    return i;
+}
+
+int gui_type_map_find(const GuiTypeMap *m, int type)
+{
+    return m->slot[type_probe(m, type)] - 1;
+}
+
+int gui_type_map_add(GuiTypeMap *m, int type)
+{
+    unsigned i = type_probe(m, type);
+    if (m->slot[i] != 0) return m->slot[i] - 1;
+    if (m->n == GUI_TYPE_MAP_CAP) return -1;
+
+    int k = m->n++;
+    m->type[k] = type;
+    m->slot[i] = (int16_t)(k + 1);
+    return k;
+}
+
+void gui_type_map_clear(GuiTypeMap *m)
+{
+    memset(m->slot, 0, sizeof(m->slot));
+    m->n = 0;
+}
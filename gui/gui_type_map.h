@@ -0,0 +1,50 @@
+/**
+ * @file gui_type_map.h
+ * @brief Small open-addressed map from RTCM message type to a dense index.
+ *
+ * A stream carries some 30..60 distinct message types out of the 4096
+ * the type field can hold.  Per-type state (statistics, the last frame,
+ * the open detail window) is kept in arrays of @ref GUI_TYPE_MAP_CAP
+ * entries indexed by the order the types were first seen; this map finds
+ * the index of a type, and its @c type[] list lets refresh, clear and
+ * save walk the @c n live entries only.
+ *
+ * Linear probing over @ref GUI_TYPE_MAP_SLOTS slots, at most half full.
+ * There is no removal: the map is cleared (or rebuilt) per stream.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_TYPE_MAP_H
+#define GUI_TYPE_MAP_H
+
+#include <stdint.h>
+
+/** @brief Distinct types per map. */
+#define GUI_TYPE_MAP_CAP    128
+
+/** @brief Hash slots; a power of two, twice GUI_TYPE_MAP_CAP. */
+#define GUI_TYPE_MAP_SLOTS  256
+
+/**
+ * @struct GuiTypeMap
+ * @brief Type -> index map.  All zero is an empty map.
+ */
+typedef struct {
+    int16_t slot[GUI_TYPE_MAP_SLOTS];   /**< index + 1; 0 = empty */
+    int     type[GUI_TYPE_MAP_CAP];     /**< type of index k, first-seen order */
+    int     n;                          /**< entries in use */
+} GuiTypeMap;
+
+/** @brief Index of @p type, or -1 if it has none. */
+int gui_type_map_find(const GuiTypeMap *m, int type);
+
+/** @brief Index of @p type, added if new; -1 when the map is full. */
+int gui_type_map_add(GuiTypeMap *m, int type);
+
+/** @brief Empty the map. */
+void gui_type_map_clear(GuiTypeMap *m);
+
+#endif /* GUI_TYPE_MAP_H */
@@ -0,0 +1,186 @@
+/**
+ * @file gui_ui_lag.c
+ * @brief Queue latency, handler and paint durations of the UI thread.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "gui_ui_lag.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const chan_names[UI_LAG_CHAN_COUNT] = {
+    "records", "stats", "ui_batch", "stream_info", "stream_done",
+    "mount_rows", "mount_result"
+};
+
+static const char *const wnd_names[UI_LAG_WND_COUNT] = {
+    "main", "sky", "detail", "sv_detail", "history"
+};
+
+/* Stamps are 32-bit microseconds; 0 means "none", so a stamp that
+ * happens to be 0 is moved to 1. */
+static LONG lag_stamp_now(void)
+{
+    LONG us = (LONG)(unsigned int)(perf_now_ns() / 1000);
+    return us ? us : 1;
+}
+
+void ui_lag_stamp(UiLag *l, UiLagChan c)
+{
+    if (!perf_probes_on) return;
+    InterlockedCompareExchange(&l->posted_us[c], lag_stamp_now(), 0);
+}
+
+BOOL ui_lag_post(UiLag *l, UiLagChan c, HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    LONG us = 0;
+    if (perf_probes_on) {
+        us = lag_stamp_now();
+        if (InterlockedCompareExchange(&l->posted_us[c], us, 0) != 0)
+            us = 0;                             /* an older one waits */
+    }
+    if (PostMessage(hwnd, msg, wParam, lParam)) return TRUE;
+    if (us) InterlockedCompareExchange(&l->posted_us[c], 0, us);
+    return FALSE;
+}
+
+uint64_t ui_lag_now(void)
+{
+    return perf_probes_on ? perf_now_ns() : 0;
+}
+
+uint64_t ui_lag_begin(UiLag *l, UiLagChan c)
+{
+    if (!perf_probes_on) return 0;
+    uint64_t now = perf_now_ns();
+    LONG us = InterlockedExchange(&l->posted_us[c], 0);
+    if (us)
+        perf_hist_add(&l->queue[c],
+                      (uint64_t)((unsigned int)(now / 1000) - (unsigned int)us) * 1000);
+    return now;
+}
+
+void ui_lag_queued(UiLag *l, UiLagChan c, uint64_t t_post_ns)
+{
+    if (!perf_probes_on || !t_post_ns) return;
+    uint64_t now = perf_now_ns();
+    if (now > t_post_ns) perf_hist_add(&l->queue[c], now - t_post_ns);
+}
+
+void ui_lag_end(UiLag *l, UiLagChan c, uint64_t t0)
+{
+    if (!t0) return;
+    perf_hist_add(&l->handler[c], perf_now_ns() - t0);
+}
+
+void ui_lag_paint(UiLag *l, UiLagWnd w, uint64_t t0)
+{
+    if (!t0) return;
+    perf_hist_add(&l->paint[w], perf_now_ns() - t0);
+}
+
+void ui_lag_reset(UiLag *l)
+{
+    memset(l->queue, 0, sizeof(l->queue));
+    memset(l->handler, 0, sizeof(l->handler));
+    memset(l->paint, 0, sizeof(l->paint));
+}
+
+const PerfHist *ui_lag_row(const UiLag *l, int row, char *name, size_t name_len)
+{
+    if (row < 0 || row >= UI_LAG_ROWS) return NULL;
+    if (row < UI_LAG_CHAN_COUNT) {
+        snprintf(name, name_len, "queue: %s", chan_names[row]);
+        return &l->queue[row];
+    }
+    row -= UI_LAG_CHAN_COUNT;
+    if (row < UI_LAG_CHAN_COUNT) {
+        snprintf(name, name_len, "handler: %s", chan_names[row]);
+        return &l->handler[row];
+    }
+    row -= UI_LAG_CHAN_COUNT;
+    snprintf(name, name_len, "paint: %s", wnd_names[row]);
+    return &l->paint[row];
+}
+
+/* ── JSON ──────────────────────────────────────────────────── */
+typedef struct {
+    char  *buf;
+    size_t len, cap;
+    BOOL   oom;
+} LagText;
+
+static void lag_printf(LagText *t, const char *fmt, ...)
+{
+    if (t->oom) return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) { t->oom = TRUE; return; }
+        if ((size_t)n < t->cap - t->len) {
+            t->len += (size_t)n;
+            return;
+        }
+        size_t cap = t->cap * 2 + (size_t)n;
+        char *p = (char *)realloc(t->buf, cap);
+        if (!p) { t->oom = TRUE; return; }
+        t->buf = p;
+        t->cap = cap;
+    }
+}
+
+/* "name":{...} for each non-empty histogram of @p h[0 .. n-1]. */
+static void lag_hists(LagText *t, const char *key, const PerfHist *h, int n,
+                      const char *(*name_of)(int))
+{
+    lag_printf(t, "\"%s\":{", key);
+    const char *sep = "";
+    for (int i = 0; i < n; i++) {
+        if (!h[i].count) continue;
+        double c = (double)h[i].count;
+        lag_printf(t, "%s\"%s\":{\"n\":%llu,\"mean_us\":%.2f,\"p50_us\":%.2f,"
+                      "\"p90_us\":%.2f,\"p99_us\":%.2f,\"p999_us\":%.2f,\"max_us\":%.2f}",
+                   sep, name_of(i), (unsigned long long)h[i].count,
+                   (double)h[i].sum_ns / c / 1e3,
+                   perf_hist_quantile(&h[i], 0.50)  / 1e3,
+                   perf_hist_quantile(&h[i], 0.90)  / 1e3,
+                   perf_hist_quantile(&h[i], 0.99)  / 1e3,
+                   perf_hist_quantile(&h[i], 0.999) / 1e3,
+                   h[i].max_ns / 1e3);
+        sep = ",";
+    }
+    lag_printf(t, "}");
+}
+
+static const char *stage_name(int i) { return perf_stage_name((PerfStage)i); }
+static const char *chan_name(int i)  { return chan_names[i]; }
+static const char *wnd_name(int i)   { return wnd_names[i]; }
+
+char *ui_lag_json(const UiLag *l, const PerfStream *perf)
+{
+    LagText t = { (char *)malloc(4096), 0, 4096, FALSE };
+    if (!t.buf) return NULL;
+    t.buf[0] = '\0';
+    lag_printf(&t, "{");
+    lag_hists(&t, "stages", perf->stage, PERF_STAGE_COUNT, stage_name);
+    lag_printf(&t, ",\"ui\":{");
+    lag_hists(&t, "queue", l->queue, UI_LAG_CHAN_COUNT, chan_name);
+    lag_printf(&t, ",");
+    lag_hists(&t, "handler", l->handler, UI_LAG_CHAN_COUNT, chan_name);
+    lag_printf(&t, ",");
+    lag_hists(&t, "paint", l->paint, UI_LAG_WND_COUNT, wnd_name);
+    lag_printf(&t, "}}\n");
+    if (t.oom) {
+        free(t.buf);
+        return NULL;
+    }
+    return t.buf;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file gui_ui_lag.h
+ * @brief How far the UI thread runs behind the workers.
+ *
+ * Every way a worker hands something to the UI thread is a channel: the
+ * uiQueue records, the statistics snapshot and each WM_APP_* message the
+ * workers post.  Per channel the queue latency (handed over -> the UI
+ * starts on it) and the handler duration go into a PerfHist, and per
+ * window the paint duration; the Performance tab shows them below the
+ * stage rows and copies them as JSON.
+ *
+ * A channel keeps one post stamp: that of the oldest hand-over the UI
+ * has not yet taken, set with a compare-exchange from zero (stamps are
+ * perf_now_ns() / 1000 cut to 32 bits, like UiFrameRec's).  The records
+ * of one batch and messages posted while one is waiting therefore count
+ * once, with the age of the oldest -- how long the UI let the channel
+ * wait.  Nothing is recorded when the probes are off.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GUI_UI_LAG_H
+#define GUI_UI_LAG_H
+
+#define _WIN32_WINNT 0x0601
+#include <windows.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "perf_probe.h"
+
+/** @brief Worker -> UI hand-overs. */
+typedef enum {
+    UI_LAG_RECORDS,         /**< uiQueue records (frames, sky updates), drained per batch */
+    UI_LAG_STATS,           /**< statistics snapshot: published -> applied */
+    UI_LAG_MSG_UI_BATCH,    /**< WM_APP_UI_BATCH kick */
+    UI_LAG_MSG_STREAM_INFO, /**< WM_APP_STREAM_INFO */
+    UI_LAG_MSG_STREAM_DONE, /**< WM_APP_STREAM_DONE */
+    UI_LAG_MSG_MOUNT_ROWS,  /**< WM_APP_MOUNT_ROWS */
+    UI_LAG_MSG_MOUNT_RESULT,/**< WM_APP_MOUNT_RESULT */
+    UI_LAG_CHAN_COUNT
+} UiLagChan;
+
+/** @brief Windows whose painting is timed. */
+typedef enum {
+    UI_LAG_WND_MAIN,        /**< the main window's ListViews (custom-draw pre/post paint) */
+    UI_LAG_WND_SKY,         /**< Sky Plot WM_PAINT */
+    UI_LAG_WND_DETAIL,      /**< detail windows: formatting and setting their text */
+    UI_LAG_WND_SV_DETAIL,   /**< SV detail WM_PAINT */
+    UI_LAG_WND_HISTORY,     /**< History WM_PAINT */
+    UI_LAG_WND_COUNT
+} UiLagWnd;
+
+/** @brief Rows ui_lag_row() describes: queue and handler per channel, paint per window. */
+#define UI_LAG_ROWS (2 * UI_LAG_CHAN_COUNT + UI_LAG_WND_COUNT)
+
+/**
+ * @struct UiLag
+ * @brief The histograms; post stamps are written by any thread, the rest
+ *        on the UI thread only.
+ */
+typedef struct {
+    volatile LONG posted_us[UI_LAG_CHAN_COUNT];   /**< oldest untaken hand-over; 0 = none */
+    PerfHist      queue[UI_LAG_CHAN_COUNT];
+    PerfHist      handler[UI_LAG_CHAN_COUNT];
+    PerfHist      paint[UI_LAG_WND_COUNT];
+    uint64_t      main_paint_t0;                  /**< CDDS_PREPAINT of the ListView painting */
+} UiLag;
+
+/** @brief Worker side: stamp channel @p c unless an older hand-over waits. */
+void ui_lag_stamp(UiLag *l, UiLagChan c);
+
+/** @brief ui_lag_stamp() and PostMessage(); the stamp is dropped if the post fails. */
+BOOL ui_lag_post(UiLag *l, UiLagChan c, HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+/**
+ * @brief UI side: take the stamp of @p c into its queue histogram.
+ * @return Start of the handler (perf_now_ns()), 0 when not timed.
+ */
+uint64_t ui_lag_begin(UiLag *l, UiLagChan c);
+
+/** @brief Queue latency of a hand-over stamped at @p t_post_ns (perf_now_ns()). */
+void ui_lag_queued(UiLag *l, UiLagChan c, uint64_t t_post_ns);
+
+/** @brief Handler of @p c done; @p t0 from ui_lag_begin() or ui_lag_now(). */
+void ui_lag_end(UiLag *l, UiLagChan c, uint64_t t0);
+
+/** @brief perf_now_ns() when the probes are on, else 0. */
+uint64_t ui_lag_now(void);
+
+/** @brief Paint of @p w done; @p t0 from ui_lag_now(). */
+void ui_lag_paint(UiLag *l, UiLagWnd w, uint64_t t0);
+
+/** @brief Clear the histograms (stamps of waiting hand-overs stay). */
+void ui_lag_reset(UiLag *l);
+
+/**
+ * @brief Row @p row of the Performance tab below the stages.
+ * @param name  Receives e.g. "queue: records", "paint: sky".
+ * @return The row's histogram, NULL if @p row is out of range.
+ */
+const PerfHist *ui_lag_row(const UiLag *l, int row, char *name, size_t name_len);
+
+/**
+ * @brief The stage latencies of @p perf and all of @p l as JSON,
+ *        {"stages":{...},"ui":{"queue":{...},"handler":{...},"paint":{...}}},
+ *        each histogram as the fields of the CLI's --perf event (n,
+ *        mean_us, p50_us .. max_us); empty ones are left out.
+ * @return malloc'd NUL-terminated text, NULL when out of memory.
+ */
+char *ui_lag_json(const UiLag *l, const PerfStream *perf);
+
+#endif /* GUI_UI_LAG_H */
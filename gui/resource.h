@@ -22,6 +22,7 @@
 #define IDM_FILE_RTCM_START     9007
 #define IDM_FILE_RTCM_STOP      9008
 #define IDM_FILE_RTCM_REPLAY    9009
+#define IDM_FILE_ANOMALY_DUMP   9013
 
 /* ── Menu items: Connection ───────────────────────────────── */
 #define IDM_CONN_MOUNTPOINTS    9010
@@ -31,6 +32,7 @@
 /* ── Menu items: View ─────────────────────────────────────── */
 #define IDM_VIEW_SKY_PLOT       9020
 #define IDM_VIEW_VRS_MONITOR    9021
+#define IDM_VIEW_HISTORY        9022
 
 /* ── Menu items: Tools ────────────────────────────────────── */
 #define IDM_TOOLS_VRS_GGA_TOGGLE   9040  /* toggle auto-send GGA on/off */
@@ -78,6 +80,8 @@
 #define IDC_EDIT_LOG            1402
 #define IDC_LV_MSG_STATS        1403
 #define IDC_LV_SATELLITES       1404
+#define IDC_LV_PERF             1405
+#define IDC_LV_QUALITY          1406
 
 /* ── Status bar ───────────────────────────────────────────── */
 #define IDC_STATUSBAR           1500
@@ -106,12 +110,10 @@
 #define WM_APP_STREAM_DONE      (WM_APP + 2)
 #define WM_APP_LOG_LINE         (WM_APP + 5)
 #define WM_APP_STATUS_UPDATE    (WM_APP + 6)
-#define WM_APP_STAT_UPDATE      (WM_APP + 7)
-#define WM_APP_SAT_UPDATE       (WM_APP + 8)
 #define WM_APP_STREAM_INFO      (WM_APP + 9)
-#define WM_APP_MSG_RAW          (WM_APP + 10)   /* raw RTCM frame for detail window */
 #define WM_APP_DETAIL_CLOSED    (WM_APP + 11)   /* detail window closed: wParam=msg_type */
-#define WM_APP_SKY_UPDATE       (WM_APP + 12)   /* sky-plot SV update: wParam=count, lParam=SkySatUpdate* */
+#define WM_APP_UI_BATCH         (WM_APP + 13)   /* drain AppState::uiQueue now (batch filled) */
+#define WM_APP_MOUNT_ROWS       (WM_APP + 14)   /* sourcetable lines so far: lParam=heap string */
 
 /* ── Detail window ───────────────────────────────────────── */
 #define IDC_DETAIL_EDIT         1700
@@ -127,10 +129,13 @@
 /* ── Context menu IDs ────────────────────────────────────── */
 #define IDM_CTX_SELECT_ALL      3001
 #define IDM_CTX_COPY            3002
+#define IDM_CTX_COPY_JSON       3003
+#define IDM_CTX_PERF_RESET      3004
 
 /* ── Timer IDs ────────────────────────────────────────────── */
 #define IDT_LOG_PUMP            2001
 #define IDT_STATUS_UPDATE       2002
 #define IDT_SKY_CLOCK           2003
+#define IDT_UI_BATCH            2004
 
 #endif /* RESOURCE_H */
@@ -0,0 +1,168 @@
+/**
+ * @file anomaly_ring.c
+ * @brief Forensic ring of the last sync losses of a stream.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "anomaly_ring.h"
+#include "stream_clock.h"
+#include "stream_format.h"
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SLOT_MASK ((uint64_t)ANOMALY_RING_SLOTS - 1)
+
+#if (ANOMALY_RING_SLOTS & (ANOMALY_RING_SLOTS - 1)) != 0
+#error "ANOMALY_RING_SLOTS must be a power of two"
+#endif
+
+AnomalyEvent *anomaly_ring_begin(AnomalyRing *r)
+{
+    uint64_t h = r->head;               /* only the writer changes it */
+    int i = (int)(h & SLOT_MASK);
+    __atomic_store_n(&r->gen[i], r->gen[i] + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    AnomalyEvent *e = &r->slot[i];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+void anomaly_ring_commit(AnomalyRing *r)
+{
+    uint64_t h = r->head;
+    int i = (int)(h & SLOT_MASK);
+    r->slot[i].seq    = h + 1;
+    r->slot[i].utc_ns = stream_clock_utc_ns();
+    __atomic_store_n(&r->gen[i], r->gen[i] + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t anomaly_ring_count(const AnomalyRing *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+}
+
+int anomaly_ring_read(const AnomalyRing *r, AnomalyEvent *out, int max)
+{
+    uint64_t h = anomaly_ring_count(r);
+    uint64_t k = h > ANOMALY_RING_SLOTS ? h - ANOMALY_RING_SLOTS : 0;
+    int n = 0;
+    for (; k < h && n < max; k++) {
+        int i = (int)(k & SLOT_MASK);
+        uint32_t g = __atomic_load_n(&r->gen[i], __ATOMIC_ACQUIRE);
+        if (g & 1) continue;            /* being overwritten with a newer one */
+        memcpy(&out[n], &r->slot[i], sizeof(out[n]));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&r->gen[i], __ATOMIC_RELAXED) != g) continue;
+        if (out[n].seq != k + 1) continue;      /* lapped before the copy */
+        n++;
+    }
+    return n;
+}
+
+const char *anomaly_kind_name(uint32_t kind)
+{
+    switch (kind) {
+    case ANOMALY_CRC:       return "crc";
+    case ANOMALY_SYNC_LOST: return "sync-lost";
+    case ANOMALY_RESYNCED:  return "resynced";
+    default:                return "?";
+    }
+}
+
+/* snprintf() that appends at @p *at and never runs past @p cap. */
+static void fmt_add(char *buf, size_t cap, size_t *at, const char *fmt, ...)
+{
+    if (*at + 1 >= cap) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(buf + *at, cap - *at, fmt, ap);
+    va_end(ap);
+    if (w < 0) return;
+    *at += (size_t)w < cap - *at ? (size_t)w : cap - *at - 1;
+}
+
+size_t anomaly_event_format(const AnomalyEvent *e, char *buf, size_t cap)
+{
+    size_t at = 0;
+    if (!cap) return 0;
+    buf[0] = '\0';
+
+    char ts[32] = "?";
+    time_t s = (time_t)(e->utc_ns / 1000000000);
+    struct tm *gt = gmtime(&s);
+    if (gt) strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", gt);
+    fmt_add(buf, cap, &at, "#%llu %s.%03dZ %-9s at byte %llu  %s",
+            (unsigned long long)e->seq, ts, (int)(e->utc_ns / 1000000 % 1000),
+            anomaly_kind_name(e->kind), (unsigned long long)e->offset,
+            stream_format_name((StreamFormat)e->format));
+    if (e->kind == ANOMALY_CRC)
+        fmt_add(buf, cap, &at, "  len %u  crc 0x%06X != 0x%06X",
+                e->frame_len, e->crc_calc, e->crc_recv);
+    else if (e->frame_len)
+        fmt_add(buf, cap, &at, "  len %u", e->frame_len);
+    if (e->kind == ANOMALY_RESYNCED)
+        fmt_add(buf, cap, &at, "  skipped %llu", (unsigned long long)e->skipped);
+    fmt_add(buf, cap, &at, "\n    buffered %u  frames %llu  crc errors %llu  skipped %llu  resyncs %llu\n",
+            e->fill, (unsigned long long)e->frames, (unsigned long long)e->crc_errors,
+            (unsigned long long)e->skipped_bytes, (unsigned long long)e->resyncs);
+
+    /* Rows of 16 aligned on the anomaly, which starts a row. */
+    int n   = e->n_before + e->n_after;
+    int row = -(int)((e->n_before + 15) / 16) * 16;
+    for (; row < e->n_after; row += 16) {
+        fmt_add(buf, cap, &at, "    %+5d ", row);
+        for (int c = 0; c < 16; c++) {
+            int i = e->n_before + row + c;
+            if (i < 0 || i >= n) fmt_add(buf, cap, &at, "   ");
+            else                 fmt_add(buf, cap, &at, " %02x", e->bytes[i]);
+        }
+        fmt_add(buf, cap, &at, "\n");
+    }
+    return at;
+}
+
+int anomaly_ring_dump(FILE *f, const AnomalyRing *r, const char *name)
+{
+    AnomalyEvent *ev = (AnomalyEvent *)malloc(ANOMALY_RING_SLOTS * sizeof(*ev));
+    char text[ANOMALY_TEXT_MAX];
+    int n = ev ? anomaly_ring_read(r, ev, ANOMALY_RING_SLOTS) : 0;
+    fprintf(f, "[%s] %d of %llu anomalies\n", name, n,
+            (unsigned long long)anomaly_ring_count(r));
+    for (int i = 0; i < n; i++) {
+        anomaly_event_format(&ev[i], text, sizeof(text));
+        fputs(text, f);
+    }
+    free(ev);
+    return n;
+}
+
+/* ── SIGUSR1 ──────────────────────────────────────────────────────────── */
+
+static volatile sig_atomic_t s_usr1;
+
+#ifdef SIGUSR1
+static void on_sigusr1(int sig) { (void)sig; s_usr1 = 1; }
+#endif
+
+void anomaly_dump_watch(void)
+{
+    s_usr1 = 0;
+#ifdef SIGUSR1
+    signal(SIGUSR1, on_sigusr1);
+#endif
+}
+
+bool anomaly_dump_due(void)
+{
+    if (!s_usr1) return false;
+    s_usr1 = 0;
+    return true;
+}
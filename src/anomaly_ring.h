@@ -0,0 +1,158 @@
+/**
+ * @file anomaly_ring.h
+ * @brief Forensic ring of the last sync losses of a stream.
+ *
+ * A CRC failure or a run of stray bytes on a stream only ever left its
+ * counters behind (and a line of text with output on), so an
+ * intermittent link fault could only be looked at by capturing the whole
+ * stream until it happened again.  With an AnomalyRing attached
+ * (RtcmFramer::anomalies), the framer keeps the last
+ * @ref ANOMALY_RING_SLOTS anomalies of the stream instead, each with the
+ * raw bytes around it, its UTC time and the framer's state:
+ *
+ *   - ANOMALY_CRC:       the frame that should have followed a good one
+ *                        failed its checksum;
+ *   - ANOMALY_SYNC_LOST: sync was lost on anything else -- a byte that
+ *                        is not a preamble, reserved bits set, a length
+ *                        out of range;
+ *   - ANOMALY_RESYNCED:  the first good frame after a loss, with the
+ *                        bytes skipped to reach it.
+ *
+ * Only the transitions are recorded: the false preamble candidates the
+ * framer rejects while it hunts for sync are counted as before, but do
+ * not push the loss that caused them out of the ring.  A stream that
+ * stays in sync costs one pointer test per loss, i.e. nothing.
+ *
+ * The ring is fixed in size and written by the stream's thread alone.
+ * Every slot is bracketed by a sequence count that is odd while it is
+ * written (as in stats_snapshot.h), so anomaly_ring_read() and
+ * anomaly_ring_dump() may run on any other thread -- a signal-driven
+ * dump, the metrics server, the GUI -- without a lock: a slot overwritten
+ * during its copy is left out, never torn.
+ *
+ * anomaly_dump_watch() / anomaly_dump_due() are the SIGUSR1 trigger, in
+ * the way config_watch.h handles SIGHUP.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef ANOMALY_RING_H
+#define ANOMALY_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Anomalies kept per stream (a power of two). */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define ANOMALY_RING_SLOTS  8
+#else
+#define ANOMALY_RING_SLOTS  32
+#endif
+
+/** @brief Raw bytes kept from before the anomaly (already consumed). */
+#define ANOMALY_BYTES_BEFORE  64
+
+/** @brief Raw bytes kept from the anomaly on. */
+#define ANOMALY_BYTES_AFTER   192
+
+/** @brief What happened. */
+typedef enum {
+    ANOMALY_CRC = 1,
+    ANOMALY_SYNC_LOST,
+    ANOMALY_RESYNCED
+} AnomalyKind;
+
+/**
+ * @struct AnomalyEvent
+ * @brief One anomaly: where the framer stood and the bytes around it.
+ *
+ * @c bytes holds @c n_before bytes from before the read position, then
+ * @c n_after from it on; the anomaly is at @c bytes[n_before].
+ */
+typedef struct {
+    uint64_t seq;               /**< 1 for the first anomaly of the stream */
+    int64_t  utc_ns;            /**< stream_clock_utc_ns() when recorded */
+    uint64_t offset;            /**< stream bytes before it, since the connection started */
+    uint32_t kind;              /**< AnomalyKind */
+    uint32_t format;            /**< StreamFormat being framed */
+    uint32_t frame_len;         /**< length the header declared; 0 = none */
+    uint32_t crc_calc;          /**< ANOMALY_CRC: checksum of the bytes */
+    uint32_t crc_recv;          /**< ... and the one the frame carries */
+    uint32_t fill;              /**< bytes buffered from the read position */
+    uint64_t skipped;           /**< ANOMALY_RESYNCED: bytes skipped since the loss */
+    uint64_t frames;            /**< framer counters at the time */
+    uint64_t crc_errors;
+    uint64_t skipped_bytes;
+    uint64_t resyncs;
+    uint16_t n_before;
+    uint16_t n_after;
+    unsigned char bytes[ANOMALY_BYTES_BEFORE + ANOMALY_BYTES_AFTER];
+} AnomalyEvent;
+
+/**
+ * @struct AnomalyRing
+ * @brief The last ANOMALY_RING_SLOTS anomalies of one stream.
+ */
+typedef struct {
+    uint64_t     head;          /**< anomalies recorded so far (atomic) */
+    uint32_t     gen[ANOMALY_RING_SLOTS];   /**< odd while the slot is written */
+    AnomalyEvent slot[ANOMALY_RING_SLOTS];
+    bool         lost;          /**< writer only: sync lost, no good frame since */
+    uint64_t     lost_skipped;  /**< writer only: skipped_bytes at the loss */
+} AnomalyRing;
+
+/** @brief Writer: open the slot of the next anomaly; fill it in, then commit. */
+AnomalyEvent *anomaly_ring_begin(AnomalyRing *r);
+
+/** @brief Writer: stamp the anomaly opened by anomaly_ring_begin() and publish it. */
+void anomaly_ring_commit(AnomalyRing *r);
+
+/** @brief Anomalies recorded so far (any thread). */
+uint64_t anomaly_ring_count(const AnomalyRing *r);
+
+/**
+ * @brief Reader: copy the anomalies still in the ring, oldest first.
+ * @return The number copied to @p out (at most @p max).
+ */
+int anomaly_ring_read(const AnomalyRing *r, AnomalyEvent *out, int max);
+
+/** @brief Name of an AnomalyKind ("crc", "sync-lost", "resynced"). */
+const char *anomaly_kind_name(uint32_t kind);
+
+/** @brief Longest text of one anomaly from anomaly_event_format(). */
+#define ANOMALY_TEXT_MAX  2048
+
+/**
+ * @brief Format @p e as text: a header line with its time, kind and the
+ *        framer state, then a hex dump of its bytes, offsets counted from
+ *        the anomaly.
+ * @return Characters written to @p buf (always terminated).
+ */
+size_t anomaly_event_format(const AnomalyEvent *e, char *buf, size_t cap);
+
+/**
+ * @brief Reader: write the anomalies of @p r as text (one header line and
+ *        a hex dump each) to @p f under the heading @p name.
+ * @return The number of anomalies written.
+ */
+int anomaly_ring_dump(FILE *f, const AnomalyRing *r, const char *name);
+
+/** @brief Install the SIGUSR1 handler (POSIX; nothing elsewhere). */
+void anomaly_dump_watch(void);
+
+/** @brief true once per SIGUSR1 since the last call. */
+bool anomaly_dump_due(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ANOMALY_RING_H */
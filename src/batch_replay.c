@@ -0,0 +1,798 @@
+/**
+ * @file batch_replay.c
+ * @brief Batch sky replay: every capture in a directory, on all cores.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "batch_replay.h"
+#include "event_out.h"
+#include "quantile_sketch.h"
+#include "rinex_nav.h"
+#include "sky_render.h"
+#include "stream_clock.h"
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#define BATCH_SEP '\\'
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BATCH_SEP '/'
+#endif
+
+#define BATCH_N_SECTORS  (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+#define BATCH_DT_TYPES   32             /* message types with an interval sketch */
+#define BATCH_N_GNSS     8              /* RtcmMsgInfo::gnss_id 0..7 */
+#define BATCH_AGG_NAME   "aggregate_ARP-EPG.png"
+
+static const char batch_gnss_letter[BATCH_N_GNSS] = {
+    '?', 'G', 'R', 'E', 'J', 'C', 'S', 'I'
+};
+
+/**
+ * One capture and, once run, what its child reported.
+ *   - exit_code:  Child exit status; -1 = could not be started,
+ *                 -2 = not run (stopped).
+ */
+typedef struct {
+    char           *path;
+    const char     *name;               /* base name, inside path */
+    char           *png;
+    uint64_t        size;
+    int             exit_code;
+    bool            have_summary;
+    long            frames, msm, upd;
+    unsigned long   crc_errors, skipped;
+    double          hours;
+    double          wall_s;
+    uint64_t        sv_mask[BATCH_N_GNSS];
+    SkyRenderSector sectors[BATCH_N_SECTORS];
+    int             n_dt;
+    int             dt_type[BATCH_DT_TYPES];
+    QSketch         dt[BATCH_DT_TYPES]; /* message intervals per type */
+    char            note[120];          /* first [ERROR] line */
+} BatchFile;
+
+typedef struct {
+    const BatchReplayOptions *opt;
+    BatchFile          *files;
+    size_t             *order;          /* indices into files, largest first */
+    size_t              n;
+    size_t              next;           /* next slot of order to hand out */
+    size_t              done;
+    const volatile int *stop;
+    char                exe[1024];
+} BatchQueue;
+
+/* ── Capture list ─────────────────────────────────────────────────────── */
+
+static bool batch_ext_is(const char *name, const char *ext)
+{
+    size_t n = strlen(name), e = strlen(ext);
+    if (n <= e) return false;
+    for (size_t i = 0; i < e; i++)
+        if (tolower((unsigned char)name[n - e + i]) != ext[i]) return false;
+    return true;
+}
+
+static bool batch_is_capture(const char *name)
+{
+    return batch_ext_is(name, ".rtcm3") || batch_ext_is(name, ".rtcm") ||
+           batch_ext_is(name, ".nacap");
+}
+
+static char *batch_join(const char *dir, const char *name, const char *suffix)
+{
+    size_t d = strlen(dir);
+    bool sep = d > 0 && dir[d - 1] != '/' && dir[d - 1] != BATCH_SEP;
+    size_t len = d + (sep ? 1 : 0) + strlen(name) + strlen(suffix) + 1;
+    char *p = (char *)malloc(len);
+    if (p) snprintf(p, len, "%s%s%s%s", dir, sep ? (char[]){ BATCH_SEP, 0 } : "",
+                    name, suffix);
+    return p;
+}
+
+static bool batch_add(BatchFile **files, size_t *n, size_t *cap,
+                      const char *dir, const char *name, uint64_t size)
+{
+    if (*n == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 64;
+        BatchFile *f = (BatchFile *)realloc(*files, ncap * sizeof(*f));
+        if (!f) return false;
+        *files = f;
+        *cap = ncap;
+    }
+    BatchFile *f = &(*files)[*n];
+    memset(f, 0, sizeof(*f));
+    f->path = batch_join(dir, name, "");
+    if (!f->path) return false;
+    f->name      = f->path + strlen(f->path) - strlen(name);
+    f->size      = size;
+    f->exit_code = -2;
+    (*n)++;
+    return true;
+}
+
+/* Collect the capture files of @p dir.  Returns false if it can't be read. */
+static bool batch_list(const char *dir, BatchFile **files, size_t *n)
+{
+    size_t cap = 0;
+    *files = NULL;
+    *n = 0;
+#ifdef _WIN32
+    char *pattern = batch_join(dir, "*", "");
+    if (!pattern) return false;
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    free(pattern);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    do {
+        if ((fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ||
+            !batch_is_capture(fd.cFileName))
+            continue;
+        uint64_t size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        if (!batch_add(files, n, &cap, dir, fd.cFileName, size)) break;
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir);
+    if (!d) return false;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (!batch_is_capture(de->d_name)) continue;
+        char *path = batch_join(dir, de->d_name, "");
+        struct stat st;
+        bool regular = path && stat(path, &st) == 0 && S_ISREG(st.st_mode);
+        free(path);
+        if (!regular) continue;
+        if (!batch_add(files, n, &cap, dir, de->d_name, (uint64_t)st.st_size))
+            break;
+    }
+    closedir(d);
+#endif
+    return true;
+}
+
+static int batch_cmp_name(const void *a, const void *b)
+{
+    return strcmp(((const BatchFile *)a)->name, ((const BatchFile *)b)->name);
+}
+
+static const BatchFile *g_sort_files;   /* qsort context, main thread only */
+
+static int batch_cmp_size(const void *a, const void *b)
+{
+    uint64_t sa = g_sort_files[*(const size_t *)a].size;
+    uint64_t sb = g_sort_files[*(const size_t *)b].size;
+    return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+/* ── Child process ────────────────────────────────────────────────────── */
+
+/* Append to a growing output buffer; false when out of memory. */
+static bool batch_buf_add(char **buf, size_t *len, size_t *cap,
+                          const char *p, size_t n)
+{
+    if (*len + n + 1 > *cap) {
+        size_t ncap = *cap ? *cap : 8192;
+        while (*len + n + 1 > ncap) ncap *= 2;
+        char *nb = (char *)realloc(*buf, ncap);
+        if (!nb) return false;
+        *buf = nb;
+        *cap = ncap;
+    }
+    memcpy(*buf + *len, p, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+    return true;
+}
+
+#ifdef _WIN32
+static CRITICAL_SECTION g_spawn_lock;
+
+/* Append @p arg to a command line, quoted the way the C runtime's
+ * argument parser undoes it. */
+static void batch_quote(char **buf, size_t *len, size_t *cap, const char *arg)
+{
+    if (*len) batch_buf_add(buf, len, cap, " ", 1);
+    batch_buf_add(buf, len, cap, "\"", 1);
+    for (const char *p = arg; ; p++) {
+        size_t bs = 0;
+        while (*p == '\\') {
+            bs++;
+            p++;
+        }
+        /* Backslashes are literal unless they precede a quote (or the
+         * closing quote), where each one must be doubled. */
+        size_t reps = (*p == '"' || *p == '\0') ? bs * 2 : bs;
+        for (size_t i = 0; i < reps; i++) batch_buf_add(buf, len, cap, "\\", 1);
+        if (*p == '\0') break;
+        if (*p == '"') batch_buf_add(buf, len, cap, "\\\"", 2);
+        else           batch_buf_add(buf, len, cap, p, 1);
+    }
+    batch_buf_add(buf, len, cap, "\"", 1);
+}
+
+/* Run @p argv with stdout and stderr captured into *out.  Returns the
+ * exit code, or -1 if the child could not be started. */
+static int batch_spawn(char *const argv[], char **out)
+{
+    char *cmd = NULL;
+    size_t clen = 0, ccap = 0;
+    for (int i = 0; argv[i]; i++) batch_quote(&cmd, &clen, &ccap, argv[i]);
+    if (!cmd) return -1;
+
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, TRUE };
+    HANDLE rd = NULL, wr = NULL, nul = INVALID_HANDLE_VALUE;
+    PROCESS_INFORMATION pi;
+    BOOL started = FALSE;
+
+    /* Inheritable handles are only alive inside the lock, so a child
+     * started by another worker cannot inherit this one's pipe. */
+    EnterCriticalSection(&g_spawn_lock);
+    if (CreatePipe(&rd, &wr, &sa, 0)) {
+        SetHandleInformation(rd, HANDLE_FLAG_INHERIT, 0);
+        nul = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                          &sa, OPEN_EXISTING, 0, NULL);
+        STARTUPINFOA si;
+        ZeroMemory(&si, sizeof(si));
+        si.cb         = sizeof(si);
+        si.dwFlags    = STARTF_USESTDHANDLES;
+        si.hStdInput  = nul;
+        si.hStdOutput = wr;
+        si.hStdError  = wr;
+        /* No console: the child's Ctrl-A poll must not eat key presses. */
+        started = CreateProcessA(NULL, cmd, NULL, NULL, TRUE, CREATE_NO_WINDOW,
+                                 NULL, NULL, &si, &pi);
+        CloseHandle(wr);
+        if (nul != INVALID_HANDLE_VALUE) CloseHandle(nul);
+    }
+    LeaveCriticalSection(&g_spawn_lock);
+    free(cmd);
+    if (!started) {
+        if (rd) CloseHandle(rd);
+        return -1;
+    }
+
+    size_t len = 0, cap = 0;
+    char chunk[4096];
+    DWORD got;
+    while (ReadFile(rd, chunk, sizeof(chunk), &got, NULL) && got > 0)
+        batch_buf_add(out, &len, &cap, chunk, got);
+    CloseHandle(rd);
+
+    DWORD code = 1;
+    WaitForSingleObject(pi.hProcess, INFINITE);
+    GetExitCodeProcess(pi.hProcess, &code);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+    return (int)code;
+}
+#else
+static pthread_mutex_t g_spawn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int batch_spawn(char *const argv[], char **out)
+{
+    int pfd[2];
+    pid_t pid = -1;
+
+    /* Both pipe ends are close-on-exec before any other worker can fork,
+     * so a child only ever holds its own pipe. */
+    pthread_mutex_lock(&g_spawn_lock);
+    if (pipe(pfd) == 0) {
+        fcntl(pfd[0], F_SETFD, FD_CLOEXEC);
+        fcntl(pfd[1], F_SETFD, FD_CLOEXEC);
+        pid = fork();
+        if (pid == 0) {
+            /* stdin from /dev/null: the child must not put the terminal
+             * into raw mode for its Ctrl-A poll. */
+            int null_fd = open("/dev/null", O_RDONLY);
+            if (null_fd >= 0) dup2(null_fd, STDIN_FILENO);
+            dup2(pfd[1], STDOUT_FILENO);
+            dup2(pfd[1], STDERR_FILENO);
+            execvp(argv[0], argv);
+            _exit(127);
+        }
+        close(pfd[1]);
+        if (pid < 0) close(pfd[0]);
+    }
+    pthread_mutex_unlock(&g_spawn_lock);
+    if (pid < 0) return -1;
+
+    size_t len = 0, cap = 0;
+    char chunk[4096];
+    for (;;) {
+        ssize_t got = read(pfd[0], chunk, sizeof(chunk));
+        if (got > 0) {
+            batch_buf_add(out, &len, &cap, chunk, (size_t)got);
+            continue;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        break;
+    }
+    close(pfd[0]);
+
+    int st;
+    while (waitpid(pid, &st, 0) < 0)
+        if (errno != EINTR) return -1;
+    return WIFEXITED(st) ? WEXITSTATUS(st) : -1;
+}
+#endif
+
+/* ── Child report ─────────────────────────────────────────────────────── */
+
+static double batch_num(const cJSON *obj, const char *key)
+{
+    const cJSON *v = cJSON_GetObjectItemCaseSensitive(obj, key);
+    return cJSON_IsNumber(v) ? v->valuedouble : 0.0;
+}
+
+static void batch_read_sectors(const cJSON *arr, SkyRenderSector *s, bool observed)
+{
+    int i = 0;
+    const cJSON *v;
+    cJSON_ArrayForEach(v, arr) {
+        if (i >= BATCH_N_SECTORS) break;
+        int x = cJSON_IsNumber(v) ? v->valueint : 0;
+        if (observed) s[i].observed = x;
+        else          s[i].expected = x;
+        i++;
+    }
+}
+
+/* Take the child's "summary" event (see run_sky_replay_stream()). */
+/* Rebuild a sketch written by qsketch_to_event(). */
+static bool batch_read_sketch(QSketch *q, const cJSON *o)
+{
+    const cJSON *bins = cJSON_GetObjectItemCaseSensitive(o, "bins");
+    if (!cJSON_IsObject(o) || !cJSON_IsArray(bins)) return false;
+    memset(q, 0, sizeof(*q));
+    q->count  = (uint64_t)batch_num(o, "n");
+    q->zero   = (uint64_t)batch_num(o, "z");
+    q->min    = batch_num(o, "min");
+    q->max    = batch_num(o, "max");
+    q->sum    = batch_num(o, "sum");
+    q->key_lo = (int32_t)batch_num(o, "lo");
+    const cJSON *b;
+    cJSON_ArrayForEach(b, bins) {
+        const cJSON *i = cJSON_GetArrayItem(b, 0), *c = cJSON_GetArrayItem(b, 1);
+        if (!cJSON_IsNumber(i) || !cJSON_IsNumber(c)) return false;
+        if (i->valueint < 0 || i->valueint >= QSKETCH_BINS) return false;
+        q->bin[i->valueint] = (uint32_t)c->valuedouble;
+    }
+    return true;
+}
+
+static void batch_read_summary(BatchFile *f, const cJSON *j)
+{
+    f->have_summary = true;
+    f->frames     = (long)batch_num(j, "frames");
+    f->msm        = (long)batch_num(j, "msm");
+    f->upd        = (long)batch_num(j, "upd");
+    f->crc_errors = (unsigned long)batch_num(j, "crc_errors");
+    f->skipped    = (unsigned long)batch_num(j, "skipped");
+    f->hours      = batch_num(j, "hours");
+
+    const cJSON *sv = cJSON_GetObjectItemCaseSensitive(j, "sv_mask");
+    for (int g = 1; g < BATCH_N_GNSS; g++) {
+        char key[2] = { batch_gnss_letter[g], 0 };
+        const cJSON *m = cJSON_GetObjectItemCaseSensitive(sv, key);
+        if (cJSON_IsString(m))
+            f->sv_mask[g] = (uint64_t)strtoull(m->valuestring, NULL, 16);
+    }
+    const cJSON *dt = cJSON_GetObjectItemCaseSensitive(j, "dt");
+    const cJSON *d;
+    cJSON_ArrayForEach(d, dt) {
+        if (f->n_dt == BATCH_DT_TYPES) break;
+        if (!d->string || !batch_read_sketch(&f->dt[f->n_dt], d)) continue;
+        f->dt_type[f->n_dt++] = atoi(d->string);
+    }
+    const cJSON *sec = cJSON_GetObjectItemCaseSensitive(j, "sectors");
+    batch_read_sectors(cJSON_GetObjectItemCaseSensitive(sec, "observed"),
+                       f->sectors, true);
+    batch_read_sectors(cJSON_GetObjectItemCaseSensitive(sec, "expected"),
+                       f->sectors, false);
+}
+
+static void batch_parse_output(BatchFile *f, char *out)
+{
+    for (char *line = out; line && *line; ) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        if (line[0] == '{') {
+            cJSON *j = cJSON_Parse(line);
+            const cJSON *ev = cJSON_GetObjectItemCaseSensitive(j, "event");
+            if (cJSON_IsString(ev) && strcmp(ev->valuestring, "summary") == 0)
+                batch_read_summary(f, j);
+            cJSON_Delete(j);
+        } else if (!f->note[0] && strncmp(line, "[ERROR] ", 8) == 0) {
+            snprintf(f->note, sizeof(f->note), "%s", line + 8);
+        }
+        line = nl ? nl + 1 : NULL;
+    }
+}
+
+static double batch_coverage(const SkyRenderSector *s)
+{
+    long long obs = 0, exp = 0;
+    for (int i = 0; i < BATCH_N_SECTORS; i++) {
+        obs += s[i].observed;
+        exp += s[i].expected;
+    }
+    return exp > 0 ? 100.0 * (double)obs / (double)exp : 0.0;
+}
+
+static int batch_popcount(uint64_t v)
+{
+    int n = 0;
+    for (; v; v &= v - 1) n++;
+    return n;
+}
+
+/* "G12 E9 C14": SVs seen per GNSS. */
+static void batch_format_svs(const uint64_t *mask, char *out, size_t cap)
+{
+    size_t len = 0;
+    out[0] = '\0';
+    for (int g = 1; g < BATCH_N_GNSS && len < cap; g++) {
+        int n = batch_popcount(mask[g]);
+        if (n)
+            len += (size_t)snprintf(out + len, cap - len, "%s%c%d",
+                                    len ? " " : "", batch_gnss_letter[g], n);
+    }
+    if (!out[0]) snprintf(out, cap, "-");
+}
+
+/* ── Workers ──────────────────────────────────────────────────────────── */
+
+static void batch_run_one(BatchQueue *q, BatchFile *f)
+{
+    const BatchReplayOptions *opt = q->opt;
+    f->png = batch_join(opt->out_dir ? opt->out_dir : opt->dir, f->name, ".png");
+    if (!f->png) {
+        f->exit_code = -1;
+        return;
+    }
+    char *argv[] = {
+        q->exe, "--sky", "--replay", f->path,
+        "-c", (char *)opt->config_path, "-R", (char *)opt->rinex_path,
+        "-o", f->png, "-q", "--no-progress", "--json", NULL
+    };
+    char *out = NULL;
+    double t0 = stream_clock_wall_seconds();
+    f->exit_code = batch_spawn(argv, &out);
+    f->wall_s = stream_clock_wall_seconds() - t0;
+    if (out) batch_parse_output(f, out);
+    free(out);
+    if (f->exit_code == -1 && !f->note[0])
+        snprintf(f->note, sizeof(f->note), "cannot start the child process");
+}
+
+static void batch_report_file(BatchQueue *q, const BatchFile *f, size_t done)
+{
+    const BatchReplayOptions *opt = q->opt;
+    if (opt->events) {
+        event_begin(opt->events, "file");
+        event_str(opt->events, "path", f->path);
+        event_int(opt->events, "exit", f->exit_code);
+        event_str(opt->events, "png", f->exit_code == 0 ? f->png : "");
+        event_int(opt->events, "frames", f->frames);
+        event_int(opt->events, "msm", f->msm);
+        event_num(opt->events, "coverage", batch_coverage(f->sectors));
+        event_num(opt->events, "wall_s", f->wall_s);
+        event_end(opt->events);
+    } else if (!opt->quiet) {
+        fprintf(stderr, "[BATCH] %lu/%lu %s: %s (%.1f s)\n",
+                (unsigned long)done, (unsigned long)q->n, f->name,
+                f->exit_code == 0 ? "ok" : "FAILED", f->wall_s);
+    }
+    fflush(stderr);
+}
+
+static void batch_work(BatchQueue *q)
+{
+    while (!*q->stop) {
+        size_t k = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+        if (k >= q->n) break;
+        BatchFile *f = &q->files[q->order[k]];
+        batch_run_one(q, f);
+        batch_report_file(q, f, __atomic_add_fetch(&q->done, 1, __ATOMIC_RELAXED));
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall batch_thread(void *arg)
+#else
+static void *batch_thread(void *arg)
+#endif
+{
+    batch_work((BatchQueue *)arg);
+    return 0;
+}
+
+static int batch_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* ── Summary ──────────────────────────────────────────────────────────── */
+
+#define BATCH_RULE "+--------------------------------+--------+----------+----------+--------+----------+--------------------------+----------+\n"
+
+static void batch_print_row(const char *name, double hours, long frames,
+                            long msm, unsigned long crc, double cov,
+                            const char *svs, const char *status)
+{
+    printf("| %-30.30s | %6.1f | %8ld | %8ld | %6lu | %7.1f%% | %-24.24s | %-8.8s |\n",
+           name, hours, frames, msm, crc, cov, svs, status);
+}
+
+static int batch_cmp_int(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/* Message intervals of every capture, merged per type. */
+static void batch_print_intervals(const BatchQueue *q, size_t n_ok)
+{
+    int      types[BATCH_DT_TYPES];
+    QSketch *sum = (QSketch *)calloc(BATCH_DT_TYPES, sizeof(QSketch));
+    int      n_types = 0;
+    if (!sum) return;
+    for (size_t i = 0; i < q->n; i++) {
+        const BatchFile *f = &q->files[i];
+        if (f->exit_code != 0) continue;
+        for (int t = 0; t < f->n_dt; t++) {
+            int k = 0;
+            while (k < n_types && types[k] != f->dt_type[t]) k++;
+            if (k == n_types) {
+                if (n_types == BATCH_DT_TYPES) continue;
+                types[n_types++] = f->dt_type[t];
+            }
+            qsketch_merge(&sum[k], &f->dt[t]);
+        }
+    }
+    /* Sort the types, carrying their sketches along */
+    int sorted[BATCH_DT_TYPES];
+    memcpy(sorted, types, (size_t)n_types * sizeof(int));
+    qsort(sorted, (size_t)n_types, sizeof(int), batch_cmp_int);
+    bool head = false;
+    for (int s = 0; s < n_types; s++) {
+        int k = 0;
+        while (types[k] != sorted[s]) k++;
+        if (sum[k].count == 0) continue;
+        if (!head) {
+            char title[64];
+            snprintf(title, sizeof(title), "[INFO] Message intervals, %lu captures",
+                     (unsigned long)n_ok);
+            qsketch_print_head(title, stdout);
+            head = true;
+        }
+        qsketch_print_row(sorted[s], &sum[k], stdout);
+    }
+    if (head) qsketch_print_foot(stdout);
+    free(sum);
+}
+
+static void batch_print_summary(const BatchQueue *q, double elapsed, int jobs,
+                                const char *agg_png, bool agg_ok)
+{
+    SkyRenderSector tot_sec[BATCH_N_SECTORS];
+    uint64_t tot_mask[BATCH_N_GNSS] = { 0 };
+    double   tot_hours = 0.0;
+    long     tot_frames = 0, tot_msm = 0;
+    unsigned long tot_crc = 0;
+    size_t   n_ok = 0;
+    char     svs[64], status[16];
+
+    memset(tot_sec, 0, sizeof(tot_sec));
+    printf("\n[INFO] Batch replay: %lu captures, %d jobs, %.1f s\n",
+           (unsigned long)q->n, jobs, elapsed);
+    printf(BATCH_RULE);
+    printf("| %-30s | %6s | %8s | %8s | %6s | %8s | %-24s | %-8s |\n",
+           "Capture", "Hours", "Frames", "MSM", "CRC", "Coverage", "SVs", "Status");
+    printf(BATCH_RULE);
+    for (size_t i = 0; i < q->n; i++) {
+        const BatchFile *f = &q->files[i];
+        batch_format_svs(f->sv_mask, svs, sizeof(svs));
+        if (f->exit_code == 0)       snprintf(status, sizeof(status), "ok");
+        else if (f->exit_code == -2) snprintf(status, sizeof(status), "skipped");
+        else if (f->exit_code == -1) snprintf(status, sizeof(status), "no start");
+        else                         snprintf(status, sizeof(status), "exit %d", f->exit_code);
+        batch_print_row(f->name, f->hours, f->frames, f->msm, f->crc_errors,
+                        batch_coverage(f->sectors), svs, status);
+        if (f->exit_code != 0) continue;
+        n_ok++;
+        tot_hours  += f->hours;
+        tot_frames += f->frames;
+        tot_msm    += f->msm;
+        tot_crc    += f->crc_errors;
+        for (int g = 0; g < BATCH_N_GNSS; g++) tot_mask[g] |= f->sv_mask[g];
+        for (int s = 0; s < BATCH_N_SECTORS; s++) {
+            tot_sec[s].observed += f->sectors[s].observed;
+            tot_sec[s].expected += f->sectors[s].expected;
+        }
+    }
+    printf(BATCH_RULE);
+    batch_format_svs(tot_mask, svs, sizeof(svs));
+    snprintf(status, sizeof(status), "%lu/%lu", (unsigned long)n_ok, (unsigned long)q->n);
+    batch_print_row("TOTAL", tot_hours, tot_frames, tot_msm, tot_crc,
+                    batch_coverage(tot_sec), svs, status);
+    printf(BATCH_RULE);
+    batch_print_intervals(q, n_ok);
+
+    for (size_t i = 0; i < q->n; i++) {
+        const BatchFile *f = &q->files[i];
+        if (f->exit_code != 0 && f->note[0])
+            printf("%-30s %s\n", f->name, f->note);
+    }
+    if (agg_png)
+        printf("%s %s\n", agg_ok ? "Aggregate heatmap:" : "[ERROR] Could not write",
+               agg_png);
+    fflush(stdout);
+}
+
+static bool batch_write_aggregate(const BatchQueue *q, const char *path)
+{
+    SkyRenderSector *sum = (SkyRenderSector *)calloc(BATCH_N_SECTORS, sizeof(*sum));
+    if (!sum) return false;
+    size_t n_ok = 0;
+    for (size_t i = 0; i < q->n; i++) {
+        const BatchFile *f = &q->files[i];
+        if (f->exit_code != 0 || !f->have_summary) continue;
+        n_ok++;
+        for (int s = 0; s < BATCH_N_SECTORS; s++) {
+            sum[s].observed += f->sectors[s].observed;
+            sum[s].expected += f->sectors[s].expected;
+        }
+    }
+    char label[64], utc_label[40] = "";
+    snprintf(label, sizeof(label), "aggregate of %lu captures", (unsigned long)n_ok);
+    time_t now_t = time(NULL);
+    struct tm *gt = gmtime(&now_t);
+    if (gt) strftime(utc_label, sizeof(utc_label), "%Y-%m-%d %H:%M:%S UTC", gt);
+    bool ok = n_ok > 0 &&
+              sky_render_heatmap_png(path, sum, 800, 800, false, 0.0, 0.0, 0.0,
+                                     label, utc_label);
+    free(sum);
+    return ok;
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+int batch_replay_run(const BatchReplayOptions *opt, const volatile int *stop_flag)
+{
+    BatchQueue q;
+    memset(&q, 0, sizeof(q));
+    q.opt  = opt;
+    q.stop = stop_flag;
+#ifdef _WIN32
+    /* The children must run this very binary, wherever it was found. */
+    if (!GetModuleFileNameA(NULL, q.exe, sizeof(q.exe)))
+        snprintf(q.exe, sizeof(q.exe), "%s", opt->exe);
+    InitializeCriticalSection(&g_spawn_lock);
+#else
+    snprintf(q.exe, sizeof(q.exe), "%s", opt->exe);
+#endif
+
+    if (!batch_list(opt->dir, &q.files, &q.n)) {
+        fprintf(stderr, "[ERROR] Cannot read directory: %s\n", opt->dir);
+        return -1;
+    }
+    if (q.n == 0) {
+        fprintf(stderr, "[ERROR] No capture files (.rtcm3, .rtcm, .nacap) in %s\n",
+                opt->dir);
+        free(q.files);
+        return -1;
+    }
+    /* Parse the RINEX file once up front: its .ephc sidecar is then in
+     * place before the children start, instead of every child parsing it
+     * and racing to write the sidecar. */
+    if (rinex_nav_load(opt->rinex_path, NULL) < 0) {
+        fprintf(stderr, "[ERROR] Could not read RINEX file: %s\n", opt->rinex_path);
+        for (size_t i = 0; i < q.n; i++) free(q.files[i].path);
+        free(q.files);
+        return -1;
+    }
+    qsort(q.files, q.n, sizeof(*q.files), batch_cmp_name);
+    q.order = (size_t *)malloc(q.n * sizeof(*q.order));
+    if (!q.order) {
+        free(q.files);
+        return -1;
+    }
+    for (size_t i = 0; i < q.n; i++) q.order[i] = i;
+    g_sort_files = q.files;
+    qsort(q.order, q.n, sizeof(*q.order), batch_cmp_size);
+
+    int jobs = opt->jobs > 0 ? opt->jobs : batch_cpu_count();
+    if (jobs > BATCH_REPLAY_MAX_JOBS) jobs = BATCH_REPLAY_MAX_JOBS;
+    if ((size_t)jobs > q.n) jobs = (int)q.n;
+    if (!opt->quiet && !opt->events)
+        fprintf(stderr, "[BATCH] %lu captures in %s, %d jobs\n",
+                (unsigned long)q.n, opt->dir, jobs);
+
+    double t0 = stream_clock_wall_seconds();
+#ifdef _WIN32
+    HANDLE threads[BATCH_REPLAY_MAX_JOBS];
+#else
+    pthread_t threads[BATCH_REPLAY_MAX_JOBS];
+#endif
+    bool started[BATCH_REPLAY_MAX_JOBS] = { false };
+    /* Worker 0 is this thread. */
+    for (int t = 1; t < jobs; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, batch_thread, &q, 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, batch_thread, &q) == 0;
+#endif
+    }
+    batch_work(&q);
+    for (int t = 1; t < jobs; t++) {
+        if (!started[t]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+    double elapsed = stream_clock_wall_seconds() - t0;
+
+    char *agg = NULL;
+    bool agg_ok = false;
+    for (size_t i = 0; i < q.n && !agg; i++)
+        if (q.files[i].exit_code == 0 && q.files[i].have_summary)
+            agg = batch_join(opt->out_dir ? opt->out_dir : opt->dir, BATCH_AGG_NAME, "");
+    if (agg) agg_ok = batch_write_aggregate(&q, agg);
+    batch_print_summary(&q, elapsed, jobs, agg, agg_ok);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < q.n; i++)
+        if (q.files[i].exit_code != 0) failed++;
+    if (opt->events) {
+        event_begin(opt->events, "batch");
+        event_uint(opt->events, "files", q.n);
+        event_uint(opt->events, "failed", failed);
+        event_num(opt->events, "elapsed_s", elapsed);
+        event_str(opt->events, "aggregate", agg_ok ? agg : "");
+        event_end(opt->events);
+        event_out_flush(opt->events);
+    }
+
+    free(agg);
+    for (size_t i = 0; i < q.n; i++) {
+        free(q.files[i].path);
+        free(q.files[i].png);
+    }
+    free(q.files);
+    free(q.order);
+#ifdef _WIN32
+    DeleteCriticalSection(&g_spawn_lock);
+#endif
+    return failed ? 1 : 0;
+}
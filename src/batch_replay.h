@@ -0,0 +1,86 @@
+/**
+ * @file batch_replay.h
+ * @brief Batch sky replay: every capture in a directory, on all cores.
+ *
+ * `--sky --replay-dir DIR` replays each capture file in DIR (.rtcm3,
+ * .rtcm and .nacap) as if `--sky --replay FILE` had been run on it, with
+ * up to N files in flight at once (--jobs, default one per core).
+ *
+ * Each file runs in a child process of this same executable.  The sky
+ * pipeline keeps its state in process globals (the epoch assembler, the
+ * station ARP and the stream clock), so separate processes are what
+ * keeps the replays independent of each other.  The RINEX file is
+ * loaded once before the first child starts, so the children share its
+ * parsed records through the .ephc sidecar (rinex_nav.h).  A pool of N worker threads pulls files off a shared queue,
+ * largest first, so one long capture does not end up last on a busy
+ * worker.
+ *
+ * A child writes its heatmap next to the others and reports on its
+ * --json event stream; the "summary" event carries its counters, the
+ * satellites it saw, a message-interval sketch per type
+ * (quantile_sketch.h) and its sector grid.  After the last file a table
+ * of all files and a total row are printed on stdout, the interval
+ * sketches are merged into one table per message type, and the sector
+ * grids are summed into an aggregate heatmap ("aggregate_ARP-EPG.png").
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef BATCH_REPLAY_H
+#define BATCH_REPLAY_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Upper bound on --jobs. */
+#define BATCH_REPLAY_MAX_JOBS  256
+
+struct EventOut;   /* event_out.h */
+
+/**
+ * @struct BatchReplayOptions
+ * @brief What to replay, and how the child runs are set up.
+ *
+ * Fields:
+ *   - exe:          Path of this executable (argv[0]).
+ *   - dir:          Directory with the capture files.
+ *   - out_dir:      Where the heatmaps go; NULL = @c dir.
+ *   - config_path:  Config file passed on to every child.
+ *   - rinex_path:   RINEX NAV file passed on to every child.
+ *   - jobs:         Files in flight at once; 0 = one per core.
+ *   - events:       --json stream (event_out.h) for one "file" event per
+ *                   capture and a final "batch" event; NULL = none.
+ *   - quiet:        No per-file progress lines on stderr.
+ */
+typedef struct {
+    const char *exe;
+    const char *dir;
+    const char *out_dir;
+    const char *config_path;
+    const char *rinex_path;
+    int         jobs;
+    struct EventOut *events;
+    bool        quiet;
+} BatchReplayOptions;
+
+/**
+ * @brief Replay every capture in @p opt->dir and print the summary.
+ *
+ * @param stop_flag  Polled between files; non-zero stops handing out new
+ *                   files (the ones in flight finish).
+ * @return 0 if every file replayed, 1 if any failed, -1 if the directory
+ *         cannot be read or holds no captures, or the RINEX file cannot
+ *         be read.
+ */
+int batch_replay_run(const BatchReplayOptions *opt, const volatile int *stop_flag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATCH_REPLAY_H */
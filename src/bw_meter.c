@@ -0,0 +1,160 @@
+/**
+ * @file bw_meter.c
+ * @brief Per-message-type bandwidth over sliding windows, and the byte
+ *        bursts that follow each MSM epoch.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "bw_meter.h"
+#include "rtcm3x_parser.h"
+#include "rtcm_bitreader.h"
+
+#include <math.h>
+#include <string.h>
+
+static const int k_window_s[BW_WINDOWS] = { 1, 10, 60 };
+
+void bw_burst_frame(BwBurst *b, const unsigned char *frame, int frame_len, double now)
+{
+    if (frame_len < 6 + 2) return;
+    const unsigned char *payload = frame + 3;
+    int payload_len = frame_len - 6;
+    int msg_type = (payload[0] << 4) | (payload[1] >> 4);
+    /* The multiple-message bit follows type, station and epoch time. */
+    bool msm = rtcm_msg_is_msm(msg_type, 1, 7) && payload_len >= 7;
+
+    if (msm && b->epoch_end) {
+        if (b->seq) {
+            b->sum += b->bytes;
+            b->closed++;
+        }
+        b->seq++;
+        b->t_start = now;
+        b->bytes   = 0;
+        b->span    = 0.0;
+        b->open    = true;
+    }
+    if (b->open && now - b->t_start > BW_BURST_WINDOW_S) b->open = false;
+    if (b->open) {
+        b->bytes += (uint32_t)frame_len;
+        b->span   = now - b->t_start;
+        if (b->bytes > b->peak) {
+            b->peak      = b->bytes;
+            b->peak_span = b->span;
+        }
+    }
+    if (msm) b->epoch_end = rtcm_bits_at(payload, payload_len, 54, 1) == 0;
+}
+
+double bw_burst_mean(const BwBurst *b)
+{
+    return b->closed ? (double)b->sum / b->closed : 0.0;
+}
+
+static uint32_t bw_second(double now)
+{
+    return now > 0.0 ? (uint32_t)floor(now) : 0;
+}
+
+static void bw_bucket_add(BwBucket *k, uint32_t stamp, int bytes)
+{
+    if (k->sec != stamp) {
+        k->sec    = stamp;
+        k->bytes  = 0;
+        k->frames = 0;
+    }
+    k->bytes += (uint32_t)bytes;
+    k->frames++;
+}
+
+void bw_meter_add(BwMeter *m, double now, int bytes, const BwBurst *burst)
+{
+    uint32_t s = bw_second(now);
+    if (m->frames && s != m->last_sec) {
+        /* The previous second is complete. */
+        const BwBucket *prev = &m->fine[m->last_sec % BW_FINE_BUCKETS];
+        if (prev->sec == m->last_sec && prev->bytes > m->peak_1s)
+            m->peak_1s = prev->bytes;
+    }
+    if (!m->frames) m->first_sec = s;
+    m->last_sec = s;
+    bw_bucket_add(&m->fine[s % BW_FINE_BUCKETS], s, bytes);
+    bw_bucket_add(&m->coarse[(s / 10) % BW_COARSE_BUCKETS], s / 10, bytes);
+    m->bytes += (uint64_t)bytes;
+    m->frames++;
+
+    if (burst && burst->open) {
+        if (m->burst_seq != burst->seq) {
+            m->burst_seq   = burst->seq;
+            m->burst_bytes = 0;
+        }
+        m->burst_bytes += (uint32_t)bytes;
+        if (m->burst_bytes > m->burst_peak) m->burst_peak = m->burst_bytes;
+    }
+}
+
+/* Bytes and frames of the buckets stamped first .. last. */
+static void bw_sum(const BwBucket *k, int n, uint32_t first, uint32_t last,
+                   double *bytes, double *frames)
+{
+    *bytes = *frames = 0.0;
+    for (int i = 0; i < n; i++) {
+        if (k[i].sec < first || k[i].sec > last) continue;
+        *bytes  += k[i].bytes;
+        *frames += k[i].frames;
+    }
+}
+
+void bw_meter_rates(const BwMeter *m, double now, BwRates *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->bytes      = m->bytes;
+    out->frames     = m->frames;
+    out->burst_peak = m->burst_peak;
+    out->peak_1s    = m->peak_1s;
+    if (!m->frames) return;
+
+    uint32_t s = bw_second(now);
+    const BwBucket *newest = &m->fine[m->last_sec % BW_FINE_BUCKETS];
+    if (m->last_sec < s && newest->sec == m->last_sec && newest->bytes > out->peak_1s)
+        out->peak_1s = newest->bytes;
+    if (s <= m->first_sec) return;      /* no complete second yet */
+
+    double b, f;
+    bw_sum(m->fine, BW_FINE_BUCKETS, s - 1, s - 1, &b, &f);
+    out->bytes_s[BW_WIN_1S]  = b;
+    out->frames_s[BW_WIN_1S] = f;
+
+    uint32_t from = s >= 10 ? s - 10 : 0;
+    if (from < m->first_sec) from = m->first_sec;
+    bw_sum(m->fine, BW_FINE_BUCKETS, from, s - 1, &b, &f);
+    out->bytes_s[BW_WIN_10S]  = b / (s - from);
+    out->frames_s[BW_WIN_10S] = f / (s - from);
+
+    uint32_t blk = s / 10;
+    uint32_t first_blk = blk >= 6 ? blk - 6 : 0;
+    from = first_blk * 10;
+    if (from < m->first_sec) from = m->first_sec;
+    if (blk * 10 <= from) return;       /* the first block is not complete */
+    bw_sum(m->coarse, BW_COARSE_BUCKETS, first_blk, blk - 1, &b, &f);
+    out->bytes_s[BW_WIN_60S]  = b / (blk * 10 - from);
+    out->frames_s[BW_WIN_60S] = f / (blk * 10 - from);
+}
+
+int bw_window_seconds(BwWindow w)
+{
+    return (unsigned)w < BW_WINDOWS ? k_window_s[w] : 0;
+}
+
+const char *bw_window_name(BwWindow w)
+{
+    switch (w) {
+    case BW_WIN_1S:  return "1s";
+    case BW_WIN_10S: return "10s";
+    case BW_WIN_60S: return "60s";
+    default:         return "?";
+    }
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bw_meter.h
+ * @brief Per-message-type bandwidth over sliding windows, and the byte
+ *        bursts that follow each MSM epoch.
+ *
+ * A radio link is sized by two numbers: the sustained rate of the stream
+ * and the burst a reference station sends once per epoch, when every
+ * MSM of the epoch (and whatever is scheduled with it) goes out at once.
+ * A BwMeter counts the bytes and frames of one message type in ring
+ * buckets -- ten of one second and six of ten seconds, each stamped with
+ * its second (block) so a stale bucket is skipped rather than cleared --
+ * and reports:
+ *
+ *   - the rate over the last complete second, the last 10 complete
+ *     seconds and the last six complete 10 s blocks (the 60 s window
+ *     therefore moves in 10 s steps); a window reaching back before the
+ *     first frame is averaged over the part after it
+ *   - the busiest complete second so far
+ *   - its share of the largest epoch burst
+ *
+ * A BwBurst marks the bursts of a stream.  An epoch ends with the MSM
+ * whose multiple-message bit is 0; the next MSM opens a burst, and every
+ * frame (any type) received within @ref BW_BURST_WINDOW_S of it counts
+ * towards it.  bw_burst_frame() must see each frame before the meters do.
+ *
+ * Adding a frame and reading the rates take constant time.  Times are
+ * seconds on any clock that does not go backwards (wall, monotonic or a
+ * capture's virtual time); plain data, one writer.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef BW_METER_H
+#define BW_METER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief One-second buckets of a meter. */
+#define BW_FINE_BUCKETS    10
+
+/** @brief Ten-second buckets of a meter. */
+#define BW_COARSE_BUCKETS  6
+
+/** @brief Seconds after an epoch boundary whose frames make up its burst. */
+#define BW_BURST_WINDOW_S  0.5
+
+/** @brief The reported windows. */
+typedef enum {
+    BW_WIN_1S = 0,
+    BW_WIN_10S,
+    BW_WIN_60S,
+    BW_WINDOWS
+} BwWindow;
+
+/** @brief Bytes and frames of one second or ten-second block. */
+typedef struct {
+    uint32_t sec;               /**< second (fine) or block (coarse) counted */
+    uint32_t bytes;
+    uint32_t frames;
+} BwBucket;
+
+/**
+ * @struct BwBurst
+ * @brief The epoch bursts of one stream.
+ */
+typedef struct {
+    uint32_t seq;               /**< bursts opened so far */
+    double   t_start;           /**< receive time of the burst's first MSM */
+    bool     open;              /**< still within BW_BURST_WINDOW_S */
+    bool     epoch_end;         /**< the last MSM ended its epoch */
+    uint32_t bytes;             /**< of the current burst */
+    double   span;              /**< first to last frame of the current burst (s) */
+    uint32_t peak;              /**< largest burst, bytes */
+    double   peak_span;         /**< ... and its span */
+    uint64_t sum;               /**< bytes of the closed bursts */
+    uint32_t closed;            /**< closed bursts */
+} BwBurst;
+
+/**
+ * @struct BwMeter
+ * @brief Bandwidth of one message type (or a whole stream).  Zeroed = empty.
+ */
+typedef struct {
+    BwBucket fine[BW_FINE_BUCKETS];     /**< second s at s % BW_FINE_BUCKETS */
+    BwBucket coarse[BW_COARSE_BUCKETS]; /**< block s / 10 at (s / 10) % BW_COARSE_BUCKETS */
+    uint64_t bytes;             /**< total */
+    uint64_t frames;
+    uint32_t first_sec;         /**< second of the first frame */
+    uint32_t last_sec;          /**< second of the newest frame */
+    uint32_t peak_1s;           /**< busiest complete second before last_sec, bytes */
+    uint32_t burst_seq;         /**< BwBurst::seq that burst_bytes belongs to */
+    uint32_t burst_bytes;       /**< bytes in that burst */
+    uint32_t burst_peak;        /**< most bytes in one burst */
+} BwMeter;
+
+/** @brief What a meter reports at one instant (plain data, for snapshots). */
+typedef struct {
+    uint64_t bytes;
+    uint64_t frames;
+    double   bytes_s[BW_WINDOWS];   /**< bytes per second, per window */
+    double   frames_s[BW_WINDOWS];  /**< frames per second, per window */
+    uint32_t peak_1s;               /**< busiest complete second, bytes */
+    uint32_t burst_peak;            /**< most bytes in one epoch burst */
+} BwRates;
+
+/**
+ * @brief Follow the epoch bursts: call for every frame, before any
+ *        bw_meter_add() of it.
+ *
+ * @param frame  Complete RTCM frame (header, payload, CRC).
+ * @param now    Receive time (s).
+ */
+void bw_burst_frame(BwBurst *b, const unsigned char *frame, int frame_len, double now);
+
+/** @brief Mean bytes of the closed bursts; 0 before the first closed. */
+double bw_burst_mean(const BwBurst *b);
+
+/**
+ * @brief Count one frame of @p bytes received at @p now.
+ *
+ * @param burst  The stream's bursts, or NULL to leave the burst share out.
+ */
+void bw_meter_add(BwMeter *m, double now, int bytes, const BwBurst *burst);
+
+/** @brief Rates of @p m as seen at @p now (windows end at the last complete second). */
+void bw_meter_rates(const BwMeter *m, double now, BwRates *out);
+
+/** @brief Length of window @p w in seconds. */
+int bw_window_seconds(BwWindow w);
+
+/** @brief "1s", "10s" or "60s". */
+const char *bw_window_name(BwWindow w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BW_METER_H */
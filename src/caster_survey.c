@@ -0,0 +1,458 @@
+/**
+ * @file caster_survey.c
+ * @brief Caster survey: STR parsing, checks, report and JSON.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "caster_survey.h"
+#include "ntrip_handler.h"
+#include "rtcm3x_parser.h"
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SURVEY_STR_FIELDS   11      /* STR;Mount;Ident;Format;Details;Carrier;Nav;Net;Country;Lat;Lon */
+#define SURVEY_LINE_MAX     2048
+
+/* One letter per GNSS ID, as RINEX names them; '?' for ID 0. */
+static const char k_gnss_letter[SURVEY_GNSS] = { '?', 'G', 'R', 'E', 'J', 'C', 'S', 'I' };
+
+static const char *const k_issue_name[SURVEY_ISSUES] = {
+    "down", "no-arp", "arp-far", "missing", "unlisted", "gnss", "crc", "format"
+};
+
+/* ── Sourcetable ───────────────────────────────────────────────────── */
+
+/* "1004(1),1005(10),1033(30)": the types and the rates in brackets. */
+static void parse_details(SurveyMount *m, const char *details)
+{
+    for (const char *p = details; *p; ) {
+        if (!isdigit((unsigned char)*p)) { p++; continue; }
+        char *end;
+        long msg = strtol(p, &end, 10);
+        int rate = 0;
+        if (*end == '(') rate = atoi(end + 1);
+        if ((*end == '(' || *end == ',' || *end == '\0') && msg >= 1 && msg <= 4095 &&
+            m->n_listed < SURVEY_TYPES) {
+            m->listed[m->n_listed]   = (int)msg;
+            m->listed_s[m->n_listed] = rate > 0 ? rate : 0;
+            m->n_listed++;
+        }
+        p = end;
+        while (*p && *p != ',') p++;
+    }
+}
+
+/* "GPS+GLO+GAL+BDS", "GPS&GLONASS", "GPS,Galileo": a bit per GNSS ID. */
+static unsigned parse_nav(const char *nav)
+{
+    static const struct { const char *prefix; int id; } k_nav[] = {
+        { "GPS", 1 }, { "NAVSTAR", 1 }, { "GLO", 2 }, { "GAL", 3 }, { "QZS", 4 },
+        { "BDS", 5 }, { "BEI", 5 }, { "COMPASS", 5 }, { "CMP", 5 }, { "SBAS", 6 },
+        { "IRN", 7 }, { "NAVIC", 7 }
+    };
+    unsigned mask = 0;
+    for (const char *p = nav; *p; ) {
+        if (!isalpha((unsigned char)*p)) { p++; continue; }
+        char tok[16];
+        size_t n = 0;
+        while (isalnum((unsigned char)*p)) {
+            if (n < sizeof(tok) - 1) tok[n++] = (char)toupper((unsigned char)*p);
+            p++;
+        }
+        tok[n] = '\0';
+        for (size_t k = 0; k < sizeof(k_nav) / sizeof(k_nav[0]); k++) {
+            if (strncmp(tok, k_nav[k].prefix, strlen(k_nav[k].prefix)) == 0) {
+                mask |= 1u << k_nav[k].id;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+int caster_survey_parse(const char *table, int max_mounts, SurveyMount **out, int *n_out)
+{
+    int cap = 64, n = 0;
+    SurveyMount *v = (SurveyMount *)calloc((size_t)cap, sizeof(SurveyMount));
+    if (!v) {
+        fprintf(stderr, "[ERROR] Out of memory reading the sourcetable\n");
+        return -1;
+    }
+    for (const char *p = table; p && *p; ) {
+        size_t len = strcspn(p, "\r\n");
+        const char *next = p + len;
+        next += strspn(next, "\r\n");
+        if (len > 4 && strncmp(p, "STR;", 4) == 0) {
+            char line[SURVEY_LINE_MAX];
+            snprintf(line, sizeof(line), "%.*s", (int)len, p);
+            char *f[SURVEY_STR_FIELDS];
+            int nf = 0;
+            for (char *tok = line; tok && nf < SURVEY_STR_FIELDS; ) {
+                f[nf++] = tok;
+                tok = strchr(tok, ';');
+                if (tok) *tok++ = '\0';
+            }
+            int dup = 0;
+            while (nf > 1 && dup < n && strcmp(v[dup].mount, f[1]) != 0) dup++;
+            if (nf >= 2 && f[1][0] && dup == n) {
+                if (n == max_mounts) {
+                    fprintf(stderr, "[ERROR] The sourcetable lists more than %d mountpoints\n",
+                            max_mounts);
+                    free(v);
+                    return -1;
+                }
+                if (n == cap) {
+                    SurveyMount *nv = (SurveyMount *)realloc(v, (size_t)cap * 2 * sizeof(SurveyMount));
+                    if (!nv) {
+                        fprintf(stderr, "[ERROR] Out of memory reading the sourcetable\n");
+                        free(v);
+                        return -1;
+                    }
+                    memset(nv + cap, 0, (size_t)cap * sizeof(SurveyMount));
+                    v   = nv;
+                    cap *= 2;
+                }
+                SurveyMount *m = &v[n++];
+                snprintf(m->mount, sizeof(m->mount), "%s", f[1]);
+                if (nf > 3) snprintf(m->format, sizeof(m->format), "%s", f[3]);
+                if (nf > 4) parse_details(m, f[4]);
+                if (nf > 6) {
+                    snprintf(m->nav, sizeof(m->nav), "%s", f[6]);
+                    m->listed_gnss = parse_nav(f[6]);
+                }
+                if (nf > 10) {
+                    m->lat = atof(f[9]);
+                    m->lon = atof(f[10]);
+                }
+                m->header_s = -1.0;
+                m->arp_km   = -1.0;
+            }
+        }
+        p = next;
+    }
+    if (n == 0) {
+        fprintf(stderr, "[ERROR] The sourcetable lists no mountpoints (STR lines)\n");
+        free(v);
+        return -1;
+    }
+    *out   = v;
+    *n_out = n;
+    return 0;
+}
+
+/* ── Checks ────────────────────────────────────────────────────────── */
+
+static int listed_index(const SurveyMount *m, int type)
+{
+    for (int i = 0; i < m->n_listed; i++)
+        if (m->listed[i] == type) return i;
+    return -1;
+}
+
+static int seen_index(const SurveyMount *m, int type)
+{
+    for (int i = 0; i < m->n_types; i++)
+        if (m->types[i] == type) return i;
+    return -1;
+}
+
+/* Whether @p type should have come in the sample: twice its listed rate,
+ * or twice SURVEY_RATE_GUESS_S for a rate not given. */
+static bool type_due(const SurveyMount *m, int type)
+{
+    int i = listed_index(m, type);
+    int rate = (i >= 0 && m->listed_s[i] > 0) ? m->listed_s[i] : SURVEY_RATE_GUESS_S;
+    return m->sample_s >= 2.0 * rate;
+}
+
+static bool type_missing(const SurveyMount *m, int i)
+{
+    return seen_index(m, m->listed[i]) < 0 && type_due(m, m->listed[i]);
+}
+
+static bool type_unlisted(const SurveyMount *m, int i)
+{
+    return m->n_listed > 0 && listed_index(m, m->types[i]) < 0;
+}
+
+void caster_survey_check(SurveyMount *m)
+{
+    m->issues = 0;
+    if (m->bytes == 0) {
+        m->issues = SURVEY_NO_STREAM;
+        return;
+    }
+    if (m->crc_errors > 0) m->issues |= SURVEY_CRC;
+    if (m->stream_format != STREAM_FMT_RTCM3) {
+        m->issues |= SURVEY_FORMAT;
+        return;                 /* no types, satellites or ARP to compare */
+    }
+
+    for (int i = 0; i < m->n_listed; i++)
+        if (type_missing(m, i)) m->issues |= SURVEY_MISSING;
+    for (int i = 0; i < m->n_types; i++)
+        if (type_unlisted(m, i)) m->issues |= SURVEY_UNLISTED;
+
+    /* SBAS is left out: tables list it for the receiver, few send it as MSM. */
+    unsigned seen = 0, sbas = 1u << 6;
+    for (int g = 1; g < SURVEY_GNSS; g++)
+        if (m->sats[g]) seen |= 1u << g;
+    if (m->listed_gnss && seen && (seen & ~sbas) != (m->listed_gnss & ~sbas))
+        m->issues |= SURVEY_GNSS_DIFF;
+
+    if (m->arp_valid) {
+        if (m->lat != 0.0 || m->lon != 0.0) {
+            double heading;
+            calc_distance_heading(m->lat, m->lon, m->arp_lat, m->arp_lon, &m->arp_km, &heading);
+            if (m->arp_km > SURVEY_ARP_FAR_KM) m->issues |= SURVEY_ARP_FAR;
+        }
+    } else if (type_due(m, 1005) || type_due(m, 1006)) {
+        m->issues |= SURVEY_NO_ARP;
+    }
+}
+
+/* ── Report ────────────────────────────────────────────────────────── */
+
+static void format_sats(const SurveyMount *m, char *buf, size_t len)
+{
+    size_t o = 0;
+    buf[0] = '\0';
+    for (int g = 1; g < SURVEY_GNSS && o < len; g++) {
+        if (!m->sats[g]) continue;
+        int w = snprintf(buf + o, len - o, "%s%c%d", o ? " " : "", k_gnss_letter[g],
+                         sat_mask_count(m->sats[g]));
+        if (w < 0) break;
+        o += (size_t)w;
+    }
+    if (!buf[0]) snprintf(buf, len, "-");
+}
+
+static void format_issues(unsigned issues, char *buf, size_t len)
+{
+    size_t o = 0;
+    buf[0] = '\0';
+    for (int b = 0; b < SURVEY_ISSUES && o < len; b++) {
+        if (!(issues & (1u << b))) continue;
+        int w = snprintf(buf + o, len - o, "%s%s", o ? "," : "", k_issue_name[b]);
+        if (w < 0) break;
+        o += (size_t)w;
+    }
+    if (!buf[0]) snprintf(buf, len, "ok");
+}
+
+/* "missing 1033, 1230; unlisted 1013" for the detail lines. */
+static void format_type_diff(const SurveyMount *m, char *buf, size_t len)
+{
+    size_t o = 0;
+    buf[0] = '\0';
+    bool first = true;
+    for (int i = 0; i < m->n_listed && o < len; i++) {
+        if (!type_missing(m, i)) continue;
+        int w = snprintf(buf + o, len - o, "%s%d", first ? "missing " : ", ", m->listed[i]);
+        if (w < 0) break;
+        o += (size_t)w;
+        first = false;
+    }
+    bool first_u = true;
+    for (int i = 0; i < m->n_types && o < len; i++) {
+        if (!type_unlisted(m, i)) continue;
+        int w = snprintf(buf + o, len - o, "%s%d",
+                         first_u ? (first ? "unlisted " : "; unlisted ") : ", ", m->types[i]);
+        if (w < 0) break;
+        o += (size_t)w;
+        first_u = false;
+    }
+}
+
+void caster_survey_report(const SurveyMount *m, int n, const char *caster,
+                          double window_s, double elapsed, FILE *out)
+{
+    static const char *rule =
+        "+------+----------------------+--------------+---------+-------+-------------------------+--------+---------+--------------------+\n";
+
+    fprintf(out, "\n[INFO] Caster survey: %d mountpoints on %s, %.0f s per mountpoint, %.0f s\n",
+            n, caster, window_s, elapsed);
+    fprintf(out, "%s", rule);
+    fprintf(out, "| %4s | %-20s | %-12s | %7s | %5s | %-23s | %6s | %7s | %-18s |\n",
+            "#", "Mountpoint", "Stream", "kbit/s", "Types", "Satellites", "ARP km",
+            "Age ms", "Issues");
+    fprintf(out, "%s", rule);
+    int streamed = 0, clean = 0;
+    int per_issue[SURVEY_ISSUES] = { 0 };
+    for (int i = 0; i < n; i++) {
+        const SurveyMount *s = &m[i];
+        const char *stream;
+        char kbps[16], types[16], sats[48], arp[16], age[16], issues[64];
+        if (s->bytes > 0) {
+            streamed++;
+            stream = stream_format_name(s->stream_format);
+            snprintf(kbps, sizeof(kbps), "%.1f",
+                     s->sample_s > 0.0 ? s->bytes * 8.0 / 1000.0 / s->sample_s : 0.0);
+            snprintf(types, sizeof(types), "%d/%d", s->n_types, s->n_listed);
+        } else {
+            stream = s->note[0] ? s->note : "no data";
+            snprintf(kbps, sizeof(kbps), "-");
+            snprintf(types, sizeof(types), "-/%d", s->n_listed);
+        }
+        format_sats(s, sats, sizeof(sats));
+        if (s->arp_km >= 0.0)  snprintf(arp, sizeof(arp), "%.1f", s->arp_km);
+        else if (s->arp_valid) snprintf(arp, sizeof(arp), "?");
+        else                   snprintf(arp, sizeof(arp), "-");
+        if (s->age_ms.count > 0) snprintf(age, sizeof(age), "%.0f", qsketch_quantile(&s->age_ms, 0.5));
+        else                     snprintf(age, sizeof(age), "-");
+        format_issues(s->issues, issues, sizeof(issues));
+        fprintf(out, "| %4d | %-20.20s | %-12.12s | %7s | %5s | %-23.23s | %6s | %7s | %-18.18s |\n",
+                i + 1, s->mount, stream, kbps, types, sats, arp, age, issues);
+        if (!s->issues) clean++;
+        for (int b = 0; b < SURVEY_ISSUES; b++)
+            if (s->issues & (1u << b)) per_issue[b]++;
+    }
+    fprintf(out, "%s", rule);
+
+    /* What the short columns cut off: failure reasons and type lists. */
+    for (int i = 0; i < n; i++) {
+        const SurveyMount *s = &m[i];
+        char diff[512];
+        if (s->issues & SURVEY_NO_STREAM) {
+            fprintf(out, "  %-20s %s\n", s->mount, s->note[0] ? s->note : "no data");
+            continue;
+        }
+        if (s->issues & (SURVEY_MISSING | SURVEY_UNLISTED)) {
+            format_type_diff(s, diff, sizeof(diff));
+            fprintf(out, "  %-20s %s\n", s->mount, diff);
+        }
+        if (s->issues & SURVEY_GNSS_DIFF) {
+            char sats[48];
+            format_sats(s, sats, sizeof(sats));
+            fprintf(out, "  %-20s listed %s, seen %s\n", s->mount, s->nav, sats);
+        }
+        if (s->issues & SURVEY_ARP_FAR)
+            fprintf(out, "  %-20s station %d at %.5f, %.5f is %.1f km from the listed %.5f, %.5f\n",
+                    s->mount, s->station, s->arp_lat, s->arp_lon, s->arp_km, s->lat, s->lon);
+    }
+
+    fprintf(out, "[INFO] %d of %d mountpoints streamed, %d without issues", streamed, n, clean);
+    bool any = false;
+    for (int b = 0; b < SURVEY_ISSUES; b++) {
+        if (!per_issue[b]) continue;
+        fprintf(out, "%s%d %s", any ? ", " : "; ", per_issue[b], k_issue_name[b]);
+        any = true;
+    }
+    fprintf(out, "\n");
+}
+
+/* ── JSON ──────────────────────────────────────────────────────────── */
+
+static double round3(double x)
+{
+    return floor(x * 1000.0 + 0.5) / 1000.0;
+}
+
+static cJSON *survey_mount_json(const SurveyMount *s)
+{
+    cJSON *o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "mountpoint", s->mount);
+
+    cJSON *str = cJSON_AddObjectToObject(o, "sourcetable");
+    cJSON_AddStringToObject(str, "format", s->format);
+    cJSON_AddStringToObject(str, "nav_system", s->nav);
+    cJSON_AddNumberToObject(str, "latitude", s->lat);
+    cJSON_AddNumberToObject(str, "longitude", s->lon);
+    cJSON *listed = cJSON_AddArrayToObject(str, "messages");
+    for (int i = 0; i < s->n_listed; i++) {
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddNumberToObject(t, "type", s->listed[i]);
+        if (s->listed_s[i] > 0) cJSON_AddNumberToObject(t, "rate_s", s->listed_s[i]);
+        cJSON_AddItemToArray(listed, t);
+    }
+
+    cJSON_AddBoolToObject(o, "streamed", s->bytes > 0);
+    cJSON_AddStringToObject(o, "note", s->note);
+    if (s->header_s >= 0.0) cJSON_AddNumberToObject(o, "header_s", round3(s->header_s));
+    cJSON_AddNumberToObject(o, "sample_s", round3(s->sample_s));
+    cJSON_AddNumberToObject(o, "bytes", (double)s->bytes);
+    cJSON_AddNumberToObject(o, "frames", (double)s->frames);
+    cJSON_AddNumberToObject(o, "crc_errors", (double)s->crc_errors);
+    if (s->bytes > 0) cJSON_AddStringToObject(o, "stream_format", stream_format_name(s->stream_format));
+
+    cJSON *types = cJSON_AddArrayToObject(o, "messages");
+    for (int i = 0; i < s->n_types; i++) {
+        cJSON *t = cJSON_CreateObject();
+        cJSON_AddNumberToObject(t, "type", s->types[i]);
+        cJSON_AddNumberToObject(t, "count", s->counts[i]);
+        if (s->interval_s[i] > 0.0) cJSON_AddNumberToObject(t, "interval_s", round3(s->interval_s[i]));
+        cJSON_AddBoolToObject(t, "listed", listed_index(s, s->types[i]) >= 0);
+        cJSON_AddItemToArray(types, t);
+    }
+    cJSON *missing = cJSON_AddArrayToObject(o, "missing");
+    for (int i = 0; i < s->n_listed; i++)
+        if (s->bytes > 0 && type_missing(s, i))
+            cJSON_AddItemToArray(missing, cJSON_CreateNumber(s->listed[i]));
+
+    cJSON *sats = cJSON_AddObjectToObject(o, "satellites");
+    for (int g = 1; g < SURVEY_GNSS; g++)
+        if (s->sats[g]) cJSON_AddNumberToObject(sats, gnss_name_from_id(g), sat_mask_count(s->sats[g]));
+
+    if (s->arp_valid) {
+        cJSON *arp = cJSON_AddObjectToObject(o, "arp");
+        cJSON_AddNumberToObject(arp, "station", s->station);
+        cJSON_AddNumberToObject(arp, "latitude", s->arp_lat);
+        cJSON_AddNumberToObject(arp, "longitude", s->arp_lon);
+        cJSON_AddNumberToObject(arp, "height", round3(s->arp_alt));
+        if (s->arp_km >= 0.0) cJSON_AddNumberToObject(arp, "distance_km", round3(s->arp_km));
+    } else {
+        cJSON_AddNullToObject(o, "arp");
+    }
+
+    if (s->age_ms.count > 0) {
+        cJSON *age = cJSON_AddObjectToObject(o, "age_ms");
+        cJSON_AddNumberToObject(age, "p50", round3(qsketch_quantile(&s->age_ms, 0.5)));
+        cJSON_AddNumberToObject(age, "p95", round3(qsketch_quantile(&s->age_ms, 0.95)));
+        cJSON_AddNumberToObject(age, "max", round3(s->age_ms.max));
+    }
+
+    cJSON *issues = cJSON_AddArrayToObject(o, "issues");
+    for (int b = 0; b < SURVEY_ISSUES; b++)
+        if (s->issues & (1u << b)) cJSON_AddItemToArray(issues, cJSON_CreateString(k_issue_name[b]));
+    return o;
+}
+
+int caster_survey_write_json(const SurveyMount *m, int n, const char *caster,
+                             double window_s, const char *path)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "caster", caster);
+    cJSON_AddNumberToObject(root, "window_s", window_s);
+    int per_issue[SURVEY_ISSUES] = { 0 };
+    cJSON *jm = cJSON_AddArrayToObject(root, "mountpoints");
+    for (int i = 0; i < n; i++) {
+        cJSON_AddItemToArray(jm, survey_mount_json(&m[i]));
+        for (int b = 0; b < SURVEY_ISSUES; b++)
+            if (m[i].issues & (1u << b)) per_issue[b]++;
+    }
+    cJSON *ji = cJSON_AddObjectToObject(root, "issues");
+    for (int b = 0; b < SURVEY_ISSUES; b++)
+        cJSON_AddNumberToObject(ji, k_issue_name[b], per_issue[b]);
+
+    char *text = cJSON_Print(root);
+    cJSON_Delete(root);
+    FILE *f = text ? fopen(path, "w") : NULL;
+    int rc = 0;
+    if (!f) {
+        rc = -1;
+    } else {
+        fputs(text, f);
+        fputc('\n', f);
+        if (fclose(f) != 0) rc = -1;
+    }
+    free(text);
+    if (rc != 0) fprintf(stderr, "[ERROR] Could not write %s\n", path);
+    return rc;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file caster_survey.h
+ * @brief Caster survey: every mountpoint of a sourcetable, sampled at once.
+ *
+ * A sourcetable STR line is a claim: a format, the message types and
+ * their rates, the GNSS carried and the position of the station.  How
+ * many of those claims hold shows only in the stream itself, and running
+ * -t and -s on each mountpoint in turn takes an afternoon for a caster of
+ * a few hundred.  `--survey` opens them on the --mounts-file event loop
+ * (ntrip_multi_survey()), at most --jobs at a time, samples each for a
+ * fixed window and compares what came with what was listed:
+ *
+ *   - the message types and their mean interval, the counts -t makes,
+ *   - the satellites per GNSS seen in the MSM headers, as -s does,
+ *   - the station ARP of 1005 / 1006 against the STR position,
+ *   - the age of corrections and the CRC error count.
+ *
+ * caster_survey_parse() turns the sourcetable into the list of
+ * mountpoints, caster_survey_report() prints one row per mountpoint and
+ * the totals per issue, caster_survey_write_json() saves it all.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef CASTER_SURVEY_H
+#define CASTER_SURVEY_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "quantile_sketch.h"
+#include "sat_vis.h"
+#include "stream_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Message types kept per mountpoint, listed and seen. */
+#define SURVEY_TYPES           32
+
+/** @brief Satellite masks per mountpoint, GNSS ID 0..7 as in the RTCM registry. */
+#define SURVEY_GNSS            8
+
+/** @brief Sample window (s) per mountpoint when --survey has no value. */
+#define SURVEY_DEFAULT_WINDOW  30
+
+/** @brief Sessions in flight when --jobs is not given. */
+#define SURVEY_DEFAULT_JOBS    32
+
+/** @brief Assumed rate (s) of a type whose STR line gives none. */
+#define SURVEY_RATE_GUESS_S    10
+
+/** @brief An ARP further than this from the STR position is flagged. */
+#define SURVEY_ARP_FAR_KM      10.0
+
+/** @brief Issues found on a mountpoint, bits of SurveyMount::issues. */
+enum {
+    SURVEY_NO_STREAM   = 1u << 0,   /**< No data: DNS, connect, HTTP status, ... */
+    SURVEY_NO_ARP      = 1u << 1,   /**< Streamed, but no 1005 / 1006 in the window */
+    SURVEY_ARP_FAR     = 1u << 2,   /**< ARP more than SURVEY_ARP_FAR_KM from the STR position */
+    SURVEY_MISSING     = 1u << 3,   /**< A listed type was not seen in twice its rate */
+    SURVEY_UNLISTED    = 1u << 4,   /**< A type was seen that the STR line does not list */
+    SURVEY_GNSS_DIFF   = 1u << 5,   /**< GNSS seen in MSM differ from the STR nav systems */
+    SURVEY_CRC         = 1u << 6,   /**< Frames failed their checksum */
+    SURVEY_FORMAT      = 1u << 7    /**< The stream is not RTCM 3 */
+};
+
+/** @brief Number of SURVEY_* issue bits. */
+#define SURVEY_ISSUES          8
+
+/** @brief One mountpoint: what the sourcetable says and what came. */
+typedef struct {
+    /* The STR line */
+    char               mount[64];
+    char               format[32];
+    char               nav[48];
+    double             lat, lon;        /**< STR position; 0, 0 = none */
+    int                n_listed;
+    int                listed[SURVEY_TYPES];
+    int                listed_s[SURVEY_TYPES];  /**< Rate in brackets, s; 0 = not given */
+    unsigned           listed_gnss;     /**< Bit per GNSS ID named in nav; 0 = none parsed */
+
+    /* The sample */
+    bool               streamed;        /**< The caster answered with a stream */
+    char               note[96];        /**< Failure or end reason */
+    double             header_s;        /**< Request to response header; < 0 = none */
+    double             sample_s;        /**< Header to last byte */
+    unsigned long long bytes;
+    unsigned long      frames;
+    unsigned long      crc_errors;
+    StreamFormat       stream_format;   /**< As sniffed by the framer */
+    int                n_types;         /**< Types seen, by type number */
+    int                types[SURVEY_TYPES];
+    unsigned           counts[SURVEY_TYPES];
+    double             interval_s[SURVEY_TYPES];    /**< Mean; 0 = seen once */
+    SatMask            sats[SURVEY_GNSS];           /**< Satellites seen in MSM headers */
+    bool               arp_valid;
+    int                station;         /**< DF003 of the last ARP */
+    double             arp_lat, arp_lon, arp_alt;
+    double             arp_km;          /**< ARP to STR position; < 0 = no STR position */
+    QSketch            age_ms;          /**< Age of corrections of every MSM frame */
+    unsigned           issues;          /**< SURVEY_* bits, set by caster_survey_check() */
+} SurveyMount;
+
+/**
+ * @brief Read the STR lines of @p table into one SurveyMount each.
+ *
+ * At most @p max_mounts are accepted; a mountpoint listed twice is
+ * surveyed once.
+ *
+ * @param out   [out] calloc()ed array of @p n_out mountpoints (free() it).
+ * @return 0 on success, -1 (message on stderr) if the table lists no STR or
+ *         more than @p max_mounts mountpoints.
+ */
+int caster_survey_parse(const char *table, int max_mounts, SurveyMount **out, int *n_out);
+
+/** @brief Compare the sample of @p m with its STR line and set @c issues. */
+void caster_survey_check(SurveyMount *m);
+
+/**
+ * @brief Print one row per mountpoint, the types listed but missing and
+ *        seen but unlisted, and the number of mountpoints per issue.
+ */
+void caster_survey_report(const SurveyMount *m, int n, const char *caster,
+                          double window_s, double elapsed, FILE *out);
+
+/**
+ * @brief Write every mountpoint with its STR claims, its sample and its
+ *        issues as JSON.
+ *
+ * @return 0 on success, -1 if @p path cannot be written.
+ */
+int caster_survey_write_json(const SurveyMount *m, int n, const char *caster,
+                             double window_s, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CASTER_SURVEY_H */
@@ -1,4 +1,5 @@
 #include "cli_help.h"
+#include "anomaly_ring.h"
 #include "config.h"
 #include <stdbool.h>
 #include <stdio.h>
@@ -25,27 +26,231 @@ void print_help(const char *progname) {
     printf("  -c, --config [file]      Specify config file (default: config.json)\n");
     printf("  -m, --mounts             Show mountpoint list (sourcetable)\n");
     printf("  -r, --raw                Show mountpoint list in raw format (use with -m)\n");
-    printf("  -d, --decode [types]     Start NTRIP stream (optionally filter message types, comma-separated)\n");
+    printf("      --nearest [K]        List the K mountpoints nearest to LATITUDE/LONGITUDE\n");
+    printf("                           (or --lat/--lon), nearest first (default: 10).\n");
+    printf("      --radius <km>        Only list --nearest mountpoints within <km>.\n");
+    printf("      --table-ttl <sec>    Reuse a cached sourcetable for <sec> seconds, then\n");
+    printf("                           revalidate it (overrides SOURCETABLE_TTL; 0 = off).\n");
+    printf("      --crawl <file>       Fetch the sourcetables of every caster in a JSON file,\n");
+    printf("                           --jobs at a time (default: 8), and write them merged\n");
+    printf("                           and deduplicated as JSON to -o (default: stdout).\n");
+    printf("      --timeout <sec>      Time limit per caster for --crawl (default: 15, or\n");
+    printf("                           SOURCETABLE_TIMEOUT from the config).\n");
+    printf("  -d, --decode [filter]    Start NTRIP stream (optionally filter message types, comma-separated)\n");
+    printf("                           Filter terms: 1077, 1070-1139, msm, msm1..msm7, eph,\n");
+    printf("                           station, obs, all; \"/N\" keeps 1 in N (1077/10).\n");
     printf("  -s, --sat [seconds]      Analyze unique satellites for N seconds (default: 60)\n");
     printf("  -t, --time [seconds]     Analyze message types for N seconds (default: 60)\n");
     printf("  -S, --sky                Sky-heatmap mode: collect obs + ephemerides until\n");
     printf("                           Ctrl-C, then save YYYYMMDDHHmmss_ARP-EPG.png.\n");
     printf("                           Requires either an EPH_CASTER block in the config\n");
-    printf("                           file, or -R / --RINEX.\n");
+    printf("                           file, -R / --RINEX, or --eph-shm.\n");
     printf("  -R, --RINEX <file>       RINEX 3 NAV file to preload ephemerides from before\n");
-    printf("                           the live EPH stream takes over (use with -S/--sky).\n");
-    printf("      --duration <sec>     Auto-stop --sky mode after N seconds and save normally.\n");
+    printf("                           the live EPH stream takes over (use with -S/--sky),\n");
+    printf("                           or to build the --simulate stream from.\n");
+    printf("                           Parsed records are cached in <file>.ephc.\n");
+    printf("      --eph-shm <name>     Keep the --sky ephemerides in shared memory segment\n");
+    printf("                           <name>: the first process with an ephemeris source\n");
+    printf("                           feeds it, every other one only reads it and opens\n");
+    printf("                           no EPH stream; it takes over if the feeder exits.\n");
+    printf("      --eph-feed <name>    Only feed segment <name> from the EPH_* stream (and\n");
+    printf("                           -R) for --sky --eph-shm processes, until Ctrl-C\n");
+    printf("                           or --duration.\n");
+    printf("      --eph-cache <file>   Keep the --sky / --eph-feed ephemerides in <file>:\n");
+    printf("                           loaded at the start (the versions still valid),\n");
+    printf("                           rewritten every 60 s and at the end, so a restart\n");
+    printf("                           needs no re-broadcast before the sky is covered.\n");
+    printf("                           --sky-expected only reads it, every version.\n");
+    printf("      --mounts-file <file> Monitor every mountpoint listed in a JSON file over one\n");
+    printf("                           event loop (epoll / WSAPoll); prints per-stream bytes,\n");
+    printf("                           frames, CRC errors and message types on exit, and\n");
+    printf("                           interval p50 .. p99.9 per type over all streams.\n");
+    printf("                           With -S/--sky: one heatmap per station, written as\n");
+    printf("                           <ts>_<MOUNT>_ARP-EPG.png into the -o directory.\n");
+    printf("      --shards <n|auto>    --mounts-file: spread the streams over n event loops\n");
+    printf("                           on as many threads (auto: one per core); streams\n");
+    printf("                           move to the least busy loop every 30 s as needed.\n");
+    printf("                           Not with --sky or --push.\n");
+    printf("      --pin-cores          With --shards: keep each loop thread on its own core.\n");
+    printf("      --compare[=<s>]      --mounts-file: compare the 2..8 streams with the first\n");
+    printf("                           one epoch by epoch (MSM epochs aligned by GNSS time):\n");
+    printf("                           missing epochs and satellites, CNR per signal and\n");
+    printf("                           arrival time.  One line per stream every <s> s\n");
+    printf("                           (default 10), totals on exit.\n");
+    printf("      --compare-window <ms>\n");
+    printf("                           How long an epoch waits for the streams that lack it\n");
+    printf("                           (default 2000).\n");
+    printf("      --anomaly-dump <file>\n");
+    printf("                           --mounts-file: keep the last %d CRC failures and sync\n", ANOMALY_RING_SLOTS);
+    printf("                           losses of every stream with the raw bytes around them\n");
+    printf("                           and append them to <file> on SIGUSR1 and on exit\n");
+    printf("                           (and serve them at /anomalies with --metrics-listen).\n");
+    printf("      --relay [addr:]port  Local caster: hold one upstream connection per\n");
+    printf("                           mountpoint (MOUNTPOINT, or all of --mounts-file) and\n");
+    printf("                           re-serve it to any number of local NTRIP clients.\n");
+    printf("      --push <host:port>   Send a summary of the --mounts-file streams (totals,\n");
+    printf("                           interval sketches, satellites; with --sky the sector\n");
+    printf("                           grids) to a --collect host every 10 s.\n");
+    printf("      --node <name>        Node name for --push (default: the host name).\n");
+    printf("      --collect [addr:]port\n");
+    printf("                           Receive the --push summaries of any number of nodes\n");
+    printf("                           and print the merged fleet view every 60 s; with -o,\n");
+    printf("                           write the merged grids as DIR/<MOUNT>.sky.\n");
+    printf("      --load-test <n>      Load-test the caster: n client sessions on one event\n");
+    printf("                           loop, spread over MOUNTPOINT or the --mounts-file\n");
+    printf("                           list; streams are framed and CRC-checked only.\n");
+    printf("                           Prints connect, header, first-byte and correction\n");
+    printf("                           age p50 .. p99 and the throughput per mountpoint.\n");
+    printf("      --load-ramp <spec>   How sessions start: instant (default), linear:SECONDS\n");
+    printf("                           or step:COUNT/SECONDS, e.g. step:50/5.\n");
+    printf("      --vrs-probe <spec>   Probe MOUNTPOINT from many GGA positions at once, one\n");
+    printf("                           session each: grid:S,W,N,E/STEP_KM, grid:RADIUS_KM/\n");
+    printf("                           STEP_KM around LATITUDE/LONGITUDE, or a track file\n");
+    printf("                           (LAT,LON or NMEA GGA lines).  Reports the ARP served,\n");
+    printf("                           the switch time after the GGA moves from LATITUDE/\n");
+    printf("                           LONGITUDE and the message mix per position, and a\n");
+    printf("                           coverage map; -o saves it as GeoJSON.  Opens ten\n");
+    printf("                           sessions a second unless --load-ramp is given.\n");
+    printf("      --survey [sec]       Sample every mountpoint of the sourcetable for sec\n");
+    printf("                           seconds (default 30), --jobs at a time (default 32),\n");
+    printf("                           and check each against its STR line: message types\n");
+    printf("                           and rates, GNSS, ARP vs. position, CRC errors, age\n");
+    printf("                           of corrections.  -o saves the report as JSON.\n");
+    printf("      --metrics-listen [addr]:port\n");
+    printf("                           Serve Prometheus / OpenMetrics on GET /metrics while\n");
+    printf("                           --mounts-file or --relay runs: per-mountpoint bytes,\n");
+    printf("                           frames per type, CRC, resyncs, reconnects, satellites,\n");
+    printf("                           interval quantiles, queue depth, cycle slips, gaps\n");
+    printf("                           and CNR drops per signal (add --perf for the stage\n");
+    printf("                           latency).\n");
+    printf("      --rollups            With --metrics-listen: keep per-mountpoint history at\n");
+    printf("                           1 s (1 h), 1 min (1 day) and 15 min (30 days) in fixed\n");
+    printf("                           rings, served as JSON on GET /rollup.\n");
+    printf("      --simulate <out>     Generate a synthetic RTCM 3 stream (MSM, 1006 and\n");
+    printf("                           ephemerides of the satellites in view of LATITUDE /\n");
+    printf("                           LONGITUDE) to a file, \"-\" (stdout) or [addr]:port,\n");
+    printf("                           where it is served as MOUNTPOINT (default SIM) to\n");
+    printf("                           NTRIP clients.  Orbits from -R, else nominal ones.\n");
+    printf("      --sim-gnss <list>    Constellations: GPS,GLO,GAL,BDS,QZSS,NAVIC or GRECJI\n");
+    printf("                           (default GPS,GLO,GAL,BDS).\n");
+    printf("      --sim-msm 4|5|7      MSM subtype (default 7).\n");
+    printf("      --sim-rate <hz>      Epochs per second of stream time (default 1).\n");
+    printf("      --sim-speed max|Nx   Stream seconds per second (default: 1 to a port,\n");
+    printf("                           max to a file).\n");
+    printf("      --sim-errors <spec>  Inject errors per frame: crc=P,cut=P,junk=P,drop=P\n");
+    printf("                           (probabilities, or percentages such as 1%%).\n");
+    printf("      --sim-seed <n>       Seed for noise and injected errors (default 1).\n");
+    printf("      --duration <sec>     Auto-stop --sky, --mounts-file, --relay, --load-test or\n");
+    printf("                           --survey\n");
+    printf("                           after N seconds\n");
+    printf("                           (--simulate: N seconds of stream time;\n");
+    printf("                           --sky saves normally).\n");
     printf("                           Useful for unattended / cron usage.\n");
     printf("  -o, --output <path>      Write the --sky PNG to this path instead of the default\n");
-    printf("                           timestamped name (overwrites if it exists).\n");
+    printf("                           timestamped name (overwrites if it exists; a .svg\n");
+    printf("                           path writes a vector heatmap instead), or the\n");
+    printf("                           --vrs-probe GeoJSON coverage map, or the --survey\n");
+    printf("                           JSON report.\n");
+    printf("      --no-reconnect       End -d/-s/-t/--sky when the caster drops the connection\n");
+    printf("                           instead of re-opening it with backoff (the default;\n");
+    printf("                           RECONNECT_DELAY_MAX caps the wait, default 60 s).\n");
+    printf("      --watch-config       Reload the config (and --mounts-file) when it\n");
+    printf("                           changes, as SIGHUP always does in --sky and\n");
+    printf("                           --mounts-file: only streams whose settings changed\n");
+    printf("                           are re-opened; stats and heatmaps carry on.\n");
+    printf("      --perf               Time every frame through receive, framing/CRC, decode,\n");
+    printf("                           sky update and output; print per-stage latency\n");
+    printf("                           percentiles on exit (-d, -t, --sky, --mounts-file).\n");
+    printf("      --live[=HZ]          With -t or -s: redraw a dashboard of message types,\n");
+    printf("                           satellites and correction age HZ times a second\n");
+    printf("                           (default 2) instead of a token per frame; only the\n");
+    printf("                           changed cells are written.  Needs a terminal.\n");
     printf("      --no-progress        Never print the per-second status line in --sky mode.\n");
     printf("                           (Useful when -q is not enough.)\n");
     printf("      --json               Emit per-tick status as one JSON object per line on\n");
     printf("                           stderr instead of the human-readable line; final\n");
     printf("                           {\"event\":\"stop\",\"reason\":...,\"saved\":...} on exit.\n");
+    printf("      --json-fd <target>   Send the --json events to file descriptor N (e.g. 3,\n");
+    printf("                           with 3>events.json) or a TCP host:port instead of\n");
+    printf("                           stderr.  Implies --json.\n");
+    printf("      --json-binary        Events as a u32 big-endian length plus one\n");
+    printf("                           MessagePack map each.  Implies --json.\n");
+    printf("      --json-flush <ms>    Buffer events and write them every <ms>, or with\n");
+    printf("                           <ms>,<size> also once <size> (bytes, k, M; default\n");
+    printf("                           64k) is buffered.  Default: each event at once.\n");
     printf("      --rtcm-stdin         Read obs RTCM bytes from stdin instead of opening\n");
     printf("                           the NTRIP socket.  Auto-stops at EOF.  Lets you do\n");
     printf("                           offline replay:  --sky --rtcm-stdin -R nav.rnx <cap.rtcm3\n");
+    printf("      --replay <file>      Like --rtcm-stdin, but memory-maps the capture and\n");
+    printf("                           indexes its frames (index cached in <file>.rtidx).\n");
+    printf("                           Also reads native .nacap captures (see --record).\n");
+    printf("      --replay-start <t>   Start --replay at <t> seconds into the capture (MSM\n");
+    printf("                           time; receive time for .nacap), or at frame \"#N\".\n");
+    printf("      --replay-seek <t>    Like --replay-start, but with the sky state of a\n");
+    printf("                           replay up to <t>: restored from the keyframes a\n");
+    printf("                           replay from the start saves every 10 min of stream\n");
+    printf("                           time (in <file>.rtkey), then replayed from there.\n");
+    printf("      --replay-speed <s>   Pace --replay at <s> x the capture's time, e.g.\n");
+    printf("                           10x; \"max\" (default) runs at disk speed.  Stats and\n");
+    printf("                           sky positions follow the capture's time either way.\n");
+    printf("      --replay-dir <dir>   Batch --replay: replay every capture in <dir> (.rtcm3,\n");
+    printf("                           .rtcm, .nacap) in parallel, one heatmap per capture\n");
+    printf("                           plus aggregate_ARP-EPG.png, and print a table of\n");
+    printf("                           all captures and their merged message intervals.\n");
+    printf("                           Needs -R; -o names the output dir.\n");
+    printf("                           Captures run with the config file and environment\n");
+    printf("                           only, not other CLI overrides.\n");
+    printf("      --jobs <N>           Captures in flight for --replay-dir (default: one\n");
+    printf("                           per CPU core), casters for --crawl, mountpoints\n");
+    printf("                           for --survey, or threads\n");
+    printf("                           for --merge, --sky-expected and the --sky / --merge\n");
+    printf("                           PNGs.\n");
+    printf("      --checkpoint <file>  Save the --sky sector grid to a .sky file every 60 s\n");
+    printf("                           and at the end, so a crash loses at most a minute.\n");
+    printf("      --resume <file>      Start --sky from the grid in a .sky file (if it\n");
+    printf("                           exists) and keep checkpointing to it.\n");
+    printf("      --snapshot-interval <s>\n");
+    printf("                           Rewrite the --sky PNG(s) every <s> seconds while\n");
+    printf("                           collecting, on a thread of its own; each file is\n");
+    printf("                           replaced in one rename, for live dashboards.\n");
+    printf("      --sky-expected <t>   Compute the expected counts of a --sky grid without a\n");
+    printf("                           stream, from -R and/or --eph-cache: every epoch from\n");
+    printf("                           UTC time <t> (\"now\" or YYYY-MM-DDTHH:MM:SS) for\n");
+    printf("                           --duration (default 86400 s), on --jobs threads.\n");
+    printf("                           Writes -o <file>.sky (default <ts>_<MOUNT>_expected.sky),\n");
+    printf("                           or with --mounts-file -o DIR/<MOUNT>_expected.sky.\n");
+    printf("      --epoch-interval <s> Epoch step of --sky-expected (default 1).\n");
+    printf("      --expected <file>    Take --sky's expected counts from a --sky-expected\n");
+    printf("                           grid and count only the observed SVs.\n");
+    printf("      --merge <a.sky> ...  Add up .sky grids into one: -o <file>.sky (default\n");
+    printf("                           <ts>_merged.sky) or -o <file>.png / .svg to render it.\n");
+    printf("      --png-sizes <list>   Heatmap sizes for --sky and --merge -o <file>.png,\n");
+    printf("                           e.g. 800,256 or 1024x768,320x240 (default 800).  The\n");
+    printf("                           first is the named file, the others add _<W>x<H>.\n");
+    printf("      --record <file>      Also write the stream of -t, -d, -s or --sky to a\n");
+    printf("                           native capture (.nacap): every frame with its\n");
+    printf("                           receive time, plus a sparse index for seeking.\n");
+    printf("                           Any other extension writes the raw frames.  Disk\n");
+    printf("                           writes run on a background thread.\n");
+    printf("      --record-rotate <N>  Start a new --record file every N bytes (500k, 100M,\n");
+    printf("                           2G) or N seconds/minutes/hours (90s, 15m, 1h);\n");
+    printf("                           files get _0001, _0002, ... suffixes.\n");
+    printf("      --compress           Write --record or --convert .nacap output in\n");
+    printf("                           independently compressed blocks (LZ, no deps).\n");
+    printf("                           --convert a.nacap -o b.nacap [--compress] packs or\n");
+    printf("                           unpacks an existing native capture.\n");
+    printf("      --convert <file>     Convert a capture: .nacap -> raw RTCM, raw -> .nacap\n");
+    printf("                           (timestamps from MSM epochs).  Output: -o <path>,\n");
+    printf("                           default the input name with the other extension.\n");
+    printf("                           -o <file>.obs / .rnx / .YYo writes RINEX OBS,\n");
+    printf("                           -o <file>.nacol a columnar export.\n");
+    printf("      --rinex-obs <file>   Also write the MSM observations of -t, -d, -s or\n");
+    printf("                           --sky (live, --replay or --rtcm-stdin) as RINEX 3.04\n");
+    printf("                           OBS, one epoch as soon as it is complete, on a\n");
+    printf("                           background thread.\n");
+    printf("      --export <file>      Also write every decoded MSM cell and ephemeris of\n");
+    printf("                           -t, -d, -s or --sky as a columnar .nacol file (layout\n");
+    printf("                           in src/obs_columns.h), encoded on a background thread.\n");
     printf("  -q, --quiet              Suppress informational chatter.  Errors still go to\n");
     printf("                           stderr; the saved PNG path is still printed to stdout.\n");
     printf("  -v, --verbose            Verbose output (overrides decoder mute in --sky mode).\n");
@@ -72,7 +277,10 @@ void print_help(const char *progname) {
     printf("\nExamples:\n");
     printf("  %s -m                            Show mountpoint list\n", progname);
     printf("  %s -m -r                         Show mountpoint list in raw format\n", progname);
+    printf("  %s --nearest=5 --lat 52.1 --lon 5.2 --radius 50\n", progname);
+    printf("                                   Five closest bases within 50 km.\n");
     printf("  %s -d 1004,1012                  Start stream, filter for types 1004 and 1012\n", progname);
+    printf("  %s -d eph,msm7/10                Ephemerides, and 1 in 10 of each MSM7 type\n", progname);
     printf("  %s -s 120                        Analyze satellites for 120 seconds\n", progname);
     printf("  %s -S                            Collect sky-heatmap, save PNG on Ctrl-C\n", progname);
     printf("  %s -S -R brdc.rnx                ... with a RINEX preload\n", progname);
@@ -80,6 +288,49 @@ void print_help(const char *progname) {
     printf("  %s -S --duration 300 -o sky.png -q\n", progname);
     printf("                                   5-min unattended capture; script-friendly.\n");
     printf("                                   Stdout will contain only 'sky.png'.\n");
+    printf("  %s -S --duration 86400 --checkpoint day1.sky -q\n", progname);
+    printf("  %s --merge day*.sky -o week.png\n", progname);
+    printf("                                   Checkpoint daily; one heatmap of the week.\n");
+    printf("  %s --sky-expected 2026-10-14T00:00:00 -R brdc.rnx -o base.sky\n", progname);
+    printf("  %s -S --duration 86400 --expected base.sky -R brdc.rnx\n", progname);
+    printf("                                   Baseline of the day first, then observe.\n");
+    printf("  %s -S --mounts-file list.json -o maps/ --png-sizes 800,256\n", progname);
+    printf("                                   Heatmap and thumbnail of every station.\n");
+    printf("  %s -t 3600 --rinex-obs site.obs --record site.nacap\n", progname);
+    printf("                                   One hour as RINEX OBS and as a capture.\n");
+    printf("  %s -t 86400 --export site.nacol\n", progname);
+    printf("                                   A day of observations for analytics.\n");
+    printf("  %s --crawl casters.json --jobs 16 -o inventory.json\n", progname);
+    printf("                                   Merged mountpoint inventory of many casters.\n");
+    printf("  %s --mounts-file list.json --duration 600\n", progname);
+    printf("                                   Watch many mountpoints for 10 min, one process.\n");
+    printf("  %s --sky --mounts-file list.json --duration 3600 -o heatmaps\n", progname);
+    printf("                                   One sky heatmap per station of the network.\n");
+    printf("  %s --relay 2101 --mounts-file list.json\n", progname);
+    printf("                                   One caster login per mountpoint for the whole site.\n");
+    printf("  %s --collect 7700 -o fleet       One view of every node started with --push.\n", progname);
+    printf("  %s --mounts-file list.json --push central:7700 --node site-a\n", progname);
+    printf("                                   Node of the fleet: summaries only, no raw RTCM.\n");
+    printf("  %s --simulate 127.0.0.1:2102 --sim-speed 100x --sim-rate 10\n", progname);
+    printf("                                   Local caster with a 10 Hz stream at 100x real time.\n");
+    printf("  %s --simulate bad.rtcm3 --duration 3600 --sim-errors crc=1%%,cut=0.5%%\n", progname);
+    printf("                                   One hour of damaged stream for framer tests.\n");
+    printf("  %s --load-test 500 --load-ramp linear:60 --duration 300\n", progname);
+    printf("                                   500 clients on MOUNTPOINT, one more every 0.12 s.\n");
+    printf("  %s --vrs-probe grid:20/5 -o vrs.geojson\n", progname);
+    printf("                                   Which station serves each 5 km cell within 20 km.\n");
+    printf("  %s --survey=60 --jobs 64 -o survey.json\n", progname);
+    printf("                                   Check every mountpoint of the caster, 1 min each.\n");
+    printf("  %s --mounts-file list.json --metrics-listen :9464\n", progname);
+    printf("                                   Long-running monitor scraped by Prometheus.\n");
+    printf("  %s --mounts-file list.json --shards auto --pin-cores\n", progname);
+    printf("                                   A thousand mountpoints on every core of the host.\n");
+    printf("  %s --mounts-file pair.json --compare=30\n", progname);
+    printf("                                   Backup base station against the primary, live.\n");
+    printf("  %s --mounts-file list.json --anomaly-dump link.txt\n", progname);
+    printf("                                   Keep the bytes around every sync loss; kill -USR1 dumps.\n");
+    printf("  %s -t 60 --perf                  Message types plus per-stage latency (p50..p99.9).\n", progname);
+    printf("  %s -t 3600 --live                An hour of message types on a live dashboard.\n", progname);
     printf("  %s --check-config                Dry-run config validation (DNS, fields).\n", progname);
     printf("  %s --caster a.b.c -m -q          List mountpoints from a one-off caster.\n", progname);
     printf("  NTRIP_PASSWORD=$SECRET %s -m     Credentials via env, no config file edit.\n", progname);
@@ -201,6 +452,45 @@ void print_verbose_config(
         case OP_SKY_HEATMAP:
             fprintf(stderr, "Sky-heatmap collection (Ctrl-C to save PNG)\n");
             break;
+        case OP_MULTI_MONITOR:
+            fprintf(stderr, "Multi-mountpoint monitor (--mounts-file)\n");
+            break;
+        case OP_CONVERT_CAPTURE:
+            fprintf(stderr, "Convert capture file (--convert)\n");
+            break;
+        case OP_NEAREST_MOUNTS:
+            fprintf(stderr, "List nearest mountpoints (--nearest)\n");
+            break;
+        case OP_CRAWL_SOURCETABLES:
+            fprintf(stderr, "Crawl caster sourcetables (--crawl)\n");
+            break;
+        case OP_RELAY:
+            fprintf(stderr, "Local caster / relay (--relay)\n");
+            break;
+        case OP_SIMULATE:
+            fprintf(stderr, "Synthetic stream (--simulate)\n");
+            break;
+        case OP_LOAD_TEST:
+            fprintf(stderr, "Caster load test (--load-test)\n");
+            break;
+        case OP_VRS_PROBE:
+            fprintf(stderr, "VRS coverage probe (--vrs-probe)\n");
+            break;
+        case OP_SKY_MERGE:
+            fprintf(stderr, "Merge sky-heatmap grids (--merge)\n");
+            break;
+        case OP_EPH_FEED:
+            fprintf(stderr, "Feed shared ephemerides (--eph-feed)\n");
+            break;
+        case OP_FLEET_COLLECT:
+            fprintf(stderr, "Collect node summaries (--collect)\n");
+            break;
+        case OP_SKY_EXPECTED:
+            fprintf(stderr, "Expected sky coverage (--sky-expected)\n");
+            break;
+        case OP_CASTER_SURVEY:
+            fprintf(stderr, "Caster survey (--survey)\n");
+            break;
         default:
             fprintf(stderr, "No action specified\n");
     }
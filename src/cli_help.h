@@ -36,7 +36,20 @@ typedef enum {
     OP_SHOW_MOUNT_RAW,         /**< Display raw mountpoint source table from caster */
     OP_SHOW_MOUNT_FORMATTED,   /**< Display formatted mountpoint table from caster */
     OP_DECODE_STREAM,          /**< Decode and display detailed RTCM message contents */
-    OP_SKY_HEATMAP             /**< Collect sky-heatmap data until Ctrl-C, save PNG */
+    OP_SKY_HEATMAP,            /**< Collect sky-heatmap data until Ctrl-C, save PNG */
+    OP_MULTI_MONITOR,          /**< Monitor every mountpoint in a mounts file on one event loop */
+    OP_CONVERT_CAPTURE,        /**< Convert a capture between raw RTCM and the native format */
+    OP_NEAREST_MOUNTS,         /**< List the mountpoints nearest to the configured position */
+    OP_CRAWL_SOURCETABLES,     /**< Fetch and merge the sourcetables of many casters */
+    OP_RELAY,                  /**< Re-serve mountpoints to local NTRIP clients (local caster) */
+    OP_SIMULATE,               /**< Generate a synthetic RTCM stream (file, stdout or local caster) */
+    OP_LOAD_TEST,              /**< Load-test a caster with many client sessions on one event loop */
+    OP_VRS_PROBE,              /**< Probe a VRS mountpoint from many GGA positions at once */
+    OP_SKY_MERGE,              /**< Add up sky-heatmap sector grids (.sky files) */
+    OP_EPH_FEED,               /**< Feed a shared-memory ephemeris segment for --sky --eph-shm */
+    OP_FLEET_COLLECT,          /**< Collect and merge the summaries pushed by analyser nodes */
+    OP_SKY_EXPECTED,           /**< Compute expected sky-heatmap counts without a stream */
+    OP_CASTER_SURVEY           /**< Sample every mountpoint of the sourcetable and check its STR line */
 } Operation;
 
 /**
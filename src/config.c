@@ -8,11 +8,21 @@
  */
 
 #include "config.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "cJSON.h"
 
+/* TLS / EPH_TLS: true or a positive number = on, false or a negative
+ * number = off, absent or 0 = decided by the port. */
+static int config_tls_mode(const cJSON *item)
+{
+    if (cJSON_IsBool(item))   return cJSON_IsTrue(item) ? 1 : -1;
+    if (cJSON_IsNumber(item)) return item->valueint > 0 ? 1 : (item->valueint < 0 ? -1 : 0);
+    return 0;
+}
+
 int load_config(const char *filename, NTRIP_Config *config) {
     FILE *file = fopen(filename, "r");
     if (!file) {
@@ -43,12 +53,34 @@ int load_config(const char *filename, NTRIP_Config *config) {
         return -1;
     }
 
+    /* Required fields.  A file caught half-written by a live reload
+     * (config_watch.h) lands here too, so check before copying. */
+    static const char *const required[] = {
+        "NTRIP_CASTER", "MOUNTPOINT", "USERNAME", "PASSWORD"
+    };
+    for (size_t i = 0; i < sizeof(required) / sizeof(required[0]); i++) {
+        if (!cJSON_IsString(cJSON_GetObjectItem(json, required[i]))) {
+            fprintf(stderr, "Config file: %s missing or not a string\n", required[i]);
+            cJSON_Delete(json);
+            return -1;
+        }
+    }
+    if (!cJSON_IsNumber(cJSON_GetObjectItem(json, "NTRIP_PORT"))) {
+        fprintf(stderr, "Config file: NTRIP_PORT missing or not a number\n");
+        cJSON_Delete(json);
+        return -1;
+    }
+
     // Extract configuration values
-    strcpy(config->NTRIP_CASTER, cJSON_GetObjectItem(json, "NTRIP_CASTER")->valuestring);
+    snprintf(config->NTRIP_CASTER, sizeof(config->NTRIP_CASTER), "%s",
+             cJSON_GetObjectItem(json, "NTRIP_CASTER")->valuestring);
     config->NTRIP_PORT = cJSON_GetObjectItem(json, "NTRIP_PORT")->valueint;
-    strcpy(config->MOUNTPOINT, cJSON_GetObjectItem(json, "MOUNTPOINT")->valuestring);
-    strcpy(config->USERNAME, cJSON_GetObjectItem(json, "USERNAME")->valuestring);
-    strcpy(config->PASSWORD, cJSON_GetObjectItem(json, "PASSWORD")->valuestring);
+    snprintf(config->MOUNTPOINT, sizeof(config->MOUNTPOINT), "%s",
+             cJSON_GetObjectItem(json, "MOUNTPOINT")->valuestring);
+    snprintf(config->USERNAME, sizeof(config->USERNAME), "%s",
+             cJSON_GetObjectItem(json, "USERNAME")->valuestring);
+    snprintf(config->PASSWORD, sizeof(config->PASSWORD), "%s",
+             cJSON_GetObjectItem(json, "PASSWORD")->valuestring);
 
     // New: Extract latitude and longitude if present
     cJSON *lat = cJSON_GetObjectItem(json, "LATITUDE");
@@ -56,6 +88,27 @@ int load_config(const char *filename, NTRIP_Config *config) {
     config->LATITUDE = (lat && cJSON_IsNumber(lat)) ? lat->valuedouble : 0.0;
     config->LONGITUDE = (lon && cJSON_IsNumber(lon)) ? lon->valuedouble : 0.0;
 
+    /* Sourcetable cache lifetime; absent or 0 leaves the cache off */
+    cJSON *ttl = cJSON_GetObjectItem(json, "SOURCETABLE_TTL");
+    config->SOURCETABLE_TTL = (ttl && cJSON_IsNumber(ttl) && ttl->valueint > 0) ? ttl->valueint : 0;
+    cJSON *tmo = cJSON_GetObjectItem(json, "SOURCETABLE_TIMEOUT");
+    config->SOURCETABLE_TIMEOUT = (tmo && cJSON_IsNumber(tmo) && tmo->valueint > 0) ? tmo->valueint : 0;
+
+    /* Stream reconnect backoff ceiling; absent = default, negative = off */
+    cJSON *rcn = cJSON_GetObjectItem(json, "RECONNECT_DELAY_MAX");
+    config->RECONNECT_DELAY_MAX = (rcn && cJSON_IsNumber(rcn)) ? rcn->valueint : 0;
+
+    /* NTRIP over TLS; absent = only on port 443 */
+    config->TLS     = config_tls_mode(cJSON_GetObjectItem(json, "TLS"));
+    config->EPH_TLS = config_tls_mode(cJSON_GetObjectItem(json, "EPH_TLS"));
+    cJSON *insecure = cJSON_GetObjectItem(json, "TLS_INSECURE");
+    config->TLS_INSECURE = insecure && (cJSON_IsTrue(insecure) ||
+                                        (cJSON_IsNumber(insecure) && insecure->valueint));
+
+    /* GGA period of event-loop streams; absent = every second */
+    cJSON *gga = cJSON_GetObjectItem(json, "GGA_INTERVAL");
+    config->GGA_INTERVAL = (gga && cJSON_IsNumber(gga)) ? gga->valueint : 0;
+
     /* ── Optional secondary ephemeris stream ──────────────────────────
      * Missing fields stay empty so the eph worker stays disabled by
      * default; the user enables it by entering values manually or by
@@ -99,6 +152,41 @@ int load_config(const char *filename, NTRIP_Config *config) {
     return 0;
 }
 
+unsigned config_diff(const NTRIP_Config *a, const NTRIP_Config *b)
+{
+    unsigned d = 0;
+    if (strcmp(a->NTRIP_CASTER, b->NTRIP_CASTER) || a->NTRIP_PORT != b->NTRIP_PORT ||
+        strcmp(a->MOUNTPOINT, b->MOUNTPOINT) || strcmp(a->USERNAME, b->USERNAME) ||
+        strcmp(a->PASSWORD, b->PASSWORD) || a->TLS != b->TLS ||
+        a->TLS_INSECURE != b->TLS_INSECURE)
+        d |= CONFIG_DIFF_OBS;
+    if (strcmp(a->EPH_CASTER, b->EPH_CASTER) || a->EPH_PORT != b->EPH_PORT ||
+        strcmp(a->EPH_MOUNTPOINT, b->EPH_MOUNTPOINT) ||
+        strcmp(a->EPH_USERNAME, b->EPH_USERNAME) ||
+        strcmp(a->EPH_PASSWORD, b->EPH_PASSWORD) || a->EPH_TLS != b->EPH_TLS ||
+        a->TLS_INSECURE != b->TLS_INSECURE)
+        d |= CONFIG_DIFF_EPH;
+    if (a->LATITUDE != b->LATITUDE || a->LONGITUDE != b->LONGITUDE ||
+        a->GGA_INTERVAL != b->GGA_INTERVAL)
+        d |= CONFIG_DIFF_POSITION;
+    if (a->RECONNECT_DELAY_MAX != b->RECONNECT_DELAY_MAX ||
+        a->SOURCETABLE_TTL != b->SOURCETABLE_TTL ||
+        a->SOURCETABLE_TIMEOUT != b->SOURCETABLE_TIMEOUT)
+        d |= CONFIG_DIFF_OTHER;
+    return d;
+}
+
+bool config_eph_is_obs_stream(const NTRIP_Config *config)
+{
+    if (!config->EPH_CASTER[0] || config->EPH_PORT != config->NTRIP_PORT ||
+        strcmp(config->EPH_MOUNTPOINT, config->MOUNTPOINT) != 0)
+        return false;
+    const char *a = config->EPH_CASTER, *b = config->NTRIP_CASTER;
+    for (; *a && *b; a++, b++)
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+    return *a == *b;
+}
+
 int initialize_config(const char *filename) {
     FILE *test = fopen(filename, "r");
     if (test) {
@@ -122,6 +210,7 @@ int initialize_config(const char *filename) {
         "    \"PASSWORD\": \"your_password\",\n"
         "    \"LATITUDE\": 0.0,\n"
         "    \"LONGITUDE\": 0.0,\n"
+        "    \"SOURCETABLE_TTL\": 300,\n"
         "    \"EPH_CASTER\": \"products.igs-ip.net\",\n"
         "    \"EPH_PORT\": 2101,\n"
         "    \"EPH_MOUNTPOINT\": \"BCEP00BKG0\",\n"
@@ -31,6 +31,35 @@ extern "C" {
  */
 int load_config(const char *filename, NTRIP_Config *config);
 
+/** @brief config_diff(): caster, port, mountpoint, credentials or TLS of the stream. */
+#define CONFIG_DIFF_OBS       0x01u
+/** @brief config_diff(): any EPH_* connection field (or TLS_INSECURE). */
+#define CONFIG_DIFF_EPH       0x02u
+/** @brief config_diff(): LATITUDE, LONGITUDE or GGA_INTERVAL. */
+#define CONFIG_DIFF_POSITION  0x04u
+/** @brief config_diff(): RECONNECT_DELAY_MAX or the sourcetable settings. */
+#define CONFIG_DIFF_OTHER     0x08u
+
+/**
+ * @brief What differs between two loaded configs, for a live reload.
+ *
+ * Credentials are compared as USERNAME / PASSWORD; AUTH_BASIC is derived
+ * from them.  A connection needs to be re-opened only for the
+ * @ref CONFIG_DIFF_OBS or @ref CONFIG_DIFF_EPH bit of its own stream.
+ *
+ * @return 0 when nothing of interest changed, else CONFIG_DIFF_* bits.
+ */
+unsigned config_diff(const NTRIP_Config *a, const NTRIP_Config *b);
+
+/**
+ * @brief true if EPH_CASTER / EPH_PORT / EPH_MOUNTPOINT name the obs
+ *        stream itself (caster compared without case).
+ *
+ * Its ephemerides are then decoded from the obs connection; a second
+ * connection would only bring the same frames again.
+ */
+bool config_eph_is_obs_stream(const NTRIP_Config *config);
+
 /**
  * @brief Create a config file with all required fields and dummy values.
  *
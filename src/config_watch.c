@@ -0,0 +1,88 @@
+/**
+ * @file config_watch.c
+ * @brief Live-reload trigger for the config and mounts files.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "config_watch.h"
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct {
+    const char *path;
+    time_t      mtime;
+    long long   size;           /* -1 = could not stat */
+} WatchedFile;
+
+static WatchedFile          s_files[CONFIG_WATCH_MAX_FILES];
+static int                  s_n_files;
+static bool                 s_active;
+static bool                 s_poll;
+static time_t               s_next_poll;
+static volatile sig_atomic_t s_hup;
+
+#ifdef SIGHUP
+static void on_sighup(int sig) { (void)sig; s_hup = 1; }
+#endif
+
+static void watch_stat(WatchedFile *f, time_t *mtime, long long *size)
+{
+    struct stat st;
+    if (stat(f->path, &st) != 0) {
+        *mtime = 0;
+        *size  = -1;
+        return;
+    }
+    *mtime = st.st_mtime;
+    *size  = (long long)st.st_size;
+}
+
+void config_watch_init(const char *const *paths, int n, bool poll)
+{
+    s_n_files = 0;
+    for (int i = 0; i < n && s_n_files < CONFIG_WATCH_MAX_FILES; i++) {
+        if (!paths[i]) continue;
+        WatchedFile *f = &s_files[s_n_files++];
+        f->path = paths[i];
+        watch_stat(f, &f->mtime, &f->size);
+    }
+    s_poll      = poll;
+    s_next_poll = time(NULL) + CONFIG_WATCH_POLL_S;
+    s_hup       = 0;
+    s_active    = true;
+#ifdef SIGHUP
+    signal(SIGHUP, on_sighup);
+#endif
+}
+
+bool config_watch_due(void)
+{
+    if (!s_active) return false;
+    if (s_hup) {
+        s_hup = 0;
+        return true;
+    }
+    if (!s_poll) return false;
+    time_t now = time(NULL);
+    if (now < s_next_poll) return false;
+    s_next_poll = now + CONFIG_WATCH_POLL_S;
+
+    /* Take every change in, so one edit of both files is one reload. */
+    bool changed = false;
+    for (int i = 0; i < s_n_files; i++) {
+        WatchedFile *f = &s_files[i];
+        time_t    mtime;
+        long long size;
+        watch_stat(f, &mtime, &size);
+        if (mtime == f->mtime && size == f->size) continue;
+        f->mtime = mtime;
+        f->size  = size;
+        if (size >= 0) changed = true;  /* a vanished file is not a new config */
+    }
+    return changed;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file config_watch.h
+ * @brief Live-reload trigger for the config and mounts files: SIGHUP or
+ *        a change of their modification time.
+ *
+ * The streaming modes (`--sky` from a caster, `--mounts-file`) poll
+ * config_watch_due() from their receive loop.  When it returns true the
+ * loop reloads the files, compares the result with what is running
+ * (config_diff()) and re-opens only the connections whose settings
+ * changed; the ephemeris store, statistics and sector grids stay.
+ *
+ * Triggers:
+ *   - SIGHUP (POSIX), always once config_watch_init() has run;
+ *   - with @p poll, a changed size or modification time of any watched
+ *     file, checked every @ref CONFIG_WATCH_POLL_S.  This is the trigger
+ *     on Windows, which has no SIGHUP.
+ *
+ * An editor that writes the file in several steps may be caught half
+ * way; the reload then fails to parse, the running settings are kept,
+ * and the next poll sees the completed file.
+ *
+ * Threading: config_watch_due() is called from one thread.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef CONFIG_WATCH_H
+#define CONFIG_WATCH_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Files one watch follows (config file, mounts file). */
+#define CONFIG_WATCH_MAX_FILES  2
+
+/** @brief Seconds between two looks at the watched files. */
+#define CONFIG_WATCH_POLL_S     2
+
+/**
+ * @brief Install the SIGHUP handler and remember @p paths.
+ *
+ * @param paths  Files to watch; NULL entries are skipped, at most
+ *               @ref CONFIG_WATCH_MAX_FILES are used.  The strings must
+ *               outlive the watch.
+ * @param poll   Also reload when a file changes (--watch-config).
+ */
+void config_watch_init(const char *const *paths, int n, bool poll);
+
+/**
+ * @brief true once per SIGHUP or file change since the last call.
+ *
+ * Cheap enough for every turn of a receive loop: the files are looked
+ * at no more often than every @ref CONFIG_WATCH_POLL_S.  Always false
+ * before config_watch_init().
+ */
+bool config_watch_due(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_WATCH_H */
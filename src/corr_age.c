@@ -0,0 +1,121 @@
+/**
+ * @file corr_age.c
+ * @brief Age of corrections: MSM epoch time against the receive time.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "corr_age.h"
+#include "rtcm3x_parser.h"
+#include "rtcm_bitreader.h"
+#include "stream_clock.h"
+
+#define NS_PER_MS        1000000LL
+#define WEEK_NS          (604800LL * 1000000000LL)
+#define DAY_NS           (86400LL * 1000000000LL)
+#define GPS_EPOCH_UNIX   315964800LL    /* 1980-01-06 UTC */
+
+/* Wrap @p d into (-period/2, period/2]. */
+static int64_t age_wrap(int64_t d, int64_t period)
+{
+    d %= period;
+    if (d >   period / 2) d -= period;
+    if (d <= -period / 2) d += period;
+    return d;
+}
+
+bool corr_age_of_frame(const unsigned char *frame, int frame_len, int64_t rx_utc_ns,
+                       int64_t *age_ns)
+{
+    if (!frame || frame_len < 6 + 7) return false;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+    if (!rtcm_msg_is_msm(mt, 1, 7)) return false;
+    const unsigned char *p = &frame[3];
+
+    if (mt / 10 == 108) {
+        /* GLONASS: DF416 day of week (3 bits), DF034 Moscow time of day */
+        uint32_t tod_ms = (uint32_t)get_bits(p, 27, 27);
+        if (tod_ms >= 86400000u) return false;
+        int64_t rx_msk = rx_utc_ns + 3 * 3600 * 1000000000LL;
+        *age_ns = age_wrap(rx_msk % DAY_NS - (int64_t)tod_ms * NS_PER_MS, DAY_NS);
+        return true;
+    }
+
+    uint32_t tow_ms = (uint32_t)get_bits(p, 24, 30);
+    if (tow_ms >= 604800000u) return false;
+    int64_t epoch_ns = (int64_t)tow_ms * NS_PER_MS;
+    switch (mt / 10) {
+    case 107:                             /* GPS */
+    case 109:                             /* Galileo (GST) */
+    case 110:                             /* SBAS */
+    case 111:                             /* QZSS */
+    case 113:                             /* NavIC (aligned to GPS ToW) */
+        break;
+    case 112:                             /* BeiDou: BDT = GPST - 14 s */
+        epoch_ns += 14000 * NS_PER_MS;
+        break;
+    default:
+        return false;
+    }
+
+    int64_t unix_s = rx_utc_ns / 1000000000LL;
+    int64_t rx_gps = rx_utc_ns - GPS_EPOCH_UNIX * 1000000000LL +
+                     (int64_t)stream_clock_leap_seconds(unix_s) * 1000000000LL;
+    *age_ns = age_wrap(rx_gps % WEEK_NS - epoch_ns, WEEK_NS);
+    return true;
+}
+
+void corr_age_add(CorrAge *ca, const unsigned char *frame, int frame_len, int64_t rx_utc_ns)
+{
+    int64_t age;
+    if (rx_utc_ns <= 0 || !corr_age_of_frame(frame, frame_len, rx_utc_ns, &age)) return;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+    int slot = mt - CORR_AGE_FIRST_TYPE;
+    if (slot < 0 || slot >= CORR_AGE_SLOTS) return;
+
+    CorrAgeStat *st = &ca->type[slot];
+    if (age < 0) {
+        st->early++;
+        age = 0;
+    }
+    perf_hist_add(&st->hist, (uint64_t)age);
+}
+
+const CorrAgeStat *corr_age_stat(const CorrAge *ca, int msg_type)
+{
+    int slot = msg_type - CORR_AGE_FIRST_TYPE;
+    if (slot < 0 || slot >= CORR_AGE_SLOTS) return NULL;
+    return &ca->type[slot];
+}
+
+bool corr_age_any(const CorrAge *ca)
+{
+    for (int i = 0; i < CORR_AGE_SLOTS; i++) {
+        if (ca->type[i].hist.count) return true;
+    }
+    return false;
+}
+
+void corr_age_print_table(const CorrAge *ca, const char *title, FILE *out)
+{
+    static const char border[] =
+        "+-------------+-------+------------+------------+------------+------------+-------+\n";
+    fprintf(out, "\n%s (ms)\n", title);
+    fputs(border, out);
+    fprintf(out, "| MessageType | Count | p50        | p90        | p99        | Max        | Early |\n");
+    fputs(border, out);
+    for (int i = 0; i < CORR_AGE_SLOTS; i++) {
+        const CorrAgeStat *st = &ca->type[i];
+        const PerfHist *h = &st->hist;
+        if (!h->count) continue;
+        fprintf(out, "| %-11d | %5llu | %10.1f | %10.1f | %10.1f | %10.1f | %5llu |\n",
+                CORR_AGE_FIRST_TYPE + i, (unsigned long long)h->count,
+                perf_hist_quantile(h, 0.50) / 1e6,
+                perf_hist_quantile(h, 0.90) / 1e6,
+                perf_hist_quantile(h, 0.99) / 1e6,
+                h->max_ns / 1e6, (unsigned long long)st->early);
+    }
+    fputs(border, out);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file corr_age.h
+ * @brief Age of corrections: MSM epoch time against the receive time.
+ *
+ * Inter-arrival intervals say how regular a stream is, not how old its
+ * observations are when they arrive -- and the age is what limits an RTK
+ * rover.  Every MSM header carries the epoch time of its observations;
+ * corr_age_add() converts it to GPS time of week and subtracts it from
+ * the UTC receive time of the bytes (plus the GPS - UTC leap seconds):
+ *
+ *   - GPS, Galileo, SBAS, QZSS, NavIC: epoch time is GPS time of week
+ *   - BeiDou: BDT = GPST - 14 s
+ *   - GLONASS: day of week + Moscow time of day (UTC + 3 h, no leap
+ *     seconds); compared as a time of day
+ *
+ * Ages go into one log-linear histogram per MSM message type
+ * (perf_probe.h), updated per frame in constant memory.  A frame whose
+ * epoch lies after its receive time (the local clock runs behind the
+ * station's) counts as age 0 and is also counted as @c early.
+ *
+ * The receive time should be taken as close to the wire as possible:
+ * ntrip_session_recv() stamps every read with the kernel receive time
+ * (SO_TIMESTAMPNS) where the platform has it.  Either way the result is
+ * only as good as the local clock's sync to UTC (NTP, PTP).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef CORR_AGE_H
+#define CORR_AGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "perf_probe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief First message type with a slot (GPS MSM1). */
+#define CORR_AGE_FIRST_TYPE  1071
+
+/** @brief Slots: MSM message types 1071 .. 1137. */
+#define CORR_AGE_SLOTS       67
+
+/** @brief Age distribution of one message type. */
+typedef struct {
+    PerfHist hist;          /**< age in ns */
+    uint64_t early;         /**< epochs after the receive time (added as 0) */
+} CorrAgeStat;
+
+/** @brief Age distributions of every MSM type of one stream (~150 kB). */
+typedef struct {
+    CorrAgeStat type[CORR_AGE_SLOTS];
+} CorrAge;
+
+/**
+ * @brief Age of one MSM frame.
+ *
+ * @param frame      Whole RTCM frame (starting at the 0xD3 preamble).
+ * @param frame_len  Frame length in bytes.
+ * @param rx_utc_ns  UTC receive time in Unix ns.
+ * @param age_ns     [out] Receive time - epoch time; negative if the
+ *                   epoch lies after the receive time.
+ * @return false for non-MSM frames and unusable epoch times.
+ */
+bool corr_age_of_frame(const unsigned char *frame, int frame_len, int64_t rx_utc_ns,
+                       int64_t *age_ns);
+
+/** @brief Add the age of @p frame (if it is an MSM frame) to its type's histogram. */
+void corr_age_add(CorrAge *ca, const unsigned char *frame, int frame_len, int64_t rx_utc_ns);
+
+/** @brief Statistics of @p msg_type, or NULL for a type without a slot. */
+const CorrAgeStat *corr_age_stat(const CorrAge *ca, int msg_type);
+
+/** @brief true if any type has a sample. */
+bool corr_age_any(const CorrAge *ca);
+
+/**
+ * @brief Print the types that have samples as a table (ms): count, p50,
+ *        p90, p99, max and the early count.
+ */
+void corr_age_print_table(const CorrAge *ca, const char *title, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CORR_AGE_H */
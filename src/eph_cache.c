@@ -0,0 +1,141 @@
+/**
+ * @file eph_cache.c
+ * @brief The ephemeris store on disk across restarts (`--eph-cache`).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "eph_cache.h"
+#include "file_map.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define EPHS_MAGIC    "NAEPHS\r\n"
+#define EPHS_VERSION  1
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint32_t n_records;
+    uint32_t reserved;
+    int64_t  saved;
+} EphCacheHeader;
+
+static void ephs_header(EphCacheHeader *h, uint32_t n_records)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, EPHS_MAGIC, sizeof(h->magic));
+    h->version   = EPHS_VERSION;
+    h->rec_size  = (uint32_t)sizeof(SvEphemeris);
+    h->n_records = n_records;
+    h->saved     = (int64_t)time(NULL);
+}
+
+int eph_cache_load(const char *path, int week, double tow_s, double glo_tod,
+                   int *counts, int *stale)
+{
+    if (counts) memset(counts, 0, SV_EPH_MAX_GNSS * sizeof(counts[0]));
+    if (stale) *stale = 0;
+
+    FileMap m;
+    if (!file_map_open(&m, path)) {
+        fprintf(stderr, "[ERROR] Cannot read %s\n", path);
+        return -1;
+    }
+    EphCacheHeader h;
+    const char *why = NULL;
+    bool other_build = false;
+    if (m.size < sizeof(h)) {
+        why = "not an ephemeris cache";
+    } else {
+        memcpy(&h, m.data, sizeof(h));
+        if (memcmp(h.magic, EPHS_MAGIC, sizeof(h.magic)) != 0)
+            why = "not an ephemeris cache";
+        else if (h.version != EPHS_VERSION || h.rec_size != sizeof(SvEphemeris))
+            other_build = true;
+        else if (m.size != sizeof(h) + (size_t)h.n_records * sizeof(SvEphemeris))
+            why = "truncated";
+    }
+    if (other_build) {
+        fprintf(stderr, "[EPH] %s was written by a different build; starting empty\n", path);
+        file_map_close(&m);
+        return 0;
+    }
+    if (why) {
+        fprintf(stderr, "[ERROR] %s: %s\n", path, why);
+        file_map_close(&m);
+        return -1;
+    }
+
+    int total = 0;
+    const unsigned char *p = m.data + sizeof(h);
+    for (uint32_t i = 0; i < h.n_records; i++, p += sizeof(SvEphemeris)) {
+        SvEphemeris eph;
+        memcpy(&eph, p, sizeof(eph));
+        if (eph.gnss_id <= 0 || eph.gnss_id >= SV_EPH_MAX_GNSS) continue;
+        if (eph.prn < 1 || eph.prn > SV_EPH_MAX_SATS_PER_GNSS) continue;
+        eph.valid = true;
+        if (week >= 0 &&
+            !sv_eph_is_valid_at(&eph, week, eph.gnss_id == 2 ? glo_tod : tow_s)) {
+            if (stale) (*stale)++;
+            continue;
+        }
+        sv_eph_store(&eph);
+        if (counts) counts[eph.gnss_id]++;
+        total++;
+    }
+    file_map_close(&m);
+    return total;
+}
+
+int eph_cache_save(const char *path)
+{
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp = (char *)malloc(tmp_len);
+    if (!tmp) {
+        fprintf(stderr, "[ERROR] %s: out of memory\n", path);
+        return -1;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    EphCacheHeader h;
+    ephs_header(&h, 0);
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && fwrite(&h, sizeof(h), 1, f) == 1;
+
+    /* Read without a lock, like sv_eph_get(), while the eph worker may
+     * still be adding versions. */
+    uint32_t n = 0;
+    for (int g = 1; ok && g < SV_EPH_MAX_GNSS; g++) {
+        for (int prn = 1; ok && prn <= SV_EPH_MAX_SATS_PER_GNSS; prn++) {
+            const SvEphemeris *v[SV_EPH_HISTORY];
+            int k = sv_eph_get_all(g, prn, v);
+            for (int i = 0; ok && i < k; i++) {
+                ok = fwrite(v[i], sizeof(SvEphemeris), 1, f) == 1;
+                n++;
+            }
+        }
+    }
+    if (ok) {
+        ephs_header(&h, n);
+        ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+    if (f && fclose(f) != 0) ok = false;
+    if (ok) {
+        remove(path);                     /* rename() won't replace on Windows */
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "[ERROR] Cannot write %s\n", path);
+        remove(tmp);
+    }
+    free(tmp);
+    return ok ? (int)n : -1;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file eph_cache.h
+ * @brief The ephemeris store on disk across restarts (`--eph-cache`).
+ *
+ * Without it every run starts with an empty store (sv_ephemeris.h), and
+ * the sky collection expects nothing until each SV's ephemeris has been
+ * broadcast again: minutes for GPS, longer for some other systems.  With
+ * `--eph-cache FILE` the store is written to FILE every
+ * @ref EPH_CACHE_SAVE_S seconds and at the end of the run, and the next
+ * run loads the versions that sv_eph_is_valid_at() still accepts before
+ * its first frame, so its first sky epoch already has them all.
+ *
+ * Like the RINEX "<file>.ephc" sidecar (rinex_nav.c) the records are raw
+ * SvEphemeris structs: the file is valid only for builds with the same
+ * struct layout, and any other is ignored.  It is written to
+ * "<file>.tmp" and renamed into place, so a run stopped half way leaves
+ * the previous cache intact.
+ *
+ * Layout (host byte order):
+ * @code
+ *   header   32 B  "NAEPHS\r\n", u32 version, u32 record size,
+ *                  u32 records, u32 reserved, i64 saved (Unix s)
+ *   records        that many SvEphemeris, every version of every SV,
+ *                  by GNSS, PRN and ascending toe
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef EPH_CACHE_H
+#define EPH_CACHE_H
+
+#include <stdbool.h>
+
+#include "sv_ephemeris.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Seconds (wall clock) between two saves while running. */
+#define EPH_CACHE_SAVE_S  60
+
+/**
+ * @brief Load the versions in @p path that are valid at @p week / @p tow_s
+ *        (GLONASS: @p glo_tod, Moscow seconds of day) into the store.
+ *
+ * @param week    GPS week; < 0 loads every version without a time check
+ *                (a replay, whose time is not known yet).
+ * @param counts  [out] Array of SV_EPH_MAX_GNSS: versions loaded per GNSS
+ *                ID.  NULL if not wanted.
+ * @param stale   [out] Versions skipped as no longer valid.  May be NULL.
+ * @return Versions loaded; 0 for the cache of a build with another
+ *         layout, which the next save replaces; -1 if @p path cannot be
+ *         read or is not an ephemeris cache (reported on stderr).
+ */
+int eph_cache_load(const char *path, int week, double tow_s, double glo_tod,
+                   int *counts, int *stale);
+
+/**
+ * @brief Write every version in the store to @p path, replacing it
+ *        atomically.
+ * @return Versions written, or -1 on an I/O error (reported on stderr);
+ *         @p path is then unchanged.
+ */
+int eph_cache_save(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EPH_CACHE_H */
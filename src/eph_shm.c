@@ -0,0 +1,226 @@
+/**
+ * @file eph_shm.c
+ * @brief Broadcast-ephemeris store in a named shared-memory segment.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "eph_shm.h"
+#include "sv_ephemeris.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SHM_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SHM_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SHM_CAS(p, e, v)  __atomic_compare_exchange_n((p), (e), (v), false, \
+                                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+#define SHM_MAGIC    0x5045414Eu    /* "NAEP" little-endian */
+#define SHM_BUSY     0x59535542u    /* "BUSY": header being filled in */
+#define SHM_VERSION  1u
+#define SHM_HEADER   64             /* bytes before the slot table */
+#define SHM_PREFIX   "ntripanalyser-"
+
+typedef struct {
+    uint32_t magic;             /* SHM_MAGIC once the header is filled in */
+    uint32_t version;
+    uint64_t table_size;        /* sv_eph_table_size() of the creating build */
+    uint32_t feeder;            /* process id, 0 = none */
+    uint32_t reserved;
+    int64_t  created;           /* Unix s */
+    uint8_t  pad[SHM_HEADER - 32];
+} ShmHeader;
+
+typedef char shm_header_size_check[sizeof(ShmHeader) == SHM_HEADER ? 1 : -1];
+
+static ShmHeader *s_hdr;
+static bool       s_feeding;
+
+bool eph_shm_name_ok(const char *name)
+{
+    size_t n = name ? strlen(name) : 0;
+    if (n == 0 || n > EPH_SHM_NAME_MAX) return false;
+    for (size_t i = 0; i < n; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-'))
+            return false;
+    }
+    return true;
+}
+
+static uint32_t shm_self(void)
+{
+#ifdef _WIN32
+    return (uint32_t)GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+static bool shm_pid_alive(uint32_t pid)
+{
+#ifdef _WIN32
+    HANDLE h = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (!h) return GetLastError() == ERROR_ACCESS_DENIED;
+    bool alive = WaitForSingleObject(h, 0) == WAIT_TIMEOUT;
+    CloseHandle(h);
+    return alive;
+#else
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+static void shm_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* Map @p size bytes of the segment, zero-filled when new.  NULL with a
+ * message on failure. */
+static void *shm_map(const char *name, size_t size)
+{
+#ifdef _WIN32
+    char path[sizeof("Local\\" SHM_PREFIX) + EPH_SHM_NAME_MAX];
+    snprintf(path, sizeof(path), "Local\\" SHM_PREFIX "%s", name);
+    HANDLE map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                    (DWORD)((uint64_t)size >> 32), (DWORD)size, path);
+    if (!map) {
+        fprintf(stderr, "[EPH] Cannot create shared segment %s (error %lu)\n",
+                path, (unsigned long)GetLastError());
+        return NULL;
+    }
+    /* The handle stays open for the life of the process: it keeps the
+     * segment alive for the others. */
+    void *p = MapViewOfFile(map, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!p) {
+        fprintf(stderr, "[EPH] Cannot map shared segment %s; made by another build?\n", path);
+        CloseHandle(map);
+    }
+    return p;
+#else
+    char path[sizeof("/" SHM_PREFIX) + EPH_SHM_NAME_MAX];
+    snprintf(path, sizeof(path), "/" SHM_PREFIX "%s", name);
+    int fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "[EPH] Cannot open shared segment %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0 && ftruncate(fd, (off_t)size) != 0) {
+        fprintf(stderr, "[EPH] Cannot size shared segment %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != size) {
+        fprintf(stderr, "[EPH] Shared segment %s has another size; made by another build?\n",
+                path);
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "[EPH] Cannot map shared segment %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    return p;
+#endif
+}
+
+/* Claim the feeder role if it is free or its holder is gone. */
+static bool shm_claim(ShmHeader *h)
+{
+    uint32_t me = shm_self();
+    for (;;) {
+        uint32_t cur = SHM_LOAD(&h->feeder);
+        if (cur == me) return true;
+        if (cur != 0 && shm_pid_alive(cur)) return false;
+        if (SHM_CAS(&h->feeder, &cur, me)) return true;
+    }
+}
+
+EphShmRole eph_shm_attach(const char *name, bool feed)
+{
+    if (!eph_shm_name_ok(name)) {
+        fprintf(stderr, "[EPH] Invalid shared segment name '%s'\n", name ? name : "");
+        return EPH_SHM_ERROR;
+    }
+    size_t table = sv_eph_table_size();
+    ShmHeader *h = (ShmHeader *)shm_map(name, SHM_HEADER + table);
+    if (!h) return EPH_SHM_ERROR;
+
+    /* The first process to see the segment fills in the header; the
+     * others wait until it has. */
+    uint32_t zero = 0;
+    if (SHM_CAS(&h->magic, &zero, SHM_BUSY)) {
+        h->version    = SHM_VERSION;
+        h->table_size = table;
+        h->created    = (int64_t)time(NULL);
+        SHM_STORE(&h->magic, SHM_MAGIC);
+    }
+    for (int i = 0; i < 100 && SHM_LOAD(&h->magic) == SHM_BUSY; i++) shm_sleep_ms(10);
+    if (SHM_LOAD(&h->magic) != SHM_MAGIC || h->version != SHM_VERSION ||
+        h->table_size != table) {
+        fprintf(stderr, "[EPH] Shared segment '%s' was made by another build of the analyser\n",
+                name);
+        return EPH_SHM_ERROR;
+    }
+
+    s_hdr     = h;
+    s_feeding = feed && shm_claim(h);
+    sv_eph_set_table((unsigned char *)h + SHM_HEADER, s_feeding);
+    return s_feeding ? EPH_SHM_FEEDER : EPH_SHM_READER;
+}
+
+bool eph_shm_take_over(void)
+{
+    if (!s_hdr) return false;
+    if (!s_feeding && shm_claim(s_hdr)) {
+        s_feeding = true;
+        sv_eph_set_table((unsigned char *)s_hdr + SHM_HEADER, true);
+    }
+    return s_feeding;
+}
+
+bool eph_shm_feeding(void)
+{
+    return s_feeding;
+}
+
+unsigned long eph_shm_feeder(void)
+{
+    if (!s_hdr) return 0;
+    uint32_t pid = SHM_LOAD(&s_hdr->feeder);
+    return pid != 0 && shm_pid_alive(pid) ? (unsigned long)pid : 0;
+}
+
+void eph_shm_release(void)
+{
+    if (!s_hdr || !s_feeding) return;
+    uint32_t me = shm_self();
+    SHM_CAS(&s_hdr->feeder, &me, 0u);
+    s_feeding = false;
+    sv_eph_set_table((unsigned char *)s_hdr + SHM_HEADER, false);
+}
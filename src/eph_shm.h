@@ -0,0 +1,90 @@
+/**
+ * @file eph_shm.h
+ * @brief Broadcast-ephemeris store in a named shared-memory segment, fed
+ *        by one process and read by every other analyser on the host.
+ *
+ * Every `--sky` process used to open its own ephemeris connection and
+ * decode the same 1019/1020/1045/... messages into its own cache.  With
+ * `--eph-shm NAME` the sv_ephemeris.h slot table is placed in a segment
+ * shared by all processes using NAME instead:
+ *
+ *   - one process -- the first one with an ephemeris source (EPH_* in
+ *     the config, or -R), or a dedicated `--eph-feed NAME` -- claims the
+ *     segment as its feeder and stores into it as before;
+ *   - every other process maps it, does not connect to the ephemeris
+ *     caster at all, and reads the slots wait-free with the same acquire
+ *     index loads it uses in-process (sv_ephemeris.c); its own stores are
+ *     switched off, so there is only ever one writer.
+ *
+ * The feeder is recorded by process id in the segment header.  When that
+ * process is gone, a reader that has an ephemeris source of its own can
+ * take the feed over (eph_shm_take_over()).  The data outlives every
+ * process: a restarted feeder continues with the ephemerides already
+ * held.
+ *
+ * Segment (POSIX shm_open "/ntripanalyser-NAME", Win32 named mapping
+ * "Local\\ntripanalyser-NAME"): a 64-byte header -- magic "NAEP",
+ * version, table size, feeder pid, creation time -- followed by the slot
+ * table.  The first process to map it fills the header; a process of a
+ * build with a different table layout is refused.  On POSIX the segment
+ * stays until removed (`rm /dev/shm/ntripanalyser-NAME` on Linux).  Feeder
+ * and readers must see the same process ids (the same PID namespace).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef EPH_SHM_H
+#define EPH_SHM_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Longest segment name (letters, digits, '.', '_', '-'). */
+#define EPH_SHM_NAME_MAX  64
+
+typedef enum {
+    EPH_SHM_ERROR = -1,
+    EPH_SHM_READER,         /**< another live process feeds the segment */
+    EPH_SHM_FEEDER          /**< this process feeds it */
+} EphShmRole;
+
+/** @brief true if @p name is usable as a segment name. */
+bool eph_shm_name_ok(const char *name);
+
+/**
+ * @brief Map segment @p name, creating it on first use, and point the
+ *        ephemeris store (sv_ephemeris.h) at it.
+ *
+ * Call before any thread uses the store.
+ *
+ * @param feed  Claim the feeder role if no live process holds it.
+ * @return The role taken, or @ref EPH_SHM_ERROR (with a message on
+ *         stderr) if the segment cannot be mapped or has another layout.
+ */
+EphShmRole eph_shm_attach(const char *name, bool feed);
+
+/**
+ * @brief Reader: become the feeder if the feeding process has exited.
+ * @return true if this process feeds the segment now.
+ */
+bool eph_shm_take_over(void);
+
+/** @brief true if this process feeds the segment. */
+bool eph_shm_feeding(void);
+
+/** @brief Process id of the live feeder, 0 if none (or not attached). */
+unsigned long eph_shm_feeder(void);
+
+/** @brief Give up the feeder role (at exit); the mapping stays. */
+void eph_shm_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EPH_SHM_H */
@@ -0,0 +1,566 @@
+/**
+ * @file event_out.c
+ * @brief Buffered --json event stream (NDJSON / MessagePack).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <io.h>
+    #define CLOSESOCKET closesocket
+#else
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #define CLOSESOCKET close
+#endif
+
+#include "event_out.h"
+#include "ntrip_connect.h"
+#include "stream_clock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef enum { EV_TARGET_STDERR, EV_TARGET_FD, EV_TARGET_SOCKET } EvTarget;
+
+typedef struct {
+    bool     array;
+    uint32_t count;         /* fields / elements so far */
+    size_t   hdr;           /* MessagePack: offset of the map32 / array32 header */
+} EvLevel;
+
+struct EventOut {
+    EventOutOptions opt;
+    EvTarget        target;
+    int             fd;
+    NtripSocket     sock;
+
+    unsigned char  *buf;
+    size_t          len, cap;
+    size_t          start;              /* offset of the event being built */
+    EvLevel         level[EVENT_OUT_MAX_DEPTH];
+    int             depth;
+    int             overflow;           /* levels opened beyond the limit */
+    bool            drop;               /* out of memory: discard this event */
+    bool            force;              /* flush when this event ends */
+    bool            failed;
+    double          last_flush;
+
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t  lock;
+#endif
+};
+
+/* ── Output ───────────────────────────────────────────────────────────── */
+
+static bool ev_write(EventOut *e, const unsigned char *p, size_t n)
+{
+    if (e->target == EV_TARGET_STDERR) {
+        /* Through the FILE, so the lines stay in order with INFO / ERR. */
+        bool ok = fwrite(p, 1, n, stderr) == n;
+        fflush(stderr);
+        return ok;
+    }
+    while (n > 0) {
+        size_t chunk = n > 65536 ? 65536 : n;
+        long k;
+        if (e->target == EV_TARGET_SOCKET) {
+            k = (long)send(e->sock, (const char *)p, (int)chunk, MSG_NOSIGNAL);
+        } else {
+#ifdef _WIN32
+            k = _write(e->fd, p, (unsigned)chunk);
+#else
+            k = (long)write(e->fd, p, chunk);
+            if (k < 0 && errno == EINTR) continue;
+#endif
+        }
+        if (k <= 0) return false;
+        p += k;
+        n -= (size_t)k;
+    }
+    return true;
+}
+
+/* Write the complete events in the buffer (never a half-built one). */
+static void ev_flush_locked(EventOut *e)
+{
+    if (e->start > 0 && !e->failed && !ev_write(e, e->buf, e->start))
+        e->failed = true;
+    memmove(e->buf, e->buf + e->start, e->len - e->start);
+    e->len  -= e->start;
+    e->start = 0;
+    e->last_flush = stream_clock_wall_seconds();
+}
+
+/* ── Buffer ───────────────────────────────────────────────────────────── */
+
+static unsigned char *ev_room(EventOut *e, size_t n)
+{
+    if (e->drop) return NULL;
+    if (e->len + n > e->cap) {
+        size_t cap = e->cap * 2;
+        while (e->len + n > cap) cap *= 2;
+        unsigned char *nb = (unsigned char *)realloc(e->buf, cap);
+        if (!nb) {
+            e->drop = true;
+            return NULL;
+        }
+        e->buf = nb;
+        e->cap = cap;
+    }
+    unsigned char *p = e->buf + e->len;
+    e->len += n;
+    return p;
+}
+
+static void ev_put(EventOut *e, const void *s, size_t n)
+{
+    unsigned char *p = ev_room(e, n);
+    if (p) memcpy(p, s, n);
+}
+
+static void ev_byte(EventOut *e, unsigned char c)
+{
+    unsigned char *p = ev_room(e, 1);
+    if (p) *p = c;
+}
+
+static void ev_be(EventOut *e, uint64_t v, int bytes)
+{
+    unsigned char *p = ev_room(e, (size_t)bytes);
+    if (!p) return;
+    for (int i = bytes - 1; i >= 0; i--, v >>= 8) p[i] = (unsigned char)v;
+}
+
+static void ev_patch_be32(EventOut *e, size_t off, uint32_t v)
+{
+    if (e->drop) return;
+    e->buf[off]     = (unsigned char)(v >> 24);
+    e->buf[off + 1] = (unsigned char)(v >> 16);
+    e->buf[off + 2] = (unsigned char)(v >> 8);
+    e->buf[off + 3] = (unsigned char)v;
+}
+
+/* ── Number formatting ────────────────────────────────────────────────── */
+
+static const char k_digits2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Decimal digits of @p v, written backwards ending at @p end; returns the start. */
+static char *ev_utoa(uint64_t v, char *end)
+{
+    while (v >= 100) {
+        unsigned d = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--end = k_digits2[d + 1];
+        *--end = k_digits2[d];
+    }
+    if (v >= 10) {
+        *--end = k_digits2[v * 2 + 1];
+        *--end = k_digits2[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static void ev_json_uint(EventOut *e, uint64_t v, bool neg)
+{
+    char tmp[24], *end = tmp + sizeof(tmp);
+    char *s = ev_utoa(v, end);
+    if (neg) *--s = '-';
+    ev_put(e, s, (size_t)(end - s));
+}
+
+static void ev_json_fixed(EventOut *e, double v, int decimals)
+{
+    static const double pow10[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    if (!isfinite(v)) {
+        ev_put(e, "null", 4);
+        return;
+    }
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9 || fabs(v) * pow10[decimals] >= 9e15) {
+        char tmp[64];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        ev_put(e, tmp, (size_t)n);
+        return;
+    }
+    bool neg = v < 0;
+    uint64_t scaled = (uint64_t)llround(fabs(v) * pow10[decimals]);
+    uint64_t p = (uint64_t)pow10[decimals];
+    char tmp[40], *end = tmp + sizeof(tmp), *s = end;
+    if (decimals > 0) {
+        uint64_t frac = scaled % p;
+        for (int i = 0; i < decimals; i++, frac /= 10) *--s = (char)('0' + frac % 10);
+        *--s = '.';
+    }
+    s = ev_utoa(scaled / p, s);
+    if (neg && scaled) *--s = '-';
+    ev_put(e, s, (size_t)(end - s));
+}
+
+/* ── MessagePack scalars ──────────────────────────────────────────────── */
+
+static void ev_mp_str(EventOut *e, const char *s, size_t n)
+{
+    if (n < 32)          ev_byte(e, (unsigned char)(0xa0 | n));
+    else if (n < 256)    { ev_byte(e, 0xd9); ev_be(e, n, 1); }
+    else if (n < 65536)  { ev_byte(e, 0xda); ev_be(e, n, 2); }
+    else                 { ev_byte(e, 0xdb); ev_be(e, n, 4); }
+    ev_put(e, s, n);
+}
+
+static void ev_mp_int(EventOut *e, int64_t v)
+{
+    if (v >= 0 && v < 128)                  ev_byte(e, (unsigned char)v);
+    else if (v >= -32 && v < 0)             ev_byte(e, (unsigned char)(0xe0 | (v + 32)));
+    else if (v >= INT32_MIN && v <= INT32_MAX) { ev_byte(e, 0xd2); ev_be(e, (uint32_t)(int32_t)v, 4); }
+    else                                    { ev_byte(e, 0xd3); ev_be(e, (uint64_t)v, 8); }
+}
+
+static void ev_mp_double(EventOut *e, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    ev_byte(e, 0xcb);
+    ev_be(e, bits, 8);
+}
+
+/* ── Fields ───────────────────────────────────────────────────────────── */
+
+/* Separator and key of the next field or element. */
+static void ev_key(EventOut *e, const char *key)
+{
+    EvLevel *l = &e->level[e->depth - 1];
+    bool mp = e->opt.format == EVENT_OUT_MSGPACK;
+    if (!mp && l->count) ev_byte(e, ',');
+    l->count++;
+    if (l->array || !key) return;
+    size_t n = strlen(key);
+    if (mp) {
+        ev_mp_str(e, key, n);
+    } else {
+        ev_byte(e, '"');
+        ev_put(e, key, n);
+        ev_put(e, "\":", 2);
+    }
+}
+
+static void ev_open(EventOut *e, bool array)
+{
+    if (e->depth == EVENT_OUT_MAX_DEPTH) {
+        e->overflow++;
+        e->drop = true;
+        return;
+    }
+    EvLevel *l = &e->level[e->depth++];
+    l->array = array;
+    l->count = 0;
+    l->hdr   = e->len;
+    if (e->opt.format == EVENT_OUT_MSGPACK) {
+        ev_byte(e, array ? 0xdd : 0xdf);
+        ev_be(e, 0, 4);
+    } else {
+        ev_byte(e, array ? '[' : '{');
+    }
+}
+
+void event_obj(EventOut *e, const char *key)
+{
+    if (!e) return;
+    ev_key(e, key);
+    ev_open(e, false);
+}
+
+void event_arr(EventOut *e, const char *key)
+{
+    if (!e) return;
+    ev_key(e, key);
+    ev_open(e, true);
+}
+
+void event_close(EventOut *e)
+{
+    if (!e) return;
+    if (e->overflow) {
+        e->overflow--;
+        return;
+    }
+    if (e->depth <= 1) return;
+    EvLevel *l = &e->level[--e->depth];
+    if (e->opt.format == EVENT_OUT_MSGPACK)
+        ev_patch_be32(e, l->hdr + 1, l->count);
+    else
+        ev_byte(e, l->array ? ']' : '}');
+}
+
+void event_int(EventOut *e, const char *key, int64_t v)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) ev_mp_int(e, v);
+    else ev_json_uint(e, v < 0 ? 0 - (uint64_t)v : (uint64_t)v, v < 0);
+}
+
+void event_uint(EventOut *e, const char *key, uint64_t v)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) {
+        if (v <= INT64_MAX) ev_mp_int(e, (int64_t)v);
+        else { ev_byte(e, 0xcf); ev_be(e, v, 8); }
+    } else {
+        ev_json_uint(e, v, false);
+    }
+}
+
+void event_fixed(EventOut *e, const char *key, double v, int decimals)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) ev_mp_double(e, v);
+    else ev_json_fixed(e, v, decimals);
+}
+
+void event_num(EventOut *e, const char *key, double v)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) {
+        ev_mp_double(e, v);
+    } else if (!isfinite(v)) {
+        ev_put(e, "null", 4);
+    } else {
+        char tmp[32];
+        int n = snprintf(tmp, sizeof(tmp), "%.9g", v);
+        ev_put(e, tmp, (size_t)n);
+    }
+}
+
+void event_str(EventOut *e, const char *key, const char *s)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (!s) {
+        if (e->opt.format == EVENT_OUT_MSGPACK) ev_byte(e, 0xc0);
+        else ev_put(e, "null", 4);
+        return;
+    }
+    size_t n = strlen(s);
+    if (e->opt.format == EVENT_OUT_MSGPACK) {
+        ev_mp_str(e, s, n);
+        return;
+    }
+    static const char hex[] = "0123456789abcdef";
+    ev_byte(e, '"');
+    size_t run = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        ev_put(e, s + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') {
+            ev_byte(e, '\\');
+            ev_byte(e, c);
+        } else {
+            char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            ev_put(e, u, sizeof(u));
+        }
+    }
+    ev_put(e, s + run, n - run);
+    ev_byte(e, '"');
+}
+
+void event_bool(EventOut *e, const char *key, bool v)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) ev_byte(e, v ? 0xc3 : 0xc2);
+    else if (v) ev_put(e, "true", 4);
+    else        ev_put(e, "false", 5);
+}
+
+void event_null(EventOut *e, const char *key)
+{
+    if (!e) return;
+    ev_key(e, key);
+    if (e->opt.format == EVENT_OUT_MSGPACK) ev_byte(e, 0xc0);
+    else ev_put(e, "null", 4);
+}
+
+/* ── Events ───────────────────────────────────────────────────────────── */
+
+void event_begin(EventOut *e, const char *name)
+{
+    if (!e) return;
+#ifdef _WIN32
+    EnterCriticalSection(&e->lock);
+#else
+    pthread_mutex_lock(&e->lock);
+#endif
+    e->start    = e->len;
+    e->depth    = 0;
+    e->overflow = 0;
+    e->drop     = false;
+    e->force    = strcmp(name, "stop") == 0;
+    if (e->opt.format == EVENT_OUT_MSGPACK) ev_be(e, 0, 4);  /* record length */
+    ev_open(e, false);
+    event_str(e, "event", name);
+}
+
+void event_end(EventOut *e)
+{
+    if (!e) return;
+    while (e->depth > 1) event_close(e);
+    EvLevel *top = &e->level[0];
+    if (e->opt.format == EVENT_OUT_MSGPACK) {
+        ev_patch_be32(e, top->hdr + 1, top->count);
+        if (!e->drop) ev_patch_be32(e, e->start, (uint32_t)(e->len - e->start - 4));
+    } else {
+        ev_put(e, "}\n", 2);
+    }
+    if (e->drop) e->len = e->start;         /* incomplete: never written */
+    e->start = e->len;
+    e->depth = 0;
+
+    size_t limit = e->opt.flush_bytes ? e->opt.flush_bytes : EVENT_OUT_BUF;
+    if (e->force || e->opt.flush_ms <= 0 || e->len >= limit ||
+        (stream_clock_wall_seconds() - e->last_flush) * 1000.0 >= e->opt.flush_ms)
+        ev_flush_locked(e);
+#ifdef _WIN32
+    LeaveCriticalSection(&e->lock);
+#else
+    pthread_mutex_unlock(&e->lock);
+#endif
+}
+
+/* ── Open / close ─────────────────────────────────────────────────────── */
+
+/* "host:port" or "[v6]:port" to a connected socket. */
+static NtripSocket ev_connect(const char *target)
+{
+    const char *colon = strrchr(target, ':');
+    if (!colon || !colon[1]) return NTRIP_INVALID_SOCKET;
+    char host[256];
+    const char *h = target;
+    size_t hl = (size_t)(colon - target);
+    if (hl >= 2 && h[0] == '[' && h[hl - 1] == ']') {
+        h++;
+        hl -= 2;
+    }
+    if (hl == 0 || hl >= sizeof(host)) return NTRIP_INVALID_SOCKET;
+    memcpy(host, h, hl);
+    host[hl] = '\0';
+    int port = atoi(colon + 1);
+    if (port <= 0 || port > 65535) return NTRIP_INVALID_SOCKET;
+
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];
+    int n = ntrip_dns_lookup(host, port, addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+    if (n <= 0) return NTRIP_INVALID_SOCKET;
+    NtripSocket s = ntrip_connect_race(addrs, n, 0, 0, NULL);
+#ifdef SO_NOSIGPIPE
+    if (s != NTRIP_INVALID_SOCKET) {
+        int one = 1;
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+    }
+#endif
+    return s;
+}
+
+EventOut *event_out_open(const char *target, const EventOutOptions *opt)
+{
+    EventOut *e = (EventOut *)calloc(1, sizeof(*e));
+    if (!e) return NULL;
+    if (opt) e->opt = *opt;
+    e->fd   = -1;
+    e->sock = NTRIP_INVALID_SOCKET;
+    e->cap  = EVENT_OUT_BUF;
+    e->buf  = (unsigned char *)malloc(e->cap);
+    if (!e->buf) {
+        free(e);
+        return NULL;
+    }
+
+    if (!target || !target[0]) {
+        e->target = EV_TARGET_STDERR;
+    } else if (strspn(target, "0123456789") == strlen(target)) {
+        e->target = EV_TARGET_FD;
+        e->fd     = atoi(target);
+#ifdef _WIN32
+        bool ok = _get_osfhandle(e->fd) != -1;
+#else
+        bool ok = fcntl(e->fd, F_GETFD) != -1;
+#endif
+        if (!ok) {
+            free(e->buf);
+            free(e);
+            return NULL;
+        }
+    } else {
+        e->target = EV_TARGET_SOCKET;
+        e->sock   = ev_connect(target);
+        if (e->sock == NTRIP_INVALID_SOCKET) {
+            free(e->buf);
+            free(e);
+            return NULL;
+        }
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&e->lock);
+#else
+    pthread_mutex_init(&e->lock, NULL);
+#endif
+    e->last_flush = stream_clock_wall_seconds();
+    return e;
+}
+
+void event_out_flush(EventOut *e)
+{
+    if (!e) return;
+#ifdef _WIN32
+    EnterCriticalSection(&e->lock);
+    ev_flush_locked(e);
+    LeaveCriticalSection(&e->lock);
+#else
+    pthread_mutex_lock(&e->lock);
+    ev_flush_locked(e);
+    pthread_mutex_unlock(&e->lock);
+#endif
+}
+
+bool event_out_close(EventOut *e)
+{
+    if (!e) return true;
+    event_out_flush(e);
+    bool ok = !e->failed;
+    if (e->target == EV_TARGET_SOCKET) CLOSESOCKET(e->sock);
+#ifdef _WIN32
+    else if (e->target == EV_TARGET_FD) _close(e->fd);
+    DeleteCriticalSection(&e->lock);
+#else
+    else if (e->target == EV_TARGET_FD) close(e->fd);
+    pthread_mutex_destroy(&e->lock);
+#endif
+    free(e->buf);
+    free(e);
+    return ok;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file event_out.h
+ * @brief Buffered --json event stream: NDJSON or length-prefixed
+ *        MessagePack, to stderr, an inherited descriptor or a TCP socket.
+ *
+ * An event is built field by field into one preallocated buffer, with
+ * the numbers formatted by hand instead of through printf, and the
+ * buffer goes out in one write:
+ *   - after every event (the default, so a consumer sees each tick when
+ *     it happens), or
+ *   - batched: once @c flush_ms have passed since the last write or
+ *     @c flush_bytes are buffered, checked whenever an event ends, and on
+ *     event_out_flush() / event_out_close().  "stop" events always flush.
+ *
+ * Formats:
+ *   - @ref EVENT_OUT_NDJSON: one JSON object per line, the historical
+ *     --json output.
+ *   - @ref EVENT_OUT_MSGPACK: every event is a u32 big-endian byte count
+ *     followed by one MessagePack map (maps and arrays always with 32-bit
+ *     headers, so their sizes can be filled in when they close).  Doubles
+ *     are written as float64 at full precision, the decimals of
+ *     event_fixed() only apply to JSON.
+ *
+ * Events may come from several threads; event_begin() takes the writer's
+ * lock and event_end() releases it.  A target that cannot be written
+ * (closed socket, full disk) stops the stream: later events are dropped
+ * and event_out_close() reports it.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef EVENT_OUT_H
+#define EVENT_OUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Initial buffer size; one event larger than this grows it. */
+#define EVENT_OUT_BUF        (64 * 1024)
+
+/** @brief Nesting of objects and arrays one event may use. */
+#define EVENT_OUT_MAX_DEPTH  8
+
+typedef enum {
+    EVENT_OUT_NDJSON = 0,
+    EVENT_OUT_MSGPACK
+} EventOutFormat;
+
+/**
+ * @struct EventOutOptions
+ * @brief How events are encoded and batched.
+ *
+ * Fields:
+ *   - format:       NDJSON or MessagePack.
+ *   - flush_ms:     Longest time events stay buffered; 0 = write each event.
+ *   - flush_bytes:  Write once this much is buffered; 0 = @ref EVENT_OUT_BUF.
+ */
+typedef struct {
+    EventOutFormat format;
+    int            flush_ms;
+    size_t         flush_bytes;
+} EventOutOptions;
+
+/** @brief Opaque event writer. */
+typedef struct EventOut EventOut;
+
+/**
+ * @brief Open an event stream.
+ *
+ * @param target  NULL or "" = stderr; "N" = inherited file descriptor N
+ *                (e.g. 3 with `3>events.json`); "host:port" or
+ *                "[v6]:port" = TCP connection to a collector.  Winsock
+ *                must be initialised for a socket target on Windows.
+ * @param opt     Format and batching; NULL = NDJSON, unbatched.
+ * @return The writer, or NULL if the target cannot be opened.
+ */
+EventOut *event_out_open(const char *target, const EventOutOptions *opt);
+
+/** @brief Write what is buffered. */
+void event_out_flush(EventOut *e);
+
+/**
+ * @brief Flush, close a descriptor or socket target and free @p e.
+ * @return false if anything could not be written.
+ */
+bool event_out_close(EventOut *e);
+
+/** @brief Start event @p name: {"event":"<name>", ...  Takes the lock. */
+void event_begin(EventOut *e, const char *name);
+
+/** @brief Finish the event started by event_begin(), flush if due, unlock. */
+void event_end(EventOut *e);
+
+/*
+ * Fields.  @p key names the field inside an object and must be NULL for
+ * an element of an array.
+ */
+
+/** @brief Open a nested object; close it with event_close(). */
+void event_obj(EventOut *e, const char *key);
+
+/** @brief Open a nested array; close it with event_close(). */
+void event_arr(EventOut *e, const char *key);
+
+/** @brief Close the innermost event_obj() / event_arr(). */
+void event_close(EventOut *e);
+
+void event_int(EventOut *e, const char *key, int64_t v);
+void event_uint(EventOut *e, const char *key, uint64_t v);
+
+/** @brief @p v with @p decimals digits after the point in JSON ("%.Nf"). */
+void event_fixed(EventOut *e, const char *key, double v, int decimals);
+
+/** @brief @p v with 9 significant digits in JSON ("%.9g"). */
+void event_num(EventOut *e, const char *key, double v);
+
+/** @brief String (escaped for JSON), or null for NULL. */
+void event_str(EventOut *e, const char *key, const char *s);
+
+void event_bool(EventOut *e, const char *key, bool v);
+void event_null(EventOut *e, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_OUT_H */
@@ -0,0 +1,87 @@
+/**
+ * @file file_map.c
+ * @brief Read-only whole-file memory mapping (POSIX mmap / Win32 views).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "file_map.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool file_map_open(FileMap *m, const char *path)
+{
+    memset(m, 0, sizeof(*m));
+    if (!path) return false;
+
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz)) {
+        CloseHandle(f);
+        return false;
+    }
+    if (sz.QuadPart == 0) {            /* CreateFileMapping rejects 0 bytes */
+        CloseHandle(f);
+        return true;
+    }
+    HANDLE map = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(f);                    /* the mapping keeps the file open */
+    if (!map) return false;
+    const void *view = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(map);
+        return false;
+    }
+    m->data   = (const unsigned char *)view;
+    m->size   = (size_t)sz.QuadPart;
+    m->handle = map;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {             /* mmap rejects 0 bytes */
+        close(fd);
+        return true;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                         /* the mapping keeps the file open */
+    if (p == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    m->data = (const unsigned char *)p;
+    m->size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+void file_map_close(FileMap *m)
+{
+    if (!m) return;
+#ifdef _WIN32
+    if (m->data)   UnmapViewOfFile((LPCVOID)m->data);
+    if (m->handle) CloseHandle((HANDLE)m->handle);
+#else
+    if (m->data) munmap((void *)m->data, m->size);
+#endif
+    memset(m, 0, sizeof(*m));
+}
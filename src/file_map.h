@@ -0,0 +1,56 @@
+/**
+ * @file file_map.h
+ * @brief Read-only whole-file memory mapping (POSIX mmap / Win32 views).
+ *
+ * Maps a file read-only so large inputs (merged BRDC NAV files, RTCM
+ * captures) can be scanned in place instead of through stdio line or
+ * block reads.  The mapping is not NUL-terminated: callers must bound
+ * every scan by @c size.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct FileMap
+ * @brief A mapped file.
+ *
+ * Fields:
+ *   - data:    First byte of the file, or NULL for an empty file.
+ *   - size:    File size in bytes.
+ *   - handle:  Platform mapping handle (Win32 only); opaque.
+ */
+typedef struct {
+    const unsigned char *data;
+    size_t               size;
+    void                *handle;
+} FileMap;
+
+/**
+ * @brief Map @p path read-only.
+ *
+ * An empty file succeeds with @c data == NULL and @c size == 0.
+ *
+ * @return false if the file cannot be opened or mapped; @p m is zeroed.
+ */
+bool file_map_open(FileMap *m, const char *path);
+
+/** @brief Unmap @p m and zero it.  Safe on a zeroed or failed map. */
+void file_map_close(FileMap *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILE_MAP_H */
@@ -0,0 +1,518 @@
+/**
+ * @file fleet_collect.c
+ * @brief Collector of the summaries pushed by analyser nodes: the live
+ *        fleet view.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #ifndef _WIN32_WINNT
+    #define _WIN32_WINNT 0x0601     /* WSAPoll() needs Vista or later */
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #define CLOSESOCKET closesocket
+    #define SOCK_WOULDBLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+    #define collect_poll(p, n, t) WSAPoll((p), (ULONG)(n), (t))
+    typedef WSAPOLLFD CollectPollFd;
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #include <poll.h>
+    #define CLOSESOCKET close
+    #define SOCK_WOULDBLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+    #define collect_poll(p, n, t) poll((p), (nfds_t)(n), (t))
+    typedef struct pollfd CollectPollFd;
+#endif
+
+#include "fleet_collect.h"
+#include "fleet_push.h"
+#include "ntrip_connect.h"
+#include "ntrip_handler.h"
+#include "sky_file.h"
+#include "stream_clock.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COLLECT_RECV_CHUNK  65536
+#define COLLECT_N_SECTORS   (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+
+/* One node, by name: its newest summary and what was seen of it. */
+typedef struct {
+    char         peer[64];          /* address of the newest summary */
+    double       t_last;            /* wall monotonic time of the newest summary */
+    int64_t      first_unix;        /* Unix time of its first summary */
+    uint64_t     received;
+    uint64_t     lost;              /* sequence gaps */
+    uint64_t     restarts;          /* sequence started over */
+    FleetSummary last;
+} CollectNode;
+
+typedef struct {
+    NtripSocket    sock;
+    char           peer[64];
+    unsigned char *buf;
+    size_t         len, cap;
+    int            node;            /* CollectNode index, -1 before the first summary */
+} CollectConn;
+
+typedef struct {
+    NtripSocket   lsock;
+    CollectConn   conns[FLEET_COLLECT_MAX_CONNS];
+    int           n_conns;
+    CollectNode  *nodes;
+    int           n_nodes;
+    const char   *out_dir;
+    bool          quiet;
+    double        t0;
+    uint64_t      summaries;
+    uint64_t      rejected;         /* connections dropped for a bad message */
+} Collector;
+
+static const char *collect_state_name(int s)
+{
+    switch (s) {
+    case FLEET_STREAMING:  return "streaming";
+    case FLEET_CONNECTING: return "connecting";
+    default:               return "down";
+    }
+}
+
+/* ── Connections ───────────────────────────────────────────────────── */
+
+static void collect_drop(Collector *c, int i, const char *why)
+{
+    CollectConn *k = &c->conns[i];
+    if (k->node >= 0 && !c->quiet) {
+        fprintf(stderr, "[FLEET] Node \"%s\" (%s) %s\n", c->nodes[k->node].last.node,
+                k->peer, why);
+    } else if (!c->quiet) {
+        fprintf(stderr, "[FLEET] %s %s\n", k->peer, why);
+    }
+    CLOSESOCKET(k->sock);
+    free(k->buf);
+    c->conns[i] = c->conns[--c->n_conns];
+}
+
+static void collect_accept(Collector *c)
+{
+    struct sockaddr_in sa;
+    socklen_t sl = sizeof(sa);
+    NtripSocket s = accept(c->lsock, (struct sockaddr *)&sa, &sl);
+    if (s == NTRIP_INVALID_SOCKET) return;
+    if (c->n_conns == FLEET_COLLECT_MAX_CONNS) {
+        CLOSESOCKET(s);
+        return;
+    }
+    ntrip_socket_set_blocking(s, false);
+    CollectConn *k = &c->conns[c->n_conns++];
+    memset(k, 0, sizeof(*k));
+    k->sock = s;
+    k->node = -1;
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &sa.sin_addr, ip, sizeof(ip));
+    snprintf(k->peer, sizeof(k->peer), "%s:%d", ip, ntohs(sa.sin_port));
+}
+
+/* Keep @p s (moved in) as the newest summary of its node. */
+static void collect_summary(Collector *c, CollectConn *k, FleetSummary *s, double now)
+{
+    int n = 0;
+    while (n < c->n_nodes && strcmp(c->nodes[n].last.node, s->node) != 0) n++;
+    if (n == c->n_nodes) {
+        if (c->n_nodes == FLEET_COLLECT_MAX_NODES) {
+            fleet_summary_free(s);
+            return;
+        }
+        CollectNode *nodes = (CollectNode *)realloc(c->nodes, (size_t)(n + 1) * sizeof(*nodes));
+        if (!nodes) {
+            fleet_summary_free(s);
+            return;
+        }
+        c->nodes = nodes;
+        memset(&c->nodes[n], 0, sizeof(c->nodes[n]));
+        c->nodes[n].first_unix = s->unix_s;
+        c->n_nodes++;
+    }
+    CollectNode *nd = &c->nodes[n];
+    if (k->node != n) {
+        k->node = n;
+        if (!c->quiet)
+            fprintf(stderr, "[FLEET] Node \"%s\" %s from %s, %d streams\n", s->node,
+                    nd->received ? "back" : "joined", k->peer, s->n_streams);
+    }
+    if (nd->received) {
+        if (s->seq > nd->last.seq + 1)  nd->lost += s->seq - nd->last.seq - 1;
+        else if (s->seq <= nd->last.seq) nd->restarts++;
+    }
+    snprintf(nd->peer, sizeof(nd->peer), "%s", k->peer);
+    nd->t_last = now;
+    nd->received++;
+    fleet_summary_free(&nd->last);
+    nd->last = *s;
+    c->summaries++;
+}
+
+/* Read what @p k has and take every whole summary out of it. */
+static void collect_read(Collector *c, int i, double now)
+{
+    CollectConn *k = &c->conns[i];
+    if (k->cap - k->len < COLLECT_RECV_CHUNK) {
+        size_t cap = k->cap ? k->cap * 2 : 2 * COLLECT_RECV_CHUNK;
+        unsigned char *b = (unsigned char *)realloc(k->buf, cap);
+        if (!b) {
+            collect_drop(c, i, "dropped: out of memory");
+            return;
+        }
+        k->buf = b;
+        k->cap = cap;
+    }
+    int n = (int)recv(k->sock, (char *)k->buf + k->len, COLLECT_RECV_CHUNK, 0);
+    if (n < 0 && SOCK_WOULDBLOCK()) return;
+    if (n <= 0) {
+        collect_drop(c, i, "disconnected");
+        return;
+    }
+    k->len += (size_t)n;
+
+    size_t at = 0;
+    for (;;) {
+        long m = fleet_msg_len(k->buf + at, k->len - at);
+        if (m == 0 || (m > 0 && (size_t)m > k->len - at)) break;
+        FleetSummary s;
+        if (m < 0 || !fleet_decode(k->buf + at, (size_t)m, &s)) {
+            c->rejected++;
+            collect_drop(c, i, "dropped: not a valid summary");
+            return;
+        }
+        collect_summary(c, k, &s, now);
+        at += (size_t)m;
+    }
+    memmove(k->buf, k->buf + at, k->len - at);
+    k->len -= at;
+}
+
+/* ── Fleet view ────────────────────────────────────────────────────── */
+
+static bool collect_stale(const CollectNode *nd, double now)
+{
+    double iv = nd->last.interval_s ? nd->last.interval_s : FLEET_PUSH_INTERVAL_S;
+    return now - nd->t_last > FLEET_COLLECT_STALE * iv;
+}
+
+static int cmp_fleet_type(const void *a, const void *b)
+{
+    return ((const FleetType *)a)->msg_type - ((const FleetType *)b)->msg_type;
+}
+
+static void collect_print_nodes(const Collector *c, double now)
+{
+    int streams = 0, up = 0;
+    for (int n = 0; n < c->n_nodes; n++) {
+        streams += c->nodes[n].last.n_streams;
+        up      += !collect_stale(&c->nodes[n], now);
+    }
+    printf("\n[INFO] Fleet: %d nodes (%d reporting), %d streams, %.0f s\n",
+           c->n_nodes, up, streams, now - c->t0);
+    printf("+----------------------+------------------------+-----------+--------------+------------+----------+--------+--------+\n");
+    printf("| Node                 | Peer                   | Streaming |        Bytes |     Frames |      CRC |   Lost |    Age |\n");
+    printf("+----------------------+------------------------+-----------+--------------+------------+----------+--------+--------+\n");
+    for (int n = 0; n < c->n_nodes; n++) {
+        const CollectNode *nd = &c->nodes[n];
+        unsigned long long bytes = 0, frames = 0, crc = 0;
+        int streaming = 0;
+        for (int i = 0; i < nd->last.n_streams; i++) {
+            const FleetStream *s = &nd->last.streams[i];
+            bytes     += s->bytes;
+            frames    += s->frames;
+            crc       += s->crc_errors;
+            streaming += s->state == FLEET_STREAMING;
+        }
+        char st[16], age[16];
+        snprintf(st, sizeof(st), "%d/%d", streaming, nd->last.n_streams);
+        if (collect_stale(nd, now)) snprintf(age, sizeof(age), "stale");
+        else                        snprintf(age, sizeof(age), "%.0f s", now - nd->t_last);
+        printf("| %-20.20s | %-22.22s | %9s | %12llu | %10llu | %8llu | %6llu | %6s |\n",
+               nd->last.node, nd->peer, st, bytes, frames, crc,
+               (unsigned long long)nd->lost, age);
+    }
+    printf("+----------------------+------------------------+-----------+--------------+------------+----------+--------+--------+\n");
+}
+
+static void collect_print_streams(const Collector *c)
+{
+    printf("+----------------------+----------------------+------------+--------------+------------+----------+--------+------+\n");
+    printf("| Node                 | Mountpoint           | State      |        Bytes |     Frames |      CRC | Reconn | Sats |\n");
+    printf("+----------------------+----------------------+------------+--------------+------------+----------+--------+------+\n");
+    for (int n = 0; n < c->n_nodes; n++) {
+        const FleetSummary *su = &c->nodes[n].last;
+        for (int i = 0; i < su->n_streams; i++) {
+            const FleetStream *s = &su->streams[i];
+            int sats = 0;
+            for (int g = 0; g < FLEET_GNSS; g++) sats += sat_mask_count(s->sats[g]);
+            printf("| %-20.20s | %-20.20s | %-10s | %12llu | %10llu | %8llu | %6u | %4d |\n",
+                   su->node, s->mount, collect_state_name(s->state),
+                   (unsigned long long)s->bytes, (unsigned long long)s->frames,
+                   (unsigned long long)s->crc_errors, s->reconnects, sats);
+        }
+    }
+    printf("+----------------------+----------------------+------------+--------------+------------+----------+--------+------+\n");
+}
+
+/* Interval quantiles per message type over every stream of every node. */
+static void collect_print_intervals(const Collector *c, int streams)
+{
+    FleetType *fleet = (FleetType *)calloc(FLEET_MAX_TYPES, sizeof(FleetType));
+    if (!fleet) return;
+    int n_fleet = 0;
+    for (int n = 0; n < c->n_nodes; n++) {
+        const FleetSummary *su = &c->nodes[n].last;
+        for (int i = 0; i < su->n_streams; i++) {
+            const FleetStream *s = &su->streams[i];
+            for (int t = 0; t < s->n_types; t++) {
+                if (s->types[t].dt.count == 0) continue;
+                int f = 0;
+                while (f < n_fleet && fleet[f].msg_type != s->types[t].msg_type) f++;
+                if (f == n_fleet) {
+                    if (n_fleet == FLEET_MAX_TYPES) continue;
+                    fleet[n_fleet++].msg_type = s->types[t].msg_type;
+                }
+                fleet[f].frames += s->types[t].frames;
+                qsketch_merge(&fleet[f].dt, &s->types[t].dt);
+            }
+        }
+    }
+    if (n_fleet > 0) {
+        char title[64];
+        qsort(fleet, (size_t)n_fleet, sizeof(FleetType), cmp_fleet_type);
+        snprintf(title, sizeof(title), "[INFO] Message intervals, fleet of %d streams", streams);
+        qsketch_print_head(title, stdout);
+        for (int f = 0; f < n_fleet; f++)
+            qsketch_print_row(fleet[f].msg_type, &fleet[f].dt, stdout);
+        qsketch_print_foot(stdout);
+    }
+    free(fleet);
+}
+
+/* Per GNSS: the streams that saw it in their last interval, and the
+ * satellites any of them saw. */
+static void collect_print_sats(const Collector *c)
+{
+    SatMask any[FLEET_GNSS] = { 0 };
+    int streams[FLEET_GNSS] = { 0 };
+    for (int n = 0; n < c->n_nodes; n++) {
+        const FleetSummary *su = &c->nodes[n].last;
+        for (int i = 0; i < su->n_streams; i++) {
+            for (int g = 0; g < FLEET_GNSS; g++) {
+                if (!su->streams[i].sats[g]) continue;
+                any[g] |= su->streams[i].sats[g];
+                streams[g]++;
+            }
+        }
+    }
+    bool header = false;
+    for (int g = 0; g < FLEET_GNSS; g++) {
+        if (!any[g]) continue;
+        if (!header) {
+            printf("[INFO] Satellites seen in the last interval\n");
+            printf("+-----------+---------+------+\n");
+            printf("| GNSS      | Streams | Sats |\n");
+            printf("+-----------+---------+------+\n");
+            header = true;
+        }
+        printf("| %-9s | %7d | %4d |\n", gnss_name_from_id(g), streams[g],
+               sat_mask_count(any[g]));
+    }
+    if (header) printf("+-----------+---------+------+\n");
+}
+
+/* DIR/<MOUNT>.sky for every mountpoint some node sends a grid of, summed
+ * over the nodes that send it. */
+static void collect_write_sky(const Collector *c)
+{
+    if (!c->out_dir) return;
+    SkyRenderSector *grid = (SkyRenderSector *)malloc(COLLECT_N_SECTORS * sizeof(*grid));
+    if (!grid) return;
+    for (int n = 0; n < c->n_nodes; n++) {
+        const FleetSummary *su = &c->nodes[n].last;
+        for (int i = 0; i < su->n_streams; i++) {
+            const FleetStream *s = &su->streams[i];
+            if (!s->sky) continue;
+
+            /* Done at the first node that has this mountpoint. */
+            bool seen = false;
+            for (int m = 0; m < n && !seen; m++) {
+                const FleetSummary *o = &c->nodes[m].last;
+                for (int j = 0; j < o->n_streams && !seen; j++)
+                    seen = o->streams[j].sky && strcmp(o->streams[j].mount, s->mount) == 0;
+            }
+            for (int j = 0; j < i && !seen; j++)
+                seen = su->streams[j].sky && strcmp(su->streams[j].mount, s->mount) == 0;
+            if (seen) continue;
+
+            SkyFileMeta meta;
+            memset(grid, 0, COLLECT_N_SECTORS * sizeof(*grid));
+            memset(&meta, 0, sizeof(meta));
+            for (int m = n; m < c->n_nodes; m++) {
+                const CollectNode *nd = &c->nodes[m];
+                for (int j = 0; j < nd->last.n_streams; j++) {
+                    const FleetStream *o = &nd->last.streams[j];
+                    if (!o->sky || strcmp(o->mount, s->mount) != 0) continue;
+                    SkyFileMeta om;
+                    memset(&om, 0, sizeof(om));
+                    om.arp_valid = o->arp_valid;
+                    om.arp_x     = o->arp_x;
+                    om.arp_y     = o->arp_y;
+                    om.arp_z     = o->arp_z;
+                    om.t_first   = nd->first_unix;
+                    om.t_last    = nd->last.unix_s;
+                    om.runs      = 1;
+                    for (int g = 0; g < FLEET_GNSS; g++)
+                        if (o->sats[g]) om.gnss_mask |= 1u << g;
+                    snprintf(om.mountpoint, sizeof(om.mountpoint), "%s", o->mount);
+                    if (!sky_file_add(grid, &meta, o->sky, &om))
+                        fprintf(stderr, "[FLEET] %s: node \"%s\" reports another ARP; "
+                                "grids added anyway\n", o->mount, nd->last.node);
+                }
+            }
+
+            char name[64], path[512];
+            size_t k = 0;
+            for (const char *p = s->mount; *p && k < sizeof(name) - 1; p++)
+                name[k++] = (isalnum((unsigned char)*p) || *p == '-') ? *p : '_';
+            name[k] = '\0';
+            size_t len = strlen(c->out_dir);
+            bool sep = len && (c->out_dir[len - 1] == '/' || c->out_dir[len - 1] == '\\');
+            snprintf(path, sizeof(path), "%s%s%s" SKY_FILE_EXT, c->out_dir, sep ? "" : "/", name);
+            sky_file_write(path, grid, &meta);
+        }
+    }
+    free(grid);
+}
+
+static void collect_report(const Collector *c, double now)
+{
+    int streams = 0;
+    for (int n = 0; n < c->n_nodes; n++) streams += c->nodes[n].last.n_streams;
+    collect_print_nodes(c, now);
+    if (streams == 0) return;
+    collect_print_streams(c);
+    collect_print_intervals(c, streams);
+    collect_print_sats(c);
+    fflush(stdout);
+    collect_write_sky(c);
+}
+
+/* ── Entry point ───────────────────────────────────────────────────── */
+
+static NtripSocket collect_listen(const char *addr, int port)
+{
+    const char *shown = addr && addr[0] ? addr : "0.0.0.0";
+    NtripSocket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NTRIP_INVALID_SOCKET) return s;
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = htons((unsigned short)port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (addr && addr[0] && inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "[ERROR] --collect: \"%s\" is not an IPv4 address\n", addr);
+        CLOSESOCKET(s);
+        return NTRIP_INVALID_SOCKET;
+    }
+    if (bind(s, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(s, 64) != 0) {
+        fprintf(stderr, "[ERROR] --collect: cannot listen on %s:%d\n", shown, port);
+        CLOSESOCKET(s);
+        return NTRIP_INVALID_SOCKET;
+    }
+    ntrip_socket_set_blocking(s, false);
+    fprintf(stderr, "[FLEET] Collecting node summaries on %s:%d\n", shown, port);
+    return s;
+}
+
+int fleet_collect_run(const char *addr, int port, const char *out_dir,
+                      int duration_s, const volatile int *stop_flag, bool quiet)
+{
+    Collector *c = (Collector *)calloc(1, sizeof(*c));
+    if (!c) return -1;
+    c->lsock = collect_listen(addr, port);
+    if (c->lsock == NTRIP_INVALID_SOCKET) {
+        free(c);
+        return -1;
+    }
+    c->out_dir = out_dir && out_dir[0] ? out_dir : NULL;
+    c->quiet   = quiet;
+    c->t0      = stream_clock_wall_seconds();
+    double t_report = c->t0 + FLEET_COLLECT_REPORT_S;
+    double t_status = c->t0 + FLEET_COLLECT_STATUS_S;
+    CollectPollFd pfd[FLEET_COLLECT_MAX_CONNS + 1];
+
+    for (;;) {
+        double now = stream_clock_wall_seconds();
+        if (stop_flag && *stop_flag) break;
+        if (duration_s > 0 && now - c->t0 >= duration_s) break;
+        if (now >= t_report) {
+            collect_report(c, now);
+            t_report += FLEET_COLLECT_REPORT_S;
+        }
+        if (now >= t_status) {
+            if (!quiet) {
+                int up = 0, streams = 0, streaming = 0;
+                for (int n = 0; n < c->n_nodes; n++) {
+                    up      += !collect_stale(&c->nodes[n], now);
+                    streams += c->nodes[n].last.n_streams;
+                    for (int i = 0; i < c->nodes[n].last.n_streams; i++)
+                        streaming += c->nodes[n].last.streams[i].state == FLEET_STREAMING;
+                }
+                fprintf(stderr, "[FLEET] t=%4.0fs  nodes %d/%d reporting  streaming %d/%d  "
+                        "summaries %llu\n", now - c->t0, up, c->n_nodes, streaming, streams,
+                        (unsigned long long)c->summaries);
+            }
+            t_status += FLEET_COLLECT_STATUS_S;
+        }
+
+        pfd[0].fd      = c->lsock;
+        pfd[0].events  = POLLIN;
+        pfd[0].revents = 0;
+        for (int i = 0; i < c->n_conns; i++) {
+            pfd[i + 1].fd      = c->conns[i].sock;
+            pfd[i + 1].events  = POLLIN;
+            pfd[i + 1].revents = 0;
+        }
+        int n_pfd = c->n_conns + 1;
+        if (collect_poll(pfd, n_pfd, 250) <= 0) continue;
+        now = stream_clock_wall_seconds();
+        /* Backwards: collect_drop() moves the last connection into the gap. */
+        for (int i = n_pfd - 2; i >= 0; i--) {
+            if (pfd[i + 1].revents & (POLLIN | POLLERR | POLLHUP))
+                collect_read(c, i, now);
+        }
+        if (pfd[0].revents & POLLIN) collect_accept(c);
+    }
+
+    double now = stream_clock_wall_seconds();
+    collect_report(c, now);
+    if (!quiet)
+        fprintf(stderr, "[FLEET] %llu summaries from %d nodes, %llu connections rejected\n",
+                (unsigned long long)c->summaries, c->n_nodes, (unsigned long long)c->rejected);
+    int rc = c->summaries ? 0 : 1;
+    c->quiet = true;
+    while (c->n_conns) collect_drop(c, c->n_conns - 1, "disconnected");
+    CLOSESOCKET(c->lsock);
+    for (int n = 0; n < c->n_nodes; n++) fleet_summary_free(&c->nodes[n].last);
+    free(c->nodes);
+    free(c);
+    return rc;
+}
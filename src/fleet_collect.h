@@ -0,0 +1,77 @@
+/**
+ * @file fleet_collect.h
+ * @brief Collector of the summaries pushed by analyser nodes: the live
+ *        fleet view.
+ *
+ * `--collect [ADDR:]PORT` listens for the nodes started with
+ * `--push HOST:PORT` (fleet_push.h) and keeps the newest summary of each
+ * node, matched by node name so a node that reconnects -- or restarts
+ * with a new sequence -- carries on where it was.  All connections are
+ * served on one thread with poll() / WSAPoll(); a node may send from any
+ * address, and any number of nodes may come and go.
+ *
+ * Every @ref FLEET_COLLECT_REPORT_S (and when the run ends) the fleet
+ * view is printed on stdout, built by merging the newest summaries:
+ *
+ *   - per node: streams up, bytes, frames, CRC errors, summaries lost
+ *     on the way (sequence gaps) and the age of the newest one; a node
+ *     silent for @ref FLEET_COLLECT_STALE of its intervals is "stale"
+ *   - per stream: state, totals, reconnects and the satellites seen in
+ *     the node's last interval
+ *   - interval p50 .. p99.9 per message type over every stream of the
+ *     fleet (the QSketches merged exactly)
+ *   - per GNSS: the streams that see it and the satellites seen by any
+ *
+ * With `-o DIR`, the sector grids of summaries pushed by `--sky
+ * --mounts-file` nodes are added up per mountpoint (sky_file_add()) and
+ * written as DIR/<MOUNT>.sky at every report -- `--merge` renders them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef FLEET_COLLECT_H
+#define FLEET_COLLECT_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Seconds between two fleet reports on stdout. */
+#define FLEET_COLLECT_REPORT_S  60
+
+/** @brief Seconds between two status lines on stderr. */
+#define FLEET_COLLECT_STATUS_S  10
+
+/** @brief Node connections served at once. */
+#define FLEET_COLLECT_MAX_CONNS 256
+
+/** @brief Distinct node names kept. */
+#define FLEET_COLLECT_MAX_NODES 1024
+
+/** @brief Push intervals without a summary after which a node is stale. */
+#define FLEET_COLLECT_STALE     3
+
+/**
+ * @brief Collect summaries on @p addr (IPv4, "" = all) : @p port until
+ *        the duration ends or @p stop_flag is set.
+ *
+ * Winsock must already be initialised on Windows.
+ *
+ * @param out_dir     Directory for the merged .sky grids; NULL = none.
+ * @param duration_s  Stop after this many seconds; 0 runs until @p stop_flag.
+ * @param quiet       No status lines or node join / leave lines on stderr.
+ * @return 0 if any summary was received, 1 if none was, -1 if the port
+ *         cannot be opened.
+ */
+int fleet_collect_run(const char *addr, int port, const char *out_dir,
+                      int duration_s, const volatile int *stop_flag, bool quiet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLEET_COLLECT_H */
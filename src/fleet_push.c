@@ -0,0 +1,673 @@
+/**
+ * @file fleet_push.c
+ * @brief Compact, mergeable stream summaries pushed from analyser nodes
+ *        to a collector.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+    #define CLOSESOCKET closesocket
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #define CLOSESOCKET close
+#endif
+
+#include "fleet_push.h"
+#include "ntrip_connect.h"
+#include "stream_clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define FLEET_MAGIC        "NAFLT\r\n\x1a"
+#define FLEET_VERSION      1
+#define FLEET_FLAG_ARP     1u
+#define FLEET_N_SECTORS    (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+#define FLEET_IO_TIMEOUT_S 5            /* a collector that takes no bytes this long is dropped */
+
+/* CRC-32 (IEEE, reflected), bitwise: a summary is a few kB per stream. */
+static uint32_t fleet_crc32(const unsigned char *p, size_t n)
+{
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++) {
+        c ^= p[i];
+        for (int k = 0; k < 8; k++)
+            c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+/* ── Writer ───────────────────────────────────────────────────────────── */
+
+typedef struct {
+    unsigned char **buf;
+    size_t         *cap;
+    size_t          len;
+    bool            oom;
+} FleetWriter;
+
+static unsigned char *fw_room(FleetWriter *w, size_t n)
+{
+    if (w->oom) return NULL;
+    if (w->len + n > *w->cap) {
+        size_t cap = *w->cap ? *w->cap : 4096;
+        while (cap < w->len + n) cap *= 2;
+        unsigned char *b = (unsigned char *)realloc(*w->buf, cap);
+        if (!b) {
+            w->oom = true;
+            return NULL;
+        }
+        *w->buf = b;
+        *w->cap = cap;
+    }
+    unsigned char *p = *w->buf + w->len;
+    w->len += n;
+    return p;
+}
+
+static void fw_le(FleetWriter *w, uint64_t v, int bytes)
+{
+    unsigned char *p = fw_room(w, (size_t)bytes);
+    if (!p) return;
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void fw_u8(FleetWriter *w, unsigned v)   { fw_le(w, v, 1); }
+static void fw_u16(FleetWriter *w, unsigned v)  { fw_le(w, v, 2); }
+static void fw_u32(FleetWriter *w, uint32_t v)  { fw_le(w, v, 4); }
+static void fw_u64(FleetWriter *w, uint64_t v)  { fw_le(w, v, 8); }
+
+static void fw_f64(FleetWriter *w, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    fw_u64(w, v);
+}
+
+/* @p s into a fixed field of @p n bytes, NUL padded. */
+static void fw_str(FleetWriter *w, const char *s, size_t n)
+{
+    unsigned char *p = fw_room(w, n);
+    if (!p) return;
+    memset(p, 0, n);
+    size_t l = strlen(s);
+    memcpy(p, s, l < n ? l : n - 1);
+}
+
+static void fw_type(FleetWriter *w, const FleetType *t)
+{
+    const QSketch *q = &t->dt;
+    unsigned bins = 0;
+    for (int b = 0; b < QSKETCH_BINS; b++) bins += q->bin[b] != 0;
+    fw_u16(w, (unsigned)t->msg_type);
+    fw_u16(w, bins);
+    fw_u64(w, t->frames);
+    fw_u64(w, q->count);
+    fw_u64(w, q->zero);
+    fw_f64(w, q->min);
+    fw_f64(w, q->max);
+    fw_f64(w, q->sum);
+    fw_u32(w, (uint32_t)q->key_lo);
+    for (int b = 0; b < QSKETCH_BINS; b++) {
+        if (!q->bin[b]) continue;
+        fw_u8(w, (unsigned)b);
+        fw_u32(w, q->bin[b]);
+    }
+}
+
+static void fw_stream(FleetWriter *w, const FleetStream *s)
+{
+    int n_types = s->n_types < FLEET_MAX_TYPES ? s->n_types : FLEET_MAX_TYPES;
+    fw_str(w, s->mount, FLEET_MOUNT_MAX);
+    fw_u8(w, (unsigned)s->state);
+    fw_u8(w, FLEET_GNSS);
+    fw_u16(w, (unsigned)n_types);
+    fw_u32(w, s->reconnects);
+    fw_u64(w, s->bytes);
+    fw_u64(w, s->frames);
+    fw_u64(w, s->crc_errors);
+    for (int g = 0; g < FLEET_GNSS; g++) fw_u64(w, s->sats[g]);
+    for (int t = 0; t < n_types; t++) fw_type(w, &s->types[t]);
+
+    fw_u8(w, s->arp_valid ? FLEET_FLAG_ARP : 0);
+    fw_f64(w, s->arp_x);
+    fw_f64(w, s->arp_y);
+    fw_f64(w, s->arp_z);
+    size_t at_n = w->len;
+    fw_u32(w, 0);
+    if (!s->sky) return;
+    uint32_t n = 0;
+    for (int k = 0; k < FLEET_N_SECTORS; k++) {
+        const SkyRenderSector *c = &s->sky[k];
+        if (c->expected <= 0 && c->observed <= 0) continue;
+        fw_u32(w, (uint32_t)k);
+        fw_u32(w, (uint32_t)(c->observed > 0 ? c->observed : 0));
+        fw_u32(w, (uint32_t)(c->expected > 0 ? c->expected : 0));
+        n++;
+    }
+    if (w->oom) return;
+    unsigned char *p = *w->buf + at_n;
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(n >> (8 * i));
+}
+
+size_t fleet_encode(const FleetSummary *s, unsigned char **buf, size_t *cap)
+{
+    FleetWriter w = { buf, cap, 0, false };
+    int n = s->n_streams < FLEET_MAX_STREAMS ? s->n_streams : FLEET_MAX_STREAMS;
+
+    fw_room(&w, FLEET_HEADER_SIZE);     /* filled in below */
+    fw_str(&w, s->node, FLEET_NODE_MAX);
+    fw_u64(&w, s->seq);
+    fw_u64(&w, (uint64_t)s->unix_s);
+    fw_u32(&w, s->interval_s);
+    fw_u32(&w, s->uptime_s);
+    fw_u32(&w, (uint32_t)n);
+    for (int i = 0; i < n; i++) fw_stream(&w, &s->streams[i]);
+    if (w.oom || w.len - FLEET_HEADER_SIZE > FLEET_MSG_MAX) return 0;
+
+    unsigned char *h = *buf;
+    size_t body = w.len - FLEET_HEADER_SIZE;
+    uint32_t crc = fleet_crc32(h + FLEET_HEADER_SIZE, body);
+    memcpy(h, FLEET_MAGIC, 8);
+    for (int i = 0; i < 2; i++) h[8 + i]  = (unsigned char)(FLEET_VERSION >> (8 * i));
+    for (int i = 0; i < 2; i++) h[10 + i] = (unsigned char)(FLEET_HEADER_SIZE >> (8 * i));
+    for (int i = 0; i < 4; i++) h[12 + i] = (unsigned char)((uint32_t)body >> (8 * i));
+    for (int i = 0; i < 4; i++) h[16 + i] = (unsigned char)(crc >> (8 * i));
+    memset(h + 20, 0, 4);
+    return w.len;
+}
+
+/* ── Reader ───────────────────────────────────────────────────────────── */
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool                 bad;
+} FleetReader;
+
+static uint64_t fr_le(FleetReader *r, int bytes)
+{
+    if (r->bad || r->end - r->p < bytes) {
+        r->bad = true;
+        return 0;
+    }
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | r->p[i];
+    r->p += bytes;
+    return v;
+}
+
+static unsigned fr_u8(FleetReader *r)   { return (unsigned)fr_le(r, 1); }
+static unsigned fr_u16(FleetReader *r)  { return (unsigned)fr_le(r, 2); }
+static uint32_t fr_u32(FleetReader *r)  { return (uint32_t)fr_le(r, 4); }
+static uint64_t fr_u64(FleetReader *r)  { return fr_le(r, 8); }
+
+static double fr_f64(FleetReader *r)
+{
+    uint64_t v = fr_u64(r);
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+static void fr_str(FleetReader *r, char *dst, size_t n)
+{
+    if (r->bad || (size_t)(r->end - r->p) < n) {
+        r->bad = true;
+        dst[0] = '\0';
+        return;
+    }
+    memcpy(dst, r->p, n);
+    dst[n - 1] = '\0';
+    r->p += n;
+}
+
+static void fr_type(FleetReader *r, FleetType *t)
+{
+    QSketch *q = &t->dt;
+    t->msg_type = (int)fr_u16(r);
+    unsigned bins = fr_u16(r);
+    t->frames = fr_u64(r);
+    q->count  = fr_u64(r);
+    q->zero   = fr_u64(r);
+    q->min    = fr_f64(r);
+    q->max    = fr_f64(r);
+    q->sum    = fr_f64(r);
+    q->key_lo = (int32_t)fr_u32(r);
+    if (bins > QSKETCH_BINS) r->bad = true;
+    for (unsigned b = 0; b < bins && !r->bad; b++) {
+        unsigned k = fr_u8(r);
+        uint32_t v = fr_u32(r);
+        if (k >= QSKETCH_BINS) r->bad = true;
+        else                   q->bin[k] = v;
+    }
+}
+
+static void fr_stream(FleetReader *r, FleetStream *s)
+{
+    fr_str(r, s->mount, FLEET_MOUNT_MAX);
+    s->state = (int)fr_u8(r);
+    unsigned n_gnss = fr_u8(r);
+    unsigned n_types = fr_u16(r);
+    s->reconnects = fr_u32(r);
+    s->bytes      = fr_u64(r);
+    s->frames     = fr_u64(r);
+    s->crc_errors = fr_u64(r);
+    for (unsigned g = 0; g < n_gnss; g++) {
+        uint64_t m = fr_u64(r);
+        if (g < FLEET_GNSS) s->sats[g] = m;
+    }
+    if (n_types > FLEET_MAX_TYPES) r->bad = true;
+    if (r->bad) return;
+    if (n_types) {
+        s->types = (FleetType *)calloc(n_types, sizeof(FleetType));
+        if (!s->types) {
+            r->bad = true;
+            return;
+        }
+    }
+    for (unsigned t = 0; t < n_types && !r->bad; t++) fr_type(r, &s->types[t]);
+    s->n_types = (int)n_types;
+
+    s->arp_valid = (fr_u8(r) & FLEET_FLAG_ARP) != 0;
+    s->arp_x = fr_f64(r);
+    s->arp_y = fr_f64(r);
+    s->arp_z = fr_f64(r);
+    uint32_t n = fr_u32(r);
+    if (r->bad || n == 0) return;
+    if (n > FLEET_N_SECTORS || (size_t)(r->end - r->p) < (size_t)n * 12) {
+        r->bad = true;
+        return;
+    }
+    s->sky = (SkyRenderSector *)calloc(FLEET_N_SECTORS, sizeof(SkyRenderSector));
+    if (!s->sky) {
+        r->bad = true;
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k   = fr_u32(r);
+        uint32_t obs = fr_u32(r);
+        uint32_t exp = fr_u32(r);
+        if (k >= FLEET_N_SECTORS) {
+            r->bad = true;
+            return;
+        }
+        s->sky[k].observed = obs > INT32_MAX ? INT32_MAX : (int)obs;
+        s->sky[k].expected = exp > INT32_MAX ? INT32_MAX : (int)exp;
+    }
+}
+
+long fleet_msg_len(const unsigned char *buf, size_t len)
+{
+    if (len < FLEET_HEADER_SIZE) return 0;
+    if (memcmp(buf, FLEET_MAGIC, 8) != 0) return -1;
+    unsigned hdr  = (unsigned)(buf[10] | (buf[11] << 8));
+    uint32_t body = 0;
+    for (int i = 3; i >= 0; i--) body = (body << 8) | buf[12 + i];
+    if (hdr < FLEET_HEADER_SIZE || body > FLEET_MSG_MAX) return -1;
+    return (long)(hdr + body);
+}
+
+bool fleet_decode(const unsigned char *buf, size_t len, FleetSummary *out)
+{
+    memset(out, 0, sizeof(*out));
+    long total = fleet_msg_len(buf, len);
+    if (total <= 0 || (size_t)total > len) return false;
+    unsigned hdr = (unsigned)(buf[10] | (buf[11] << 8));
+    unsigned version = (unsigned)(buf[8] | (buf[9] << 8));
+    uint32_t crc = 0;
+    for (int i = 3; i >= 0; i--) crc = (crc << 8) | buf[16 + i];
+    if (version != FLEET_VERSION ||
+        fleet_crc32(buf + hdr, (size_t)total - hdr) != crc) return false;
+
+    FleetReader r = { buf + hdr, buf + total, false };
+    fr_str(&r, out->node, FLEET_NODE_MAX);
+    out->seq        = fr_u64(&r);
+    out->unix_s     = (int64_t)fr_u64(&r);
+    out->interval_s = fr_u32(&r);
+    out->uptime_s   = fr_u32(&r);
+    uint32_t n = fr_u32(&r);
+    if (n > FLEET_MAX_STREAMS) r.bad = true;
+    if (!r.bad && n) {
+        out->streams = (FleetStream *)calloc(n, sizeof(FleetStream));
+        if (!out->streams) r.bad = true;
+    }
+    for (uint32_t i = 0; i < n && !r.bad; i++) {
+        fr_stream(&r, &out->streams[i]);
+        out->n_streams = (int)i + 1;    /* so a half-read one is freed, too */
+    }
+    if (r.bad) {
+        fleet_summary_free(out);
+        return false;
+    }
+    return true;
+}
+
+void fleet_summary_free(FleetSummary *s)
+{
+    for (int i = 0; i < s->n_streams; i++) {
+        free(s->streams[i].types);
+        free(s->streams[i].sky);
+    }
+    free(s->streams);
+    memset(s, 0, sizeof(*s));
+}
+
+/* ── Sender ───────────────────────────────────────────────────────────── */
+
+struct FleetPush {
+    char            target[256];
+    char            host[256];
+    int             port;
+    char            node[FLEET_NODE_MAX];
+    bool            quiet;
+    const SkyMulti *sky;
+    uint64_t        seq;
+    unsigned char  *enc;            /* submitter: encode buffer */
+    size_t          enc_cap;
+    unsigned char  *pending;        /* under lock: the summary waiting */
+    size_t          pending_len;
+    size_t          pending_cap;
+    unsigned char  *out;            /* thread: the summary being sent */
+    size_t          out_len;
+    size_t          out_cap;
+    int             stop;           /* under lock */
+    uint64_t        sent;           /* thread */
+    uint64_t        replaced;       /* both, under lock */
+    uint64_t        failures;       /* thread */
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    HANDLE           thread;
+#else
+    pthread_mutex_t  lock;
+    pthread_t        thread;
+#endif
+};
+
+static void push_lock(FleetPush *p)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&p->lock);
+#else
+    pthread_mutex_lock(&p->lock);
+#endif
+}
+
+static void push_unlock(FleetPush *p)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&p->lock);
+#else
+    pthread_mutex_unlock(&p->lock);
+#endif
+}
+
+static void push_sleep_100ms(void)
+{
+#ifdef _WIN32
+    Sleep(100);
+#else
+    struct timespec ts = { 0, 100 * 1000 * 1000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* "host:port" or "[v6]:port" into @p host / @p port. */
+static bool fleet_split_target(const char *target, char *host, size_t host_len, int *port)
+{
+    const char *colon = strrchr(target, ':');
+    if (!colon || !colon[1]) return false;
+    const char *h = target;
+    size_t hl = (size_t)(colon - target);
+    if (hl >= 2 && h[0] == '[' && h[hl - 1] == ']') {
+        h++;
+        hl -= 2;
+    }
+    if (hl == 0 || hl >= host_len) return false;
+    char *end;
+    long v = strtol(colon + 1, &end, 10);
+    if (*end || v < 1 || v > 65535) return false;
+    memcpy(host, h, hl);
+    host[hl] = '\0';
+    *port = (int)v;
+    return true;
+}
+
+bool fleet_target_ok(const char *target)
+{
+    char host[256];
+    int port;
+    return fleet_split_target(target, host, sizeof(host), &port);
+}
+
+static NtripSocket push_connect(const FleetPush *p)
+{
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];
+    int n = ntrip_dns_lookup(p->host, p->port, addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+    if (n <= 0) return NTRIP_INVALID_SOCKET;
+    NtripSocket s = ntrip_connect_race(addrs, n, 0, 0, NULL);
+    if (s == NTRIP_INVALID_SOCKET) return s;
+#ifdef _WIN32
+    DWORD tmo = FLEET_IO_TIMEOUT_S * 1000;
+#else
+    struct timeval tmo = { FLEET_IO_TIMEOUT_S, 0 };
+#endif
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tmo, sizeof(tmo));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    return s;
+}
+
+static bool push_send_all(NtripSocket s, const unsigned char *buf, size_t len)
+{
+    while (len > 0) {
+        int chunk = len > (1u << 20) ? (1 << 20) : (int)len;
+        int n = (int)send(s, (const char *)buf, chunk, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Take the waiting summary, if any, as the one to send. */
+static bool push_take(FleetPush *p, bool pending_out, bool *stop)
+{
+    bool took = false;
+    push_lock(p);
+    *stop = p->stop != 0;
+    if (p->pending_len) {
+        unsigned char *b = p->out;
+        size_t cap = p->out_cap;
+        p->out         = p->pending;
+        p->out_cap     = p->pending_cap;
+        p->out_len     = p->pending_len;
+        p->pending     = b;
+        p->pending_cap = cap;
+        p->pending_len = 0;
+        if (pending_out) p->replaced++;
+        took = true;
+    }
+    push_unlock(p);
+    return took;
+}
+
+static void push_loop(FleetPush *p)
+{
+    NtripSocket sock = NTRIP_INVALID_SOCKET;
+    bool   have = false, stop = false, ever = false;
+    int    backoff_s = 1;
+    double t_retry = 0.0, t_stop = 0.0;
+
+    for (;;) {
+        bool was_stop = stop;
+        if (push_take(p, have, &stop)) have = true;
+        double now = stream_clock_wall_seconds();
+        if (stop && !was_stop) t_stop = now;
+        if (stop && (!have || now - t_stop >= FLEET_PUSH_FLUSH_S)) break;
+
+        if (have && sock == NTRIP_INVALID_SOCKET && now >= t_retry) {
+            sock = push_connect(p);
+            if (sock == NTRIP_INVALID_SOCKET) {
+                p->failures++;
+                if (!p->quiet && backoff_s == 1)
+                    fprintf(stderr, "[FLEET] Cannot reach collector %s; retrying\n", p->target);
+                t_retry   = now + backoff_s;
+                backoff_s = backoff_s * 2 > FLEET_PUSH_BACKOFF_MAX_S ? FLEET_PUSH_BACKOFF_MAX_S
+                                                                     : backoff_s * 2;
+            } else {
+                if (!p->quiet)
+                    fprintf(stderr, "[FLEET] %s collector %s as node \"%s\"\n",
+                            ever ? "Reconnected to" : "Pushing to", p->target, p->node);
+                ever      = true;
+                backoff_s = 1;
+            }
+        }
+        if (have && sock != NTRIP_INVALID_SOCKET) {
+            if (push_send_all(sock, p->out, p->out_len)) {
+                p->sent++;
+                have = false;
+            } else {
+                if (!p->quiet)
+                    fprintf(stderr, "[FLEET] Lost collector %s; reconnecting\n", p->target);
+                CLOSESOCKET(sock);
+                sock    = NTRIP_INVALID_SOCKET;
+                t_retry = now + backoff_s;
+                p->failures++;
+            }
+            continue;
+        }
+        push_sleep_100ms();
+    }
+    if (have) p->replaced++;            /* never went out */
+    if (sock != NTRIP_INVALID_SOCKET) CLOSESOCKET(sock);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall push_thread(void *arg)
+#else
+static void *push_thread(void *arg)
+#endif
+{
+    push_loop((FleetPush *)arg);
+    return 0;
+}
+
+FleetPush *fleet_push_open(const char *target, const char *node, bool quiet)
+{
+    FleetPush *p = (FleetPush *)calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    if (!fleet_split_target(target, p->host, sizeof(p->host), &p->port)) {
+        fprintf(stderr, "[ERROR] --push expects HOST:PORT, e.g. collector.example.net:7700\n");
+        free(p);
+        return NULL;
+    }
+    snprintf(p->target, sizeof(p->target), "%s", target);
+    if (node && node[0]) {
+        snprintf(p->node, sizeof(p->node), "%s", node);
+    } else if (gethostname(p->node, sizeof(p->node)) != 0 || !p->node[0]) {
+        snprintf(p->node, sizeof(p->node), "node");
+    }
+    p->node[sizeof(p->node) - 1] = '\0';
+    p->quiet = quiet;
+#ifdef _WIN32
+    InitializeCriticalSection(&p->lock);
+    p->thread = (HANDLE)_beginthreadex(NULL, 0, push_thread, p, 0, NULL);
+    bool started = p->thread != NULL;
+#else
+    pthread_mutex_init(&p->lock, NULL);
+    bool started = pthread_create(&p->thread, NULL, push_thread, p) == 0;
+#endif
+    if (!started) {
+        fprintf(stderr, "[ERROR] --push: cannot start the sender thread\n");
+#ifdef _WIN32
+        DeleteCriticalSection(&p->lock);
+#else
+        pthread_mutex_destroy(&p->lock);
+#endif
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void fleet_push_set_sky(FleetPush *p, const SkyMulti *sky)
+{
+    p->sky = sky;
+}
+
+void fleet_push_submit(FleetPush *p, FleetSummary *s, double uptime_s)
+{
+    snprintf(s->node, sizeof(s->node), "%s", p->node);
+    s->seq        = ++p->seq;
+    s->unix_s     = (int64_t)time(NULL);
+    s->interval_s = FLEET_PUSH_INTERVAL_S;
+    s->uptime_s   = uptime_s > 0.0 ? (uint32_t)uptime_s : 0;
+    for (int i = 0; p->sky && i < s->n_streams && i < p->sky->n; i++) {
+        const SkyMultiStation *st = &p->sky->st[i];
+        s->streams[i].sky       = st->sectors;
+        s->streams[i].arp_valid = st->frame.valid;
+        s->streams[i].arp_x     = st->frame.x;
+        s->streams[i].arp_y     = st->frame.y;
+        s->streams[i].arp_z     = st->frame.z;
+    }
+
+    size_t len = fleet_encode(s, &p->enc, &p->enc_cap);
+    if (len == 0) {
+        fprintf(stderr, "[FLEET] Summary %llu too large or out of memory; not sent\n",
+                (unsigned long long)s->seq);
+        return;
+    }
+    push_lock(p);
+    if (p->pending_len) p->replaced++;
+    unsigned char *b = p->pending;
+    size_t cap = p->pending_cap;
+    p->pending     = p->enc;
+    p->pending_cap = p->enc_cap;
+    p->pending_len = len;
+    p->enc         = b;
+    p->enc_cap     = cap;
+    push_unlock(p);
+}
+
+void fleet_push_close(FleetPush *p)
+{
+    if (!p) return;
+    push_lock(p);
+    p->stop = 1;
+    push_unlock(p);
+#ifdef _WIN32
+    WaitForSingleObject(p->thread, INFINITE);
+    CloseHandle(p->thread);
+    DeleteCriticalSection(&p->lock);
+#else
+    pthread_join(p->thread, NULL);
+    pthread_mutex_destroy(&p->lock);
+#endif
+    if (!p->quiet)
+        fprintf(stderr, "[FLEET] %llu summaries sent to %s (%llu not sent, %llu connect failures)\n",
+                (unsigned long long)p->sent, p->target, (unsigned long long)p->replaced,
+                (unsigned long long)p->failures);
+    free(p->enc);
+    free(p->pending);
+    free(p->out);
+    free(p);
+}
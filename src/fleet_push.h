@@ -0,0 +1,203 @@
+/**
+ * @file fleet_push.h
+ * @brief Compact, mergeable stream summaries pushed from analyser nodes
+ *        to a collector (fleet_collect.h).
+ *
+ * One analyser watches the mountpoints it can reach; a network operator
+ * runs several of them (one per site, per caster, per region) and wants
+ * one view.  Shipping raw frames to a central box would move the whole
+ * RTCM volume again, so a node sends summaries instead, every
+ * @ref FLEET_PUSH_INTERVAL_S, per stream:
+ *
+ *   - state, reconnects and the byte, frame and CRC-error totals
+ *   - per message type: frame count and the interval QSketch
+ *     (quantile_sketch.h), non-empty bins only
+ *   - per GNSS: the SatMask of the satellites seen since the last summary
+ *   - with `--sky`: the sector grid and ARP of the station
+ *
+ * Everything in a summary is a running total from the start of the node
+ * (the satellite masks excepted), so the collector keeps only the
+ * newest summary of each node: a summary lost on the way costs nothing,
+ * and the fleet view is the merge (qsketch_merge(), |, sky_file_add()) of
+ * the newest summaries.  A few kB per stream, however busy it is.
+ *
+ * The sending (connect, write, reconnect with doubling backoff up to
+ * @ref FLEET_PUSH_BACKOFF_MAX_S) runs on a thread of its own, so a
+ * collector that is slow or away never stalls the node's event loop.
+ * There is one slot: a summary not sent by the time the next one is
+ * submitted is replaced by it.
+ *
+ * Wire format over TCP, one message per summary (integers little-endian,
+ * doubles as IEEE-754 bit patterns):
+ * @code
+ *   header      24 B   "NAFLT\r\n\x1a", u16 version, u16 header size,
+ *                      u32 body length, u32 CRC-32 of the body, 4 B reserved
+ *   body               char node[32], u64 seq, i64 Unix time (s),
+ *                      u32 push interval (s), u32 uptime (s), u32 streams,
+ *                      then per stream:
+ *     char mountpoint[48], u8 state, u8 GNSS count G, u16 types T,
+ *     u32 reconnects, u64 bytes, u64 frames, u64 CRC errors,
+ *     u64 satellite mask x G (GNSS ID 0 .. G-1, PRN 1 in the top bit),
+ *     T x { u16 type, u16 bins B, u64 frames,
+ *           u64 count, u64 zero, f64 min, f64 max, f64 sum, i32 key_lo,
+ *           B x { u8 bin, u32 samples } },
+ *     u8 flags (bit 0: ARP valid), f64 ARP x, y, z (m),
+ *     u32 sectors S, S x { u32 index, u32 observed, u32 expected }
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef FLEET_PUSH_H
+#define FLEET_PUSH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "quantile_sketch.h"
+#include "sat_vis.h"
+#include "sky_multi.h"
+#include "sky_render.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Seconds between two summaries of a node. */
+#define FLEET_PUSH_INTERVAL_S    10
+
+/** @brief Longest wait between two connect attempts to the collector (s). */
+#define FLEET_PUSH_BACKOFF_MAX_S 60
+
+/** @brief Seconds fleet_push_close() waits for the last summary to go out. */
+#define FLEET_PUSH_FLUSH_S       3
+
+/** @brief Largest message accepted (bytes). */
+#define FLEET_MSG_MAX            (16u << 20)
+
+/** @brief Bytes of the message header. */
+#define FLEET_HEADER_SIZE        24
+
+#define FLEET_NODE_MAX           32     /**< node name, incl. NUL */
+#define FLEET_MOUNT_MAX          48     /**< mountpoint, incl. NUL */
+#define FLEET_GNSS               8      /**< satellite masks per stream, GNSS ID 0..7 */
+#define FLEET_MAX_TYPES          256    /**< message types per stream */
+#define FLEET_MAX_STREAMS        4096   /**< streams per summary */
+
+/** @brief Stream state as the node saw it. */
+typedef enum {
+    FLEET_DOWN = 0,             /**< failed or closed */
+    FLEET_CONNECTING,           /**< connecting or waiting to reconnect */
+    FLEET_STREAMING
+} FleetState;
+
+/** @brief One message type of a stream. */
+typedef struct {
+    int      msg_type;
+    uint64_t frames;
+    QSketch  dt;                /**< inter-arrival times (s) */
+} FleetType;
+
+/**
+ * @struct FleetStream
+ * @brief One stream of a summary.
+ */
+typedef struct {
+    char             mount[FLEET_MOUNT_MAX];
+    int              state;             /**< FleetState */
+    uint32_t         reconnects;
+    uint64_t         bytes;
+    uint64_t         frames;
+    uint64_t         crc_errors;
+    SatMask          sats[FLEET_GNSS];  /**< seen since the previous summary */
+    int              n_types;
+    FleetType       *types;
+    bool             arp_valid;
+    double           arp_x, arp_y, arp_z;
+    SkyRenderSector *sky;               /**< sector grid as sky_multi.h; NULL = none */
+} FleetStream;
+
+/**
+ * @struct FleetSummary
+ * @brief One message: a node and its streams.
+ */
+typedef struct {
+    char         node[FLEET_NODE_MAX];
+    uint64_t     seq;               /**< 1 for the first summary of a node run */
+    int64_t      unix_s;
+    uint32_t     interval_s;
+    uint32_t     uptime_s;
+    int          n_streams;
+    FleetStream *streams;
+} FleetSummary;
+
+/**
+ * @brief Encode @p s into @p *buf (grown with realloc(), @p *cap its size).
+ * @return Message length, 0 when out of memory.
+ */
+size_t fleet_encode(const FleetSummary *s, unsigned char **buf, size_t *cap);
+
+/**
+ * @brief Length of the message starting at @p buf.
+ * @return The whole message's length; 0 if fewer than
+ *         @ref FLEET_HEADER_SIZE bytes are there; -1 if it is not a
+ *         summary or longer than @ref FLEET_MSG_MAX.
+ */
+long fleet_msg_len(const unsigned char *buf, size_t len);
+
+/**
+ * @brief Decode one whole message into @p out (its arrays malloc()ed;
+ *        release with fleet_summary_free()).
+ * @return false on a CRC mismatch or a malformed body; @p out is empty then.
+ */
+bool fleet_decode(const unsigned char *buf, size_t len, FleetSummary *out);
+
+/** @brief Free the arrays of a decoded summary and zero it. */
+void fleet_summary_free(FleetSummary *s);
+
+/** @brief Sender of one node.  Opaque. */
+typedef struct FleetPush FleetPush;
+
+/**
+ * @brief Start pushing to @p target ("host:port" or "[v6]:port") as
+ *        node @p node (NULL or "" = the host name).
+ *
+ * @param quiet  No connect / lost lines on stderr.
+ * @return NULL if @p target is malformed or the thread cannot start
+ *         (reported on stderr).  Connecting happens on the thread.
+ */
+FleetPush *fleet_push_open(const char *target, const char *node, bool quiet);
+
+/**
+ * @brief Send the grid and ARP of @p sky->st[i] with stream i of each
+ *        summary (`--sky --mounts-file`); NULL stops.  @p sky is only
+ *        read inside fleet_push_submit(), on the caller's thread.
+ */
+void fleet_push_set_sky(FleetPush *p, const SkyMulti *sky);
+
+/**
+ * @brief Fill in the node, sequence number and times of @p s, encode it
+ *        and hand it to the sender, replacing a summary still waiting.
+ *
+ * @param uptime_s  Seconds the node has been running.
+ */
+void fleet_push_submit(FleetPush *p, FleetSummary *s, double uptime_s);
+
+/**
+ * @brief Send what is waiting (for at most @ref FLEET_PUSH_FLUSH_S),
+ *        stop the thread, report what was sent on stderr unless quiet
+ *        and free @p p.  NULL is ignored.
+ */
+void fleet_push_close(FleetPush *p);
+
+/** @brief Whether @p target looks like "host:port" (checked before connecting). */
+bool fleet_target_ok(const char *target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLEET_PUSH_H */
@@ -0,0 +1,213 @@
+/**
+ * @file geo_index.c
+ * @brief Nearest-mountpoint queries over the positions in a sourcetable.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "geo_index.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DEG2RAD (M_PI / 180.0)
+
+/* A tree node: the point on the unit sphere and the axis (0..2) this
+ * node splits on.  The tree is implicit: the node of range [lo, hi) sits
+ * at (lo + hi) / 2 with its children in the two halves. */
+typedef struct {
+    double p[3];
+    int    id;
+    int    axis;
+} GeoNode;
+
+struct GeoIndex {
+    GeoNode *nodes;
+    int      n;
+};
+
+/* Running result of a query: up to k hits sorted by chord^2. */
+typedef struct {
+    GeoIndexHit *hits;       /* km holds chord^2 until the end */
+    int          k, count;
+    double       limit2;     /* chord^2 of the search radius */
+} GeoQuery;
+
+double geo_distance_km(double lat1, double lon1, double lat2, double lon2)
+{
+    double dLat = (lat2 - lat1) * DEG2RAD;
+    double dLon = (lon2 - lon1) * DEG2RAD;
+    double a = sin(dLat / 2.0) * sin(dLat / 2.0) +
+               cos(lat1 * DEG2RAD) * cos(lat2 * DEG2RAD) *
+               sin(dLon / 2.0) * sin(dLon / 2.0);
+    return GEO_EARTH_RADIUS_KM * 2.0 * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+static void to_unit(double lat_deg, double lon_deg, double p[3])
+{
+    double lat = lat_deg * DEG2RAD, lon = lon_deg * DEG2RAD;
+    p[0] = cos(lat) * cos(lon);
+    p[1] = cos(lat) * sin(lon);
+    p[2] = sin(lat);
+}
+
+/* Great-circle km from chord^2 on the unit sphere. */
+static double chord2_to_km(double c2)
+{
+    double h = sqrt(c2) / 2.0;
+    if (h > 1.0) h = 1.0;
+    return 2.0 * GEO_EARTH_RADIUS_KM * asin(h);
+}
+
+static void swap_nodes(GeoNode *a, GeoNode *b)
+{
+    GeoNode t = *a; *a = *b; *b = t;
+}
+
+/* Put the node with the median coordinate on `axis` at `mid`, smaller
+ * ones before it and larger ones after it (quickselect). */
+static void select_median(GeoNode *v, int lo, int hi, int mid, int axis)
+{
+    hi--;
+    while (lo < hi) {
+        double pivot = v[(lo + hi) / 2].p[axis];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (v[i].p[axis] < pivot) i++;
+            while (v[j].p[axis] > pivot) j--;
+            if (i <= j) swap_nodes(&v[i++], &v[j--]);
+        }
+        if (mid <= j)      hi = j;
+        else if (mid >= i) lo = i;
+        else               break;
+    }
+}
+
+static void build(GeoNode *v, int lo, int hi)
+{
+    if (hi - lo <= 1) {
+        if (hi > lo) v[lo].axis = 0;
+        return;
+    }
+    /* Split on the axis with the widest spread */
+    double mn[3] = { 2, 2, 2 }, mx[3] = { -2, -2, -2 };
+    for (int i = lo; i < hi; i++)
+        for (int a = 0; a < 3; a++) {
+            if (v[i].p[a] < mn[a]) mn[a] = v[i].p[a];
+            if (v[i].p[a] > mx[a]) mx[a] = v[i].p[a];
+        }
+    int axis = 0;
+    for (int a = 1; a < 3; a++)
+        if (mx[a] - mn[a] > mx[axis] - mn[axis]) axis = a;
+
+    int mid = (lo + hi) / 2;
+    select_median(v, lo, hi, mid, axis);
+    v[mid].axis = axis;
+    build(v, lo, mid);
+    build(v, mid + 1, hi);
+}
+
+GeoIndex *geo_index_build(const double *lat_deg, const double *lon_deg, int n)
+{
+    GeoIndex *idx = (GeoIndex *)calloc(1, sizeof(*idx));
+    if (!idx) return NULL;
+    if (n <= 0) return idx;
+
+    idx->nodes = (GeoNode *)malloc((size_t)n * sizeof(GeoNode));
+    if (!idx->nodes) {
+        free(idx);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) {
+        if (lat_deg[i] == 0.0 && lon_deg[i] == 0.0) continue;
+        GeoNode *g = &idx->nodes[idx->n++];
+        to_unit(lat_deg[i], lon_deg[i], g->p);
+        g->id = i;
+    }
+    build(idx->nodes, 0, idx->n);
+    return idx;
+}
+
+void geo_index_free(GeoIndex *idx)
+{
+    if (!idx) return;
+    free(idx->nodes);
+    free(idx);
+}
+
+int geo_index_count(const GeoIndex *idx)
+{
+    return idx ? idx->n : 0;
+}
+
+/* The distance a farther node must beat: the k-th hit once there are k,
+ * the radius until then. */
+static double query_bound(const GeoQuery *q)
+{
+    return q->count == q->k ? q->hits[q->k - 1].km : q->limit2;
+}
+
+static void query_offer(GeoQuery *q, int id, double d2)
+{
+    if (d2 > q->limit2) return;
+    if (q->count == q->k && d2 >= q->hits[q->k - 1].km) return;
+
+    int i = q->count < q->k ? q->count++ : q->k - 1;
+    while (i > 0 && q->hits[i - 1].km > d2) {
+        q->hits[i] = q->hits[i - 1];
+        i--;
+    }
+    q->hits[i].id = id;
+    q->hits[i].km = d2;
+}
+
+static void search(const GeoNode *v, int lo, int hi, const double t[3], GeoQuery *q)
+{
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const GeoNode *g = &v[mid];
+        double dx = t[0] - g->p[0], dy = t[1] - g->p[1], dz = t[2] - g->p[2];
+        query_offer(q, g->id, dx * dx + dy * dy + dz * dz);
+
+        double diff = t[g->axis] - g->p[g->axis];
+        int nlo = lo, nhi = mid, flo = mid + 1, fhi = hi;
+        if (diff > 0) {
+            nlo = mid + 1; nhi = hi; flo = lo; fhi = mid;
+        }
+        search(v, nlo, nhi, t, q);
+        if (diff * diff > query_bound(q)) return;
+        lo = flo;                      /* far side, without recursing */
+        hi = fhi;
+    }
+}
+
+int geo_index_nearest(const GeoIndex *idx, double lat_deg, double lon_deg,
+                      int k, double max_km, GeoIndexHit *hits)
+{
+    if (!idx || idx->n == 0 || k <= 0 || !hits) return 0;
+
+    GeoQuery q;
+    q.hits  = hits;
+    q.k     = k;
+    q.count = 0;
+    if (max_km > 0.0 && max_km < M_PI * GEO_EARTH_RADIUS_KM) {
+        double c = 2.0 * sin(max_km / (2.0 * GEO_EARTH_RADIUS_KM));
+        q.limit2 = c * c;
+    } else {
+        q.limit2 = 4.0 + 1e-9;        /* whole sphere */
+    }
+
+    double t[3];
+    to_unit(lat_deg, lon_deg, t);
+    search(idx->nodes, 0, idx->n, t, &q);
+
+    for (int i = 0; i < q.count; i++)
+        hits[i].km = chord2_to_km(hits[i].km);
+    return q.count;
+}
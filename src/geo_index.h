@@ -0,0 +1,85 @@
+/**
+ * @file geo_index.h
+ * @brief Nearest-mountpoint queries over the positions in a sourcetable.
+ *
+ * A nationwide caster lists thousands of mountpoints.  Working out which
+ * of them are closest to a rover used to mean a great-circle distance to
+ * every one of them, again for every new rover position.  The index is
+ * built once per sourcetable: each position is projected onto the unit
+ * sphere (x, y, z) and stored in a balanced k-d tree, so "the k nearest
+ * within R km" visits O(log n + k) nodes instead of all n.  The
+ * straight-line (chord) distance between two points on the sphere grows
+ * with their great-circle distance, so the tree search in 3-D gives the
+ * same ranking as haversine.
+ *
+ * Positions at exactly 0/0 are left out: in a sourcetable that means the
+ * mountpoint publishes no coordinates.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef GEO_INDEX_H
+#define GEO_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Earth mean radius (km) used for every distance in the index. */
+#define GEO_EARTH_RADIUS_KM  6371.0
+
+/** @brief Opaque k-d tree over a set of positions. */
+typedef struct GeoIndex GeoIndex;
+
+/**
+ * @struct GeoIndexHit
+ * @brief One result of geo_index_nearest().
+ *
+ * Fields:
+ *   - id:  Index of the position in the arrays given to geo_index_build().
+ *   - km:  Great-circle distance from the query position.
+ */
+typedef struct {
+    int    id;
+    double km;
+} GeoIndexHit;
+
+/**
+ * @brief Great-circle (haversine) distance in km between two positions
+ *        in degrees.
+ */
+double geo_distance_km(double lat1, double lon1, double lat2, double lon2);
+
+/**
+ * @brief Build an index over @p n positions.
+ *
+ * @param lat_deg  Latitudes in degrees; position i gets id i.
+ * @param lon_deg  Longitudes in degrees.
+ * @return The index (possibly empty), or NULL if out of memory.
+ */
+GeoIndex *geo_index_build(const double *lat_deg, const double *lon_deg, int n);
+
+/** @brief Free an index (NULL is ignored). */
+void geo_index_free(GeoIndex *idx);
+
+/** @brief Number of positions in the index (0/0 positions excluded). */
+int geo_index_count(const GeoIndex *idx);
+
+/**
+ * @brief The @p k positions nearest to @p lat_deg / @p lon_deg.
+ *
+ * @param k       Most hits to return.
+ * @param max_km  Only positions within this distance; <= 0 for no limit.
+ * @param hits    [out] Room for @p k hits, nearest first.
+ * @return Number of hits written.
+ */
+int geo_index_nearest(const GeoIndex *idx, double lat_deg, double lon_deg,
+                      int k, double max_km, GeoIndexHit *hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEO_INDEX_H */
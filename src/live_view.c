@@ -0,0 +1,394 @@
+/**
+ * @file live_view.c
+ * @brief `--live`: a terminal dashboard of message types, satellites and
+ *        correction age, redrawn at a fixed rate.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+    #include <io.h>       // _isatty / _fileno
+    #ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+    #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+    #endif
+#else
+    #include <pthread.h>
+    #include <sys/ioctl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+#include "live_view.h"
+#include "perf_probe.h"
+#include "stats_snapshot.h"
+#include "stream_format.h"
+#include "ntrip_handler.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LIVE_MIN_COLS     40
+#define LIVE_MIN_ROWS     8
+#define LIVE_MAX_COLS     240
+#define LIVE_MAX_ROWS     120
+#define LIVE_RUN_GAP      6         /* equal cells bridged rather than a new cursor escape */
+
+struct LiveView {
+    StatsSnapshot snap;
+    uint64_t      period_ns;
+    uint64_t      next_due_ns;      /* writer */
+    LiveStats     view;             /* drawing thread: newest consistent copy */
+    LiveStats     scratch;          /* read target, so a raced read keeps the view */
+    uint32_t      seen;
+    bool          have;
+    int           rows, cols;       /* of the grids; 0 = nothing on screen yet */
+    int           used;             /* rows the dashboard took at the last frame */
+    char         *shown;            /* what the terminal shows */
+    char         *grid;             /* the frame being laid out */
+    char         *out;
+    size_t        out_len, out_cap;
+    uint64_t      t_repaint_ns;
+    volatile int  stop;
+#ifdef _WIN32
+    HANDLE        thread;
+#else
+    pthread_t     thread;
+#endif
+};
+
+/* ── Terminal ──────────────────────────────────────────────────────── */
+
+static bool live_term_open(void)
+{
+#ifdef _WIN32
+    if (!_isatty(_fileno(stdout))) return false;
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (h == INVALID_HANDLE_VALUE || !GetConsoleMode(h, &mode)) return false;
+    return SetConsoleMode(h, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+    if (!isatty(STDOUT_FILENO)) return false;
+    const char *term = getenv("TERM");
+    return !term || strcmp(term, "dumb") != 0;
+#endif
+}
+
+static void live_term_size(int *rows, int *cols)
+{
+    int r = 24, c = 80;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        r = info.srWindow.Bottom - info.srWindow.Top + 1;
+        c = info.srWindow.Right - info.srWindow.Left + 1;
+    }
+#else
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col) {
+        r = ws.ws_row;
+        c = ws.ws_col;
+    }
+#endif
+    /* The last row parks the cursor; the last column is left alone so a
+     * full row never makes the terminal wrap. */
+    r -= 1;
+    c -= 1;
+    *rows = r < LIVE_MIN_ROWS ? LIVE_MIN_ROWS : r > LIVE_MAX_ROWS ? LIVE_MAX_ROWS : r;
+    *cols = c < LIVE_MIN_COLS ? LIVE_MIN_COLS : c > LIVE_MAX_COLS ? LIVE_MAX_COLS : c;
+}
+
+/* One write of the frame, so the terminal never shows half of it. */
+static void live_term_write(const char *buf, size_t len)
+{
+#ifdef _WIN32
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    while (len > 0) {
+        DWORD n = 0;
+        if (!WriteFile(h, buf, (DWORD)len, &n, NULL) || n == 0) return;
+        buf += n;
+        len -= n;
+    }
+#else
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        buf += n;
+        len -= (size_t)n;
+    }
+#endif
+}
+
+static void live_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* ── Output buffer ─────────────────────────────────────────────────── */
+
+static void out_put(LiveView *v, const char *s, size_t n)
+{
+    if (v->out_len + n > v->out_cap) {
+        size_t cap = v->out_cap ? v->out_cap : 4096;
+        while (cap < v->out_len + n) cap *= 2;
+        char *b = (char *)realloc(v->out, cap);
+        if (!b) return;
+        v->out = b;
+        v->out_cap = cap;
+    }
+    memcpy(v->out + v->out_len, s, n);
+    v->out_len += n;
+}
+
+static void out_goto(LiveView *v, int row, int col)
+{
+    char esc[24];
+    int n = snprintf(esc, sizeof(esc), "\x1b[%d;%dH", row + 1, col + 1);
+    out_put(v, esc, (size_t)n);
+}
+
+/* ── Layout ────────────────────────────────────────────────────────── */
+
+/* printf() into grid row @p row, blank-padded and cut at the width. */
+static void grid_line(LiveView *v, int row, const char *fmt, ...)
+{
+    if (row >= v->rows) return;
+    char line[LIVE_MAX_COLS + 1];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) n = 0;
+    if (n > v->cols) n = v->cols;
+    char *dst = v->grid + (size_t)row * (size_t)v->cols;
+    for (int i = 0; i < n; i++)
+        dst[i] = (line[i] >= 0x20 && line[i] < 0x7f) ? line[i] : '?';
+    memset(dst + n, ' ', (size_t)(v->cols - n));
+}
+
+/* "12.3", "-" for a value < 0 (none). */
+static const char *fmt_num(char *buf, size_t len, double x, int decimals)
+{
+    if (x < 0.0) snprintf(buf, len, "-");
+    else         snprintf(buf, len, "%.*f", decimals, x);
+    return buf;
+}
+
+static void live_layout(LiveView *v, uint64_t now_ns)
+{
+    memset(v->grid, ' ', (size_t)v->rows * (size_t)v->cols);
+    int r = 0;
+    if (!v->have) {
+        grid_line(v, r++, "NTRIP-Analyser --live: waiting for the first frame...");
+        v->used = r;
+        return;
+    }
+    const LiveStats *s = &v->view;
+    double stale = now_ns > s->t_publish_ns ? (double)(now_ns - s->t_publish_ns) / 1e9 : 0.0;
+    char a[24], b[24], c[24], d[24], e[24];
+
+    grid_line(v, r++, "NTRIP-Analyser --live  %s  [%s]", s->source, s->mode ? s->mode : "");
+    grid_line(v, r++, "Elapsed %.0f / %d s   Format %s   %s",
+              s->elapsed_s + stale, s->duration_s,
+              stream_format_name((StreamFormat)s->format),
+              stale >= 2.0 ? "(no data for a while)" : "");
+    grid_line(v, r++, "Frames %llu   Bytes %llu (%.0f B/s)   CRC errors %llu   "
+              "Skipped %llu B in %llu resyncs   Reconnects %d",
+              (unsigned long long)s->frames, (unsigned long long)s->bytes, s->bytes_s,
+              (unsigned long long)s->crc_errors, (unsigned long long)s->skipped_bytes,
+              (unsigned long long)s->resyncs, s->reconnects);
+    if (s->age_p50_ms >= 0.0)
+        grid_line(v, r++, "Age of corrections: p50 %s ms, p99 %s ms",
+                  fmt_num(a, sizeof(a), s->age_p50_ms, 0), fmt_num(b, sizeof(b), s->age_p99_ms, 0));
+    r++;
+
+    if (s->n_gnss > 0) {
+        grid_line(v, r++, "GNSS        In view   Seen");
+        for (int i = 0; i < s->n_gnss && r < v->rows; i++)
+            grid_line(v, r++, "%-10s  %7u  %5u", gnss_name_from_id(s->gnss[i].gnss_id),
+                      s->gnss[i].in_view, s->gnss[i].seen);
+        r++;
+    }
+
+    if (s->n_types > 0) {
+        grid_line(v, r++, "Type    Frames   Fr/s     B/s   Last s  p50 dt  max dt  Age p50  Age p99");
+        for (int i = 0; i < s->n_types && r < v->rows; i++) {
+            const LiveTypeRow *t = &s->type[i];
+            grid_line(v, r++, "%-5d %8llu %6.2f %7.0f %8s %7s %7s %8s %8s",
+                      t->msg_type, (unsigned long long)t->frames, t->frames_s, t->bytes_s,
+                      fmt_num(a, sizeof(a), t->last_s < 0.0 ? -1.0 : t->last_s + stale, 1),
+                      fmt_num(b, sizeof(b), t->p50_dt, 3), fmt_num(c, sizeof(c), t->max_dt, 3),
+                      fmt_num(d, sizeof(d), t->age_p50_ms, 0), fmt_num(e, sizeof(e), t->age_p99_ms, 0));
+        }
+        if (s->more_types) grid_line(v, r++, "... and %d more types", s->more_types);
+    }
+    v->used = r < v->rows ? r : v->rows;
+}
+
+/* ── Drawing ───────────────────────────────────────────────────────── */
+
+/* Resize both grids; the screen is cleared and nothing counts as shown. */
+static bool live_resize(LiveView *v, int rows, int cols)
+{
+    size_t n = (size_t)rows * (size_t)cols;
+    char *shown = (char *)malloc(n);
+    char *grid  = (char *)malloc(n);
+    if (!shown || !grid) {
+        free(shown);
+        free(grid);
+        return false;
+    }
+    free(v->shown);
+    free(v->grid);
+    v->shown = shown;
+    v->grid  = grid;
+    v->rows  = rows;
+    v->cols  = cols;
+    return true;
+}
+
+/* Emit the runs of @p row that differ from the screen. */
+static void live_diff_row(LiveView *v, int row)
+{
+    const char *want = v->grid  + (size_t)row * (size_t)v->cols;
+    char       *have = v->shown + (size_t)row * (size_t)v->cols;
+    int c = 0;
+    while (c < v->cols) {
+        if (want[c] == have[c]) {
+            c++;
+            continue;
+        }
+        int start = c, end = c + 1, same = 0;
+        for (int k = c + 1; k < v->cols && same < LIVE_RUN_GAP; k++) {
+            if (want[k] != have[k]) {
+                end  = k + 1;
+                same = 0;
+            } else {
+                same++;
+            }
+        }
+        out_goto(v, row, start);
+        out_put(v, want + start, (size_t)(end - start));
+        memcpy(have + start, want + start, (size_t)(end - start));
+        c = end;
+    }
+}
+
+static void live_draw(LiveView *v)
+{
+    uint64_t now = perf_now_ns();
+    int rows, cols;
+    live_term_size(&rows, &cols);
+    v->out_len = 0;
+    if (rows != v->rows || cols != v->cols ||
+        now - v->t_repaint_ns >= (uint64_t)(LIVE_REPAINT_S * 1e9)) {
+        if ((rows != v->rows || cols != v->cols) && !live_resize(v, rows, cols)) return;
+        /* A cleared screen is all blanks: only the text is sent again */
+        memset(v->shown, ' ', (size_t)v->rows * (size_t)v->cols);
+        out_put(v, "\x1b[H\x1b[2J", 7);
+        v->t_repaint_ns = now;
+    }
+    if (stats_snapshot_read(&v->snap, &v->scratch, &v->seen)) {
+        v->view = v->scratch;
+        v->have = true;
+    }
+    live_layout(v, now);
+    for (int r = 0; r < v->rows; r++) live_diff_row(v, r);
+    out_goto(v, v->used, 0);
+    live_term_write(v->out, v->out_len);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall live_thread(void *arg)
+#else
+static void *live_thread(void *arg)
+#endif
+{
+    LiveView *v = (LiveView *)arg;
+    int period_ms = (int)(v->period_ns / 1000000u);
+    while (!__atomic_load_n(&v->stop, __ATOMIC_ACQUIRE)) {
+        live_draw(v);
+        /* Sleep in slices so a stop at a low rate does not wait a period */
+        for (int t = 0; t < period_ms && !__atomic_load_n(&v->stop, __ATOMIC_ACQUIRE); t += 50)
+            live_sleep_ms(period_ms - t < 50 ? period_ms - t : 50);
+    }
+    return 0;
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
+
+LiveView *live_view_start(double hz)
+{
+    if (!live_term_open()) {
+        fprintf(stderr, "[WARN] --live needs a terminal on stdout; running without it\n");
+        return NULL;
+    }
+    if (hz <= 0.0) hz = LIVE_DEFAULT_HZ;
+    if (hz > LIVE_MAX_HZ) hz = LIVE_MAX_HZ;
+    LiveView *v = (LiveView *)calloc(1, sizeof(*v));
+    if (!v || !stats_snapshot_init(&v->snap, sizeof(LiveStats))) {
+        fprintf(stderr, "[WARN] --live: out of memory; running without it\n");
+        free(v);
+        return NULL;
+    }
+    v->period_ns = (uint64_t)(1e9 / hz);
+    fflush(stdout);
+#ifdef _WIN32
+    v->thread = (HANDLE)_beginthreadex(NULL, 0, live_thread, v, 0, NULL);
+    bool started = v->thread != NULL;
+#else
+    bool started = pthread_create(&v->thread, NULL, live_thread, v) == 0;
+#endif
+    if (!started) {
+        fprintf(stderr, "[WARN] --live: cannot start the drawing thread; running without it\n");
+        stats_snapshot_free(&v->snap);
+        free(v);
+        return NULL;
+    }
+    return v;
+}
+
+bool live_view_due(LiveView *v)
+{
+    uint64_t now = perf_now_ns();
+    if (now < v->next_due_ns) return false;
+    v->next_due_ns = now + v->period_ns / 2;
+    return true;
+}
+
+void live_view_publish(LiveView *v, LiveStats *s)
+{
+    s->t_publish_ns = perf_now_ns();
+    stats_snapshot_publish(&v->snap, s);
+}
+
+void live_view_stop(LiveView *v)
+{
+    if (!v) return;
+    __atomic_store_n(&v->stop, 1, __ATOMIC_RELEASE);
+#ifdef _WIN32
+    WaitForSingleObject(v->thread, INFINITE);
+    CloseHandle(v->thread);
+#else
+    pthread_join(v->thread, NULL);
+#endif
+    live_draw(v);
+    live_term_write("\n", 1);
+    stats_snapshot_free(&v->snap);
+    free(v->shown);
+    free(v->grid);
+    free(v->out);
+    free(v);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file live_view.h
+ * @brief `--live`: a terminal dashboard of message types, satellites and
+ *        correction age, redrawn at a fixed rate.
+ *
+ * -t and -s print a token per frame and their tables only at the end.
+ * With --live they print nothing while the stream runs; a thread of its
+ * own redraws a dashboard on stdout instead:
+ *
+ * @code
+ * LiveView *lv = live_view_start(2.0);               // NULL: no terminal
+ * ...
+ * if (lv && live_view_due(lv)) {                     // ingest, per frame
+ *     fill(&ls);                                     // a LiveStats
+ *     live_view_publish(lv, &ls);
+ * }
+ * ...
+ * live_view_stop(lv);                                // last frame stays
+ * @endcode
+ *
+ * The ingest thread never touches the terminal and never waits for it:
+ * it fills a plain-data @ref LiveStats when live_view_due() says so
+ * (twice per redraw period) and publishes it through a sequence-locked
+ * snapshot (stats_snapshot.h).  The drawing thread copies the newest one
+ * out on its own tick, lays the screen out in a character grid and
+ * compares it with the grid on screen: only runs of changed cells are
+ * written, each after a cursor-position escape, in one write per frame.
+ * A steady stream changes a few counters per tick, so a redraw costs
+ * tens of bytes rather than a screen.  The whole screen is repainted
+ * when the terminal size changes and every @ref LIVE_REPAINT_S, which
+ * also heals the lines a stderr message wrote over.
+ *
+ * Needs a terminal on stdout with ANSI escapes (any POSIX terminal;
+ * Windows 10 and later, where virtual terminal processing is switched
+ * on).  On anything else live_view_start() says so and returns NULL and
+ * the mode runs as without --live.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef LIVE_VIEW_H
+#define LIVE_VIEW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default redraws per second of --live. */
+#define LIVE_DEFAULT_HZ  2.0
+
+/** @brief Highest --live rate. */
+#define LIVE_MAX_HZ      20.0
+
+/** @brief Seconds between two full repaints. */
+#define LIVE_REPAINT_S   10.0
+
+/** @brief Message types on the dashboard; later types are only counted. */
+#define LIVE_TYPE_ROWS   40
+
+/** @brief GNSS rows (ids 1 .. 7, as SatStatsSummary). */
+#define LIVE_GNSS_ROWS   8
+
+/** @brief One message type row.  Ages are < 0 for types without one. */
+typedef struct {
+    int      msg_type;
+    uint64_t frames;
+    double   frames_s;          /**< frames per second, last 10 s */
+    double   bytes_s;           /**< bytes per second, last 10 s */
+    double   last_s;            /**< since its last frame, at the publish */
+    double   p50_dt;            /**< median interval (s) */
+    double   max_dt;
+    double   age_p50_ms;
+    double   age_p99_ms;
+} LiveTypeRow;
+
+/** @brief Satellites of one GNSS. */
+typedef struct {
+    int      gnss_id;
+    unsigned in_view;           /**< in the newest epoch */
+    unsigned seen;              /**< since the start */
+} LiveGnssRow;
+
+/**
+ * @struct LiveStats
+ * @brief What the ingest thread publishes (plain data).
+ */
+typedef struct {
+    char        source[160];    /**< caster:port/mountpoint */
+    const char *mode;           /**< "message types", "satellites"; a literal */
+    int         format;         /**< StreamFormat */
+    double      elapsed_s;
+    int         duration_s;
+    uint64_t    bytes;          /**< in CRC-valid frames */
+    double      bytes_s;        /**< last 10 s; -s: mean of the run */
+    uint64_t    frames;
+    uint64_t    crc_errors;
+    uint64_t    skipped_bytes;
+    uint64_t    resyncs;
+    int         reconnects;
+    int         n_types;
+    int         more_types;     /**< types seen beyond LIVE_TYPE_ROWS */
+    LiveTypeRow type[LIVE_TYPE_ROWS];
+    int         n_gnss;
+    LiveGnssRow gnss[LIVE_GNSS_ROWS];
+    double      age_p50_ms;     /**< every MSM type; < 0 = none */
+    double      age_p99_ms;
+    uint64_t    t_publish_ns;   /**< perf_now_ns() of the publish */
+} LiveStats;
+
+typedef struct LiveView LiveView;
+
+/**
+ * @brief Start drawing @p hz times a second on stdout.
+ * @return NULL (with a warning) if stdout is not a terminal that takes
+ *         ANSI escapes, or the thread could not be started.
+ */
+LiveView *live_view_start(double hz);
+
+/** @brief Writer: whether the next publish is due (cheap; call per frame). */
+bool live_view_due(LiveView *v);
+
+/** @brief Writer: publish @p s; stamps s->t_publish_ns. */
+void live_view_publish(LiveView *v, LiveStats *s);
+
+/**
+ * @brief Draw the newest snapshot one last time, stop the thread and put
+ *        the cursor below the dashboard (NULL is ignored).
+ */
+void live_view_stop(LiveView *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIVE_VIEW_H */
@@ -0,0 +1,107 @@
+/**
+ * @file load_governor.c
+ * @brief Adaptive load shedding for a pipeline that falls behind.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "load_governor.h"
+
+#include <string.h>
+
+void load_gov_init(LoadGovernor *g, double now)
+{
+    memset(g, 0, sizeof(*g));
+    g->t_level = now;
+    g->t_calm  = -1.0;
+}
+
+double load_gov_pressure(double queue_fill, double lag_s, double duty)
+{
+    double p = 0.0;
+    if (queue_fill >= 0.0 && queue_fill / LOAD_GOV_QUEUE_HIGH > p)
+        p = queue_fill / LOAD_GOV_QUEUE_HIGH;
+    if (lag_s >= 0.0 && lag_s / LOAD_GOV_LAG_HIGH_S > p)
+        p = lag_s / LOAD_GOV_LAG_HIGH_S;
+    if (duty >= 0.0 && duty / LOAD_GOV_DUTY_HIGH > p)
+        p = duty / LOAD_GOV_DUTY_HIGH;
+    return p;
+}
+
+static void load_gov_set(LoadGovernor *g, int level, double now)
+{
+    __atomic_store_n(&g->level, level, __ATOMIC_RELEASE);
+    __atomic_store_n(&g->changes, g->changes + 1, __ATOMIC_RELAXED);
+    if (level > g->peak) g->peak = level;
+    g->t_level = now;
+}
+
+int load_gov_sample(LoadGovernor *g, double pressure, double now)
+{
+    int level = g->level;           /* only the writer changes it */
+    g->pressure = pressure;
+    if (pressure >= 1.0) {
+        g->t_calm = -1.0;
+        if (level < LOAD_LEVELS - 1 && now - g->t_level >= LOAD_GOV_STEP_S)
+            load_gov_set(g, ++level, now);
+    } else if (pressure < LOAD_GOV_RELAX) {
+        if (g->t_calm < 0.0) {
+            g->t_calm = now;
+        } else if (level > LOAD_FULL && now - g->t_calm >= LOAD_GOV_HOLD_S) {
+            load_gov_set(g, --level, now);
+            g->t_calm = now;        /* each step down waits its own hold */
+        }
+    } else {
+        g->t_calm = -1.0;
+    }
+    return level;
+}
+
+bool load_gov_keep(LoadGovernor *g, LoadWork w, uint32_t key)
+{
+    int level = g->level;
+    bool keep;
+    if (w == LOAD_WORK_TEXT)
+        keep = level < LOAD_SHED_TEXT;
+    else
+        keep = level < LOAD_SHED_SKY || key % LOAD_GOV_DECIMATE == 0;
+    if (!keep) __atomic_store_n(&g->shed[w], g->shed[w] + 1, __ATOMIC_RELAXED);
+    return keep;
+}
+
+int load_gov_level(const LoadGovernor *g)
+{
+    return __atomic_load_n(&g->level, __ATOMIC_ACQUIRE);
+}
+
+uint64_t load_gov_shed(const LoadGovernor *g, LoadWork w)
+{
+    return __atomic_load_n(&g->shed[w], __ATOMIC_RELAXED);
+}
+
+uint64_t load_gov_changes(const LoadGovernor *g)
+{
+    return __atomic_load_n(&g->changes, __ATOMIC_RELAXED);
+}
+
+const char *load_gov_level_name(int level)
+{
+    switch (level) {
+    case LOAD_FULL:      return "full";
+    case LOAD_SHED_SKY:  return "shed-sky";
+    case LOAD_SHED_TEXT: return "shed-text";
+    default:             return "?";
+    }
+}
+
+const char *load_gov_work_name(LoadWork w)
+{
+    switch (w) {
+    case LOAD_WORK_SKY:    return "sky";
+    case LOAD_WORK_DETAIL: return "detail";
+    case LOAD_WORK_TEXT:   return "text";
+    default:               return "?";
+    }
+}
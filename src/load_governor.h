@@ -0,0 +1,148 @@
+/**
+ * @file load_governor.h
+ * @brief Adaptive load shedding for a pipeline that falls behind.
+ *
+ * A live stream cannot be slowed down: when the analysis takes longer
+ * than the caster takes to send the next frames, the backlog grows until
+ * frames are dropped whole -- statistics, capture and all.  A
+ * LoadGovernor sheds the optional work first, in a fixed order:
+ *
+ *   - @ref LOAD_SHED_SKY: the sky propagation and the detail-window
+ *     decode run for one epoch / frame in @ref LOAD_GOV_DECIMATE
+ *   - @ref LOAD_SHED_TEXT: the text trace of decoded message types
+ *     stops as well
+ *
+ * Framing and CRC checks, the message statistics and the capture never
+ * go through the governor and keep full fidelity at every level.
+ *
+ * The producer samples a pressure every @ref LOAD_GOV_SAMPLE_S --
+ * load_gov_pressure() of the queue fill, the age of the frame being
+ * decoded and the duty cycle, whichever of them it has.  A pressure of 1
+ * steps up one level (at most one step per @ref LOAD_GOV_STEP_S); the
+ * level steps down again once the pressure stayed under
+ * @ref LOAD_GOV_RELAX for @ref LOAD_GOV_HOLD_S, so the work comes back
+ * only when there is clearly room for it.
+ *
+ * One writer -- the thread that samples and asks load_gov_keep() -- and
+ * any number of readers of the level and the counters
+ * (load_gov_level(), load_gov_shed()).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef LOAD_GOVERNOR_H
+#define LOAD_GOVERNOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Seconds between two load_gov_sample() calls of a producer. */
+#define LOAD_GOV_SAMPLE_S    0.1
+
+/** @brief Queue fill (0..1) that counts as falling behind. */
+#define LOAD_GOV_QUEUE_HIGH  0.25
+
+/** @brief Age of the frame being decoded (s) that counts as falling behind. */
+#define LOAD_GOV_LAG_HIGH_S  0.5
+
+/** @brief Busy fraction of a single-threaded loop that counts as falling behind. */
+#define LOAD_GOV_DUTY_HIGH   0.9
+
+/** @brief Pressure under which the level may step down. */
+#define LOAD_GOV_RELAX       0.5
+
+/** @brief Seconds at one level before the next step up. */
+#define LOAD_GOV_STEP_S      0.5
+
+/** @brief Seconds under @ref LOAD_GOV_RELAX before a step down. */
+#define LOAD_GOV_HOLD_S      2.0
+
+/** @brief Shed sky / detail work keeps one epoch or frame in this many. */
+#define LOAD_GOV_DECIMATE    4
+
+typedef enum {
+    LOAD_FULL = 0,          /**< everything runs */
+    LOAD_SHED_SKY,          /**< sky propagation and detail decode decimated */
+    LOAD_SHED_TEXT,         /**< ... and no text trace */
+    LOAD_LEVELS
+} LoadLevel;
+
+typedef enum {
+    LOAD_WORK_SKY = 0,      /**< sky propagation of a closed epoch */
+    LOAD_WORK_DETAIL,       /**< a frame for the detail windows */
+    LOAD_WORK_TEXT,         /**< text output of a decoded frame */
+    LOAD_WORKS
+} LoadWork;
+
+/**
+ * @struct LoadGovernor
+ * @brief Level, its hysteresis state and the shed counters.
+ */
+typedef struct {
+    int      level;             /**< LoadLevel; read with load_gov_level() */
+    int      peak;              /**< highest level reached */
+    double   t_level;           /**< writer only: when the level was entered */
+    double   t_calm;            /**< writer only: pressure under the relax mark since; <0 = not */
+    double   pressure;          /**< writer only: the last sample */
+    uint64_t changes;           /**< level changes */
+    uint64_t shed[LOAD_WORKS];  /**< work items skipped, per LoadWork */
+} LoadGovernor;
+
+/** @brief Start at @ref LOAD_FULL with zeroed counters; @p now on any monotonic clock (s). */
+void load_gov_init(LoadGovernor *g, double now);
+
+/**
+ * @brief Pressure of one sample: the largest of the inputs over their
+ *        high marks.  Pass a negative value for an input the producer
+ *        does not have.
+ *
+ * @param queue_fill  Queue bytes waiting over its capacity (0..1).
+ * @param lag_s       Seconds since the frame now being decoded was received.
+ * @param duty        Busy fraction of the producer over the last period (0..1).
+ */
+double load_gov_pressure(double queue_fill, double lag_s, double duty);
+
+/**
+ * @brief Writer: feed one sample and move the level.
+ *
+ * @return The new level, as a LoadLevel.
+ */
+int load_gov_sample(LoadGovernor *g, double pressure, double now);
+
+/**
+ * @brief Writer: whether to run one item of work @p w at the current
+ *        level; a skipped item is counted.
+ *
+ * @param key  Decimation key of sky and detail work: items whose key is
+ *             a multiple of @ref LOAD_GOV_DECIMATE run.  Callers keying
+ *             sky epochs on their epoch second keep the same epochs at
+ *             every station.
+ */
+bool load_gov_keep(LoadGovernor *g, LoadWork w, uint32_t key);
+
+/** @brief Reader: the current level, as a LoadLevel. */
+int load_gov_level(const LoadGovernor *g);
+
+/** @brief Reader: items of @p w skipped so far. */
+uint64_t load_gov_shed(const LoadGovernor *g, LoadWork w);
+
+/** @brief Reader: level changes so far. */
+uint64_t load_gov_changes(const LoadGovernor *g);
+
+/** @brief "full", "shed-sky" or "shed-text". */
+const char *load_gov_level_name(int level);
+
+/** @brief "sky", "detail" or "text". */
+const char *load_gov_work_name(LoadWork w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOAD_GOVERNOR_H */
@@ -0,0 +1,159 @@
+/**
+ * @file lz_block.c
+ * @brief Small self-contained LZ77 block codec for capture files.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "lz_block.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH   4
+#define LZ_MAX_DIST    65535u
+#define LZ_HASH_BITS   12
+#define LZ_SKIP_SHIFT  5       /* step grows by one every 32 misses */
+
+static uint32_t lz_read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Write a count extension (the part above 15) as 255, ..., last. */
+static unsigned char *lz_put_ext(unsigned char *op, size_t v)
+{
+    while (v >= 255) {
+        *op++ = 255;
+        v -= 255;
+    }
+    *op++ = (unsigned char)v;
+    return op;
+}
+
+/* Emit one sequence: literals [lit, lit + nlit), then a match of mlen
+ * bytes at distance dist (mlen == 0: last sequence, literals only). */
+static unsigned char *lz_put_seq(unsigned char *op, const unsigned char *lit,
+                                 size_t nlit, size_t mlen, size_t dist)
+{
+    size_t ml = mlen ? mlen - LZ_MIN_MATCH : 0;
+    unsigned char *token = op++;
+    *token = (unsigned char)(((nlit < 15 ? nlit : 15) << 4) | (ml < 15 ? ml : 15));
+    if (nlit >= 15) op = lz_put_ext(op, nlit - 15);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (mlen) {
+        *op++ = (unsigned char)dist;
+        *op++ = (unsigned char)(dist >> 8);
+        if (ml >= 15) op = lz_put_ext(op, ml - 15);
+    }
+    return op;
+}
+
+size_t lz_block_compress(const unsigned char *in, size_t n,
+                         unsigned char *out, size_t cap)
+{
+    if (cap < LZ_BLOCK_BOUND(n)) return 0;
+
+    uint32_t table[1u << LZ_HASH_BITS];       /* position + 1; 0 = empty */
+    memset(table, 0, sizeof(table));
+
+    unsigned char *op = out;
+    size_t anchor = 0, ip = 0;
+    size_t misses = 0;
+    /* Leave the last bytes as literals so match probes never read past
+     * the input. */
+    size_t limit = n > LZ_MIN_MATCH ? n - LZ_MIN_MATCH : 0;
+
+    while (ip < limit) {
+        uint32_t cur = lz_read32(in + ip);
+        uint32_t h   = lz_hash(cur);
+        size_t   ref = table[h];
+        table[h] = (uint32_t)(ip + 1);
+
+        if (!ref || ip - (ref - 1) > LZ_MAX_DIST ||
+            lz_read32(in + ref - 1) != cur) {
+            ip += 1 + (misses++ >> LZ_SKIP_SHIFT);
+            continue;
+        }
+        ref--;
+        misses = 0;
+
+        /* Extend backwards over literals, then forwards. */
+        while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+            ip--;
+            ref--;
+        }
+        size_t mlen = LZ_MIN_MATCH;
+        while (ip + mlen < n && in[ref + mlen] == in[ip + mlen]) mlen++;
+
+        op = lz_put_seq(op, in + anchor, ip - anchor, mlen, ip - ref);
+        ip += mlen;
+        anchor = ip;
+        /* Seed the table from inside the match for the next search. */
+        if (ip < limit && ip >= 2)
+            table[lz_hash(lz_read32(in + ip - 2))] = (uint32_t)(ip - 2 + 1);
+    }
+    op = lz_put_seq(op, in + anchor, n - anchor, 0, 0);
+    return (size_t)(op - out);
+}
+
+/* Read a count extension onto *v; false if it runs past the input. */
+static int lz_get_ext(const unsigned char **ip, const unsigned char *end,
+                      size_t *v)
+{
+    unsigned char b;
+    do {
+        if (*ip >= end) return 0;
+        b = *(*ip)++;
+        *v += b;
+    } while (b == 255);
+    return 1;
+}
+
+size_t lz_block_decompress(const unsigned char *in, size_t n,
+                           unsigned char *out, size_t cap)
+{
+    const unsigned char *ip  = in;
+    const unsigned char *end = in + n;
+    size_t op = 0;
+
+    while (ip < end) {
+        unsigned token = *ip++;
+        size_t nlit = token >> 4;
+        if (nlit == 15 && !lz_get_ext(&ip, end, &nlit)) return 0;
+        if (nlit > (size_t)(end - ip) || nlit > cap - op) return 0;
+        memcpy(out + op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == end) break;                /* last sequence */
+
+        if (end - ip < 2) return 0;
+        size_t dist = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t mlen = token & 15;
+        if (mlen == 15 && !lz_get_ext(&ip, end, &mlen)) return 0;
+        mlen += LZ_MIN_MATCH;
+        if (dist == 0 || dist > op || mlen > cap - op) return 0;
+
+        /* Byte copy: the source may overlap the bytes being written. */
+        const unsigned char *src = out + op - dist;
+        unsigned char *dst = out + op;
+        if (dist >= mlen) {
+            memcpy(dst, src, mlen);
+        } else {
+            for (size_t i = 0; i < mlen; i++) dst[i] = src[i];
+        }
+        op += mlen;
+    }
+    return op;
+}
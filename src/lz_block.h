@@ -0,0 +1,69 @@
+/**
+ * @file lz_block.h
+ * @brief Small self-contained LZ77 block codec for capture files.
+ *
+ * A byte-oriented LZ77 codec in the LZ4 style: every sequence is a token
+ * (literal count, match length), the literals, and a 16-bit match
+ * distance.  It trades ratio for speed: compression is one greedy pass
+ * with a 4096-entry hash table and no entropy stage, so it runs at
+ * hundreds of MB/s on one core, and decompression is a copy loop.
+ * RTCM streams compress well with it because consecutive epochs repeat
+ * whole runs of bytes (message headers, satellite and signal masks,
+ * slowly changing fields).
+ *
+ * Each block is independent: it needs no dictionary and no state from
+ * any other block, so a reader can jump straight to any block.
+ *
+ * Sequence layout:
+ * @code
+ *   token        u8   high nibble: literal count (15 = more follows)
+ *                     low nibble:  match length - 4 (15 = more follows)
+ *   [count ext]  u8.. 255, 255, ..., last (< 255), added to 15
+ *   literals
+ *   distance     u16  little-endian, 1..65535      (absent in the last
+ *   [length ext] u8.. as the count extension        sequence)
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest compressed size of @p n input bytes (incompressible input). */
+#define LZ_BLOCK_BOUND(n)  ((n) + (n) / 255 + 16)
+
+/**
+ * @brief Compress @p n bytes of @p in into @p out.
+ *
+ * @param cap  Size of @p out; LZ_BLOCK_BOUND(n) always suffices.
+ * @return Compressed size, or 0 if @p out is too small.
+ */
+size_t lz_block_compress(const unsigned char *in, size_t n,
+                         unsigned char *out, size_t cap);
+
+/**
+ * @brief Decompress a block produced by lz_block_compress().
+ *
+ * Every length and distance is checked, so a damaged block fails
+ * instead of reading or writing out of bounds.
+ *
+ * @param cap  Size of @p out.
+ * @return Decompressed size, or 0 if the block is damaged or does not fit.
+ */
+size_t lz_block_decompress(const unsigned char *in, size_t n,
+                           unsigned char *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LZ_BLOCK_H */
@@ -8,6 +8,8 @@
 #include <signal.h>
 #include <time.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <math.h>
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h> // Required for getaddrinfo
@@ -27,16 +29,47 @@
 #endif
 #include "cJSON.h" // Include cJSON library
 #include "rtcm3x_parser.h" // Include RTCM parser header
+#include "rtcm_framer.h"
+#include "rtcm_replay.h"
+#include "replay_keyframe.h"
+#include "rtcm_capture.h"
+#include "rtcm_recorder.h"
+#include "rinex_obs.h"
+#include "obs_columns.h"
+#include "event_out.h"
+#include "batch_replay.h"
+#include "stream_clock.h"
 #include "ntrip_handler.h"
 #include "config.h"
+#include "config_watch.h"
+#include "eph_shm.h"
+#include "eph_cache.h"
+#include "fleet_collect.h"
+#include "fleet_push.h"
+#include "sv_ephemeris.h"
 #include "cli_help.h"
 #include "sky_collect.h"
+#include "sky_expect.h"
+#include "sky_multi.h"
+#include "stream_compare.h"
+#include "sky_file.h"
 #include "sky_render.h"
+#include "sky_snapshot.h"
 #include "rinex_nav.h"
 #include "nmea_parser.h"
-
-#define BUFFER_SIZE 4096
-#define MAX_MSG_TYPES 4096
+#include "ntrip_multi.h"
+#include "ntrip_relay.h"
+#include "vrs_probe.h"
+#include "caster_survey.h"
+#include "geo_index.h"
+#include "sourcetable_crawl.h"
+#include "ntrip_session.h"
+#include "perf_probe.h"
+#include "live_view.h"
+#include "quantile_sketch.h"
+#include "metrics_http.h"
+#include "obs_quality.h"
+#include "rtcm_gen.h"
 
 // Define column widths for verbose printing
 #define CONF_KEY_WIDTH 14
@@ -55,9 +88,41 @@ bool verbose = false;
 bool quiet   = false;        /* -q / --quiet: suppress info chatter */
 bool no_progress = false;    /* --no-progress: never emit the per-second status line */
 bool json_output = false;    /* --json: machine-readable status lines */
+const char *json_target = NULL;    /* --json-fd: event stream target, NULL = stderr */
+EventOutOptions json_opt = { EVENT_OUT_NDJSON, 0, 0 };   /* --json-binary, --json-flush */
+EventOut *g_events = NULL;         /* the --json event stream, open while json_output */
 bool rtcm_stdin  = false;    /* --rtcm-stdin: read obs RTCM from stdin */
-int filter_list[MAX_MSG_TYPES] = {0};
-int filter_count = 0;
+const char *replay_path  = NULL;   /* --replay: read obs RTCM from a capture file */
+const char *replay_start = NULL;   /* --replay-start: "<sec>" or "#<frame>" */
+const char *replay_seek  = NULL;   /* --replay-seek: as --replay-start, with the state up to it */
+double replay_speed = 0.0;         /* --replay-speed: N x real time, 0 = max */
+const char *record_path  = NULL;   /* --record: capture of the stream */
+RtcmRecorderOptions record_opt = { 0 };   /* --record-rotate, --compress */
+const char *convert_path = NULL;   /* --convert: capture file to convert */
+const char *rinex_obs_path = NULL; /* --rinex-obs: RINEX OBS written from the stream */
+const char *export_path  = NULL;   /* --export: columnar observations (.nacol) */
+const char *replay_dir   = NULL;   /* --replay-dir: batch replay of a directory */
+int batch_jobs = 0;                /* --jobs: captures in flight, 0 = cores */
+int nearest_k = 10;                /* --nearest [K]: mountpoints to list */
+double nearest_radius_km = 0.0;    /* --radius: --nearest limit, 0 = none */
+const char *crawl_file = NULL;     /* --crawl: casters file */
+int crawl_timeout_s = 0;           /* --timeout: per caster, 0 = default */
+const char *checkpoint_path = NULL; /* --checkpoint: sector grid rewritten while collecting */
+const char *resume_path     = NULL; /* --resume: sector grid to continue from */
+const char *expected_path   = NULL; /* --expected: precomputed expected counts */
+int snapshot_interval = 0;          /* --snapshot-interval: live heatmap every N s, 0 = off */
+double live_hz = 0.0;               /* --live: dashboard redraws per second, 0 = off */
+SkyRenderSize png_sizes[SKY_RENDER_MAX_SIZES];
+int n_png_sizes = 0;                 /* --png-sizes: heatmap sizes, first = the main file; 0 = 800x800 */
+RtcmFilter msg_filter;               /* -d [spec], compiled */
+const char *filter_spec = NULL;
+bool watch_config = false;           /* --watch-config: reload when the config file changes */
+const char *eph_shm_name = NULL;     /* --eph-shm / --eph-feed: shared ephemeris segment */
+const char *eph_cache_path = NULL;   /* --eph-cache: ephemeris store kept across runs */
+const char *push_target = NULL;      /* --push: collector to send summaries to */
+const char *node_name = NULL;        /* --node: name in those summaries; NULL = host name */
+static FleetPush *g_push;            /* open while a --push run lasts */
+bool rollups = false;                /* --rollups: per-mountpoint history on /rollup */
 
 /* ── Exit codes (documented in --help and docs/compile.md) ─────────── */
 #define EXIT_OK              0
@@ -105,6 +170,10 @@ typedef struct {
     const char *eph_mountpoint;
     const char *eph_user;
     const char *eph_password;
+    const char *latitude;       /* --lat / --latitude (no env var) */
+    const char *longitude;      /* --lon / --longitude (no env var) */
+    const char *table_ttl;      /* --table-ttl (no env var) */
+    bool        no_reconnect;   /* --no-reconnect (no env var) */
 } ConfigOverrides;
 
 static void overrides_apply_env(ConfigOverrides *o)
@@ -138,6 +207,10 @@ static void overrides_apply_to_config(NTRIP_Config *cfg, const ConfigOverrides *
     if (o->eph_mountpoint && o->eph_mountpoint[0]) ASSIGN_STR(cfg->EPH_MOUNTPOINT,  o->eph_mountpoint);
     if (o->eph_user       && o->eph_user[0])       ASSIGN_STR(cfg->EPH_USERNAME,    o->eph_user);
     if (o->eph_password   && o->eph_password[0])   ASSIGN_STR(cfg->EPH_PASSWORD,    o->eph_password);
+    if (o->latitude       && o->latitude[0])       cfg->LATITUDE  = atof(o->latitude);
+    if (o->longitude      && o->longitude[0])      cfg->LONGITUDE = atof(o->longitude);
+    if (o->table_ttl      && o->table_ttl[0])      cfg->SOURCETABLE_TTL = atoi(o->table_ttl);
+    if (o->no_reconnect)                           cfg->RECONNECT_DELAY_MAX = -1;
 }
 
 /* ── --check-config dry-run ──────────────────────────────────────────
@@ -145,6 +218,24 @@ static void overrides_apply_to_config(NTRIP_Config *cfg, const ConfigOverrides *
  * applied), reports each field on stdout (so a script can grep/parse),
  * and DNS-resolves the casters.  Returns EXIT_OK if everything looks
  * good; EXIT_GENERIC if a DNS lookup or required-field check fails. */
+
+/* One "DNS_xxx = host (addr, addr, ...)" line of --check-config. */
+static bool check_dns(const char *label, const char *host, int port)
+{
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];
+    int n = ntrip_dns_lookup(host, port, addrs, NTRIP_CONNECT_MAX_ADDRS, true);
+    if (n == 0) {
+        printf("%-20s = FAILED for %s\n", label, host);
+        return false;
+    }
+    printf("%-20s = %s (", label, host);
+    for (int i = 0; i < n; i++) {
+        char a[80];
+        printf("%s%s", i ? ", " : "", ntrip_addr_str(&addrs[i], a, sizeof(a)));
+    }
+    printf(")\n");
+    return true;
+}
 static int run_check_config(const NTRIP_Config *cfg)
 {
     int problems = 0;
@@ -156,6 +247,20 @@ static int run_check_config(const NTRIP_Config *cfg)
     printf("PASSWORD             = %s\n", cfg->PASSWORD[0] ? "(set)" : "(empty)");
     printf("LATITUDE             = %.6f\n", cfg->LATITUDE);
     printf("LONGITUDE            = %.6f\n", cfg->LONGITUDE);
+    printf("SOURCETABLE_TTL      = %d\n", cfg->SOURCETABLE_TTL);
+    if (cfg->RECONNECT_DELAY_MAX < 0)
+        printf("RECONNECT_DELAY_MAX  = off\n");
+    else
+        printf("RECONNECT_DELAY_MAX  = %d\n", cfg->RECONNECT_DELAY_MAX ? cfg->RECONNECT_DELAY_MAX
+                                                                     : NTRIP_SESSION_BACKOFF_MAX_S);
+    printf("TLS                  = %s%s\n",
+           (ntrip_config_session_flags(cfg, false) & NTRIP_SESSION_TLS) ? "on" : "off",
+           cfg->TLS ? "" : " (auto: port 443)");
+    printf("TLS_INSECURE         = %s\n", cfg->TLS_INSECURE ? "yes" : "no");
+    if (cfg->GGA_INTERVAL < 0)
+        printf("GGA_INTERVAL         = off\n");
+    else
+        printf("GGA_INTERVAL         = %d\n", cfg->GGA_INTERVAL ? cfg->GGA_INTERVAL : 1);
 
     bool have_eph = cfg->EPH_CASTER[0] && cfg->EPH_PORT > 0 && cfg->EPH_MOUNTPOINT[0];
     printf("EPH_CASTER           = %s\n", cfg->EPH_CASTER[0] ? cfg->EPH_CASTER : "(none)");
@@ -163,6 +268,9 @@ static int run_check_config(const NTRIP_Config *cfg)
     printf("EPH_MOUNTPOINT       = %s\n", cfg->EPH_MOUNTPOINT[0] ? cfg->EPH_MOUNTPOINT : "(none)");
     printf("EPH_USERNAME         = %s\n", cfg->EPH_USERNAME);
     printf("EPH_PASSWORD         = %s\n", cfg->EPH_PASSWORD[0] ? "(set)" : "(empty)");
+    printf("EPH_TLS              = %s%s\n",
+           (ntrip_config_session_flags(cfg, true) & NTRIP_SESSION_TLS) ? "on" : "off",
+           cfg->EPH_TLS ? "" : " (auto: port 443)");
     printf("EPH_STREAM           = %s\n", have_eph ? "configured" : "(not configured)");
 
     /* Required-field checks */
@@ -179,38 +287,11 @@ static int run_check_config(const NTRIP_Config *cfg)
         problems++;
     }
 
-    /* DNS lookup of casters */
-    struct addrinfo hints, *res;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    if (cfg->NTRIP_CASTER[0]) {
-        int rc = getaddrinfo(cfg->NTRIP_CASTER, NULL, &hints, &res);
-        if (rc == 0) {
-            char ip[INET_ADDRSTRLEN] = "";
-            struct sockaddr_in *sa = (struct sockaddr_in *)res->ai_addr;
-            inet_ntop(AF_INET, &sa->sin_addr, ip, sizeof(ip));
-            printf("DNS_OBS              = %s (%s)\n", cfg->NTRIP_CASTER, ip);
-            freeaddrinfo(res);
-        } else {
-            printf("DNS_OBS              = FAILED for %s\n", cfg->NTRIP_CASTER);
-            problems++;
-        }
-    }
-    if (have_eph) {
-        int rc = getaddrinfo(cfg->EPH_CASTER, NULL, &hints, &res);
-        if (rc == 0) {
-            char ip[INET_ADDRSTRLEN] = "";
-            struct sockaddr_in *sa = (struct sockaddr_in *)res->ai_addr;
-            inet_ntop(AF_INET, &sa->sin_addr, ip, sizeof(ip));
-            printf("DNS_EPH              = %s (%s)\n", cfg->EPH_CASTER, ip);
-            freeaddrinfo(res);
-        } else {
-            printf("DNS_EPH              = FAILED for %s\n", cfg->EPH_CASTER);
-            problems++;
-        }
-    }
+    /* DNS lookup of casters (every address, in the order they are tried) */
+    if (cfg->NTRIP_CASTER[0] && !check_dns("DNS_OBS", cfg->NTRIP_CASTER, cfg->NTRIP_PORT))
+        problems++;
+    if (have_eph && !check_dns("DNS_EPH", cfg->EPH_CASTER, cfg->EPH_PORT))
+        problems++;
 
     printf("STATUS               = %s\n",
            problems == 0 ? "ok" : "issues detected");
@@ -230,7 +311,7 @@ typedef enum {
     STOP_REASON_SIGINT,    /* Ctrl-C */
     STOP_REASON_ABORT,     /* Ctrl-A */
     STOP_REASON_DURATION,  /* --duration timer expired */
-    STOP_REASON_EOF,       /* stdin EOF on --rtcm-stdin */
+    STOP_REASON_EOF,       /* stdin EOF on --rtcm-stdin, end of --replay */
     STOP_REASON_ERROR      /* socket / read error */
 } StopReason;
 static const char *stop_reason_name(StopReason r) {
@@ -283,6 +364,8 @@ static void terminal_restore(void)
 }
 static int poll_for_ctrl_a(void)
 {
+    /* Only a terminal set up above; a piped stdin (--rtcm-stdin) is data. */
+    if (!g_tio_saved) return 0;
     fd_set rs;
     FD_ZERO(&rs);
     FD_SET(STDIN_FILENO, &rs);
@@ -297,27 +380,553 @@ static int poll_for_ctrl_a(void)
 #endif
 
 /* ── Thread wrapper for the eph NTRIP worker ───────────────────────── */
+/* The worker runs on its own copy of the config and its own stop flag,
+ * so a config reload can stop it and start it again on new settings
+ * while the obs stream carries on. */
 typedef struct {
-    const NTRIP_Config *config;
-    bool verbose;
-} EphThreadArgs;
+    NTRIP_Config config;
+    bool         verbose;
+    volatile int stop;
+    volatile int done;          /* run_eph_stream() has returned */
+    bool         running;
+    bool         stuck;         /* did not stop in time; never restarted */
+#ifdef _WIN32
+    HANDLE       thread;
+#else
+    pthread_t    thread;
+#endif
+} EphWorker;
+
+static EphWorker sky_eph;
+
+/* --eph-shm reader with an eph stream of its own: it takes the feed over
+ * once the feeding process has gone (sky_eph_check_feed()). */
+static bool sky_eph_standby = false;
+
+/* Seconds between checks whether the shared segment's feeder is alive. */
+#define SKY_EPH_FEED_CHECK_S 10
+
+/* Constellations the obs stream(s) observe and carry ephemerides for
+ * (sky_obs_eph()). */
+static NtripEphCoverage sky_eph_cov;
 
 #ifdef _WIN32
 static unsigned __stdcall eph_thread_entry(void *p)
 {
-    EphThreadArgs *a = (EphThreadArgs *)p;
-    run_eph_stream(a->config, &g_stop_requested, a->verbose);
+    EphWorker *w = (EphWorker *)p;
+    run_eph_stream(&w->config, &w->stop, w->verbose);
+    w->done = 1;
     return 0;
 }
 #else
 static void *eph_thread_entry(void *p)
 {
-    EphThreadArgs *a = (EphThreadArgs *)p;
-    run_eph_stream(a->config, &g_stop_requested, a->verbose);
+    EphWorker *w = (EphWorker *)p;
+    run_eph_stream(&w->config, &w->stop, w->verbose);
+    w->done = 1;
     return NULL;
 }
 #endif
 
+static bool sky_eph_start(const NTRIP_Config *config, bool verbose)
+{
+    if (sky_eph.running || sky_eph.stuck) return false;
+    sky_eph.config  = *config;
+    sky_eph.verbose = verbose;
+    sky_eph.stop    = 0;
+    sky_eph.done    = 0;
+#ifdef _WIN32
+    sky_eph.thread  = (HANDLE)_beginthreadex(NULL, 0, eph_thread_entry, &sky_eph, 0, NULL);
+    sky_eph.running = sky_eph.thread != NULL;
+    if (!sky_eph.running) ERR("[ERROR] Could not start EPH worker thread\n");
+#else
+    sky_eph.running = pthread_create(&sky_eph.thread, NULL, eph_thread_entry, &sky_eph) == 0;
+    if (!sky_eph.running) ERR("[ERROR] pthread_create for EPH worker failed\n");
+#endif
+    return sky_eph.running;
+}
+
+/* Stop the worker and wait for it (on Windows at most 3 s).  False if it
+ * did not end in time: it still reads sky_eph.config then. */
+static bool sky_eph_stop(void)
+{
+    if (!sky_eph.running) return !sky_eph.stuck;
+    sky_eph.stop = 1;
+#ifdef _WIN32
+    bool ended = WaitForSingleObject(sky_eph.thread, 3000) == WAIT_OBJECT_0;
+    CloseHandle(sky_eph.thread);
+#else
+    bool ended = pthread_join(sky_eph.thread, NULL) == 0;
+#endif
+    sky_eph.running = false;
+    sky_eph.stuck   = !ended;
+    return ended;
+}
+
+/* Standby reader: start feeding the shared segment if its feeder exited. */
+static void sky_eph_check_feed(const NTRIP_Config *config, bool verbose)
+{
+    if (!sky_eph_standby || !eph_shm_take_over()) return;
+    sky_eph_standby = false;
+    INFO("[EPH] Feeder of shared segment '%s' is gone; feeding it from %s:%d /%s\n",
+         eph_shm_name, config->EPH_CASTER, config->EPH_PORT, config->EPH_MOUNTPOINT);
+    if (!config_eph_is_obs_stream(config)) sky_eph_start(config, verbose);
+}
+
+/* An ephemeris or MSM frame of the obs stream(s).  The ephemerides are
+ * decoded here whenever no EPH worker writes the store.  While one does
+ * they are only counted, and once they cover every constellation the obs
+ * stream observes, the worker's connection is closed: it only brings the
+ * same broadcast again. */
+static void sky_obs_eph(int mt, const unsigned char *payload, int len)
+{
+    double now = stream_clock_seconds();
+    ntrip_eph_coverage_add(&sky_eph_cov, mt, now);
+    if (!rtcm_msg_is_eph(mt) || sky_eph.stuck) return;
+    if (sky_eph.running) {
+        if (!ntrip_eph_coverage_full(&sky_eph_cov, now)) return;
+        INFO("[EPH] The obs stream carries the ephemerides of every constellation it "
+             "observes; closing the EPH connection\n");
+        if (!sky_eph_stop()) return;
+    }
+    SvEphemeris eph;
+    rtcm_decode_eph(payload, len, &eph);
+}
+
+/* ── Ephemeris store across runs (--eph-cache) ─────────────────────── */
+static double eph_cache_next;           /* wall time of the next save */
+
+/* A --eph-shm process writes the cache only while it feeds the segment. */
+static bool eph_cache_writer(void)
+{
+    return eph_cache_path && (!eph_shm_name || eph_shm_feeding());
+}
+
+/* Preload the store from --eph-cache if the file exists: the versions
+ * still valid now, or all of them on an @p offline source, whose time
+ * is not known before its first frame. */
+static void eph_cache_begin(bool offline)
+{
+    eph_cache_next = stream_clock_wall_seconds() + EPH_CACHE_SAVE_S;
+    if (!eph_cache_writer()) return;
+    FILE *f = fopen(eph_cache_path, "rb");
+    if (!f) {
+        INFO("[EPH] %s does not exist yet, starting with an empty cache\n", eph_cache_path);
+        return;
+    }
+    fclose(f);
+
+    int week = -1;
+    double tow = 0.0, tod = 0.0;
+    if (!offline) {
+        stream_clock_gps_time(&week, &tow);
+        tod = stream_clock_glo_tod();
+    }
+    int counts[SV_EPH_MAX_GNSS], stale;
+    int total = eph_cache_load(eph_cache_path, week, tow, tod, counts, &stale);
+    if (total < 0) {
+        /* Not a cache at all: a mistyped path must not be overwritten. */
+        ERR("[EPH] Not writing %s in this run\n", eph_cache_path);
+        eph_cache_path = NULL;
+        return;
+    }
+    INFO("[EPH] Loaded %d ephemerides from %s (G:%d R:%d E:%d J:%d C:%d I:%d), "
+         "%d no longer valid\n", total, eph_cache_path, counts[1], counts[2],
+         counts[3], counts[4], counts[5], counts[7], stale);
+}
+
+/* Rewrite --eph-cache if a save is due, or now if @p force. */
+static void eph_cache_tick(bool force)
+{
+    if (!eph_cache_writer()) return;
+    double now = stream_clock_wall_seconds();
+    if (!force && now < eph_cache_next) return;
+    eph_cache_next = now + EPH_CACHE_SAVE_S;
+    int n = eph_cache_save(eph_cache_path);
+    if (n >= 0 && (force || verbose))
+        INFO("[SAVE] %d ephemerides to %s\n", n, eph_cache_path);
+}
+
+/* ── Live config reload (config_watch.h) ───────────────────────────── */
+static const char      *reload_config_path;    /* the -c file */
+static const char      *reload_mounts_path;    /* --mounts-file, NULL = none */
+static ConfigOverrides  reload_ov;             /* env / CLI overrides, applied again */
+
+/* Load the config file the way main() did: the file, then the overrides,
+ * then the credentials of both casters.  False (with a message) keeps the
+ * running settings. */
+static bool reload_config(NTRIP_Config *out)
+{
+    NTRIP_Config c;
+    memset(&c, 0, sizeof(c));
+    if (load_config(reload_config_path, &c) != 0) {
+        ERR("[CONFIG] Reloading %s failed; keeping the running settings\n", reload_config_path);
+        return false;
+    }
+    overrides_apply_to_config(&c, &reload_ov);
+    char auth[512];
+    snprintf(auth, sizeof(auth), "%s:%s", c.USERNAME, c.PASSWORD);
+    base64_encode(auth, c.AUTH_BASIC);
+    snprintf(auth, sizeof(auth), "%s:%s", c.EPH_USERNAME, c.EPH_PASSWORD);
+    base64_encode(auth, c.EPH_AUTH_BASIC);
+    *out = c;
+    return true;
+}
+
+/* ntrip_multi_set_reload_hook(): the new base config after a SIGHUP or
+ * a change of the config or mounts file. */
+static bool multi_reload_hook(NTRIP_Config *base, void *user)
+{
+    (void)user;
+    if (!config_watch_due()) return false;
+    INFO("[CONFIG] Reloading %s and %s\n", reload_config_path, reload_mounts_path);
+    return reload_config(base);
+}
+
+/* ── Sky-mode: per-frame handler shared by the obs and stdin loops ─── */
+#define SKY_DT_TYPES  32               /* message types with an interval sketch */
+
+typedef struct {
+    int     msg_type;
+    double  last_time;
+    QSketch dt;
+} SkyTypeDt;
+
+typedef struct {
+    const NTRIP_Config *config;
+    RtcmDecoderCtx     *dec;           /* station ARP of the obs stream */
+    SkyRenderSector    *sectors;
+    RtcmStrBuf         *sink;          /* discard sink, or NULL with -v */
+    long                frame_total;
+    long                msm_total;
+    long                obs_total;     /* sector updates */
+    uint64_t            sv_seen[8];    /* MSM satellite masks per GNSS id */
+    int                 n_dt;
+    SkyTypeDt           dt[SKY_DT_TYPES]; /* intervals per type, for the summary */
+    ObsQuality         *quality;       /* signal quality for the summary, or NULL */
+} SkyFrameCtx;
+
+/* Add the interval since the previous frame of type @p mt (stream time). */
+static void sky_type_interval(SkyFrameCtx *ctx, int mt, double now)
+{
+    int i = 0;
+    while (i < ctx->n_dt && ctx->dt[i].msg_type != mt) i++;
+    if (i == ctx->n_dt) {
+        if (ctx->n_dt == SKY_DT_TYPES) return;
+        ctx->n_dt++;
+        ctx->dt[i].msg_type  = mt;
+        ctx->dt[i].last_time = now;
+        return;
+    }
+    qsketch_add(&ctx->dt[i].dt, now - ctx->dt[i].last_time);
+    ctx->dt[i].last_time = now;
+}
+
+/* --perf stage latency of the sky obs source (one stream per run) */
+static PerfStream sky_perf;
+
+/* ── Sky-mode: checkpoint / resume (--checkpoint, --resume) ─────────── */
+static SkyFileMeta sky_meta;           /* describes the grid being collected */
+static double      sky_ckpt_next;      /* wall time of the next checkpoint */
+static bool        sky_arp_checked;    /* resumed ARP compared with the stream's */
+
+static const char *sky_checkpoint_target(void)
+{
+    return checkpoint_path ? checkpoint_path : resume_path;
+}
+
+/* Stream time in Unix seconds: the capture's own time on a replay. */
+static int64_t sky_stream_unix(void)
+{
+    if (!stream_clock_is_virtual())
+        return stream_clock_utc_ns() / 1000000000LL;
+    int week;
+    double tow;
+    stream_clock_gps_time(&week, &tow);
+    int64_t gps = 315964800LL + (int64_t)week * 604800 + (int64_t)tow;
+    return gps - stream_clock_leap_seconds(gps);
+}
+
+/* Start the metadata of this run: from the --resume grid if there is
+ * one (its counts go into @p sectors).  false if it cannot be read. */
+static bool sky_checkpoint_begin(SkyRenderSector *sectors, const NTRIP_Config *config)
+{
+    memset(&sky_meta, 0, sizeof(sky_meta));
+    sky_arp_checked = false;
+    if (resume_path) {
+        FILE *f = fopen(resume_path, "rb");
+        if (!f) {
+            INFO("[SKY] %s does not exist yet, starting with an empty grid\n", resume_path);
+        } else {
+            fclose(f);
+            if (!sky_file_read(resume_path, sectors, &sky_meta)) return false;
+            INFO("[SKY] Resumed %s: %u run%s%s%s\n", resume_path, sky_meta.runs,
+                 sky_meta.runs == 1 ? "" : "s",
+                 sky_meta.mountpoint[0] ? " of " : "", sky_meta.mountpoint);
+        }
+    }
+    /* --expected: the baseline's counts, the run adds the observed ones
+     * (never with --resume, so the grid is still empty). */
+    if (expected_path) {
+        SkyFileMeta base;
+        if (!sky_file_read(expected_path, sectors, &base)) return false;
+        for (int k = 0; k < SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS; k++)
+            sectors[k].observed = 0;
+        sky_meta.arp_valid = base.arp_valid;
+        sky_meta.arp_x     = base.arp_x;
+        sky_meta.arp_y     = base.arp_y;
+        sky_meta.arp_z     = base.arp_z;
+        sky_collect_set_observed_only(true);
+        INFO("[SKY] Expected counts from %s; counting the observed SVs only\n", expected_path);
+    }
+    if (!sky_meta.mountpoint[0])
+        snprintf(sky_meta.mountpoint, sizeof(sky_meta.mountpoint), "%.47s", config->MOUNTPOINT);
+    sky_meta.runs++;
+    sky_ckpt_next = stream_clock_wall_seconds() + SKY_FILE_CHECKPOINT_S;
+    return true;
+}
+
+/* Sector updates of GNSS @p gnss_id at ARP (sx, sy, sz). */
+static void sky_meta_update(int gnss_id, double sx, double sy, double sz)
+{
+    int64_t now = sky_stream_unix();
+    if (!sky_meta.t_first || now < sky_meta.t_first) sky_meta.t_first = now;
+    if (now > sky_meta.t_last) sky_meta.t_last = now;
+    if (gnss_id > 0 && gnss_id < 32) sky_meta.gnss_mask |= 1u << gnss_id;
+
+    if (sky_meta.arp_valid && !sky_arp_checked) {
+        double dx = sx - sky_meta.arp_x, dy = sy - sky_meta.arp_y, dz = sz - sky_meta.arp_z;
+        double d = sqrt(dx * dx + dy * dy + dz * dz);
+        if (d > SKY_FILE_ARP_TOL_M)
+            ERR("[WARN] The stream's ARP is %.0f m from the one of %s\n", d,
+                resume_path ? resume_path : expected_path);
+    }
+    sky_arp_checked = true;
+    sky_meta.arp_valid = true;
+    sky_meta.arp_x = sx;
+    sky_meta.arp_y = sy;
+    sky_meta.arp_z = sz;
+}
+
+/* Rewrite the checkpoint if one is due, or now if @p force. */
+static void sky_checkpoint(const SkyRenderSector *sectors, bool force)
+{
+    const char *path = sky_checkpoint_target();
+    if (!path) return;
+    double now = stream_clock_wall_seconds();
+    if (!force && now < sky_ckpt_next) return;
+    sky_ckpt_next = now + SKY_FILE_CHECKPOINT_S;
+    if (sky_file_write(path, sectors, &sky_meta) && (force || verbose))
+        INFO("[SAVE] Checkpoint %s\n", path);
+}
+
+/* ── Sky-mode: live heatmaps (--snapshot-interval) ──────────────────── */
+static SkySnapshot *sky_snap;           /* open while a --snapshot-interval run lasts */
+static char         sky_snap_path[260]; /* the heatmap it keeps current */
+
+/* The --png-sizes outputs of one heatmap: @p path at the first size, the
+ * others next to it as <path>_<W>x<H>.png (or .svg, which the batch
+ * renderer writes as vector graphics).  Fills one job (a copy of
+ * @p proto) and name per size and returns how many. */
+static int sky_png_jobs(const SkyRenderJob *proto, const char *path,
+                        SkyRenderJob *jobs, char (*names)[512])
+{
+    static const SkyRenderSize def_size = { 800, 800 };
+    const SkyRenderSize *sizes = n_png_sizes ? png_sizes : &def_size;
+    int n = n_png_sizes ? n_png_sizes : 1;
+    size_t len  = strlen(path);
+    size_t stem = len >= 4 && (strcmp(path + len - 4, ".png") == 0 ||
+                               strcmp(path + len - 4, ".PNG") == 0 ||
+                               sky_render_is_svg(path)) ? len - 4 : len;
+    for (int k = 0; k < n; k++) {
+        jobs[k] = *proto;
+        jobs[k].width  = sizes[k].width;
+        jobs[k].height = sizes[k].height;
+        if (k == 0)
+            snprintf(names[k], sizeof(names[k]), "%s", path);
+        else
+            snprintf(names[k], sizeof(names[k]), "%.*s_%dx%d%s", (int)stem, path,
+                     sizes[k].width, sizes[k].height, path + stem);
+        jobs[k].filename = names[k];
+    }
+    return n;
+}
+
+/* The default heatmap name, <local time>_ARP-EPG.png (the GUI's convention). */
+static void sky_default_output(char *buf, size_t len)
+{
+    time_t now_t = time(NULL);
+    struct tm *lt = localtime(&now_t);
+    char ts[16] = "00000000000000";
+    if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
+    snprintf(buf, len, "%s_ARP-EPG.png", ts);
+}
+
+/* The jobs of a heatmap of @p sectors: ARP and UTC time of now in the
+ * footer (@p utc_label holds the latter). */
+static void sky_heatmap_proto(SkyRenderJob *proto, const SkyRenderSector *sectors,
+                              const NTRIP_Config *config, char utc_label[40])
+{
+    bool   arp_valid = false;
+    double lat = 0, lon = 0, alt = 0;
+    rtcm_get_station_arp(&arp_valid, NULL, NULL, NULL, &lat, &lon, &alt);
+    if (!arp_valid) {
+        lat = config->LATITUDE;
+        lon = config->LONGITUDE;
+        alt = 0.0;
+        if (lat != 0.0 || lon != 0.0) arp_valid = true;
+    }
+
+    utc_label[0] = '\0';
+    time_t now_t = time(NULL);
+    struct tm *gt = gmtime(&now_t);
+    if (gt) strftime(utc_label, 40, "%Y-%m-%d %H:%M:%S UTC", gt);
+
+    memset(proto, 0, sizeof(*proto));
+    proto->sectors     = sectors;
+    proto->have_arp    = arp_valid;
+    proto->arp_lat_deg = lat;
+    proto->arp_lon_deg = lon;
+    proto->arp_alt_m   = alt;
+    proto->mountpoint  = config->MOUNTPOINT;
+    proto->utc_label   = utc_label;
+}
+
+/* Hand the grid to the snapshot thread if the interval has passed: a
+ * copy of a few kB, then straight back to the stream. */
+static void sky_live_snapshot(const SkyRenderSector *sectors, const NTRIP_Config *config)
+{
+    if (!sky_snapshot_due(sky_snap)) return;
+    SkyRenderJob proto, jobs[SKY_RENDER_MAX_SIZES];
+    char names[SKY_RENDER_MAX_SIZES][512];
+    char utc_label[40];
+    sky_heatmap_proto(&proto, sectors, config, utc_label);
+    int n_jobs = sky_png_jobs(&proto, sky_snap_path, jobs, names);
+    sky_snapshot_submit(sky_snap, jobs, n_jobs);
+}
+
+static void sky_obs_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    SkyFrameCtx *ctx = (SkyFrameCtx *)user;
+    const NTRIP_Config *config = ctx->config;
+    int msg_length = frame_len - 6;
+    if (msg_length < 2) return;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+
+    PerfFrame pf;
+    perf_frame_begin(&sky_perf, &pf);
+
+    ctx->frame_total++;
+    stream_clock_feed(frame, frame_len);
+    sky_type_interval(ctx, mt, stream_clock_seconds());
+    ntrip_record_frame(frame, frame_len);     /* --record (obs stream only) */
+    perf_frame_stage(&sky_perf, &pf, PERF_STAGE_OUTPUT);
+
+    /* Reset the discard sink between frames so it can't grow
+     * unbounded if we're running for hours. */
+    if (ctx->sink) rtcm_strbuf_clear(ctx->sink);
+
+    /* Decode 1005/1006 so the station ARP gets cached for
+     * azel_from_ecef.  Don't decode MSM frames -- we only need
+     * the sat-mask + sectorisation, which sky_collect handles (one
+     * sky update per GNSS epoch, however many MSM types carry it). */
+    if (mt == 1005) {
+        decode_rtcm_1005_ctx(ctx->dec, &frame[3], msg_length, config);
+    } else if (mt == 1006) {
+        decode_rtcm_1006_ctx(ctx->dec, &frame[3], msg_length, config);
+    } else if (rtcm_msg_is_eph(mt) || rtcm_msg_is_msm(mt, 4, 7)) {
+        sky_obs_eph(mt, &frame[3], msg_length);
+    }
+
+    /* The quality engine is the one consumer that needs every cell. */
+    if (ctx->quality) obs_quality_add_frame(ctx->quality, frame, frame_len);
+
+    if (rtcm_msg_is_msm(mt, 4, 7)) {
+        ctx->msm_total++;
+        int g = rtcm_msg_gnss_id(mt);
+        if (g > 0 && g < 8 && msg_length >= 17)
+            ctx->sv_seen[g] |= rtcm_bits_at(&frame[3], msg_length, 73, 64);
+        perf_frame_stage(&sky_perf, &pf, PERF_STAGE_DECODE);
+
+        /* Get current ARP -- prefer cached 1005/1006, fall back
+         * to the configured rover lat/lon at altitude 0. */
+        bool   arp_valid = false;
+        double sx = 0, sy = 0, sz = 0;
+        rtcm_ctx_get_station_arp(ctx->dec, &arp_valid, &sx, &sy, &sz,
+                                 NULL, NULL, NULL);
+        if (!arp_valid &&
+            (config->LATITUDE != 0.0 || config->LONGITUDE != 0.0)) {
+            geodetic_to_ecef(config->LATITUDE, config->LONGITUDE,
+                             0.0, &sx, &sy, &sz);
+            arp_valid = true;
+        }
+
+        if (arp_valid) {
+            int upd = sky_collect_feed_msm(ctx->sectors, &frame[3], msg_length, mt,
+                                           sx, sy, sz);
+            ctx->obs_total += upd;
+            if (upd > 0) sky_meta_update(g, sx, sy, sz);
+            perf_frame_stage(&sky_perf, &pf, PERF_STAGE_SKY);
+        }
+    } else {
+        perf_frame_stage(&sky_perf, &pf, PERF_STAGE_DECODE);
+    }
+    perf_frame_end(&sky_perf, &pf);
+    sky_checkpoint(ctx->sectors, false);
+    sky_live_snapshot(ctx->sectors, config);
+    eph_cache_tick(false);
+}
+
+/* --json "summary" event at the end of a replay: the counters, the
+ * satellites seen per GNSS, the interval sketch of every message type,
+ * the signal quality rows (obs_quality.h) and the whole sector grid, so a batch run
+ * (batch_replay.h) can tabulate and aggregate its children. */
+static void sky_print_summary_json(const SkyFrameCtx *ctx, unsigned long crc_errors,
+                                   unsigned long skipped, double hours)
+{
+    static const char gnss[8][2] = { "?", "G", "R", "E", "J", "C", "S", "I" };
+    const int n = SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS;
+
+    event_begin(g_events, "summary");
+    event_str(g_events, "source", "replay");
+    event_int(g_events, "frames", ctx->frame_total);
+    event_int(g_events, "msm", ctx->msm_total);
+    event_int(g_events, "upd", ctx->obs_total);
+    event_uint(g_events, "crc_errors", crc_errors);
+    event_uint(g_events, "skipped", skipped);
+    event_fixed(g_events, "hours", hours, 4);
+    event_obj(g_events, "sv_mask");
+    for (int g = 1; g < 8; g++) {
+        if (!ctx->sv_seen[g]) continue;
+        char mask[17];
+        snprintf(mask, sizeof(mask), "%016llx", (unsigned long long)ctx->sv_seen[g]);
+        event_str(g_events, gnss[g], mask);
+    }
+    event_close(g_events);
+    event_obj(g_events, "dt");
+    for (int i = 0; i < ctx->n_dt; i++) {
+        char key[12];
+        snprintf(key, sizeof(key), "%d", ctx->dt[i].msg_type);
+        qsketch_to_event(&ctx->dt[i].dt, g_events, key);
+    }
+    event_close(g_events);
+    if (ctx->quality) {
+        obs_quality_to_event(&ctx->quality->stats, g_events, "quality");
+    } else {
+        event_arr(g_events, "quality");
+        event_close(g_events);
+    }
+    event_obj(g_events, "sectors");
+    event_arr(g_events, "observed");
+    for (int k = 0; k < n; k++) event_int(g_events, NULL, ctx->sectors[k].observed);
+    event_close(g_events);
+    event_arr(g_events, "expected");
+    for (int k = 0; k < n; k++) event_int(g_events, NULL, ctx->sectors[k].expected);
+    event_close(g_events);
+    event_close(g_events);
+    event_end(g_events);
+}
+
 /* ── Sky-mode: read obs RTCM from stdin (--rtcm-stdin) ───────────────
  * Mirrors run_sky_obs_stream() but reads from stdin instead of a
  * socket.  Auto-stops at EOF (reason=eof); Ctrl-C and Ctrl-A behave
@@ -349,10 +958,13 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
              duration_s);
     else
         INFO("Collecting heatmap data: Ctrl-C to save PNG and exit, Ctrl-A to abort without saving\n");
-    if (json_output)
-        fprintf(stderr,
-                "{\"event\":\"start\",\"source\":\"stdin\",\"t\":%ld,\"duration_s\":%d}\n",
-                (long)t_start, duration_s);
+    if (json_output) {
+        event_begin(g_events, "start");
+        event_str(g_events, "source", "stdin");
+        event_int(g_events, "t", t_start);
+        event_int(g_events, "duration_s", duration_s);
+        event_end(g_events);
+    }
 
     terminal_setup();
 
@@ -366,13 +978,11 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
         sink_used = 1;
     }
 
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int  msg_buffer_len = 0;
-    char buffer[BUFFER_SIZE];
+    SkyFrameCtx ctx = { .config = config, .dec = rtcm_decoder_default(),
+                        .sectors = sectors, .sink = sink_used ? &sink : NULL };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, sky_obs_frame, &ctx);
 
-    long  msm_total     = 0;
-    long  obs_total     = 0;
-    long  frame_total   = 0;
     long  bytes_total   = 0;
     long  bytes_at_tick = 0;
     time_t last_tick    = t_start;
@@ -380,7 +990,10 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
     int spin_i = 0;
 
     while (!g_stop_requested && !g_abort_requested) {
-        size_t got = fread(buffer, 1, sizeof(buffer), stdin);
+        size_t avail;
+        unsigned char *dst = rtcm_framer_write_ptr(&framer, &avail);
+        size_t got = fread(dst, 1, avail, stdin);
+        if (got > 0) perf_recv(&sky_perf);
         if (got == 0) {
             if (feof(stdin)) {
                 *reason = STOP_REASON_EOF;
@@ -415,20 +1028,24 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
             bytes_at_tick = bytes_total;
             double kBps = (double)bytes_in_window / 1024.0;
             if (json_output) {
-                fprintf(stderr,
-                    "{\"event\":\"tick\",\"t\":%ld,\"frames\":%ld,\"msm\":%ld,"
-                    "\"upd\":%ld,\"kBps\":%.2f,\"total_kb\":%ld,\"source\":\"stdin\"}\n",
-                    (long)now, frame_total, msm_total, obs_total,
-                    kBps, bytes_total / 1024);
+                event_begin(g_events, "tick");
+                event_int(g_events, "t", now);
+                event_int(g_events, "frames", ctx.frame_total);
+                event_int(g_events, "msm", ctx.msm_total);
+                event_int(g_events, "upd", ctx.obs_total);
+                event_fixed(g_events, "kBps", kBps, 2);
+                event_int(g_events, "total_kb", bytes_total / 1024);
+                event_str(g_events, "source", "stdin");
+                event_end(g_events);
             } else if (stderr_is_tty) {
                 fprintf(stderr,
                     "\r [%c] stdin frames=%ld  MSM=%ld  upd=%ld  rate=%5.1f kB/s  total=%ld KB    ",
-                    spin[spin_i & 3], frame_total, msm_total, obs_total,
+                    spin[spin_i & 3], ctx.frame_total, ctx.msm_total, ctx.obs_total,
                     kBps, bytes_total / 1024);
             } else {
                 fprintf(stderr,
                     "[%c] stdin frames=%ld  MSM=%ld  upd=%ld  rate=%5.1f kB/s  total=%ld KB\n",
-                    spin[spin_i & 3], frame_total, msm_total, obs_total,
+                    spin[spin_i & 3], ctx.frame_total, ctx.msm_total, ctx.obs_total,
                     kBps, bytes_total / 1024);
             }
             fflush(stderr);
@@ -437,66 +1054,8 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
         }
 
         /* Same frame-parsing pipeline as run_sky_obs_stream. */
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received &&
-                       (unsigned char)buffer[buf_pos] != 0xD3) buf_pos++;
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE)
-                to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int frame_len  = 3 + msg_length + 3;
-                if (msg_buffer_len < frame_len) break;
-                if (msg_length < 2) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int mt = ((int)msg_buffer[3] << 4) | ((int)msg_buffer[4] >> 4);
-                frame_total++;
-
-                if (mt == 1005) {
-                    decode_rtcm_1005(&msg_buffer[3], msg_length, config);
-                } else if (mt == 1006) {
-                    decode_rtcm_1006(&msg_buffer[3], msg_length, config);
-                }
-
-                int subtype = mt % 10;
-                if (mt >= 1070 && mt <= 1139 && subtype >= 4 && subtype <= 7) {
-                    msm_total++;
-                    bool   arp_valid = false;
-                    double sx = 0, sy = 0, sz = 0;
-                    rtcm_get_station_arp(&arp_valid, &sx, &sy, &sz, NULL, NULL, NULL);
-                    if (!arp_valid &&
-                        (config->LATITUDE != 0.0 || config->LONGITUDE != 0.0)) {
-                        geodetic_to_ecef(config->LATITUDE, config->LONGITUDE, 0.0,
-                                         &sx, &sy, &sz);
-                        arp_valid = true;
-                    }
-                    if (arp_valid) {
-                        int contrib = sky_collect_feed_msm(
-                            sectors, &msg_buffer[3], msg_length, mt,
-                            sx, sy, sz);
-                        obs_total += contrib;
-                    }
-                }
-
-                memmove(msg_buffer, msg_buffer + frame_len,
-                        msg_buffer_len - frame_len);
-                msg_buffer_len -= frame_len;
-            }
-        }
+        rtcm_framer_commit(&framer, got);
+        stream_format_log(rtcm_framer_new_format(&framer), "stdin");
     }
 
     if (*reason == STOP_REASON_NONE) {
@@ -504,9 +1063,17 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
         else if (g_stop_requested) *reason = STOP_REASON_SIGINT;
     }
 
+    /* Score the last epoch of every GNSS still held by the assembler. */
+    ctx.obs_total += sky_collect_flush(sectors);
+
     if (show_progress && stderr_is_tty && !json_output) INFO("\n");
     INFO("[OBS] stdin closed (frames=%ld  MSM=%ld  sector updates=%ld  total=%ld KB)\n",
-         frame_total, msm_total, obs_total, bytes_total / 1024);
+         ctx.frame_total, ctx.msm_total, ctx.obs_total, bytes_total / 1024);
+    INFO("[OBS] Framer: CRC errors=%lu  skipped=%lu bytes  resyncs=%lu\n",
+         framer.crc_errors, framer.skipped_bytes, framer.resyncs);
+    if (framer.format != STREAM_FMT_RTCM3 && framer.format != STREAM_FMT_NONE)
+        INFO("[OBS] Stream format: %s (%lu frames)\n", stream_format_name(framer.format),
+             framer.frames);
     terminal_restore();
     if (sink_used) {
         rtcm_set_output_buffer(NULL);
@@ -515,101 +1082,195 @@ static int run_sky_stdin_stream(const NTRIP_Config *config,
     return 0;
 }
 
-/* ── Sky-mode: obs stream with on-the-fly sector accumulation ──────── */
-/* Returns 0 on clean stop, non-zero on connection failure.  Sets *reason
- * to indicate why the loop exited (used by JSON summary). */
-static int run_sky_obs_stream(const NTRIP_Config *config,
-                              SkyRenderSector *sectors,
-                              int duration_s,
-                              bool verbose,
-                              StopReason *reason)
+/* --replay-speed: hold the replay to @p speed x the capture's stream
+ * time @p v (seconds; MSM time for a raw capture, receive time for a
+ * native one).  *@p v0 / *@p w0 anchor stream to wall time (@p v0 < 0:
+ * not anchored).  Gaps in the recording longer than 10 s of wall time
+ * are skipped by re-anchoring rather than slept through. */
+static void replay_pace(double speed, double v, double *v0, double *w0)
 {
+    double now = stream_clock_wall_seconds();
+    if (*v0 < 0.0 || v < *v0) {
+        *v0 = v;
+        *w0 = now;
+        return;
+    }
+    double wait = *w0 + (v - *v0) / speed - now;
+    if (wait > 10.0) {
+        *v0 = v;
+        *w0 = now;
+        return;
+    }
+    while (wait > 0.0 && !g_stop_requested && !g_abort_requested) {
+        double step = wait < 0.2 ? wait : 0.2;
 #ifdef _WIN32
-    typedef SOCKET sock_t;
-#define SK_CLOSE closesocket
-#define SK_INVALID INVALID_SOCKET
+        Sleep((DWORD)(step * 1000.0));
 #else
-    typedef int sock_t;
-#define SK_CLOSE close
-#define SK_INVALID -1
+        struct timespec ts = { 0, (long)(step * 1e9) };
+        nanosleep(&ts, NULL);
 #endif
-
-    struct addrinfo hints, *result;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    if (getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result) != 0) {
-        fprintf(stderr, "[OBS] DNS lookup failed for %s\n", config->NTRIP_CASTER);
-        return 1;
+        wait = *w0 + (v - *v0) / speed - stream_clock_wall_seconds();
     }
+}
 
-    sock_t sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (sock == SK_INVALID) {
-        fprintf(stderr, "[OBS] Socket creation failed\n");
-        freeaddrinfo(result);
-        return 1;
-    }
+/* ── Sky-mode: replay keyframes (--replay-seek) ──────────────────────
+ * A replay from the first frame saves the sky state every 10 min of
+ * stream time to <capture>.rtkey (replay_keyframe.h); --replay-seek
+ * restores the last one before its target instead of replaying up to it. */
+enum {
+    SKY_KEY_STATE = 1,                 /* SkyKeyState */
+    SKY_KEY_GRID  = 2,                 /* the sector grid */
+    SKY_KEY_EPH   = 3                  /* SvEphemeris versions new since the previous keyframe */
+};
 
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port   = htons(config->NTRIP_PORT);
-    server.sin_addr   = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
-    freeaddrinfo(result);
+#define SKY_GRID_BYTES \
+    (sizeof(SkyRenderSector) * SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
 
-    if (connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)) < 0) {
-        fprintf(stderr, "[OBS] Connect failed to %s:%d\n",
-                config->NTRIP_CASTER, config->NTRIP_PORT);
-        SK_CLOSE(sock);
-        return 1;
+typedef struct {
+    long            frame_total, msm_total, obs_total;
+    uint64_t        sv_seen[8];
+    int             n_dt;
+    SkyTypeDt       dt[SKY_DT_TYPES];
+    int64_t         gps_ms;            /* virtual clock */
+    bool            arp_valid;         /* station ARP of the decoder */
+    double          arp_x, arp_y, arp_z;
+    double          arp_lat_deg, arp_lon_deg, arp_alt_m;
+    SkyFileMeta     meta;
+    SkyCollectState collect;
+} SkyKeyState;
+
+/* The toes held per satellite when the previous keyframe was saved. */
+static double  sky_key_toe[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS][SV_EPH_HISTORY];
+static uint8_t sky_key_n_toe[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+
+static void sky_key_save(ReplayKeyWriter *w, const SkyFrameCtx *ctx,
+                         size_t frame, uint32_t t_ms)
+{
+    SkyKeyState st;
+    memset(&st, 0, sizeof(st));
+    st.frame_total = ctx->frame_total;
+    st.msm_total   = ctx->msm_total;
+    st.obs_total   = ctx->obs_total;
+    memcpy(st.sv_seen, ctx->sv_seen, sizeof(st.sv_seen));
+    st.n_dt = ctx->n_dt;
+    memcpy(st.dt, ctx->dt, sizeof(st.dt));
+    st.gps_ms      = stream_clock_virtual_ms();
+    st.arp_valid   = ctx->dec->arp_valid;
+    st.arp_x       = ctx->dec->arp_x;
+    st.arp_y       = ctx->dec->arp_y;
+    st.arp_z       = ctx->dec->arp_z;
+    st.arp_lat_deg = ctx->dec->arp_lat_deg;
+    st.arp_lon_deg = ctx->dec->arp_lon_deg;
+    st.arp_alt_m   = ctx->dec->arp_alt_m;
+    st.meta        = sky_meta;
+    sky_collect_save(&st.collect);
+
+    /* Only the ephemerides added since the previous keyframe: a restore
+     * stores those of every keyframe up to its own, in order. */
+    SvEphemeris *add = NULL;
+    size_t n_add = 0, cap = 0;
+    for (int g = 1; g < SV_EPH_MAX_GNSS; g++) {
+        for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS; prn++) {
+            const SvEphemeris *v[SV_EPH_HISTORY];
+            double *toe = sky_key_toe[g][prn - 1];
+            uint8_t *n_toe = &sky_key_n_toe[g][prn - 1];
+            int k = sv_eph_get_all(g, prn, v);
+            for (int i = 0; i < k; i++) {
+                int j = 0;
+                while (j < *n_toe && toe[j] != v[i]->toe) j++;
+                if (j < *n_toe) continue;
+                if (n_add == cap) {
+                    size_t ncap = cap ? cap * 2 : 256;
+                    SvEphemeris *n = (SvEphemeris *)realloc(add, ncap * sizeof(*n));
+                    if (!n) break;
+                    add = n;
+                    cap = ncap;
+                }
+                add[n_add++] = *v[i];
+            }
+            for (int i = 0; i < k; i++) toe[i] = v[i]->toe;
+            *n_toe = (uint8_t)k;
+        }
     }
 
-    char request[1024];
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->MOUNTPOINT, config->NTRIP_CASTER, config->AUTH_BASIC);
-    send(sock, request, strlen(request), 0);
+    replay_key_begin(w, frame, t_ms);
+    replay_key_put(w, SKY_KEY_STATE, &st, sizeof(st));
+    replay_key_put(w, SKY_KEY_GRID, ctx->sectors, SKY_GRID_BYTES);
+    replay_key_put(w, SKY_KEY_EPH, add, n_add * sizeof(SvEphemeris));
+    replay_key_end(w);
+    free(add);
+}
 
-    /* Optional GGA push (some casters require it before sending data). */
-    char gga[100];
-    create_gngga_sentence(config->LATITUDE, config->LONGITUDE, gga);
-    char gga_with_crlf[104];
-    snprintf(gga_with_crlf, sizeof(gga_with_crlf), "%s\r\n", gga);
-    time_t last_gga_time = time(NULL);
+/* Continue from keyframe @p key.  false if it was written by a build
+ * with other structures (nothing is changed then). */
+static bool sky_key_restore(const ReplayKeys *k, const ReplayKey *key, SkyFrameCtx *ctx)
+{
+    size_t len, grid_len;
+    const SkyKeyState *st = (const SkyKeyState *)
+        replay_keys_section(k, key, SKY_KEY_STATE, &len);
+    const void *grid = replay_keys_section(k, key, SKY_KEY_GRID, &grid_len);
+    if (!st || len != sizeof(*st) || !grid || grid_len != SKY_GRID_BYTES ||
+        st->n_dt < 0 || st->n_dt > SKY_DT_TYPES)
+        return false;
+    for (const ReplayKey *e = k->keys; e <= key; e++) {
+        if (!replay_keys_section(k, e, SKY_KEY_EPH, &len) || len % sizeof(SvEphemeris))
+            return false;
+    }
 
-    /* Short recv timeout so the SIGINT flag is polled. */
-#ifdef _WIN32
-    DWORD tv_ms = 500;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv_ms, sizeof(tv_ms));
-#else
-    struct timeval tv = { 0, 500000 };
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof(tv));
-#endif
+    for (const ReplayKey *e = k->keys; e <= key; e++) {
+        const unsigned char *p =
+            (const unsigned char *)replay_keys_section(k, e, SKY_KEY_EPH, &len);
+        for (size_t off = 0; off < len; off += sizeof(SvEphemeris)) {
+            SvEphemeris eph;
+            memcpy(&eph, p + off, sizeof(eph));
+            sv_eph_store(&eph);
+        }
+    }
+    ctx->frame_total = st->frame_total;
+    ctx->msm_total   = st->msm_total;
+    ctx->obs_total   = st->obs_total;
+    memcpy(ctx->sv_seen, st->sv_seen, sizeof(ctx->sv_seen));
+    ctx->n_dt = st->n_dt;
+    memcpy(ctx->dt, st->dt, sizeof(ctx->dt));
+    stream_clock_set_virtual_ms(st->gps_ms);
+    ctx->dec->arp_valid   = st->arp_valid;
+    ctx->dec->arp_x       = st->arp_x;
+    ctx->dec->arp_y       = st->arp_y;
+    ctx->dec->arp_z       = st->arp_z;
+    ctx->dec->arp_lat_deg = st->arp_lat_deg;
+    ctx->dec->arp_lon_deg = st->arp_lon_deg;
+    ctx->dec->arp_alt_m   = st->arp_alt_m;
+    SkyFileMeta meta = st->meta;
+    memcpy(meta.mountpoint, sky_meta.mountpoint, sizeof(meta.mountpoint));
+    meta.runs = sky_meta.runs;
+    sky_meta = meta;
+    sky_arp_checked = true;
+    sky_collect_restore(&st->collect);
+    memcpy(ctx->sectors, grid, SKY_GRID_BYTES);
+    return true;
+}
 
-    INFO("[OBS] Connected to %s:%d /%s\n",
-         config->NTRIP_CASTER, config->NTRIP_PORT, config->MOUNTPOINT);
-    if (duration_s > 0)
-        INFO("Collecting heatmap data for %d s (Ctrl-C to save early, Ctrl-A to abort without saving)\n",
-             duration_s);
-    else
-        INFO("Collecting heatmap data: Ctrl-C to save PNG and exit, Ctrl-A to abort without saving\n");
-    if (json_output)
-        fprintf(stderr,
-                "{\"event\":\"start\",\"source\":\"ntrip\",\"caster\":\"%s\",\"port\":%d,"
-                "\"mountpoint\":\"%s\",\"t\":%ld,\"duration_s\":%d}\n",
-                config->NTRIP_CASTER, config->NTRIP_PORT, config->MOUNTPOINT,
-                (long)time(NULL), duration_s);
-    fflush(stdout);
+/* Frame of a --replay-start / --replay-seek value: "<sec>" or "#<frame>". */
+static size_t replay_frame_of(const RtcmReplay *rp, const char *spec)
+{
+    size_t i = spec[0] == '#'
+        ? (size_t)strtoul(spec + 1, NULL, 10)
+        : rtcm_replay_find_time(rp, (uint32_t)(atof(spec) * 1000.0));
+    return i > rp->n_frames ? rp->n_frames : i;
+}
 
-    /* TTY detection on stderr (status line writes there now so stdout
-     * stays reserved for data).  When stderr is a pipe / file, the
-     * carriage-return spinner becomes garbage -- switch to one-line-
-     * per-tick.  --quiet and --no-progress suppress the line entirely. */
+/* ── Sky-mode: replay a capture file (--replay) ──────────────────────
+ * Like run_sky_stdin_stream() but the capture is memory-mapped and
+ * indexed (rtcm_replay.h), so frames are fed straight from the mapping
+ * and --replay-start can skip to a time offset or frame number:
+ *     ./ntripanalyse --sky --replay cap.rtcm3 --replay-start 3600 -R brdc.rnx
+ */
+static int run_sky_replay_stream(const NTRIP_Config *config,
+                                 SkyRenderSector *sectors,
+                                 int duration_s,
+                                 bool verbose,
+                                 StopReason *reason)
+{
 #ifdef _WIN32
     bool stderr_is_tty = _isatty(_fileno(stderr)) != 0;
 #else
@@ -617,9 +1278,45 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
 #endif
     bool show_progress = !quiet && !no_progress;
 
-    /* Mute the per-frame decode chatter (RTCM 1005/1006 reference-station
-     * blocks) unless -v is on.  The user's own [OBS] / spinner output
-     * uses printf directly, so it stays visible either way. */
+    RtcmReplay rp;
+    if (!rtcm_replay_open(&rp, replay_path)) {
+        ERR("[ERROR] Cannot open capture file: %s\n", replay_path);
+        *reason = STOP_REASON_ERROR;
+        return 1;
+    }
+    if (rp.format != STREAM_FMT_RTCM3 && rp.format != STREAM_FMT_UNKNOWN)
+        ERR("[WARN] %s holds no RTCM 3.x frames; it looks like %s\n",
+            replay_path, stream_format_name(rp.format));
+
+    /* Frames [from, first) are fed before the replay proper starts:
+     * with --replay-seek, those after the keyframe restored. */
+    size_t first = 0;
+    if (replay_start) first = replay_frame_of(&rp, replay_start);
+    if (replay_seek)  first = replay_frame_of(&rp, replay_seek);
+    size_t from = first;
+
+    time_t t_start = time(NULL);
+    INFO("[OBS] Replaying %s: %lu frames, %.2f h of %s time (index %s)\n",
+         replay_path, (unsigned long)rp.n_frames,
+         rtcm_replay_duration_ms(&rp) / 3600000.0,
+         rp.native ? "receive" : "MSM",
+         rp.native ? "native" : rp.index_cached ? "cached" : "built");
+    if (first > 0)
+        INFO("[OBS] Starting at frame %lu (t=%.1f s)\n", (unsigned long)first,
+             first < rp.n_frames ? rp.frames[first].t_ms / 1000.0 : 0.0);
+    if (json_output) {
+        event_begin(g_events, "start");
+        event_str(g_events, "source", "replay");
+        event_int(g_events, "t", t_start);
+        event_int(g_events, "duration_s", duration_s);
+        event_uint(g_events, "frames", rp.n_frames);
+        event_uint(g_events, "first", first);
+        event_end(g_events);
+    }
+
+    terminal_setup();
+
+    /* Same mute as run_sky_stdin_stream. */
     RtcmStrBuf sink;
     int        sink_used = 0;
     if (!verbose) {
@@ -628,45 +1325,373 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
         sink_used = 1;
     }
 
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
-    char buffer[BUFFER_SIZE];
-
-    long  msm_total      = 0;
-    long  obs_total      = 0;
-    long  frame_total    = 0;
-    long  bytes_total    = 0;       /* lifetime payload bytes (after HTTP header) */
-    long  bytes_at_tick  = 0;       /* snapshot at the start of the current second */
-    time_t t_start       = time(NULL);
-    time_t last_tick     = t_start;
+    SkyFrameCtx ctx = { .config = config, .dec = rtcm_decoder_default(),
+                        .sectors = sectors, .sink = sink_used ? &sink : NULL };
+    if (json_output) ctx.quality = (ObsQuality *)calloc(1, sizeof(ObsQuality));
+    time_t last_tick = t_start;
     const char spin[] = "|/-\\";
     int spin_i = 0;
 
-    /* Switch the controlling terminal into a non-canonical mode so we can
-     * poll for Ctrl-A without waiting for the user to press Enter.  Always
-     * call terminal_restore() before returning so the user's shell isn't
-     * left with echo off. */
-    terminal_setup();
-
-    while (!g_stop_requested && !g_abort_requested) {
-        int received = recv(sock, buffer, sizeof(buffer), 0);
-        if (received == 0) {
-            fprintf(stderr, "\n[OBS] Caster closed the connection\n");
-            *reason = STOP_REASON_EOF;
-            break;
+    ReplayKeys keys;
+    bool have_keys = replay_keys_open(&keys, replay_path);
+    if (replay_seek) {
+        from = 0;
+        const ReplayKey *key = have_keys ? replay_keys_find(&keys, first) : NULL;
+        if (key && sky_key_restore(&keys, key, &ctx)) {
+            from = (size_t)key->frame;
+            INFO("[OBS] Restored the keyframe at frame %lu (t=%.1f s); %lu frames to go\n",
+                 (unsigned long)from, key->t_ms / 1000.0, (unsigned long)(first - from));
+        } else {
+            INFO("[OBS] No usable keyframe before frame %lu in %s.rtkey; replaying from "
+                 "the start\n", (unsigned long)first, replay_path);
         }
-        if (received < 0) {
-#ifdef _WIN32
-            int err = WSAGetLastError();
-            if (err == WSAETIMEDOUT) { /* fall through to housekeeping */ }
-            else { *reason = STOP_REASON_ERROR; break; }
-#else
-            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-                /* fall through */
-            } else { *reason = STOP_REASON_ERROR; break; }
-#endif
-            received = 0;
+    }
+    /* A replay from the first frame with an empty grid writes the
+     * keyframes, unless a complete set is there already. */
+    ReplayKeyWriter kw = { 0 };
+    bool key_writing = from == 0 && !replay_start && !resume_path && !expected_path &&
+                       !(have_keys && keys.complete);
+    if (have_keys) replay_keys_close(&keys);
+    if (key_writing) replay_key_create(&kw, replay_path);
+
+    double pace_v0 = -1.0, pace_w0 = 0.0;
+    size_t i = from;
+    while (i < rp.n_frames) {
+        /* Check the stop conditions once per batch, not per frame; a
+         * paced replay has time to spare, so its batches are short.
+         * Frames before a --replay-seek target go unpaced. */
+        size_t batch_end = i + (replay_speed > 0.0 && i >= first ? 64 : 4096);
+        if (batch_end > rp.n_frames) batch_end = rp.n_frames;
+        for (; i < batch_end; i++) {
+            if (replay_key_due(&kw, rp.frames[i].t_ms))
+                sky_key_save(&kw, &ctx, i, rp.frames[i].t_ms);
+            int len;
+            const unsigned char *frame = rtcm_replay_frame(&rp, i, &len);
+            if (!frame) continue;             /* capture changed on disk */
+            sky_obs_frame(frame, len, &ctx);
+            if (replay_speed > 0.0 && i >= first)
+                replay_pace(replay_speed, rp.frames[i].t_ms / 1000.0,
+                            &pace_v0, &pace_w0);
+        }
+
+        if (g_stop_requested || g_abort_requested) break;
+        if (poll_for_ctrl_a()) {
+            g_abort_requested = 1;
+            *reason = STOP_REASON_ABORT;
+            break;
+        }
+        time_t now = time(NULL);
+        if (duration_s > 0 && difftime(now, t_start) >= (double)duration_s) {
+            INFO("\n[OBS] Reached --duration %d s\n", duration_s);
+            *reason = STOP_REASON_DURATION;
+            break;
+        }
+        if (show_progress && now != last_tick) {
+            double pos_s = rp.frames[i - 1].t_ms / 1000.0;
+            if (json_output) {
+                event_begin(g_events, "tick");
+                event_int(g_events, "t", now);
+                event_int(g_events, "frames", ctx.frame_total);
+                event_int(g_events, "msm", ctx.msm_total);
+                event_int(g_events, "upd", ctx.obs_total);
+                event_fixed(g_events, "pos_s", pos_s, 1);
+                event_str(g_events, "source", "replay");
+                event_end(g_events);
+            } else {
+                fprintf(stderr,
+                    "%s [%c] replay frames=%ld  MSM=%ld  upd=%ld  pos=%.0f s  (%lu%%)%s",
+                    stderr_is_tty ? "\r" : "",
+                    spin[spin_i & 3], ctx.frame_total, ctx.msm_total, ctx.obs_total,
+                    pos_s, (unsigned long)(100 * (unsigned long long)i / rp.n_frames),
+                    stderr_is_tty ? "    " : "\n");
+            }
+            fflush(stderr);
+            spin_i++;
+            last_tick = now;
+        }
+    }
+
+    if (*reason == STOP_REASON_NONE) {
+        if (g_abort_requested)     *reason = STOP_REASON_ABORT;
+        else if (g_stop_requested) *reason = STOP_REASON_SIGINT;
+        else                       *reason = STOP_REASON_EOF;
+    }
+
+    replay_key_finish(&kw, i == rp.n_frames);
+
+    /* Score the last epoch of every GNSS still held by the assembler. */
+    ctx.obs_total += sky_collect_flush(sectors);
+
+    if (show_progress && stderr_is_tty && !json_output) INFO("\n");
+    INFO("[OBS] Replay done (frames=%ld  MSM=%ld  sector updates=%ld)\n",
+         ctx.frame_total, ctx.msm_total, ctx.obs_total);
+    INFO("[OBS] Index: CRC errors=%lu  skipped=%lu bytes\n",
+         rp.crc_errors, rp.skipped_bytes);
+    if (json_output) {
+        size_t origin = replay_seek ? 0 : first;     /* where the state starts */
+        double hours = i > origin
+            ? (rp.frames[i - 1].t_ms - rp.frames[origin].t_ms) / 3600000.0 : 0.0;
+        sky_print_summary_json(&ctx, rp.crc_errors, rp.skipped_bytes, hours);
+    }
+    if (ctx.quality) {
+        obs_quality_free(ctx.quality);
+        free(ctx.quality);
+    }
+    terminal_restore();
+    if (sink_used) {
+        rtcm_set_output_buffer(NULL);
+        rtcm_strbuf_free(&sink);
+    }
+    rtcm_replay_close(&rp);
+    return 0;
+}
+
+/* ── Sky-mode: obs stream with on-the-fly sector accumulation ──────── */
+/* Stop check while run_sky_obs_stream() waits to reconnect: Ctrl-C,
+ * Ctrl-A or the end of --duration end the run instead. */
+typedef struct {
+    time_t t_start;
+    int    duration_s;
+} SkyStopCheck;
+
+static int sky_should_stop(void *user)
+{
+    const SkyStopCheck *c = (const SkyStopCheck *)user;
+    if (poll_for_ctrl_a()) g_abort_requested = 1;
+    if (g_stop_requested || g_abort_requested) return 1;
+    return c->duration_s > 0 &&
+           difftime(time(NULL), c->t_start) >= (double)c->duration_s;
+}
+
+/* SIGHUP / --watch-config while run_sky_obs_stream() runs: load the
+ * config again and apply what changed.  A changed eph stream is restarted
+ * here; a changed obs stream is pointed at its new target, for the caller
+ * to re-open.  Either both apply or, if the obs target is unusable,
+ * nothing does.  Returns the CONFIG_DIFF_* bits now in @p config. */
+static unsigned sky_reload(NTRIP_Config *config, NtripSession *session, bool verbose)
+{
+    NTRIP_Config next;
+    INFO("[CONFIG] Reloading %s\n", reload_config_path);
+    if (!reload_config(&next)) return 0;
+    unsigned d = config_diff(config, &next);
+    if (!d) {
+        INFO("[CONFIG] No changes\n");
+        return 0;
+    }
+
+    if (d & CONFIG_DIFF_OBS) {
+        if (next.RECONNECT_DELAY_MAX < 0) {
+            ERR("[CONFIG] The obs stream cannot switch with reconnecting off "
+                "(RECONNECT_DELAY_MAX < 0); keeping the running settings\n");
+            return 0;
+        }
+        if (!ntrip_session_set_target(session, next.NTRIP_CASTER, next.NTRIP_PORT,
+                                      next.MOUNTPOINT, next.AUTH_BASIC,
+                                      next.RECONNECT_DELAY_MAX,
+                                      ntrip_config_session_flags(&next, false))) {
+            ERR("[CONFIG] Keeping the running settings\n");
+            return 0;
+        }
+        INFO("[OBS] Switching to %s:%d /%s\n",
+             next.NTRIP_CASTER, next.NTRIP_PORT, next.MOUNTPOINT);
+    }
+    /* The EPH worker runs while EPH_* names a stream other than the obs
+     * one; a new obs stream has to show its ephemerides anew. */
+    if (d & CONFIG_DIFF_OBS) memset(&sky_eph_cov, 0, sizeof(sky_eph_cov));
+    bool have_eph = next.EPH_CASTER[0] && next.EPH_PORT > 0 && next.EPH_MOUNTPOINT[0];
+    bool eph_conn = have_eph && !config_eph_is_obs_stream(&next);
+    if (eph_shm_name && !eph_shm_feeding()) {
+        /* Another process feeds the shared segment; only remember
+         * whether this one could take over. */
+        if (d & CONFIG_DIFF_EPH) sky_eph_standby = have_eph;
+    } else if ((d & CONFIG_DIFF_EPH) ||
+               ((d & CONFIG_DIFF_OBS) && eph_conn && !sky_eph.running)) {
+        if (!sky_eph_stop())
+            ERR("[CONFIG] EPH worker did not stop; restart to apply its settings\n");
+        else if (eph_conn && sky_eph_start(&next, verbose))
+            INFO("[EPH] Restarted on %s:%d /%s; cached ephemerides kept\n",
+                 next.EPH_CASTER, next.EPH_PORT, next.EPH_MOUNTPOINT);
+        else if (have_eph && !eph_conn)
+            INFO("[EPH] EPH_* names the obs stream; decoding its ephemerides from it\n");
+        else if (!have_eph)
+            INFO("[EPH] Stream removed from the config; cached ephemerides kept\n");
+    }
+    *config = next;
+
+    INFO("[CONFIG] Applied:%s%s%s%s\n",
+         d & CONFIG_DIFF_OBS      ? " obs stream"   : "",
+         d & CONFIG_DIFF_EPH      ? " eph stream"   : "",
+         d & CONFIG_DIFF_POSITION ? " position"     : "",
+         d & CONFIG_DIFF_OTHER    ? " other"        : "");
+    if (json_output) {
+        event_begin(g_events, "reload");
+        event_int(g_events, "t", time(NULL));
+        event_arr(g_events, "changed");
+        if (d & CONFIG_DIFF_OBS)      event_str(g_events, NULL, "obs");
+        if (d & CONFIG_DIFF_EPH)      event_str(g_events, NULL, "eph");
+        if (d & CONFIG_DIFF_POSITION) event_str(g_events, NULL, "position");
+        if (d & CONFIG_DIFF_OTHER)    event_str(g_events, NULL, "other");
+        event_close(g_events);
+        event_end(g_events);
+    }
+    return d;
+}
+
+/* Returns 0 on clean stop, non-zero on connection failure.  Sets *reason
+ * to indicate why the loop exited (used by JSON summary). */
+static int run_sky_obs_stream(NTRIP_Config *config,
+                              SkyRenderSector *sectors,
+                              int duration_s,
+                              bool verbose,
+                              StopReason *reason)
+{
+    /* Short recv timeout so the SIGINT flag is polled. */
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            config->MOUNTPOINT, config->AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 500, "[OBS]",
+                            ntrip_config_session_flags(config, false)))
+        return 1;
+
+    /* Optional GGA push (some casters require it before sending data). */
+    char gga[100];
+    create_gngga_sentence(config->LATITUDE, config->LONGITUDE, gga);
+    char gga_with_crlf[104];
+    snprintf(gga_with_crlf, sizeof(gga_with_crlf), "%s\r\n", gga);
+    time_t last_gga_time = time(NULL);
+    time_t last_feed_check = time(NULL);
+
+    INFO("[OBS] Connected to %s:%d /%s\n",
+         config->NTRIP_CASTER, config->NTRIP_PORT, config->MOUNTPOINT);
+    if (duration_s > 0)
+        INFO("Collecting heatmap data for %d s (Ctrl-C to save early, Ctrl-A to abort without saving)\n",
+             duration_s);
+    else
+        INFO("Collecting heatmap data: Ctrl-C to save PNG and exit, Ctrl-A to abort without saving\n");
+    if (json_output) {
+        event_begin(g_events, "start");
+        event_str(g_events, "source", "ntrip");
+        event_str(g_events, "caster", config->NTRIP_CASTER);
+        event_int(g_events, "port", config->NTRIP_PORT);
+        event_str(g_events, "mountpoint", config->MOUNTPOINT);
+        event_int(g_events, "t", time(NULL));
+        event_int(g_events, "duration_s", duration_s);
+        event_end(g_events);
+    }
+    fflush(stdout);
+
+    /* TTY detection on stderr (status line writes there now so stdout
+     * stays reserved for data).  When stderr is a pipe / file, the
+     * carriage-return spinner becomes garbage -- switch to one-line-
+     * per-tick.  --quiet and --no-progress suppress the line entirely. */
+#ifdef _WIN32
+    bool stderr_is_tty = _isatty(_fileno(stderr)) != 0;
+#else
+    bool stderr_is_tty = isatty(fileno(stderr)) != 0;
+#endif
+    bool show_progress = !quiet && !no_progress;
+
+    /* Mute the per-frame decode chatter (RTCM 1005/1006 reference-station
+     * blocks) unless -v is on.  The user's own [OBS] / spinner output
+     * uses printf directly, so it stays visible either way. */
+    RtcmStrBuf sink;
+    int        sink_used = 0;
+    if (!verbose) {
+        rtcm_strbuf_init(&sink, 8192);
+        rtcm_set_output_buffer(&sink);
+        sink_used = 1;
+    }
+
+    SkyFrameCtx ctx = { .config = config, .dec = rtcm_decoder_default(),
+                        .sectors = sectors, .sink = sink_used ? &sink : NULL };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, sky_obs_frame, &ctx);
+
+    long  bytes_total    = 0;       /* lifetime payload bytes (after HTTP header) */
+    long  bytes_at_tick  = 0;       /* snapshot at the start of the current second */
+    time_t t_start       = time(NULL);
+    time_t last_tick     = t_start;
+    time_t last_data     = t_start;
+    const char spin[] = "|/-\\";
+    int spin_i = 0;
+    SkyStopCheck stop_check = { t_start, duration_s };
+
+    /* Switch the controlling terminal into a non-canonical mode so we can
+     * poll for Ctrl-A without waiting for the user to press Enter.  Always
+     * call terminal_restore() before returning so the user's shell isn't
+     * left with echo off. */
+    terminal_setup();
+
+    while (!g_stop_requested && !g_abort_requested) {
+        /* Receive straight into the framer ring; the session's reply
+         * decoder strips the HTTP header and any chunk framing there. */
+        size_t avail;
+        unsigned char *dst = rtcm_framer_write_ptr(&framer, &avail);
+        int received = ntrip_session_recv(&session, dst, (int)avail);
+
+        /* A lost connection is re-opened; the sectors, the epoch
+         * assembler and the ephemeris store carry on untouched. */
+        const char *lost = NULL;
+        StopReason  lost_reason = STOP_REASON_EOF;
+        if (received == 0) {
+            lost = "caster closed the connection";
+        } else if (received < 0) {
+#ifdef _WIN32
+            bool tick = WSAGetLastError() == WSAETIMEDOUT;
+#else
+            bool tick = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+            if (!tick)
+                lost = "receive error";
+            else if (difftime(time(NULL), last_data) >= NTRIP_SESSION_IDLE_S)
+                lost = "stream went silent";
+            lost_reason = STOP_REASON_ERROR;
+            received = 0;
+        } else {
+            last_data = time(NULL);
+            perf_recv(&sky_perf);
+        }
+
+        /* Live reload: position and eph changes apply at once, a new obs
+         * target is re-opened like a lost connection.  The sectors and
+         * the ephemeris store are not touched. */
+        if (!lost && config_watch_due()) {
+            unsigned changed = sky_reload(config, &session, verbose);
+            if (changed & CONFIG_DIFF_POSITION) {
+                create_gngga_sentence(config->LATITUDE, config->LONGITUDE, gga);
+                snprintf(gga_with_crlf, sizeof(gga_with_crlf), "%s\r\n", gga);
+                last_gga_time = 0;
+            }
+            if (changed & CONFIG_DIFF_OBS) lost = "configuration reloaded";
+        }
+        if (lost) {
+            if (show_progress && stderr_is_tty && !json_output) INFO("\n");
+            if (!ntrip_session_resume(&session, lost, sky_should_stop, &stop_check)) {
+                if (*reason == STOP_REASON_NONE)
+                    *reason = g_abort_requested ? STOP_REASON_ABORT
+                            : g_stop_requested  ? STOP_REASON_SIGINT
+                            : (duration_s > 0 &&
+                               difftime(time(NULL), t_start) >= (double)duration_s)
+                                                ? STOP_REASON_DURATION
+                                                : lost_reason;
+                if (*reason == STOP_REASON_DURATION)
+                    INFO("[OBS] Reached --duration %d s\n", duration_s);
+                break;
+            }
+            if (json_output) {
+                const NtripSessionGap *g = &session.gaps[(session.gap_count - 1) %
+                                                         NTRIP_SESSION_MAX_GAPS];
+                event_begin(g_events, "gap");
+                event_int(g_events, "lost", g->lost);
+                event_int(g_events, "resumed", g->resumed);
+                event_fixed(g_events, "seconds", g->seconds, 1);
+                event_int(g_events, "reconnects", session.reconnects);
+                event_end(g_events);
+            }
+            rtcm_framer_reset(&framer);
+            last_data = time(NULL);
+            last_gga_time = 0;
+            continue;
         }
 
         /* Poll for Ctrl-A on every iteration -- raw mode means the
@@ -688,10 +1713,15 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
 
         /* Keep-alive GGA every 5 s. */
         if (now - last_gga_time >= 5) {
-            send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
+            ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf));
             last_gga_time = now;
         }
 
+        if (sky_eph_standby && now - last_feed_check >= SKY_EPH_FEED_CHECK_S) {
+            sky_eph_check_feed(config, verbose);
+            last_feed_check = now;
+        }
+
         if (received > 0) bytes_total += received;
 
         /* Heartbeat: spinner + counters + bps.  When stdout is a TTY use
@@ -706,20 +1736,23 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
              * (gui_events.c "Streaming  X.X kB/s") so the two UIs agree. */
             double kBps = (double)bytes_in_window / 1024.0;
             if (json_output) {
-                fprintf(stderr,
-                    "{\"event\":\"tick\",\"t\":%ld,\"frames\":%ld,\"msm\":%ld,"
-                    "\"upd\":%ld,\"kBps\":%.2f,\"total_kb\":%ld}\n",
-                    (long)now, frame_total, msm_total, obs_total,
-                    kBps, bytes_total / 1024);
+                event_begin(g_events, "tick");
+                event_int(g_events, "t", now);
+                event_int(g_events, "frames", ctx.frame_total);
+                event_int(g_events, "msm", ctx.msm_total);
+                event_int(g_events, "upd", ctx.obs_total);
+                event_fixed(g_events, "kBps", kBps, 2);
+                event_int(g_events, "total_kb", bytes_total / 1024);
+                event_end(g_events);
             } else if (stderr_is_tty) {
                 fprintf(stderr,
                     "\r [%c] frames=%ld  MSM=%ld  obs+exp updates=%ld  rate=%5.1f kB/s  total=%ld KB    ",
-                    spin[spin_i & 3], frame_total, msm_total, obs_total,
+                    spin[spin_i & 3], ctx.frame_total, ctx.msm_total, ctx.obs_total,
                     kBps, bytes_total / 1024);
             } else {
                 fprintf(stderr,
                     "[%c] frames=%ld  MSM=%ld  obs+exp updates=%ld  rate=%5.1f kB/s  total=%ld KB\n",
-                    spin[spin_i & 3], frame_total, msm_total, obs_total,
+                    spin[spin_i & 3], ctx.frame_total, ctx.msm_total, ctx.obs_total,
                     kBps, bytes_total / 1024);
             }
             fflush(stderr);
@@ -729,92 +1762,8 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
 
         if (received == 0) continue;
 
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            char *ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
-        }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received &&
-                       (unsigned char)buffer[buf_pos] != 0xD3) buf_pos++;
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE)
-                to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int frame_len  = 3 + msg_length + 3;
-                if (msg_buffer_len < frame_len) break;
-                if (msg_length < 2) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int mt = ((int)msg_buffer[3] << 4) | ((int)msg_buffer[4] >> 4);
-
-                frame_total++;
-
-                /* Reset the discard sink between frames so it can't grow
-                 * unbounded if we're running for hours. */
-                if (sink_used) rtcm_strbuf_clear(&sink);
-
-                /* Decode 1005/1006 so the station ARP gets cached for
-                 * azel_from_ecef.  Don't decode MSM frames -- we only need
-                 * the sat-mask + sectorisation, which sky_collect handles. */
-                if (mt == 1005) {
-                    decode_rtcm_1005(&msg_buffer[3], msg_length, config);
-                } else if (mt == 1006) {
-                    decode_rtcm_1006(&msg_buffer[3], msg_length, config);
-                }
-
-                int subtype = mt % 10;
-                if (mt >= 1070 && mt <= 1139 && subtype >= 4 && subtype <= 7) {
-                    msm_total++;
-
-                    /* Get current ARP -- prefer cached 1005/1006, fall back
-                     * to the configured rover lat/lon at altitude 0. */
-                    bool   arp_valid = false;
-                    double sx = 0, sy = 0, sz = 0;
-                    rtcm_get_station_arp(&arp_valid, &sx, &sy, &sz,
-                                         NULL, NULL, NULL);
-                    if (!arp_valid &&
-                        (config->LATITUDE != 0.0 || config->LONGITUDE != 0.0)) {
-                        geodetic_to_ecef(config->LATITUDE, config->LONGITUDE,
-                                         0.0, &sx, &sy, &sz);
-                        arp_valid = true;
-                    }
-
-                    if (arp_valid) {
-                        int contrib = sky_collect_feed_msm(
-                            sectors, &msg_buffer[3], msg_length, mt,
-                            sx, sy, sz);
-                        obs_total += contrib;
-                    }
-                }
-
-                memmove(msg_buffer, msg_buffer + frame_len,
-                        msg_buffer_len - frame_len);
-                msg_buffer_len -= frame_len;
-            }
-        }
+        rtcm_framer_commit(&framer, ntrip_http_decode(&session.http, dst, (size_t)received));
+        stream_format_log(rtcm_framer_new_format(&framer), NULL);
     }
 
     /* If the loop ended via the while-condition (not an explicit break)
@@ -825,11 +1774,20 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
         else if (g_stop_requested)   *reason = STOP_REASON_SIGINT;
     }
 
+    /* Score the last epoch of every GNSS still held by the assembler. */
+    ctx.obs_total += sky_collect_flush(sectors);
+
     /* Final newline so subsequent output starts on a clean row.
      * Only needed when the TTY spinner left the cursor mid-line. */
     if (show_progress && stderr_is_tty && !json_output) INFO("\n");
     INFO("[OBS] Stream stopped (frames=%ld  MSM=%ld  sector updates=%ld  total=%ld KB)\n",
-         frame_total, msm_total, obs_total, bytes_total / 1024);
+         ctx.frame_total, ctx.msm_total, ctx.obs_total, bytes_total / 1024);
+    INFO("[OBS] Framer: CRC errors=%lu  skipped=%lu bytes  resyncs=%lu\n",
+         framer.crc_errors, framer.skipped_bytes, framer.resyncs);
+    if (framer.format != STREAM_FMT_RTCM3 && framer.format != STREAM_FMT_NONE)
+        INFO("[OBS] Stream format: %s (%lu frames)\n", stream_format_name(framer.format),
+             framer.frames);
+    if (!quiet) ntrip_session_print_gaps(&session, stderr);
     if (g_abort_requested)
         INFO("[OBS] Aborted by Ctrl-A; PNG will NOT be written.\n");
     fflush(stdout);
@@ -840,17 +1798,317 @@ static int run_sky_obs_stream(const NTRIP_Config *config,
         rtcm_set_output_buffer(NULL);
         rtcm_strbuf_free(&sink);
     }
-    SK_CLOSE(sock);
+    ntrip_session_close(&session);
     return 0;
+}
+
+/* ── --sky --mounts-file: one heatmap per station ──────────────────── */
+/* Every stream of the multi-mountpoint monitor is one station of a
+ * SkyMulti; the satellite positions of an epoch are shared among them
+ * (sky_multi.h).  Runs on the monitor's event-loop thread. */
+typedef struct {
+    SkyMulti     *sky;
+    NTRIP_Config *cfgs;         /* one per mounts-file entry */
+    int           n;
+} SkyNetwork;
+
+static void sky_network_frame(int stream, const unsigned char *frame,
+                              int frame_len, void *user)
+{
+    SkyNetwork *net = (SkyNetwork *)user;
+    if (stream < 0 || stream >= net->n || frame_len < 6 + 2) return;
+    eph_cache_tick(false);
+
+    const unsigned char *payload = frame + 3;
+    int payload_len = frame_len - 6;
+    int msg_type = (payload[0] << 4) | (payload[1] >> 4);
+    if (msg_type == 1005 || msg_type == 1006) {
+        RtcmStationArp arp;
+        if (rtcm_decode_arp(payload, payload_len, &arp))
+            sky_multi_set_arp(net->sky, stream, arp.x, arp.y, arp.z);
+        return;
+    }
+    if (rtcm_msg_is_eph(msg_type) || rtcm_msg_is_msm(msg_type, 4, 7))
+        sky_obs_eph(msg_type, payload, payload_len);
+    sky_multi_feed_msm(net->sky, stream, payload, payload_len, msg_type);
+}
+
+/* Stage 3 of run_sky_mode() for a network: monitor every mountpoint of
+ * @p mounts_file until the duration ends or Ctrl-C.  Returns false if the
+ * mounts file could not be used. */
+static bool run_sky_network(const NTRIP_Config *config, const char *mounts_file,
+                            int duration_s, SkyNetwork *net, StopReason *reason)
+{
+    memset(net, 0, sizeof(*net));
+    if (ntrip_multi_load_mounts(config, mounts_file, &net->cfgs, &net->n) != 0)
+        return false;
+    if (net->n == 0) {
+        ERR("[ERROR] %s: no mountpoints listed\n", mounts_file);
+        free(net->cfgs);
+        return false;
+    }
+    net->sky = sky_multi_new(net->n);
+    if (!net->sky) {
+        ERR("[ERROR] Out of memory allocating %d sector grids\n", net->n);
+        free(net->cfgs);
+        return false;
+    }
+    /* Until a 1005/1006 arrives, the entry's LATITUDE/LONGITUDE stand in
+     * for the ARP, as the config position does in single-station mode. */
+    for (int i = 0; i < net->n; i++) {
+        const NTRIP_Config *c = &net->cfgs[i];
+        if (c->LATITUDE == 0.0 && c->LONGITUDE == 0.0) continue;
+        double x, y, z;
+        geodetic_to_ecef(c->LATITUDE, c->LONGITUDE, 0.0, &x, &y, &z);
+        sky_multi_set_arp(net->sky, i, x, y, z);
+    }
+
+    net->sky->gov = ntrip_multi_governor();
+    ntrip_multi_set_frame_hook(sky_network_frame, net);
+    if (g_push) fleet_push_set_sky(g_push, net->sky);
+    ntrip_multi_run(config, mounts_file, duration_s, &g_stop_requested, quiet);
+    if (g_push) fleet_push_set_sky(g_push, NULL);
+    ntrip_multi_set_frame_hook(NULL, NULL);
+    sky_multi_flush(net->sky);
+
+    *reason = g_stop_requested ? STOP_REASON_SIGINT : STOP_REASON_DURATION;
+    INFO("[SKY] %lu epoch position sets propagated, %lu shared between stations\n",
+         net->sky->propagated, net->sky->reused);
+    uint64_t shed = load_gov_shed(net->sky->gov, LOAD_WORK_SKY);
+    if (shed)
+        INFO("[SKY] %llu station epochs skipped while the monitor shed load\n",
+             (unsigned long long)shed);
+    return true;
+}
+
+/* ── --mounts-file --compare: epoch-aligned comparison ──────────────── */
+/* Every stream of the monitor against the first one (stream_compare.h);
+ * runs on the monitor's event-loop thread. */
+static void compare_frame(int stream, const unsigned char *frame, int frame_len, void *user)
+{
+    StreamCompare *cmp = (StreamCompare *)user;
+    int64_t now = stream_clock_utc_ns();
+    stream_compare_frame(cmp, stream, frame, frame_len, now);
+    stream_compare_interval(cmp, now, stdout, g_events);
+}
+
+/* Monitor @p mounts_file with the comparison as frame hook, then print
+ * its report.  Returns as ntrip_multi_run(). */
+static int run_compare(const NTRIP_Config *config, const char *mounts_file, int duration_s,
+                       int report_s, int window_ms)
+{
+    NTRIP_Config *cfgs;
+    int n;
+    if (ntrip_multi_load_mounts(config, mounts_file, &cfgs, &n) != 0) return -1;
+    if (n < 2 || n > CMP_MAX_STREAMS) {
+        ERR("[ERROR] --compare needs 2..%d mountpoints in %s (%d listed)\n",
+            CMP_MAX_STREAMS, mounts_file, n);
+        free(cfgs);
+        return -1;
+    }
+    StreamCompare *cmp = stream_compare_new(n, window_ms, report_s);
+    if (!cmp) {
+        ERR("[ERROR] Out of memory allocating the --compare buffer\n");
+        free(cfgs);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) stream_compare_set_name(cmp, i, cfgs[i].MOUNTPOINT);
+    free(cfgs);
+
+    INFO("[CMP] Comparing %d streams against %s: window %d ms, report every %d s\n",
+         n, cmp->st[0].name, window_ms, report_s);
+    ntrip_multi_set_frame_hook(compare_frame, cmp);
+    int rc = ntrip_multi_run(config, mounts_file, duration_s, &g_stop_requested, quiet);
+    ntrip_multi_set_frame_hook(NULL, NULL);
+    if (rc >= 0) {
+        stream_compare_flush(cmp);
+        stream_compare_report(cmp, stdout, g_events);
+    }
+    stream_compare_free(cmp);
+    return rc;
+}
+
+/* Mountpoint @p i of @p cfgs as a file name part; "_<i+1>" is appended
+ * when another entry has the same mountpoint (on another caster). */
+static void sky_station_name(const NTRIP_Config *cfgs, int n, int i, char *name, size_t len)
+{
+    const char *mount = cfgs[i].MOUNTPOINT;
+    size_t k = 0;
+    for (const char *p = mount; *p && k < len - 1; p++)
+        name[k++] = (isalnum((unsigned char)*p) || *p == '-') ? *p : '_';
+    name[k] = '\0';
+    for (int j = 0; j < n; j++) {
+        if (j != i && strcmp(cfgs[j].MOUNTPOINT, mount) == 0) {
+            snprintf(name + k, len - k, "_%d", i + 1);
+            break;
+        }
+    }
+}
+
+/* Stage 5 for a network: <ts>_<MOUNT>_ARP-EPG.png per station with data,
+ * in the -o directory (default: the working directory), at every
+ * --png-sizes size; all stations are rendered in one batch. */
+static int sky_network_save(const SkyNetwork *net, const char *out_dir,
+                            StopReason reason)
+{
+    time_t now_t = time(NULL);
+    struct tm *lt = localtime(&now_t);
+    char ts[16] = "00000000000000";
+    if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
+    char utc_label[40] = "";
+    struct tm *gt = gmtime(&now_t);
+    if (gt) strftime(utc_label, sizeof(utc_label), "%Y-%m-%d %H:%M:%S UTC", gt);
+
+    int n_sizes = n_png_sizes ? n_png_sizes : 1;
+    SkyRenderJob *jobs = (SkyRenderJob *)calloc((size_t)net->n * n_sizes, sizeof(*jobs));
+    char (*names)[512] = (char (*)[512])malloc((size_t)net->n * n_sizes * 512);
+    int *first = (int *)malloc((size_t)net->n * sizeof(int));
+    if (!jobs || !names || !first) {
+        ERR("[ERROR] Out of memory rendering %d heatmaps\n", net->n * n_sizes);
+        free(jobs);
+        free(names);
+        free(first);
+        return EXIT_GENERIC;
+    }
+    int n_jobs = 0;
+    for (int i = 0; i < net->n; i++) {
+        first[i] = -1;
+        const SkyMultiStation *st = &net->sky->st[i];
+        const char *mount = net->cfgs[i].MOUNTPOINT;
+        if (st->updates == 0) {
+            INFO("[SAVE] %s: no sky data, skipped\n", mount);
+            continue;
+        }
+        char name[64];
+        sky_station_name(net->cfgs, net->n, i, name, sizeof(name));
+
+        char filename[512];
+        if (out_dir && out_dir[0]) {
+            size_t len = strlen(out_dir);
+            bool sep = out_dir[len - 1] == '/' || out_dir[len - 1] == '\\';
+            snprintf(filename, sizeof(filename), "%s%s%s_%s_ARP-EPG.png",
+                     out_dir, sep ? "" : "/", ts, name);
+        } else {
+            snprintf(filename, sizeof(filename), "%s_%s_ARP-EPG.png", ts, name);
+        }
+
+        SkyRenderJob proto;
+        memset(&proto, 0, sizeof(proto));
+        proto.sectors     = st->sectors;
+        proto.have_arp    = st->frame.valid;
+        proto.arp_lat_deg = st->frame.lat_deg;
+        proto.arp_lon_deg = st->frame.lon_deg;
+        proto.arp_alt_m   = st->frame.alt_m;
+        proto.mountpoint  = mount;
+        proto.utc_label   = utc_label;
+        first[i] = n_jobs;
+        n_jobs += sky_png_jobs(&proto, filename, &jobs[n_jobs], &names[n_jobs]);
+        INFO("[SAVE] Writing %s ...\n", filename);
+    }
+    sky_render_heatmap_batch(jobs, n_jobs, batch_jobs);
+
+    int saved = 0, failed = 0, files = 0;
+    if (json_output) {
+        event_begin(g_events, "stop");
+        event_str(g_events, "reason", stop_reason_name(reason));
+        event_arr(g_events, "saved");
+    }
+    for (int i = 0; i < net->n; i++) {
+        if (first[i] < 0) continue;
+        bool ok = true;
+        for (int k = first[i]; k < first[i] + n_sizes; k++) {
+            if (!jobs[k].ok) {
+                ERR("[ERROR] Failed to write %s\n", jobs[k].filename);
+                ok = false;
+                continue;
+            }
+            if (json_output) event_str(g_events, NULL, jobs[k].filename);
+            printf("%s\n", jobs[k].filename);
+            files++;
+        }
+        if (ok) saved++;
+        else    failed++;
+    }
+    if (json_output) event_end(g_events);
+    fflush(stdout);
+    INFO("[SAVE] %d of %d stations written\n", saved, net->n);
+    free(jobs);
+    free(names);
+    free(first);
+    return failed || saved == 0 ? EXIT_GENERIC : EXIT_OK;
+}
+
+/* ── --eph-feed: fill a shared ephemeris segment ───────────────────── */
+/* Runs the eph worker (after -R, if given) into segment eph_shm_name so
+ * any number of `--sky --eph-shm` processes can read it, until Ctrl-C,
+ * --duration or the eph stream fails for good. */
+static int run_eph_feed(NTRIP_Config *config, const char *rinex_path,
+                        int duration_s, bool verbose)
+{
+    if (!config->EPH_CASTER[0] || config->EPH_PORT <= 0 || !config->EPH_MOUNTPOINT[0]) {
+        ERR("[ERROR] --eph-feed needs EPH_CASTER / EPH_PORT / EPH_MOUNTPOINT in the config file\n");
+        return EXIT_NO_EPH;
+    }
+    char auth[512];
+    snprintf(auth, sizeof(auth), "%s:%s", config->EPH_USERNAME, config->EPH_PASSWORD);
+    base64_encode(auth, config->EPH_AUTH_BASIC);
+
+    EphShmRole role = eph_shm_attach(eph_shm_name, true);
+    if (role == EPH_SHM_ERROR) return EXIT_GENERIC;
+    if (role != EPH_SHM_FEEDER) {
+        ERR("[ERROR] Shared segment '%s' is already fed by pid %lu\n",
+            eph_shm_name, eph_shm_feeder());
+        return EXIT_GENERIC;
+    }
+    atexit(eph_shm_release);
+
+    signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+    signal(SIGTERM, on_sigint);
+#endif
+
+    if (rinex_path) {
+        int total = rinex_nav_load(rinex_path, NULL);
+        if (total < 0) {
+            ERR("[ERROR] Could not read RINEX file: %s\n", rinex_path);
+            return EXIT_GENERIC;
+        }
+        INFO("[RINEX] %d ephemerides from %s\n", total, rinex_path);
+    }
+    eph_cache_begin(false);
+    INFO("[EPH] Feeding shared segment '%s' from %s:%d /%s\n", eph_shm_name,
+         config->EPH_CASTER, config->EPH_PORT, config->EPH_MOUNTPOINT);
+    if (!sky_eph_start(config, verbose)) return EXIT_GENERIC;
+
+    time_t t_start = time(NULL);
+    while (!g_stop_requested && !sky_eph.done &&
+           (duration_s <= 0 || difftime(time(NULL), t_start) < (double)duration_s)) {
+#ifdef _WIN32
+        Sleep(200);
+#else
+        struct timespec ts = { 0, 200000000L };
+        nanosleep(&ts, NULL);
+#endif
+        eph_cache_tick(false);
+    }
+    bool failed = sky_eph.done && !g_stop_requested;
+    sky_eph_stop();
+    eph_cache_tick(true);
 
-#undef SK_CLOSE
-#undef SK_INVALID
+    int held = 0;
+    for (int g = 0; g < SV_EPH_MAX_GNSS; g++)
+        for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS; prn++)
+            if (sv_eph_get(g, prn)) held++;
+    INFO("[EPH] Segment '%s' holds %d ephemerides\n", eph_shm_name, held);
+    eph_shm_release();
+    return failed ? EXIT_GENERIC : EXIT_OK;
 }
 
 /* ── Sky-mode entry point ──────────────────────────────────────────── */
 static int run_sky_mode(NTRIP_Config *config,
                         const char *rinex_path,
                         const char *output_path,
+                        const char *mounts_file,
                         int duration_s,
                         bool verbose)
 {
@@ -859,10 +2117,11 @@ static int run_sky_mode(NTRIP_Config *config,
         config->EPH_CASTER[0] && config->EPH_PORT > 0 && config->EPH_MOUNTPOINT[0];
     bool have_rinex = (rinex_path && rinex_path[0]);
 
-    if (!have_eph_stream && !have_rinex) {
+    if (!have_eph_stream && !have_rinex && !eph_shm_name) {
         ERR("[ERROR] --sky requires an ephemeris source.\n"
             "        Either configure an EPH_CASTER / EPH_PORT / EPH_MOUNTPOINT\n"
-            "        in the config file, or pass a RINEX 3 NAV file with -R/--RINEX.\n");
+            "        in the config file, pass a RINEX 3 NAV file with -R/--RINEX,\n"
+            "        or read the ephemerides another process shares with --eph-shm.\n");
         return EXIT_NO_EPH;
     }
 
@@ -880,6 +2139,31 @@ static int run_sky_mode(NTRIP_Config *config,
     signal(SIGTERM, on_sigint);
 #endif
 
+    /* --eph-shm: the ephemeris store lives in the shared segment.  A
+     * process with a source of its own feeds it if nobody does; the
+     * others only read it. */
+    if (eph_shm_name) {
+        EphShmRole role = eph_shm_attach(eph_shm_name, have_eph_stream || have_rinex);
+        if (role == EPH_SHM_ERROR) return EXIT_GENERIC;
+        atexit(eph_shm_release);
+        if (role == EPH_SHM_READER) {
+            unsigned long feeder = eph_shm_feeder();
+            if (feeder)
+                INFO("[EPH] Reading the ephemerides of shared segment '%s' (fed by pid %lu)\n",
+                     eph_shm_name, feeder);
+            else
+                INFO("[EPH] Shared segment '%s' has no feeder; reading what it holds\n",
+                     eph_shm_name);
+            if (have_rinex)
+                INFO("[RINEX] %s not loaded: the segment already has a feeder\n", rinex_path);
+            sky_eph_standby = have_eph_stream;
+            have_eph_stream = false;
+            have_rinex      = false;
+        } else {
+            INFO("[EPH] Feeding shared segment '%s'\n", eph_shm_name);
+        }
+    }
+
     /* Allocate the sector grid (flat array, indexed band*MAX_AZ_BINS+bin). */
     SkyRenderSector *sectors = (SkyRenderSector *)calloc(
         (size_t)SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS,
@@ -888,6 +2172,10 @@ static int run_sky_mode(NTRIP_Config *config,
         ERR("[ERROR] Out of memory allocating sector grid\n");
         return EXIT_GENERIC;
     }
+    if (!sky_checkpoint_begin(sectors, config)) {
+        free(sectors);
+        return EXIT_GENERIC;
+    }
 
     /* Stage 1: load RINEX (if any).  Always runs first so the eph cache
      * has something useful before the first obs frame arrives.  The eph
@@ -908,63 +2196,84 @@ static int run_sky_mode(NTRIP_Config *config,
              counts[5], counts[7]);
     }
 
-    /* Stage 2: spawn the EPH worker thread (if configured). */
-    EphThreadArgs eph_args;
-    eph_args.config  = config;
-    eph_args.verbose = verbose;
-#ifdef _WIN32
-    HANDLE hEphThread = NULL;
-#else
-    pthread_t eph_thread;
-    int eph_thread_started = 0;
-#endif
-    if (have_eph_stream) {
-#ifdef _WIN32
-        hEphThread = (HANDLE)_beginthreadex(NULL, 0, eph_thread_entry,
-                                            &eph_args, 0, NULL);
-        if (!hEphThread) {
-            ERR("[ERROR] Could not start EPH worker thread\n");
-        }
-#else
-        if (pthread_create(&eph_thread, NULL, eph_thread_entry, &eph_args) == 0)
-            eph_thread_started = 1;
+    /* --eph-cache: what the last run held, so the first epoch has it. */
+    eph_cache_begin(replay_path || rtcm_stdin);
+
+    /* --snapshot-interval: the heatmap is kept current while collecting,
+     * under the name the final one gets (timestamped at the start when
+     * there is no --output). */
+    if (snapshot_interval) {
+        if (output_path && output_path[0])
+            snprintf(sky_snap_path, sizeof(sky_snap_path), "%s", output_path);
         else
-            ERR("[ERROR] pthread_create for EPH worker failed\n");
-#endif
+            sky_default_output(sky_snap_path, sizeof(sky_snap_path));
+        sky_snap = sky_snapshot_open(snapshot_interval, quiet);
+        if (!sky_snap) {
+            free(sectors);
+            return EXIT_GENERIC;
+        }
+        INFO("[SKY] Writing %s every %d s\n", sky_snap_path, snapshot_interval);
     }
 
+    /* Stage 2: spawn the EPH worker thread (if configured) -- unless
+     * EPH_* names the obs stream itself: sky_obs_eph() then decodes its
+     * ephemerides from the obs connection. */
+    if (have_eph_stream && !mounts_file && !replay_path && !rtcm_stdin &&
+        config_eph_is_obs_stream(config))
+        INFO("[EPH] EPH_* names the obs stream; decoding its ephemerides from it\n");
+    else if (have_eph_stream)
+        sky_eph_start(config, verbose);
+
     /* Stage 3: drive the obs source until SIGINT / Ctrl-A / timeout / EOF.
      * Source is either the obs NTRIP stream (default) or stdin if the
-     * user passed --rtcm-stdin (offline replay of a captured .rtcm3). */
+     * user passed --rtcm-stdin or --replay (offline replay of a captured
+     * .rtcm3), or every mountpoint of --mounts-file at once. */
     StopReason stop_reason = STOP_REASON_NONE;
-    if (rtcm_stdin)
+    SkyNetwork network;
+    bool network_ok = false;
+    /* Offline sources run on the capture's own time (stream_clock.h). */
+    if (replay_path || rtcm_stdin) stream_clock_set_virtual(true);
+    if (mounts_file)
+        network_ok = run_sky_network(config, mounts_file, duration_s, &network, &stop_reason);
+    else if (replay_path)
+        run_sky_replay_stream(config, sectors, duration_s, verbose, &stop_reason);
+    else if (rtcm_stdin)
         run_sky_stdin_stream(config, sectors, duration_s, verbose, &stop_reason);
     else
         run_sky_obs_stream(config, sectors, duration_s, verbose, &stop_reason);
 
-    /* Stage 4: wait for the eph thread to finish (it polls the same flag).
-     * Set BOTH flags so an abort also stops the eph stream cleanly -- the
-     * eph worker only checks g_stop_requested.  Ctrl-A pressed in the obs
-     * loop must propagate here too. */
-    g_stop_requested = 1;
-#ifdef _WIN32
-    if (hEphThread) {
-        WaitForSingleObject(hEphThread, 3000);
-        CloseHandle(hEphThread);
+    if (perf_stream_any(&sky_perf)) {
+        if (!quiet) perf_print_table(&sky_perf, "[OBS] Stage latency", stderr);
+        if (json_output) perf_print_event(&sky_perf, g_events);
     }
-#else
-    if (eph_thread_started) {
-        pthread_join(eph_thread, NULL);
+
+    /* Stage 4: stop the eph thread (it polls its own flag) and wait for
+     * it.  g_stop_requested is set as well so an abort (Ctrl-A in the obs
+     * loop) ends everything else that polls it. */
+    g_stop_requested = 1;
+    sky_eph_stop();
+    eph_cache_tick(true);
+    sky_snapshot_close(sky_snap);
+    sky_snap = NULL;
+
+    if (mounts_file) {
+        free(sectors);
+        if (!network_ok) return EXIT_CONFIG_ERROR;
+        int rc = sky_network_save(&network, output_path, stop_reason);
+        sky_multi_free(network.sky);
+        free(network.cfgs);
+        return rc;
     }
-#endif
 
     /* Stage 5: render the snapshot PNG -- unless the user aborted. */
+    if (!g_abort_requested) sky_checkpoint(sectors, true);
     if (g_abort_requested) {
         INFO("[SAVE] Skipped (aborted)\n");
         if (json_output) {
-            fprintf(stderr,
-                "{\"event\":\"stop\",\"reason\":\"%s\",\"saved\":null}\n",
-                stop_reason_name(stop_reason));
+            event_begin(g_events, "stop");
+            event_str(g_events, "reason", stop_reason_name(stop_reason));
+            event_null(g_events, "saved");
+            event_end(g_events);
         }
         free(sectors);
         return EXIT_ABORTED;
@@ -975,42 +2284,23 @@ static int run_sky_mode(NTRIP_Config *config,
     const char *filename;
     if (output_path && output_path[0]) {
         filename = output_path;
+    } else if (snapshot_interval) {
+        filename = sky_snap_path;
     } else {
-        time_t now_t = time(NULL);
-        struct tm *lt = localtime(&now_t);
-        char ts[16] = "00000000000000";
-        if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
-        snprintf(filename_buf, sizeof(filename_buf), "%s_ARP-EPG.png", ts);
+        sky_default_output(filename_buf, sizeof(filename_buf));
         filename = filename_buf;
     }
 
-    /* Pull final ARP for the footer. */
-    bool   arp_valid = false;
-    double lat = 0, lon = 0, alt = 0;
-    rtcm_get_station_arp(&arp_valid, NULL, NULL, NULL, &lat, &lon, &alt);
-    if (!arp_valid) {
-        lat = config->LATITUDE;
-        lon = config->LONGITUDE;
-        alt = 0.0;
-        if (lat != 0.0 || lon != 0.0) arp_valid = true;
-    }
-
-    /* UTC label */
-    char utc_label[40] = "";
-    {
-        time_t now_t = time(NULL);
-        struct tm *gt = gmtime(&now_t);
-        if (gt) strftime(utc_label, sizeof(utc_label),
-                         "%Y-%m-%d %H:%M:%S UTC", gt);
-    }
-
+    /* Final ARP and time for the footer. */
+    SkyRenderJob proto, jobs[SKY_RENDER_MAX_SIZES];
+    char names[SKY_RENDER_MAX_SIZES][512];
+    char utc_label[40];
+    sky_heatmap_proto(&proto, sectors, config, utc_label);
+    int n_jobs = sky_png_jobs(&proto, filename, jobs, names);
     INFO("[SAVE] Writing %s ...\n", filename);
-    bool ok = sky_render_heatmap_png(filename, sectors,
-                                     800, 800,
-                                     arp_valid, lat, lon, alt,
-                                     config->MOUNTPOINT, utc_label);
-    if (!ok) {
-        ERR("[ERROR] Failed to write %s\n", filename);
+    if (sky_render_heatmap_batch(jobs, n_jobs, batch_jobs) < n_jobs) {
+        for (int k = 0; k < n_jobs; k++)
+            if (!jobs[k].ok) ERR("[ERROR] Failed to write %s\n", jobs[k].filename);
         free(sectors);
         return EXIT_GENERIC;
     }
@@ -1018,28 +2308,816 @@ static int run_sky_mode(NTRIP_Config *config,
 
     /* Machine-readable summary line for --json consumers. */
     if (json_output) {
-        fprintf(stderr,
-            "{\"event\":\"stop\",\"reason\":\"%s\",\"saved\":\"%s\"}\n",
-            stop_reason_name(stop_reason), filename);
+        event_begin(g_events, "stop");
+        event_str(g_events, "reason", stop_reason_name(stop_reason));
+        event_str(g_events, "saved", filename);
+        event_end(g_events);
     }
 
     /* Script-friendly: print the saved path on its own line to stdout.
-     * Scripts can capture it with $(./ntripanalyse --sky --duration 60 -q). */
-    printf("%s\n", filename);
+     * Scripts can capture it with $(./ntripanalyse --sky --duration 60 -q).
+     * Further --png-sizes files follow, one per line. */
+    for (int k = 0; k < n_jobs; k++) printf("%s\n", jobs[k].filename);
     fflush(stdout);
 
     free(sectors);
     return EXIT_OK;
 }
 
+/* ── --merge: add up sector grids ─────────────────────────────────── */
+static void sky_format_day(int64_t t, char *buf, size_t len)
+{
+    time_t tt = (time_t)t;
+    struct tm *gt = gmtime(&tt);
+    if (!gt || !strftime(buf, len, "%Y-%m-%d", gt)) snprintf(buf, len, "?");
+}
+
+static int run_sky_merge(const char *const *paths, int n, const char *out, int jobs)
+{
+    SkyRenderSector *sectors = (SkyRenderSector *)calloc(
+        (size_t)SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS, sizeof(SkyRenderSector));
+    if (!sectors) {
+        ERR("[ERROR] Out of memory allocating sector grid\n");
+        return EXIT_GENERIC;
+    }
+    SkyFileMeta meta;
+    double t0 = stream_clock_wall_seconds();
+    if (sky_file_merge(paths, n, jobs, sectors, &meta) < 0) {
+        free(sectors);
+        return EXIT_GENERIC;
+    }
+    double elapsed = stream_clock_wall_seconds() - t0;
+
+    char first[16] = "-", last[16] = "-";
+    if (meta.t_first) sky_format_day(meta.t_first, first, sizeof(first));
+    if (meta.t_last)  sky_format_day(meta.t_last, last, sizeof(last));
+    char gnss[8];
+    int k = 0;
+    static const char letter[8] = { '?', 'G', 'R', 'E', 'J', 'C', 'S', 'I' };
+    for (int g = 1; g < 8; g++)
+        if (meta.gnss_mask & (1u << g)) gnss[k++] = letter[g];
+    gnss[k] = '\0';
+    long long obs = 0, exp = 0;
+    for (int s = 0; s < SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS; s++) {
+        obs += sectors[s].observed;
+        exp += sectors[s].expected;
+    }
+    INFO("[MERGE] %d grid%s (%u run%s) of %s, %s .. %s, GNSS %s, %.1f%% observed, %.3f s\n",
+         n, n == 1 ? "" : "s", meta.runs, meta.runs == 1 ? "" : "s", meta.mountpoint[0] ? meta.mountpoint : "?", first, last,
+         k ? gnss : "-", exp ? 100.0 * (double)obs / (double)exp : 0.0, elapsed);
+
+    char buf[260];
+    if (!out || !out[0]) {
+        time_t now_t = time(NULL);
+        struct tm *lt = localtime(&now_t);
+        char ts[16] = "00000000000000";
+        if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
+        snprintf(buf, sizeof(buf), "%s_merged" SKY_FILE_EXT, ts);
+        out = buf;
+    }
+    /* -o *.png / *.svg renders the merged grid; anything else is the grid
+     * itself, to be merged again or rendered later. */
+    size_t len = strlen(out);
+    bool png = (len >= 4 && (strcmp(out + len - 4, ".png") == 0 ||
+                             strcmp(out + len - 4, ".PNG") == 0)) ||
+               sky_render_is_svg(out);
+    SkyRenderJob png_jobs[SKY_RENDER_MAX_SIZES];
+    char names[SKY_RENDER_MAX_SIZES][512];
+    int  n_out = 1;
+    bool ok;
+    if (png) {
+        double lat = 0, lon = 0, alt = 0;
+        if (meta.arp_valid)
+            ecef_to_geodetic(meta.arp_x, meta.arp_y, meta.arp_z, 0.0, &lat, &lon, &alt);
+        char label[40];
+        if (strcmp(first, last) == 0) snprintf(label, sizeof(label), "%s UTC", first);
+        else                          snprintf(label, sizeof(label), "%s .. %s UTC", first, last);
+        SkyRenderJob proto;
+        memset(&proto, 0, sizeof(proto));
+        proto.sectors     = sectors;
+        proto.have_arp    = meta.arp_valid;
+        proto.arp_lat_deg = lat;
+        proto.arp_lon_deg = lon;
+        proto.arp_alt_m   = alt;
+        proto.mountpoint  = meta.mountpoint;
+        proto.utc_label   = label;
+        n_out = sky_png_jobs(&proto, out, png_jobs, names);
+        INFO("[SAVE] Writing %s ...\n", out);
+        ok = sky_render_heatmap_batch(png_jobs, n_out, jobs) == n_out;
+        for (int k = 0; k < n_out; k++)
+            if (!png_jobs[k].ok) ERR("[ERROR] Failed to write %s\n", png_jobs[k].filename);
+    } else {
+        ok = sky_file_write(out, sectors, &meta);
+        png_jobs[0].filename = out;
+    }
+    free(sectors);
+    if (!ok) return EXIT_GENERIC;
+    for (int k = 0; k < n_out; k++) printf("%s\n", png_jobs[k].filename);
+    fflush(stdout);
+    return EXIT_OK;
+}
+
+/* ── --sky-expected: expected counts without a stream ─────────────── */
+
+/* "now", or "YYYY-MM-DD[THH:MM[:SS]]" UTC ('T' or a space), as Unix
+ * seconds; -1 if it is neither. */
+static int64_t parse_utc_time(const char *s)
+{
+    if (strcmp(s, "now") == 0) return (int64_t)time(NULL);
+    int y, mo, d, h = 0, mi = 0, sec = 0;
+    char sep = 'T';
+    int n = sscanf(s, "%4d-%2d-%2d%c%2d:%2d:%2d", &y, &mo, &d, &sep, &h, &mi, &sec);
+    if (n != 3 && n < 6) return -1;
+    if ((sep != 'T' && sep != ' ') || y < 1980 || mo < 1 || mo > 12 || d < 1 || d > 31 ||
+        h < 0 || h > 23 || mi < 0 || mi > 59 || sec < 0 || sec > 59)
+        return -1;
+    struct tm tm_u;
+    memset(&tm_u, 0, sizeof(tm_u));
+    tm_u.tm_year = y - 1900;
+    tm_u.tm_mon  = mo - 1;
+    tm_u.tm_mday = d;
+    tm_u.tm_hour = h;
+    tm_u.tm_min  = mi;
+    tm_u.tm_sec  = sec;
+#if defined(_WIN32)
+    time_t t = _mkgmtime(&tm_u);
+#else
+    time_t t = timegm(&tm_u);
+#endif
+    return t == (time_t)-1 ? -1 : (int64_t)t;
+}
+
+/* The stations of --sky-expected: the --mounts-file entries (NULL: the
+ * configuration alone), with their LATITUDE / LONGITUDE at altitude 0.
+ * Every station gets a <MOUNT>_expected.sky in the -o directory; a single
+ * one gets -o itself, or <ts>_<MOUNT>_expected.sky. */
+static int run_sky_expected(const NTRIP_Config *config, const char *rinex_path,
+                            const char *mounts_file, const char *out,
+                            const SkyExpectSpan *span)
+{
+    bool have_rinex = rinex_path && rinex_path[0];
+    if (!have_rinex && !eph_cache_path) {
+        ERR("[ERROR] --sky-expected needs the ephemerides of the span:\n"
+            "        -R <nav.rnx> and/or --eph-cache <file>\n");
+        return EXIT_NO_EPH;
+    }
+    if (have_rinex) {
+        int counts[RINEX_NAV_MAX_GNSS] = { 0 };
+        INFO("[RINEX] Loading %s ...\n", rinex_path);
+        int total = rinex_nav_load(rinex_path, counts);
+        if (total < 0) {
+            ERR("[ERROR] Could not read RINEX file: %s\n", rinex_path);
+            return EXIT_GENERIC;
+        }
+        INFO("[RINEX] Loaded %d ephemerides "
+             "(G:%d R:%d E:%d J:%d C:%d I:%d)\n",
+             total, counts[1], counts[2], counts[3], counts[4],
+             counts[5], counts[7]);
+    }
+    if (eph_cache_path) {
+        int counts[SV_EPH_MAX_GNSS];
+        int total = eph_cache_load(eph_cache_path, -1, 0.0, 0.0, counts, NULL);
+        if (total < 0) return EXIT_GENERIC;
+        INFO("[EPH] Loaded %d ephemerides from %s (G:%d R:%d E:%d J:%d C:%d I:%d)\n",
+             total, eph_cache_path, counts[1], counts[2], counts[3], counts[4],
+             counts[5], counts[7]);
+    }
+    uint32_t gnss_mask = 0;
+    for (int g = 1; g < SV_EPH_MAX_GNSS && g < 32; g++) {
+        for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
+            const SvEphemeris *v[SV_EPH_HISTORY];
+            if (sv_eph_get_all(g, p, v) > 0) {
+                gnss_mask |= 1u << g;
+                break;
+            }
+        }
+    }
+
+    NTRIP_Config *cfgs = NULL;
+    int n = 0;
+    if (mounts_file) {
+        if (ntrip_multi_load_mounts(config, mounts_file, &cfgs, &n) != 0)
+            return EXIT_CONFIG_ERROR;
+    } else {
+        cfgs = (NTRIP_Config *)malloc(sizeof(*cfgs));
+        if (cfgs) {
+            *cfgs = *config;
+            n = 1;
+        }
+    }
+    if (mounts_file && n == 0) {
+        ERR("[ERROR] %s: no mountpoints listed\n", mounts_file);
+        free(cfgs);
+        return EXIT_CONFIG_ERROR;
+    }
+    SkyMulti *m = sky_multi_new(n);
+    if (!m) {
+        ERR("[ERROR] Out of memory allocating sector grids\n");
+        free(cfgs);
+        return EXIT_GENERIC;
+    }
+    int n_pos = 0;
+    for (int i = 0; i < n; i++) {
+        const NTRIP_Config *c = &cfgs[i];
+        if (c->LATITUDE == 0.0 && c->LONGITUDE == 0.0) {
+            if (mounts_file) INFO("[SKY] %s: no LATITUDE / LONGITUDE, skipped\n", c->MOUNTPOINT);
+            continue;
+        }
+        double x, y, z;
+        geodetic_to_ecef(c->LATITUDE, c->LONGITUDE, 0.0, &x, &y, &z);
+        sky_multi_set_arp(m, i, x, y, z);
+        n_pos++;
+    }
+    if (!n_pos) {
+        ERR("[ERROR] --sky-expected needs a station position: LATITUDE / LONGITUDE%s\n",
+            mounts_file ? " in the mounts file" : " (or --lat / --lon)");
+        sky_multi_free(m);
+        free(cfgs);
+        return EXIT_CONFIG_ERROR;
+    }
+
+    double t0 = stream_clock_wall_seconds();
+    long long updates = sky_expect_run(m, span);
+    double elapsed = stream_clock_wall_seconds() - t0;
+    if (updates < 0) {
+        sky_multi_free(m);
+        free(cfgs);
+        return EXIT_GENERIC;
+    }
+    long long n_epochs = ((long long)span->span_s * 1000 + span->step_ms - 1) / span->step_ms;
+    INFO("[SKY] %lld epochs at %d station%s: %lld sector updates, %lu position sets, %.3f s\n",
+         n_epochs, n_pos, n_pos == 1 ? "" : "s", updates, m->propagated, elapsed);
+
+    time_t now_t = time(NULL);
+    struct tm *lt = localtime(&now_t);
+    char ts[16] = "00000000000000";
+    if (lt) strftime(ts, sizeof(ts), "%Y%m%d%H%M%S", lt);
+    int rc = EXIT_OK;
+    for (int i = 0; i < n; i++) {
+        const SkyMultiStation *st = &m->st[i];
+        if (!st->frame.valid) continue;
+        SkyFileMeta meta;
+        memset(&meta, 0, sizeof(meta));
+        meta.arp_valid = true;
+        meta.arp_x     = st->frame.x;
+        meta.arp_y     = st->frame.y;
+        meta.arp_z     = st->frame.z;
+        meta.t_first   = span->start_unix;
+        meta.t_last    = span->start_unix + span->span_s;
+        meta.gnss_mask = gnss_mask;
+        meta.runs      = 1;
+        snprintf(meta.mountpoint, sizeof(meta.mountpoint), "%.47s", cfgs[i].MOUNTPOINT);
+
+        char name[64], filename[512];
+        sky_station_name(cfgs, n, i, name, sizeof(name));
+        if (mounts_file) {
+            const char *dir = out && out[0] ? out : ".";
+            size_t len = strlen(dir);
+            bool sep = dir[len - 1] == '/' || dir[len - 1] == '\\';
+            snprintf(filename, sizeof(filename), "%s%s%s_expected" SKY_FILE_EXT,
+                     dir, sep ? "" : "/", name);
+        } else if (out && out[0]) {
+            snprintf(filename, sizeof(filename), "%s", out);
+        } else {
+            snprintf(filename, sizeof(filename), "%s_%s_expected" SKY_FILE_EXT, ts, name);
+        }
+        if (sky_file_write(filename, st->sectors, &meta)) printf("%s\n", filename);
+        else rc = EXIT_GENERIC;
+    }
+    fflush(stdout);
+    sky_multi_free(m);
+    free(cfgs);
+    return rc;
+}
+
+/* ── --record / --rinex-obs / --export / --convert ───────────────── */
+static RtcmRecorder   *g_recorder  = NULL;
+static RinexObsWriter *g_rinex_obs = NULL;
+static ObsColWriter   *g_export    = NULL;
+
+/* Stem of @p path: file name without directory and extension. */
+static void path_stem(const char *path, char *out, size_t out_size)
+{
+    const char *base = strrchr(path, '/');
+#ifdef _WIN32
+    const char *bsep = strrchr(path, '\\');
+    if (bsep && (!base || bsep > base)) base = bsep;
+#endif
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    size_t len = dot ? (size_t)(dot - base) : strlen(base);
+    snprintf(out, out_size, "%.*s", (int)len, base);
+}
+
+static void rinex_obs_report(const char *path, bool ok, const RinexObsStats *st)
+{
+    if (ok)
+        INFO("[INFO] Wrote %lu epochs to %s\n", (unsigned long)st->epochs, path);
+    else
+        ERR("[ERROR] Writing %s failed; the observation file is incomplete\n", path);
+    if (st->epochs == 0 && ok)
+        ERR("[WARN] No MSM observations: %s has a header only\n", path);
+    if (st->dropped && ok)
+        ERR("[WARN] %lu epochs dropped: the RINEX writer fell behind\n",
+            (unsigned long)st->dropped);
+    if (st->late || st->other_station || st->overflow)
+        INFO("[INFO] RINEX OBS skipped %lu late and %lu other-station MSM frames, "
+             "%lu cells over the epoch limit\n", (unsigned long)st->late,
+             (unsigned long)st->other_station, (unsigned long)st->overflow);
+}
+
+static void obs_col_report(const char *path, bool ok, const ObsColStats *st)
+{
+    if (ok)
+        INFO("[INFO] Exported %lu cells and %lu ephemerides (%lu row groups, %lu bytes) to %s\n",
+             (unsigned long)st->cells, (unsigned long)st->ephs,
+             (unsigned long)st->groups, (unsigned long)st->bytes, path);
+    else
+        ERR("[ERROR] Writing %s failed; the export is incomplete\n", path);
+    if (st->cells == 0 && ok)
+        ERR("[WARN] No MSM observations: %s has no cell rows\n", path);
+    if (st->stalls)
+        INFO("[INFO] Export waited %lu times for its encoder\n", (unsigned long)st->stalls);
+}
+
+/* Open the --record capture, the --rinex-obs file and the --export file
+ * and hand them to the stream loops. */
+static bool record_start(const NTRIP_Config *config)
+{
+    /* A capture is dated by its own start when it has one. */
+    const char *marker = config->MOUNTPOINT;
+    char stem[64];
+    int64_t hint = 0;
+    if (replay_path && (rinex_obs_path || export_path)) {
+        RtcmReplay rp;
+        if (rtcm_replay_open(&rp, replay_path))
+            hint = rp.start_unix_ns / 1000000000LL;
+        rtcm_replay_close(&rp);
+        path_stem(replay_path, stem, sizeof(stem));
+        marker = stem;
+    }
+    if (export_path) {
+        g_export = obs_col_writer_open(export_path, marker, hint);
+        if (!g_export) {
+            ERR("[ERROR] Cannot create export file: %s\n", export_path);
+            return false;
+        }
+        ntrip_set_obs_export(g_export);
+        INFO("[INFO] Exporting observations to %s\n", export_path);
+    }
+    if (rinex_obs_path) {
+        g_rinex_obs = rinex_obs_open(rinex_obs_path, marker,
+                                     replay_path || rtcm_stdin, hint);
+        if (!g_rinex_obs) {
+            ERR("[ERROR] Cannot create RINEX observation file: %s\n", rinex_obs_path);
+            return false;
+        }
+        ntrip_set_rinex_obs(g_rinex_obs);
+        INFO("[INFO] Writing RINEX observations to %s\n", rinex_obs_path);
+    }
+    if (!record_path) return true;
+    g_recorder = rtcm_recorder_open(record_path, &record_opt);
+    if (!g_recorder) {
+        ERR("[ERROR] Cannot create capture file: %s\n", record_path);
+        return false;
+    }
+    ntrip_set_recorder(g_recorder);
+    INFO("[INFO] Recording stream to %s\n", record_path);
+    return true;
+}
+
+static void record_stop(void)
+{
+    if (g_export) {
+        ntrip_set_obs_export(NULL);
+        ObsColStats cst;
+        bool ok = obs_col_writer_close(g_export, &cst);
+        g_export = NULL;
+        obs_col_report(export_path, ok, &cst);
+    }
+    if (g_rinex_obs) {
+        ntrip_set_rinex_obs(NULL);
+        RinexObsStats ost;
+        bool ok = rinex_obs_close(g_rinex_obs, &ost);
+        g_rinex_obs = NULL;
+        rinex_obs_report(rinex_obs_path, ok, &ost);
+    }
+    if (!g_recorder) return;
+    ntrip_set_recorder(NULL);
+    RtcmRecorderStats st;
+    bool ok = rtcm_recorder_close(g_recorder, &st);
+    g_recorder = NULL;
+    if (ok)
+        INFO("[INFO] Recorded %lu frames (%lu bytes, %u file%s) to %s\n",
+             (unsigned long)st.frames, (unsigned long)st.bytes,
+             (unsigned)st.files, st.files == 1 ? "" : "s", record_path);
+    else
+        ERR("[ERROR] Writing %s failed; the capture is incomplete\n", record_path);
+    if (st.dropped)
+        ERR("[WARN] %lu frames dropped: the capture writer fell behind\n",
+            (unsigned long)st.dropped);
+}
+
+/* --record-rotate: "<N>k|M|G" (bytes) or "<N>s|m|h" (age). */
+static bool parse_record_rotate(const char *s, RtcmRecorderOptions *opt)
+{
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0.0) return false;
+    double per_byte = 0.0, per_sec = 0.0;
+    if      (!strcmp(end, "k") || !strcmp(end, "K") || !strcmp(end, "KB")) per_byte = 1024.0;
+    else if (!strcmp(end, "M") || !strcmp(end, "MB")) per_byte = 1024.0 * 1024.0;
+    else if (!strcmp(end, "G") || !strcmp(end, "GB")) per_byte = 1024.0 * 1024.0 * 1024.0;
+    else if (!strcmp(end, "s"))                       per_sec  = 1.0;
+    else if (!strcmp(end, "m") || !strcmp(end, "min")) per_sec = 60.0;
+    else if (!strcmp(end, "h"))                       per_sec  = 3600.0;
+    else return false;
+    if (per_byte > 0.0) opt->rotate_bytes = (uint64_t)(v * per_byte);
+    else                opt->rotate_secs  = (uint32_t)(v * per_sec);
+    return opt->rotate_bytes > 0 || opt->rotate_secs > 0;
+}
+
+/* --json-flush: "<ms>" or "<ms>,<N>[k|M]" (bytes). */
+static bool parse_json_flush(const char *s, EventOutOptions *opt)
+{
+    char *end;
+    long ms = strtol(s, &end, 10);
+    if (end == s || ms < 0 || ms > 3600 * 1000L) return false;
+    opt->flush_ms = (int)ms;
+    if (!*end) return true;
+    if (*end != ',') return false;
+    const char *sz = end + 1;
+    double v = strtod(sz, &end);
+    if (end == sz || v <= 0.0) return false;
+    if      (!strcmp(end, "k") || !strcmp(end, "K") || !strcmp(end, "KB")) v *= 1024.0;
+    else if (!strcmp(end, "M") || !strcmp(end, "MB")) v *= 1024.0 * 1024.0;
+    else if (*end) return false;
+    opt->flush_bytes = (size_t)v;
+    return opt->flush_bytes > 0;
+}
+
+/* Flush and close the --json stream on every way out of main(). */
+static void events_close(void)
+{
+    if (g_events && !event_out_close(g_events))
+        ERR("[WARN] --json events could not all be written\n");
+    g_events = NULL;
+}
+
+/* -m / -r: sourcetable lines go to stdout while the table downloads. */
+static void print_mount_line(const char *line, size_t len, void *user)
+{
+    (void)user;
+    fwrite(line, 1, len, stdout);
+}
+
+/* --nearest [K] [--radius KM]: fetch the sourcetable and list the K
+ * mountpoints closest to the configured position, nearest first. */
+static int run_nearest(const NTRIP_Config *cfg, int k, double radius_km)
+{
+    if (cfg->LATITUDE == 0.0 && cfg->LONGITUDE == 0.0) {
+        ERR("[ERROR] --nearest needs a position: LATITUDE/LONGITUDE in the config, or --lat/--lon\n");
+        return EXIT_BAD_ARGS;
+    }
+    INFO("[DEBUG] Requesting mountpoint list (sourcetable)...\n");
+    char *table = receive_mount_table(cfg);
+    if (!table) {
+        ERR("[ERROR] Failed to retrieve mountpoint list.\n");
+        return EXIT_GENERIC;
+    }
+
+    /* STR;Mountpoint;Identifier;Format;Details;Carrier;NavSys;Network;Country;Lat;Lon;...
+     * Cut each STR line into fields in place. */
+    enum { F_MOUNT = 1, F_FORMAT = 3, F_NAVSYS = 6, F_COUNTRY = 8, F_LAT = 9, F_LON = 10, F_NEED = 11 };
+    int cap = 256, n = 0;
+    char  *(*rows)[F_NEED] = malloc((size_t)cap * sizeof(*rows));
+    double *lat = malloc((size_t)cap * sizeof(double));
+    double *lon = malloc((size_t)cap * sizeof(double));
+    for (char *line = table; rows && lat && lon && line && *line; ) {
+        char *next = line + strcspn(line, "\r\n");
+        if (*next) { *next++ = '\0'; next += strspn(next, "\r\n"); }
+        if (strncmp(line, "STR;", 4) == 0) {
+            char *f[F_NEED];
+            int nf = 0;
+            for (char *tok = line; tok && nf < F_NEED; nf++) {
+                f[nf] = tok;
+                tok = strchr(tok, ';');
+                if (tok) *tok++ = '\0';
+            }
+            if (nf == F_NEED) {
+                if (n == cap) {
+                    cap *= 2;
+                    void *r2 = realloc(rows, (size_t)cap * sizeof(*rows));
+                    void *a2 = realloc(lat,  (size_t)cap * sizeof(double));
+                    void *o2 = realloc(lon,  (size_t)cap * sizeof(double));
+                    if (r2) rows = r2;
+                    if (a2) lat = a2;
+                    if (o2) lon = o2;
+                    if (!r2 || !a2 || !o2) break;
+                }
+                memcpy(rows[n], f, sizeof(f));
+                lat[n] = atof(f[F_LAT]);
+                lon[n] = atof(f[F_LON]);
+                n++;
+            }
+        }
+        line = next;
+    }
+
+    GeoIndex *idx = (rows && lat && lon) ? geo_index_build(lat, lon, n) : NULL;
+    GeoIndexHit *hits = malloc((size_t)k * sizeof(*hits));
+    int rc = EXIT_OK;
+    if (!idx || !hits) {
+        ERR("[ERROR] Out of memory indexing %d mountpoints\n", n);
+        rc = EXIT_GENERIC;
+    } else {
+        int found = geo_index_nearest(idx, cfg->LATITUDE, cfg->LONGITUDE,
+                                      k, radius_km, hits);
+        INFO("[INFO] %d of %d mountpoints have a position; %d within reach\n",
+             geo_index_count(idx), n, found);
+        /* The list IS the data -- keep it on stdout. */
+        printf("%-3s %-20s %9s  %-16s %-16s %-7s %9s %10s\n",
+               "#", "Mountpoint", "km", "Format", "Nav System", "Country", "Lat", "Lon");
+        for (int i = 0; i < found; i++) {
+            char **r = rows[hits[i].id];
+            printf("%-3d %-20s %9.1f  %-16.16s %-16.16s %-7.7s %9.4f %10.4f\n",
+                   i + 1, r[F_MOUNT], hits[i].km, r[F_FORMAT], r[F_NAVSYS],
+                   r[F_COUNTRY], lat[hits[i].id], lon[hits[i].id]);
+        }
+    }
+    free(hits);
+    geo_index_free(idx);
+    free(rows);
+    free(lat);
+    free(lon);
+    free(table);
+    return rc;
+}
+
+/* --convert IN [-o OUT]: raw RTCM <-> native capture, or native ->
+ * native to (de)compress.  Without -o the output is IN with its
+ * extension replaced (.nacap or .rtcm3). */
+/* --convert <capture> -o <file>.obs: every frame of the capture through a
+ * RINEX observation writer. */
+static int run_convert_rinex(const char *in, const char *out)
+{
+    RtcmReplay rp;
+    if (!rtcm_replay_open(&rp, in)) {
+        ERR("[ERROR] Cannot open capture file: %s\n", in);
+        rtcm_replay_close(&rp);
+        return EXIT_GENERIC;
+    }
+    char marker[64];
+    path_stem(in, marker, sizeof(marker));
+    RinexObsWriter *w = rinex_obs_open(out, marker, true, rp.start_unix_ns / 1000000000LL);
+    if (!w) {
+        ERR("[ERROR] Cannot create RINEX observation file: %s\n", out);
+        rtcm_replay_close(&rp);
+        return EXIT_GENERIC;
+    }
+    for (size_t i = 0; i < rp.n_frames; i++) {
+        int len;
+        const unsigned char *frame = rtcm_replay_frame(&rp, i, &len);
+        if (frame) rinex_obs_add_frame(w, frame, len);
+    }
+    rtcm_replay_close(&rp);
+    RinexObsStats st;
+    bool ok = rinex_obs_close(w, &st);
+    rinex_obs_report(out, ok, &st);
+    return ok ? EXIT_OK : EXIT_GENERIC;
+}
+
+/* --convert <capture> -o <file>.nacol: the same to a columnar export. */
+static int run_convert_columns(const char *in, const char *out)
+{
+    RtcmReplay rp;
+    if (!rtcm_replay_open(&rp, in)) {
+        ERR("[ERROR] Cannot open capture file: %s\n", in);
+        rtcm_replay_close(&rp);
+        return EXIT_GENERIC;
+    }
+    char source[64];
+    path_stem(in, source, sizeof(source));
+    ObsColWriter *w = obs_col_writer_open(out, source, rp.start_unix_ns / 1000000000LL);
+    if (!w) {
+        ERR("[ERROR] Cannot create export file: %s\n", out);
+        rtcm_replay_close(&rp);
+        return EXIT_GENERIC;
+    }
+    for (size_t i = 0; i < rp.n_frames; i++) {
+        int len;
+        const unsigned char *frame = rtcm_replay_frame(&rp, i, &len);
+        if (frame) obs_col_writer_add_frame(w, frame, len);
+    }
+    rtcm_replay_close(&rp);
+    ObsColStats st;
+    bool ok = obs_col_writer_close(w, &st);
+    obs_col_report(out, ok, &st);
+    return ok ? EXIT_OK : EXIT_GENERIC;
+}
+
+static int run_convert(const char *in, const char *out, bool compress)
+{
+    if (out && (rinex_obs_is_path(out) || obs_col_is_path(out))) {
+        if (compress) {
+            ERR("[ERROR] --compress needs a " RTCM_CAPTURE_EXT " output\n");
+            return EXIT_BAD_ARGS;
+        }
+        return obs_col_is_path(out) ? run_convert_columns(in, out)
+                                    : run_convert_rinex(in, out);
+    }
+    char buf[1024];
+    FileMap fm;
+    bool native = file_map_open(&fm, in) &&
+                  rtcm_capture_is_native(fm.data, fm.size);
+    file_map_close(&fm);
+    if (!out || !out[0]) {
+        if (native && compress) {
+            ERR("[ERROR] --convert --compress of a native capture needs -o <file>.nacap\n");
+            return EXIT_BAD_ARGS;
+        }
+        const char *dot = strrchr(in, '.');
+        const char *sep = strrchr(in, '/');
+#ifdef _WIN32
+        const char *bsep = strrchr(in, '\\');
+        if (bsep && (!sep || bsep > sep)) sep = bsep;
+#endif
+        size_t stem = (dot && (!sep || dot > sep)) ? (size_t)(dot - in) : strlen(in);
+        snprintf(buf, sizeof(buf), "%.*s%s", (int)stem, in,
+                 native ? ".rtcm3" : RTCM_CAPTURE_EXT);
+        out = buf;
+    }
+    if (compress && !rtcm_capture_is_native_path(out)) {
+        ERR("[ERROR] --compress needs a " RTCM_CAPTURE_EXT " output\n");
+        return EXIT_BAD_ARGS;
+    }
+    unsigned long frames = 0;
+    bool to_native = false;
+    if (!rtcm_capture_convert(in, out, compress ? RTCM_CAPTURE_COMPRESS : 0,
+                              &frames, &to_native)) {
+        ERR("[ERROR] Converting %s to %s failed\n", in, out);
+        return EXIT_GENERIC;
+    }
+    INFO("[INFO] Wrote %lu frames to %s (%s%s)\n", frames, out,
+         !to_native ? "raw RTCM" :
+         native     ? "native capture" : "native capture, MSM-time stamps",
+         compress   ? ", compressed" : "");
+    return EXIT_OK;
+}
+
+/* ── --simulate: synthetic stream to a file, stdout or a local caster ── */
+
+static bool sim_file_sink(const unsigned char *data, int len, void *user)
+{
+    return fwrite(data, 1, (size_t)len, (FILE *)user) == (size_t)len;
+}
+
+typedef struct {
+    const RtcmGenConfig *cfg;
+    RtcmGenStats        *stats;
+    int                  rc;
+} SimServe;
+
+typedef struct {
+    NtripRelayEmit emit;
+    void          *emit_user;
+} SimEmit;
+
+static bool sim_relay_sink(const unsigned char *data, int len, void *user)
+{
+    SimEmit *e = (SimEmit *)user;
+    e->emit(data, len, e->emit_user);
+    return true;
+}
+
+/* NtripRelaySource: the generator on the relay's upstream thread */
+static void sim_relay_source(NtripRelayEmit emit, void *emit_user,
+                             const volatile int *stop, void *user)
+{
+    SimServe *sv = (SimServe *)user;
+    SimEmit e = { emit, emit_user };
+    sv->rc = rtcm_gen_run(sv->cfg, sim_relay_sink, &e, stop, sv->stats);
+}
+
+/* "[ADDR]:PORT" rather than a file name: digits after the last ':' and
+ * no path separator in front of it (so "C:\x.rtcm3" stays a file). */
+static bool sim_parse_listen(const char *out, char *addr, size_t addr_len, int *port)
+{
+    const char *colon = strrchr(out, ':');
+    if (!colon || !colon[1] || strcspn(colon + 1, "0123456789") != 0 ||
+        colon[1 + strspn(colon + 1, "0123456789")] != '\0')
+        return false;
+    for (const char *p = out; p < colon; p++)
+        if (*p == '/' || *p == '\\') return false;
+    *port = atoi(colon + 1);
+    snprintf(addr, addr_len, "%.*s", (int)(colon - out), out);
+    return *port >= 1 && *port <= 65535;
+}
+
+static int run_simulate(const NTRIP_Config *config, const char *out, RtcmGenConfig *gen,
+                        const char *rinex_path)
+{
+    gen->lat_deg = config->LATITUDE;
+    gen->lon_deg = config->LONGITUDE;
+    if (rinex_path) {
+        int total = rinex_nav_load(rinex_path, NULL);
+        if (total < 0) {
+            ERR("[ERROR] Could not read RINEX file: %s\n", rinex_path);
+            return EXIT_GENERIC;
+        }
+        INFO("[RINEX] %d ephemerides from %s\n", total, rinex_path);
+    }
+
+    char addr[64];
+    int port = 0;
+    bool serve = sim_parse_listen(out, addr, sizeof(addr), &port);
+    if (gen->speed < 0.0) gen->speed = serve ? 1.0 : 0.0;
+
+    signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+    signal(SIGTERM, on_sigint);
+#endif
+    RtcmGenStats st;
+    memset(&st, 0, sizeof(st));
+    int rc;
+    if (serve) {
+        const char *mount = config->MOUNTPOINT[0] ? config->MOUNTPOINT : "SIM";
+        SimServe sv = { gen, &st, 0 };
+        INFO("[SIM] Serving mountpoint %s on %s:%d\n", mount, addr[0] ? addr : "0.0.0.0", port);
+        rc = ntrip_relay_serve(mount, gen->lat_deg, gen->lon_deg, sim_relay_source, &sv,
+                               addr, port, 0, &g_stop_requested, quiet);
+        if (rc == 0) rc = sv.rc;
+    } else {
+        bool to_stdout = strcmp(out, "-") == 0;
+        FILE *f = to_stdout ? stdout : fopen(out, "wb");
+        if (!f) {
+            ERR("[ERROR] Cannot create %s\n", out);
+            return EXIT_GENERIC;
+        }
+#ifdef _WIN32
+        if (to_stdout) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        rc = rtcm_gen_run(gen, sim_file_sink, f, &g_stop_requested, &st);
+        if (fflush(f) != 0) rc = -1;
+        if (!to_stdout && fclose(f) != 0) rc = -1;
+    }
+    if (rc != 0 && st.epochs == 0) return EXIT_GENERIC;
+
+    INFO("[SIM] %lu epochs (%.0f s of stream in %.1f s, up to %d satellites): "
+         "%lu frames (%lu MSM, %lu ephemeris, %lu ARP), %.1f MB\n",
+         st.epochs, st.stream_s, st.wall_s, st.sats_max, st.frames, st.msm, st.eph, st.arp,
+         st.bytes / 1048576.0);
+    if (st.dropped || st.corrupted || st.cut || st.junk)
+        INFO("[SIM] Injected: %lu dropped, %lu CRC errors, %lu cut, %lu junk\n",
+             st.dropped, st.corrupted, st.cut, st.junk);
+    return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+}
+
+/* "max" or a factor such as 10 or 60x (--replay-speed, --sim-speed) */
+static bool parse_speed(const char *s, double *speed)
+{
+    if (strcmp(s, "max") == 0) {
+        *speed = 0.0;
+        return true;
+    }
+    char *end;
+    double v = strtod(s, &end);
+    if (v <= 0.0 || end == s ||
+        (*end && strcmp(end, "x") && strcmp(end, "X") && strcmp(end, "\xc3\x97")))
+        return false;
+    *speed = v;
+    return true;
+}
+
 int main(int argc, char *argv[]) {
     NTRIP_Config config;
     const char *config_filename = "config.json";
     const char *rinex_path = NULL;
     const char *output_path = NULL;     /* -o / --output for --sky */
+    const char *mounts_file = NULL;     /* --mounts-file for the multi monitor */
+    char relay_addr[64] = "";           /* --relay ADDR: part; "" = all */
+    int relay_port = 0;                 /* --relay PORT */
+    char collect_addr[64] = "";         /* --collect ADDR: part; "" = all */
+    int collect_port = 0;               /* --collect PORT */
     int duration_s = 0;                 /* --duration: auto-stop sky mode */
     bool check_config_only = false;     /* --check-config: dry-run validation */
     ConfigOverrides ov = { 0 };         /* per-field CLI overrides */
+    const char *sim_out = NULL;         /* --simulate OUT */
+    bool sim_opts = false;              /* any --sim-* seen */
+    RtcmGenConfig sim;
+    rtcm_gen_config_init(&sim);
+    sim.speed = -1.0;                   /* unset: real time to a caster, max otherwise */
+    NtripLoadPlan load = { 0 };         /* --load-test N, --load-ramp */
+    const char *load_ramp = NULL;
+    const char *vrs_spec = NULL;        /* --vrs-probe grid:... | track file */
+    int survey_window = SURVEY_DEFAULT_WINDOW;  /* --survey [SECONDS] */
+    int shards = 1;                     /* --shards N: monitor loop threads, 0 = cores */
+    bool pin_cores = false;             /* --pin-cores */
+    int compare_s = 0;                  /* --compare [SECONDS]: report interval, 0 = off */
+    int compare_window = CMP_DEFAULT_WINDOW_MS; /* --compare-window MS */
+    const char *anomaly_dump = NULL;    /* --anomaly-dump FILE */
+    const char *merge_first = NULL;     /* --merge A.sky; the rest are operands */
+    SkyExpectSpan expect = { 0 };       /* --sky-expected START, --epoch-interval */
     int opt;
     int analysis_time = 60; // default to 60 seconds
     Operation operation = OP_NONE;
@@ -1078,6 +3156,64 @@ int main(int argc, char *argv[]) {
         {"check-config",   no_argument,       0, 18 },
         {"json",           no_argument,       0, 19 },
         {"rtcm-stdin",     no_argument,       0, 20 },
+        {"mounts-file",    required_argument, 0, 21 },
+        {"replay",         required_argument, 0, 22 },
+        {"replay-start",   required_argument, 0, 23 },
+        {"replay-seek",    required_argument, 0, 75 },
+        {"compare",        optional_argument, 0, 76 },
+        {"compare-window", required_argument, 0, 77 },
+        {"anomaly-dump",   required_argument, 0, 78 },
+        {"replay-speed",   required_argument, 0, 24 },
+        {"record",         required_argument, 0, 25 },
+        {"convert",        required_argument, 0, 26 },
+        {"record-rotate",  required_argument, 0, 27 },
+        {"compress",       no_argument,       0, 28 },
+        {"replay-dir",     required_argument, 0, 29 },
+        {"jobs",           required_argument, 0, 30 },
+        {"nearest",        optional_argument, 0, 31 },
+        {"radius",         required_argument, 0, 32 },
+        {"table-ttl",      required_argument, 0, 33 },
+        {"crawl",          required_argument, 0, 34 },
+        {"timeout",        required_argument, 0, 35 },
+        {"no-reconnect",   no_argument,       0, 36 },
+        {"relay",          required_argument, 0, 37 },
+        {"perf",           no_argument,       0, 38 },
+        {"metrics-listen", required_argument, 0, 39 },
+        {"simulate",       required_argument, 0, 40 },
+        {"sim-gnss",       required_argument, 0, 41 },
+        {"sim-msm",        required_argument, 0, 42 },
+        {"sim-rate",       required_argument, 0, 43 },
+        {"sim-errors",     required_argument, 0, 44 },
+        {"sim-speed",      required_argument, 0, 45 },
+        {"sim-seed",       required_argument, 0, 46 },
+        {"load-test",      required_argument, 0, 47 },
+        {"load-ramp",      required_argument, 0, 48 },
+        {"vrs-probe",      required_argument, 0, 49 },
+        {"checkpoint",     required_argument, 0, 50 },
+        {"resume",         required_argument, 0, 51 },
+        {"merge",          required_argument, 0, 52 },
+        {"png-sizes",      required_argument, 0, 53 },
+        {"rinex-obs",      required_argument, 0, 54 },
+        {"export",         required_argument, 0, 55 },
+        {"json-fd",        required_argument, 0, 56 },
+        {"json-binary",    no_argument,       0, 57 },
+        {"json-flush",     required_argument, 0, 58 },
+        {"watch-config",   no_argument,       0, 59 },
+        {"eph-shm",        required_argument, 0, 60 },
+        {"eph-feed",       required_argument, 0, 61 },
+        {"push",           required_argument, 0, 62 },
+        {"node",           required_argument, 0, 63 },
+        {"collect",        required_argument, 0, 64 },
+        {"rollups",        no_argument,       0, 65 },
+        {"snapshot-interval", required_argument, 0, 66 },
+        {"eph-cache",      required_argument, 0, 67 },
+        {"sky-expected",   required_argument, 0, 68 },
+        {"epoch-interval", required_argument, 0, 69 },
+        {"expected",       required_argument, 0, 70 },
+        {"live",           optional_argument, 0, 71 },
+        {"survey",         optional_argument, 0, 72 },
+        {"shards",         required_argument, 0, 73 },
+        {"pin-cores",      no_argument,       0, 74 },
         {"generate",    no_argument,       0, 'g'},
         {"info",        no_argument,       0, 'i'},
         {"help",        no_argument,       0, 'h'},
@@ -1120,19 +3256,20 @@ int main(int argc, char *argv[]) {
             case 'd':
                 claim_action(&operation, OP_DECODE_STREAM, "-d / --decode");
                 if (optarg) {
-                    char *token = strtok(optarg, ", ");
-                    while (token && filter_count < MAX_MSG_TYPES) {
-                        filter_list[filter_count++] = atoi(token);
-                        token = strtok(NULL, ", ");
-                    }
+                    filter_spec = optarg;
                 } else if (optind < argc && argv[optind] && argv[optind][0] != '-') {
-                    char *token = strtok(argv[optind], ", ");
-                    while (token && filter_count < MAX_MSG_TYPES) {
-                        filter_list[filter_count++] = atoi(token);
-                        token = strtok(NULL, ", ");
-                    }
+                    filter_spec = argv[optind];
                     optind++;
                 }
+                {
+                    char err[128];
+                    if (!rtcm_filter_compile(&msg_filter, filter_spec, err, sizeof(err))) {
+                        ERR("[ERROR] -d: %s\n"
+                            "        Use types (1077), ranges (1070-1139), msm, msm1..msm7,\n"
+                            "        eph, station, obs or all, optionally with /N (1077/10).\n", err);
+                        return EXIT_BAD_ARGS;
+                    }
+                }
                 break;
             case 's':   /* -s / --sat (original satellite-analysis mode) */
                 claim_action(&operation, OP_ANALYZE_SATS, "-s / --sat");
@@ -1147,52 +3284,349 @@ int main(int argc, char *argv[]) {
                     analysis_time = 60;
                 }
                 break;
-            case 'S':   /* -S / --sky */
-                claim_action(&operation, OP_SKY_HEATMAP, "-S / --sky");
+            case 'S':   /* -S / --sky */
+                if (operation == OP_MULTI_MONITOR)   /* --mounts-file ... --sky */
+                    operation = OP_NONE;
+                claim_action(&operation, OP_SKY_HEATMAP, "-S / --sky");
+                break;
+            case 'R':   /* -R / --RINEX path */
+                rinex_path = optarg;
+                break;
+            case 1: // --latitude
+            case 2: // --lat
+                ov.latitude = optarg;
+                break;
+            case 3: // --longitude
+            case 4: // --lon
+                ov.longitude = optarg;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'q':       /* -q / --quiet */
+                quiet = true;
+                break;
+            case 'o':       /* -o / --output PATH */
+                output_path = optarg;
+                break;
+            case 5:         /* --duration SECONDS */
+                if (optarg) duration_s = atoi(optarg);
+                if (duration_s < 0) duration_s = 0;
+                break;
+            case 6:         /* --no-progress */
+                no_progress = true;
+                break;
+            case 7:         /* --version */
+                printf("ntrip-analyser %s\n", NTRIP_ANALYSER_VERSION);
+                return EXIT_OK;
+            case 8:  ov.caster         = optarg; break;   /* --caster */
+            case 9:  ov.port           = optarg; break;   /* --port */
+            case 10: ov.mountpoint     = optarg; break;   /* --mountpoint */
+            case 11: ov.user           = optarg; break;   /* --user */
+            case 12: ov.password       = optarg; break;   /* --password */
+            case 13: ov.eph_caster     = optarg; break;   /* --eph-caster */
+            case 14: ov.eph_port       = optarg; break;   /* --eph-port */
+            case 15: ov.eph_mountpoint = optarg; break;   /* --eph-mountpoint */
+            case 16: ov.eph_user       = optarg; break;   /* --eph-user */
+            case 17: ov.eph_password   = optarg; break;   /* --eph-password */
+            case 18: check_config_only = true;   break;   /* --check-config */
+            case 19: json_output       = true;   break;   /* --json */
+            case 20: rtcm_stdin        = true;   break;   /* --rtcm-stdin */
+            case 21:        /* --mounts-file FILE */
+                if (operation != OP_RELAY &&    /* --relay ... --mounts-file */
+                    operation != OP_LOAD_TEST &&
+                    operation != OP_SKY_HEATMAP &&
+                    operation != OP_SKY_EXPECTED)
+                    claim_action(&operation, OP_MULTI_MONITOR, "--mounts-file");
+                mounts_file = optarg;
+                break;
+            case 22: replay_path       = optarg; break;   /* --replay FILE */
+            case 23: replay_start      = optarg; break;   /* --replay-start */
+            case 24:        /* --replay-speed max|N[x] */
+                if (!parse_speed(optarg, &replay_speed)) {
+                    ERR("[ERROR] --replay-speed expects 'max' or a factor such as 1, 10 or 60x\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 25: record_path       = optarg; break;   /* --record FILE */
+            case 26:        /* --convert FILE */
+                convert_path = optarg;
+                claim_action(&operation, OP_CONVERT_CAPTURE, "--convert");
+                break;
+            case 27:        /* --record-rotate 100M | 1h */
+                if (!parse_record_rotate(optarg, &record_opt)) {
+                    ERR("[ERROR] --record-rotate expects a size (500k, 100M, 2G) or an age (90s, 15m, 1h)\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 28: record_opt.compress = true; break;   /* --compress */
+            case 29: replay_dir        = optarg; break;   /* --replay-dir DIR */
+            case 30:        /* --jobs N */
+                batch_jobs = atoi(optarg);
+                if (batch_jobs < 1 || batch_jobs > BATCH_REPLAY_MAX_JOBS) {
+                    ERR("[ERROR] --jobs expects 1..%d\n", BATCH_REPLAY_MAX_JOBS);
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 31:        /* --nearest [K] */
+                claim_action(&operation, OP_NEAREST_MOUNTS, "--nearest");
+                if (optarg) {
+                    nearest_k = atoi(optarg);
+                    if (nearest_k < 1 || nearest_k > 100000) {
+                        ERR("[ERROR] --nearest expects a count of 1..100000\n");
+                        return EXIT_BAD_ARGS;
+                    }
+                }
+                break;
+            case 32:        /* --radius KM */
+                nearest_radius_km = atof(optarg);
+                if (nearest_radius_km <= 0.0) {
+                    ERR("[ERROR] --radius expects a distance in km above 0\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 33:        /* --table-ttl SECONDS */
+                if (atoi(optarg) < 0 || optarg[strspn(optarg, "0123456789")]) {
+                    ERR("[ERROR] --table-ttl expects a number of seconds (0 disables the cache)\n");
+                    return EXIT_BAD_ARGS;
+                }
+                ov.table_ttl = optarg;
+                break;
+            case 34:        /* --crawl FILE */
+                claim_action(&operation, OP_CRAWL_SOURCETABLES, "--crawl");
+                crawl_file = optarg;
+                break;
+            case 35:        /* --timeout SECONDS */
+                crawl_timeout_s = atoi(optarg);
+                if (crawl_timeout_s < 1) {
+                    ERR("[ERROR] --timeout expects a number of seconds above 0\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 36:        /* --no-reconnect */
+                ov.no_reconnect = true;
+                break;
+            case 37: {      /* --relay [ADDR:]PORT */
+                if (operation == OP_MULTI_MONITOR)   /* --mounts-file ... --relay */
+                    operation = OP_NONE;
+                claim_action(&operation, OP_RELAY, "--relay");
+                const char *colon = strrchr(optarg, ':');
+                const char *port_str = colon ? colon + 1 : optarg;
+                if (colon) {
+                    snprintf(relay_addr, sizeof(relay_addr), "%.*s",
+                             (int)(colon - optarg), optarg);
+                }
+                relay_port = atoi(port_str);
+                if (relay_port < 1 || relay_port > 65535) {
+                    ERR("[ERROR] --relay expects [ADDR:]PORT, e.g. 2101 or 127.0.0.1:2101\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            }
+            case 38:        /* --perf */
+                perf_enable(true);
+                break;
+            case 39:        /* --metrics-listen [ADDR]:PORT */
+                if (!metrics_configure(optarg)) {
+                    ERR("[ERROR] --metrics-listen expects [ADDR]:PORT, e.g. :9464 or 127.0.0.1:9464\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 40:        /* --simulate OUT|[ADDR]:PORT */
+                sim_out = optarg;
+                claim_action(&operation, OP_SIMULATE, "--simulate");
+                break;
+            case 41:        /* --sim-gnss GPS,GLO,... */
+                sim_opts = true;
+                if (!rtcm_gen_parse_gnss(optarg, &sim.gnss_mask)) {
+                    ERR("[ERROR] --sim-gnss expects a list of GPS, GLO, GAL, BDS, QZSS, NAVIC (or GRECJI)\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 42:        /* --sim-msm 4|5|7 */
+                sim_opts = true;
+                sim.msm_subtype = atoi(optarg);
+                if (sim.msm_subtype != 4 && sim.msm_subtype != 5 && sim.msm_subtype != 7) {
+                    ERR("[ERROR] --sim-msm expects 4, 5 or 7\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 43:        /* --sim-rate HZ */
+                sim_opts = true;
+                sim.rate_hz = atof(optarg);
+                if (sim.rate_hz < 0.1 || sim.rate_hz > 100.0) {
+                    ERR("[ERROR] --sim-rate expects epochs per second, 0.1 .. 100\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 44:        /* --sim-errors crc=P,cut=P,junk=P,drop=P */
+                sim_opts = true;
+                if (!rtcm_gen_parse_errors(optarg, &sim)) {
+                    ERR("[ERROR] --sim-errors expects e.g. crc=0.01,cut=0.005,junk=1%%,drop=0.02\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 45:        /* --sim-speed max|N[x] */
+                sim_opts = true;
+                if (!parse_speed(optarg, &sim.speed)) {
+                    ERR("[ERROR] --sim-speed expects 'max' or a factor such as 1, 10 or 100x\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 46:        /* --sim-seed N */
+                sim_opts = true;
+                sim.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 47:        /* --load-test N */
+                if (operation == OP_MULTI_MONITOR)   /* --mounts-file ... --load-test */
+                    operation = OP_NONE;
+                claim_action(&operation, OP_LOAD_TEST, "--load-test");
+                load.sessions = atoi(optarg);
+                if (load.sessions < 1 || load.sessions > NTRIP_MULTI_MAX_STREAMS) {
+                    ERR("[ERROR] --load-test expects a number of sessions, 1 .. %d\n",
+                        NTRIP_MULTI_MAX_STREAMS);
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 48:        /* --load-ramp instant|linear:S|step:N/S */
+                load_ramp = optarg;
+                if (!ntrip_load_parse_ramp(optarg, &load)) {
+                    ERR("[ERROR] --load-ramp expects instant, linear:SECONDS or step:COUNT/SECONDS\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 49:        /* --vrs-probe grid:S,W,N,E/KM | grid:R/KM | track file */
+                claim_action(&operation, OP_VRS_PROBE, "--vrs-probe");
+                vrs_spec = optarg;
+                break;
+            case 50: checkpoint_path   = optarg; break;   /* --checkpoint FILE.sky */
+            case 51: resume_path       = optarg; break;   /* --resume FILE.sky */
+            case 54: rinex_obs_path    = optarg; break;   /* --rinex-obs FILE.obs */
+            case 55: export_path       = optarg; break;   /* --export FILE.nacol */
+            case 59: watch_config      = true;   break;   /* --watch-config */
+            case 60: eph_shm_name      = optarg; break;   /* --eph-shm NAME */
+            case 67: eph_cache_path    = optarg; break;   /* --eph-cache FILE */
+            case 70: expected_path     = optarg; break;   /* --expected FILE.sky */
+            case 68:        /* --sky-expected START */
+                if (operation == OP_MULTI_MONITOR)   /* --mounts-file ... --sky-expected */
+                    operation = OP_NONE;
+                claim_action(&operation, OP_SKY_EXPECTED, "--sky-expected");
+                expect.start_unix = parse_utc_time(optarg);
+                if (expect.start_unix < 0) {
+                    ERR("[ERROR] --sky-expected expects \"now\" or a UTC time "
+                        "YYYY-MM-DD[THH:MM[:SS]]\n");
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 71:        /* --live[=HZ] */
+                live_hz = optarg ? atof(optarg) : LIVE_DEFAULT_HZ;
+                if (live_hz < 0.1 || live_hz > LIVE_MAX_HZ) {
+                    ERR("[ERROR] --live expects redraws per second, 0.1..%.0f (e.g. --live=4)\n",
+                        LIVE_MAX_HZ);
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 72:        /* --survey [SECONDS] */
+                claim_action(&operation, OP_CASTER_SURVEY, "--survey");
+                if (optarg) {
+                    survey_window = atoi(optarg);
+                    if (survey_window < 1 || survey_window > 3600) {
+                        ERR("[ERROR] --survey expects a sample window of 1..3600 seconds\n");
+                        return EXIT_BAD_ARGS;
+                    }
+                }
+                break;
+            case 73:        /* --shards N | auto */
+                shards = strcmp(optarg, "auto") == 0 ? 0 : atoi(optarg);
+                if (shards < 0 || shards > NTRIP_MULTI_MAX_SHARDS ||
+                    (shards == 0 && strcmp(optarg, "auto") != 0 && strcmp(optarg, "0") != 0)) {
+                    ERR("[ERROR] --shards expects 1..%d or auto\n", NTRIP_MULTI_MAX_SHARDS);
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 74: pin_cores = true; break;            /* --pin-cores */
+            case 75: replay_seek       = optarg; break;   /* --replay-seek */
+            case 76:        /* --compare [SECONDS] */
+                compare_s = optarg ? atoi(optarg) : CMP_DEFAULT_REPORT_S;
+                if (compare_s < 1 || compare_s > 3600) {
+                    ERR("[ERROR] --compare expects a report interval of 1..3600 seconds\n");
+                    return EXIT_BAD_ARGS;
+                }
                 break;
-            case 'R':   /* -R / --RINEX path */
-                rinex_path = optarg;
+            case 77:        /* --compare-window MS */
+                compare_window = atoi(optarg);
+                if (compare_window < 100 || compare_window > 60000) {
+                    ERR("[ERROR] --compare-window expects 100..60000 ms\n");
+                    return EXIT_BAD_ARGS;
+                }
                 break;
-            case 1: // --latitude
-            case 2: // --lat
-                if (optarg) config.LATITUDE = atof(optarg);
+            case 78: anomaly_dump      = optarg; break;   /* --anomaly-dump */
+            case 69: {      /* --epoch-interval SECONDS */
+                double s = atof(optarg);
+                if (s < 0.001 || s > 3600.0) {
+                    ERR("[ERROR] --epoch-interval expects 0.001..3600 seconds\n");
+                    return EXIT_BAD_ARGS;
+                }
+                expect.step_ms = (int)(s * 1000.0 + 0.5);
                 break;
-            case 3: // --longitude
-            case 4: // --lon
-                if (optarg) config.LONGITUDE = atof(optarg);
+            }
+            case 61:        /* --eph-feed NAME */
+                claim_action(&operation, OP_EPH_FEED, "--eph-feed");
+                eph_shm_name = optarg;
                 break;
-            case 'v':
-                verbose = true;
+            case 62: push_target       = optarg; break;   /* --push HOST:PORT */
+            case 63: node_name         = optarg; break;   /* --node NAME */
+            case 65: rollups           = true;   break;   /* --rollups */
+            case 66:        /* --snapshot-interval SECONDS */
+                snapshot_interval = atoi(optarg);
+                if (snapshot_interval < 1 || snapshot_interval > SKY_SNAPSHOT_MAX_INTERVAL_S) {
+                    ERR("[ERROR] --snapshot-interval expects 1..%d seconds\n",
+                        SKY_SNAPSHOT_MAX_INTERVAL_S);
+                    return EXIT_BAD_ARGS;
+                }
                 break;
-            case 'q':       /* -q / --quiet */
-                quiet = true;
+            case 64: {      /* --collect [ADDR:]PORT */
+                claim_action(&operation, OP_FLEET_COLLECT, "--collect");
+                const char *colon = strrchr(optarg, ':');
+                const char *port_str = colon ? colon + 1 : optarg;
+                if (colon) {
+                    snprintf(collect_addr, sizeof(collect_addr), "%.*s",
+                             (int)(colon - optarg), optarg);
+                }
+                collect_port = atoi(port_str);
+                if (collect_port < 1 || collect_port > 65535) {
+                    ERR("[ERROR] --collect expects [ADDR:]PORT, e.g. 7700 or 0.0.0.0:7700\n");
+                    return EXIT_BAD_ARGS;
+                }
                 break;
-            case 'o':       /* -o / --output PATH */
-                output_path = optarg;
+            }
+            case 56:        /* --json-fd N | host:port */
+                json_target = optarg;
+                json_output = true;
                 break;
-            case 5:         /* --duration SECONDS */
-                if (optarg) duration_s = atoi(optarg);
-                if (duration_s < 0) duration_s = 0;
+            case 57:        /* --json-binary */
+                json_opt.format = EVENT_OUT_MSGPACK;
+                json_output = true;
                 break;
-            case 6:         /* --no-progress */
-                no_progress = true;
+            case 58:        /* --json-flush MS[,SIZE] */
+                if (!parse_json_flush(optarg, &json_opt)) {
+                    ERR("[ERROR] --json-flush expects MILLISECONDS[,SIZE], e.g. 500 or 1000,256k\n");
+                    return EXIT_BAD_ARGS;
+                }
+                json_output = true;
+                break;
+            case 53:        /* --png-sizes 800,200 | WxH,... */
+                n_png_sizes = sky_render_parse_sizes(optarg, png_sizes, SKY_RENDER_MAX_SIZES);
+                if (n_png_sizes < 1) {
+                    ERR("[ERROR] --png-sizes expects up to %d sizes N or WxH, %d..%d px, "
+                        "e.g. 800,200\n", SKY_RENDER_MAX_SIZES, 100, SKY_RENDER_MAX_DIM);
+                    return EXIT_BAD_ARGS;
+                }
+                break;
+            case 52:        /* --merge A.sky [B.sky ...] */
+                claim_action(&operation, OP_SKY_MERGE, "--merge");
+                merge_first = optarg;
                 break;
-            case 7:         /* --version */
-                printf("ntrip-analyser %s\n", NTRIP_ANALYSER_VERSION);
-                return EXIT_OK;
-            case 8:  ov.caster         = optarg; break;   /* --caster */
-            case 9:  ov.port           = optarg; break;   /* --port */
-            case 10: ov.mountpoint     = optarg; break;   /* --mountpoint */
-            case 11: ov.user           = optarg; break;   /* --user */
-            case 12: ov.password       = optarg; break;   /* --password */
-            case 13: ov.eph_caster     = optarg; break;   /* --eph-caster */
-            case 14: ov.eph_port       = optarg; break;   /* --eph-port */
-            case 15: ov.eph_mountpoint = optarg; break;   /* --eph-mountpoint */
-            case 16: ov.eph_user       = optarg; break;   /* --eph-user */
-            case 17: ov.eph_password   = optarg; break;   /* --eph-password */
-            case 18: check_config_only = true;   break;   /* --check-config */
-            case 19: json_output       = true;   break;   /* --json */
-            case 20: rtcm_stdin        = true;   break;   /* --rtcm-stdin */
             case 'g':
                 initialize_config("config.json");
                 return EXIT_OK;
@@ -1225,6 +3659,236 @@ int main(int argc, char *argv[]) {
         return EXIT_BAD_ARGS;
     }
 
+    /* --convert is a file-to-file operation: no config, no network. */
+    if (operation == OP_CONVERT_CAPTURE)
+        return run_convert(convert_path, output_path, record_opt.compress);
+
+    /* So is --merge: its first file is the option argument, the others
+     * are the operands getopt moved behind the options. */
+    if (operation == OP_SKY_MERGE) {
+        const char **paths = (const char **)malloc((size_t)(argc - optind + 1) * sizeof(*paths));
+        if (!paths) return EXIT_GENERIC;
+        int n = 0;
+        paths[n++] = merge_first;
+        while (optind < argc) paths[n++] = argv[optind++];
+        int rc = run_sky_merge(paths, n, output_path, batch_jobs);
+        free(paths);
+        return rc;
+    }
+    if ((checkpoint_path || resume_path) &&
+        (operation != OP_SKY_HEATMAP || mounts_file || replay_dir)) {
+        ERR("[ERROR] --checkpoint and --resume need --sky on a single stream\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (snapshot_interval &&
+        (operation != OP_SKY_HEATMAP || mounts_file || replay_dir)) {
+        ERR("[ERROR] --snapshot-interval needs --sky on a single stream\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (eph_cache_path &&
+        ((operation != OP_SKY_HEATMAP && operation != OP_EPH_FEED &&
+          operation != OP_SKY_EXPECTED) || replay_dir)) {
+        ERR("[ERROR] --eph-cache needs --sky, --eph-feed or --sky-expected\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (expect.step_ms && operation != OP_SKY_EXPECTED) {
+        ERR("[ERROR] --epoch-interval needs --sky-expected\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (expected_path &&
+        (operation != OP_SKY_HEATMAP || mounts_file || replay_dir || resume_path)) {
+        ERR("[ERROR] --expected needs --sky on a single stream, without --resume\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (operation == OP_SKY_EXPECTED &&
+        (replay_path || replay_dir || rtcm_stdin || record_path || eph_shm_name)) {
+        ERR("[ERROR] --sky-expected reads no stream; it cannot be combined with --replay,\n"
+            "        --replay-dir, --rtcm-stdin, --record or --eph-shm\n");
+        return EXIT_BAD_ARGS;
+    }
+
+    if (live_hz > 0.0 && operation != OP_ANALYZE_TYPES && operation != OP_ANALYZE_SATS) {
+        ERR("[ERROR] --live needs -t or -s\n");
+        return EXIT_BAD_ARGS;
+    }
+
+    if (record_path &&
+        (operation != OP_ANALYZE_TYPES && operation != OP_DECODE_STREAM &&
+         operation != OP_ANALYZE_SATS && operation != OP_SKY_HEATMAP)) {
+        ERR("[ERROR] --record needs a stream action: -t, -d, -s or --sky\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (!record_path && (record_opt.rotate_bytes || record_opt.rotate_secs)) {
+        ERR("[ERROR] --record-rotate needs --record <file>\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (record_opt.compress && !rtcm_capture_is_native_path(record_path)) {
+        ERR("[ERROR] --compress needs --record <file>" RTCM_CAPTURE_EXT " or --convert\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (rinex_obs_path &&
+        ((operation != OP_ANALYZE_TYPES && operation != OP_DECODE_STREAM &&
+          operation != OP_ANALYZE_SATS && operation != OP_SKY_HEATMAP) ||
+         mounts_file || replay_dir)) {
+        ERR("[ERROR] --rinex-obs needs -t, -d, -s or --sky on a single stream\n"
+            "        (use --convert <capture> -o <file>.obs for capture files)\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (export_path &&
+        ((operation != OP_ANALYZE_TYPES && operation != OP_DECODE_STREAM &&
+          operation != OP_ANALYZE_SATS && operation != OP_SKY_HEATMAP) ||
+         mounts_file || replay_dir)) {
+        ERR("[ERROR] --export needs -t, -d, -s or --sky on a single stream\n"
+            "        (use --convert <capture> -o <file>" OBS_COL_EXT " for capture files)\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (watch_config &&
+        (operation != OP_MULTI_MONITOR &&
+         (operation != OP_SKY_HEATMAP || replay_path || rtcm_stdin || replay_dir))) {
+        ERR("[ERROR] --watch-config needs --mounts-file or --sky on a caster stream\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (eph_shm_name && operation != OP_SKY_HEATMAP && operation != OP_EPH_FEED) {
+        ERR("[ERROR] --eph-shm needs --sky\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (eph_shm_name && !eph_shm_name_ok(eph_shm_name)) {
+        ERR("[ERROR] --eph-shm / --eph-feed expect a name of at most %d letters, digits, "
+            "'.', '_' or '-'\n", EPH_SHM_NAME_MAX);
+        return EXIT_BAD_ARGS;
+    }
+    if (eph_shm_name && replay_dir) {
+        ERR("[ERROR] --eph-shm cannot be combined with --replay-dir\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (export_path && !obs_col_is_path(export_path)) {
+        ERR("[ERROR] --export needs a <file>" OBS_COL_EXT "\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (record_path && (replay_path || rtcm_stdin)) {
+        ERR("[ERROR] --record records a live stream; use --convert for capture files\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (replay_seek &&
+        (operation != OP_SKY_HEATMAP || !replay_path || replay_start || resume_path ||
+         expected_path)) {
+        ERR("[ERROR] --replay-seek needs --sky --replay <file>, without --replay-start,\n"
+            "        --resume or --expected\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (replay_dir && (operation != OP_SKY_HEATMAP || !rinex_path)) {
+        ERR("[ERROR] --replay-dir needs --sky and -R <nav.rnx>\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (operation == OP_SKY_HEATMAP && mounts_file &&
+        (replay_dir || replay_path || rtcm_stdin || record_path)) {
+        ERR("[ERROR] --sky --mounts-file monitors live streams; it cannot be combined with\n"
+            "        --replay, --replay-dir, --rtcm-stdin or --record\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (replay_dir && (replay_path || rtcm_stdin || record_path)) {
+        ERR("[ERROR] --replay-dir cannot be combined with --replay, --rtcm-stdin or --record\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (batch_jobs && !replay_dir && operation != OP_CRAWL_SOURCETABLES &&
+        operation != OP_SKY_HEATMAP && operation != OP_SKY_EXPECTED &&
+        operation != OP_CASTER_SURVEY) {
+        ERR("[ERROR] --jobs needs --replay-dir <dir>, --crawl <file>, --merge <files>, --sky,\n"
+            "        --sky-expected or --survey\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (shards != 1 && operation != OP_MULTI_MONITOR) {
+        ERR("[ERROR] --shards needs --mounts-file (without --sky)\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (shards != 1 && push_target) {
+        ERR("[ERROR] --shards cannot be combined with --push\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (compare_s && (operation != OP_MULTI_MONITOR || shards != 1 || push_target)) {
+        ERR("[ERROR] --compare needs --mounts-file (without --sky), and runs on one loop:\n"
+            "        it cannot be combined with --shards or --push\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (compare_window != CMP_DEFAULT_WINDOW_MS && !compare_s) {
+        ERR("[ERROR] --compare-window needs --compare\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (anomaly_dump && operation != OP_MULTI_MONITOR &&
+        (operation != OP_SKY_HEATMAP || !mounts_file)) {
+        ERR("[ERROR] --anomaly-dump needs --mounts-file\n");
+        return EXIT_BAD_ARGS;
+    }
+    ntrip_multi_set_anomaly_dump(anomaly_dump);
+    if (pin_cores && shards == 1) {
+        ERR("[ERROR] --pin-cores needs --shards N (N > 1) or --shards auto\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (n_png_sizes && (operation != OP_SKY_HEATMAP || replay_dir)) {
+        ERR("[ERROR] --png-sizes needs --sky or --merge\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (metrics_enabled() && operation != OP_MULTI_MONITOR && operation != OP_RELAY) {
+        ERR("[ERROR] --metrics-listen needs --mounts-file or --relay\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (rollups && !metrics_enabled()) {
+        ERR("[ERROR] --rollups needs --metrics-listen\n");
+        return EXIT_BAD_ARGS;
+    }
+    metrics_set_rollups(rollups);
+    if (push_target && operation != OP_MULTI_MONITOR &&
+        (operation != OP_SKY_HEATMAP || !mounts_file)) {
+        ERR("[ERROR] --push needs --mounts-file (with or without --sky)\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (push_target && !fleet_target_ok(push_target)) {
+        ERR("[ERROR] --push expects HOST:PORT, e.g. collector.example.net:7700\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (node_name && (!push_target || !node_name[0] || strlen(node_name) >= FLEET_NODE_MAX)) {
+        ERR("[ERROR] --node needs --push and a name of 1 .. %d characters\n", FLEET_NODE_MAX - 1);
+        return EXIT_BAD_ARGS;
+    }
+    if (load_ramp && operation != OP_LOAD_TEST && operation != OP_VRS_PROBE) {
+        ERR("[ERROR] --load-ramp needs --load-test <sessions> or --vrs-probe <spec>\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (sim_opts && operation != OP_SIMULATE) {
+        ERR("[ERROR] --sim-* options need --simulate <file|-|[ADDR]:PORT>\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (crawl_timeout_s && operation != OP_CRAWL_SOURCETABLES) {
+        ERR("[ERROR] --timeout needs --crawl\n");
+        return EXIT_BAD_ARGS;
+    }
+    if (nearest_radius_km > 0.0 && operation != OP_NEAREST_MOUNTS) {
+        ERR("[ERROR] --radius needs --nearest\n");
+        return EXIT_BAD_ARGS;
+    }
+
+    /* The collector only listens for nodes: no config either. */
+    if (operation == OP_FLEET_COLLECT) {
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) {
+            ERR("[ERROR] WSAStartup failed.\n");
+            return EXIT_GENERIC;
+        }
+#endif
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        int rc = fleet_collect_run(collect_addr, collect_port, output_path, duration_s,
+                                   &g_stop_requested, quiet);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        if (rc < 0) return EXIT_GENERIC;
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
     if (load_config(config_filename, &config) != 0) {
         ERR("[ERROR] Could not open or parse config file: %s\n", config_filename);
         ERR("Aborting.\n");
@@ -1245,6 +3909,16 @@ int main(int argc, char *argv[]) {
     }
 #endif
 
+    if (json_output) {
+        g_events = event_out_open(json_target, &json_opt);
+        if (!g_events) {
+            ERR("[ERROR] Cannot open the --json event stream: %s\n",
+                json_target ? json_target : "stderr");
+            return EXIT_BAD_ARGS;
+        }
+        atexit(events_close);
+    }
+
     char auth[512];
     snprintf(auth, sizeof(auth), "%s:%s", config.USERNAME, config.PASSWORD);
     base64_encode(auth, config.AUTH_BASIC);
@@ -1267,29 +3941,94 @@ int main(int argc, char *argv[]) {
         );
     }
 
+    // === Live reload (SIGHUP, --watch-config) of the streaming modes ===
+    if (operation == OP_MULTI_MONITOR ||
+        (operation == OP_SKY_HEATMAP && !replay_path && !rtcm_stdin && !replay_dir)) {
+        const char *watched[CONFIG_WATCH_MAX_FILES] = { config_filename, mounts_file };
+        reload_config_path = config_filename;
+        reload_mounts_path = mounts_file;
+        reload_ov          = ov;
+        config_watch_init(watched, CONFIG_WATCH_MAX_FILES, watch_config);
+        if (mounts_file) ntrip_multi_set_reload_hook(multi_reload_hook, NULL);
+    }
+
+    // === --record: open the native capture for the stream below ===
+    if (!record_start(&config)) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return EXIT_GENERIC;
+    }
+
     // === 0. Analyze message types if requested ===
     if (operation == OP_ANALYZE_TYPES) {
+        ntrip_set_live_view(live_hz > 0.0 ? live_view_start(live_hz) : NULL);
         analyze_message_types(&config, analysis_time);
+        record_stop();
 #ifdef _WIN32
         WSACleanup();
 #endif
         return 0;
     }
 
+    if (operation == OP_SKY_EXPECTED) {
+        expect.span_s = duration_s > 0 ? duration_s : 86400;
+        if (!expect.step_ms) expect.step_ms = 1000;
+        expect.jobs = batch_jobs;
+        int rc = run_sky_expected(&config, rinex_path, mounts_file, output_path, &expect);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc;
+    }
+
+    if (operation == OP_NEAREST_MOUNTS) {
+        int rc = run_nearest(&config, nearest_k, nearest_radius_km);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc;
+    }
+
+    if (operation == OP_CRAWL_SOURCETABLES) {
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        SourcetableCrawlOptions copt = {
+            crawl_file, output_path, batch_jobs, crawl_timeout_s, quiet
+        };
+        int rc = sourcetable_crawl_run(&config, &copt, &g_stop_requested);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        if (rc < 0) return EXIT_CONFIG_ERROR;
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
     // === 1. Request and display mountpoint list ===
     if (operation == OP_SHOW_MOUNT_FORMATTED || operation == OP_SHOW_MOUNT_RAW) {
         INFO("[DEBUG] Requesting mountpoint list (sourcetable)...\n");
-        char *mount_table = receive_mount_table(&config);
+        /* Sourcetable IS the data -- keep it on stdout, printed as it
+         * arrives. */
+        MountTableInfo table_info;
+        char *mount_table = receive_mount_table_ex(&config, print_mount_line, NULL,
+                                                   &table_info);
         if (mount_table) {
-            /* Sourcetable IS the data -- keep it on stdout. */
-            if (operation == OP_SHOW_MOUNT_RAW) {
-                printf("%s", mount_table);
-            } else {
-                printf("%s\n", mount_table);
+            if (operation == OP_SHOW_MOUNT_FORMATTED) {
+                printf("\n");
+            }
+            if (table_info.source != MOUNT_TABLE_NETWORK) {
+                INFO("[INFO] Sourcetable from cache (%s, %ld s old)\n",
+                     table_info.source == MOUNT_TABLE_CACHED      ? "within TTL" :
+                     table_info.source == MOUNT_TABLE_REVALIDATED ? "not modified"
+                                                                  : "caster unreachable",
+                     table_info.age_s);
             }
             free(mount_table);
         } else {
             ERR("[ERROR] Failed to retrieve mountpoint list.\n");
+            record_stop();
 #ifdef _WIN32
             WSACleanup();
 #endif
@@ -1307,16 +4046,13 @@ int main(int argc, char *argv[]) {
     // === 2. Start NTRIP stream from configured mountpoint ===
     if (operation == OP_DECODE_STREAM) {
         INFO("[DEBUG] Starting NTRIP stream from mountpoint '%s'...\n", config.MOUNTPOINT);
-        if (filter_count > 0) {
-            INFO("[DEBUG] Filter list: ");
-            for (int i = 0; i < filter_count; ++i) {
-                if (!quiet) fprintf(stderr, "%d ", filter_list[i]);
-            }
-            INFO("\n");
+        if (!msg_filter.all) {
+            INFO("[DEBUG] Filter: %s\n", filter_spec);
         } else {
             INFO("[DEBUG] No filter: all message types will be shown.\n");
         }
-        start_ntrip_stream_with_filter(&config, filter_list, filter_count, verbose);
+        start_ntrip_stream_with_filter(&config, &msg_filter, verbose);
+        record_stop();
 #ifdef _WIN32
         WSACleanup();
 #endif
@@ -1324,22 +4060,219 @@ int main(int argc, char *argv[]) {
     }
 
     if (operation == OP_ANALYZE_SATS) {
+        ntrip_set_live_view(live_hz > 0.0 ? live_view_start(live_hz) : NULL);
         analyze_satellites_stream(&config, analysis_time);
+        record_stop();
 #ifdef _WIN32
         WSACleanup();
 #endif
         return 0;
     }
 
+    if (operation == OP_SKY_HEATMAP && replay_dir) {
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        /* -o names the output directory here; the children get only the
+         * config file (and the environment), not other CLI overrides. */
+        BatchReplayOptions bopt = {
+            argv[0], replay_dir, output_path, config_filename, rinex_path,
+            batch_jobs, g_events, quiet
+        };
+        int rc = batch_replay_run(&bopt, &g_stop_requested);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        if (rc < 0) return EXIT_BAD_ARGS;
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
+    if (push_target) {
+        g_push = fleet_push_open(push_target, node_name, quiet);
+        if (!g_push) {
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return EXIT_GENERIC;
+        }
+        ntrip_multi_set_push(g_push);
+    }
+
     if (operation == OP_SKY_HEATMAP) {
-        int rc = run_sky_mode(&config, rinex_path,
-                              output_path, duration_s, verbose);
+        int rc = run_sky_mode(&config, rinex_path, output_path,
+                              mounts_file, duration_s, verbose);
+        fleet_push_close(g_push);
+        record_stop();
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc;
+    }
+
+    if (operation == OP_EPH_FEED) {
+        int rc = run_eph_feed(&config, rinex_path, duration_s, verbose);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc;
+    }
+
+    if (operation == OP_MULTI_MONITOR) {
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        ntrip_multi_set_shards(shards, pin_cores);
+        int rc = compare_s
+            ? run_compare(&config, mounts_file, duration_s, compare_s, compare_window)
+            : ntrip_multi_run(&config, mounts_file, duration_s, &g_stop_requested, quiet);
+        fleet_push_close(g_push);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        if (rc < 0) return EXIT_CONFIG_ERROR;
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
+    if (operation == OP_SIMULATE) {
+        sim.duration_s = duration_s;
+        int rc = run_simulate(&config, sim_out, &sim, rinex_path);
 #ifdef _WIN32
         WSACleanup();
 #endif
         return rc;
     }
 
+    if (operation == OP_LOAD_TEST) {
+        /* Sessions go round-robin over --mounts-file, else all to the
+         * config's MOUNTPOINT. */
+        NTRIP_Config *mounts = &config;
+        int n_mounts = 1;
+        if (mounts_file &&
+            (ntrip_multi_load_mounts(&config, mounts_file, &mounts, &n_mounts) != 0 ||
+             n_mounts == 0)) {
+            if (mounts != &config) free(mounts);
+            if (n_mounts == 0) ERR("[ERROR] %s: no mountpoints listed\n", mounts_file);
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return EXIT_CONFIG_ERROR;
+        }
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        int rc = ntrip_multi_load_test(mounts, n_mounts, &load, duration_s,
+                                       &g_stop_requested, quiet);
+        if (mounts != &config) free(mounts);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        if (rc < 0) return EXIT_GENERIC;
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
+    if (operation == OP_VRS_PROBE) {
+        VrsProbePoint *pts;
+        VrsProbeGrid grid;
+        int n_pts;
+        if (vrs_probe_parse(vrs_spec, config.LATITUDE, config.LONGITUDE,
+                            NTRIP_MULTI_MAX_STREAMS, &pts, &n_pts, &grid) != 0) {
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return EXIT_BAD_ARGS;
+        }
+        /* Unless --load-ramp says otherwise, open ten sessions a second
+         * so a large grid does not arrive at the caster all at once. */
+        load.sessions = n_pts;
+        if (!load_ramp) {
+            load.kind   = NTRIP_RAMP_LINEAR;
+            load.ramp_s = n_pts / 10.0;
+        }
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        double elapsed = 0.0;
+        int rc = ntrip_multi_vrs_probe(&config, pts, n_pts, &load, duration_s,
+                                       &g_stop_requested, quiet, &elapsed);
+        if (rc >= 0) {
+            vrs_probe_report(pts, n_pts, &grid, config.MOUNTPOINT, elapsed, stdout);
+            if (output_path && vrs_probe_write_geojson(pts, n_pts, output_path) != 0)
+                rc = -1;
+            else if (output_path)
+                INFO("[INFO] Coverage map written to %s\n", output_path);
+        }
+        free(pts);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
+    if (operation == OP_CASTER_SURVEY) {
+        INFO("[DEBUG] Requesting mountpoint list (sourcetable)...\n");
+        char *table = receive_mount_table(&config);
+        SurveyMount *mounts = NULL;
+        int n_mounts = 0;
+        int rc = -1;
+        if (!table) {
+            ERR("[ERROR] Failed to retrieve mountpoint list.\n");
+        } else if (caster_survey_parse(table, NTRIP_MULTI_MAX_STREAMS, &mounts, &n_mounts) == 0) {
+            signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+            signal(SIGTERM, on_sigint);
+#endif
+            char caster[300];
+            snprintf(caster, sizeof(caster), "%s:%d", config.NTRIP_CASTER, config.NTRIP_PORT);
+            double elapsed = 0.0;
+            rc = ntrip_multi_survey(&config, mounts, n_mounts,
+                                    batch_jobs ? batch_jobs : SURVEY_DEFAULT_JOBS,
+                                    survey_window, duration_s, &g_stop_requested, quiet, &elapsed);
+            if (rc >= 0) {
+                caster_survey_report(mounts, n_mounts, caster, survey_window, elapsed, stdout);
+                if (output_path &&
+                    caster_survey_write_json(mounts, n_mounts, caster, survey_window, output_path) != 0)
+                    rc = -1;
+                else if (output_path)
+                    INFO("[INFO] Survey written to %s\n", output_path);
+            }
+        }
+        free(mounts);
+        free(table);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
+    if (operation == OP_RELAY) {
+        /* --mounts-file lists the mountpoints to relay; without it the
+         * config's own MOUNTPOINT is relayed. */
+        NTRIP_Config *mounts = &config;
+        int n_mounts = 1;
+        if (mounts_file &&
+            ntrip_multi_load_mounts(&config, mounts_file, &mounts, &n_mounts) != 0) {
+#ifdef _WIN32
+            WSACleanup();
+#endif
+            return EXIT_CONFIG_ERROR;
+        }
+        signal(SIGINT, on_sigint);
+#ifdef SIGTERM
+        signal(SIGTERM, on_sigint);
+#endif
+        int rc = ntrip_relay_run(mounts, n_mounts, relay_addr, relay_port, duration_s,
+                                 &g_stop_requested, quiet);
+        if (mounts != &config) free(mounts);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return rc == 0 ? EXIT_OK : EXIT_GENERIC;
+    }
+
 #ifdef _WIN32
     WSACleanup();
 #endif
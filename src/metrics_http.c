@@ -0,0 +1,975 @@
+/**
+ * @file metrics_http.c
+ * @brief Prometheus / OpenMetrics exporter for the long-running modes.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #ifndef _WIN32_WINNT
+    #define _WIN32_WINNT 0x0601     /* WSAPoll() needs Vista or later */
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+    #define CLOSESOCKET closesocket
+    #define metrics_poll(p, n, t) WSAPoll((p), (ULONG)(n), (t))
+    typedef WSAPOLLFD MetricsPollFd;
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <sys/time.h>
+    #define CLOSESOCKET close
+    #define metrics_poll(p, n, t) poll((p), (nfds_t)(n), (t))
+    typedef struct pollfd MetricsPollFd;
+#endif
+
+#include "metrics_http.h"
+#include "corr_age.h"
+#include "ntrip_connect.h"
+#include "rtcm3x_parser.h"
+#include "rtcm_bitreader.h"
+#include "stream_clock.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define METRICS_REQ_MAX      4096       /* request header limit */
+#define METRICS_IO_TIMEOUT_S 2          /* a scrape that stalls longer is dropped */
+
+static char s_listen_addr[64];
+static int  s_listen_port;
+static bool s_enabled;
+static const LoadGovernor *s_load_gov;
+static bool s_rollups;
+
+/* Series every rollup store starts with, in this order (ids 0 ..). */
+enum { ROLL_BYTES = 0, ROLL_FRAMES, ROLL_CRC, ROLL_RECONNECTS, ROLL_UP,
+       ROLL_AGE_P50, ROLL_AGE_P99, ROLL_FIXED };
+static const char *const k_roll_name[ROLL_FIXED] = {
+    "bytes", "frames", "crc_errors", "reconnects", "up", "age_ms.p50", "age_ms.p99"
+};
+
+static const char k_gnss[8][8] = { "", "GPS", "GLONASS", "Galileo", "QZSS",
+                                   "BeiDou", "SBAS", "NavIC" };
+
+struct MetricsServer {
+    NtripSocket         sock;
+    const MetricsMount *mounts;     /* the writers' structs: only their snapshots are read */
+    MetricsMount       *view;       /* newest consistent copy of each */
+    MetricsMount        scratch;    /* read target, so a raced read keeps the old view */
+    uint32_t           *seen;       /* snapshot version of each view */
+    int                 n;
+    char                mode[16];
+    uint64_t            t_start;
+    volatile int        stop;
+#ifdef _WIN32
+    HANDLE              thread;
+#else
+    pthread_t           thread;
+#endif
+};
+
+/* ── Configuration and writer side ─────────────────────────────────── */
+
+bool metrics_configure(const char *spec)
+{
+    const char *colon = strrchr(spec, ':');
+    const char *port_str = colon ? colon + 1 : spec;
+    char *end;
+    long port = strtol(port_str, &end, 10);
+    if (*port_str == '\0' || *end != '\0' || port < 1 || port > 65535) return false;
+    s_listen_addr[0] = '\0';
+    if (colon) {
+        int len = (int)(colon - spec);
+        if (len >= (int)sizeof(s_listen_addr)) return false;
+        snprintf(s_listen_addr, sizeof(s_listen_addr), "%.*s", len, spec);
+    }
+    s_listen_port = (int)port;
+    s_enabled     = true;
+    return true;
+}
+
+void metrics_set_governor(const LoadGovernor *gov)
+{
+    s_load_gov = gov;
+}
+
+void metrics_set_rollups(bool on)
+{
+    s_rollups = on;
+}
+
+bool metrics_enabled(void)
+{
+    return s_enabled;
+}
+
+MetricsMount *metrics_mounts_new(int n)
+{
+    if (n <= 0) return NULL;
+    MetricsMount *mm = (MetricsMount *)calloc((size_t)n, sizeof(MetricsMount));
+    StatsSnapshot *pub = (StatsSnapshot *)calloc((size_t)n, sizeof(StatsSnapshot));
+    bool ok = mm && pub;
+    for (int i = 0; ok && i < n; i++) {
+        ok = stats_snapshot_init(&pub[i], sizeof(MetricsMount));
+        mm[i].pub = &pub[i];
+        /* Without the engine the mount still works, minus the quality families */
+        if (ok) mm[i].oq = (ObsQuality *)calloc(1, sizeof(ObsQuality));
+        if (ok && s_rollups) {
+            ok = (mm[i].rollup = rollup_store_new()) != NULL;
+            for (int k = 0; ok && k < ROLL_FIXED; k++)
+                ok = rollup_series(mm[i].rollup, k_roll_name[k],
+                                   k < ROLL_UP ? ROLLUP_COUNTER : ROLLUP_GAUGE) == k;
+        }
+    }
+    if (!ok) {
+        if (mm) metrics_mounts_free(mm, n);
+        else    free(pub);
+        return NULL;
+    }
+    return mm;
+}
+
+void metrics_mounts_free(MetricsMount *mounts, int n)
+{
+    if (!mounts) return;
+    StatsSnapshot *pub = mounts[0].pub;
+    for (int i = 0; pub && i < n; i++) stats_snapshot_free(&pub[i]);
+    for (int i = 0; i < n; i++) {
+        rollup_store_free(mounts[i].rollup);
+        if (!mounts[i].oq) continue;
+        obs_quality_free(mounts[i].oq);
+        free(mounts[i].oq);
+    }
+    free(pub);
+    free(mounts);
+}
+
+void metrics_mount_label(MetricsMount *m, const char *mount, const char *host, int port)
+{
+    snprintf(m->mount, sizeof(m->mount), "%s", mount);
+    snprintf(m->caster, sizeof(m->caster), "%.80s:%d", host, port);
+}
+
+void metrics_mount_frame(MetricsMount *m, const unsigned char *frame, int frame_len,
+                         double now)
+{
+    m->frames++;
+    if (frame_len < 8) return;          /* no room for a message number */
+    bw_burst_frame(&m->burst, frame, frame_len, now);
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+
+    MetricsType *t = NULL;
+    int n = m->n_types;
+    for (int i = 0; i < n; i++) {
+        if (m->type[i].msg_type == mt) { t = &m->type[i]; break; }
+    }
+    if (!t) {
+        if (n == METRICS_TYPE_SLOTS) {
+            m->other_frames++;
+            return;
+        }
+        t = &m->type[n];
+        t->msg_type  = mt;
+        t->last_time = now;
+        t->frames    = 1;
+        m->n_types   = n + 1;
+    } else {
+        qsketch_add(&t->dt, now - t->last_time);
+        t->last_time = now;
+        t->frames++;
+    }
+    bw_meter_add(&t->bw, now, frame_len, &m->burst);
+
+    /* MSM header: satellite mask at bit 73 */
+    int g = rtcm_msg_gnss_id(mt);
+    if (rtcm_msg_is_msm(mt, 1, 7) && g > 0 && g < 8 && frame_len - 6 >= 17) {
+        uint64_t mask = rtcm_bits_at(&frame[3], frame_len - 6, 73, 64);
+        uint32_t sats = 0;
+        for (; mask; mask &= mask - 1) sats++;
+        m->sats[g] = sats;
+        if (m->oq) obs_quality_add_frame(m->oq, frame, frame_len);
+    }
+}
+
+void metrics_mount_age(MetricsMount *m, const unsigned char *frame, int frame_len,
+                       int64_t rx_utc_ns)
+{
+    int64_t age_ns;
+    if (m->rollup && corr_age_of_frame(frame, frame_len, rx_utc_ns, &age_ns))
+        qsketch_add(&m->roll.age, (double)age_ns / 1e6);
+}
+
+void metrics_mount_framer(MetricsMount *m, const RtcmFramer *f)
+{
+    m->crc_errors    = (uint64_t)f->crc_errors;
+    m->skipped_bytes = (uint64_t)f->skipped_bytes;
+    m->resyncs       = (uint64_t)f->resyncs;
+    m->queue_bytes   = (uint64_t)(f->wr - f->rd);
+}
+
+/* Add what changed since the last roll to the rollup, at most once per
+ * wall-clock second: counter deltas, gauges as they stand, and the age
+ * quantiles of the frames since. */
+static void metrics_mount_roll(MetricsMount *m)
+{
+    double t = (double)stream_clock_utc_ns() / 1e9;
+    if ((int64_t)t == m->roll.sec) return;
+    m->roll.sec = (int64_t)t;
+    RollupStore *r = m->rollup;
+    MetricsRoll *x = &m->roll;
+
+    rollup_add(r, ROLL_BYTES,      t, (double)(m->bytes - x->bytes));
+    rollup_add(r, ROLL_FRAMES,     t, (double)(m->frames - x->frames));
+    rollup_add(r, ROLL_CRC,        t, (double)(m->crc_errors - x->crc_errors));
+    rollup_add(r, ROLL_RECONNECTS, t, (double)(m->reconnects - x->reconnects));
+    rollup_add(r, ROLL_UP,         t, m->state == METRICS_STREAMING ? 1.0 : 0.0);
+    x->bytes      = m->bytes;
+    x->frames     = m->frames;
+    x->crc_errors = m->crc_errors;
+    x->reconnects = m->reconnects;
+    if (x->age.count) {
+        rollup_add(r, ROLL_AGE_P50, t, qsketch_quantile(&x->age, 0.50));
+        rollup_add(r, ROLL_AGE_P99, t, qsketch_quantile(&x->age, 0.99));
+        memset(&x->age, 0, sizeof(x->age));
+    }
+
+    char name[ROLLUP_NAME_MAX];
+    for (int i = 0; i < m->n_types; i++) {
+        MetricsType *ty = &m->type[i];
+        if (!ty->roll_id) {
+            snprintf(name, sizeof(name), "frames.%d", ty->msg_type);
+            ty->roll_id = rollup_series(r, name, ROLLUP_COUNTER) + 1;
+        }
+        rollup_add(r, ty->roll_id - 1, t, (double)(ty->frames - ty->rolled));
+        ty->rolled = ty->frames;
+    }
+    for (int g = 1; g < 8; g++) {
+        if (!x->sats_id[g]) {
+            if (!m->sats[g]) continue;      /* GNSS not seen yet */
+            snprintf(name, sizeof(name), "sats.%s", k_gnss[g]);
+            x->sats_id[g] = rollup_series(r, name, ROLLUP_GAUGE) + 1;
+        }
+        rollup_add(r, x->sats_id[g] - 1, t, m->state == METRICS_STREAMING ? m->sats[g] : 0.0);
+    }
+}
+
+void metrics_mount_publish(MetricsMount *m, double now, bool force)
+{
+    if (!force && now - m->t_published < METRICS_PUBLISH_INTERVAL_S) return;
+    m->t_published = now;
+    if (m->rollup) metrics_mount_roll(m);
+    if (m->oq) m->quality = m->oq->stats;
+    for (int i = 0; i < m->n_types; i++)
+        bw_meter_rates(&m->type[i].bw, now, &m->type[i].rates);
+    stats_snapshot_publish(m->pub, m);
+}
+
+bool metrics_mount_read(const MetricsMount *m, MetricsMount *view, uint32_t *seen)
+{
+    return stats_snapshot_read(m->pub, view, seen);
+}
+
+/* ── Text exposition ───────────────────────────────────────────────── */
+
+typedef struct {
+    char  *p;
+    size_t len, cap;
+    bool   oom;
+    bool   openmetrics;
+} MetricsBuf;
+
+static void mb_printf(MetricsBuf *b, const char *fmt, ...)
+{
+    if (b->oom) return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int k = vsnprintf(b->p + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (k < 0) { b->oom = true; return; }
+        if ((size_t)k < b->cap - b->len) {
+            b->len += (size_t)k;
+            return;
+        }
+        size_t cap = b->cap * 2 + (size_t)k;
+        char *p = (char *)realloc(b->p, cap);
+        if (!p) { b->oom = true; return; }
+        b->p   = p;
+        b->cap = cap;
+    }
+}
+
+/* HELP and TYPE lines.  A counter family is "name" in OpenMetrics and
+ * "name_total" in the Prometheus format; its samples are always _total. */
+static void mb_family(MetricsBuf *b, const char *name, const char *type, const char *help)
+{
+    bool counter = strcmp(type, "counter") == 0 && !b->openmetrics;
+    mb_printf(b, "# HELP %s%s %s\n# TYPE %s%s %s\n",
+              name, counter ? "_total" : "", help, name, counter ? "_total" : "", type);
+}
+
+/* Label value with \, " and newline escaped. */
+static void mb_escape(char *out, size_t cap, const char *v)
+{
+    size_t o = 0;
+    for (; *v && o + 2 < cap; v++) {
+        if (*v == '\\' || *v == '"') out[o++] = '\\';
+        if (*v == '\n') { out[o++] = '\\'; out[o++] = 'n'; continue; }
+        out[o++] = *v;
+    }
+    out[o] = '\0';
+}
+
+typedef struct {
+    char mount[140];
+    char caster[200];
+} MountLabels;
+
+static void mb_labels(const MetricsMount *m, MountLabels *l)
+{
+    mb_escape(l->mount, sizeof(l->mount), m->mount);
+    mb_escape(l->caster, sizeof(l->caster), m->caster);
+}
+
+/* One sample per mountpoint of a uint64_t field at byte offset @p off. */
+static void mb_per_mount(MetricsBuf *b, const MetricsServer *srv, const char *name,
+                         const char *type, const char *help, size_t off)
+{
+    bool counter = strcmp(type, "counter") == 0;
+    mb_family(b, name, type, help);
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&srv->view[i], &l);
+        const uint64_t *v = (const uint64_t *)((const char *)&srv->view[i] + off);
+        mb_printf(b, "%s%s{mount=\"%s\",caster=\"%s\"} %llu\n", name,
+                  counter ? "_total" : "", l.mount, l.caster, (unsigned long long)*v);
+    }
+}
+
+/* One counter sample per mountpoint and quality row of the ObsQualityRow
+ * field at byte offset @p off: uint64_t when @p wide, else uint32_t. */
+static void mb_quality(MetricsBuf *b, const MetricsServer *srv, const char *name,
+                       const char *help, size_t off, bool wide)
+{
+    mb_family(b, name, "counter", help);
+    for (int i = 0; i < srv->n; i++) {
+        const ObsQualityStats *q = &srv->view[i].quality;
+        if (!q->n_rows) continue;
+        MountLabels l;
+        mb_labels(&srv->view[i], &l);
+        for (int r = 0; r < q->n_rows; r++) {
+            const ObsQualityRow *row = &q->row[r];
+            const char *p = (const char *)row + off;
+            unsigned long long v = wide ? *(const uint64_t *)p : *(const uint32_t *)p;
+            mb_printf(b, "%s_total{mount=\"%s\",caster=\"%s\",station=\"%u\",gnss=\"%s\","
+                         "signal=\"%s\"} %llu\n", name, l.mount, l.caster,
+                      (unsigned)row->station, k_gnss[row->gnss_id & 7],
+                      msm_signal_label(row->gnss_id, row->sig_idx), v);
+        }
+    }
+}
+
+static const double k_quantiles[] = { 0.5, 0.9, 0.95, 0.99, 0.999 };
+#define N_QUANTILES ((int)(sizeof(k_quantiles) / sizeof(k_quantiles[0])))
+
+/* Bring every view up to the newest snapshot of its mountpoint. */
+static void metrics_refresh(MetricsServer *srv)
+{
+    for (int i = 0; i < srv->n; i++) {
+        if (metrics_mount_read(&srv->mounts[i], &srv->scratch, &srv->seen[i]))
+            srv->view[i] = srv->scratch;
+    }
+}
+
+static void metrics_render(const MetricsServer *srv, MetricsBuf *b)
+{
+    const MetricsMount *mm = srv->view;
+
+    mb_family(b, "ntrip_analyser_info", "gauge", "Exporting mode of NTRIP-Analyser.");
+    mb_printf(b, "ntrip_analyser_info{mode=\"%s\"} 1\n", srv->mode);
+    mb_family(b, "ntrip_analyser_uptime_seconds", "gauge", "Seconds since the exporter started.");
+    mb_printf(b, "ntrip_analyser_uptime_seconds %.3f\n",
+              (double)(perf_now_ns() - srv->t_start) / 1e9);
+
+    mb_family(b, "ntrip_stream_state", "gauge",
+              "Stream state: 0 down, 1 connecting or reconnecting, 2 streaming.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        mb_printf(b, "ntrip_stream_state{mount=\"%s\",caster=\"%s\"} %d\n",
+                  l.mount, l.caster, mm[i].state);
+    }
+    mb_per_mount(b, srv, "ntrip_received_bytes", "counter",
+                 "Bytes received from the caster.", offsetof(MetricsMount, bytes));
+    mb_per_mount(b, srv, "ntrip_frames", "counter",
+                 "CRC-valid RTCM frames.", offsetof(MetricsMount, frames));
+    mb_per_mount(b, srv, "ntrip_crc_errors", "counter",
+                 "Frame candidates rejected on CRC.", offsetof(MetricsMount, crc_errors));
+    mb_per_mount(b, srv, "ntrip_resync_skipped_bytes", "counter",
+                 "Bytes discarded while resynchronising.", offsetof(MetricsMount, skipped_bytes));
+    mb_per_mount(b, srv, "ntrip_resyncs", "counter",
+                 "Times sync was lost after a good frame.", offsetof(MetricsMount, resyncs));
+    mb_per_mount(b, srv, "ntrip_reconnects", "counter",
+                 "Stream re-opens after a drop.", offsetof(MetricsMount, reconnects));
+    mb_per_mount(b, srv, "ntrip_other_type_frames", "counter",
+                 "Frames of message types beyond the tracked slots.",
+                 offsetof(MetricsMount, other_frames));
+    mb_per_mount(b, srv, "ntrip_queue_bytes", "gauge",
+                 "Bytes waiting: framer ring, or the laggiest relay client.",
+                 offsetof(MetricsMount, queue_bytes));
+
+    if (strcmp(srv->mode, "relay") == 0) {
+        mb_family(b, "ntrip_relay_clients", "gauge", "Local clients streaming the mountpoint.");
+        for (int i = 0; i < srv->n; i++) {
+            MountLabels l;
+            mb_labels(&mm[i], &l);
+            mb_printf(b, "ntrip_relay_clients{mount=\"%s\",caster=\"%s\"} %u\n",
+                      l.mount, l.caster, (unsigned)mm[i].clients);
+        }
+    }
+
+    mb_family(b, "ntrip_satellites", "gauge", "Satellites in the last MSM frame, per GNSS.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int g = 1; g < 8; g++) {
+            uint32_t s = mm[i].sats[g];
+            if (s)
+                mb_printf(b, "ntrip_satellites{mount=\"%s\",caster=\"%s\",gnss=\"%s\"} %u\n",
+                          l.mount, l.caster, k_gnss[g], (unsigned)s);
+        }
+    }
+
+    mb_family(b, "ntrip_type_frames", "counter", "CRC-valid frames per RTCM message type.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            mb_printf(b, "ntrip_type_frames_total{mount=\"%s\",caster=\"%s\",type=\"%d\"} %llu\n",
+                      l.mount, l.caster, mm[i].type[t].msg_type,
+                      (unsigned long long)mm[i].type[t].frames);
+    }
+
+    mb_family(b, "ntrip_type_bytes", "counter",
+              "Bytes (incl. framing) per RTCM message type.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            mb_printf(b, "ntrip_type_bytes_total{mount=\"%s\",caster=\"%s\",type=\"%d\"} %llu\n",
+                      l.mount, l.caster, mm[i].type[t].msg_type,
+                      (unsigned long long)mm[i].type[t].rates.bytes);
+    }
+    mb_family(b, "ntrip_type_bytes_per_second", "gauge",
+              "Bytes per second of one message type over the last complete 1 s, 10 s or 60 s.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            for (int w = 0; w < BW_WINDOWS; w++)
+                mb_printf(b, "ntrip_type_bytes_per_second{mount=\"%s\",caster=\"%s\","
+                             "type=\"%d\",window=\"%s\"} %.1f\n",
+                          l.mount, l.caster, mm[i].type[t].msg_type,
+                          bw_window_name((BwWindow)w), mm[i].type[t].rates.bytes_s[w]);
+    }
+    mb_family(b, "ntrip_type_frames_per_second", "gauge",
+              "Frames per second of one message type over the last complete 1 s, 10 s or 60 s.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            for (int w = 0; w < BW_WINDOWS; w++)
+                mb_printf(b, "ntrip_type_frames_per_second{mount=\"%s\",caster=\"%s\","
+                             "type=\"%d\",window=\"%s\"} %.2f\n",
+                          l.mount, l.caster, mm[i].type[t].msg_type,
+                          bw_window_name((BwWindow)w), mm[i].type[t].rates.frames_s[w]);
+    }
+    mb_family(b, "ntrip_type_peak_second_bytes", "gauge",
+              "Most bytes of one message type in one second.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            mb_printf(b, "ntrip_type_peak_second_bytes{mount=\"%s\",caster=\"%s\",type=\"%d\"} %u\n",
+                      l.mount, l.caster, mm[i].type[t].msg_type,
+                      (unsigned)mm[i].type[t].rates.peak_1s);
+    }
+    mb_family(b, "ntrip_type_burst_bytes", "gauge",
+              "Most bytes of one message type in one epoch burst.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++)
+            mb_printf(b, "ntrip_type_burst_bytes{mount=\"%s\",caster=\"%s\",type=\"%d\"} %u\n",
+                      l.mount, l.caster, mm[i].type[t].msg_type,
+                      (unsigned)mm[i].type[t].rates.burst_peak);
+    }
+    mb_family(b, "ntrip_epoch_bursts", "counter",
+              "Epoch bursts: frames within 0.5 s after the first MSM of an epoch.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        mb_printf(b, "ntrip_epoch_bursts_total{mount=\"%s\",caster=\"%s\"} %u\n",
+                  l.mount, l.caster, (unsigned)mm[i].burst.seq);
+    }
+    mb_family(b, "ntrip_epoch_burst_peak_bytes", "gauge", "Most bytes in one epoch burst.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        mb_printf(b, "ntrip_epoch_burst_peak_bytes{mount=\"%s\",caster=\"%s\"} %u\n",
+                  l.mount, l.caster, (unsigned)mm[i].burst.peak);
+    }
+    mb_family(b, "ntrip_epoch_burst_mean_bytes", "gauge", "Mean bytes of an epoch burst.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        mb_printf(b, "ntrip_epoch_burst_mean_bytes{mount=\"%s\",caster=\"%s\"} %.0f\n",
+                  l.mount, l.caster, bw_burst_mean(&mm[i].burst));
+    }
+
+    mb_family(b, "ntrip_message_interval_seconds", "summary",
+              "Interval between frames of one message type.");
+    for (int i = 0; i < srv->n; i++) {
+        MountLabels l;
+        mb_labels(&mm[i], &l);
+        for (int t = 0; t < mm[i].n_types; t++) {
+            const QSketch *dt = &mm[i].type[t].dt;
+            if (dt->count == 0) continue;
+            int mt = mm[i].type[t].msg_type;
+            for (int q = 0; q < N_QUANTILES; q++)
+                mb_printf(b, "ntrip_message_interval_seconds{mount=\"%s\",caster=\"%s\","
+                             "type=\"%d\",quantile=\"%g\"} %.6f\n",
+                          l.mount, l.caster, mt, k_quantiles[q],
+                          qsketch_quantile(dt, k_quantiles[q]));
+            mb_printf(b, "ntrip_message_interval_seconds_sum{mount=\"%s\",caster=\"%s\","
+                         "type=\"%d\"} %.6f\n", l.mount, l.caster, mt, dt->sum);
+            mb_printf(b, "ntrip_message_interval_seconds_count{mount=\"%s\",caster=\"%s\","
+                         "type=\"%d\"} %llu\n", l.mount, l.caster, mt,
+                      (unsigned long long)dt->count);
+        }
+    }
+
+    mb_quality(b, srv, "ntrip_obs_signal_observations",
+               "MSM cell observations per station, GNSS and signal.",
+               offsetof(ObsQualityRow, obs), true);
+    mb_quality(b, srv, "ntrip_obs_cycle_slips",
+               "Lock-time resets (cycle slips) per station, GNSS and signal.",
+               offsetof(ObsQualityRow, slips), false);
+    mb_quality(b, srv, "ntrip_obs_gaps",
+               "Signals back after a few missed epochs.",
+               offsetof(ObsQualityRow, gaps), false);
+    mb_quality(b, srv, "ntrip_obs_cnr_drops",
+               "CNR drops under the signal's moving mean.",
+               offsetof(ObsQualityRow, cnr_drops), false);
+
+    bool any_perf = false;
+    for (int i = 0; i < srv->n && !any_perf; i++)
+        any_perf = mm[i].perf && perf_stream_any(mm[i].perf);
+    if (any_perf) {
+        mb_family(b, "ntrip_stage_latency_seconds", "summary",
+                  "Time a frame spent in one processing stage (--perf).");
+        for (int i = 0; i < srv->n; i++) {
+            if (!mm[i].perf) continue;
+            MountLabels l;
+            mb_labels(&mm[i], &l);
+            for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+                const PerfHist *h = &mm[i].perf->stage[s];
+                if (!h->count) continue;
+                const char *st = perf_stage_name((PerfStage)s);
+                for (int q = 0; q < N_QUANTILES; q++)
+                    mb_printf(b, "ntrip_stage_latency_seconds{mount=\"%s\",caster=\"%s\","
+                                 "stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                              l.mount, l.caster, st, k_quantiles[q],
+                              perf_hist_quantile(h, k_quantiles[q]) / 1e9);
+                mb_printf(b, "ntrip_stage_latency_seconds_sum{mount=\"%s\",caster=\"%s\","
+                             "stage=\"%s\"} %.9f\n", l.mount, l.caster, st, h->sum_ns / 1e9);
+                mb_printf(b, "ntrip_stage_latency_seconds_count{mount=\"%s\",caster=\"%s\","
+                             "stage=\"%s\"} %llu\n", l.mount, l.caster, st,
+                          (unsigned long long)h->count);
+            }
+        }
+    }
+
+    if (s_load_gov) {
+        mb_family(b, "ntrip_load_level", "gauge",
+                  "Load shedding level: 0 full, 1 sky and detail decimated, 2 text output off too.");
+        mb_printf(b, "ntrip_load_level %d\n", load_gov_level(s_load_gov));
+        mb_family(b, "ntrip_load_level_changes", "counter", "Load shedding level changes.");
+        mb_printf(b, "ntrip_load_level_changes_total %llu\n",
+                  (unsigned long long)load_gov_changes(s_load_gov));
+        mb_family(b, "ntrip_load_shed", "counter", "Optional work items skipped under load.");
+        for (int w = 0; w < LOAD_WORKS; w++)
+            mb_printf(b, "ntrip_load_shed_total{work=\"%s\"} %llu\n",
+                      load_gov_work_name((LoadWork)w),
+                      (unsigned long long)load_gov_shed(s_load_gov, (LoadWork)w));
+    }
+    if (b->openmetrics) mb_printf(b, "# EOF\n");
+}
+
+/* ── Server thread ─────────────────────────────────────────────────── */
+
+static bool metrics_has_ci(const char *hdr, const char *needle)
+{
+    size_t nl = strlen(needle);
+    for (const char *p = hdr; *p; p++) {
+        size_t k = 0;
+        while (k < nl && p[k] && (p[k] | 0x20) == (needle[k] | 0x20)) k++;
+        if (k == nl) return true;
+    }
+    return false;
+}
+
+static void metrics_send_all(NtripSocket s, const char *p, size_t len)
+{
+    while (len > 0) {
+        int k = send(s, p, (int)(len > 65536 ? 65536 : len), MSG_NOSIGNAL);
+        if (k <= 0) return;
+        p   += k;
+        len -= (size_t)k;
+    }
+}
+
+static void metrics_reply(NtripSocket s, const char *status, const char *type,
+                          const char *body, size_t body_len, bool head_only)
+{
+    char head[256];
+    int hl = snprintf(head, sizeof(head),
+                      "HTTP/1.1 %s\r\nServer: NTRIP-Analyser\r\nContent-Type: %s\r\n"
+                      "Content-Length: %lu\r\nConnection: close\r\n\r\n",
+                      status, type, (unsigned long)body_len);
+    metrics_send_all(s, head, (size_t)hl);
+    if (!head_only) metrics_send_all(s, body, body_len);
+}
+
+/* Value of query parameter @p key in the request target @p path, with
+ * %XX and + decoded; false if it is not there. */
+static bool metrics_query(const char *path, const char *key, char *out, size_t cap)
+{
+    const char *q = path + strcspn(path, "? \r\n");
+    size_t kl = strlen(key);
+    while (*q == '?' || *q == '&') {
+        q++;
+        size_t n = strcspn(q, "& \r\n");
+        if (n > kl && q[kl] == '=' && strncmp(q, key, kl) == 0) {
+            size_t o = 0;
+            for (const char *v = q + kl + 1; v < q + n && o + 1 < cap; v++) {
+                unsigned hex;
+                if (*v == '%' && v + 2 < q + n && sscanf(v + 1, "%2x", &hex) == 1) {
+                    out[o++] = (char)hex;
+                    v += 2;
+                } else {
+                    out[o++] = *v == '+' ? ' ' : *v;
+                }
+            }
+            out[o] = '\0';
+            return true;
+        }
+        q += n;
+    }
+    return false;
+}
+
+/* GET /rollup: the series of every mountpoint, or with ?mount= the
+ * points of one (series= prefix, res= 1s | 1m | 15m, since= Unix s). */
+static void metrics_rollup(const MetricsServer *srv, NtripSocket s, const char *path,
+                           bool head_only)
+{
+    char mount[64] = "", series[ROLLUP_NAME_MAX] = "", res[8] = "1m", since[24] = "0";
+    MetricsBuf b;
+    memset(&b, 0, sizeof(b));
+    b.cap = 16 * 1024;
+    if (!(b.p = (char *)malloc(b.cap))) return;
+
+    const char *status = "200 OK";
+    char esc[140];
+    if (!metrics_query(path, "mount", mount, sizeof(mount))) {
+        mb_printf(&b, "{\"resolutions\":[\"1s\",\"1m\",\"15m\"],\"mounts\":[");
+        for (int i = 0; i < srv->n; i++) {
+            const MetricsMount *m = &srv->mounts[i];
+            mb_escape(esc, sizeof(esc), m->mount);
+            mb_printf(&b, "%s{\"mount\":\"%s\",\"series\":[", i ? "," : "", esc);
+            for (int k = 0; k < rollup_count(m->rollup); k++) {
+                char name[ROLLUP_NAME_MAX];
+                if (rollup_info(m->rollup, k, name, NULL))
+                    mb_printf(&b, "%s\"%s\"", k ? "," : "", name);
+            }
+            mb_printf(&b, "]}");
+        }
+        mb_printf(&b, "]}\n");
+    } else {
+        metrics_query(path, "series", series, sizeof(series));
+        metrics_query(path, "res", res, sizeof(res));
+        metrics_query(path, "since", since, sizeof(since));
+        RollupTier tier;
+        const MetricsMount *m = NULL;
+        for (int i = 0; i < srv->n && !m; i++)
+            if (strcmp(srv->mounts[i].mount, mount) == 0) m = &srv->mounts[i];
+        size_t len = 0;
+        char *json = NULL;
+        if (!rollup_tier_parse(res, &tier)) {
+            status = "400 Bad Request";
+            mb_printf(&b, "{\"error\":\"res must be 1s, 1m or 15m\"}\n");
+        } else if (!m) {
+            status = "404 Not Found";
+            mb_printf(&b, "{\"error\":\"no such mount\"}\n");
+        } else if (!(json = rollup_json(m->rollup, series, tier, atof(since), &len))) {
+            b.oom = true;
+        } else {
+            mb_escape(esc, sizeof(esc), m->mount);
+            mb_printf(&b, "{\"mount\":\"%s\",\"res\":\"%s\",\"step\":%d,\"series\":",
+                      esc, rollup_tier_name(tier), rollup_tier_step(tier));
+            mb_printf(&b, "%.*s}\n", (int)len, json);
+        }
+        free(json);
+    }
+    if (b.oom) {
+        static const char msg[] = "Out of memory\n";
+        metrics_reply(s, "500 Internal Server Error", "text/plain", msg, sizeof(msg) - 1,
+                      head_only);
+    } else {
+        metrics_reply(s, status, "application/json", b.p, b.len, head_only);
+    }
+    free(b.p);
+}
+
+/* GET /anomalies: the anomaly ring of every mountpoint that has one, or
+ * with ?mount= of that one, as text. */
+static void metrics_anomalies(const MetricsServer *srv, NtripSocket s, const char *path,
+                              bool head_only)
+{
+    char mount[64] = "";
+    bool one = metrics_query(path, "mount", mount, sizeof(mount));
+    AnomalyEvent *ev = (AnomalyEvent *)malloc(ANOMALY_RING_SLOTS * sizeof(*ev));
+    char *text = (char *)malloc(ANOMALY_TEXT_MAX);
+    MetricsBuf b;
+    memset(&b, 0, sizeof(b));
+    b.cap = 64 * 1024;
+    b.p   = (char *)malloc(b.cap);
+    if (!ev || !text || !b.p) b.oom = true;
+
+    int shown = 0;
+    for (int i = 0; !b.oom && i < srv->n; i++) {
+        const MetricsMount *m = &srv->mounts[i];
+        if (!m->anomalies || (one && strcmp(m->mount, mount) != 0)) continue;
+        int n = anomaly_ring_read(m->anomalies, ev, ANOMALY_RING_SLOTS);
+        mb_printf(&b, "[%s] %d of %llu anomalies\n", m->mount, n,
+                  (unsigned long long)anomaly_ring_count(m->anomalies));
+        for (int k = 0; k < n; k++) {
+            anomaly_event_format(&ev[k], text, ANOMALY_TEXT_MAX);
+            mb_printf(&b, "%s", text);
+        }
+        shown++;
+    }
+    if (b.oom) {
+        static const char msg[] = "Out of memory\n";
+        metrics_reply(s, "500 Internal Server Error", "text/plain", msg, sizeof(msg) - 1,
+                      head_only);
+    } else if (!shown) {
+        static const char msg[] = "No such mount\n";
+        metrics_reply(s, "404 Not Found", "text/plain", msg, sizeof(msg) - 1, head_only);
+    } else {
+        metrics_reply(s, "200 OK", "text/plain; charset=utf-8", b.p, b.len, head_only);
+    }
+    free(b.p);
+    free(text);
+    free(ev);
+}
+
+static void metrics_handle(MetricsServer *srv, NtripSocket s)
+{
+#ifdef _WIN32
+    DWORD tmo = METRICS_IO_TIMEOUT_S * 1000;
+#else
+    struct timeval tmo = { METRICS_IO_TIMEOUT_S, 0 };
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tmo, sizeof(tmo));
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tmo, sizeof(tmo));
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    char req[METRICS_REQ_MAX + 1];
+    int len = 0;
+    while (len < METRICS_REQ_MAX) {
+        int k = recv(s, req + len, METRICS_REQ_MAX - len, 0);
+        if (k <= 0) return;
+        len += k;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+    req[len] = '\0';
+
+    bool head_only = strncmp(req, "HEAD ", 5) == 0;
+    if (!head_only && strncmp(req, "GET ", 4) != 0) {
+        static const char msg[] = "Only GET /metrics\n";
+        metrics_reply(s, "405 Method Not Allowed", "text/plain", msg, sizeof(msg) - 1, false);
+        return;
+    }
+    const char *path = req + (head_only ? 5 : 4);
+    size_t plen = strcspn(path, " ?\r\n");
+
+    if (plen == 8 && strncmp(path, "/metrics", 8) == 0) {
+        MetricsBuf b;
+        memset(&b, 0, sizeof(b));
+        b.cap = 64 * 1024;
+        b.p   = (char *)malloc(b.cap);
+        if (!b.p) return;
+        b.openmetrics = metrics_has_ci(req, "application/openmetrics-text");
+        metrics_refresh(srv);
+        metrics_render(srv, &b);
+        if (b.oom) {
+            static const char msg[] = "Out of memory\n";
+            metrics_reply(s, "500 Internal Server Error", "text/plain", msg, sizeof(msg) - 1,
+                          head_only);
+        } else {
+            metrics_reply(s, "200 OK",
+                          b.openmetrics
+                              ? "application/openmetrics-text; version=1.0.0; charset=utf-8"
+                              : "text/plain; version=0.0.4; charset=utf-8",
+                          b.p, b.len, head_only);
+        }
+        free(b.p);
+    } else if (plen == 7 && strncmp(path, "/rollup", 7) == 0 && s_rollups) {
+        metrics_rollup(srv, s, path, head_only);
+    } else if (plen == 10 && strncmp(path, "/anomalies", 10) == 0 && srv->n > 0 &&
+               srv->mounts[0].anomalies) {
+        metrics_anomalies(srv, s, path, head_only);
+    } else if (plen == 1) {
+        static const char msg[] = "NTRIP-Analyser metrics exporter: GET /metrics\n";
+        metrics_reply(s, "200 OK", "text/plain", msg, sizeof(msg) - 1, head_only);
+    } else {
+        static const char msg[] = "Not found\n";
+        metrics_reply(s, "404 Not Found", "text/plain", msg, sizeof(msg) - 1, head_only);
+    }
+}
+
+/* One scrape at a time: Prometheus scrapes every few seconds, and a
+ * stalled client is cut off by the socket timeouts. */
+static void metrics_serve(MetricsServer *srv)
+{
+    while (!srv->stop) {
+        MetricsPollFd p;
+        p.fd      = srv->sock;
+        p.events  = POLLIN;
+        p.revents = 0;
+        if (metrics_poll(&p, 1, 250) <= 0 || !(p.revents & POLLIN)) continue;
+        NtripSocket c = accept(srv->sock, NULL, NULL);
+        if (c == NTRIP_INVALID_SOCKET) continue;
+        ntrip_socket_set_blocking(c, true);
+        metrics_handle(srv, c);
+        CLOSESOCKET(c);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall metrics_thread(void *arg)
+#else
+static void *metrics_thread(void *arg)
+#endif
+{
+    metrics_serve((MetricsServer *)arg);
+    return 0;
+}
+
+MetricsServer *metrics_server_start(const MetricsMount *mounts, int n, const char *mode)
+{
+    if (!s_enabled) return NULL;
+    const char *shown = s_listen_addr[0] ? s_listen_addr : "0.0.0.0";
+
+    NtripSocket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NTRIP_INVALID_SOCKET) return NULL;
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_port        = htons((unsigned short)s_listen_port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (s_listen_addr[0] && inet_pton(AF_INET, s_listen_addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "[ERROR] --metrics-listen: \"%s\" is not an IPv4 address\n",
+                s_listen_addr);
+        CLOSESOCKET(s);
+        return NULL;
+    }
+    if (bind(s, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(s, 16) != 0) {
+        fprintf(stderr, "[ERROR] --metrics-listen: cannot listen on %s:%d\n",
+                shown, s_listen_port);
+        CLOSESOCKET(s);
+        return NULL;
+    }
+    ntrip_socket_set_blocking(s, false);
+
+    MetricsServer *srv = (MetricsServer *)calloc(1, sizeof(MetricsServer));
+    if (srv) {
+        srv->view = (MetricsMount *)calloc((size_t)n, sizeof(MetricsMount));
+        srv->seen = (uint32_t *)calloc((size_t)n, sizeof(uint32_t));
+    }
+    if (!srv || !srv->view || !srv->seen) {
+        fprintf(stderr, "[ERROR] --metrics-listen: out of memory\n");
+        if (srv) { free(srv->view); free(srv->seen); }
+        free(srv);
+        CLOSESOCKET(s);
+        return NULL;
+    }
+    /* Labelled views until the first snapshots; the streams have not
+     * started, so the structs are still the caller's to read. */
+    memcpy(srv->view, mounts, (size_t)n * sizeof(MetricsMount));
+    srv->sock    = s;
+    srv->mounts  = mounts;
+    srv->n       = n;
+    srv->t_start = perf_now_ns();
+    snprintf(srv->mode, sizeof(srv->mode), "%s", mode);
+#ifdef _WIN32
+    srv->thread = (HANDLE)_beginthreadex(NULL, 0, metrics_thread, srv, 0, NULL);
+    bool started = srv->thread != NULL;
+#else
+    bool started = pthread_create(&srv->thread, NULL, metrics_thread, srv) == 0;
+#endif
+    if (!started) {
+        fprintf(stderr, "[ERROR] --metrics-listen: cannot start the exporter thread\n");
+        CLOSESOCKET(s);
+        free(srv->view);
+        free(srv->seen);
+        free(srv);
+        return NULL;
+    }
+    fprintf(stderr, "[METRICS] Serving http://%s:%d/metrics\n", shown, s_listen_port);
+    if (s_rollups)
+        fprintf(stderr, "[METRICS] Rollups at http://%s:%d/rollup\n", shown, s_listen_port);
+    if (n > 0 && mounts[0].anomalies)
+        fprintf(stderr, "[METRICS] Anomalies at http://%s:%d/anomalies\n", shown, s_listen_port);
+    return srv;
+}
+
+void metrics_server_stop(MetricsServer *srv)
+{
+    if (!srv) return;
+    srv->stop = 1;
+#ifdef _WIN32
+    WaitForSingleObject(srv->thread, INFINITE);
+    CloseHandle(srv->thread);
+#else
+    pthread_join(srv->thread, NULL);
+#endif
+    CLOSESOCKET(srv->sock);
+    free(srv->view);
+    free(srv->seen);
+    free(srv);
+}
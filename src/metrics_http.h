@@ -0,0 +1,250 @@
+/**
+ * @file metrics_http.h
+ * @brief Prometheus / OpenMetrics exporter for the long-running modes.
+ *
+ * `--metrics-listen [ADDR]:PORT` serves `GET /metrics` from a thread of
+ * its own while --mounts-file or --relay runs.  The exporter knows
+ * nothing about either mode: each keeps one MetricsMount per mountpoint,
+ * updates it from the thread that owns the stream and publishes it at a
+ * fixed cadence; the server thread renders the published copies on
+ * every scrape:
+ *
+ * @code
+ * MetricsMount *mm = metrics_mounts_new(n);          // labels filled in
+ * MetricsServer *srv = metrics_server_start(mm, n, "multi");
+ * ...
+ * mm[i].bytes += r;                                  // stream's thread
+ * metrics_mount_frame(&mm[i], frame, len, now);      // framer callback
+ * metrics_mount_framer(&mm[i], &framer);
+ * metrics_mount_publish(&mm[i], now, false);         // every pass
+ * ...
+ * metrics_server_stop(srv);
+ * metrics_mounts_free(mm, n);
+ * @endcode
+ *
+ * A MetricsMount is plain data owned by one thread.  Readers never look
+ * at it: metrics_mount_publish() copies it into a sequence-locked
+ * snapshot (stats_snapshot.h) every @ref METRICS_PUBLISH_INTERVAL_S and
+ * metrics_mount_read() copies the newest one out, so a scrape sees each
+ * mountpoint as it was at one instant and never takes a lock the ingest
+ * path waits on.  Only the --perf stage histograms (perf_probe.h) are
+ * read in place, as by the GUI.
+ *
+ * Families exported per mountpoint (labels mount, caster): stream up,
+ * bytes, frames, frames per message type, CRC errors, resync skipped
+ * bytes and resyncs, reconnects, satellites per GNSS in the last MSM
+ * frame, bytes waiting in the framer or relay ring (queue depth), relay
+ * clients, message interval quantiles, bytes per message type with the
+ * 1 s / 10 s / 60 s rates, busiest second and epoch burst share (bw_meter.h),
+ * the epoch bursts of the stream, the signal quality counters of
+ * obs_quality.h (observations, cycle slips, gaps, CNR drops; labels
+ * station, gnss and signal as well) and, when --perf is on, the stage
+ * latency quantiles.  A monitor with a load governor (metrics_set_governor())
+ * adds its shedding level and the work it skipped.  A scrape asking for OpenMetrics gets
+ * application/openmetrics-text, otherwise the Prometheus 0.0.4 text
+ * format.
+ *
+ * With `--rollups` every mountpoint also keeps a bounded history
+ * (rollup.h): bytes, frames (in all and per type), CRC errors,
+ * reconnects, stream up, satellites per GNSS and the p50 / p99 age of
+ * corrections, added once a second by the writer inside
+ * metrics_mount_publish().  `GET /rollup` lists the mountpoints and
+ * series; `GET /rollup?mount=M&series=PREFIX&res=1s|1m|15m&since=T`
+ * returns the points as JSON.
+ *
+ * With `--anomaly-dump` the anomaly ring of every mountpoint
+ * (anomaly_ring.h) is served as text at `GET /anomalies`, or of one at
+ * `GET /anomalies?mount=M`; like the --perf histograms it is read in
+ * place, lock-free.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "anomaly_ring.h"
+#include "bw_meter.h"
+#include "load_governor.h"
+#include "obs_quality.h"
+#include "perf_probe.h"
+#include "quantile_sketch.h"
+#include "rollup.h"
+#include "rtcm_framer.h"
+#include "stats_snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default port of --metrics-listen (the OpenMetrics exporter range). */
+#define METRICS_DEFAULT_PORT  9464
+
+/** @brief Message types tracked per mountpoint; later types count as other. */
+#define METRICS_TYPE_SLOTS    48
+
+/** @brief Seconds between two snapshots of a mountpoint. */
+#define METRICS_PUBLISH_INTERVAL_S  0.5
+
+/** @brief Stream states exported as ntrip_stream_state. */
+typedef enum {
+    METRICS_DOWN = 0,       /**< failed or closed */
+    METRICS_CONNECTING,     /**< connect, TLS or header in progress; reconnect backoff */
+    METRICS_STREAMING
+} MetricsState;
+
+/** @brief Frames and intervals of one message type. */
+typedef struct {
+    int      msg_type;
+    uint64_t frames;
+    double   last_time;         /**< writer only */
+    QSketch  dt;                /**< inter-arrival intervals (s) */
+    BwMeter  bw;                /**< writer only: bytes and frames per window */
+    BwRates  rates;             /**< ... as of the last publish */
+    int      roll_id;           /**< writer only: rollup series + 1; 0 = not made yet */
+    uint64_t rolled;            /**< writer only: frames already in the rollup */
+} MetricsType;
+
+/** @brief Writer-side state of the --rollups history of a mountpoint. */
+typedef struct {
+    int64_t  sec;               /**< Unix second rolled last */
+    uint64_t bytes;             /**< totals already in the rollup */
+    uint64_t frames;
+    uint64_t crc_errors;
+    uint64_t reconnects;
+    int      sats_id[8];        /**< series + 1 per GNSS id; 0 = not made yet */
+    QSketch  age;               /**< correction age (ms) since the last roll */
+} MetricsRoll;
+
+/**
+ * @struct MetricsMount
+ * @brief Exported state of one mountpoint.
+ *
+ * Written by one thread -- the one owning the stream -- and read by
+ * others only through metrics_mount_read().  @c mount, @c caster and
+ * @c perf are set before metrics_server_start().
+ */
+typedef struct {
+    char        mount[64];
+    char        caster[96];     /**< host:port */
+    int         state;          /**< MetricsState */
+    uint64_t    bytes;          /**< received from the caster */
+    uint64_t    frames;         /**< CRC-valid frames */
+    uint64_t    crc_errors;
+    uint64_t    skipped_bytes;  /**< dropped while resynchronising */
+    uint64_t    resyncs;
+    uint64_t    reconnects;
+    uint64_t    other_frames;   /**< frames of types beyond the slots */
+    uint64_t    queue_bytes;    /**< bytes waiting: framer ring, or the laggiest relay client */
+    uint32_t    clients;        /**< relay clients (0 for the monitor) */
+    uint32_t    sats[8];        /**< satellites in the last MSM frame, per GNSS id */
+    int         n_types;        /**< published slots of @c type */
+    MetricsType type[METRICS_TYPE_SLOTS];
+    BwBurst     burst;          /**< epoch bursts of the stream */
+    ObsQualityStats quality;    /**< signal quality counts, copied from @c oq on publish */
+    ObsQuality *oq;             /**< writer only: the engine behind @c quality; NULL = none */
+    const PerfStream *perf;     /**< --perf histograms of the stream; NULL = none */
+    const AnomalyRing *anomalies;   /**< --anomaly-dump ring of the stream; NULL = none */
+    RollupStore *rollup;        /**< --rollups history; NULL = none.  Locked on its own */
+    MetricsRoll roll;           /**< writer only */
+    double      t_published;    /**< writer only: time of the last snapshot */
+    StatsSnapshot *pub;         /**< published copies of this struct */
+} MetricsMount;
+
+/** @brief Opaque exporter thread. */
+typedef struct MetricsServer MetricsServer;
+
+/**
+ * @brief Parse `[ADDR]:PORT` or `PORT` and enable the exporter.
+ *
+ * @return false if the spec is not a valid address and port.
+ */
+bool metrics_configure(const char *spec);
+
+/** @brief true after a successful metrics_configure(). */
+bool metrics_enabled(void);
+
+/**
+ * @brief Export the level and shed counters of @p gov (read through its
+ *        atomic readers) with every scrape; NULL = none.  Set before
+ *        metrics_server_start(), cleared after metrics_server_stop().
+ */
+void metrics_set_governor(const LoadGovernor *gov);
+
+/** @brief Keep a rollup history per mountpoint (`--rollups`); set before
+ *         metrics_mounts_new(). */
+void metrics_set_rollups(bool on);
+
+/** @brief Allocate @p n zeroed mounts, their snapshots and (--rollups) their
+ *         rollup stores; NULL when out of memory. */
+MetricsMount *metrics_mounts_new(int n);
+
+/** @brief Free what metrics_mounts_new() returned (NULL is ignored). */
+void metrics_mounts_free(MetricsMount *mounts, int n);
+
+/** @brief Set the labels of @p m. */
+void metrics_mount_label(MetricsMount *m, const char *mount, const char *host, int port);
+
+/**
+ * @brief Count one CRC-valid frame of @p m: type counter and interval,
+ *        and the satellite count and signal quality of MSM frames.
+ *
+ * @param now  Receive time in seconds, on any monotonic clock.
+ */
+void metrics_mount_frame(MetricsMount *m, const unsigned char *frame, int frame_len,
+                         double now);
+
+/**
+ * @brief Add the age of corrections of @p frame (MSM frames only) to the
+ *        rollup of @p m; nothing without --rollups.
+ *
+ * @param rx_utc_ns  UTC receive time of the frame, Unix ns.
+ */
+void metrics_mount_age(MetricsMount *m, const unsigned char *frame, int frame_len,
+                       int64_t rx_utc_ns);
+
+/** @brief Copy the frame, CRC and resync counters and the buffered bytes of @p f. */
+void metrics_mount_framer(MetricsMount *m, const RtcmFramer *f);
+
+/**
+ * @brief Writer: publish a snapshot of @p m if @ref METRICS_PUBLISH_INTERVAL_S
+ *        has passed since the last one, or at once when @p force is set
+ *        (state changes, before the stream's thread starts).
+ *
+ * @param now  Seconds on the clock passed to metrics_mount_frame().
+ */
+void metrics_mount_publish(MetricsMount *m, double now, bool force);
+
+/**
+ * @brief Reader: copy the newest snapshot of @p m to @p view if it is newer
+ *        than @p *seen (0 initially).
+ *
+ * @return true if @p view now holds a consistent, newer copy; false if
+ *         nothing new was published (@p view untouched) or the copy raced
+ *         two publishes (@p view torn -- read into a scratch copy when
+ *         the previous contents must survive).
+ */
+bool metrics_mount_read(const MetricsMount *m, MetricsMount *view, uint32_t *seen);
+
+/**
+ * @brief Listen on the configured address and serve @p mounts.
+ *
+ * @param mode  Exported as the mode label of ntrip_analyser_info.
+ * @return The running server; NULL if the exporter is not configured or
+ *         could not listen (reported on stderr -- check metrics_enabled()).
+ */
+MetricsServer *metrics_server_start(const MetricsMount *mounts, int n, const char *mode);
+
+/** @brief Stop the server thread and close its socket (NULL is ignored). */
+void metrics_server_stop(MetricsServer *srv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_HTTP_H */
@@ -0,0 +1,432 @@
+/**
+ * @file ntrip_connect.c
+ * @brief Shared caster connection helper: cached DNS, IPv4 + IPv6, and
+ *        connect attempts that race each other and give up in time.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601     /* SRWLOCK needs Vista or later */
+#endif
+#endif
+
+#include "ntrip_connect.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#define CONN_CLOSE(s)  closesocket(s)
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#define CONN_CLOSE(s)  close(s)
+#endif
+
+/* Lookups running at once in ntrip_dns_prefetch(). */
+#define DNS_PREFETCH_MAX_JOBS  16
+
+static double conn_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/* ── DNS cache ─────────────────────────────────────────────────────── */
+
+typedef struct {
+    char      host[256];
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];   /* port 0 */
+    int       n;                    /* 0 = negative entry */
+    double    expires;
+    double    used;                 /* for LRU replacement */
+} DnsEntry;
+
+static DnsEntry g_dns[NTRIP_DNS_CACHE_SLOTS];
+
+#ifdef _WIN32
+static SRWLOCK g_dns_lock = SRWLOCK_INIT;
+#define DNS_LOCK()    AcquireSRWLockExclusive(&g_dns_lock)
+#define DNS_UNLOCK()  ReleaseSRWLockExclusive(&g_dns_lock)
+#else
+static pthread_mutex_t g_dns_lock = PTHREAD_MUTEX_INITIALIZER;
+#define DNS_LOCK()    pthread_mutex_lock(&g_dns_lock)
+#define DNS_UNLOCK()  pthread_mutex_unlock(&g_dns_lock)
+#endif
+
+static DnsEntry *dns_find(const char *host)
+{
+    for (int i = 0; i < NTRIP_DNS_CACHE_SLOTS; i++)
+        if (g_dns[i].host[0] && strcmp(g_dns[i].host, host) == 0) return &g_dns[i];
+    return NULL;
+}
+
+/* Slot for a new name: a free one, else the least recently used. */
+static DnsEntry *dns_slot(void)
+{
+    DnsEntry *lru = &g_dns[0];
+    for (int i = 0; i < NTRIP_DNS_CACHE_SLOTS; i++) {
+        if (!g_dns[i].host[0]) return &g_dns[i];
+        if (g_dns[i].used < lru->used) lru = &g_dns[i];
+    }
+    return lru;
+}
+
+static bool addr_same(const NtripAddr *a, const NtripAddr *b)
+{
+    return a->len == b->len && memcmp(&a->sa, &b->sa, (size_t)a->len) == 0;
+}
+
+/* getaddrinfo() for both families; the answer in RFC 8305 order:
+ * the first family the resolver prefers, then alternating. */
+static int dns_resolve(const char *host, NtripAddr *out)
+{
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_ADDRCONFIG;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || !result)
+        return 0;
+
+    NtripAddr v4[NTRIP_CONNECT_MAX_ADDRS], v6[NTRIP_CONNECT_MAX_ADDRS];
+    int n4 = 0, n6 = 0, first = 0;
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+        if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) continue;
+        if ((size_t)ai->ai_addrlen > sizeof(struct sockaddr_storage)) continue;
+        NtripAddr a;
+        memset(&a, 0, sizeof(a));
+        memcpy(&a.sa, ai->ai_addr, ai->ai_addrlen);
+        a.len = (int)ai->ai_addrlen;
+        NtripAddr *list = ai->ai_family == AF_INET ? v4 : v6;
+        int *cnt        = ai->ai_family == AF_INET ? &n4 : &n6;
+        bool dup = false;
+        for (int i = 0; i < *cnt; i++)
+            if (addr_same(&list[i], &a)) dup = true;
+        if (dup || *cnt >= NTRIP_CONNECT_MAX_ADDRS) continue;
+        if (!first) first = ai->ai_family;
+        list[(*cnt)++] = a;
+    }
+    freeaddrinfo(result);
+
+    const NtripAddr *pa = first == AF_INET6 ? v6 : v4;
+    const NtripAddr *pb = first == AF_INET6 ? v4 : v6;
+    int na = first == AF_INET6 ? n6 : n4;
+    int nb = first == AF_INET6 ? n4 : n6;
+    int n = 0;
+    for (int i = 0; (i < na || i < nb) && n < NTRIP_CONNECT_MAX_ADDRS; i++) {
+        if (i < na) out[n++] = pa[i];
+        if (i < nb && n < NTRIP_CONNECT_MAX_ADDRS) out[n++] = pb[i];
+    }
+    return n;
+}
+
+static void addr_set_port(NtripAddr *a, int port)
+{
+    if (a->sa.ss_family == AF_INET6)
+        ((struct sockaddr_in6 *)&a->sa)->sin6_port = htons((unsigned short)port);
+    else
+        ((struct sockaddr_in *)&a->sa)->sin_port = htons((unsigned short)port);
+}
+
+/* Copy @p e out with the port set; returns the count copied. */
+static int dns_copy(const DnsEntry *e, int port, NtripAddr *out, int max)
+{
+    int n = e->n < max ? e->n : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = e->addrs[i];
+        addr_set_port(&out[i], port);
+    }
+    return n;
+}
+
+int ntrip_dns_lookup(const char *host, int port, NtripAddr *out, int max, bool fresh)
+{
+    if (!host || !host[0] || max <= 0 || strlen(host) >= sizeof(g_dns[0].host))
+        return 0;
+
+    double now = conn_now();
+    DNS_LOCK();
+    DnsEntry *e = dns_find(host);
+    if (e && !fresh && now < e->expires) {
+        e->used = now;
+        int n = dns_copy(e, port, out, max);
+        DNS_UNLOCK();
+        return n;
+    }
+    DNS_UNLOCK();
+
+    /* The lookup itself runs unlocked; two threads asking for the same
+     * name at once both resolve it, which is harmless. */
+    NtripAddr got[NTRIP_CONNECT_MAX_ADDRS];
+    int n_got = dns_resolve(host, got);
+
+    now = conn_now();
+    DNS_LOCK();
+    e = dns_find(host);
+    if (n_got > 0) {
+        if (!e) e = dns_slot();
+        snprintf(e->host, sizeof(e->host), "%s", host);
+        memcpy(e->addrs, got, (size_t)n_got * sizeof(got[0]));
+        e->n       = n_got;
+        e->expires = now + NTRIP_DNS_TTL_S;
+    } else if (e && e->n > 0) {
+        /* Resolver trouble: keep serving the last good answer */
+        e->expires = now + NTRIP_DNS_NEGATIVE_TTL_S;
+    } else {
+        if (!e) e = dns_slot();
+        snprintf(e->host, sizeof(e->host), "%s", host);
+        e->n       = 0;
+        e->expires = now + NTRIP_DNS_NEGATIVE_TTL_S;
+    }
+    e->used = now;
+    int n = dns_copy(e, port, out, max);
+    DNS_UNLOCK();
+    return n;
+}
+
+typedef struct {
+    const char *const *hosts;
+    int n;
+    int next;                       /* under g_dns_lock */
+} DnsPrefetch;
+
+static void dns_prefetch_work(DnsPrefetch *q)
+{
+    for (;;) {
+        DNS_LOCK();
+        int i = q->next < q->n ? q->next++ : -1;
+        DNS_UNLOCK();
+        if (i < 0) return;
+        NtripAddr a;
+        ntrip_dns_lookup(q->hosts[i], 0, &a, 1, false);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall dns_prefetch_thread(void *arg)
+#else
+static void *dns_prefetch_thread(void *arg)
+#endif
+{
+    dns_prefetch_work((DnsPrefetch *)arg);
+    return 0;
+}
+
+void ntrip_dns_prefetch(const char *const *hosts, int n, int jobs)
+{
+    DnsPrefetch q = { hosts, n, 0 };
+    if (jobs > DNS_PREFETCH_MAX_JOBS) jobs = DNS_PREFETCH_MAX_JOBS;
+    if (jobs > n) jobs = n;
+
+#ifdef _WIN32
+    HANDLE threads[DNS_PREFETCH_MAX_JOBS];
+#else
+    pthread_t threads[DNS_PREFETCH_MAX_JOBS];
+#endif
+    bool started[DNS_PREFETCH_MAX_JOBS] = { false };
+    /* Worker 0 is this thread. */
+    for (int t = 1; t < jobs; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, dns_prefetch_thread, &q, 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, dns_prefetch_thread, &q) == 0;
+#endif
+    }
+    dns_prefetch_work(&q);
+    for (int t = 1; t < jobs; t++) {
+        if (!started[t]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+}
+
+const char *ntrip_addr_str(const NtripAddr *a, char *buf, size_t len)
+{
+    char host[64], port[16];
+    if (getnameinfo((const struct sockaddr *)&a->sa, (socklen_t)a->len, host, sizeof(host),
+                    port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        snprintf(buf, len, "?");
+    } else if (a->sa.ss_family == AF_INET6) {
+        snprintf(buf, len, "[%s]:%s", host, port);
+    } else {
+        snprintf(buf, len, "%s:%s", host, port);
+    }
+    return buf;
+}
+
+/* ── Connecting ────────────────────────────────────────────────────── */
+
+void ntrip_socket_set_blocking(NtripSocket sock, bool blocking)
+{
+#ifdef _WIN32
+    u_long nb = blocking ? 0 : 1;
+    ioctlsocket(sock, FIONBIO, &nb);
+#else
+    int fl = fcntl(sock, F_GETFL, 0);
+    if (fl >= 0) fcntl(sock, F_SETFL, blocking ? (fl & ~O_NONBLOCK) : (fl | O_NONBLOCK));
+#endif
+}
+
+int ntrip_socket_wait(NtripSocket sock, bool want_write, int timeout_ms)
+{
+#ifdef _WIN32
+    fd_set fs, es;
+    struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    FD_ZERO(&fs);
+    FD_ZERO(&es);
+    FD_SET(sock, &fs);
+    FD_SET(sock, &es);
+    return select(0, want_write ? NULL : &fs, want_write ? &fs : NULL, &es, &tv);
+#else
+    struct pollfd pfd = { sock, (short)(want_write ? POLLOUT : POLLIN), 0 };
+    return poll(&pfd, 1, timeout_ms);
+#endif
+}
+
+NtripSocket ntrip_connect_start(const NtripAddr *a)
+{
+    NtripSocket sock = socket(a->sa.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == NTRIP_INVALID_SOCKET) return NTRIP_INVALID_SOCKET;
+    ntrip_socket_set_blocking(sock, false);
+#ifdef _WIN32
+    if (connect(sock, (const struct sockaddr *)&a->sa, a->len) == SOCKET_ERROR &&
+        WSAGetLastError() != WSAEWOULDBLOCK) {
+#else
+    if (connect(sock, (const struct sockaddr *)&a->sa, (socklen_t)a->len) != 0 &&
+        errno != EINPROGRESS) {
+#endif
+        CONN_CLOSE(sock);
+        return NTRIP_INVALID_SOCKET;
+    }
+    return sock;
+}
+
+bool ntrip_connect_result(NtripSocket sock)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return getsockopt(sock, SOL_SOCKET, SO_ERROR, (char *)&err, &len) == 0 && err == 0;
+}
+
+/* Wait up to @p ms for any of the @p n pending connects to finish;
+ * done[i] is set for each one that did (successfully or not). */
+static int conn_wait(const NtripSocket *socks, int n, int ms, bool *done)
+{
+#ifdef _WIN32
+    /* select(): WSAPoll() does not report a refused connect on older Windows */
+    fd_set ws, es;
+    struct timeval tv = { ms / 1000, (ms % 1000) * 1000 };
+    FD_ZERO(&ws);
+    FD_ZERO(&es);
+    for (int i = 0; i < n; i++) {
+        FD_SET(socks[i], &ws);
+        FD_SET(socks[i], &es);
+    }
+    int r = select(0, NULL, &ws, &es, &tv);
+    for (int i = 0; i < n; i++)
+        done[i] = r > 0 && (FD_ISSET(socks[i], &ws) || FD_ISSET(socks[i], &es));
+    return r;
+#else
+    struct pollfd pfd[NTRIP_CONNECT_MAX_ADDRS];
+    for (int i = 0; i < n; i++) {
+        pfd[i].fd      = socks[i];
+        pfd[i].events  = POLLOUT;
+        pfd[i].revents = 0;
+    }
+    int r = poll(pfd, (nfds_t)n, ms);
+    for (int i = 0; i < n; i++)
+        done[i] = r > 0 && pfd[i].revents != 0;
+    return r;
+#endif
+}
+
+NtripSocket ntrip_connect_race(const NtripAddr *addrs, int n, int first,
+                               int timeout_ms, int *winner)
+{
+    if (n <= 0) return NTRIP_INVALID_SOCKET;
+    if (n > NTRIP_CONNECT_MAX_ADDRS) n = NTRIP_CONNECT_MAX_ADDRS;
+    if (first < 0 || first >= n) first = 0;
+    if (timeout_ms <= 0) timeout_ms = NTRIP_CONNECT_TIMEOUT_MS;
+
+    NtripSocket pending[NTRIP_CONNECT_MAX_ADDRS];
+    int         which[NTRIP_CONNECT_MAX_ADDRS];
+    int         np = 0, started = 0;
+    double      deadline = conn_now() + timeout_ms / 1000.0;
+    double      next_start = 0.0;
+    NtripSocket won = NTRIP_INVALID_SOCKET;
+
+    for (;;) {
+        double now = conn_now();
+        if (now >= deadline) break;
+        /* Start the next attempt when its turn comes, or at once if
+         * nothing is in flight */
+        while (started < n && (np == 0 || now >= next_start)) {
+            int i = (first + started++) % n;
+            NtripSocket s = ntrip_connect_start(&addrs[i]);
+            if (s == NTRIP_INVALID_SOCKET) continue;
+            pending[np] = s;
+            which[np++] = i;
+            next_start  = now + NTRIP_CONNECT_ATTEMPT_DELAY_MS / 1000.0;
+            break;
+        }
+        if (np == 0) break;
+
+        double until = started < n && next_start < deadline ? next_start : deadline;
+        int wait_ms = (int)((until - now) * 1000.0) + 1;
+        bool done[NTRIP_CONNECT_MAX_ADDRS];
+        if (conn_wait(pending, np, wait_ms, done) <= 0) continue;
+
+        for (int k = 0; k < np && won == NTRIP_INVALID_SOCKET; k++) {
+            if (!done[k]) continue;
+            if (ntrip_connect_result(pending[k])) {
+                won = pending[k];
+                if (winner) *winner = which[k];
+                pending[k] = NTRIP_INVALID_SOCKET;
+            } else {
+                /* Failed: the next address need not wait its turn */
+                CONN_CLOSE(pending[k]);
+                pending[k] = NTRIP_INVALID_SOCKET;
+                next_start = 0.0;
+            }
+        }
+        int m = 0;
+        for (int k = 0; k < np; k++) {
+            if (pending[k] == NTRIP_INVALID_SOCKET) continue;
+            pending[m] = pending[k];
+            which[m++] = which[k];
+        }
+        np = m;
+        if (won != NTRIP_INVALID_SOCKET) break;
+        if (np == 0 && started >= n) break;
+    }
+
+    for (int k = 0; k < np; k++) CONN_CLOSE(pending[k]);
+    if (won != NTRIP_INVALID_SOCKET) ntrip_socket_set_blocking(won, true);
+    return won;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file ntrip_connect.h
+ * @brief Shared caster connection helper: cached DNS, IPv4 + IPv6, and
+ *        connect attempts that race each other and give up in time.
+ *
+ * Every connection path in the analyser goes through here:
+ *
+ *   - ntrip_dns_lookup() answers from a process-wide cache.  A name is
+ *     looked up (for both address families) at most once per
+ *     NTRIP_DNS_TTL_S; a failed lookup is remembered for
+ *     NTRIP_DNS_NEGATIVE_TTL_S, and while the resolver is down the last
+ *     good answer is used instead.  ntrip_dns_prefetch() fills the cache
+ *     for many names at once on a few threads, so a `--mounts-file` run with
+ *     hundreds of casters does not wait for the lookups one by one.
+ *   - The addresses come back in RFC 8305 order: the resolver's own
+ *     preference first, then the families interleaved (v6, v4, v6, ...).
+ *   - ntrip_connect_race() is the blocking "happy eyeballs" connect: the
+ *     first attempt starts at once, the next one after
+ *     NTRIP_CONNECT_ATTEMPT_DELAY_MS or as soon as an attempt fails, and
+ *     the first socket to connect wins.  A caster whose IPv6 route is a
+ *     black hole therefore costs 250 ms instead of a SYN timeout.
+ *   - ntrip_connect_start() / ntrip_connect_result() are the non-blocking
+ *     halves for the event-loop engine (ntrip_multi.c), which watches the
+ *     socket itself and moves on to the next address when one fails.
+ *
+ * The getaddrinfo() API has no TTLs, hence the fixed cache lifetime.
+ * Winsock must already be initialised on Windows.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef NTRIP_CONNECT_H
+#define NTRIP_CONNECT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NtripSocket;
+#define NTRIP_INVALID_SOCKET  INVALID_SOCKET
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+typedef int NtripSocket;
+#define NTRIP_INVALID_SOCKET  (-1)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Addresses kept per name (after removing duplicates). */
+#define NTRIP_CONNECT_MAX_ADDRS         8
+
+/** @brief Lifetime of a cached DNS answer (s). */
+#define NTRIP_DNS_TTL_S                 300
+
+/** @brief Lifetime of a cached lookup failure (s). */
+#define NTRIP_DNS_NEGATIVE_TTL_S        30
+
+/** @brief Names the DNS cache holds; the least recently used one goes first. */
+#define NTRIP_DNS_CACHE_SLOTS           128
+
+/** @brief RFC 8305 "Connection Attempt Delay" between staggered attempts (ms). */
+#define NTRIP_CONNECT_ATTEMPT_DELAY_MS  250
+
+/** @brief Overall time limit of ntrip_connect_race() when none is given (ms). */
+#define NTRIP_CONNECT_TIMEOUT_MS        10000
+
+/** @brief One resolved socket address (IPv4 or IPv6) including the port. */
+typedef struct {
+    struct sockaddr_storage sa;
+    int len;
+} NtripAddr;
+
+/**
+ * @brief Addresses of @p host with @p port filled in, in connect order.
+ *
+ * Thread-safe.  IP literals are accepted as well.
+ *
+ * @param fresh  Bypass the cache (the caller found every cached address
+ *               dead); the answer still replaces the cached one.
+ * @return Number of addresses written to @p out (at most @p max); 0 if
+ *         the name does not resolve and nothing is cached for it.
+ */
+int ntrip_dns_lookup(const char *host, int port, NtripAddr *out, int max, bool fresh);
+
+/**
+ * @brief Resolve @p n names into the cache, @p jobs lookups at a time.
+ *
+ * Names already cached and duplicates in @p hosts are cheap.  Returns
+ * when every lookup has finished.
+ */
+void ntrip_dns_prefetch(const char *const *hosts, int n, int jobs);
+
+/** @brief "192.0.2.1:2101" or "[2001:db8::1]:2101". */
+const char *ntrip_addr_str(const NtripAddr *a, char *buf, size_t len);
+
+/**
+ * @brief Connect to the first of @p addrs that answers.
+ *
+ * Attempts start at @p first and wrap around; they are staggered by
+ * NTRIP_CONNECT_ATTEMPT_DELAY_MS and run concurrently, and the losers are
+ * closed as soon as one connects.
+ *
+ * @param timeout_ms  Limit for the whole race; <= 0 = NTRIP_CONNECT_TIMEOUT_MS.
+ * @param winner      Receives the index of the address that connected; may be NULL.
+ * @return A connected, blocking socket, or NTRIP_INVALID_SOCKET.
+ */
+NtripSocket ntrip_connect_race(const NtripAddr *addrs, int n, int first,
+                               int timeout_ms, int *winner);
+
+/**
+ * @brief Start a non-blocking connect to @p a.
+ *
+ * Wait for the socket to become writable (or report an error), then call
+ * ntrip_connect_result().  The socket stays non-blocking.
+ *
+ * @return The socket, or NTRIP_INVALID_SOCKET if the attempt failed at once.
+ */
+NtripSocket ntrip_connect_start(const NtripAddr *a);
+
+/** @brief true if the connect started by ntrip_connect_start() succeeded. */
+bool ntrip_connect_result(NtripSocket sock);
+
+/** @brief Switch @p sock between blocking and non-blocking mode. */
+void ntrip_socket_set_blocking(NtripSocket sock, bool blocking);
+
+/**
+ * @brief Wait up to @p timeout_ms for @p sock to become readable (or
+ *        writable with @p want_write).
+ * @return > 0 when ready, 0 on timeout, < 0 on error or EINTR.
+ */
+int ntrip_socket_wait(NtripSocket sock, bool want_write, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_CONNECT_H */
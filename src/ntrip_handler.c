@@ -1,6 +1,19 @@
 #include "ntrip_handler.h"
 #include "nmea_parser.h"
 #include "rtcm3x_parser.h"
+#include "rtcm_framer.h"
+#include "stream_clock.h"
+#include "rtcm_recorder.h"
+#include "rinex_obs.h"
+#include "obs_columns.h"
+#include "sourcetable_cache.h"
+#include "ntrip_session.h"
+#include "perf_probe.h"
+#include "bw_meter.h"
+#include "corr_age.h"
+#include "obs_quality.h"
+#include "quantile_sketch.h"
+#include "live_view.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,9 +28,11 @@
 #else
     #include <netdb.h>
     #include <sys/socket.h>
+    #include <sys/select.h>
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <errno.h>
+    #include <fcntl.h>
     #define CLOSESOCKET close
     #define SOCKET_TYPE int
     #define SOCK_ERR(val) ((val) < 0)
@@ -73,8 +88,75 @@ typedef struct {
     double sum_dt;
     double last_time;
     bool seen;
+    bool resumed;    /* first frame after a reconnect: no interval */
+    QSketch dt;      /* interval distribution (p50 .. p99.9) */
+    BwMeter bw;      /* bytes and frames over 1 s / 10 s / 60 s, burst share */
 } MsgStats;
 
+/**
+ * @brief Receive one chunk from an NTRIP stream into a framer.
+ *
+ * recv() writes straight into the framer ring; the session's reply
+ * decoder then drops the HTTP header and, for an NTRIP 2.0 chunked
+ * reply, the chunk framing in place (ntrip_http.h), and only the RTCM
+ * bytes are committed.  Complete frames are delivered to the framer
+ * callbacks before return.
+ *
+ * @param session  Connected stream (plain TCP or TLS).
+ * @param framer   Framer receiving the RTCM bytes.
+ * @param perf     Stage probes of the stream (stamped before the framer
+ *                 runs), or NULL.
+ * @return recv() result (bytes received, 0 on close, < 0 on error).
+ */
+static int ntrip_recv_framed(NtripSession *session, RtcmFramer *framer, PerfStream *perf)
+{
+    size_t avail;
+    unsigned char *dst = rtcm_framer_write_ptr(framer, &avail);
+    int received = ntrip_session_recv(session, dst, (int)avail);
+    if (received > 0) {
+        if (perf) perf_recv(perf);
+        rtcm_framer_commit(framer, ntrip_http_decode(&session->http, dst, (size_t)received));
+        stream_format_log(rtcm_framer_new_format(framer), NULL);
+    }
+    return received;
+}
+
+/**
+ * @brief Wait until @p sock has data (or EOF / an error) to report.
+ *
+ * @param sock        Connected stream socket.
+ * @param timeout_ms  Longest time to wait; 0 just polls.
+ * @return 1 if recv() will not block, 0 on timeout or EINTR,
+ *         -1 if select() itself failed.
+ */
+static int ntrip_wait_readable(SOCKET_TYPE sock, int timeout_ms)
+{
+    fd_set rs;
+    struct timeval tv;
+
+    FD_ZERO(&rs);
+    FD_SET(sock, &rs);
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int r = select((int)sock + 1, &rs, NULL, NULL, &tv);
+    if (r > 0) return 1;
+    if (r == 0) return 0;
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEINTR ? 0 : -1;
+#else
+    return errno == EINTR ? 0 : -1;
+#endif
+}
+
+unsigned ntrip_config_session_flags(const NTRIP_Config *config, bool eph)
+{
+    int tls  = eph ? config->EPH_TLS  : config->TLS;
+    int port = eph ? config->EPH_PORT : config->NTRIP_PORT;
+    if (tls < 0 || (tls == 0 && port != 443)) return 0;
+    return NTRIP_SESSION_TLS | (config->TLS_INSECURE ? NTRIP_SESSION_TLS_NOVERIFY : 0);
+}
+
 void base64_encode(const char *input, char *output) {
     const char *base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     unsigned char in[3];
@@ -97,229 +179,385 @@ void base64_encode(const char *input, char *output) {
     output[output_index] = '\0';
 }
 
-char* receive_mount_table(const NTRIP_Config *config) {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
-        return NULL;
+/* Reply of a sourcetable request.  The buffer doubles when it fills, so
+ * a large table costs a handful of reallocations rather than one per
+ * recv(); complete lines go to the caller's callback as they arrive. */
+typedef struct {
+    char            *data;
+    size_t           len, cap;
+    size_t           line_start;     /* first byte not yet passed on */
+    bool             status_seen;    /* first line checked */
+    bool             not_modified;   /* "304": the cached copy is current */
+    bool             done;           /* ENDSOURCETABLE seen */
+    MountTableLineFn on_line;
+    void            *user;
+} MountReply;
+
+static bool mount_reply_append(MountReply *r, const char *p, size_t n)
+{
+    if (r->len + n + 1 > r->cap) {
+        size_t cap = r->cap ? r->cap : 64 * 1024;
+        while (r->len + n + 1 > cap) cap *= 2;
+        char *nd = realloc(r->data, cap);
+        if (!nd) return false;
+        r->data = nd;
+        r->cap  = cap;
     }
-#endif
+    memcpy(r->data + r->len, p, n);
+    r->len += n;
+    r->data[r->len] = '\0';
+    return true;
+}
 
-    if (!config) {
-        fprintf(stderr, "[ERROR] Config pointer is NULL.\n");
-        return NULL; // -1
+/* Pass each complete line (with its line end) to on_line; with
+ * @p flush, also the unterminated tail. */
+static void mount_reply_lines(MountReply *r, bool flush)
+{
+    while (r->line_start < r->len) {
+        const char *line = r->data + r->line_start;
+        const char *nl = memchr(line, '\n', r->len - r->line_start);
+        size_t n = nl ? (size_t)(nl - line) + 1 : r->len - r->line_start;
+        if (!nl && !flush) {
+            if (n >= 14 && strncmp(line, "ENDSOURCETABLE", 14) == 0) r->done = true;
+            break;
+        }
+        if (!r->status_seen) {
+            r->status_seen  = true;
+            r->not_modified = strncmp(line, "HTTP/", 5) == 0 &&
+                              strstr(line, " 304") && strstr(line, " 304") < line + n;
+        }
+        if (strncmp(line, "ENDSOURCETABLE", 14) == 0) r->done = true;
+        if (r->on_line && !r->not_modified) r->on_line(line, n, r->user);
+        r->line_start += n;
     }
+}
 
+/* Connect, send the request and collect the reply into @p r, within
+ * SOURCETABLE_TIMEOUT if set. */
+static bool mount_table_request(const NTRIP_Config *config, const char *if_modified_since,
+                                MountReply *r)
+{
     SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
+    NtripAddr addrs[NTRIP_CONNECT_MAX_ADDRS];
     char request[1024];
     char buffer[BUFFER_SIZE];
-    char *mount_table = NULL;
-    size_t mount_table_size = 0;
-
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
 
-    int gai_ret = getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result);
-    if (gai_ret != 0) {
-#ifdef _WIN32
-        fprintf(stderr, "DNS lookup failed: %d\n", WSAGetLastError());
-        WSACleanup();
-#else
-        fprintf(stderr, "DNS lookup failed: %s\n", gai_strerror(errno));
-#endif
-        return NULL; // -2
+    int n_addrs = ntrip_dns_lookup(config->NTRIP_CASTER, config->NTRIP_PORT,
+                                   addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+    if (n_addrs == 0) {
+        fprintf(stderr, "DNS lookup failed for %s\n", config->NTRIP_CASTER);
+        return false; // -2
     }
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-#ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", WSAGetLastError());
-        freeaddrinfo(result);
-        WSACleanup();
-        return NULL; // -3
-    }
-#else
-    if (sock < 0) {
-        perror("Socket creation failed");
-        freeaddrinfo(result);
-        return NULL; // -3
+    double deadline = config->SOURCETABLE_TIMEOUT > 0
+                    ? get_time_seconds() + config->SOURCETABLE_TIMEOUT : 0.0;
+    sock = ntrip_connect_race(addrs, n_addrs, 0, config->SOURCETABLE_TIMEOUT * 1000, NULL);
+    if (sock == NTRIP_INVALID_SOCKET) {
+        fprintf(stderr, "Connection failed\n");
+        return false; // -4
     }
-#endif
-
-    server.sin_family = AF_INET;
-    server.sin_port = htons(config->NTRIP_PORT);
-    server.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
-
-    freeaddrinfo(result);
 
-    if (SOCK_CONN_ERR(connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)))) {
-        fprintf(stderr, "Connection failed\n");
-        CLOSESOCKET(sock);
-#ifdef _WIN32
-        WSACleanup();
-#endif
-        return NULL; // -4
+    NtripTls *tls = NULL;
+    unsigned flags = ntrip_config_session_flags(config, false);
+    if (flags & NTRIP_SESSION_TLS) {
+        tls = ntrip_tls_new(sock, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            !(flags & NTRIP_SESSION_TLS_NOVERIFY));
+        int left_ms = deadline > 0.0 ? (int)((deadline - get_time_seconds()) * 1000.0)
+                                     : NTRIP_SESSION_CONNECT_MS;
+        if (!tls || !ntrip_tls_handshake(tls, left_ms > 0 ? left_ms : 1)) {
+            fprintf(stderr, "[ERROR] TLS handshake with %s:%d failed: %s\n",
+                    config->NTRIP_CASTER, config->NTRIP_PORT,
+                    tls ? ntrip_tls_error(tls) : "this build has no TLS support");
+            ntrip_tls_free(tls);
+            CLOSESOCKET(sock);
+            return false;
+        }
     }
 
+    char conditional[192] = "";
+    if (if_modified_since && if_modified_since[0])
+        snprintf(conditional, sizeof(conditional),
+                 "If-Modified-Since: %s\r\n", if_modified_since);
+
     snprintf(request, sizeof(request),
              "GET / HTTP/1.1\r\n"
              "Host: %s\r\n"
              "User-Agent: NTRIP CClient/1.0\r\n"
              "Authorization: Basic %s\r\n"
+             "%s"
              "\r\n",
-             config->NTRIP_CASTER, config->AUTH_BASIC);
+             config->NTRIP_CASTER, config->AUTH_BASIC, conditional);
 
+    int sent = ntrip_io_send(sock, tls, request, (int)strlen(request));
 #ifdef _WIN32
-    int sent = send(sock, request, strlen(request), 0);
-    if (sent == SOCKET_ERROR) {
+    if (sent < 0) {
         fprintf(stderr, "[ERROR] Failed to send mountpoint list request: %d\n", WSAGetLastError());
+        ntrip_tls_free(tls);
         CLOSESOCKET(sock);
-        WSACleanup();
-        return NULL; // -5
+        return false; // -5
     }
 #else
-    ssize_t sent = send(sock, request, strlen(request), 0);
     if (sent < 0) {
         perror("[ERROR] Failed to send mountpoint list request");
+        ntrip_tls_free(tls);
         CLOSESOCKET(sock);
-        return NULL; // -5
+        return false; // -5
     }
 #endif
 
     int received;
-    while (
-#ifdef _WIN32
-        (received = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0
-#else
-        (received = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0
-#endif
-    ) {
-        buffer[received] = '\0';
-        size_t old_size = mount_table_size;
-        mount_table_size += received;
-        char *new_table = realloc(mount_table, mount_table_size + 1);
-        if (!new_table) {
-            free(mount_table);
+    for (;;) {
+        if (deadline > 0.0) {
+            int left_ms = (int)((deadline - get_time_seconds()) * 1000.0);
+            if (left_ms <= 0) {
+                fprintf(stderr, "[ERROR] Sourcetable from %s timed out after %d s\n",
+                        config->NTRIP_CASTER, config->SOURCETABLE_TIMEOUT);
+                ntrip_tls_free(tls);
+                CLOSESOCKET(sock);
+                return false;
+            }
+            int w = ntrip_tls_pending(tls) > 0 ? 1 : ntrip_wait_readable(sock, left_ms);
+            if (w == 0) continue;          /* EINTR, or the deadline above */
+            if (w < 0) break;
+        }
+        received = ntrip_io_recv(sock, tls, buffer, (int)sizeof(buffer));
+        if (received <= 0) break;
+        if (!mount_reply_append(r, buffer, (size_t)received)) {
             fprintf(stderr, "[ERROR] Memory allocation failed for mount table.\n");
+            ntrip_tls_free(tls);
             CLOSESOCKET(sock);
-#ifdef _WIN32
-            WSACleanup();
-#endif
-            return NULL; // -6
+            return false; // -6
         }
-        mount_table = new_table;
-        memcpy(mount_table + old_size, buffer, received + 1);
-        if (strstr(buffer, "ENDSOURCETABLE")) {
+        mount_reply_lines(r, false);
+        if (r->done || (r->status_seen && r->not_modified &&
+                        strstr(r->data, "\r\n\r\n"))) {
             break;
         }
     }
-    if (mount_table)
-        mount_table[mount_table_size] = '\0';
+    mount_reply_lines(r, true);
 
+    ntrip_tls_free(tls);
     CLOSESOCKET(sock);
-#ifdef _WIN32
-    WSACleanup();
-#endif
-    return mount_table; // 0 (success)
+    return r->data != NULL; // 0 (success)
 }
 
-void start_ntrip_stream(const NTRIP_Config *config) {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
-        return; //-1;
+/* Hand a cached reply to on_line, line by line. */
+static void mount_table_replay(const char *data, MountTableLineFn on_line, void *user)
+{
+    if (!on_line) return;
+    for (const char *p = data; *p; ) {
+        const char *nl = strchr(p, '\n');
+        size_t n = nl ? (size_t)(nl - p) + 1 : strlen(p);
+        on_line(p, n, user);
+        p += n;
     }
-#endif
+}
 
+char* receive_mount_table_ex(const NTRIP_Config *config, MountTableLineFn on_line,
+                             void *user, MountTableInfo *info) {
+    if (info) {
+        info->source = MOUNT_TABLE_NETWORK;
+        info->age_s  = 0;
+    }
     if (!config) {
         fprintf(stderr, "[ERROR] Config pointer is NULL.\n");
-        return; //-1;
+        return NULL; // -1
     }
 
-    SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
-    char request[1024];
-    char buffer[BUFFER_SIZE];
-
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
+    /* A copy younger than SOURCETABLE_TTL is used as is */
+    char cache_path[640];
+    bool use_cache = config->SOURCETABLE_TTL > 0 &&
+                     sourcetable_cache_path(config->NTRIP_CASTER, config->NTRIP_PORT,
+                                            config->USERNAME, cache_path, sizeof(cache_path));
+    long age_s = 0;
+    char *cached = use_cache ? sourcetable_cache_load(cache_path, NULL, &age_s) : NULL;
+    if (cached && age_s < config->SOURCETABLE_TTL) {
+        mount_table_replay(cached, on_line, user);
+        if (info) {
+            info->source = MOUNT_TABLE_CACHED;
+            info->age_s  = age_s;
+        }
+        return cached;
+    }
 
-    int gai_ret = getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result);
-    if (gai_ret != 0) {
 #ifdef _WIN32
-        fprintf(stderr, "DNS lookup failed: %d\n", WSAGetLastError());
-        WSACleanup();
-#else
-        fprintf(stderr, "DNS lookup failed: %s\n", gai_strerror(errno));
-#endif
-        return; //-2;
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
+        free(cached);
+        return NULL;
     }
+#endif
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    /* Older: ask the caster whether it changed since */
+    char validator[128] = "";
+    if (cached) sourcetable_cache_validator(cached, validator, sizeof(validator));
+
+    MountReply reply = { 0 };
+    reply.on_line = on_line;
+    reply.user    = user;
+    bool ok = mount_table_request(config, validator, &reply);
 #ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", WSAGetLastError());
-        freeaddrinfo(result);
-        WSACleanup();
-        return; //-3;
+    WSACleanup();
+#endif
+
+    if (cached && (!ok || reply.not_modified)) {
+        /* Unchanged, or the caster cannot be reached: the cached copy
+         * is the best there is. */
+        if (ok) {
+            sourcetable_cache_touch(cache_path);
+            age_s = 0;
+        }
+        free(reply.data);
+        mount_table_replay(cached, on_line, user);
+        if (info) {
+            info->source = ok ? MOUNT_TABLE_REVALIDATED : MOUNT_TABLE_STALE;
+            info->age_s  = age_s;
+        }
+        return cached;
     }
-#else
-    if (sock < 0) {
-        perror("Socket creation failed");
-        freeaddrinfo(result);
-        return; //-3;
+    free(cached);
+    if (!ok) {
+        free(reply.data);
+        return NULL;
     }
-#endif
 
-    server.sin_family = AF_INET;
-    server.sin_port = htons(config->NTRIP_PORT);
-    server.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
+    /* Keep complete tables only */
+    if (use_cache && reply.done)
+        sourcetable_cache_store(cache_path, reply.data, reply.len);
+    return reply.data;
+}
+
+char* receive_mount_table(const NTRIP_Config *config) {
+    return receive_mount_table_ex(config, NULL, NULL, NULL);
+}
+
+/* --record: capture written alongside the decoding streams. */
+static RtcmRecorder *s_recorder = NULL;
 
-    freeaddrinfo(result);
+/* --rinex-obs: observation file written from the same frames. */
+static RinexObsWriter *s_rinex_obs = NULL;
 
-    if (SOCK_CONN_ERR(connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)))) {
-        fprintf(stderr, "Connection failed\n");
-        CLOSESOCKET(sock);
+/* --export: columnar observation file from the same frames. */
+static ObsColWriter *s_obs_export = NULL;
+
+/* --live: dashboard of -t and -s; NULL prints the per-frame tokens. */
+static LiveView *s_live = NULL;
+
+/* End the dashboard (its last frame stays) before the run prints. */
+static void live_end(void)
+{
+    live_view_stop(s_live);
+    s_live = NULL;
+}
+
+/* The header of a --live snapshot; the caller fills in its own rows. */
+static void live_fill_common(LiveStats *ls, const NTRIP_Config *config, const char *mode,
+                             const RtcmFramer *framer, const NtripSession *session,
+                             double t_start, int analysis_time)
+{
+    snprintf(ls->source, sizeof(ls->source), "%.96s:%d/%.48s",
+             config->NTRIP_CASTER, config->NTRIP_PORT, config->MOUNTPOINT);
+    ls->mode          = mode;
+    ls->format        = (int)framer->format;
+    ls->elapsed_s     = get_time_seconds() - t_start;
+    ls->duration_s    = analysis_time;
+    ls->frames        = framer->frames;
+    ls->crc_errors    = framer->crc_errors;
+    ls->skipped_bytes = framer->skipped_bytes;
+    ls->resyncs       = framer->resyncs;
+    ls->reconnects    = session->reconnects;
+    ls->age_p50_ms    = -1.0;
+    ls->age_p99_ms    = -1.0;
+}
+
+/* Stop check for the fixed-length runs: stop reconnecting once the
+ * analysis time is over. */
+typedef struct {
+    time_t start;
+    int    seconds;
+} RunDeadline;
+
+static int run_deadline_passed(void *user)
+{
+    const RunDeadline *d = (const RunDeadline *)user;
+    return difftime(time(NULL), d->start) >= d->seconds;
+}
+
+static const char *recv_end_reason(int received)
+{
+    return received == 0 ? "caster closed the connection" : "receive error";
+}
+
+/* Reconnect and restart the framer; whatever the caller has collected so
+ * far is left alone. */
+static bool stream_resume(NtripSession *session, const char *why,
+                          NtripSessionStopFn should_stop, void *user,
+                          RtcmFramer *framer)
+{
+    if (!ntrip_session_resume(session, why, should_stop, user)) return false;
+    rtcm_framer_reset(framer);
+    return true;
+}
+
+void ntrip_set_live_view(LiveView *v)
+{
+    s_live = v;
+}
+
+void ntrip_set_recorder(RtcmRecorder *r)
+{
+    s_recorder = r;
+}
+
+void ntrip_set_rinex_obs(RinexObsWriter *w)
+{
+    s_rinex_obs = w;
+}
+
+void ntrip_set_obs_export(ObsColWriter *w)
+{
+    s_obs_export = w;
+}
+
+void ntrip_record_frame(const unsigned char *frame, int frame_len)
+{
+    if (s_recorder)  rtcm_recorder_push(s_recorder, frame, frame_len);
+    if (s_rinex_obs) rinex_obs_add_frame(s_rinex_obs, frame, frame_len);
+    if (s_obs_export) obs_col_writer_add_frame(s_obs_export, frame, frame_len);
+}
+
+/* start_ntrip_stream(): decode and print every frame. */
+static void stream_decode_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    ntrip_record_frame(frame, frame_len);
+    analyze_rtcm_message(frame, frame_len, false, (const NTRIP_Config *)user);
+}
+
+void start_ntrip_stream(const NTRIP_Config *config) {
 #ifdef _WIN32
-        WSACleanup();
-#endif
-        return; //-4
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
+        return; //-1;
     }
+#endif
 
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->MOUNTPOINT, config->NTRIP_CASTER, config->AUTH_BASIC);
+    if (!config) {
+        fprintf(stderr, "[ERROR] Config pointer is NULL.\n");
+        return; //-1;
+    }
 
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            config->MOUNTPOINT, config->AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 0, "[NTRIP]",
+                            ntrip_config_session_flags(config, false))) {
 #ifdef _WIN32
-    int sent = send(sock, request, strlen(request), 0);
-    if (sent == SOCKET_ERROR) {
-        fprintf(stderr, "[ERROR] Failed to send NTRIP stream request: %d\n", WSAGetLastError());
-        CLOSESOCKET(sock);
         WSACleanup();
-        return; // -5;
-    }
-#else
-    ssize_t sent = send(sock, request, strlen(request), 0);
-    if (sent < 0) {
-        perror("[ERROR] Failed to send NTRIP stream request");
-        CLOSESOCKET(sock);
-        return; //-5
-    }
 #endif
+        return; //-4
+    }
 
     // --- GGA sending logic ---
     char gga[100];
@@ -329,99 +567,72 @@ void start_ntrip_stream(const NTRIP_Config *config) {
     time_t last_gga_time = time(NULL);
 
     int received;
-    char *ptr;
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, stream_decode_frame, (void *)config);
 
     // --- Timing logic: run for a fixed period like -t mode ---
     int analysis_time = 60; // Default to 60 seconds, or make this configurable
     time_t start_time = time(NULL);
+    RunDeadline deadline = { start_time, analysis_time };
 
     printf("[INFO] Decoding all messages for %d seconds...\n", analysis_time);
 
     while (difftime(time(NULL), start_time) < analysis_time) {
-#ifdef _WIN32
-        received = recv(sock, buffer, sizeof(buffer), 0);
-#else
-        received = recv(sock, buffer, sizeof(buffer), 0);
-#endif
-        if (received <= 0) break;
+        received = ntrip_recv_framed(&session, &framer, NULL);
+        if (received <= 0) {
+            if (!stream_resume(&session, recv_end_reason(received), run_deadline_passed,
+                               &deadline, &framer))
+                break;
+            last_gga_time = 0;
+            continue;
+        }
 
         // Send GGA every 1 second during reception
         time_t now = time(NULL);
         if (now - last_gga_time >= 1) {
-#ifdef _WIN32
-            sent = send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
-            if (sent == SOCKET_ERROR) {
-                fprintf(stderr, "[ERROR] Failed to send GGA sentence: %d\n", WSAGetLastError());
-                CLOSESOCKET(sock);
-                WSACleanup();
-                return;
-            }
-#else
-            sent = send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
-            if (sent < 0) {
-                perror("[ERROR] Failed to send GGA sentence");
-                CLOSESOCKET(sock);
-                return;
-            }
-#endif
+            ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf));
             last_gga_time = now;
         }
-
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
-        }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received && (unsigned char)buffer[buf_pos] != 0xD3) {
-                    buf_pos++;
-                }
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE) to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int full_frame = msg_length + 6;
-                if (msg_buffer_len < full_frame) break;
-
-                // Only decode and print, do not collect stats or print table
-                analyze_rtcm_message(msg_buffer, full_frame, false, config);
-
-                memmove(msg_buffer, msg_buffer + full_frame, msg_buffer_len - full_frame);
-                msg_buffer_len -= full_frame;
-            }
-        }
     }
 
-    CLOSESOCKET(sock);
+    ntrip_session_close(&session);
+    ntrip_session_print_gaps(&session, stdout);
 #ifdef _WIN32
     WSACleanup();
 #endif
 }
 
-void start_ntrip_stream_with_filter(const NTRIP_Config *config, const int *filter_list, int filter_count, bool debug) {
+typedef struct {
+    const NTRIP_Config *config;
+    RtcmFilter         *filter;
+    PerfStream         *perf;
+} FilterFrameCtx;
+
+/* start_ntrip_stream_with_filter(): decode frames the filter accepts and
+ * print only the message number of all others.  The framer has checked
+ * the CRC, so the filter runs on the header bytes before anything is
+ * decoded. */
+static void filter_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    const FilterFrameCtx *ctx = (const FilterFrameCtx *)user;
+    PerfFrame pf;
+    perf_frame_begin(ctx->perf, &pf);
+    ntrip_record_frame(frame, frame_len);
+    perf_frame_stage(ctx->perf, &pf, PERF_STAGE_OUTPUT);
+
+    int msg_type = rtcm_filter_frame_type(frame, frame_len);
+    if (rtcm_filter_accept(ctx->filter, msg_type)) {
+        /* Decoding and printing are one step here */
+        analyze_rtcm_message(frame, frame_len, false, ctx->config);
+    } else {
+        printf("%d ", msg_type); // Print message number in sequence
+        fflush(stdout);
+    }
+    perf_frame_stage(ctx->perf, &pf, PERF_STAGE_DECODE);
+    perf_frame_end(ctx->perf, &pf);
+}
+
+void start_ntrip_stream_with_filter(const NTRIP_Config *config, RtcmFilter *filter, bool debug) {
 #ifdef _WIN32
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -435,100 +646,22 @@ void start_ntrip_stream_with_filter(const NTRIP_Config *config, const int *filte
         return;
     }
 
-    SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
-    char request[1024];
-    char buffer[BUFFER_SIZE];
-
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    int gai_ret = getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result);
-    if (gai_ret != 0) {
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            config->MOUNTPOINT, config->AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 0, "[NTRIP]",
+                            ntrip_config_session_flags(config, false))) {
 #ifdef _WIN32
-        fprintf(stderr, "DNS lookup failed: %d\n", WSAGetLastError());
         WSACleanup();
-#else
-        fprintf(stderr, "DNS lookup failed: %s\n", gai_strerror(errno));
 #endif
         return;
     }
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-#ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", WSAGetLastError());
-        freeaddrinfo(result);
-        WSACleanup();
-        return;
-    }
-#else
-    if (sock < 0) {
-        perror("Socket creation failed");
-        freeaddrinfo(result);
-        return;
-    }
-#endif
-
-    server.sin_family = AF_INET;
-    server.sin_port = htons(config->NTRIP_PORT);
-    server.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
-
-    freeaddrinfo(result);
-
-    if (SOCK_CONN_ERR(connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)))) {
-        fprintf(stderr, "Connection failed\n");
-        CLOSESOCKET(sock);
-#ifdef _WIN32
-        WSACleanup();
-#endif
-        return;
-    }
-
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->MOUNTPOINT, config->NTRIP_CASTER, config->AUTH_BASIC);
-
-#ifdef _WIN32
-    int sent = send(sock, request, strlen(request), 0);
-    if (sent == SOCKET_ERROR) {
-        fprintf(stderr, "[ERROR] Failed to send NTRIP stream request: %d\n", WSAGetLastError());
-        CLOSESOCKET(sock);
-        WSACleanup();
-        return;
-    }
-#else
-    ssize_t sent = send(sock, request, strlen(request), 0);
-    if (sent < 0) {
-        perror("[ERROR] Failed to send NTRIP stream request");
-        CLOSESOCKET(sock);
-        return;
-    }
-#endif
-
-    if (sent > 0) {
-        buffer[sent] = '\0';
-        if (debug) {
-            printf("[NTRIP] Server response after login:\n%s\n", buffer);
-        // Print server response as HEX
-        printf("[NTRIP] Server response (HEX):\n");
-        for (int i = 0; i < sent; ++i) {
-            printf("%02X ", (unsigned char)buffer[i]);
-            if ((i + 1) % 16 == 0) printf("\n");
-        }
-        if (sent % 16 != 0) printf("\n");
-        }
-        
-    } else {
-        fprintf(stderr, "[ERROR] No response received from server after login.\n");
+    if (debug) {
+        char where[80];
+        printf("[NTRIP] Connected to %s, requested /%s\n",
+               ntrip_addr_str(&session.addrs[session.cur], where, sizeof(where)),
+               config->MOUNTPOINT);
     }
 
     // Prepare GGA sentence
@@ -537,229 +670,229 @@ void start_ntrip_stream_with_filter(const NTRIP_Config *config, const int *filte
     char gga_with_crlf[104];
     snprintf(gga_with_crlf, sizeof(gga_with_crlf), "%s\r\n", gga);
 
-    time_t last_gga_time = time(NULL);
+    double next_gga_time = get_time_seconds() + 1.0;
 
     int received;
-    char *ptr;
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
-
-    // --- Change: GGA sending is now independent of NTRIP data reception ---
+    PerfStream perf;
+    perf_stream_reset(&perf);
+    FilterFrameCtx ctx = { config, filter, &perf };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, filter_frame, &ctx);
+
+    // Sleep in select() until data arrives or the next GGA is due, so
+    // frames are decoded the moment they arrive and an idle stream only
+    // wakes up once per second.  A lost connection is re-opened; the
+    // loop only ends when reconnecting is disabled.
     while (1) {
         // Check if it's time to send GGA
-        time_t now = time(NULL);
-        if (now - last_gga_time >= 1) {
-            int sent = send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
-#ifdef _WIN32
-            if (sent == SOCKET_ERROR) {
-                fprintf(stderr, "[ERROR] Failed to send GGA sentence: %d\n", WSAGetLastError());
-                CLOSESOCKET(sock);
-                WSACleanup();
-                return;
-            } else {
-                printf("GGA ");
-            }
-#else
-            if (sent < 0) {
-                perror("[ERROR] Failed to send GGA sentence");
-                CLOSESOCKET(sock);
-                return;
-            } else {
-                printf("GGA ");
+        double now = get_time_seconds();
+        if (now >= next_gga_time) {
+            int sent = ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf));
+            if (SOCK_CONN_ERR(sent)) {
+                if (!stream_resume(&session, "GGA send failed", NULL, NULL,
+                                   &framer))
+                    break;
+                next_gga_time = get_time_seconds();
+                continue;
             }
-#endif
-            last_gga_time = now;
+            printf("GGA ");
+            fflush(stdout);
+            // Keep a 1 s cadence; after a stall, restart it from now
+            // instead of sending a burst of catch-up sentences.
+            next_gga_time += 1.0;
+            if (next_gga_time <= now) next_gga_time = now + 1.0;
         }
 
-        // Use non-blocking or timeout recv to avoid blocking forever
-#ifdef _WIN32
-        received = recv(sock, buffer, sizeof(buffer), 0);
-#else
-        received = recv(sock, buffer, sizeof(buffer), MSG_DONTWAIT);
-#endif
-        if (received < 0) {
+        int wait_ms = (int)((next_gga_time - now) * 1000.0) + 1;
+        int ready = ntrip_session_pending(&session) ? 1
+                  : ntrip_wait_readable(session.sock, wait_ms);
+        if (ready == 0) continue;   // GGA due (or EINTR)
+
+        received = ready < 0 ? -1
+                 : ntrip_recv_framed(&session, &framer, ctx.perf);
+        if (received < 0 && ready > 0) {
 #ifdef _WIN32
-            if (WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINTR) {
-                // No data available, just continue loop
-                // Sleep a bit to avoid busy loop
-                Sleep(50);
-                continue;
-            } else {
-                break;
-            }
+            if (WSAGetLastError() == WSAEINTR) continue;
 #else
-            if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                // No data available, just continue loop
-                // Sleep a bit to avoid busy loop
-                usleep(50000);
-                continue;
-            } else {
-                break;
-            }
+            if (errno == EINTR || errno == EAGAIN) continue;
 #endif
-        } else if (received == 0) {
-            // Connection closed
-            break;
-        }
-
-        // ...existing message processing logic...
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
         }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received && (unsigned char)buffer[buf_pos] != 0xD3) {
-                    buf_pos++;
-                }
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE) to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int full_frame = msg_length + 6;
-                if (msg_buffer_len < full_frame) break;
-
-                // Always analyze first to get the message type (no output)
-                int msg_type = analyze_rtcm_message(msg_buffer, full_frame, true, config);
-
-                int in_filter = 0;
-                if (filter_count == 0) {
-                    // No filter: print all messages
-                    analyze_rtcm_message(msg_buffer, full_frame, false, config);
-                } else {
-                    // Only print if in filter_list, else print "."
-                    for (int i = 0; i < filter_count; ++i) {
-                        if (msg_type == filter_list[i]) {
-                            analyze_rtcm_message(msg_buffer, full_frame, false, config);
-                            in_filter = 1;
-                            break;
-                        }
-                    }
-                    if (!in_filter) {
-                        printf("%d ", msg_type); // Print message number in sequence
-                        fflush(stdout);
-                    }
-                }
-
-                memmove(msg_buffer, msg_buffer + full_frame, msg_buffer_len - full_frame);
-                msg_buffer_len -= full_frame;
-            }
+        if (received <= 0) {
+            if (!stream_resume(&session, recv_end_reason(received), NULL, NULL,
+                               &framer))
+                break;
+            next_gga_time = get_time_seconds();
         }
     }
 
-    CLOSESOCKET(sock);
+    ntrip_session_close(&session);
+    ntrip_session_print_gaps(&session, stderr);
+    if (perf_stream_any(&perf)) perf_print_table(&perf, "[NTRIP] Stage latency", stderr);
 #ifdef _WIN32
     WSACleanup();
 #endif
 }
 
-void analyze_message_types(const NTRIP_Config *config, int analysis_time) {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
+typedef struct {
+    const NTRIP_Config *config;
+    MsgStats           *stats;   /* MAX_MSG_TYPES entries */
+    PerfStream         *perf;
+    CorrAge            *age;     /* NULL if it could not be allocated */
+    ObsQuality         *quality; /* likewise */
+    const NtripSession *session; /* receive time of the current read */
+    BwBurst             burst;   /* epoch bursts of the stream */
+    BwMeter             all;     /* every frame, for the total row */
+} MsgTypesFrameCtx;
+
+/* analyze_message_types(): update the inter-arrival statistics. */
+static void msg_types_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    MsgTypesFrameCtx *ctx = (MsgTypesFrameCtx *)user;
+    PerfFrame pf;
+    perf_frame_begin(ctx->perf, &pf);
+
+    ntrip_record_frame(frame, frame_len);
+    perf_frame_stage(ctx->perf, &pf, PERF_STAGE_OUTPUT);
+    stream_clock_feed(frame, frame_len);
+    double now = stream_clock_seconds();
+    bw_burst_frame(&ctx->burst, frame, frame_len, now);
+    bw_meter_add(&ctx->all, now, frame_len, &ctx->burst);
+    if (ctx->age) corr_age_add(ctx->age, frame, frame_len, ctx->session->rx_utc_ns);
+    if (ctx->quality) obs_quality_add_frame(ctx->quality, frame, frame_len);
+    int msg_type = analyze_rtcm_message(frame, frame_len, true, ctx->config);
+    perf_frame_stage(ctx->perf, &pf, PERF_STAGE_DECODE);
+    if (msg_type <= 0 || msg_type >= MAX_MSG_TYPES) {
+        perf_frame_end(ctx->perf, &pf);
         return;
     }
-#endif
 
-    SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
-    char request[1024]; // Increased from 512 to 1024
-    char buffer[BUFFER_SIZE];
+    if (!s_live) {
+        printf("%d ", msg_type); // Print message number in sequence
+        fflush(stdout);
+    }
 
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
+    MsgStats *s = &ctx->stats[msg_type];
+    if (!s->seen) {
+        s->seen = true;
+        s->last_time = now;
+        s->min_dt = s->max_dt = s->sum_dt = 0.0;
+    } else if (s->resumed) {
+        /* The interval across an outage says nothing about the stream */
+        s->resumed = false;
+        s->last_time = now;
+    } else {
+        double dt = now - s->last_time;
+        s->last_time = now;
+        s->sum_dt += dt;
+        s->min_dt = (dt < s->min_dt || s->min_dt == 0.0) ? dt : s->min_dt;
+        s->max_dt = dt > s->max_dt ? dt : s->max_dt;
+        qsketch_add(&s->dt, dt);
+    }
+    s->count++;
+    bw_meter_add(&s->bw, now, frame_len, &ctx->burst);
+    perf_frame_end(ctx->perf, &pf);
+}
 
-    if (getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result) != 0) {
-#ifdef _WIN32
-    fprintf(stderr, "DNS lookup failed: %d\n", WSAGetLastError());
-    WSACleanup();
-#else
-    fprintf(stderr, "DNS lookup failed: %s\n", gai_strerror(errno));
-#endif
-        return;
+/* One row of the bandwidth table; @p elapsed gives the mean rate. */
+static void bw_print_row(const char *label, const BwMeter *m, double now, double elapsed)
+{
+    BwRates r;
+    bw_meter_rates(m, now, &r);
+    printf("| %-11s | %10llu | %8.0f | %8.0f | %8.0f | %8.0f | %10u | %10u |\n",
+           label, (unsigned long long)r.bytes, elapsed > 0.0 ? r.bytes / elapsed : 0.0,
+           r.bytes_s[BW_WIN_1S], r.bytes_s[BW_WIN_10S], r.bytes_s[BW_WIN_60S],
+           (unsigned)r.peak_1s, (unsigned)r.burst_peak);
+}
+
+/* Bytes per message type and the epoch bursts, for sizing a link. */
+static void bw_print_table(const MsgStats *stats, const MsgTypesFrameCtx *ctx, double elapsed)
+{
+    if (!ctx->all.frames) return;
+    double now = stream_clock_seconds();
+    const char *rule = "+-------------+------------+----------+----------+----------+----------+------------+------------+\n";
+    printf("[INFO] Bandwidth per message type (bytes incl. framing; windows end at the last full second):\n");
+    printf("%s", rule);
+    printf("| MessageType |    Bytes   | Avg B/s  | 1 s B/s  | 10 s B/s | 60 s B/s | Peak 1 s B |   Burst B  |\n");
+    printf("%s", rule);
+    for (int i = 1; i < MAX_MSG_TYPES; i++) {
+        if (!stats[i].seen || !stats[i].bw.frames) continue;
+        char label[12];
+        snprintf(label, sizeof(label), "%d", i);
+        bw_print_row(label, &stats[i].bw, now, elapsed);
     }
+    printf("%s", rule);
+    bw_print_row("All", &ctx->all, now, elapsed);
+    printf("%s", rule);
+    const BwBurst *b = &ctx->burst;
+    if (b->seq)
+        printf("[INFO] Epoch bursts (frames within %.0f ms of the first MSM of an epoch): %u, "
+               "mean %.0f B, peak %u B over %.0f ms\n",
+               BW_BURST_WINDOW_S * 1000.0, (unsigned)b->seq, bw_burst_mean(b),
+               (unsigned)b->peak, b->peak_span * 1000.0);
+}
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-#ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", WSAGetLastError());
-        freeaddrinfo(result);
-        WSACleanup();
-        return;
+/* --live: publish the message type rows of analyze_message_types(). */
+static void live_publish_types(const MsgTypesFrameCtx *ctx, const RtcmFramer *framer,
+                               double t_start, int analysis_time)
+{
+    LiveStats ls;
+    memset(&ls, 0, sizeof(ls));
+    live_fill_common(&ls, ctx->config, "message types", framer, ctx->session,
+                     t_start, analysis_time);
+    double now = stream_clock_seconds();
+    BwRates r;
+    bw_meter_rates(&ctx->all, now, &r);
+    ls.bytes   = r.bytes;
+    ls.bytes_s = r.bytes_s[BW_WIN_10S];
+
+    PerfHist all_age;
+    memset(&all_age, 0, sizeof(all_age));
+    for (int i = 1; i < MAX_MSG_TYPES; i++) {
+        const MsgStats *s = &ctx->stats[i];
+        if (!s->seen) continue;
+        const CorrAgeStat *age = ctx->age ? corr_age_stat(ctx->age, i) : NULL;
+        if (age) perf_hist_merge(&all_age, &age->hist);
+        if (ls.n_types == LIVE_TYPE_ROWS) {
+            ls.more_types++;
+            continue;
+        }
+        LiveTypeRow *t = &ls.type[ls.n_types++];
+        bw_meter_rates(&s->bw, now, &r);
+        t->msg_type   = i;
+        t->frames     = (uint64_t)s->count;
+        t->frames_s   = r.frames_s[BW_WIN_10S];
+        t->bytes_s    = r.bytes_s[BW_WIN_10S];
+        t->last_s     = now - s->last_time;
+        t->p50_dt     = s->dt.count ? qsketch_quantile(&s->dt, 0.50) : -1.0;
+        t->max_dt     = s->dt.count ? s->max_dt : -1.0;
+        t->age_p50_ms = age && age->hist.count ? perf_hist_quantile(&age->hist, 0.50) / 1e6 : -1.0;
+        t->age_p99_ms = age && age->hist.count ? perf_hist_quantile(&age->hist, 0.99) / 1e6 : -1.0;
     }
-#else
-    if (sock < 0) {
-        perror("Socket creation failed");
-        freeaddrinfo(result);
-        return;
+    if (all_age.count) {
+        ls.age_p50_ms = perf_hist_quantile(&all_age, 0.50) / 1e6;
+        ls.age_p99_ms = perf_hist_quantile(&all_age, 0.99) / 1e6;
     }
-#endif
-
-    server.sin_family = AF_INET;
-    server.sin_port = htons(config->NTRIP_PORT);
-    server.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
-
-    freeaddrinfo(result);
+    live_view_publish(s_live, &ls);
+}
 
-    if (connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)) == 
-#ifdef _WIN32
-        SOCKET_ERROR
-#else
-        -1
-#endif
-    ) {
+void analyze_message_types(const NTRIP_Config *config, int analysis_time) {
 #ifdef _WIN32
-        fprintf(stderr, "Connection failed: %d\n", WSAGetLastError());
-        closesocket(sock);
-        WSACleanup();
-#else
-        perror("Connection failed");
-        close(sock);
-#endif
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fprintf(stderr, "WSAStartup failed: %d\n", WSAGetLastError());
+        live_end();
         return;
     }
+#endif
 
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->MOUNTPOINT, config->NTRIP_CASTER, config->AUTH_BASIC);
-
-    int sent = send(sock, request, strlen(request), 0);
-    if (sent == SOCKET_ERROR) {
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            config->MOUNTPOINT, config->AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 0, "[INFO]",
+                            ntrip_config_session_flags(config, false))) {
+        live_end();
 #ifdef _WIN32
-        fprintf(stderr, "DNS lookup failed: %d\n", WSAGetLastError());
         WSACleanup();
-#else
-        fprintf(stderr, "DNS lookup failed: %s\n", gai_strerror(errno));
 #endif
         return;
     }
@@ -773,117 +906,104 @@ void analyze_message_types(const NTRIP_Config *config, int analysis_time) {
     time_t last_gga_time = time(NULL);
 
     int received;
-    char *ptr;
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
 
-    MsgStats stats[MAX_MSG_TYPES] = {0};
+    /* With an interval sketch per type the table is ~2.3 MB: not a local */
+    MsgStats *stats = (MsgStats *)calloc(MAX_MSG_TYPES, sizeof(MsgStats));
+    if (!stats) {
+        fprintf(stderr, "[ERROR] Out of memory\n");
+        live_end();
+        ntrip_session_close(&session);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return;
+    }
+    PerfStream perf;
+    perf_stream_reset(&perf);
+    CorrAge *age = (CorrAge *)calloc(1, sizeof(CorrAge));
+    ObsQuality *quality = (ObsQuality *)calloc(1, sizeof(ObsQuality));
+    MsgTypesFrameCtx ctx = { .config = config, .stats = stats, .perf = &perf,
+                             .age = age, .quality = quality, .session = &session };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, msg_types_frame, &ctx);
     time_t start_time = time(NULL);
+    double t_start = get_time_seconds();
+    RunDeadline deadline = { start_time, analysis_time };
 
-    printf("[INFO] Analyzing message types for %d seconds...\n", analysis_time);
+    if (!s_live) printf("[INFO] Analyzing message types for %d seconds...\n", analysis_time);
     
     while (difftime(time(NULL), start_time) < analysis_time) {
 
-        received = recv(sock, buffer, sizeof(buffer), 0);
-        if (received <= 0) break;
+        received = ntrip_recv_framed(&session, &framer, &perf);
+        if (s_live && live_view_due(s_live))
+            live_publish_types(&ctx, &framer, t_start, analysis_time);
+        if (received <= 0) {
+            if (!stream_resume(&session, recv_end_reason(received), run_deadline_passed,
+                               &deadline, &framer))
+                break;
+            for (int i = 1; i < MAX_MSG_TYPES; i++) stats[i].resumed = stats[i].seen;
+            last_gga_time = 0;
+            continue;
+        }
 
         // Send GGA every 1 second during reception
         time_t now = time(NULL);
         if (now - last_gga_time >= 1) {
-            send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
-            printf("GGA ");
+            ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf));
+            if (!s_live) printf("GGA ");
             last_gga_time = now;
         }
-
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
-        }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received && (unsigned char)buffer[buf_pos] != 0xD3) {
-                    buf_pos++;
-                }
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE) to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int full_frame = msg_length + 6;
-                if (msg_buffer_len < full_frame) break;
-
-                double now = get_time_seconds();
-                int msg_type = analyze_rtcm_message(msg_buffer, full_frame, true, config);
-                if (msg_type > 0 && msg_type < MAX_MSG_TYPES) {
-                    printf("%d ", msg_type); // Print message number in sequence
-                    fflush(stdout);
-
-                    MsgStats *s = &stats[msg_type];
-                    if (!s->seen) {
-                        s->seen = true;
-                        s->last_time = now;
-                        s->min_dt = s->max_dt = s->sum_dt = 0.0;
-                    } else {
-                        double dt = now - s->last_time;
-                        s->last_time = now;
-                        s->sum_dt += dt;
-                        s->min_dt = (dt < s->min_dt || s->min_dt == 0.0) ? dt : s->min_dt;
-                        s->max_dt = dt > s->max_dt ? dt : s->max_dt;
-                    }
-                    s->count++;
-                }
-
-                memmove(msg_buffer, msg_buffer + full_frame, msg_buffer_len - full_frame);
-                msg_buffer_len -= full_frame;
-            }
-        }
     }
 
-    CLOSESOCKET(sock);
+    ntrip_session_close(&session);
 #ifdef _WIN32
     WSACleanup();
 #endif
+    if (s_live) {
+        live_publish_types(&ctx, &framer, t_start, analysis_time);
+        live_end();
+    }
 
     // Print statistics as a table
     printf("\n[INFO] Message type analysis complete. Statistics:\n");
-    printf("+-------------+-------+---------------+---------------+---------------+\n");
-    printf("| MessageType | Count |  Min-DT (S)   |  Max-DT (S)   |  Avg-DT (S)   |\n");
-    printf("+-------------+-------+---------------+---------------+---------------+\n");
+    printf("+-------------+-------+---------------+---------------+---------------+---------+---------+---------+---------+\n");
+    printf("| MessageType | Count |  Min-DT (S)   |  Max-DT (S)   |  Avg-DT (S)   | p50 (S) | p95 (S) | p99 (S) | p99.9   |\n");
+    printf("+-------------+-------+---------------+---------------+---------------+---------+---------+---------+---------+\n");
     for (int i = 1; i < MAX_MSG_TYPES; i++) {
         if (stats[i].seen && stats[i].count > 0) {
             double avg_dt = stats[i].count > 0 ? stats[i].sum_dt / stats[i].count : 0.0;
-            printf("| %-11d | %5d | %13.3f | %13.3f | %13.3f |\n",
-                   i, stats[i].count, stats[i].min_dt, stats[i].max_dt, avg_dt);
+            const QSketch *q = &stats[i].dt;
+            printf("| %-11d | %5d | %13.3f | %13.3f | %13.3f | %7.3f | %7.3f | %7.3f | %7.3f |\n",
+                   i, stats[i].count, stats[i].min_dt, stats[i].max_dt, avg_dt,
+                   qsketch_quantile(q, 0.50), qsketch_quantile(q, 0.95),
+                   qsketch_quantile(q, 0.99), qsketch_quantile(q, 0.999));
         }
     }
-    printf("+-------------+-------+---------------+---------------+---------------+\n");
+    printf("+-------------+-------+---------------+---------------+---------------+---------+---------+---------+---------+\n");
+    bw_print_table(stats, &ctx, difftime(time(NULL), start_time));
+    if (framer.format != STREAM_FMT_RTCM3 && framer.format != STREAM_FMT_NONE)
+        printf("[INFO] Stream format: %s\n", stream_format_name(framer.format));
+    printf("[INFO] Framer: %lu frames, %lu CRC errors, %lu bytes skipped in %lu resyncs\n",
+           framer.frames, framer.crc_errors, framer.skipped_bytes, framer.resyncs);
+    if (age && corr_age_any(age))
+        corr_age_print_table(age, "[INFO] Age of corrections (receive - MSM epoch)", stdout);
+    free(age);
+    if (quality) {
+        if (quality->stats.n_rows)
+            obs_quality_print_table(&quality->stats,
+                                    "[INFO] Signal quality per station, GNSS and signal", stdout);
+        obs_quality_free(quality);
+        free(quality);
+    }
+    free(stats);
+    if (perf_stream_any(&perf)) perf_print_table(&perf, "[INFO] Stage latency", stdout);
+    ntrip_session_print_gaps(&session, stdout);
 }
 
-void extract_satellites(const unsigned char *data, int len, int msg_type, SatStatsSummary *summary) {
-    int prns[MAX_SATS_PER_GNSS];
-    int gnss_id = 0;
-    int n = msm_extract_prns(data, len, msg_type, prns, MAX_SATS_PER_GNSS, &gnss_id);
-    if (n <= 0 || !gnss_id) return;
+/* Merge one frame's satellite mask into the running summary. */
+static void summary_add_mask(SatStatsSummary *summary, int gnss_id, uint32_t epoch_time,
+                             SatMask prns) {
+    if (!prns || !gnss_id) return;
 
     int idx = -1;
     for (int i = 0; i < summary->gnss_count; ++i) {
@@ -894,20 +1014,26 @@ void extract_satellites(const unsigned char *data, int len, int msg_type, SatSta
     }
     if (idx == -1 && summary->gnss_count < MAX_GNSS) {
         idx = summary->gnss_count++;
+        memset(&summary->gnss[idx], 0, sizeof(summary->gnss[idx]));
         summary->gnss[idx].gnss_id = gnss_id;
-        memset(summary->gnss[idx].sat_seen, 0, sizeof(summary->gnss[idx].sat_seen));
-        summary->gnss[idx].count = 0;
     }
     if (idx == -1) return;
 
-    for (int i = 0; i < n; ++i) {
-        int prn = prns[i];
-        if (prn < 1 || prn > MAX_SATS_PER_GNSS) continue;
-        if (!summary->gnss[idx].sat_seen[prn - 1]) {
-            summary->gnss[idx].sat_seen[prn - 1] = 1;
-            summary->gnss[idx].count++;
-        }
-    }
+    summary->gnss[idx].seen |= prns;
+    sat_vis_add(&summary->gnss[idx].vis, epoch_time, prns);
+}
+
+void extract_satellites(const unsigned char *data, int len, int msg_type, SatStatsSummary *summary) {
+    uint64_t mask;
+    uint32_t epoch = 0;
+    int gnss_id = 0;
+    if (msm_extract_sat_mask(data, len, msg_type, &mask, &epoch, &gnss_id))
+        summary_add_mask(summary, gnss_id, epoch, mask);
+}
+
+void extract_satellites_obs(const RtcmMsmObs *obs, SatStatsSummary *summary) {
+    if (!obs || obs->msm_subtype < 4) return;   /* same MSM4..7 gate as msm_extract_prns */
+    summary_add_mask(summary, obs->gnss_id, obs->epoch_time, obs->sat_mask);
 }
 
 const char* rinex_id_from_gnss(int gnss_id, int prn, char *buf, size_t buflen) {
@@ -928,66 +1054,67 @@ const char* rinex_id_from_gnss(int gnss_id, int prn, char *buf, size_t buflen) {
     return buf;
 }
 
-void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
-    printf("Opening NTRIP stream and analyzing satellites for %d seconds...\n", analysis_time);
-    SatStatsSummary summary = {0};
+typedef struct {
+    SatStatsSummary *summary;
+    uint64_t         bytes;     /* in CRC-valid frames, for --live */
+} SatellitesFrameCtx;
 
-    SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
-    char request[1024];
-    char buffer[BUFFER_SIZE];
+/* analyze_satellites_stream(): collect satellites, print the running total. */
+static void satellites_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    SatellitesFrameCtx *ctx = (SatellitesFrameCtx *)user;
+    SatStatsSummary *summary = ctx->summary;
+    int msg_type = (frame[3] << 4) | (frame[4] >> 4);
 
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
+    ntrip_record_frame(frame, frame_len);
 
-    int gai_ret = getaddrinfo(config->NTRIP_CASTER, NULL, &hints, &result);
-    if (gai_ret != 0) {
-        fprintf(stderr, "DNS lookup failed\n");
-        return;
-    }
+    extract_satellites(frame + 3, frame_len - 6, msg_type, summary);
+    ctx->bytes += (uint64_t)frame_len;
+    if (s_live) return;
 
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-#ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", WSAGetLastError());
-        freeaddrinfo(result);
-        WSACleanup();
-        return;
-    }
-#else
-    if (sock < 0) {
-        perror("Socket creation failed");
-        freeaddrinfo(result);
-        return;
+    // Count unique satellites after this message
+    int total_unique = 0;
+    for (int i = 0; i < summary->gnss_count; ++i) {
+        total_unique += sat_mask_count(summary->gnss[i].seen);
     }
-#endif
+    printf("%d ", total_unique); // Print after each message
+    fflush(stdout);              // Ensure immediate output
+}
 
-    server.sin_family = AF_INET;
-    server.sin_port = htons(config->NTRIP_PORT);
-    server.sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
+/* --live: publish the GNSS rows of analyze_satellites_stream(). */
+static void live_publish_sats(const SatellitesFrameCtx *ctx, const NTRIP_Config *config,
+                              const RtcmFramer *framer, const NtripSession *session,
+                              double t_start, int analysis_time)
+{
+    LiveStats ls;
+    memset(&ls, 0, sizeof(ls));
+    live_fill_common(&ls, config, "satellites", framer, session, t_start, analysis_time);
+    ls.bytes   = ctx->bytes;
+    ls.bytes_s = ls.elapsed_s > 0.0 ? (double)ctx->bytes / ls.elapsed_s : 0.0;
+    const SatStatsSummary *summary = ctx->summary;
+    for (int i = 0; i < summary->gnss_count && ls.n_gnss < LIVE_GNSS_ROWS; i++) {
+        LiveGnssRow *g = &ls.gnss[ls.n_gnss++];
+        g->gnss_id = summary->gnss[i].gnss_id;
+        g->in_view = (unsigned)sat_mask_count(sat_vis_now(&summary->gnss[i].vis));
+        g->seen    = (unsigned)sat_mask_count(summary->gnss[i].seen);
+    }
+    live_view_publish(s_live, &ls);
+}
 
-    freeaddrinfo(result);
+void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
+    if (!s_live)
+        printf("Opening NTRIP stream and analyzing satellites for %d seconds...\n", analysis_time);
+    SatStatsSummary summary = {0};
 
-    if (SOCK_CONN_ERR(connect(sock, (struct sockaddr *)&server, sizeof(struct sockaddr)))) {
-        fprintf(stderr, "Connection failed\n");
-        CLOSESOCKET(sock);
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->NTRIP_CASTER, config->NTRIP_PORT,
+                            config->MOUNTPOINT, config->AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 0, "[INFO]",
+                            ntrip_config_session_flags(config, false))) {
+        live_end();
         return;
     }
 
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->MOUNTPOINT, config->NTRIP_CASTER, config->AUTH_BASIC);
-
-    send(sock, request, strlen(request), 0);
-
     // --- GGA sending logic ---
     char gga[100];
     create_gngga_sentence(config->LATITUDE, config->LONGITUDE, gga);
@@ -996,84 +1123,46 @@ void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
     time_t last_gga_time = time(NULL);
 
     int received;
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
+    SatellitesFrameCtx ctx = { &summary, 0 };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, satellites_frame, &ctx);
 
     time_t start_time = time(NULL);
+    double t_start = get_time_seconds();
+    RunDeadline deadline = { start_time, analysis_time };
 
     while (difftime(time(NULL), start_time) < analysis_time) {
-        received = recv(sock, buffer, sizeof(buffer), 0);
-        if (received <= 0) break;
+        received = ntrip_recv_framed(&session, &framer, NULL);
+        if (s_live && live_view_due(s_live))
+            live_publish_sats(&ctx, config, &framer, &session, t_start, analysis_time);
+        if (received <= 0) {
+            if (!stream_resume(&session, recv_end_reason(received), run_deadline_passed,
+                               &deadline, &framer))
+                break;
+            last_gga_time = 0;
+            continue;
+        }
 
         // Send GGA every 1 second during reception
         time_t now = time(NULL);
         if (now - last_gga_time >= 1) {
-            send(sock, gga_with_crlf, strlen(gga_with_crlf), 0);
-            printf("GGA ");
+            ntrip_session_send(&session, gga_with_crlf, (int)strlen(gga_with_crlf));
+            if (!s_live) printf("GGA ");
             last_gga_time = now;
         }
-
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            char *ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
-        }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received && (unsigned char)buffer[buf_pos] != 0xD3) {
-                    buf_pos++;
-                }
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE) to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int full_frame = msg_length + 6;
-                if (msg_buffer_len < full_frame) break;
-
-                int msg_type = (msg_buffer[3] << 4) | (msg_buffer[4] >> 4);
-
-                extract_satellites(msg_buffer + 3, msg_length, msg_type, &summary);
-
-                // Count unique satellites after this message
-                int total_unique = 0;
-                for (int i = 0; i < summary.gnss_count; ++i) {
-                    total_unique += summary.gnss[i].count;
-                }
-                printf("%d ", total_unique); // Print after each message
-                fflush(stdout);              // Ensure immediate output
-
-                memmove(msg_buffer, msg_buffer + full_frame, msg_buffer_len - full_frame);
-                msg_buffer_len -= full_frame;
-            }
-        }
     }
 
-    CLOSESOCKET(sock);
+    ntrip_session_close(&session);
+    if (s_live) {
+        live_publish_sats(&ctx, config, &framer, &session, t_start, analysis_time);
+        live_end();
+    }
 
     // Calculate total unique satellites
     int total_unique = 0;
     for (int i = 0; i < summary.gnss_count; ++i) {
-        total_unique += summary.gnss[i].count;
+        sat_vis_flush(&summary.gnss[i].vis);
+        total_unique += sat_mask_count(summary.gnss[i].seen);
     }
 
     // Print dynamic table border
@@ -1099,12 +1188,11 @@ void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
         int pos = 0;
         int first = 1;
         char idbuf[8];
-        for (int s = 0; s < MAX_SATS_PER_GNSS; ++s) {
-            if (summary.gnss[i].sat_seen[s]) {
-                const char *rinex = rinex_id_from_gnss(summary.gnss[i].gnss_id, s + 1, idbuf, sizeof(idbuf));
-                pos += snprintf(sat_list + pos, sizeof(sat_list) - pos, "%s%s", first ? "" : " ", rinex);
-                first = 0;
-            }
+        SatMask seen = summary.gnss[i].seen;
+        for (int prn; (prn = sat_mask_next(&seen)) != 0; ) {
+            const char *rinex = rinex_id_from_gnss(summary.gnss[i].gnss_id, prn, idbuf, sizeof(idbuf));
+            pos += snprintf(sat_list + pos, sizeof(sat_list) - pos, "%s%s", first ? "" : " ", rinex);
+            first = 0;
         }
         if (pos == 0) snprintf(sat_list, sizeof(sat_list), "None");
 
@@ -1121,7 +1209,7 @@ void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
             if (first_line) {
                 printf("| %-9s | %10d | %-*s|\n",
                        gnss_name_from_id(summary.gnss[i].gnss_id),
-                       summary.gnss[i].count,
+                       sat_mask_count(summary.gnss[i].seen),
                        SAT_COL_WIDTH, line_buf);
                 first_line = 0;
             } else {
@@ -1136,6 +1224,31 @@ void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time) {
     printf("%s\n", border);
     printf("| Total     | %10d | %-*s|\n", total_unique, SAT_COL_WIDTH, ""); // Print total at the end
     printf("%s\n", border);
+
+    // Visibility per GNSS over the MSM epochs: passes, and SVs that were
+    // lost for a few epochs and came back (SAT_VIS_DROPOUT_EPOCHS)
+    if (summary.gnss_count > 0) printf("\nVisibility per MSM epoch:\n");
+    for (int i = 0; i < summary.gnss_count; ++i) {
+        const SatVisHistory *vis = &summary.gnss[i].vis;
+        unsigned passes = 0;
+        SatMask seen = summary.gnss[i].seen;
+        for (int prn; (prn = sat_mask_next(&seen)) != 0; )
+            passes += sat_vis_passes(vis, prn);
+        printf("  %-9s %6u epochs, %2d in view at the end, %3u passes, %3u dropouts",
+               gnss_name_from_id(summary.gnss[i].gnss_id), (unsigned)vis->n,
+               sat_mask_count(sat_vis_now(vis)), passes, sat_vis_dropouts(vis, 0));
+        char idbuf[8];
+        const char *sep = ": ";
+        seen = summary.gnss[i].seen;
+        for (int prn; (prn = sat_mask_next(&seen)) != 0; ) {
+            if (!sat_vis_dropouts(vis, prn)) continue;
+            printf("%s%s x%u", sep, rinex_id_from_gnss(summary.gnss[i].gnss_id, prn, idbuf, sizeof(idbuf)),
+                   sat_vis_dropouts(vis, prn));
+            sep = ", ";
+        }
+        printf("\n");
+    }
+    ntrip_session_print_gaps(&session, stdout);
 }
 
 const char* gnss_name_from_id(int gnss_id) {
@@ -1151,18 +1264,10 @@ const char* gnss_name_from_id(int gnss_id) {
     }
 }
 
-/* Note: this mapping must agree with msm_extract_prns() in rtcm3x_parser.c,
- * which is what actually drives the Satellites tab today.  Previously this
- * function had SBAS mis-mapped to the 1130 range and lacked a NavIC entry. */
+/* MSM range -> GNSS ID, answered by the rtcm3x_parser message registry so
+ * it always agrees with msm_extract_prns(). */
 int get_gnss_id_from_rtcm(int msg_type) {
-    if (msg_type >= 1070 && msg_type < 1080) return 1; // GPS
-    if (msg_type >= 1080 && msg_type < 1090) return 2; // GLONASS
-    if (msg_type >= 1090 && msg_type < 1100) return 3; // Galileo
-    if (msg_type >= 1100 && msg_type < 1110) return 6; // SBAS
-    if (msg_type >= 1110 && msg_type < 1120) return 4; // QZSS
-    if (msg_type >= 1120 && msg_type < 1130) return 5; // BeiDou
-    if (msg_type >= 1130 && msg_type < 1140) return 7; // NavIC / IRNSS
-    return 0;
+    return rtcm_msg_is_msm(msg_type, 1, 7) ? rtcm_msg_gnss_id(msg_type) : 0;
 }
 
 /* ─────────────────────────────────────────────────────────────────────
@@ -1175,6 +1280,62 @@ int get_gnss_id_from_rtcm(int msg_type) {
  * decode_rtcm_* functions.  Polls @p stop_flag every recv() iteration
  * so it can exit promptly on Ctrl-C.
  * ───────────────────────────────────────────────────────────────────── */
+typedef struct {
+    const NTRIP_Config *config;
+    RtcmStrBuf         *sink;      /* discard sink, or NULL when verbose */
+    bool                verbose;
+    int                 eph_count;
+} EphFrameCtx;
+
+/* run_eph_stream(): decode ephemeris frames, ignore everything else. */
+static void eph_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    EphFrameCtx *ctx = (EphFrameCtx *)user;
+    int msg_length = frame_len - 6;
+    if (msg_length < 2) return;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+
+    /* Reset the discard sink between frames so it can't grow
+     * unbounded if we're running for hours. */
+    if (ctx->sink) rtcm_strbuf_clear(ctx->sink);
+
+    /* Ephemeris types only -- 1005/1006 from this caster must
+     * not overwrite the obs station ARP.  They fill the shared
+     * ephemeris store and need no decoder context. */
+    if (!rtcm_msg_is_eph(mt)) return;
+    rtcm_msg_info(mt)->decode(NULL, &frame[3], msg_length, ctx->config);
+    ctx->eph_count++;
+
+    if (ctx->verbose) {
+        fprintf(stderr, "[EPH] type=%d  (total cached: %d)\n", mt, ctx->eph_count);
+        fflush(stderr);
+    }
+}
+
+void ntrip_eph_coverage_add(NtripEphCoverage *c, int msg_type, double now)
+{
+    int g = rtcm_msg_gnss_id(msg_type);
+    if (g <= 0 || g >= 32) return;
+    if (rtcm_msg_is_eph(msg_type)) {
+        c->eph_gnss |= 1u << g;
+    } else if (rtcm_msg_is_msm(msg_type, 1, 7) && g != 6) {
+        if (!c->msm_gnss) c->t_first = now;
+        c->msm_gnss |= 1u << g;
+    }
+}
+
+bool ntrip_eph_coverage_full(const NtripEphCoverage *c, double now)
+{
+    return c->msm_gnss && (c->msm_gnss & ~c->eph_gnss) == 0 &&
+           now - c->t_first >= NTRIP_EPH_COVERAGE_SETTLE_S;
+}
+
+static int stop_flag_set(void *user)
+{
+    const volatile int *stop_flag = (const volatile int *)user;
+    return stop_flag && *stop_flag;
+}
+
 int run_eph_stream(const NTRIP_Config *config,
                    const volatile int *stop_flag, bool verbose)
 {
@@ -1183,82 +1344,17 @@ int run_eph_stream(const NTRIP_Config *config,
         !config->EPH_MOUNTPOINT[0])
         return -1;
 
-    SOCKET_TYPE sock;
-    struct sockaddr_in server;
-    struct addrinfo hints, *result;
-    char request[1024];
-    char buffer[BUFFER_SIZE];
-
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-
-    int gai_ret = getaddrinfo(config->EPH_CASTER, NULL, &hints, &result);
-    if (gai_ret != 0) {
-        fprintf(stderr, "[EPH] DNS lookup failed for %s\n", config->EPH_CASTER);
+    /* Short recv timeout so the stop_flag is polled regularly. */
+    NtripSession session;
+    if (!ntrip_session_open(&session, config->EPH_CASTER, config->EPH_PORT,
+                            config->EPH_MOUNTPOINT, config->EPH_AUTH_BASIC,
+                            config->RECONNECT_DELAY_MAX, 500, "[EPH]",
+                            ntrip_config_session_flags(config, true)))
         return -1;
-    }
-
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-#ifdef _WIN32
-    if (sock == INVALID_SOCKET) {
-        fprintf(stderr, "[EPH] Socket creation failed\n");
-        freeaddrinfo(result);
-        return -1;
-    }
-#else
-    if (sock < 0) {
-        perror("[EPH] Socket creation failed");
-        freeaddrinfo(result);
-        return -1;
-    }
-#endif
-
-    server.sin_family = AF_INET;
-    server.sin_port   = htons(config->EPH_PORT);
-    server.sin_addr   = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-    memset(&(server.sin_zero), 0, 8);
-    freeaddrinfo(result);
-
-    if (SOCK_CONN_ERR(connect(sock, (struct sockaddr *)&server,
-                              sizeof(struct sockaddr)))) {
-        fprintf(stderr, "[EPH] Connect failed to %s:%d\n",
-                config->EPH_CASTER, config->EPH_PORT);
-        CLOSESOCKET(sock);
-        return -1;
-    }
-
-    snprintf(request, sizeof(request),
-             "GET /%s HTTP/1.1\r\n"
-             "Host: %s\r\n"
-             "Ntrip-Version: Ntrip/2.0\r\n"
-             "User-Agent: NTRIP CClient/1.0\r\n"
-             "Authorization: Basic %s\r\n"
-             "\r\n",
-             config->EPH_MOUNTPOINT, config->EPH_CASTER,
-             config->EPH_AUTH_BASIC);
-    send(sock, request, strlen(request), 0);
 
     fprintf(stderr, "[EPH] Connected to %s:%d /%s\n",
             config->EPH_CASTER, config->EPH_PORT, config->EPH_MOUNTPOINT);
 
-    int header_skipped = 0;
-    unsigned char msg_buffer[BUFFER_SIZE];
-    int msg_buffer_len = 0;
-    int eph_count = 0;
-
-    /* Use a short recv timeout so the stop_flag is polled regularly. */
-#ifdef _WIN32
-    DWORD tv_ms = 500;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
-               (const char *)&tv_ms, sizeof(tv_ms));
-#else
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 500000;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO,
-               (const char *)&tv, sizeof(tv));
-#endif
 
     /* Mute the per-frame decode chatter unless the user asked for -v.
      * decode_rtcm_*() writes to rtcm_printf, which routes to a __thread
@@ -1273,96 +1369,48 @@ int run_eph_stream(const NTRIP_Config *config,
         sink_used = 1;
     }
 
+    EphFrameCtx ctx = { config, sink_used ? &sink : NULL, verbose, 0 };
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, eph_frame, &ctx);
+
+    double last_data = get_time_seconds();
     while (!stop_flag || !*stop_flag) {
-        int received = recv(sock, buffer, sizeof(buffer), 0);
-        if (received == 0) break;             /* EOF -- caster closed */
-        if (received < 0) {
-            /* Treat any error as "no data this tick" so the stop flag is
-             * polled; do not break on timeout. */
+        int received = ntrip_recv_framed(&session, &framer, NULL);
+        const char *why = NULL;
+        if (received > 0) {
+            last_data = get_time_seconds();
+            continue;
+        }
+        if (received == 0) {
+            why = recv_end_reason(0);         /* EOF -- caster closed */
+        } else {
+            /* A timeout is just "no data this tick" so the stop flag is
+             * polled; only a long silence counts as a lost connection. */
 #ifdef _WIN32
-            int err = WSAGetLastError();
-            if (err == WSAETIMEDOUT) continue;
+            bool tick = WSAGetLastError() == WSAETIMEDOUT;
 #else
-            if (errno == EAGAIN || errno == EWOULDBLOCK ||
-                errno == EINTR) continue;
+            bool tick = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
 #endif
-            break;
-        }
-
-        if (!header_skipped) {
-            buffer[received] = '\0';
-            char *ptr = strstr(buffer, "\r\n\r\n");
-            if (ptr) {
-                int offset = (ptr - buffer) + 4;
-                memmove(buffer, buffer + offset, received - offset);
-                received -= offset;
-                header_skipped = 1;
-            } else {
-                continue;
-            }
-        }
-
-        int buf_pos = 0;
-        while (buf_pos < received) {
-            if (msg_buffer_len == 0) {
-                while (buf_pos < received &&
-                       (unsigned char)buffer[buf_pos] != 0xD3) buf_pos++;
-                if (buf_pos >= received) break;
-            }
-            int to_copy = received - buf_pos;
-            if (msg_buffer_len + to_copy > BUFFER_SIZE)
-                to_copy = BUFFER_SIZE - msg_buffer_len;
-            memcpy(msg_buffer + msg_buffer_len, buffer + buf_pos, to_copy);
-            msg_buffer_len += to_copy;
-            buf_pos += to_copy;
-
-            while (msg_buffer_len >= 3) {
-                if (msg_buffer[0] != 0xD3) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int msg_length = ((msg_buffer[1] & 0x03) << 8) | msg_buffer[2];
-                int frame_len  = 3 + msg_length + 3;
-                if (msg_buffer_len < frame_len) break;
-                if (msg_length < 2) {
-                    memmove(msg_buffer, msg_buffer + 1, --msg_buffer_len);
-                    continue;
-                }
-                int mt = ((int)msg_buffer[3] << 4) | ((int)msg_buffer[4] >> 4);
-
-                /* Reset the discard sink between frames so it can't grow
-                 * unbounded if we're running for hours. */
-                if (sink_used) rtcm_strbuf_clear(&sink);
-
-                switch (mt) {
-                case 1019: decode_rtcm_1019(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1020: decode_rtcm_1020(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1041: decode_rtcm_1041(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1042: decode_rtcm_1042(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1044: decode_rtcm_1044(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1045: decode_rtcm_1045(&msg_buffer[3], msg_length); eph_count++; break;
-                case 1046: decode_rtcm_1046(&msg_buffer[3], msg_length); eph_count++; break;
-                default: break;
-                }
-
-                if (verbose && mt >= 1019 && mt <= 1046) {
-                    fprintf(stderr, "[EPH] type=%d  (total cached: %d)\n", mt, eph_count);
-                    fflush(stderr);
-                }
-
-                memmove(msg_buffer, msg_buffer + frame_len,
-                        msg_buffer_len - frame_len);
-                msg_buffer_len -= frame_len;
-            }
+            if (!tick)
+                why = recv_end_reason(-1);
+            else if (get_time_seconds() - last_data >= NTRIP_SESSION_IDLE_S)
+                why = "stream went silent";
         }
+        if (!why) continue;
+        if (!stream_resume(&session, why, stop_flag_set, (void *)stop_flag,
+                           &framer))
+            break;
+        last_data = get_time_seconds();
     }
 
-    CLOSESOCKET(sock);
+    ntrip_session_close(&session);
+    ntrip_session_print_gaps(&session, stderr);
     if (sink_used) {
         rtcm_set_output_buffer(NULL);
         rtcm_strbuf_free(&sink);
     }
-    fprintf(stderr, "[EPH] Stream closed (decoded %d ephemerides)\n", eph_count);
+    fprintf(stderr, "[EPH] Stream closed (decoded %d ephemerides, %lu bytes skipped)\n",
+            ctx.eph_count, framer.skipped_bytes);
     fflush(stderr);
     return 0;
 }
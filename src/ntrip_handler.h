@@ -24,9 +24,13 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #ifndef NTRIP_HANDLER_H
 #define NTRIP_HANDLER_H
 
+#include "rtcm_filter.h"
+#include "sat_vis.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,6 +52,22 @@ extern "C" {
  *   - AUTH_BASIC:   Base64 encoded "username:password" for HTTP Basic Auth
  *   - LATITUDE:     Latitude for NTRIP connection (optional)
  *   - LONGITUDE:    Longitude for NTRIP connection (optional)
+ *   - SOURCETABLE_TTL: Seconds a cached sourcetable is used without asking
+ *                   the caster; 0 disables the cache (optional)
+ *   - SOURCETABLE_TIMEOUT: Seconds a sourcetable fetch (connect and
+ *                   transfer) may take; 0 = no limit (optional)
+ *   - RECONNECT_DELAY_MAX: Longest wait in seconds between attempts to
+ *                   re-open a lost stream; 0 = 60, negative = do not
+ *                   reconnect (optional)
+ *   - TLS:          NTRIP over TLS: 1 = on, -1 = off, 0 = on when the
+ *                   port is 443 (optional; EPH_TLS likewise for the
+ *                   ephemeris caster)
+ *   - TLS_INSECURE: Non-zero skips certificate checks, for casters with a
+ *                   self-signed certificate (optional)
+ *   - GGA_INTERVAL: Seconds between GGA sentences on an event-loop stream
+ *                   (--mounts-file, --load-test); 0 = 1 s, negative = send
+ *                   none, for mountpoints that do not need a position
+ *                   (optional)
  */
 typedef struct {
     char NTRIP_CASTER[256];   /**< Hostname or IP address of the NTRIP caster */
@@ -58,6 +78,12 @@ typedef struct {
     char AUTH_BASIC[256];     /**< Base64 encoded "username:password" for HTTP Basic Auth */
     double LATITUDE;          /**< Latitude for NTRIP connection (optional) */
     double LONGITUDE;         /**< Longitude for NTRIP connection (optional) */
+    int  SOURCETABLE_TTL;     /**< Sourcetable cache lifetime in seconds; 0 = off */
+    int  SOURCETABLE_TIMEOUT; /**< Sourcetable fetch time limit in seconds; 0 = none */
+    int  RECONNECT_DELAY_MAX; /**< Longest wait between reconnects in s; 0 = 60, < 0 = off */
+    int  TLS;                 /**< NTRIP over TLS: 1 = on, -1 = off, 0 = on for port 443 */
+    int  TLS_INSECURE;        /**< Non-zero: accept any TLS certificate */
+    int  GGA_INTERVAL;        /**< Event-loop GGA period in s; 0 = 1 s, < 0 = none */
 
     /* ── Optional secondary ephemeris stream ─────────────────────────── */
     /* Used by the GUI Sky Plot when the primary observation mountpoint
@@ -70,6 +96,7 @@ typedef struct {
     char EPH_USERNAME[128];   /**< Ephemeris-caster username */
     char EPH_PASSWORD[128];   /**< Ephemeris-caster password */
     char EPH_AUTH_BASIC[256]; /**< Base64 of "user:pass" for the eph caster */
+    int  EPH_TLS;             /**< As TLS, for the ephemeris caster */
 } NTRIP_Config;
 
 /**
@@ -84,7 +111,7 @@ typedef struct {
  * @def MAX_SATS_PER_GNSS
  * @brief Maximum number of satellites per GNSS system supported in statistics.
  *
- * Used as the size of the sat_seen array in GnssSatStats.
+ * The width of the SatMask in GnssSatStats (the MSM satellite mask, DF394).
  */
 #define MAX_SATS_PER_GNSS 64
 
@@ -96,13 +123,13 @@ typedef struct {
  *
  * Fields:
  *   - gnss_id:   GNSS system ID (1=GPS, 2=GLONASS, 3=Galileo, 4=QZSS, 5=BeiDou, 6=SBAS, etc.)
- *   - sat_seen:  Array indicating which satellites have been seen (1 if seen, 0 if not)
- *   - count:     Number of unique satellites seen for this GNSS
+ *   - seen:      Satellites seen so far (sat_mask_count() for the number, see sat_vis.h)
+ *   - vis:       Per-epoch visibility: in view now, rises, sets, dropouts
  */
 typedef struct {
-    int gnss_id;                        /**< GNSS system ID */
-    int sat_seen[MAX_SATS_PER_GNSS];    /**< 1 if seen, 0 if not */
-    int count;                          /**< Number of unique satellites seen */
+    int           gnss_id;              /**< GNSS system ID */
+    SatMask       seen;                 /**< Satellites seen so far */
+    SatVisHistory vis;                  /**< Per-epoch visibility */
 } GnssSatStats;
 
 /**
@@ -128,6 +155,15 @@ typedef struct {
  */
 void base64_encode(const char *input, char *output);
 
+/**
+ * @brief Transport flags (NTRIP_SESSION_TLS, NTRIP_SESSION_TLS_NOVERIFY)
+ *        for the main caster, or the ephemeris caster with @p eph.
+ *
+ * TLS is used when TLS / EPH_TLS is 1, or when it is 0 (not set) and the
+ * port is 443.
+ */
+unsigned ntrip_config_session_flags(const NTRIP_Config *config, bool eph);
+
 /**
  * @brief Receives the NTRIP mountpoint table (sourcetable) from the caster.
  *
@@ -138,6 +174,44 @@ void base64_encode(const char *input, char *output);
  */
 char* receive_mount_table(const NTRIP_Config *config);
 
+/**
+ * @brief Called by receive_mount_table_ex() for each line of the reply.
+ *
+ * @p line is not NUL-terminated; its @p len bytes include the line end.
+ * Together the lines make up exactly the returned string.
+ */
+typedef void (*MountTableLineFn)(const char *line, size_t len, void *user);
+
+/** @brief Where the sourcetable of receive_mount_table_ex() came from. */
+typedef enum {
+    MOUNT_TABLE_NETWORK,      /**< Fetched from the caster */
+    MOUNT_TABLE_CACHED,       /**< Cached copy, not checked with the caster */
+    MOUNT_TABLE_REVALIDATED,  /**< Cached copy, caster said 304 Not Modified */
+    MOUNT_TABLE_STALE         /**< Cached copy past its TTL, caster unreachable */
+} MountTableSource;
+
+/** @brief Details of a receive_mount_table_ex() result. */
+typedef struct {
+    MountTableSource source;  /**< Network or cache */
+    long             age_s;   /**< Age of a cached copy in seconds */
+} MountTableInfo;
+
+/**
+ * @brief receive_mount_table() that hands each line to @p on_line while
+ *        the reply is still arriving.
+ *
+ * With SOURCETABLE_TTL set, the reply comes from the on-disk cache when
+ * possible (see sourcetable_cache.h); it is then passed to @p on_line
+ * the same way.
+ *
+ * @param on_line Line callback, or NULL.
+ * @param user    Passed to @p on_line.
+ * @param info    [out] Source of the table, or NULL.
+ * @return As receive_mount_table().
+ */
+char* receive_mount_table_ex(const NTRIP_Config *config, MountTableLineFn on_line,
+                             void *user, MountTableInfo *info);
+
 /**
  * @brief Starts the NTRIP stream from the configured mountpoint and prints RTCM message types.
  *
@@ -152,14 +226,14 @@ void start_ntrip_stream(const NTRIP_Config *config);
  * @brief Starts the NTRIP stream with a filter for specific RTCM message types.
  *
  * Connects to the NTRIP caster and mountpoint specified in the config, receives RTCM 3.x data,
- * and processes messages using the RTCM parser, but only for the message types specified in the filter.
+ * and processes messages using the RTCM parser, but only for the message types the filter
+ * accepts; of all other messages only the message number is printed.
  *
  * @param config Pointer to NTRIP_Config struct with connection details.
- * @param filter_list Array of RTCM message type IDs to filter (e.g., {1005, 1006, 1007}).
- * @param filter_count Number of message types in the filter_list.
+ * @param filter Compiled filter (rtcm_filter_compile()); its rate counters advance.
  * @param debug If true, print debug information including server response after login.
  */
-void start_ntrip_stream_with_filter(const NTRIP_Config *config, const int *filter_list, int filter_count, bool debug);
+void start_ntrip_stream_with_filter(const NTRIP_Config *config, RtcmFilter *filter, bool debug);
 
 /**
  * @brief Analyze RTCM message types for a given duration and print a summary table.
@@ -192,6 +266,17 @@ int get_gnss_id_from_rtcm(int msg_type);
  */
 void extract_satellites(const unsigned char *data, int len, int msg_type, SatStatsSummary *summary);
 
+struct RtcmMsmObs;   /* rtcm3x_parser.h */
+
+/**
+ * @brief Same as extract_satellites() for a frame already decoded with
+ *        rtcm_decode_msm() (see rtcm3x_parser.h).
+ *
+ * @param obs      Decoded MSM frame.
+ * @param summary  Pointer to SatStatsSummary to update.
+ */
+void extract_satellites_obs(const struct RtcmMsmObs *obs, SatStatsSummary *summary);
+
 /**
  * @brief Opens NTRIP stream and analyzes satellites for a period.
  *
@@ -203,6 +288,57 @@ void extract_satellites(const unsigned char *data, int len, int msg_type, SatSta
  */
 void analyze_satellites_stream(const NTRIP_Config *config, int analysis_time);
 
+struct LiveView;
+
+/**
+ * @brief Draw the next analyze_message_types() or
+ *        analyze_satellites_stream() on a --live dashboard (live_view.h)
+ *        instead of printing a token per frame.
+ *
+ * The run takes @p v over: it publishes the final snapshot and calls
+ * live_view_stop() when the stream ends, so its tables print below the
+ * last frame.  NULL prints the tokens.
+ */
+void ntrip_set_live_view(struct LiveView *v);
+
+struct RtcmRecorder;
+
+/**
+ * @brief Record every CRC-valid frame of the following streams (--record).
+ *
+ * Applies to start_ntrip_stream(), start_ntrip_stream_with_filter(),
+ * analyze_message_types() and analyze_satellites_stream(); the ephemeris
+ * stream is never recorded.  Frames are queued to the recorder's writer
+ * thread, so the receive loop never waits for the disk.  Pass NULL to
+ * stop recording.
+ *
+ * @param r  Open recorder (rtcm_recorder.h), or NULL.
+ */
+void ntrip_set_recorder(struct RtcmRecorder *r);
+
+struct RinexObsWriter;
+
+/**
+ * @brief Also feed every frame of those streams to a RINEX observation
+ *        writer (--rinex-obs, rinex_obs.h), or stop with NULL.
+ */
+void ntrip_set_rinex_obs(struct RinexObsWriter *w);
+
+struct ObsColWriter;
+
+/**
+ * @brief Also feed every frame of those streams to a columnar export
+ *        writer (--export, obs_columns.h), or stop with NULL.
+ */
+void ntrip_set_obs_export(struct ObsColWriter *w);
+
+/**
+ * @brief Write @p frame to the recorder set with ntrip_set_recorder() and
+ *        the writers set with ntrip_set_rinex_obs() and
+ *        ntrip_set_obs_export(), if any.
+ */
+void ntrip_record_frame(const unsigned char *frame, int frame_len);
+
 /**
  * @brief Returns the GNSS system name string for a given GNSS ID.
  *
@@ -233,6 +369,34 @@ const char* gnss_name_from_id(int gnss_id);
 int run_eph_stream(const NTRIP_Config *config,
                    const volatile int *stop_flag, bool verbose);
 
+/** @brief Seconds of MSM an obs stream must have shown before its
+ *         ephemerides can be judged complete (ntrip_eph_coverage_full()). */
+#define NTRIP_EPH_COVERAGE_SETTLE_S  10.0
+
+/**
+ * @struct NtripEphCoverage
+ * @brief Which constellations an obs stream observes (MSM) and which it
+ *        also broadcasts ephemerides for (1019/1020/1041/1042/1044/1045/1046).
+ *
+ * Zero-initialise; start again with a new stream.  SBAS MSM are not
+ * counted: RTCM has no SBAS ephemeris message.
+ */
+typedef struct {
+    uint32_t msm_gnss;      /**< bit per gnss_id with MSM seen */
+    uint32_t eph_gnss;      /**< bit per gnss_id with an ephemeris seen */
+    double   t_first;       /**< stream_clock_seconds() of the first MSM */
+} NtripEphCoverage;
+
+/** @brief Count one frame of type @p msg_type seen at @p now (s). */
+void ntrip_eph_coverage_add(NtripEphCoverage *c, int msg_type, double now);
+
+/**
+ * @brief true once the stream has carried an ephemeris of every
+ *        constellation it observes, after @ref NTRIP_EPH_COVERAGE_SETTLE_S
+ *        of MSM -- a separate ephemeris stream then brings nothing new.
+ */
+bool ntrip_eph_coverage_full(const NtripEphCoverage *c, double now);
+
 /**
  * @brief Formats a RINEX satellite ID for a given GNSS and PRN.
  *
@@ -0,0 +1,197 @@
+/**
+ * @file ntrip_http.c
+ * @brief Streaming decoder for NTRIP stream replies (header, chunked body).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "ntrip_http.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ASCII-only case folding; header names are ASCII. */
+static int http_lower(int c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static bool http_prefix_ci(const char *s, const char *prefix)
+{
+    for (; *prefix; s++, prefix++) {
+        if (http_lower((unsigned char)*s) != *prefix) return false;
+    }
+    return true;
+}
+
+static bool http_contains_ci(const char *s, const char *needle)
+{
+    for (; *s; s++) {
+        if (http_prefix_ci(s, needle)) return true;
+    }
+    return false;
+}
+
+static int http_hex(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    c = http_lower(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+void ntrip_http_init(NtripHttp *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->state = NTRIP_HTTP_HEAD;
+}
+
+/* One complete header line (without CRLF) in h->line. */
+static void http_header_line(NtripHttp *h)
+{
+    h->line[h->line_len] = '\0';
+    if (h->head_lines == 0) {
+        snprintf(h->status_line, sizeof(h->status_line), "%.95s", h->line);
+        h->icy = strncmp(h->line, "ICY", 3) == 0;
+        const char *sp = strchr(h->line, ' ');
+        h->status = sp ? atoi(sp + 1) : 0;
+    } else if (http_prefix_ci(h->line, "transfer-encoding:") &&
+               http_contains_ci(h->line + 18, "chunked")) {
+        h->chunked = true;
+    }
+    h->head_lines++;
+}
+
+static void http_body_starts(NtripHttp *h)
+{
+    h->state       = h->chunked ? NTRIP_HTTP_CHUNK_SIZE : NTRIP_HTTP_BODY;
+    h->chunk_left  = 0;
+    h->size_digits = 0;
+}
+
+size_t ntrip_http_decode(NtripHttp *h, unsigned char *buf, size_t len)
+{
+    size_t i = 0, out = 0;
+
+    while (i < len) {
+        switch (h->state) {
+        case NTRIP_HTTP_HEAD: {
+            int c = buf[i];
+            /* NTRIP 1.0: the data may follow "ICY 200 OK\r\n" directly */
+            if (h->icy && h->head_lines == 1 && h->line_len == 0 && c != '\r' &&
+                !((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))) {
+                http_body_starts(h);
+                break;
+            }
+            i++;
+            h->head_bytes++;
+            if (c == '\n') {
+                if (h->line_len > 0 && h->line[h->line_len - 1] == '\r') h->line_len--;
+                if (h->line_len == 0 && h->head_lines > 0) {
+                    http_body_starts(h);
+                } else if (h->line_len > 0) {
+                    http_header_line(h);
+                }
+                h->line_len = 0;
+            } else if (h->line_len < NTRIP_HTTP_LINE_MAX - 1) {
+                h->line[h->line_len++] = (char)c;
+            }
+            break;
+        }
+
+        case NTRIP_HTTP_BODY:
+            /* The bulk case: everything left is body */
+            if (out != i) memmove(buf + out, buf + i, len - i);
+            out += len - i;
+            i = len;
+            break;
+
+        case NTRIP_HTTP_CHUNK_DATA: {
+            size_t k = len - i;
+            if (k > h->chunk_left) k = (size_t)h->chunk_left;
+            if (out != i) memmove(buf + out, buf + i, k);
+            out += k;
+            i   += k;
+            h->chunk_left -= k;
+            if (h->chunk_left == 0) h->state = NTRIP_HTTP_CHUNK_END;
+            break;
+        }
+
+        case NTRIP_HTTP_CHUNK_SIZE:
+        case NTRIP_HTTP_CHUNK_EXT: {
+            int c = buf[i];
+            int v = http_hex(c);
+            bool ok = true;
+            if (c == '\n') {
+                if (h->size_digits == 0) {
+                    ok = false;
+                } else if (h->chunk_left == 0) {
+                    h->state    = NTRIP_HTTP_TRAILER;
+                    h->line_len = 0;
+                } else {
+                    h->state = NTRIP_HTTP_CHUNK_DATA;
+                    h->chunks++;
+                }
+            } else if (h->state == NTRIP_HTTP_CHUNK_EXT || c == '\r') {
+                /* extension text, or the CR of the size line */
+            } else if (c == ';' || c == ' ' || c == '\t') {
+                h->state = NTRIP_HTTP_CHUNK_EXT;
+            } else if (v >= 0 && h->size_digits < 15) {
+                h->chunk_left = h->chunk_left * 16 + (unsigned)v;
+                h->size_digits++;
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                /* Not chunk framing after all: pass the rest through */
+                h->bad_chunk = true;
+                h->state     = NTRIP_HTTP_BODY;
+                break;
+            }
+            i++;
+            break;
+        }
+
+        case NTRIP_HTTP_CHUNK_END: {
+            int c = buf[i];
+            if (c == '\n') {
+                h->state       = NTRIP_HTTP_CHUNK_SIZE;
+                h->chunk_left  = 0;
+                h->size_digits = 0;
+            } else if (c != '\r') {
+                h->bad_chunk = true;
+                h->state     = NTRIP_HTTP_BODY;
+                break;
+            }
+            i++;
+            break;
+        }
+
+        case NTRIP_HTTP_TRAILER: {
+            int c = buf[i++];
+            if (c == '\n') {
+                if (h->line_len == 0) h->state = NTRIP_HTTP_DONE;
+                h->line_len = 0;
+            } else if (c != '\r') {
+                h->line_len++;
+            }
+            break;
+        }
+
+        case NTRIP_HTTP_DONE:
+            i = len;
+            break;
+        }
+    }
+
+    h->framing_bytes += len - out;
+    return out;
+}
+
+bool ntrip_http_ok(const NtripHttp *h)
+{
+    return h->status == 200 && (h->icy || strncmp(h->status_line, "HTTP/", 5) == 0);
+}
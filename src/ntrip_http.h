@@ -0,0 +1,114 @@
+/**
+ * @file ntrip_http.h
+ * @brief Streaming decoder for the HTTP side of an NTRIP stream reply:
+ *        response header, then a plain or chunked body.
+ *
+ * NTRIP 1.0 casters answer "ICY 200 OK" and send the RTCM bytes as they
+ * are.  NTRIP 2.0 casters answer "HTTP/1.1 200 OK" and usually send the
+ * body with "Transfer-Encoding: chunked": every chunk is preceded by a
+ * hex size line and followed by CRLF, so the framing lines sit between
+ * the RTCM bytes.  Handed to the framer as they are, those bytes make it
+ * resync at every chunk boundary and drop the frames they cut.
+ *
+ * An NtripHttp decodes a reply as it arrives, one recv() at a time, in
+ * the buffer the bytes were received into -- normally the framer ring at
+ * rtcm_framer_write_ptr():
+ *
+ * @code
+ * unsigned char *dst = rtcm_framer_write_ptr(&framer, &avail);
+ * int n = ntrip_session_recv(&session, dst, (int)avail);
+ * if (n > 0) rtcm_framer_commit(&framer, ntrip_http_decode(&http, dst, n));
+ * @endcode
+ *
+ * Header bytes and chunk framing are dropped; body bytes are closed up
+ * over them, so a read that starts in the middle of a chunk (the common
+ * case) is not touched at all and only the bytes after a chunk boundary
+ * move, by the few bytes of the size line.  The header and the size lines
+ * may be split anywhere across reads.
+ *
+ * A chunk size line that does not parse ends chunk decoding: the
+ * remaining bytes are passed on unchanged and the framer's resync copes
+ * with them, as it did before.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef NTRIP_HTTP_H
+#define NTRIP_HTTP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Longest header line kept for parsing; the rest of a line is ignored. */
+#define NTRIP_HTTP_LINE_MAX  256
+
+/** @brief Decoder state (NtripHttp::state). */
+typedef enum {
+    NTRIP_HTTP_HEAD = 0,     /**< In the response header */
+    NTRIP_HTTP_BODY,         /**< Body without framing: passed on as is */
+    NTRIP_HTTP_CHUNK_SIZE,   /**< In a chunk size line */
+    NTRIP_HTTP_CHUNK_EXT,    /**< In a chunk extension (";name=value") */
+    NTRIP_HTTP_CHUNK_DATA,   /**< In chunk data */
+    NTRIP_HTTP_CHUNK_END,    /**< CRLF after the chunk data */
+    NTRIP_HTTP_TRAILER,      /**< After the last (0-size) chunk */
+    NTRIP_HTTP_DONE          /**< Reply complete; more bytes are dropped */
+} NtripHttpState;
+
+/**
+ * @struct NtripHttp
+ * @brief One reply being decoded.
+ */
+typedef struct {
+    NtripHttpState state;
+    int   status;                   /**< Status code, e.g. 200; 0 until seen */
+    bool  icy;                      /**< NTRIP 1.0 "ICY" status line */
+    bool  chunked;                  /**< Transfer-Encoding: chunked */
+    bool  bad_chunk;                /**< A size line failed to parse */
+    char  status_line[96];          /**< First line of the reply */
+
+    /* Header and chunk-line parser */
+    char  line[NTRIP_HTTP_LINE_MAX];
+    int   line_len;
+    int   head_lines;               /**< Lines finished so far */
+    size_t head_bytes;              /**< Header length in bytes */
+    unsigned long long chunk_left;  /**< Data bytes left in the current chunk */
+    int   size_digits;              /**< Hex digits seen in the size line */
+
+    unsigned long      chunks;         /**< Chunks started */
+    unsigned long long framing_bytes;  /**< Header and chunk framing dropped */
+} NtripHttp;
+
+/** @brief Start decoding a new reply (at every connect and reconnect). */
+void ntrip_http_init(NtripHttp *h);
+
+/**
+ * @brief Decode @p len received bytes in place.
+ *
+ * @return Number of body bytes, now at buf[0 .. return).  0 while the
+ *         header or chunk framing is all that arrived.
+ */
+size_t ntrip_http_decode(NtripHttp *h, unsigned char *buf, size_t len);
+
+/** @brief true once the whole response header has been read. */
+static inline bool ntrip_http_head_done(const NtripHttp *h)
+{
+    return h->state != NTRIP_HTTP_HEAD;
+}
+
+/**
+ * @brief true if the header announced a stream: "ICY 200 OK" or
+ *        "HTTP/1.x 200".  "SOURCETABLE 200 OK" (unknown mountpoint) is not.
+ */
+bool ntrip_http_ok(const NtripHttp *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_HTTP_H */
@@ -0,0 +1,2787 @@
+/**
+ * @file ntrip_multi.c
+ * @brief Multi-mountpoint monitor: many NTRIP streams on one event loop.
+ *
+ * Project: NTRIP RTCM 3.x Stream Analyzer
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause (see LICENSE for details)
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE                 /* pthread_setaffinity_np() for --pin-cores */
+#endif
+
+#ifdef _WIN32
+    #ifndef _WIN32_WINNT
+    #define _WIN32_WINNT 0x0601     /* WSAPoll(), SRWLOCK need Vista or later */
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+    #define CLOSESOCKET closesocket
+    #define SOCKET_TYPE SOCKET
+    #define SOCK_INVALID INVALID_SOCKET
+    #define SOCK_WOULDBLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+    typedef SRWLOCK MultiLock;
+    #define MULTI_LOCK_INIT(l)  InitializeSRWLock(l)
+    #define MULTI_LOCK(l)       AcquireSRWLockExclusive(l)
+    #define MULTI_UNLOCK(l)     ReleaseSRWLockExclusive(l)
+    #define MULTI_LOCK_FREE(l)  ((void)(l))
+#else
+    #include <netdb.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/resource.h>
+    #include <pthread.h>
+    #ifdef __linux__
+    #include <sys/epoll.h>
+    #define MULTI_USE_EPOLL 1
+    #endif
+    #define CLOSESOCKET close
+    #define SOCKET_TYPE int
+    #define SOCK_INVALID (-1)
+    #define SOCK_WOULDBLOCK() (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS)
+    typedef pthread_mutex_t MultiLock;
+    #define MULTI_LOCK_INIT(l)  pthread_mutex_init((l), NULL)
+    #define MULTI_LOCK(l)       pthread_mutex_lock(l)
+    #define MULTI_UNLOCK(l)     pthread_mutex_unlock(l)
+    #define MULTI_LOCK_FREE(l)  pthread_mutex_destroy(l)
+#endif
+
+#include "ntrip_multi.h"
+#include "anomaly_ring.h"
+#include "config.h"
+#include "ntrip_connect.h"
+#include "ntrip_http.h"
+#include "ntrip_session.h"
+#include "ntrip_tls.h"
+#include "corr_age.h"
+#include "fleet_push.h"
+#include "load_governor.h"
+#include "metrics_http.h"
+#include "nmea_parser.h"
+#include "perf_probe.h"
+#include "quantile_sketch.h"
+#include "rtcm_framer.h"
+#include "rtcm3x_parser.h"
+#include "stats_snapshot.h"
+#include "stream_clock.h"
+#include "timer_wheel.h"
+#include "uring_rx.h"
+#include "cJSON.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MULTI_TYPE_SLOTS      48    /* distinct message types tracked per stream */
+#define MULTI_HDR_MAX         2048  /* HTTP / ICY response header limit */
+#define MULTI_CONNECT_TIMEOUT 15.0  /* s, connect + response header */
+#define MULTI_ATTEMPT_STALL   2.0   /* s, give up on one address if others remain */
+#define MULTI_DNS_JOBS        8     /* concurrent lookups of distinct casters */
+#define MULTI_GGA_INTERVAL    1.0   /* s, same as the single-stream modes */
+#define MULTI_IDLE_TIMEOUT    NTRIP_SESSION_IDLE_S  /* s without a byte: connection dead */
+#define MULTI_STABLE_S        60.0  /* s streaming before the backoff starts over */
+#define MULTI_STATS_INTERVAL  1.0   /* s, --metrics-listen export tick */
+#define MULTI_STATUS_INTERVAL 10.0  /* s, stderr progress line */
+#define MULTI_TIMER_TICK      0.01  /* s, timer wheel resolution */
+#define MULTI_WAIT_EVENTS     256   /* events fetched per epoll_wait() */
+#define MULTI_LOAD_REASONS    8     /* distinct failure reasons in the load summary */
+#define MULTI_PROBE_SETTLE    15.0  /* s, VRS probe: wait for the ARP at the start position */
+#define MULTI_PROBE_WAIT      30.0  /* s, ... for a new ARP after the GGA switch */
+#define MULTI_PROBE_MIX       10.0  /* s, ... streaming on for the message mix */
+#define MULTI_SHARD_TICK      1.0   /* s, --shards: totals of a shard published */
+#define MULTI_BALANCE_INTERVAL 30.0 /* s, --shards: busy fraction of the shards compared */
+#define MULTI_BALANCE_MIN     0.10  /* ... difference that moves streams */
+#define MULTI_BALANCE_MOVES   64    /* ... streams moved per balance at most */
+
+typedef enum {
+    MS_PENDING,         /* not started yet (load-test ramp) */
+    MS_CONNECTING,      /* non-blocking connect() in progress */
+    MS_TLS,             /* TLS handshake in progress */
+    MS_HEADER,          /* request sent, waiting for the response header */
+    MS_STREAMING,       /* header accepted, RTCM flowing into the framer */
+    MS_BACKOFF,         /* lost, waiting to reconnect */
+    MS_CLOSED,          /* caster closed a streaming connection */
+    MS_FAILED           /* DNS, connect, HTTP status or timeout failure */
+} MultiState;
+
+static const char *multi_state_name(MultiState s)
+{
+    switch (s) {
+    case MS_PENDING:    return "pending";
+    case MS_CONNECTING: return "connecting";
+    case MS_TLS:        return "tls";
+    case MS_HEADER:     return "header";
+    case MS_STREAMING:  return "streaming";
+    case MS_BACKOFF:    return "reconnect";
+    case MS_CLOSED:     return "closed";
+    case MS_FAILED:     return "failed";
+    }
+    return "?";
+}
+
+/* Per-type statistics, same fields as MsgStats in ntrip_handler.c but kept
+ * in a small table instead of a 4096-entry array per stream. */
+typedef struct {
+    int     msg_type;
+    int     count;
+    double  last_time;
+    double  min_dt;
+    double  max_dt;
+    double  sum_dt;
+    QSketch dt;                     /* interval distribution, merged for the fleet */
+} MultiTypeStat;
+
+/* Load-test distributions shared by all sessions (one thread). */
+typedef struct {
+    QSketch connect_ms;             /* TCP connect */
+    QSketch header_ms;              /* response header accepted */
+    QSketch first_ms;               /* first RTCM byte */
+    QSketch age_ms;                 /* age of corrections, every MSM frame */
+    QSketch kbps;                   /* throughput per streaming session */
+} MultiLoad;
+
+/* VRS probe session: where it is in vrs_probe.h's three steps. */
+typedef enum {
+    PROBE_START,        /* GGA at the configured position, waiting for its ARP */
+    PROBE_SWITCHED,     /* GGA at the probe position, waiting for a new ARP */
+    PROBE_MIX           /* new ARP seen, collecting the message mix */
+} MultiProbePhase;
+
+struct MultiRun;
+
+typedef struct {
+    NTRIP_Config       cfg;
+    struct MultiRun   *run;
+    int                idx;             /* index in the event loop */
+    NtripAddr          addrs[NTRIP_CONNECT_MAX_ADDRS];
+    int                n_addrs;
+    int                next_addr;       /* next address to try */
+    SOCKET_TYPE        sock;
+    NtripTls          *tls;             /* NULL = plaintext */
+    unsigned           flags;           /* NTRIP_SESSION_TLS, ... */
+    MultiState         state;
+    char               note[96];        /* failure reason or status line */
+    char               gga[104];        /* GGA sentence incl. CRLF */
+    NtripHttp          http;            /* reply decoder: header, chunks */
+    double             t_open;
+    double             t_attempt;       /* current connect attempt started */
+    double             t_last_rx;
+    double             gga_s;           /* GGA period; 0 = send none */
+    TimerWheelTimer    tm_open;         /* ramp start, end of a reconnect backoff */
+    TimerWheelTimer    tm_deadline;     /* connect / header / idle timeout */
+    TimerWheelTimer    tm_gga;
+    TimerWheelTimer    tm_stats;        /* --metrics-listen export */
+    int                backoff_ms;      /* next reconnect delay */
+    int                backoff_max_ms;  /* 0 = do not reconnect */
+    int                attempts;        /* reconnect attempts since the loss */
+    double             t_lost;          /* connection lost, for the gap report */
+    bool               streamed;        /* reached MS_STREAMING at least once */
+    unsigned long      reconnects;
+    double             t_start;         /* s after the run start (load-test ramp) */
+    double             t_connected;     /* load test: TCP connect done, 0 = not yet */
+    double             t_header;        /* load test: header accepted, 0 = not yet */
+    double             t_first_byte;    /* load test: first RTCM byte, 0 = not yet */
+    int64_t            rx_utc_ns;       /* load test, --rollups: wall-clock time of the last recv() */
+    MultiLoad         *load;            /* load test; NULL = monitor */
+    VrsProbePoint     *probe;           /* VRS probe position and results; NULL = off */
+    MultiProbePhase    probe_phase;
+    double             t_switch;        /* VRS probe: GGA moved to the probe position */
+    TimerWheelTimer    tm_probe;        /* VRS probe: end of the current step; survey: of the window */
+    SurveyMount       *survey;          /* caster survey results; NULL = off */
+    unsigned long long bytes;
+    int                n_types;
+    unsigned long      other_frames;    /* frames whose type did not fit */
+    MultiTypeStat      types[MULTI_TYPE_SLOTS];
+    SatMask            sats[FLEET_GNSS];    /* --push: seen since the last summary */
+    RtcmFramer         framer;
+    PerfStream        *perf;            /* --perf stage latency; NULL = off */
+    MetricsMount      *mx;              /* --metrics-listen export; NULL = off */
+    double             cpu_s;           /* --shards: loop time spent on its events */
+    double             cpu_mark;        /* ... cpu_s at the shard's last balance */
+} MultiStream;
+
+#ifdef _WIN32
+static double multi_now(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / freq.QuadPart;
+}
+#else
+static double multi_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+#endif
+
+/* ── Event-loop backend ────────────────────────────────────────────────
+ * A minimal readiness interface over epoll (Linux) and poll()/WSAPoll()
+ * (everything else).  Streams are identified by their index.  Each
+ * stream waits either for writability (connect in progress) or for
+ * readability (everything after that).
+ *
+ * On Linux a plaintext stream that is streaming moves to io_uring
+ * (uring_rx.h) when the kernel offers it: loop_ring_recv() keeps one
+ * receive queued into its framer ring, all of them go to the kernel in
+ * one call per loop_wait(), and a completed receive comes back as an
+ * event with @c done set.  Requests carry the stream index and a
+ * generation that loop_unwatch() bumps, so a completion that arrives
+ * after the socket was taken off the ring is recognised and dropped. */
+
+typedef struct {
+    int idx;
+    int readable;
+    int writable;
+    int error;
+    int done;               /* io_uring receive completed; its result in res */
+    int res;                /* bytes received, 0 = closed, -errno */
+} MultiEvent;
+
+#define LOOP_RING_IDX   0xFFFFFFFFu     /* epoll data of the ring descriptor */
+#define LOOP_RING_SEND  (1ULL << 63)    /* request tag: a GGA send */
+#define LOOP_RING_ON    1u              /* ring_flags: the socket is on the ring */
+#define LOOP_RING_TX    2u              /* ... a send from ring_tx is in flight */
+
+typedef struct {
+#ifdef MULTI_USE_EPOLL
+    int                 epfd;
+    struct epoll_event  ev[MULTI_WAIT_EVENTS];
+    UringRx            *ring;           /* NULL = recv() on readiness only */
+    int                 n;
+    uint32_t           *ring_gen;       /* per stream: generation of its requests */
+    unsigned char      *ring_flags;     /* per stream: LOOP_RING_* */
+    char              (*ring_tx)[104];  /* per stream: the GGA being sent */
+#else
+    struct pollfd      *pfd;
+    int                 n;
+#endif
+    MultiEvent         *out;
+} MultiLoop;
+
+/* One run: the streams, their readiness loop and the timer wheel that
+ * carries every deadline of every stream (GGA, metrics tick, connect and
+ * idle timeouts, reconnect backoff), so nothing walks all streams. */
+typedef struct MultiRun {
+    MultiStream        *ms;
+    int                 n;
+    int                 alive;          /* streams not closed or failed */
+    const char         *mounts_file;    /* monitor: re-read on a reload; NULL = none */
+    MultiLoop           loop;
+    TimerWheel          wheel;
+    TimerWheelTimer     status;         /* stderr progress line */
+    double              t0;
+    bool                quiet;
+    unsigned long long  last_bytes;     /* at the previous progress line */
+    double              last_t;
+    LoadGovernor       *gov;            /* monitor: load shedding; NULL = none */
+    double              t_gov;          /* start of the current duty sample */
+    double              idle;           /* ... seconds of it spent waiting */
+    FleetPush          *push;           /* monitor: summaries to a collector; NULL = none */
+    TimerWheelTimer     tm_push;
+    int                 batch;          /* streams open at once; 0 = all */
+    int                 next;           /* survey: next pending stream to open */
+    double              window;         /* survey: s sampled per stream */
+    struct MultiShard  *shard;          /* --shards: the shard this loop is; NULL = the only one */
+    uint32_t            seed;           /* backoff jitter */
+} MultiRun;
+
+/* --shards: the monitor on several loop threads.  Each shard is a
+ * MultiRun of its own (loop, wheel, alive count) over the shared stream
+ * array and owns the streams whose @c run is its run, socket, framer and
+ * counters alike, so a stream is only ever touched by one thread.  The
+ * shards see each other's totals through a StatsSnapshot; streams change
+ * hands through the receiving shard's inbox. */
+typedef struct {
+    int                 owned, streaming;
+    unsigned long       frames, crc;
+    unsigned long long  bytes;
+    double              busy;           /* fraction of the last tick not spent waiting */
+    double              work_s;         /* s not spent waiting since the start */
+} MultiShardStats;
+
+struct MultiShards;
+
+typedef struct MultiShard {
+    MultiRun            run;
+    struct MultiShards *all;
+    int                 id;
+    int                 cpu;            /* --pin-cores: its core; -1 = not pinned */
+    StatsSnapshot       pub;            /* MultiShardStats, every MULTI_SHARD_TICK */
+    TimerWheelTimer     tm_tick;
+    double              t_tick;         /* start of the current tick */
+    double              idle_tick;      /* ... seconds of it spent waiting */
+    double              work_s;
+    double              t_mark;         /* last balance: stream cpu_mark taken */
+    MultiLock           lock;           /* inbox */
+    int                *inbox;          /* streams handed over, not yet adopted */
+    int                 n_inbox;        /* atomic */
+    int                 shed_to;        /* atomic: shard to hand streams to; -1 = none */
+    double              shed;           /* ... busy fraction to hand over, set before */
+    uint32_t            reload_seen;
+    double              elapsed;
+#ifdef _WIN32
+    HANDLE              thread;
+#else
+    pthread_t           thread;
+#endif
+} MultiShard;
+
+typedef struct MultiShards {
+    MultiShard         *sh;
+    int                 n;
+    int                 alive;          /* atomic: streams not closed or failed, all shards */
+    int                 stop;           /* atomic: end every shard */
+    int                 duration_s;
+    const volatile int *stop_flag;
+    MultiLock           lock;           /* reload_base */
+    NTRIP_Config        reload_base;
+    uint32_t            reload_gen;     /* atomic */
+    MultiShardStats    *view;           /* shard 0: the last consistent read of each */
+    double             *work_last;      /* shard 0: work_s of each at the last balance */
+    double              t_balance;
+    unsigned long       moved;          /* atomic: streams that changed shard */
+} MultiShards;
+
+/* The monitor's governor, fed by the duty cycle of the loop.  Static so
+ * a frame hook can hand it to its consumers before the run starts. */
+static LoadGovernor s_load_gov;
+
+static FleetPush *s_push;
+
+static const char *s_anomaly_path;
+
+void ntrip_multi_set_anomaly_dump(const char *path)
+{
+    s_anomaly_path = path;
+}
+
+void ntrip_multi_set_push(FleetPush *push)
+{
+    s_push = push;
+}
+
+LoadGovernor *ntrip_multi_governor(void)
+{
+    return &s_load_gov;
+}
+
+static int loop_open(MultiLoop *lp, int n)
+{
+#ifdef MULTI_USE_EPOLL
+    /* The kernel sizes the interest set; @p n sizes the ring. */
+    lp->epfd = epoll_create1(0);
+    if (lp->epfd < 0) return -1;
+    /* Readiness events plus as many ring completions per wait. */
+    lp->out = (MultiEvent *)calloc(2 * MULTI_WAIT_EVENTS, sizeof(MultiEvent));
+    if (!lp->out) { close(lp->epfd); return -1; }
+    lp->n    = n;
+    lp->ring = uring_rx_open((unsigned)n * 2);
+    if (lp->ring) {
+        lp->ring_gen   = (uint32_t *)calloc((size_t)n, sizeof(uint32_t));
+        lp->ring_flags = (unsigned char *)calloc((size_t)n, 1);
+        lp->ring_tx    = (char (*)[104])malloc((size_t)n * sizeof(*lp->ring_tx));
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events   = EPOLLIN;
+        ev.data.u32 = LOOP_RING_IDX;
+        if (!lp->ring_gen || !lp->ring_flags || !lp->ring_tx ||
+            epoll_ctl(lp->epfd, EPOLL_CTL_ADD, uring_rx_fd(lp->ring), &ev) != 0) {
+            free(lp->ring_gen);
+            free(lp->ring_flags);
+            free(lp->ring_tx);
+            uring_rx_close(lp->ring);
+            lp->ring = NULL;
+        }
+    }
+#else
+    lp->n   = n;
+    lp->pfd = (struct pollfd *)calloc((size_t)n, sizeof(struct pollfd));
+    lp->out = (MultiEvent *)calloc((size_t)n, sizeof(MultiEvent));
+    if (!lp->pfd || !lp->out) { free(lp->pfd); free(lp->out); return -1; }
+    for (int i = 0; i < n; i++) lp->pfd[i].fd = SOCK_INVALID;
+#endif
+    return 0;
+}
+
+static void loop_close(MultiLoop *lp)
+{
+#ifdef MULTI_USE_EPOLL
+    if (lp->ring) {
+        uring_rx_close(lp->ring);       /* cancels whatever is still queued */
+        free(lp->ring_gen);
+        free(lp->ring_flags);
+        free(lp->ring_tx);
+    }
+    close(lp->epfd);
+#else
+    free(lp->pfd);
+#endif
+    free(lp->out);
+}
+
+/* true if the receives of stream @p idx go through the ring. */
+static bool loop_on_ring(const MultiLoop *lp, int idx)
+{
+#ifdef MULTI_USE_EPOLL
+    return lp->ring && (lp->ring_flags[idx] & LOOP_RING_ON);
+#else
+    (void)lp;
+    (void)idx;
+    return false;
+#endif
+}
+
+/* Queue the next receive of stream @p idx into @p buf, moving @p s from
+ * epoll to the ring first; false if there is no ring (then nothing
+ * changed and @p s is still watched for readability). */
+static bool loop_ring_recv(MultiLoop *lp, int idx, SOCKET_TYPE s, void *buf, size_t len)
+{
+#ifdef MULTI_USE_EPOLL
+    if (!lp->ring) return false;
+    uint64_t tag = (uint64_t)(lp->ring_gen[idx] & 0x7FFFFFFFu) << 32 | (uint32_t)idx;
+    if (!(lp->ring_flags[idx] & LOOP_RING_ON)) {
+        if (!uring_rx_recv(lp->ring, s, buf, len, tag)) return false;
+        epoll_ctl(lp->epfd, EPOLL_CTL_DEL, s, NULL);
+        lp->ring_flags[idx] |= LOOP_RING_ON;
+        return true;
+    }
+    if (uring_rx_recv(lp->ring, s, buf, len, tag)) return true;
+    /* The queue cannot take it: back to readiness. */
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u32 = (uint32_t)idx;
+    uring_rx_cancel(lp->ring, s);
+    lp->ring_gen[idx]++;
+    lp->ring_flags[idx] = 0;
+    epoll_ctl(lp->epfd, EPOLL_CTL_ADD, s, &ev);
+    return false;
+#else
+    (void)lp; (void)idx; (void)s; (void)buf; (void)len;
+    return false;
+#endif
+}
+
+/* Queue @p len bytes of @p buf (copied) as a send on stream @p idx's
+ * ring socket, to go with the next batch; false if it is not on the
+ * ring or its previous send is still in flight. */
+static bool loop_ring_send(MultiLoop *lp, int idx, SOCKET_TYPE s, const char *buf, size_t len)
+{
+#ifdef MULTI_USE_EPOLL
+    if (!loop_on_ring(lp, idx) || (lp->ring_flags[idx] & LOOP_RING_TX) ||
+        len > sizeof(lp->ring_tx[idx]))
+        return false;
+    memcpy(lp->ring_tx[idx], buf, len);
+    uint64_t tag = LOOP_RING_SEND | (uint64_t)(lp->ring_gen[idx] & 0x7FFFFFFFu) << 32 |
+                   (uint32_t)idx;
+    if (!uring_rx_send(lp->ring, s, lp->ring_tx[idx], len, tag)) return false;
+    lp->ring_flags[idx] |= LOOP_RING_TX;
+    return true;
+#else
+    (void)lp; (void)idx; (void)s; (void)buf; (void)len;
+    return false;
+#endif
+}
+
+/* Start (add != 0) or change watching @p s for stream @p idx. */
+static void loop_watch(MultiLoop *lp, int idx, SOCKET_TYPE s, int want_write, int add)
+{
+#ifdef MULTI_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = want_write ? EPOLLOUT : EPOLLIN;
+    ev.data.u32 = (uint32_t)idx;
+    epoll_ctl(lp->epfd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, s, &ev);
+#else
+    (void)add;
+    lp->pfd[idx].fd      = s;
+    lp->pfd[idx].events  = want_write ? POLLOUT : POLLIN;
+    lp->pfd[idx].revents = 0;
+#endif
+}
+
+static void loop_unwatch(MultiLoop *lp, int idx, SOCKET_TYPE s)
+{
+#ifdef MULTI_USE_EPOLL
+    if (loop_on_ring(lp, idx)) {
+        /* The framer ring may be reset once this returns. */
+        uring_rx_cancel(lp->ring, s);
+        lp->ring_gen[idx]++;
+        lp->ring_flags[idx] = 0;
+        return;
+    }
+    epoll_ctl(lp->epfd, EPOLL_CTL_DEL, s, NULL);
+#else
+    (void)s;
+    lp->pfd[idx].fd = SOCK_INVALID;
+#endif
+}
+
+/* Wait up to @p timeout_ms; returns the number of events in lp->out. */
+static int loop_wait(MultiLoop *lp, int timeout_ms)
+{
+    int k = 0;
+#ifdef MULTI_USE_EPOLL
+    /* Everything re-armed since the last wait goes in one call; the
+     * ring descriptor is readable while completions wait. */
+    if (lp->ring) uring_rx_submit(lp->ring);
+    int r = epoll_wait(lp->epfd, lp->ev, MULTI_WAIT_EVENTS, timeout_ms);
+    for (int i = 0; i < r; i++) {
+        if (lp->ev[i].data.u32 == LOOP_RING_IDX) continue;
+        memset(&lp->out[k], 0, sizeof(lp->out[k]));
+        lp->out[k].idx      = (int)lp->ev[i].data.u32;
+        lp->out[k].readable = (lp->ev[i].events & EPOLLIN)  != 0;
+        lp->out[k].writable = (lp->ev[i].events & EPOLLOUT) != 0;
+        lp->out[k].error    = (lp->ev[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+        k++;
+    }
+    /* Completions beyond this batch keep the descriptor readable. */
+    uint64_t tag;
+    int res;
+    for (int c = 0; lp->ring && c < MULTI_WAIT_EVENTS && uring_rx_next(lp->ring, &tag, &res); c++) {
+        uint32_t idx = (uint32_t)tag;
+        if (idx >= (uint32_t)lp->n ||
+            (uint32_t)(tag >> 32 & 0x7FFFFFFFu) != (lp->ring_gen[idx] & 0x7FFFFFFFu))
+            continue;                   /* taken off the ring meanwhile */
+        if (tag & LOOP_RING_SEND) {
+            lp->ring_flags[idx] &= (unsigned char)~LOOP_RING_TX;
+            continue;                   /* a lost connection shows on the receive side */
+        }
+        memset(&lp->out[k], 0, sizeof(lp->out[k]));
+        lp->out[k].idx  = (int)idx;
+        lp->out[k].done = 1;
+        lp->out[k].res  = res;
+        k++;
+    }
+#else
+#ifdef _WIN32
+    int r = WSAPoll(lp->pfd, (ULONG)lp->n, timeout_ms);
+#else
+    int r = poll(lp->pfd, (nfds_t)lp->n, timeout_ms);
+#endif
+    for (int i = 0; i < lp->n && k < r; i++) {
+        short re = lp->pfd[i].revents;
+        if (lp->pfd[i].fd == SOCK_INVALID || !re) continue;
+        lp->out[k].idx      = i;
+        lp->out[k].readable = (re & POLLIN)  != 0;
+        lp->out[k].writable = (re & POLLOUT) != 0;
+        lp->out[k].error    = (re & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+        k++;
+    }
+#endif
+    return k;
+}
+
+/* ── Mounts file ───────────────────────────────────────────────────── */
+
+static void json_copy_str(const cJSON *obj, const char *key, char *dst, size_t dst_len)
+{
+    const cJSON *it = cJSON_GetObjectItem(obj, key);
+    if (it && cJSON_IsString(it)) {
+        strncpy(dst, it->valuestring, dst_len - 1);
+        dst[dst_len - 1] = '\0';
+    }
+}
+
+int ntrip_multi_load_mounts(const NTRIP_Config *base, const char *path,
+                            NTRIP_Config **out, int *out_n)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror("Failed to open mounts file");
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = (char *)malloc((size_t)length + 1);
+    if (!data) {
+        fclose(file);
+        return -1;
+    }
+    size_t got = fread(data, 1, (size_t)length, file);
+    data[got] = '\0';
+    fclose(file);
+
+    cJSON *root = cJSON_Parse(data);
+    free(data);
+    if (!root) {
+        fprintf(stderr, "[ERROR] Failed to parse mounts file %s near: %.32s\n",
+                path, cJSON_GetErrorPtr() ? cJSON_GetErrorPtr() : "");
+        return -1;
+    }
+
+    const cJSON *list = cJSON_IsArray(root) ? root : cJSON_GetObjectItem(root, "mounts");
+    if (!list || !cJSON_IsArray(list)) {
+        fprintf(stderr, "[ERROR] %s: expected an array or {\"mounts\": [...]}\n", path);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    int count = cJSON_GetArraySize(list);
+    if (count > NTRIP_MULTI_MAX_STREAMS) {
+        fprintf(stderr, "[WARN] %s: %d entries, only the first %d are used\n",
+                path, count, NTRIP_MULTI_MAX_STREAMS);
+        count = NTRIP_MULTI_MAX_STREAMS;
+    }
+    NTRIP_Config *cfgs = count > 0 ? (NTRIP_Config *)calloc((size_t)count, sizeof(NTRIP_Config))
+                                   : NULL;
+    if (count > 0 && !cfgs) {
+        fprintf(stderr, "[ERROR] Out of memory for %d streams\n", count);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    int n = 0, pos = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, list) {
+        if (n >= count) break;
+        pos++;
+        NTRIP_Config *c = &cfgs[n];
+        *c = *base;
+        c->MOUNTPOINT[0] = '\0';
+
+        if (cJSON_IsString(item)) {
+            strncpy(c->MOUNTPOINT, item->valuestring, sizeof(c->MOUNTPOINT) - 1);
+        } else if (cJSON_IsObject(item)) {
+            json_copy_str(item, "MOUNTPOINT",   c->MOUNTPOINT,   sizeof(c->MOUNTPOINT));
+            json_copy_str(item, "NTRIP_CASTER", c->NTRIP_CASTER, sizeof(c->NTRIP_CASTER));
+            json_copy_str(item, "USERNAME",     c->USERNAME,     sizeof(c->USERNAME));
+            json_copy_str(item, "PASSWORD",     c->PASSWORD,     sizeof(c->PASSWORD));
+            const cJSON *tls  = cJSON_GetObjectItem(item, "TLS");
+            if (cJSON_IsBool(tls))   c->TLS = cJSON_IsTrue(tls) ? 1 : -1;
+            if (cJSON_IsNumber(tls)) c->TLS = tls->valueint > 0 ? 1 : (tls->valueint < 0 ? -1 : 0);
+            const cJSON *port = cJSON_GetObjectItem(item, "NTRIP_PORT");
+            const cJSON *lat  = cJSON_GetObjectItem(item, "LATITUDE");
+            const cJSON *lon  = cJSON_GetObjectItem(item, "LONGITUDE");
+            const cJSON *gga  = cJSON_GetObjectItem(item, "GGA_INTERVAL");
+            if (port && cJSON_IsNumber(port)) c->NTRIP_PORT   = port->valueint;
+            if (lat  && cJSON_IsNumber(lat))  c->LATITUDE     = lat->valuedouble;
+            if (lon  && cJSON_IsNumber(lon))  c->LONGITUDE    = lon->valuedouble;
+            if (gga  && cJSON_IsNumber(gga))  c->GGA_INTERVAL = gga->valueint;
+        }
+        if (!c->MOUNTPOINT[0]) {
+            fprintf(stderr, "[WARN] %s: entry %d has no MOUNTPOINT, skipped\n", path, pos);
+            continue;
+        }
+
+        char auth[512];
+        snprintf(auth, sizeof(auth), "%s:%s", c->USERNAME, c->PASSWORD);
+        base64_encode(auth, c->AUTH_BASIC);
+        n++;
+    }
+    cJSON_Delete(root);
+
+    *out   = cfgs;
+    *out_n = n;
+    return 0;
+}
+
+/* ── Per-stream handling ───────────────────────────────────────────── */
+
+static void multi_count_type(MultiStream *ms, const unsigned char *frame, int frame_len)
+{
+    if (frame_len < 8) return;      /* no room for a message number */
+
+    int msg_type = (frame[3] << 4) | (frame[4] >> 4);
+    double now = ms->t_last_rx;     /* set by the caller before commit */
+
+    uint64_t mask;
+    int gnss_id;
+    if (ms->run->push &&
+        msm_extract_sat_mask(frame + 3, frame_len - 6, msg_type, &mask, NULL, &gnss_id) &&
+        gnss_id >= 0 && gnss_id < FLEET_GNSS)
+        ms->sats[gnss_id] |= mask;
+
+    MultiTypeStat *s = NULL;
+    for (int i = 0; i < ms->n_types; i++) {
+        if (ms->types[i].msg_type == msg_type) { s = &ms->types[i]; break; }
+    }
+    if (!s) {
+        if (ms->n_types == MULTI_TYPE_SLOTS) { ms->other_frames++; return; }
+        s = &ms->types[ms->n_types++];
+        memset(s, 0, sizeof(*s));
+        s->msg_type  = msg_type;
+        s->last_time = now;
+    } else {
+        double dt = now - s->last_time;
+        s->last_time = now;
+        s->sum_dt += dt;
+        s->min_dt = (dt < s->min_dt || s->min_dt == 0.0) ? dt : s->min_dt;
+        s->max_dt = dt > s->max_dt ? dt : s->max_dt;
+        qsketch_add(&s->dt, dt);
+    }
+    s->count++;
+}
+
+static NtripMultiFrameHook s_frame_hook;
+static void               *s_frame_hook_user;
+
+void ntrip_multi_set_frame_hook(NtripMultiFrameHook hook, void *user)
+{
+    s_frame_hook      = hook;
+    s_frame_hook_user = user;
+}
+
+static NtripMultiReloadHook s_reload_hook;
+static void                *s_reload_hook_user;
+
+void ntrip_multi_set_reload_hook(NtripMultiReloadHook hook, void *user)
+{
+    s_reload_hook      = hook;
+    s_reload_hook_user = user;
+}
+
+static void multi_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    MultiStream *ms = (MultiStream *)user;
+    if (ms->mx) {
+        metrics_mount_frame(ms->mx, frame, frame_len, ms->t_last_rx);
+        metrics_mount_age(ms->mx, frame, frame_len, ms->rx_utc_ns);
+    }
+    if (s_frame_hook) s_frame_hook(ms->idx, frame, frame_len, s_frame_hook_user);
+    if (!ms->perf) {
+        multi_count_type(ms, frame, frame_len);
+        return;
+    }
+    PerfFrame pf;
+    perf_frame_begin(ms->perf, &pf);
+    multi_count_type(ms, frame, frame_len);
+    perf_frame_stage(ms->perf, &pf, PERF_STAGE_DECODE);
+    perf_frame_end(ms->perf, &pf);
+}
+
+/* Load test: the framer has validated the CRC; only the MSM epoch time
+ * is read, for the age of corrections. */
+static void multi_load_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    MultiStream *ms = (MultiStream *)user;
+    int64_t age_ns;
+    if (corr_age_of_frame(frame, frame_len, ms->rx_utc_ns, &age_ns))
+        qsketch_add(&ms->load->age_ms, (double)age_ns / 1e6);
+}
+
+/* xorshift32 for the backoff jitter, so streams of one caster that lost
+ * it together do not all come back on the same tick.  One state per
+ * loop: shards draw without sharing it. */
+static uint32_t multi_rand(MultiRun *run)
+{
+    uint32_t x = run->seed;
+    if (!x) x = (uint32_t)time(NULL) ^ (uint32_t)(multi_now() * 1e6) ^ 0x9E3779B9u ^
+                (uint32_t)(uintptr_t)run;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return run->seed = x;
+}
+
+/* Arm the timeout of the current state: the connect attempt stall and
+ * the connect / header limit, or the idle limit while streaming. */
+static void multi_arm_deadline(MultiStream *ms)
+{
+    double at;
+    switch (ms->state) {
+    case MS_CONNECTING:
+        at = ms->t_open + MULTI_CONNECT_TIMEOUT;
+        if (ms->next_addr < ms->n_addrs && ms->t_attempt + MULTI_ATTEMPT_STALL < at)
+            at = ms->t_attempt + MULTI_ATTEMPT_STALL;
+        break;
+    case MS_TLS:
+    case MS_HEADER:
+        at = ms->t_open + MULTI_CONNECT_TIMEOUT;
+        break;
+    case MS_STREAMING:
+        at = ms->t_last_rx + MULTI_IDLE_TIMEOUT;
+        break;
+    default:
+        return;
+    }
+    timer_wheel_schedule(&ms->run->wheel, &ms->tm_deadline, at);
+}
+
+/* Wait for the next reconnect attempt: the backoff doubles after each
+ * failed one up to RECONNECT_DELAY_MAX, half fixed and half random, and
+ * starts over once a connection held for a while. */
+static void multi_backoff(MultiStream *ms, double now)
+{
+    if (ms->attempts == 0) {
+        ms->t_lost = now;
+        if (now - ms->t_header >= MULTI_STABLE_S) ms->backoff_ms = NTRIP_SESSION_BACKOFF_MIN_MS;
+        if (!ms->run->quiet)
+            fprintf(stderr, "[MULTI] %s: connection lost (%s); reconnecting\n",
+                    ms->cfg.MOUNTPOINT, ms->note);
+    } else if (ms->backoff_ms < ms->backoff_max_ms) {
+        ms->backoff_ms *= 2;
+        if (ms->backoff_ms > ms->backoff_max_ms) ms->backoff_ms = ms->backoff_max_ms;
+    }
+    int half = ms->backoff_ms / 2;
+    int delay_ms = half + (int)(multi_rand(ms->run) % (uint32_t)(half + 1));
+    ms->state = MS_BACKOFF;
+    timer_wheel_schedule(&ms->run->wheel, &ms->tm_open, now + delay_ms / 1000.0);
+}
+
+/* Count @p d streams more (or fewer) alive, in all shards as well. */
+static void multi_alive_add(MultiRun *run, int d)
+{
+    run->alive += d;
+    if (run->shard) __atomic_add_fetch(&run->shard->all->alive, d, __ATOMIC_RELAXED);
+}
+
+/* A stream of a batched run ended: open the next pending one. */
+static void multi_open_next(MultiRun *run)
+{
+    while (run->next < run->n) {
+        MultiStream *ms = &run->ms[run->next++];
+        if (ms->state != MS_PENDING) continue;      /* DNS or TLS failure */
+        timer_wheel_schedule(&run->wheel, &ms->tm_open, multi_now());
+        return;
+    }
+}
+
+/* Close the connection.  A stream that has streamed before and may
+ * reconnect waits out a backoff; anything else ends in @p state. */
+static void multi_fail(MultiStream *ms, MultiLoop *lp, int idx,
+                       MultiState state, const char *note)
+{
+    ntrip_tls_free(ms->tls);
+    ms->tls = NULL;
+    if (ms->sock != SOCK_INVALID) {
+        loop_unwatch(lp, idx, ms->sock);
+        CLOSESOCKET(ms->sock);
+        ms->sock = SOCK_INVALID;
+    }
+    timer_wheel_cancel(&ms->run->wheel, &ms->tm_deadline);
+    timer_wheel_cancel(&ms->run->wheel, &ms->tm_gga);
+    timer_wheel_cancel(&ms->run->wheel, &ms->tm_probe);
+    snprintf(ms->note, sizeof(ms->note), "%s", note);
+    if (ms->streamed && ms->backoff_max_ms > 0) {
+        multi_backoff(ms, multi_now());
+        return;
+    }
+    ms->state = state;
+    multi_alive_add(ms->run, -1);
+    if (ms->run->batch) multi_open_next(ms->run);
+}
+
+/* Start a non-blocking connect to the next address that accepts one;
+ * false when every address has been tried. */
+static bool multi_attempt(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    while (ms->next_addr < ms->n_addrs) {
+        ms->sock = ntrip_connect_start(&ms->addrs[ms->next_addr++]);
+        if (ms->sock == SOCK_INVALID) continue;
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(ms->sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        ms->t_attempt = now;
+        loop_watch(lp, idx, ms->sock, 1, 1);
+        multi_arm_deadline(ms);
+        return true;
+    }
+    return false;
+}
+
+/* Open the socket and start a non-blocking connect. */
+static void multi_start(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    ms->t_open    = now;
+    ms->state     = MS_CONNECTING;
+    ms->next_addr = 0;
+    if (!multi_attempt(ms, lp, idx, now))
+        multi_fail(ms, lp, idx, MS_FAILED, "connect failed");
+}
+
+/* The current connect attempt failed or stalled: drop it and try the
+ * next address (RFC 8305 fallback), or fail the stream. */
+static void multi_next_addr(MultiStream *ms, MultiLoop *lp, int idx, double now,
+                            const char *note)
+{
+    loop_unwatch(lp, idx, ms->sock);
+    CLOSESOCKET(ms->sock);
+    ms->sock = SOCK_INVALID;
+    if (!multi_attempt(ms, lp, idx, now))
+        multi_fail(ms, lp, idx, MS_FAILED, note);
+}
+
+/* send() / recv() on the stream, through TLS if it uses it. */
+static int multi_send(MultiStream *ms, const char *buf, int len)
+{
+    if (ms->tls) return ntrip_io_send(ms->sock, ms->tls, buf, len);
+    return (int)send(ms->sock, buf, len, MSG_NOSIGNAL);
+}
+
+static int multi_recv(MultiStream *ms, void *buf, int len)
+{
+    return ntrip_io_recv(ms->sock, ms->tls, buf, len);
+}
+
+/* Send the GGA sentence and schedule the next one at @p next; none at
+ * all when GGA_INTERVAL < 0. */
+static void multi_send_gga(MultiStream *ms, double next)
+{
+    if (ms->gga_s <= 0.0) return;
+    size_t len = strlen(ms->gga);
+    if (!loop_ring_send(&ms->run->loop, ms->idx, ms->sock, ms->gga, len))
+        multi_send(ms, ms->gga, (int)len);
+    timer_wheel_schedule(&ms->run->wheel, &ms->tm_gga, next);
+}
+
+/* Connected (and through the TLS handshake): send the request. */
+static void multi_send_request(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    char request[1024];
+    int req_len = snprintf(request, sizeof(request),
+             "GET /%s HTTP/1.1\r\n"
+             "Host: %s\r\n"
+             "Ntrip-Version: Ntrip/2.0\r\n"
+             "User-Agent: NTRIP CClient/1.0\r\n"
+             "Authorization: Basic %s\r\n"
+             "\r\n",
+             ms->cfg.MOUNTPOINT, ms->cfg.NTRIP_CASTER, ms->cfg.AUTH_BASIC);
+    /* A fresh socket's send buffer always takes the whole request. */
+    if (multi_send(ms, request, req_len) != req_len) {
+        multi_fail(ms, lp, idx, MS_FAILED, "send request failed");
+        return;
+    }
+    multi_send_gga(ms, now + ms->gga_s);
+    if (ms->probe && ms->probe_phase == PROBE_SWITCHED)
+        ms->t_switch = now;         /* the first GGA is already the probe position */
+
+    ntrip_http_init(&ms->http);
+    ms->state = MS_HEADER;
+    loop_watch(lp, idx, ms->sock, 0, 0);
+    multi_arm_deadline(ms);
+}
+
+/* Advance the TLS handshake; it decides which readiness to wait for. */
+static void multi_on_tls(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    bool want_write = false;
+    int r = ntrip_tls_handshake_step(ms->tls, &want_write);
+    if (r == 0) {
+        loop_watch(lp, idx, ms->sock, want_write, 0);
+    } else if (r < 0) {
+        char note[96];
+        snprintf(note, sizeof(note), "TLS: %.88s", ntrip_tls_error(ms->tls));
+        multi_fail(ms, lp, idx, MS_FAILED, note);
+    } else {
+        multi_send_request(ms, lp, idx, now);
+    }
+}
+
+/* connect() finished: check the result and send the request. */
+static void multi_on_connected(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    if (!ntrip_connect_result(ms->sock)) {
+        multi_next_addr(ms, lp, idx, now, "connect failed");
+        return;
+    }
+    ms->t_connected = now;
+
+    if (ms->flags & NTRIP_SESSION_TLS) {
+        ms->tls = ntrip_tls_new(ms->sock, ms->cfg.NTRIP_CASTER, ms->cfg.NTRIP_PORT,
+                                !(ms->flags & NTRIP_SESSION_TLS_NOVERIFY));
+        if (!ms->tls) {
+            multi_fail(ms, lp, idx, MS_FAILED, "TLS setup failed");
+            return;
+        }
+        ms->state = MS_TLS;
+        multi_arm_deadline(ms);
+        multi_on_tls(ms, lp, idx, now);
+        return;
+    }
+    multi_send_request(ms, lp, idx, now);
+}
+
+/* @p r bytes arrived at the framer's write pointer @p dst at @p now: let
+ * the reply decoder strip the header and chunk framing in place; only
+ * RTCM bytes are committed, after t_last_rx, which stamps their frames. */
+static void multi_rx_framed(MultiStream *ms, unsigned char *dst, int r, double now)
+{
+    if (ms->perf) perf_recv(ms->perf);
+    size_t body = ntrip_http_decode(&ms->http, dst, (size_t)r);
+    if (body > 0 && ntrip_http_ok(&ms->http)) {         /* not an error page */
+        if (ms->load) {
+            ms->rx_utc_ns = stream_clock_utc_ns();
+            if (ms->bytes == 0) ms->t_first_byte = multi_now();
+        } else if (ms->survey || (ms->mx && ms->mx->rollup)) {
+            ms->rx_utc_ns = stream_clock_utc_ns();
+        }
+        ms->bytes += (unsigned long long)body;
+        ms->t_last_rx = now;
+        rtcm_framer_commit(&ms->framer, body);
+        StreamFormat fmt = rtcm_framer_new_format(&ms->framer);
+        if (fmt != STREAM_FMT_NONE && !ms->run->quiet)
+            stream_format_log(fmt, ms->cfg.MOUNTPOINT);
+    }
+}
+
+/* Receive straight into the framer ring. */
+static int multi_recv_framed(MultiStream *ms, double now)
+{
+    size_t avail;
+    unsigned char *dst = rtcm_framer_write_ptr(&ms->framer, &avail);
+    int r = multi_recv(ms, dst, (int)avail);
+    if (r > 0) multi_rx_framed(ms, dst, r, now);
+    return r;
+}
+
+/* Queue the next receive of a plaintext stream on the ring, if there is
+ * one; otherwise it stays on recv() after readiness. */
+static void multi_ring_arm(MultiStream *ms, MultiLoop *lp, int idx)
+{
+    if (ms->tls || ms->state != MS_STREAMING || ms->sock == SOCK_INVALID) return;
+    size_t avail;
+    unsigned char *dst = rtcm_framer_write_ptr(&ms->framer, &avail);
+    loop_ring_recv(lp, idx, ms->sock, dst, avail);
+}
+
+/* Read the response header; on completion check the status line.  Body
+ * bytes that arrived with it are already in the framer. */
+static void multi_on_header(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    int r = multi_recv_framed(ms, now);
+    if (r < 0 && SOCK_WOULDBLOCK()) return;
+    if (r <= 0) {
+        multi_fail(ms, lp, idx, MS_FAILED, "closed before response header");
+        return;
+    }
+    if (!ntrip_http_head_done(&ms->http)) {
+        if (ms->http.head_bytes >= MULTI_HDR_MAX)
+            multi_fail(ms, lp, idx, MS_FAILED, "response header too long");
+        return;
+    }
+
+    if (!ntrip_http_ok(&ms->http)) {
+        /* Keep the status line, e.g. "HTTP/1.1 401 Unauthorized" or
+         * "SOURCETABLE 200 OK" for an unknown mountpoint. */
+        char status[80];
+        snprintf(status, sizeof(status), "%.79s", ms->http.status_line);
+        multi_fail(ms, lp, idx, MS_FAILED, status);
+        return;
+    }
+
+    ms->state     = MS_STREAMING;
+    ms->t_last_rx = now;
+    ms->t_header  = now;
+    ms->streamed  = true;
+    multi_arm_deadline(ms);
+    if (ms->attempts > 0) {
+        ms->reconnects++;
+        if (!ms->run->quiet)
+            fprintf(stderr, "[MULTI] %s: reconnected after %d attempt(s); gap %.1f s\n",
+                    ms->cfg.MOUNTPOINT, ms->attempts, now - ms->t_lost);
+        snprintf(ms->note, sizeof(ms->note), "%lu reconnect(s)", ms->reconnects);
+        ms->attempts = 0;
+    }
+    if (ms->probe) {
+        ms->probe->header_s = now - ms->t_open;
+        timer_wheel_schedule(&ms->run->wheel, &ms->tm_probe,
+                             ms->probe_phase == PROBE_START ? now + MULTI_PROBE_SETTLE
+                                                            : ms->t_switch + MULTI_PROBE_WAIT);
+    }
+    if (ms->survey) {
+        ms->survey->header_s = now - ms->t_open;
+        timer_wheel_schedule(&ms->run->wheel, &ms->tm_probe, now + ms->run->window);
+    }
+    multi_ring_arm(ms, lp, idx);
+}
+
+static void multi_on_data(MultiStream *ms, MultiLoop *lp, int idx, double now)
+{
+    int r = multi_recv_framed(ms, now);
+    if (r < 0 && SOCK_WOULDBLOCK()) return;
+    if (r == 0) {
+        multi_fail(ms, lp, idx, MS_CLOSED, "closed by caster");
+        return;
+    }
+    if (r < 0) {
+        multi_fail(ms, lp, idx, MS_CLOSED, "receive error");
+        return;
+    }
+    ms->t_last_rx = now;
+}
+
+/* A receive queued by multi_ring_arm() completed with @p res. */
+static void multi_on_ring_data(MultiStream *ms, MultiLoop *lp, int idx, double now, int res)
+{
+    if (res == -EAGAIN || res == -EINTR) {
+        multi_ring_arm(ms, lp, idx);
+        return;
+    }
+    if (res == 0) {
+        multi_fail(ms, lp, idx, MS_CLOSED, "closed by caster");
+        return;
+    }
+    if (res < 0) {
+        multi_fail(ms, lp, idx, MS_CLOSED, "receive error");
+        return;
+    }
+    size_t avail;
+    multi_rx_framed(ms, rtcm_framer_write_ptr(&ms->framer, &avail), res, now);
+    ms->t_last_rx = now;
+    multi_ring_arm(ms, lp, idx);        /* unless a frame hook closed it */
+}
+
+/* Copy the counters the frame callback does not see to the exporter's
+ * struct and publish it when due; a state change is published at once. */
+static void multi_export(const MultiStream *ms, double now, bool force)
+{
+    MetricsMount *m = ms->mx;
+    if (!m) return;
+    int st = ms->state == MS_STREAMING ? METRICS_STREAMING :
+             ms->state <  MS_STREAMING || ms->state == MS_BACKOFF ? METRICS_CONNECTING
+                                                                  : METRICS_DOWN;
+    if (m->state != st) force = true;
+    m->state      = st;
+    m->bytes      = (uint64_t)ms->bytes;
+    m->reconnects = ms->reconnects;
+    metrics_mount_framer(m, &ms->framer);
+    metrics_mount_publish(m, now, force);
+}
+
+/* --push: a summary of every stream to the collector.  The type tables
+ * are copied, so the sender thread never reads what the loop writes. */
+static void multi_push(MultiRun *run, double now)
+{
+    int n_types = 0;
+    for (int i = 0; i < run->n; i++) n_types += run->ms[i].n_types;
+    FleetStream *fs = (FleetStream *)calloc((size_t)run->n, sizeof(FleetStream));
+    FleetType   *ft = (FleetType *)malloc((size_t)(n_types ? n_types : 1) * sizeof(FleetType));
+    if (!fs || !ft) {
+        free(fs);
+        free(ft);
+        return;
+    }
+    FleetType *t = ft;
+    for (int i = 0; i < run->n; i++) {
+        MultiStream *ms = &run->ms[i];
+        FleetStream *s  = &fs[i];
+        snprintf(s->mount, sizeof(s->mount), "%.47s", ms->cfg.MOUNTPOINT);
+        s->state = ms->state == MS_STREAMING ? FLEET_STREAMING :
+                   ms->state <  MS_STREAMING || ms->state == MS_BACKOFF ? FLEET_CONNECTING
+                                                                        : FLEET_DOWN;
+        s->reconnects = (uint32_t)ms->reconnects;
+        s->bytes      = ms->bytes;
+        s->frames     = ms->framer.frames;
+        s->crc_errors = ms->framer.crc_errors;
+        memcpy(s->sats, ms->sats, sizeof(s->sats));
+        memset(ms->sats, 0, sizeof(ms->sats));
+        s->types   = t;
+        s->n_types = ms->n_types;
+        for (int k = 0; k < ms->n_types; k++, t++) {
+            t->msg_type = ms->types[k].msg_type;
+            t->frames   = (uint64_t)ms->types[k].count;
+            t->dt       = ms->types[k].dt;
+        }
+    }
+    FleetSummary sum;
+    memset(&sum, 0, sizeof(sum));
+    sum.n_streams = run->n;
+    sum.streams   = fs;
+    fleet_push_submit(run->push, &sum, now - run->t0);
+    free(fs);
+    free(ft);
+}
+
+/* Resolve every distinct caster once, MULTI_DNS_JOBS at a time; streams
+ * sharing a caster share the cached answer.  Returns the number of
+ * streams left in a failed state. */
+static int multi_resolve(MultiStream *ms, int n)
+{
+    const char **hosts = (const char **)calloc((size_t)n, sizeof(*hosts));
+    int n_hosts = 0, failed = 0;
+    if (hosts) {
+        for (int i = 0; i < n; i++) {
+            int j;
+            for (j = 0; j < n_hosts; j++) {
+                if (strcmp(hosts[j], ms[i].cfg.NTRIP_CASTER) == 0) break;
+            }
+            if (j == n_hosts) hosts[n_hosts++] = ms[i].cfg.NTRIP_CASTER;
+        }
+        ntrip_dns_prefetch(hosts, n_hosts, MULTI_DNS_JOBS);
+        free(hosts);
+    }
+
+    for (int i = 0; i < n; i++) {
+        ms[i].flags = ntrip_config_session_flags(&ms[i].cfg, false);
+        if ((ms[i].flags & NTRIP_SESSION_TLS) && !ntrip_tls_available()) {
+            ms[i].state = MS_FAILED;
+            snprintf(ms[i].note, sizeof(ms[i].note), "TLS not supported by this build");
+            failed++;
+            continue;
+        }
+        ms[i].n_addrs = ntrip_dns_lookup(ms[i].cfg.NTRIP_CASTER, ms[i].cfg.NTRIP_PORT,
+                                         ms[i].addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+        if (ms[i].n_addrs == 0) {
+            ms[i].state = MS_FAILED;
+            snprintf(ms[i].note, sizeof(ms[i].note), "DNS lookup failed");
+            failed++;
+        }
+    }
+    return failed;
+}
+
+/* ── Summary ───────────────────────────────────────────────────────── */
+
+static int cmp_type_stat(const void *a, const void *b)
+{
+    return ((const MultiTypeStat *)a)->msg_type - ((const MultiTypeStat *)b)->msg_type;
+}
+
+static void multi_print_summary(MultiStream *ms, int n, double elapsed)
+{
+    printf("\n[INFO] Multi-mountpoint monitor: %d streams, %.0f s\n", n, elapsed);
+    printf("+----------------------+--------------------------------+------------+------------+---------+--------+---------+\n");
+    printf("| Mountpoint           | Caster                         | State      |      Bytes |  Frames |    CRC | Skipped |\n");
+    printf("+----------------------+--------------------------------+------------+------------+---------+--------+---------+\n");
+    for (int i = 0; i < n; i++) {
+        char caster[48];
+        snprintf(caster, sizeof(caster), "%.24s:%d", ms[i].cfg.NTRIP_CASTER, ms[i].cfg.NTRIP_PORT);
+        printf("| %-20.20s | %-30.30s | %-10s | %10llu | %7lu | %6lu | %7lu |\n",
+               ms[i].cfg.MOUNTPOINT, caster, multi_state_name(ms[i].state),
+               ms[i].bytes, ms[i].framer.frames, ms[i].framer.crc_errors,
+               ms[i].framer.skipped_bytes);
+    }
+    printf("+----------------------+--------------------------------+------------+------------+---------+--------+---------+\n");
+
+    /* Per stream: failure reason, or message types as type x count
+     * (average interval). */
+    for (int i = 0; i < n; i++) {
+        printf("%-20s ", ms[i].cfg.MOUNTPOINT);
+        if (ms[i].n_types == 0) {
+            printf("%s\n", ms[i].note[0] ? ms[i].note : "no RTCM frames");
+            continue;
+        }
+        qsort(ms[i].types, (size_t)ms[i].n_types, sizeof(MultiTypeStat), cmp_type_stat);
+        for (int t = 0; t < ms[i].n_types; t++) {
+            const MultiTypeStat *s = &ms[i].types[t];
+            if (s->count > 1)
+                printf(" %d x%d (%.2fs)", s->msg_type, s->count, s->sum_dt / (s->count - 1));
+            else
+                printf(" %d x%d", s->msg_type, s->count);
+        }
+        if (ms[i].other_frames)
+            printf(" +%lu other", ms[i].other_frames);
+        if (ms[i].note[0])
+            printf("  [%s]", ms[i].note);
+        printf("\n");
+    }
+
+    /* Interval quantiles per message type over all streams */
+    MultiTypeStat *fleet = (MultiTypeStat *)calloc(MULTI_TYPE_SLOTS, sizeof(MultiTypeStat));
+    if (!fleet) return;
+    int n_fleet = 0;
+    for (int i = 0; i < n; i++) {
+        for (int t = 0; t < ms[i].n_types; t++) {
+            const MultiTypeStat *s = &ms[i].types[t];
+            if (s->dt.count == 0) continue;
+            int f = 0;
+            while (f < n_fleet && fleet[f].msg_type != s->msg_type) f++;
+            if (f == n_fleet) {
+                if (n_fleet == MULTI_TYPE_SLOTS) continue;
+                fleet[n_fleet++].msg_type = s->msg_type;
+            }
+            qsketch_merge(&fleet[f].dt, &s->dt);
+        }
+    }
+    if (n_fleet > 0) {
+        char title[64];
+        qsort(fleet, (size_t)n_fleet, sizeof(MultiTypeStat), cmp_type_stat);
+        snprintf(title, sizeof(title), "[INFO] Message intervals, %d streams", n);
+        qsketch_print_head(title, stdout);
+        for (int f = 0; f < n_fleet; f++)
+            qsketch_print_row(fleet[f].msg_type, &fleet[f].dt, stdout);
+        qsketch_print_foot(stdout);
+    }
+    free(fleet);
+
+    /* --perf: all streams in one table */
+    PerfStream *sum = (PerfStream *)calloc(1, sizeof(PerfStream));
+    if (!sum) return;
+    for (int i = 0; i < n; i++) {
+        if (!ms[i].perf) continue;
+        for (int s = 0; s < PERF_STAGE_COUNT; s++)
+            perf_hist_merge(&sum->stage[s], &ms[i].perf->stage[s]);
+    }
+    if (perf_stream_any(sum)) {
+        char title[64];
+        snprintf(title, sizeof(title), "[INFO] Stage latency, %d streams", n);
+        perf_print_table(sum, title, stdout);
+    }
+    free(sum);
+}
+
+/* ── Event loop ────────────────────────────────────────────────────── */
+
+/* Ramp start, or the end of a reconnect backoff. */
+static void multi_open_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *ms = (MultiStream *)arg;
+    (void)t;
+    if (ms->state == MS_BACKOFF) {
+        ms->attempts++;
+        rtcm_framer_reset(&ms->framer);     /* no half frame across connections */
+    } else if (ms->state != MS_PENDING) {
+        return;
+    }
+    multi_start(ms, &ms->run->loop, ms->idx, now);
+}
+
+/* A connect attempt stalled, the connect / header limit passed, or a
+ * streaming connection may have gone quiet. */
+static void multi_deadline_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *s  = (MultiStream *)arg;
+    MultiLoop   *lp = &s->run->loop;
+    (void)t;
+    if (s->state == MS_CONNECTING && s->next_addr < s->n_addrs &&
+        now - s->t_attempt >= MULTI_ATTEMPT_STALL) {
+        multi_next_addr(s, lp, s->idx, now, "connect timeout");
+    } else if ((s->state == MS_CONNECTING || s->state == MS_TLS || s->state == MS_HEADER) &&
+               now - s->t_open >= MULTI_CONNECT_TIMEOUT) {
+        multi_fail(s, lp, s->idx, MS_FAILED,
+                   s->state == MS_CONNECTING ? "connect timeout" :
+                   s->state == MS_TLS        ? "TLS handshake timeout"
+                                             : "response header timeout");
+    } else if (s->state == MS_STREAMING && now - s->t_last_rx >= MULTI_IDLE_TIMEOUT) {
+        multi_fail(s, lp, s->idx, MS_CLOSED, "no data, idle timeout");
+    } else {
+        multi_arm_deadline(s);      /* data arrived since it was armed */
+    }
+}
+
+static void multi_gga_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *ms = (MultiStream *)arg;
+    if (ms->state != MS_HEADER && ms->state != MS_STREAMING) return;
+    double next = t->at + ms->gga_s;        /* keep the cadence ... */
+    if (next <= now) next = now + ms->gga_s; /* ... unless it fell behind */
+    multi_send_gga(ms, next);
+}
+
+static void multi_push_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiRun *run = (MultiRun *)arg;
+    multi_push(run, now);
+    timer_wheel_schedule(&run->wheel, t, t->at + FLEET_PUSH_INTERVAL_S);
+}
+
+static void multi_stats_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *ms = (MultiStream *)arg;
+    multi_export(ms, now, false);
+    timer_wheel_schedule(&ms->run->wheel, t, t->at + MULTI_STATS_INTERVAL);
+}
+
+/* Take the settings of @p cfg that apply without a new connection:
+ * GGA position and period, reconnect ceiling. */
+static void multi_stream_configure(MultiStream *ms, const NTRIP_Config *cfg)
+{
+    char gga[100];
+    ms->cfg   = *cfg;
+    ms->gga_s = cfg->GGA_INTERVAL > 0 ? (double)cfg->GGA_INTERVAL :
+                cfg->GGA_INTERVAL == 0 ? MULTI_GGA_INTERVAL : 0.0;
+    /* The load test measures what the caster keeps, so it never reconnects. */
+    ms->backoff_max_ms = ms->load || cfg->RECONNECT_DELAY_MAX < 0 ? 0 :
+                         (cfg->RECONNECT_DELAY_MAX ? cfg->RECONNECT_DELAY_MAX
+                                                   : NTRIP_SESSION_BACKOFF_MAX_S) * 1000;
+    create_gngga_sentence(ms->cfg.LATITUDE, ms->cfg.LONGITUDE, gga);
+    snprintf(ms->gga, sizeof(ms->gga), "%s\r\n", gga);
+}
+
+static void multi_stream_init(MultiStream *ms, const NTRIP_Config *cfg, MultiLoad *load,
+                              MultiRun *run, int idx)
+{
+    ms->run        = run;
+    ms->idx        = idx;
+    ms->sock       = SOCK_INVALID;
+    ms->load       = load;
+    ms->backoff_ms = NTRIP_SESSION_BACKOFF_MIN_MS;
+    multi_stream_configure(ms, cfg);
+    rtcm_framer_init(&ms->framer, load ? multi_load_frame : multi_frame, ms);
+    timer_init(&ms->tm_open,     multi_open_due,     ms);
+    timer_init(&ms->tm_deadline, multi_deadline_due, ms);
+    timer_init(&ms->tm_gga,      multi_gga_due,      ms);
+    timer_init(&ms->tm_stats,    multi_stats_due,    ms);
+}
+
+static void multi_shard_status(MultiShard *sh, double now);
+
+/* Progress line on stderr every MULTI_STATUS_INTERVAL. */
+static void multi_status_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiRun *run = (MultiRun *)arg;
+    const MultiStream *ms = run->ms;
+    if (run->shard) {
+        multi_shard_status(run->shard, now);
+        timer_wheel_schedule(&run->wheel, t, t->at + MULTI_STATUS_INTERVAL);
+        return;
+    }
+    int started = 0, streaming = 0, down = 0;
+    unsigned long frames = 0, crc = 0;
+    unsigned long long bytes = 0;
+    for (int i = 0; i < run->n; i++) {
+        if (ms[i].state != MS_PENDING)   started++;
+        if (ms[i].state == MS_STREAMING) streaming++;
+        if (ms[i].state >  MS_STREAMING) down++;
+        frames += ms[i].framer.frames;
+        crc    += ms[i].framer.crc_errors;
+        bytes  += ms[i].bytes;
+    }
+    double el = now - run->t0;
+    if (ms[0].probe) {
+        int switched = 0, same = 0;
+        for (int i = 0; i < run->n; i++) {
+            switched += ms[i].probe_phase == PROBE_MIX;
+            same     += ms[i].probe_phase == PROBE_SWITCHED && ms[i].probe->arp_valid;
+        }
+        fprintf(stderr, "[VRS] t=%4.0fs  started %d/%d  streaming %d  done %d  switched %d  same ARP %d\n",
+                el, started, run->n, streaming, down, switched, same);
+    } else if (ms[0].survey) {
+        int failed = 0;
+        for (int i = 0; i < run->n; i++) failed += ms[i].state == MS_FAILED;
+        fprintf(stderr, "[SURVEY] t=%4.0fs  started %d/%d  streaming %d  done %d  failed %d  frames %lu  CRC errors %lu\n",
+                el, started, run->n, streaming, down - failed, failed, frames, crc);
+    } else if (!ms[0].load) {
+        int level = run->gov ? load_gov_level(run->gov) : LOAD_FULL;
+        fprintf(stderr, "[MULTI] t=%4.0fs  streaming %d/%d  frames %lu  bytes %llu  CRC errors %lu%s%s\n",
+                el, streaming, run->n, frames, bytes, crc,
+                level ? "  load " : "", level ? load_gov_level_name(level) : "");
+    } else {
+        double kbps = el > run->last_t ? (double)(bytes - run->last_bytes) * 8.0 / 1000.0 /
+                                         (el - run->last_t) : 0.0;
+        fprintf(stderr, "[LOAD] t=%4.0fs  started %d/%d  streaming %d  down %d  %.1f kbit/s  frames %lu  CRC errors %lu\n",
+                el, started, run->n, streaming, down, kbps, frames, crc);
+        run->last_bytes = bytes;
+        run->last_t     = el;
+    }
+    timer_wheel_schedule(&run->wheel, t, t->at + MULTI_STATUS_INTERVAL);
+}
+
+/* ── Live reload ───────────────────────────────────────────────────── */
+
+/* Re-open @p ms with the connection settings of @p cfg: close what is
+ * open, resolve the caster and wait in MS_PENDING until @p at. */
+static void multi_restart(MultiStream *ms, const NTRIP_Config *cfg, double at)
+{
+    MultiRun *run  = ms->run;
+    bool      down = ms->state == MS_FAILED || ms->state == MS_CLOSED;
+    ntrip_tls_free(ms->tls);
+    ms->tls = NULL;
+    if (ms->sock != SOCK_INVALID) {
+        loop_unwatch(&run->loop, ms->idx, ms->sock);
+        CLOSESOCKET(ms->sock);
+        ms->sock = SOCK_INVALID;
+    }
+    timer_wheel_cancel(&run->wheel, &ms->tm_deadline);
+    timer_wheel_cancel(&run->wheel, &ms->tm_gga);
+    multi_stream_configure(ms, cfg);
+    rtcm_framer_reset(&ms->framer);     /* no half frame across connections */
+    ms->flags      = ntrip_config_session_flags(&ms->cfg, false);
+    ms->attempts   = 0;
+    ms->backoff_ms = NTRIP_SESSION_BACKOFF_MIN_MS;
+    if (ms->mx)
+        metrics_mount_label(ms->mx, ms->cfg.MOUNTPOINT, ms->cfg.NTRIP_CASTER, ms->cfg.NTRIP_PORT);
+
+    const char *fail = NULL;
+    if ((ms->flags & NTRIP_SESSION_TLS) && !ntrip_tls_available()) {
+        fail = "TLS not supported by this build";
+    } else {
+        ms->n_addrs = ntrip_dns_lookup(ms->cfg.NTRIP_CASTER, ms->cfg.NTRIP_PORT,
+                                       ms->addrs, NTRIP_CONNECT_MAX_ADDRS, false);
+        if (ms->n_addrs == 0) fail = "DNS lookup failed";
+    }
+    if (fail) {
+        snprintf(ms->note, sizeof(ms->note), "%s", fail);
+        ms->state = MS_FAILED;
+        if (!down) multi_alive_add(run, -1);
+        return;
+    }
+    snprintf(ms->note, sizeof(ms->note), "config reloaded");
+    ms->state = MS_PENDING;
+    if (down) multi_alive_add(run, 1);
+    timer_wheel_schedule(&run->wheel, &ms->tm_open, at);
+}
+
+/* Same connection, new position, GGA period or reconnect ceiling; a
+ * connected stream sends the new GGA at once. */
+static void multi_reposition(MultiStream *ms, const NTRIP_Config *cfg, double now)
+{
+    multi_stream_configure(ms, cfg);
+    if (ms->state != MS_HEADER && ms->state != MS_STREAMING) return;
+    if (ms->gga_s > 0.0) multi_send_gga(ms, now + ms->gga_s);
+    else                 timer_wheel_cancel(&ms->run->wheel, &ms->tm_gga);
+}
+
+/* Read the mounts file again with @p base and apply it entry by entry
+ * to the streams of @p run; each shard applies it to its own. */
+static void multi_reload(MultiRun *run, const NTRIP_Config *base, double now)
+{
+    NTRIP_Config *cfgs;
+    int n = 0;
+    bool lead = !run->shard || run->shard->id == 0;     /* one complaint, not one per shard */
+    if (ntrip_multi_load_mounts(base, run->mounts_file, &cfgs, &n) != 0) {
+        if (lead)
+            fprintf(stderr, "[MULTI] Reload: %s unusable; keeping the running streams\n",
+                    run->mounts_file);
+        return;
+    }
+    if (n != run->n) {
+        if (lead)
+            fprintf(stderr, "[MULTI] Reload: %s lists %d mountpoints, %d are running; "
+                    "adding or removing streams needs a restart\n", run->mounts_file, n, run->n);
+        free(cfgs);
+        return;
+    }
+
+    /* Resolve the casters of the streams to re-open in parallel first. */
+    const char **hosts = (const char **)malloc((size_t)n * sizeof(*hosts));
+    int n_hosts = 0;
+    for (int i = 0; hosts && i < n; i++) {
+        if (run->ms[i].run != run) continue;
+        if (!(config_diff(&run->ms[i].cfg, &cfgs[i]) & CONFIG_DIFF_OBS)) continue;
+        int j;
+        for (j = 0; j < n_hosts; j++) {
+            if (strcmp(hosts[j], cfgs[i].NTRIP_CASTER) == 0) break;
+        }
+        if (j == n_hosts) hosts[n_hosts++] = cfgs[i].NTRIP_CASTER;
+    }
+    if (n_hosts > 0) ntrip_dns_prefetch(hosts, n_hosts, MULTI_DNS_JOBS);
+    free(hosts);
+
+    int restarted = 0, moved = 0, owned = 0;
+    for (int i = 0; i < n; i++) {
+        MultiStream *ms = &run->ms[i];
+        if (ms->run != run) continue;
+        owned++;
+        unsigned d = config_diff(&ms->cfg, &cfgs[i]);   /* EPH_* is not used here */
+        if (d & CONFIG_DIFF_OBS) {
+            if (!run->quiet)
+                fprintf(stderr, "[MULTI] %s: connection settings changed; reconnecting\n",
+                        cfgs[i].MOUNTPOINT);
+            multi_restart(ms, &cfgs[i], now + restarted * NTRIP_MULTI_RELOAD_STAGGER);
+            multi_export(ms, now, true);
+            restarted++;
+        } else if (d & (CONFIG_DIFF_POSITION | CONFIG_DIFF_OTHER)) {
+            multi_reposition(ms, &cfgs[i], now);
+            if (d & CONFIG_DIFF_POSITION) moved++;
+        }
+    }
+    free(cfgs);
+    if (!run->quiet)
+        fprintf(stderr, "[MULTI] Reload: %d stream(s) reconnecting, %d with a new position, "
+                "%d unchanged\n", restarted, moved, owned - restarted - moved);
+}
+
+/* ── Shards ────────────────────────────────────────────────────────── */
+
+/* Shard @p i's totals as last published; the previous copy if the read
+ * raced a publish.  Shard 0 only. */
+static const MultiShardStats *multi_shard_view(MultiShards *all, int i)
+{
+    MultiShardStats st;
+    if (stats_snapshot_read(&all->sh[i].pub, &st, NULL)) all->view[i] = st;
+    return &all->view[i];
+}
+
+/* Take streaming @p ms off this shard's loop and wheel and queue it in
+ * @p to's inbox; socket, TLS session and framer go along as they are. */
+static void multi_shard_hand_over(MultiStream *ms, MultiShard *to)
+{
+    MultiRun *run = ms->run;
+    loop_unwatch(&run->loop, ms->idx, ms->sock);
+    timer_wheel_cancel(&run->wheel, &ms->tm_deadline);
+    timer_wheel_cancel(&run->wheel, &ms->tm_gga);
+    timer_wheel_cancel(&run->wheel, &ms->tm_stats);
+    run->alive--;                       /* not in the total: it lives on */
+    ms->run = NULL;                     /* in transit, nobody's */
+    MULTI_LOCK(&to->lock);
+    to->inbox[to->n_inbox] = ms->idx;
+    __atomic_store_n(&to->n_inbox, to->n_inbox + 1, __ATOMIC_RELEASE);
+    MULTI_UNLOCK(&to->lock);
+    __atomic_add_fetch(&to->all->moved, 1, __ATOMIC_RELAXED);
+}
+
+/* Take over what other shards handed to this one: watch the sockets and
+ * arm the timers on this loop. */
+static void multi_shard_adopt(MultiShard *sh, double now)
+{
+    if (__atomic_load_n(&sh->n_inbox, __ATOMIC_ACQUIRE) == 0) return;
+    MultiRun *run = &sh->run;
+    MULTI_LOCK(&sh->lock);
+    for (int k = 0; k < sh->n_inbox; k++) {
+        MultiStream *ms = &run->ms[sh->inbox[k]];
+        ms->run      = run;
+        ms->cpu_mark = ms->cpu_s;
+        run->alive++;
+        loop_watch(&run->loop, ms->idx, ms->sock, 0, 1);
+        multi_arm_deadline(ms);
+        if (ms->gga_s > 0.0)
+            timer_wheel_schedule(&run->wheel, &ms->tm_gga, now + ms->gga_s);
+        if (ms->mx)
+            timer_wheel_schedule(&run->wheel, &ms->tm_stats, now + MULTI_STATS_INTERVAL);
+        multi_ring_arm(ms, &run->loop, ms->idx);
+    }
+    __atomic_store_n(&sh->n_inbox, 0, __ATOMIC_RELAXED);
+    MULTI_UNLOCK(&sh->lock);
+}
+
+typedef struct {
+    int    idx;
+    double cpu;                         /* fraction of a core since the last balance */
+} MultiShed;
+
+static int cmp_shed(const void *a, const void *b)
+{
+    double x = ((const MultiShed *)a)->cpu, y = ((const MultiShed *)b)->cpu;
+    return (x < y) - (x > y);           /* busiest first */
+}
+
+/* Hand streams worth about @p share of a core to @p to, busiest first,
+ * by the loop time each took since the last balance.  A stream heavier
+ * than what is left to hand over stays: moving it would only swap the
+ * roles of the two shards. */
+static void multi_shard_shed(MultiShard *sh, MultiShard *to, double share, double now)
+{
+    MultiRun *run  = &sh->run;
+    double    span = now - sh->t_mark;
+    MultiShed *c = (MultiShed *)malloc((size_t)run->n * sizeof(*c));
+    int n_c = 0;
+    for (int i = 0; c && i < run->n; i++) {
+        MultiStream *ms = &run->ms[i];
+        if (ms->run != run) continue;
+        if (ms->state == MS_STREAMING && span > 0.0) {
+            c[n_c].idx = i;
+            c[n_c].cpu = (ms->cpu_s - ms->cpu_mark) / span;
+            n_c++;
+        }
+        ms->cpu_mark = ms->cpu_s;
+    }
+    sh->t_mark = now;
+    if (!c) return;
+    qsort(c, (size_t)n_c, sizeof(*c), cmp_shed);
+    int    moved = 0;
+    double left  = share;
+    for (int k = 0; k < n_c && moved < MULTI_BALANCE_MOVES; k++) {
+        if (c[k].cpu <= 0.0 || c[k].cpu > left) continue;
+        multi_shard_hand_over(&run->ms[c[k].idx], to);
+        left -= c[k].cpu;
+        moved++;
+    }
+    free(c);
+    if (moved && !run->quiet)
+        fprintf(stderr, "[MULTI] Shard %d: %d stream(s), %.0f%% of a core, to shard %d\n",
+                sh->id, moved, (share - left) * 100.0, to->id);
+}
+
+/* Shard 0, every MULTI_BALANCE_INTERVAL: compare how busy the shards
+ * were over the interval and ask the busiest to hand half the difference
+ * to the idlest.  The request waits in shed_to until the busiest shard's
+ * next tick. */
+static void multi_shard_balance(MultiShards *all, double now)
+{
+    double span = now - all->t_balance;
+    if (span < MULTI_BALANCE_INTERVAL) return;
+    all->t_balance = now;
+    int    hi = 0, lo = 0;
+    double busy_hi = -1.0, busy_lo = 2.0;
+    for (int i = 0; i < all->n; i++) {
+        double w    = multi_shard_view(all, i)->work_s;
+        double busy = (w - all->work_last[i]) / span;
+        all->work_last[i] = w;
+        if (busy > busy_hi) { busy_hi = busy; hi = i; }
+        if (busy < busy_lo) { busy_lo = busy; lo = i; }
+    }
+    MultiShard *from = &all->sh[hi];
+    if (hi == lo || busy_hi - busy_lo < MULTI_BALANCE_MIN ||
+        __atomic_load_n(&from->shed_to, __ATOMIC_ACQUIRE) >= 0)
+        return;
+    from->shed = (busy_hi - busy_lo) / 2.0;
+    __atomic_store_n(&from->shed_to, lo, __ATOMIC_RELEASE);
+}
+
+/* Every MULTI_SHARD_TICK: publish the totals of this shard, hand streams
+ * over if shard 0 asked for it, and on shard 0 compare the shards. */
+static void multi_shard_tick_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiShard *sh  = (MultiShard *)arg;
+    MultiRun   *run = &sh->run;
+    MultiShardStats st;
+    memset(&st, 0, sizeof(st));
+    for (int i = 0; i < run->n; i++) {
+        const MultiStream *ms = &run->ms[i];
+        if (ms->run != run) continue;
+        st.owned++;
+        if (ms->state == MS_STREAMING) st.streaming++;
+        st.frames += ms->framer.frames;
+        st.crc    += ms->framer.crc_errors;
+        st.bytes  += ms->bytes;
+    }
+    double span = now - sh->t_tick;
+    if (span > 0.0) {
+        double work = span - sh->idle_tick;
+        if (work < 0.0) work = 0.0;
+        st.busy     = work / span;
+        sh->work_s += work;
+    }
+    st.work_s     = sh->work_s;
+    sh->t_tick    = now;
+    sh->idle_tick = 0.0;
+    stats_snapshot_publish(&sh->pub, &st);
+
+    int to = __atomic_load_n(&sh->shed_to, __ATOMIC_ACQUIRE);
+    if (to >= 0) {
+        multi_shard_shed(sh, &sh->all->sh[to], sh->shed, now);
+        __atomic_store_n(&sh->shed_to, -1, __ATOMIC_RELEASE);
+    }
+    if (sh->id == 0) multi_shard_balance(sh->all, now);
+    timer_wheel_schedule(&run->wheel, t, t->at + MULTI_SHARD_TICK);
+}
+
+/* The progress line of a sharded monitor, summed from what the shards
+ * published; printed by shard 0. */
+static void multi_shard_status(MultiShard *sh, double now)
+{
+    MultiShards *all = sh->all;
+    MultiRun    *run = &sh->run;
+    int streaming = 0;
+    unsigned long frames = 0, crc = 0;
+    unsigned long long bytes = 0;
+    char busy[NTRIP_MULTI_MAX_SHARDS * 5 + 1];
+    size_t k = 0;
+    busy[0] = '\0';
+    for (int i = 0; i < all->n; i++) {
+        const MultiShardStats *v = multi_shard_view(all, i);
+        streaming += v->streaming;
+        frames    += v->frames;
+        crc       += v->crc;
+        bytes     += v->bytes;
+        int w = snprintf(busy + k, sizeof(busy) - k, "%s%.0f%%", i ? " " : "", v->busy * 100.0);
+        if (w > 0 && (size_t)w < sizeof(busy) - k) k += (size_t)w;
+    }
+    int level = run->gov ? load_gov_level(run->gov) : LOAD_FULL;
+    fprintf(stderr, "[MULTI] t=%4.0fs  streaming %d/%d  frames %lu  bytes %llu  CRC errors %lu  busy %s%s%s\n",
+            now - run->t0, streaming, run->n, frames, bytes, crc, busy,
+            level ? "  load " : "", level ? load_gov_level_name(level) : "");
+}
+
+/* Live reload of a sharded monitor: shard 0 polls the hook and posts the
+ * new base config, every shard applies it to its own streams. */
+static void multi_shard_reload(MultiShard *sh, double now)
+{
+    MultiShards *all = sh->all;
+    NTRIP_Config base;
+    if (sh->id == 0 && s_reload_hook(&base, s_reload_hook_user)) {
+        MULTI_LOCK(&all->lock);
+        all->reload_base = base;
+        __atomic_add_fetch(&all->reload_gen, 1, __ATOMIC_RELEASE);
+        MULTI_UNLOCK(&all->lock);
+    }
+    if (__atomic_load_n(&all->reload_gen, __ATOMIC_ACQUIRE) == sh->reload_seen) return;
+    MULTI_LOCK(&all->lock);
+    base            = all->reload_base;
+    sh->reload_seen = all->reload_gen;
+    MULTI_UNLOCK(&all->lock);
+    multi_reload(&sh->run, &base, now);
+}
+
+/* true once the run is over for every shard. */
+static bool multi_shards_done(const MultiShards *all)
+{
+    return __atomic_load_n(&all->alive, __ATOMIC_RELAXED) <= 0 ||
+           __atomic_load_n(&all->stop, __ATOMIC_RELAXED);
+}
+
+/* Close one duty-cycle sample of the loop and move the load level: a
+ * loop that is busy nearly all the time is what falling behind looks
+ * like on one thread, the frames then wait in the socket buffers. */
+static void multi_govern(MultiRun *run, double now)
+{
+    double span = now - run->t_gov;
+    if (span < LOAD_GOV_SAMPLE_S) return;
+    double duty = 1.0 - run->idle / span;
+    if (run->shard) {
+        /* Sharded: the busiest loop is the one falling behind. */
+        MultiShards *all = run->shard->all;
+        for (int i = 0; i < all->n; i++) {
+            if (i == run->shard->id) continue;
+            double busy = multi_shard_view(all, i)->busy;
+            if (busy > duty) duty = busy;
+        }
+    }
+    run->t_gov = now;
+    run->idle  = 0.0;
+    int before = run->gov->level;
+    int level  = load_gov_sample(run->gov, load_gov_pressure(-1.0, -1.0, duty), now);
+    if (level != before && !run->quiet)
+        fprintf(stderr, "[MULTI] Loop %.0f%% busy: load level %s\n",
+                duty * 100.0, load_gov_level_name(level));
+}
+
+/* --anomaly-dump: append the anomaly ring of every stream to the dump
+ * file.  The rings are read lock-free, so this may run on shard 0 while
+ * the other shards write theirs. */
+static void multi_dump_anomalies(const MultiRun *run, const char *why)
+{
+    FILE *f = fopen(s_anomaly_path, "a");
+    if (!f) {
+        fprintf(stderr, "[WARN] Cannot open %s for the anomaly dump\n", s_anomaly_path);
+        return;
+    }
+    char ts[32] = "?";
+    time_t now_t = time(NULL);
+    struct tm *gt = gmtime(&now_t);
+    if (gt) strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S UTC", gt);
+    fprintf(f, "# NTRIP-Analyser anomaly dump, %s (%s), %d streams\n", ts, why, run->n);
+    int total = 0;
+    for (int i = 0; i < run->n; i++) {
+        const MultiStream *ms = &run->ms[i];
+        if (!ms->framer.anomalies || !anomaly_ring_count(ms->framer.anomalies)) continue;
+        total += anomaly_ring_dump(f, ms->framer.anomalies, ms->cfg.MOUNTPOINT);
+    }
+    fprintf(f, "\n");
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok)
+        fprintf(stderr, "[WARN] Cannot write the anomaly dump to %s\n", s_anomaly_path);
+    else if (!run->quiet)
+        fprintf(stderr, "[MULTI] %d anomal%s written to %s (%s)\n",
+                total, total == 1 ? "y" : "ies", s_anomaly_path, why);
+}
+
+/* Start each stream at its t_start (all 0 for the monitor) and run them
+ * until the duration ends, @p stop_flag is set or every stream is done.
+ * All deadlines are timers on the wheel; the loop only waits for the
+ * sockets or the next timer, whichever comes first.  Returns the run
+ * time. */
+static double multi_loop(MultiRun *run, int duration_s, const volatile int *stop_flag)
+{
+    MultiStream *ms = run->ms;
+    double t0 = run->t0 = multi_now();
+    timer_wheel_init(&run->wheel, t0, MULTI_TIMER_TICK);
+    run->alive = 0;
+    run->next  = 0;
+    for (int i = 0; i < run->n; i++) {
+        if (ms[i].state != MS_PENDING) continue;    /* DNS or TLS failure */
+        if (ms[i].run != run) continue;             /* another shard's */
+        run->alive++;
+        /* A batched run opens the rest as these end, see multi_fail(). */
+        if (run->batch && run->alive > run->batch) continue;
+        run->next = i + 1;
+        timer_wheel_schedule(&run->wheel, &ms[i].tm_open, t0 + ms[i].t_start);
+        /* Spread the export ticks over the second. */
+        if (ms[i].mx)
+            timer_wheel_schedule(&run->wheel, &ms[i].tm_stats,
+                                 t0 + MULTI_STATS_INTERVAL * (1.0 + (i % 100) / 100.0));
+    }
+    timer_init(&run->status, multi_status_due, run);
+    if (run->gov) {
+        load_gov_init(run->gov, t0);
+        run->t_gov = t0;
+        run->idle  = 0.0;
+    }
+    MultiShard *sh = run->shard;
+    if (sh) {
+        sh->t_tick = sh->t_mark = t0;
+        if (sh->id == 0) sh->all->t_balance = t0;
+        timer_init(&sh->tm_tick, multi_shard_tick_due, sh);
+        timer_wheel_schedule(&run->wheel, &sh->tm_tick, t0 + MULTI_SHARD_TICK);
+    }
+    if (!run->quiet && (!sh || sh->id == 0))
+        timer_wheel_schedule(&run->wheel, &run->status, t0 + MULTI_STATUS_INTERVAL);
+    if (run->push) {
+        timer_init(&run->tm_push, multi_push_due, run);
+        timer_wheel_schedule(&run->wheel, &run->tm_push, t0 + FLEET_PUSH_INTERVAL_S);
+    }
+
+    for (;;) {
+        double now = multi_now();
+        if (stop_flag && *stop_flag) break;
+        if (duration_s > 0 && now - t0 >= duration_s) break;
+        if (run->mounts_file && s_reload_hook) {
+            NTRIP_Config base;
+            if (sh) multi_shard_reload(sh, now);
+            else if (s_reload_hook(&base, s_reload_hook_user)) multi_reload(run, &base, now);
+        }
+        if (sh) multi_shard_adopt(sh, now);
+        if (s_anomaly_path && (!sh || sh->id == 0) && anomaly_dump_due())
+            multi_dump_anomalies(run, "SIGUSR1");
+        timer_wheel_advance(&run->wheel, now);
+        /* A shard without streams stays up: the balancer may send some. */
+        if (sh ? multi_shards_done(sh->all) : run->alive == 0) break;
+
+        double t_wait = multi_now();
+        int k = loop_wait(&run->loop, timer_wheel_timeout(&run->wheel, t_wait, 1.0));
+        now = multi_now();
+        run->idle += now - t_wait;
+        if (sh) sh->idle_tick += now - t_wait;
+        double t_ev = now;
+        for (int e = 0; e < k; e++) {
+            const MultiEvent *ev = &run->loop.out[e];
+            MultiStream *s = &ms[ev->idx];
+            if (s->sock == SOCK_INVALID || s->run != run) continue;
+            switch (s->state) {
+            case MS_CONNECTING:
+                /* WSAPoll on older Windows may never flag a refused
+                 * connect; the connect deadline catches that. */
+                if (ev->writable || ev->error) multi_on_connected(s, &run->loop, ev->idx, now);
+                break;
+            case MS_TLS:
+                multi_on_tls(s, &run->loop, ev->idx, now);
+                break;
+            case MS_HEADER:
+            case MS_STREAMING:
+                if (ev->done) {
+                    if (s->state == MS_STREAMING && loop_on_ring(&run->loop, ev->idx))
+                        multi_on_ring_data(s, &run->loop, ev->idx, now, ev->res);
+                    break;
+                }
+                if (!ev->readable && !ev->error) break;
+                /* TLS may hold decrypted bytes the socket no longer
+                 * signals; drain them before waiting again. */
+                do {
+                    if (s->state == MS_HEADER) multi_on_header(s, &run->loop, ev->idx, now);
+                    else                       multi_on_data(s, &run->loop, ev->idx, now);
+                } while (s->tls && (s->state == MS_HEADER || s->state == MS_STREAMING) &&
+                         ntrip_tls_pending(s->tls) > 0);
+                break;
+            default:
+                break;
+            }
+            multi_export(s, now, false);
+            if (sh) {
+                /* What the balancer weighs a stream by. */
+                double t = multi_now();
+                s->cpu_s += t - t_ev;
+                t_ev = t;
+            }
+        }
+        if (run->gov) multi_govern(run, multi_now());
+    }
+    if (run->push) multi_push(run, multi_now());   /* the final totals */
+    return multi_now() - t0;
+}
+
+/* Close every socket of @p run's streams; true if any stream delivered
+ * data. */
+static bool multi_close_all(MultiRun *run)
+{
+    bool any_data = false;
+    for (int i = 0; i < run->n; i++) {
+        MultiStream *ms = &run->ms[i];
+        if (ms->bytes > 0) any_data = true;
+        if (ms->run != run) continue;       /* another shard's */
+        ntrip_tls_free(ms->tls);
+        ms->tls = NULL;
+        if (ms->sock != SOCK_INVALID) {
+            loop_unwatch(&run->loop, i, ms->sock);
+            CLOSESOCKET(ms->sock);
+            ms->sock = SOCK_INVALID;
+        }
+    }
+#ifdef MULTI_USE_EPOLL
+    if (run->loop.ring && !run->quiet) {
+        unsigned long long requests, submits;
+        uring_rx_counts(run->loop.ring, &requests, &submits);
+        fprintf(stderr, "[MULTI] io_uring: %llu receives and sends in %llu submissions\n",
+                requests, submits);
+    }
+#endif
+    loop_close(&run->loop);
+    return any_data;
+}
+
+/* ── Sharded run ───────────────────────────────────────────────────── */
+
+static int  s_shards = 1;
+static bool s_pin_cores;
+
+void ntrip_multi_set_shards(int shards, bool pin_cores)
+{
+    s_shards    = shards;
+    s_pin_cores = pin_cores;
+}
+
+static int multi_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* The number of shards for @p n streams: --shards, 0 = one per core,
+ * never more than streams.  A frame hook (--sky) and --push read across
+ * all streams, so they keep the single loop. */
+static int multi_shard_count(int n)
+{
+    int k = s_shards > 0 ? s_shards : multi_cpu_count();
+    if (k > NTRIP_MULTI_MAX_SHARDS) k = NTRIP_MULTI_MAX_SHARDS;
+    if (k > n) k = n;
+    if (k > 1 && (s_frame_hook || s_push)) {
+        fprintf(stderr, "[WARN] --shards: --sky and --push need a single loop; not sharding\n");
+        k = 1;
+    }
+    return k < 1 ? 1 : k;
+}
+
+/* --pin-cores: keep the calling shard thread on its core. */
+static void multi_shard_pin(const MultiShard *sh)
+{
+    bool ok;
+#if defined(_WIN32)
+    ok = sh->cpu < (int)(8 * sizeof(DWORD_PTR)) &&
+         SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << sh->cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(sh->cpu, &set);
+    ok = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    ok = false;                         /* no hard affinity on macOS */
+#endif
+    if (!ok)
+        fprintf(stderr, "[WARN] --pin-cores: cannot pin shard %d to core %d\n", sh->id, sh->cpu);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall multi_shard_thread(void *arg)
+#else
+static void *multi_shard_thread(void *arg)
+#endif
+{
+    MultiShard *sh = (MultiShard *)arg;
+    if (sh->cpu >= 0) multi_shard_pin(sh);
+    sh->elapsed = multi_loop(&sh->run, sh->all->duration_s, sh->all->stop_flag);
+    return 0;
+}
+
+/* Run the streams of @p tmpl on @p n_sh loop threads, stream i starting
+ * on shard i % n_sh, and close every socket once they are done.  Shard 0
+ * keeps @p tmpl's governor and prints the progress line.  Returns the run
+ * time, or -1 if the shards could not be set up. */
+static double multi_shards_run(MultiRun *tmpl, int n_sh, int duration_s,
+                               const volatile int *stop_flag)
+{
+    MultiShards all;
+    memset(&all, 0, sizeof(all));
+    all.n          = n_sh;
+    all.duration_s = duration_s;
+    all.stop_flag  = stop_flag;
+    all.sh         = (MultiShard *)calloc((size_t)n_sh, sizeof(MultiShard));
+    all.view       = (MultiShardStats *)calloc((size_t)n_sh, sizeof(MultiShardStats));
+    all.work_last  = (double *)calloc((size_t)n_sh, sizeof(double));
+    MULTI_LOCK_INIT(&all.lock);
+    for (int i = 0; all.sh && i < n_sh; i++) MULTI_LOCK_INIT(&all.sh[i].lock);
+
+    int  ncpu  = multi_cpu_count();
+    int  ready = 0;                     /* shards with an open loop */
+    bool ok    = all.sh && all.view && all.work_last;
+    for (int i = 0; ok && i < n_sh; i++) {
+        MultiShard *sh = &all.sh[i];
+        sh->run       = *tmpl;
+        sh->run.shard = sh;
+        sh->run.gov   = i == 0 ? tmpl->gov : NULL;
+        sh->all       = &all;
+        sh->id        = i;
+        sh->cpu       = s_pin_cores ? i % ncpu : -1;
+        sh->shed_to   = -1;
+        sh->inbox     = (int *)malloc((size_t)tmpl->n * sizeof(int));
+        ok = sh->inbox && stats_snapshot_init(&sh->pub, sizeof(MultiShardStats)) &&
+             loop_open(&sh->run.loop, tmpl->n) == 0;
+        if (ok) ready++;
+    }
+
+    double elapsed = -1.0;
+    if (ok) {
+        for (int i = 0; i < tmpl->n; i++) {
+            tmpl->ms[i].run = &all.sh[i % n_sh].run;
+            if (tmpl->ms[i].state == MS_PENDING) all.alive++;
+        }
+        int started = 0;
+        for (; started < n_sh; started++) {
+            MultiShard *sh = &all.sh[started];
+#ifdef _WIN32
+            sh->thread = (HANDLE)_beginthreadex(NULL, 0, multi_shard_thread, sh, 0, NULL);
+            if (!sh->thread) break;
+#else
+            if (pthread_create(&sh->thread, NULL, multi_shard_thread, sh) != 0) break;
+#endif
+        }
+        if (started < n_sh) __atomic_store_n(&all.stop, 1, __ATOMIC_RELAXED);
+        for (int i = 0; i < started; i++) {
+#ifdef _WIN32
+            WaitForSingleObject(all.sh[i].thread, INFINITE);
+            CloseHandle(all.sh[i].thread);
+#else
+            pthread_join(all.sh[i].thread, NULL);
+#endif
+            if (all.sh[i].elapsed > elapsed) elapsed = all.sh[i].elapsed;
+        }
+        if (started < n_sh) elapsed = -1.0;
+    }
+
+    /* Every thread is gone: close what each shard owns, then what was
+     * still in an inbox. */
+    for (int i = 0; i < ready; i++) multi_close_all(&all.sh[i].run);
+    for (int i = 0; i < tmpl->n; i++) {
+        MultiStream *ms = &tmpl->ms[i];
+        ntrip_tls_free(ms->tls);
+        ms->tls = NULL;
+        if (ms->sock != SOCK_INVALID) {
+            CLOSESOCKET(ms->sock);
+            ms->sock = SOCK_INVALID;
+        }
+        ms->run = tmpl;
+    }
+    if (elapsed >= 0.0 && all.moved && !tmpl->quiet)
+        fprintf(stderr, "[MULTI] Balancer: %lu stream move(s) between %d shards\n",
+                all.moved, n_sh);
+    for (int i = 0; all.sh && i < n_sh; i++) {
+        free(all.sh[i].inbox);
+        stats_snapshot_free(&all.sh[i].pub);
+        MULTI_LOCK_FREE(&all.sh[i].lock);
+    }
+    MULTI_LOCK_FREE(&all.lock);
+    free(all.sh);
+    free(all.view);
+    free(all.work_last);
+    return elapsed;
+}
+
+/* ── Entry point ───────────────────────────────────────────────────── */
+
+int ntrip_multi_run(const NTRIP_Config *base, const char *mounts_file,
+                    int duration_s, const volatile int *stop_flag, bool quiet)
+{
+    NTRIP_Config *cfgs;
+    int n = 0;
+    if (ntrip_multi_load_mounts(base, mounts_file, &cfgs, &n) != 0) return -1;
+    if (n == 0) {
+        fprintf(stderr, "[ERROR] %s: no mountpoints listed\n", mounts_file);
+        free(cfgs);
+        return -1;
+    }
+    MultiStream *ms = (MultiStream *)calloc((size_t)n, sizeof(MultiStream));
+    if (!ms) {
+        fprintf(stderr, "[ERROR] Out of memory for %d streams\n", n);
+        free(cfgs);
+        return -1;
+    }
+
+    MultiRun run;
+    memset(&run, 0, sizeof(run));
+    run.ms          = ms;
+    run.n           = n;
+    run.quiet       = quiet;
+    run.mounts_file = mounts_file;
+    run.gov         = &s_load_gov;
+    run.push        = s_push;
+    for (int i = 0; i < n; i++)
+        multi_stream_init(&ms[i], &cfgs[i], NULL, &run, i);
+    free(cfgs);
+
+    int dns_failed = multi_resolve(ms, n);
+    int shards     = multi_shard_count(n);     /* each opens its own loop */
+
+    if (shards == 1 && loop_open(&run.loop, n) != 0) {
+        fprintf(stderr, "[ERROR] Cannot create event loop\n");
+        free(ms);
+        return 1;
+    }
+    if (perf_probes_on) {
+        for (int i = 0; i < n; i++)
+            ms[i].perf = (PerfStream *)calloc(1, sizeof(PerfStream));
+    }
+    AnomalyRing *rings = NULL;
+    if (s_anomaly_path) {
+        rings = (AnomalyRing *)calloc((size_t)n, sizeof(AnomalyRing));
+        if (!rings)
+            fprintf(stderr, "[WARN] Out of memory for the anomaly rings; --anomaly-dump is off\n");
+        for (int i = 0; rings && i < n; i++) ms[i].framer.anomalies = &rings[i];
+        if (rings) anomaly_dump_watch();
+    }
+    MetricsMount *mx = NULL;
+    MetricsServer *metrics = NULL;
+    if (metrics_enabled()) {
+        mx = metrics_mounts_new(n);
+        for (int i = 0; mx && i < n; i++) {
+            metrics_mount_label(&mx[i], ms[i].cfg.MOUNTPOINT, ms[i].cfg.NTRIP_CASTER,
+                                ms[i].cfg.NTRIP_PORT);
+            mx[i].perf      = ms[i].perf;
+            mx[i].anomalies = ms[i].framer.anomalies;
+            ms[i].mx        = &mx[i];
+            multi_export(&ms[i], 0.0, true);
+        }
+        metrics_set_governor(run.gov);
+        if (mx) metrics = metrics_server_start(mx, n, "multi");
+        if (!metrics) {
+            if (shards == 1) loop_close(&run.loop);
+            for (int i = 0; i < n; i++) free(ms[i].perf);
+            metrics_mounts_free(mx, n);
+            free(rings);
+            free(ms);
+            return -1;
+        }
+    }
+
+    if (!quiet) {
+        char threads[48] = "";
+        if (shards > 1)
+            snprintf(threads, sizeof(threads), " on %d loop threads%s", shards,
+                     s_pin_cores ? ", pinned" : "");
+        fprintf(stderr, "[INFO] Monitoring %d mountpoints (%d DNS failures)%s%s\n", n, dns_failed,
+                threads, duration_s > 0 ? "" : ", Ctrl-C to stop");
+    }
+    double elapsed;
+    bool any_data = false;
+    if (shards > 1) {
+        elapsed = multi_shards_run(&run, shards, duration_s, stop_flag);
+        for (int i = 0; i < n; i++) any_data = any_data || ms[i].bytes > 0;
+        if (elapsed < 0.0) {
+            fprintf(stderr, "[ERROR] Cannot start %d loop threads\n", shards);
+            metrics_server_stop(metrics);
+            metrics_set_governor(NULL);
+            metrics_mounts_free(mx, n);
+            for (int i = 0; i < n; i++) free(ms[i].perf);
+            free(rings);
+            free(ms);
+            return -1;
+        }
+    } else {
+        elapsed  = multi_loop(&run, duration_s, stop_flag);
+        any_data = multi_close_all(&run);
+    }
+    metrics_server_stop(metrics);
+    metrics_set_governor(NULL);
+    metrics_mounts_free(mx, n);
+
+    multi_print_summary(ms, n, elapsed);
+    ntrip_tls_print_stats(stdout);
+    if (rings) multi_dump_anomalies(&run, "end of run");
+    for (int i = 0; i < n; i++) free(ms[i].perf);
+    free(rings);
+    free(ms);
+    return any_data ? 0 : 1;
+}
+
+/* ── Load test ─────────────────────────────────────────────────────── */
+
+bool ntrip_load_parse_ramp(const char *spec, NtripLoadPlan *plan)
+{
+    char *end;
+    if (!spec || !*spec) return false;
+    if (strcmp(spec, "instant") == 0) {
+        plan->kind   = NTRIP_RAMP_INSTANT;
+        plan->ramp_s = 0.0;
+        return true;
+    }
+    if (strncmp(spec, "step:", 5) == 0) {
+        long k = strtol(spec + 5, &end, 10);
+        if (k < 1 || *end != '/') return false;
+        const char *v = end + 1;
+        double t = strtod(v, &end);
+        if (end == v || t <= 0.0 || (*end && strcmp(end, "s"))) return false;
+        plan->kind   = NTRIP_RAMP_STEP;
+        plan->step   = (int)k;
+        plan->ramp_s = t;
+        return true;
+    }
+    const char *v = strncmp(spec, "linear:", 7) == 0 ? spec + 7 : spec;
+    double t = strtod(v, &end);
+    if (end == v || t < 0.0 || (*end && strcmp(end, "s"))) return false;
+    plan->kind   = t > 0.0 ? NTRIP_RAMP_LINEAR : NTRIP_RAMP_INSTANT;
+    plan->ramp_s = t;
+    return true;
+}
+
+/* Seconds after the start at which session @p i opens. */
+static double load_start_offset(const NtripLoadPlan *plan, int i)
+{
+    switch (plan->kind) {
+    case NTRIP_RAMP_LINEAR: return plan->ramp_s * i / plan->sessions;
+    case NTRIP_RAMP_STEP:   return plan->ramp_s * (i / plan->step);
+    default:                return 0.0;
+    }
+}
+
+/* One socket per session: raise the soft open-file limit if needed. */
+static void load_fd_limit(int n)
+{
+#ifndef _WIN32
+    struct rlimit rl;
+    rlim_t want = (rlim_t)n + 64;   /* stdio, DNS, the epoll fd, ... */
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur >= want) return;
+    rl.rlim_cur = (rl.rlim_max == RLIM_INFINITY || rl.rlim_max >= want) ? want : rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur < want)
+        fprintf(stderr, "[WARN] Open-file limit %lu is too low for %d sessions (ulimit -n)\n",
+                (unsigned long)rl.rlim_cur, n);
+#else
+    (void)n;
+#endif
+}
+
+static void load_print_row(const char *name, const QSketch *s)
+{
+    if (s->count == 0) {
+        printf("| %-24s | %7d | %9s | %9s | %9s | %9s | %9s | %9s |\n",
+               name, 0, "-", "-", "-", "-", "-", "-");
+        return;
+    }
+    printf("| %-24s | %7llu | %9.1f | %9.1f | %9.1f | %9.1f | %9.1f | %9.1f |\n",
+           name, (unsigned long long)s->count, s->zero ? 0.0 : s->min,
+           qsketch_quantile(s, 0.50), qsketch_quantile(s, 0.90),
+           qsketch_quantile(s, 0.99), s->max, qsketch_mean(s));
+}
+
+static void load_print_summary(const MultiStream *ms, int n, const NTRIP_Config *mounts,
+                               int n_mounts, const NtripLoadPlan *plan, MultiLoad *ld,
+                               double elapsed, double t_stop)
+{
+    /* Per-session samples; the age was collected frame by frame. */
+    unsigned long long bytes = 0;
+    unsigned long frames = 0, crc = 0, resyncs = 0;
+    for (int i = 0; i < n; i++) {
+        const MultiStream *s = &ms[i];
+        if (s->t_connected > 0.0)  qsketch_add(&ld->connect_ms, (s->t_connected - s->t_open) * 1000.0);
+        if (s->t_header > 0.0)     qsketch_add(&ld->header_ms, (s->t_header - s->t_open) * 1000.0);
+        if (s->t_first_byte > 0.0) qsketch_add(&ld->first_ms, (s->t_first_byte - s->t_open) * 1000.0);
+        if (s->t_header > 0.0) {
+            double t_end = s->state == MS_STREAMING ? t_stop : s->t_last_rx;
+            if (t_end - s->t_header >= 1.0)
+                qsketch_add(&ld->kbps, (double)s->bytes * 8.0 / 1000.0 / (t_end - s->t_header));
+        }
+        bytes   += s->bytes;
+        frames  += s->framer.frames;
+        crc     += s->framer.crc_errors;
+        resyncs += s->framer.resyncs;
+    }
+
+    char ramp[48];
+    switch (plan->kind) {
+    case NTRIP_RAMP_LINEAR: snprintf(ramp, sizeof(ramp), "linear over %.0f s", plan->ramp_s); break;
+    case NTRIP_RAMP_STEP:   snprintf(ramp, sizeof(ramp), "%d every %.0f s", plan->step, plan->ramp_s); break;
+    default:                snprintf(ramp, sizeof(ramp), "all at once"); break;
+    }
+    printf("\n[INFO] Load test: %d sessions on %d mountpoints, %.0f s, started %s\n",
+           n, n_mounts, elapsed, ramp);
+    printf("+----------------------+--------------------------------+----------+-----------+---------+--------+------------+---------+--------+\n");
+    printf("| Mountpoint           | Caster                         | Sessions | Streaming | Dropped | Failed |      Bytes |  Frames |    CRC |\n");
+    printf("+----------------------+--------------------------------+----------+-----------+---------+--------+------------+---------+--------+\n");
+    for (int g = 0; g < n_mounts; g++) {
+        int sessions = 0, streaming = 0, dropped = 0, failed = 0;
+        unsigned long long g_bytes = 0;
+        unsigned long g_frames = 0, g_crc = 0;
+        for (int i = g; i < n; i += n_mounts) {
+            sessions++;
+            streaming += ms[i].state == MS_STREAMING;
+            dropped   += ms[i].state == MS_CLOSED;
+            failed    += ms[i].state == MS_FAILED;
+            g_bytes   += ms[i].bytes;
+            g_frames  += ms[i].framer.frames;
+            g_crc     += ms[i].framer.crc_errors;
+        }
+        char caster[48];
+        snprintf(caster, sizeof(caster), "%.24s:%d", mounts[g].NTRIP_CASTER, mounts[g].NTRIP_PORT);
+        printf("| %-20.20s | %-30.30s | %8d | %9d | %7d | %6d | %10llu | %7lu | %6lu |\n",
+               mounts[g].MOUNTPOINT, caster, sessions, streaming, dropped, failed,
+               g_bytes, g_frames, g_crc);
+    }
+    printf("+----------------------+--------------------------------+----------+-----------+---------+--------+------------+---------+--------+\n");
+
+    /* Why sessions ended, most common first */
+    const char *reason[MULTI_LOAD_REASONS];
+    int reason_n[MULTI_LOAD_REASONS], n_reasons = 0, other = 0;
+    for (int i = 0; i < n; i++) {
+        if (ms[i].state <= MS_STREAMING) continue;
+        const char *note = ms[i].note[0] ? ms[i].note : multi_state_name(ms[i].state);
+        int r = 0;
+        while (r < n_reasons && strcmp(reason[r], note) != 0) r++;
+        if (r == n_reasons) {
+            if (n_reasons == MULTI_LOAD_REASONS) { other++; continue; }
+            reason[n_reasons] = note;
+            reason_n[n_reasons++] = 0;
+        }
+        reason_n[r]++;
+    }
+    if (n_reasons > 0) {
+        printf("[INFO] Sessions ended:");
+        for (int done = 0; done < n_reasons; done++) {
+            int best = -1;
+            for (int r = 0; r < n_reasons; r++) {
+                if (reason_n[r] > 0 && (best < 0 || reason_n[r] > reason_n[best])) best = r;
+            }
+            printf("%s %d x %s", done ? "," : "", reason_n[best], reason[best]);
+            reason_n[best] = -reason_n[best];
+        }
+        if (other) printf(", %d other", other);
+        printf("\n");
+    }
+
+    printf("+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    printf("| Per session              |   Count |       Min |       p50 |       p90 |       p99 |       Max |      Mean |\n");
+    printf("+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    load_print_row("Connect (ms)", &ld->connect_ms);
+    load_print_row("Response header (ms)", &ld->header_ms);
+    load_print_row("First RTCM byte (ms)", &ld->first_ms);
+    load_print_row("Correction age (ms)", &ld->age_ms);
+    load_print_row("Throughput (kbit/s)", &ld->kbps);
+    printf("+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    printf("[INFO] Total: %llu bytes, %.1f kbit/s, %lu frames (%.1f/s), %lu CRC errors, %lu resyncs\n",
+           bytes, elapsed > 0.0 ? (double)bytes * 8.0 / 1000.0 / elapsed : 0.0,
+           frames, elapsed > 0.0 ? frames / elapsed : 0.0, crc, resyncs);
+}
+
+int ntrip_multi_load_test(const NTRIP_Config *mounts, int n_mounts,
+                          const NtripLoadPlan *plan, int duration_s,
+                          const volatile int *stop_flag, bool quiet)
+{
+    int n = plan->sessions;
+    MultiStream *ms  = (MultiStream *)calloc((size_t)n, sizeof(MultiStream));
+    MultiLoad   *ld  = (MultiLoad *)calloc(1, sizeof(MultiLoad));
+    if (!ms || !ld) {
+        fprintf(stderr, "[ERROR] Out of memory for %d sessions\n", n);
+        free(ms);
+        free(ld);
+        return -1;
+    }
+    MultiRun run;
+    memset(&run, 0, sizeof(run));
+    run.ms    = ms;
+    run.n     = n;
+    run.quiet = quiet;
+    for (int i = 0; i < n; i++) {
+        multi_stream_init(&ms[i], &mounts[i % n_mounts], ld, &run, i);
+        ms[i].t_start = load_start_offset(plan, i);
+    }
+    load_fd_limit(n);
+
+    int dns_failed = multi_resolve(ms, n);
+
+    if (loop_open(&run.loop, n) != 0) {
+        fprintf(stderr, "[ERROR] Cannot create event loop\n");
+        free(ms);
+        free(ld);
+        return -1;
+    }
+    if (!quiet) {
+        fprintf(stderr, "[INFO] Load test: %d sessions on %d mountpoints (%d DNS failures)%s\n",
+                n, n_mounts, dns_failed, duration_s > 0 ? "" : ", Ctrl-C to stop");
+    }
+    double elapsed = multi_loop(&run, duration_s, stop_flag);
+    double t_stop  = multi_now();
+    bool any_data  = multi_close_all(&run);
+
+    load_print_summary(ms, n, mounts, n_mounts, plan, ld, elapsed, t_stop);
+    ntrip_tls_print_stats(stdout);
+    free(ms);
+    free(ld);
+    return any_data ? 0 : 1;
+}
+
+/* ── VRS probe ─────────────────────────────────────────────────────── */
+
+/* Move the GGA to the probe position and start timing the switch. */
+static void multi_probe_switch(MultiStream *ms, double now)
+{
+    char gga[100];
+    create_gngga_sentence(ms->probe->lat, ms->probe->lon, gga);
+    snprintf(ms->gga, sizeof(ms->gga), "%s\r\n", gga);
+    ms->probe_phase  = PROBE_SWITCHED;
+    ms->t_switch     = now;
+    ms->n_types      = 0;           /* the mix is the one served at the probe position */
+    ms->other_frames = 0;
+    multi_send_gga(ms, now + ms->gga_s);
+    timer_wheel_schedule(&ms->run->wheel, &ms->tm_probe, now + MULTI_PROBE_WAIT);
+}
+
+static void multi_probe_arp(MultiStream *ms, const RtcmStationArp *arp, double now)
+{
+    VrsProbePoint *p = ms->probe;
+    if (ms->probe_phase == PROBE_START) {
+        p->base_valid   = true;
+        p->base_station = arp->ref_station_id;
+        p->base_lat     = arp->lat_deg;
+        p->base_lon     = arp->lon_deg;
+        multi_probe_switch(ms, now);
+        return;
+    }
+    if (ms->probe_phase != PROBE_SWITCHED) return;
+
+    p->arp_valid = true;
+    p->station   = arp->ref_station_id;
+    p->arp_lat   = arp->lat_deg;
+    p->arp_lon   = arp->lon_deg;
+    p->arp_alt   = arp->alt_m;
+    double moved_km = 0.0, heading;
+    if (p->base_valid)
+        calc_distance_heading(p->base_lat, p->base_lon, p->arp_lat, p->arp_lon, &moved_km, &heading);
+    /* The old station may still be on the wire just after the switch. */
+    if (p->base_valid && p->station == p->base_station && moved_km * 1000.0 < VRS_PROBE_SAME_M)
+        return;
+    p->switch_s     = now - ms->t_switch;
+    ms->probe_phase = PROBE_MIX;
+    timer_wheel_schedule(&ms->run->wheel, &ms->tm_probe, now + MULTI_PROBE_MIX);
+}
+
+/* Frames of a probe session: the mix, and the ARP of 1005 / 1006. */
+static void multi_probe_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    MultiStream *ms = (MultiStream *)user;
+    if (ms->probe_phase != PROBE_START) multi_count_type(ms, frame, frame_len);
+    if (frame_len < 8) return;
+    int msg_type = (frame[3] << 4) | (frame[4] >> 4);
+    if (msg_type != 1005 && msg_type != 1006) return;
+    RtcmStationArp arp;
+    if (rtcm_decode_arp(frame + 3, frame_len - 6, &arp))
+        multi_probe_arp(ms, &arp, multi_now());
+}
+
+/* End of a step: no ARP at the start position (switch anyway), no new
+ * ARP after the switch, or the mix is complete. */
+static void multi_probe_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *ms = (MultiStream *)arg;
+    (void)t;
+    if (ms->state != MS_STREAMING) return;
+    switch (ms->probe_phase) {
+    case PROBE_START:
+        multi_probe_switch(ms, now);
+        break;
+    case PROBE_SWITCHED:
+        multi_fail(ms, &ms->run->loop, ms->idx, MS_CLOSED,
+                   ms->probe->arp_valid ? "ARP did not change" : "no 1005 / 1006 received");
+        break;
+    case PROBE_MIX:
+        multi_fail(ms, &ms->run->loop, ms->idx, MS_CLOSED, "done");
+        break;
+    }
+}
+
+/* Copy what the session saw into its result. */
+static void multi_probe_collect(MultiStream *ms)
+{
+    VrsProbePoint *p = ms->probe;
+    p->outcome = !ms->streamed                   ? VRS_PROBE_FAILED   :
+                 ms->probe_phase == PROBE_MIX    ? VRS_PROBE_SWITCHED :
+                 p->arp_valid                    ? VRS_PROBE_SAME     : VRS_PROBE_NO_ARP;
+    snprintf(p->note, sizeof(p->note), "%s",
+             ms->note[0] ? ms->note : multi_state_name(ms->state));
+    p->bytes = ms->bytes;
+    qsort(ms->types, (size_t)ms->n_types, sizeof(MultiTypeStat), cmp_type_stat);
+    p->n_types = 0;
+    for (int t = 0; t < ms->n_types && p->n_types < VRS_PROBE_TYPES; t++) {
+        p->types[p->n_types]  = ms->types[t].msg_type;
+        p->counts[p->n_types] = (unsigned)ms->types[t].count;
+        p->n_types++;
+    }
+}
+
+int ntrip_multi_vrs_probe(const NTRIP_Config *cfg, VrsProbePoint *pts, int n,
+                          const NtripLoadPlan *plan, int duration_s,
+                          const volatile int *stop_flag, bool quiet, double *elapsed_s)
+{
+    MultiStream *ms = (MultiStream *)calloc((size_t)n, sizeof(MultiStream));
+    if (!ms) {
+        fprintf(stderr, "[ERROR] Out of memory for %d sessions\n", n);
+        return -1;
+    }
+    MultiRun run;
+    memset(&run, 0, sizeof(run));
+    run.ms    = ms;
+    run.n     = n;
+    run.quiet = quiet;
+    /* Without a configured position there is nothing to switch from:
+     * the first GGA is the probe position. */
+    bool from_base = cfg->LATITUDE != 0.0 || cfg->LONGITUDE != 0.0;
+    for (int i = 0; i < n; i++) {
+        MultiStream *s = &ms[i];
+        multi_stream_init(s, cfg, NULL, &run, i);
+        s->probe          = &pts[i];
+        s->t_start        = load_start_offset(plan, i);
+        s->backoff_max_ms = 0;      /* one session per position, never reopened */
+        if (s->gga_s <= 0.0) s->gga_s = MULTI_GGA_INTERVAL;  /* the probe is GGA */
+        pts[i].header_s = pts[i].switch_s = -1.0;
+        rtcm_framer_init(&s->framer, multi_probe_frame, s);
+        timer_init(&s->tm_probe, multi_probe_due, s);
+        if (!from_base) {
+            char gga[100];
+            create_gngga_sentence(pts[i].lat, pts[i].lon, gga);
+            snprintf(s->gga, sizeof(s->gga), "%s\r\n", gga);
+            s->probe_phase = PROBE_SWITCHED;
+        }
+    }
+    load_fd_limit(n);
+
+    int dns_failed = multi_resolve(ms, n);
+
+    if (loop_open(&run.loop, n) != 0) {
+        fprintf(stderr, "[ERROR] Cannot create event loop\n");
+        free(ms);
+        return -1;
+    }
+    if (!quiet) {
+        fprintf(stderr, "[INFO] VRS probe: %d positions on %s (%d DNS failures)%s\n",
+                n, cfg->MOUNTPOINT, dns_failed, duration_s > 0 ? "" : ", Ctrl-C to stop");
+    }
+    double elapsed = multi_loop(&run, duration_s, stop_flag);
+    multi_close_all(&run);
+
+    bool any_arp = false;
+    for (int i = 0; i < n; i++) {
+        multi_probe_collect(&ms[i]);
+        if (pts[i].arp_valid || pts[i].base_valid) any_arp = true;
+    }
+    if (elapsed_s) *elapsed_s = elapsed;
+    free(ms);
+    return any_arp ? 0 : 1;
+}
+
+/* ── Caster survey ─────────────────────────────────────────────────── */
+
+/* Frames of a survey session: the type counts of -t, the satellites of
+ * -s, the ARP and the age of corrections. */
+static void multi_survey_frame(const unsigned char *frame, int frame_len, void *user)
+{
+    MultiStream *ms = (MultiStream *)user;
+    SurveyMount *sv = ms->survey;
+    if (ms->framer.format != STREAM_FMT_RTCM3) return;
+    multi_count_type(ms, frame, frame_len);
+    if (frame_len < 8) return;
+
+    int msg_type = (frame[3] << 4) | (frame[4] >> 4);
+    uint64_t mask;
+    int gnss_id;
+    int64_t age_ns;
+    RtcmStationArp arp;
+    if (msm_extract_sat_mask(frame + 3, frame_len - 6, msg_type, &mask, NULL, &gnss_id)) {
+        if (gnss_id >= 0 && gnss_id < SURVEY_GNSS) sv->sats[gnss_id] |= mask;
+        if (corr_age_of_frame(frame, frame_len, ms->rx_utc_ns, &age_ns))
+            qsketch_add(&sv->age_ms, (double)age_ns / 1e6);
+    } else if ((msg_type == 1005 || msg_type == 1006) &&
+               rtcm_decode_arp(frame + 3, frame_len - 6, &arp)) {
+        sv->arp_valid = true;
+        sv->station   = arp.ref_station_id;
+        sv->arp_lat   = arp.lat_deg;
+        sv->arp_lon   = arp.lon_deg;
+        sv->arp_alt   = arp.alt_m;
+    }
+}
+
+/* The sample window of a survey session is over. */
+static void multi_survey_due(TimerWheelTimer *t, void *arg, double now)
+{
+    MultiStream *ms = (MultiStream *)arg;
+    (void)t;
+    (void)now;
+    if (ms->state == MS_STREAMING)
+        multi_fail(ms, &ms->run->loop, ms->idx, MS_CLOSED, "done");
+}
+
+/* Copy what the session saw into its result and check it. */
+static void multi_survey_collect(MultiStream *ms)
+{
+    SurveyMount *sv = ms->survey;
+    sv->streamed = ms->streamed;
+    snprintf(sv->note, sizeof(sv->note), "%s",
+             ms->note[0] ? ms->note : multi_state_name(ms->state));
+    sv->sample_s      = ms->streamed ? ms->t_last_rx - ms->t_header : 0.0;
+    sv->bytes         = ms->bytes;
+    sv->frames        = ms->framer.frames;
+    sv->crc_errors    = ms->framer.crc_errors;
+    sv->stream_format = ms->framer.format;
+    qsort(ms->types, (size_t)ms->n_types, sizeof(MultiTypeStat), cmp_type_stat);
+    sv->n_types = 0;
+    for (int t = 0; t < ms->n_types && sv->n_types < SURVEY_TYPES; t++) {
+        const MultiTypeStat *st = &ms->types[t];
+        sv->types[sv->n_types]      = st->msg_type;
+        sv->counts[sv->n_types]     = (unsigned)st->count;
+        sv->interval_s[sv->n_types] = st->count > 1 ? st->sum_dt / (st->count - 1) : 0.0;
+        sv->n_types++;
+    }
+    caster_survey_check(sv);
+}
+
+int ntrip_multi_survey(const NTRIP_Config *cfg, SurveyMount *mounts, int n, int jobs,
+                       int window_s, int duration_s, const volatile int *stop_flag,
+                       bool quiet, double *elapsed_s)
+{
+    MultiStream *ms = (MultiStream *)calloc((size_t)n, sizeof(MultiStream));
+    if (!ms) {
+        fprintf(stderr, "[ERROR] Out of memory for %d sessions\n", n);
+        return -1;
+    }
+    MultiRun run;
+    memset(&run, 0, sizeof(run));
+    run.ms     = ms;
+    run.n      = n;
+    run.quiet  = quiet;
+    run.batch  = jobs < n ? jobs : 0;
+    run.window = window_s;
+    for (int i = 0; i < n; i++) {
+        /* Same caster and login for all; GGA at the station listed, which
+         * is where a nearest-base or VRS mountpoint would serve from. */
+        NTRIP_Config c = *cfg;
+        snprintf(c.MOUNTPOINT, sizeof(c.MOUNTPOINT), "%s", mounts[i].mount);
+        if (mounts[i].lat != 0.0 || mounts[i].lon != 0.0) {
+            c.LATITUDE  = mounts[i].lat;
+            c.LONGITUDE = mounts[i].lon;
+        }
+        MultiStream *s = &ms[i];
+        multi_stream_init(s, &c, NULL, &run, i);
+        s->survey         = &mounts[i];
+        s->backoff_max_ms = 0;      /* one sample per mountpoint, never reopened */
+        rtcm_framer_init(&s->framer, multi_survey_frame, s);
+        timer_init(&s->tm_probe, multi_survey_due, s);
+    }
+    load_fd_limit(run.batch ? run.batch : n);
+
+    int dns_failed = multi_resolve(ms, n);
+
+    if (loop_open(&run.loop, n) != 0) {
+        fprintf(stderr, "[ERROR] Cannot create event loop\n");
+        free(ms);
+        return -1;
+    }
+    if (!quiet) {
+        fprintf(stderr, "[INFO] Caster survey: %d mountpoints on %s:%d, %d at a time, %d s each%s\n",
+                n, cfg->NTRIP_CASTER, cfg->NTRIP_PORT, run.batch ? run.batch : n, window_s,
+                dns_failed ? " (DNS lookup failed)" : "");
+    }
+    double elapsed = multi_loop(&run, duration_s, stop_flag);
+    multi_close_all(&run);
+
+    bool any_data = false;
+    for (int i = 0; i < n; i++) {
+        multi_survey_collect(&ms[i]);
+        if (mounts[i].bytes > 0) any_data = true;
+    }
+    if (elapsed_s) *elapsed_s = elapsed;
+    free(ms);
+    return any_data ? 0 : 1;
+}
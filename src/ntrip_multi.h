@@ -0,0 +1,291 @@
+/**
+ * @file ntrip_multi.h
+ * @brief Multi-mountpoint monitor: many NTRIP streams on one event loop.
+ *
+ * Every other CLI mode opens one blocking socket and runs its own recv()
+ * loop, so watching N mountpoints used to take N processes.  The monitor
+ * started by ntrip_multi_run() opens all streams listed in a mounts file
+ * as non-blocking sockets and multiplexes them on a single thread:
+ *
+ *   - Linux:         epoll
+ *   - Windows:       WSAPoll
+ *   - other POSIX:   poll()
+ *
+ * Each stream gets its own @ref RtcmFramer and a compact per-message-type
+ * statistics table (count and inter-arrival times, as in -t / --types).
+ * A GGA sentence is sent on every stream at the same 1 s interval as the
+ * single-stream modes, unless GGA_INTERVAL in the config or the mounts
+ * file says otherwise.  When the run ends (duration elapsed, stop flag set
+ * or every stream closed) a summary table is printed on stdout.  A stream
+ * that streamed and then dropped, or went silent for the idle timeout, is
+ * reopened with the same doubling, jittered backoff as the single-stream
+ * modes (RECONNECT_DELAY_MAX; negative = never).
+ *
+ * With a reload hook set (ntrip_multi_set_reload_hook()), the monitor
+ * re-reads the mounts file whenever the hook hands it a new config and
+ * matches the entries to the running streams by position.  Only a stream
+ * whose caster, mountpoint, credentials or TLS changed is re-opened, and
+ * those restarts are spread @ref NTRIP_MULTI_RELOAD_STAGGER apart so a
+ * change of the shared caster does not reconnect every stream at once.
+ * A new position or GGA_INTERVAL is sent at once on the open connection.
+ * Adding or removing entries needs a restart.
+ *
+ * Every deadline of every stream -- the next GGA, the next metrics tick,
+ * the connect, response and idle timeouts, the end of a backoff -- is a
+ * timer on one hashed timer wheel (timer_wheel.h), so the loop does O(1)
+ * work per timer instead of walking all streams each second, and a GGA
+ * goes out within 10 ms of its time.
+ *
+ * With shards set (ntrip_multi_set_shards()), the monitor runs on several
+ * loop threads instead of one.  Each shard owns its streams end to end --
+ * socket, framer, counters, metrics export, timers -- so the hot path
+ * takes no lock; the shards publish their totals through a
+ * StatsSnapshot (stats_snapshot.h), from which shard 0 prints the
+ * progress line and feeds the governor.  The loop time of every event is
+ * booked on its stream; every 30 s shard 0 compares how busy the shards
+ * were and has the busiest hand streaming connections worth half the
+ * difference to the idlest, socket and all, without a reconnect.
+ *
+ * With a sender set (ntrip_multi_set_push()), the monitor submits a
+ * summary of every stream each @ref FLEET_PUSH_INTERVAL_S and a last
+ * one when the run ends, for a `--collect` node (fleet_push.h).
+ *
+ * ntrip_multi_load_test() runs the same engine as a caster load
+ * generator: N client sessions spread round-robin over the mountpoints,
+ * started on a ramp, each only framed and CRC-checked (no decoding), as
+ * cheap per connection as the monitor; a session that ends is never
+ * reopened.  It reports the connect, response
+ * header and first-byte time distributions, the age of corrections of
+ * every MSM frame and the throughput per session and per mountpoint.
+ *
+ * ntrip_multi_vrs_probe() uses it to survey a VRS mountpoint: one session
+ * per GGA position of a grid or track, see vrs_probe.h.
+ *
+ * ntrip_multi_survey() samples every mountpoint of a caster's sourcetable
+ * for a fixed window, a bounded number at a time, see caster_survey.h.
+ *
+ * ## Mounts file
+ * JSON, either a top-level array or an object with a "mounts" array.
+ * Every entry is either a mountpoint name on the configured caster, or an
+ * object using the config-file key names; missing keys are taken from the
+ * loaded config:
+ * @code
+ * { "mounts": [
+ *     "MOUNT1",
+ *     { "MOUNTPOINT": "MOUNT2", "LATITUDE": 52.1, "LONGITUDE": 5.2 },
+ *     { "NTRIP_CASTER": "other.caster.net", "NTRIP_PORT": 2101,
+ *       "MOUNTPOINT": "MOUNT3", "USERNAME": "u", "PASSWORD": "p" },
+ *     { "MOUNTPOINT": "RTCM3_NEAREST", "GGA_INTERVAL": -1 }
+ * ] }
+ * @endcode
+ *
+ * Project: NTRIP RTCM 3.x Stream Analyzer
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause (see LICENSE for details)
+ */
+
+#ifndef NTRIP_MULTI_H
+#define NTRIP_MULTI_H
+
+#include <stdbool.h>
+#include "ntrip_handler.h"
+#include "fleet_push.h"
+#include "load_governor.h"
+#include "vrs_probe.h"
+#include "caster_survey.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Upper bound on the number of entries accepted from a mounts file. */
+#define NTRIP_MULTI_MAX_STREAMS 4096
+
+/**
+ * @brief Monitor every mountpoint listed in @p mounts_file until stopped.
+ *
+ * Winsock must already be initialised on Windows.
+ *
+ * @param base         Loaded config; supplies defaults for every entry.
+ * @param mounts_file  Path to the JSON mounts file.
+ * @param duration_s   Stop after this many seconds; 0 runs until @p stop_flag.
+ * @param stop_flag    Polled once per loop iteration; non-zero ends the run.
+ * @param quiet        Suppress the periodic status line on stderr.
+ * @return 0 if at least one stream delivered data, 1 if none did,
+ *         -1 if the mounts file could not be read or parsed.
+ */
+int ntrip_multi_run(const NTRIP_Config *base, const char *mounts_file,
+                    int duration_s, const volatile int *stop_flag, bool quiet);
+
+/** @brief Frame callback of ntrip_multi_set_frame_hook(). */
+typedef void (*NtripMultiFrameHook)(int stream, const unsigned char *frame,
+                                    int frame_len, void *user);
+
+/**
+ * @brief Have ntrip_multi_run() pass every CRC-checked frame to @p hook as
+ *        well, with the index of its entry in the mounts file.
+ *
+ * Called on the event-loop thread; NULL removes the hook.  Used by
+ * `--sky --mounts-file` (sky_multi.h).
+ */
+void ntrip_multi_set_frame_hook(NtripMultiFrameHook hook, void *user);
+
+/**
+ * @brief The governor of ntrip_multi_run(), fed by the busy fraction of
+ *        its event loop.
+ *
+ * Valid before the run (it is reset when the run starts); a frame hook
+ * asks it which optional work to skip (load_governor.h).  Written on the
+ * event-loop thread only.
+ */
+LoadGovernor *ntrip_multi_governor(void);
+
+/**
+ * @brief Have ntrip_multi_run() submit its stream summaries to @p push
+ *        (NULL = none); fleet_push_set_sky() adds the grids of
+ *        `--sky --mounts-file`.  The load test and the VRS probe do not
+ *        push.
+ */
+void ntrip_multi_set_push(FleetPush *push);
+
+/** @brief Upper bound on the loop threads of ntrip_multi_set_shards(). */
+#define NTRIP_MULTI_MAX_SHARDS 64
+
+/**
+ * @brief Have ntrip_multi_run() spread its streams over @p shards loop
+ *        threads (0 = one per core, 1 = the single loop, the default),
+ *        each pinned to a core of its own if @p pin_cores is set.
+ *
+ * A frame hook (`--sky`) and a sender (`--push`) read every stream, so
+ * with either set the monitor keeps the single loop.  Fewer streams than
+ * shards leave the rest unstarted.
+ */
+void ntrip_multi_set_shards(int shards, bool pin_cores);
+
+/**
+ * @brief Have ntrip_multi_run() keep the last anomalies of every stream
+ *        (anomaly_ring.h) and append them to @p path on SIGUSR1 and when
+ *        the run ends; NULL = off, the default.
+ *
+ * The rings are read without stopping the loops, so the dump of a
+ * sharded monitor is taken by shard 0 while the others stream on.  With
+ * --metrics-listen they are served at `GET /anomalies` as well.
+ */
+void ntrip_multi_set_anomaly_dump(const char *path);
+
+/** @brief Seconds between two stream restarts of one reload. */
+#define NTRIP_MULTI_RELOAD_STAGGER 0.05
+
+/**
+ * @brief Reload callback of ntrip_multi_set_reload_hook().
+ *
+ * @param base  [out] The reloaded config, AUTH_BASIC filled in.
+ * @return true when @p base is a new config to apply (e.g. after a
+ *         SIGHUP, config_watch.h); false on most calls.
+ */
+typedef bool (*NtripMultiReloadHook)(NTRIP_Config *base, void *user);
+
+/**
+ * @brief Have ntrip_multi_run() poll @p hook once per loop turn and apply
+ *        the config it returns, with the mounts file read again.
+ *
+ * Called on the event-loop thread; NULL removes the hook.  The load test
+ * and the VRS probe do not reload.
+ */
+void ntrip_multi_set_reload_hook(NtripMultiReloadHook hook, void *user);
+
+/** @brief How ntrip_multi_load_test() starts its sessions. */
+typedef enum {
+    NTRIP_RAMP_INSTANT,        /**< All at once */
+    NTRIP_RAMP_LINEAR,         /**< Evenly spread over @c ramp_s */
+    NTRIP_RAMP_STEP            /**< @c step sessions every @c ramp_s */
+} NtripRampKind;
+
+/** @brief A load test: how many sessions and how they are started. */
+typedef struct {
+    int           sessions;    /**< 1 .. NTRIP_MULTI_MAX_STREAMS */
+    NtripRampKind kind;
+    double        ramp_s;      /**< LINEAR: time to start all; STEP: time between steps */
+    int           step;        /**< STEP: sessions started per step */
+} NtripLoadPlan;
+
+/**
+ * @brief Parse a ramp profile: "0" or "instant", "linear:SECONDS" (or just
+ *        "SECONDS", "30s"), "step:COUNT/SECONDS" (e.g. "step:50/5").
+ *
+ * @return false on a malformed spec; @p plan is then unchanged.
+ */
+bool ntrip_load_parse_ramp(const char *spec, NtripLoadPlan *plan);
+
+/**
+ * @brief Load-test the caster(s) of @p mounts with @p plan->sessions
+ *        client sessions until the duration ends or @p stop_flag is set.
+ *
+ * Session i requests mounts[i % n_mounts]; a session the caster drops is
+ * not reopened, so the sessions still streaming at the end are the ones
+ * the caster kept.  Winsock must already be initialised on Windows.
+ *
+ * @return 0 if at least one session delivered data, 1 if none did,
+ *         -1 if the event loop could not be set up.
+ */
+int ntrip_multi_load_test(const NTRIP_Config *mounts, int n_mounts,
+                          const NtripLoadPlan *plan, int duration_s,
+                          const volatile int *stop_flag, bool quiet);
+
+/**
+ * @brief Probe a VRS mountpoint at every position of @p pts at once: one
+ *        session per position, started as @p plan says, each going
+ *        through the steps described in vrs_probe.h.
+ *
+ * Every session requests @p cfg's MOUNTPOINT and sends GGA (at least
+ * every second when GGA_INTERVAL is negative) and is closed once its
+ * position is done, so the run ends on its own; @p duration_s caps it.
+ * The results are filled into @p pts.  Winsock must already be
+ * initialised on Windows.
+ *
+ * @param elapsed_s  [out] Run time, may be NULL.
+ * @return 0 if any session received an ARP, 1 if none did, -1 if the
+ *         event loop could not be set up.
+ */
+int ntrip_multi_vrs_probe(const NTRIP_Config *cfg, VrsProbePoint *pts, int n,
+                          const NtripLoadPlan *plan, int duration_s,
+                          const volatile int *stop_flag, bool quiet, double *elapsed_s);
+
+/**
+ * @brief Sample every mountpoint of @p mounts for @p window_s seconds,
+ *        @p jobs sessions at a time, as described in caster_survey.h.
+ *
+ * Every session uses @p cfg's caster and login, requests its mountpoint
+ * and sends GGA at the STR position (the configured one if the line has
+ * none; none at all when GGA_INTERVAL is negative).  A session ends when
+ * its window is over or the caster drops it and is never reopened; the
+ * next pending mountpoint then starts.  @p duration_s caps the run.  The
+ * results, checked by caster_survey_check(), are filled into @p mounts.
+ * Winsock must already be initialised on Windows.
+ *
+ * @param elapsed_s  [out] Run time, may be NULL.
+ * @return 0 if any mountpoint delivered data, 1 if none did, -1 if the
+ *         event loop could not be set up.
+ */
+int ntrip_multi_survey(const NTRIP_Config *cfg, SurveyMount *mounts, int n, int jobs,
+                       int window_s, int duration_s, const volatile int *stop_flag,
+                       bool quiet, double *elapsed_s);
+
+/**
+ * @brief Read a mounts file into one config per listed mountpoint.
+ *
+ * Missing keys are taken from @p base and AUTH_BASIC is filled in;
+ * entries without a MOUNTPOINT are skipped with a warning.  Also used by
+ * the relay (ntrip_relay.h).
+ *
+ * @param out    [out] malloc()ed array of @p out_n configs (free() it).
+ * @return 0 on success, -1 if the file could not be read or parsed.
+ */
+int ntrip_multi_load_mounts(const NTRIP_Config *base, const char *path,
+                            NTRIP_Config **out, int *out_n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_MULTI_H */
@@ -0,0 +1,1061 @@
+/**
+ * @file ntrip_relay.c
+ * @brief Local caster mode: one upstream connection per mountpoint,
+ *        re-served to many local NTRIP clients from a shared ring.
+ *
+ * Threads: one per upstream mountpoint (NtripSession loop, framer,
+ * publish into the ring) and the calling thread, which runs the client
+ * side on poll() / WSAPoll().  An upstream thread wakes the client loop
+ * with a datagram on a loopback UDP socket, so new frames go out at once
+ * without the loop polling on a timer.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #ifndef _WIN32_WINNT
+    #define _WIN32_WINNT 0x0601     /* WSAPoll(), SRWLOCK need Vista or later */
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+    #define CLOSESOCKET closesocket
+    #define SOCK_WOULDBLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+    typedef WSAPOLLFD RelayPollFd;
+    #define relay_poll(p, n, t) WSAPoll((p), (ULONG)(n), (t))
+    typedef SRWLOCK RelayLock;
+    #define RELAY_LOCK_INIT(l)  InitializeSRWLock(l)
+    #define RELAY_LOCK(l)       AcquireSRWLockExclusive(l)
+    #define RELAY_UNLOCK(l)     ReleaseSRWLockExclusive(l)
+    #define RELAY_LOCK_FREE(l)  ((void)(l))
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #define CLOSESOCKET close
+    #define SOCK_WOULDBLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+    typedef struct pollfd RelayPollFd;
+    #define relay_poll(p, n, t) poll((p), (nfds_t)(n), (t))
+    typedef pthread_mutex_t RelayLock;
+    #define RELAY_LOCK_INIT(l)  pthread_mutex_init((l), NULL)
+    #define RELAY_LOCK(l)       pthread_mutex_lock(l)
+    #define RELAY_UNLOCK(l)     pthread_mutex_unlock(l)
+    #define RELAY_LOCK_FREE(l)  pthread_mutex_destroy(l)
+#endif
+
+#include "ntrip_relay.h"
+#include "ntrip_connect.h"
+#include "ntrip_http.h"
+#include "metrics_http.h"
+#include "ntrip_session.h"
+#include "nmea_parser.h"
+#include "rtcm_framer.h"
+#include "stream_clock.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define RELAY_RING_MASK       ((uint64_t)NTRIP_RELAY_RING_SIZE - 1)
+/* A client is dropped once it lags this close to a full ring, leaving
+ * room for the frames published while one send() is in progress. */
+#define RELAY_RING_GUARD      (64u * 1024u)
+#define RELAY_SEND_MAX        (64 * 1024)    /* bytes per send() */
+#define RELAY_SNDBUF          (64 * 1024)    /* client socket send buffer */
+#define RELAY_REQ_MAX         2048           /* client request header limit */
+#define RELAY_GGA_INTERVAL_S  5
+#define RELAY_RETRY_S         10             /* upstream open retry delay */
+#define RELAY_STATUS_INTERVAL 10.0           /* s between status lines */
+#define RELAY_SERVER          "NTRIP-Analyser relay"
+
+#if (NTRIP_RELAY_RING_SIZE & (NTRIP_RELAY_RING_SIZE - 1)) != 0 || \
+    NTRIP_RELAY_RING_SIZE < 4 * RELAY_RING_GUARD
+#error "NTRIP_RELAY_RING_SIZE must be a power of two >= 4 * RELAY_RING_GUARD"
+#endif
+
+typedef enum {
+    UP_CONNECTING = 0,
+    UP_STREAMING,
+    UP_RECONNECTING,
+    UP_FAILED                   /* refused by the caster; not retried */
+} UpState;
+
+static const char *up_state_name(UpState s)
+{
+    switch (s) {
+    case UP_CONNECTING:   return "connecting";
+    case UP_STREAMING:    return "streaming";
+    case UP_RECONNECTING: return "reconnect";
+    case UP_FAILED:       return "failed";
+    }
+    return "?";
+}
+
+struct RelayCtx;
+
+typedef struct {
+    NTRIP_Config     cfg;
+    char             tag[64];        /* log prefix, e.g. "[RELAY MOUNT]" */
+    char             str[1024];      /* STR record for our sourcetable, no CRLF */
+    struct RelayCtx *ctx;
+
+    /* Shared with the upstream thread; under lock */
+    RelayLock        lock;
+    unsigned char   *ring;
+    uint64_t         head;           /* bytes ever published */
+    unsigned long    frames;
+    UpState          state;
+    char             note[96];
+    int              reconnects;
+    uint32_t         export_clients; /* client-loop gauges for the exporter */
+    uint64_t         export_lag;
+
+    /* Client loop only */
+    int                clients;
+    unsigned long      clients_total;
+    unsigned long      dropped;      /* too slow */
+    unsigned long long bytes_out;
+
+    /* Upstream thread only (the snapshot it publishes is read by the
+     * status line and by --metrics-listen) */
+    MetricsMount    *mx;
+
+    /* A local producer instead of the upstream session (ntrip_relay_serve) */
+    NtripRelaySource source;
+    void            *source_user;
+    volatile int     source_done;
+
+#ifdef _WIN32
+    HANDLE           thread;
+#else
+    pthread_t        thread;
+#endif
+    bool             started;
+} RelayMount;
+
+typedef enum {
+    RC_FREE = 0,
+    RC_REQUEST,                 /* reading the request header */
+    RC_STREAM,                  /* response header, then the ring */
+    RC_REPLY                    /* one reply (sourcetable, error), then close */
+} ClientState;
+
+typedef struct {
+    NtripSocket sock;
+    ClientState state;
+    int         mount;
+    uint64_t    cursor;         /* next ring byte to send */
+    bool        blocked;        /* last send() filled the socket buffer */
+    char        req[RELAY_REQ_MAX + 1];
+    int         req_len;
+    char       *out;            /* pending response bytes (malloc) */
+    size_t      out_len, out_off;
+    double      t_open;
+    char        peer[64];
+} RelayClient;
+
+typedef struct RelayCtx {
+    RelayMount   *m;
+    int           n;
+    volatile int  stop;
+    bool          quiet;
+    NtripSocket   wake_rx;      /* loopback UDP the client loop polls */
+    NtripSocket   wake_tx;
+    RelayLock     wake_lock;
+    bool          wake_pending;
+} RelayCtx;
+
+#ifdef _WIN32
+static double relay_now(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+}
+#else
+static double relay_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+#endif
+
+/* ── Upstream side ─────────────────────────────────────────────────── */
+
+static void relay_wake(RelayCtx *ctx)
+{
+    RELAY_LOCK(&ctx->wake_lock);
+    bool send_it = !ctx->wake_pending;
+    ctx->wake_pending = true;
+    RELAY_UNLOCK(&ctx->wake_lock);
+    if (send_it) send(ctx->wake_tx, "w", 1, 0);
+}
+
+/* Framer callback: append one CRC-valid frame to the mount's ring.  The
+ * writer never waits for readers; slow ones notice they were lapped. */
+static void relay_publish(const unsigned char *frame, int frame_len, void *user)
+{
+    RelayMount *m = (RelayMount *)user;
+    size_t len = (size_t)frame_len;
+
+    RELAY_LOCK(&m->lock);
+    size_t off   = (size_t)(m->head & RELAY_RING_MASK);
+    size_t first = NTRIP_RELAY_RING_SIZE - off;
+    if (first > len) first = len;
+    memcpy(m->ring + off, frame, first);
+    memcpy(m->ring, frame + first, len - first);
+    m->head += len;
+    m->frames++;
+    RELAY_UNLOCK(&m->lock);
+
+    metrics_mount_frame(m->mx, frame, frame_len, relay_now());
+    if (m->mx->rollup) metrics_mount_age(m->mx, frame, frame_len, stream_clock_utc_ns());
+    relay_wake(m->ctx);
+}
+
+/* Publish the mount's metrics snapshot when due (at once with @p force),
+ * with the client gauges the client loop left under the lock. */
+static void relay_export(RelayMount *m, bool force)
+{
+    MetricsMount *x = m->mx;
+    RELAY_LOCK(&m->lock);
+    x->clients     = m->export_clients;
+    x->queue_bytes = m->export_lag;
+    RELAY_UNLOCK(&m->lock);
+    metrics_mount_publish(x, relay_now(), force);
+}
+
+static void relay_set_state(RelayMount *m, UpState st, const char *note)
+{
+    RELAY_LOCK(&m->lock);
+    m->state = st;
+    if (note) snprintf(m->note, sizeof(m->note), "%s", note);
+    RELAY_UNLOCK(&m->lock);
+    m->mx->state = st == UP_STREAMING ? METRICS_STREAMING :
+                   st == UP_FAILED    ? METRICS_DOWN : METRICS_CONNECTING;
+    relay_export(m, true);
+}
+
+static int relay_should_stop(void *user)
+{
+    return ((RelayCtx *)user)->stop;
+}
+
+/* Sleep up to @p seconds, returning early when the relay stops. */
+static void relay_pause(RelayCtx *ctx, int seconds)
+{
+    for (int i = 0; i < seconds * 10 && !ctx->stop; i++) {
+#ifdef _WIN32
+        Sleep(100);
+#else
+        struct timespec ts = { 0, 100 * 1000 * 1000 };
+        nanosleep(&ts, NULL);
+#endif
+    }
+}
+
+static void relay_upstream(RelayMount *m)
+{
+    RelayCtx *ctx = m->ctx;
+    const NTRIP_Config *c = &m->cfg;
+    unsigned flags = ntrip_config_session_flags(c, false);
+
+    char gga[100], gga_crlf[104];
+    create_gngga_sentence(c->LATITUDE, c->LONGITUDE, gga);
+    snprintf(gga_crlf, sizeof(gga_crlf), "%s\r\n", gga);
+
+    NtripSession session;
+    while (!ctx->stop) {
+        if (ntrip_session_open(&session, c->NTRIP_CASTER, c->NTRIP_PORT, c->MOUNTPOINT,
+                               c->AUTH_BASIC, c->RECONNECT_DELAY_MAX, 500, m->tag, flags))
+            break;
+        relay_set_state(m, UP_RECONNECTING, "connect failed");
+        relay_pause(ctx, RELAY_RETRY_S);
+    }
+    if (ctx->stop) return;
+
+    RtcmFramer framer;
+    rtcm_framer_init(&framer, relay_publish, m);
+    time_t last_gga = 0, last_data = time(NULL);
+
+    while (!ctx->stop) {
+        time_t now = time(NULL);
+        if (now - last_gga >= RELAY_GGA_INTERVAL_S) {
+            ntrip_session_send(&session, gga_crlf, (int)strlen(gga_crlf));
+            last_gga = now;
+        }
+
+        size_t avail;
+        unsigned char *dst = rtcm_framer_write_ptr(&framer, &avail);
+        int r = ntrip_session_recv(&session, dst, (int)avail);
+
+        const char *lost = NULL;
+        if (r == 0) {
+            lost = "caster closed the connection";
+        } else if (r < 0) {
+#ifdef _WIN32
+            bool tick = WSAGetLastError() == WSAETIMEDOUT;
+#else
+            bool tick = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+            if (!tick)
+                lost = "receive error";
+            else if (difftime(now, last_data) >= NTRIP_SESSION_IDLE_S)
+                lost = "stream went silent";
+        } else {
+            last_data = now;
+            bool in_header = !ntrip_http_head_done(&session.http);
+            size_t body = ntrip_http_decode(&session.http, dst, (size_t)r);
+            if (in_header && ntrip_http_head_done(&session.http)) {
+                if (!ntrip_http_ok(&session.http)) {
+                    fprintf(stderr, "%s Caster refused the mountpoint: %s\n",
+                            m->tag, session.http.status_line);
+                    relay_set_state(m, UP_FAILED, session.http.status_line);
+                    break;
+                }
+                relay_set_state(m, UP_STREAMING, "");
+            }
+            rtcm_framer_commit(&framer, body);
+            stream_format_log(rtcm_framer_new_format(&framer), m->cfg.MOUNTPOINT);
+            m->mx->bytes         += (uint64_t)r;
+            m->mx->crc_errors     = (uint64_t)framer.crc_errors;
+            m->mx->skipped_bytes  = (uint64_t)framer.skipped_bytes;
+            m->mx->resyncs        = (uint64_t)framer.resyncs;
+        }
+
+        if (lost) {
+            relay_set_state(m, UP_RECONNECTING, lost);
+            if (!ntrip_session_resume(&session, lost, relay_should_stop, ctx)) {
+                if (!ctx->stop) relay_set_state(m, UP_FAILED, lost);
+                break;
+            }
+            RELAY_LOCK(&m->lock);
+            m->reconnects = session.reconnects;
+            RELAY_UNLOCK(&m->lock);
+            m->mx->reconnects = (uint64_t)session.reconnects;
+            rtcm_framer_reset(&framer);
+            last_gga = 0;
+            last_data = time(NULL);
+        }
+        relay_export(m, false);
+    }
+    ntrip_session_close(&session);
+}
+
+/* NtripRelayEmit of a local source: publish, and count what the
+ * upstream loop would have counted as received. */
+static void relay_source_emit(const unsigned char *frame, int frame_len, void *user)
+{
+    RelayMount *m = (RelayMount *)user;
+    m->mx->bytes += (uint64_t)frame_len;
+    relay_publish(frame, frame_len, m);
+    relay_export(m, false);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall relay_upstream_thread(void *arg)
+#else
+static void *relay_upstream_thread(void *arg)
+#endif
+{
+    RelayMount *m = (RelayMount *)arg;
+    if (m->source) {
+        relay_set_state(m, UP_STREAMING, "");
+        m->source(relay_source_emit, m, &m->ctx->stop, m->source_user);
+        __atomic_store_n(&m->source_done, 1, __ATOMIC_RELEASE);
+        relay_wake(m->ctx);
+    } else {
+        relay_upstream(m);
+    }
+    return 0;
+}
+
+/* ── Sourcetable ───────────────────────────────────────────────────── */
+
+typedef struct {
+    RelayMount *m;
+    int         n;
+    const char *caster;
+    int         port;
+} StrScan;
+
+/* Keep the upstream STR record of every relayed mountpoint, with
+ * authentication and fee cleared and NMEA off (clients share one
+ * upstream position). */
+static void relay_str_line(const char *line, size_t len, void *user)
+{
+    StrScan *sc = (StrScan *)user;
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+    if (len < 5 || strncmp(line, "STR;", 4) != 0) return;
+
+    const char *name = line + 4;
+    const char *semi = memchr(name, ';', len - 4);
+    if (!semi) return;
+    size_t name_len = (size_t)(semi - name);
+
+    for (int i = 0; i < sc->n; i++) {
+        RelayMount *m = &sc->m[i];
+        if (m->str[0] || m->cfg.NTRIP_PORT != sc->port ||
+            strcmp(m->cfg.NTRIP_CASTER, sc->caster) != 0 ||
+            strlen(m->cfg.MOUNTPOINT) != name_len ||
+            strncmp(m->cfg.MOUNTPOINT, name, name_len) != 0)
+            continue;
+
+        /* Copy field by field: 12 = nmea, 16 = authentication, 17 = fee */
+        size_t o = 0;
+        int field = 1;
+        for (size_t k = 0; k < len && o + 2 < sizeof(m->str); k++) {
+            if (line[k] == ';') {
+                field++;
+                m->str[o++] = ';';
+                if (field == 12 || field == 16 || field == 17) {
+                    m->str[o++] = field == 12 ? '0' : 'N';
+                    while (k + 1 < len && line[k + 1] != ';') k++;
+                }
+                continue;
+            }
+            m->str[o++] = line[k];
+        }
+        m->str[o] = '\0';
+    }
+}
+
+static void relay_build_sourcetable(RelayMount *m, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (m[i].source) continue;      /* nothing upstream to ask */
+        int j;
+        for (j = 0; j < i; j++) {
+            if (m[j].cfg.NTRIP_PORT == m[i].cfg.NTRIP_PORT &&
+                strcmp(m[j].cfg.NTRIP_CASTER, m[i].cfg.NTRIP_CASTER) == 0)
+                break;
+        }
+        if (j < i) continue;            /* caster already fetched */
+        StrScan sc = { m, n, m[i].cfg.NTRIP_CASTER, m[i].cfg.NTRIP_PORT };
+        char *table = receive_mount_table_ex(&m[i].cfg, relay_str_line, &sc, NULL);
+        free(table);
+    }
+    for (int i = 0; i < n; i++) {
+        if (m[i].str[0]) continue;
+        snprintf(m[i].str, sizeof(m[i].str),
+                 "STR;%s;%s;RTCM 3;;0;;;;%.2f;%.2f;0;0;" RELAY_SERVER ";none;N;N;0;",
+                 m[i].cfg.MOUNTPOINT, m[i].cfg.MOUNTPOINT,
+                 m[i].cfg.LATITUDE, m[i].cfg.LONGITUDE);
+    }
+}
+
+/* ── Client side ───────────────────────────────────────────────────── */
+
+static void client_close(RelayCtx *ctx, RelayClient *c)
+{
+    if (c->state == RC_STREAM && c->mount >= 0) ctx->m[c->mount].clients--;
+    CLOSESOCKET(c->sock);
+    free(c->out);
+    memset(c, 0, sizeof(*c));
+    c->sock  = NTRIP_INVALID_SOCKET;
+    c->state = RC_FREE;
+}
+
+/* Queue @p head and @p body (may be NULL) as the response. */
+static void client_reply(RelayClient *c, ClientState st, const char *head, const char *body)
+{
+    size_t hl = strlen(head), bl = body ? strlen(body) : 0;
+    c->out = (char *)malloc(hl + bl + 1);
+    if (c->out) {
+        memcpy(c->out, head, hl);
+        if (bl) memcpy(c->out + hl, body, bl);
+        c->out_len = hl + bl;
+    }
+    c->out_off = 0;
+    c->state   = st;
+}
+
+static void client_sourcetable(RelayCtx *ctx, RelayClient *c, bool v2)
+{
+    size_t cap = 32;
+    for (int i = 0; i < ctx->n; i++) cap += strlen(ctx->m[i].str) + 2;
+    char *body = (char *)malloc(cap);
+    if (!body) return;
+    size_t o = 0;
+    for (int i = 0; i < ctx->n; i++)
+        o += (size_t)snprintf(body + o, cap - o, "%s\r\n", ctx->m[i].str);
+    snprintf(body + o, cap - o, "ENDSOURCETABLE\r\n");
+
+    char head[256];
+    if (v2)
+        snprintf(head, sizeof(head),
+                 "HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\nServer: " RELAY_SERVER "\r\n"
+                 "Content-Type: gnss/sourcetable\r\nContent-Length: %zu\r\n"
+                 "Connection: close\r\n\r\n", strlen(body));
+    else
+        snprintf(head, sizeof(head),
+                 "SOURCETABLE 200 OK\r\nServer: " RELAY_SERVER "\r\n"
+                 "Content-Type: text/plain\r\nContent-Length: %zu\r\n\r\n", strlen(body));
+    client_reply(c, RC_REPLY, head, body);
+    free(body);
+}
+
+static bool header_has_ci(const char *hdr, const char *needle)
+{
+    size_t nl = strlen(needle);
+    for (const char *p = hdr; *p; p++) {
+        size_t k = 0;
+        while (k < nl && p[k] && (p[k] | 0x20) == (needle[k] | 0x20)) k++;
+        if (k == nl) return true;
+    }
+    return false;
+}
+
+/* A complete request header is in c->req: pick the reply. */
+static void client_request(RelayCtx *ctx, RelayClient *c)
+{
+    bool v2 = header_has_ci(c->req, "Ntrip-Version: Ntrip/2");
+    if (strncmp(c->req, "GET /", 5) != 0) {
+        client_reply(c, RC_REPLY, "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n", NULL);
+        return;
+    }
+    const char *path = c->req + 5;
+    size_t plen = strcspn(path, " ?\r\n");
+
+    int found = -1;
+    for (int i = 0; i < ctx->n && plen > 0; i++) {
+        if (strlen(ctx->m[i].cfg.MOUNTPOINT) == plen &&
+            strncmp(ctx->m[i].cfg.MOUNTPOINT, path, plen) == 0) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) {
+        /* NTRIP 1.0 clients get the sourcetable for an unknown mountpoint */
+        if (plen == 0 || !v2)
+            client_sourcetable(ctx, c, v2);
+        else
+            client_reply(c, RC_REPLY, "HTTP/1.1 404 Not Found\r\nNtrip-Version: Ntrip/2.0\r\n"
+                                      "Connection: close\r\n\r\n", NULL);
+        return;
+    }
+
+    RelayMount *m = &ctx->m[found];
+    client_reply(c, RC_STREAM,
+                 v2 ? "HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\nServer: " RELAY_SERVER "\r\n"
+                      "Content-Type: gnss/data\r\nCache-Control: no-store, no-cache\r\n"
+                      "Connection: close\r\n\r\n"
+                    : "ICY 200 OK\r\n\r\n",
+                 NULL);
+    c->mount = found;
+    RELAY_LOCK(&m->lock);
+    c->cursor = m->head;        /* start at the next frame boundary */
+    RELAY_UNLOCK(&m->lock);
+    m->clients++;
+    m->clients_total++;
+    if (!ctx->quiet)
+        fprintf(stderr, "[RELAY] %s -> %s (NTRIP %s)\n", c->peer, m->cfg.MOUNTPOINT,
+                v2 ? "2.0" : "1.0");
+}
+
+static void client_read(RelayCtx *ctx, RelayClient *c)
+{
+    char scratch[512];
+    for (;;) {
+        char *dst = c->state == RC_REQUEST ? c->req + c->req_len : scratch;
+        int room  = c->state == RC_REQUEST ? RELAY_REQ_MAX - c->req_len : (int)sizeof(scratch);
+        if (room <= 0) {
+            client_close(ctx, c);           /* request header too long */
+            return;
+        }
+        int r = (int)recv(c->sock, dst, room, 0);
+        if (r < 0 && SOCK_WOULDBLOCK()) return;
+        if (r <= 0) {
+            client_close(ctx, c);
+            return;
+        }
+        if (c->state != RC_REQUEST) continue;   /* GGA and the like: dropped */
+        c->req_len += r;
+        c->req[c->req_len] = '\0';
+        if (strstr(c->req, "\r\n\r\n")) {
+            client_request(ctx, c);
+            return;
+        }
+    }
+}
+
+/* Drop a streaming client the ring is about to overwrite unsent bytes of. */
+static bool client_lapped(RelayCtx *ctx, RelayClient *c, uint64_t lag)
+{
+    if (lag <= NTRIP_RELAY_RING_SIZE - RELAY_RING_GUARD) return false;
+    RelayMount *m = &ctx->m[c->mount];
+    m->dropped++;
+    if (!ctx->quiet)
+        fprintf(stderr, "[RELAY] %s dropped from %s: too slow (%.1f MB behind)\n",
+                c->peer, m->cfg.MOUNTPOINT, lag / 1048576.0);
+    client_close(ctx, c);
+    return true;
+}
+
+/* Send what is pending: first the response bytes, then the ring. */
+static void client_flush(RelayCtx *ctx, RelayClient *c)
+{
+    c->blocked = false;
+    while (c->out && c->out_off < c->out_len) {
+        int r = (int)send(c->sock, c->out + c->out_off, (int)(c->out_len - c->out_off),
+                          MSG_NOSIGNAL);
+        if (r < 0 && SOCK_WOULDBLOCK()) {
+            c->blocked = true;
+            return;
+        }
+        if (r <= 0) {
+            client_close(ctx, c);
+            return;
+        }
+        c->out_off += (size_t)r;
+    }
+    if (c->out) {
+        free(c->out);
+        c->out = NULL;
+    }
+    if (c->state == RC_REPLY) {
+        client_close(ctx, c);
+        return;
+    }
+    if (c->state != RC_STREAM) return;
+
+    RelayMount *m = &ctx->m[c->mount];
+    for (;;) {
+        RELAY_LOCK(&m->lock);
+        uint64_t head = m->head;
+        RELAY_UNLOCK(&m->lock);
+
+        uint64_t lag = head - c->cursor;
+        if (lag == 0 || client_lapped(ctx, c, lag)) return;
+
+        size_t off = (size_t)(c->cursor & RELAY_RING_MASK);
+        size_t k   = NTRIP_RELAY_RING_SIZE - off;
+        if (k > lag) k = (size_t)lag;
+        if (k > RELAY_SEND_MAX) k = RELAY_SEND_MAX;
+        int r = (int)send(c->sock, (const char *)m->ring + off, (int)k, MSG_NOSIGNAL);
+        if (r < 0 && SOCK_WOULDBLOCK()) {
+            c->blocked = true;
+            return;
+        }
+        if (r <= 0) {
+            client_close(ctx, c);
+            return;
+        }
+        c->cursor    += (uint64_t)r;
+        m->bytes_out += (unsigned long long)r;
+        if ((size_t)r < k) {
+            c->blocked = true;
+            return;
+        }
+    }
+}
+
+static void client_accept(NtripSocket lsock, RelayClient *cl, double now)
+{
+    for (;;) {
+        struct sockaddr_storage sa;
+        socklen_t sa_len = sizeof(sa);
+        NtripSocket s = accept(lsock, (struct sockaddr *)&sa, &sa_len);
+        if (s == NTRIP_INVALID_SOCKET) return;
+
+        RelayClient *c = NULL;
+        for (int i = 0; i < NTRIP_RELAY_MAX_CLIENTS; i++) {
+            if (cl[i].state == RC_FREE) {
+                c = &cl[i];
+                break;
+            }
+        }
+        if (!c) {
+            static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+            send(s, busy, (int)sizeof(busy) - 1, MSG_NOSIGNAL);
+            CLOSESOCKET(s);
+            continue;
+        }
+        ntrip_socket_set_blocking(s, false);
+        /* Keep the kernel's copy small: the ring is the buffer, and a slow
+         * client should show up as lag there rather than hide in the socket. */
+        int sndbuf = RELAY_SNDBUF;
+        setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char *)&sndbuf, sizeof(sndbuf));
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        memset(c, 0, sizeof(*c));
+        c->sock   = s;
+        c->state  = RC_REQUEST;
+        c->mount  = -1;
+        c->t_open = now;
+        NtripAddr a;
+        memcpy(&a.sa, &sa, sizeof(sa));
+        a.len = (int)sa_len;
+        ntrip_addr_str(&a, c->peer, sizeof(c->peer));
+    }
+}
+
+/* ── Setup and main loop ───────────────────────────────────────────── */
+
+static NtripSocket relay_listen(const char *bind_addr, int port)
+{
+    NtripSocket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NTRIP_INVALID_SOCKET) return s;
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port   = htons((unsigned short)port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind_addr && bind_addr[0] && inet_pton(AF_INET, bind_addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "[ERROR] --relay: \"%s\" is not an IPv4 address\n", bind_addr);
+        CLOSESOCKET(s);
+        return NTRIP_INVALID_SOCKET;
+    }
+    if (bind(s, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(s, 64) != 0) {
+        fprintf(stderr, "[ERROR] --relay: cannot listen on %s:%d\n",
+                bind_addr && bind_addr[0] ? bind_addr : "0.0.0.0", port);
+        CLOSESOCKET(s);
+        return NTRIP_INVALID_SOCKET;
+    }
+    ntrip_socket_set_blocking(s, false);
+    return s;
+}
+
+/* Loopback UDP pair for waking the client loop from upstream threads. */
+static bool relay_wake_open(RelayCtx *ctx)
+{
+    struct sockaddr_in sa;
+    socklen_t len = sizeof(sa);
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family      = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    ctx->wake_rx = socket(AF_INET, SOCK_DGRAM, 0);
+    ctx->wake_tx = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ctx->wake_rx == NTRIP_INVALID_SOCKET || ctx->wake_tx == NTRIP_INVALID_SOCKET ||
+        bind(ctx->wake_rx, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+        getsockname(ctx->wake_rx, (struct sockaddr *)&sa, &len) != 0 ||
+        connect(ctx->wake_tx, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+        return false;
+    ntrip_socket_set_blocking(ctx->wake_rx, false);
+    return true;
+}
+
+/* Client-side gauges for the exporter: clients and the lag of the
+ * slowest one per mountpoint (the relay's queue depth), handed to the
+ * upstream thread, which publishes them with the rest. */
+static void relay_export_clients(RelayCtx *ctx, const RelayClient *cl)
+{
+    for (int i = 0; i < ctx->n; i++) {
+        RelayMount *m = &ctx->m[i];
+        RELAY_LOCK(&m->lock);
+        uint64_t head = m->head;
+        uint64_t lag = 0;
+        for (int c = 0; c < NTRIP_RELAY_MAX_CLIENTS; c++) {
+            if (cl[c].state == RC_STREAM && cl[c].mount == i && head - cl[c].cursor > lag)
+                lag = head - cl[c].cursor;
+        }
+        m->export_clients = (uint32_t)m->clients;
+        m->export_lag     = lag;
+        RELAY_UNLOCK(&m->lock);
+    }
+}
+
+/* Every local source has returned and every client has been sent all
+ * of it, or has had two seconds to. */
+static bool relay_sources_drained(const RelayCtx *ctx, const RelayClient *cl,
+                                  double now, double *done_at)
+{
+    for (int i = 0; i < ctx->n; i++)
+        if (!__atomic_load_n(&ctx->m[i].source_done, __ATOMIC_ACQUIRE)) return false;
+    if (*done_at == 0.0) *done_at = now;
+    if (now - *done_at >= 2.0) return true;
+    for (int c = 0; c < NTRIP_RELAY_MAX_CLIENTS; c++) {
+        if (cl[c].state == RC_FREE) continue;
+        if (cl[c].state != RC_STREAM || cl[c].out) return false;
+        RelayMount *m = &ctx->m[cl[c].mount];
+        RELAY_LOCK(&m->lock);
+        uint64_t head = m->head;
+        RELAY_UNLOCK(&m->lock);
+        if (cl[c].cursor != head) return false;
+    }
+    return true;
+}
+
+static void relay_print_summary(const RelayCtx *ctx, double elapsed)
+{
+    printf("\nRelay summary (%.0f s)\n", elapsed);
+    printf("+----------------------+--------------------------------+------------+---------+------------+---------+---------+--------------+\n");
+    printf("| Mountpoint           | Caster                         | Upstream   | Frames  | Reconnects | Clients | Dropped | Bytes out    |\n");
+    printf("+----------------------+--------------------------------+------------+---------+------------+---------+---------+--------------+\n");
+    for (int i = 0; i < ctx->n; i++) {
+        const RelayMount *m = &ctx->m[i];
+        char caster[64];
+        if (m->source)
+            snprintf(caster, sizeof(caster), "(local source)");
+        else
+            snprintf(caster, sizeof(caster), "%.50s:%d", m->cfg.NTRIP_CASTER, m->cfg.NTRIP_PORT);
+        printf("| %-20.20s | %-30.30s | %-10s | %7lu | %10d | %7lu | %7lu | %12llu |\n",
+               m->cfg.MOUNTPOINT, caster, up_state_name(m->state), m->frames,
+               m->reconnects, m->clients_total, m->dropped, m->bytes_out);
+    }
+    printf("+----------------------+--------------------------------+------------+---------+------------+---------+---------+--------------+\n");
+    for (int i = 0; i < ctx->n; i++) {
+        if (ctx->m[i].state == UP_FAILED && ctx->m[i].note[0])
+            printf("%-22s [%s]\n", ctx->m[i].cfg.MOUNTPOINT, ctx->m[i].note);
+    }
+}
+
+static int relay_run(const NTRIP_Config *mounts, int n, NtripRelaySource source, void *source_user,
+                     const char *bind_addr, int port, int duration_s,
+                     const volatile int *stop_flag, bool quiet)
+{
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(mounts[i].MOUNTPOINT, mounts[j].MOUNTPOINT) == 0) {
+                fprintf(stderr, "[ERROR] --relay: mountpoint %s is listed twice\n",
+                        mounts[i].MOUNTPOINT);
+                return -1;
+            }
+        }
+    }
+
+    RelayCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.n     = n;
+    ctx.quiet = quiet;
+    ctx.m     = (RelayMount *)calloc((size_t)n, sizeof(RelayMount));
+    RelayClient *cl = (RelayClient *)calloc(NTRIP_RELAY_MAX_CLIENTS, sizeof(RelayClient));
+    RelayPollFd *pfd = (RelayPollFd *)calloc(NTRIP_RELAY_MAX_CLIENTS + 2, sizeof(RelayPollFd));
+    int *pfd_client  = (int *)calloc(NTRIP_RELAY_MAX_CLIENTS + 2, sizeof(int));
+    if (!ctx.m || !cl || !pfd || !pfd_client) {
+        fprintf(stderr, "[ERROR] Out of memory for the relay\n");
+        free(ctx.m); free(cl); free(pfd); free(pfd_client);
+        return -1;
+    }
+    RELAY_LOCK_INIT(&ctx.wake_lock);
+    for (int i = 0; i < NTRIP_RELAY_MAX_CLIENTS; i++) cl[i].sock = NTRIP_INVALID_SOCKET;
+
+    int rc = -1;
+    MetricsMount *mx = NULL;
+    MetricsServer *metrics = NULL;
+    MetricsMount *status_view = NULL;   /* status line: newest snapshot of each mount */
+    uint32_t *status_seen = NULL;
+    int *status_state = NULL;
+    NtripSocket lsock = relay_listen(bind_addr, port);
+    if (lsock == NTRIP_INVALID_SOCKET) goto out;
+    if (!relay_wake_open(&ctx)) {
+        fprintf(stderr, "[ERROR] --relay: cannot open the loopback wake socket\n");
+        goto out;
+    }
+
+    for (int i = 0; i < n; i++) {
+        RelayMount *m = &ctx.m[i];
+        m->cfg  = mounts[i];
+        m->ctx  = &ctx;
+        m->source      = source;
+        m->source_user = source_user;
+        m->ring = (unsigned char *)malloc(NTRIP_RELAY_RING_SIZE);
+        if (!m->ring) {
+            fprintf(stderr, "[ERROR] Out of memory for the relay ring of %s\n", m->cfg.MOUNTPOINT);
+            goto out;
+        }
+        snprintf(m->tag, sizeof(m->tag), "[RELAY %.48s]", m->cfg.MOUNTPOINT);
+        RELAY_LOCK_INIT(&m->lock);
+    }
+    /* Every mount publishes a metrics snapshot: the status line reads
+     * them, and so does --metrics-listen if it is on. */
+    mx           = metrics_mounts_new(n);
+    status_view  = (MetricsMount *)malloc(sizeof(MetricsMount));
+    status_seen  = (uint32_t *)calloc((size_t)n, sizeof(uint32_t));
+    status_state = (int *)calloc((size_t)n, sizeof(int));
+    if (!mx || !status_view || !status_seen || !status_state) {
+        fprintf(stderr, "[ERROR] Out of memory for the relay\n");
+        goto out;
+    }
+    for (int i = 0; i < n; i++) {
+        metrics_mount_label(&mx[i], ctx.m[i].cfg.MOUNTPOINT, ctx.m[i].cfg.NTRIP_CASTER,
+                            ctx.m[i].cfg.NTRIP_PORT);
+        mx[i].state = METRICS_CONNECTING;
+        metrics_mount_publish(&mx[i], 0.0, true);
+        ctx.m[i].mx = &mx[i];
+    }
+    if (metrics_enabled()) {
+        metrics = metrics_server_start(mx, n, "relay");
+        if (!metrics) goto out;
+    }
+    double t0 = relay_now();
+    for (int i = 0; i < n; i++) {
+        RelayMount *m = &ctx.m[i];
+#ifdef _WIN32
+        m->thread  = (HANDLE)_beginthreadex(NULL, 0, relay_upstream_thread, m, 0, NULL);
+        m->started = m->thread != NULL;
+#else
+        m->started = pthread_create(&m->thread, NULL, relay_upstream_thread, m) == 0;
+#endif
+        if (!m->started) relay_set_state(m, UP_FAILED, "thread start failed");
+    }
+    /* Streams come up while the upstream sourcetables are fetched; clients
+     * that connect meanwhile wait in the listen backlog. */
+    relay_build_sourcetable(ctx.m, n);
+
+    if (!quiet)
+        fprintf(stderr, "[RELAY] Serving %d mountpoint(s) on %s:%d%s\n", n,
+                bind_addr && bind_addr[0] ? bind_addr : "0.0.0.0", port,
+                duration_s > 0 ? "" : ", Ctrl-C to stop");
+
+    double next_status = t0 + RELAY_STATUS_INTERVAL;
+    double next_export = t0;
+    double sources_done_at = 0.0;
+    rc = 0;
+    for (;;) {
+        double now = relay_now();
+        if (stop_flag && *stop_flag) break;
+        if (duration_s > 0 && now - t0 >= duration_s) break;
+        if (source && relay_sources_drained(&ctx, cl, now, &sources_done_at)) break;
+
+        /* Clear the wake flag before looking at the rings, so a frame
+         * published from here on sends another wake-up. */
+        RELAY_LOCK(&ctx.wake_lock);
+        ctx.wake_pending = false;
+        RELAY_UNLOCK(&ctx.wake_lock);
+
+        for (int i = 0; i < NTRIP_RELAY_MAX_CLIENTS; i++) {
+            if (cl[i].state == RC_REQUEST && now - cl[i].t_open > NTRIP_RELAY_REQUEST_TIMEOUT_S)
+                client_close(&ctx, &cl[i]);
+            else if (cl[i].state >= RC_STREAM && !cl[i].blocked)
+                client_flush(&ctx, &cl[i]);
+            else if (cl[i].state == RC_STREAM && !cl[i].out) {
+                /* Blocked: waits for POLLOUT, but must not be lapped meanwhile */
+                RelayMount *m = &ctx.m[cl[i].mount];
+                RELAY_LOCK(&m->lock);
+                uint64_t head = m->head;
+                RELAY_UNLOCK(&m->lock);
+                client_lapped(&ctx, &cl[i], head - cl[i].cursor);
+            }
+        }
+
+        int np = 0;
+        pfd[np].fd = lsock;       pfd[np].events = POLLIN; pfd[np].revents = 0; pfd_client[np++] = -1;
+        pfd[np].fd = ctx.wake_rx; pfd[np].events = POLLIN; pfd[np].revents = 0; pfd_client[np++] = -1;
+        for (int i = 0; i < NTRIP_RELAY_MAX_CLIENTS; i++) {
+            if (cl[i].state == RC_FREE) continue;
+            pfd[np].fd      = cl[i].sock;
+            pfd[np].events  = (short)(POLLIN | (cl[i].blocked ? POLLOUT : 0));
+            pfd[np].revents = 0;
+            pfd_client[np++] = i;
+        }
+
+        int timeout_ms = (int)((next_status - now) * 1000.0);
+        if (timeout_ms > 1000) timeout_ms = 1000;
+        if (timeout_ms < 0) timeout_ms = 0;
+        int k = relay_poll(pfd, np, timeout_ms);
+        now = relay_now();
+        if (k < 0) continue;        /* EINTR: the stop flag is checked above */
+
+        if (pfd[1].revents) {
+            char drain[64];
+            while (recv(ctx.wake_rx, drain, sizeof(drain), 0) > 0) { }
+        }
+        for (int p = 2; p < np; p++) {
+            RelayClient *c = &cl[pfd_client[p]];
+            if (c->state == RC_FREE || !pfd[p].revents) continue;
+            if (pfd[p].revents & (POLLIN | POLLERR | POLLHUP)) client_read(&ctx, c);
+            if (c->state != RC_FREE && (pfd[p].revents & POLLOUT)) client_flush(&ctx, c);
+        }
+        if (pfd[0].revents & POLLIN) client_accept(lsock, cl, now);
+        /* Replies just queued by client_read() go out on the next pass */
+
+        if (now >= next_export) {
+            next_export = now + 1.0;
+            relay_export_clients(&ctx, cl);
+        }
+
+        if (!quiet && now >= next_status) {
+            next_status = now + RELAY_STATUS_INTERVAL;
+            int up = 0, clients = 0;
+            unsigned long long out = 0;
+            for (int i = 0; i < n; i++) {
+                if (metrics_mount_read(&mx[i], status_view, &status_seen[i]))
+                    status_state[i] = status_view->state;
+                if (status_state[i] == METRICS_STREAMING) up++;
+                clients += ctx.m[i].clients;
+                out     += ctx.m[i].bytes_out;
+            }
+            fprintf(stderr, "[RELAY] t=%4.0fs  upstream %d/%d streaming  clients %d  out %.1f MB\n",
+                    now - t0, up, n, clients, out / 1048576.0);
+        }
+    }
+
+    ctx.stop = 1;
+    for (int i = 0; i < NTRIP_RELAY_MAX_CLIENTS; i++) {
+        if (cl[i].state != RC_FREE) client_close(&ctx, &cl[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        RelayMount *m = &ctx.m[i];
+        if (!m->started) continue;
+#ifdef _WIN32
+        WaitForSingleObject(m->thread, INFINITE);
+        CloseHandle(m->thread);
+#else
+        pthread_join(m->thread, NULL);
+#endif
+    }
+    relay_print_summary(&ctx, relay_now() - t0);
+
+out:
+    metrics_server_stop(metrics);
+    metrics_mounts_free(mx, n);
+    free(status_view);
+    free(status_seen);
+    free(status_state);
+    if (lsock != NTRIP_INVALID_SOCKET) CLOSESOCKET(lsock);
+    if (ctx.wake_rx != NTRIP_INVALID_SOCKET && ctx.wake_rx) CLOSESOCKET(ctx.wake_rx);
+    if (ctx.wake_tx != NTRIP_INVALID_SOCKET && ctx.wake_tx) CLOSESOCKET(ctx.wake_tx);
+    for (int i = 0; i < n; i++) {
+        if (!ctx.m[i].ring) continue;
+        free(ctx.m[i].ring);
+        RELAY_LOCK_FREE(&ctx.m[i].lock);
+    }
+    RELAY_LOCK_FREE(&ctx.wake_lock);
+    free(ctx.m);
+    free(cl);
+    free(pfd);
+    free(pfd_client);
+    return rc;
+}
+
+int ntrip_relay_run(const NTRIP_Config *mounts, int n, const char *bind_addr, int port,
+                    int duration_s, const volatile int *stop_flag, bool quiet)
+{
+    return relay_run(mounts, n, NULL, NULL, bind_addr, port, duration_s, stop_flag, quiet);
+}
+
+int ntrip_relay_serve(const char *mountpoint, double lat, double lon,
+                      NtripRelaySource source, void *user,
+                      const char *bind_addr, int port, int duration_s,
+                      const volatile int *stop_flag, bool quiet)
+{
+    NTRIP_Config c;
+    memset(&c, 0, sizeof(c));
+    snprintf(c.MOUNTPOINT, sizeof(c.MOUNTPOINT), "%s", mountpoint);
+    c.LATITUDE  = lat;
+    c.LONGITUDE = lon;
+    return relay_run(&c, 1, source, user, bind_addr, port, duration_s, stop_flag, quiet);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file ntrip_relay.h
+ * @brief Local caster mode: one upstream connection per mountpoint,
+ *        re-served to any number of local NTRIP clients.
+ *
+ * Casters limit concurrent logins per account, and every receiver, QA
+ * tool and logger on a site opening its own connection soon runs into
+ * that limit.  ntrip_relay_run() holds exactly one upstream connection
+ * per mountpoint (an NtripSession, so drops are re-opened with backoff)
+ * and listens for local NTRIP 1.0 and 2.0 clients:
+ *
+ *   - "GET /" (or an unknown mountpoint from an NTRIP 1.0 client) gets
+ *     the relay's own sourcetable: the upstream STR records of the
+ *     relayed mountpoints, with authentication disabled and NMEA off,
+ *     since clients share one upstream position.
+ *   - "GET /MOUNT" gets "ICY 200 OK" (NTRIP 1.0) or "HTTP/1.1 200 OK"
+ *     (NTRIP 2.0, plain body) and from then on the stream.
+ *
+ * Only CRC-valid frames are relayed, whole, so a client always starts
+ * at a frame boundary and never sees an upstream resync.  Every
+ * mountpoint has one shared ring (@ref NTRIP_RELAY_RING_SIZE) that the
+ * upstream thread appends frames to; each client keeps only its read
+ * position and is sent straight from the ring, so a frame is stored
+ * once however many clients receive it.  The upstream side never waits
+ * for a client: one that falls so far behind that the ring is about to
+ * overwrite its unsent bytes is disconnected, and the others carry on.
+ *
+ * Clients need no login; GGA sentences they send are read and dropped
+ * (the upstream GGA comes from the config, as in the other modes).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef NTRIP_RELAY_H
+#define NTRIP_RELAY_H
+
+#include <stdbool.h>
+
+#include "ntrip_handler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Ring bytes per relayed mountpoint; a client this far behind is dropped. */
+#define NTRIP_RELAY_RING_SIZE     (1u << 20)
+
+/** @brief Local clients served at once; more are refused with 503. */
+#define NTRIP_RELAY_MAX_CLIENTS   256
+
+/** @brief A client that sent no complete request within this time is closed (s). */
+#define NTRIP_RELAY_REQUEST_TIMEOUT_S  10
+
+/** @brief Default listening port of --relay. */
+#define NTRIP_RELAY_DEFAULT_PORT  2101
+
+/**
+ * @brief Publishes one whole frame to the clients of a mountpoint;
+ *        handed to an @ref NtripRelaySource.
+ */
+typedef void (*NtripRelayEmit)(const unsigned char *frame, int frame_len, void *emit_user);
+
+/**
+ * @brief Frame producer that runs on the upstream thread in place of an
+ *        NtripSession (see ntrip_relay_serve()).
+ *
+ * Calls @p emit for every frame, from this thread only, and returns when
+ * @p stop turns non-zero or it has nothing more to send.
+ */
+typedef void (*NtripRelaySource)(NtripRelayEmit emit, void *emit_user,
+                                 const volatile int *stop, void *user);
+
+/**
+ * @brief Relay @p n mountpoints to local clients until stopped.
+ *
+ * Winsock must already be initialised on Windows.
+ *
+ * @param mounts      One config per upstream mountpoint; the local name
+ *                    is the upstream MOUNTPOINT, which must be unique.
+ * @param bind_addr   IPv4 address to listen on; NULL or "" = all.
+ * @param port        TCP port to listen on.
+ * @param duration_s  Stop after this many seconds; 0 runs until @p stop_flag.
+ * @param stop_flag   Non-zero ends the run.
+ * @param quiet       Suppress the periodic status line on stderr.
+ * @return 0 after a normal stop, -1 if the port could not be opened or
+ *         no mountpoint was usable.
+ */
+int ntrip_relay_run(const NTRIP_Config *mounts, int n, const char *bind_addr, int port,
+                    int duration_s, const volatile int *stop_flag, bool quiet);
+
+/**
+ * @brief Serve the frames of a local @p source as mountpoint
+ *        @p mountpoint, the same way ntrip_relay_run() serves an upstream.
+ *
+ * Used by the stream generator (rtcm_gen.h) to act as a caster.  Once the
+ * source returns, clients are given up to two seconds to catch up and
+ * the call returns.
+ *
+ * @param lat, lon  Position for the sourcetable entry.
+ * @param user      Passed to @p source.
+ * Other parameters and the return value as ntrip_relay_run().
+ */
+int ntrip_relay_serve(const char *mountpoint, double lat, double lon,
+                      NtripRelaySource source, void *user,
+                      const char *bind_addr, int port, int duration_s,
+                      const volatile int *stop_flag, bool quiet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_RELAY_H */
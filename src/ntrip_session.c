@@ -0,0 +1,390 @@
+/**
+ * @file ntrip_session.c
+ * @brief NTRIP stream connection that survives caster restarts and resets.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "ntrip_session.h"
+#include "stream_clock.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define SESSION_CLOSE(s)  closesocket(s)
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define SESSION_CLOSE(s)  close(s)
+#endif
+
+/* A connection that stayed up this long starts the next outage with the
+ * shortest delay again. */
+#define SESSION_STABLE_S  60.0
+
+static double session_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void session_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* xorshift32 for the jitter; seeded once from the clock so clients that
+ * lost the same caster at the same moment spread out. */
+static uint32_t session_rand(void)
+{
+    static uint32_t x;
+    if (!x) x = (uint32_t)time(NULL) ^ (uint32_t)(session_now() * 1e6) ^ 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/* Fill s->addrs from the DNS cache (or, with @p fresh, from DNS).  On
+ * failure the previous list is kept, so an outage of the resolver does
+ * not stop reconnects to known addresses. */
+static bool session_resolve(NtripSession *s, bool fresh)
+{
+    NtripAddr got[NTRIP_SESSION_MAX_ADDRS];
+    int n = ntrip_dns_lookup(s->host, s->port, got, NTRIP_SESSION_MAX_ADDRS, fresh);
+    if (n == 0) return false;
+    memcpy(s->addrs, got, (size_t)n * sizeof(got[0]));
+    s->n_addrs = n;
+    s->cur     = 0;
+    return true;
+}
+
+/* TLS handshake on a fresh connection, offering the cached session. */
+static bool session_tls(NtripSession *s, NtripSocket sock)
+{
+    NtripTls *t = ntrip_tls_new(sock, s->host, s->port,
+                                !(s->flags & NTRIP_SESSION_TLS_NOVERIFY));
+    if (!t || !ntrip_tls_handshake(t, NTRIP_SESSION_CONNECT_MS)) {
+        fprintf(stderr, "%s TLS handshake with %s:%d failed: %s\n",
+                s->tag, s->host, s->port, t ? ntrip_tls_error(t) : "TLS not available");
+        ntrip_tls_free(t);
+        return false;
+    }
+    if (ntrip_tls_resumed(t)) {
+        s->tls_resumed++;
+        s->tls_resumed_ms += ntrip_tls_handshake_ms(t);
+    } else {
+        s->tls_full++;
+        s->tls_full_ms += ntrip_tls_handshake_ms(t);
+    }
+    s->tls = t;
+    return true;
+}
+
+/* Send the GET request on a fresh connection to address @p i. */
+static bool session_request(NtripSession *s, NtripSocket sock, int i)
+{
+    if ((s->flags & NTRIP_SESSION_TLS) && !session_tls(s, sock)) {
+        SESSION_CLOSE(sock);
+        return false;
+    }
+
+    char request[1024];
+    int len = snprintf(request, sizeof(request),
+                       "GET /%s HTTP/1.1\r\n"
+                       "Host: %s\r\n"
+                       "Ntrip-Version: Ntrip/2.0\r\n"
+                       "User-Agent: NTRIP CClient/1.0\r\n"
+                       "Authorization: Basic %s\r\n"
+                       "\r\n",
+                       s->mountpoint, s->host, s->auth_basic);
+    if (ntrip_io_send(sock, s->tls, request, len) != len) {
+        ntrip_tls_free(s->tls);
+        s->tls = NULL;
+        SESSION_CLOSE(sock);
+        return false;
+    }
+
+    if (s->recv_timeout_ms > 0) {
+#ifdef _WIN32
+        DWORD tv_ms = (DWORD)s->recv_timeout_ms;
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv_ms, sizeof(tv_ms));
+#else
+        struct timeval tv = { s->recv_timeout_ms / 1000, (s->recv_timeout_ms % 1000) * 1000 };
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char *)&tv, sizeof(tv));
+#endif
+    }
+#ifdef SO_TIMESTAMPNS
+    /* Kernel receive timestamps for the age of corrections (corr_age.h) */
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+#endif
+
+    ntrip_http_init(&s->http);
+    s->sock         = sock;
+    s->cur          = i;
+    s->connected_at = session_now();
+    return true;
+}
+
+/* One race over every known address, starting at the last good one. */
+static bool session_try_all(NtripSession *s)
+{
+    int i = 0;
+    NtripSocket sock = ntrip_connect_race(s->addrs, s->n_addrs, s->cur,
+                                          NTRIP_SESSION_CONNECT_MS, &i);
+    return sock != NTRIP_INVALID_SOCKET && session_request(s, sock, i);
+}
+
+bool ntrip_session_open(NtripSession *s, const char *host, int port,
+                        const char *mountpoint, const char *auth_basic,
+                        int reconnect_max_s, int recv_timeout_ms, const char *tag,
+                        unsigned flags)
+{
+    memset(s, 0, sizeof(*s));
+    s->sock            = NTRIP_INVALID_SOCKET;
+    s->recv_timeout_ms = recv_timeout_ms;
+    s->tag             = tag ? tag : "[NTRIP]";
+    s->port            = port;
+    s->flags           = flags;
+    s->backoff_ms      = NTRIP_SESSION_BACKOFF_MIN_MS;
+    s->backoff_max_ms  = reconnect_max_s < 0 ? 0
+                       : (reconnect_max_s ? reconnect_max_s : NTRIP_SESSION_BACKOFF_MAX_S) * 1000;
+    snprintf(s->host,       sizeof(s->host),       "%s", host ? host : "");
+    snprintf(s->mountpoint, sizeof(s->mountpoint), "%s", mountpoint ? mountpoint : "");
+    snprintf(s->auth_basic, sizeof(s->auth_basic), "%s", auth_basic ? auth_basic : "");
+
+    if ((flags & NTRIP_SESSION_TLS) && !ntrip_tls_available()) {
+        fprintf(stderr, "%s TLS requested for %s:%d, but this build has no TLS support\n",
+                s->tag, s->host, s->port);
+        return false;
+    }
+    if (!session_resolve(s, false)) {
+        fprintf(stderr, "%s DNS lookup failed for %s\n", s->tag, s->host);
+        return false;
+    }
+    if (!session_try_all(s)) {
+        fprintf(stderr, "%s Connect failed to %s:%d\n", s->tag, s->host, s->port);
+        return false;
+    }
+    return true;
+}
+
+/* Close the books on outage @p g. */
+static void session_end_gap(NtripSession *s, int g, time_t lost, double t_lost)
+{
+    double secs = session_now() - t_lost;
+    s->gap_total_s += secs;
+    if (secs > s->gap_longest_s) s->gap_longest_s = secs;
+    if (g < NTRIP_SESSION_MAX_GAPS) {
+        s->gaps[g].lost    = lost;
+        s->gaps[g].resumed = time(NULL);
+        s->gaps[g].seconds = secs;
+    }
+}
+
+static void session_hms(time_t t, char *out, size_t len)
+{
+    struct tm *gt = gmtime(&t);
+    if (!gt || !strftime(out, len, "%H:%M:%S", gt)) snprintf(out, len, "?");
+}
+
+/* Sleep @p ms in short steps; true if @p should_stop fired. */
+static bool session_wait(int ms, NtripSessionStopFn should_stop, void *user)
+{
+    while (ms > 0) {
+        if (should_stop && should_stop(user)) return true;
+        int step = ms < 100 ? ms : 100;
+        session_sleep_ms(step);
+        ms -= step;
+    }
+    return should_stop && should_stop(user);
+}
+
+bool ntrip_session_resume(NtripSession *s, const char *why,
+                          NtripSessionStopFn should_stop, void *user)
+{
+    ntrip_session_close(s);
+
+    time_t lost   = time(NULL);
+    double t_lost = session_now();
+    int    g      = s->gap_count++;
+
+    if (s->backoff_max_ms <= 0) {
+        fprintf(stderr, "%s Connection lost (%s)\n", s->tag, why ? why : "error");
+        session_end_gap(s, g, lost, t_lost);
+        return false;
+    }
+    if (t_lost - s->connected_at >= SESSION_STABLE_S)
+        s->backoff_ms = NTRIP_SESSION_BACKOFF_MIN_MS;
+
+    fprintf(stderr, "%s Connection lost (%s); reconnecting\n", s->tag, why ? why : "error");
+    fflush(stderr);
+
+    int attempts = 0;
+    for (;;) {
+        /* Half the delay fixed, half random */
+        int half = s->backoff_ms / 2;
+        if (session_wait(half + (int)(session_rand() % (uint32_t)(half + 1)), should_stop, user))
+            break;
+
+        attempts++;
+        if (session_try_all(s)) {
+            s->reconnects++;
+            session_end_gap(s, g, lost, t_lost);
+            char a[16], b[16], where[80], tls[64] = "";
+            session_hms(lost, a, sizeof(a));
+            session_hms(time(NULL), b, sizeof(b));
+            if (s->tls)
+                snprintf(tls, sizeof(tls), "; TLS %s in %.1f ms",
+                         ntrip_tls_resumed(s->tls) ? "resumed" : "full handshake",
+                         ntrip_tls_handshake_ms(s->tls));
+            fprintf(stderr, "%s Reconnected to %s after %d attempt(s); gap %s - %s UTC (%.1f s)%s\n",
+                    s->tag, ntrip_addr_str(&s->addrs[s->cur], where, sizeof(where)), attempts,
+                    a, b, session_now() - t_lost, tls);
+            fflush(stderr);
+            return true;
+        }
+
+        /* Every known address refused: the caster may have moved */
+        session_resolve(s, true);
+        if (s->backoff_ms < s->backoff_max_ms) {
+            s->backoff_ms *= 2;
+            if (s->backoff_ms > s->backoff_max_ms) s->backoff_ms = s->backoff_max_ms;
+        }
+        if (attempts == 1 || attempts % 10 == 0)
+            fprintf(stderr, "%s Reconnect attempt %d to %s:%d failed; next in about %d s\n",
+                    s->tag, attempts, s->host, s->port, s->backoff_ms / 1000);
+    }
+
+    session_end_gap(s, g, lost, t_lost);
+    return false;
+}
+
+bool ntrip_session_set_target(NtripSession *s, const char *host, int port,
+                              const char *mountpoint, const char *auth_basic,
+                              int reconnect_max_s, unsigned flags)
+{
+    if ((flags & NTRIP_SESSION_TLS) && !ntrip_tls_available()) {
+        fprintf(stderr, "%s TLS requested for %s:%d, but this build has no TLS support\n",
+                s->tag, host, port);
+        return false;
+    }
+    /* Resolve into a copy so a failure keeps the running target. */
+    NtripSession t;
+    snprintf(t.host, sizeof(t.host), "%s", host ? host : "");
+    t.port = port;
+    if (!session_resolve(&t, false)) {
+        fprintf(stderr, "%s DNS lookup failed for %s\n", s->tag, t.host);
+        return false;
+    }
+    memcpy(s->host, t.host, sizeof(s->host));
+    memcpy(s->addrs, t.addrs, sizeof(s->addrs));
+    s->n_addrs = t.n_addrs;
+    s->cur     = 0;
+    s->port    = port;
+    s->flags   = flags;
+    snprintf(s->mountpoint, sizeof(s->mountpoint), "%s", mountpoint ? mountpoint : "");
+    snprintf(s->auth_basic, sizeof(s->auth_basic), "%s", auth_basic ? auth_basic : "");
+    s->backoff_max_ms = reconnect_max_s < 0 ? 0
+                      : (reconnect_max_s ? reconnect_max_s : NTRIP_SESSION_BACKOFF_MAX_S) * 1000;
+    s->backoff_ms = NTRIP_SESSION_BACKOFF_MIN_MS;     /* a new target starts over */
+    return true;
+}
+
+void ntrip_session_close(NtripSession *s)
+{
+    ntrip_tls_free(s->tls);
+    s->tls = NULL;
+    if (s->sock != NTRIP_INVALID_SOCKET) {
+        SESSION_CLOSE(s->sock);
+        s->sock = NTRIP_INVALID_SOCKET;
+    }
+}
+
+int ntrip_session_recv(NtripSession *s, void *buf, int len)
+{
+#ifdef SO_TIMESTAMPNS
+    if (!s->tls) {
+        struct iovec iov = { buf, (size_t)len };
+        union {
+            char           buf[CMSG_SPACE(sizeof(struct timespec))];
+            struct cmsghdr align;
+        } ctl;
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = ctl.buf;
+        msg.msg_controllen = sizeof(ctl.buf);
+        int r = (int)recvmsg(s->sock, &msg, 0);
+        if (r > 0) {
+            s->rx_utc_ns = 0;
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec ts;
+                    memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    s->rx_utc_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+                }
+            }
+            if (s->rx_utc_ns == 0) s->rx_utc_ns = stream_clock_utc_ns();
+        }
+        return r;
+    }
+#endif
+    int r = ntrip_io_recv(s->sock, s->tls, buf, len);
+    if (r > 0) s->rx_utc_ns = stream_clock_utc_ns();
+    return r;
+}
+
+int ntrip_session_send(NtripSession *s, const void *buf, int len)
+{
+    return ntrip_io_send(s->sock, s->tls, buf, len);
+}
+
+bool ntrip_session_pending(const NtripSession *s)
+{
+    return ntrip_tls_pending(s->tls) > 0;
+}
+
+void ntrip_session_print_gaps(const NtripSession *s, FILE *out)
+{
+    if (s->tls_full + s->tls_resumed > 0)
+        fprintf(out, "%s TLS handshakes: %d full (%.1f ms avg), %d resumed (%.1f ms avg)\n",
+                s->tag, s->tls_full, s->tls_full ? s->tls_full_ms / s->tls_full : 0.0,
+                s->tls_resumed, s->tls_resumed ? s->tls_resumed_ms / s->tls_resumed : 0.0);
+    if (s->reconnects == 0) return;
+    fprintf(out, "%s Reconnects: %d  outages: %d  total gap: %.1f s  longest: %.1f s\n",
+            s->tag, s->reconnects, s->gap_count, s->gap_total_s, s->gap_longest_s);
+    int n = s->gap_count < NTRIP_SESSION_MAX_GAPS ? s->gap_count : NTRIP_SESSION_MAX_GAPS;
+    for (int i = 0; i < n; i++) {
+        char a[16], b[16];
+        session_hms(s->gaps[i].lost, a, sizeof(a));
+        session_hms(s->gaps[i].resumed, b, sizeof(b));
+        fprintf(out, "%s   gap %2d: %s - %s UTC (%.1f s)\n",
+                s->tag, i + 1, a, b, s->gaps[i].seconds);
+    }
+    if (s->gap_count > n)
+        fprintf(out, "%s   ... %d more\n", s->tag, s->gap_count - n);
+}
@@ -0,0 +1,219 @@
+/**
+ * @file ntrip_session.h
+ * @brief NTRIP stream connection that survives caster restarts and resets.
+ *
+ * An NtripSession opens a mountpoint (connect, GET request) and, when the
+ * connection is lost, opens it again: first at the address that worked,
+ * then at the other addresses the caster name resolved to (IPv4 and IPv6
+ * raced as in ntrip_connect_race()), and after a full round of failures
+ * at freshly resolved addresses.  Attempts are
+ * spaced by an exponential backoff (1 s doubling up to
+ * RECONNECT_DELAY_MAX, 60 s by default) with random jitter, so a caster
+ * coming back up is not hit by every client on the same second.
+ *
+ * The session only owns the socket and the reply decoder (@c http, see
+ * ntrip_http.h), which starts over with every connection.  Everything the
+ * stream loop has accumulated -- statistics, heatmap sectors, the
+ * ephemeris store -- lives in the loop and carries on; the loop calls
+ * rtcm_framer_reset() so the partial frame from the old connection is not
+ * glued to the first bytes of the new one.
+ *
+ * Every outage is reported on stderr as it ends:
+ * @code
+ * [OBS] Connection lost (caster closed the connection); reconnecting
+ * [OBS] Reconnected to 192.0.2.10:2101 after 3 attempt(s); gap 14:02:11 - 14:02:18 UTC (7.2 s)
+ * @endcode
+ * and ntrip_session_print_gaps() lists them all at the end of a run.
+ *
+ * With NTRIP_SESSION_TLS the connection runs over TLS (ntrip_tls.h); every
+ * reconnect then offers the caster's cached session ticket, and the loop
+ * reads and writes through ntrip_session_recv() / ntrip_session_send().
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef NTRIP_SESSION_H
+#define NTRIP_SESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "ntrip_connect.h"
+#include "ntrip_http.h"
+#include "ntrip_tls.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Caster addresses kept from one name lookup. */
+#define NTRIP_SESSION_MAX_ADDRS  NTRIP_CONNECT_MAX_ADDRS
+
+/** @brief Outages kept for ntrip_session_print_gaps(); later ones are only counted. */
+#define NTRIP_SESSION_MAX_GAPS   64
+
+/** @brief First reconnect delay (ms); doubled after every failed attempt. */
+#define NTRIP_SESSION_BACKOFF_MIN_MS  1000
+
+/** @brief RECONNECT_DELAY_MAX when the config leaves it at 0 (s). */
+#define NTRIP_SESSION_BACKOFF_MAX_S   60
+
+/** @brief Seconds without a byte after which a polling loop treats the
+ *         connection as dead (a caster that vanished without a FIN/RST). */
+#define NTRIP_SESSION_IDLE_S          60
+
+/** @brief Time limit for one round of connect attempts over every address (ms). */
+#define NTRIP_SESSION_CONNECT_MS      10000
+
+/** @brief ntrip_session_open() flag: speak TLS to the caster. */
+#define NTRIP_SESSION_TLS           0x01u
+
+/** @brief ntrip_session_open() flag: accept any certificate (TLS_INSECURE). */
+#define NTRIP_SESSION_TLS_NOVERIFY  0x02u
+
+/**
+ * @brief Called while a reconnect waits or between attempts.
+ * @return Non-zero to give up (Ctrl-C, --duration reached, GUI Stop).
+ */
+typedef int (*NtripSessionStopFn)(void *user);
+
+/** @brief One outage: last byte of the old connection to the new GET. */
+typedef struct {
+    time_t lost;
+    time_t resumed;
+    double seconds;
+} NtripSessionGap;
+
+/**
+ * @struct NtripSession
+ * @brief A mountpoint connection plus what is needed to re-open it.
+ *
+ * The host, mountpoint and credentials are copied, so the config may
+ * change (or go away) while the session runs.
+ */
+typedef struct {
+    NtripSocket sock;
+    NtripTls   *tls;             /**< TLS over sock; NULL = plaintext */
+    NtripHttp   http;            /**< Reply decoder, restarted at every connect */
+
+    char  host[256];
+    int   port;
+    char  mountpoint[256];
+    char  auth_basic[256];
+    const char *tag;             /**< Log prefix, e.g. "[OBS]" */
+    int   recv_timeout_ms;       /**< SO_RCVTIMEO set on every connect; 0 = none */
+    int   backoff_max_ms;        /**< 0 = reconnecting disabled */
+    unsigned flags;              /**< NTRIP_SESSION_TLS, ... */
+
+    NtripAddr addrs[NTRIP_SESSION_MAX_ADDRS];
+    int   n_addrs;
+    int   cur;                   /**< Address of the current / last good connection */
+    int   backoff_ms;            /**< Delay before the next attempt */
+    double connected_at;         /**< Monotonic time of the last successful connect */
+    int64_t rx_utc_ns;           /**< UTC (Unix ns) the data of the last recv() arrived;
+                                      see ntrip_session_recv() */
+
+    int   reconnects;            /**< Successful re-opens */
+    int   gap_count;             /**< Outages, including any still open */
+    double gap_total_s;
+    double gap_longest_s;
+    NtripSessionGap gaps[NTRIP_SESSION_MAX_GAPS];
+
+    int   tls_full;              /**< Full TLS handshakes */
+    int   tls_resumed;           /**< Handshakes that resumed the cached session */
+    double tls_full_ms;          /**< Sum of full handshake times */
+    double tls_resumed_ms;       /**< Sum of resumed handshake times */
+} NtripSession;
+
+/**
+ * @brief Resolve @p host, connect and send the GET for @p mountpoint.
+ *
+ * Winsock must already be initialised on Windows.
+ *
+ * @param reconnect_max_s  RECONNECT_DELAY_MAX: longest wait between
+ *                         attempts in seconds; 0 = default, < 0 = never
+ *                         reconnect (ntrip_session_resume() fails at once).
+ * @param recv_timeout_ms  SO_RCVTIMEO for every connection, so the loop
+ *                         can poll its stop flags; 0 = blocking recv().
+ * @param tag              Log prefix used for every message.
+ * @param flags            NTRIP_SESSION_TLS, NTRIP_SESSION_TLS_NOVERIFY.
+ * @return false (with a message on stderr) if no address accepted the
+ *         connection.  The session need not be closed then.
+ */
+bool ntrip_session_open(NtripSession *s, const char *host, int port,
+                        const char *mountpoint, const char *auth_basic,
+                        int reconnect_max_s, int recv_timeout_ms, const char *tag,
+                        unsigned flags);
+
+/**
+ * @brief Replace a lost connection with a new one.
+ *
+ * Closes the socket, records the outage, then keeps trying with backoff
+ * until a connection is made or @p should_stop returns non-zero.  The
+ * caller must reset its framer; the reply decoder (and so the header
+ * skip) restarts by itself.
+ *
+ * @param why          What ended the connection (for the log line).
+ * @param should_stop  Polled about every 100 ms; may be NULL.
+ * @return true once reconnected, false if reconnecting is disabled or
+ *         @p should_stop asked to give up.
+ */
+bool ntrip_session_resume(NtripSession *s, const char *why,
+                          NtripSessionStopFn should_stop, void *user);
+
+/**
+ * @brief Point the session at another caster, mountpoint or credentials.
+ *
+ * Used by a live config reload.  The running connection is left alone;
+ * the caller then ends it with ntrip_session_resume(), which connects to
+ * the new target (after the shortest backoff) and records the switch as
+ * an outage like any other.  Parameters as ntrip_session_open().
+ *
+ * @return false (with a message on stderr) if the new host does not
+ *         resolve or needs TLS this build lacks; the session is then
+ *         unchanged.  With @p reconnect_max_s < 0 the following
+ *         ntrip_session_resume() fails, so callers refuse such a switch.
+ */
+bool ntrip_session_set_target(NtripSession *s, const char *host, int port,
+                              const char *mountpoint, const char *auth_basic,
+                              int reconnect_max_s, unsigned flags);
+
+/** @brief Close the connection (safe to call twice). */
+void ntrip_session_close(NtripSession *s);
+
+/**
+ * @brief recv() on the session's connection (through TLS if in use).
+ *
+ * Data is stamped in @c rx_utc_ns: with the kernel receive timestamp
+ * (SO_TIMESTAMPNS, Linux, plaintext), otherwise with the UTC clock read
+ * right after the call.
+ */
+int ntrip_session_recv(NtripSession *s, void *buf, int len);
+
+/** @brief send() on the session's connection (through TLS if in use). */
+int ntrip_session_send(NtripSession *s, const void *buf, int len);
+
+/**
+ * @brief true if decrypted data is already buffered, so a select() on
+ *        the socket would wait needlessly.
+ */
+bool ntrip_session_pending(const NtripSession *s);
+
+/**
+ * @brief Print the TLS handshake times, the reconnect count and every
+ *        recorded outage.
+ *
+ * Prints nothing for a plaintext connection that was never re-opened,
+ * so a run that ends at its first drop looks as it always did.
+ */
+void ntrip_session_print_gaps(const NtripSession *s, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_SESSION_H */
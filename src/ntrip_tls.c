@@ -0,0 +1,431 @@
+/**
+ * @file ntrip_tls.c
+ * @brief Optional TLS transport under the NTRIP requests, with session
+ *        resumption per caster.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601     /* SRWLOCK needs Vista or later */
+#endif
+#endif
+
+#include "ntrip_tls.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#endif
+
+#ifdef _WIN32
+static SRWLOCK g_tls_lock = SRWLOCK_INIT;
+#define TLS_LOCK()    AcquireSRWLockExclusive(&g_tls_lock)
+#define TLS_UNLOCK()  ReleaseSRWLockExclusive(&g_tls_lock)
+#else
+static pthread_mutex_t g_tls_lock = PTHREAD_MUTEX_INITIALIZER;
+#define TLS_LOCK()    pthread_mutex_lock(&g_tls_lock)
+#define TLS_UNLOCK()  pthread_mutex_unlock(&g_tls_lock)
+#endif
+
+static NtripTlsStats g_stats;
+
+void ntrip_tls_get_stats(NtripTlsStats *out)
+{
+    TLS_LOCK();
+    *out = g_stats;
+    TLS_UNLOCK();
+}
+
+void ntrip_tls_print_stats(FILE *out)
+{
+    NtripTlsStats st;
+    ntrip_tls_get_stats(&st);
+    if (st.full + st.resumed + st.failed == 0) return;
+    fprintf(out, "[TLS] Handshakes: %lu full (%.1f ms avg), %lu resumed (%.1f ms avg), %lu failed\n",
+            st.full, st.full ? st.full_ms / st.full : 0.0,
+            st.resumed, st.resumed ? st.resumed_ms / st.resumed : 0.0, st.failed);
+}
+
+#ifdef NTRIP_WITH_OPENSSL
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+/* Make a failed read or write look like recv() / send() timing out or
+ * finding nothing to do, so the callers' timeout checks still apply. */
+static void tls_set_would_block(bool nonblocking)
+{
+#ifdef _WIN32
+    WSASetLastError(nonblocking ? WSAEWOULDBLOCK : WSAETIMEDOUT);
+#else
+    (void)nonblocking;
+    errno = EAGAIN;
+#endif
+}
+
+struct NtripTls {
+    SSL        *ssl;
+    NtripSocket sock;
+    char        key[300];       /* "host:port:v" -- ticket cache key */
+    double      t_start;
+    double      ms;
+    bool        done;
+    bool        resumed;
+    bool        nonblocking;
+    bool        broken;         /* no close_notify on free */
+    char        err[128];
+};
+
+typedef struct {
+    char         key[300];
+    SSL_SESSION *sess;
+    unsigned long stored;       /* for replacing the oldest */
+} TlsTicket;
+
+static SSL_CTX      *g_ctx;
+static int           g_ex_index = -1;
+static TlsTicket     g_tickets[NTRIP_TLS_CACHE_SLOTS];
+static unsigned long g_ticket_seq;
+
+static double tls_now(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/* New-session callback: keep the newest ticket per caster.  TLS 1.3
+ * tickets arrive after the handshake, during the first reads.  The cache
+ * holds a copy: OpenSSL marks the connection's own session unusable when
+ * the connection ends in an error, which for a caster that resets the
+ * TCP connection would throw the ticket away with it. */
+static int tls_new_session(SSL *ssl, SSL_SESSION *sess)
+{
+    NtripTls *t = (NtripTls *)SSL_get_ex_data(ssl, g_ex_index);
+    SSL_SESSION *copy = t ? SSL_SESSION_dup(sess) : NULL;
+    if (!copy) return 0;
+
+    TLS_LOCK();
+    TlsTicket *slot = NULL, *free_slot = NULL, *oldest = &g_tickets[0];
+    for (int i = 0; i < NTRIP_TLS_CACHE_SLOTS && !slot; i++) {
+        if (strcmp(g_tickets[i].key, t->key) == 0) slot = &g_tickets[i];
+        else if (!g_tickets[i].key[0]) { if (!free_slot) free_slot = &g_tickets[i]; }
+        else if (g_tickets[i].stored < oldest->stored) oldest = &g_tickets[i];
+    }
+    if (!slot) slot = free_slot ? free_slot : oldest;
+    if (slot->sess) SSL_SESSION_free(slot->sess);
+    snprintf(slot->key, sizeof(slot->key), "%s", t->key);
+    slot->sess   = copy;
+    slot->stored = ++g_ticket_seq;
+    TLS_UNLOCK();
+    return 0;                       /* OpenSSL may drop its reference */
+}
+
+static SSL_CTX *tls_ctx(void)
+{
+    TLS_LOCK();
+    if (!g_ctx) {
+        SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+        if (ctx) {
+            SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+            SSL_CTX_set_default_verify_paths(ctx);
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                                SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, tls_new_session);
+            SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+            /* A caster that just drops the TCP connection reads as EOF */
+            SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+            g_ex_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+            g_ctx = ctx;
+        }
+    }
+    SSL_CTX *ctx = g_ctx;
+    TLS_UNLOCK();
+    return ctx;
+}
+
+bool ntrip_tls_available(void)
+{
+    return true;
+}
+
+static bool tls_is_ip_literal(const char *host)
+{
+    return strchr(host, ':') != NULL || strspn(host, "0123456789.") == strlen(host);
+}
+
+NtripTls *ntrip_tls_new(NtripSocket sock, const char *host, int port, bool verify)
+{
+    SSL_CTX *ctx = tls_ctx();
+    if (!ctx) return NULL;
+    NtripTls *t = (NtripTls *)calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->ssl = SSL_new(ctx);
+    if (!t->ssl) {
+        free(t);
+        return NULL;
+    }
+    t->sock = sock;
+    snprintf(t->key, sizeof(t->key), "%s:%d:%c", host, port, verify ? 'v' : 'n');
+    SSL_set_fd(t->ssl, (int)sock);
+    SSL_set_ex_data(t->ssl, g_ex_index, t);
+
+    bool ip = tls_is_ip_literal(host);
+    if (!ip) SSL_set_tlsext_host_name(t->ssl, host);
+    if (verify) {
+        SSL_set_verify(t->ssl, SSL_VERIFY_PEER, NULL);
+        if (ip) X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(t->ssl), host);
+        else    SSL_set1_host(t->ssl, host);
+    } else {
+        SSL_set_verify(t->ssl, SSL_VERIFY_NONE, NULL);
+    }
+
+    TLS_LOCK();
+    for (int i = 0; i < NTRIP_TLS_CACHE_SLOTS; i++) {
+        if (g_tickets[i].sess && strcmp(g_tickets[i].key, t->key) == 0) {
+            if (SSL_SESSION_is_resumable(g_tickets[i].sess))
+                SSL_set_session(t->ssl, g_tickets[i].sess);
+            break;
+        }
+    }
+    TLS_UNLOCK();
+    return t;
+}
+
+int ntrip_tls_handshake_step(NtripTls *t, bool *want_write)
+{
+    if (t->done) return 1;
+    if (t->t_start == 0.0) t->t_start = tls_now();
+    t->nonblocking = true;
+
+    ERR_clear_error();
+    int r = SSL_connect(t->ssl);
+    if (r == 1) {
+        t->done    = true;
+        t->ms      = (tls_now() - t->t_start) * 1000.0;
+        t->resumed = SSL_session_reused(t->ssl) != 0;
+        TLS_LOCK();
+        if (t->resumed) { g_stats.resumed++; g_stats.resumed_ms += t->ms; }
+        else            { g_stats.full++;    g_stats.full_ms    += t->ms; }
+        TLS_UNLOCK();
+        return 1;
+    }
+    int e = SSL_get_error(t->ssl, r);
+    if (e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE) {
+        if (want_write) *want_write = e == SSL_ERROR_WANT_WRITE;
+        return 0;
+    }
+
+    long vr = SSL_get_verify_result(t->ssl);
+    unsigned long code = ERR_get_error();
+    if (vr != X509_V_OK)
+        snprintf(t->err, sizeof(t->err), "certificate: %s", X509_verify_cert_error_string(vr));
+    else if (code)
+        ERR_error_string_n(code, t->err, sizeof(t->err));
+    else
+        snprintf(t->err, sizeof(t->err), "connection closed during handshake");
+    t->broken = true;
+    TLS_LOCK();
+    g_stats.failed++;
+    TLS_UNLOCK();
+    return -1;
+}
+
+bool ntrip_tls_handshake(NtripTls *t, int timeout_ms)
+{
+    double deadline = tls_now() + timeout_ms / 1000.0;
+    ntrip_socket_set_blocking(t->sock, false);
+    int r;
+    for (;;) {
+        bool want_write = false;
+        r = ntrip_tls_handshake_step(t, &want_write);
+        if (r != 0) break;
+        int left_ms = (int)((deadline - tls_now()) * 1000.0);
+        if (left_ms <= 0) {
+            snprintf(t->err, sizeof(t->err), "handshake timed out");
+            t->broken = true;
+            TLS_LOCK();
+            g_stats.failed++;
+            TLS_UNLOCK();
+            break;
+        }
+        ntrip_socket_wait(t->sock, want_write, left_ms);
+    }
+    ntrip_socket_set_blocking(t->sock, true);
+    t->nonblocking = false;
+    return r == 1;
+}
+
+const char *ntrip_tls_error(const NtripTls *t)
+{
+    return t && t->err[0] ? t->err : "TLS error";
+}
+
+double ntrip_tls_handshake_ms(const NtripTls *t)
+{
+    return t ? t->ms : 0.0;
+}
+
+bool ntrip_tls_resumed(const NtripTls *t)
+{
+    return t && t->resumed;
+}
+
+const char *ntrip_tls_describe(const NtripTls *t, char *buf, size_t len)
+{
+    snprintf(buf, len, "%s %s, %s, %.1f ms",
+             SSL_get_version(t->ssl), SSL_get_cipher_name(t->ssl),
+             t->resumed ? "resumed" : "full handshake", t->ms);
+    return buf;
+}
+
+int ntrip_tls_pending(const NtripTls *t)
+{
+    return t ? SSL_pending(t->ssl) : 0;
+}
+
+void ntrip_tls_free(NtripTls *t)
+{
+    if (!t) return;
+    if (t->done && !t->broken) SSL_shutdown(t->ssl);
+    SSL_free(t->ssl);
+    free(t);
+}
+
+int ntrip_io_recv(NtripSocket sock, NtripTls *t, void *buf, int len)
+{
+    if (!t) return (int)recv(sock, (char *)buf, len, 0);
+    ERR_clear_error();
+    int r = SSL_read(t->ssl, buf, len);
+    if (r > 0) return r;
+    switch (SSL_get_error(t->ssl, r)) {
+    case SSL_ERROR_ZERO_RETURN:
+        t->broken = true;
+        return 0;
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        tls_set_would_block(t->nonblocking);
+        return -1;
+    case SSL_ERROR_SYSCALL:
+        t->broken = true;
+        return r == 0 ? 0 : -1;
+    default:
+        t->broken = true;
+        return -1;
+    }
+}
+
+int ntrip_io_send(NtripSocket sock, NtripTls *t, const void *buf, int len)
+{
+    if (!t) return (int)send(sock, (const char *)buf, len, 0);
+    ERR_clear_error();
+    int r = SSL_write(t->ssl, buf, len);
+    if (r > 0) return r;
+    int e = SSL_get_error(t->ssl, r);
+    if (e == SSL_ERROR_WANT_READ || e == SSL_ERROR_WANT_WRITE) {
+        tls_set_would_block(t->nonblocking);
+    } else {
+        t->broken = true;
+    }
+    return -1;
+}
+
+#else /* !NTRIP_WITH_OPENSSL */
+
+struct NtripTls {
+    int unused;
+};
+
+bool ntrip_tls_available(void)
+{
+    return false;
+}
+
+NtripTls *ntrip_tls_new(NtripSocket sock, const char *host, int port, bool verify)
+{
+    (void)sock; (void)host; (void)port; (void)verify;
+    return NULL;
+}
+
+int ntrip_tls_handshake_step(NtripTls *t, bool *want_write)
+{
+    (void)t; (void)want_write;
+    return -1;
+}
+
+bool ntrip_tls_handshake(NtripTls *t, int timeout_ms)
+{
+    (void)t; (void)timeout_ms;
+    return false;
+}
+
+const char *ntrip_tls_error(const NtripTls *t)
+{
+    (void)t;
+    return "built without TLS support";
+}
+
+double ntrip_tls_handshake_ms(const NtripTls *t)
+{
+    (void)t;
+    return 0.0;
+}
+
+bool ntrip_tls_resumed(const NtripTls *t)
+{
+    (void)t;
+    return false;
+}
+
+const char *ntrip_tls_describe(const NtripTls *t, char *buf, size_t len)
+{
+    (void)t;
+    snprintf(buf, len, "plaintext");
+    return buf;
+}
+
+int ntrip_tls_pending(const NtripTls *t)
+{
+    (void)t;
+    return 0;
+}
+
+void ntrip_tls_free(NtripTls *t)
+{
+    (void)t;
+}
+
+int ntrip_io_recv(NtripSocket sock, NtripTls *t, void *buf, int len)
+{
+    (void)t;
+    return (int)recv(sock, (char *)buf, len, 0);
+}
+
+int ntrip_io_send(NtripSocket sock, NtripTls *t, const void *buf, int len)
+{
+    (void)t;
+    return (int)send(sock, (const char *)buf, len, 0);
+}
+
+#endif /* NTRIP_WITH_OPENSSL */
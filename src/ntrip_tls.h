@@ -0,0 +1,139 @@
+/**
+ * @file ntrip_tls.h
+ * @brief Optional TLS transport under the NTRIP requests, with session
+ *        resumption per caster.
+ *
+ * NTRIP over TLS ("NTRIPS", usually port 443) is plain NTRIP inside a TLS
+ * connection.  An NtripTls wraps a connected socket; ntrip_io_recv() and
+ * ntrip_io_send() then stand in for recv() / send() and fall back to them
+ * when the connection is plaintext (NULL NtripTls), so the stream loops
+ * need no second code path.
+ *
+ * Every successful handshake leaves a session ticket in a process-wide
+ * cache keyed by caster host, port and verification mode.  The next
+ * connection to that caster -- a reconnect, or one of many parallel
+ * mountpoints in `--mounts-file` -- offers the ticket and, if the caster
+ * accepts it, skips the certificate exchange.  Handshake times are kept
+ * separately for full and resumed handshakes; ntrip_tls_print_stats()
+ * shows both.
+ *
+ * TLS needs OpenSSL 1.1.1 or later and is compiled in only when
+ * NTRIP_WITH_OPENSSL is defined (link with -lssl -lcrypto).  Without it
+ * ntrip_tls_available() is false, ntrip_tls_new() returns NULL and the
+ * io functions are plain recv() / send().
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef NTRIP_TLS_H
+#define NTRIP_TLS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ntrip_connect.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Casters whose session ticket is kept; the oldest one goes first. */
+#define NTRIP_TLS_CACHE_SLOTS  64
+
+/** @brief One TLS connection over a socket the caller owns. */
+typedef struct NtripTls NtripTls;
+
+/** @brief Handshake counters over the whole process. */
+typedef struct {
+    unsigned long full;          /**< Handshakes with a certificate exchange */
+    unsigned long resumed;       /**< Handshakes that resumed a cached session */
+    unsigned long failed;
+    double full_ms;              /**< Sum of full handshake times */
+    double resumed_ms;           /**< Sum of resumed handshake times */
+} NtripTlsStats;
+
+/** @brief true if this build can speak TLS. */
+bool ntrip_tls_available(void);
+
+/**
+ * @brief Prepare TLS over the connected socket @p sock (no I/O yet).
+ *
+ * @param host    Caster name: sent as SNI and checked against the
+ *                certificate when @p verify is set.
+ * @param verify  Check the certificate chain against the system trust
+ *                store and the name against @p host.
+ * @return NULL without TLS support or on allocation failure.
+ */
+NtripTls *ntrip_tls_new(NtripSocket sock, const char *host, int port, bool verify);
+
+/**
+ * @brief Advance the handshake on a non-blocking socket.
+ *
+ * @param want_write  Set when the handshake waits for the socket to
+ *                    become writable rather than readable.
+ * @return 1 when done, 0 to be called again once the socket is ready,
+ *         -1 on failure (see ntrip_tls_error()).
+ */
+int ntrip_tls_handshake_step(NtripTls *t, bool *want_write);
+
+/**
+ * @brief Complete the handshake on a blocking socket within @p timeout_ms.
+ *
+ * The socket is blocking again afterwards.
+ */
+bool ntrip_tls_handshake(NtripTls *t, int timeout_ms);
+
+/** @brief Why the handshake failed, e.g. "certificate verify failed". */
+const char *ntrip_tls_error(const NtripTls *t);
+
+/** @brief Duration of the completed handshake (ms). */
+double ntrip_tls_handshake_ms(const NtripTls *t);
+
+/** @brief true if the completed handshake resumed a cached session. */
+bool ntrip_tls_resumed(const NtripTls *t);
+
+/** @brief "TLSv1.3 TLS_AES_256_GCM_SHA384, resumed, 12.4 ms". */
+const char *ntrip_tls_describe(const NtripTls *t, char *buf, size_t len);
+
+/**
+ * @brief Decrypted bytes already buffered.
+ *
+ * A readiness wait on the socket does not see these; callers check this
+ * first.
+ */
+int ntrip_tls_pending(const NtripTls *t);
+
+/** @brief Send close_notify (best effort) and free; the socket stays open. */
+void ntrip_tls_free(NtripTls *t);
+
+/**
+ * @brief recv() through @p t, or plain recv() when @p t is NULL.
+ *
+ * Returns like recv(): bytes, 0 once the caster closed the connection,
+ * < 0 on error.  A receive timeout or "would block" sets errno (Winsock:
+ * the last error) as recv() would, so callers can tell it apart.
+ */
+int ntrip_io_recv(NtripSocket sock, NtripTls *t, void *buf, int len);
+
+/** @brief send() through @p t, or plain send() when @p t is NULL. */
+int ntrip_io_send(NtripSocket sock, NtripTls *t, const void *buf, int len);
+
+/** @brief Copy of the process-wide handshake counters. */
+void ntrip_tls_get_stats(NtripTlsStats *out);
+
+/**
+ * @brief One line with handshake counts and average times, e.g.
+ * @code
+ * [TLS] Handshakes: 1 full (84.1 ms avg), 57 resumed (11.9 ms avg), 0 failed
+ * @endcode
+ * Prints nothing if no TLS connection was made.
+ */
+void ntrip_tls_print_stats(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTRIP_TLS_H */
@@ -0,0 +1,563 @@
+/**
+ * @file obs_columns.c
+ * @brief Columnar export of decoded MSM cells and ephemerides (.nacol).
+ *
+ * Each table has a pair of row groups.  The producer appends raw rows
+ * (absolute times, 64-bit keys) to one; when it is full it is marked
+ * busy for the encoder thread, which builds the dictionary, turns times
+ * into deltas and writes it, while the producer fills the other.  At most
+ * one group per table is busy, so groups are written in order.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "obs_columns.h"
+#include "rtcm3x_parser.h"
+#include "stream_clock.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "obs_columns.c writes column arrays in host order, which must be little-endian"
+#endif
+
+#define COL_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define COL_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define COL_MAGIC        "NACOL\r\n\x1a"
+#define COL_GROUP_MAGIC  "NAGR"
+#define COL_VERSION      1
+#define COL_HEADER       64
+#define COL_GROUP_HEADER 48
+#define COL_DIR_ENTRY    16
+#define COL_MAX_COLS     OBS_COL_N_EPH_COLS
+#define COL_IDLE_MS      5
+#define COL_IO_BUF       (1u << 20)
+#define COL_HASH_BITS    17                     /* 2x the largest dictionary */
+#define COL_HASH_SIZE    (1u << COL_HASH_BITS)
+
+/* Column of a table: its type in the file, encoding and the width of
+ * the value the producer stores (times and keys as 64-bit until encoded). */
+typedef struct {
+    uint8_t type;
+    uint8_t enc;
+    uint8_t width;
+} ColDef;
+
+static const uint8_t k_type_size[] = { 0, 1, 1, 2, 2, 4, 4, 8, 4, 8 };
+
+static const ColDef k_cell_cols[OBS_COL_N_CELL_COLS] = {
+    [OBS_COL_C_T]     = { OBS_COL_I32, OBS_COL_DELTA, 8 },
+    [OBS_COL_C_KEY]   = { OBS_COL_U16, OBS_COL_DICT,  8 },
+    [OBS_COL_C_MSM]   = { OBS_COL_U8,  OBS_COL_PLAIN, 1 },
+    [OBS_COL_C_CNR]   = { OBS_COL_U16, OBS_COL_PLAIN, 2 },
+    [OBS_COL_C_LOCK]  = { OBS_COL_U16, OBS_COL_PLAIN, 2 },
+    [OBS_COL_C_FLAGS] = { OBS_COL_U8,  OBS_COL_PLAIN, 1 },
+    [OBS_COL_C_PR]    = { OBS_COL_F64, OBS_COL_PLAIN, 8 },
+    [OBS_COL_C_PH]    = { OBS_COL_F64, OBS_COL_PLAIN, 8 },
+    [OBS_COL_C_RATE]  = { OBS_COL_F32, OBS_COL_PLAIN, 4 },
+};
+
+/* Filled in by col_eph_defs(): the doubles after OBS_COL_E_TOE are alike. */
+static ColDef k_eph_cols[OBS_COL_N_EPH_COLS];
+
+static void col_eph_defs(void)
+{
+    k_eph_cols[OBS_COL_E_T]        = (ColDef){ OBS_COL_I32, OBS_COL_DELTA, 8 };
+    k_eph_cols[OBS_COL_E_KEY]      = (ColDef){ OBS_COL_U16, OBS_COL_DICT,  8 };
+    k_eph_cols[OBS_COL_E_IODE]     = (ColDef){ OBS_COL_I32, OBS_COL_PLAIN, 4 };
+    k_eph_cols[OBS_COL_E_WEEK]     = (ColDef){ OBS_COL_I16, OBS_COL_PLAIN, 2 };
+    k_eph_cols[OBS_COL_E_HEALTH]   = (ColDef){ OBS_COL_I16, OBS_COL_PLAIN, 2 };
+    k_eph_cols[OBS_COL_E_GLO_CHAN] = (ColDef){ OBS_COL_I8,  OBS_COL_PLAIN, 1 };
+    for (int c = OBS_COL_E_TOE; c < OBS_COL_N_EPH_COLS; c++)
+        k_eph_cols[c] = (ColDef){ OBS_COL_F64, OBS_COL_PLAIN, 8 };
+}
+
+typedef struct {
+    void     *col[COL_MAX_COLS];
+    uint32_t  rows;
+    int       busy;                     /* 1 = handed to the encoder */
+} ColGroup;
+
+typedef struct {
+    int           table;
+    const ColDef *defs;
+    int           n_cols;
+    uint32_t      cap;
+    ColGroup      grp[2];
+    int           fill;                 /* group the producer appends to */
+    int64_t       last_t;               /* time of its last row */
+} ColTable;
+
+struct ObsColWriter {
+    ColTable   tab[2];                  /* cells, ephemerides */
+    int64_t    last_ms;                 /* latest MSM epoch, -1 = none yet */
+    int64_t    hint_ms;
+    uint64_t   stalls;
+    int        stop;
+
+    /* Encoder thread. */
+    FILE      *f;
+    uint64_t   off;
+    int32_t   *delta;
+    uint16_t  *idx;
+    uint64_t  *dict;
+    uint32_t  *hash;                    /* dictionary index + 1, 0 = empty */
+    uint64_t   cells, ephs, groups;
+    int        failed;
+
+#ifdef _WIN32
+    HANDLE     thread;
+#else
+    pthread_t  thread;
+#endif
+};
+
+static void col_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { 0, (long)ms * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void put_u16(unsigned char *p, uint16_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+static void put_u32(unsigned char *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static void put_u64(unsigned char *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+static uint16_t get_u16(const unsigned char *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const unsigned char *p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+static uint64_t get_u64(const unsigned char *p) { return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+static uint64_t align8(uint64_t v) { return (v + 7) & ~(uint64_t)7; }
+
+/* ── Encoder ──────────────────────────────────────────────────────────── */
+
+static void col_write(ObsColWriter *w, const void *p, size_t n)
+{
+    if (n && fwrite(p, 1, n, w->f) != n) COL_STORE(&w->failed, 1);
+    w->off += n;
+}
+
+static void col_pad(ObsColWriter *w)
+{
+    static const unsigned char zero[8];
+    col_write(w, zero, (size_t)(align8(w->off) - w->off));
+}
+
+/* Dictionary-encode @p keys into w->idx / w->dict; returns the entries. */
+static uint32_t col_dict(ObsColWriter *w, const uint64_t *keys, uint32_t n)
+{
+    memset(w->hash, 0, COL_HASH_SIZE * sizeof(w->hash[0]));
+    uint32_t nd = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        uint32_t h = (uint32_t)((k * 0x9E3779B97F4A7C15ull) >> (64 - COL_HASH_BITS));
+        while (w->hash[h] && w->dict[w->hash[h] - 1] != k)
+            h = (h + 1) & (COL_HASH_SIZE - 1);
+        if (!w->hash[h]) {
+            w->dict[nd] = k;
+            w->hash[h] = ++nd;
+        }
+        w->idx[i] = (uint16_t)(w->hash[h] - 1);
+    }
+    return nd;
+}
+
+static void col_encode(ObsColWriter *w, const ColTable *t, const ColGroup *g)
+{
+    const uint32_t n = g->rows;
+    const int n_cols = t->n_cols;
+    uint32_t nd = 0;
+    int64_t t_base = 0, t_last = 0;
+
+    /* Times to deltas, keys to the dictionary; every table has one of each. */
+    for (int c = 0; c < n_cols; c++) {
+        if (t->defs[c].enc == OBS_COL_DELTA) {
+            const int64_t *ts = (const int64_t *)g->col[c];
+            t_base = t_last = ts[0];
+            for (uint32_t i = 0; i < n; i++) {
+                w->delta[i] = (int32_t)(ts[i] - t_last);
+                t_last = ts[i];
+            }
+        } else if (t->defs[c].enc == OBS_COL_DICT) {
+            nd = col_dict(w, (const uint64_t *)g->col[c], n);
+        }
+    }
+
+    /* Offsets: header, directory, dictionary, then one aligned array per column */
+    const uint64_t start = w->off;
+    uint64_t offs[COL_MAX_COLS];
+    uint64_t pos = align8(start + COL_GROUP_HEADER + (uint64_t)n_cols * COL_DIR_ENTRY +
+                          (uint64_t)nd * 8);
+    for (int c = 0; c < n_cols; c++) {
+        offs[c] = pos;
+        pos = align8(pos + (uint64_t)n * k_type_size[t->defs[c].type]);
+    }
+
+    unsigned char hdr[COL_GROUP_HEADER];
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, COL_GROUP_MAGIC, 4);
+    put_u16(hdr + 4, (uint16_t)t->table);
+    put_u16(hdr + 6, (uint16_t)n_cols);
+    put_u32(hdr + 8, n);
+    put_u32(hdr + 12, nd);
+    put_u64(hdr + 16, pos - start);
+    put_u64(hdr + 24, (uint64_t)t_base);
+    put_u64(hdr + 32, (uint64_t)t_last);
+    col_write(w, hdr, sizeof(hdr));
+    for (int c = 0; c < n_cols; c++) {
+        unsigned char e[COL_DIR_ENTRY];
+        memset(e, 0, sizeof(e));
+        put_u16(e, (uint16_t)c);
+        e[2] = t->defs[c].type;
+        e[3] = t->defs[c].enc;
+        put_u64(e + 8, offs[c]);
+        col_write(w, e, sizeof(e));
+    }
+    col_write(w, w->dict, (size_t)nd * 8);
+    for (int c = 0; c < n_cols; c++) {
+        col_pad(w);
+        const void *src = t->defs[c].enc == OBS_COL_DELTA ? (const void *)w->delta :
+                          t->defs[c].enc == OBS_COL_DICT  ? (const void *)w->idx : g->col[c];
+        col_write(w, src, (size_t)n * k_type_size[t->defs[c].type]);
+    }
+    col_pad(w);
+
+    if (t->table == OBS_COL_CELLS) __atomic_add_fetch(&w->cells, n, __ATOMIC_RELAXED);
+    else                           __atomic_add_fetch(&w->ephs, n, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&w->groups, 1, __ATOMIC_RELAXED);
+}
+
+/* Encode every busy group; returns how many. */
+static int col_drain(ObsColWriter *w)
+{
+    int done = 0;
+    for (int k = 0; k < 2; k++)
+        for (int i = 0; i < 2; i++) {
+            ColGroup *g = &w->tab[k].grp[i];
+            if (!COL_LOAD(&g->busy)) continue;
+            col_encode(w, &w->tab[k], g);
+            COL_STORE(&g->busy, 0);
+            done++;
+        }
+    return done;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall col_thread(void *arg)
+#else
+static void *col_thread(void *arg)
+#endif
+{
+    ObsColWriter *w = (ObsColWriter *)arg;
+    for (;;) {
+        int stop = COL_LOAD(&w->stop);      /* before draining: nothing is lost */
+        if (col_drain(w) > 0) continue;
+        if (stop) break;
+        col_sleep_ms(COL_IDLE_MS);
+    }
+    return 0;
+}
+
+/* ── Producer ─────────────────────────────────────────────────────────── */
+
+/* Hand the group being filled to the encoder and switch to the other,
+ * once the encoder is done with it. */
+static void col_hand_off(ObsColWriter *w, ColTable *t)
+{
+    ColGroup *g = &t->grp[t->fill];
+    if (g->rows == 0) return;
+    ColGroup *next = &t->grp[t->fill ^ 1];
+    if (COL_LOAD(&next->busy)) {
+        w->stalls++;
+        while (COL_LOAD(&next->busy)) col_sleep_ms(1);
+    }
+    COL_STORE(&g->busy, 1);
+    next->rows = 0;
+    t->fill ^= 1;
+}
+
+/* The group to append a row of time @p t to: the current one, unless it
+ * is full or the time step does not fit the i32 delta. */
+static ColGroup *col_room(ObsColWriter *w, ColTable *t, int64_t ts)
+{
+    ColGroup *g = &t->grp[t->fill];
+    int64_t d = ts - t->last_t;
+    if (g->rows == t->cap || (g->rows && (d > INT32_MAX || d < INT32_MIN))) {
+        col_hand_off(w, t);
+        g = &t->grp[t->fill];
+    }
+    t->last_t = ts;
+    return g;
+}
+
+#define COL(g, c, T)  ((T *)(g)->col[c])
+
+static void col_add_msm(ObsColWriter *w, const RtcmMsmObs *o)
+{
+    int64_t ts = stream_clock_msm_gps_ms(o->gnss_id, o->epoch_time,
+                                         w->last_ms >= 0 ? w->last_ms : w->hint_ms);
+    if (ts < 0) return;
+    w->last_ms = ts;
+
+    ColTable *t = &w->tab[0];
+    const bool ext = o->msm_subtype == 5 || o->msm_subtype == 7;
+    const uint64_t station = (uint64_t)o->ref_station_id << 32 | (uint64_t)o->gnss_id << 16;
+    for (int c = 0; c < o->num_cells; c++) {
+        const RtcmMsmCell *cell = &o->cells[c];
+        const RtcmMsmSat  *sat  = &o->sats[cell->sat];
+        ColGroup *g = col_room(w, t, ts);
+        uint32_t r = g->rows++;
+        bool rate = ext && sat->rough_rate != -8192 && cell->fine_rate != -16384;
+        float cnr = cell->cnr_dbhz * 16.0f + 0.5f;
+        COL(g, OBS_COL_C_T,     int64_t)[r]  = ts;
+        COL(g, OBS_COL_C_KEY,   uint64_t)[r] = station | (uint64_t)sat->prn << 8 | (uint64_t)cell->sig_idx;
+        COL(g, OBS_COL_C_MSM,   uint8_t)[r]  = (uint8_t)o->msm_subtype;
+        COL(g, OBS_COL_C_CNR,   uint16_t)[r] = cnr > 0.0f ? (uint16_t)(cnr < 65535.0f ? cnr : 65535.0f) : 0;
+        COL(g, OBS_COL_C_LOCK,  uint16_t)[r] = cell->lock;
+        COL(g, OBS_COL_C_FLAGS, uint8_t)[r]  = (uint8_t)((cell->half_cycle ? 1 : 0) | (rate ? 2 : 0));
+        COL(g, OBS_COL_C_PR,    double)[r]   = cell->pr_m;
+        COL(g, OBS_COL_C_PH,    double)[r]   = cell->ph_m;
+        COL(g, OBS_COL_C_RATE,  float)[r]    = rate ? (float)(sat->rough_rate + cell->fine_rate * 0.0001) : 0.0f;
+    }
+}
+
+static void col_add_eph(ObsColWriter *w, int mt, const SvEphemeris *e)
+{
+    ColTable *t = &w->tab[1];
+    int64_t ts = w->last_ms >= 0 ? w->last_ms : w->hint_ms;
+    ColGroup *g = col_room(w, t, ts);
+    uint32_t r = g->rows++;
+    COL(g, OBS_COL_E_T,        int64_t)[r]  = ts;
+    COL(g, OBS_COL_E_KEY,      uint64_t)[r] = (uint64_t)mt << 16 | (uint64_t)e->gnss_id << 8 | (uint64_t)e->prn;
+    COL(g, OBS_COL_E_IODE,     int32_t)[r]  = e->iode_iodnav;
+    COL(g, OBS_COL_E_WEEK,     int16_t)[r]  = (int16_t)e->week;
+    COL(g, OBS_COL_E_HEALTH,   int16_t)[r]  = (int16_t)e->health;
+    COL(g, OBS_COL_E_GLO_CHAN, int8_t)[r]   = (int8_t)(e->gnss_id == 2 ? e->glo_freq_chan : 0);
+    const double v[OBS_COL_N_EPH_COLS - OBS_COL_E_TOE] = {
+        e->toe, e->toc, e->sqrt_a, e->e, e->i0, e->omega0, e->omega, e->m0,
+        e->delta_n, e->idot, e->omega_dot, e->cuc, e->cus, e->crc, e->crs,
+        e->cic, e->cis, e->af0, e->af1, e->af2,
+        e->glo_pos[0], e->glo_pos[1], e->glo_pos[2],
+        e->glo_vel[0], e->glo_vel[1], e->glo_vel[2],
+        e->glo_acc[0], e->glo_acc[1], e->glo_acc[2], e->glo_tb_sod
+    };
+    for (int c = OBS_COL_E_TOE; c < OBS_COL_N_EPH_COLS; c++)
+        COL(g, c, double)[r] = v[c - OBS_COL_E_TOE];
+}
+
+void obs_col_writer_add_frame(ObsColWriter *w, const unsigned char *frame, int frame_len)
+{
+    if (!w || !frame || frame_len < 6 + 2) return;
+    const unsigned char *payload = frame + 3;
+    int len = frame_len - 6;
+    int mt = ((int)payload[0] << 4) | ((int)payload[1] >> 4);
+    if (rtcm_msg_is_msm(mt, 1, 7)) {
+        RtcmMsmObs obs;
+        if (rtcm_decode_msm(payload, len, &obs)) col_add_msm(w, &obs);
+    } else if (mt == 1019 || mt == 1020 || mt == 1041 || mt == 1042 ||
+               mt == 1044 || mt == 1045 || mt == 1046) {
+        SvEphemeris eph;
+        if (rtcm_decode_eph(payload, len, &eph)) col_add_eph(w, mt, &eph);
+    }
+}
+
+/* ── Writer API ───────────────────────────────────────────────────────── */
+
+static bool col_table_init(ColTable *t, int table, const ColDef *defs, int n_cols, uint32_t cap)
+{
+    t->table  = table;
+    t->defs   = defs;
+    t->n_cols = n_cols;
+    t->cap    = cap;
+    for (int i = 0; i < 2; i++)
+        for (int c = 0; c < n_cols; c++)
+            if (!(t->grp[i].col[c] = malloc((size_t)cap * defs[c].width))) return false;
+    return true;
+}
+
+static void col_writer_free(ObsColWriter *w)
+{
+    for (int k = 0; k < 2; k++)
+        for (int i = 0; i < 2; i++)
+            for (int c = 0; c < COL_MAX_COLS; c++) free(w->tab[k].grp[i].col[c]);
+    free(w->delta);
+    free(w->idx);
+    free(w->dict);
+    free(w->hash);
+    free(w);
+}
+
+ObsColWriter *obs_col_writer_open(const char *path, const char *source, int64_t t_hint)
+{
+    if (!path) return NULL;
+    col_eph_defs();
+    ObsColWriter *w = (ObsColWriter *)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    const uint32_t max_rows = OBS_COL_CELL_ROWS;
+    w->delta = (int32_t *)malloc(max_rows * sizeof(int32_t));
+    w->idx   = (uint16_t *)malloc(max_rows * sizeof(uint16_t));
+    w->dict  = (uint64_t *)malloc(max_rows * sizeof(uint64_t));
+    w->hash  = (uint32_t *)malloc(COL_HASH_SIZE * sizeof(uint32_t));
+    if (!w->delta || !w->idx || !w->dict || !w->hash ||
+        !col_table_init(&w->tab[0], OBS_COL_CELLS, k_cell_cols, OBS_COL_N_CELL_COLS,
+                        OBS_COL_CELL_ROWS) ||
+        !col_table_init(&w->tab[1], OBS_COL_EPHS, k_eph_cols, OBS_COL_N_EPH_COLS,
+                        OBS_COL_EPH_ROWS) ||
+        !(w->f = fopen(path, "wb"))) {
+        col_writer_free(w);
+        return NULL;
+    }
+    setvbuf(w->f, NULL, _IOFBF, COL_IO_BUF);
+    w->last_ms = -1;
+    w->hint_ms = stream_clock_unix_to_gps_ms(t_hint > 0 ? t_hint : (int64_t)time(NULL));
+
+    unsigned char hdr[COL_HEADER];
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, COL_MAGIC, 8);
+    put_u32(hdr + 8, COL_VERSION);
+    put_u32(hdr + 12, COL_HEADER);
+    put_u64(hdr + 16, (uint64_t)(int64_t)time(NULL));
+    if (source) strncpy((char *)hdr + 24, source, 39);
+    col_write(w, hdr, sizeof(hdr));
+
+#ifdef _WIN32
+    w->thread = (HANDLE)_beginthreadex(NULL, 0, col_thread, w, 0, NULL);
+    bool started = w->thread != NULL;
+#else
+    bool started = pthread_create(&w->thread, NULL, col_thread, w) == 0;
+#endif
+    if (!started) {
+        fclose(w->f);
+        col_writer_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+bool obs_col_writer_close(ObsColWriter *w, ObsColStats *st)
+{
+    if (!w) return false;
+    col_hand_off(w, &w->tab[0]);
+    col_hand_off(w, &w->tab[1]);
+    COL_STORE(&w->stop, 1);
+#ifdef _WIN32
+    WaitForSingleObject(w->thread, INFINITE);
+    CloseHandle(w->thread);
+#else
+    pthread_join(w->thread, NULL);
+#endif
+    if (fclose(w->f) != 0) w->failed = 1;
+    if (st) {
+        st->cells  = w->cells;
+        st->ephs   = w->ephs;
+        st->groups = w->groups;
+        st->bytes  = w->off;
+        st->stalls = w->stalls;
+        st->failed = w->failed != 0;
+    }
+    bool ok = !w->failed;
+    col_writer_free(w);
+    return ok;
+}
+
+bool obs_col_is_path(const char *path)
+{
+    size_t len = path ? strlen(path) : 0;
+    size_t ext = strlen(OBS_COL_EXT);
+    return len > ext && strcmp(path + len - ext, OBS_COL_EXT) == 0;
+}
+
+/* ── Reader ───────────────────────────────────────────────────────────── */
+
+bool obs_col_file_open(ObsColFile *f, const char *path)
+{
+    memset(f, 0, sizeof(*f));
+    if (!file_map_open(&f->map, path)) return false;
+    const unsigned char *d = f->map.data;
+    const uint64_t size = f->map.size;
+    if (size < COL_HEADER || memcmp(d, COL_MAGIC, 8) != 0 ||
+        get_u32(d + 8) != COL_VERSION || get_u32(d + 12) < COL_HEADER) {
+        obs_col_file_close(f);
+        return false;
+    }
+    f->created = (int64_t)get_u64(d + 16);
+    memcpy(f->source, d + 24, 40);
+    f->source[40] = '\0';
+
+    uint32_t cap = 0;
+    uint64_t off = get_u32(d + 12);
+    while (off < size) {
+        const unsigned char *h = d + off;
+        if (size - off < COL_GROUP_HEADER || memcmp(h, COL_GROUP_MAGIC, 4) != 0) {
+            f->truncated = true;
+            break;
+        }
+        uint64_t bytes = get_u64(h + 16);
+        int n_cols = get_u16(h + 6);
+        uint32_t nd = get_u32(h + 12);
+        if (bytes > size - off || n_cols > COL_MAX_COLS ||
+            COL_GROUP_HEADER + (uint64_t)n_cols * COL_DIR_ENTRY + (uint64_t)nd * 8 > bytes) {
+            f->truncated = true;
+            break;
+        }
+        if (f->n_groups == cap) {
+            cap = cap ? cap * 2 : 64;
+            ObsColGroup *ng = (ObsColGroup *)realloc(f->groups, cap * sizeof(ObsColGroup));
+            if (!ng) {
+                obs_col_file_close(f);
+                return false;
+            }
+            f->groups = ng;
+        }
+        ObsColGroup *g = &f->groups[f->n_groups++];
+        g->table  = get_u16(h + 4);
+        g->n_cols = n_cols;
+        g->rows   = get_u32(h + 8);
+        g->n_dict = nd;
+        g->t_base = (int64_t)get_u64(h + 24);
+        g->t_last = (int64_t)get_u64(h + 32);
+        g->dir    = h + COL_GROUP_HEADER;
+        g->dict   = (const uint64_t *)(g->dir + (size_t)n_cols * COL_DIR_ENTRY);
+        off += bytes;
+    }
+    return true;
+}
+
+void obs_col_file_close(ObsColFile *f)
+{
+    file_map_close(&f->map);
+    free(f->groups);
+    memset(f, 0, sizeof(*f));
+}
+
+const void *obs_col_column(const ObsColFile *f, const ObsColGroup *g, int column, int *type)
+{
+    for (int c = 0; c < g->n_cols; c++) {
+        const unsigned char *e = g->dir + (size_t)c * COL_DIR_ENTRY;
+        if (get_u16(e) != column) continue;
+        int t = e[2];
+        uint64_t off = get_u64(e + 8);
+        if (t < OBS_COL_I8 || t > OBS_COL_F64 || (off & 7) ||
+            off > f->map.size || (uint64_t)g->rows * k_type_size[t] > f->map.size - off)
+            return NULL;
+        if (type) *type = t;
+        return f->map.data + off;
+    }
+    return NULL;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file obs_columns.h
+ * @brief Columnar export of decoded MSM cells and ephemerides (.nacol).
+ *
+ * `-d` text is the slowest way to get observations into an analytics
+ * stack: every value is formatted, then parsed back.  A .nacol file keeps
+ * the decoded values as plain arrays, one per column, in row groups:
+ *
+ *   - Cells: one row per MSM cell (satellite x signal), ephemerides: one
+ *     row per decoded 1019 / 1020 / 1041 / 1042 / 1044 / 1045 / 1046.
+ *   - Time is GPS ms, stored as the difference to the previous row of the
+ *     group (0 for all cells of an epoch) from the group's base time.
+ *   - The (station, GNSS, PRN, signal) or (message, GNSS, PRN) identity of
+ *     a row is a u16 index into the group's dictionary.
+ *   - Every column starts on an 8-byte boundary of the file, so a reader
+ *     can map the file (file_map.h) and use a column as a C array; only
+ *     the pages of the columns it reads are ever loaded.  Scanning the CNR
+ *     of one station reads the key and cnr columns (4 bytes per cell).
+ *
+ * obs_col_writer_add_frame() decodes on the receiving thread and appends
+ * to the row group being filled.  A full group is handed to an encoder
+ * thread (dictionary, time deltas, write) while the other one of a pair
+ * is filled, so encoding and disk writes stay off the receive path.  The
+ * receiving thread only waits if the encoder is a whole group behind.
+ *
+ * A file is a header and row groups, nothing else: a run that is killed
+ * leaves a readable file up to its last complete group.
+ *
+ * Layout (little-endian; arrays in the host order of the little-endian
+ * platforms the analyser builds on):
+ * @code
+ *   header        64 B  "NACOL\r\n\x1a", u32 version, u32 header size,
+ *                       i64 created (Unix s), char source[40] (NUL padded)
+ *   row group     48 B  "NAGR", u16 table (1 cells, 2 ephemerides),
+ *                       u16 columns, u32 rows, u32 dictionary entries,
+ *                       u64 group bytes (from "NAGR"), i64 t_base,
+ *                       i64 t_last (GPS ms), 8 B reserved
+ *                 columns x 16 B { u16 column, u8 type, u8 encoding,
+ *                       4 B reserved, u64 offset from the file start }
+ *                 dictionary entries x u64
+ *                 column arrays, rows x type size each, 8-byte aligned
+ * @endcode
+ * Dictionary keys: cells (station << 32) | (gnss << 16) | (prn << 8) |
+ * signal (DF395 position, 0-based); ephemerides (message << 16) |
+ * (gnss << 8) | prn.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef OBS_COLUMNS_H
+#define OBS_COLUMNS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "file_map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OBS_COL_EXT            ".nacol"
+
+/** @brief Rows per cell row group (the u16 dictionary index needs <= 65536). */
+#define OBS_COL_CELL_ROWS      65536
+
+/** @brief Rows per ephemeris row group. */
+#define OBS_COL_EPH_ROWS       4096
+
+/** @brief Row-group tables. */
+enum { OBS_COL_CELLS = 1, OBS_COL_EPHS = 2 };
+
+/** @brief Column types; the value is also the code in the file. */
+enum {
+    OBS_COL_I8 = 1, OBS_COL_U8, OBS_COL_I16, OBS_COL_U16,
+    OBS_COL_I32, OBS_COL_U32, OBS_COL_I64, OBS_COL_F32, OBS_COL_F64
+};
+
+/** @brief Column encodings. */
+enum {
+    OBS_COL_PLAIN = 0,
+    OBS_COL_DELTA = 1,   /**< i32 difference to the previous row, first from t_base */
+    OBS_COL_DICT  = 2    /**< u16 index into the group dictionary */
+};
+
+/** @brief Cell columns. */
+enum {
+    OBS_COL_C_T,         /**< i32 delta, GPS ms */
+    OBS_COL_C_KEY,       /**< u16 dict */
+    OBS_COL_C_MSM,       /**< u8  MSM subtype 1..7 */
+    OBS_COL_C_CNR,       /**< u16 CNR in 1/16 dB-Hz, 0 = none */
+    OBS_COL_C_LOCK,      /**< u16 lock-time indicator (DF402 / DF407) */
+    OBS_COL_C_FLAGS,     /**< u8  bit 0 half-cycle ambiguity, bit 1 rate valid */
+    OBS_COL_C_PR,        /**< f64 pseudorange, m (0 = invalid) */
+    OBS_COL_C_PH,        /**< f64 phase range, m (0 = invalid) */
+    OBS_COL_C_RATE,      /**< f32 phase-range rate, m/s (MSM5/7) */
+    OBS_COL_N_CELL_COLS
+};
+
+/** @brief Ephemeris columns: time, key, integers, then the SvEphemeris doubles. */
+enum {
+    OBS_COL_E_T,         /**< i32 delta, GPS ms of the latest MSM epoch */
+    OBS_COL_E_KEY,       /**< u16 dict */
+    OBS_COL_E_IODE,      /**< i32 IODE / IODnav / IODEC ... */
+    OBS_COL_E_WEEK,      /**< i16 as broadcast */
+    OBS_COL_E_HEALTH,    /**< i16 */
+    OBS_COL_E_GLO_CHAN,  /**< i8  GLONASS channel, 0 otherwise */
+    OBS_COL_E_TOE,       /**< f64 columns from here, in SvEphemeris order: */
+    OBS_COL_E_TOC, OBS_COL_E_SQRT_A, OBS_COL_E_E, OBS_COL_E_I0, OBS_COL_E_OMEGA0,
+    OBS_COL_E_OMEGA, OBS_COL_E_M0, OBS_COL_E_DELTA_N, OBS_COL_E_IDOT,
+    OBS_COL_E_OMEGA_DOT, OBS_COL_E_CUC, OBS_COL_E_CUS, OBS_COL_E_CRC,
+    OBS_COL_E_CRS, OBS_COL_E_CIC, OBS_COL_E_CIS, OBS_COL_E_AF0, OBS_COL_E_AF1,
+    OBS_COL_E_AF2,
+    OBS_COL_E_GLO_X, OBS_COL_E_GLO_Y, OBS_COL_E_GLO_Z,
+    OBS_COL_E_GLO_VX, OBS_COL_E_GLO_VY, OBS_COL_E_GLO_VZ,
+    OBS_COL_E_GLO_AX, OBS_COL_E_GLO_AY, OBS_COL_E_GLO_AZ,
+    OBS_COL_E_GLO_TB,
+    OBS_COL_N_EPH_COLS
+};
+
+/* ── Writer ───────────────────────────────────────────────────────────── */
+
+/**
+ * @struct ObsColStats
+ * @brief Writer counters.
+ *
+ * Fields:
+ *   - cells, ephs:  Rows written.
+ *   - groups:       Row groups written.
+ *   - bytes:        File size.
+ *   - stalls:       Times the receiving thread waited for the encoder.
+ *   - failed:       The file could not be written.
+ */
+typedef struct {
+    uint64_t cells;
+    uint64_t ephs;
+    uint64_t groups;
+    uint64_t bytes;
+    uint64_t stalls;
+    bool     failed;
+} ObsColStats;
+
+/** @brief Opaque writer (owns its encoder thread). */
+typedef struct ObsColWriter ObsColWriter;
+
+/**
+ * @brief Create @p path and start the encoder thread.
+ *
+ * @param source  Mountpoint or capture name for the header.
+ * @param t_hint  Unix time (s) within half a week of the data, for the GPS
+ *                week (see stream_clock_msm_gps_ms()); 0 = system clock.
+ * @return The writer, or NULL if the file or thread cannot be created.
+ */
+ObsColWriter *obs_col_writer_open(const char *path, const char *source, int64_t t_hint);
+
+/**
+ * @brief Feed one RTCM frame (0xD3 preamble to CRC).  MSM1..7 add cells,
+ *        ephemeris messages a row; others are ignored.  One thread only.
+ */
+void obs_col_writer_add_frame(ObsColWriter *w, const unsigned char *frame, int frame_len);
+
+/**
+ * @brief Write the partial row groups, stop the thread, close the file
+ *        and free @p w.
+ * @param st  [out] Final counters (may be NULL).
+ * @return false if the file could not be written completely.
+ */
+bool obs_col_writer_close(ObsColWriter *w, ObsColStats *st);
+
+/** @brief true if @p path ends in @ref OBS_COL_EXT. */
+bool obs_col_is_path(const char *path);
+
+/* ── Reader ───────────────────────────────────────────────────────────── */
+
+/**
+ * @struct ObsColGroup
+ * @brief One row group of a mapped file; pointers into the mapping.
+ */
+typedef struct {
+    int                  table;      /**< OBS_COL_CELLS / OBS_COL_EPHS */
+    uint32_t             rows;
+    uint32_t             n_dict;
+    int                  n_cols;
+    int64_t              t_base;     /**< GPS ms the first time delta is from */
+    int64_t              t_last;
+    const uint64_t      *dict;
+    const unsigned char *dir;        /**< column directory */
+} ObsColGroup;
+
+/**
+ * @struct ObsColFile
+ * @brief A mapped .nacol file and its row groups.
+ */
+typedef struct {
+    FileMap      map;
+    char         source[41];
+    int64_t      created;
+    uint32_t     n_groups;
+    ObsColGroup *groups;
+    bool         truncated;          /**< ended inside a row group (killed run) */
+} ObsColFile;
+
+/**
+ * @brief Map @p path and index its row groups.
+ * @return false if it is not a .nacol file or memory runs out.
+ */
+bool obs_col_file_open(ObsColFile *f, const char *path);
+
+/** @brief Unmap and free.  Safe on a failed open. */
+void obs_col_file_close(ObsColFile *f);
+
+/**
+ * @brief Column @p column of group @p g as an array of @c g->rows values.
+ * @param type  [out] OBS_COL_I8 .. OBS_COL_F64 (may be NULL).
+ * @return NULL if the group has no such column.
+ */
+const void *obs_col_column(const ObsColFile *f, const ObsColGroup *g, int column, int *type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OBS_COLUMNS_H */
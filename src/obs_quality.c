@@ -0,0 +1,293 @@
+/**
+ * @file obs_quality.c
+ * @brief Streaming per-signal observation quality from decoded MSM cells.
+ *
+ * Epochs are numbered per (station, GNSS) as in sat_vis.c: a frame with a
+ * new epoch time opens the next epoch, and the epoch times are unwrapped
+ * into milliseconds (week for GPS time of week, day for GLONASS time of
+ * day) so the lock-time test can use the time between two observations
+ * of a cell even across a gap.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "obs_quality.h"
+#include "event_out.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define WEEK_MS  604800000LL
+#define DAY_MS    86400000LL
+
+typedef struct {
+    int64_t  t_ms;              /* epoch of the last observation */
+    uint32_t epoch;             /* its number; 0 = never seen */
+    uint32_t lock_lo;           /* its minimum lock time, ms */
+    float    cnr_mean;
+    uint16_t cnr_n;             /* CNR samples in the track, saturating */
+    uint8_t  has_lock;
+    uint8_t  half_cycle;
+    uint8_t  in_drop;
+} ObsQualityCell;
+
+struct ObsQualitySv {
+    ObsQualityCell cell[OBSQ_MAX_SIGS];
+};
+
+/* DF407, RTCM 10403.3 Table 3.5-75: 1 ms steps up to 63, then 32
+ * values per doubling of the step, from 64 ms at 2 ms. */
+static uint32_t lock_df407_ms(unsigned i)
+{
+    if (i < 64) return i;
+    if (i > 704) i = 704;
+    unsigned j = (i - 64) / 32 + 1;
+    return (1u << (j + 5)) + (i - 32 - 32 * j) * (1u << j);
+}
+
+void obs_quality_lock_range(unsigned indicator, bool extended,
+                            uint32_t *lo_ms, uint32_t *hi_ms)
+{
+    if (extended) {
+        /* 705..1023 are reserved: read as the top value */
+        unsigned i = indicator > 704 ? 704 : indicator;
+        *lo_ms = lock_df407_ms(i);
+        *hi_ms = i == 704 ? UINT32_MAX : lock_df407_ms(i + 1);
+        return;
+    }
+    /* DF402: 0 = under 32 ms, then 32 ms doubling up to 15 = 524288 ms */
+    unsigned i = indicator & 15;
+    *lo_ms = i ? 16u << i : 0;
+    *hi_ms = i == 15 ? UINT32_MAX : 16u << (i + 1);
+}
+
+static int station_slot(ObsQualityStats *s, uint16_t station)
+{
+    for (int i = 0; i < s->n_stations; i++)
+        if (s->station[i] == station) return i;
+    if (s->n_stations == OBSQ_MAX_STATIONS) return -1;
+    s->station[s->n_stations] = station;
+    return s->n_stations++;
+}
+
+static ObsQualityRow *row_get(ObsQualityStats *s, int slot, int g, int sig)
+{
+    uint8_t *r = &s->row_of[slot][g][sig];
+    if (*r) return &s->row[*r - 1];
+    if (s->n_rows == OBSQ_MAX_ROWS) return NULL;
+    ObsQualityRow *row = &s->row[s->n_rows];
+    memset(row, 0, sizeof(*row));
+    row->station = s->station[slot];
+    row->gnss_id = (uint8_t)g;
+    row->sig_idx = (uint8_t)sig;
+    *r = (uint8_t)++s->n_rows;
+    return row;
+}
+
+/* Open the epoch of @p obs if it is a new one. */
+static void epoch_advance(ObsQualityEpoch *e, const RtcmMsmObs *obs)
+{
+    if (e->n && e->epoch_time == obs->epoch_time) return;
+
+    int64_t ms, period;
+    if (obs->gnss_id == 2) {
+        ms     = obs->epoch_time & 0x7FFFFFF;       /* DF034, time of day */
+        period = DAY_MS;
+    } else {
+        ms     = obs->epoch_time;
+        period = WEEK_MS;
+    }
+    if (e->n) {
+        int64_t prev = e->t_ms % period;
+        if (prev < 0) prev += period;
+        int64_t d = (ms - prev) % period;
+        if (d >   period / 2) d -= period;
+        if (d <= -period / 2) d += period;
+        e->t_ms += d;
+        if (d > 0 && (!e->interval_ms || d < e->interval_ms)) e->interval_ms = d;
+    } else {
+        e->t_ms = ms;
+    }
+    e->epoch_time = obs->epoch_time;
+    e->n++;
+}
+
+void obs_quality_add(ObsQuality *q, const RtcmMsmObs *obs)
+{
+    if (!obs || obs->num_cells == 0) return;
+    int g = obs->gnss_id;
+    if (g < 0 || g >= OBSQ_MAX_GNSS) return;
+
+    ObsQualityStats *s = &q->stats;
+    int slot = station_slot(s, obs->ref_station_id);
+    if (slot < 0) {
+        s->overflow += (uint64_t)obs->num_cells;
+        return;
+    }
+    ObsQualityEpoch *e = &q->epoch[slot][g];
+    epoch_advance(e, obs);
+
+    /* MSM1 has no lock time; MSM2..5 the 4-bit DF402, MSM6/7 DF407 */
+    const bool has_lock = obs->msm_subtype >= 2;
+    const bool extended = obs->msm_subtype >= 6;
+    const bool has_cnr  = obs->msm_subtype >= 4;
+
+    for (int c = 0; c < obs->num_cells; c++) {
+        const RtcmMsmCell *cell = &obs->cells[c];
+        int prn = obs->sats[cell->sat].prn;
+        if (prn < 1 || prn > OBSQ_MAX_PRN || cell->sig_idx < 0 ||
+            cell->sig_idx >= OBSQ_MAX_SIGS)
+            continue;
+
+        ObsQualitySv **sv = &q->sv[slot][g][prn - 1];
+        if (!*sv && !(*sv = (ObsQualitySv *)calloc(1, sizeof(**sv)))) {
+            s->overflow++;
+            continue;
+        }
+        ObsQualityCell *st = &(*sv)->cell[cell->sig_idx];
+        if (st->epoch == e->n) continue;          /* already seen this epoch */
+
+        ObsQualityRow *row = row_get(s, slot, g, cell->sig_idx);
+        if (!row) {
+            s->overflow++;
+            continue;
+        }
+        row->obs++;
+
+        uint32_t lo = 0, hi = UINT32_MAX;
+        if (has_lock) obs_quality_lock_range(cell->lock, extended, &lo, &hi);
+
+        int64_t  dt     = e->t_ms - st->t_ms;
+        uint32_t missed = UINT32_MAX;
+        if (st->epoch && e->interval_ms)
+            missed = dt < 0 ? 0 : (uint32_t)((dt + e->interval_ms / 2) / e->interval_ms - 1);
+        else if (st->epoch)
+            missed = e->n - st->epoch - 1;
+        if (missed > OBSQ_GAP_MAX_EPOCHS) {
+            row->tracks++;
+            st->cnr_n   = 0;
+            st->in_drop = 0;
+        } else {
+            if (missed) {
+                row->gaps++;
+                row->missed += missed;
+            }
+            /* Without a slip the lock time grew by at least the time
+             * since the last observation. */
+            if (has_lock && st->has_lock && dt >= 0 &&
+                (int64_t)hi < (int64_t)st->lock_lo + dt)
+                row->slips++;
+            if (cell->half_cycle && !st->half_cycle)
+                row->half_cycles++;
+        }
+        st->epoch      = e->n;
+        st->t_ms       = e->t_ms;
+        st->lock_lo    = lo;
+        st->has_lock   = has_lock;
+        st->half_cycle = cell->half_cycle;
+
+        float x = cell->cnr_dbhz;
+        if (!has_cnr || !(x > 0.0f)) continue;
+        if (st->cnr_n == 0) {
+            st->cnr_mean = x;
+        } else {
+            if (st->cnr_n >= OBSQ_CNR_WARMUP) {
+                if (!st->in_drop && x <= st->cnr_mean - OBSQ_CNR_DROP_DB) {
+                    row->cnr_drops++;
+                    st->in_drop = 1;
+                } else if (st->in_drop && x >= st->cnr_mean - OBSQ_CNR_DROP_DB / 2) {
+                    st->in_drop = 0;
+                }
+            }
+            st->cnr_mean += OBSQ_CNR_ALPHA * (x - st->cnr_mean);
+        }
+        if (st->cnr_n < UINT16_MAX) st->cnr_n++;
+    }
+}
+
+bool obs_quality_add_frame(ObsQuality *q, const unsigned char *frame, int frame_len)
+{
+    if (!frame || frame_len < 6 + 7) return false;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+    if (!rtcm_msg_is_msm(mt, 1, 7)) return false;
+    RtcmMsmObs obs;
+    if (!rtcm_decode_msm(frame + 3, frame_len - 6, &obs)) return false;
+    obs_quality_add(q, &obs);
+    return true;
+}
+
+void obs_quality_free(ObsQuality *q)
+{
+    for (int k = 0; k < OBSQ_MAX_STATIONS; k++)
+        for (int g = 0; g < OBSQ_MAX_GNSS; g++)
+            for (int p = 0; p < OBSQ_MAX_PRN; p++)
+                free(q->sv[k][g][p]);
+    memset(q, 0, sizeof(*q));
+}
+
+ObsQualityRow obs_quality_total(const ObsQualityStats *s, int gnss_id)
+{
+    ObsQualityRow t;
+    memset(&t, 0, sizeof(t));
+    t.gnss_id = (uint8_t)gnss_id;
+    for (int i = 0; i < s->n_rows; i++) {
+        const ObsQualityRow *r = &s->row[i];
+        if (gnss_id && r->gnss_id != gnss_id) continue;
+        t.obs         += r->obs;
+        t.tracks      += r->tracks;
+        t.slips       += r->slips;
+        t.gaps        += r->gaps;
+        t.missed      += r->missed;
+        t.cnr_drops   += r->cnr_drops;
+        t.half_cycles += r->half_cycles;
+    }
+    return t;
+}
+
+static const char k_gnss[OBSQ_MAX_GNSS][8] = { "?", "GPS", "GLONASS", "Galileo",
+                                               "QZSS", "BeiDou", "SBAS", "NavIC" };
+
+void obs_quality_print_table(const ObsQualityStats *s, const char *title, FILE *out)
+{
+    static const char border[] =
+        "+---------+---------+--------+----------+--------+-------+-------+--------+-----------+------------+\n";
+    fprintf(out, "\n%s\n", title);
+    fputs(border, out);
+    fprintf(out, "| Station | GNSS    | Signal | Obs      | Tracks | Slips | Gaps  | Missed "
+                 "| CNR drops | Half-cycle |\n");
+    fputs(border, out);
+    for (int i = 0; i < s->n_rows; i++) {
+        const ObsQualityRow *r = &s->row[i];
+        fprintf(out, "| %7u | %-7s | %-6s | %8llu | %6u | %5u | %5u | %6u | %9u | %10u |\n",
+                (unsigned)r->station, k_gnss[r->gnss_id],
+                msm_signal_label(r->gnss_id, r->sig_idx), (unsigned long long)r->obs,
+                r->tracks, r->slips, r->gaps, r->missed, r->cnr_drops, r->half_cycles);
+    }
+    fputs(border, out);
+    if (s->overflow)
+        fprintf(out, "(%llu observations beyond %d stations / %d rows not counted)\n",
+                (unsigned long long)s->overflow, OBSQ_MAX_STATIONS, OBSQ_MAX_ROWS);
+}
+
+void obs_quality_to_event(const ObsQualityStats *s, EventOut *ev, const char *key)
+{
+    event_arr(ev, key);
+    for (int i = 0; i < s->n_rows; i++) {
+        const ObsQualityRow *r = &s->row[i];
+        event_obj(ev, NULL);
+        event_uint(ev, "station", r->station);
+        event_str(ev, "gnss", k_gnss[r->gnss_id]);
+        event_str(ev, "signal", msm_signal_label(r->gnss_id, r->sig_idx));
+        event_uint(ev, "obs", r->obs);
+        event_uint(ev, "tracks", r->tracks);
+        event_uint(ev, "slips", r->slips);
+        event_uint(ev, "gaps", r->gaps);
+        event_uint(ev, "missed", r->missed);
+        event_uint(ev, "cnr_drops", r->cnr_drops);
+        event_uint(ev, "half_cycles", r->half_cycles);
+        event_close(ev);
+    }
+    event_close(ev);
+}
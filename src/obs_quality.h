@@ -0,0 +1,168 @@
+/**
+ * @file obs_quality.h
+ * @brief Streaming per-signal observation quality: cycle slips, gaps and
+ *        CNR drops from the decoded MSM cells.
+ *
+ * Every MSM cell carries a lock-time indicator and a half-cycle flag,
+ * MSM4..MSM7 also a CNR.  obs_quality_add() walks the cells of one decoded
+ * frame (rtcm_decode_msm()) and keeps a few bytes of state per (station,
+ * GNSS, PRN, signal), so each cell costs O(1) and nothing is ever
+ * rescanned:
+ *
+ *   - cycle slip: the lock time went back -- the cell's lock time is less
+ *     than it was one observation earlier plus the time in between.  The
+ *     indicators (DF402, or DF407 for MSM6/7) give a range per value, so
+ *     only a range that cannot hold the old lock time plus the elapsed
+ *     time counts; a saturated indicator never does
+ *   - gap: the cell is back after 1..@ref OBSQ_GAP_MAX_EPOCHS epochs
+ *     without it, counted in the epoch interval of its GNSS so frames lost
+ *     whole count as well; a longer absence starts a new track
+ *   - CNR drop: the CNR fell @ref OBSQ_CNR_DROP_DB or more under its
+ *     moving mean, after @ref OBSQ_CNR_WARMUP epochs of the track; counted
+ *     once until it has recovered half way
+ *   - half cycle: the half-cycle ambiguity flag (DF420) was raised
+ *
+ * The counts are kept per (station, GNSS, signal) in @ref ObsQualityStats:
+ * plain data, a few kB, meant to be copied into a statistics snapshot
+ * (stats_snapshot.h) or a metrics mount.  The per-cell state sits in
+ * blocks allocated when a satellite is first seen, as in sat_vis.h only
+ * the satellites actually in the stream cost memory.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef OBS_QUALITY_H
+#define OBS_QUALITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rtcm3x_parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OBSQ_MAX_GNSS       8       /**< gnss_id 0..7 */
+#define OBSQ_MAX_PRN        64
+#define OBSQ_MAX_SIGS       32      /**< MSM signal-mask bits */
+
+/** @brief Reference stations (DF003) told apart per stream. */
+#define OBSQ_MAX_STATIONS   4
+
+/** @brief (station, GNSS, signal) rows; observations past them count as overflow. */
+#define OBSQ_MAX_ROWS       128
+
+/** @brief A cell back within this many missed epochs continues its track. */
+#define OBSQ_GAP_MAX_EPOCHS 30
+
+/** @brief CNR this far under the moving mean is a drop (dB-Hz). */
+#define OBSQ_CNR_DROP_DB    6.0f
+
+/** @brief Weight of a new CNR in the moving mean, per epoch. */
+#define OBSQ_CNR_ALPHA      0.1f
+
+/** @brief Epochs of a track before CNR drops are looked for. */
+#define OBSQ_CNR_WARMUP     10
+
+/** @brief Counts of one (station, GNSS, signal). */
+typedef struct {
+    uint16_t station;           /**< DF003 */
+    uint8_t  gnss_id;
+    uint8_t  sig_idx;           /**< 0-based MSM signal-mask position */
+    uint64_t obs;               /**< cell observations, one per epoch */
+    uint32_t tracks;            /**< first seen, or back after more than OBSQ_GAP_MAX_EPOCHS */
+    uint32_t slips;             /**< lock-time resets */
+    uint32_t gaps;              /**< back after 1..OBSQ_GAP_MAX_EPOCHS missed epochs */
+    uint32_t missed;            /**< epochs missed in those gaps */
+    uint32_t cnr_drops;
+    uint32_t half_cycles;       /**< half-cycle ambiguity flag raised */
+} ObsQualityRow;
+
+/**
+ * @struct ObsQualityStats
+ * @brief Quality counts of one stream.  All zero is empty.
+ *
+ * Rows are taken in first-seen order and never move.
+ */
+typedef struct {
+    int           n_stations;
+    uint16_t      station[OBSQ_MAX_STATIONS];
+    int           n_rows;
+    uint64_t      overflow;     /**< observations without a station slot or row */
+    uint8_t       row_of[OBSQ_MAX_STATIONS][OBSQ_MAX_GNSS][OBSQ_MAX_SIGS];  /**< row + 1; 0 = none */
+    ObsQualityRow row[OBSQ_MAX_ROWS];
+} ObsQualityStats;
+
+/** @brief Epoch state of one (station, GNSS). */
+typedef struct {
+    uint32_t n;                 /**< epochs so far */
+    uint32_t epoch_time;        /**< MSM epoch time of epoch n */
+    int64_t  t_ms;              /**< epoch n in ms, unwrapped since the first */
+    int64_t  interval_ms;       /**< shortest step between two epochs; 0 = not known yet */
+} ObsQualityEpoch;
+
+/** @brief Per-cell state of one satellite (opaque). */
+typedef struct ObsQualitySv ObsQualitySv;
+
+/**
+ * @struct ObsQuality
+ * @brief The engine: counts plus per-cell state.  All zero is empty;
+ *        obs_quality_free() releases the cell blocks.
+ */
+typedef struct {
+    ObsQualityStats stats;
+    ObsQualityEpoch epoch[OBSQ_MAX_STATIONS][OBSQ_MAX_GNSS];
+    ObsQualitySv   *sv[OBSQ_MAX_STATIONS][OBSQ_MAX_GNSS][OBSQ_MAX_PRN];
+} ObsQuality;
+
+/**
+ * @brief Minimum and (exclusive) maximum lock time in ms of a lock-time
+ *        indicator: DF407 when @p extended (MSM6/7), else DF402.
+ *
+ * @p hi_ms is UINT32_MAX for the top value of either.
+ */
+void obs_quality_lock_range(unsigned indicator, bool extended,
+                            uint32_t *lo_ms, uint32_t *hi_ms);
+
+/**
+ * @brief Add the cells of one decoded MSM frame.
+ *
+ * Frames of one epoch (several MSM types, multiple-message bit) may come
+ * in any order; a cell already seen in the epoch is not counted again.
+ */
+void obs_quality_add(ObsQuality *q, const RtcmMsmObs *obs);
+
+/**
+ * @brief Decode @p frame (a whole RTCM frame) and add it if it is an MSM
+ *        frame.
+ * @return true if it was.
+ */
+bool obs_quality_add_frame(ObsQuality *q, const unsigned char *frame, int frame_len);
+
+/** @brief Free the cell blocks and clear @p q. */
+void obs_quality_free(ObsQuality *q);
+
+/** @brief Sum of the rows of @p gnss_id (0 = all); station and signal are 0 in it. */
+ObsQualityRow obs_quality_total(const ObsQualityStats *s, int gnss_id);
+
+/** @brief Print the rows as a table, one per station, GNSS and signal. */
+void obs_quality_print_table(const ObsQualityStats *s, const char *title, FILE *out);
+
+struct EventOut;   /* event_out.h */
+
+/**
+ * @brief Add the rows to the event being built as field @p key, an array
+ *        of objects {"station","gnss","signal","obs","tracks","slips",
+ *        "gaps","missed","cnr_drops","half_cycles"}.
+ */
+void obs_quality_to_event(const ObsQualityStats *s, struct EventOut *ev, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OBS_QUALITY_H */
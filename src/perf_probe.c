@@ -0,0 +1,163 @@
+/**
+ * @file perf_probe.c
+ * @brief Per-stage latency probes with constant-memory histograms.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "perf_probe.h"
+#include "event_out.h"
+
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifndef NTRIP_NO_PERF_PROBES
+bool perf_probes_on = false;
+#endif
+
+void perf_enable(bool on)
+{
+#ifndef NTRIP_NO_PERF_PROBES
+    perf_probes_on = on;
+#else
+    (void)on;
+#endif
+}
+
+#ifdef _WIN32
+uint64_t perf_now_ns(void)
+{
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    /* Split so the multiply cannot overflow for any uptime */
+    uint64_t f = (uint64_t)freq.QuadPart, c = (uint64_t)now.QuadPart;
+    return c / f * 1000000000ull + c % f * 1000000000ull / f;
+}
+#else
+uint64_t perf_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+void perf_stream_reset(PerfStream *ps)
+{
+    memset(ps, 0, sizeof(*ps));
+}
+
+void perf_hist_merge(PerfHist *dst, const PerfHist *src)
+{
+    if (src->count == 0) return;
+    if (dst->count == 0 || src->min_ns < dst->min_ns) dst->min_ns = src->min_ns;
+    if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    dst->count  += src->count;
+    dst->sum_ns += src->sum_ns;
+    for (int i = 0; i < PERF_HIST_BUCKETS; i++) dst->bucket[i] += src->bucket[i];
+}
+
+/* Middle of bucket @p idx. */
+static uint64_t perf_bucket_mid(int idx)
+{
+    const int sub = 1 << PERF_HIST_SUB_BITS;
+    if (idx < sub) return (uint64_t)idx;
+    int k = (idx >> PERF_HIST_SUB_BITS) + PERF_HIST_SUB_BITS - 1;
+    uint64_t width = 1ull << (k - PERF_HIST_SUB_BITS);
+    uint64_t lo    = (uint64_t)(sub + (idx & (sub - 1))) * width;
+    return lo + width / 2;
+}
+
+uint64_t perf_hist_quantile(const PerfHist *h, double q)
+{
+    if (h->count == 0) return 0;
+    if (q <= 0.0) return h->min_ns;
+    if (q >= 1.0) return h->max_ns;
+
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < PERF_HIST_BUCKETS; i++) {
+        seen += h->bucket[i];
+        if (seen >= rank) {
+            uint64_t v = perf_bucket_mid(i);
+            if (v < h->min_ns) v = h->min_ns;
+            if (v > h->max_ns) v = h->max_ns;
+            return v;
+        }
+    }
+    return h->max_ns;
+}
+
+const char *perf_stage_name(PerfStage stage)
+{
+    switch (stage) {
+    case PERF_STAGE_FRAME:  return "frame";
+    case PERF_STAGE_QUEUE:  return "queue";
+    case PERF_STAGE_DECODE: return "decode";
+    case PERF_STAGE_SKY:    return "sky";
+    case PERF_STAGE_OUTPUT: return "output";
+    case PERF_STAGE_TOTAL:  return "total";
+    default:                return "?";
+    }
+}
+
+bool perf_stream_any(const PerfStream *ps)
+{
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        if (ps->stage[s].count) return true;
+    }
+    return false;
+}
+
+void perf_print_table(const PerfStream *ps, const char *title, FILE *out)
+{
+    static const char border[] =
+        "+--------+-----------+----------+----------+----------+----------+----------+----------+\n";
+    fprintf(out, "\n%s (us)\n", title);
+    fputs(border, out);
+    fprintf(out, "| Stage  | Count     | Mean     | p50      | p90      | p99      | p99.9    | Max      |\n");
+    fputs(border, out);
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        const PerfHist *h = &ps->stage[s];
+        if (!h->count) continue;
+        fprintf(out, "| %-6s | %9llu | %8.1f | %8.1f | %8.1f | %8.1f | %8.1f | %8.1f |\n",
+                perf_stage_name((PerfStage)s), (unsigned long long)h->count,
+                (double)h->sum_ns / (double)h->count / 1e3,
+                perf_hist_quantile(h, 0.50)  / 1e3,
+                perf_hist_quantile(h, 0.90)  / 1e3,
+                perf_hist_quantile(h, 0.99)  / 1e3,
+                perf_hist_quantile(h, 0.999) / 1e3,
+                h->max_ns / 1e3);
+    }
+    fputs(border, out);
+}
+
+void perf_print_event(const PerfStream *ps, EventOut *ev)
+{
+    event_begin(ev, "perf");
+    event_obj(ev, "stages");
+    for (int s = 0; s < PERF_STAGE_COUNT; s++) {
+        const PerfHist *h = &ps->stage[s];
+        if (!h->count) continue;
+        event_obj(ev, perf_stage_name((PerfStage)s));
+        event_uint(ev, "n", h->count);
+        event_fixed(ev, "mean_us", (double)h->sum_ns / (double)h->count / 1e3, 2);
+        event_fixed(ev, "p50_us",  perf_hist_quantile(h, 0.50)  / 1e3, 2);
+        event_fixed(ev, "p90_us",  perf_hist_quantile(h, 0.90)  / 1e3, 2);
+        event_fixed(ev, "p99_us",  perf_hist_quantile(h, 0.99)  / 1e3, 2);
+        event_fixed(ev, "p999_us", perf_hist_quantile(h, 0.999) / 1e3, 2);
+        event_fixed(ev, "max_us",  h->max_ns / 1e3, 2);
+        event_close(ev);
+    }
+    event_close(ev);
+    event_end(ev);
+}
@@ -0,0 +1,235 @@
+/**
+ * @file perf_probe.h
+ * @brief Per-stage latency probes with constant-memory histograms.
+ *
+ * A frame passes a fixed set of stages on its way through a stream loop:
+ * it is received, framed and CRC-checked, decoded, fed to the sky
+ * accumulator and handed to its consumer (the capture recorder, stdout,
+ * the GUI thread).  The probes stamp a monotonic clock at those
+ * boundaries and add the time spent in each stage to a histogram of that
+ * stage, so a run can tell whether latency comes from framing, decoding,
+ * the sky update or delivery:
+ *
+ * @code
+ * perf_recv(&ps);                              // recv() returned
+ * rtcm_framer_commit(&framer, n);              // -> frame callback:
+ *
+ *     PerfFrame pf;
+ *     perf_frame_begin(&ps, &pf);              // FRAME: recv -> CRC ok
+ *     decode(...);
+ *     perf_frame_stage(&ps, &pf, PERF_STAGE_DECODE);
+ *     sky_collect_feed_msm(...);
+ *     perf_frame_stage(&ps, &pf, PERF_STAGE_SKY);
+ *     perf_frame_end(&ps, &pf);                // TOTAL: recv -> done
+ * @endcode
+ *
+ * Framing and the CRC check are one pass in the framer, so they share
+ * the FRAME stage.  Every frame completed by one recv() is timed from
+ * that recv(), so FRAME includes the time spent on the frames before it
+ * in the same read -- the latency the frame actually saw.
+ *
+ * Histograms are log-linear (HDR style): exact below 16 ns, then 16
+ * sub-buckets per power of two (about 6 % resolution) up to 2^38 ns
+ * (~275 s), in @ref PERF_HIST_BUCKETS counters whatever the run length.
+ * A PerfStream holds one per stage, about 13 kB.
+ *
+ * Probes are off until perf_enable() (CLI --perf; the GUI always turns
+ * them on).  Off, each probe is one load of a global and a branch.
+ * Built with -DNTRIP_NO_PERF_PROBES they compile to nothing.
+ *
+ * Threading: a histogram has one writer.  The GUI spreads the stages of
+ * one PerfStream over its I/O, decode and UI threads, each writing its
+ * own stages; readers (the Performance tab) read without a lock and may
+ * see a frame's counts a moment before its sum.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef PERF_PROBE_H
+#define PERF_PROBE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Sub-bucket bits per power of two (16 sub-buckets, ~6 %). */
+#define PERF_HIST_SUB_BITS  4
+
+/** @brief Counters per histogram: 16 exact + 16 per power of two to 2^38 ns. */
+#define PERF_HIST_BUCKETS   560
+
+/** @brief Stage boundaries a frame is timed at. */
+typedef enum {
+    PERF_STAGE_FRAME = 0,   /**< recv() returned -> CRC-valid frame delivered */
+    PERF_STAGE_QUEUE,       /**< Waiting in a hand-off queue (GUI decode thread) */
+    PERF_STAGE_DECODE,      /**< Message decode / analysis */
+    PERF_STAGE_SKY,         /**< Sky accumulator / propagation */
+    PERF_STAGE_OUTPUT,      /**< Handed to the consumer: recorder, stdout, GUI thread */
+    PERF_STAGE_TOTAL,       /**< recv() returned -> frame fully handled */
+    PERF_STAGE_COUNT
+} PerfStage;
+
+/**
+ * @struct PerfHist
+ * @brief One log-linear latency histogram (nanoseconds).
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;                    /**< valid when count > 0 */
+    uint64_t max_ns;
+    uint32_t bucket[PERF_HIST_BUCKETS];
+} PerfHist;
+
+/**
+ * @struct PerfStream
+ * @brief Stage histograms of one stream, plus the stamp of its last recv().
+ */
+typedef struct {
+    PerfHist stage[PERF_STAGE_COUNT];
+    uint64_t t_recv;                    /**< perf_now_ns() of the last recv(); 0 = none */
+} PerfStream;
+
+/** @brief One frame on its way through the stages (a local in the frame callback). */
+typedef struct {
+    uint64_t t_recv;                    /**< 0 = frame not timed */
+    uint64_t t_mark;                    /**< end of the previous stage */
+} PerfFrame;
+
+#ifdef NTRIP_NO_PERF_PROBES
+#define perf_probes_on  false
+#else
+/** @brief Set by perf_enable(); read by every probe. */
+extern bool perf_probes_on;
+#endif
+
+/** @brief Turn the probes on or off (no effect with NTRIP_NO_PERF_PROBES). */
+void perf_enable(bool on);
+
+/** @brief Monotonic clock in ns (QueryPerformanceCounter / CLOCK_MONOTONIC). */
+uint64_t perf_now_ns(void);
+
+/** @brief Bucket of a latency of @p ns. */
+static inline int perf_hist_index(uint64_t ns)
+{
+    if (ns < (1u << PERF_HIST_SUB_BITS)) return (int)ns;
+#if defined(__GNUC__)
+    int k = 63 - __builtin_clzll(ns);
+#else
+    int k = 0;
+    for (uint64_t v = ns; v >>= 1; ) k++;
+#endif
+    int idx = (k - PERF_HIST_SUB_BITS + 1) << PERF_HIST_SUB_BITS |
+              (int)((ns >> (k - PERF_HIST_SUB_BITS)) & ((1u << PERF_HIST_SUB_BITS) - 1));
+    return idx < PERF_HIST_BUCKETS ? idx : PERF_HIST_BUCKETS - 1;
+}
+
+/** @brief Add one sample of @p ns. */
+static inline void perf_hist_add(PerfHist *h, uint64_t ns)
+{
+    if (h->count == 0 || ns < h->min_ns) h->min_ns = ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    h->count++;
+    h->sum_ns += ns;
+    h->bucket[perf_hist_index(ns)]++;
+}
+
+/** @brief Stamp a recv() that returned data. */
+static inline void perf_recv(PerfStream *ps)
+{
+    if (perf_probes_on) ps->t_recv = perf_now_ns();
+}
+
+/**
+ * @brief A frame was delivered by the framer: record its FRAME stage.
+ *
+ * Without a perf_recv() stamp (a replay) only the later stages are timed.
+ */
+static inline void perf_frame_begin(PerfStream *ps, PerfFrame *f)
+{
+    f->t_recv = 0;
+    f->t_mark = 0;
+    if (!perf_probes_on) return;
+    f->t_recv = ps->t_recv;
+    f->t_mark = perf_now_ns();
+    if (f->t_recv)
+        perf_hist_add(&ps->stage[PERF_STAGE_FRAME], f->t_mark - f->t_recv);
+}
+
+/**
+ * @brief Start timing a frame taken from a hand-off queue, stamped
+ *        @p t_recv (0 = unknown) by the thread that received it.
+ */
+static inline void perf_frame_start_at(PerfFrame *f, uint64_t t_recv)
+{
+    if (!perf_probes_on) {
+        f->t_recv = 0;
+        f->t_mark = 0;
+        return;
+    }
+    f->t_recv = t_recv;
+    f->t_mark = perf_now_ns();
+}
+
+/** @brief The frame finished @p stage: record the time since the last mark. */
+static inline void perf_frame_stage(PerfStream *ps, PerfFrame *f, PerfStage stage)
+{
+    if (!perf_probes_on) return;
+    uint64_t now = perf_now_ns();
+    perf_hist_add(&ps->stage[stage], now - f->t_mark);
+    f->t_mark = now;
+}
+
+/** @brief The frame is fully handled: record TOTAL. */
+static inline void perf_frame_end(PerfStream *ps, PerfFrame *f)
+{
+    if (!perf_probes_on || f->t_recv == 0) return;
+    perf_hist_add(&ps->stage[PERF_STAGE_TOTAL], perf_now_ns() - f->t_recv);
+}
+
+/** @brief Clear every histogram of @p ps. */
+void perf_stream_reset(PerfStream *ps);
+
+/** @brief Add the samples of @p src to @p dst. */
+void perf_hist_merge(PerfHist *dst, const PerfHist *src);
+
+/**
+ * @brief Latency at quantile @p q (0 .. 1), in ns.
+ *
+ * The middle of the bucket holding the sample, clamped to the recorded
+ * min / max; 0 for an empty histogram.
+ */
+uint64_t perf_hist_quantile(const PerfHist *h, double q);
+
+/** @brief Short stage name: "frame", "queue", "decode", "sky", "output", "total". */
+const char *perf_stage_name(PerfStage stage);
+
+/** @brief true if any stage of @p ps has a sample. */
+bool perf_stream_any(const PerfStream *ps);
+
+/**
+ * @brief Print the stages that have samples as a table (µs): count,
+ *        mean, p50, p90, p99, p99.9 and max.
+ */
+void perf_print_table(const PerfStream *ps, const char *title, FILE *out);
+
+struct EventOut;   /* event_out.h */
+
+/**
+ * @brief Emit one --json event:
+ *        {"event":"perf","stages":{"frame":{"n":..,"mean_us":..,"p50_us":..,
+ *        "p90_us":..,"p99_us":..,"p999_us":..,"max_us":..},...}}
+ */
+void perf_print_event(const PerfStream *ps, struct EventOut *ev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_PROBE_H */
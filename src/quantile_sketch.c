@@ -0,0 +1,193 @@
+/**
+ * @file quantile_sketch.c
+ * @brief Mergeable constant-memory quantile sketch (DDSketch).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "quantile_sketch.h"
+#include "event_out.h"
+
+#include <math.h>
+#include <string.h>
+
+/* The first sample lands in the middle of the window, which can then
+ * move either way. */
+#define QSKETCH_LOW_ROOM  (QSKETCH_BINS / 2)
+
+static double qsketch_gamma(void)
+{
+    return (1.0 + QSKETCH_ALPHA) / (1.0 - QSKETCH_ALPHA);
+}
+
+/* Empty bins at the bottom / top of the window. */
+static int32_t qsketch_free_low(const QSketch *s)
+{
+    int32_t i = 0;
+    while (i < QSKETCH_BINS && !s->bin[i]) i++;
+    return i;
+}
+
+static int32_t qsketch_free_high(const QSketch *s)
+{
+    int32_t i = 0;
+    while (i < QSKETCH_BINS && !s->bin[QSKETCH_BINS - 1 - i]) i++;
+    return i;
+}
+
+/* Index of @p key in the window.  A key outside moves the window over
+ * empty bins only; what still does not fit goes to the end bin on its
+ * side, so an outlier never folds the body of the distribution. */
+static int32_t qsketch_index(QSketch *s, int32_t key)
+{
+    int32_t idx = key - s->key_lo;
+    if (idx >= QSKETCH_BINS) {
+        int32_t shift = idx - (QSKETCH_BINS - 1);
+        int32_t room  = qsketch_free_low(s);
+        if (shift > room) shift = room;
+        if (shift > 0) {
+            memmove(&s->bin[0], &s->bin[shift],
+                    (size_t)(QSKETCH_BINS - shift) * sizeof(s->bin[0]));
+            memset(&s->bin[QSKETCH_BINS - shift], 0, (size_t)shift * sizeof(s->bin[0]));
+            s->key_lo += shift;
+        }
+        idx = key - s->key_lo;
+        if (idx > QSKETCH_BINS - 1) idx = QSKETCH_BINS - 1;
+    } else if (idx < 0) {
+        int32_t shift = -idx;
+        int32_t room  = qsketch_free_high(s);
+        if (shift > room) shift = room;
+        if (shift > 0) {
+            memmove(&s->bin[shift], &s->bin[0],
+                    (size_t)(QSKETCH_BINS - shift) * sizeof(s->bin[0]));
+            memset(&s->bin[0], 0, (size_t)shift * sizeof(s->bin[0]));
+            s->key_lo -= shift;
+        }
+        idx = key - s->key_lo;
+        if (idx < 0) idx = 0;
+    }
+    return idx;
+}
+
+/* Add @p n samples of bin @p key; @p first: the sketch has no bins yet. */
+static void qsketch_add_key(QSketch *s, int32_t key, uint32_t n, bool first)
+{
+    if (first) s->key_lo = key - QSKETCH_LOW_ROOM;
+    s->bin[qsketch_index(s, key)] += n;
+}
+
+/* Samples in the bins (count > 0 and not zero). */
+static uint64_t qsketch_positive(const QSketch *s)
+{
+    return s->count - s->zero;
+}
+
+static void qsketch_minmax(QSketch *s, double lo, double hi)
+{
+    if (s->count == 0 || lo < s->min) s->min = lo;
+    if (s->count == 0 || hi > s->max) s->max = hi;
+}
+
+void qsketch_add(QSketch *s, double x)
+{
+    if (x > 0.0) {
+        int32_t key = (int32_t)ceil(log(x) / log(qsketch_gamma()));
+        qsketch_add_key(s, key, 1, qsketch_positive(s) == 0);
+    } else {
+        x = 0.0;
+        s->zero++;
+    }
+    qsketch_minmax(s, x, x);
+    s->count++;
+    s->sum += x;
+}
+
+void qsketch_merge(QSketch *dst, const QSketch *src)
+{
+    if (src->count == 0) return;
+    bool first = qsketch_positive(dst) == 0;
+    for (int i = 0; i < QSKETCH_BINS; i++) {
+        if (!src->bin[i]) continue;
+        qsketch_add_key(dst, src->key_lo + i, src->bin[i], first);
+        first = false;
+    }
+    qsketch_minmax(dst, src->min, src->max);
+    dst->count += src->count;
+    dst->zero  += src->zero;
+    dst->sum   += src->sum;
+}
+
+double qsketch_quantile(const QSketch *s, double q)
+{
+    if (s->count == 0) return 0.0;
+    if (q <= 0.0) return s->min;
+    if (q >= 1.0) return s->max;
+
+    double rank = q * (double)(s->count - 1);
+    uint64_t seen = s->zero;
+    if ((double)seen > rank) return 0.0;
+    const double gamma = qsketch_gamma();
+    for (int i = 0; i < QSKETCH_BINS; i++) {
+        seen += s->bin[i];
+        if ((double)seen > rank) {
+            /* Middle of bin (gamma^(k-1), gamma^k], relative to its edges */
+            double v = 2.0 * pow(gamma, (double)(s->key_lo + i)) / (gamma + 1.0);
+            if (v < s->min) v = s->min;
+            if (v > s->max) v = s->max;
+            return v;
+        }
+    }
+    return s->max;
+}
+
+double qsketch_mean(const QSketch *s)
+{
+    return s->count ? s->sum / (double)s->count : 0.0;
+}
+
+static const char qsketch_border[] =
+    "+-------------+---------+---------+---------+---------+---------+---------+---------+\n";
+
+void qsketch_print_head(const char *title, FILE *out)
+{
+    fprintf(out, "\n%s (s)\n", title);
+    fputs(qsketch_border, out);
+    fprintf(out, "| MessageType | Count   | Mean    | p50     | p95     | p99     | p99.9   | Max     |\n");
+    fputs(qsketch_border, out);
+}
+
+void qsketch_print_row(int msg_type, const QSketch *s, FILE *out)
+{
+    fprintf(out, "| %-11d | %7llu | %7.3f | %7.3f | %7.3f | %7.3f | %7.3f | %7.3f |\n",
+            msg_type, (unsigned long long)s->count, qsketch_mean(s),
+            qsketch_quantile(s, 0.50), qsketch_quantile(s, 0.95),
+            qsketch_quantile(s, 0.99), qsketch_quantile(s, 0.999), s->max);
+}
+
+void qsketch_print_foot(FILE *out)
+{
+    fputs(qsketch_border, out);
+}
+
+void qsketch_to_event(const QSketch *s, EventOut *ev, const char *key)
+{
+    event_obj(ev, key);
+    event_uint(ev, "n", s->count);
+    event_uint(ev, "z", s->zero);
+    event_num(ev, "min", s->min);
+    event_num(ev, "max", s->max);
+    event_num(ev, "sum", s->sum);
+    event_int(ev, "lo", s->key_lo);
+    event_arr(ev, "bins");
+    for (int i = 0; i < QSKETCH_BINS; i++) {
+        if (!s->bin[i]) continue;
+        event_arr(ev, NULL);
+        event_int(ev, NULL, i);
+        event_uint(ev, NULL, s->bin[i]);
+        event_close(ev);
+    }
+    event_close(ev);
+    event_close(ev);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file quantile_sketch.h
+ * @brief Mergeable constant-memory quantile sketch (DDSketch).
+ *
+ * Min / max / mean describe a message interval badly: one stall hides in
+ * the max and a jittery stream looks fine on average.  A QSketch keeps
+ * the distribution of a stream of positive values in a fixed number of
+ * logarithmic bins, so p50 / p95 / p99 / p99.9 can be read at any time
+ * and sketches of several streams or files can be merged exactly:
+ *
+ *   - value x > 0 goes to bin ceil(log_gamma(x)), gamma = (1 + a) / (1 - a)
+ *     with a = @ref QSKETCH_ALPHA: every quantile read back lies within
+ *     2 % (relative) of a value the stream actually had
+ *   - @ref QSKETCH_BINS consecutive bins (a dynamic range of ~28000x,
+ *     e.g. 1 ms .. 28 s) centred on the first value; a value outside
+ *     moves the window only as far as the bins it leaves behind are
+ *     empty.  What then still does not fit is counted in the end bin on
+ *     its side: a stall far above the body of the distribution lands in
+ *     the top bin (max keeps its exact value), and p50 .. p99.9 stay
+ *     within 2 % as long as the body itself spans less than the window
+ *   - values <= 0 are counted apart (as 0)
+ *
+ * The storage is inline and never reallocated: a sketch is a plain
+ * struct (~1 KB) that can be memset, copied, merged and read by
+ * another thread without a lock (a reader may see a sample's count
+ * before its bin, like PerfHist).
+ *
+ * qsketch_to_event() carries a sketch between processes: batch mode
+ * rebuilds the sketch of every replayed file from its summary line and
+ * merges them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Relative accuracy of a quantile. */
+#define QSKETCH_ALPHA  0.02
+
+/** @brief Logarithmic bins per sketch (at most 256: fleet_push.h sends
+ *         a bin index as one byte). */
+#define QSKETCH_BINS   256
+
+/**
+ * @struct QSketch
+ * @brief Distribution of a stream of values; zero-initialised = empty.
+ */
+typedef struct {
+    uint64_t count;                 /**< all samples, including @c zero */
+    uint64_t zero;                  /**< samples <= 0 */
+    double   min;                   /**< valid when count > 0 */
+    double   max;
+    double   sum;
+    int32_t  key_lo;                /**< key of bin[0]; set by the first positive sample */
+    uint32_t bin[QSKETCH_BINS];
+} QSketch;
+
+/** @brief Add one sample. */
+void qsketch_add(QSketch *s, double x);
+
+/** @brief Add the samples of @p src to @p dst. */
+void qsketch_merge(QSketch *dst, const QSketch *src);
+
+/**
+ * @brief Value at quantile @p q (0 .. 1), clamped to the recorded
+ *        min / max; 0 for an empty sketch.
+ */
+double qsketch_quantile(const QSketch *s, double q);
+
+/** @brief Mean of the samples; 0 for an empty sketch. */
+double qsketch_mean(const QSketch *s);
+
+/** @brief Print the head of a per-type interval table (s): count, mean, p50,
+ *         p95, p99, p99.9 and max. */
+void qsketch_print_head(const char *title, FILE *out);
+
+/** @brief One row of the table started by qsketch_print_head(). */
+void qsketch_print_row(int msg_type, const QSketch *s, FILE *out);
+
+/** @brief Close the table started by qsketch_print_head(). */
+void qsketch_print_foot(FILE *out);
+
+struct EventOut;   /* event_out.h */
+
+/**
+ * @brief Add @p s to the event being built as field @p key (NULL inside
+ *        an array), an object
+ *        {"n":..,"z":..,"min":..,"max":..,"sum":..,"lo":..,"bins":[[i,c],...]}
+ *        (only the bins that have counts).
+ */
+void qsketch_to_event(const QSketch *s, struct EventOut *ev, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUANTILE_SKETCH_H */
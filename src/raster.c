@@ -0,0 +1,1027 @@
+/**
+ * @file raster.c
+ * @brief Portable software rasteriser (spans, lines, 5x7 font atlas) and
+ *        PNG writer, shared by sky_render.c and the GUI.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void crc_init(void);
+static void dz_tables_init(void);
+
+/* ── Spans ──────────────────────────────────────────────────────────── */
+
+/* Rows lo .. hi - 1 are in px. */
+static int rows_lo(const RasterImage *img)
+{
+    return img->band_h > 0 ? img->band_y0 : 0;
+}
+
+static int rows_hi(const RasterImage *img)
+{
+    return img->band_h > 0 ? img->band_y0 + img->band_h : img->h;
+}
+
+uint32_t *raster_row(const RasterImage *img, int y)
+{
+    int lo = rows_lo(img);
+    if (y < lo || y >= rows_hi(img) || y >= img->h) return NULL;
+    return img->px + (size_t)(y - lo) * img->stride;
+}
+
+void raster_put(RasterImage *img, int x, int y, uint32_t c)
+{
+    if (x < 0 || x >= img->w) return;
+    uint32_t *p = raster_row(img, y);
+    if (p) p[x] = c;
+}
+
+void raster_span(RasterImage *img, int y, int x0, int x1, uint32_t c)
+{
+    uint32_t *p = raster_row(img, y);
+    if (!p) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= img->w) x1 = img->w - 1;
+    for (int x = x0; x <= x1; x++) p[x] = c;
+}
+
+void raster_fill_rect(RasterImage *img, int x0, int y0, int x1, int y1, uint32_t c)
+{
+    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
+    if (y0 > y1) { int t = y0; y0 = y1; y1 = t; }
+    if (y0 < rows_lo(img)) y0 = rows_lo(img);
+    if (y1 >= rows_hi(img)) y1 = rows_hi(img) - 1;
+    for (int y = y0; y <= y1; y++) raster_span(img, y, x0, x1, c);
+}
+
+void raster_fill(RasterImage *img, uint32_t c)
+{
+    raster_fill_rect(img, 0, 0, img->w - 1, img->h - 1, c);
+}
+
+void raster_line(RasterImage *img, int x0, int y0, int x1, int y1, uint32_t c)
+{
+    /* Axis-parallel lines (frames, outlines) are one span or a column */
+    if (y0 == y1) {
+        raster_span(img, y0, x0 < x1 ? x0 : x1, x0 < x1 ? x1 : x0, c);
+        return;
+    }
+    int dx =  abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+    int err = dx + dy;
+    for (;;) {
+        raster_put(img, x0, y0, c);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+void raster_circle(RasterImage *img, int cx, int cy, int radius, uint32_t c)
+{
+    int x = radius, y = 0;
+    int err = 1 - radius;
+    while (x >= y) {
+        raster_put(img, cx + x, cy + y, c);
+        raster_put(img, cx + y, cy + x, c);
+        raster_put(img, cx - y, cy + x, c);
+        raster_put(img, cx - x, cy + y, c);
+        raster_put(img, cx - x, cy - y, c);
+        raster_put(img, cx - y, cy - x, c);
+        raster_put(img, cx + y, cy - x, c);
+        raster_put(img, cx + x, cy - y, c);
+        y++;
+        if (err < 0) err += 2 * y + 1;
+        else        { x--; err += 2 * (y - x) + 1; }
+    }
+}
+
+/* ── 5x7 bitmap font (subset of printable ASCII) ────────────────────────
+ * Each glyph: 7 bytes, one per row.  Bits 4..0 hold the 5 columns left-
+ * to-right.  Missing chars render as a blank space. */
+typedef struct { char c; uint8_t rows[7]; } Glyph;
+
+static const Glyph g_font[] = {
+    {' ', {0x00,0x00,0x00,0x00,0x00,0x00,0x00}},
+    {'!', {0x04,0x04,0x04,0x04,0x00,0x00,0x04}},
+    {'(', {0x02,0x04,0x08,0x08,0x08,0x04,0x02}},
+    {')', {0x08,0x04,0x02,0x02,0x02,0x04,0x08}},
+    {'+', {0x00,0x04,0x04,0x1F,0x04,0x04,0x00}},
+    {',', {0x00,0x00,0x00,0x00,0x00,0x04,0x08}},
+    {'-', {0x00,0x00,0x00,0x1F,0x00,0x00,0x00}},
+    {'.', {0x00,0x00,0x00,0x00,0x00,0x00,0x04}},
+    {'/', {0x01,0x02,0x02,0x04,0x08,0x08,0x10}},
+    {'0', {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}},
+    {'1', {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E}},
+    {'2', {0x0E,0x11,0x01,0x06,0x08,0x10,0x1F}},
+    {'3', {0x0E,0x11,0x01,0x06,0x01,0x11,0x0E}},
+    {'4', {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}},
+    {'5', {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E}},
+    {'6', {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}},
+    {'7', {0x1F,0x01,0x02,0x04,0x08,0x08,0x08}},
+    {'8', {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}},
+    {'9', {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C}},
+    {':', {0x00,0x04,0x00,0x00,0x00,0x04,0x00}},
+    {'A', {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}},
+    {'B', {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E}},
+    {'C', {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}},
+    {'D', {0x1E,0x11,0x11,0x11,0x11,0x11,0x1E}},
+    {'E', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}},
+    {'F', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10}},
+    {'G', {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}},
+    {'H', {0x11,0x11,0x11,0x1F,0x11,0x11,0x11}},
+    {'I', {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}},
+    {'J', {0x07,0x02,0x02,0x02,0x02,0x12,0x0C}},
+    {'K', {0x11,0x12,0x14,0x18,0x14,0x12,0x11}},
+    {'L', {0x10,0x10,0x10,0x10,0x10,0x10,0x1F}},
+    {'M', {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}},
+    {'N', {0x11,0x11,0x19,0x15,0x13,0x11,0x11}},
+    {'O', {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}},
+    {'P', {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10}},
+    {'Q', {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}},
+    {'R', {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11}},
+    {'S', {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}},
+    {'T', {0x1F,0x04,0x04,0x04,0x04,0x04,0x04}},
+    {'U', {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}},
+    {'V', {0x11,0x11,0x11,0x11,0x11,0x0A,0x04}},
+    {'W', {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}},
+    {'X', {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11}},
+    {'Y', {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}},
+    {'Z', {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F}},
+};
+
+/* The atlas: per character code, per row, the runs of set columns as
+ * (first column, width).  A 5-bit row holds at most three runs.  Built
+ * once from g_font, so drawing a glyph is a table index and a few spans
+ * instead of a search and 35 bit tests. */
+typedef struct {
+    uint8_t n[RASTER_GLYPH_H];
+    uint8_t x[RASTER_GLYPH_H][3];
+    uint8_t len[RASTER_GLYPH_H][3];
+} AtlasGlyph;
+
+static AtlasGlyph g_atlas[128];
+static int        g_atlas_init = 0;
+
+static void atlas_init(void)
+{
+    if (g_atlas_init) return;
+    memset(g_atlas, 0, sizeof(g_atlas));
+    const int n_font = (int)(sizeof(g_font) / sizeof(g_font[0]));
+    for (int i = 0; i < n_font; i++) {
+        AtlasGlyph *a = &g_atlas[(unsigned char)g_font[i].c & 0x7F];
+        for (int row = 0; row < RASTER_GLYPH_H; row++) {
+            uint8_t bits = g_font[i].rows[row];
+            for (int col = 0; col < 5; col++) {
+                if (!(bits & (1 << (4 - col)))) continue;
+                int k = a->n[row];
+                if (k && a->x[row][k - 1] + a->len[row][k - 1] == col) {
+                    a->len[row][k - 1]++;
+                } else {
+                    a->x[row][k]   = (uint8_t)col;
+                    a->len[row][k] = 1;
+                    a->n[row]++;
+                }
+            }
+        }
+    }
+    /* Lower case as upper case */
+    for (int c = 'a'; c <= 'z'; c++) g_atlas[c] = g_atlas[c - 'a' + 'A'];
+    g_atlas_init = 1;
+}
+
+void raster_init(void)
+{
+    atlas_init();
+    crc_init();
+    dz_tables_init();
+}
+
+int raster_text(RasterImage *img, int x, int y, const char *s, uint32_t c)
+{
+    if (!s) return x;
+    atlas_init();
+    for (; *s; s++, x += RASTER_GLYPH_W) {
+        if ((unsigned char)*s >= 0x80) continue;
+        const AtlasGlyph *a = &g_atlas[(unsigned char)*s];
+        for (int row = 0; row < RASTER_GLYPH_H; row++)
+            for (int k = 0; k < a->n[row]; k++)
+                raster_span(img, y + row, x + a->x[row][k],
+                            x + a->x[row][k] + a->len[row][k] - 1, c);
+    }
+    return x;
+}
+
+int raster_text_width(const char *s)
+{
+    return s ? RASTER_GLYPH_W * (int)strlen(s) : 0;
+}
+
+int raster_text_right(RasterImage *img, int xr, int y, const char *s, uint32_t c)
+{
+    int x = xr - raster_text_width(s);
+    raster_text(img, x, y, s, c);
+    return x;
+}
+
+/* ─────────────────────────────────────────────────────────────────────
+ * Minimal PNG writer — no external dependencies.
+ *
+ * Rows are filtered one at a time (None / Sub / Up / Average / Paeth,
+ * whichever gives the smallest sum of absolute residuals) and streamed
+ * into a small DEFLATE encoder: greedy LZ77 over a 32 KB window with hash
+ * chains, then per block the cheaper of fixed and dynamic Huffman codes.
+ * Compressed bytes go out as a sequence of 64 KB IDAT chunks, so besides
+ * the image itself only two unpacked rows, one filtered row, the LZ77
+ * window and one output chunk are in memory.  The flat heatmap colours compress by well over
+ * an order of magnitude.  raster_png_write_rows() takes the image a band
+ * at a time, so not even all of that has to exist at once.
+ * ───────────────────────────────────────────────────────────────────── */
+
+static uint32_t g_crc_table[256];
+static int      g_crc_init = 0;
+
+static void crc_init(void)
+{
+    if (g_crc_init) return;
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+        g_crc_table[n] = c;
+    }
+    g_crc_init = 1;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    crc_init();
+    crc ^= 0xFFFFFFFFU;
+    for (size_t i = 0; i < len; i++)
+        crc = g_crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static void write_be32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16),
+                     (uint8_t)(v >> 8),  (uint8_t)(v) };
+    fwrite(b, 1, 4, f);
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+{
+    write_be32(f, len);
+    fwrite(type, 1, 4, f);
+    if (len) fwrite(data, 1, len, f);
+
+    /* CRC over type + data; crc32_update() chains across calls. */
+    uint32_t c = crc32_update(0, (const uint8_t *)type, 4);
+    if (len) c = crc32_update(c, data, len);
+    write_be32(f, c);
+}
+
+/* ── DEFLATE encoder (RFC 1950 zlib wrapper around RFC 1951) ────────── */
+/* NTRIP_SMALL_FOOTPRINT: an 8 KB window and smaller tables, about 110 KB
+ * of encoder state instead of 460 KB, for somewhat larger files. */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define DZ_WSIZE      8192
+#else
+#define DZ_WSIZE      32768
+#endif
+#define DZ_WMASK      (DZ_WSIZE - 1)
+#define DZ_MIN_MATCH  3
+#define DZ_MAX_MATCH  258
+#define DZ_LOOKAHEAD  (DZ_MAX_MATCH + DZ_MIN_MATCH + 1)
+#define DZ_MAX_DIST   (DZ_WSIZE - DZ_LOOKAHEAD)
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define DZ_HASH_BITS  13
+#define DZ_MAX_TOKENS 4096    /* LZ77 tokens per Huffman block */
+#define DZ_OUT_CHUNK  16384   /* IDAT chunk payload size */
+#else
+#define DZ_HASH_BITS  15
+#define DZ_MAX_TOKENS 16384
+#define DZ_OUT_CHUNK  65536
+#endif
+#define DZ_HASH_SIZE  (1 << DZ_HASH_BITS)
+#define DZ_CHAIN      32      /* hash-chain steps per match search */
+#define DZ_NICE       128     /* stop searching once a match is this long */
+
+#define DZ_N_LIT  286
+#define DZ_N_DIST 30
+#define DZ_N_CL   19
+
+static const uint16_t dz_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t dz_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dz_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t dz_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t dz_cl_order[DZ_N_CL] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* Length (3..258) -> length code index 0..28, distance-1 -> code 0..29. */
+static uint8_t g_dz_len_code[DZ_MAX_MATCH + 1];
+static uint8_t g_dz_dist_code[DZ_WSIZE];
+static int     g_dz_init = 0;
+
+static void dz_tables_init(void)
+{
+    if (g_dz_init) return;
+    for (int c = 0; c < 29; c++) {
+        int n = 1 << dz_len_extra[c];
+        for (int i = 0; i < n && dz_len_base[c] + i <= DZ_MAX_MATCH; i++)
+            g_dz_len_code[dz_len_base[c] + i] = (uint8_t)c;
+    }
+    g_dz_len_code[DZ_MAX_MATCH] = 28;
+    for (int c = 0; c < 30; c++) {
+        int n = 1 << dz_dist_extra[c];
+        for (int i = 0; i < n && dz_dist_base[c] - 1 + i < DZ_WSIZE; i++)
+            g_dz_dist_code[dz_dist_base[c] - 1 + i] = (uint8_t)c;
+    }
+    g_dz_init = 1;
+}
+
+typedef struct {
+    FILE    *f;
+
+    /* Output: IDAT payload being filled, LSB-first bit accumulator. */
+    uint8_t  out[DZ_OUT_CHUNK];
+    size_t   out_n;
+    uint32_t bits;
+    int      nbits;
+
+    /* LZ77 window: history before strstart, lookahead bytes after it.
+     * head / prev hold window positions (-1 = none). */
+    uint8_t  win[2 * DZ_WSIZE];
+    int      strstart;
+    int      lookahead;
+    int32_t  head[DZ_HASH_SIZE];
+    int32_t  prev[DZ_WSIZE];
+
+    /* Tokens of the current block: tok_dist == 0 means tok_lit is a
+     * literal byte, else tok_lit is the match length. */
+    uint16_t tok_lit[DZ_MAX_TOKENS];
+    uint16_t tok_dist[DZ_MAX_TOKENS];
+    int      n_tok;
+
+    uint32_t adler_a, adler_b;
+} Deflater;
+
+static void dz_out_byte(Deflater *d, uint8_t b)
+{
+    d->out[d->out_n++] = b;
+    if (d->out_n == DZ_OUT_CHUNK) {
+        write_chunk(d->f, "IDAT", d->out, (uint32_t)d->out_n);
+        d->out_n = 0;
+    }
+}
+
+static void dz_put_bits(Deflater *d, uint32_t v, int n)
+{
+    d->bits |= v << d->nbits;
+    d->nbits += n;
+    while (d->nbits >= 8) {
+        dz_out_byte(d, (uint8_t)d->bits);
+        d->bits >>= 8;
+        d->nbits -= 8;
+    }
+}
+
+static void dz_align(Deflater *d)
+{
+    if (d->nbits > 0) dz_out_byte(d, (uint8_t)d->bits);
+    d->bits  = 0;
+    d->nbits = 0;
+}
+
+/* Huffman code lengths for @p n symbols, limited to @p max_bits.  Unused
+ * symbols get length 0; a lone used symbol gets length 1. */
+static void huff_lengths(const uint32_t *freq, int n, int max_bits, uint8_t *len)
+{
+    int      sym[DZ_N_LIT], parent[2 * DZ_N_LIT];
+    uint32_t w[2 * DZ_N_LIT];
+    uint8_t  depth[2 * DZ_N_LIT];
+    int m = 0;
+
+    memset(len, 0, (size_t)n);
+    for (int i = 0; i < n; i++)
+        if (freq[i]) sym[m++] = i;
+    if (m == 0) return;
+    if (m == 1) { len[sym[0]] = 1; return; }
+
+    /* Leaves sorted by weight (insertion sort: n <= 286). */
+    for (int i = 1; i < m; i++) {
+        int s = sym[i], j = i;
+        while (j > 0 && freq[sym[j - 1]] > freq[s]) { sym[j] = sym[j - 1]; j--; }
+        sym[j] = s;
+    }
+    for (int i = 0; i < m; i++) w[i] = freq[sym[i]];
+
+    /* Two-queue construction: leaves 0..m-1, internal nodes m..2m-2 are
+     * created in non-decreasing weight order, so parents always have a
+     * higher index than their children. */
+    int li = 0, ni = m;
+    for (int k = m; k < 2 * m - 1; k++) {
+        int pick[2];
+        for (int t = 0; t < 2; t++) {
+            if (li < m && (ni >= k || w[li] <= w[ni])) pick[t] = li++;
+            else                                        pick[t] = ni++;
+        }
+        w[k] = w[pick[0]] + w[pick[1]];
+        parent[pick[0]] = parent[pick[1]] = k;
+    }
+    depth[2 * m - 2] = 0;
+    for (int k = 2 * m - 3; k >= 0; k--)
+        depth[k] = (uint8_t)(depth[parent[k]] + 1);
+
+    int over = 0;
+    for (int i = 0; i < m; i++) {
+        int l = depth[i];
+        if (l > max_bits) { l = max_bits; over = 1; }
+        len[sym[i]] = (uint8_t)l;
+    }
+    if (!over) return;
+
+    /* Clamping broke the Kraft inequality: lengthen the deepest codes
+     * that are still below the limit until it holds again. */
+    uint32_t kraft = 0, full = 1U << max_bits;
+    for (int i = 0; i < m; i++) kraft += 1U << (max_bits - len[sym[i]]);
+    while (kraft > full) {
+        int best = -1;
+        for (int i = 0; i < m; i++) {
+            int l = len[sym[i]];
+            if (l < max_bits && (best < 0 || l > len[sym[best]])) best = i;
+        }
+        kraft -= 1U << (max_bits - len[sym[best]] - 1);
+        len[sym[best]]++;
+    }
+
+    /* That may overshoot; inflaters reject incomplete codes, so shorten
+     * the longest codes again.  The deficit is always a multiple of the
+     * longest code's weight, so this ends exactly at a complete code. */
+    while (kraft < full) {
+        int best = -1;
+        for (int i = 0; i < m; i++)
+            if (best < 0 || len[sym[i]] > len[sym[best]]) best = i;
+        kraft += 1U << (max_bits - len[sym[best]]);
+        len[sym[best]]--;
+    }
+}
+
+/* Canonical codes for @p len, bit-reversed for the LSB-first stream. */
+static void huff_codes(const uint8_t *len, int n, uint16_t *code)
+{
+    uint16_t count[16] = {0}, next[16];
+    for (int i = 0; i < n; i++) count[len[i]]++;
+    count[0] = 0;
+    uint16_t c = 0;
+    for (int b = 1; b < 16; b++) {
+        c = (uint16_t)((c + count[b - 1]) << 1);
+        next[b] = c;
+    }
+    for (int i = 0; i < n; i++) {
+        int l = len[i];
+        if (!l) { code[i] = 0; continue; }
+        uint16_t v = next[l]++, r = 0;
+        for (int b = 0; b < l; b++) { r = (uint16_t)((r << 1) | (v & 1)); v >>= 1; }
+        code[i] = r;
+    }
+}
+
+/* Emit the tokens collected so far as one block. */
+static void dz_flush_block(Deflater *d, bool last)
+{
+    uint32_t lf[DZ_N_LIT] = {0}, df[DZ_N_DIST] = {0};
+    uint32_t extra_bits = 0;
+    for (int i = 0; i < d->n_tok; i++) {
+        if (d->tok_dist[i] == 0) {
+            lf[d->tok_lit[i]]++;
+        } else {
+            int lc = g_dz_len_code[d->tok_lit[i]];
+            int dc = g_dz_dist_code[d->tok_dist[i] - 1];
+            lf[257 + lc]++;
+            df[dc]++;
+            extra_bits += dz_len_extra[lc] + dz_dist_extra[dc];
+        }
+    }
+    lf[256] = 1;
+
+    /* Fixed code lengths (RFC 1951 3.2.6). */
+    uint8_t fl[DZ_N_LIT], fd[DZ_N_DIST];
+    for (int i = 0; i < DZ_N_LIT; i++)
+        fl[i] = (uint8_t)(i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+    memset(fd, 5, sizeof(fd));
+
+    /* Dynamic code lengths.  Inflaters want at least two lit/len codes
+     * and one distance code. */
+    uint32_t lf2[DZ_N_LIT], df2[DZ_N_DIST];
+    memcpy(lf2, lf, sizeof(lf2));
+    memcpy(df2, df, sizeof(df2));
+    if (d->n_tok == 0) lf2[0] = 1;
+    int n_dist_used = 0;
+    for (int i = 0; i < DZ_N_DIST; i++) n_dist_used += df2[i] != 0;
+    if (n_dist_used == 0) df2[0] = 1;
+    uint8_t dl[DZ_N_LIT], dd[DZ_N_DIST];
+    huff_lengths(lf2, DZ_N_LIT, 15, dl);
+    huff_lengths(df2, DZ_N_DIST, 15, dd);
+
+    int hlit = DZ_N_LIT, hdist = DZ_N_DIST;
+    while (hlit > 257 && dl[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && dd[hdist - 1] == 0) hdist--;
+
+    /* Run-length code the concatenated lengths (symbols 16/17/18). */
+    uint8_t seq[DZ_N_LIT + DZ_N_DIST];
+    int n_seq = 0;
+    for (int i = 0; i < hlit; i++)  seq[n_seq++] = dl[i];
+    for (int i = 0; i < hdist; i++) seq[n_seq++] = dd[i];
+
+    uint8_t cl_sym[DZ_N_LIT + DZ_N_DIST], cl_ext[DZ_N_LIT + DZ_N_DIST];
+    int n_cl = 0;
+    for (int i = 0; i < n_seq; ) {
+        int v = seq[i], run = 1;
+        while (i + run < n_seq && seq[i + run] == v) run++;
+        i += run;
+        if (v == 0) {
+            while (run >= 11) {
+                int r = run > 138 ? 138 : run;
+                cl_sym[n_cl] = 18; cl_ext[n_cl++] = (uint8_t)(r - 11); run -= r;
+            }
+            if (run >= 3) {
+                cl_sym[n_cl] = 17; cl_ext[n_cl++] = (uint8_t)(run - 3); run = 0;
+            }
+        } else {
+            cl_sym[n_cl] = (uint8_t)v; cl_ext[n_cl++] = 0; run--;
+            while (run >= 3) {
+                int r = run > 6 ? 6 : run;
+                cl_sym[n_cl] = 16; cl_ext[n_cl++] = (uint8_t)(r - 3); run -= r;
+            }
+        }
+        while (run-- > 0) { cl_sym[n_cl] = (uint8_t)v; cl_ext[n_cl++] = 0; }
+    }
+
+    uint32_t cf[DZ_N_CL] = {0};
+    for (int i = 0; i < n_cl; i++) cf[cl_sym[i]]++;
+    int n_cf_used = 0;
+    for (int i = 0; i < DZ_N_CL; i++) n_cf_used += cf[i] != 0;
+    if (n_cf_used < 2) cf[cf[0] ? 1 : 0]++;
+    uint8_t cll[DZ_N_CL];
+    huff_lengths(cf, DZ_N_CL, 7, cll);
+    int hclen = DZ_N_CL;
+    while (hclen > 4 && cll[dz_cl_order[hclen - 1]] == 0) hclen--;
+
+    /* Pick the cheaper encoding. */
+    uint64_t cost_fixed = 3 + extra_bits, cost_dyn = 3 + extra_bits + 14 + 3 * (uint64_t)hclen;
+    for (int i = 0; i < DZ_N_LIT; i++) {
+        cost_fixed += (uint64_t)lf[i] * fl[i];
+        cost_dyn   += (uint64_t)lf[i] * dl[i];
+    }
+    for (int i = 0; i < DZ_N_DIST; i++) {
+        cost_fixed += (uint64_t)df[i] * fd[i];
+        cost_dyn   += (uint64_t)df[i] * dd[i];
+    }
+    for (int i = 0; i < n_cl; i++)
+        cost_dyn += cll[cl_sym[i]] +
+                    (cl_sym[i] == 16 ? 2 : cl_sym[i] == 17 ? 3 : cl_sym[i] == 18 ? 7 : 0);
+
+    const uint8_t *ll, *dlen;
+    if (cost_dyn < cost_fixed) {
+        dz_put_bits(d, (last ? 1u : 0u) | (2u << 1), 3);
+        dz_put_bits(d, (uint32_t)(hlit - 257), 5);
+        dz_put_bits(d, (uint32_t)(hdist - 1), 5);
+        dz_put_bits(d, (uint32_t)(hclen - 4), 4);
+        for (int i = 0; i < hclen; i++)
+            dz_put_bits(d, cll[dz_cl_order[i]], 3);
+        uint16_t clc[DZ_N_CL];
+        huff_codes(cll, DZ_N_CL, clc);
+        for (int i = 0; i < n_cl; i++) {
+            int s = cl_sym[i];
+            dz_put_bits(d, clc[s], cll[s]);
+            if (s == 16) dz_put_bits(d, cl_ext[i], 2);
+            else if (s == 17) dz_put_bits(d, cl_ext[i], 3);
+            else if (s == 18) dz_put_bits(d, cl_ext[i], 7);
+        }
+        ll = dl; dlen = dd;
+    } else {
+        dz_put_bits(d, (last ? 1u : 0u) | (1u << 1), 3);
+        ll = fl; dlen = fd;
+    }
+
+    uint16_t lc[DZ_N_LIT], dc[DZ_N_DIST];
+    huff_codes(ll, DZ_N_LIT, lc);
+    huff_codes(dlen, DZ_N_DIST, dc);
+    for (int i = 0; i < d->n_tok; i++) {
+        if (d->tok_dist[i] == 0) {
+            int s = d->tok_lit[i];
+            dz_put_bits(d, lc[s], ll[s]);
+        } else {
+            int len  = d->tok_lit[i];
+            int dist = d->tok_dist[i];
+            int c  = g_dz_len_code[len];
+            int dcd = g_dz_dist_code[dist - 1];
+            dz_put_bits(d, lc[257 + c], ll[257 + c]);
+            if (dz_len_extra[c])
+                dz_put_bits(d, (uint32_t)(len - dz_len_base[c]), dz_len_extra[c]);
+            dz_put_bits(d, dc[dcd], dlen[dcd]);
+            if (dz_dist_extra[dcd])
+                dz_put_bits(d, (uint32_t)(dist - dz_dist_base[dcd]), dz_dist_extra[dcd]);
+        }
+    }
+    dz_put_bits(d, lc[256], ll[256]);
+    d->n_tok = 0;
+}
+
+static void dz_token(Deflater *d, int lit_or_len, int dist)
+{
+    d->tok_lit[d->n_tok]  = (uint16_t)lit_or_len;
+    d->tok_dist[d->n_tok] = (uint16_t)dist;
+    if (++d->n_tok == DZ_MAX_TOKENS) dz_flush_block(d, false);
+}
+
+static unsigned dz_hash(const uint8_t *p)
+{
+    return (((unsigned)p[0] << 10) ^ ((unsigned)p[1] << 5) ^ p[2]) & (DZ_HASH_SIZE - 1);
+}
+
+static void dz_insert(Deflater *d, int pos)
+{
+    unsigned h = dz_hash(d->win + pos);
+    d->prev[pos & DZ_WMASK] = d->head[h];
+    d->head[h] = pos;
+}
+
+/* Greedy LZ77 over the lookahead.  Without @p flush, stop while a full
+ * maximum-length match could still be cut short by missing input. */
+static void dz_compress(Deflater *d, bool flush)
+{
+    while (d->lookahead >= (flush ? 1 : DZ_LOOKAHEAD)) {
+        int pos = d->strstart;
+        int best_len = 0, best_dist = 0;
+
+        if (d->lookahead >= DZ_MIN_MATCH) {
+            int max_len = d->lookahead < DZ_MAX_MATCH ? d->lookahead : DZ_MAX_MATCH;
+            const uint8_t *s = d->win + pos;
+            int cur = d->head[dz_hash(s)];
+            for (int chain = DZ_CHAIN; cur >= 0 && chain > 0; chain--) {
+                int dist = pos - cur;
+                if (dist > DZ_MAX_DIST) break;
+                const uint8_t *m = d->win + cur;
+                if (m[best_len] == s[best_len] && m[0] == s[0]) {
+                    int l = 0;
+                    while (l < max_len && m[l] == s[l]) l++;
+                    if (l > best_len) {
+                        best_len  = l;
+                        best_dist = dist;
+                        if (l >= DZ_NICE || l == max_len) break;
+                    }
+                }
+                int nxt = d->prev[cur & DZ_WMASK];
+                if (nxt >= cur) break;
+                cur = nxt;
+            }
+            dz_insert(d, pos);
+        }
+
+        if (best_len >= DZ_MIN_MATCH) {
+            dz_token(d, best_len, best_dist);
+            for (int i = 1; i < best_len; i++)
+                if (d->lookahead - i >= DZ_MIN_MATCH) dz_insert(d, pos + i);
+            d->strstart  += best_len;
+            d->lookahead -= best_len;
+        } else {
+            dz_token(d, d->win[pos], 0);
+            d->strstart++;
+            d->lookahead--;
+        }
+    }
+}
+
+/* Drop the older half of the window once the buffer is full. */
+static void dz_slide(Deflater *d)
+{
+    memmove(d->win, d->win + DZ_WSIZE, DZ_WSIZE);
+    d->strstart -= DZ_WSIZE;
+    for (int i = 0; i < DZ_HASH_SIZE; i++)
+        d->head[i] = d->head[i] >= DZ_WSIZE ? d->head[i] - DZ_WSIZE : -1;
+    for (int i = 0; i < DZ_WSIZE; i++)
+        d->prev[i] = d->prev[i] >= DZ_WSIZE ? d->prev[i] - DZ_WSIZE : -1;
+}
+
+static void dz_write(Deflater *d, const uint8_t *data, size_t len)
+{
+    /* Adler-32 of the uncompressed stream; 5552 bytes is the longest
+     * run before the sums can overflow 32 bits. */
+    const uint8_t *p = data;
+    size_t n = len;
+    while (n > 0) {
+        size_t k = n < 5552 ? n : 5552;
+        for (size_t i = 0; i < k; i++) {
+            d->adler_a += p[i];
+            d->adler_b += d->adler_a;
+        }
+        d->adler_a %= 65521;
+        d->adler_b %= 65521;
+        p += k;
+        n -= k;
+    }
+
+    while (len > 0) {
+        int end = d->strstart + d->lookahead;
+        if (end == 2 * DZ_WSIZE) {
+            dz_slide(d);
+            end -= DZ_WSIZE;
+        }
+        size_t k = (size_t)(2 * DZ_WSIZE - end);
+        if (k > len) k = len;
+        memcpy(d->win + end, data, k);
+        d->lookahead += (int)k;
+        data += k;
+        len  -= k;
+        dz_compress(d, false);
+    }
+}
+
+static Deflater *dz_begin(FILE *f)
+{
+    dz_tables_init();
+    Deflater *d = (Deflater *)malloc(sizeof(Deflater));
+    if (!d) return NULL;
+    d->f = f;
+    d->out_n = 0;
+    d->bits = 0;
+    d->nbits = 0;
+    d->strstart = 0;
+    d->lookahead = 0;
+    d->n_tok = 0;
+    d->adler_a = 1;
+    d->adler_b = 0;
+    for (int i = 0; i < DZ_HASH_SIZE; i++) d->head[i] = -1;
+    for (int i = 0; i < DZ_WSIZE; i++)     d->prev[i] = -1;
+
+    /* CMF + FLG -- CMF=0x78 (deflate, 32K window; a smaller one only
+     * means shorter distances), FLG chosen so that (CMF<<8 | FLG) % 31 == 0. */
+    dz_out_byte(d, 0x78);
+    dz_out_byte(d, 0x9C);
+    return d;
+}
+
+/* Finish the stream (final block, Adler-32), write the last IDAT and free. */
+static void dz_end(Deflater *d)
+{
+    dz_compress(d, true);
+    dz_flush_block(d, true);
+    dz_align(d);
+    uint32_t adl = (d->adler_b << 16) | d->adler_a;
+    dz_out_byte(d, (uint8_t)(adl >> 24));
+    dz_out_byte(d, (uint8_t)(adl >> 16));
+    dz_out_byte(d, (uint8_t)(adl >>  8));
+    dz_out_byte(d, (uint8_t)(adl));
+    if (d->out_n > 0)
+        write_chunk(d->f, "IDAT", d->out, (uint32_t)d->out_n);
+    free(d);
+}
+
+/* ── PNG row filters (bpp = 3) ──────────────────────────────────────── */
+static int paeth(int a, int b, int c)
+{
+    int p  = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+/* Write the filter byte plus the filtered row into @p out; @p prev is the
+ * row above or NULL for the first row.  The filter is the one with the
+ * smallest sum of absolute (signed) residuals, the usual PNG heuristic;
+ * all five sums are gathered in one pass. */
+static void filter_row(const uint8_t *cur, const uint8_t *prev, size_t n,
+                       uint8_t *out)
+{
+    uint32_t sum[5] = {0, 0, 0, 0, 0};
+    for (size_t i = 0; i < n; i++) {
+        int x = cur[i];
+        int a = i >= 3 ? cur[i - 3] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = (prev && i >= 3) ? prev[i - 3] : 0;
+        sum[0] += (uint32_t)abs((int8_t)x);
+        sum[1] += (uint32_t)abs((int8_t)(x - a));
+        sum[2] += (uint32_t)abs((int8_t)(x - b));
+        sum[3] += (uint32_t)abs((int8_t)(x - ((a + b) >> 1)));
+        sum[4] += (uint32_t)abs((int8_t)(x - paeth(a, b, c)));
+    }
+    int best = 0;
+    for (int t = 1; t < 5; t++)
+        if (sum[t] < sum[best]) best = t;
+
+    out[0] = (uint8_t)best;
+    for (size_t i = 0; i < n; i++) {
+        int x = cur[i];
+        int a = i >= 3 ? cur[i - 3] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = (prev && i >= 3) ? prev[i - 3] : 0;
+        switch (best) {
+        case 1:  x -= a;                  break;
+        case 2:  x -= b;                  break;
+        case 3:  x -= (a + b) >> 1;       break;
+        case 4:  x -= paeth(a, b, c);     break;
+        default:                          break;
+        }
+        out[1 + i] = (uint8_t)x;
+    }
+}
+
+/* Signature and IHDR of a @p w x @p h 8-bit RGB PNG. */
+static FILE *png_open(const char *filename, int w, int h)
+{
+    FILE *f = fopen(filename, "wb");
+    if (!f) return NULL;
+
+    static const uint8_t SIG[8] = { 0x89,'P','N','G',0x0D,0x0A,0x1A,0x0A };
+    fwrite(SIG, 1, 8, f);
+
+    /* IHDR: width(4 BE) height(4 BE) depth=8 colorType=2 (RGB) comp=0 filt=0 interlace=0 */
+    uint8_t ihdr[13];
+    ihdr[0] = (uint8_t)((w >> 24) & 0xFF);
+    ihdr[1] = (uint8_t)((w >> 16) & 0xFF);
+    ihdr[2] = (uint8_t)((w >>  8) & 0xFF);
+    ihdr[3] = (uint8_t)( w        & 0xFF);
+    ihdr[4] = (uint8_t)((h >> 24) & 0xFF);
+    ihdr[5] = (uint8_t)((h >> 16) & 0xFF);
+    ihdr[6] = (uint8_t)((h >>  8) & 0xFF);
+    ihdr[7] = (uint8_t)( h        & 0xFF);
+    ihdr[8]  = 8;     /* bit depth */
+    ihdr[9]  = 2;     /* color type: RGB */
+    ihdr[10] = 0;     /* compression */
+    ihdr[11] = 0;     /* filter */
+    ihdr[12] = 0;     /* interlace */
+    write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    return f;
+}
+
+/* IEND and close; false if anything failed. */
+static bool png_close(FILE *f, bool ok)
+{
+    write_chunk(f, "IEND", NULL, 0);
+    if (ferror(f)) ok = false;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+/* Pixels of one row to R, G, B bytes. */
+static void png_unpack(const uint32_t *src, int w, uint8_t *u)
+{
+    for (int x = 0; x < w; x++) {
+        u[3 * x]     = RASTER_R(src[x]);
+        u[3 * x + 1] = RASTER_G(src[x]);
+        u[3 * x + 2] = RASTER_B(src[x]);
+    }
+}
+
+struct RasterPngWriter {
+    FILE     *f;
+    Deflater *z;
+    int       w, h;
+    int       y;                /* next row to encode */
+    uint8_t  *rgb;              /* that row and the one above, unpacked */
+    uint8_t  *row;              /* filter byte + filtered row */
+    bool      ok;
+};
+
+RasterPngWriter *raster_png_begin(const char *filename, int w, int h)
+{
+    if (w <= 0 || h <= 0) return NULL;
+    RasterPngWriter *pw = (RasterPngWriter *)calloc(1, sizeof(*pw));
+    if (!pw) return NULL;
+    size_t row_bytes = (size_t)w * 3;
+    pw->w   = w;
+    pw->h   = h;
+    pw->ok  = true;
+    pw->rgb = (uint8_t *)malloc(2 * row_bytes);
+    pw->row = pw->rgb ? (uint8_t *)malloc(1 + row_bytes) : NULL;
+    pw->f   = pw->row ? png_open(filename, w, h) : NULL;
+    pw->z   = pw->f ? dz_begin(pw->f) : NULL;
+    if (!pw->z) {
+        if (pw->f) fclose(pw->f);
+        free(pw->row);
+        free(pw->rgb);
+        free(pw);
+        return NULL;
+    }
+    return pw;
+}
+
+bool raster_png_write_rows(RasterPngWriter *pw, const RasterImage *band)
+{
+    int lo = band->band_h > 0 ? band->band_y0 : 0;
+    int hi = band->band_h > 0 ? band->band_y0 + band->band_h : band->h;
+    if (hi > pw->h) hi = pw->h;
+    if (band->w != pw->w || lo != pw->y) {
+        pw->ok = false;
+        return false;
+    }
+    size_t row_bytes = (size_t)pw->w * 3;
+    for (int y = lo; y < hi; y++) {
+        uint8_t *cur  = pw->rgb + (y & 1) * row_bytes;
+        uint8_t *prev = y ? pw->rgb + ((y - 1) & 1) * row_bytes : NULL;
+        png_unpack(raster_row(band, y), pw->w, cur);
+        filter_row(cur, prev, row_bytes, pw->row);
+        dz_write(pw->z, pw->row, 1 + row_bytes);
+    }
+    pw->y = hi;
+    return true;
+}
+
+bool raster_png_end(RasterPngWriter *pw)
+{
+    if (!pw) return false;
+    dz_end(pw->z);
+    bool ok = png_close(pw->f, pw->ok && pw->y == pw->h);
+    free(pw->row);
+    free(pw->rgb);
+    free(pw);
+    return ok;
+}
+
+bool raster_write_png(const RasterImage *img, const char *filename)
+{
+    RasterPngWriter *pw = raster_png_begin(filename, img->w, img->h);
+    if (!pw) return false;
+    raster_png_write_rows(pw, img);
+    return raster_png_end(pw);
+}
+
+void raster_png_rows_free(RasterPngRows *keep)
+{
+    free(keep->rows);
+    memset(keep, 0, sizeof(*keep));
+}
+
+bool raster_write_png_rows(const RasterImage *img, const char *filename,
+                           RasterPngRows *keep, const uint8_t *dirty)
+{
+    /* The kept rows are only reused for an image of their size. */
+    size_t row_bytes = (size_t)img->w * 3;
+    if (keep && (!keep->rows || keep->w != img->w || keep->h != img->h)) {
+        raster_png_rows_free(keep);
+        keep->rows = (uint8_t *)malloc((size_t)img->h * (1 + row_bytes));
+        if (keep->rows) {
+            keep->w = img->w;
+            keep->h = img->h;
+        }
+        dirty = NULL;
+    }
+    if (keep && !keep->rows) keep = NULL;
+    if (!keep) dirty = NULL;
+
+    FILE *f = png_open(filename, img->w, img->h);
+    if (!f) return false;
+
+    /* Each row is unpacked to R, G, B bytes before filtering; the row
+     * above is kept unpacked for the Up / Average / Paeth filters.  A
+     * kept row is filtered again only when it or the row above changed. */
+    uint8_t  *rgb = (uint8_t *)malloc(2 * row_bytes);
+    uint8_t  *row = rgb ? (uint8_t *)malloc(1 + row_bytes) : NULL;
+    Deflater *z   = row ? dz_begin(f) : NULL;
+    if (!z) { free(row); free(rgb); fclose(f); return false; }
+
+    for (int y = 0; y < img->h; y++) {
+        uint8_t *out = keep ? keep->rows + (size_t)y * (1 + row_bytes) : row;
+        if (dirty && !dirty[y] && (y == 0 || !dirty[y - 1])) {
+            dz_write(z, out, 1 + row_bytes);
+            continue;
+        }
+        /* Unpack the row above too if the previous row was reused. */
+        for (int k = dirty && y > 0 && !dirty[y - 1] ? 1 : 0; k >= 0; k--)
+            png_unpack(raster_row(img, y - k), img->w, rgb + ((y - k) & 1) * row_bytes);
+        uint8_t *cur  = rgb + (y & 1) * row_bytes;
+        uint8_t *prev = y ? rgb + ((y - 1) & 1) * row_bytes : NULL;
+        filter_row(cur, prev, row_bytes, out);
+        dz_write(z, out, 1 + row_bytes);
+    }
+    dz_end(z);
+    free(row);
+    free(rgb);
+
+    return png_close(f, true);
+}
@@ -0,0 +1,176 @@
+/**
+ * @file raster.h
+ * @brief Portable software rasteriser and PNG writer shared by the CLI
+ *        sky renderer and the GUI.
+ *
+ * A RasterImage is a top-down array of 32-bit pixels 0x00RRGGBB: the
+ * memory layout of a 32-bpp BI_RGB DIB section (B, G, R, 0 per pixel),
+ * so the GUI points one at the bits of its back buffer, fills the parts
+ * it shares with the CLI -- the sky heatmap disc, see
+ * sky_render_heatmap_disc() -- and blits the result without a copy.
+ * sky_render.c draws its whole PNG on one.
+ *
+ * Drawing is by spans: rectangles, the 1-px lines and circles of the
+ * compass rose and the 5x7 bitmap font, whose glyphs are kept as row
+ * runs in an atlas built once by raster_init().  raster_write_png()
+ * encodes an image as an 8-bit RGB PNG with the built-in row filters and
+ * DEFLATE coder (no zlib), row by row from the image itself.
+ *
+ * An image may also be a band: a few rows of a taller one (band_h > 0).
+ * Drawing on a band draws the rows it holds, the same pixels as on the
+ * whole image, so a picture can be drawn band by band, each band handed
+ * to raster_png_write_rows() and the buffer reused for the next.
+ *
+ * Nothing here allocates except the PNG writers; the functions clip to
+ * the image (or band) and are thread-safe once raster_init() has run.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Pixel from 8-bit components. */
+#define RASTER_RGB(r, g, b) \
+    ((uint32_t)(uint8_t)(r) << 16 | (uint32_t)(uint8_t)(g) << 8 | (uint32_t)(uint8_t)(b))
+
+/** @brief Components of a pixel. */
+#define RASTER_R(c) ((uint8_t)((c) >> 16))
+#define RASTER_G(c) ((uint8_t)((c) >> 8))
+#define RASTER_B(c) ((uint8_t)(c))
+
+/** @brief Advance of one 5x7 glyph, pixels (5 + 1 tracking). */
+#define RASTER_GLYPH_W 6
+
+/** @brief Height of a glyph, pixels. */
+#define RASTER_GLYPH_H 7
+
+/**
+ * @struct RasterImage
+ * @brief A view of a pixel buffer the caller owns.
+ */
+typedef struct {
+    uint32_t *px;       /**< row y starts at px + (y - band_y0) * stride */
+    int       w, h;
+    int       stride;   /**< pixels per row, >= w */
+    int       band_y0;  /**< first row held, when band_h > 0 */
+    int       band_h;   /**< rows held from band_y0; 0 = all h */
+} RasterImage;
+
+/**
+ * @brief Build the shared tables: the glyph atlas and the PNG CRC and
+ *        DEFLATE code tables.  Idempotent; call it before drawing from
+ *        more than one thread (the drawing calls run it on first use).
+ */
+void raster_init(void);
+
+/** @brief Row @p y of @p img; NULL if the image (band) does not hold it. */
+uint32_t *raster_row(const RasterImage *img, int y);
+
+/** @brief Set one pixel (clipped). */
+void raster_put(RasterImage *img, int x, int y, uint32_t c);
+
+/** @brief Fill pixels x0..x1 (inclusive) of row @p y. */
+void raster_span(RasterImage *img, int y, int x0, int x1, uint32_t c);
+
+/** @brief Fill the rectangle with corners (x0, y0) and (x1, y1), inclusive. */
+void raster_fill_rect(RasterImage *img, int x0, int y0, int x1, int y1, uint32_t c);
+
+/** @brief Fill the whole image. */
+void raster_fill(RasterImage *img, uint32_t c);
+
+/** @brief 1-px Bresenham line, both end points included. */
+void raster_line(RasterImage *img, int x0, int y0, int x1, int y1, uint32_t c);
+
+/** @brief 1-px midpoint circle of @p radius around (cx, cy). */
+void raster_circle(RasterImage *img, int cx, int cy, int radius, uint32_t c);
+
+/**
+ * @brief Draw @p s in the 5x7 font with its top-left corner at (x, y).
+ *
+ * Lower case is drawn as upper case; characters without a glyph leave a
+ * blank cell.
+ *
+ * @return The x just past the last cell.
+ */
+int raster_text(RasterImage *img, int x, int y, const char *s, uint32_t c);
+
+/** @brief As raster_text(), ending at @p xr; returns the left edge. */
+int raster_text_right(RasterImage *img, int xr, int y, const char *s, uint32_t c);
+
+/** @brief Width of @p s in the 5x7 font, pixels. */
+int raster_text_width(const char *s);
+
+/**
+ * @brief Save @p img as an 8-bit RGB PNG.
+ *
+ * Rows are filtered one at a time (None / Sub / Up / Average / Paeth,
+ * the one with the smallest residuals) and streamed through DEFLATE into
+ * 64 KB IDAT chunks, so only two rows and the LZ77 window are held.
+ *
+ * @return true on success, false on I/O or allocation failure.
+ */
+bool raster_write_png(const RasterImage *img, const char *filename);
+
+/**
+ * @struct RasterPngRows
+ * @brief The filtered rows of the previous raster_write_png_rows() call.
+ */
+typedef struct {
+    uint8_t *rows;      /**< h rows of 1 + 3 w bytes; NULL until first use */
+    int      w, h;
+} RasterPngRows;
+
+/**
+ * @brief raster_write_png() for an image written again and again.
+ *
+ * The filtered rows are kept in @p keep; row y is filtered again only if
+ * @p dirty[y] or @p dirty[y - 1] is set (the filters read the row above)
+ * and copied from @p keep otherwise, so a repeat write costs DEFLATE and
+ * the changed rows.  @p dirty NULL, or @p keep empty or of another size,
+ * filters every row.  The file is the one raster_write_png() writes.
+ * Free @p keep with raster_png_rows_free().
+ */
+bool raster_write_png_rows(const RasterImage *img, const char *filename,
+                           RasterPngRows *keep, const uint8_t *dirty);
+
+/** @brief Free the rows of @p keep and zero it. */
+void raster_png_rows_free(RasterPngRows *keep);
+
+/** @brief A PNG being written band by band (raster_png_begin()). */
+typedef struct RasterPngWriter RasterPngWriter;
+
+/**
+ * @brief Start a @p w x @p h PNG whose rows come from
+ *        raster_png_write_rows().
+ * @return NULL if the file cannot be created or out of memory.
+ */
+RasterPngWriter *raster_png_begin(const char *filename, int w, int h);
+
+/**
+ * @brief Encode the rows @p band holds (all of a whole image); bands must
+ *        come top to bottom, each starting where the previous one ended.
+ * @return false on a gap or a band of another width.
+ */
+bool raster_png_write_rows(RasterPngWriter *pw, const RasterImage *band);
+
+/**
+ * @brief Finish the file and free @p pw.
+ * @return true if every row was written and no I/O failed.
+ */
+bool raster_png_end(RasterPngWriter *pw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RASTER_H */
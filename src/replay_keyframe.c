@@ -0,0 +1,242 @@
+/**
+ * @file replay_keyframe.c
+ * @brief State keyframes of a replay, for seeking into a capture.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "replay_keyframe.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define KEY_MAGIC    "NARKEY\r\n"
+#define KEY_VERSION  1
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t src_size;
+    int64_t  src_mtime;
+    uint64_t n_keys;
+    uint64_t table_off;
+    uint32_t complete;
+    uint32_t reserved;
+} KeyHeader;
+
+typedef struct {
+    uint32_t tag;
+    uint32_t len;
+} KeySection;
+
+static char *key_path(const char *path, const char *suffix)
+{
+    size_t n = strlen(path);
+    char *p = (char *)malloc(n + strlen(suffix) + 1);
+    if (!p) return NULL;
+    memcpy(p, path, n);
+    strcpy(p + n, suffix);
+    return p;
+}
+
+static void key_header(KeyHeader *h, uint64_t src_size, int64_t src_mtime)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, KEY_MAGIC, sizeof(h->magic));
+    h->version    = KEY_VERSION;
+    h->entry_size = (uint32_t)sizeof(ReplayKey);
+    h->src_size   = src_size;
+    h->src_mtime  = src_mtime;
+}
+
+static void key_write(ReplayKeyWriter *w, const void *data, size_t len)
+{
+    if (w->failed || !len) return;
+    if (fwrite(data, 1, len, w->f) != len) w->failed = true;
+    w->at += len;
+}
+
+static void key_pad(ReplayKeyWriter *w)
+{
+    static const unsigned char zero[8];
+    key_write(w, zero, (size_t)(-w->at & 7u));
+}
+
+/* ── Writing ──────────────────────────────────────────────────────────── */
+
+bool replay_key_create(ReplayKeyWriter *w, const char *capture)
+{
+    memset(w, 0, sizeof(*w));
+    struct stat st;
+    if (stat(capture, &st) != 0) return false;
+    w->src_size  = (uint64_t)st.st_size;
+    w->src_mtime = (int64_t)st.st_mtime;
+    w->path = key_path(capture, ".rtkey");
+    w->tmp  = key_path(capture, ".rtkey.tmp");
+    w->f = w->tmp && w->path ? fopen(w->tmp, "wb") : NULL;
+    if (!w->f) {
+        free(w->path);
+        free(w->tmp);
+        memset(w, 0, sizeof(*w));
+        return false;
+    }
+    KeyHeader h;
+    key_header(&h, w->src_size, w->src_mtime);
+    key_write(w, &h, sizeof(h));          /* rewritten by replay_key_finish() */
+    w->next_t_ms = REPLAY_KEY_INTERVAL_MS;
+    return true;
+}
+
+void replay_key_begin(ReplayKeyWriter *w, size_t frame, uint32_t t_ms)
+{
+    if (!w->f) return;
+    if (w->n_keys == w->cap) {
+        size_t ncap = w->cap ? w->cap * 2 : 64;
+        ReplayKey *n = (ReplayKey *)realloc(w->keys, ncap * sizeof(*n));
+        if (!n) {
+            w->failed = true;
+            return;
+        }
+        w->keys = n;
+        w->cap  = ncap;
+    }
+    ReplayKey *k = &w->keys[w->n_keys];
+    memset(k, 0, sizeof(*k));
+    k->frame  = frame;
+    k->offset = w->at;
+    k->t_ms   = t_ms;
+}
+
+void replay_key_put(ReplayKeyWriter *w, uint32_t tag, const void *data, size_t len)
+{
+    if (!w->f || w->failed) return;
+    if (len > UINT32_MAX) {
+        w->failed = true;
+        return;
+    }
+    KeySection s = { tag, (uint32_t)len };
+    key_write(w, &s, sizeof(s));
+    key_write(w, data, len);
+    key_pad(w);
+}
+
+void replay_key_end(ReplayKeyWriter *w)
+{
+    if (!w->f || w->failed) return;
+    ReplayKey *k = &w->keys[w->n_keys++];
+    k->size = (uint32_t)(w->at - k->offset);
+    w->next_t_ms = k->t_ms + REPLAY_KEY_INTERVAL_MS;
+}
+
+bool replay_key_finish(ReplayKeyWriter *w, bool complete)
+{
+    if (!w->f) return true;
+    KeyHeader h;
+    key_header(&h, w->src_size, w->src_mtime);
+    h.n_keys    = w->n_keys;
+    h.table_off = w->at;
+    h.complete  = complete ? 1u : 0u;
+    key_write(w, w->keys, w->n_keys * sizeof(ReplayKey));
+    bool ok = !w->failed &&
+              fseek(w->f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, w->f) == 1;
+    if (fclose(w->f) != 0) ok = false;
+    if (ok && w->n_keys > 0) {
+        remove(w->path);                  /* rename() won't replace on Windows */
+        ok = rename(w->tmp, w->path) == 0;
+    } else {
+        remove(w->tmp);
+    }
+    if (!ok) fprintf(stderr, "[WARN] Cannot write %s\n", w->path);
+    free(w->keys);
+    free(w->path);
+    free(w->tmp);
+    memset(w, 0, sizeof(*w));
+    return ok;
+}
+
+/* ── Reading ──────────────────────────────────────────────────────────── */
+
+bool replay_keys_open(ReplayKeys *k, const char *capture)
+{
+    memset(k, 0, sizeof(*k));
+    struct stat st;
+    if (stat(capture, &st) != 0) return false;
+    char *kp = key_path(capture, ".rtkey");
+    if (!kp) return false;
+    bool ok = file_map_open(&k->map, kp);
+    free(kp);
+    if (!ok) return false;
+
+    KeyHeader want, have;
+    key_header(&want, (uint64_t)st.st_size, (int64_t)st.st_mtime);
+    if (k->map.size < sizeof(have)) goto reject;
+    memcpy(&have, k->map.data, sizeof(have));
+    want.n_keys    = have.n_keys;
+    want.table_off = have.table_off;
+    want.complete  = have.complete;
+    if (memcmp(&want, &have, sizeof(want)) != 0) goto reject;
+    if (have.table_off > k->map.size || (have.table_off & 7u) ||
+        have.n_keys != (k->map.size - have.table_off) / sizeof(ReplayKey) ||
+        k->map.size != have.table_off + have.n_keys * sizeof(ReplayKey))
+        goto reject;
+
+    const ReplayKey *keys = (const ReplayKey *)(k->map.data + have.table_off);
+    for (size_t i = 0; i < (size_t)have.n_keys; i++)
+        if (keys[i].offset < sizeof(have) || keys[i].offset > have.table_off ||
+            keys[i].size > have.table_off - keys[i].offset ||
+            (i > 0 && keys[i].frame <= keys[i - 1].frame))
+            goto reject;
+
+    k->keys     = keys;
+    k->n_keys   = (size_t)have.n_keys;
+    k->complete = have.complete != 0;
+    return true;
+
+reject:
+    file_map_close(&k->map);
+    memset(k, 0, sizeof(*k));
+    return false;
+}
+
+void replay_keys_close(ReplayKeys *k)
+{
+    file_map_close(&k->map);
+    memset(k, 0, sizeof(*k));
+}
+
+const ReplayKey *replay_keys_find(const ReplayKeys *k, size_t frame)
+{
+    size_t lo = 0, hi = k->n_keys;       /* first key past @p frame */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (k->keys[mid].frame <= frame) lo = mid + 1;
+        else                             hi = mid;
+    }
+    return lo > 0 ? &k->keys[lo - 1] : NULL;
+}
+
+const void *replay_keys_section(const ReplayKeys *k, const ReplayKey *key,
+                                uint32_t tag, size_t *len)
+{
+    const unsigned char *p   = k->map.data + key->offset;
+    const unsigned char *end = p + key->size;
+    while ((size_t)(end - p) >= sizeof(KeySection)) {
+        KeySection s;
+        memcpy(&s, p, sizeof(s));
+        p += sizeof(s);
+        if (s.len > (size_t)(end - p)) break;
+        if (s.tag == tag) {
+            *len = s.len;
+            return p;
+        }
+        size_t step = ((size_t)s.len + 7u) & ~(size_t)7u;
+        if (step > (size_t)(end - p)) break;
+        p += step;
+    }
+    *len = 0;
+    return NULL;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file replay_keyframe.h
+ * @brief State keyframes of a replay, for seeking into a capture.
+ *
+ * The sky state after N frames of a capture is the product of every
+ * frame before it: the ephemerides decoded so far, the partly assembled
+ * epochs, the sector grid and the counters.  Jumping to hour 20 of a day
+ * long capture therefore meant replaying hours 0..20 first.  A replay
+ * from the start now saves that state every REPLAY_KEY_INTERVAL_MS of
+ * stream time as "<file>.rtkey", next to the frame index (rtcm_replay.h)
+ * and keyed the same way, on the capture's size and mtime.  A seek
+ * restores the last keyframe before the target and replays only the
+ * frames between the two.
+ *
+ * A keyframe is a list of tagged sections; what they hold is up to the
+ * caller (main.c keeps the sky state), this module only stores and finds
+ * them.  A section whose length no longer matches is the caller's sign of
+ * a different build.
+ *
+ * Layout (host byte order, sections 8-byte aligned):
+ *   header   magic "NARKEY\r\n", u32 version, u32 entry size,
+ *            u64 capture size, i64 capture mtime, u64 keyframes,
+ *            u64 table offset, u32 complete, u32 reserved
+ *   keyframes  { u32 tag, u32 length, data, padding }...
+ *   table    one ReplayKey per keyframe, by frame
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef REPLAY_KEYFRAME_H
+#define REPLAY_KEYFRAME_H
+
+#include "file_map.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Stream time (ms) between two keyframes. */
+#define REPLAY_KEY_INTERVAL_MS  600000u
+
+/**
+ * @struct ReplayKey
+ * @brief One table entry (24 bytes, also the on-disk layout).
+ *
+ * Fields:
+ *   - frame:   Index of the first frame not yet fed when the state was
+ *              saved (the frame a restore continues with).
+ *   - offset:  File offset of the keyframe's first section.
+ *   - t_ms:    Stream time of that frame (RtcmReplayFrame::t_ms).
+ *   - size:    Bytes of all its sections.
+ */
+typedef struct {
+    uint64_t frame;
+    uint64_t offset;
+    uint32_t t_ms;
+    uint32_t size;
+} ReplayKey;
+
+/**
+ * @struct ReplayKeyWriter
+ * @brief Keyframes being written to "<file>.rtkey.tmp".
+ */
+typedef struct {
+    FILE      *f;
+    char      *path;          /**< "<file>.rtkey" */
+    char      *tmp;           /**< "<file>.rtkey.tmp" */
+    uint64_t   src_size;
+    int64_t    src_mtime;
+    uint64_t   at;            /**< bytes written */
+    ReplayKey *keys;
+    size_t     n_keys, cap;
+    uint32_t   next_t_ms;     /**< stream time of the next keyframe due */
+    bool       failed;
+} ReplayKeyWriter;
+
+/**
+ * @struct ReplayKeys
+ * @brief The mapped keyframes of a capture.
+ */
+typedef struct {
+    FileMap          map;
+    const ReplayKey *keys;
+    size_t           n_keys;
+    bool             complete;  /**< written by a replay that reached the end */
+} ReplayKeys;
+
+/**
+ * @brief Start writing the keyframes of capture @p capture.
+ * @return false if the capture cannot be stat()ed or the file created.
+ */
+bool replay_key_create(ReplayKeyWriter *w, const char *capture);
+
+/** @brief true if a keyframe is due before the frame at stream time @p t_ms. */
+static inline bool replay_key_due(const ReplayKeyWriter *w, uint32_t t_ms)
+{
+    return w->f && t_ms >= w->next_t_ms;
+}
+
+/** @brief Open the keyframe that restores to frame @p frame (at @p t_ms). */
+void replay_key_begin(ReplayKeyWriter *w, size_t frame, uint32_t t_ms);
+
+/** @brief Add section @p tag of @p len bytes to the open keyframe. */
+void replay_key_put(ReplayKeyWriter *w, uint32_t tag, const void *data, size_t len);
+
+/** @brief Close the open keyframe; the next is due one interval later. */
+void replay_key_end(ReplayKeyWriter *w);
+
+/**
+ * @brief Write the table and move the file in place of "<file>.rtkey".
+ *
+ * Keyframes of an interrupted replay are kept (@p complete false), so a
+ * seek can resume it; a later replay from the start replaces them.  A
+ * file without keyframes is dropped.
+ *
+ * @return false (message on stderr) if the file could not be written.
+ */
+bool replay_key_finish(ReplayKeyWriter *w, bool complete);
+
+/**
+ * @brief Map the keyframes of @p capture if "<capture>.rtkey" matches it.
+ * @return false if there is none, or it belongs to another version of
+ *         the capture; @p k is zeroed.
+ */
+bool replay_keys_open(ReplayKeys *k, const char *capture);
+
+/** @brief Release the mapping.  Safe on a failed open. */
+void replay_keys_close(ReplayKeys *k);
+
+/** @brief The last keyframe at or before frame @p frame, or NULL. */
+const ReplayKey *replay_keys_find(const ReplayKeys *k, size_t frame);
+
+/**
+ * @brief Section @p tag of keyframe @p key.
+ * @param len  [out] Its length in bytes.
+ * @return Pointer into the mapping (8-byte aligned), or NULL if absent.
+ */
+const void *replay_keys_section(const ReplayKeys *k, const ReplayKey *key,
+                                uint32_t tag, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPLAY_KEYFRAME_H */
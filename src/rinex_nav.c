@@ -14,6 +14,12 @@
  * Each data line carries up to 4 floats in Fortran "1.234D+05" notation;
  * we substitute 'D' -> 'E' before calling atof.
  *
+ * The file is memory-mapped and split into records in one pass; the
+ * records are then parsed in parallel batches and stored in file order.
+ * The parsed records are written to a binary "<file>.ephc" sidecar keyed
+ * on the file's size and mtime, so loading the same file again skips
+ * parsing altogether.
+ *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
  * License: Apache License 2.0 with Commons Clause
@@ -21,13 +27,25 @@
 
 #include "rinex_nav.h"
 #include "sv_ephemeris.h"
+#include "file_map.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
 #include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -132,8 +150,8 @@ static double rnx_to_glo_tod(int hour, int min, double sec)
 
 /* Common Keplerian record: GPS (G), Galileo (E), QZSS (J), BeiDou (C).
  * Records are 8 lines (the first one being the sat-id/date/clock line).
- * Returns 1 if a SvEphemeris was stored, 0 otherwise. */
-static int parse_keplerian_record(int gnss_id, int prn,
+ * Returns 1 if @p out was filled, 0 otherwise. */
+static int parse_keplerian_record(SvEphemeris *out, int gnss_id, int prn,
                                   int year, int month, int day,
                                   int hour, int min, double sec,
                                   double af0, double af1, double af2,
@@ -187,14 +205,14 @@ static int parse_keplerian_record(int gnss_id, int prn,
 
     eph.health = (int)v6[1];
 
-    sv_eph_store(&eph);
+    *out = eph;
     return 1;
 }
 
 /* GLONASS record: 4 lines.  First line carries clock_bias + gamma_n +
  * message frame time.  Lines 1-3 are position/velocity/acceleration in
  * km / km/s / km/s^2, plus health, freq channel, age_of_oper_info. */
-static int parse_glonass_record(int prn,
+static int parse_glonass_record(SvEphemeris *out, int prn,
                                 int year, int month, int day,
                                 int hour, int min, double sec,
                                 double clock_bias, double gamma_n,
@@ -239,31 +257,59 @@ static int parse_glonass_record(int prn,
     eph.toe        = eph.glo_tb_sod;
     eph.toc        = eph.glo_tb_sod;
 
-    sv_eph_store(&eph);
+    *out = eph;
     (void)year; (void)month; (void)day;     /* date not needed by sky plot */
     return 1;
 }
 
-/* ── Top-level loader ─────────────────────────────────────────────────── */
+/* ── Record splitting ─────────────────────────────────────────────────── */
 
-int rinex_nav_load(const char *filename, int *out_counts)
+/* One record located in the mapped file: the sat-id line and the number
+ * of follow-up lines that belong to it. */
+typedef struct {
+    const char *start;
+    int         n_follow;
+} RnxRecord;
+
+/* Copy the line at *@p cur into @p dst the way fgets + rnx_chomp would
+ * (truncated to @p cap - 1 bytes) and advance *@p cur past it.
+ * Returns 0 at end of file. */
+static int rnx_next_line(const char **cur, const char *end,
+                         char *dst, size_t cap)
 {
-    int counts[RINEX_NAV_MAX_GNSS] = { 0 };
-    if (!filename) return -1;
+    const char *p = *cur;
+    if (p >= end) return 0;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    const char *eol = nl ? nl : end;
+    size_t n = (size_t)(eol - p);
+    if (n > cap - 1) n = cap - 1;
+    memcpy(dst, p, n);
+    dst[n] = '\0';
+    rnx_chomp(dst);
+    *cur = nl ? nl + 1 : end;
+    return 1;
+}
 
-    FILE *f = fopen(filename, "r");
-    if (!f) return -1;
+/* Skip the line at *@p cur.  Returns 0 at end of file. */
+static int rnx_skip_line(const char **cur, const char *end)
+{
+    const char *p = *cur;
+    if (p >= end) return 0;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    *cur = nl ? nl + 1 : end;
+    return 1;
+}
 
+/* Locate the next Keplerian or GLONASS record at or after *@p cur,
+ * applying the same skip rules as a sequential read: short lines are
+ * dropped, other systems consume a default 4 follow-up lines.  Returns 0
+ * when the file ends before a complete record. */
+static int rnx_find_record(const char **cur, const char *end, RnxRecord *rec)
+{
     char line[256];
-
-    /* Skip header */
-    while (fgets(line, sizeof(line), f)) {
-        if (strstr(line, "END OF HEADER")) break;
-    }
-
-    /* Read records */
-    while (fgets(line, sizeof(line), f)) {
-        rnx_chomp(line);
+    for (;;) {
+        const char *start = *cur;
+        if (!rnx_next_line(cur, end, line, sizeof(line))) return 0;
 
         /* Need at least a sat-id + date in the first 22 characters */
         if (strlen(line) < 22) continue;
@@ -276,77 +322,351 @@ int rinex_nav_load(const char *filename, int *out_counts)
              * follow-up lines and resync.  Worst case: a small drift that
              * a later sat-id line corrects on its own. */
             for (int i = 0; i < 4; i++)
-                if (!fgets(line, sizeof(line), f)) break;
+                if (!rnx_skip_line(cur, end)) break;
             continue;
         }
 
-        int prn   = atoi(line + 1);
-        int year  = atoi(line + 4);
-        int month = atoi(line + 9);
-        int day   = atoi(line + 12);
-        int hour  = atoi(line + 15);
-        int min   = atoi(line + 18);
-        double sec = atof(line + 21);
-
-        double clock0[4];
-        rnx_read_4(line, clock0);   /* fields beyond char 23: af0, af1, af2 */
-        double af0 = clock0[1];
-        double af1 = clock0[2];
-        double af2 = clock0[3];
-
-        if (sys == 'R') {
-            char L1[256] = "", L2[256] = "", L3[256] = "";
-            if (!fgets(L1, sizeof(L1), f)) break;
-            rnx_chomp(L1);
-            if (!fgets(L2, sizeof(L2), f)) break;
-            rnx_chomp(L2);
-            if (!fgets(L3, sizeof(L3), f)) break;
-            rnx_chomp(L3);
-            if (parse_glonass_record(prn, year, month, day, hour, min, sec,
-                                     af0, af1, af2,   /* RINEX names: tau, gamma, msg-frame-time */
-                                     L1, L2, L3)) {
-                counts[2]++;
-            }
-        } else {
-            char L1[256]="", L2[256]="", L3[256]="", L4[256]="",
-                 L5[256]="", L6[256]="", L7[256]="";
-            if (!fgets(L1, sizeof(L1), f)) break;
-            rnx_chomp(L1);
-            if (!fgets(L2, sizeof(L2), f)) break;
-            rnx_chomp(L2);
-            if (!fgets(L3, sizeof(L3), f)) break;
-            rnx_chomp(L3);
-            if (!fgets(L4, sizeof(L4), f)) break;
-            rnx_chomp(L4);
-            if (!fgets(L5, sizeof(L5), f)) break;
-            rnx_chomp(L5);
-            if (!fgets(L6, sizeof(L6), f)) break;
-            rnx_chomp(L6);
-            if (!fgets(L7, sizeof(L7), f)) break;
-            rnx_chomp(L7);
-
-            int gnss_id;
-            switch (sys) {
-            case 'G': gnss_id = 1; break;
-            case 'E': gnss_id = 3; break;
-            case 'J': gnss_id = 4; break;
-            case 'C': gnss_id = 5; break;
-            case 'I': gnss_id = 7; break;  /* NavIC / IRNSS — same 8-line Keplerian layout */
-            default:  gnss_id = 0; break;
-            }
-            if (gnss_id > 0 &&
-                parse_keplerian_record(gnss_id, prn,
-                                       year, month, day, hour, min, sec,
-                                       af0, af1, af2,
-                                       L1, L2, L3, L4, L5, L6, L7)) {
-                if (gnss_id < RINEX_NAV_MAX_GNSS) counts[gnss_id]++;
-            }
+        rec->start    = start;
+        rec->n_follow = (sys == 'R') ? 3 : 7;
+        for (int i = 0; i < rec->n_follow; i++)
+            if (!rnx_skip_line(cur, end)) return 0;
+        return 1;
+    }
+}
+
+/* Parse one located record into @p out.  Returns the GNSS ID, or 0. */
+static int rnx_parse_record(const RnxRecord *rec, const char *end,
+                            SvEphemeris *out)
+{
+    char line[256];
+    char L[7][256];
+    const char *cur = rec->start;
+    rnx_next_line(&cur, end, line, sizeof(line));
+    for (int i = 0; i < rec->n_follow; i++)
+        rnx_next_line(&cur, end, L[i], sizeof(L[i]));
+
+    char sys  = line[0];
+    int prn   = atoi(line + 1);
+    int year  = atoi(line + 4);
+    int month = atoi(line + 9);
+    int day   = atoi(line + 12);
+    int hour  = atoi(line + 15);
+    int min   = atoi(line + 18);
+    double sec = atof(line + 21);
+
+    double clock0[4];
+    rnx_read_4(line, clock0);   /* fields beyond char 23: af0, af1, af2 */
+    double af0 = clock0[1];
+    double af1 = clock0[2];
+    double af2 = clock0[3];
+
+    if (sys == 'R') {
+        return parse_glonass_record(out, prn, year, month, day, hour, min, sec,
+                                    af0, af1, af2,   /* RINEX names: tau, gamma, msg-frame-time */
+                                    L[0], L[1], L[2]) ? 2 : 0;
+    }
+
+    int gnss_id;
+    switch (sys) {
+    case 'G': gnss_id = 1; break;
+    case 'E': gnss_id = 3; break;
+    case 'J': gnss_id = 4; break;
+    case 'C': gnss_id = 5; break;
+    case 'I': gnss_id = 7; break;  /* NavIC / IRNSS — same 8-line Keplerian layout */
+    default:  gnss_id = 0; break;
+    }
+    if (gnss_id > 0 &&
+        parse_keplerian_record(out, gnss_id, prn,
+                               year, month, day, hour, min, sec,
+                               af0, af1, af2,
+                               L[0], L[1], L[2], L[3], L[4], L[5], L[6]))
+        return gnss_id;
+    return 0;
+}
+
+/* ── Parallel parse ───────────────────────────────────────────────────── */
+
+/* Records are split sequentially (cheap: memchr per line), then parsed
+ * in batches of RNX_BATCH across worker threads (the float conversions
+ * dominate), and stored into the cache in file order so the ephemeris
+ * history sees them in the same order a sequential read would. */
+#define RNX_BATCH           16384
+#define RNX_MAX_THREADS     8
+#define RNX_MIN_PER_THREAD  1024
+
+typedef struct {
+    const RnxRecord *recs;
+    SvEphemeris     *out;
+    unsigned char   *gnss;
+    int              begin, end;
+    const char      *file_end;
+} RnxJob;
+
+#ifdef _WIN32
+static unsigned __stdcall rnx_worker(void *arg)
+#else
+static void *rnx_worker(void *arg)
+#endif
+{
+    RnxJob *job = (RnxJob *)arg;
+    for (int i = job->begin; i < job->end; i++)
+        job->gnss[i] = (unsigned char)rnx_parse_record(&job->recs[i],
+                                                       job->file_end,
+                                                       &job->out[i]);
+    return 0;
+}
+
+static int rnx_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* Parse @p n records into @p out / @p gnss, spreading them over up to
+ * RNX_MAX_THREADS threads.  Falls back to the calling thread for small
+ * batches or if a thread cannot be started. */
+static void rnx_parse_batch(const RnxRecord *recs, int n, const char *file_end,
+                            SvEphemeris *out, unsigned char *gnss)
+{
+    int n_threads = rnx_cpu_count();
+    if (n_threads > RNX_MAX_THREADS) n_threads = RNX_MAX_THREADS;
+    if (n_threads > n / RNX_MIN_PER_THREAD) n_threads = n / RNX_MIN_PER_THREAD;
+    if (n_threads < 1) n_threads = 1;
+
+    RnxJob jobs[RNX_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[RNX_MAX_THREADS];
+#else
+    pthread_t threads[RNX_MAX_THREADS];
+#endif
+    bool started[RNX_MAX_THREADS] = { false };
+
+    for (int t = 0; t < n_threads; t++) {
+        jobs[t].recs     = recs;
+        jobs[t].out      = out;
+        jobs[t].gnss     = gnss;
+        jobs[t].begin    = (int)((long long)n * t / n_threads);
+        jobs[t].end      = (int)((long long)n * (t + 1) / n_threads);
+        jobs[t].file_end = file_end;
+    }
+
+    /* Job 0 runs on this thread. */
+    for (int t = 1; t < n_threads; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, rnx_worker, &jobs[t], 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, rnx_worker, &jobs[t]) == 0;
+#endif
+    }
+    rnx_worker(&jobs[0]);
+    for (int t = 1; t < n_threads; t++) {
+        if (!started[t]) {
+            rnx_worker(&jobs[t]);
+            continue;
         }
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
     }
+}
+
+/* ── Binary sidecar cache ─────────────────────────────────────────────── */
+
+/* "<file>.ephc": the parsed records of <file>, in file order, as raw
+ * SvEphemeris structs.  Keyed on the NAV file's size and mtime, and on
+ * the struct size so a rebuilt binary with a changed layout ignores it.
+ * The cache is an in-place memory image, valid only for the build that
+ * wrote it; it is rewritten whenever it does not match. */
+#define RNX_CACHE_MAGIC    "NAEPHC\r\n"
+#define RNX_CACHE_VERSION  1
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint64_t src_size;
+    int64_t  src_mtime;
+    uint32_t n_records;
+    uint32_t reserved;
+} RnxCacheHeader;
+
+static char *rnx_cache_path(const char *filename, const char *suffix)
+{
+    size_t n = strlen(filename);
+    char *path = (char *)malloc(n + strlen(suffix) + 1);
+    if (!path) return NULL;
+    memcpy(path, filename, n);
+    strcpy(path + n, suffix);
+    return path;
+}
+
+static void rnx_cache_header(RnxCacheHeader *h, const struct stat *st)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, RNX_CACHE_MAGIC, sizeof(h->magic));
+    h->version   = RNX_CACHE_VERSION;
+    h->rec_size  = (uint32_t)sizeof(SvEphemeris);
+    h->src_size  = (uint64_t)st->st_size;
+    h->src_mtime = (int64_t)st->st_mtime;
+}
 
-    fclose(f);
+/* Load @p filename's sidecar into the ephemeris cache.  Returns the total
+ * loaded, or -1 if there is no matching cache. */
+static int rnx_cache_load(const char *filename, const struct stat *st,
+                          int counts[RINEX_NAV_MAX_GNSS])
+{
+    char *path = rnx_cache_path(filename, ".ephc");
+    if (!path) return -1;
+    FileMap m;
+    bool ok = file_map_open(&m, path);
+    free(path);
+    if (!ok) return -1;
+
+    RnxCacheHeader want, have;
+    rnx_cache_header(&want, st);
+    if (m.size < sizeof(have)) {
+        file_map_close(&m);
+        return -1;
+    }
+    memcpy(&have, m.data, sizeof(have));
+    want.n_records = have.n_records;
+    if (memcmp(&want, &have, sizeof(want)) != 0 ||
+        m.size != sizeof(have) + (size_t)have.n_records * sizeof(SvEphemeris)) {
+        file_map_close(&m);
+        return -1;
+    }
 
     int total = 0;
+    const unsigned char *p = m.data + sizeof(have);
+    for (uint32_t i = 0; i < have.n_records; i++, p += sizeof(SvEphemeris)) {
+        SvEphemeris eph;
+        memcpy(&eph, p, sizeof(eph));
+        if (eph.gnss_id <= 0 || eph.gnss_id >= RINEX_NAV_MAX_GNSS) continue;
+        sv_eph_store(&eph);
+        counts[eph.gnss_id]++;
+        total++;
+    }
+    file_map_close(&m);
+    return total;
+}
+
+/* Start writing a sidecar to "<file>.ephc.tmp".  Returns NULL if the
+ * directory is not writable; the load then simply runs uncached. */
+static FILE *rnx_cache_begin(const char *filename, const struct stat *st)
+{
+    char *tmp = rnx_cache_path(filename, ".ephc.tmp");
+    if (!tmp) return NULL;
+    FILE *f = fopen(tmp, "wb");
+    free(tmp);
+    if (!f) return NULL;
+    RnxCacheHeader h;
+    rnx_cache_header(&h, st);
+    if (fwrite(&h, sizeof(h), 1, f) != 1) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+/* Patch the record count into the header and move the sidecar into
+ * place; on any failure the temporary file is removed instead. */
+static void rnx_cache_end(FILE *f, const char *filename, const struct stat *st,
+                          uint32_t n_records, bool ok)
+{
+    char *tmp  = rnx_cache_path(filename, ".ephc.tmp");
+    char *path = rnx_cache_path(filename, ".ephc");
+    if (ok) {
+        RnxCacheHeader h;
+        rnx_cache_header(&h, st);
+        h.n_records = n_records;
+        ok = fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    }
+    if (fclose(f) != 0) ok = false;
+    if (tmp && path) {
+        if (ok) {
+            remove(path);                 /* rename() won't replace on Windows */
+            if (rename(tmp, path) != 0) remove(tmp);
+        } else {
+            remove(tmp);
+        }
+    }
+    free(tmp);
+    free(path);
+}
+
+/* ── Top-level loader ─────────────────────────────────────────────────── */
+
+int rinex_nav_load(const char *filename, int *out_counts)
+{
+    int counts[RINEX_NAV_MAX_GNSS] = { 0 };
+    if (!filename) return -1;
+
+    struct stat st;
+    if (stat(filename, &st) != 0) return -1;
+
+    int total = rnx_cache_load(filename, &st, counts);
+    if (total < 0) {
+        FileMap m;
+        if (!file_map_open(&m, filename)) return -1;
+
+        RnxRecord     *recs = (RnxRecord *)malloc(RNX_BATCH * sizeof(RnxRecord));
+        SvEphemeris   *ephs = (SvEphemeris *)malloc(RNX_BATCH * sizeof(SvEphemeris));
+        unsigned char *gnss = (unsigned char *)malloc(RNX_BATCH);
+        if (!recs || !ephs || !gnss) {
+            free(recs); free(ephs); free(gnss);
+            file_map_close(&m);
+            return -1;
+        }
+
+        const char *cur = (const char *)m.data;
+        const char *end = cur + m.size;
+
+        /* Skip header */
+        char line[256];
+        while (rnx_next_line(&cur, end, line, sizeof(line))) {
+            if (strstr(line, "END OF HEADER")) break;
+        }
+
+        FILE *cache = rnx_cache_begin(filename, &st);
+        bool cache_ok = cache != NULL;
+        uint32_t n_cached = 0;
+
+        total = 0;
+        for (;;) {
+            int n = 0;
+            while (n < RNX_BATCH && rnx_find_record(&cur, end, &recs[n])) n++;
+            if (n == 0) break;
+
+            rnx_parse_batch(recs, n, end, ephs, gnss);
+            for (int i = 0; i < n; i++) {
+                if (gnss[i] == 0) continue;
+                sv_eph_store(&ephs[i]);
+                if (gnss[i] < RINEX_NAV_MAX_GNSS) counts[gnss[i]]++;
+                if (cache_ok)
+                    cache_ok = fwrite(&ephs[i], sizeof(ephs[i]), 1, cache) == 1;
+                n_cached++;
+            }
+            if (n < RNX_BATCH) break;
+        }
+
+        if (cache) rnx_cache_end(cache, filename, &st, n_cached, cache_ok);
+        free(recs);
+        free(ephs);
+        free(gnss);
+        file_map_close(&m);
+    }
+
+    total = 0;
     for (int i = 0; i < RINEX_NAV_MAX_GNSS; i++) {
         if (out_counts) out_counts[i] = counts[i];
         total += counts[i];
@@ -8,6 +8,10 @@
  * QZSS, BeiDou and NavIC/IRNSS as Keplerian records, and GLONASS as state
  * vectors.  SBAS records are recognised and skipped.
  *
+ * Every record is stored (the cache keeps a per-SV history), and the
+ * parsed records are cached in a "<file>.ephc" sidecar next to the file;
+ * see rinex_nav_load().
+ *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
  * License: Apache License 2.0 with Commons Clause
@@ -26,6 +30,11 @@ extern "C" {
 /**
  * @brief Load broadcast ephemerides from a RINEX 3 NAV file.
  *
+ * Uses "<filename>.ephc" instead of parsing when its recorded size and
+ * mtime match the file's; otherwise parses the file and (re)writes the
+ * sidecar if the directory is writable.  The sidecar is a raw memory
+ * image and is ignored by a build with a different SvEphemeris layout.
+ *
  * @param filename      Path to the file.
  * @param out_counts    Array of size RINEX_NAV_MAX_GNSS; on success each
  *                      slot is set to the number of ephemerides loaded
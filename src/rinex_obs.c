@@ -0,0 +1,743 @@
+/**
+ * @file rinex_obs.c
+ * @brief Streaming RINEX 3.04 observation writer fed with MSM frames.
+ *
+ * The ring is an array of epoch slots: head is written only by the
+ * producer and tail only by the writer thread, both published with
+ * release stores, as in rtcm_recorder.c.  The producer assembles the
+ * open epoch in its own buffer and copies it into the slot at head when
+ * the epoch is complete.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rinex_obs.h"
+#include "rtcm3x_parser.h"
+#include "stream_clock.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#endif
+
+#define OBS_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define OBS_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define OBS_ADD(p, v)    __atomic_add_fetch((p), (v), __ATOMIC_RELAXED)
+
+#define OBS_IDLE_MS      20             /* writer poll interval when idle */
+#define OBS_FLUSH_NS     1000000000LL   /* flush a quiet file once a second */
+#define OBS_IO_BUF       (256u << 10)
+
+#define OBS_MAX_GNSS     8              /* GNSS ID 1..7 */
+#define OBS_MAX_PRN      64
+#define OBS_MAX_SIGS     32
+#define OBS_MAX_TYPES    64             /* observation types per GNSS */
+#define OBS_NO_CHAN      (-128)         /* GLONASS channel unknown */
+
+#define DAY_MS           86400000LL
+
+/* Observation kinds, in RINEX order. */
+enum { KIND_C, KIND_L, KIND_D, KIND_S, N_KINDS };
+static const char k_kind[N_KINDS] = { 'C', 'L', 'D', 'S' };
+static const char k_sys[OBS_MAX_GNSS] = { '?', 'G', 'R', 'E', 'J', 'C', 'S', 'I' };
+
+typedef struct {
+    uint8_t  gnss_id, prn, sig_idx, msm;
+    char     code[2];                   /* RINEX band + attribute, e.g. "1C" */
+    int8_t   glo_chan;                  /* GLONASS channel, OBS_NO_CHAN */
+    uint8_t  half_cycle;
+    uint16_t lock;                      /* DF402 / DF407 */
+    uint8_t  has_rate;
+    float    cnr_dbhz;
+    double   pr_m, ph_m, rate_mps;
+} ObsCell;
+
+typedef struct {
+    int64_t  t_ms;                      /* GPS ms since 1980-01-06 */
+    int      n;
+    bool     arp_valid;
+    double   arp[3];
+    int8_t   glo_chan[OBS_MAX_PRN];     /* by PRN - 1, as known at close */
+    ObsCell  cells[RINEX_OBS_MAX_CELLS];
+} ObsEpoch;
+
+/* Up to and including the cells in use: what obs_queue() copies. */
+#define EPOCH_BYTES(e) (offsetof(ObsEpoch, cells) + (size_t)(e)->n * sizeof(ObsCell))
+
+struct RinexObsWriter {
+    /* Ring (producer: head and its counters; writer: tail). */
+    ObsEpoch  *slots;
+    uint64_t   head;
+    uint64_t   tail;
+    int        stop;
+    bool       wait;
+    uint64_t   dropped, late, other_station, overflow;
+
+    /* Producer state. */
+    ObsEpoch   cur;
+    bool       cur_open;
+    int64_t    last_ms;                 /* -1 = no epoch yet */
+    int64_t    hint_ms;                 /* GPS ms near the first epoch */
+    int        station;                 /* -1 = none yet */
+    bool       arp_valid;
+    double     arp[3];
+    int8_t     glo_chan[OBS_MAX_PRN];
+
+    /* Output, owned by the writer thread after open. */
+    FILE      *f;
+    char       marker[61];
+    char       run_date[24];
+    bool       header_done;
+    bool       header_arp;              /* the header had a position */
+    int        n_types[OBS_MAX_GNSS];
+    char       types[OBS_MAX_GNSS][OBS_MAX_TYPES][4];
+    int8_t     col[OBS_MAX_GNSS][OBS_MAX_SIGS][N_KINDS];   /* -1 = no column */
+    bool       sys_changed[OBS_MAX_GNSS];
+    uint16_t   lock_prev[OBS_MAX_GNSS][OBS_MAX_PRN][OBS_MAX_SIGS];
+    uint8_t    lock_msm[OBS_MAX_GNSS][OBS_MAX_PRN][OBS_MAX_SIGS];  /* 0 = none yet */
+    int64_t    last_flush_ns;
+    uint64_t   epochs;
+    int        failed;
+
+#ifdef _WIN32
+    HANDLE     thread;
+#else
+    pthread_t  thread;
+#endif
+};
+
+static void obs_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { 0, (long)ms * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* ── Signals and frequencies ──────────────────────────────────────────── */
+
+/* RINEX band + attribute of MSM signal @p sig of @p g; false for reserved
+ * signal IDs.  Call on the producer thread (msm_signal_label() keeps a
+ * static buffer for unknown IDs). */
+static bool obs_signal_code(int g, int sig, char code[2])
+{
+    const char *lbl = msm_signal_label(g, sig);
+    size_t len = strlen(lbl);
+    if (g == 7 && len == 2) {                   /* NavIC: "5A" */
+        code[0] = lbl[0];
+        code[1] = lbl[1];
+        return true;
+    }
+    if (len != 3 || (lbl[0] == 'S' && lbl[1] >= '0' && lbl[1] <= '9'))
+        return false;                           /* reserved: "S%02d" */
+    code[0] = lbl[1];
+    code[1] = lbl[2];
+    if (g == 5) {
+        /* BeiDou labels carry the RTCM band ("B1I" .. "B8D"); RINEX 3.04
+         * numbers B1I 2, B1C 1, B2a 5, B2 7, B2a+b 8, B3 6. */
+        static const char band[OBS_MAX_SIGS] = {
+            0,  '2','2','2', 0,  0,  0,  0,
+            '6','6','6', 0,  0,  '7','7','7',
+            0,  0,  0,  0,  0,  '5','5','5',
+            '7','7','7','8','8','1','1','1'
+        };
+        if (!band[sig]) return false;
+        code[0] = band[sig];
+    }
+    return true;
+}
+
+/* Carrier frequency in Hz, 0 if unknown (GLONASS without a channel). */
+static double obs_freq_hz(int g, char band, int glo_chan)
+{
+    switch (g) {
+    case 1: case 4: case 6:                     /* GPS, QZSS, SBAS */
+        switch (band) {
+        case '1': return 1575.42e6;
+        case '2': return 1227.60e6;
+        case '5': return 1176.45e6;
+        case '6': return 1278.75e6;
+        }
+        break;
+    case 2:
+        if (glo_chan == OBS_NO_CHAN) return 0.0;
+        if (band == '1') return 1602.0e6 + glo_chan * 0.5625e6;
+        if (band == '2') return 1246.0e6 + glo_chan * 0.4375e6;
+        break;
+    case 3:
+        switch (band) {
+        case '1': return 1575.42e6;
+        case '5': return 1176.45e6;
+        case '6': return 1278.75e6;
+        case '7': return 1207.14e6;
+        case '8': return 1191.795e6;
+        }
+        break;
+    case 5:
+        switch (band) {
+        case '1': return 1575.42e6;
+        case '2': return 1561.098e6;
+        case '5': return 1176.45e6;
+        case '6': return 1268.52e6;
+        case '7': return 1207.14e6;
+        case '8': return 1191.795e6;
+        }
+        break;
+    case 7:
+        if (band == '5') return 1176.45e6;
+        if (band == '9') return 2492.028e6;
+        break;
+    }
+    return 0.0;
+}
+
+/* ── Producer: epochs from MSM frames ─────────────────────────────────── */
+
+/* Hand the open epoch to the writer. */
+static void obs_queue(RinexObsWriter *w)
+{
+    w->cur_open = false;
+    if (w->cur.n == 0) return;
+    w->cur.arp_valid = w->arp_valid;
+    memcpy(w->cur.arp, w->arp, sizeof(w->arp));
+    memcpy(w->cur.glo_chan, w->glo_chan, sizeof(w->glo_chan));
+
+    uint64_t head = w->head;
+    while (head - OBS_LOAD(&w->tail) >= RINEX_OBS_SLOTS) {
+        if (!w->wait || OBS_LOAD(&w->failed)) {
+            OBS_ADD(&w->dropped, 1);
+            return;
+        }
+        obs_sleep_ms(1);
+    }
+    memcpy(&w->slots[head % RINEX_OBS_SLOTS], &w->cur, EPOCH_BYTES(&w->cur));
+    OBS_STORE(&w->head, head + 1);
+}
+
+static void obs_add_msm(RinexObsWriter *w, const RtcmMsmObs *o)
+{
+    int g = o->gnss_id;
+    if (g < 1 || g >= OBS_MAX_GNSS || o->num_cells == 0) return;
+    if (w->station < 0) {
+        w->station = o->ref_station_id;
+    } else if (o->ref_station_id != w->station) {
+        OBS_ADD(&w->other_station, 1);
+        return;
+    }
+    /* Near the last epoch, or the time hint for the first one */
+    int64_t t = stream_clock_msm_gps_ms(g, o->epoch_time,
+                                        w->last_ms >= 0 ? w->last_ms : w->hint_ms);
+    if (t < 0) return;
+    if (w->cur_open) {
+        if (t < w->cur.t_ms) {
+            OBS_ADD(&w->late, 1);
+            return;
+        }
+        if (t > w->cur.t_ms) obs_queue(w);
+    }
+    if (!w->cur_open) {
+        w->cur.t_ms = t;
+        w->cur.n    = 0;
+        w->cur_open = true;
+    }
+    w->last_ms = t;
+
+    /* MSM5/7 carry the GLONASS channel (DF419, 0..13 = channel + 7) */
+    const bool ext = o->msm_subtype == 5 || o->msm_subtype == 7;
+    if (g == 2 && ext) {
+        for (int s = 0; s < o->num_sats; s++) {
+            int prn = o->sats[s].prn;
+            if (prn >= 1 && prn <= OBS_MAX_PRN && o->sats[s].ext_info <= 13)
+                w->glo_chan[prn - 1] = (int8_t)(o->sats[s].ext_info - 7);
+        }
+    }
+
+    for (int c = 0; c < o->num_cells; c++) {
+        const RtcmMsmCell *cell = &o->cells[c];
+        const RtcmMsmSat  *sat  = &o->sats[cell->sat];
+        if (sat->prn < 1 || sat->prn > OBS_MAX_PRN ||
+            cell->sig_idx < 0 || cell->sig_idx >= OBS_MAX_SIGS)
+            continue;
+        if (w->cur.n == RINEX_OBS_MAX_CELLS) {
+            OBS_ADD(&w->overflow, 1);
+            continue;
+        }
+        ObsCell *oc = &w->cur.cells[w->cur.n];
+        if (!obs_signal_code(g, cell->sig_idx, oc->code)) continue;
+        oc->gnss_id    = (uint8_t)g;
+        oc->prn        = (uint8_t)sat->prn;
+        oc->sig_idx    = (uint8_t)cell->sig_idx;
+        oc->msm        = (uint8_t)o->msm_subtype;
+        oc->glo_chan   = g == 2 ? w->glo_chan[sat->prn - 1] : OBS_NO_CHAN;
+        oc->half_cycle = cell->half_cycle;
+        oc->lock       = cell->lock;
+        oc->cnr_dbhz   = cell->cnr_dbhz;
+        oc->pr_m       = cell->pr_m;
+        oc->ph_m       = cell->ph_m;
+        /* DF399 / DF404 invalid: -8192 / -16384 */
+        oc->has_rate   = ext && sat->rough_rate != -8192 && cell->fine_rate != -16384;
+        oc->rate_mps   = oc->has_rate ? sat->rough_rate + cell->fine_rate * 0.0001 : 0.0;
+        w->cur.n++;
+    }
+}
+
+static void obs_add_arp(RinexObsWriter *w, const unsigned char *payload, int len)
+{
+    RtcmStationArp a;
+    if (!rtcm_decode_arp(payload, len, &a)) return;
+    w->arp[0] = a.x;
+    w->arp[1] = a.y;
+    w->arp[2] = a.z;
+    w->arp_valid = true;
+}
+
+/* 1020: DF038 satellite slot, DF040 frequency channel + 7. */
+static void obs_add_glo_eph(RinexObsWriter *w, const unsigned char *payload, int len)
+{
+    if (len < 3) return;
+    int slot = (int)get_bits(payload, 12, 6);
+    int chan = (int)get_bits(payload, 18, 5) - 7;
+    if (slot >= 1 && slot <= OBS_MAX_PRN && chan >= -7 && chan <= 13)
+        w->glo_chan[slot - 1] = (int8_t)chan;
+}
+
+void rinex_obs_add_frame(RinexObsWriter *w, const unsigned char *frame, int frame_len)
+{
+    if (!w || !frame || frame_len < 6 + 2) return;
+    const unsigned char *payload = frame + 3;
+    int len = frame_len - 6;
+    int mt = ((int)payload[0] << 4) | ((int)payload[1] >> 4);
+    if (rtcm_msg_is_msm(mt, 1, 7)) {
+        RtcmMsmObs obs;
+        if (rtcm_decode_msm(payload, len, &obs)) obs_add_msm(w, &obs);
+    } else if (mt == 1005 || mt == 1006) {
+        obs_add_arp(w, payload, len);
+    } else if (mt == 1020) {
+        obs_add_glo_eph(w, payload, len);
+    }
+}
+
+/* ── Writer: header and epoch records ─────────────────────────────────── */
+
+/* Calendar date of GPS time @p t_ms (GPS time scale, no leap seconds). */
+static void obs_civil(int64_t t_ms, int *y, int *mo, int *d, int *h, int *mi, double *s)
+{
+    int64_t days = t_ms / DAY_MS;
+    int64_t ms   = t_ms % DAY_MS;
+    int64_t z    = days + 3657 + 719468;            /* 1980-01-06 is Unix day 3657 */
+    int64_t era  = z / 146097;
+    int64_t doe  = z - era * 146097;
+    int64_t yoe  = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy  = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp   = (5 * doy + 2) / 153;
+    int     m    = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y  = (int)(yoe + era * 400) + (m <= 2);
+    *mo = m;
+    *d  = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *h  = (int)(ms / 3600000);
+    *mi = (int)(ms / 60000 % 60);
+    *s  = (double)(ms % 60000) / 1000.0;
+}
+
+/* One header line: 60 columns of content and the label. */
+static void hdr_line(RinexObsWriter *w, const char *content, const char *label)
+{
+    fprintf(w->f, "%-60.60s%-20s\n", content, label);
+}
+
+/* Columns for the kinds the MSM subtype of @p c carries.  Returns true
+ * if a new type was added to its GNSS. */
+static bool obs_register(RinexObsWriter *w, const ObsCell *c)
+{
+    static const bool carries[8][N_KINDS] = {
+        { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 1, 1, 0, 0 },
+        { 1, 1, 0, 1 }, { 1, 1, 1, 1 }, { 1, 1, 0, 1 }, { 1, 1, 1, 1 }
+    };
+    int g = c->gnss_id;
+    bool added = false;
+    for (int k = 0; k < N_KINDS; k++) {
+        if (!carries[c->msm & 7][k] || w->col[g][c->sig_idx][k] >= 0) continue;
+        if (w->n_types[g] == OBS_MAX_TYPES) break;
+        int n = w->n_types[g]++;
+        w->types[g][n][0] = k_kind[k];
+        w->types[g][n][1] = c->code[0];
+        w->types[g][n][2] = c->code[1];
+        w->types[g][n][3] = '\0';
+        w->col[g][c->sig_idx][k] = (int8_t)n;
+        w->sys_changed[g] = true;
+        added = true;
+    }
+    return added;
+}
+
+/* SYS / # / OBS TYPES of @p g; returns the number of lines (also when
+ * @p write is false, to count them for an event record). */
+static int hdr_obs_types(RinexObsWriter *w, int g, bool write)
+{
+    int n = w->n_types[g];
+    int lines = (n + 12) / 13;
+    for (int l = 0; write && l < lines; l++) {
+        char buf[64];
+        int k = l ? snprintf(buf, sizeof(buf), "      ")
+                  : snprintf(buf, sizeof(buf), "%c  %3d", k_sys[g], n);
+        for (int i = l * 13; i < n && i < (l + 1) * 13; i++)
+            k += snprintf(buf + k, sizeof(buf) - k, " %s", w->types[g][i]);
+        hdr_line(w, buf, "SYS / # / OBS TYPES");
+    }
+    return lines;
+}
+
+static void hdr_position(RinexObsWriter *w, const ObsEpoch *e)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%14.4f%14.4f%14.4f",
+             e ? e->arp[0] : 0.0, e ? e->arp[1] : 0.0, e ? e->arp[2] : 0.0);
+    hdr_line(w, buf, "APPROX POSITION XYZ");
+}
+
+static void obs_write_header(RinexObsWriter *w)
+{
+    uint64_t tail = w->tail, head = OBS_LOAD(&w->head);
+    const ObsEpoch *first = tail != head ? &w->slots[tail % RINEX_OBS_SLOTS] : NULL;
+    const ObsEpoch *pos = NULL, *last = NULL;
+    for (uint64_t i = tail; i != head; i++) {
+        const ObsEpoch *e = &w->slots[i % RINEX_OBS_SLOTS];
+        for (int c = 0; c < e->n; c++) obs_register(w, &e->cells[c]);
+        if (e->arp_valid) pos = e;
+        last = e;
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%9.2f%11s%-20s%-20s", 3.04, "", "OBSERVATION DATA", "M");
+    hdr_line(w, buf, "RINEX VERSION / TYPE");
+    snprintf(buf, sizeof(buf), "%-20s%-20s%-20s", "NTRIP-Analyser", "", w->run_date);
+    hdr_line(w, buf, "PGM / RUN BY / DATE");
+    hdr_line(w, w->marker, "MARKER NAME");
+    hdr_line(w, "", "OBSERVER / AGENCY");
+    hdr_line(w, "", "REC # / TYPE / VERS");
+    hdr_line(w, "", "ANT # / TYPE");
+    hdr_position(w, pos);
+    w->header_arp = pos != NULL;
+    snprintf(buf, sizeof(buf), "%14.4f%14.4f%14.4f", 0.0, 0.0, 0.0);
+    hdr_line(w, buf, "ANTENNA: DELTA H/E/N");
+    for (int g = 1; g < OBS_MAX_GNSS; g++) {
+        if (w->n_types[g]) hdr_obs_types(w, g, true);
+        w->sys_changed[g] = false;
+    }
+    hdr_line(w, "DBHZ", "SIGNAL STRENGTH UNIT");
+    if (first) {
+        int y, mo, d, h, mi;
+        double s;
+        obs_civil(first->t_ms, &y, &mo, &d, &h, &mi, &s);
+        snprintf(buf, sizeof(buf), "%6d%6d%6d%6d%6d%13.7f%5s%3s", y, mo, d, h, mi, s, "", "GPS");
+        hdr_line(w, buf, "TIME OF FIRST OBS");
+    }
+    for (int g = 1; g < OBS_MAX_GNSS; g++)
+        if (w->n_types[g]) {
+            snprintf(buf, sizeof(buf), "%c", k_sys[g]);
+            hdr_line(w, buf, "SYS / PHASE SHIFT");
+        }
+    if (w->n_types[2]) {
+        /* Channels known so far; phases of the others stay blank. */
+        int n = 0;
+        for (int p = 0; last && p < OBS_MAX_PRN; p++) n += last->glo_chan[p] != OBS_NO_CHAN;
+        int k = snprintf(buf, sizeof(buf), "%3d ", n);
+        int on_line = 0;
+        for (int p = 0; last && p < OBS_MAX_PRN; p++) {
+            if (last->glo_chan[p] == OBS_NO_CHAN) continue;
+            if (on_line == 8) {
+                hdr_line(w, buf, "GLONASS SLOT / FRQ #");
+                k = snprintf(buf, sizeof(buf), "    ");
+                on_line = 0;
+            }
+            k += snprintf(buf + k, sizeof(buf) - k, "R%02d %2d ", p + 1, last->glo_chan[p]);
+            on_line++;
+        }
+        hdr_line(w, buf, "GLONASS SLOT / FRQ #");
+        hdr_line(w, "", "GLONASS COD/PHS/BIS");
+    }
+    hdr_line(w, "", "END OF HEADER");
+    w->header_done = true;
+}
+
+/* Cells of one epoch in output order: GNSS, PRN, signal, richest MSM first. */
+static int obs_cell_cmp(const void *a, const void *b)
+{
+    const ObsCell *x = *(const ObsCell *const *)a;
+    const ObsCell *y = *(const ObsCell *const *)b;
+    if (x->gnss_id != y->gnss_id) return x->gnss_id - y->gnss_id;
+    if (x->prn != y->prn)         return x->prn - y->prn;
+    if (x->sig_idx != y->sig_idx) return x->sig_idx - y->sig_idx;
+    return y->msm - x->msm;
+}
+
+typedef struct {
+    double  v[OBS_MAX_TYPES];
+    uint8_t set[OBS_MAX_TYPES];
+    char    lli[OBS_MAX_TYPES];
+    char    ssi[OBS_MAX_TYPES];
+} ObsRow;
+
+/* Fill the columns of cell @p c into @p row. */
+static void obs_fill(RinexObsWriter *w, const ObsCell *c, ObsRow *row)
+{
+    int g = c->gnss_id;
+    const int8_t *col = w->col[g][c->sig_idx];
+    double f = obs_freq_hz(g, c->code[0], c->glo_chan);
+    double lambda = f > 0.0 ? RTCM_LIGHT_MS * 1000.0 / f : 0.0;
+
+    if (col[KIND_C] >= 0 && c->pr_m != 0.0 && c->msm != 2) {
+        row->v[col[KIND_C]]   = c->pr_m;
+        row->set[col[KIND_C]] = 1;
+    }
+    if (col[KIND_L] >= 0 && c->ph_m != 0.0 && c->msm >= 2 && lambda > 0.0) {
+        int n = col[KIND_L];
+        row->v[n]   = c->ph_m / lambda;
+        row->set[n] = 1;
+        /* A lock time that went down is a loss of lock.  DF402 and DF407
+         * are not comparable, so only within the same MSM family. */
+        int lli = 0;
+        uint8_t *pm = &w->lock_msm[g][c->prn - 1][c->sig_idx];
+        uint16_t *pl = &w->lock_prev[g][c->prn - 1][c->sig_idx];
+        bool ext = c->msm >= 6;
+        if (*pm && (*pm >= 6) == ext && c->lock < *pl) lli |= 1;
+        if (c->half_cycle) lli |= 2;
+        *pm = c->msm;
+        *pl = c->lock;
+        row->lli[n] = lli ? (char)('0' + lli) : ' ';
+        if (c->cnr_dbhz > 0.0f) {
+            int ssi = (int)(c->cnr_dbhz / 6.0f);
+            row->ssi[n] = (char)('0' + (ssi < 1 ? 1 : ssi > 9 ? 9 : ssi));
+        }
+    }
+    if (col[KIND_D] >= 0 && c->has_rate && lambda > 0.0) {
+        row->v[col[KIND_D]]   = -c->rate_mps / lambda;
+        row->set[col[KIND_D]] = 1;
+    }
+    if (col[KIND_S] >= 0 && c->cnr_dbhz > 0.0f) {
+        row->v[col[KIND_S]]   = c->cnr_dbhz;
+        row->set[col[KIND_S]] = 1;
+    }
+}
+
+/* Header lines inside the data (event flag 4) for what changed since the
+ * header: new observation types, a position that was not known yet. */
+static void obs_write_event(RinexObsWriter *w, const ObsEpoch *e)
+{
+    bool pos = e->arp_valid && !w->header_arp;
+    int lines = pos;
+    for (int g = 1; g < OBS_MAX_GNSS; g++)
+        if (w->sys_changed[g]) lines += hdr_obs_types(w, g, false);
+    if (!lines) return;
+    fprintf(w->f, ">%30s%d%3d\n", "", 4, lines);
+    if (pos) {
+        hdr_position(w, e);
+        w->header_arp = true;
+    }
+    for (int g = 1; g < OBS_MAX_GNSS; g++)
+        if (w->sys_changed[g]) {
+            hdr_obs_types(w, g, true);
+            w->sys_changed[g] = false;
+        }
+}
+
+static void obs_write_epoch(RinexObsWriter *w, const ObsEpoch *e)
+{
+    const ObsCell *order[RINEX_OBS_MAX_CELLS];
+    for (int c = 0; c < e->n; c++) {
+        order[c] = &e->cells[c];
+        obs_register(w, &e->cells[c]);
+    }
+    obs_write_event(w, e);
+    qsort(order, (size_t)e->n, sizeof(order[0]), obs_cell_cmp);
+
+    int n_sats = 0;
+    for (int c = 0; c < e->n; c++)
+        if (!c || order[c]->gnss_id != order[c - 1]->gnss_id ||
+            order[c]->prn != order[c - 1]->prn)
+            n_sats++;
+    int y, mo, d, h, mi;
+    double s;
+    obs_civil(e->t_ms, &y, &mo, &d, &h, &mi, &s);
+    fprintf(w->f, "> %4d %02d %02d %02d %02d%11.7f  %d%3d\n", y, mo, d, h, mi, s, 0, n_sats);
+
+    static ObsRow row;          /* writer thread only */
+    char line[32 + OBS_MAX_TYPES * 16];
+    for (int c = 0; c < e->n; ) {
+        const ObsCell *sv = order[c];
+        int g = sv->gnss_id;
+        int n = w->n_types[g];
+        memset(row.set, 0, (size_t)n);
+        memset(row.lli, ' ', (size_t)n);
+        memset(row.ssi, ' ', (size_t)n);
+        for (; c < e->n && order[c]->gnss_id == g && order[c]->prn == sv->prn; c++) {
+            /* The same signal from two MSM flavours: keep the richer one */
+            if (c > 0 && order[c - 1]->gnss_id == g && order[c - 1]->prn == sv->prn &&
+                order[c - 1]->sig_idx == order[c]->sig_idx)
+                continue;
+            obs_fill(w, order[c], &row);
+        }
+        int prn = g == 6 ? sv->prn + 19 : sv->prn;      /* SBAS: PRN 120.. = S20.. */
+        int k = snprintf(line, sizeof(line), "%c%02d", k_sys[g], prn);
+        int end = k;
+        for (int i = 0; i < n; i++) {
+            if (row.set[i]) {
+                double v = row.v[i];
+                if (v > 9999999999.999 || v < -999999999.999) v = 0.0;   /* F14.3 */
+                k += snprintf(line + k, sizeof(line) - k, "%14.3f%c%c", v, row.lli[i], row.ssi[i]);
+                end = k;
+            } else {
+                k += snprintf(line + k, sizeof(line) - k, "%16s", "");
+            }
+        }
+        while (end > 3 && line[end - 1] == ' ') end--;
+        line[end] = '\0';
+        fprintf(w->f, "%s\n", line);
+    }
+    OBS_ADD(&w->epochs, 1);
+}
+
+/* ── Writer thread ────────────────────────────────────────────────────── */
+
+/* Header once enough is queued, then every queued epoch.  Returns the
+ * number of epochs written. */
+static size_t obs_drain(RinexObsWriter *w, bool stop)
+{
+    uint64_t head = OBS_LOAD(&w->head);
+    if (!w->header_done) {
+        bool ready = stop || head - w->tail >= RINEX_OBS_HOLD;
+        for (uint64_t i = w->tail; !ready && i != head; i++)
+            ready = w->slots[i % RINEX_OBS_SLOTS].arp_valid;
+        if (!ready) return 0;
+        obs_write_header(w);
+    }
+    size_t n = 0;
+    for (; w->tail != head; n++) {
+        obs_write_epoch(w, &w->slots[w->tail % RINEX_OBS_SLOTS]);
+        OBS_STORE(&w->tail, w->tail + 1);
+    }
+    if (ferror(w->f)) OBS_STORE(&w->failed, 1);
+    return n;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall obs_thread(void *arg)
+#else
+static void *obs_thread(void *arg)
+#endif
+{
+    RinexObsWriter *w = (RinexObsWriter *)arg;
+    for (;;) {
+        /* Sample stop before draining so the last epochs are written. */
+        int stop = OBS_LOAD(&w->stop);
+        if (obs_drain(w, stop != 0) > 0) continue;
+        if (stop) break;
+        int64_t now = stream_clock_wall_ns();
+        if (now - w->last_flush_ns >= OBS_FLUSH_NS) {
+            if (fflush(w->f) != 0) OBS_STORE(&w->failed, 1);
+            w->last_flush_ns = now;
+        }
+        obs_sleep_ms(OBS_IDLE_MS);
+    }
+    if (fclose(w->f) != 0) OBS_STORE(&w->failed, 1);
+    w->f = NULL;
+    return 0;
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+RinexObsWriter *rinex_obs_open(const char *path, const char *marker, bool wait,
+                               int64_t t_hint)
+{
+    if (!path) return NULL;
+    RinexObsWriter *w = (RinexObsWriter *)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->slots = (ObsEpoch *)malloc(RINEX_OBS_SLOTS * sizeof(ObsEpoch));
+    w->f     = w->slots ? fopen(path, "w") : NULL;
+    if (!w->f) {
+        free(w->slots);
+        free(w);
+        return NULL;
+    }
+    setvbuf(w->f, NULL, _IOFBF, OBS_IO_BUF);
+    w->wait    = wait;
+    w->last_ms = -1;
+    w->station = -1;
+    memset(w->glo_chan, OBS_NO_CHAN, sizeof(w->glo_chan));
+    memset(w->col, -1, sizeof(w->col));
+    snprintf(w->marker, sizeof(w->marker), "%s", marker ? marker : "");
+    time_t now = time(NULL);
+    int64_t unix_s = t_hint > 0 ? t_hint : (int64_t)now;
+    w->hint_ms = stream_clock_unix_to_gps_ms(unix_s);
+    struct tm *gt = gmtime(&now);
+    if (!gt || !strftime(w->run_date, sizeof(w->run_date), "%Y%m%d %H%M%S UTC", gt))
+        w->run_date[0] = '\0';
+    w->last_flush_ns = stream_clock_wall_ns();
+
+#ifdef _WIN32
+    w->thread = (HANDLE)_beginthreadex(NULL, 0, obs_thread, w, 0, NULL);
+    bool started = w->thread != NULL;
+#else
+    bool started = pthread_create(&w->thread, NULL, obs_thread, w) == 0;
+#endif
+    if (!started) {
+        fclose(w->f);
+        free(w->slots);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+void rinex_obs_stats(const RinexObsWriter *w, RinexObsStats *st)
+{
+    st->epochs        = OBS_LOAD(&w->epochs);
+    st->dropped       = OBS_LOAD(&w->dropped);
+    st->late          = OBS_LOAD(&w->late);
+    st->other_station = OBS_LOAD(&w->other_station);
+    st->overflow      = OBS_LOAD(&w->overflow);
+    st->failed        = OBS_LOAD(&w->failed) != 0;
+}
+
+bool rinex_obs_close(RinexObsWriter *w, RinexObsStats *st)
+{
+    if (!w) return false;
+    if (w->cur_open) obs_queue(w);
+    OBS_STORE(&w->stop, 1);
+#ifdef _WIN32
+    WaitForSingleObject(w->thread, INFINITE);
+    CloseHandle(w->thread);
+#else
+    pthread_join(w->thread, NULL);
+#endif
+    RinexObsStats s;
+    rinex_obs_stats(w, &s);
+    if (st) *st = s;
+    free(w->slots);
+    free(w);
+    return !s.failed;
+}
+
+bool rinex_obs_is_path(const char *path)
+{
+    size_t len = path ? strlen(path) : 0;
+    if (len < 4 || path[len - 4] != '.') return false;
+    const char *ext = path + len - 3;
+    char e[3];
+    for (int i = 0; i < 3; i++)
+        e[i] = (char)(ext[i] >= 'A' && ext[i] <= 'Z' ? ext[i] - 'A' + 'a' : ext[i]);
+    if (memcmp(e, "obs", 3) == 0 || memcmp(e, "rnx", 3) == 0) return true;
+    return e[0] >= '0' && e[0] <= '9' && e[1] >= '0' && e[1] <= '9' && e[2] == 'o';
+}
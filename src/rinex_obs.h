@@ -0,0 +1,126 @@
+/**
+ * @file rinex_obs.h
+ * @brief Streaming RINEX 3.04 observation writer fed with MSM frames.
+ *
+ * Turning a stream or capture into RINEX OBS with an external converter
+ * means a second full decode of every frame.  @ref RinexObsWriter takes
+ * the frames the analyser already receives and writes the observation
+ * file while the stream runs:
+ *   - rinex_obs_add_frame() decodes MSM1..7 (rtcm_decode_msm()) on the
+ *     receiving thread and assembles the cells of all GNSS with the same
+ *     GPS time into one epoch.  An epoch is complete when an MSM frame of
+ *     a later time arrives, as in sky_epoch.h; late frames are counted
+ *     and dropped.  1005/1006 give the approximate position, 1020 and
+ *     MSM5/7 the GLONASS frequency channels.
+ *   - Complete epochs go through a fixed ring of @ref RINEX_OBS_SLOTS
+ *     slots to a writer thread, which formats and writes them, so memory
+ *     is bounded and the receiving thread never touches the disk.  With
+ *     a full ring a live stream drops the epoch (counted); a capture or
+ *     stdin (@c wait = true) waits for a slot instead.
+ *   - The header needs the observation types and the position before the
+ *     first epoch.  The writer holds back up to @ref RINEX_OBS_HOLD
+ *     epochs until a 1005/1006 has been seen and takes the types from
+ *     them; a signal that first shows up later is announced with an
+ *     event-flag 4 record (header lines inside the data), which RINEX 3
+ *     readers apply from that epoch on.
+ *
+ * Observables per signal: C (pseudorange, m), L (carrier phase, cycles),
+ * D (Doppler from the MSM5/7 phase-range rate, Hz) and S (CNR, dB-Hz), as
+ * far as the MSM subtype carries them.  L has LLI bit 0 when the lock-time
+ * indicator went down (cycle slip) and bit 1 while the half-cycle
+ * ambiguity flag is set, and an SSI from the CNR.  GLONASS phase and
+ * Doppler need the frequency channel and are left blank until it is
+ * known.  Times are GPS time; BeiDou and GLONASS epochs are converted.
+ *
+ * One writer serves one stream (one producer thread).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RINEX_OBS_H
+#define RINEX_OBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Cells (satellite x signal) one epoch can hold, all GNSS together. */
+#define RINEX_OBS_MAX_CELLS  1024
+
+/** @brief Epochs queued between the receiving thread and the writer. */
+#define RINEX_OBS_SLOTS      32
+
+/** @brief Epochs held back for the header while no 1005/1006 was seen. */
+#define RINEX_OBS_HOLD       16
+
+/**
+ * @struct RinexObsStats
+ * @brief Writer counters, safe to read while writing.
+ *
+ * Fields:
+ *   - epochs:   Epochs written.
+ *   - dropped:  Epochs lost because the ring was full.
+ *   - late:     MSM frames older than the epoch being assembled.
+ *   - other_station: MSM frames of another reference station ID than the
+ *               first one, ignored.
+ *   - overflow: Cells beyond @ref RINEX_OBS_MAX_CELLS in one epoch.
+ *   - failed:   The file could not be written.
+ */
+typedef struct {
+    uint64_t epochs;
+    uint64_t dropped;
+    uint64_t late;
+    uint64_t other_station;
+    uint64_t overflow;
+    bool     failed;
+} RinexObsStats;
+
+/** @brief Opaque writer (owns its writer thread). */
+typedef struct RinexObsWriter RinexObsWriter;
+
+/**
+ * @brief Create @p path and start the writer thread.
+ *
+ * @param path    Output file.
+ * @param marker  MARKER NAME of the header (mountpoint, capture name).
+ * @param wait    Wait for a free slot instead of dropping the epoch when
+ *                the writer falls behind (captures, stdin).
+ * @param t_hint  Unix time (s) within half a week of the data, which
+ *                fixes the GPS week MSM time of week does not carry: the
+ *                start of a native capture, or 0 for the system clock.
+ * @return The writer, or NULL if the file or the thread cannot be created.
+ */
+RinexObsWriter *rinex_obs_open(const char *path, const char *marker, bool wait,
+                               int64_t t_hint);
+
+/**
+ * @brief Feed one RTCM frame (0xD3 preamble to CRC); anything but MSM,
+ *        1005/1006 and 1020 is ignored.  Always call from the same thread.
+ */
+void rinex_obs_add_frame(RinexObsWriter *w, const unsigned char *frame, int frame_len);
+
+/** @brief Snapshot of the counters. */
+void rinex_obs_stats(const RinexObsWriter *w, RinexObsStats *st);
+
+/**
+ * @brief Queue the epoch being assembled, write out everything, close the
+ *        file and free @p w.
+ *
+ * @param st  [out] Final counters (may be NULL).
+ * @return false if the file could not be written completely.
+ */
+bool rinex_obs_close(RinexObsWriter *w, RinexObsStats *st);
+
+/** @brief true if @p path names a RINEX observation file: *.obs, *.rnx or *.YYo. */
+bool rinex_obs_is_path(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINEX_OBS_H */
@@ -0,0 +1,362 @@
+/**
+ * @file rollup.c
+ * @brief Bounded-memory time-series rollups: 1 s / 1 min / 15 min rings.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include "rollup.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int k_step[ROLLUP_TIERS]   = { 1, 60, 900 };
+static const int k_length[ROLLUP_TIERS] = { 3600, 1440, 2880 };
+
+#define ROLLUP_BUCKETS (3600 + 1440 + 2880)
+
+/* One resolution of a series: a window into the series' bucket block. */
+typedef struct {
+    RollupBucket *b;
+    int64_t       head;         /* slot of the newest bucket */
+    bool          used;         /* head is set */
+} RollupRing;
+
+typedef struct {
+    char         name[ROLLUP_NAME_MAX];
+    RollupKind   kind;
+    RollupRing   ring[ROLLUP_TIERS];
+    RollupBucket *block;        /* ROLLUP_BUCKETS, all rings */
+} RollupSeries;
+
+struct RollupStore {
+    int          n;
+    RollupSeries s[ROLLUP_MAX_SERIES];
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t  lock;
+#endif
+};
+
+static void rollup_lock(RollupStore *r)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&r->lock);
+#else
+    pthread_mutex_lock(&r->lock);
+#endif
+}
+
+static void rollup_unlock(RollupStore *r)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&r->lock);
+#else
+    pthread_mutex_unlock(&r->lock);
+#endif
+}
+
+RollupStore *rollup_store_new(void)
+{
+    RollupStore *r = (RollupStore *)calloc(1, sizeof(RollupStore));
+    if (!r) return NULL;
+#ifdef _WIN32
+    InitializeCriticalSection(&r->lock);
+#else
+    pthread_mutex_init(&r->lock, NULL);
+#endif
+    return r;
+}
+
+static void rollup_drop_all(RollupStore *r)
+{
+    for (int i = 0; i < r->n; i++) free(r->s[i].block);
+    memset(r->s, 0, sizeof(r->s));
+    r->n = 0;
+}
+
+void rollup_store_free(RollupStore *r)
+{
+    if (!r) return;
+    rollup_drop_all(r);
+#ifdef _WIN32
+    DeleteCriticalSection(&r->lock);
+#else
+    pthread_mutex_destroy(&r->lock);
+#endif
+    free(r);
+}
+
+void rollup_store_clear(RollupStore *r)
+{
+    if (!r) return;
+    rollup_lock(r);
+    rollup_drop_all(r);
+    rollup_unlock(r);
+}
+
+static int rollup_find_locked(const RollupStore *r, const char *name)
+{
+    for (int i = 0; i < r->n; i++)
+        if (strcmp(r->s[i].name, name) == 0) return i;
+    return -1;
+}
+
+int rollup_series(RollupStore *r, const char *name, RollupKind kind)
+{
+    if (!r || !name || strlen(name) >= ROLLUP_NAME_MAX) return -1;
+    rollup_lock(r);
+    int id = rollup_find_locked(r, name);
+    if (id < 0 && r->n < ROLLUP_MAX_SERIES) {
+        RollupBucket *block = (RollupBucket *)calloc(ROLLUP_BUCKETS, sizeof(RollupBucket));
+        if (block) {
+            RollupSeries *s = &r->s[r->n];
+            snprintf(s->name, sizeof(s->name), "%s", name);
+            s->kind  = kind;
+            s->block = block;
+            for (int k = 0, off = 0; k < ROLLUP_TIERS; off += k_length[k], k++)
+                s->ring[k].b = block + off;
+            id = r->n++;
+        }
+    }
+    rollup_unlock(r);
+    return id;
+}
+
+int rollup_find(RollupStore *r, const char *name)
+{
+    if (!r || !name) return -1;
+    rollup_lock(r);
+    int id = rollup_find_locked(r, name);
+    rollup_unlock(r);
+    return id;
+}
+
+/* Add v to the bucket of slot; buckets between the old head and a newer
+ * slot are cleared first (at most the whole ring, once). */
+static void ring_add(RollupRing *g, int len, int64_t slot, float v)
+{
+    if (!g->used) {
+        g->head = slot;
+        g->used = true;
+    } else if (slot > g->head) {
+        int64_t gap = slot - g->head;
+        if (gap >= len) {
+            memset(g->b, 0, (size_t)len * sizeof(RollupBucket));
+        } else {
+            for (int64_t k = g->head + 1; k <= slot; k++)
+                memset(&g->b[k % len], 0, sizeof(RollupBucket));
+        }
+        g->head = slot;
+    } else if (slot <= g->head - len) {
+        return;                             /* older than the ring */
+    }
+    RollupBucket *b = &g->b[slot % len];
+    if (b->n == 0) {
+        b->sum = b->min = b->max = v;
+    } else {
+        b->sum += v;
+        if (v < b->min) b->min = v;
+        if (v > b->max) b->max = v;
+    }
+    b->n++;
+}
+
+void rollup_add(RollupStore *r, int id, double t, double v)
+{
+    if (!r || id < 0 || t < 0.0 || !isfinite(v)) return;
+    rollup_lock(r);
+    if (id < r->n) {
+        RollupSeries *s = &r->s[id];
+        for (int k = 0; k < ROLLUP_TIERS; k++)
+            ring_add(&s->ring[k], k_length[k], (int64_t)(t / k_step[k]), (float)v);
+    }
+    rollup_unlock(r);
+}
+
+int rollup_count(RollupStore *r)
+{
+    if (!r) return 0;
+    rollup_lock(r);
+    int n = r->n;
+    rollup_unlock(r);
+    return n;
+}
+
+bool rollup_info(RollupStore *r, int id, char name[ROLLUP_NAME_MAX], RollupKind *kind)
+{
+    if (!r) return false;
+    rollup_lock(r);
+    bool ok = id >= 0 && id < r->n;
+    if (ok) {
+        if (name) memcpy(name, r->s[id].name, ROLLUP_NAME_MAX);
+        if (kind) *kind = r->s[id].kind;
+    }
+    rollup_unlock(r);
+    return ok;
+}
+
+static int rollup_read_locked(const RollupSeries *s, RollupTier tier, double since,
+                              RollupPoint *out, int max)
+{
+    const RollupRing *g = &s->ring[tier];
+    int len = k_length[tier], step = k_step[tier];
+    if (!g->used || max <= 0) return 0;
+
+    /* Walk back from the newest bucket until max are found, then write
+     * them out oldest first. */
+    int64_t first = g->head - len + 1;
+    if (first < 0) first = 0;
+    int64_t lo = (int64_t)ceil(since / step);
+    if (lo > first) first = lo;
+    int found = 0;
+    int64_t slot = g->head;
+    for (; slot >= first && found < max; slot--)
+        if (g->b[slot % len].n) found++;
+    int n = 0;
+    for (slot++; slot <= g->head && n < found; slot++) {
+        const RollupBucket *b = &g->b[slot % len];
+        if (!b->n) continue;
+        RollupPoint *p = &out[n++];
+        p->t     = (double)slot * step;
+        p->value = s->kind == ROLLUP_GAUGE ? (double)b->sum / b->n : (double)b->sum;
+        p->min   = b->min;
+        p->max   = b->max;
+        p->n     = b->n;
+    }
+    return n;
+}
+
+int rollup_read(RollupStore *r, int id, RollupTier tier, double since,
+                RollupPoint *out, int max)
+{
+    if (!r || tier < 0 || tier >= ROLLUP_TIERS) return 0;
+    rollup_lock(r);
+    int n = id >= 0 && id < r->n ? rollup_read_locked(&r->s[id], tier, since, out, max) : 0;
+    rollup_unlock(r);
+    return n;
+}
+
+int rollup_tier_length(RollupTier tier)
+{
+    return tier >= 0 && tier < ROLLUP_TIERS ? k_length[tier] : 0;
+}
+
+int rollup_tier_step(RollupTier tier)
+{
+    return tier >= 0 && tier < ROLLUP_TIERS ? k_step[tier] : 0;
+}
+
+const char *rollup_tier_name(RollupTier tier)
+{
+    switch (tier) {
+    case ROLLUP_1S:  return "1s";
+    case ROLLUP_1M:  return "1m";
+    case ROLLUP_15M: return "15m";
+    default:         return "?";
+    }
+}
+
+bool rollup_tier_parse(const char *s, RollupTier *tier)
+{
+    if (!s) return false;
+    if (strcmp(s, "1s") == 0)                              *tier = ROLLUP_1S;
+    else if (strcmp(s, "1m") == 0 || strcmp(s, "60s") == 0)  *tier = ROLLUP_1M;
+    else if (strcmp(s, "15m") == 0 || strcmp(s, "900s") == 0) *tier = ROLLUP_15M;
+    else return false;
+    return true;
+}
+
+/* ── JSON ─────────────────────────────────────────────────────────────── */
+
+typedef struct {
+    char  *p;
+    size_t len, cap;
+    bool   oom;
+} RollupText;
+
+static void rt_printf(RollupText *t, const char *fmt, ...)
+{
+    if (t->oom) return;
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int k = vsnprintf(t->p + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        if (k < 0) {
+            t->oom = true;
+            return;
+        }
+        if ((size_t)k < t->cap - t->len) {
+            t->len += (size_t)k;
+            return;
+        }
+        size_t cap = t->cap * 2;
+        while (cap - t->len <= (size_t)k) cap *= 2;
+        char *p = (char *)realloc(t->p, cap);
+        if (!p) {
+            t->oom = true;
+            return;
+        }
+        t->p   = p;
+        t->cap = cap;
+    }
+}
+
+char *rollup_json(RollupStore *r, const char *prefix, RollupTier tier, double since,
+                  size_t *len)
+{
+    if (len) *len = 0;
+    if (!r || tier < 0 || tier >= ROLLUP_TIERS) return NULL;
+    RollupText t = { (char *)malloc(4096), 0, 4096, false };
+    RollupPoint *pts = (RollupPoint *)malloc((size_t)k_length[ROLLUP_1S] * sizeof(RollupPoint));
+    if (!t.p || !pts) {
+        free(t.p);
+        free(pts);
+        return NULL;
+    }
+    size_t plen = prefix ? strlen(prefix) : 0;
+
+    rt_printf(&t, "[");
+    bool first = true;
+    for (int id = 0; id < rollup_count(r); id++) {
+        char name[ROLLUP_NAME_MAX];
+        RollupKind kind;
+        if (!rollup_info(r, id, name, &kind) || strncmp(name, prefix ? prefix : "", plen) != 0)
+            continue;
+        /* Copied out under the lock, formatted without it */
+        int n = rollup_read(r, id, tier, since, pts, k_length[tier]);
+        rt_printf(&t, "%s{\"name\":\"%s\",\"kind\":\"%s\",\"points\":[", first ? "" : ",",
+                  name, kind == ROLLUP_GAUGE ? "gauge" : "counter");
+        for (int i = 0; i < n; i++) {
+            const RollupPoint *p = &pts[i];
+            if (kind == ROLLUP_GAUGE)
+                rt_printf(&t, "%s[%.0f,%.6g,%.6g,%.6g]", i ? "," : "", p->t, p->value,
+                          (double)p->min, (double)p->max);
+            else
+                rt_printf(&t, "%s[%.0f,%.9g]", i ? "," : "", p->t, p->value);
+        }
+        rt_printf(&t, "]}");
+        first = false;
+    }
+    rt_printf(&t, "]");
+    free(pts);
+    if (t.oom) {
+        free(t.p);
+        return NULL;
+    }
+    if (len) *len = t.len;
+    return t.p;
+}
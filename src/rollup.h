@@ -0,0 +1,159 @@
+/**
+ * @file rollup.h
+ * @brief Bounded-memory time-series rollups for sessions that run for
+ *        days or weeks.
+ *
+ * A long session either keeps everything (the sky tracks) or nothing
+ * beyond totals.  A RollupStore keeps named series -- counters (frames,
+ * bytes) and gauges (satellites, CNR, age quantiles) -- at three
+ * resolutions, each a fixed ring of buckets:
+ *
+ *   - 1 s for the last hour       (@ref ROLLUP_1S,  3600 buckets)
+ *   - 1 min for the last day      (@ref ROLLUP_1M,  1440 buckets)
+ *   - 15 min for the last 30 days (@ref ROLLUP_15M, 2880 buckets)
+ *
+ * Downsampling happens on insert: rollup_add() adds the value to the
+ * bucket of its second, minute and quarter hour at once, so nothing is
+ * ever re-read or compacted.  A bucket holds the sum, minimum, maximum
+ * and number of the values added to it; a counter reports the sum, a
+ * gauge the mean (with min / max).  Buckets sit at slot % length, the
+ * slot being the time divided by the step; moving past the newest slot
+ * clears the buckets skipped, so a gap in the data reads as a gap.
+ *
+ * A series costs 124 kB whatever the uptime; a store holds up to
+ * @ref ROLLUP_MAX_SERIES of them, allocated when first named.  Every
+ * call takes the store's lock, so one thread may add (once a second or
+ * per observation) while another reads.  Times are Unix seconds
+ * (stream_clock_utc_ns() / 1e9), so buckets line up with the clock and
+ * the points read back carry real timestamps.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Series per store. */
+#define ROLLUP_MAX_SERIES  96
+
+/** @brief Longest series name, incl. NUL ("frames.1077", "sats.Galileo"). */
+#define ROLLUP_NAME_MAX    32
+
+/** @brief The resolutions. */
+typedef enum {
+    ROLLUP_1S = 0,
+    ROLLUP_1M,
+    ROLLUP_15M,
+    ROLLUP_TIERS
+} RollupTier;
+
+/** @brief How a bucket is reported. */
+typedef enum {
+    ROLLUP_COUNTER = 0,         /**< sum of the values added (per step) */
+    ROLLUP_GAUGE                /**< mean, min and max of the values added */
+} RollupKind;
+
+/** @brief One bucket; n == 0 is empty. */
+typedef struct {
+    float    sum;
+    float    min;
+    float    max;
+    uint32_t n;
+} RollupBucket;
+
+/** @brief One bucket as read back. */
+typedef struct {
+    double   t;                 /**< start of the bucket, Unix s */
+    double   value;             /**< counter: sum; gauge: mean */
+    float    min;
+    float    max;
+    uint32_t n;                 /**< values added */
+} RollupPoint;
+
+/** @brief A store of series.  Opaque. */
+typedef struct RollupStore RollupStore;
+
+/** @brief Empty store; NULL when out of memory. */
+RollupStore *rollup_store_new(void);
+
+/** @brief Free @p r and its series (NULL is ignored). */
+void rollup_store_free(RollupStore *r);
+
+/** @brief Drop every series (a new stream); the memory is freed. */
+void rollup_store_clear(RollupStore *r);
+
+/**
+ * @brief Id of series @p name, created (empty) if it does not exist.
+ *
+ * @return 0 .. ROLLUP_MAX_SERIES - 1; -1 when the store is full, the
+ *         name too long or memory out.  An existing series keeps its kind.
+ */
+int rollup_series(RollupStore *r, const char *name, RollupKind kind);
+
+/** @brief Id of series @p name; -1 if there is none. */
+int rollup_find(RollupStore *r, const char *name);
+
+/** @brief Add @p v at Unix time @p t to series @p id at every resolution. */
+void rollup_add(RollupStore *r, int id, double t, double v);
+
+/** @brief Series so far (ids 0 .. n-1). */
+int rollup_count(RollupStore *r);
+
+/**
+ * @brief Name and kind of series @p id.
+ * @return false for an unknown id.
+ */
+bool rollup_info(RollupStore *r, int id, char name[ROLLUP_NAME_MAX], RollupKind *kind);
+
+/**
+ * @brief The non-empty buckets of series @p id at resolution @p tier
+ *        that start at or after @p since, oldest first.
+ *
+ * @param max  Room in @p out; the newest @p max are returned when there
+ *             are more.
+ * @return Points written.
+ */
+int rollup_read(RollupStore *r, int id, RollupTier tier, double since,
+                RollupPoint *out, int max);
+
+/** @brief Buckets of @p tier. */
+int rollup_tier_length(RollupTier tier);
+
+/** @brief Seconds per bucket of @p tier. */
+int rollup_tier_step(RollupTier tier);
+
+/** @brief "1s", "1m" or "15m". */
+const char *rollup_tier_name(RollupTier tier);
+
+/** @brief Parse "1s", "1m" or "15m" (also "60s", "900s"). */
+bool rollup_tier_parse(const char *s, RollupTier *tier);
+
+/**
+ * @brief The series whose names start with @p prefix ("" or NULL = all)
+ *        as a JSON array, malloc()ed and NUL-terminated:
+ * @code
+ *   [{"name":"frames.1077","kind":"counter","points":[[t,sum],...]},
+ *    {"name":"sats.GPS","kind":"gauge","points":[[t,mean,min,max],...]}]
+ * @endcode
+ *
+ * @param len  [out] Length without the NUL; may be NULL.
+ * @return NULL when out of memory.
+ */
+char *rollup_json(RollupStore *r, const char *prefix, RollupTier tier, double since,
+                  size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROLLUP_H */
@@ -20,6 +20,8 @@
 #include <string.h>
 #include <math.h>
 #include "rtcm3x_parser.h"
+#include "rtcm_fmt.h"
+#include "rtcm_unpack.h"
 #include "sv_ephemeris.h"
 
 /* ── Redirectable output buffer for decode functions ──────── */
@@ -52,12 +54,103 @@ void rtcm_set_output_buffer(RtcmStrBuf *sb) {
     g_rtcm_strbuf = sb;
 }
 
+/* rtcm_decode_eph(): where the ephemeris decoders copy their result. */
+static __thread SvEphemeris *g_eph_out;
+static __thread bool         g_eph_got;
+static __thread bool         g_eph_no_store;    /* rtcm_set_eph_store(false) */
+
+void rtcm_set_eph_store(bool on) {
+    g_eph_no_store = !on;
+}
+
+/* Every ephemeris decoder hands its result here: the shared store, and
+ * the caller of rtcm_decode_eph() if there is one. */
+static void eph_decoded(const SvEphemeris *eph)
+{
+    if (!g_eph_no_store) sv_eph_store(eph);
+    if (g_eph_out) {
+        *g_eph_out = *eph;
+        g_eph_out->valid = true;
+        g_eph_got = true;
+    }
+}
+
+/* Text of a frame decoded for stdout (no buffer set): collected here and
+ * written with one fwrite when analyze_rtcm_message() is done with the
+ * frame, instead of one vprintf per field.  The buffer is kept for the
+ * next frame; it grows to the largest frame's text. */
+static __thread RtcmStrBuf g_rtcm_frame_buf;
+static __thread int        g_rtcm_frame_depth;
+
+/* Free space rtcm_printf() makes sure of before formatting, so a line
+ * is formatted once; only a longer one is formatted again after growing. */
+#define RTCM_OUT_HEADROOM 256
+
+/* The buffer text currently goes to, or NULL for stdout directly. */
+static RtcmStrBuf *rtcm_out_target(void) {
+    if (g_rtcm_strbuf && g_rtcm_strbuf->buf) return g_rtcm_strbuf;
+    if (g_rtcm_frame_depth > 0) return &g_rtcm_frame_buf;
+    return NULL;
+}
+
+/* Room for need more bytes plus the NUL, growing by doubling. */
+static bool rtcm_strbuf_reserve(RtcmStrBuf *sb, int need) {
+    if (sb->cap - sb->len > need) return true;
+    int new_cap = sb->cap > 0 ? sb->cap * 2 : 1024;
+    while (new_cap - sb->len <= need) new_cap *= 2;
+    char *tmp = (char *)realloc(sb->buf, new_cap);
+    if (!tmp) return false;
+    sb->buf = tmp;
+    sb->cap = new_cap;
+    return true;
+}
+
+/* Append n preformatted bytes to the output. */
+static void rtcm_out_write(const char *s, int n) {
+    RtcmStrBuf *sb = rtcm_out_target();
+    if (!sb) {
+        fwrite(s, 1, (size_t)n, stdout);
+        return;
+    }
+    if (!rtcm_strbuf_reserve(sb, n)) return;
+    memcpy(sb->buf + sb->len, s, (size_t)n);
+    sb->len += n;
+    sb->buf[sb->len] = '\0';
+}
+
+/* Expected text size of a frame, so the buffer grows once up front:
+ * an MSM prints a line per cell, an ephemeris a screenful. */
+static int rtcm_out_hint(int msg_type, int payload_len) {
+    const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+    if (!info) return 256;
+    if (info->flags & RTCM_MSG_F_MSM) return 1024 + 12 * payload_len;
+    if (info->flags & RTCM_MSG_F_EPH) return 2048;
+    return 512;
+}
+
+/* Bracket the decoding of one frame; the outermost end writes the
+ * collected stdout text. */
+static void rtcm_out_frame_begin(int size_hint) {
+    g_rtcm_frame_depth++;
+    RtcmStrBuf *sb = rtcm_out_target();
+    if (sb) rtcm_strbuf_reserve(sb, size_hint);
+}
+
+static void rtcm_out_frame_end(void) {
+    if (--g_rtcm_frame_depth > 0) return;
+    if (g_rtcm_frame_buf.len > 0) {
+        fwrite(g_rtcm_frame_buf.buf, 1, (size_t)g_rtcm_frame_buf.len, stdout);
+        g_rtcm_frame_buf.len = 0;
+    }
+}
+
 /**
  * @brief Printf replacement that writes to g_rtcm_strbuf when set, otherwise outputs to stdout.
  * 
  * This function provides redirectable output for all RTCM decode functions. When a string buffer
  * is set via rtcm_set_output_buffer(), all output is captured into that buffer. Otherwise, 
- * output goes to stdout. The buffer automatically expands if needed.
+ * output goes to stdout, collected per frame inside analyze_rtcm_message(). The buffer
+ * automatically expands if needed.
  * 
  * @param fmt Printf-style format string.
  * @param ... Variable arguments matching the format string.
@@ -68,98 +161,188 @@ void rtcm_set_output_buffer(RtcmStrBuf *sb) {
 static void rtcm_printf(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    if (g_rtcm_strbuf && g_rtcm_strbuf->buf) {
-        int avail = g_rtcm_strbuf->cap - g_rtcm_strbuf->len;
-        va_list ap2;
-        va_copy(ap2, ap);
-        int n = vsnprintf(g_rtcm_strbuf->buf + g_rtcm_strbuf->len, avail, fmt, ap2);
-        va_end(ap2);
-        if (n >= avail) {
-            /* Grow buffer */
-            int new_cap = g_rtcm_strbuf->cap * 2;
-            if (new_cap < g_rtcm_strbuf->len + n + 1)
-                new_cap = g_rtcm_strbuf->len + n + 1;
-            char *tmp = (char *)realloc(g_rtcm_strbuf->buf, new_cap);
-            if (tmp) {
-                g_rtcm_strbuf->buf = tmp;
-                g_rtcm_strbuf->cap = new_cap;
-                vsnprintf(g_rtcm_strbuf->buf + g_rtcm_strbuf->len,
-                          g_rtcm_strbuf->cap - g_rtcm_strbuf->len, fmt, ap);
+    RtcmStrBuf *sb = rtcm_out_target();
+    if (sb) {
+        if (rtcm_strbuf_reserve(sb, RTCM_OUT_HEADROOM)) {
+            int avail = sb->cap - sb->len;
+            va_list ap2;
+            va_copy(ap2, ap);
+            int n = vsnprintf(sb->buf + sb->len, avail, fmt, ap2);
+            va_end(ap2);
+            if (n >= avail) {
+                /* Longer than the headroom: grow and format again */
+                if (rtcm_strbuf_reserve(sb, n))
+                    vsnprintf(sb->buf + sb->len, sb->cap - sb->len, fmt, ap);
+                else
+                    n = avail - 1;
             }
+            if (n > 0) sb->len += n;
         }
-        if (n > 0) g_rtcm_strbuf->len += n;
     } else {
         vprintf(fmt, ap);
     }
     va_end(ap);
 }
 
-uint32_t crc24q(const uint8_t *data, size_t length) {
-    uint32_t crc = 0x000000;
-    const uint32_t poly = 0x1864CFB;
+/* ── CRC-24Q (slicing-by-8) ───────────────────────────────────────────
+ *
+ * The CRC register is kept left-aligned in a 32-bit word (bits 31..8) so
+ * the table step is a plain "shift out the top byte" like the common
+ * MSB-first CRC-32 implementations.  crc24q_tab[k][b] is the register
+ * contribution of byte b followed by k zero bytes, which lets the main
+ * loop fold 8 input bytes with 8 independent lookups instead of 64
+ * conditional shifts.
+ *
+ * Tables are built once, on first use.  The build is published with an
+ * atomic flag (same __atomic builtins as sv_ephemeris.c) because the obs
+ * and eph worker threads can both hit crc24q() first; a thread that
+ * loses the race just uses the bytewise fallback for that one call.
+ *
+ * On x86 with PCLMULQDQ (checked with __builtin_cpu_supports(), as the
+ * AVX2 unpacker in rtcm_unpack.c) frames of 32 bytes or more are folded
+ * 16 bytes per carry-less multiply instead; see crc24q_clmul(). */
+#define CRC24Q_POLY_LA (0x864CFBu << 8)   /* poly 0x1864CFB, left-aligned */
+
+#if !defined(NTRIP_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define CRC24Q_CLMUL 1
+#include <immintrin.h>
+
+/* x^192 and x^128 mod P(x)*x^8, the left-aligned polynomial; set with
+ * the tables. */
+static uint64_t crc24q_fold_k1, crc24q_fold_k2;
+
+/* x^n mod P(x)*x^8, bit i = coefficient of x^i. */
+static uint64_t crc24q_xpow_mod(int n) {
+    uint64_t r = 1;
+    while (n--) {
+        r <<= 1;
+        if (r & 0x100000000ull) r ^= 0x1864CFB00ull;
+    }
+    return r;
+}
+#endif
+
+static uint32_t crc24q_tab[8][256];
+static int      crc24q_tab_state = 0;     /* 0 = empty, 1 = building, 2 = ready */
+
+static void crc24q_build_tables(void) {
+    for (int b = 0; b < 256; b++) {
+        uint32_t crc = (uint32_t)b << 24;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x80000000u) ? (crc << 1) ^ CRC24Q_POLY_LA : (crc << 1);
+        crc24q_tab[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int b = 0; b < 256; b++) {
+            uint32_t prev = crc24q_tab[k - 1][b];
+            crc24q_tab[k][b] = (prev << 8) ^ crc24q_tab[0][prev >> 24];
+        }
+    }
+#ifdef CRC24Q_CLMUL
+    crc24q_fold_k1 = crc24q_xpow_mod(192);
+    crc24q_fold_k2 = crc24q_xpow_mod(128);
+#endif
+}
 
+/* Bit-serial reference, used only until the tables are published. */
+static uint32_t crc24q_bitwise(uint32_t crc, const uint8_t *data, size_t length) {
     for (size_t i = 0; i < length; i++) {
-        crc ^= ((uint32_t)data[i]) << 16;
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x800000)
-                crc = ((crc << 1) ^ poly) & 0xFFFFFF;
-            else
-                crc = (crc << 1) & 0xFFFFFF;
-        }
+        crc ^= (uint32_t)data[i] << 24;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x80000000u) ? (crc << 1) ^ CRC24Q_POLY_LA : (crc << 1);
     }
     return crc;
 }
 
-uint64_t get_bits(const unsigned char *buf, int start_bit, int bit_len) {
-    uint64_t result = 0;
-    for (int i = 0; i < bit_len; ++i) {
-        int byte = (start_bit + i) / 8;
-        int bit = 7 - ((start_bit + i) % 8);
-        result = (result << 1) | ((buf[byte] >> bit) & 1);
-    }
-    return result;
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8)  |  (uint32_t)p[3];
 }
 
-int64_t extract_signed38(const unsigned char *buf, int start_bit) {
-    uint64_t raw = get_bits(buf, start_bit, 38);
-    if ((raw >> 37) & 1) {
-        // Negative number
-        return -((int64_t)((1ULL << 38) - raw));
-    } else {
-        return (int64_t)raw;
-    }
+/* Fold 8 bytes into the register. */
+static inline uint32_t crc24q_step8(uint32_t crc, const uint8_t *p) {
+    uint32_t w1 = crc ^ load_be32(p);
+    uint32_t w2 = load_be32(p + 4);
+    return crc24q_tab[7][w1 >> 24]          ^ crc24q_tab[6][(w1 >> 16) & 0xFF] ^
+           crc24q_tab[5][(w1 >> 8) & 0xFF]  ^ crc24q_tab[4][w1 & 0xFF]         ^
+           crc24q_tab[3][w2 >> 24]          ^ crc24q_tab[2][(w2 >> 16) & 0xFF] ^
+           crc24q_tab[1][(w2 >> 8) & 0xFF]  ^ crc24q_tab[0][w2 & 0xFF];
+}
+
+#ifdef CRC24Q_CLMUL
+/* Fold the 16-byte blocks of @p data (at least two, @p blocks in all)
+ * into one 128-bit remainder A, congruent to them mod P(x)*x^8: a block
+ * B after A makes A*x^128 + B, and A*x^128 is A's upper half times
+ * x^192 plus its lower half times x^128, each product at most 96 bits.
+ * The CRC of the blocks is then that of A's 16 bytes, which @p out
+ * receives big-endian for the table loop. */
+__attribute__((target("pclmul,ssse3")))
+static void crc24q_clmul(const uint8_t *data, size_t blocks, uint8_t out[16]) {
+    const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                        7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i k = _mm_set_epi64x((long long)crc24q_fold_k1,
+                                     (long long)crc24q_fold_k2);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), bswap);
+    for (size_t i = 1; i < blocks; i++) {
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), bswap);
+        a = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x11),
+                                        _mm_clmulepi64_si128(a, k, 0x00)), b);
+    }
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(a, bswap));
+}
+#endif
+
+const char *crc24q_impl(void) {
+#ifdef CRC24Q_CLMUL
+    if (__builtin_cpu_supports("pclmul")) return "pclmul";
+#endif
+    return "table";
 }
 
-int64_t extract_signed(const unsigned char *buf, int start_bit, int bit_len) {
-    uint64_t val = get_bits(buf, start_bit, bit_len);
-    // Sign-extend if needed
-    if (val & ((uint64_t)1 << (bit_len - 1))) {
-        val |= (~0ULL) << bit_len;
+uint32_t crc24q(const uint8_t *data, size_t length) {
+    int state = __atomic_load_n(&crc24q_tab_state, __ATOMIC_ACQUIRE);
+    if (state != 2) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&crc24q_tab_state, &expected, 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            crc24q_build_tables();
+            __atomic_store_n(&crc24q_tab_state, 2, __ATOMIC_RELEASE);
+        } else {
+            return crc24q_bitwise(0, data, length) >> 8;
+        }
     }
-    return (int64_t)val;
+
+    uint32_t crc = 0;
+#ifdef CRC24Q_CLMUL
+    if (length >= 32 && __builtin_cpu_supports("pclmul")) {
+        uint8_t rem[16];
+        size_t blocks = length / 16;
+        crc24q_clmul(data, blocks, rem);
+        data   += 16 * blocks;
+        length -= 16 * blocks;
+        crc = crc24q_step8(crc24q_step8(0, rem), rem + 8);
+    }
+#endif
+    while (length >= 8) {
+        crc = crc24q_step8(crc, data);
+        data   += 8;
+        length -= 8;
+    }
+    while (length--)
+        crc = (crc << 8) ^ crc24q_tab[0][(crc >> 24) ^ *data++];
+    return crc >> 8;
 }
 
-int msm_extract_prns(const unsigned char *payload, int payload_len,
-                     int msg_type, int *prns_out, int max_prns,
-                     int *gnss_id_out)
+bool msm_extract_sat_mask(const unsigned char *payload, int payload_len,
+                          int msg_type, uint64_t *mask_out, uint32_t *epoch_out,
+                          int *gnss_id_out)
 {
-    if (!payload || payload_len < 14 || !prns_out || max_prns <= 0) return 0;
-
-    /* MSM4/5/6/7 only — message numbers ending in 4..7 of any GNSS range */
-    int subtype = msg_type % 10;
-    if (msg_type < 1070 || msg_type > 1139 || subtype < 4 || subtype > 7) return 0;
-
-    /* Map RTCM range to GNSS ID, matching get_gnss_id_from_rtcm() */
-    int gnss_id;
-    if      (msg_type >= 1070 && msg_type <  1080) gnss_id = 1;   /* GPS */
-    else if (msg_type >= 1080 && msg_type <  1090) gnss_id = 2;   /* GLONASS */
-    else if (msg_type >= 1090 && msg_type < 1100)  gnss_id = 3;   /* Galileo */
-    else if (msg_type >= 1100 && msg_type < 1110)  gnss_id = 6;   /* SBAS */
-    else if (msg_type >= 1110 && msg_type < 1120)  gnss_id = 4;   /* QZSS */
-    else if (msg_type >= 1120 && msg_type < 1130)  gnss_id = 5;   /* BeiDou */
-    else if (msg_type >= 1130 && msg_type < 1140)  gnss_id = 7;   /* NavIC */
-    else return 0;
-    if (gnss_id_out) *gnss_id_out = gnss_id;
+    if (!payload || payload_len < 14 || !mask_out) return false;
+
+    /* MSM4/5/6/7 only; the registry also supplies the GNSS ID. */
+    if (!rtcm_msg_is_msm(msg_type, 4, 7)) return false;
+    if (gnss_id_out) *gnss_id_out = rtcm_msg_gnss_id(msg_type);
 
     /* MSM header layout (RTCM 10403.3, fixed 169-bit header):
      *   12 msg_number, 12 ref_station_id, 30 epoch_time, 1 MM, 3 IODS,
@@ -167,10 +350,24 @@ int msm_extract_prns(const unsigned char *payload, int payload_len,
      *   64 satellite_mask, 32 signal_mask, ...cell_mask follows
      * Total before satellite_mask = 12+12+30+1+3+7+2+2+1+3 = 73 bits.
      */
-    int bit = 73;
-    if ((bit + 64) > payload_len * 8) return 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 73);
+    if (rtcm_br_left(&br) < 64) return false;
 
-    uint64_t sat_mask = get_bits(payload, bit, 64);
+    *mask_out = rtcm_br_read(&br, 64);
+    if (epoch_out) *epoch_out = (uint32_t)rtcm_bits_at(payload, payload_len, 24, 30);
+    return true;
+}
+
+int msm_extract_prns(const unsigned char *payload, int payload_len,
+                     int msg_type, int *prns_out, int max_prns,
+                     int *gnss_id_out)
+{
+    if (!prns_out || max_prns <= 0) return 0;
+
+    uint64_t sat_mask;
+    if (!msm_extract_sat_mask(payload, payload_len, msg_type, &sat_mask, NULL, gnss_id_out))
+        return 0;
 
     int count = 0;
     for (int i = 0; i < 64 && count < max_prns; i++) {
@@ -182,24 +379,45 @@ int msm_extract_prns(const unsigned char *payload, int payload_len,
     return count;
 }
 
+/* ── Decoder context ─────────────────────────────────────────────────────
+ * The default context backs every function without a context argument;
+ * zero-initialised, which is what rtcm_decoder_ctx_init() produces. */
+static RtcmDecoderCtx g_default_ctx;
+
+void rtcm_decoder_ctx_init(RtcmDecoderCtx *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+RtcmDecoderCtx *rtcm_decoder_default(void)
+{
+    return &g_default_ctx;
+}
+
 /* ── Per-band CNR cache ───────────────────────────────────────────────────
  * Updated by msm7_update_per_band_cnr each time an MSM7 frame arrives;
  * read by the SV detail window to show one CNR value per signal-mask
- * bit position.  Indexed by [gnss_id][prn-1][sig_idx (0-based, MSB-first)].
- * Values in dB-Hz; 0.0 means "no observation for that signal". */
-#define CNR_MAX_GNSS    8
-#define CNR_MAX_PRN     64
-#define CNR_MAX_SIGS    32
-static float g_msm7_per_band_cnr[CNR_MAX_GNSS][CNR_MAX_PRN][CNR_MAX_SIGS];
-
-void get_sv_per_band_cnr(int gnss_id, int prn, float out_cnr[CNR_MAX_SIGS])
+ * bit position.  Lives in RtcmDecoderCtx::cnr, indexed by
+ * [gnss_id][prn-1][sig_idx (0-based, MSB-first)].  Values in dB-Hz;
+ * 0.0 means "no observation for that signal". */
+#define CNR_MAX_GNSS    RTCM_CNR_MAX_GNSS
+#define CNR_MAX_PRN     RTCM_CNR_MAX_PRN
+#define CNR_MAX_SIGS    RTCM_CNR_MAX_SIGS
+
+void rtcm_ctx_get_sv_per_band_cnr(const RtcmDecoderCtx *ctx, int gnss_id, int prn,
+                                  float out_cnr[CNR_MAX_SIGS])
 {
     if (!out_cnr) return;
     for (int i = 0; i < CNR_MAX_SIGS; i++) out_cnr[i] = 0.0f;
     if (gnss_id < 0 || gnss_id >= CNR_MAX_GNSS) return;
     if (prn < 1 || prn > CNR_MAX_PRN)           return;
     for (int i = 0; i < CNR_MAX_SIGS; i++)
-        out_cnr[i] = g_msm7_per_band_cnr[gnss_id][prn - 1][i];
+        out_cnr[i] = ctx->cnr[gnss_id][prn - 1][i];
+}
+
+void get_sv_per_band_cnr(int gnss_id, int prn, float out_cnr[CNR_MAX_SIGS])
+{
+    rtcm_ctx_get_sv_per_band_cnr(&g_default_ctx, gnss_id, prn, out_cnr);
 }
 
 /* ── MSM signal-mask label tables (RTCM 10403.3 Tables 3.5-91 .. 3.5-96) ─
@@ -275,204 +493,116 @@ const char *msm_signal_label(int gnss_id, int sig_idx)
     return fallback;
 }
 
-void msm7_update_per_band_cnr(const unsigned char *payload, int payload_len,
-                              int msg_type)
+void rtcm_msm_obs_update_per_band_cnr(const RtcmMsmObs *obs)
 {
-    if (!payload) return;
-    if (msg_type < 1070 || msg_type > 1139 || msg_type % 10 != 7) return;
-
-    int gnss_id;
-    if      (msg_type >= 1070 && msg_type <  1080) gnss_id = 1;
-    else if (msg_type >= 1080 && msg_type <  1090) gnss_id = 2;
-    else if (msg_type >= 1090 && msg_type <  1100) gnss_id = 3;
-    else if (msg_type >= 1100 && msg_type <  1110) gnss_id = 6;
-    else if (msg_type >= 1110 && msg_type <  1120) gnss_id = 4;
-    else if (msg_type >= 1120 && msg_type <  1130) gnss_id = 5;
-    else if (msg_type >= 1130 && msg_type <  1140) gnss_id = 7;
-    else return;
-    if (gnss_id >= CNR_MAX_GNSS) return;
-
-    const int total_bits = payload_len * 8;
-    if (total_bits < 169) return;
-
-    uint64_t sat_mask = get_bits(payload, 73, 64);
-    uint32_t sig_mask = (uint32_t)get_bits(payload, 137, 32);
-
-    /* sat list (PRN per index) and sig list (0-based bit position per
-     * index, MSB-first so it matches RTCM "Signal N" ordering). */
-    int sat_prns[64];
-    int num_sats = 0;
-    for (int i = 0; i < 64; i++) {
-        if ((sat_mask >> (63 - i)) & 1ULL) {
-            if (num_sats < 64) sat_prns[num_sats] = i + 1;
-            num_sats++;
-        }
-    }
-    if (num_sats == 0 || num_sats > 64) return;
+    rtcm_ctx_update_per_band_cnr(&g_default_ctx, obs);
+}
 
-    int sig_idx_list[32];
-    int num_sigs = 0;
-    for (int i = 0; i < 32; i++) {
-        if ((sig_mask >> (31 - i)) & 1U) {
-            if (num_sigs < 32) sig_idx_list[num_sigs] = i;
-            num_sigs++;
-        }
-    }
-    if (num_sigs == 0) return;
+void rtcm_ctx_update_per_band_cnr(RtcmDecoderCtx *ctx, const RtcmMsmObs *obs)
+{
+    if (!obs || obs->msm_subtype < 4) return;   /* MSM1..3 carry no CNR */
+    if (obs->gnss_id < 0 || obs->gnss_id >= CNR_MAX_GNSS) return;
+    if (obs->num_sats == 0 || obs->num_sigs == 0) return;
+
+    float (*rows)[CNR_MAX_SIGS] = ctx->cnr[obs->gnss_id];
 
     /* Zero out the rows we're about to touch so stale signals from the
      * previous frame don't linger (a satellite may drop a band). */
-    for (int s = 0; s < num_sats; s++) {
-        int prn = sat_prns[s];
-        if (prn < 1 || prn > CNR_MAX_PRN) continue;
-        for (int i = 0; i < CNR_MAX_SIGS; i++)
-            g_msm7_per_band_cnr[gnss_id][prn - 1][i] = 0.0f;
-    }
-
-    const int cell_mask_start  = 169;
-    const int cell_block_start = cell_mask_start
-                                 + num_sats * num_sigs
-                                 + 36 * num_sats;
-    const int cnr_offset_in_cell = 55;
-    const int cell_stride = 80;
-
-    int cell_index = 0;
-    for (int s = 0; s < num_sats; s++) {
-        int prn = sat_prns[s];
-        for (int sg = 0; sg < num_sigs; sg++) {
-            int cell_mask_bit = cell_mask_start + s * num_sigs + sg;
-            if (cell_mask_bit + 1 > total_bits) break;
-            if (!get_bits(payload, cell_mask_bit, 1)) continue;
-
-            int cnr_bit = cell_block_start + cell_index * cell_stride
-                          + cnr_offset_in_cell;
-            cell_index++;
-            if (cnr_bit + 10 > total_bits) continue;
-
-            uint32_t cnr_raw = (uint32_t)get_bits(payload, cnr_bit, 10);
-            float cnr_dbhz = (float)cnr_raw * 0.0625f;
-
-            int sig_idx = sig_idx_list[sg];   /* 0-based bit position, MSB-first */
-            if (prn >= 1 && prn <= CNR_MAX_PRN && sig_idx >= 0 && sig_idx < CNR_MAX_SIGS)
-                g_msm7_per_band_cnr[gnss_id][prn - 1][sig_idx] = cnr_dbhz;
-        }
+    for (int s = 0; s < obs->num_sats; s++)
+        memset(rows[obs->sats[s].prn - 1], 0, sizeof(rows[0]));
+
+    for (int c = 0; c < obs->num_cells; c++) {
+        const RtcmMsmCell *cell = &obs->cells[c];
+        rows[obs->sats[cell->sat].prn - 1][cell->sig_idx] = cell->cnr_dbhz;
     }
 }
 
-int msm7_extract_cnr(const unsigned char *payload, int payload_len,
-                     int msg_type,
-                     int *prns_out, float *cnr_out, int max_prns,
-                     int *gnss_id_out)
+int rtcm_msm_obs_best_cnr(const RtcmMsmObs *obs,
+                          int *prns_out, float *cnr_out, int max_prns)
 {
-    if (!payload || !prns_out || !cnr_out || max_prns <= 0) return 0;
-
-    /* MSM7 only: 1077 / 1087 / 1097 / 1117 / 1127 / 1137.  MSM4/5/6 have
-     * different per-cell block sizes and CNR widths; out of scope for v1. */
-    if (msg_type < 1070 || msg_type > 1139 || msg_type % 10 != 7) return 0;
-
-    int gnss_id;
-    if      (msg_type >= 1070 && msg_type <  1080) gnss_id = 1;
-    else if (msg_type >= 1080 && msg_type <  1090) gnss_id = 2;
-    else if (msg_type >= 1090 && msg_type <  1100) gnss_id = 3;
-    else if (msg_type >= 1100 && msg_type <  1110) gnss_id = 6;
-    else if (msg_type >= 1110 && msg_type <  1120) gnss_id = 4;
-    else if (msg_type >= 1120 && msg_type <  1130) gnss_id = 5;
-    else if (msg_type >= 1130 && msg_type <  1140) gnss_id = 7;
-    else return 0;
-    if (gnss_id_out) *gnss_id_out = gnss_id;
-
-    const int total_bits = payload_len * 8;
-    if (total_bits < 169) return 0;
-
-    /* Read sat mask (bit 73, 64 bits) and sig mask (bit 137, 32 bits). */
-    uint64_t sat_mask = get_bits(payload, 73, 64);
-    uint32_t sig_mask = (uint32_t)get_bits(payload, 137, 32);
-
-    /* Sat list */
-    int sat_prns[64];
-    int num_sats = 0;
-    for (int i = 0; i < 64; i++) {
-        if ((sat_mask >> (63 - i)) & 1ULL) {
-            if (num_sats < 64) sat_prns[num_sats] = i + 1;
-            num_sats++;
-        }
-    }
-    if (num_sats == 0) return 0;
-    if (num_sats > 64) num_sats = 64;
-
-    /* Sig count */
-    int num_sigs = 0;
-    for (int i = 0; i < 32; i++)
-        if ((sig_mask >> (31 - i)) & 1U) num_sigs++;
-    if (num_sigs == 0) return 0;
-
-    const int cell_mask_start  = 169;
-    const int cell_block_start = cell_mask_start
-                                 + num_sats * num_sigs
-                                 + 36 * num_sats;
-    /* Per-cell CNR offset (after PR 20 + PH 24 + lock 10 + half 1) */
-    const int cnr_offset = 55;
-    const int cell_stride = 80;
+    if (!obs || !prns_out || !cnr_out || max_prns <= 0) return 0;
+    if (obs->msm_subtype < 4) return 0;
+    if (obs->num_sats == 0 || obs->num_sigs == 0) return 0;
 
     /* Best CNR per satellite-index */
-    float best_cnr[64];
-    for (int i = 0; i < num_sats; i++) best_cnr[i] = 0.0f;
-
-    int cell_index = 0;
-    for (int s = 0; s < num_sats; s++) {
-        for (int sg = 0; sg < num_sigs; sg++) {
-            int cell_mask_bit = cell_mask_start + s * num_sigs + sg;
-            if (cell_mask_bit + 1 > total_bits) break;
-            if (!get_bits(payload, cell_mask_bit, 1)) continue;
-
-            int cnr_bit = cell_block_start + cell_index * cell_stride + cnr_offset;
-            if (cnr_bit + 10 > total_bits) {
-                cell_index++;
-                continue;
-            }
-            uint32_t cnr_raw = (uint32_t)get_bits(payload, cnr_bit, 10);
-            float cnr_dbhz = (float)cnr_raw * 0.0625f;
-            if (cnr_dbhz > best_cnr[s]) best_cnr[s] = cnr_dbhz;
-
-            cell_index++;
-        }
+    float best_cnr[RTCM_MSM_MAX_SATS];
+    for (int i = 0; i < obs->num_sats; i++) best_cnr[i] = 0.0f;
+    for (int c = 0; c < obs->num_cells; c++) {
+        const RtcmMsmCell *cell = &obs->cells[c];
+        if (cell->cnr_dbhz > best_cnr[cell->sat]) best_cnr[cell->sat] = cell->cnr_dbhz;
     }
 
-    int out_count = (num_sats < max_prns) ? num_sats : max_prns;
+    int out_count = (obs->num_sats < max_prns) ? obs->num_sats : max_prns;
     for (int i = 0; i < out_count; i++) {
-        prns_out[i] = sat_prns[i];
+        prns_out[i] = obs->sats[i].prn;
         cnr_out[i]  = best_cnr[i];
     }
     return out_count;
 }
 
+int rtcm_msm_obs_prns(const RtcmMsmObs *obs, int *prns_out, int max_prns)
+{
+    if (!obs || !prns_out || max_prns <= 0) return 0;
+    int n = (obs->num_sats < max_prns) ? obs->num_sats : max_prns;
+    for (int i = 0; i < n; i++) prns_out[i] = obs->sats[i].prn;
+    return n;
+}
+
+void msm7_update_per_band_cnr(const unsigned char *payload, int payload_len,
+                              int msg_type)
+{
+    if (!payload) return;
+    if (!rtcm_msg_is_msm(msg_type, 7, 7)) return;
+
+    RtcmMsmObs obs;
+    if (rtcm_decode_msm(payload, payload_len, &obs))
+        rtcm_msm_obs_update_per_band_cnr(&obs);
+}
+
+int msm7_extract_cnr(const unsigned char *payload, int payload_len,
+                     int msg_type,
+                     int *prns_out, float *cnr_out, int max_prns,
+                     int *gnss_id_out)
+{
+    if (!payload || !prns_out || !cnr_out || max_prns <= 0) return 0;
+
+    /* MSM7 only: 1077 / 1087 / 1097 / 1117 / 1127 / 1137.  Callers that
+     * want MSM4..6 CNR decode once and use rtcm_msm_obs_best_cnr(). */
+    if (!rtcm_msg_is_msm(msg_type, 7, 7)) return 0;
+    if (gnss_id_out) *gnss_id_out = rtcm_msg_gnss_id(msg_type);
+
+    RtcmMsmObs obs;
+    if (!rtcm_decode_msm(payload, payload_len, &obs)) return 0;
+    return rtcm_msm_obs_best_cnr(&obs, prns_out, cnr_out, max_prns);
+}
+
 /* ── Reference-station ARP cache ──────────────────────────────────────────
  * Populated by decode_rtcm_1005 / 1006 every time the station broadcasts
- * its antenna reference point.  Read by the GUI worker thread when
- * computing satellite az/el for the Sky Plot window.
+ * its antenna reference point, into the RtcmDecoderCtx the frame was
+ * decoded with.  Read by the sky code when computing satellite az/el.
  *
- * Single-threaded by convention: written and read on the worker.  The UI
- * thread's re-decode-for-display path also writes to it, but a torn read
- * is harmless for our purposes. */
-static struct {
-    bool   valid;
-    double x, y, z;        /* ECEF metres */
-    double lat_deg;
-    double lon_deg;
-    double alt_m;
-} g_station_arp = { false, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+ * The default context is single-threaded by convention: written and read
+ * on the worker.  The GUI's re-decode-for-display path also writes to
+ * it, but a torn read is harmless for our purposes. */
+void rtcm_ctx_get_station_arp(const RtcmDecoderCtx *ctx, bool *valid,
+                              double *x, double *y, double *z,
+                              double *lat_deg, double *lon_deg, double *alt_m)
+{
+    if (valid)   *valid   = ctx->arp_valid;
+    if (x)       *x       = ctx->arp_x;
+    if (y)       *y       = ctx->arp_y;
+    if (z)       *z       = ctx->arp_z;
+    if (lat_deg) *lat_deg = ctx->arp_lat_deg;
+    if (lon_deg) *lon_deg = ctx->arp_lon_deg;
+    if (alt_m)   *alt_m   = ctx->arp_alt_m;
+}
 
 void rtcm_get_station_arp(bool *valid,
                           double *x, double *y, double *z,
                           double *lat_deg, double *lon_deg, double *alt_m)
 {
-    if (valid)   *valid   = g_station_arp.valid;
-    if (x)       *x       = g_station_arp.x;
-    if (y)       *y       = g_station_arp.y;
-    if (z)       *z       = g_station_arp.z;
-    if (lat_deg) *lat_deg = g_station_arp.lat_deg;
-    if (lon_deg) *lon_deg = g_station_arp.lon_deg;
-    if (alt_m)   *alt_m   = g_station_arp.alt_m;
+    rtcm_ctx_get_station_arp(&g_default_ctx, valid, x, y, z,
+                             lat_deg, lon_deg, alt_m);
 }
 
 void ecef_to_geodetic(double x, double y, double z, double h, double *lat_deg, double *lon_deg, double *alt) {
@@ -540,13 +670,45 @@ void azel_from_ecef(double sta_x, double sta_y, double sta_z,
                     double sv_x,  double sv_y,  double sv_z,
                     double *az_deg, double *el_deg)
 {
-    double lat, lon, alt;
-    ecef_to_geodetic(sta_x, sta_y, sta_z, 0.0, &lat, &lon, &alt);
+    StationFrame f;
+    f.valid = false;
+    station_frame_set(&f, sta_x, sta_y, sta_z);
+    azel_from_ecef_frame(&f, sv_x, sv_y, sv_z, az_deg, el_deg);
+}
+
+bool station_frame_set(StationFrame *f, double x, double y, double z)
+{
+    if (f->valid && f->x == x && f->y == y && f->z == z) return false;
+
+    f->x = x;
+    f->y = y;
+    f->z = z;
+    ecef_to_geodetic(x, y, z, 0.0, &f->lat_deg, &f->lon_deg, &f->alt_m);
+
+    double lat = f->lat_deg * M_PI / 180.0;
+    double lon = f->lon_deg * M_PI / 180.0;
+    double sl  = sin(lat), cl  = cos(lat);
+    double slo = sin(lon), clo = cos(lon);
 
-    double e, n, u;
-    ecef_to_enu(lat, lon,
-                sv_x - sta_x, sv_y - sta_y, sv_z - sta_z,
-                &e, &n, &u);
+    /* Same rotation as ecef_to_enu(), one row per output axis. */
+    f->r[0][0] = -slo;       f->r[0][1] =  clo;       f->r[0][2] = 0.0;
+    f->r[1][0] = -sl * clo;  f->r[1][1] = -sl * slo;  f->r[1][2] = cl;
+    f->r[2][0] =  cl * clo;  f->r[2][1] =  cl * slo;  f->r[2][2] = sl;
+    f->valid = true;
+    return true;
+}
+
+void azel_from_ecef_frame(const StationFrame *f,
+                          double sv_x, double sv_y, double sv_z,
+                          double *az_deg, double *el_deg)
+{
+    double dx = sv_x - f->x;
+    double dy = sv_y - f->y;
+    double dz = sv_z - f->z;
+
+    double e = f->r[0][0] * dx + f->r[0][1] * dy;
+    double n = f->r[1][0] * dx + f->r[1][1] * dy + f->r[1][2] * dz;
+    double u = f->r[2][0] * dx + f->r[2][1] * dy + f->r[2][2] * dz;
 
     enu_to_azel(e, n, u, az_deg, el_deg);
 }
@@ -573,147 +735,314 @@ void calc_distance_heading(double lat1, double lon1, double lat2, double lon2, d
 }
 
     
-void decode_rtcm_1005(const unsigned char *payload, int payload_len, const NTRIP_Config *config) {
-    if (payload_len < 19) { // 12+12+6+1+1+1+1+38+1+1+38+2+38+2 = 200 bits = 25 bytes
-        rtcm_printf("Type 1005: Payload too short!\n");
-        return;
-    }
-    int bit = 0;
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1005
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint8_t itrf_year = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-    uint8_t gps_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t glo_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t gal_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t ref_station_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-
-    uint64_t raw_x = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_x = (raw_x & ((uint64_t)1 << 37)) ? (int64_t)(raw_x | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_x;
-
-    uint8_t osc_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    bit += 1; // Reserved
+/* ── Structured decoders ──────────────────────────────────────────────────
+ * rtcm_decode_msm() / rtcm_decode_arp() only fill plain structs; the
+ * decode_rtcm_xxxx() text decoders below format those structs. */
+
+/* Widths per subtype; see RtcmMsmLayout.  The one description of the
+ * layout: it fills g_msm_layout for the encoder and rtcm_msm_layout(),
+ * and stamps out one body decoder per subtype below. */
+#define RTCM_MSM_LAYOUTS(X)                                                  \
+    /*  sub int ext rate  pr  ph lock cnr rate  pr_e  ph_e  cnr_lsb */       \
+    X(1,   0,  0,  0,   15,  0,  0,  0,  0,  -24,    0, 0.0f    )            \
+    X(2,   0,  0,  0,    0, 22,  4,  0,  0,    0,  -29, 0.0f    )            \
+    X(3,   0,  0,  0,   15, 22,  4,  0,  0,  -24,  -29, 0.0f    )            \
+    X(4,   8,  0,  0,   15, 22,  4,  6,  0,  -24,  -29, 1.0f    )            \
+    X(5,   8,  4, 14,   15, 22,  4,  6, 15,  -24,  -29, 1.0f    )            \
+    X(6,   8,  0,  0,   20, 24, 10, 10,  0,  -29,  -31, 0.0625f )            \
+    X(7,   8,  4, 14,   20, 24, 10, 10, 15,  -29,  -31, 0.0625f )
+
+#define MSM_LAYOUT_ROW(n, si, se, sr, pr, ph, lk, cn, rt, pe, he, cl) \
+    [n] = { si, se, sr, pr, ph, lk, cn, rt, pe, he, cl },
+static const RtcmMsmLayout g_msm_layout[8] = { RTCM_MSM_LAYOUTS(MSM_LAYOUT_ROW) };
+#undef MSM_LAYOUT_ROW
+
+const RtcmMsmLayout *rtcm_msm_layout(int subtype)
+{
+    return (subtype >= 1 && subtype <= 7) ? &g_msm_layout[subtype] : NULL;
+}
 
-    uint64_t raw_y = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_y = (raw_y & ((uint64_t)1 << 37)) ? (int64_t)(raw_y | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_y;
+/* Force the body into each per-subtype wrapper, so the widths, the
+ * "field present" tests and the scales fold to constants there. */
+#if defined(_MSC_VER)
+#define MSM_BODY_INLINE static __forceinline
+#elif defined(__GNUC__)
+#define MSM_BODY_INLINE static inline __attribute__((always_inline))
+#else
+#define MSM_BODY_INLINE static inline
+#endif
+
+/* Satellite and signal blocks plus physical units, after the cell mask. */
+MSM_BODY_INLINE void msm_decode_body(RtcmBitReader *br, RtcmMsmObs *out,
+                                     const RtcmMsmLayout L)
+{
+    /* ── Satellite data block: one field at a time across all sats, each
+     * field array unpacked in one go (rtcm_unpack.h) ── */
+    const int ns = out->num_sats, nc = out->num_cells;
+    uint32_t u[RTCM_MSM_MAX_CELLS];   /* == RTCM_MSM_MAX_SATS, both 64 */
+    int32_t  v[RTCM_MSM_MAX_CELLS];
+    if (L.sat_int) {
+        rtcm_br_read_u32s(br, L.sat_int, ns, u);
+        for (int s = 0; s < ns; ++s) out->sats[s].rough_int_ms = (int)u[s];
+    }
+    if (L.sat_ext) {
+        rtcm_br_read_u32s(br, L.sat_ext, ns, u);
+        for (int s = 0; s < ns; ++s) out->sats[s].ext_info = (int)u[s];
+    }
+    rtcm_br_read_u32s(br, 10, ns, u);
+    for (int s = 0; s < ns; ++s) out->sats[s].rough_mod = (int)u[s];
+    if (L.sat_rate) {
+        rtcm_br_read_i32s(br, L.sat_rate, ns, v);
+        for (int s = 0; s < ns; ++s) out->sats[s].rough_rate = v[s];
+    }
+
+    /* ── Signal data block ── */
+    if (L.pr) {
+        rtcm_br_read_i32s(br, L.pr, nc, v);
+        for (int c = 0; c < nc; ++c) out->cells[c].fine_pr = v[c];
+    }
+    if (L.ph) {
+        rtcm_br_read_i32s(br, L.ph, nc, v);
+        for (int c = 0; c < nc; ++c) out->cells[c].fine_ph = v[c];
+    }
+    if (L.lock) {
+        rtcm_br_read_u32s(br, L.lock, nc, u);
+        for (int c = 0; c < nc; ++c) out->cells[c].lock = (uint16_t)u[c];
+    }
+    if (L.ph) {
+        rtcm_br_read_u32s(br, 1, nc, u);
+        for (int c = 0; c < nc; ++c) out->cells[c].half_cycle = (uint8_t)u[c];
+    }
+    if (L.cnr) {
+        rtcm_br_read_u32s(br, L.cnr, nc, u);
+        for (int c = 0; c < nc; ++c) out->cells[c].cnr_raw = (uint16_t)u[c];
+    }
+    if (L.rate) {
+        rtcm_br_read_i32s(br, L.rate, nc, v);
+        for (int c = 0; c < nc; ++c) out->cells[c].fine_rate = (int16_t)v[c];
+    }
+
+    out->truncated = rtcm_br_left(br) < 0;
+
+    /* ── Physical units ── */
+    for (int s = 0; s < ns; ++s) {
+        RtcmMsmSat *sat = &out->sats[s];
+        if (sat->rough_int_ms != 255)   /* 255 = invalid (DF397) */
+            sat->rough_range_m = (sat->rough_int_ms + sat->rough_mod / 1024.0) * RTCM_LIGHT_MS;
+    }
+    const double pr_lsb = ldexp(1.0, L.pr_exp) * RTCM_LIGHT_MS;
+    const double ph_lsb = ldexp(1.0, L.ph_exp) * RTCM_LIGHT_MS;
+    for (int c = 0; c < nc; ++c) {
+        RtcmMsmCell *cell = &out->cells[c];
+        double rough = out->sats[cell->sat].rough_range_m;
+        cell->cnr_dbhz = (float)cell->cnr_raw * L.cnr_lsb;
+        /* The most negative fine value flags "invalid" (DF400/401/405/406). */
+        if (L.pr && rough != 0.0 && cell->fine_pr != -(1 << (L.pr - 1)))
+            cell->pr_m = rough + cell->fine_pr * pr_lsb;
+        if (L.ph && rough != 0.0 && cell->fine_ph != -(1 << (L.ph - 1)))
+            cell->ph_m = rough + cell->fine_ph * ph_lsb;
+    }
+}
 
-    bit += 2; // Reserved
+/* One decoder per subtype; GNSS does not change the field layout (only
+ * the signal map and the RTCM_LIGHT_MS scale, which is common), so
+ * specialising per subtype covers it. */
+#define MSM_BODY_FN(n, si, se, sr, pr, ph, lk, cn, rt, pe, he, cl)           \
+    static void msm_decode_body_##n(RtcmBitReader *br, RtcmMsmObs *out)     \
+    {                                                                        \
+        static const RtcmMsmLayout L = { si, se, sr, pr, ph, lk, cn, rt, pe, he, cl }; \
+        msm_decode_body(br, out, L);                                         \
+    }
+RTCM_MSM_LAYOUTS(MSM_BODY_FN)
+#undef MSM_BODY_FN
+
+#define MSM_BODY_ENTRY(n, ...) [n] = msm_decode_body_##n,
+static void (*const g_msm_body[8])(RtcmBitReader *, RtcmMsmObs *) = {
+    RTCM_MSM_LAYOUTS(MSM_BODY_ENTRY)
+};
+#undef MSM_BODY_ENTRY
 
-    uint64_t raw_z = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_z = (raw_z & ((uint64_t)1 << 37)) ? (int64_t)(raw_z | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_z;
+bool rtcm_decode_msm(const unsigned char *payload, int payload_len, RtcmMsmObs *out)
+{
+    if (!payload || !out || payload_len < 22)   /* 169-bit MSM header */
+        return false;
+
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+
+    int msg_type = (int)rtcm_br_read(&br, 12);
+    const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+    if (!info || !(info->flags & RTCM_MSG_F_MSM) ||
+        info->msm_subtype < 1 || info->msm_subtype > 7)
+        return false;
+
+    memset(out, 0, sizeof(*out));
+    out->msg_type       = msg_type;
+    out->payload_len    = payload_len;
+    out->gnss_id        = info->gnss_id;
+    out->msm_subtype    = info->msm_subtype;
+    out->ref_station_id = (uint16_t)rtcm_br_read(&br, 12);
+    out->epoch_time     = (uint32_t)rtcm_br_read(&br, 30);
+    out->mm_flag        = (uint8_t)rtcm_br_read(&br, 1);
+    out->iods           = (uint8_t)rtcm_br_read(&br, 3);
+    rtcm_br_skip(&br, 7); /* reserved */
+    out->clk_steering   = (uint8_t)rtcm_br_read(&br, 2);
+    out->ext_clk        = (uint8_t)rtcm_br_read(&br, 2);
+    out->df_smoothing   = (uint8_t)rtcm_br_read(&br, 1);
+    out->smoothing_int  = (uint8_t)rtcm_br_read(&br, 3);
+    out->sat_mask       = rtcm_br_read(&br, 64);
+    out->sig_mask       = (uint32_t)rtcm_br_read(&br, 32);
+
+    for (int i = 0; i < RTCM_MSM_MAX_SATS; ++i)
+        if ((out->sat_mask >> (63 - i)) & 1)
+            out->sats[out->num_sats++].prn = i + 1;
+    for (int i = 0; i < RTCM_MSM_MAX_SIGS; ++i)
+        if ((out->sig_mask >> (31 - i)) & 1)
+            out->sig_idx[out->num_sigs++] = i;
+
+    /* The cell mask is limited to 64 bits (DF396). */
+    if (out->num_sats * out->num_sigs > RTCM_MSM_MAX_CELLS)
+        return false;
+
+    for (int s = 0; s < out->num_sats; ++s)
+        for (int g = 0; g < out->num_sigs; ++g)
+            if (rtcm_br_read(&br, 1)) {
+                RtcmMsmCell *cell = &out->cells[out->num_cells++];
+                cell->sat     = s;
+                cell->sig_idx = out->sig_idx[g];
+            }
 
-    bit += 2; // Reserved
+    g_msm_body[info->msm_subtype](&br, out);
+    return true;
+}
 
-    // 1005 does not have antenna height
-    double x = ecef_x * 0.0001;
-    double y = ecef_y * 0.0001;
-    double z = ecef_z * 0.0001;
-    double h = 0.0;
+bool rtcm_decode_arp(const unsigned char *payload, int payload_len, RtcmStationArp *out)
+{
+    if (!payload || !out || payload_len < 19)   /* 152-bit 1005 body */
+        return false;
+
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    int msg_type = (int)rtcm_br_read(&br, 12);
+    if (msg_type != 1005 && msg_type != 1006)
+        return false;
+    if (msg_type == 1006 && payload_len < 21)   /* + 16-bit antenna height */
+        return false;
+
+    memset(out, 0, sizeof(*out));
+    out->msg_type        = msg_type;
+    out->ref_station_id  = (uint16_t)rtcm_br_read(&br, 12);
+    out->itrf_year       = (uint8_t)rtcm_br_read(&br, 6);
+    out->gps_ind         = (uint8_t)rtcm_br_read(&br, 1);
+    out->glo_ind         = (uint8_t)rtcm_br_read(&br, 1);
+    out->gal_ind         = (uint8_t)rtcm_br_read(&br, 1);
+    out->ref_station_ind = (uint8_t)rtcm_br_read(&br, 1);
+    out->x               = rtcm_br_read_signed(&br, 38) * 0.0001;
+    out->osc_ind         = (uint8_t)rtcm_br_read(&br, 1);
+    rtcm_br_skip(&br, 1); /* reserved */
+    out->y               = rtcm_br_read_signed(&br, 38) * 0.0001;
+    out->quarter_cycle_ind = (uint8_t)rtcm_br_read(&br, 2);
+    out->z               = rtcm_br_read_signed(&br, 38) * 0.0001;
+    if (msg_type == 1006)
+        out->antenna_height = rtcm_br_read(&br, 16) * 0.0001;
+
+    ecef_to_geodetic(out->x, out->y, out->z, out->antenna_height,
+                     &out->lat_deg, &out->lon_deg, &out->alt_m);
+    return true;
+}
 
-    double lat_deg, lon_deg, alt;
-    ecef_to_geodetic(x, y, z, h, &lat_deg, &lon_deg, &alt);
+bool rtcm_decode_eph(const unsigned char *payload, int payload_len, SvEphemeris *out)
+{
+    if (!payload || !out || payload_len < 2) return false;
+
+    /* The text decoders fill the SvEphemeris; their text goes to a
+     * per-thread scratch buffer that is dropped. */
+    static __thread RtcmStrBuf scratch;
+    if (!scratch.buf) rtcm_strbuf_init(&scratch, 2048);
+    RtcmStrBuf *prev = g_rtcm_strbuf;
+    g_rtcm_strbuf = &scratch;
+    g_eph_out = out;
+    g_eph_got = false;
+    switch ((int)get_bits(payload, 0, 12)) {
+    case 1019: decode_rtcm_1019(payload, payload_len); break;
+    case 1020: decode_rtcm_1020(payload, payload_len); break;
+    case 1041: decode_rtcm_1041(payload, payload_len); break;
+    case 1042: decode_rtcm_1042(payload, payload_len); break;
+    case 1044: decode_rtcm_1044(payload, payload_len); break;
+    case 1045: decode_rtcm_1045(payload, payload_len); break;
+    case 1046: decode_rtcm_1046(payload, payload_len); break;
+    default: break;
+    }
+    g_eph_out = NULL;
+    g_rtcm_strbuf = prev;
+    rtcm_strbuf_clear(&scratch);
+    return g_eph_got;
+}
 
+/* Text formatter shared by decode_rtcm_1005 / 1006; also refreshes the
+ * station-ARP cache used by the Sky Plot. */
+static void print_station_arp(RtcmDecoderCtx *ctx, const RtcmStationArp *arp,
+                              const NTRIP_Config *config)
+{
     /* Cache station ARP for the Sky Plot az/el computation */
-    g_station_arp.valid   = true;
-    g_station_arp.x       = x;
-    g_station_arp.y       = y;
-    g_station_arp.z       = z;
-    g_station_arp.lat_deg = lat_deg;
-    g_station_arp.lon_deg = lon_deg;
-    g_station_arp.alt_m   = alt;
-
-    rtcm_printf("RTCM 1005:\n");
-    rtcm_printf("  Message Number: %u\n", msg_number);
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  ITRF Realization Year: %u\n", itrf_year);
-    rtcm_printf("  GPS: %u, GLONASS: %u, Galileo: %u\n", gps_ind, glo_ind, gal_ind);
-    rtcm_printf("  Reference Station Indicator: %u\n", ref_station_ind);
-    rtcm_printf("  ECEF X: %.4f m\n", x);
-    rtcm_printf("  ECEF Y: %.4f m\n", y);
-    rtcm_printf("  ECEF Z: %.4f m\n", z);
-    rtcm_printf("  Single Receiver Oscillator Indicator: %u\n", osc_ind);
-    rtcm_printf("WGS84 Lat: %.8f deg, Lon: %.8f deg, Alt: %.3f m\n", lat_deg, lon_deg, alt);
-    rtcm_printf("[Google Maps Link] https://maps.google.com/?q=%.8f,%.8f\n", lat_deg, lon_deg);
+    ctx->arp_valid   = true;
+    ctx->arp_x       = arp->x;
+    ctx->arp_y       = arp->y;
+    ctx->arp_z       = arp->z;
+    ctx->arp_lat_deg = arp->lat_deg;
+    ctx->arp_lon_deg = arp->lon_deg;
+    ctx->arp_alt_m   = arp->alt_m;
+
+    rtcm_printf("RTCM %d:\n", arp->msg_type);
+    rtcm_printf("  Message Number: %d\n", arp->msg_type);
+    rtcm_printf("  Reference Station ID: %u\n", arp->ref_station_id);
+    rtcm_printf("  ITRF Realization Year: %u\n", arp->itrf_year);
+    rtcm_printf("  GPS: %u, GLONASS: %u, Galileo: %u\n", arp->gps_ind, arp->glo_ind, arp->gal_ind);
+    rtcm_printf("  Reference Station Indicator: %u\n", arp->ref_station_ind);
+    rtcm_printf("  ECEF X: %.4f m\n", arp->x);
+    rtcm_printf("  ECEF Y: %.4f m\n", arp->y);
+    rtcm_printf("  ECEF Z: %.4f m\n", arp->z);
+    if (arp->msg_type == 1006)
+        rtcm_printf("  Antenna Height: %.4f m\n", arp->antenna_height);
+    rtcm_printf("  Single Receiver Oscillator Indicator: %u\n", arp->osc_ind);
+    rtcm_printf("WGS84 Lat: %.8f deg, Lon: %.8f deg, Alt: %.3f m\n", arp->lat_deg, arp->lon_deg, arp->alt_m);
+    rtcm_printf("[Google Maps Link] https://maps.google.com/?q=%.8f,%.8f\n", arp->lat_deg, arp->lon_deg);
 
     // --- Distance and heading calculation ---
     if (config) {
         double distance_km = 0, heading_deg = 0;
-        // Calculate distance and heading from rover (config) to base (RTCM 1005)
-        calc_distance_heading(config->LATITUDE, config->LONGITUDE, lat_deg, lon_deg, &distance_km, &heading_deg);
+        // Calculate distance and heading from rover (config) to base (RTCM 1005/1006)
+        calc_distance_heading(config->LATITUDE, config->LONGITUDE, arp->lat_deg, arp->lon_deg, &distance_km, &heading_deg);
         rtcm_printf("Distance to base (from rover): %.3f km, Heading: %.1f deg\n", distance_km, heading_deg);
     }
 }
 
-void decode_rtcm_1006(const unsigned char *payload, int payload_len, const NTRIP_Config *config) {
-    if (payload_len < 21) { // 12+12+6+1+1+1+1+38+1+1+38+2+38+2+16 = 216 bits = 27 bytes
-        rtcm_printf("Type 1006: Payload too short!\n");
+void decode_rtcm_1005_ctx(RtcmDecoderCtx *ctx, const unsigned char *payload,
+                          int payload_len, const NTRIP_Config *config) {
+    RtcmStationArp arp;
+    if (!rtcm_decode_arp(payload, payload_len, &arp)) { // 152 bits = 19 bytes
+        rtcm_printf("Type 1005: Payload too short!\n");
         return;
     }
+    print_station_arp(ctx, &arp, config);
+}
 
-    int bit = 0;
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1006
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint8_t itrf_year = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-    uint8_t gps_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t glo_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t gal_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t ref_station_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-
-    uint64_t raw_x = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_x = (raw_x & ((uint64_t)1 << 37)) ? (int64_t)(raw_x | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_x;
-
-    uint8_t osc_ind = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    bit += 1; // Reserved
-
-    uint64_t raw_y = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_y = (raw_y & ((uint64_t)1 << 37)) ? (int64_t)(raw_y | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_y;
-
-    bit += 2; // Reserved
-
-    uint64_t raw_z = get_bits(payload, bit, 38); bit += 38;
-    int64_t ecef_z = (raw_z & ((uint64_t)1 << 37)) ? (int64_t)(raw_z | (~((uint64_t)0x3FFFFFFFFF))) : (int64_t)raw_z;
-
-    bit += 2; // Reserved
-
-    uint16_t antenna_height = (uint16_t)get_bits(payload, bit, 16); bit += 16;
-
-    double x = ecef_x * 0.0001;
-    double y = ecef_y * 0.0001;
-    double z = ecef_z * 0.0001;
-    double h = antenna_height * 0.0001;
-
-    double lat_deg, lon_deg, alt;
-    ecef_to_geodetic(x, y, z, h, &lat_deg, &lon_deg, &alt);
+void decode_rtcm_1006_ctx(RtcmDecoderCtx *ctx, const unsigned char *payload,
+                          int payload_len, const NTRIP_Config *config) {
+    RtcmStationArp arp;
+    if (!rtcm_decode_arp(payload, payload_len, &arp)) { // 168 bits = 21 bytes
+        rtcm_printf("Type 1006: Payload too short!\n");
+        return;
+    }
+    print_station_arp(ctx, &arp, config);
+}
 
-    /* Cache station ARP for the Sky Plot az/el computation */
-    g_station_arp.valid   = true;
-    g_station_arp.x       = x;
-    g_station_arp.y       = y;
-    g_station_arp.z       = z;
-    g_station_arp.lat_deg = lat_deg;
-    g_station_arp.lon_deg = lon_deg;
-    g_station_arp.alt_m   = alt;
-
-    rtcm_printf("RTCM 1006:\n");
-    rtcm_printf("  Message Number: %u\n", msg_number);
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  ITRF Realization Year: %u\n", itrf_year);
-    rtcm_printf("  GPS: %u, GLONASS: %u, Galileo: %u\n", gps_ind, glo_ind, gal_ind);
-    rtcm_printf("  Reference Station Indicator: %u\n", ref_station_ind);
-    rtcm_printf("  ECEF X: %.4f m\n", x);
-    rtcm_printf("  ECEF Y: %.4f m\n", y);
-    rtcm_printf("  ECEF Z: %.4f m\n", z);
-    rtcm_printf("  Antenna Height: %.4f m\n", h);
-    rtcm_printf("  Single Receiver Oscillator Indicator: %u\n", osc_ind);
-    rtcm_printf("WGS84 Lat: %.8f deg, Lon: %.8f deg, Alt: %.3f m\n", lat_deg, lon_deg, alt);
-    rtcm_printf("[Google Maps Link] https://maps.google.com/?q=%.8f,%.8f\n", lat_deg, lon_deg);
+void decode_rtcm_1005(const unsigned char *payload, int payload_len, const NTRIP_Config *config) {
+    decode_rtcm_1005_ctx(&g_default_ctx, payload, payload_len, config);
+}
 
-    // --- Distance and heading calculation ---
-    if (config) {
-        double distance_km = 0, heading_deg = 0;
-        // Calculate distance and heading from rover (config) to base (RTCM 1005)
-        calc_distance_heading(config->LATITUDE, config->LONGITUDE, lat_deg, lon_deg, &distance_km, &heading_deg);
-        rtcm_printf("Distance to base (from rover): %.3f km, Heading: %.1f deg\n", distance_km, heading_deg);
-    }
+void decode_rtcm_1006(const unsigned char *payload, int payload_len, const NTRIP_Config *config) {
+    decode_rtcm_1006_ctx(&g_default_ctx, payload, payload_len, config);
 }
 
 /**
@@ -760,120 +1089,40 @@ void decode_rtcm_1006(const unsigned char *payload, int payload_len, const NTRIP
 /* Per-GNSS PRN-prefix letter (RINEX-style) from a 1077..1137 message type. */
 static char msm_gnss_letter(int msg_type)
 {
-    if (msg_type >= 1070 && msg_type < 1080) return 'G';   /* GPS */
-    if (msg_type >= 1080 && msg_type < 1090) return 'R';   /* GLONASS */
-    if (msg_type >= 1090 && msg_type < 1100) return 'E';   /* Galileo */
-    if (msg_type >= 1100 && msg_type < 1110) return 'S';   /* SBAS */
-    if (msg_type >= 1110 && msg_type < 1120) return 'J';   /* QZSS */
-    if (msg_type >= 1120 && msg_type < 1130) return 'C';   /* BeiDou */
-    if (msg_type >= 1130 && msg_type < 1140) return 'I';   /* NavIC */
-    return '?';
+    switch (rtcm_msg_gnss_id(msg_type)) {
+    case 1: return 'G';   /* GPS */
+    case 2: return 'R';   /* GLONASS */
+    case 3: return 'E';   /* Galileo */
+    case 6: return 'S';   /* SBAS */
+    case 4: return 'J';   /* QZSS */
+    case 5: return 'C';   /* BeiDou */
+    case 7: return 'I';   /* NavIC */
+    default: return '?';
+    }
 }
 /* gnss_id mapping for msm_signal_label() lookups. */
 static int msm_gnss_id_from_msg(int msg_type)
 {
-    if (msg_type >= 1070 && msg_type < 1080) return 1;
-    if (msg_type >= 1080 && msg_type < 1090) return 2;
-    if (msg_type >= 1090 && msg_type < 1100) return 3;
-    if (msg_type >= 1100 && msg_type < 1110) return 6;
-    if (msg_type >= 1110 && msg_type < 1120) return 4;
-    if (msg_type >= 1120 && msg_type < 1130) return 5;
-    if (msg_type >= 1130 && msg_type < 1140) return 7;
-    return 0;
+    return rtcm_msg_is_msm(msg_type, 1, 7) ? rtcm_msg_gnss_id(msg_type) : 0;
 }
 
-static void decode_rtcm_msm7_full(const unsigned char *payload, int payload_len,
-                                   const char *gnss_name, int msg_type)
+/* MSM7 text formatter over an already decoded frame; msg_type selects
+ * the PRN letter and signal labels. */
+static void format_msm7(const RtcmMsmObs *o, int msg_type)
 {
-    int bit = 0;
-    if (payload_len < 20) {
-        rtcm_printf("Type %d: Payload too short!\n", msg_type);
-        return;
-    }
-    (void)gnss_name;   /* PRN letter and signal labels are now keyed on msg_type. */
     char  sys_letter = msm_gnss_letter(msg_type);
     int   sys_gnss_id = msm_gnss_id_from_msg(msg_type);
-
-    /* ── MSM header ──────────────────────────────────────────────
-     * Per RTCM 10403.3 Table 3.5-78 the header starts with the 12-bit
-     * message number, followed by a 12-bit reference-station ID.  This
-     * decoder previously skipped the message number, which shifted every
-     * subsequent field by 12 bits and corrupted the entire decode -- the
-     * "ref_station_id" actually carried the message number, "epoch_time"
-     * was station-ID+top-of-epoch, and so on through the sat-mask.       */
-    uint32_t header_msg_num = (uint32_t)get_bits(payload, bit, 12); bit += 12;
-    (void)header_msg_num;   /* msg_type from caller is canonical */
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time     = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t  mm_flag        = (uint8_t)get_bits(payload, bit, 1);  bit += 1;
-    uint8_t  iods           = (uint8_t)get_bits(payload, bit, 3);  bit += 3;
-    bit += 7; /* reserved */
-    uint8_t  clk_steering   = (uint8_t)get_bits(payload, bit, 2);  bit += 2;
-    uint8_t  ext_clk        = (uint8_t)get_bits(payload, bit, 2);  bit += 2;
-    uint8_t  df_smoothing   = (uint8_t)get_bits(payload, bit, 1);  bit += 1;
-    uint8_t  smoothing_int  = (uint8_t)get_bits(payload, bit, 3);  bit += 3;
-
-    uint64_t sat_mask = get_bits(payload, bit, 64); bit += 64;
-    uint32_t sig_mask = (uint32_t)get_bits(payload, bit, 32); bit += 32;
-
-    /* Build satellite PRN list from mask */
-    int sat_prns[64];
-    int num_sats = 0;
-    for (int i = 0; i < 64; ++i) {
-        if ((sat_mask >> (63 - i)) & 1)
-            sat_prns[num_sats++] = i + 1;   /* PRN = 1-based mask bit position */
-    }
-
-    /* Build signal ID list from mask */
-    int sig_ids[32];
-    int num_sigs = 0;
-    for (int i = 0; i < 32; ++i) {
-        if ((sig_mask >> (31 - i)) & 1)
-            sig_ids[num_sigs++] = i + 1;
-    }
-
-    /* Cell mask: num_sats × num_sigs bit matrix */
-    int cell_mask[64][32];
-    int num_cells = 0;
-    for (int s = 0; s < num_sats; s++) {
-        for (int g = 0; g < num_sigs; g++) {
-            cell_mask[s][g] = (int)get_bits(payload, bit, 1); bit += 1;
-            if (cell_mask[s][g]) num_cells++;
-        }
-    }
-
-    rtcm_printf("  Reference Station ID  : %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time            : %u\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag : %u\n", mm_flag);
-    rtcm_printf("  IODS                  : %u\n", iods);
-    rtcm_printf("  Clock Steering        : %u\n", clk_steering);
-    rtcm_printf("  External Clock        : %u\n", ext_clk);
-    rtcm_printf("  Div-free Smoothing    : %u\n", df_smoothing);
-    rtcm_printf("  Smoothing Interval    : %u\n", smoothing_int);
-    rtcm_printf("  Satellites            : %d\n", num_sats);
-    rtcm_printf("  Signals               : %d\n", num_sigs);
-    rtcm_printf("  Cells                 : %d\n", num_cells);
-
-    /* ── Satellite data block ────────────────────────────────── */
-    int    rough_range_int[64];
-    int    ext_info[64];
-    int    rough_range_mod[64];
-    int    rough_phrate[64];
-
-    for (int s = 0; s < num_sats; s++) {
-        rough_range_int[s] = (int)get_bits(payload, bit, 8); bit += 8;
-    }
-    for (int s = 0; s < num_sats; s++) {
-        ext_info[s] = (int)get_bits(payload, bit, 4); bit += 4;
-    }
-    for (int s = 0; s < num_sats; s++) {
-        rough_range_mod[s] = (int)get_bits(payload, bit, 10); bit += 10;
-    }
-    for (int s = 0; s < num_sats; s++) {
-        int raw = (int)get_bits(payload, bit, 14); bit += 14;
-        if (raw & (1 << 13)) raw -= (1 << 14);
-        rough_phrate[s] = raw;
-    }
+    rtcm_printf("  Reference Station ID  : %u\n", o->ref_station_id);
+    rtcm_printf("  Epoch Time            : %u\n", o->epoch_time);
+    rtcm_printf("  Multiple Message Flag : %u\n", o->mm_flag);
+    rtcm_printf("  IODS                  : %u\n", o->iods);
+    rtcm_printf("  Clock Steering        : %u\n", o->clk_steering);
+    rtcm_printf("  External Clock        : %u\n", o->ext_clk);
+    rtcm_printf("  Div-free Smoothing    : %u\n", o->df_smoothing);
+    rtcm_printf("  Smoothing Interval    : %u\n", o->smoothing_int);
+    rtcm_printf("  Satellites            : %d\n", o->num_sats);
+    rtcm_printf("  Signals               : %d\n", o->num_sigs);
+    rtcm_printf("  Cells                 : %d\n", o->num_cells);
 
     /* Print satellite summary */
     rtcm_printf("\n");
@@ -881,75 +1130,27 @@ static void decode_rtcm_msm7_full(const unsigned char *payload, int payload_len,
     rtcm_printf("  -------------------------------------------------------\n");
     rtcm_printf("  PRN   Range(ms)     ExtInfo  PhaseRate(m/s)\n");
     rtcm_printf("  -------------------------------------------------------\n");
-    for (int s = 0; s < num_sats; s++) {
-        double range_ms = rough_range_int[s] + rough_range_mod[s] / 1024.0;
-        double phrate_ms = rough_phrate[s] * 1.0;
-        rtcm_printf("  %c%02d   %10.4f     %2d       %8.1f\n",
-                     sys_letter, sat_prns[s], range_ms, ext_info[s], phrate_ms);
-    }
-
-    /* ── Signal / cell data block ────────────────────────────── */
-    /* Read all cell data arrays (MSM7 bit widths) */
-    int32_t  fine_pr[256];
-    int32_t  fine_ph[256];
-    uint16_t lock_ind[256];
-    uint8_t  half_cyc[256];
-    uint16_t cnr_raw[256];
-    int16_t  fine_phrate[256];
-
-    int c = 0;
-    /* Fine pseudoranges (20 bits signed each) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                int32_t v = (int32_t)get_bits(payload, bit, 20); bit += 20;
-                if (v & (1 << 19)) v -= (1 << 20);
-                fine_pr[c++] = v;
-            }
-
-    c = 0;
-    /* Fine phase ranges (24 bits signed each) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                int32_t v = (int32_t)get_bits(payload, bit, 24); bit += 24;
-                if (v & (1 << 23)) v -= (1 << 24);
-                fine_ph[c++] = v;
-            }
-
-    c = 0;
-    /* Lock time indicators (10 bits each) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                lock_ind[c++] = (uint16_t)get_bits(payload, bit, 10); bit += 10;
-            }
-
-    c = 0;
-    /* Half-cycle ambiguity (1 bit each) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                half_cyc[c++] = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-            }
-
-    c = 0;
-    /* CNR (10 bits each, resolution 0.0625 dB-Hz) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                cnr_raw[c++] = (uint16_t)get_bits(payload, bit, 10); bit += 10;
-            }
-
-    c = 0;
-    /* Fine phase-range rates (15 bits signed, 0.0001 m/s) */
-    for (int s = 0; s < num_sats; s++)
-        for (int g = 0; g < num_sigs; g++)
-            if (cell_mask[s][g]) {
-                int16_t v = (int16_t)get_bits(payload, bit, 15); bit += 15;
-                if (v & (1 << 14)) v -= (1 << 15);
-                fine_phrate[c++] = v;
-            }
+    /* The per-satellite and per-cell lines are the bulk of the text:
+     * built with rtcm_fmt.h instead of rtcm_printf(), same characters as
+     * the printf formats in the comments. */
+    char line[160];
+    for (int s = 0; s < o->num_sats; s++) {
+        const RtcmMsmSat *sat = &o->sats[s];
+        double range_ms = sat->rough_int_ms + sat->rough_mod / 1024.0;
+        /* "  %c%02d   %10.4f     %2d       %8.1f\n" */
+        int n = 0;
+        line[n++] = ' '; line[n++] = ' ';
+        line[n++] = sys_letter;
+        n += rtcm_fmt_uint(line + n, (unsigned)sat->prn, 2, true);
+        n += rtcm_fmt_str(line + n, "   ", 0, false);
+        n += rtcm_fmt_fixed(line + n, range_ms, 4, 10, false);
+        n += rtcm_fmt_str(line + n, "     ", 0, false);
+        n += rtcm_fmt_int(line + n, sat->ext_info, 2, false);
+        n += rtcm_fmt_str(line + n, "       ", 0, false);
+        n += rtcm_fmt_scaled(line + n, (int64_t)sat->rough_rate * 10, 1, 8, false);
+        line[n++] = '\n';
+        rtcm_out_write(line, n);
+    }
 
     /* ── Print signal data per satellite ─────────────────────── */
     rtcm_printf("\n");
@@ -958,30 +1159,60 @@ static void decode_rtcm_msm7_full(const unsigned char *payload, int payload_len,
     rtcm_printf("  PRN   Sig  Fine PR(m)   Fine PH(m)   Lock  HC  CNR(dB-Hz)  PHrate(m/s)\n");
     rtcm_printf("  -------------------------------------------------------------------------------------\n");
 
-    c = 0;
-    for (int s = 0; s < num_sats; s++) {
-        for (int g = 0; g < num_sigs; g++) {
-            if (cell_mask[s][g]) {
-                double pr_m      = fine_pr[c]     * 0.0001;
-                double ph_m      = fine_ph[c]     * 0.0001;
-                double cnr_dbhz  = cnr_raw[c]     * 0.0625;
-                double phrate_ms = fine_phrate[c]  * 0.0001;
-
-                /* sig_idx is 0-based bit position; msm_signal_label maps to
-                 * a short name like "E1C" / "L2W" / "B2I" or "S<N>" fallback. */
-                const char *sig_lbl =
-                    msm_signal_label(sys_gnss_id, sig_ids[g] - 1);
-                rtcm_printf("  %c%02d  %-4s  %+10.4f   %+11.4f   %4u   %u   %7.2f     %+8.4f\n",
-                             sys_letter, sat_prns[s], sig_lbl,
-                             pr_m, ph_m, lock_ind[c], half_cyc[c],
-                             cnr_dbhz, phrate_ms);
-                c++;
-            }
-        }
+    for (int c = 0; c < o->num_cells; c++) {
+        const RtcmMsmCell *cell = &o->cells[c];
+        double cnr_dbhz  = cell->cnr_raw   * 0.0625;
+
+        /* sig_idx is 0-based bit position; msm_signal_label maps to
+         * a short name like "E1C" / "L2W" / "B2I" or "S<N>" fallback. */
+        const char *sig_lbl = msm_signal_label(sys_gnss_id, cell->sig_idx);
+        /* "  %c%02d  %-4s  %+10.4f   %+11.4f   %4u   %u   %7.2f     %+8.4f\n"
+         * of fine_pr/fine_ph/fine_rate * 0.0001, cnr_raw * 0.0625. */
+        int n = 0;
+        line[n++] = ' '; line[n++] = ' ';
+        line[n++] = sys_letter;
+        n += rtcm_fmt_uint(line + n, (unsigned)o->sats[cell->sat].prn, 2, true);
+        n += rtcm_fmt_str(line + n, "  ", 0, false);
+        n += rtcm_fmt_str(line + n, sig_lbl, 4, true);
+        n += rtcm_fmt_str(line + n, "  ", 0, false);
+        n += rtcm_fmt_scaled(line + n, cell->fine_pr, 4, 10, true);
+        n += rtcm_fmt_str(line + n, "   ", 0, false);
+        n += rtcm_fmt_scaled(line + n, cell->fine_ph, 4, 11, true);
+        n += rtcm_fmt_str(line + n, "   ", 0, false);
+        n += rtcm_fmt_uint(line + n, cell->lock, 4, false);
+        n += rtcm_fmt_str(line + n, "   ", 0, false);
+        n += rtcm_fmt_uint(line + n, cell->half_cycle, 0, false);
+        n += rtcm_fmt_str(line + n, "   ", 0, false);
+        n += rtcm_fmt_fixed(line + n, cnr_dbhz, 2, 7, false);
+        n += rtcm_fmt_str(line + n, "     ", 0, false);
+        n += rtcm_fmt_scaled(line + n, cell->fine_rate, 4, 8, true);
+        line[n++] = '\n';
+        rtcm_out_write(line, n);
     }
     rtcm_printf("  -------------------------------------------------------------------------------------\n");
 }
 
+static void decode_rtcm_msm7_full(const unsigned char *payload, int payload_len,
+                                   const char *gnss_name, int msg_type)
+{
+    if (payload_len < 20) {
+        rtcm_printf("Type %d: Payload too short!\n", msg_type);
+        return;
+    }
+    (void)gnss_name;   /* PRN letter and signal labels are now keyed on msg_type. */
+
+    /* The header starts with the 12-bit message number (RTCM 10403.3
+     * Table 3.5-78); rtcm_decode_msm() reads it and picks the field
+     * widths for the subtype, msg_type from the caller stays canonical
+     * for labelling. */
+    RtcmMsmObs obs;
+    if (!rtcm_decode_msm(payload, payload_len, &obs)) {
+        rtcm_printf("Type %d: Invalid MSM header or cell mask!\n", msg_type);
+        return;
+    }
+    format_msm7(&obs, msg_type);
+}
+
 void decode_rtcm_1077(const unsigned char *payload, int payload_len) {
     decode_rtcm_msm7_full(payload, payload_len, "GPS", 1077);
 }
@@ -1028,16 +1259,17 @@ void decode_rtcm_1137(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1007(const unsigned char *payload, int payload_len) {
-    int bit = 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
     if (payload_len < 4) {
         rtcm_printf("Type 1007: Payload too short!\n");
         return;
     }
 
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1007
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+    uint16_t msg_number = (uint16_t)rtcm_br_read(&br, 12); // Should be 1007
+    uint16_t ref_station_id = (uint16_t)rtcm_br_read(&br, 12);
 
-    uint8_t desc_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t desc_len = (uint8_t)rtcm_br_read(&br, 8);
     if (payload_len < 4 + desc_len) {
         rtcm_printf("Type 1007: Payload too short for antenna descriptor!\n");
         return;
@@ -1045,11 +1277,11 @@ void decode_rtcm_1007(const unsigned char *payload, int payload_len) {
 
     char descriptor[65] = {0};
     for (int i = 0; i < desc_len && i < 64; ++i) {
-        descriptor[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        descriptor[i] = (char)rtcm_br_read(&br, 8);
     }
     descriptor[64] = '\0';
 
-    uint8_t setup_id = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t setup_id = (uint8_t)rtcm_br_read(&br, 8);
 
     rtcm_printf("RTCM 1007:\n");
     rtcm_printf("  Message Number: %u\n", msg_number);
@@ -1059,16 +1291,17 @@ void decode_rtcm_1007(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1008(const unsigned char *payload, int payload_len) {
-    int bit = 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
     if (payload_len < 4) {
         rtcm_printf("Type 1008: Payload too short!\n");
         return;
     }
 
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1008
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+    uint16_t msg_number = (uint16_t)rtcm_br_read(&br, 12); // Should be 1008
+    uint16_t ref_station_id = (uint16_t)rtcm_br_read(&br, 12);
 
-    uint8_t desc_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t desc_len = (uint8_t)rtcm_br_read(&br, 8);
     if (payload_len < 4 + desc_len) {
         rtcm_printf("Type 1008: Payload too short for antenna descriptor!\n");
         return;
@@ -1076,11 +1309,11 @@ void decode_rtcm_1008(const unsigned char *payload, int payload_len) {
 
     char descriptor[65] = {0};
     for (int i = 0; i < desc_len && i < 64; ++i) {
-        descriptor[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        descriptor[i] = (char)rtcm_br_read(&br, 8);
     }
     descriptor[64] = '\0';
 
-    uint8_t serial_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t serial_len = (uint8_t)rtcm_br_read(&br, 8);
     if (payload_len < 4 + desc_len + 1 + serial_len) {
         rtcm_printf("Type 1008: Payload too short for antenna serial!\n");
         return;
@@ -1088,7 +1321,7 @@ void decode_rtcm_1008(const unsigned char *payload, int payload_len) {
 
     char serial[65] = {0};
     for (int i = 0; i < serial_len && i < 64; ++i) {
-        serial[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        serial[i] = (char)rtcm_br_read(&br, 8);
     }
     serial[64] = '\0';
 
@@ -1100,94 +1333,96 @@ void decode_rtcm_1008(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1013(const unsigned char *payload, int payload_len) {
-    int bit = 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
     if (payload_len < 8) { // Minimum size check (12+12+16+17+5+8 = 70 bits = 9 bytes minimum)
-        printf("Type 1013: Payload too short!\n");
+        rtcm_printf("Type 1013: Payload too short!\n");
         return;
     }
 
     // DF002: Message Number (12 bits)
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+    uint16_t msg_number = (uint16_t)rtcm_br_read(&br, 12);
     
     // DF003: Station ID (12 bits)
-    uint16_t station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+    uint16_t station_id = (uint16_t)rtcm_br_read(&br, 12);
     
     // DF051: Modified Julian Day Number (16 bits)
-    uint16_t mjd = (uint16_t)get_bits(payload, bit, 16); bit += 16;
+    uint16_t mjd = (uint16_t)rtcm_br_read(&br, 16);
     
     // DF052: Seconds of Day (17 bits)
-    uint32_t seconds_of_day = (uint32_t)get_bits(payload, bit, 17); bit += 17;
+    uint32_t seconds_of_day = (uint32_t)rtcm_br_read(&br, 17);
     
     // DF053: Number of Messages (5 bits)
-    uint8_t num_messages = (uint8_t)get_bits(payload, bit, 5); bit += 5;
+    uint8_t num_messages = (uint8_t)rtcm_br_read(&br, 5);
     
     // DF054: Leap Seconds (8 bits)
-    uint8_t leap_seconds = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t leap_seconds = (uint8_t)rtcm_br_read(&br, 8);
 
-    printf("RTCM 1013 (System Parameters):\n");
-    printf("  Message Number: %u\n", msg_number);
-    printf("  Station ID: %u\n", station_id);
-    printf("  Modified Julian Day (MJD): %u\n", mjd);
-    printf("  Seconds of Day: %u (%.2f hours)\n", seconds_of_day, seconds_of_day / 3600.0);
-    printf("  Leap Seconds: %u\n", leap_seconds);
-    printf("  Number of Sync Messages: %u\n", num_messages);
+    rtcm_printf("RTCM 1013 (System Parameters):\n");
+    rtcm_printf("  Message Number: %u\n", msg_number);
+    rtcm_printf("  Station ID: %u\n", station_id);
+    rtcm_printf("  Modified Julian Day (MJD): %u\n", mjd);
+    rtcm_printf("  Seconds of Day: %u (%.2f hours)\n", seconds_of_day, seconds_of_day / 3600.0);
+    rtcm_printf("  Leap Seconds: %u\n", leap_seconds);
+    rtcm_printf("  Number of Sync Messages: %u\n", num_messages);
 
     // Decode each message sync info
     for (int i = 0; i < num_messages; ++i) {
-        if ((bit + 29) / 8 > payload_len) {
-            printf("    Warning: Insufficient data for message %d\n", i + 1);
+        if ((br.pos + 29) / 8 > payload_len) {
+            rtcm_printf("    Warning: Insufficient data for message %d\n", i + 1);
             break;
         }
         
         // DF055: Message Number (12 bits)
-        uint16_t sync_msg_num = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+        uint16_t sync_msg_num = (uint16_t)rtcm_br_read(&br, 12);
         
         // DF056: Sync Flag (1 bit)
-        uint8_t sync_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
+        uint8_t sync_flag = (uint8_t)rtcm_br_read(&br, 1);
         
         // DF057: Transmission Interval (16 bits)
-        uint16_t interval = (uint16_t)get_bits(payload, bit, 16); bit += 16;
+        uint16_t interval = (uint16_t)rtcm_br_read(&br, 16);
         
-        printf("    Message %d: Type=%u, Sync=%s, Interval=%u\n", 
+        rtcm_printf("    Message %d: Type=%u, Sync=%s, Interval=%u\n", 
                i + 1, sync_msg_num, sync_flag ? "Yes" : "No", interval);
     }
 }
 
 void decode_rtcm_1033(const unsigned char *payload, int payload_len) {
-    int bit = 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
     if (payload_len < 8) {
         rtcm_printf("Type 1033: Payload too short!\n");
         return;
     }
 
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1033
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
+    uint16_t msg_number = (uint16_t)rtcm_br_read(&br, 12); // Should be 1033
+    uint16_t ref_station_id = (uint16_t)rtcm_br_read(&br, 12);
 
-    uint8_t ant_desc_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t ant_desc_len = (uint8_t)rtcm_br_read(&br, 8);
     char ant_desc[65] = {0};
     for (int i = 0; i < ant_desc_len && i < 64; ++i) {
-        ant_desc[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        ant_desc[i] = (char)rtcm_br_read(&br, 8);
     }
     ant_desc[64] = '\0';
 
-    uint8_t ant_serial_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t ant_serial_len = (uint8_t)rtcm_br_read(&br, 8);
     char ant_serial[65] = {0};
     for (int i = 0; i < ant_serial_len && i < 64; ++i) {
-        ant_serial[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        ant_serial[i] = (char)rtcm_br_read(&br, 8);
     }
     ant_serial[64] = '\0';
 
-    uint8_t recv_type_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t recv_type_len = (uint8_t)rtcm_br_read(&br, 8);
     char recv_type[65] = {0};
     for (int i = 0; i < recv_type_len && i < 64; ++i) {
-        recv_type[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        recv_type[i] = (char)rtcm_br_read(&br, 8);
     }
     recv_type[64] = '\0';
 
-    uint8_t recv_serial_len = (uint8_t)get_bits(payload, bit, 8); bit += 8;
+    uint8_t recv_serial_len = (uint8_t)rtcm_br_read(&br, 8);
     char recv_serial[65] = {0};
     for (int i = 0; i < recv_serial_len && i < 64; ++i) {
-        recv_serial[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        recv_serial[i] = (char)rtcm_br_read(&br, 8);
     }
     recv_serial[64] = '\0';
 
@@ -1209,46 +1444,43 @@ void decode_rtcm_1033(const unsigned char *payload, int payload_len) {
  *   - applies the scaling factors specified in RTCM 10403.3 Table 3.5-22/23,
  *   - populates the orbital part of @p eph (gnss_id, prn, week, toe, toc,
  *     orbital elements, harmonic corrections, clock polynomial),
- *   - advances @p *bit by the consumed bit count.
+ *   - advances @p br past the consumed bits.
  *
  * Caller sets eph->health afterwards based on the per-message trailing bits.
  *
- * @param p           Raw RTCM payload.
- * @param bit         [in/out] Bit cursor.
+ * @param br          [in/out] Bit reader positioned at the SVID field.
  * @param eph         [out] SvEphemeris to populate.
  * @param out_iodnav  [out, may be NULL] Raw IODnav for printing.
  * @param out_sisa    [out, may be NULL] Raw SISA index for printing.
  */
-static void galileo_read_orbit_block(const unsigned char *p, int *bit,
+static void galileo_read_orbit_block(RtcmBitReader *br,
                                      SvEphemeris *eph,
                                      uint32_t *out_iodnav, uint32_t *out_sisa)
 {
-    int b = *bit;
-    uint32_t svid    = (uint32_t)get_bits(p, b, 6);          b += 6;
-    uint32_t week    = (uint32_t)get_bits(p, b, 12);         b += 12;
-    uint32_t iodnav  = (uint32_t)get_bits(p, b, 10);         b += 10;
-    uint32_t sisa    = (uint32_t)get_bits(p, b, 8);          b += 8;
-    int32_t  idot    = (int32_t) extract_signed(p, b, 14);   b += 14;
-    uint32_t toc_raw = (uint32_t)get_bits(p, b, 14);         b += 14;
-    int32_t  af2     = (int32_t) extract_signed(p, b, 6);    b += 6;
-    int32_t  af1     = (int32_t) extract_signed(p, b, 21);   b += 21;
-    int32_t  af0     = (int32_t) extract_signed(p, b, 31);   b += 31;
-    int32_t  crs     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    int32_t  delta_n = (int32_t) extract_signed(p, b, 16);   b += 16;
-    int32_t  m0      = (int32_t) extract_signed(p, b, 32);   b += 32;
-    int32_t  cuc     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    uint64_t e_raw   =          get_bits(p, b, 32);          b += 32;
-    int32_t  cus     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    uint64_t sqrtA   =          get_bits(p, b, 32);          b += 32;
-    uint32_t toe_raw = (uint32_t)get_bits(p, b, 14);         b += 14;
-    int32_t  cic     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    int32_t  omega0  = (int32_t) extract_signed(p, b, 32);   b += 32;
-    int32_t  cis     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    int32_t  i0      = (int32_t) extract_signed(p, b, 32);   b += 32;
-    int32_t  crc     = (int32_t) extract_signed(p, b, 16);   b += 16;
-    int32_t  omega   = (int32_t) extract_signed(p, b, 32);   b += 32;
-    int32_t  om_dot  = (int32_t) extract_signed(p, b, 24);   b += 24;
-    *bit = b;
+    uint32_t svid    = (uint32_t)rtcm_br_read(br, 6);
+    uint32_t week    = (uint32_t)rtcm_br_read(br, 12);
+    uint32_t iodnav  = (uint32_t)rtcm_br_read(br, 10);
+    uint32_t sisa    = (uint32_t)rtcm_br_read(br, 8);
+    int32_t  idot    = (int32_t) rtcm_br_read_signed(br, 14);
+    uint32_t toc_raw = (uint32_t)rtcm_br_read(br, 14);
+    int32_t  af2     = (int32_t) rtcm_br_read_signed(br, 6);
+    int32_t  af1     = (int32_t) rtcm_br_read_signed(br, 21);
+    int32_t  af0     = (int32_t) rtcm_br_read_signed(br, 31);
+    int32_t  crs     = (int32_t) rtcm_br_read_signed(br, 16);
+    int32_t  delta_n = (int32_t) rtcm_br_read_signed(br, 16);
+    int32_t  m0      = (int32_t) rtcm_br_read_signed(br, 32);
+    int32_t  cuc     = (int32_t) rtcm_br_read_signed(br, 16);
+    uint64_t e_raw   =          rtcm_br_read(br, 32);
+    int32_t  cus     = (int32_t) rtcm_br_read_signed(br, 16);
+    uint64_t sqrtA   =          rtcm_br_read(br, 32);
+    uint32_t toe_raw = (uint32_t)rtcm_br_read(br, 14);
+    int32_t  cic     = (int32_t) rtcm_br_read_signed(br, 16);
+    int32_t  omega0  = (int32_t) rtcm_br_read_signed(br, 32);
+    int32_t  cis     = (int32_t) rtcm_br_read_signed(br, 16);
+    int32_t  i0      = (int32_t) rtcm_br_read_signed(br, 32);
+    int32_t  crc     = (int32_t) rtcm_br_read_signed(br, 16);
+    int32_t  omega   = (int32_t) rtcm_br_read_signed(br, 32);
+    int32_t  om_dot  = (int32_t) rtcm_br_read_signed(br, 24);
 
     memset(eph, 0, sizeof(*eph));
     eph->gnss_id      = 3;             /* Galileo */
@@ -1315,8 +1547,9 @@ void decode_rtcm_1045(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1045) {
         rtcm_printf("[1045] Not a 1045 message (got %u)\n", msg_type);
         return;
@@ -1324,12 +1557,12 @@ void decode_rtcm_1045(const unsigned char *payload, int payload_len) {
 
     SvEphemeris eph;
     uint32_t iodnav, sisa;
-    galileo_read_orbit_block(payload, &bit, &eph, &iodnav, &sisa);
+    galileo_read_orbit_block(&br, &eph, &iodnav, &sisa);
 
     /* Trailing F/NAV-specific fields */
-    int32_t  bgd_e1_e5a = (int32_t) extract_signed(payload, bit, 10); bit += 10;
-    uint32_t e5a_oshs   = (uint32_t)get_bits(payload, bit, 2);        bit += 2;
-    uint32_t e5a_osdvs  = (uint32_t)get_bits(payload, bit, 1);        bit += 1;
+    int32_t  bgd_e1_e5a = (int32_t) rtcm_br_read_signed(&br, 10);
+    uint32_t e5a_oshs   = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t e5a_osdvs  = (uint32_t)rtcm_br_read(&br, 1);
     /* 7-bit reserved */
 
     double bgd_e1_e5a_s = (double)bgd_e1_e5a * pow(2.0, -32);
@@ -1337,7 +1570,7 @@ void decode_rtcm_1045(const unsigned char *payload, int payload_len) {
     /* Health: combine 2-bit OSHS and 1-bit OSDVS into a single field.
      * Bit 0 = OSHS LSB, bit 1 = OSHS MSB, bit 2 = OSDVS.  0 = nominal. */
     eph.health = (int)((e5a_osdvs << 2) | (e5a_oshs & 0x3));
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     rtcm_printf("RTCM 1045 (Galileo F/NAV Ephemeris):\n");
     galileo_print_orbit_block(&eph, iodnav, sisa);
@@ -1350,14 +1583,13 @@ void decode_rtcm_1045(const unsigned char *payload, int payload_len) {
  *
  * GLONASS broadcast values use a 1-bit sign followed by (bits-1) bits of
  * magnitude — NOT two's complement as in GPS / Galileo / BeiDou.
- * @param p     RTCM payload.
- * @param bit   Starting bit position.
+ * @param br    Bit reader; advanced by @p bits.
  * @param bits  Total field width (sign + magnitude).
  */
-static int64_t glo_sign_mag(const unsigned char *p, int bit, int bits)
+static int64_t glo_sign_mag(RtcmBitReader *br, int bits)
 {
-    int     sign = (int)get_bits(p, bit, 1);
-    uint64_t mag = get_bits(p, bit + 1, bits - 1);
+    int     sign = (int)rtcm_br_read(br, 1);
+    uint64_t mag = rtcm_br_read(br, bits - 1);
     return sign ? -(int64_t)mag : (int64_t)mag;
 }
 
@@ -1372,45 +1604,46 @@ void decode_rtcm_1020(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1020) {
         rtcm_printf("[1020] Not a 1020 message (got %u)\n", msg_type);
         return;
     }
 
-    uint32_t prn       = (uint32_t)get_bits(payload, bit, 6);  bit += 6;
-    uint32_t freq_raw  = (uint32_t)get_bits(payload, bit, 5);  bit += 5;
-    uint32_t alm_hlt   = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    uint32_t alm_hlt_v = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    uint32_t p1        = (uint32_t)get_bits(payload, bit, 2);  bit += 2;
-    uint32_t tk        = (uint32_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t bn_msb    = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    uint32_t p2        = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    uint32_t tb_raw    = (uint32_t)get_bits(payload, bit, 7);  bit += 7;
+    uint32_t prn       = (uint32_t)rtcm_br_read(&br, 6);
+    uint32_t freq_raw  = (uint32_t)rtcm_br_read(&br, 5);
+    uint32_t alm_hlt   = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t alm_hlt_v = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t p1        = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t tk        = (uint32_t)rtcm_br_read(&br, 12);
+    uint32_t bn_msb    = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t p2        = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t tb_raw    = (uint32_t)rtcm_br_read(&br, 7);
 
     /* X-axis state vector */
-    int64_t  vx_raw    = glo_sign_mag(payload, bit, 24);  bit += 24;
-    int64_t  x_raw     = glo_sign_mag(payload, bit, 27);  bit += 27;
-    int64_t  ax_raw    = glo_sign_mag(payload, bit, 5);   bit += 5;
+    int64_t  vx_raw    = glo_sign_mag(&br, 24);
+    int64_t  x_raw     = glo_sign_mag(&br, 27);
+    int64_t  ax_raw    = glo_sign_mag(&br, 5);
 
     /* Y-axis state vector */
-    int64_t  vy_raw    = glo_sign_mag(payload, bit, 24);  bit += 24;
-    int64_t  y_raw     = glo_sign_mag(payload, bit, 27);  bit += 27;
-    int64_t  ay_raw    = glo_sign_mag(payload, bit, 5);   bit += 5;
+    int64_t  vy_raw    = glo_sign_mag(&br, 24);
+    int64_t  y_raw     = glo_sign_mag(&br, 27);
+    int64_t  ay_raw    = glo_sign_mag(&br, 5);
 
     /* Z-axis state vector */
-    int64_t  vz_raw    = glo_sign_mag(payload, bit, 24);  bit += 24;
-    int64_t  z_raw     = glo_sign_mag(payload, bit, 27);  bit += 27;
-    int64_t  az_raw    = glo_sign_mag(payload, bit, 5);   bit += 5;
-
-    uint32_t p3        = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    int64_t  gamma_raw = glo_sign_mag(payload, bit, 11);  bit += 11;
-    uint32_t m_p       = (uint32_t)get_bits(payload, bit, 2);  bit += 2;
-    uint32_t m_ln3     = (uint32_t)get_bits(payload, bit, 1);  bit += 1;
-    int64_t  tau_raw   = glo_sign_mag(payload, bit, 22);  bit += 22;
-    uint32_t m_dtau    = (uint32_t)get_bits(payload, bit, 5);  bit += 5;
-    uint32_t en        = (uint32_t)get_bits(payload, bit, 5);  bit += 5;
+    int64_t  vz_raw    = glo_sign_mag(&br, 24);
+    int64_t  z_raw     = glo_sign_mag(&br, 27);
+    int64_t  az_raw    = glo_sign_mag(&br, 5);
+
+    uint32_t p3        = (uint32_t)rtcm_br_read(&br, 1);
+    int64_t  gamma_raw = glo_sign_mag(&br, 11);
+    uint32_t m_p       = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t m_ln3     = (uint32_t)rtcm_br_read(&br, 1);
+    int64_t  tau_raw   = glo_sign_mag(&br, 22);
+    uint32_t m_dtau    = (uint32_t)rtcm_br_read(&br, 5);
+    uint32_t en        = (uint32_t)rtcm_br_read(&br, 5);
     /* Remaining trailing fields (M_P4, M_F_t, M_N_t, etc.) are not needed
      * for orbit propagation; ignore for the sky-plot use case. */
 
@@ -1453,7 +1686,7 @@ void decode_rtcm_1020(const unsigned char *payload, int payload_len) {
     eph.glo_acc[2]     = azm;
     eph.glo_tb_sod     = tb_sod;
     eph.glo_freq_chan  = freq;
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     rtcm_printf("RTCM 1020 (GLONASS Ephemeris):\n");
     rtcm_printf("  SV: R%02u   FDMA chan K: %+d   tb: %.0f s of day (Moscow)\n",
@@ -1480,42 +1713,43 @@ void decode_rtcm_1044(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1044) {
         rtcm_printf("[1044] Not a 1044 message (got %u)\n", msg_type);
         return;
     }
 
-    uint32_t prn       = (uint32_t)get_bits(payload, bit, 4);          bit += 4;
-    uint32_t toc_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    int32_t  af2       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    int32_t  af1       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  af0       = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    uint32_t iode      = (uint32_t)get_bits(payload, bit, 8);          bit += 8;
-    int32_t  crs       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  delta_n   = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  m0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cuc       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    uint64_t e_raw     =          get_bits(payload, bit, 32);          bit += 32;
-    int32_t  cus       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    uint64_t sqrtA_raw =          get_bits(payload, bit, 32);          bit += 32;
-    uint32_t toe_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    int32_t  cic       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  omega0    = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cis       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  i0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  crc       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  omega     = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  omega_dot = (int32_t) extract_signed(payload, bit, 24);   bit += 24;
-    int32_t  idot      = (int32_t) extract_signed(payload, bit, 14);   bit += 14;
-    uint32_t code_l2   = (uint32_t)get_bits(payload, bit, 2);          bit += 2;
-    uint32_t week      = (uint32_t)get_bits(payload, bit, 10);         bit += 10;
-    uint32_t sv_acc    = (uint32_t)get_bits(payload, bit, 4);          bit += 4;
-    uint32_t health    = (uint32_t)get_bits(payload, bit, 6);          bit += 6;
-    int32_t  tgd       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    uint32_t iodc      = (uint32_t)get_bits(payload, bit, 10);         bit += 10;
-    uint32_t fit_flag  = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
+    uint32_t prn       = (uint32_t)rtcm_br_read(&br, 4);
+    uint32_t toc_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    int32_t  af2       = (int32_t) rtcm_br_read_signed(&br, 8);
+    int32_t  af1       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  af0       = (int32_t) rtcm_br_read_signed(&br, 22);
+    uint32_t iode      = (uint32_t)rtcm_br_read(&br, 8);
+    int32_t  crs       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  delta_n   = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  m0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cuc       = (int32_t) rtcm_br_read_signed(&br, 16);
+    uint64_t e_raw     =          rtcm_br_read(&br, 32);
+    int32_t  cus       = (int32_t) rtcm_br_read_signed(&br, 16);
+    uint64_t sqrtA_raw =          rtcm_br_read(&br, 32);
+    uint32_t toe_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    int32_t  cic       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  omega0    = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cis       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  i0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  crc       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  omega     = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  omega_dot = (int32_t) rtcm_br_read_signed(&br, 24);
+    int32_t  idot      = (int32_t) rtcm_br_read_signed(&br, 14);
+    uint32_t code_l2   = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t week      = (uint32_t)rtcm_br_read(&br, 10);
+    uint32_t sv_acc    = (uint32_t)rtcm_br_read(&br, 4);
+    uint32_t health    = (uint32_t)rtcm_br_read(&br, 6);
+    int32_t  tgd       = (int32_t) rtcm_br_read_signed(&br, 8);
+    uint32_t iodc      = (uint32_t)rtcm_br_read(&br, 10);
+    uint32_t fit_flag  = (uint32_t)rtcm_br_read(&br, 1);
 
     /* QZSS uses GPS-identical scaling */
     double idot_s      = (double)idot      * pow(2.0, -43) * M_PI;
@@ -1567,7 +1801,7 @@ void decode_rtcm_1044(const unsigned char *payload, int payload_len) {
     eph.af1         = af1_s;
     eph.af2         = af2_s;
     eph.health      = (int)health;
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     rtcm_printf("RTCM 1044 (QZSS Ephemeris):\n");
     rtcm_printf("  SV: J%02u   Week: %u (10-bit, no rollover)   URA: %u\n",
@@ -1631,41 +1865,42 @@ void decode_rtcm_1041(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1041) {
         rtcm_printf("[1041] Not a 1041 message (got %u)\n", msg_type);
         return;
     }
 
-    uint32_t prn       = (uint32_t)get_bits(payload, bit, 6);          bit += 6;
-    uint32_t week      = (uint32_t)get_bits(payload, bit, 10);         bit += 10;
-    int32_t  af0       = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    int32_t  af1       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  af2       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    uint32_t ura       = (uint32_t)get_bits(payload, bit, 4);          bit += 4;
-    uint32_t toc_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    int32_t  tgd       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    int32_t  delta_n   = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    uint32_t iodec     = (uint32_t)get_bits(payload, bit, 8);          bit += 8;
-    bit += 10;   /* reserved */
-    uint32_t l5_flag   = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
-    uint32_t s_flag    = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
-    int32_t  cuc       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  cus       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  cic       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  cis       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  crc       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  crs       = (int32_t) extract_signed(payload, bit, 15);   bit += 15;
-    int32_t  idot      = (int32_t) extract_signed(payload, bit, 14);   bit += 14;
-    int32_t  m0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    uint32_t toe_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    uint64_t e_raw     =          get_bits(payload, bit, 32);          bit += 32;
-    uint64_t sqrtA_raw =          get_bits(payload, bit, 32);          bit += 32;
-    int32_t  omega0    = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  omega     = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  omega_dot = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    int32_t  i0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
+    uint32_t prn       = (uint32_t)rtcm_br_read(&br, 6);
+    uint32_t week      = (uint32_t)rtcm_br_read(&br, 10);
+    int32_t  af0       = (int32_t) rtcm_br_read_signed(&br, 22);
+    int32_t  af1       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  af2       = (int32_t) rtcm_br_read_signed(&br, 8);
+    uint32_t ura       = (uint32_t)rtcm_br_read(&br, 4);
+    uint32_t toc_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    int32_t  tgd       = (int32_t) rtcm_br_read_signed(&br, 8);
+    int32_t  delta_n   = (int32_t) rtcm_br_read_signed(&br, 22);
+    uint32_t iodec     = (uint32_t)rtcm_br_read(&br, 8);
+    rtcm_br_skip(&br, 10);   /* reserved */
+    uint32_t l5_flag   = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t s_flag    = (uint32_t)rtcm_br_read(&br, 1);
+    int32_t  cuc       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  cus       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  cic       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  cis       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  crc       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  crs       = (int32_t) rtcm_br_read_signed(&br, 15);
+    int32_t  idot      = (int32_t) rtcm_br_read_signed(&br, 14);
+    int32_t  m0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    uint32_t toe_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    uint64_t e_raw     =          rtcm_br_read(&br, 32);
+    uint64_t sqrtA_raw =          rtcm_br_read(&br, 32);
+    int32_t  omega0    = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  omega     = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  omega_dot = (int32_t) rtcm_br_read_signed(&br, 22);
+    int32_t  i0        = (int32_t) rtcm_br_read_signed(&br, 32);
 
     /* ── Scaling.  Angular fields stored in semi-circles use the
      *    factor pi (1 semi-circle = pi radians). ── */
@@ -1726,7 +1961,7 @@ void decode_rtcm_1041(const unsigned char *payload, int payload_len) {
         eph.af1          = af1_s;
         eph.af2          = af2_s;
         eph.health       = 0;             /* RTCM 1041 carries no explicit health flag */
-        sv_eph_store(&eph);
+        eph_decoded(&eph);
     }
 
     rtcm_printf("RTCM 1041 (NavIC Ephemeris):\n");
@@ -1761,41 +1996,42 @@ void decode_rtcm_1042(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1042) {
         rtcm_printf("[1042] Not a 1042 message (got %u)\n", msg_type);
         return;
     }
 
-    uint32_t prn       = (uint32_t)get_bits(payload, bit, 6);          bit += 6;
-    uint32_t week      = (uint32_t)get_bits(payload, bit, 13);         bit += 13;
-    uint32_t urai      = (uint32_t)get_bits(payload, bit, 4);          bit += 4;
-    int32_t  idot      = (int32_t) extract_signed(payload, bit, 14);   bit += 14;
-    uint32_t aode      = (uint32_t)get_bits(payload, bit, 5);          bit += 5;
-    uint32_t toc_raw   = (uint32_t)get_bits(payload, bit, 17);         bit += 17;
-    int32_t  a2        = (int32_t) extract_signed(payload, bit, 11);   bit += 11;
-    int32_t  a1        = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    int32_t  a0        = (int32_t) extract_signed(payload, bit, 24);   bit += 24;
-    uint32_t aodc      = (uint32_t)get_bits(payload, bit, 5);          bit += 5;
-    int32_t  crs       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    int32_t  delta_n   = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  m0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cuc       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    uint64_t e_raw     =          get_bits(payload, bit, 32);          bit += 32;
-    int32_t  cus       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    uint64_t sqrtA_raw =          get_bits(payload, bit, 32);          bit += 32;
-    uint32_t toe_raw   = (uint32_t)get_bits(payload, bit, 17);         bit += 17;
-    int32_t  cic       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    int32_t  omega0    = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cis       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    int32_t  i0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  crc       = (int32_t) extract_signed(payload, bit, 18);   bit += 18;
-    int32_t  omega     = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  omega_dot = (int32_t) extract_signed(payload, bit, 24);   bit += 24;
-    int32_t  tgd1      = (int32_t) extract_signed(payload, bit, 10);   bit += 10;
-    int32_t  tgd2      = (int32_t) extract_signed(payload, bit, 10);   bit += 10;
-    uint32_t health    = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
+    uint32_t prn       = (uint32_t)rtcm_br_read(&br, 6);
+    uint32_t week      = (uint32_t)rtcm_br_read(&br, 13);
+    uint32_t urai      = (uint32_t)rtcm_br_read(&br, 4);
+    int32_t  idot      = (int32_t) rtcm_br_read_signed(&br, 14);
+    uint32_t aode      = (uint32_t)rtcm_br_read(&br, 5);
+    uint32_t toc_raw   = (uint32_t)rtcm_br_read(&br, 17);
+    int32_t  a2        = (int32_t) rtcm_br_read_signed(&br, 11);
+    int32_t  a1        = (int32_t) rtcm_br_read_signed(&br, 22);
+    int32_t  a0        = (int32_t) rtcm_br_read_signed(&br, 24);
+    uint32_t aodc      = (uint32_t)rtcm_br_read(&br, 5);
+    int32_t  crs       = (int32_t) rtcm_br_read_signed(&br, 18);
+    int32_t  delta_n   = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  m0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cuc       = (int32_t) rtcm_br_read_signed(&br, 18);
+    uint64_t e_raw     =          rtcm_br_read(&br, 32);
+    int32_t  cus       = (int32_t) rtcm_br_read_signed(&br, 18);
+    uint64_t sqrtA_raw =          rtcm_br_read(&br, 32);
+    uint32_t toe_raw   = (uint32_t)rtcm_br_read(&br, 17);
+    int32_t  cic       = (int32_t) rtcm_br_read_signed(&br, 18);
+    int32_t  omega0    = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cis       = (int32_t) rtcm_br_read_signed(&br, 18);
+    int32_t  i0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  crc       = (int32_t) rtcm_br_read_signed(&br, 18);
+    int32_t  omega     = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  omega_dot = (int32_t) rtcm_br_read_signed(&br, 24);
+    int32_t  tgd1      = (int32_t) rtcm_br_read_signed(&br, 10);
+    int32_t  tgd2      = (int32_t) rtcm_br_read_signed(&br, 10);
+    uint32_t health    = (uint32_t)rtcm_br_read(&br, 1);
 
     /* Apply BeiDou-specific scaling */
     double idot_s      = (double)idot      * pow(2.0, -43) * M_PI;
@@ -1849,7 +2085,7 @@ void decode_rtcm_1042(const unsigned char *payload, int payload_len) {
     eph.af1         = a1_s;
     eph.af2         = a2_s;
     eph.health      = (int)health;
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     rtcm_printf("RTCM 1042 (BeiDou D1 Ephemeris):\n");
     rtcm_printf("  SV: C%02u   BDT Week: %u (13-bit)   URAI: %u\n", prn, week, urai);
@@ -1875,8 +2111,9 @@ void decode_rtcm_1046(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1046) {
         rtcm_printf("[1046] Not a 1046 message (got %u)\n", msg_type);
         return;
@@ -1884,15 +2121,15 @@ void decode_rtcm_1046(const unsigned char *payload, int payload_len) {
 
     SvEphemeris eph;
     uint32_t iodnav, sisa;
-    galileo_read_orbit_block(payload, &bit, &eph, &iodnav, &sisa);
+    galileo_read_orbit_block(&br, &eph, &iodnav, &sisa);
 
     /* Trailing I/NAV-specific fields */
-    int32_t  bgd_e1_e5a = (int32_t) extract_signed(payload, bit, 10); bit += 10;
-    int32_t  bgd_e1_e5b = (int32_t) extract_signed(payload, bit, 10); bit += 10;
-    uint32_t e5b_shs    = (uint32_t)get_bits(payload, bit, 2);        bit += 2;
-    uint32_t e5b_dvs    = (uint32_t)get_bits(payload, bit, 1);        bit += 1;
-    uint32_t e1b_shs    = (uint32_t)get_bits(payload, bit, 2);        bit += 2;
-    uint32_t e1b_dvs    = (uint32_t)get_bits(payload, bit, 1);        bit += 1;
+    int32_t  bgd_e1_e5a = (int32_t) rtcm_br_read_signed(&br, 10);
+    int32_t  bgd_e1_e5b = (int32_t) rtcm_br_read_signed(&br, 10);
+    uint32_t e5b_shs    = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t e5b_dvs    = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t e1b_shs    = (uint32_t)rtcm_br_read(&br, 2);
+    uint32_t e1b_dvs    = (uint32_t)rtcm_br_read(&br, 1);
     /* 2-bit reserved */
 
     double bgd_e1_e5a_s = (double)bgd_e1_e5a * pow(2.0, -32);
@@ -1902,7 +2139,7 @@ void decode_rtcm_1046(const unsigned char *payload, int payload_len) {
      * bits 0-1 = E5b SHS, bit 2 = E5b DVS, bits 3-4 = E1B SHS, bit 5 = E1B DVS. */
     eph.health = (int)((e1b_dvs << 5) | (e1b_shs << 3) |
                        (e5b_dvs << 2) | (e5b_shs & 0x3));
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     rtcm_printf("RTCM 1046 (Galileo I/NAV Ephemeris):\n");
     galileo_print_orbit_block(&eph, iodnav, sisa);
@@ -1913,15 +2150,16 @@ void decode_rtcm_1046(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1230(const unsigned char *payload, int payload_len) {
-    int bit = 0;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
     if (payload_len < 4) {
         rtcm_printf("Type 1230: Payload too short!\n");
         return;
     }
 
-    uint16_t msg_number = (uint16_t)get_bits(payload, bit, 12); bit += 12; // Should be 1230
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint8_t num_sats = (uint8_t)get_bits(payload, bit, 6); bit += 6;
+    uint16_t msg_number = (uint16_t)rtcm_br_read(&br, 12); // Should be 1230
+    uint16_t ref_station_id = (uint16_t)rtcm_br_read(&br, 12);
+    uint8_t num_sats = (uint8_t)rtcm_br_read(&br, 6);
 
     rtcm_printf("RTCM 1230 (GLONASS L1/L2 Code-Phase Biases):\n");
     rtcm_printf("  Message Number: %u\n", msg_number);
@@ -1929,12 +2167,12 @@ void decode_rtcm_1230(const unsigned char *payload, int payload_len) {
     rtcm_printf("  Number of Satellites: %u\n", num_sats);
 
     for (int i = 0; i < num_sats; ++i) {
-        if ((bit + 22) > payload_len * 8) {
+        if (rtcm_br_left(&br) < 22) {
             rtcm_printf("  [WARN] Not enough data for satellite %d\n", i + 1);
             break;
         }
-        uint8_t sat_id = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-        int16_t bias = (int16_t)get_bits(payload, bit, 16); bit += 16;
+        uint8_t sat_id = (uint8_t)rtcm_br_read(&br, 6);
+        int16_t bias = (int16_t)rtcm_br_read(&br, 16);
         double bias_ns = bias * 0.01; // Convert to nanoseconds
 
         rtcm_printf("    Satellite %d: Slot ID = %u, L1-L2 Code-Phase Bias = %.2f ns\n", i + 1, sat_id, bias_ns);
@@ -1942,19 +2180,20 @@ void decode_rtcm_1230(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1012(const unsigned char *payload, int payload_len) {
-    int bit = 0;
-    int msg_type = (int)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    int msg_type = (int)rtcm_br_read(&br, 12);
     if (msg_type != 1012) {
         rtcm_printf("[1012] Not a 1012 message (got %d)\n", msg_type);
         return;
     }
 
-    int ref_station_id = (int)get_bits(payload, bit, 12); bit += 12;
-    int epoch_time = (int)get_bits(payload, bit, 27); bit += 27;
-    int sync_gnss_flag = (int)get_bits(payload, bit, 1); bit += 1;
-    int num_satellites = (int)get_bits(payload, bit, 6); bit += 6;
-    int smoothing = (int)get_bits(payload, bit, 1); bit += 1;
-    int smoothing_interval = (int)get_bits(payload, bit, 3); bit += 3;
+    int ref_station_id = (int)rtcm_br_read(&br, 12);
+    int epoch_time = (int)rtcm_br_read(&br, 27);
+    int sync_gnss_flag = (int)rtcm_br_read(&br, 1);
+    int num_satellites = (int)rtcm_br_read(&br, 6);
+    int smoothing = (int)rtcm_br_read(&br, 1);
+    int smoothing_interval = (int)rtcm_br_read(&br, 3);
 
     rtcm_printf("RTCM 1012 (GLONASS L1&L2 RTK Observables)\n");
     rtcm_printf("  Reference Station ID: %d\n", ref_station_id);
@@ -1965,19 +2204,19 @@ void decode_rtcm_1012(const unsigned char *payload, int payload_len) {
     rtcm_printf("  Smoothing Interval: %d\n", smoothing_interval);
 
     for (int i = 0; i < num_satellites; ++i) {
-        int sat_id = (int)get_bits(payload, bit, 6); bit += 6;
-        int l1_code_ind = (int)get_bits(payload, bit, 1); bit += 1;
-        int l1_pseudorange = (int)get_bits(payload, bit, 25); bit += 25;
-        int l1_phase_range = (int)get_bits(payload, bit, 20); bit += 20;
-        int l1_lock_time = (int)get_bits(payload, bit, 7); bit += 7;
-        int l1_ambiguity = (int)get_bits(payload, bit, 7); bit += 7;
-        int l1_cnr = (int)get_bits(payload, bit, 8); bit += 8;
-
-        int l2_code_ind = (int)get_bits(payload, bit, 2); bit += 2;
-        int l2_pseudorange_diff = (int)get_bits(payload, bit, 14); bit += 14;
-        int l2_phase_range_diff = (int)get_bits(payload, bit, 20); bit += 20;
-        int l2_lock_time = (int)get_bits(payload, bit, 7); bit += 7;
-        int l2_cnr = (int)get_bits(payload, bit, 8); bit += 8;
+        int sat_id = (int)rtcm_br_read(&br, 6);
+        int l1_code_ind = (int)rtcm_br_read(&br, 1);
+        int l1_pseudorange = (int)rtcm_br_read(&br, 25);
+        int l1_phase_range = (int)rtcm_br_read(&br, 20);
+        int l1_lock_time = (int)rtcm_br_read(&br, 7);
+        int l1_ambiguity = (int)rtcm_br_read(&br, 7);
+        int l1_cnr = (int)rtcm_br_read(&br, 8);
+
+        int l2_code_ind = (int)rtcm_br_read(&br, 2);
+        int l2_pseudorange_diff = (int)rtcm_br_read(&br, 14);
+        int l2_phase_range_diff = (int)rtcm_br_read(&br, 20);
+        int l2_lock_time = (int)rtcm_br_read(&br, 7);
+        int l2_cnr = (int)rtcm_br_read(&br, 8);
 
         rtcm_printf("  Satellite %d:\n", i + 1);
         rtcm_printf("    Satellite ID: %d\n", sat_id);
@@ -1995,7 +2234,184 @@ void decode_rtcm_1012(const unsigned char *payload, int payload_len) {
     }
 }
 
+/* ── Message-type registry ────────────────────────────────────────────
+ *
+ * RTCM_MSG_TABLE lists every known message type once; it expands into
+ * the dense info array and into a 4096-entry byte index keyed on the
+ * 12-bit message number, so rtcm_msg_info() is a single array load.
+ * Adding a type is one line here and costs nothing at lookup time.
+ *
+ * Decoders with the (payload, len) signature are wrapped in thin
+ * rtcm_dispatch_NNNN() thunks so every entry shares RtcmDecodeFn. */
+
+#define RTCM_DISPATCH_THUNK(t)                                              \
+    static void rtcm_dispatch_##t(RtcmDecoderCtx *ctx,                      \
+                                  const unsigned char *payload,             \
+                                  int payload_len, const NTRIP_Config *cfg) \
+    { (void)ctx; (void)cfg; decode_rtcm_##t(payload, payload_len); }
+
+RTCM_DISPATCH_THUNK(1007)
+RTCM_DISPATCH_THUNK(1008)
+RTCM_DISPATCH_THUNK(1012)
+RTCM_DISPATCH_THUNK(1013)
+RTCM_DISPATCH_THUNK(1019)
+RTCM_DISPATCH_THUNK(1020)
+RTCM_DISPATCH_THUNK(1029)
+RTCM_DISPATCH_THUNK(1033)
+RTCM_DISPATCH_THUNK(1041)
+RTCM_DISPATCH_THUNK(1042)
+RTCM_DISPATCH_THUNK(1044)
+RTCM_DISPATCH_THUNK(1045)
+RTCM_DISPATCH_THUNK(1046)
+RTCM_DISPATCH_THUNK(1074)
+RTCM_DISPATCH_THUNK(1077)
+RTCM_DISPATCH_THUNK(1084)
+RTCM_DISPATCH_THUNK(1087)
+RTCM_DISPATCH_THUNK(1094)
+RTCM_DISPATCH_THUNK(1097)
+RTCM_DISPATCH_THUNK(1117)
+RTCM_DISPATCH_THUNK(1124)
+RTCM_DISPATCH_THUNK(1127)
+RTCM_DISPATCH_THUNK(1137)
+RTCM_DISPATCH_THUNK(1230)
+
+#undef RTCM_DISPATCH_THUNK
+
+#define rtcm_dispatch_1005  decode_rtcm_1005_ctx
+#define rtcm_dispatch_1006  decode_rtcm_1006_ctx
+
+/*  X(type, name, flags, gnss_id, msm_subtype, decode) */
+#define RTCM_MSG_TABLE(X) \
+    X(1001, "GPS L1 RTK observables",             RTCM_MSG_F_OBS, 1, 0, NULL) \
+    X(1002, "GPS L1 extended RTK observables",    RTCM_MSG_F_OBS, 1, 0, NULL) \
+    X(1003, "GPS L1/L2 RTK observables",          RTCM_MSG_F_OBS, 1, 0, NULL) \
+    X(1004, "GPS L1/L2 extended RTK observables", RTCM_MSG_F_OBS, 1, 0, NULL) \
+    X(1005, "Station ARP",                        RTCM_MSG_F_STATION, 0, 0, rtcm_dispatch_1005) \
+    X(1006, "Station ARP with antenna height",    RTCM_MSG_F_STATION, 0, 0, rtcm_dispatch_1006) \
+    X(1007, "Antenna descriptor",                 RTCM_MSG_F_STATION, 0, 0, rtcm_dispatch_1007) \
+    X(1008, "Antenna descriptor and serial",      RTCM_MSG_F_STATION, 0, 0, rtcm_dispatch_1008) \
+    X(1009, "GLONASS L1 RTK observables",         RTCM_MSG_F_OBS, 2, 0, NULL) \
+    X(1010, "GLONASS L1 extended RTK observables",RTCM_MSG_F_OBS, 2, 0, NULL) \
+    X(1011, "GLONASS L1/L2 RTK observables",      RTCM_MSG_F_OBS, 2, 0, NULL) \
+    X(1012, "GLONASS L1/L2 extended RTK observables", RTCM_MSG_F_OBS, 2, 0, rtcm_dispatch_1012) \
+    X(1013, "System parameters",                  0, 0, 0, rtcm_dispatch_1013) \
+    X(1019, "GPS ephemeris",                      RTCM_MSG_F_EPH, 1, 0, rtcm_dispatch_1019) \
+    X(1020, "GLONASS ephemeris",                  RTCM_MSG_F_EPH, 2, 0, rtcm_dispatch_1020) \
+    X(1029, "Unicode text string",                0, 0, 0, rtcm_dispatch_1029) \
+    X(1033, "Receiver and antenna descriptors",   RTCM_MSG_F_STATION, 0, 0, rtcm_dispatch_1033) \
+    X(1041, "NavIC ephemeris",                    RTCM_MSG_F_EPH, 7, 0, rtcm_dispatch_1041) \
+    X(1042, "BeiDou ephemeris",                   RTCM_MSG_F_EPH, 5, 0, rtcm_dispatch_1042) \
+    X(1044, "QZSS ephemeris",                     RTCM_MSG_F_EPH, 4, 0, rtcm_dispatch_1044) \
+    X(1045, "Galileo F/NAV ephemeris",            RTCM_MSG_F_EPH, 3, 0, rtcm_dispatch_1045) \
+    X(1046, "Galileo I/NAV ephemeris",            RTCM_MSG_F_EPH, 3, 0, rtcm_dispatch_1046) \
+    X(1071, "GPS MSM1",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 1, NULL) \
+    X(1072, "GPS MSM2",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 2, NULL) \
+    X(1073, "GPS MSM3",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 3, NULL) \
+    X(1074, "GPS MSM4",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 4, rtcm_dispatch_1074) \
+    X(1075, "GPS MSM5",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 5, NULL) \
+    X(1076, "GPS MSM6",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 6, NULL) \
+    X(1077, "GPS MSM7",      RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 1, 7, rtcm_dispatch_1077) \
+    X(1081, "GLONASS MSM1",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 1, NULL) \
+    X(1082, "GLONASS MSM2",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 2, NULL) \
+    X(1083, "GLONASS MSM3",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 3, NULL) \
+    X(1084, "GLONASS MSM4",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 4, rtcm_dispatch_1084) \
+    X(1085, "GLONASS MSM5",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 5, NULL) \
+    X(1086, "GLONASS MSM6",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 6, NULL) \
+    X(1087, "GLONASS MSM7",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 2, 7, rtcm_dispatch_1087) \
+    X(1091, "Galileo MSM1",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 1, NULL) \
+    X(1092, "Galileo MSM2",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 2, NULL) \
+    X(1093, "Galileo MSM3",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 3, NULL) \
+    X(1094, "Galileo MSM4",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 4, rtcm_dispatch_1094) \
+    X(1095, "Galileo MSM5",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 5, NULL) \
+    X(1096, "Galileo MSM6",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 6, NULL) \
+    X(1097, "Galileo MSM7",  RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 3, 7, rtcm_dispatch_1097) \
+    X(1101, "SBAS MSM1",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 1, NULL) \
+    X(1102, "SBAS MSM2",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 2, NULL) \
+    X(1103, "SBAS MSM3",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 3, NULL) \
+    X(1104, "SBAS MSM4",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 4, NULL) \
+    X(1105, "SBAS MSM5",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 5, NULL) \
+    X(1106, "SBAS MSM6",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 6, NULL) \
+    X(1107, "SBAS MSM7",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 6, 7, NULL) \
+    X(1111, "QZSS MSM1",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 1, NULL) \
+    X(1112, "QZSS MSM2",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 2, NULL) \
+    X(1113, "QZSS MSM3",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 3, NULL) \
+    X(1114, "QZSS MSM4",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 4, NULL) \
+    X(1115, "QZSS MSM5",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 5, NULL) \
+    X(1116, "QZSS MSM6",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 6, NULL) \
+    X(1117, "QZSS MSM7",     RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 4, 7, rtcm_dispatch_1117) \
+    X(1121, "BeiDou MSM1",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 1, NULL) \
+    X(1122, "BeiDou MSM2",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 2, NULL) \
+    X(1123, "BeiDou MSM3",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 3, NULL) \
+    X(1124, "BeiDou MSM4",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 4, rtcm_dispatch_1124) \
+    X(1125, "BeiDou MSM5",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 5, NULL) \
+    X(1126, "BeiDou MSM6",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 6, NULL) \
+    X(1127, "BeiDou MSM7",   RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 5, 7, rtcm_dispatch_1127) \
+    X(1131, "NavIC MSM1",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 1, NULL) \
+    X(1132, "NavIC MSM2",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 2, NULL) \
+    X(1133, "NavIC MSM3",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 3, NULL) \
+    X(1134, "NavIC MSM4",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 4, NULL) \
+    X(1135, "NavIC MSM5",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 5, NULL) \
+    X(1136, "NavIC MSM6",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 6, NULL) \
+    X(1137, "NavIC MSM7",    RTCM_MSG_F_OBS | RTCM_MSG_F_MSM, 7, 7, rtcm_dispatch_1137) \
+    X(1230, "GLONASS code-phase biases",          0, 2, 0, rtcm_dispatch_1230)
+
+#define RTCM_MSG_X_ENUM(t, name, flags, gnss, sub, fn)  RTCM_MSG_IDX_##t,
+enum { RTCM_MSG_IDX_NONE = 0, RTCM_MSG_TABLE(RTCM_MSG_X_ENUM) RTCM_MSG_IDX_COUNT };
+#undef RTCM_MSG_X_ENUM
+
+#define RTCM_MSG_X_INFO(t, name, flags, gnss, sub, fn) \
+    [RTCM_MSG_IDX_##t] = { t, name, flags, gnss, sub, fn },
+static const RtcmMsgInfo g_rtcm_msg_info[RTCM_MSG_IDX_COUNT] = {
+    RTCM_MSG_TABLE(RTCM_MSG_X_INFO)
+};
+#undef RTCM_MSG_X_INFO
+
+#define RTCM_MSG_X_INDEX(t, name, flags, gnss, sub, fn)  [t] = RTCM_MSG_IDX_##t,
+static const uint8_t g_rtcm_msg_index[4096] = {
+    RTCM_MSG_TABLE(RTCM_MSG_X_INDEX)
+};
+#undef RTCM_MSG_X_INDEX
+
+typedef char rtcm_msg_index_fits_u8[(RTCM_MSG_IDX_COUNT <= 256) ? 1 : -1];
+
+const RtcmMsgInfo *rtcm_msg_info(int msg_type)
+{
+    if (msg_type <= 0 || msg_type > 4095) return NULL;
+    uint8_t idx = g_rtcm_msg_index[msg_type];
+    return idx ? &g_rtcm_msg_info[idx] : NULL;
+}
+
 int analyze_rtcm_message(const unsigned char *data, int length, bool suppress_output,const NTRIP_Config *config) {
+    return analyze_rtcm_message_ctx(&g_default_ctx, data, length, suppress_output, config);
+}
+
+/* The text of one call goes to ctx->out when set: rtcm_printf() follows
+ * the thread's buffer, which is swapped in for the call and restored. */
+static int analyze_rtcm_frame(RtcmDecoderCtx *ctx, const unsigned char *data,
+                              int length, bool suppress_output,
+                              const NTRIP_Config *config);
+
+int analyze_rtcm_message_ctx(RtcmDecoderCtx *ctx, const unsigned char *data,
+                             int length, bool suppress_output,
+                             const NTRIP_Config *config) {
+    if (suppress_output)
+        return analyze_rtcm_frame(ctx, data, length, suppress_output, config);
+    RtcmStrBuf *saved = g_rtcm_strbuf;
+    if (ctx->out) g_rtcm_strbuf = ctx->out;
+    int hint = 256;
+    if (length >= 6 && data[0] == 0xD3)
+        hint = rtcm_out_hint(((data[3] << 4) | (data[4] >> 4)) & 0x0FFF,
+                             ((data[1] & 0x03) << 8) | data[2]);
+    rtcm_out_frame_begin(hint);
+    int rc = analyze_rtcm_frame(ctx, data, length, suppress_output, config);
+    rtcm_out_frame_end();
+    g_rtcm_strbuf = saved;
+    return rc;
+}
+
+static int analyze_rtcm_frame(RtcmDecoderCtx *ctx, const unsigned char *data,
+                              int length, bool suppress_output,
+                              const NTRIP_Config *config) {
     if (length < 6) return -1;
 
     if (data[0] == 0xD3) {
@@ -2016,84 +2432,10 @@ int analyze_rtcm_message(const unsigned char *data, int length, bool suppress_ou
         }
 
         if (!suppress_output) {
-            if (msg_type == 1005) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1005 detected)\n", msg_type, msg_length);
-                decode_rtcm_1005(&data[3], msg_length, config);
-            } else if (msg_type == 1006) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1006 detected)\n", msg_type, msg_length);
-                decode_rtcm_1006(&data[3], msg_length, config);
-            } else if (msg_type == 1019) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1019 detected)\n", msg_type, msg_length);
-                decode_rtcm_1019(&data[3], msg_length);
-            } else if (msg_type == 1077) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1077 detected)\n", msg_type, msg_length);
-                decode_rtcm_1077(&data[3], msg_length);
-            } else if (msg_type == 1074) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1074 detected)\n", msg_type, msg_length);
-                decode_rtcm_msm4_generic(&data[3], msg_length, "GPS", 1074, 15, 22, 0.02, 0.0005);
-            } else if (msg_type == 1084) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1084 detected)\n", msg_type, msg_length);
-                decode_rtcm_msm4_generic(&data[3], msg_length, "GLONASS", 1084, 15, 22, 0.02, 0.0005);
-            } else if (msg_type == 1094) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1094 detected)\n", msg_type, msg_length);
-                decode_rtcm_msm4_generic(&data[3], msg_length, "Galileo", 1094, 15, 22, 0.02, 0.0005);
-            } else if (msg_type == 1124) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1124 detected)\n", msg_type, msg_length);
-                decode_rtcm_msm4_generic(&data[3], msg_length, "QZSS", 1124, 20, 24, 0.1, 0.0005);
-            } else if (msg_type == 1087) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1087 detected)\n", msg_type, msg_length);
-                decode_rtcm_1087(&data[3], msg_length);
-            } else if (msg_type == 1097) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1097 detected)\n", msg_type, msg_length);
-                decode_rtcm_1097(&data[3], msg_length);
-            } else if (msg_type == 1117) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1117 detected)\n", msg_type, msg_length);
-                decode_rtcm_1117(&data[3], msg_length);
-            } else if (msg_type == 1127) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1127 detected)\n", msg_type, msg_length);
-                decode_rtcm_1127(&data[3], msg_length);
-            } else if (msg_type == 1137) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1137 detected)\n", msg_type, msg_length);
-                decode_rtcm_1137(&data[3], msg_length);
-            } else if (msg_type == 1007) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1007 detected)\n", msg_type, msg_length);
-                decode_rtcm_1007(&data[3], msg_length);
-            } else if (msg_type == 1008) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1008 detected)\n", msg_type, msg_length);
-                decode_rtcm_1008(&data[3], msg_length);
-            } else if (msg_type == 1013) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1013 detected)\n", msg_type, msg_length);
-                decode_rtcm_1013(&data[3], msg_length);
-            } else if (msg_type == 1029) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1029 detected)\n", msg_type, msg_length);
-                decode_rtcm_1029(&data[3], msg_length);
-            } else if (msg_type == 1033) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1033 detected)\n", msg_type, msg_length);
-                decode_rtcm_1033(&data[3], msg_length);
-            } else if (msg_type == 1020) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1020 detected)\n", msg_type, msg_length);
-                decode_rtcm_1020(&data[3], msg_length);
-            } else if (msg_type == 1041) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1041 detected)\n", msg_type, msg_length);
-                decode_rtcm_1041(&data[3], msg_length);
-            } else if (msg_type == 1042) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1042 detected)\n", msg_type, msg_length);
-                decode_rtcm_1042(&data[3], msg_length);
-            } else if (msg_type == 1044) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1044 detected)\n", msg_type, msg_length);
-                decode_rtcm_1044(&data[3], msg_length);
-            } else if (msg_type == 1045) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1045 detected)\n", msg_type, msg_length);
-                decode_rtcm_1045(&data[3], msg_length);
-            } else if (msg_type == 1046) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1046 detected)\n", msg_type, msg_length);
-                decode_rtcm_1046(&data[3], msg_length);
-            } else if (msg_type == 1230) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1230 detected)\n", msg_type, msg_length);
-                decode_rtcm_1230(&data[3], msg_length);
-            } else if (msg_type == 1012) {
-                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type 1012 detected)\n", msg_type, msg_length);
-                decode_rtcm_1012(&data[3], msg_length);
+            const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+            if (info && info->decode) {
+                rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type %d detected)\n", msg_type, msg_length, msg_type);
+                info->decode(ctx, &data[3], msg_length, config);
             } else {
                 if (length >= frame_len) {
                     if (crc_calc != crc_extracted) {
@@ -2136,44 +2478,45 @@ void decode_rtcm_1019(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint32_t msg_type = (uint32_t)get_bits(payload, bit, 12); bit += 12;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint32_t msg_type = (uint32_t)rtcm_br_read(&br, 12);
     if (msg_type != 1019) {
         rtcm_printf("[1019] Not a 1019 message (got %u)\n", msg_type);
         return;
     }
 
     /* ── Field extraction, in the order defined by the RTCM spec ── */
-    uint32_t prn       = (uint32_t)get_bits(payload, bit, 6);          bit += 6;
-    uint32_t gps_week  = (uint32_t)get_bits(payload, bit, 10);         bit += 10;
-    uint32_t sv_acc    = (uint32_t)get_bits(payload, bit, 4);          bit += 4;
-    uint32_t code_l2   = (uint32_t)get_bits(payload, bit, 2);          bit += 2;
-    int32_t  idot      = (int32_t) extract_signed(payload, bit, 14);   bit += 14;
-    uint32_t iode      = (uint32_t)get_bits(payload, bit, 8);          bit += 8;
-    uint32_t toc_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    int32_t  af2       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    int32_t  af1       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  af0       = (int32_t) extract_signed(payload, bit, 22);   bit += 22;
-    uint32_t iodc      = (uint32_t)get_bits(payload, bit, 10);         bit += 10;
-    int32_t  crs       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  delta_n   = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  m0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cuc       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    uint64_t e_raw     =          get_bits(payload, bit, 32);          bit += 32;
-    int32_t  cus       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    uint64_t sqrtA_raw =          get_bits(payload, bit, 32);          bit += 32;
-    uint32_t toe_raw   = (uint32_t)get_bits(payload, bit, 16);         bit += 16;
-    int32_t  cic       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  omega0    = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  cis       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  i0        = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  crc       = (int32_t) extract_signed(payload, bit, 16);   bit += 16;
-    int32_t  omega     = (int32_t) extract_signed(payload, bit, 32);   bit += 32;
-    int32_t  omega_dot = (int32_t) extract_signed(payload, bit, 24);   bit += 24;
-    int32_t  tgd       = (int32_t) extract_signed(payload, bit, 8);    bit += 8;
-    uint32_t health    = (uint32_t)get_bits(payload, bit, 6);          bit += 6;
-    uint32_t l2p_flag  = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
-    uint32_t fit_flag  = (uint32_t)get_bits(payload, bit, 1);          bit += 1;
+    uint32_t prn       = (uint32_t)rtcm_br_read(&br, 6);
+    uint32_t gps_week  = (uint32_t)rtcm_br_read(&br, 10);
+    uint32_t sv_acc    = (uint32_t)rtcm_br_read(&br, 4);
+    uint32_t code_l2   = (uint32_t)rtcm_br_read(&br, 2);
+    int32_t  idot      = (int32_t) rtcm_br_read_signed(&br, 14);
+    uint32_t iode      = (uint32_t)rtcm_br_read(&br, 8);
+    uint32_t toc_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    int32_t  af2       = (int32_t) rtcm_br_read_signed(&br, 8);
+    int32_t  af1       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  af0       = (int32_t) rtcm_br_read_signed(&br, 22);
+    uint32_t iodc      = (uint32_t)rtcm_br_read(&br, 10);
+    int32_t  crs       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  delta_n   = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  m0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cuc       = (int32_t) rtcm_br_read_signed(&br, 16);
+    uint64_t e_raw     =          rtcm_br_read(&br, 32);
+    int32_t  cus       = (int32_t) rtcm_br_read_signed(&br, 16);
+    uint64_t sqrtA_raw =          rtcm_br_read(&br, 32);
+    uint32_t toe_raw   = (uint32_t)rtcm_br_read(&br, 16);
+    int32_t  cic       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  omega0    = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  cis       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  i0        = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  crc       = (int32_t) rtcm_br_read_signed(&br, 16);
+    int32_t  omega     = (int32_t) rtcm_br_read_signed(&br, 32);
+    int32_t  omega_dot = (int32_t) rtcm_br_read_signed(&br, 24);
+    int32_t  tgd       = (int32_t) rtcm_br_read_signed(&br, 8);
+    uint32_t health    = (uint32_t)rtcm_br_read(&br, 6);
+    uint32_t l2p_flag  = (uint32_t)rtcm_br_read(&br, 1);
+    uint32_t fit_flag  = (uint32_t)rtcm_br_read(&br, 1);
 
     /* ── Scaling.  "semi-circle" units (DF079, 087, 088, 095, 097, 099, 100)
      *    are converted to radians by multiplying the LSB by pi. ── */
@@ -2227,7 +2570,7 @@ void decode_rtcm_1019(const unsigned char *payload, int payload_len) {
     eph.af1          = af1_s;
     eph.af2          = af2_s;
     eph.health       = (int)health;
-    sv_eph_store(&eph);
+    eph_decoded(&eph);
 
     /* ── Print summary ── */
     rtcm_printf("RTCM 1019 (GPS Ephemeris):\n");
@@ -2250,303 +2593,19 @@ void decode_rtcm_1019(const unsigned char *payload, int payload_len) {
 }
 
 void decode_rtcm_1094(const unsigned char *payload, int payload_len) {
-    int bit = 0;
-    if (payload_len < 20) {
-        rtcm_printf("Type 1094: Payload too short!\n");
-        return;
-    }
-
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t mm_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t iods = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-    bit += 7; // reserved
-    uint8_t clk_steering = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t ext_clk = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t sync_gnss = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t num_sats = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-    uint8_t num_sigs = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-    // Satellite mask (num_sats bits)
-    uint64_t sat_mask = 0;
-    for (int i = 0; i < num_sats; ++i) {
-        sat_mask = (sat_mask << 1) | get_bits(payload, bit++, 1);
-    }
-
-    // Signal mask (num_sigs bits)
-    uint32_t sig_mask = 0;
-    for (int i = 0; i < num_sigs; ++i) {
-        sig_mask = (sig_mask << 1) | get_bits(payload, bit++, 1);
-    }
-
-    // Cell mask (num_sats * num_sigs bits)
-    int num_cells = 0;
-    int cell_mask_start = bit;
-    for (int i = 0; i < num_sats * num_sigs; ++i)
-        if (get_bits(payload, cell_mask_start + i, 1)) num_cells++;
-    bit += num_sats * num_sigs;
-
-    rtcm_printf("RTCM 1094 MSM4 (GLONASS):\n");
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time: %u ms\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag: %u\n", mm_flag);
-    rtcm_printf("  IODS: %u\n", iods);
-    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", clk_steering, ext_clk);
-    rtcm_printf("  Synchronous GNSS: %u\n", sync_gnss);
-    rtcm_printf("  Satellites: %u, Signals: %u, Cells: %d\n", num_sats, num_sigs, num_cells);
-
-    // MSM4: Only pseudorange, phase range, lock, half-cycle, CNR
-    for (int cell = 0; cell < num_cells && cell < 5; ++cell) {
-        int32_t pseudorange = (int32_t)get_bits(payload, bit, 15); bit += 15;
-        int32_t phaserange = (int32_t)get_bits(payload, bit, 22); bit += 22;
-        uint8_t lock = (uint8_t)get_bits(payload, bit, 4); bit += 4;
-        uint8_t half_cycle = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-        uint8_t cnr = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-        if (pseudorange & (1 << 14)) pseudorange -= (1 << 15);
-        if (phaserange & (1 << 21)) phaserange -= (1 << 22);
-
-        rtcm_printf("  Cell %d: PR=%.4f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
-            cell + 1,
-            pseudorange * 0.02,   // MSM4 scaling for pseudorange
-            phaserange * 0.0005,  // MSM4 scaling for phase range
-            lock,
-            half_cycle,
-            cnr
-        );
-    }
-    if (num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", num_cells - 5);
+    decode_rtcm_msm4_generic(payload, payload_len, "Galileo", 1094);
 }
 
 void decode_rtcm_1084(const unsigned char *payload, int payload_len) {
-    int bit = 0;
-    if (payload_len < 20) {
-        rtcm_printf("Type 1084: Payload too short!\n");
-        return;
-    }
-
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t mm_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t iods = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-    bit += 7; // session transmission time (reserved)
-    uint8_t clk_steering = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t ext_clk = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t df_smoothing = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t smoothing_int = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-
-    uint64_t sat_mask = get_bits(payload, bit, 64); bit += 64;
-    uint32_t sig_mask = (uint32_t)get_bits(payload, bit, 32); bit += 32;
-
-    // Count satellites and signals
-    int num_sats = 0, num_sigs = 0;
-    for (int i = 0; i < 64; ++i) if ((sat_mask >> (63 - i)) & 1) num_sats++;
-    for (int i = 0; i < 32; ++i) if ((sig_mask >> (31 - i)) & 1) num_sigs++;
-
-    // Cell mask
-    int num_cells = 0;
-    int cell_mask_start = bit;
-    for (int i = 0; i < num_sats * num_sigs; ++i)
-        if (get_bits(payload, cell_mask_start + i, 1)) num_cells++;
-    bit += num_sats * num_sigs;
-
-    // Print header
-    rtcm_printf("RTCM 1084 MSM4 (GPS):\n");
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time: %u ms\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag: %u\n", mm_flag);
-    rtcm_printf("  IODS: %u\n", iods);
-    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", clk_steering, ext_clk);
-    rtcm_printf("  Divergence-free Smoothing: %u, Smoothing Interval: %u\n", df_smoothing, smoothing_int);
-    rtcm_printf("  Satellites: %d, Signals: %d, Cells: %d\n", num_sats, num_sigs, num_cells);
-
-    // Print rough range and extended info for each satellite
-    rtcm_printf("  Satellite rough ranges and extended info:\n");
-    int sat_idx = 0;
-    for (int i = 0; i < 64; ++i) {
-        if ((sat_mask >> (63 - i)) & 1) {
-            if ((bit + 8 + 4) > payload_len * 8) {
-                rtcm_printf("    [WARN] Not enough data for satellite %d\n", i + 1);
-                break;
-            }
-            int rough_range = (int)get_bits(payload, bit, 8); bit += 8;
-            int ext_info = (int)get_bits(payload, bit, 4); bit += 4;
-            rtcm_printf("    PRN %2d: Rough Range = %3d, Extended Info = %2d\n", i + 1, rough_range, ext_info);
-            sat_idx++;
-        }
-    }
-
-    // MSM4: Fine pseudoranges, fine phases, lock, half-cycle, CNR
-    for (int cell = 0; cell < num_cells && cell < 5; ++cell) {
-        if ((bit + 15 + 22 + 4 + 1 + 6) > payload_len * 8) {
-            rtcm_printf("  [WARN] Not enough data for cell %d\n", cell + 1);
-            break;
-        }
-        int32_t pseudorange = (int32_t)get_bits(payload, bit, 15); bit += 15;
-        int32_t phaserange = (int32_t)get_bits(payload, bit, 22); bit += 22;
-        uint8_t lock = (uint8_t)get_bits(payload, bit, 4); bit += 4;
-        uint8_t half_cycle = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-        uint8_t cnr = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-        if (pseudorange & (1 << 14)) pseudorange -= (1 << 15);
-        if (phaserange & (1 << 21)) phaserange -= (1 << 22);
-
-        rtcm_printf("  Cell %d: PR=%.4f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
-            cell + 1,
-            pseudorange * 0.02,   // MSM4 scaling for pseudorange
-            phaserange * 0.0005,  // MSM4 scaling for phase range
-            lock,
-            half_cycle,
-            cnr
-        );
-    }
-    if (num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", num_cells - 5);
+    decode_rtcm_msm4_generic(payload, payload_len, "GLONASS", 1084);
 }
 
 void decode_rtcm_1074(const unsigned char *payload, int payload_len) {
-    int bit = 0;
-    if (payload_len < 20) {
-        rtcm_printf("Type 1074: Payload too short!\n");
-        return;
-    }
-
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t mm_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t iods = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-    bit += 7; // reserved/session transmission time
-    uint8_t clk_steering = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t ext_clk = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t df_smoothing = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t smoothing_int = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-
-    uint64_t sat_mask = get_bits(payload, bit, 64); bit += 64;
-    uint32_t sig_mask = (uint32_t)get_bits(payload, bit, 32); bit += 32;
-
-    // Count satellites and signals
-    int num_sats = 0, num_sigs = 0;
-    for (int i = 0; i < 64; ++i) if ((sat_mask >> (63 - i)) & 1) num_sats++;
-    for (int i = 0; i < 32; ++i) if ((sig_mask >> (31 - i)) & 1) num_sigs++;
-
-    // Cell mask
-    int num_cells = 0;
-    int cell_mask_start = bit;
-    for (int i = 0; i < num_sats * num_sigs; ++i)
-        if (get_bits(payload, cell_mask_start + i, 1)) num_cells++;
-    bit += num_sats * num_sigs;
-
-    // Satellite Data: Rough Range (8 bits), Extended Info (4 bits)
-    for (int i = 0, sat_idx = 0; i < 64; ++i) {
-        if ((sat_mask >> (63 - i)) & 1) {
-            (void)get_bits(payload, bit, 8); bit += 8;   // Rough Range
-            (void)get_bits(payload, bit, 4); bit += 4;   // Extended Info
-            sat_idx++;
-        }
-    }
-
-    rtcm_printf("RTCM 1074 MSM4 (GPS):\n");
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time: %u ms\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag: %u\n", mm_flag);
-    rtcm_printf("  IODS: %u\n", iods);
-    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", clk_steering, ext_clk);
-    rtcm_printf("  Divergence-free Smoothing: %u, Smoothing Interval: %u\n", df_smoothing, smoothing_int);
-    rtcm_printf("  Satellites: %d, Signals: %d, Cells: %d\n", num_sats, num_sigs, num_cells);
-
-    // MSM4: Fine pseudoranges, fine phases, lock, half-cycle, CNR
-    for (int cell = 0; cell < num_cells && cell < 5; ++cell) {
-        int32_t pseudorange = (int32_t)get_bits(payload, bit, 15); bit += 15;
-        int32_t phaserange = (int32_t)get_bits(payload, bit, 22); bit += 22;
-        uint8_t lock = (uint8_t)get_bits(payload, bit, 4); bit += 4;
-        uint8_t half_cycle = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-        uint8_t cnr = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-        if (pseudorange & (1 << 14)) pseudorange -= (1 << 15);
-        if (phaserange & (1 << 21)) phaserange -= (1 << 22);
-
-        rtcm_printf("  Cell %d: PR=%.4f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
-            cell + 1,
-            pseudorange * 0.02,   // MSM4 scaling for pseudorange
-            phaserange * 0.0005,  // MSM4 scaling for phase range
-            lock,
-            half_cycle,
-            cnr
-        );
-    }
-    if (num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", num_cells - 5);
+    decode_rtcm_msm4_generic(payload, payload_len, "GPS", 1074);
 }
 
 void decode_rtcm_1124(const unsigned char *payload, int payload_len) {
-    int bit =  0;
-    if (payload_len < 20) {
-        rtcm_printf("Type 1124: Payload too short!\n");
-        return;
-    }
-
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t mm_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t iods = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-    bit += 7; // reserved/session transmission time
-    uint8_t clk_steering = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t ext_clk = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t df_smoothing = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t smoothing_int = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-
-    uint64_t sat_mask = get_bits(payload, bit, 64); bit += 64;
-    uint32_t sig_mask = (uint32_t)get_bits(payload, bit, 32); bit += 32;
-
-    // Count satellites and signals
-    int num_sats = 0, num_sigs = 0;
-    for (int i = 0; i < 64; ++i) if ((sat_mask >> (63 - i)) & 1) num_sats++;
-    for (int i = 0; i < 32; ++i) if ((sig_mask >> (31 - i)) & 1) num_sigs++;
-
-    // Cell mask
-    int num_cells = 0;
-    int cell_mask_start = bit;
-    for (int i = 0; i < num_sats * num_sigs; ++i)
-        if (get_bits(payload, cell_mask_start + i, 1)) num_cells++;
-    bit += num_sats * num_sigs;
-
-    // Satellite Data: Rough Range (8 bits), Extended Info (4 bits)
-    for (int i = 0, sat_idx = 0; i < 64; ++i) {
-        if ((sat_mask >> (63 - i)) & 1) {
-            (void)get_bits(payload, bit, 8); bit += 8;   // Rough Range
-            (void)get_bits(payload, bit, 4); bit += 4;   // Extended Info
-            sat_idx++;
-        }
-    }
-
-    rtcm_printf("RTCM 1124 MSM4 (QZSS):\n");
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time: %u ms\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag: %u\n", mm_flag);
-    rtcm_printf("  IODS: %u\n", iods);
-    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", clk_steering, ext_clk);
-    rtcm_printf("  Divergence-free Smoothing: %u, Smoothing Interval: %u\n", df_smoothing, smoothing_int);
-    rtcm_printf("  Satellites: %d, Signals: %d, Cells: %d\n", num_sats, num_sigs, num_cells);
-
-    // Signal Data: For each cell (sat-sig pair in cell mask)
-    for (int cell = 0; cell < num_cells && cell < 5; ++cell) {
-        int32_t pseudorange = (int32_t)get_bits(payload, bit, 20); bit += 20;
-        int32_t phaserange = (int32_t)get_bits(payload, bit, 24); bit += 24;
-        uint8_t lock = (uint8_t)get_bits(payload, bit, 4); bit += 4;
-        uint8_t half_cycle = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-        uint8_t cnr = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-        if (pseudorange & (1 << 19)) pseudorange -= (1 << 20);
-        if (phaserange & (1 << 23)) phaserange -= (1 << 24);
-
-        rtcm_printf("  Cell %d: PR=%.1f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
-            cell + 1,
-            pseudorange * 0.1,   // MSM4 scaling for pseudorange (0.1 m)
-            phaserange * 0.0005, // MSM4 scaling for phase range (0.0005 m)
-            lock,
-            half_cycle,
-            cnr
-        );
-    }
-    if (num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", num_cells - 5);
+    decode_rtcm_msm4_generic(payload, payload_len, "BeiDou", 1124);
 }
 
 /**
@@ -2568,13 +2627,14 @@ void decode_rtcm_1029(const unsigned char *payload, int payload_len) {
         return;
     }
 
-    int bit = 0;
-    uint16_t msg_number      = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint16_t ref_station_id  = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint16_t mjd             = (uint16_t)get_bits(payload, bit, 16); bit += 16;
-    uint32_t sod             = (uint32_t)get_bits(payload, bit, 17); bit += 17;
-    uint8_t  n_bytes         = (uint8_t) get_bits(payload, bit,  7); bit +=  7;
-    uint8_t  n_chars         = (uint8_t) get_bits(payload, bit,  8); bit +=  8;
+    RtcmBitReader br;
+    rtcm_br_init(&br, payload, payload_len, 0);
+    uint16_t msg_number      = (uint16_t)rtcm_br_read(&br, 12);
+    uint16_t ref_station_id  = (uint16_t)rtcm_br_read(&br, 12);
+    uint16_t mjd             = (uint16_t)rtcm_br_read(&br, 16);
+    uint32_t sod             = (uint32_t)rtcm_br_read(&br, 17);
+    uint8_t  n_bytes         = (uint8_t) rtcm_br_read(&br, 7);
+    uint8_t  n_chars         = (uint8_t) rtcm_br_read(&br, 8);
     /* bit == 72 here */
 
     if (payload_len < 9 + n_bytes) {
@@ -2588,7 +2648,7 @@ void decode_rtcm_1029(const unsigned char *payload, int payload_len) {
     char text[256] = {0};
     int  copy_len  = (n_bytes < (int)sizeof(text) - 1) ? n_bytes : (int)sizeof(text) - 1;
     for (int i = 0; i < copy_len; i++) {
-        text[i] = (char)get_bits(payload, bit, 8); bit += 8;
+        text[i] = (char)rtcm_br_read(&br, 8);
     }
     text[copy_len] = '\0';
 
@@ -2607,92 +2667,68 @@ void decode_rtcm_1029(const unsigned char *payload, int payload_len) {
     rtcm_printf("  Text              : %s\n", text);
 }
 
+/* MSM4 text formatter over an already decoded frame. */
+static void format_msm4(const RtcmMsmObs *o, const char *gnss_name, int msg_type)
+{
+    char sys_letter = msm_gnss_letter(msg_type);
+
+    rtcm_printf("RTCM %d MSM4 (%s):\n", msg_type, gnss_name);
+    rtcm_printf("  Reference Station ID: %u\n", o->ref_station_id);
+    rtcm_printf("  Epoch Time: %u ms\n", o->epoch_time);
+    rtcm_printf("  Multiple Message Flag: %u\n", o->mm_flag);
+    rtcm_printf("  IODS: %u\n", o->iods);
+    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", o->clk_steering, o->ext_clk);
+    rtcm_printf("  Divergence-free Smoothing: %u, Smoothing Interval: %u\n", o->df_smoothing, o->smoothing_int);
+    rtcm_printf("  Satellites: %d, Signals: %d, Cells: %d\n", o->num_sats, o->num_sigs, o->num_cells);
+
+    // Print rough range for each satellite
+    rtcm_printf("  Satellite rough ranges:\n");
+    for (int s = 0; s < o->num_sats; ++s) {
+        const RtcmMsmSat *sat = &o->sats[s];
+        rtcm_printf("    PRN %2d: Rough Range = %3d + %4d/1024 ms\n",
+                    sat->prn, sat->rough_int_ms, sat->rough_mod);
+    }
+
+    // MSM4: full pseudorange, phase range, lock, half-cycle, CNR
+    for (int c = 0; c < o->num_cells && c < 5; ++c) {
+        const RtcmMsmCell *cell = &o->cells[c];
+        rtcm_printf("  Cell %d: %c%02d %-4s PR=%.4f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
+            c + 1, sys_letter, o->sats[cell->sat].prn,
+            msm_signal_label(o->gnss_id, cell->sig_idx),
+            cell->pr_m, cell->ph_m, cell->lock, cell->half_cycle, cell->cnr_raw);
+    }
+    if (o->num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", o->num_cells - 5);
+    if (o->truncated) rtcm_printf("  [WARN] Payload truncated, missing fields read as 0\n");
+}
+
 void decode_rtcm_msm4_generic(const unsigned char *payload, int payload_len,
-                              const char *gnss_name, int msg_type,
-                              int pr_bits, int ph_bits, double pr_scale, double ph_scale)
+                              const char *gnss_name, int msg_type)
 {
-    int bit = 0;
     if (payload_len < 20) {
         rtcm_printf("Type %d: Payload too short!\n", msg_type);
         return;
     }
-
-    uint16_t ref_station_id = (uint16_t)get_bits(payload, bit, 12); bit += 12;
-    uint32_t epoch_time = (uint32_t)get_bits(payload, bit, 30); bit += 30;
-    uint8_t mm_flag = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t iods = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-    bit += 7; // reserved/session transmission time
-    uint8_t clk_steering = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t ext_clk = (uint8_t)get_bits(payload, bit, 2); bit += 2;
-    uint8_t df_smoothing = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-    uint8_t smoothing_int = (uint8_t)get_bits(payload, bit, 3); bit += 3;
-
-    uint64_t sat_mask = get_bits(payload, bit, 64); bit += 64;
-    uint32_t sig_mask = (uint32_t)get_bits(payload, bit, 32); bit += 32;
-
-    // Count satellites and signals
-    int num_sats = 0, num_sigs = 0;
-    for (int i = 0; i < 64; ++i) if ((sat_mask >> (63 - i)) & 1) num_sats++;
-    for (int i = 0; i < 32; ++i) if ((sig_mask >> (31 - i)) & 1) num_sigs++;
-
-    // Cell mask
-    int num_cells = 0;
-    int cell_mask_start = bit;
-    for (int i = 0; i < num_sats * num_sigs; ++i)
-        if (get_bits(payload, cell_mask_start + i, 1)) num_cells++;
-    bit += num_sats * num_sigs;
-
-    rtcm_printf("RTCM %d MSM4 (%s):\n", msg_type, gnss_name);
-    rtcm_printf("  Reference Station ID: %u\n", ref_station_id);
-    rtcm_printf("  Epoch Time: %u ms\n", epoch_time);
-    rtcm_printf("  Multiple Message Flag: %u\n", mm_flag);
-    rtcm_printf("  IODS: %u\n", iods);
-    rtcm_printf("  Clock Steering: %u, Ext Clock: %u\n", clk_steering, ext_clk);
-    rtcm_printf("  Divergence-free Smoothing: %u, Smoothing Interval: %u\n", df_smoothing, smoothing_int);
-    rtcm_printf("  Satellites: %d, Signals: %d, Cells: %d\n", num_sats, num_sigs, num_cells);
-
-    // Print rough range and extended info for each satellite
-    rtcm_printf("  Satellite rough ranges and extended info:\n");
-    int sat_idx = 0;
-    for (int i = 0; i < 64; ++i) {
-        if ((sat_mask >> (63 - i)) & 1) {
-            if ((bit + 8 + 4) > payload_len * 8) {
-                rtcm_printf("    [WARN] Not enough data for satellite %d\n", i + 1);
-                break;
-            }
-            int rough_range = (int)get_bits(payload, bit, 8); bit += 8;
-            int ext_info = (int)get_bits(payload, bit, 4); bit += 4;
-            rtcm_printf("    PRN %2d: Rough Range = %3d, Extended Info = %2d\n", i + 1, rough_range, ext_info);
-            sat_idx++;
-        }
-    }
-
-    // MSM4: Fine pseudoranges, fine phases, lock, half-cycle, CNR
-    for (int cell = 0; cell < num_cells && cell < 5; ++cell) {
-        if ((bit + pr_bits + ph_bits + 4 + 1 + 6) > payload_len * 8) {
-            rtcm_printf("  [WARN] Not enough data for cell %d\n", cell + 1);
-            break;
-        }
-        int32_t pseudorange = (int32_t)get_bits(payload, bit, pr_bits); bit += pr_bits;
-        int32_t phaserange = (int32_t)get_bits(payload, bit, ph_bits); bit += ph_bits;
-        uint8_t lock = (uint8_t)get_bits(payload, bit, 4); bit += 4;
-        uint8_t half_cycle = (uint8_t)get_bits(payload, bit, 1); bit += 1;
-        uint8_t cnr = (uint8_t)get_bits(payload, bit, 6); bit += 6;
-
-        // Sign extension for signed values
-        if (pseudorange & (1 << (pr_bits - 1))) pseudorange -= (1 << pr_bits);
-        if (phaserange & (1 << (ph_bits - 1))) phaserange -= (1 << ph_bits);
-
-        rtcm_printf("  Cell %d: PR=%.4f m, PH=%.4f m, Lock=%u, Half=%u, CNR=%u dBHz\n",
-            cell + 1,
-            pseudorange * pr_scale,
-            phaserange * ph_scale,
-            lock,
-            half_cycle,
-            cnr
-        );
+    RtcmMsmObs obs;
+    if (!rtcm_decode_msm(payload, payload_len, &obs)) {
+        rtcm_printf("Type %d: Invalid MSM header or cell mask!\n", msg_type);
+        return;
     }
-    if (num_cells > 5) rtcm_printf("  ... (%d more cells not shown)\n", num_cells - 5);
+    format_msm4(&obs, gnss_name, msg_type);
 }
 
-
+void rtcm_print_msm(const RtcmMsmObs *obs)
+{
+    if (!obs) return;
+    const RtcmMsgInfo *info = rtcm_msg_info(obs->msg_type);
+    if (!info || !info->decode) return;
+
+    /* Same header line and formatter analyze_rtcm_message() would use. */
+    rtcm_out_frame_begin(rtcm_out_hint(obs->msg_type, obs->payload_len));
+    rtcm_printf("\nRTCM Message: Type = %d, Length = %d (Type %d detected)\n",
+                obs->msg_type, obs->payload_len, obs->msg_type);
+    if (obs->msm_subtype == 7)
+        format_msm7(obs, obs->msg_type);
+    else if (obs->msm_subtype == 4)
+        format_msm4(obs, gnss_name_from_id(obs->gnss_id), obs->msg_type);
+    rtcm_out_frame_end();
+}
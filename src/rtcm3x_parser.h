@@ -33,13 +33,15 @@
  *   - 1097: MSM7 Galileo
  *   - *1107: SSR Orbit Correction, QZSS*
  *   - 1117: MSM7 QZSS
- *   - 1124: MSM4 QZSS
+ *   - 1124: MSM4 BeiDou
  *   - 1127: MSM7 BeiDou
  *   - 1137: MSM7 SBAS
  *   - 1230: GLONASS Code-Phase Biases
  *
  * ## Usage:
- *   - Use @ref analyze_rtcm_message to process a raw RTCM message buffer.
+ *   - Use @ref analyze_rtcm_message to process a raw RTCM message buffer,
+ *     or @ref analyze_rtcm_message_ctx to decode into a stream's own
+ *     @ref RtcmDecoderCtx.
  *   - Use the decode_rtcm_xxxx() functions for message-specific decoding.
  *   - Use @ref get_bits for bitfield extraction and @ref crc24q for CRC checking.
  *
@@ -55,6 +57,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ntrip_handler.h"
+#include "rtcm_bitreader.h"
+#include "sv_ephemeris.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,6 +95,72 @@ void rtcm_strbuf_clear(RtcmStrBuf *sb);
  */
 void rtcm_set_output_buffer(RtcmStrBuf *sb);
 
+/**
+ * @brief Whether the ephemeris decoders of the calling thread update the
+ *        shared sv_ephemeris.h store (default: yes).
+ *
+ * A thread that decodes 1019/1020/... only to show them (the GUI's UI
+ * thread) turns it off, so the stream's one ephemeris writer stays the
+ * only one.  rtcm_decode_eph() still fills its @p out.
+ */
+void rtcm_set_eph_store(bool on);
+
+/* ── Decoder context ────────────────────────────────────────────────────
+ * The state that decoding a stream builds up: the station ARP from
+ * 1005/1006, the per-band CNR cache and, optionally, where the text goes.
+ * Every stream decoded in the same process gets its own context, so two
+ * streams no longer overwrite each other's ARP or CNR.  The functions
+ * without a context argument (analyze_rtcm_message(),
+ * rtcm_get_station_arp(), get_sv_per_band_cnr(), ...) work on a single
+ * process-wide default context, as before.
+ *
+ * Broadcast ephemerides are not part of it: they describe the satellites,
+ * not the station, and stay in the shared sv_ephemeris.h store. */
+
+#define RTCM_CNR_MAX_GNSS  8       /**< gnss_id 0..7 */
+#define RTCM_CNR_MAX_PRN   64
+#define RTCM_CNR_MAX_SIGS  32      /**< MSM signal-mask bits */
+
+/**
+ * @struct RtcmDecoderCtx
+ * @brief Per-stream decoder state.
+ *
+ * Fields:
+ *   - out:          Text output of calls with this context, or NULL for
+ *                   the calling thread's buffer (rtcm_set_output_buffer())
+ *                   or stdout.
+ *   - arp_valid:    A 1005/1006 has been decoded.
+ *   - arp_x/y/z:    Its ECEF position, metres.
+ *   - arp_lat_deg, arp_lon_deg, arp_alt_m: The same, WGS-84.
+ *   - cnr:          Per-band CNR cache, [gnss_id][prn - 1][sig_idx], dB-Hz;
+ *                   0.0 = no observation.
+ *
+ * A context is used by one thread at a time.  Initialise it with
+ * rtcm_decoder_ctx_init(); it owns no heap memory.
+ */
+typedef struct RtcmDecoderCtx {
+    RtcmStrBuf *out;
+    bool        arp_valid;
+    double      arp_x, arp_y, arp_z;
+    double      arp_lat_deg, arp_lon_deg, arp_alt_m;
+    float       cnr[RTCM_CNR_MAX_GNSS][RTCM_CNR_MAX_PRN][RTCM_CNR_MAX_SIGS];
+} RtcmDecoderCtx;
+
+/** @brief Reset @p ctx: no ARP, empty CNR cache, output to the thread default. */
+void rtcm_decoder_ctx_init(RtcmDecoderCtx *ctx);
+
+/** @brief The process-wide context behind the functions without a context argument. */
+RtcmDecoderCtx *rtcm_decoder_default(void);
+
+/** @brief rtcm_get_station_arp() for the stream decoded into @p ctx. */
+void rtcm_ctx_get_station_arp(const RtcmDecoderCtx *ctx, bool *valid,
+                              double *x, double *y, double *z,
+                              double *lat_deg, double *lon_deg, double *alt_m);
+
+/** @brief get_sv_per_band_cnr() for the stream decoded into @p ctx. */
+void rtcm_ctx_get_sv_per_band_cnr(const RtcmDecoderCtx *ctx, int gnss_id, int prn,
+                                  float out_cnr[RTCM_CNR_MAX_SIGS]);
+
 /**
  * @brief Retrieve the most recently decoded reference-station ARP.
  *
@@ -130,6 +200,22 @@ int msm_extract_prns(const unsigned char *payload, int payload_len,
                      int msg_type, int *prns_out, int max_prns,
                      int *gnss_id_out);
 
+/**
+ * @brief Satellite mask and epoch time of a single MSM4/5/6/7 frame.
+ *
+ * The header-only read behind @ref msm_extract_prns: the 64-bit
+ * satellite mask (DF394, PRN 1 in the top bit, the bit order of
+ * SatMask in sat_vis.h) and the 30-bit epoch time after the station ID.
+ *
+ * @param mask_out    [out] Satellite mask.
+ * @param epoch_out   [out, optional] GNSS epoch time (DF004, DF416+DF034, ...).
+ * @param gnss_id_out [out, optional] GNSS ID.
+ * @return false for a non-MSM4..7 type or a payload too short for the mask.
+ */
+bool msm_extract_sat_mask(const unsigned char *payload, int payload_len,
+                          int msg_type, uint64_t *mask_out, uint32_t *epoch_out,
+                          int *gnss_id_out);
+
 /**
  * @brief Extract per-SV best CNR from an MSM7 frame.
  *
@@ -176,7 +262,7 @@ void msm7_update_per_band_cnr(const unsigned char *payload, int payload_len,
  *                 for that signal index".  Index is the 0-based MSB-first
  *                 position in the RTCM signal mask.
  */
-void get_sv_per_band_cnr(int gnss_id, int prn, float out_cnr[32]);
+void get_sv_per_band_cnr(int gnss_id, int prn, float out_cnr[RTCM_CNR_MAX_SIGS]);
 
 /**
  * @brief Return a short label for a signal-mask bit position.
@@ -249,6 +335,8 @@ void enu_to_azel(double e, double n, double u,
  * @brief Convenience wrapper: compute satellite azimuth/elevation from raw ECEF.
  *
  * Combines @ref ecef_to_geodetic, @ref ecef_to_enu, and @ref enu_to_azel.
+ * Callers that evaluate many satellites for one station should use
+ * @ref azel_from_ecef_frame instead.
  *
  * @param sta_x   Station ECEF X (meters).
  * @param sta_y   Station ECEF Y (meters).
@@ -264,52 +352,69 @@ void azel_from_ecef(double sta_x, double sta_y, double sta_z,
                     double *az_deg, double *el_deg);
 
 /**
- * @brief Extract bits from a buffer (big-endian, MSB first).
+ * @struct StationFrame
+ * @brief Station position with its local ENU rotation precomputed.
  *
- * Extracts a bitfield of length @p bit_len starting at @p start_bit from the buffer @p buf.
+ * azel_from_ecef() repeats the geodetic iteration and six trig calls for
+ * every satellite, although the station does not move between calls.
+ * Build a StationFrame once per ARP update with station_frame_set() and
+ * pass it to azel_from_ecef_frame() instead.
  *
- * @param buf        Pointer to the buffer.
- * @param start_bit  Start bit index (0 = first bit of buf[0]).
- * @param bit_len    Number of bits to extract.
- * @return Extracted bits as an unsigned 64-bit integer.
+ * Fields:
+ *   - x, y, z:           Station ECEF position (metres).
+ *   - lat_deg, lon_deg:  Geodetic latitude / longitude (degrees, WGS84).
+ *   - alt_m:             Altitude above the ellipsoid (metres).
+ *   - r:                 ECEF-to-ENU rotation, rows East / North / Up.
+ *   - valid:             Set by station_frame_set().
  */
-uint64_t get_bits(const unsigned char *buf, int start_bit, int bit_len);
+typedef struct {
+    double x, y, z;
+    double lat_deg, lon_deg, alt_m;
+    double r[3][3];
+    bool   valid;
+} StationFrame;
 
 /**
- * @brief Calculate CRC-24Q for the given data.
+ * @brief Initialise @p f for a station at ECEF (x, y, z).
  *
- * Computes the CRC-24Q checksum for the given data buffer.
+ * Does nothing if @p f is already valid for exactly this position, so it
+ * is cheap to call every epoch with the current ARP.
  *
- * @param data   Pointer to input data buffer.
- * @param length Number of bytes in the buffer.
- * @return 24-bit CRC as uint32_t (lower 24 bits are valid).
+ * @param f       Frame to (re)build.
+ * @param x,y,z   Station ECEF position (meters).
+ * @return true if the frame was rebuilt, false if it was already current.
  */
-uint32_t crc24q(const uint8_t *data, size_t length);
+bool station_frame_set(StationFrame *f, double x, double y, double z);
 
 /**
- * @brief Extract a signed 38-bit integer from a buffer.
- * 
- * Extracts a 38-bit signed integer value from the buffer and properly handles
- * two's complement negative numbers.
+ * @brief Satellite azimuth/elevation from raw ECEF, using a prepared frame.
  *
- * @param buf        Pointer to the buffer.
- * @param start_bit  Start bit index (0 = first bit of buf[0]).
- * @return Extracted signed 38-bit integer as int64_t.
+ * Gives the same result as azel_from_ecef() for the frame's station.
+ *
+ * @param f       Frame from station_frame_set().
+ * @param sv_x    Satellite ECEF X (meters).
+ * @param sv_y    Satellite ECEF Y (meters).
+ * @param sv_z    Satellite ECEF Z (meters).
+ * @param az_deg  [out] Azimuth in degrees, 0..360, may be NULL.
+ * @param el_deg  [out] Elevation in degrees, -90..+90, may be NULL.
  */
-int64_t extract_signed38(const unsigned char *buf, int start_bit);
+void azel_from_ecef_frame(const StationFrame *f,
+                          double sv_x, double sv_y, double sv_z,
+                          double *az_deg, double *el_deg);
 
 /**
- * @brief Extract a signed N-bit integer from a buffer.
- * 
- * Generic function to extract signed integers of any bit length from the buffer,
- * with automatic sign extension for negative values.
+ * @brief Calculate CRC-24Q for the given data.
  *
- * @param buf        Pointer to the buffer.
- * @param start_bit  Start bit index (0 = first bit of buf[0]).
- * @param bit_len    Number of bits to extract.
- * @return Extracted signed integer as int64_t.
+ * Computes the CRC-24Q checksum for the given data buffer.
+ *
+ * @param data   Pointer to input data buffer.
+ * @param length Number of bytes in the buffer.
+ * @return 24-bit CRC as uint32_t (lower 24 bits are valid).
  */
-int64_t extract_signed(const unsigned char *buf, int start_bit, int bit_len);
+uint32_t crc24q(const uint8_t *data, size_t length);
+
+/** @brief The crc24q() kernel this CPU runs: "pclmul" or "table". */
+const char *crc24q_impl(void);
 
 /**
  * @brief Calculate the great-circle distance and heading between two WGS84 coordinates.
@@ -329,6 +434,318 @@ int64_t extract_signed(const unsigned char *buf, int start_bit, int bit_len);
  */
 void calc_distance_heading(double lat1, double lon1, double lat2, double lon2, double *distance_km, double *heading_deg);
 
+/* ── Message-type registry ─────────────────────────────────────────────
+ * One entry per known RTCM 3.x message type, indexed by the 12-bit
+ * message number.  analyze_rtcm_message() dispatches through it, and
+ * other modules (sky_collect.c, extract_satellites(), the eph workers)
+ * use it to classify frames instead of repeating range checks. */
+
+#define RTCM_MSG_F_OBS      0x01u  /**< Carries observables (legacy RTK or MSM) */
+#define RTCM_MSG_F_MSM      0x02u  /**< Multiple Signal Message (MSM1..MSM7) */
+#define RTCM_MSG_F_EPH      0x04u  /**< Broadcast ephemeris; decoding fills sv_ephemeris */
+#define RTCM_MSG_F_STATION  0x08u  /**< Reference-station / antenna / receiver info */
+
+/**
+ * @brief Decoder entry point used by the dispatch table.
+ *
+ * Decoders that have no use for @p ctx or @p config simply ignore them.
+ * The ephemeris decoders (@ref RTCM_MSG_F_EPH) fill the shared
+ * sv_ephemeris.h store and accept a NULL @p ctx.
+ */
+typedef void (*RtcmDecodeFn)(RtcmDecoderCtx *ctx, const unsigned char *payload,
+                             int payload_len, const NTRIP_Config *config);
+
+/**
+ * @struct RtcmMsgInfo
+ * @brief Static description of one RTCM message type.
+ *
+ * Fields:
+ *   - msg_type:    RTCM message number (1001..4095).
+ *   - name:        Short human-readable description.
+ *   - flags:       Bitwise OR of RTCM_MSG_F_* classification flags.
+ *   - gnss_id:     GNSS the message belongs to (1=GPS, 2=GLONASS, 3=Galileo,
+ *                  4=QZSS, 5=BeiDou, 6=SBAS, 7=NavIC), or 0 if not GNSS-specific.
+ *   - msm_subtype: 1..7 for MSM messages, 0 otherwise.
+ *   - decode:      Text decoder, or NULL if the type is known but not decoded.
+ */
+typedef struct {
+    int          msg_type;
+    const char  *name;
+    unsigned     flags;
+    int          gnss_id;
+    int          msm_subtype;
+    RtcmDecodeFn decode;
+} RtcmMsgInfo;
+
+/**
+ * @brief Look up the registry entry for an RTCM message type.
+ *
+ * O(1): a direct index on the 12-bit message number.
+ *
+ * @param msg_type RTCM message type number.
+ * @return Pointer to a static entry, or NULL if the type is unknown.
+ */
+const RtcmMsgInfo *rtcm_msg_info(int msg_type);
+
+/** @brief true if @p msg_type is an MSM of subtype @p min_sub .. @p max_sub. */
+static inline bool rtcm_msg_is_msm(int msg_type, int min_sub, int max_sub)
+{
+    const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+    return info && (info->flags & RTCM_MSG_F_MSM) &&
+           info->msm_subtype >= min_sub && info->msm_subtype <= max_sub;
+}
+
+/** @brief true if @p msg_type carries a broadcast ephemeris we decode. */
+static inline bool rtcm_msg_is_eph(int msg_type)
+{
+    const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+    return info && (info->flags & RTCM_MSG_F_EPH) && info->decode;
+}
+
+/** @brief GNSS ID of @p msg_type (see RtcmMsgInfo::gnss_id), 0 if unknown. */
+static inline int rtcm_msg_gnss_id(int msg_type)
+{
+    const RtcmMsgInfo *info = rtcm_msg_info(msg_type);
+    return info ? info->gnss_id : 0;
+}
+
+/* ── Structured decode API ──────────────────────────────────────────────
+ * Decode-to-struct entry points that fill caller-owned plain structs and
+ * never format anything.  The decode_rtcm_xxxx() text decoders are thin
+ * formatters on top of these, so statistics / sky / GUI consumers can
+ * get the numbers without paying for rtcm_printf on every field. */
+
+#define RTCM_MSM_MAX_SATS   64  /**< Satellite-mask width (DF394) */
+#define RTCM_MSM_MAX_SIGS   32  /**< Signal-mask width (DF395) */
+#define RTCM_MSM_MAX_CELLS  64  /**< Cell-mask limit, RTCM 10403.3 §3.5.12.3 */
+#define RTCM_LIGHT_MS       299792.458  /**< Metres per millisecond of range */
+
+/**
+ * @struct RtcmMsmSat
+ * @brief MSM satellite data block entry (one per set bit in the sat mask).
+ *
+ * Fields not carried by the decoded MSM subtype are left at 0.
+ *
+ * Fields:
+ *   - prn:          1-based position of the satellite in the sat mask.
+ *   - rough_int_ms: Rough range, integer milliseconds (DF397; 255 = invalid).
+ *   - ext_info:     Extended satellite info (DF419, MSM5/7 only).
+ *   - rough_mod:    Rough range modulo 1 ms, 1/1024 ms units (DF398).
+ *   - rough_rate:   Rough phase-range rate in m/s (DF399, MSM5/7 only).
+ *   - rough_range_m: Rough range converted to metres (0 if invalid).
+ */
+typedef struct {
+    int    prn;
+    int    rough_int_ms;
+    int    ext_info;
+    int    rough_mod;
+    int    rough_rate;
+    double rough_range_m;
+} RtcmMsmSat;
+
+/**
+ * @struct RtcmMsmCell
+ * @brief MSM signal data block entry (one per set bit in the cell mask).
+ *
+ * Raw fields keep the on-the-wire integer so formatters can reproduce
+ * the historical text output bit-for-bit; pr_m / ph_m are the full
+ * pseudorange / phase range in metres (rough + fine), or 0 when the
+ * rough or fine value is flagged invalid.
+ *
+ * Fields:
+ *   - sat:        Index into RtcmMsmObs::sats.
+ *   - sig_idx:    0-based MSB-first bit position in the signal mask.
+ *   - fine_pr:    Fine pseudorange (DF400 / DF405), signed raw.
+ *   - fine_ph:    Fine phase range (DF401 / DF406), signed raw.
+ *   - lock:       Lock-time indicator (DF402 / DF407), raw.
+ *   - half_cycle: Half-cycle ambiguity indicator (DF420).
+ *   - cnr_raw:    CNR (DF403 / DF408), raw; 0 for MSM1..3.
+ *   - fine_rate:  Fine phase-range rate (DF404), signed raw, MSM5/7 only.
+ *   - cnr_dbhz:   CNR in dB-Hz.
+ *   - pr_m:       Full pseudorange in metres.
+ *   - ph_m:       Full phase range in metres.
+ */
+typedef struct {
+    int      sat;
+    int      sig_idx;
+    int32_t  fine_pr;
+    int32_t  fine_ph;
+    uint16_t lock;
+    uint8_t  half_cycle;
+    uint16_t cnr_raw;
+    int16_t  fine_rate;
+    float    cnr_dbhz;
+    double   pr_m;
+    double   ph_m;
+} RtcmMsmCell;
+
+/**
+ * @struct RtcmMsmObs
+ * @brief Fully decoded MSM1..MSM7 message.
+ *
+ * Filled by @ref rtcm_decode_msm.  Plain data, safe to copy.  Cells are
+ * stored in wire order (satellite-major, then signal).
+ */
+typedef struct RtcmMsmObs {
+    int         msg_type;       /**< RTCM message number from the payload */
+    int         payload_len;    /**< Payload length in bytes (frame length field) */
+    int         gnss_id;        /**< See RtcmMsgInfo::gnss_id */
+    int         msm_subtype;    /**< 1..7 */
+    uint16_t    ref_station_id; /**< DF003 */
+    uint32_t    epoch_time;     /**< GNSS epoch time, 30 bits, GNSS-specific */
+    uint8_t     mm_flag;        /**< Multiple message bit (DF393) */
+    uint8_t     iods;           /**< Issue of data station (DF409) */
+    uint8_t     clk_steering;   /**< DF411 */
+    uint8_t     ext_clk;        /**< DF412 */
+    uint8_t     df_smoothing;   /**< Divergence-free smoothing (DF417) */
+    uint8_t     smoothing_int;  /**< Smoothing interval (DF418) */
+    uint64_t    sat_mask;       /**< DF394, MSB = PRN 1 */
+    uint32_t    sig_mask;       /**< DF395, MSB = signal ID 1 */
+    int         num_sats;
+    int         num_sigs;
+    int         num_cells;
+    int         sig_idx[RTCM_MSM_MAX_SIGS];  /**< 0-based mask positions of the active signals */
+    RtcmMsmSat  sats[RTCM_MSM_MAX_SATS];
+    RtcmMsmCell cells[RTCM_MSM_MAX_CELLS];
+    bool        truncated;      /**< Payload ended before the last field; missing bits read as 0 */
+} RtcmMsmObs;
+
+/**
+ * @brief Decode an MSM1..MSM7 payload into @p out without printing.
+ *
+ * Handles every MSM subtype's satellite and signal block layout per
+ * RTCM 10403.3 Tables 3.5-79 .. 3.5-81.  The message type is taken from
+ * the payload's first 12 bits.
+ *
+ * @param payload     RTCM payload (starting at message-number bit).
+ * @param payload_len Payload length in bytes.
+ * @param out         [out] Decoded message; fully overwritten.
+ * @return true on success; false if the payload is not an MSM, is too
+ *         short for the header, or declares more than
+ *         RTCM_MSM_MAX_CELLS cells.  A payload that ends inside the data
+ *         blocks still succeeds with @c out->truncated set.
+ */
+bool rtcm_decode_msm(const unsigned char *payload, int payload_len, RtcmMsmObs *out);
+
+/**
+ * @struct RtcmMsmLayout
+ * @brief Per-subtype MSM field widths, RTCM 10403.3 Tables 3.5-79 .. 3.5-81.
+ *
+ * A width of 0 means the field is not present in that subtype.  Shared by
+ * @ref rtcm_decode_msm and the encoder (rtcm_encoder.h).
+ */
+typedef struct {
+    uint8_t sat_int, sat_ext, sat_rate;          /**< DF397, DF419, DF399 */
+    uint8_t pr, ph, lock, cnr, rate;             /**< cell fields */
+    int8_t  pr_exp, ph_exp;                      /**< fine PR / PH scale 2^exp ms */
+    float   cnr_lsb;                             /**< dB-Hz per CNR count */
+} RtcmMsmLayout;
+
+/** @brief Field widths of MSM @p subtype (1..7), or NULL. */
+const RtcmMsmLayout *rtcm_msm_layout(int subtype);
+
+/* ── Per-frame MSM context ──────────────────────────────────────────────
+ * Decode an MSM frame once with rtcm_decode_msm() and hand the same
+ * RtcmMsmObs to every consumer below (satellite stats, CNR caches, sky
+ * plot, detail text) instead of having each one re-parse the payload.
+ * msm7_extract_cnr() / msm7_update_per_band_cnr() are wrappers over
+ * these for callers that only have the raw payload. */
+
+/**
+ * @brief PRNs tracked in a decoded MSM frame (sat-mask order).
+ * @return Number of PRNs written to @p prns_out (at most @p max_prns).
+ */
+int rtcm_msm_obs_prns(const RtcmMsmObs *obs, int *prns_out, int max_prns);
+
+/**
+ * @brief Per-satellite best CNR (dB-Hz) across its signal cells.
+ *
+ * Emits one (PRN, CNR) pair per satellite in sat-mask order; satellites
+ * without a CNR-carrying cell report 0.  MSM4..MSM7 only.
+ *
+ * @return Number of pairs written, or 0 if the frame carries no CNR.
+ */
+int rtcm_msm_obs_best_cnr(const RtcmMsmObs *obs,
+                          int *prns_out, float *cnr_out, int max_prns);
+
+/**
+ * @brief Update the per-(GNSS, PRN, signal) CNR cache read by
+ *        @ref get_sv_per_band_cnr from a decoded MSM4..MSM7 frame.
+ */
+void rtcm_msm_obs_update_per_band_cnr(const RtcmMsmObs *obs);
+
+/** @brief rtcm_msm_obs_update_per_band_cnr() into the cache of @p ctx. */
+void rtcm_ctx_update_per_band_cnr(RtcmDecoderCtx *ctx, const RtcmMsmObs *obs);
+
+/**
+ * @brief Print a decoded MSM frame exactly as @ref analyze_rtcm_message
+ *        would for the CRC-valid frame it came from.
+ *
+ * Lets a consumer that already holds the RtcmMsmObs (e.g. the GUI detail
+ * window) get the text without decoding the payload again.  Prints
+ * nothing for MSM subtypes that have no text decoder.
+ */
+void rtcm_print_msm(const RtcmMsmObs *obs);
+
+/**
+ * @struct RtcmStationArp
+ * @brief Decoded RTCM 1005 / 1006 antenna reference point.
+ *
+ * Fields:
+ *   - msg_type:          1005 or 1006.
+ *   - ref_station_id:    DF003.
+ *   - itrf_year:         ITRF realisation year (DF021).
+ *   - gps_ind, glo_ind, gal_ind: Constellation indicators (DF022..DF024).
+ *   - ref_station_ind:   Reference-station indicator (DF141).
+ *   - osc_ind:           Single receiver oscillator indicator (DF142).
+ *   - quarter_cycle_ind: Quarter-cycle indicator (DF364).
+ *   - x, y, z:           ARP ECEF coordinates in metres.
+ *   - antenna_height:    Antenna height in metres (DF028, 1006 only, else 0).
+ *   - lat_deg, lon_deg, alt_m: WGS-84 geodetic position of the ARP.
+ */
+typedef struct {
+    int      msg_type;
+    uint16_t ref_station_id;
+    uint8_t  itrf_year;
+    uint8_t  gps_ind;
+    uint8_t  glo_ind;
+    uint8_t  gal_ind;
+    uint8_t  ref_station_ind;
+    uint8_t  osc_ind;
+    uint8_t  quarter_cycle_ind;
+    double   x, y, z;
+    double   antenna_height;
+    double   lat_deg, lon_deg, alt_m;
+} RtcmStationArp;
+
+/**
+ * @brief Decode an RTCM 1005 / 1006 payload into @p out without printing.
+ *
+ * Does not touch the station-ARP cache read by @ref rtcm_get_station_arp;
+ * that is updated by the decode_rtcm_1005 / 1006 dispatch path.
+ *
+ * @param payload     RTCM payload (starting at message-number bit).
+ * @param payload_len Payload length in bytes.
+ * @param out         [out] Decoded ARP.
+ * @return true on success, false if the payload is too short or is not
+ *         a 1005 / 1006.
+ */
+bool rtcm_decode_arp(const unsigned char *payload, int payload_len, RtcmStationArp *out);
+
+/**
+ * @brief Decode an ephemeris payload (1019, 1020, 1041, 1042, 1044, 1045,
+ *        1046) into @p out without printing.
+ *
+ * Like the decode_rtcm_xxxx() dispatch path it also stores the result in
+ * the shared sv_ephemeris.h cache (unless rtcm_set_eph_store() is off).
+ *
+ * @param payload     RTCM payload (starting at message-number bit).
+ * @param payload_len Payload length in bytes.
+ * @param out         [out] Decoded ephemeris, @c valid set.
+ * @return false for other message types and payloads the decoder rejects.
+ */
+bool rtcm_decode_eph(const unsigned char *payload, int payload_len, SvEphemeris *out);
+
 /**
  * @brief Analyze and print information about an RTCM message.
  *
@@ -344,6 +761,17 @@ void calc_distance_heading(double lat1, double lon1, double lat2, double lon2, d
  */
 int analyze_rtcm_message(const unsigned char *data, int length, bool suppress_output, const NTRIP_Config *config);
 
+/**
+ * @brief analyze_rtcm_message() with the decoder state in @p ctx.
+ *
+ * A 1005/1006 updates the ARP of @p ctx, and the text goes to
+ * @p ctx->out when it is set.  analyze_rtcm_message() is this function
+ * on rtcm_decoder_default().
+ */
+int analyze_rtcm_message_ctx(RtcmDecoderCtx *ctx, const unsigned char *data,
+                             int length, bool suppress_output,
+                             const NTRIP_Config *config);
+
 /**
  * @brief Decode and print the contents of an RTCM 3.x Type 1005 message (Stationary RTK Reference Station ARP).
  * 
@@ -377,6 +805,12 @@ void decode_rtcm_1005(const unsigned char *payload, int payload_len, const NTRIP
  */
 void decode_rtcm_1006(const unsigned char *payload, int payload_len, const NTRIP_Config *config);
 
+/** @brief decode_rtcm_1005() / decode_rtcm_1006() caching the ARP in @p ctx. */
+void decode_rtcm_1005_ctx(RtcmDecoderCtx *ctx, const unsigned char *payload,
+                          int payload_len, const NTRIP_Config *config);
+void decode_rtcm_1006_ctx(RtcmDecoderCtx *ctx, const unsigned char *payload,
+                          int payload_len, const NTRIP_Config *config);
+
 /**
  * @brief Decode RTCM 1019 message (GPS Ephemeris)
  *
@@ -410,9 +844,9 @@ void decode_rtcm_1019(const unsigned char *payload, int payload_len);
 void decode_rtcm_1077(const unsigned char *payload, int payload_len);
 
 /**
- * @brief Decode and print the contents of an RTCM 3.x Type 1084 message (MSM4 GPS).
+ * @brief Decode and print the contents of an RTCM 3.x Type 1084 message (MSM4 GLONASS).
  *
- * Decodes and prints summary information for RTCM 1084 MSM4 (GPS) messages,
+ * Decodes and prints summary information for RTCM 1084 MSM4 (GLONASS) messages,
  * including satellite and signal masks, and the first few cell data.
  *
  * @param payload     Pointer to the message payload (after header).
@@ -436,9 +870,9 @@ void decode_rtcm_1084(const unsigned char *payload, int payload_len);
 void decode_rtcm_1087(const unsigned char *payload, int payload_len);
 
 /**
- * @brief Decode and print the contents of an RTCM 3.x Type 1094 message (MSM4 GLONASS).
+ * @brief Decode and print the contents of an RTCM 3.x Type 1094 message (MSM4 Galileo).
  *
- * Decodes and prints summary information for RTCM 1094 MSM4 (GLONASS) messages,
+ * Decodes and prints summary information for RTCM 1094 MSM4 (Galileo) messages,
  * including satellite and signal masks, and the first few cell data.
  *
  * @param payload     Pointer to the message payload (after header).
@@ -476,9 +910,9 @@ void decode_rtcm_1097(const unsigned char *payload, int payload_len);
 void decode_rtcm_1117(const unsigned char *payload, int payload_len);
 
 /**
- * @brief Decode and print the contents of an RTCM 3.x Type 1124 message (MSM4 QZSS).
+ * @brief Decode and print the contents of an RTCM 3.x Type 1124 message (MSM4 BeiDou).
  *
- * Decodes and prints summary information for RTCM 1124 MSM4 (QZSS) messages,
+ * Decodes and prints summary information for RTCM 1124 MSM4 (BeiDou) messages,
  * including satellite and signal masks, and the first few cell data.
  *
  * @param payload     Pointer to the message payload (after header).
@@ -726,24 +1160,19 @@ void decode_rtcm_1074(const unsigned char *payload, int payload_len);
  * medium-resolution GNSS observations. MSM4 contains pseudorange, phase range, lock time,
  * half-cycle ambiguity, and CNR data with reduced bit precision compared to MSM7.
  * 
- * This generic function handles all GNSS constellations by using constellation-specific
- * scaling parameters passed as arguments.
+ * Thin formatter over @ref rtcm_decode_msm: field widths and scaling come from
+ * the MSM subtype, and PR/PH are printed as full ranges in metres.
  *
  * @param payload     Pointer to the message payload (after RTCM header).
  * @param payload_len Length of the payload in bytes.
  * @param gnss_name   String for GNSS name (e.g., "GPS", "GLONASS", "QZSS") for display.
  * @param msg_type    RTCM message type number (e.g., 1074, 1084, 1094, 1124) for display.
- * @param pr_bits     Number of bits for pseudorange field (e.g., 15 for GPS, 20 for QZSS).
- * @param ph_bits     Number of bits for phase range field (e.g., 22 for GPS, 24 for QZSS).
- * @param pr_scale    Scaling factor for pseudorange in meters (e.g., 0.02 for GPS, 0.1 for QZSS).
- * @param ph_scale    Scaling factor for phase range in meters (typically 0.0005 for all).
  * 
  * @note Only the first 5 cells are displayed to prevent excessive output. 
  *       Use suppress_output mode if you only need the message type.
  */
 void decode_rtcm_msm4_generic(const unsigned char *payload, int payload_len,
-                              const char *gnss_name, int msg_type,
-                              int pr_bits, int ph_bits, double pr_scale, double ph_scale);
+                              const char *gnss_name, int msg_type);
 
 #ifdef __cplusplus
 }
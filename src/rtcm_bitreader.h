@@ -0,0 +1,206 @@
+/**
+ * @file rtcm_bitreader.h
+ * @brief Word-at-a-time MSB-first bit reader for RTCM 3.x payloads.
+ *
+ * RTCM 3.x packs every data field back to back, most significant bit
+ * first, with no byte alignment.  The decoders used to extract each
+ * field one bit at a time; this header provides a cursor that loads up
+ * to eight bytes as a single big-endian word and pulls the field out
+ * with one shift and mask.
+ *
+ * Two flavours are provided:
+ *   - @ref RtcmBitReader: a cursor bound to a payload length.  Reads that
+ *     run past the end of the payload return zero bits instead of
+ *     touching memory beyond it, so decoders can read a field first and
+ *     range-check afterwards.
+ *   - @ref get_bits / @ref extract_signed: the historical stateless
+ *     helpers, kept as thin inline wrappers for callers that do not know
+ *     the buffer length.  These never read past the last byte that holds
+ *     a requested bit.
+ *
+ * Header-only: everything is static inline so the hot decode loops in
+ * rtcm3x_parser.c and sky_collect.c get the reads inlined.
+ *
+ * Project: NTRIP RTCM 3.x Stream Analyzer
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause (see LICENSE for details)
+ */
+
+#ifndef RTCM_BITREADER_H
+#define RTCM_BITREADER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bit cursor over an RTCM payload.
+ *
+ * Fields:
+ *   - buf:       First payload byte (the byte holding the message number).
+ *   - len_bytes: Payload length in bytes; negative means "unknown" (no
+ *                bounds check, no wide loads).
+ *   - pos:       Next bit to read, 0 = MSB of buf[0].
+ */
+typedef struct {
+    const unsigned char *buf;
+    int len_bytes;
+    int pos;
+} RtcmBitReader;
+
+static inline uint64_t rtcm_bits_load_be64(const unsigned char *p)
+{
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+           ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+           ((uint64_t)p[6] << 8)  |  (uint64_t)p[7];
+}
+
+/* Up to 56 bits: with at most 7 bits of intra-byte offset the field
+ * always fits in one 64-bit window. */
+static inline uint64_t rtcm_bits_at56(const unsigned char *buf, int len_bytes,
+                                      int start_bit, int bit_len)
+{
+    int byte = start_bit >> 3;
+    int off  = start_bit & 7;
+    uint64_t w;
+
+    if (len_bytes >= 0 && byte + 8 <= len_bytes) {
+        w = rtcm_bits_load_be64(buf + byte);
+    } else {
+        int nbytes = (off + bit_len + 7) >> 3;
+        w = 0;
+        for (int i = 0; i < nbytes; i++) {
+            if (len_bytes >= 0 && byte + i >= len_bytes) break;
+            w |= (uint64_t)buf[byte + i] << (56 - 8 * i);
+        }
+    }
+    return (w << off) >> (64 - bit_len);
+}
+
+/**
+ * @brief Extract @p bit_len bits (0..64) starting at absolute bit @p start_bit.
+ *
+ * @param buf        Payload buffer.
+ * @param len_bytes  Payload length in bytes, or -1 if unknown.
+ * @param start_bit  Start bit index (0 = MSB of buf[0]).
+ * @param bit_len    Number of bits to extract.
+ * @return Field value, right-aligned.  Bits past @p len_bytes read as 0.
+ */
+static inline uint64_t rtcm_bits_at(const unsigned char *buf, int len_bytes,
+                                    int start_bit, int bit_len)
+{
+    if (bit_len <= 0) return 0;
+    if (bit_len <= 56)
+        return rtcm_bits_at56(buf, len_bytes, start_bit, bit_len);
+    return (rtcm_bits_at56(buf, len_bytes, start_bit, bit_len - 32) << 32) |
+            rtcm_bits_at56(buf, len_bytes, start_bit + bit_len - 32, 32);
+}
+
+/** @brief Sign-extend the low @p bit_len bits of @p v (two's complement). */
+static inline int64_t rtcm_bits_sign_extend(uint64_t v, int bit_len)
+{
+    if (bit_len <= 0 || bit_len >= 64) return (int64_t)v;
+    if (v & ((uint64_t)1 << (bit_len - 1)))
+        v |= (~0ULL) << bit_len;
+    return (int64_t)v;
+}
+
+/**
+ * @brief Initialise a reader over @p buf.
+ *
+ * @param br         Reader to initialise.
+ * @param buf        Payload buffer.
+ * @param len_bytes  Payload length in bytes (or -1 if unknown).
+ * @param start_bit  Initial cursor position.
+ */
+static inline void rtcm_br_init(RtcmBitReader *br, const unsigned char *buf,
+                                int len_bytes, int start_bit)
+{
+    br->buf       = buf;
+    br->len_bytes = len_bytes;
+    br->pos       = start_bit;
+}
+
+/** @brief Read an unsigned field and advance the cursor. */
+static inline uint64_t rtcm_br_read(RtcmBitReader *br, int bit_len)
+{
+    uint64_t v = rtcm_bits_at(br->buf, br->len_bytes, br->pos, bit_len);
+    br->pos += bit_len;
+    return v;
+}
+
+/** @brief Read a two's-complement signed field and advance the cursor. */
+static inline int64_t rtcm_br_read_signed(RtcmBitReader *br, int bit_len)
+{
+    return rtcm_bits_sign_extend(rtcm_br_read(br, bit_len), bit_len);
+}
+
+/** @brief Advance the cursor without reading (reserved fields). */
+static inline void rtcm_br_skip(RtcmBitReader *br, int bit_len)
+{
+    br->pos += bit_len;
+}
+
+/**
+ * @brief Bits left between the cursor and the end of the payload.
+ * @return Remaining bit count (negative once the cursor ran past the end).
+ */
+static inline int rtcm_br_left(const RtcmBitReader *br)
+{
+    return br->len_bytes * 8 - br->pos;
+}
+
+/**
+ * @brief Extract bits from a buffer.
+ *
+ * Extracts a sequence of bits from a byte buffer, starting at a given bit index.
+ *
+ * @param buf        Pointer to the buffer.
+ * @param start_bit  Start bit index (0 = first bit of buf[0]).
+ * @param bit_len    Number of bits to extract.
+ * @return Extracted bits as an unsigned 64-bit integer.
+ */
+static inline uint64_t get_bits(const unsigned char *buf, int start_bit, int bit_len)
+{
+    return rtcm_bits_at(buf, -1, start_bit, bit_len);
+}
+
+/**
+ * @brief Extract a signed N-bit integer from a buffer.
+ *
+ * Generic function to extract signed integers of any bit length from the buffer,
+ * with automatic sign extension for negative values.
+ *
+ * @param buf        Pointer to the buffer.
+ * @param start_bit  Start bit index (0 = first bit of buf[0]).
+ * @param bit_len    Number of bits to extract.
+ * @return Extracted signed integer as int64_t.
+ */
+static inline int64_t extract_signed(const unsigned char *buf, int start_bit, int bit_len)
+{
+    return rtcm_bits_sign_extend(get_bits(buf, start_bit, bit_len), bit_len);
+}
+
+/**
+ * @brief Extract a signed 38-bit integer from a buffer.
+ *
+ * Extracts a 38-bit signed integer value from the buffer and properly handles
+ * two's complement negative numbers.
+ *
+ * @param buf        Pointer to the buffer.
+ * @param start_bit  Start bit index (0 = first bit of buf[0]).
+ * @return Extracted signed 38-bit integer as int64_t.
+ */
+static inline int64_t extract_signed38(const unsigned char *buf, int start_bit)
+{
+    return extract_signed(buf, start_bit, 38);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_BITREADER_H */
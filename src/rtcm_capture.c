@@ -0,0 +1,566 @@
+/**
+ * @file rtcm_capture.c
+ * @brief Native RTCM capture container (.nacap) with receive timestamps.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_capture.h"
+#include "rtcm_replay.h"
+#include "stream_clock.h"
+#include "lz_block.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CAP_MAGIC         "NACAP\r\n\x1a"
+#define CAP_VERSION       1
+#define CAP_VERSION_PACK  2             /* compressed capture */
+#define CAP_FLAG_PACKED   1u
+#define CAP_HEADER_SIZE   32
+#define CAP_REC_SIZE      12
+#define CAP_TYPE_FRAME_MAX 4095u        /* types 0..4095 are frames */
+#define CAP_TYPE_INDEX    0xFFFFu
+#define CAP_TYPE_FOOTER   0xFFFEu
+#define CAP_TYPE_PACKED   0xFFFDu
+#define CAP_FOOTER_SIZE   (CAP_REC_SIZE + 8)
+#define CAP_BLOCK_HEAD    16
+#define CAP_PACK_HEAD     8             /* u32 unpacked size, u32 frames */
+
+/* A frame location in a compressed capture: block record offset and the
+ * offset of the frame bytes inside the unpacked block. */
+#define CAP_LOC(blk, at)  (((uint64_t)(blk) << 16) | (uint64_t)(at))
+#define CAP_LOC_BLK(loc)  ((size_t)((loc) >> 16))
+#define CAP_LOC_AT(loc)   ((size_t)((loc) & 0xFFFFu))
+
+/* ── Little-endian helpers ────────────────────────────────────────────── */
+
+static void put_u16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+/* ── Writer ───────────────────────────────────────────────────────────── */
+
+static void cap_put(RtcmCaptureWriter *w, const void *p, size_t n)
+{
+    if (w->failed) return;
+    if (fwrite(p, 1, n, w->f) != n) w->failed = true;
+    w->offset += n;
+}
+
+static void cap_put_record_head(RtcmCaptureWriter *w, uint64_t t_ns,
+                                uint16_t type, uint16_t len)
+{
+    unsigned char h[CAP_REC_SIZE];
+    put_u64(h, t_ns);
+    put_u16(h + 8, type);
+    put_u16(h + 10, len);
+    cap_put(w, h, sizeof(h));
+}
+
+/* Write the pending entries as one index block. */
+static void cap_flush_index(RtcmCaptureWriter *w)
+{
+    if (w->n_pending == 0) return;
+    unsigned char buf[CAP_BLOCK_HEAD + RTCM_CAPTURE_INDEX_BLOCK * 16];
+    size_t len = CAP_BLOCK_HEAD + (size_t)w->n_pending * 16;
+    put_u64(buf, w->prev_block);
+    put_u32(buf + 8, (uint32_t)w->n_pending);
+    put_u32(buf + 12, 0);
+    for (int i = 0; i < w->n_pending; i++) {
+        put_u64(buf + CAP_BLOCK_HEAD + 16 * i,     w->pending[i].t_ns);
+        put_u64(buf + CAP_BLOCK_HEAD + 16 * i + 8, w->pending[i].offset);
+    }
+    w->prev_block = w->offset;
+    cap_put_record_head(w, w->last_t_ns, CAP_TYPE_INDEX, (uint16_t)len);
+    cap_put(w, buf, len);
+    w->n_pending = 0;
+}
+
+/* Compress the block in progress and write it as one record, with an
+ * index entry of its own. */
+static void cap_flush_block(RtcmCaptureWriter *w)
+{
+    if (w->blk_len == 0) return;
+    unsigned char out[CAP_PACK_HEAD + LZ_BLOCK_BOUND(RTCM_CAPTURE_BLOCK_RAW)];
+    size_t n = lz_block_compress(w->blk, w->blk_len, out + CAP_PACK_HEAD,
+                                 sizeof(out) - CAP_PACK_HEAD);
+    put_u32(out, (uint32_t)w->blk_len);
+    put_u32(out + 4, w->blk_frames);
+
+    RtcmCaptureIndexEntry *e = &w->pending[w->n_pending++];
+    e->t_ns   = w->blk_t0;
+    e->offset = w->offset;
+    cap_put_record_head(w, w->blk_t0, CAP_TYPE_PACKED,
+                        (uint16_t)(CAP_PACK_HEAD + n));
+    cap_put(w, out, CAP_PACK_HEAD + n);
+    w->blk_len    = 0;
+    w->blk_frames = 0;
+    if (w->n_pending == RTCM_CAPTURE_INDEX_BLOCK) cap_flush_index(w);
+}
+
+bool rtcm_capture_writer_open(RtcmCaptureWriter *w, const char *path,
+                              int64_t start_unix_ns, unsigned flags)
+{
+    memset(w, 0, sizeof(*w));
+    bool packed = (flags & RTCM_CAPTURE_COMPRESS) != 0;
+    if (packed) {
+        w->blk = (unsigned char *)malloc(RTCM_CAPTURE_BLOCK_RAW);
+        if (!w->blk) return false;
+    }
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        free(w->blk);
+        w->blk = NULL;
+        return false;
+    }
+    setvbuf(w->f, NULL, _IOFBF, RTCM_CAPTURE_IO_BUF);
+    w->t0_ns = stream_clock_wall_ns();
+
+    unsigned char h[CAP_HEADER_SIZE] = { 0 };
+    memcpy(h, CAP_MAGIC, 8);
+    put_u32(h + 8,  packed ? CAP_VERSION_PACK : CAP_VERSION);
+    put_u32(h + 12, CAP_HEADER_SIZE);
+    put_u64(h + 16, (uint64_t)start_unix_ns);
+    put_u32(h + 24, packed ? 0 : RTCM_CAPTURE_INDEX_STRIDE);
+    put_u32(h + 28, packed ? CAP_FLAG_PACKED : 0);
+    cap_put(w, h, sizeof(h));
+    return !w->failed;
+}
+
+/* Compressed capture: append the frame record to the block in progress. */
+static void cap_pack_frame(RtcmCaptureWriter *w, uint64_t t_ns, uint16_t mt,
+                           const unsigned char *frame, int frame_len)
+{
+    size_t need = CAP_REC_SIZE + (size_t)frame_len;
+    if (w->blk_len &&
+        (w->blk_len + need > RTCM_CAPTURE_BLOCK_RAW ||
+         t_ns - w->blk_t0 >= (uint64_t)RTCM_CAPTURE_BLOCK_SECS * 1000000000u))
+        cap_flush_block(w);
+    if (w->blk_len == 0) w->blk_t0 = t_ns;
+    unsigned char *p = w->blk + w->blk_len;
+    put_u64(p, t_ns);
+    put_u16(p + 8, mt);
+    put_u16(p + 10, (uint16_t)frame_len);
+    memcpy(p + CAP_REC_SIZE, frame, (size_t)frame_len);
+    w->blk_len += need;
+    w->blk_frames++;
+}
+
+bool rtcm_capture_write_at(RtcmCaptureWriter *w, uint64_t t_ns,
+                           const unsigned char *frame, int frame_len)
+{
+    if (w->failed) return false;
+    /* A frame is at most 1029 bytes; the cap keeps a record inside a
+     * compressed block. */
+    if (frame_len < 6 || frame_len > RTCM_CAPTURE_BLOCK_RAW - CAP_REC_SIZE)
+        return true;
+    if (t_ns < w->last_t_ns) t_ns = w->last_t_ns;
+    w->last_t_ns = t_ns;
+
+    int mt = frame_len >= 8 ? ((int)frame[3] << 4) | ((int)frame[4] >> 4) : 0;
+    if (w->blk) {
+        cap_pack_frame(w, t_ns, (uint16_t)mt, frame, frame_len);
+        w->frames++;
+        return !w->failed;
+    }
+
+    if (w->frames % RTCM_CAPTURE_INDEX_STRIDE == 0) {
+        RtcmCaptureIndexEntry *e = &w->pending[w->n_pending++];
+        e->t_ns   = t_ns;
+        e->offset = w->offset;
+    }
+    cap_put_record_head(w, t_ns, (uint16_t)mt, (uint16_t)frame_len);
+    cap_put(w, frame, (size_t)frame_len);
+    w->frames++;
+
+    if (w->n_pending == RTCM_CAPTURE_INDEX_BLOCK) cap_flush_index(w);
+    return !w->failed;
+}
+
+bool rtcm_capture_write(RtcmCaptureWriter *w, const unsigned char *frame,
+                        int frame_len)
+{
+    int64_t now = stream_clock_wall_ns() - w->t0_ns;
+    uint64_t t_ns = now > 0 ? (uint64_t)now : 0;
+    bool ok = rtcm_capture_write_at(w, t_ns, frame, frame_len);
+    if (ok && t_ns - w->last_flush >= 1000000000u) {
+        if (fflush(w->f) != 0) w->failed = true;
+        w->last_flush = t_ns;
+    }
+    return !w->failed;
+}
+
+bool rtcm_capture_writer_close(RtcmCaptureWriter *w)
+{
+    if (!w->f) return false;
+    if (w->blk) {
+        cap_flush_block(w);
+        free(w->blk);
+        w->blk = NULL;
+    }
+    cap_flush_index(w);
+    unsigned char off[8];
+    put_u64(off, w->prev_block);
+    cap_put_record_head(w, w->last_t_ns, CAP_TYPE_FOOTER, sizeof(off));
+    cap_put(w, off, sizeof(off));
+    if (fclose(w->f) != 0) w->failed = true;
+    w->f = NULL;
+    return !w->failed;
+}
+
+/* ── Reader ───────────────────────────────────────────────────────────── */
+
+bool rtcm_capture_is_native(const unsigned char *data, size_t size)
+{
+    return data && size >= CAP_HEADER_SIZE && memcmp(data, CAP_MAGIC, 8) == 0;
+}
+
+static bool idx_append(RtcmCaptureReader *r, size_t *cap,
+                       uint64_t t_ns, uint64_t offset)
+{
+    if (r->n_index == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 256;
+        RtcmCaptureIndexEntry *n = (RtcmCaptureIndexEntry *)
+            realloc(r->index, ncap * sizeof(*n));
+        if (!n) return false;
+        r->index = n;
+        *cap = ncap;
+    }
+    r->index[r->n_index].t_ns   = t_ns;
+    r->index[r->n_index].offset = offset;
+    r->n_index++;
+    return true;
+}
+
+/* Walk the index block chain back from the footer.  Blocks are collected
+ * newest first, so the entries are reversed in place at the end. */
+static bool idx_from_chain(RtcmCaptureReader *r, uint64_t block)
+{
+    size_t cap = 0, hops = 0;
+    while (block) {
+        if (block < CAP_HEADER_SIZE || block > r->end - CAP_REC_SIZE ||
+            ++hops > r->end / CAP_REC_SIZE)
+            return false;
+        const unsigned char *p = r->data + block;
+        uint16_t len = get_u16(p + 10);
+        if (get_u16(p + 8) != CAP_TYPE_INDEX || len < CAP_BLOCK_HEAD ||
+            len > r->end - block - CAP_REC_SIZE)
+            return false;
+        p += CAP_REC_SIZE;
+        uint32_t n = get_u32(p + 8);
+        if (n > (uint32_t)(len - CAP_BLOCK_HEAD) / 16) return false;
+        for (uint32_t i = n; i-- > 0; ) {   /* newest first */
+            const unsigned char *e = p + CAP_BLOCK_HEAD + 16 * i;
+            uint64_t off = get_u64(e + 8);
+            if (off < CAP_HEADER_SIZE || off >= r->end) return false;
+            if (!idx_append(r, &cap, get_u64(e), off)) return false;
+        }
+        uint64_t prev = get_u64(p);
+        if (prev >= block) return false;
+        block = prev;
+    }
+    for (size_t i = 0, j = r->n_index; i + 1 < j; i++, j--) {
+        RtcmCaptureIndexEntry t = r->index[i];
+        r->index[i] = r->index[j - 1];
+        r->index[j - 1] = t;
+    }
+    return true;
+}
+
+/* No usable footer: rebuild the sparse index by hopping record headers. */
+static bool idx_from_scan(RtcmCaptureReader *r)
+{
+    size_t cap = 0, pos = CAP_HEADER_SIZE;
+    uint64_t frames = 0;
+    while (r->end - pos >= CAP_REC_SIZE) {
+        const unsigned char *p = r->data + pos;
+        uint16_t type = get_u16(p + 8);
+        size_t   len  = get_u16(p + 10);
+        if (len > r->end - pos - CAP_REC_SIZE) {
+            r->truncated = true;
+            break;
+        }
+        bool entry = r->compressed
+            ? type == CAP_TYPE_PACKED
+            : type <= CAP_TYPE_FRAME_MAX &&
+              frames++ % RTCM_CAPTURE_INDEX_STRIDE == 0;
+        if (entry && !idx_append(r, &cap, get_u64(p), pos)) return false;
+        pos += CAP_REC_SIZE + len;
+    }
+    r->end = pos;
+    return true;
+}
+
+bool rtcm_capture_reader_init(RtcmCaptureReader *r, const unsigned char *data,
+                              size_t size)
+{
+    memset(r, 0, sizeof(*r));
+    if (!rtcm_capture_is_native(data, size)) return false;
+    uint32_t version = get_u32(data + 8);
+    uint32_t flags   = get_u32(data + 28);
+    if (get_u32(data + 12) != CAP_HEADER_SIZE) return false;
+    if (version == CAP_VERSION_PACK && flags == CAP_FLAG_PACKED) {
+        r->compressed = true;
+        r->blk = (unsigned char *)malloc(RTCM_CAPTURE_BLOCK_RAW);
+        if (!r->blk) return false;
+    } else if (version != CAP_VERSION) {
+        return false;
+    }
+
+    r->data          = data;
+    r->size          = size;
+    r->start_unix_ns = (int64_t)get_u64(data + 16);
+    r->pos           = CAP_HEADER_SIZE;
+    r->end           = size;
+
+    if (size >= CAP_HEADER_SIZE + CAP_FOOTER_SIZE) {
+        const unsigned char *f = data + size - CAP_FOOTER_SIZE;
+        if (get_u16(f + 8) == CAP_TYPE_FOOTER && get_u16(f + 10) == 8) {
+            r->end = size - CAP_FOOTER_SIZE;
+            if (idx_from_chain(r, get_u64(f + CAP_REC_SIZE))) {
+                r->has_footer = true;
+                return true;
+            }
+            free(r->index);
+            r->index   = NULL;
+            r->n_index = 0;
+            r->end     = size;
+        }
+    }
+    if (!idx_from_scan(r)) {
+        rtcm_capture_reader_free(r);
+        return false;
+    }
+    return true;
+}
+
+void rtcm_capture_reader_free(RtcmCaptureReader *r)
+{
+    if (!r) return;
+    free(r->index);
+    free(r->blk);
+    r->index   = NULL;
+    r->n_index = 0;
+    r->blk     = NULL;
+    r->blk_len = r->blk_pos = r->blk_off = 0;
+}
+
+/* Unpack the compressed block whose record starts at @p rec into r->blk. */
+static bool cap_unpack(RtcmCaptureReader *r, size_t rec)
+{
+    r->blk_len = r->blk_pos = r->blk_off = 0;
+    if (rec < CAP_HEADER_SIZE || rec > r->end - CAP_REC_SIZE) return false;
+    const unsigned char *p = r->data + rec;
+    size_t n = get_u16(p + 10);
+    if (get_u16(p + 8) != CAP_TYPE_PACKED || n < CAP_PACK_HEAD ||
+        n > r->end - rec - CAP_REC_SIZE)
+        return false;
+    p += CAP_REC_SIZE;
+    size_t raw = get_u32(p);
+    if (raw > RTCM_CAPTURE_BLOCK_RAW ||
+        lz_block_decompress(p + CAP_PACK_HEAD, n - CAP_PACK_HEAD, r->blk,
+                            RTCM_CAPTURE_BLOCK_RAW) != raw)
+        return false;
+    r->blk_off = rec;
+    r->blk_len = raw;
+    return true;
+}
+
+/* Next frame record from the current block; false when it is used up.
+ * A damaged record ends the block. */
+static bool cap_next_packed(RtcmCaptureReader *r, uint64_t *t_ns,
+                            const unsigned char **frame, int *len,
+                            uint64_t *loc)
+{
+    if (r->blk_len - r->blk_pos < CAP_REC_SIZE) return false;
+    const unsigned char *p = r->blk + r->blk_pos;
+    size_t n = get_u16(p + 10);
+    if (n > r->blk_len - r->blk_pos - CAP_REC_SIZE) {
+        r->bad_blocks++;
+        r->blk_pos = r->blk_len;
+        return false;
+    }
+    size_t at = r->blk_pos + CAP_REC_SIZE;
+    r->blk_pos = at + n;
+    *t_ns  = get_u64(p);
+    *frame = r->blk + at;
+    *len   = (int)n;
+    if (loc) *loc = CAP_LOC(r->blk_off, at);
+    return true;
+}
+
+bool rtcm_capture_next(RtcmCaptureReader *r, uint64_t *t_ns,
+                       const unsigned char **frame, int *len, uint64_t *loc)
+{
+    for (;;) {
+        if (r->compressed && cap_next_packed(r, t_ns, frame, len, loc))
+            return true;
+        if (r->end - r->pos < CAP_REC_SIZE) return false;
+        const unsigned char *p = r->data + r->pos;
+        uint16_t type = get_u16(p + 8);
+        size_t   n    = get_u16(p + 10);
+        if (n > r->end - r->pos - CAP_REC_SIZE) {
+            r->truncated = true;
+            r->pos = r->end;
+            return false;
+        }
+        size_t rec = r->pos;
+        size_t at  = rec + CAP_REC_SIZE;
+        r->pos = at + n;
+        if (type == CAP_TYPE_PACKED && r->compressed) {
+            if (!cap_unpack(r, rec)) r->bad_blocks++;
+            continue;
+        }
+        if (type > CAP_TYPE_FRAME_MAX) continue;   /* index block */
+        *t_ns  = get_u64(p);
+        *frame = r->data + at;
+        *len   = (int)n;
+        if (loc) *loc = at;
+        return true;
+    }
+}
+
+const unsigned char *rtcm_capture_frame_at(RtcmCaptureReader *r, uint64_t loc)
+{
+    if (!r->compressed) return r->data + loc;
+    size_t blk = CAP_LOC_BLK(loc), at = CAP_LOC_AT(loc);
+    if ((r->blk_len == 0 || r->blk_off != blk) && !cap_unpack(r, blk))
+        return NULL;
+    return at < r->blk_len ? r->blk + at : NULL;
+}
+
+void rtcm_capture_seek(RtcmCaptureReader *r, uint64_t t_ns)
+{
+    /* Last index entry at or before t_ns, then walk forward. */
+    size_t lo = 0, hi = r->n_index;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r->index[mid].t_ns <= t_ns) lo = mid + 1;
+        else                            hi = mid;
+    }
+    r->pos = lo ? (size_t)r->index[lo - 1].offset : CAP_HEADER_SIZE;
+    r->blk_len = r->blk_pos = r->blk_off = 0;
+
+    uint64_t t, loc;
+    const unsigned char *frame;
+    int len;
+    while (rtcm_capture_next(r, &t, &frame, &len, &loc)) {
+        if (t >= t_ns) {
+            /* Step back onto the frame's record header. */
+            if (r->compressed) r->blk_pos = CAP_LOC_AT(loc) - CAP_REC_SIZE;
+            else               r->pos     = (size_t)loc - CAP_REC_SIZE;
+            return;
+        }
+    }
+}
+
+/* ── Converter ────────────────────────────────────────────────────────── */
+
+bool rtcm_capture_is_native_path(const char *path)
+{
+    const char *ext = path ? strrchr(path, '.') : NULL;
+    if (!ext) return false;
+#ifdef _WIN32
+    return _stricmp(ext, RTCM_CAPTURE_EXT) == 0;
+#else
+    return strcmp(ext, RTCM_CAPTURE_EXT) == 0;
+#endif
+}
+
+/* Native to native: copy every frame with its receive time, so the
+ * output differs from the input only in its writer flags. */
+static bool convert_native(const RtcmReplay *rp, const char *out_path,
+                           unsigned flags, unsigned long *frames)
+{
+    RtcmCaptureReader cr;
+    if (!rtcm_capture_reader_init(&cr, rp->data.data, rp->data.size))
+        return false;
+    RtcmCaptureWriter w;
+    bool ok = rtcm_capture_writer_open(&w, out_path, cr.start_unix_ns, flags);
+    uint64_t t_ns;
+    const unsigned char *fr;
+    int len;
+    unsigned long n = 0;
+    while (ok && rtcm_capture_next(&cr, &t_ns, &fr, &len, NULL)) {
+        ok = rtcm_capture_write_at(&w, t_ns, fr, len);
+        n++;
+    }
+    if (w.f && !rtcm_capture_writer_close(&w)) ok = false;
+    rtcm_capture_reader_free(&cr);
+    *frames = n;
+    return ok;
+}
+
+bool rtcm_capture_convert(const char *in_path, const char *out_path,
+                          unsigned flags, unsigned long *frames,
+                          bool *to_native)
+{
+    RtcmReplay rp;
+    if (!rtcm_replay_open(&rp, in_path)) return false;
+    bool native_out = !rp.native || rtcm_capture_is_native_path(out_path);
+    if (to_native) *to_native = native_out;
+
+    bool ok;
+    size_t i = 0;
+    if (rp.native && native_out) {
+        unsigned long n = 0;
+        ok = convert_native(&rp, out_path, flags, &n);
+        i = n;
+    } else if (rp.native) {
+        FILE *f = fopen(out_path, "wb");
+        ok = f != NULL;
+        for (i = 0; ok && i < rp.n_frames; i++) {
+            int len;
+            const unsigned char *fr = rtcm_replay_frame(&rp, i, &len);
+            ok = fr && fwrite(fr, 1, (size_t)len, f) == (size_t)len;
+        }
+        if (f && fclose(f) != 0) ok = false;
+    } else {
+        RtcmCaptureWriter w;
+        ok = rtcm_capture_writer_open(&w, out_path, 0, flags);
+        for (i = 0; ok && i < rp.n_frames; i++) {
+            int len;
+            const unsigned char *fr = rtcm_replay_frame(&rp, i, &len);
+            ok = rtcm_capture_write_at(&w, (uint64_t)rp.frames[i].t_ms * 1000000u,
+                                       fr, len);
+        }
+        if (w.f && !rtcm_capture_writer_close(&w)) ok = false;
+    }
+    if (frames) *frames = (unsigned long)i;
+    rtcm_replay_close(&rp);
+    return ok;
+}
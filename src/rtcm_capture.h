@@ -0,0 +1,275 @@
+/**
+ * @file rtcm_capture.h
+ * @brief Native RTCM capture container (.nacap) with receive timestamps.
+ *
+ * A raw dump (.rtcm3) is the frames concatenated as the caster sent them:
+ * it has no receive times, so a replay can only approximate the timing
+ * from MSM epochs, and finding a point in time means scanning the file.
+ * The native container keeps the frames byte-for-byte and adds:
+ *   - a 12-byte header per frame: monotonic receive time in ns since the
+ *     start of the capture, the RTCM message number and the frame length;
+ *   - a sparse index: one (time, offset) entry every
+ *     @ref RTCM_CAPTURE_INDEX_STRIDE frames, written in blocks of up to
+ *     @ref RTCM_CAPTURE_INDEX_BLOCK entries as the capture grows, each
+ *     block pointing back at the previous one;
+ *   - a footer pointing at the last index block, written on a clean close.
+ *
+ * With the footer, a reader collects the whole sparse index by walking
+ * the block chain and seeks in O(log n).  A capture cut short by a crash
+ * has no footer; the reader then rebuilds the index by hopping over the
+ * record headers, which never touches the frame bytes.
+ *
+ * A compressed capture (@ref RTCM_CAPTURE_COMPRESS, format version 2)
+ * packs the frame records into blocks of up to
+ * @ref RTCM_CAPTURE_BLOCK_RAW bytes, each compressed on its own with
+ * lz_block.h.  A block needs nothing from its neighbours, so it is the
+ * unit of seeking: the sparse index has one entry per block.  A block is
+ * closed when it is full or @ref RTCM_CAPTURE_BLOCK_SECS after its first
+ * frame, so a compressed capture whose process is killed loses at most
+ * the block in progress.
+ *
+ * Layout (all integers little-endian):
+ * @code
+ *   file header   32 B  "NACAP\r\n\x1a", u32 version, u32 header size,
+ *                       i64 start time (Unix ns, wall clock at t = 0),
+ *                       u32 index stride (0 = one entry per block),
+ *                       u32 flags (bit 0: compressed)
+ *   record        12 B  u64 t_ns, u16 type, u16 length, then length bytes
+ *     type 0..4095      one RTCM frame (0xD3 ... CRC), type = message no.
+ *     type 0xFFFD       compressed block: u32 unpacked size, u32 frames,
+ *                       then frame records (as above) packed with
+ *                       lz_block_compress(); t_ns = first frame
+ *     type 0xFFFF       index block: u64 previous block offset (0 = none),
+ *                       u32 entries, u32 reserved, entries x
+ *                       { u64 t_ns, u64 record offset }
+ *     type 0xFFFE       footer, last record: u64 last index block offset
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_CAPTURE_H
+#define RTCM_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief File extension of native captures. */
+#define RTCM_CAPTURE_EXT           ".nacap"
+
+/** @brief Frames between two sparse index entries. */
+#define RTCM_CAPTURE_INDEX_STRIDE  256
+
+/** @brief Index entries per index block. */
+#define RTCM_CAPTURE_INDEX_BLOCK   64
+
+/** @brief stdio buffer of a capture being written, for large writes. */
+#define RTCM_CAPTURE_IO_BUF        (1u << 20)
+
+/** @brief rtcm_capture_writer_open() flag: write a compressed capture. */
+#define RTCM_CAPTURE_COMPRESS      1u
+
+/** @brief Largest unpacked size of a compressed block. */
+#define RTCM_CAPTURE_BLOCK_RAW     32768
+
+/** @brief Capture seconds after which a compressed block is closed. */
+#define RTCM_CAPTURE_BLOCK_SECS    10
+
+/**
+ * @struct RtcmCaptureIndexEntry
+ * @brief One sparse index entry.
+ *
+ * Fields:
+ *   - t_ns:    Receive time of the record.
+ *   - offset:  File offset of its record header.
+ */
+typedef struct {
+    uint64_t t_ns;
+    uint64_t offset;
+} RtcmCaptureIndexEntry;
+
+/**
+ * @struct RtcmCaptureWriter
+ * @brief An open native capture being written.
+ *
+ * Fields:
+ *   - f:           Output file.
+ *   - t0_ns:       Monotonic clock at the start of the capture.
+ *   - offset:      Bytes written so far.
+ *   - frames:      Frames written.
+ *   - last_t_ns:   Latest timestamp (kept non-decreasing).
+ *   - prev_block:  Offset of the latest index block, 0 if none yet.
+ *   - pending:     Index entries not yet written out.
+ *   - n_pending:   Number of entries in @c pending.
+ *   - last_flush:  Capture time of the latest fflush().
+ *   - failed:      A write failed; the capture is incomplete.
+ *   - blk:         Compressed capture: the block being filled (heap,
+ *                  @ref RTCM_CAPTURE_BLOCK_RAW bytes), NULL otherwise.
+ *   - blk_len:     Bytes in @c blk.
+ *   - blk_frames:  Frames in @c blk.
+ *   - blk_t0:      Timestamp of the first frame in @c blk.
+ */
+typedef struct RtcmCaptureWriter {
+    FILE                 *f;
+    int64_t               t0_ns;
+    uint64_t              offset;
+    uint64_t              frames;
+    uint64_t              last_t_ns;
+    uint64_t              prev_block;
+    RtcmCaptureIndexEntry pending[RTCM_CAPTURE_INDEX_BLOCK];
+    int                   n_pending;
+    uint64_t              last_flush;
+    bool                  failed;
+    unsigned char        *blk;
+    size_t                blk_len;
+    uint32_t              blk_frames;
+    uint64_t              blk_t0;
+} RtcmCaptureWriter;
+
+/**
+ * @brief Create @p path and write the file header.
+ *
+ * @param start_unix_ns  Wall-clock time of t = 0 in Unix ns, or 0 if unknown.
+ * @param flags          0 or @ref RTCM_CAPTURE_COMPRESS.
+ * @return false if the file cannot be created.
+ */
+bool rtcm_capture_writer_open(RtcmCaptureWriter *w, const char *path,
+                              int64_t start_unix_ns, unsigned flags);
+
+/**
+ * @brief Append a frame stamped with the current monotonic time.
+ *
+ * The file is flushed at least once a second, so a capture whose process
+ * is killed loses at most the last second and stays readable.
+ *
+ * @return false once any write has failed.
+ */
+bool rtcm_capture_write(RtcmCaptureWriter *w, const unsigned char *frame,
+                        int frame_len);
+
+/** @brief Append a frame with an explicit timestamp (ns since t = 0). */
+bool rtcm_capture_write_at(RtcmCaptureWriter *w, uint64_t t_ns,
+                           const unsigned char *frame, int frame_len);
+
+/**
+ * @brief Write the block in progress, the last index block and the
+ *        footer, then close the file.
+ * @return false if any write failed during the capture.
+ */
+bool rtcm_capture_writer_close(RtcmCaptureWriter *w);
+
+/**
+ * @struct RtcmCaptureReader
+ * @brief A native capture in memory (typically a FileMap), being read.
+ *
+ * Fields:
+ *   - data, size:     The capture bytes (not owned).
+ *   - start_unix_ns:  Wall-clock time of t = 0, 0 if unknown.
+ *   - index:          Sparse index, @c n_index entries in file order.
+ *   - pos:            Offset of the next record to read.
+ *   - end:            End of the record area (before the footer).
+ *   - has_footer:     The capture was closed cleanly.
+ *   - truncated:      The last record is cut short.
+ *   - compressed:     The frames are in compressed blocks.
+ *   - blk:            Compressed capture: the unpacked current block.
+ *   - blk_off:        File offset of the block in @c blk, 0 if none.
+ *   - blk_len:        Unpacked size of @c blk.
+ *   - blk_pos:        Offset of the next record in @c blk.
+ *   - bad_blocks:     Blocks that failed to unpack (skipped).
+ */
+typedef struct {
+    const unsigned char   *data;
+    size_t                 size;
+    int64_t                start_unix_ns;
+    RtcmCaptureIndexEntry *index;
+    size_t                 n_index;
+    size_t                 pos;
+    size_t                 end;
+    bool                   has_footer;
+    bool                   truncated;
+    bool                   compressed;
+    unsigned char         *blk;
+    size_t                 blk_off;
+    size_t                 blk_len;
+    size_t                 blk_pos;
+    unsigned long          bad_blocks;
+} RtcmCaptureReader;
+
+/** @brief true if @p data starts with a native capture header. */
+bool rtcm_capture_is_native(const unsigned char *data, size_t size);
+
+/**
+ * @brief Validate the header and load (or rebuild) the sparse index.
+ * @return false if @p data is not a native capture or memory runs out.
+ */
+bool rtcm_capture_reader_init(RtcmCaptureReader *r, const unsigned char *data,
+                              size_t size);
+
+/** @brief Release the index and block buffer.  Safe on a failed init. */
+void rtcm_capture_reader_free(RtcmCaptureReader *r);
+
+/**
+ * @brief Next frame record; index blocks are skipped.
+ *
+ * @param t_ns   [out] Receive time.
+ * @param frame  [out] Frame bytes, pointing into @c data.
+ * In a compressed capture @p frame points into the reader's block buffer
+ * and stays valid until the reader moves on to the next block.
+ *
+ * @param len    [out] Frame length.
+ * @param loc    [out] Location of the frame for rtcm_capture_frame_at():
+ *               its offset in @c data, or in a compressed capture the
+ *               block offset and the offset inside the block (may be NULL).
+ * @return false at the end of the capture.
+ */
+bool rtcm_capture_next(RtcmCaptureReader *r, uint64_t *t_ns,
+                       const unsigned char **frame, int *len, uint64_t *loc);
+
+/**
+ * @brief Frame bytes at a location returned by rtcm_capture_next().
+ *
+ * Unpacks the frame's block if it is not the current one, so the
+ * pointer follows the lifetime rule of rtcm_capture_next().  That moves
+ * the reader: call rtcm_capture_seek() before rtcm_capture_next() again.
+ *
+ * @return NULL if the block no longer unpacks (file changed on disk).
+ */
+const unsigned char *rtcm_capture_frame_at(RtcmCaptureReader *r, uint64_t loc);
+
+/** @brief Position the reader at the first frame received at or after @p t_ns. */
+void rtcm_capture_seek(RtcmCaptureReader *r, uint64_t t_ns);
+
+/** @brief true if @p path has the native capture extension. */
+bool rtcm_capture_is_native_path(const char *path);
+
+/**
+ * @brief Convert between raw RTCM and the native container.
+ *
+ * A native input is written out as raw frames, or, when @p out_path has
+ * the native extension, rewritten as a native capture with the same
+ * receive times (to compress or decompress it).  Any other input is
+ * framed (rtcm_replay.h) and written as a native capture whose timestamps
+ * are the MSM stream times of the frames, the best a raw dump can offer.
+ *
+ * @param flags   Writer flags for a native output (@ref RTCM_CAPTURE_COMPRESS).
+ * @param frames  [out] Frames written (may be NULL).
+ * @param to_native  [out] true if the output is a native capture (may be NULL).
+ * @return false if the input cannot be read or the output written.
+ */
+bool rtcm_capture_convert(const char *in_path, const char *out_path,
+                          unsigned flags, unsigned long *frames,
+                          bool *to_native);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_CAPTURE_H */
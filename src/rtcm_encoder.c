@@ -0,0 +1,535 @@
+/**
+ * @file rtcm_encoder.c
+ * @brief RTCM 3.x encoder: the inverse of the structured decoders.
+ *
+ * Every message is written field by field in the order of its decoder in
+ * rtcm3x_parser.c, with the same scale factors, so the two can be read
+ * side by side.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_encoder.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* ── MSB-first bit writer, the inverse of rtcm_bitreader.h ─────────── */
+
+typedef struct {
+    unsigned char *buf;
+    int cap_bits;
+    int pos;
+    bool overflow;
+} RtcmBitWriter;
+
+static void bw_init(RtcmBitWriter *w, unsigned char *buf, int cap_bytes)
+{
+    memset(buf, 0, (size_t)cap_bytes);
+    w->buf      = buf;
+    w->cap_bits = cap_bytes * 8;
+    w->pos      = 0;
+    w->overflow = false;
+}
+
+static void bw_put(RtcmBitWriter *w, int bits, uint64_t v)
+{
+    if (w->pos + bits > w->cap_bits) {
+        w->overflow = true;
+        return;
+    }
+    for (int i = bits - 1; i >= 0; i--, w->pos++)
+        if ((v >> i) & 1)
+            w->buf[w->pos >> 3] |= (unsigned char)(0x80u >> (w->pos & 7));
+}
+
+/* Unsigned field, clamped to its width. */
+static void bw_u(RtcmBitWriter *w, int bits, int64_t v)
+{
+    int64_t max = (int64_t)((bits >= 63) ? INT64_MAX : (int64_t)((1ull << bits) - 1));
+    bw_put(w, bits, (uint64_t)(v < 0 ? 0 : v > max ? max : v));
+}
+
+/* Two's complement field, clamped to its range. */
+static void bw_s(RtcmBitWriter *w, int bits, int64_t v)
+{
+    int64_t max = (int64_t)((1ull << (bits - 1)) - 1);
+    if (v > max) v = max;
+    if (v < -max - 1) v = -max - 1;
+    bw_put(w, bits, (uint64_t)v & ((1ull << bits) - 1));
+}
+
+/* GLONASS sign-magnitude field (see glo_sign_mag() in the parser). */
+static void bw_sm(RtcmBitWriter *w, int bits, int64_t v)
+{
+    int64_t max = (int64_t)((1ull << (bits - 1)) - 1);
+    int64_t mag = v < 0 ? -v : v;
+    bw_put(w, 1, v < 0 ? 1 : 0);
+    bw_put(w, bits - 1, (uint64_t)(mag > max ? max : mag));
+}
+
+/* @p v in units of 2^exp2. */
+static int64_t q(double v, int exp2)
+{
+    return llround(ldexp(v, -exp2));
+}
+
+/* Radians in semi-circles of 2^exp2. */
+static int64_t qsc(double rad, int exp2)
+{
+    return q(rad / M_PI, exp2);
+}
+
+/* Payload written: frame it. */
+static int bw_finish(RtcmBitWriter *w, unsigned char *frame)
+{
+    if (w->overflow) return 0;
+    return rtcm_encode_frame(frame, (w->pos + 7) / 8);
+}
+
+int rtcm_encode_frame(unsigned char *frame, int payload_len)
+{
+    if (payload_len < 1 || payload_len > 1023) return 0;
+    frame[0] = 0xD3;
+    frame[1] = (unsigned char)((payload_len >> 8) & 0x03);
+    frame[2] = (unsigned char)(payload_len & 0xFF);
+    uint32_t crc = crc24q(frame, (size_t)payload_len + 3);
+    frame[payload_len + 3] = (unsigned char)(crc >> 16);
+    frame[payload_len + 4] = (unsigned char)(crc >> 8);
+    frame[payload_len + 5] = (unsigned char)crc;
+    return payload_len + 6;
+}
+
+/* ── MSM ──────────────────────────────────────────────────────────── */
+
+int rtcm_encode_msm(const RtcmMsmObs *obs, unsigned char frame[RTCM_FRAME_MAX])
+{
+    const RtcmMsgInfo *info = rtcm_msg_info(obs->msg_type);
+    if (!info || !(info->flags & RTCM_MSG_F_MSM)) return 0;
+    const RtcmMsmLayout *L = rtcm_msm_layout(info->msm_subtype);
+    const int ns = obs->num_sats, ng = obs->num_sigs, nc = obs->num_cells;
+    if (!L || ns < 0 || ng < 0 || ns * ng > RTCM_MSM_MAX_CELLS || nc > ns * ng)
+        return 0;
+
+    uint64_t sat_mask = 0;
+    uint32_t sig_mask = 0;
+    for (int s = 0; s < ns; s++) {
+        int prn = obs->sats[s].prn;
+        if (prn < 1 || prn > RTCM_MSM_MAX_SATS || (s && prn <= obs->sats[s - 1].prn))
+            return 0;
+        sat_mask |= 1ull << (64 - prn);
+    }
+    for (int g = 0; g < ng; g++) {
+        int idx = obs->sig_idx[g];
+        if (idx < 0 || idx >= RTCM_MSM_MAX_SIGS || (g && idx <= obs->sig_idx[g - 1]))
+            return 0;
+        sig_mask |= 1u << (31 - idx);
+    }
+
+    RtcmBitWriter w;
+    bw_init(&w, frame + 3, 1023);
+    bw_u(&w, 12, obs->msg_type);
+    bw_u(&w, 12, obs->ref_station_id);
+    bw_u(&w, 30, obs->epoch_time);
+    bw_u(&w, 1, obs->mm_flag);
+    bw_u(&w, 3, obs->iods);
+    bw_u(&w, 7, 0);                     /* reserved */
+    bw_u(&w, 2, obs->clk_steering);
+    bw_u(&w, 2, obs->ext_clk);
+    bw_u(&w, 1, obs->df_smoothing);
+    bw_u(&w, 3, obs->smoothing_int);
+    bw_put(&w, 64, sat_mask);
+    bw_put(&w, 32, sig_mask);
+
+    int k = 0;
+    for (int s = 0; s < ns; s++)
+        for (int g = 0; g < ng; g++) {
+            bool set = k < nc && obs->cells[k].sat == s &&
+                       obs->cells[k].sig_idx == obs->sig_idx[g];
+            bw_put(&w, 1, set ? 1 : 0);
+            if (set) k++;
+        }
+    if (k != nc) return 0;              /* cells not in wire order */
+
+    /* ── Satellite data block ── */
+    if (L->sat_int)
+        for (int s = 0; s < ns; s++) bw_u(&w, L->sat_int, obs->sats[s].rough_int_ms);
+    if (L->sat_ext)
+        for (int s = 0; s < ns; s++) bw_u(&w, L->sat_ext, obs->sats[s].ext_info);
+    for (int s = 0; s < ns; s++) bw_u(&w, 10, obs->sats[s].rough_mod);
+    if (L->sat_rate)
+        for (int s = 0; s < ns; s++) bw_s(&w, L->sat_rate, obs->sats[s].rough_rate);
+
+    /* ── Signal data block ── */
+    if (L->pr)
+        for (int c = 0; c < nc; c++) bw_s(&w, L->pr, obs->cells[c].fine_pr);
+    if (L->ph)
+        for (int c = 0; c < nc; c++) bw_s(&w, L->ph, obs->cells[c].fine_ph);
+    if (L->lock)
+        for (int c = 0; c < nc; c++) bw_u(&w, L->lock, obs->cells[c].lock);
+    if (L->ph)
+        for (int c = 0; c < nc; c++) bw_u(&w, 1, obs->cells[c].half_cycle);
+    if (L->cnr)
+        for (int c = 0; c < nc; c++) bw_u(&w, L->cnr, obs->cells[c].cnr_raw);
+    if (L->rate)
+        for (int c = 0; c < nc; c++) bw_s(&w, L->rate, obs->cells[c].fine_rate);
+
+    return bw_finish(&w, frame);
+}
+
+void rtcm_msm_set_sat(RtcmMsmObs *obs, int s, double range_m, double rate_mps, int ext_info)
+{
+    RtcmMsmSat *sat = &obs->sats[s];
+    long long units = range_m > 0.0 ? llround(range_m / RTCM_LIGHT_MS * 1024.0) : -1;
+    if (units < 0 || units / 1024 > 254) {
+        sat->rough_int_ms  = 255;       /* invalid (DF397) */
+        sat->rough_mod     = 0;
+        sat->rough_range_m = 0.0;
+    } else {
+        sat->rough_int_ms  = (int)(units / 1024);
+        sat->rough_mod     = (int)(units % 1024);
+        sat->rough_range_m = (double)units / 1024.0 * RTCM_LIGHT_MS;
+    }
+    long rate = lround(rate_mps);
+    sat->rough_rate = rate > 8191 ? 8191 : rate < -8191 ? -8191 : (int)rate;
+    sat->ext_info   = ext_info;
+}
+
+/* Fine field for @p value relative to @p rough, or the invalid code. */
+static int32_t msm_fine(double value, double rough, double lsb, int bits)
+{
+    int32_t invalid = -(1 << (bits - 1));
+    if (rough == 0.0 || value == 0.0) return invalid;
+    long long f = llround((value - rough) / lsb);
+    return (f <= invalid || f >= -(long long)invalid) ? invalid : (int32_t)f;
+}
+
+void rtcm_msm_set_cell(RtcmMsmObs *obs, int c, double pr_m, double ph_m,
+                       double rate_mps, double cnr_dbhz, int lock)
+{
+    const RtcmMsmLayout *L = rtcm_msm_layout(obs->msm_subtype);
+    RtcmMsmCell *cell = &obs->cells[c];
+    const RtcmMsmSat *sat = &obs->sats[cell->sat];
+    if (!L) return;
+
+    double rough = sat->rough_range_m;
+    const double pr_lsb = ldexp(1.0, L->pr_exp) * RTCM_LIGHT_MS;
+    const double ph_lsb = ldexp(1.0, L->ph_exp) * RTCM_LIGHT_MS;
+    cell->pr_m = cell->ph_m = 0.0;
+    if (L->pr) {
+        cell->fine_pr = msm_fine(pr_m, rough, pr_lsb, L->pr);
+        if (cell->fine_pr != -(1 << (L->pr - 1))) cell->pr_m = rough + cell->fine_pr * pr_lsb;
+    }
+    if (L->ph) {
+        cell->fine_ph = msm_fine(ph_m, rough, ph_lsb, L->ph);
+        if (cell->fine_ph != -(1 << (L->ph - 1))) cell->ph_m = rough + cell->fine_ph * ph_lsb;
+    }
+    if (L->lock) {
+        int max = (1 << L->lock) - 1;
+        cell->lock = (uint16_t)(lock < 0 ? 0 : lock > max ? max : lock);
+    }
+    if (L->cnr) {
+        long raw = lround(cnr_dbhz / L->cnr_lsb);
+        long max = (1L << L->cnr) - 1;
+        cell->cnr_raw  = (uint16_t)(raw < 0 ? 0 : raw > max ? max : raw);
+        cell->cnr_dbhz = (float)cell->cnr_raw * L->cnr_lsb;
+    }
+    if (L->rate) {
+        /* DF404: 0.0001 m/s on top of the rough rate */
+        cell->fine_rate = (int16_t)msm_fine(rate_mps, (double)sat->rough_rate + 1e-9,
+                                            0.0001, L->rate);
+    }
+}
+
+/* ── 1005 / 1006 ──────────────────────────────────────────────────── */
+
+int rtcm_encode_arp(const RtcmStationArp *arp, unsigned char frame[RTCM_FRAME_MAX])
+{
+    bool with_height = arp->msg_type == 1006;
+    RtcmBitWriter w;
+    bw_init(&w, frame + 3, 1023);
+    bw_u(&w, 12, with_height ? 1006 : 1005);
+    bw_u(&w, 12, arp->ref_station_id);
+    bw_u(&w, 6, arp->itrf_year);
+    bw_u(&w, 1, arp->gps_ind);
+    bw_u(&w, 1, arp->glo_ind);
+    bw_u(&w, 1, arp->gal_ind);
+    bw_u(&w, 1, arp->ref_station_ind);
+    bw_s(&w, 38, llround(arp->x / 0.0001));
+    bw_u(&w, 1, arp->osc_ind);
+    bw_u(&w, 1, 0);                     /* reserved */
+    bw_s(&w, 38, llround(arp->y / 0.0001));
+    bw_u(&w, 2, arp->quarter_cycle_ind);
+    bw_s(&w, 38, llround(arp->z / 0.0001));
+    if (with_height)
+        bw_u(&w, 16, llround(arp->antenna_height / 0.0001));
+    return bw_finish(&w, frame);
+}
+
+/* ── Ephemerides ──────────────────────────────────────────────────── */
+
+int rtcm_eph_msg_type(int gnss_id)
+{
+    switch (gnss_id) {
+    case 1: return 1019;
+    case 2: return 1020;
+    case 3: return 1046;
+    case 4: return 1044;
+    case 5: return 1042;
+    case 7: return 1041;
+    default: return 0;
+    }
+}
+
+static void encode_1019(RtcmBitWriter *w, const SvEphemeris *e)
+{
+    /* RTCM 10403.3 Table 3.5-21, as decode_rtcm_1019() */
+    bw_u(w, 12, 1019);
+    bw_u(w, 6,  e->prn);
+    bw_u(w, 10, e->week % 1024);
+    bw_u(w, 4,  0);                     /* URA */
+    bw_u(w, 2,  1);                     /* code on L2: P */
+    bw_s(w, 14, qsc(e->idot, -43));
+    bw_u(w, 8,  e->iode_iodnav & 0xFF);
+    bw_u(w, 16, llround(e->toc / 16.0));
+    bw_s(w, 8,  q(e->af2, -55));
+    bw_s(w, 16, q(e->af1, -43));
+    bw_s(w, 22, q(e->af0, -31));
+    bw_u(w, 10, e->iode_iodnav & 0xFF); /* IODC */
+    bw_s(w, 16, q(e->crs, -5));
+    bw_s(w, 16, qsc(e->delta_n, -43));
+    bw_s(w, 32, qsc(e->m0, -31));
+    bw_s(w, 16, q(e->cuc, -29));
+    bw_u(w, 32, q(e->e, -33));
+    bw_s(w, 16, q(e->cus, -29));
+    bw_u(w, 32, q(e->sqrt_a, -19));
+    bw_u(w, 16, llround(e->toe / 16.0));
+    bw_s(w, 16, q(e->cic, -29));
+    bw_s(w, 32, qsc(e->omega0, -31));
+    bw_s(w, 16, q(e->cis, -29));
+    bw_s(w, 32, qsc(e->i0, -31));
+    bw_s(w, 16, q(e->crc, -5));
+    bw_s(w, 32, qsc(e->omega, -31));
+    bw_s(w, 24, qsc(e->omega_dot, -43));
+    bw_s(w, 8,  0);                     /* TGD */
+    bw_u(w, 6,  e->health);
+    bw_u(w, 1,  0);                     /* L2 P data flag */
+    bw_u(w, 1,  0);                     /* fit interval */
+}
+
+static void encode_1020(RtcmBitWriter *w, const SvEphemeris *e)
+{
+    /* As decode_rtcm_1020(): PZ-90 state vector in km, sign-magnitude */
+    long tb  = lround(e->glo_tb_sod / 900.0);
+    long tod = lround(e->glo_tb_sod) - 900;             /* frame start, 15 min before tb */
+    if (tod < 0) tod += 86400;
+    bw_u(w, 12, 1020);
+    bw_u(w, 6,  e->prn);
+    bw_u(w, 5,  e->glo_freq_chan + 7);
+    bw_u(w, 1,  0);                     /* almanac health */
+    bw_u(w, 1,  0);                     /* almanac health availability */
+    bw_u(w, 2,  0);                     /* P1 */
+    bw_u(w, 12, ((tod / 3600) << 7) | ((tod / 60 % 60) << 1) | (tod % 60 >= 30)); /* tk */
+    bw_u(w, 1,  e->health ? 1 : 0);     /* Bn MSB */
+    bw_u(w, 1,  0);                     /* P2 */
+    bw_u(w, 7,  tb);
+    for (int k = 0; k < 3; k++) {
+        bw_sm(w, 24, q(e->glo_vel[k] / 1000.0, -20));
+        bw_sm(w, 27, q(e->glo_pos[k] / 1000.0, -11));
+        bw_sm(w, 5,  q(e->glo_acc[k] / 1000.0, -30));
+    }
+    bw_u(w, 1,  0);                     /* P3 */
+    bw_sm(w, 11, 0);                    /* gamma_n */
+    bw_u(w, 2,  0);                     /* M_P */
+    bw_u(w, 1,  0);                     /* M_ln (third string) */
+    bw_sm(w, 22, q(-e->af0, -30));      /* tau_n */
+    bw_u(w, 5,  0);                     /* M_delta tau_n */
+    bw_u(w, 5,  0);                     /* E_n */
+    bw_u(w, 1,  0);                     /* M_P4 */
+    bw_u(w, 4,  0);                     /* M_F_T */
+    bw_u(w, 11, 0);                     /* M_N_T */
+    bw_u(w, 2,  0);                     /* M_M */
+    bw_u(w, 1,  0);                     /* additional data availability */
+    bw_u(w, 11, 0);                     /* N_A */
+    bw_sm(w, 32, 0);                    /* tau_c */
+    bw_u(w, 5,  0);                     /* M_N4 */
+    bw_sm(w, 22, 0);                    /* M_tau_GPS */
+    bw_u(w, 1,  0);                     /* M_ln (fifth string) */
+    bw_u(w, 7,  0);                     /* reserved */
+}
+
+static void encode_1041(RtcmBitWriter *w, const SvEphemeris *e)
+{
+    /* As decode_rtcm_1041() (DF516 .. DF543) */
+    bw_u(w, 12, 1041);
+    bw_u(w, 6,  e->prn);
+    bw_u(w, 10, e->week % 1024);
+    bw_s(w, 22, q(e->af0, -31));
+    bw_s(w, 16, q(e->af1, -43));
+    bw_s(w, 8,  q(e->af2, -55));
+    bw_u(w, 4,  0);                     /* URA */
+    bw_u(w, 16, llround(e->toc / 16.0));
+    bw_s(w, 8,  0);                     /* TGD */
+    bw_s(w, 22, qsc(e->delta_n, -41));
+    bw_u(w, 8,  e->iode_iodnav & 0xFF);
+    bw_u(w, 10, 0);                     /* reserved */
+    bw_u(w, 1,  0);                     /* L5 flag */
+    bw_u(w, 1,  0);                     /* S flag */
+    bw_s(w, 15, q(e->cuc, -28));
+    bw_s(w, 15, q(e->cus, -28));
+    bw_s(w, 15, q(e->cic, -28));
+    bw_s(w, 15, q(e->cis, -28));
+    bw_s(w, 15, q(e->crc, -4));
+    bw_s(w, 15, q(e->crs, -4));
+    bw_s(w, 14, qsc(e->idot, -43));
+    bw_s(w, 32, qsc(e->m0, -31));
+    bw_u(w, 16, llround(e->toe / 16.0));
+    bw_u(w, 32, q(e->e, -33));
+    bw_u(w, 32, q(e->sqrt_a, -19));
+    bw_s(w, 32, qsc(e->omega0, -31));
+    bw_s(w, 32, qsc(e->omega, -31));
+    bw_s(w, 22, qsc(e->omega_dot, -41));
+    bw_s(w, 32, qsc(e->i0, -31));
+    bw_u(w, 2,  0);                     /* spare */
+}
+
+static void encode_1042(RtcmBitWriter *w, const SvEphemeris *e)
+{
+    /* RTCM 10403.3 Table 3.5-31, as decode_rtcm_1042() */
+    bw_u(w, 12, 1042);
+    bw_u(w, 6,  e->prn);
+    bw_u(w, 13, e->week % 8192);
+    bw_u(w, 4,  0);                     /* URAI */
+    bw_s(w, 14, qsc(e->idot, -43));
+    bw_u(w, 5,  e->iode_iodnav & 0x1F); /* AODE */
+    bw_u(w, 17, llround(e->toc / 8.0));
+    bw_s(w, 11, q(e->af2, -66));
+    bw_s(w, 22, q(e->af1, -50));
+    bw_s(w, 24, q(e->af0, -33));
+    bw_u(w, 5,  e->iode_iodnav & 0x1F); /* AODC */
+    bw_s(w, 18, q(e->crs, -6));
+    bw_s(w, 16, qsc(e->delta_n, -43));
+    bw_s(w, 32, qsc(e->m0, -31));
+    bw_s(w, 18, q(e->cuc, -31));
+    bw_u(w, 32, q(e->e, -33));
+    bw_s(w, 18, q(e->cus, -31));
+    bw_u(w, 32, q(e->sqrt_a, -19));
+    bw_u(w, 17, llround(e->toe / 8.0));
+    bw_s(w, 18, q(e->cic, -31));
+    bw_s(w, 32, qsc(e->omega0, -31));
+    bw_s(w, 18, q(e->cis, -31));
+    bw_s(w, 32, qsc(e->i0, -31));
+    bw_s(w, 18, q(e->crc, -6));
+    bw_s(w, 32, qsc(e->omega, -31));
+    bw_s(w, 24, qsc(e->omega_dot, -43));
+    bw_s(w, 10, 0);                     /* TGD1 */
+    bw_s(w, 10, 0);                     /* TGD2 */
+    bw_u(w, 1,  e->health ? 1 : 0);
+}
+
+static void encode_1044(RtcmBitWriter *w, const SvEphemeris *e)
+{
+    /* RTCM 10403.3 Table 3.5-32, as decode_rtcm_1044() */
+    bw_u(w, 12, 1044);
+    bw_u(w, 4,  e->prn);
+    bw_u(w, 16, llround(e->toc / 16.0));
+    bw_s(w, 8,  q(e->af2, -55));
+    bw_s(w, 16, q(e->af1, -43));
+    bw_s(w, 22, q(e->af0, -31));
+    bw_u(w, 8,  e->iode_iodnav & 0xFF);
+    bw_s(w, 16, q(e->crs, -5));
+    bw_s(w, 16, qsc(e->delta_n, -43));
+    bw_s(w, 32, qsc(e->m0, -31));
+    bw_s(w, 16, q(e->cuc, -29));
+    bw_u(w, 32, q(e->e, -33));
+    bw_s(w, 16, q(e->cus, -29));
+    bw_u(w, 32, q(e->sqrt_a, -19));
+    bw_u(w, 16, llround(e->toe / 16.0));
+    bw_s(w, 16, q(e->cic, -29));
+    bw_s(w, 32, qsc(e->omega0, -31));
+    bw_s(w, 16, q(e->cis, -29));
+    bw_s(w, 32, qsc(e->i0, -31));
+    bw_s(w, 16, q(e->crc, -5));
+    bw_s(w, 32, qsc(e->omega, -31));
+    bw_s(w, 24, qsc(e->omega_dot, -43));
+    bw_s(w, 14, qsc(e->idot, -43));
+    bw_u(w, 2,  0);                     /* code on L2 */
+    bw_u(w, 10, e->week % 1024);
+    bw_u(w, 4,  0);                     /* URA */
+    bw_u(w, 6,  e->health);
+    bw_s(w, 8,  0);                     /* TGD */
+    bw_u(w, 10, e->iode_iodnav & 0xFF); /* IODC */
+    bw_u(w, 1,  0);                     /* fit interval */
+}
+
+static void encode_galileo(RtcmBitWriter *w, const SvEphemeris *e, int msg_type)
+{
+    /* As galileo_read_orbit_block() plus the 1045 / 1046 trailer */
+    bw_u(w, 12, msg_type);
+    bw_u(w, 6,  e->prn);
+    bw_u(w, 12, e->week % 4096);
+    bw_u(w, 10, e->iode_iodnav & 0x3FF);
+    bw_u(w, 8,  0);                     /* SISA */
+    bw_s(w, 14, qsc(e->idot, -43));
+    bw_u(w, 14, llround(e->toc / 60.0));
+    bw_s(w, 6,  q(e->af2, -59));
+    bw_s(w, 21, q(e->af1, -46));
+    bw_s(w, 31, q(e->af0, -34));
+    bw_s(w, 16, q(e->crs, -5));
+    bw_s(w, 16, qsc(e->delta_n, -43));
+    bw_s(w, 32, qsc(e->m0, -31));
+    bw_s(w, 16, q(e->cuc, -29));
+    bw_u(w, 32, q(e->e, -33));
+    bw_s(w, 16, q(e->cus, -29));
+    bw_u(w, 32, q(e->sqrt_a, -19));
+    bw_u(w, 14, llround(e->toe / 60.0));
+    bw_s(w, 16, q(e->cic, -29));
+    bw_s(w, 32, qsc(e->omega0, -31));
+    bw_s(w, 16, q(e->cis, -29));
+    bw_s(w, 32, qsc(e->i0, -31));
+    bw_s(w, 16, q(e->crc, -5));
+    bw_s(w, 32, qsc(e->omega, -31));
+    bw_s(w, 24, qsc(e->omega_dot, -43));
+    bw_s(w, 10, 0);                     /* BGD E1-E5a */
+    if (msg_type == 1045) {
+        bw_u(w, 2, e->health & 0x3);            /* E5a OSHS */
+        bw_u(w, 1, (e->health >> 2) & 1);       /* E5a OSDVS */
+        bw_u(w, 7, 0);                          /* reserved */
+    } else {
+        bw_s(w, 10, 0);                         /* BGD E1-E5b */
+        bw_u(w, 2, e->health & 0x3);            /* E5b SHS */
+        bw_u(w, 1, (e->health >> 2) & 1);       /* E5b DVS */
+        bw_u(w, 2, (e->health >> 3) & 0x3);     /* E1B SHS */
+        bw_u(w, 1, (e->health >> 5) & 1);       /* E1B DVS */
+        bw_u(w, 2, 0);                          /* reserved */
+    }
+}
+
+int rtcm_encode_eph(const SvEphemeris *eph, int msg_type, unsigned char frame[RTCM_FRAME_MAX])
+{
+    if (!eph) return 0;
+    if (msg_type == 0) msg_type = rtcm_eph_msg_type(eph->gnss_id);
+    if (rtcm_msg_gnss_id(msg_type) != eph->gnss_id || !rtcm_msg_is_eph(msg_type))
+        return 0;
+
+    RtcmBitWriter w;
+    bw_init(&w, frame + 3, 1023);
+    switch (msg_type) {
+    case 1019: encode_1019(&w, eph); break;
+    case 1020: encode_1020(&w, eph); break;
+    case 1041: encode_1041(&w, eph); break;
+    case 1042: encode_1042(&w, eph); break;
+    case 1044: encode_1044(&w, eph); break;
+    case 1045:
+    case 1046: encode_galileo(&w, eph, msg_type); break;
+    default:   return 0;
+    }
+    return bw_finish(&w, frame);
+}
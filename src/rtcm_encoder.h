@@ -0,0 +1,111 @@
+/**
+ * @file rtcm_encoder.h
+ * @brief RTCM 3.x encoder: the inverse of the structured decoders.
+ *
+ * Builds complete frames (preamble, length, payload, CRC-24Q) from the
+ * same plain structs the decoders fill:
+ *
+ *   - rtcm_encode_msm():  RtcmMsmObs -> MSM1..MSM7 of any GNSS (what
+ *     rtcm_decode_msm() reads back bit for bit),
+ *   - rtcm_encode_arp():  RtcmStationArp -> 1005 / 1006,
+ *   - rtcm_encode_eph():  SvEphemeris -> 1019 (GPS), 1020 (GLONASS),
+ *     1041 (NavIC), 1042 (BeiDou), 1044 (QZSS), 1045 / 1046 (Galileo);
+ *     decoding the frame stores the same ephemeris to within the
+ *     message's resolution.
+ *
+ * rtcm_msm_set_sat() / rtcm_msm_set_cell() turn ranges in metres into
+ * the rough / fine raw fields of a subtype, so a caller that knows the
+ * geometry need not know the bit layout.  Fields a message carries but
+ * SvEphemeris does not (URA, TGD, IODC, GLONASS tau_n, ...) are sent as 0.
+ *
+ * Every encoder writes into a caller buffer of @ref RTCM_FRAME_MAX bytes
+ * and returns the frame length, or 0 when the input cannot be encoded.
+ * No state, no allocation: safe from any thread.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_ENCODER_H
+#define RTCM_ENCODER_H
+
+#include <stdbool.h>
+
+#include "rtcm3x_parser.h"
+#include "rtcm_framer.h"
+#include "sv_ephemeris.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Wrap the payload at @p frame + 3 into a frame: write the
+ *        preamble and length in front and the CRC-24Q behind it.
+ *
+ * @return Frame length (@p payload_len + 6), or 0 if @p payload_len is
+ *         not 1..1023.
+ */
+int rtcm_encode_frame(unsigned char *frame, int payload_len);
+
+/**
+ * @brief Encode an MSM frame.
+ *
+ * Reads msg_type (which sets GNSS and subtype), ref_station_id,
+ * epoch_time, the header flags, sats[0..num_sats) (PRN ascending),
+ * sig_idx[0..num_sigs) (ascending) and cells[0..num_cells) in wire order
+ * (satellite-major, then signal); the masks are rebuilt from those.
+ * Raw fields the subtype does not carry are ignored.
+ *
+ * @return Frame length, or 0 if msg_type is not an MSM, a PRN or signal
+ *         is out of range, the cells are out of order, or there are more
+ *         than @ref RTCM_MSM_MAX_CELLS cell-mask bits.
+ */
+int rtcm_encode_msm(const RtcmMsmObs *obs, unsigned char frame[RTCM_FRAME_MAX]);
+
+/**
+ * @brief Set the rough range of satellite @p s of @p obs, whose
+ *        msm_subtype is set, from a range in metres.
+ *
+ * @param range_m   Rough range; <= 0 marks it invalid (DF397 = 255).
+ * @param rate_mps  Range rate in m/s (MSM5/7).
+ * @param ext_info  DF419 (GLONASS: frequency channel + 7), MSM5/7.
+ */
+void rtcm_msm_set_sat(RtcmMsmObs *obs, int s, double range_m, double rate_mps, int ext_info);
+
+/**
+ * @brief Set cell @p c of @p obs from full ranges in metres, relative to
+ *        the rough range of its satellite (set that first).
+ *
+ * A pseudorange or phase range that does not fit the fine field is sent
+ * as invalid.
+ *
+ * @param lock  Lock-time indicator, clamped to the subtype's width.
+ */
+void rtcm_msm_set_cell(RtcmMsmObs *obs, int c, double pr_m, double ph_m,
+                       double rate_mps, double cnr_dbhz, int lock);
+
+/** @brief Encode a 1005 (or 1006 when arp->msg_type is 1006) from the ECEF ARP. */
+int rtcm_encode_arp(const RtcmStationArp *arp, unsigned char frame[RTCM_FRAME_MAX]);
+
+/**
+ * @brief RTCM message type of the ephemeris of @p gnss_id: 1019, 1020,
+ *        1046 (Galileo I/NAV), 1044, 1042 or 1041; 0 for others.
+ */
+int rtcm_eph_msg_type(int gnss_id);
+
+/**
+ * @brief Encode a broadcast ephemeris.
+ *
+ * @param msg_type  1019, 1020, 1041, 1042, 1044, 1045 or 1046; 0 picks
+ *                  rtcm_eph_msg_type(eph->gnss_id).
+ * @return Frame length, or 0 if @p msg_type does not match eph->gnss_id.
+ */
+int rtcm_encode_eph(const SvEphemeris *eph, int msg_type, unsigned char frame[RTCM_FRAME_MAX]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_ENCODER_H */
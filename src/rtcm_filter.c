@@ -0,0 +1,129 @@
+/**
+ * @file rtcm_filter.c
+ * @brief Compiled RTCM message-type filter for -d / --decode.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_filter.h"
+#include "rtcm3x_parser.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Classes of types a term can name; tested against the registry. */
+typedef enum {
+    RF_CLASS_RANGE,          /* lo .. hi */
+    RF_CLASS_MSM,            /* MSM subtype lo .. hi */
+    RF_CLASS_FLAG            /* any RTCM_MSG_F_* bit in lo */
+} RfClass;
+
+static bool rf_matches(RfClass cls, int lo, int hi, int t)
+{
+    if (cls == RF_CLASS_RANGE) return t >= lo && t <= hi;
+    if (cls == RF_CLASS_MSM)   return rtcm_msg_is_msm(t, lo, hi);
+    const RtcmMsgInfo *info = rtcm_msg_info(t);
+    return info && (info->flags & (unsigned)lo);
+}
+
+static bool rf_parse_type(const char *s, int *out)
+{
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end || v < 1 || v >= RTCM_FILTER_TYPES) return false;
+    *out = (int)v;
+    return true;
+}
+
+/* Parse one term (NUL-terminated, lower case) into a class. */
+static bool rf_parse_item(char *item, RfClass *cls, int *lo, int *hi)
+{
+    if (strcmp(item, "all") == 0) {
+        *cls = RF_CLASS_RANGE; *lo = 1; *hi = RTCM_FILTER_TYPES - 1;
+        return true;
+    }
+    if (strcmp(item, "msm") == 0) {
+        *cls = RF_CLASS_MSM; *lo = 1; *hi = 7;
+        return true;
+    }
+    if (strncmp(item, "msm", 3) == 0 && item[3] >= '1' && item[3] <= '7' && !item[4]) {
+        *cls = RF_CLASS_MSM; *lo = *hi = item[3] - '0';
+        return true;
+    }
+    if (strcmp(item, "eph") == 0) {
+        *cls = RF_CLASS_FLAG; *lo = RTCM_MSG_F_EPH;
+        return true;
+    }
+    if (strcmp(item, "station") == 0) {
+        *cls = RF_CLASS_FLAG; *lo = RTCM_MSG_F_STATION;
+        return true;
+    }
+    if (strcmp(item, "obs") == 0) {
+        *cls = RF_CLASS_FLAG; *lo = RTCM_MSG_F_OBS;
+        return true;
+    }
+    *cls = RF_CLASS_RANGE;
+    char *dash = strchr(item, '-');
+    if (!dash) {
+        if (!rf_parse_type(item, lo)) return false;
+        *hi = *lo;
+        return true;
+    }
+    *dash = '\0';
+    return rf_parse_type(item, lo) && rf_parse_type(dash + 1, hi) && *lo <= *hi;
+}
+
+bool rtcm_filter_compile(RtcmFilter *f, const char *spec, char *err, size_t err_len)
+{
+    memset(f, 0, sizeof(*f));
+    if (err && err_len) err[0] = '\0';
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", spec ? spec : "");
+    for (char *p = buf; *p; p++) *p = (char)tolower((unsigned char)*p);
+
+    bool any = false;
+    for (char *p = buf; *p; ) {
+        p += strspn(p, ", ");
+        if (!*p) break;
+        char *term = p;
+        p += strcspn(p, ", ");
+        if (*p) *p++ = '\0';
+
+        char shown[64];
+        snprintf(shown, sizeof(shown), "%s", term);
+
+        long every = 1;
+        char *slash = strchr(term, '/');
+        if (slash) {
+            char *end;
+            *slash = '\0';
+            every = strtol(slash + 1, &end, 10);
+            if (end == slash + 1 || *end || every < 1 || every > 65535) {
+                if (err) snprintf(err, err_len, "bad rate in \"%s\" (expected /1../65535)", shown);
+                return false;
+            }
+        }
+        RfClass cls;
+        int lo = 0, hi = 0;
+        if (!rf_parse_item(term, &cls, &lo, &hi)) {
+            if (err) snprintf(err, err_len, "unknown filter term \"%s\"", shown);
+            return false;
+        }
+        for (int t = 1; t < RTCM_FILTER_TYPES; t++) {
+            if (!rf_matches(cls, lo, hi, t)) continue;
+            f->keep[t >> 6] |= 1ull << (t & 63);
+            f->every[t] = (uint16_t)every;
+        }
+        any = true;
+    }
+    if (!any) {
+        memset(f->keep, 0xFF, sizeof(f->keep));
+        f->all = true;
+    }
+    return true;
+}
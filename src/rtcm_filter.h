@@ -0,0 +1,101 @@
+/**
+ * @file rtcm_filter.h
+ * @brief Compiled RTCM message-type filter for -d / --decode.
+ *
+ * The -d argument used to be a list of message numbers that every frame
+ * was compared against in turn.  It is now compiled once into a
+ * 4096-bit bitmap, one bit per 12-bit message number, so accepting or
+ * rejecting a frame is one bit test on the message number read straight
+ * from the frame header, before the frame is decoded or formatted.
+ *
+ * Filter spec: terms separated by commas or spaces, each one of
+ * @code
+ *   1077            one message type
+ *   1070-1139       a range of types (inclusive)
+ *   msm             every MSM type;  msm1 .. msm7: one MSM subtype
+ *   eph             broadcast ephemerides
+ *   station         station / antenna / receiver descriptions
+ *   obs             observables (legacy RTK and MSM)
+ *   all             every type
+ * @endcode
+ * optionally followed by "/N" to keep one frame in every N of each type
+ * the term covers ("1077/10", "msm7/5").  A later term sets the rate of
+ * a type again ("msm7/10,1077" keeps every 1077).  An empty spec
+ * accepts every type.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_FILTER_H
+#define RTCM_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Number of 12-bit RTCM message numbers. */
+#define RTCM_FILTER_TYPES  4096
+
+/**
+ * @struct RtcmFilter
+ * @brief A compiled filter.
+ *
+ * Fields:
+ *   - keep:   Bit t set: type t passes.
+ *   - every:  Types with a rate: keep one frame in @c every[t] (> 1).
+ *   - count:  Frames of type t seen since the last one kept.
+ *   - all:    The spec was empty: every type passes.
+ */
+typedef struct {
+    uint64_t keep[RTCM_FILTER_TYPES / 64];
+    uint16_t every[RTCM_FILTER_TYPES];
+    uint16_t count[RTCM_FILTER_TYPES];
+    bool     all;
+} RtcmFilter;
+
+/**
+ * @brief Compile @p spec into @p f.
+ *
+ * @param spec  Filter spec (see above); NULL or "" accepts every type.
+ * @param err   [out] On failure, a message naming the bad term (may be NULL).
+ * @param err_len  Size of @p err.
+ * @return false if a term does not parse.
+ */
+bool rtcm_filter_compile(RtcmFilter *f, const char *spec, char *err, size_t err_len);
+
+/**
+ * @brief Decide whether a frame of type @p msg_type passes; advances the
+ *        decimation counter of the type.
+ */
+static inline bool rtcm_filter_accept(RtcmFilter *f, int msg_type)
+{
+    unsigned t = (unsigned)msg_type & (RTCM_FILTER_TYPES - 1);
+    if (!((f->keep[t >> 6] >> (t & 63)) & 1u)) return false;
+    unsigned n = f->every[t];
+    if (n <= 1) return true;
+    unsigned c = f->count[t];
+    f->count[t] = (uint16_t)(c + 1 >= n ? 0 : c + 1);
+    return c == 0;
+}
+
+/**
+ * @brief Message number from the header of a framed RTCM message
+ *        (0xD3 ...), or 0 if the frame has no payload.
+ */
+static inline int rtcm_filter_frame_type(const unsigned char *frame, int frame_len)
+{
+    if (frame_len < 8) return 0;
+    return ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_FILTER_H */
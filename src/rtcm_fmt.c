@@ -0,0 +1,108 @@
+/**
+ * @file rtcm_fmt.c
+ * @brief Number formatting for the decoder text output.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_fmt.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const double k_pow10[10] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+/* Sign, the digits of mag with a point before the last `decimals` of
+ * them, right-aligned in width. */
+static int fmt_emit(char *dst, bool neg, bool plus, uint64_t mag,
+                    int decimals, int width)
+{
+    char tmp[32];
+    int  n = 0;
+    do {
+        tmp[n++] = (char)('0' + mag % 10);
+        mag /= 10;
+    } while (mag || n <= decimals);
+
+    int len = n + (decimals > 0) + (neg || plus);
+    int o = 0;
+    while (o < width - len) dst[o++] = ' ';
+    if (neg)       dst[o++] = '-';
+    else if (plus) dst[o++] = '+';
+    while (n > 0) {
+        if (n == decimals) dst[o++] = '.';
+        dst[o++] = tmp[--n];
+    }
+    return o;
+}
+
+int rtcm_fmt_uint(char *dst, uint64_t v, int width, bool zero_pad)
+{
+    if (!zero_pad) return fmt_emit(dst, false, false, v, 0, width);
+
+    char tmp[24];
+    int  n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    int o = 0;
+    while (o < width - n) dst[o++] = '0';
+    while (n > 0) dst[o++] = tmp[--n];
+    return o;
+}
+
+int rtcm_fmt_int(char *dst, int64_t v, int width, bool plus)
+{
+    uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    return fmt_emit(dst, v < 0, plus, mag, 0, width);
+}
+
+int rtcm_fmt_scaled(char *dst, int64_t raw, int decimals, int width, bool plus)
+{
+    uint64_t mag = raw < 0 ? 0 - (uint64_t)raw : (uint64_t)raw;
+    return fmt_emit(dst, raw < 0, plus, mag, decimals, width);
+}
+
+int rtcm_fmt_fixed(char *dst, double v, int decimals, int width, bool plus)
+{
+    if (decimals >= 0 && decimals <= 9 && isfinite(v)) {
+        double s = fabs(v) * k_pow10[decimals];
+        if (s < 1e9) {
+            double r = floor(s);
+            double f = s - r;
+            /* Close to a tie the product may have rounded either way:
+             * leave those to printf. */
+            if (fabs(f - 0.5) > 1e-6) {
+                uint64_t mag = (uint64_t)r + (f > 0.5);
+                return fmt_emit(dst, signbit(v) != 0, plus, mag, decimals, width);
+            }
+        }
+    }
+    char fmt[16];
+    snprintf(fmt, sizeof(fmt), plus ? "%%+%d.%df" : "%%%d.%df", width, decimals);
+    char buf[352];
+    int n = snprintf(buf, sizeof(buf), fmt, v);
+    if (n < 0) return 0;
+    if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
+    memcpy(dst, buf, (size_t)n);
+    return n;
+}
+
+int rtcm_fmt_str(char *dst, const char *s, int width, bool left)
+{
+    int n = (int)strlen(s);
+    int o = 0;
+    if (!left)
+        while (o < width - n) dst[o++] = ' ';
+    memcpy(dst + o, s, (size_t)n);
+    o += n;
+    if (left)
+        while (o < width) dst[o++] = ' ';
+    return o;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file rtcm_fmt.h
+ * @brief Number formatting for the decoder text output.
+ *
+ * The decoders print thousands of numbers per second in -d mode with a
+ * multi-constellation MSM7 stream, and formatting them with vsnprintf
+ * costs more than decoding the frames.  These helpers cover the printf
+ * conversions the hot lines use, write straight into a caller buffer
+ * and give the same characters printf would:
+ * @code
+ *   rtcm_fmt_uint    %u  %4u  %02u
+ *   rtcm_fmt_int     %d  %2d  %+d
+ *   rtcm_fmt_scaled  a raw integer field with an implied decimal point,
+ *                    e.g. DF405 (0.1 mm) as "%+10.4f" of raw * 1e-4
+ *   rtcm_fmt_fixed   %.Nf  %W.Nf  %+W.Nf of a double
+ *   rtcm_fmt_str     %s  %-4s  %8s
+ * @endcode
+ * Each returns the number of characters written; nothing is
+ * NUL-terminated.  The caller provides room for the field: width plus
+ * 24 characters covers every integer and every fixed-point value below
+ * 1e12 (a double near DBL_MAX takes up to 330).
+ *
+ * rtcm_fmt_fixed() is exact for values whose scaled magnitude is below
+ * 1e9 and not within 1e-6 of a rounding tie; anything else (ties, very
+ * large values, NaN, infinity) is handed to snprintf, so the output
+ * always matches printf on the platform, tie-rounding rules included.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_FMT_H
+#define RTCM_FMT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief @p v in decimal, right-aligned in @p width, padded with '0' if @p zero_pad. */
+int rtcm_fmt_uint(char *dst, uint64_t v, int width, bool zero_pad);
+
+/** @brief @p v in decimal, right-aligned in @p width; "+" before non-negative values if @p plus. */
+int rtcm_fmt_int(char *dst, int64_t v, int width, bool plus);
+
+/**
+ * @brief @p raw / 10^@p decimals with @p decimals digits after the point,
+ *        right-aligned in @p width.
+ *
+ * The same text as printf("%+W.Nf", raw * 1e-N) (without "+" unless
+ * @p plus), computed from the integer so no rounding is involved.
+ * @p decimals is 0..9.
+ */
+int rtcm_fmt_scaled(char *dst, int64_t raw, int decimals, int width, bool plus);
+
+/** @brief printf("%W.Nf", v), or "%+W.Nf" if @p plus; @p decimals is 0..9. */
+int rtcm_fmt_fixed(char *dst, double v, int decimals, int width, bool plus);
+
+/** @brief @p s in @p width, right-aligned, or left-aligned if @p left. */
+int rtcm_fmt_str(char *dst, const char *s, int width, bool left);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_FMT_H */
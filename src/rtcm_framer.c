@@ -0,0 +1,309 @@
+/**
+ * @file rtcm_framer.c
+ * @brief Ring-buffer stream framer (RTCM 3.x, UBX, SBF) shared by all
+ *        stream loops.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_framer.h"
+#include "rtcm3x_parser.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define RING_MASK ((size_t)RTCM_FRAMER_RING_SIZE - 1)
+
+#if (RTCM_FRAMER_RING_SIZE & (RTCM_FRAMER_RING_SIZE - 1)) != 0 || \
+    RTCM_FRAMER_RING_SIZE < 2 * RTCM_FRAME_MAX
+#error "RTCM_FRAMER_RING_SIZE must be a power of two >= 2 * RTCM_FRAME_MAX"
+#endif
+#if STREAM_SNIFF_WINDOW > RTCM_FRAMER_RING_SIZE / 2
+#error "STREAM_SNIFF_WINDOW must fit in half the ring"
+#endif
+
+/* Longest UBX / SBF frame taken; a partial one must leave room to write. */
+#if STREAM_FRAME_MAX < RTCM_FRAMER_RING_SIZE / 2
+#define OTHER_FRAME_MAX ((size_t)STREAM_FRAME_MAX)
+#else
+#define OTHER_FRAME_MAX ((size_t)RTCM_FRAMER_RING_SIZE / 2)
+#endif
+
+void rtcm_framer_init(RtcmFramer *f, RtcmFrameFn on_frame, void *user)
+{
+    f->rd            = 0;
+    f->wr            = 0;
+    f->on_frame      = on_frame;
+    f->user          = user;
+    f->in_sync       = 0;
+    f->format        = STREAM_FMT_NONE;
+    f->sniffing      = 1;
+    f->format_news   = 0;
+    stream_sniff_reset(&f->sniff);
+    f->frames        = 0;
+    f->crc_errors    = 0;
+    f->skipped_bytes = 0;
+    f->resyncs       = 0;
+    f->anomalies     = NULL;
+}
+
+void rtcm_framer_reset(RtcmFramer *f)
+{
+    f->rd = f->wr = 0;
+    f->in_sync  = 0;
+    f->sniffing = 1;
+    stream_sniff_reset(&f->sniff);
+    if (f->anomalies) f->anomalies->lost = false;
+}
+
+unsigned char *rtcm_framer_write_ptr(RtcmFramer *f, size_t *avail)
+{
+    size_t off        = f->wr & RING_MASK;
+    size_t free_bytes = RTCM_FRAMER_RING_SIZE - (f->wr - f->rd);
+    size_t contig     = RTCM_FRAMER_RING_SIZE - off;
+
+    /* The drain loop never leaves more than one partial frame or one
+     * sniffing window behind, so at least half the ring is free. */
+    *avail = contig < free_bytes ? contig : free_bytes;
+    return f->ring + off;
+}
+
+/* Copy @p n ring bytes from free-running index @p at to @p dst. */
+static void framer_copy_out(const RtcmFramer *f, size_t at, size_t n, unsigned char *dst)
+{
+    size_t off   = at & RING_MASK;
+    size_t first = RTCM_FRAMER_RING_SIZE - off;
+    if (first > n) first = n;
+    memcpy(dst, f->ring + off, first);
+    memcpy(dst + first, f->ring, n - first);
+}
+
+/* Keep an anomaly at rd in the ring: the consumed bytes before it that
+ * are not yet overwritten, and what is buffered from it on. */
+static void framer_anomaly(RtcmFramer *f, AnomalyKind kind, size_t frame_len,
+                           uint32_t crc_calc, uint32_t crc_recv)
+{
+    AnomalyRing *r = f->anomalies;
+    size_t fill   = f->wr - f->rd;
+    size_t before = RTCM_FRAMER_RING_SIZE - fill;
+    if (before > f->rd) before = f->rd;
+    if (before > ANOMALY_BYTES_BEFORE) before = ANOMALY_BYTES_BEFORE;
+    size_t after = fill < ANOMALY_BYTES_AFTER ? fill : ANOMALY_BYTES_AFTER;
+
+    AnomalyEvent *e = anomaly_ring_begin(r);
+    e->offset        = f->rd;
+    e->kind          = (uint32_t)kind;
+    e->format        = (uint32_t)f->format;
+    e->frame_len     = (uint32_t)frame_len;
+    e->crc_calc      = crc_calc;
+    e->crc_recv      = crc_recv;
+    e->fill          = (uint32_t)fill;
+    e->skipped       = kind == ANOMALY_RESYNCED ? f->skipped_bytes - r->lost_skipped : 0;
+    e->frames        = f->frames;
+    e->crc_errors    = f->crc_errors;
+    e->skipped_bytes = f->skipped_bytes;
+    e->resyncs       = f->resyncs;
+    e->n_before      = (uint16_t)before;
+    e->n_after       = (uint16_t)after;
+    framer_copy_out(f, f->rd - before, before + after, e->bytes);
+    anomaly_ring_commit(r);
+
+    r->lost         = kind != ANOMALY_RESYNCED;
+    r->lost_skipped = f->skipped_bytes;
+}
+
+/* A frame checked out at rd; the first after a recorded loss ends it. */
+static void framer_good(RtcmFramer *f, size_t frame_len)
+{
+    if (f->anomalies && f->anomalies->lost)
+        framer_anomaly(f, ANOMALY_RESYNCED, frame_len, 0, 0);
+    f->in_sync = 1;
+    f->frames++;
+}
+
+/* Sync is about to be lost at rd (a frame was expected there). */
+static void framer_lose(RtcmFramer *f, AnomalyKind kind, size_t frame_len,
+                        uint32_t crc_calc, uint32_t crc_recv)
+{
+    if (f->in_sync && f->anomalies)
+        framer_anomaly(f, kind, frame_len, crc_calc, crc_recv);
+}
+
+/* Drop @p n bytes that are not part of a delivered frame. */
+static void framer_skip(RtcmFramer *f, size_t n)
+{
+    if (f->in_sync) {
+        f->in_sync = 0;
+        f->resyncs++;
+    }
+    f->rd            += n;
+    f->skipped_bytes += n;
+}
+
+/* Settle the format of the bytes from rd: true once it is one with a
+ * framer.  The window is what is contiguous from rd, mirror included. */
+static bool framer_sniff(RtcmFramer *f)
+{
+    for (;;) {
+        size_t off  = f->rd & RING_MASK;
+        size_t fill = f->wr - f->rd;
+        size_t span = RTCM_FRAMER_RING_SIZE + RTCM_FRAME_MAX - off;
+        if (span > fill) span = fill;
+        if (span > STREAM_SNIFF_WINDOW) span = STREAM_SNIFF_WINDOW;
+        bool final = span == STREAM_SNIFF_WINDOW || span < fill;
+
+        StreamFormat fmt = stream_sniff_feed(&f->sniff, f->ring + off, span, final);
+        if (fmt == STREAM_FMT_NONE) return false;
+        if (fmt != f->format) {
+            f->format      = fmt;
+            f->format_news = 1;
+        }
+        stream_sniff_reset(&f->sniff);
+        if (fmt != STREAM_FMT_UNKNOWN) {
+            f->sniffing = 0;
+            return true;
+        }
+        /* Nothing in the window: drop it but for a tail that may hold the
+         * start of a frame, and look again. */
+        framer_skip(f, span - span / 4);
+    }
+}
+
+/* Frame a format without a decoder through its StreamFramerOps: check and
+ * count its frames, skip everything else.  A frame may wrap around the
+ * ring past the mirror; the checksum is then taken in two pieces. */
+static void framer_drain_other(RtcmFramer *f, const StreamFramerOps *ops)
+{
+    while (f->wr - f->rd >= ops->header_len) {
+        size_t off = f->rd & RING_MASK;
+        const unsigned char *p = f->ring + off;
+
+        if (p[0] != ops->sync) {
+            size_t span = f->wr - f->rd;
+            if (span > RTCM_FRAMER_RING_SIZE - off)
+                span = RTCM_FRAMER_RING_SIZE - off;
+            const unsigned char *hit = memchr(p, ops->sync, span);
+            framer_lose(f, ANOMALY_SYNC_LOST, 0, 0, 0);
+            framer_skip(f, hit ? (size_t)(hit - p) : span);
+            continue;
+        }
+        size_t frame_len = ops->frame_len(p);
+        if (frame_len == 0 || frame_len > OTHER_FRAME_MAX) {
+            framer_lose(f, ANOMALY_SYNC_LOST, frame_len, 0, 0);
+            framer_skip(f, 1);
+            continue;
+        }
+        if (f->wr - f->rd < frame_len) break;
+
+        size_t na = RTCM_FRAMER_RING_SIZE + RTCM_FRAME_MAX - off;
+        if (na > frame_len) na = frame_len;
+        if (!ops->check(p, na, f->ring + RTCM_FRAME_MAX, frame_len)) {
+            f->crc_errors++;
+            framer_lose(f, ANOMALY_CRC, frame_len, 0, 0);
+            framer_skip(f, 1);
+            continue;
+        }
+        framer_good(f, frame_len);
+        f->rd += frame_len;
+    }
+}
+
+/* Deliver every complete RTCM 3.x frame between rd and wr.  A frame at
+ * ring offset o occupies ring[o .. o + len), which may run into the mirror
+ * tail; the mirror holds a copy of ring[0 .. RTCM_FRAME_MAX).
+ *
+ * While in sync the next frame starts exactly where the previous one
+ * ended.  Anything else (stray bytes, a non-zero reserved field, a CRC
+ * failure) drops into resync: memchr() jumps to the next 0xD3 candidate
+ * in the contiguous part of the ring, and a candidate is only consumed
+ * once its reserved bits and CRC check out. */
+static void framer_drain(RtcmFramer *f)
+{
+    if (f->sniffing && !framer_sniff(f)) return;
+    if (f->format != STREAM_FMT_RTCM3) {
+        framer_drain_other(f, stream_framer_ops(f->format));
+        return;
+    }
+
+    while (f->wr - f->rd >= 6) {
+        size_t off = f->rd & RING_MASK;
+        const unsigned char *p = f->ring + off;
+
+        if (p[0] != 0xD3) {
+            size_t span = f->wr - f->rd;
+            if (span > RTCM_FRAMER_RING_SIZE - off)
+                span = RTCM_FRAMER_RING_SIZE - off;
+            const unsigned char *hit = memchr(p, 0xD3, span);
+            framer_lose(f, ANOMALY_SYNC_LOST, 0, 0, 0);
+            framer_skip(f, hit ? (size_t)(hit - p) : span);
+            continue;
+        }
+
+        /* The six bits between the preamble and the length are reserved
+         * and always zero in RTCM 3.x. */
+        if (p[1] & 0xFC) {
+            framer_lose(f, ANOMALY_SYNC_LOST, 0, 0, 0);
+            framer_skip(f, 1);
+            continue;
+        }
+
+        size_t payload_len = ((size_t)(p[1] & 0x03) << 8) | p[2];
+        size_t frame_len   = payload_len + 6;
+        if (f->wr - f->rd < frame_len) break;
+
+        uint32_t crc_calc = crc24q(p, payload_len + 3);
+        uint32_t crc_recv = ((uint32_t)p[payload_len + 3] << 16) |
+                            ((uint32_t)p[payload_len + 4] << 8)  |
+                             (uint32_t)p[payload_len + 5];
+        if (crc_calc != crc_recv) {
+            /* Not a frame (or a damaged one): step past this preamble
+             * candidate and look for the next one inside it. */
+            f->crc_errors++;
+            framer_lose(f, ANOMALY_CRC, frame_len, crc_calc, crc_recv);
+            framer_skip(f, 1);
+            continue;
+        }
+
+        framer_good(f, frame_len);
+        if (f->on_frame)
+            f->on_frame(p, (int)frame_len, f->user);
+        f->rd += frame_len;
+    }
+}
+
+void rtcm_framer_commit(RtcmFramer *f, size_t n)
+{
+    size_t off = f->wr & RING_MASK;
+
+    if (off < RTCM_FRAME_MAX) {
+        size_t m = RTCM_FRAME_MAX - off;
+        if (m > n) m = n;
+        memcpy(f->ring + RTCM_FRAMER_RING_SIZE + off, f->ring + off, m);
+    }
+    f->wr += n;
+    framer_drain(f);
+}
+
+StreamFormat rtcm_framer_new_format(RtcmFramer *f)
+{
+    if (!f->format_news) return STREAM_FMT_NONE;
+    f->format_news = 0;
+    return f->format;
+}
+
+void rtcm_framer_push(RtcmFramer *f, const void *data, size_t len)
+{
+    const unsigned char *src = (const unsigned char *)data;
+
+    while (len > 0) {
+        size_t avail;
+        unsigned char *dst = rtcm_framer_write_ptr(f, &avail);
+        size_t n = len < avail ? len : avail;
+        memcpy(dst, src, n);
+        rtcm_framer_commit(f, n);
+        src += n;
+        len -= n;
+    }
+}
@@ -0,0 +1,167 @@
+/**
+ * @file rtcm_framer.h
+ * @brief Ring-buffer stream framer (RTCM 3.x, UBX, SBF) shared by all
+ *        stream loops.
+ *
+ * Every stream loop (CLI decode/filter/statistics/satellite/ephemeris
+ * modes, the sky stdin and observation streams, and the GUI stream and
+ * replay workers) used to keep its own linear message buffer and shift it
+ * with memmove() after every frame and, on resync, after every single
+ * byte.  @ref RtcmFramer replaces those loops with one implementation:
+ *
+ *   - Received bytes go into a power-of-two ring.  The first
+ *     @ref RTCM_FRAME_MAX bytes of the ring are mirrored past its end, so a
+ *     frame that wraps around the ring is still contiguous in memory.
+ *   - Each complete frame whose CRC-24Q checks out is handed to the
+ *     @c on_frame callback as a pointer into the ring.  No frame is ever
+ *     copied or shifted; consuming a frame only advances a read index.
+ *   - When sync is lost the framer scans for the next preamble with
+ *     memchr(), rejects candidates whose reserved bits are set, and only
+ *     consumes a candidate once its CRC confirms it.  Every byte dropped
+ *     on the way is counted in @c skipped_bytes.
+ *   - A new stream (or one after rtcm_framer_reset()) is sniffed first
+ *     (stream_format.h): the bytes wait in the ring until the format is
+ *     known -- one good RTCM frame, or @ref STREAM_SNIFF_WINDOW bytes
+ *     without one -- and the framer then frames that format only.  UBX or
+ *     SBF frames up to half the ring long are checked and counted but not
+ *     handed to @c on_frame, which only ever sees RTCM 3.x.  A stream of
+ *     neither is dropped a window at a time and sniffed again, instead of
+ *     being resynced on every 0xD3 byte in it.
+ *   - Callers can receive straight into the ring with
+ *     rtcm_framer_write_ptr() / rtcm_framer_commit(), or copy a chunk in
+ *     with rtcm_framer_push().
+ *
+ * The frame pointer passed to a callback is valid only for the duration
+ * of that callback.  The callback must not push into the framer that
+ * is calling it.
+ *
+ * Project: NTRIP RTCM 3.x Stream Analyzer
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause (see LICENSE for details)
+ */
+
+#ifndef RTCM_FRAMER_H
+#define RTCM_FRAMER_H
+
+#include <stddef.h>
+
+#include "anomaly_ring.h"
+#include "stream_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Largest possible RTCM 3.x frame: 3 header + 1023 payload + 3 CRC. */
+#define RTCM_FRAME_MAX (3 + 1023 + 3)
+
+/** @brief Ring capacity in bytes.  Must be a power of two >= 2 * RTCM_FRAME_MAX. */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define RTCM_FRAMER_RING_SIZE 4096
+#else
+#define RTCM_FRAMER_RING_SIZE 8192
+#endif
+
+/**
+ * @brief Frame callback.
+ *
+ * @param frame      Complete frame, starting at the 0xD3 preamble and
+ *                   including the 3-byte CRC.
+ * @param frame_len  Frame length in bytes (payload length + 6).
+ * @param user       Opaque pointer given to rtcm_framer_init().
+ */
+typedef void (*RtcmFrameFn)(const unsigned char *frame, int frame_len, void *user);
+
+/**
+ * @brief Framer state.
+ *
+ * Fields:
+ *   - ring:          Ring storage plus the RTCM_FRAME_MAX mirror tail.
+ *   - rd, wr:        Free-running read / write indices (wr - rd = fill).
+ *   - on_frame:      Called for every CRC-valid RTCM 3.x frame.
+ *   - user:          Passed through to the callback.
+ *   - in_sync:       Non-zero while frames arrive back to back.
+ *   - format:        Format of the stream, STREAM_FMT_NONE until sniffed.
+ *   - sniffing:      Non-zero until the format of the current
+ *                    connection is known (format keeps the last one).
+ *   - format_news:   format changed since rtcm_framer_new_format().
+ *   - frames:        Number of checksum-valid frames (of any format).
+ *   - crc_errors:    Number of sync candidates rejected on checksum.
+ *   - skipped_bytes: Bytes discarded while (re)synchronising.
+ *   - resyncs:       Number of times sync was lost after a good frame.
+ *   - anomalies:     Where each loss of sync and the frame that ends it
+ *                    are kept (anomaly_ring.h); NULL = nowhere.  Set
+ *                    after rtcm_framer_init(), kept by rtcm_framer_reset().
+ */
+typedef struct {
+    unsigned char ring[RTCM_FRAMER_RING_SIZE + RTCM_FRAME_MAX];
+    size_t        rd;
+    size_t        wr;
+    RtcmFrameFn   on_frame;
+    void         *user;
+    int           in_sync;
+    StreamFormat  format;
+    int           sniffing;
+    int           format_news;
+    StreamSniffer sniff;
+    unsigned long frames;
+    unsigned long crc_errors;
+    unsigned long skipped_bytes;
+    unsigned long resyncs;
+    AnomalyRing  *anomalies;
+} RtcmFramer;
+
+/**
+ * @brief Initialise a framer.
+ *
+ * @param f         Framer to initialise.
+ * @param on_frame  Callback for each CRC-valid frame.
+ * @param user      Opaque pointer passed to @p on_frame.
+ */
+void rtcm_framer_init(RtcmFramer *f, RtcmFrameFn on_frame, void *user);
+
+/**
+ * @brief Drop all buffered bytes and sync (e.g. after a reconnect) and
+ *        sniff the format again; counters are kept.
+ */
+void rtcm_framer_reset(RtcmFramer *f);
+
+/**
+ * @brief Get the contiguous free space at the write end of the ring.
+ *
+ * Lets a caller recv()/fread() directly into the framer.  Follow with
+ * rtcm_framer_commit() for the number of bytes actually written.
+ *
+ * @param f      Framer.
+ * @param avail  Receives the number of bytes that may be written (> 0).
+ * @return Write pointer into the ring.
+ */
+unsigned char *rtcm_framer_write_ptr(RtcmFramer *f, size_t *avail);
+
+/**
+ * @brief Commit @p n bytes written at rtcm_framer_write_ptr() and deliver
+ *        every frame that is now complete.
+ */
+void rtcm_framer_commit(RtcmFramer *f, size_t n);
+
+/**
+ * @brief Copy @p len bytes into the framer and deliver complete frames.
+ *
+ * @param f     Framer.
+ * @param data  Input bytes.
+ * @param len   Number of input bytes.
+ */
+void rtcm_framer_push(RtcmFramer *f, const void *data, size_t len);
+
+/**
+ * @brief The stream format, if it changed since the last call.
+ * @return The new format (STREAM_FMT_UNKNOWN while a window held no
+ *         frame), STREAM_FMT_NONE if nothing changed.
+ */
+StreamFormat rtcm_framer_new_format(RtcmFramer *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_FRAMER_H */
@@ -0,0 +1,712 @@
+/**
+ * @file rtcm_gen.c
+ * @brief Synthetic RTCM 3 stream generator (see rtcm_gen.h).
+ *
+ * Time is kept as GPS milliseconds since the GPS epoch, so stream time
+ * never wraps; week / ToW and the GLONASS Moscow day are derived from it
+ * where a message or the propagator needs them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include "rtcm_gen.h"
+#include "rtcm_encoder.h"
+#include "sv_ephemeris.h"
+#include "sv_orbit.h"
+#include "stream_clock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define GEN_GPS_EPOCH_UNIX  315964800LL
+#define GEN_WEEK_MS         604800000LL
+#define GEN_OMEGA_E         7.2921151467e-5     /* rad/s */
+#define GEN_MU              3.986004418e14      /* m^3/s^2 */
+#define GEN_DEG             (M_PI / 180.0)
+#define GEN_MIN_ELEV_DEG    5.0
+#define GEN_KEPLER_PERIOD_S 7200                /* synthetic ephemeris renewal */
+#define GEN_GLO_PERIOD_S    1800
+#define GEN_MAX_GNSS        8
+#define GEN_MAX_SIGS        3
+
+/* MSM message number of subtype 0 per gnss_id (SBAS, 6, is not generated) */
+static const int k_msm_base[GEN_MAX_GNSS] = { 0, 1070, 1080, 1090, 1110, 1120, 0, 1130 };
+
+/* Signals sent per constellation, as sig_idx (0-based mask position):
+ * GPS L1C L2L L5Q, GLONASS G1C G2C, Galileo E1C E7Q E5aQ, QZSS L1C L2L
+ * L5Q, BeiDou B1I B3I B2I, NavIC L5A. */
+static const int k_sigs[GEN_MAX_GNSS][GEN_MAX_SIGS + 1] = {
+    { 0 },
+    { 3, 1, 15, 22 },
+    { 2, 1, 8 },
+    { 3, 1, 15, 22 },
+    { 3, 1, 14, 22 },
+    { 3, 1, 8, 13 },
+    { 0 },
+    { 1, 21 },
+};
+
+/* GLONASS frequency channel of slots 1..24 */
+static const int k_glo_chan[24] = {
+     1, -4,  5,  6,  1, -4,  5,  6, -2, -7,  0, -1,
+    -2, -7,  0, -1,  4, -3,  3,  2,  4, -3,  3,  2
+};
+
+/* ── Synthetic constellations ─────────────────────────────────────── */
+
+typedef struct {
+    int    gnss, prn;
+    double a, e, inc, raan, argp, m_ref;  /* m_ref: mean anomaly at the GPS epoch */
+    double lon0;                          /* geosynchronous: centre longitude */
+    bool   geosync;
+    int    glo_chan;
+} SynthSat;
+
+typedef struct {
+    int    gnss, planes, per_plane, prn0;
+    double a_km, inc_deg;
+} WalkerShell;
+
+static const WalkerShell k_shells[] = {
+    { 1, 6, 4,  1, 26559.7, 55.0 },     /* GPS */
+    { 2, 3, 8,  1, 25508.0, 64.8 },     /* GLONASS */
+    { 3, 3, 8,  1, 29599.8, 56.0 },     /* Galileo */
+    { 5, 3, 8, 19, 27906.1, 55.0 },     /* BeiDou-3 MEO */
+};
+
+typedef struct {
+    int    gnss, prn;
+    double lon0_deg, inc_deg, e, raan_deg;
+} GeoSat;
+
+static const GeoSat k_geo[] = {
+    { 4, 1, 135.0, 41.0, 0.075,   0.0 },    /* QZSS IGSO */
+    { 4, 2, 135.0, 41.0, 0.075, 120.0 },
+    { 4, 3, 135.0, 41.0, 0.075, 240.0 },
+    { 4, 7, 127.0,  0.1, 0.0,     0.0 },    /* QZSS GEO */
+    { 7, 1,  55.0, 29.0, 0.002,   0.0 },    /* NavIC IGSO */
+    { 7, 2,  55.0, 29.0, 0.002, 180.0 },
+    { 7, 3,  83.0,  0.1, 0.0,     0.0 },    /* NavIC GEO */
+    { 7, 4, 111.75, 29.0, 0.002,  0.0 },
+    { 7, 5, 111.75, 29.0, 0.002, 180.0 },
+    { 7, 6,  32.5,  0.1, 0.0,     0.0 },
+    { 7, 7, 131.5,  0.1, 0.0,     0.0 },
+};
+
+/* ── Generator state ──────────────────────────────────────────────── */
+
+typedef struct {
+    double  prev_rho, prev_t;       /* previous epoch, for the range rate */
+    int64_t rise_ms;                /* -1 = not tracked */
+    double  amb[GEN_MAX_SIGS];      /* phase offset per signal, metres */
+} TrackState;
+
+typedef struct {
+    const RtcmGenConfig *cfg;
+    RtcmGenSink          sink;
+    void                *user;
+    RtcmGenStats        *st;
+    uint64_t             rng;
+    bool                 sink_closed;
+
+    StationFrame         sta;
+    bool                 synthetic[GEN_MAX_GNSS];
+    SynthSat            *synth;
+    int                  n_synth;
+    int64_t              renew_ms[GEN_MAX_GNSS];   /* next synthetic renewal */
+    TrackState           track[GEN_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+    bool                 in_view[GEN_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+    RtcmMsmObs           obs[GEN_MAX_GNSS];
+} GenCtx;
+
+static uint64_t gen_rand(GenCtx *g)
+{
+    /* xorshift64* */
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    return g->rng * 2685821657736338717ull;
+}
+
+static double gen_uniform(GenCtx *g)
+{
+    return (double)(gen_rand(g) >> 11) / 9007199254740992.0;
+}
+
+static double gen_gauss(GenCtx *g, double sigma)
+{
+    double u = gen_uniform(g), v = gen_uniform(g);
+    if (u < 1e-300) u = 1e-300;
+    return sigma * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/* Angle in [-pi, pi), as the ephemeris fields are sent */
+static double wrap_pi(double a)
+{
+    a = fmod(a + M_PI, 2.0 * M_PI);
+    return (a < 0.0 ? a + 2.0 * M_PI : a) - M_PI;
+}
+
+static int gen_leap(int64_t gps_ms)
+{
+    return stream_clock_leap_seconds(gps_ms / 1000 + GEN_GPS_EPOCH_UNIX);
+}
+
+/* Moscow seconds of day and day of week (0 = Sunday) at GPS time @p t_ms */
+static double gen_glo_tod(int64_t t_ms, int *dow)
+{
+    int64_t msk_ms = t_ms - (int64_t)gen_leap(t_ms) * 1000 +
+                     GEN_GPS_EPOCH_UNIX * 1000 + 10800000LL;
+    int64_t day = msk_ms / 86400000LL;
+    if (dow) *dow = (int)((day + 4) % 7);           /* 1970-01-01 was a Thursday */
+    return (double)(msk_ms % 86400000LL) / 1000.0;
+}
+
+static void gen_sleep(double s)
+{
+    if (s <= 0.0) return;
+#ifdef _WIN32
+    Sleep((DWORD)(s * 1000.0));
+#else
+    struct timespec ts;
+    ts.tv_sec  = (time_t)s;
+    ts.tv_nsec = (long)((s - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void synth_build(GenCtx *g)
+{
+    int cap = 0;
+    for (size_t i = 0; i < sizeof(k_shells) / sizeof(k_shells[0]); i++)
+        cap += k_shells[i].planes * k_shells[i].per_plane;
+    cap += (int)(sizeof(k_geo) / sizeof(k_geo[0]));
+    g->synth = (SynthSat *)calloc((size_t)cap, sizeof(SynthSat));
+    if (!g->synth) return;
+
+    for (size_t i = 0; i < sizeof(k_shells) / sizeof(k_shells[0]); i++) {
+        const WalkerShell *w = &k_shells[i];
+        if (!g->synthetic[w->gnss]) continue;
+        int total = w->planes * w->per_plane;
+        for (int p = 0; p < w->planes; p++) {
+            for (int k = 0; k < w->per_plane; k++) {
+                SynthSat *s = &g->synth[g->n_synth++];
+                int slot = p * w->per_plane + k;
+                s->gnss  = w->gnss;
+                s->prn   = w->prn0 + slot;
+                s->a     = w->a_km * 1000.0;
+                s->e     = 0.002 + 0.008 * gen_uniform(g);
+                s->inc   = w->inc_deg * GEN_DEG;
+                s->raan  = 2.0 * M_PI * p / w->planes;
+                s->argp  = 2.0 * M_PI * gen_uniform(g);
+                /* Walker phasing factor 1 */
+                s->m_ref = 2.0 * M_PI * ((double)k / w->per_plane + (double)p / total) - s->argp;
+                s->glo_chan = w->gnss == 2 ? k_glo_chan[slot % 24] : 0;
+            }
+        }
+    }
+    for (size_t i = 0; i < sizeof(k_geo) / sizeof(k_geo[0]); i++) {
+        const GeoSat *q = &k_geo[i];
+        if (!g->synthetic[q->gnss]) continue;
+        SynthSat *s = &g->synth[g->n_synth++];
+        s->gnss    = q->gnss;
+        s->prn     = q->prn;
+        s->a       = 42164.17e3;
+        s->e       = q->e;
+        s->inc     = q->inc_deg * GEN_DEG;
+        s->raan    = q->raan_deg * GEN_DEG;
+        s->argp    = q->e > 0.01 ? 270.0 * GEN_DEG : 0.0;
+        s->lon0    = q->lon0_deg * GEN_DEG;
+        s->geosync = true;
+    }
+}
+
+/* Keplerian broadcast ephemeris of @p s with toe at GPS time @p toe_ms. */
+static void synth_kepler(const SynthSat *s, int64_t toe_ms, SvEphemeris *e)
+{
+    const int64_t week = toe_ms / GEN_WEEK_MS;
+    const double  toe  = (double)(toe_ms % GEN_WEEK_MS) / 1000.0;
+    const double  t    = (double)toe_ms / 1000.0;
+    const double  n    = sqrt(GEN_MU / (s->a * s->a * s->a));
+    const double  omega_dot = s->geosync ? 0.0 : -8.0e-9;
+
+    memset(e, 0, sizeof(*e));
+    e->gnss_id   = s->gnss;
+    e->prn       = s->prn;
+    e->toe       = e->toc = toe;
+    e->week      = (int)(s->gnss == 3 || s->gnss == 7 ? week - 1024 :
+                         s->gnss == 5 ? week - 1356 : week);
+    e->iode_iodnav = (int)((toe_ms / 1000 / GEN_KEPLER_PERIOD_S) % 256);
+    e->sqrt_a    = sqrt(s->a);
+    e->e         = s->e;
+    e->i0        = s->inc;
+    e->omega     = wrap_pi(s->argp);
+    e->omega_dot = omega_dot;
+    /* Omega0 is the node at toe counted from Greenwich at the start of
+     * the week, which turns by OMEGA_E * 604800 from week to week. */
+    e->omega0    = wrap_pi(s->raan + omega_dot * t - GEN_OMEGA_E * 604800.0 * (double)week);
+    if (s->geosync)     /* keep the mean longitude at lon0 */
+        e->m0 = wrap_pi(s->lon0 - (e->omega0 + s->argp) + GEN_OMEGA_E * toe);
+    else
+        e->m0 = wrap_pi(s->m_ref + n * t);
+    e->valid = true;
+}
+
+/* GLONASS state-vector ephemeris of @p s with tb at GPS time @p tb_ms:
+ * the ECEF state of the Keplerian orbit at tb. */
+static void synth_glonass(const SynthSat *s, int64_t tb_ms, SvEphemeris *e)
+{
+    SvEphemeris k;
+    synth_kepler(s, tb_ms, &k);
+    k.gnss_id = 1;                      /* propagate with the GPS model */
+    const double tow = k.toe;
+    double p0[3], p1[3], p2[3];
+    kepler_to_ecef(&k, 0, tow,       &p0[0], &p0[1], &p0[2]);
+    kepler_to_ecef(&k, 0, tow - 0.5, &p1[0], &p1[1], &p1[2]);
+    kepler_to_ecef(&k, 0, tow + 0.5, &p2[0], &p2[1], &p2[2]);
+
+    memset(e, 0, sizeof(*e));
+    e->gnss_id       = 2;
+    e->prn           = s->prn;
+    e->glo_tb_sod    = gen_glo_tod(tb_ms, NULL);
+    e->toe = e->toc  = e->glo_tb_sod;
+    e->iode_iodnav   = (int)(e->glo_tb_sod / 900.0);
+    e->glo_freq_chan = s->glo_chan;
+    for (int i = 0; i < 3; i++) {
+        e->glo_pos[i] = p0[i];
+        e->glo_vel[i] = p2[i] - p1[i];
+    }
+    e->valid = true;
+}
+
+/* Renew the synthetic ephemerides of @p gnss for GPS time @p t_ms. */
+static void synth_renew(GenCtx *g, int gnss, int64_t t_ms)
+{
+    const int64_t period = (gnss == 2 ? GEN_GLO_PERIOD_S : GEN_KEPLER_PERIOD_S) * 1000LL;
+    int64_t toe_ms;
+    if (gnss == 2) {        /* tb on the Moscow half hour */
+        double tod = gen_glo_tod(t_ms, NULL);
+        toe_ms = t_ms - (int64_t)(fmod(tod, (double)GEN_GLO_PERIOD_S) * 1000.0);
+    } else {
+        toe_ms = t_ms - t_ms % period;
+    }
+    for (int i = 0; i < g->n_synth; i++) {
+        const SynthSat *s = &g->synth[i];
+        if (s->gnss != gnss) continue;
+        SvEphemeris e;
+        if (gnss == 2) synth_glonass(s, toe_ms, &e);
+        else           synth_kepler(s, toe_ms, &e);
+        sv_eph_store(&e);
+    }
+    g->renew_ms[gnss] = toe_ms + period;
+}
+
+/* ── Output ───────────────────────────────────────────────────────── */
+
+/* Hand one encoded frame to the sink, with the configured errors. */
+static void gen_emit(GenCtx *g, unsigned char *frame, int len)
+{
+    const RtcmGenConfig *c = g->cfg;
+    RtcmGenStats *st = g->st;
+    if (len <= 0 || g->sink_closed) return;
+    st->frames++;
+
+    if (c->p_drop > 0.0 && gen_uniform(g) < c->p_drop) {
+        st->dropped++;
+        return;
+    }
+    unsigned char buf[64 + RTCM_FRAME_MAX];
+    int n = 0;
+    if (c->p_junk > 0.0 && gen_uniform(g) < c->p_junk) {
+        int junk = 1 + (int)(gen_rand(g) % 64);
+        for (int i = 0; i < junk; i++) buf[n++] = (unsigned char)gen_rand(g);
+        st->junk++;
+    }
+    memcpy(buf + n, frame, (size_t)len);
+    if (c->p_crc > 0.0 && gen_uniform(g) < c->p_crc) {
+        int bit = 24 + (int)(gen_rand(g) % (uint64_t)((len - 3) * 8));
+        buf[n + bit / 8] ^= (unsigned char)(0x80u >> (bit % 8));
+        st->corrupted++;
+    }
+    if (c->p_cut > 0.0 && gen_uniform(g) < c->p_cut) {
+        len = 1 + (int)(gen_rand(g) % (uint64_t)(len - 1));
+        st->cut++;
+    }
+    n += len;
+    if (!g->sink(buf, n, g->user)) {
+        g->sink_closed = true;
+        return;
+    }
+    st->bytes += (unsigned long long)n;
+}
+
+static void gen_arp(GenCtx *g)
+{
+    RtcmStationArp arp;
+    memset(&arp, 0, sizeof(arp));
+    arp.msg_type       = 1006;
+    arp.ref_station_id = g->cfg->station_id;
+    arp.gps_ind = arp.glo_ind = arp.gal_ind = 1;
+    arp.x = g->sta.x;
+    arp.y = g->sta.y;
+    arp.z = g->sta.z;
+    unsigned char frame[RTCM_FRAME_MAX];
+    gen_emit(g, frame, rtcm_encode_arp(&arp, frame));
+    g->st->arp++;
+}
+
+/* Ephemerides of the satellites in view. */
+static void gen_ephemerides(GenCtx *g, int64_t t_ms)
+{
+    const int week = (int)(t_ms / GEN_WEEK_MS);
+    const double tow = (double)(t_ms % GEN_WEEK_MS) / 1000.0;
+    const double tod = gen_glo_tod(t_ms, NULL);
+    unsigned char frame[RTCM_FRAME_MAX];
+    for (int gn = 1; gn < GEN_MAX_GNSS; gn++) {
+        if (!(g->cfg->gnss_mask & RTCM_GEN_GNSS(gn))) continue;
+        for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS; prn++) {
+            if (!g->in_view[gn][prn - 1]) continue;
+            const SvEphemeris *e = sv_eph_get_at(gn, prn, week, gn == 2 ? tod : tow);
+            if (!e) continue;
+            gen_emit(g, frame, rtcm_encode_eph(e, 0, frame));
+            g->st->eph++;
+        }
+    }
+}
+
+/* DF402 (MSM4/5) or DF407 (MSM7) lock-time indicator for @p ms of lock. */
+static int gen_lock_indicator(int64_t ms, int subtype)
+{
+    if (ms < 0) return 0;
+    if (subtype == 7) {
+        if (ms < 64) return (int)ms;
+        for (int k = 1; k <= 20; k++)
+            if (ms < (64LL << k))
+                return (int)((ms + 64LL * k * (1LL << (k - 1))) >> k);
+        return 704;
+    }
+    int i = 0;
+    while (i < 15 && ms >= (32LL << i)) i++;
+    return i;
+}
+
+/* Observations of constellation @p gn at GPS time @p t_ms into @p obs;
+ * false when nothing is in view. */
+static bool gen_msm(GenCtx *g, int gn, int64_t t_ms, RtcmMsmObs *obs)
+{
+    const RtcmGenConfig *c = g->cfg;
+    const int week = (int)(t_ms / GEN_WEEK_MS);
+    const double tow = (double)(t_ms % GEN_WEEK_MS) / 1000.0;
+    const double t = (double)t_ms / 1000.0;
+    int dow;
+    const double tod = gen_glo_tod(t_ms, &dow);
+
+    memset(obs, 0, sizeof(*obs));
+    obs->msg_type       = k_msm_base[gn] + c->msm_subtype;
+    obs->gnss_id        = gn;
+    obs->msm_subtype    = c->msm_subtype;
+    obs->ref_station_id = (uint16_t)c->station_id;
+    if (gn == 2)
+        obs->epoch_time = ((uint32_t)dow << 27) | (uint32_t)llround(tod * 1000.0);
+    else if (gn == 5)   /* BDT = GPS - 14 s */
+        obs->epoch_time = (uint32_t)(((t_ms - 14000) % GEN_WEEK_MS + GEN_WEEK_MS) % GEN_WEEK_MS);
+    else
+        obs->epoch_time = (uint32_t)(t_ms % GEN_WEEK_MS);
+
+    double rho[RTCM_MSM_MAX_SATS], rate[RTCM_MSM_MAX_SATS], elev[RTCM_MSM_MAX_SATS];
+    TrackState *tr[RTCM_MSM_MAX_SATS];
+    int ext[RTCM_MSM_MAX_SATS];
+    int ns = 0;
+    for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS && ns < RTCM_MSM_MAX_SATS; prn++) {
+        TrackState *ts = &g->track[gn][prn - 1];
+        g->in_view[gn][prn - 1] = false;
+        const SvEphemeris *e = sv_eph_get_at(gn, prn, week, gn == 2 ? tod : tow);
+        double x, y, z, el;
+        if (!e || e->health ||
+            !sv_to_ecef(e, week, gn == 2 ? tod : tow, &x, &y, &z)) {
+            ts->rise_ms = -1;
+            continue;
+        }
+        azel_from_ecef_frame(&g->sta, x, y, z, NULL, &el);
+        if (el < GEN_MIN_ELEV_DEG) {
+            ts->rise_ms = -1;
+            continue;
+        }
+        double dx = x - g->sta.x, dy = y - g->sta.y, dz = z - g->sta.z;
+        double r = sqrt(dx * dx + dy * dy + dz * dz);
+        if (ts->rise_ms < 0) {
+            ts->rise_ms = t_ms;
+            for (int k = 0; k < GEN_MAX_SIGS; k++)
+                ts->amb[k] = (gen_uniform(g) - 0.5) * 100.0;
+            rate[ns] = 0.0;
+        } else {
+            rate[ns] = (r - ts->prev_rho) / (t - ts->prev_t);
+        }
+        ts->prev_rho = r;
+        ts->prev_t   = t;
+        g->in_view[gn][prn - 1] = true;
+
+        obs->sats[ns].prn = prn;
+        rho[ns]  = r;
+        elev[ns] = el;
+        tr[ns]   = ts;
+        ext[ns]  = gn == 2 ? e->glo_freq_chan + 7 : 0;
+        ns++;
+    }
+    if (ns == 0) return false;
+
+    int nsig = k_sigs[gn][0];
+    if (nsig > RTCM_MSM_MAX_CELLS / ns) nsig = RTCM_MSM_MAX_CELLS / ns;
+    obs->num_sats = ns;
+    obs->num_sigs = nsig;
+    for (int k = 0; k < nsig; k++) obs->sig_idx[k] = k_sigs[gn][1 + k];
+
+    int nc = 0;
+    for (int s = 0; s < ns; s++) {
+        rtcm_msm_set_sat(obs, s, rho[s], rate[s], ext[s]);
+        int lock = gen_lock_indicator(t_ms - tr[s]->rise_ms, c->msm_subtype);
+        double cnr = 28.0 + 22.0 * sin(elev[s] * GEN_DEG);
+        for (int k = 0; k < nsig; k++) {
+            obs->cells[nc].sat     = s;
+            obs->cells[nc].sig_idx = obs->sig_idx[k];
+            rtcm_msm_set_cell(obs, nc,
+                              rho[s] + gen_gauss(g, 0.3),
+                              rho[s] + tr[s]->amb[k] + gen_gauss(g, 0.002),
+                              rate[s] + gen_gauss(g, 0.01),
+                              cnr - 2.0 * k + gen_gauss(g, 0.5), lock);
+            nc++;
+        }
+    }
+    obs->num_cells = nc;
+    return true;
+}
+
+/* ── Configuration ────────────────────────────────────────────────── */
+
+void rtcm_gen_config_init(RtcmGenConfig *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->gnss_mask      = RTCM_GEN_GNSS_DEFAULT;
+    cfg->msm_subtype    = 7;
+    cfg->rate_hz        = 1.0;
+    cfg->speed          = 1.0;
+    cfg->station_id     = 1;
+    cfg->arp_interval_s = 10;
+    cfg->eph_interval_s = 60;
+    cfg->seed           = 1;
+}
+
+bool rtcm_gen_parse_errors(const char *spec, RtcmGenConfig *cfg)
+{
+    RtcmGenConfig c = *cfg;
+    const char *p = spec;
+    while (p && *p) {
+        size_t klen = strcspn(p, "=");
+        if (p[klen] != '=') return false;
+        char *end;
+        double v = strtod(p + klen + 1, &end);
+        if (end == p + klen + 1) return false;
+        if (*end == '%') { v /= 100.0; end++; }
+        if (v < 0.0 || v > 1.0 || (*end && *end != ',')) return false;
+
+        if      (klen == 3 && strncmp(p, "crc", 3) == 0)  c.p_crc  = v;
+        else if (klen == 3 && strncmp(p, "cut", 3) == 0)  c.p_cut  = v;
+        else if (klen == 4 && strncmp(p, "junk", 4) == 0) c.p_junk = v;
+        else if (klen == 4 && strncmp(p, "drop", 4) == 0) c.p_drop = v;
+        else return false;
+        p = *end ? end + 1 : end;
+    }
+    *cfg = c;
+    return true;
+}
+
+bool rtcm_gen_parse_gnss(const char *list, unsigned *mask)
+{
+    static const struct { const char *name; char letter; int id; } k_names[] = {
+        { "GPS", 'G', 1 }, { "GLO", 'R', 2 }, { "GLONASS", 'R', 2 }, { "GAL", 'E', 3 },
+        { "GALILEO", 'E', 3 }, { "QZSS", 'J', 4 }, { "QZS", 'J', 4 }, { "BDS", 'C', 5 },
+        { "BEIDOU", 'C', 5 }, { "NAVIC", 'I', 7 }, { "IRNSS", 'I', 7 },
+    };
+    unsigned m = 0;
+    const char *p = list;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        bool found = false;
+        for (size_t i = 0; i < sizeof(k_names) / sizeof(k_names[0]) && !found; i++) {
+            const char *n = k_names[i].name;
+            size_t k = 0;
+            while (k < len && n[k] && (p[k] & ~0x20) == n[k]) k++;
+            if (k == len && !n[k]) {
+                m |= RTCM_GEN_GNSS(k_names[i].id);
+                found = true;
+            }
+        }
+        if (!found) {       /* RINEX letters, "GREC" */
+            for (size_t k = 0; k < len; k++) {
+                size_t i;
+                for (i = 0; i < sizeof(k_names) / sizeof(k_names[0]); i++)
+                    if ((p[k] & ~0x20) == k_names[i].letter) break;
+                if (i == sizeof(k_names) / sizeof(k_names[0])) return false;
+                m |= RTCM_GEN_GNSS(k_names[i].id);
+            }
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    if (!m) return false;
+    *mask = m;
+    return true;
+}
+
+/* ── Run ──────────────────────────────────────────────────────────── */
+
+/* Current GPS time in ms since the GPS epoch. */
+static int64_t gen_now_ms(void)
+{
+    int64_t now_ms = stream_clock_utc_ns() / 1000000 - GEN_GPS_EPOCH_UNIX * 1000;
+    return now_ms + (int64_t)gen_leap(now_ms) * 1000;
+}
+
+/* Stream start: the latest toe among cached ephemerides placed in the
+ * current week (their week numbers are not reliable across formats), or
+ * the current GPS time when every constellation is synthetic. */
+static int64_t gen_start_ms(const GenCtx *g)
+{
+    int64_t now_ms = gen_now_ms();
+    double latest = -1.0, glo_latest = -1.0;
+    for (int gn = 1; gn < GEN_MAX_GNSS; gn++) {
+        if (!(g->cfg->gnss_mask & RTCM_GEN_GNSS(gn)) || g->synthetic[gn]) continue;
+        for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS; prn++) {
+            const SvEphemeris *e = sv_eph_get(gn, prn);
+            if (!e) continue;
+            double *l = gn == 2 ? &glo_latest : &latest;
+            if (e->toe > *l) *l = e->toe;
+        }
+    }
+    if (latest >= 0.0) {
+        int64_t t = now_ms - now_ms % GEN_WEEK_MS + (int64_t)(latest * 1000.0);
+        if (t > now_ms + GEN_WEEK_MS / 2) t -= GEN_WEEK_MS;
+        return t;
+    }
+    if (glo_latest >= 0.0) {
+        double d = glo_latest - gen_glo_tod(now_ms, NULL);
+        if (d >  43200.0) d -= 86400.0;
+        if (d < -43200.0) d += 86400.0;
+        return now_ms + (int64_t)(d * 1000.0);
+    }
+    return now_ms;
+}
+
+int rtcm_gen_run(const RtcmGenConfig *cfg, RtcmGenSink sink, void *user,
+                 const volatile int *stop, RtcmGenStats *stats)
+{
+    RtcmGenStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (!sink || (cfg->msm_subtype != 4 && cfg->msm_subtype != 5 && cfg->msm_subtype != 7) ||
+        cfg->rate_hz < 0.1 || cfg->rate_hz > 100.0 || cfg->speed < 0.0 ||
+        !(cfg->gnss_mask & ~(RTCM_GEN_GNSS(0) | RTCM_GEN_GNSS(6))))
+        return -1;
+
+    GenCtx *g = (GenCtx *)calloc(1, sizeof(GenCtx));
+    if (!g) return -1;
+    g->cfg  = cfg;
+    g->sink = sink;
+    g->user = user;
+    g->st   = stats;
+    g->rng  = cfg->seed ? cfg->seed : 1;
+
+    double sx, sy, sz;
+    geodetic_to_ecef(cfg->lat_deg, cfg->lon_deg, cfg->alt_m, &sx, &sy, &sz);
+    station_frame_set(&g->sta, sx, sy, sz);
+
+    for (int gn = 1; gn < GEN_MAX_GNSS; gn++) {
+        if (!(cfg->gnss_mask & RTCM_GEN_GNSS(gn)) || !k_msm_base[gn]) continue;
+        bool cached = false;
+        for (int prn = 1; prn <= SV_EPH_MAX_SATS_PER_GNSS && !cached; prn++)
+            cached = sv_eph_get(gn, prn) != NULL;
+        g->synthetic[gn] = !cached;
+    }
+    synth_build(g);
+    for (int gn = 0; gn < GEN_MAX_GNSS; gn++)
+        for (int prn = 0; prn < SV_EPH_MAX_SATS_PER_GNSS; prn++)
+            g->track[gn][prn].rise_ms = -1;
+
+    const int64_t step_ms = (int64_t)llround(1000.0 / cfg->rate_hz);
+    int64_t t0 = gen_start_ms(g);
+    t0 -= t0 % step_ms;
+    const int64_t t_end = cfg->duration_s > 0.0 ?
+                          t0 + (int64_t)llround(cfg->duration_s * 1000.0) : INT64_MAX;
+    int64_t next_arp = t0, next_eph = t0;
+    /* A start at the current time lies up to one step in the past;
+     * pace from that epoch so each one goes out as it falls due. */
+    int64_t behind_ms = gen_now_ms() - t0;
+    if (behind_ms < 0 || behind_ms > step_ms || cfg->speed <= 0.0) behind_ms = 0;
+    const double wall0 = stream_clock_wall_seconds() -
+                         (behind_ms ? (double)behind_ms / 1000.0 / cfg->speed : 0.0);
+    int rc = 0;
+
+    for (int64_t t = t0; t < t_end && !g->sink_closed && !(stop && *stop); t += step_ms) {
+        if (cfg->speed > 0.0)
+            gen_sleep((double)(t - t0) / 1000.0 / cfg->speed -
+                      (stream_clock_wall_seconds() - wall0));
+
+        for (int gn = 1; gn < GEN_MAX_GNSS; gn++)
+            if (g->synthetic[gn] && t >= g->renew_ms[gn]) synth_renew(g, gn, t);
+
+        if (cfg->arp_interval_s > 0 && t >= next_arp) {
+            gen_arp(g);
+            next_arp = t + cfg->arp_interval_s * 1000LL;
+        }
+
+        /* Every constellation's observations first, so the multiple-
+         * message bit can be set on all but the last MSM sent. */
+        bool have[GEN_MAX_GNSS] = { false };
+        int last = -1, sats = 0;
+        for (int gn = 1; gn < GEN_MAX_GNSS; gn++) {
+            if (!(cfg->gnss_mask & RTCM_GEN_GNSS(gn)) || !k_msm_base[gn]) continue;
+            have[gn] = gen_msm(g, gn, t, &g->obs[gn]);
+            if (have[gn]) {
+                last = gn;
+                sats += g->obs[gn].num_sats;
+            }
+        }
+        if (t == t0 && last < 0) {
+            fprintf(stderr, "[ERROR] No satellite of the selected constellations in view\n");
+            rc = -1;
+            break;
+        }
+        unsigned char frame[RTCM_FRAME_MAX];
+        for (int gn = 1; gn < GEN_MAX_GNSS; gn++) {
+            if (!have[gn]) continue;
+            g->obs[gn].mm_flag = gn != last;
+            gen_emit(g, frame, rtcm_encode_msm(&g->obs[gn], frame));
+            stats->msm++;
+        }
+        if (sats > stats->sats_max) stats->sats_max = sats;
+
+        if (cfg->eph_interval_s > 0 && t >= next_eph) {
+            gen_ephemerides(g, t);
+            next_eph = t + cfg->eph_interval_s * 1000LL;
+        }
+        stats->epochs++;
+        stats->stream_s = (double)(t + step_ms - t0) / 1000.0;
+    }
+    stats->wall_s = stream_clock_wall_seconds() - wall0;
+    free(g->synth);
+    free(g);
+    return rc;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file rtcm_gen.h
+ * @brief Synthetic RTCM 3 stream generator for load and regression tests.
+ *
+ * Builds what a reference station would send, epoch by epoch: one MSM
+ * per constellation (multiple-message bit set on all but the last), a
+ * periodic 1005 / 1006 and the broadcast ephemeris of every satellite in
+ * view, all through the encoder in rtcm_encoder.h.
+ *
+ * The observations are computed from ephemerides, so a stream decodes
+ * to a consistent sky:
+ *
+ *   - Ephemerides already in the cache (RINEX loaded with
+ *     rinex_nav_load(), or a decoded stream) are used for their
+ *     constellation, and the stream starts at the latest toe among them;
+ *   - any other selected constellation gets a nominal synthetic one
+ *     (GPS, GLONASS, Galileo and BeiDou MEO Walker shells, the QZSS and
+ *     NavIC IGSO / GEO satellites), stored in the cache like a decoded
+ *     ephemeris and renewed every two hours (GLONASS: 30 min) of stream
+ *     time, and the stream starts at the current GPS time.
+ *
+ * Per satellite above 5 degrees: range from the station ARP, rate from
+ * the previous epoch, pseudorange and phase per signal with small
+ * Gaussian noise, CNR by elevation and a lock time since it rose.
+ *
+ * Error injection works on the emitted byte stream, per frame: dropped
+ * frames, a flipped bit (CRC error), frames cut short and junk bytes in
+ * front of a frame -- what a framer has to survive on a bad link.
+ *
+ * Pacing is in stream time: @c speed 1 is real time, 100 is a hundred
+ * stream seconds per wall second, 0 is as fast as the sink takes it.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_GEN_H
+#define RTCM_GEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Bit of gnss_id @p g in RtcmGenConfig::gnss_mask. */
+#define RTCM_GEN_GNSS(g)      (1u << (g))
+
+/** @brief Default constellations: GPS, GLONASS, Galileo, BeiDou. */
+#define RTCM_GEN_GNSS_DEFAULT (RTCM_GEN_GNSS(1) | RTCM_GEN_GNSS(2) | \
+                               RTCM_GEN_GNSS(3) | RTCM_GEN_GNSS(5))
+
+/** @brief Generator settings; start from rtcm_gen_config_init(). */
+typedef struct {
+    unsigned gnss_mask;        /**< RTCM_GEN_GNSS() bits of gnss_id 1..7 */
+    int      msm_subtype;      /**< 4, 5 or 7 */
+    double   rate_hz;          /**< Epochs per second of stream time (0.1 .. 100) */
+    double   speed;            /**< Stream seconds per wall second; 0 = no pacing */
+    double   duration_s;       /**< Stream time to generate; 0 = until stopped */
+    double   lat_deg, lon_deg; /**< Station position (WGS-84) */
+    double   alt_m;            /**< Station ellipsoidal height */
+    int      station_id;       /**< DF003 */
+    int      arp_interval_s;   /**< Stream seconds between 1006 frames; 0 = never */
+    int      eph_interval_s;   /**< Stream seconds between ephemeris rounds; 0 = never */
+    double   p_drop;           /**< Per-frame probability of leaving the frame out */
+    double   p_crc;            /**< ... of flipping one bit of it */
+    double   p_cut;            /**< ... of sending only a leading part of it */
+    double   p_junk;           /**< ... of sending 1..64 random bytes before it */
+    uint64_t seed;             /**< PRNG seed for noise and error injection */
+} RtcmGenConfig;
+
+/** @brief What a run produced. */
+typedef struct {
+    unsigned long      epochs;
+    unsigned long      frames;     /**< Frames encoded (before error injection) */
+    unsigned long      msm, eph, arp;
+    unsigned long      dropped, corrupted, cut, junk;
+    unsigned long long bytes;      /**< Bytes handed to the sink */
+    double             stream_s;   /**< Stream time covered */
+    double             wall_s;
+    int                sats_max;   /**< Most satellites in one epoch, all constellations */
+} RtcmGenStats;
+
+/**
+ * @brief Receives the generated bytes: a whole frame, possibly corrupted,
+ *        cut, or following injected junk.
+ *
+ * @return false to end the run (e.g. the output was closed).
+ */
+typedef bool (*RtcmGenSink)(const unsigned char *data, int len, void *user);
+
+/**
+ * @brief Defaults: GPS + GLONASS + Galileo + BeiDou, MSM7 at 1 Hz, real
+ *        time, no end, 1006 every 10 s, ephemerides every 60 s, no errors.
+ */
+void rtcm_gen_config_init(RtcmGenConfig *cfg);
+
+/**
+ * @brief Parse an error-injection spec "crc=0.01,cut=0.005,junk=0.01,drop=0.02"
+ *        (any subset; values are probabilities 0..1 or percentages "1%").
+ *
+ * @return false on an unknown key or a value out of range; @p cfg is then
+ *         unchanged.
+ */
+bool rtcm_gen_parse_errors(const char *spec, RtcmGenConfig *cfg);
+
+/**
+ * @brief Parse a constellation list "GPS,GLO,GAL,BDS,QZSS,NAVIC" (or the
+ *        RINEX letters "GRECJI") into RtcmGenConfig::gnss_mask.
+ *
+ * @return false on an unknown name.
+ */
+bool rtcm_gen_parse_gnss(const char *list, unsigned *mask);
+
+/**
+ * @brief Generate a stream into @p sink until the duration is covered,
+ *        the sink refuses, or @p stop turns non-zero.
+ *
+ * Uses and fills the ephemeris cache (sv_ephemeris.h), so it must not run
+ * alongside a decoder in the same process.
+ *
+ * @param stats  [out] Totals, may be NULL.
+ * @return 0 on success, -1 if @p cfg is invalid or no satellite is in view
+ *         at the start.
+ */
+int rtcm_gen_run(const RtcmGenConfig *cfg, RtcmGenSink sink, void *user,
+                 const volatile int *stop, RtcmGenStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_GEN_H */
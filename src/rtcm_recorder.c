@@ -0,0 +1,358 @@
+/**
+ * @file rtcm_recorder.c
+ * @brief Asynchronous stream recorder: capture files written off the receive thread.
+ *
+ * Ring record layout: a 16-byte header (u32 frame length, u32 unused,
+ * u64 receive time in ns) followed by the frame, padded to 8 bytes.  A
+ * record never wraps; if it does not fit before the end of the ring the
+ * producer writes a header with length REC_WRAP and continues at offset
+ * 0, as in gui_frame_queue.c.  head is written only by the producer and
+ * tail only by the writer thread; both are published with release
+ * stores, so a record's bytes are visible before the index that exposes
+ * them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_recorder.h"
+#include "rtcm_capture.h"
+#include "stream_clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#endif
+
+#define REC_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define REC_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define REC_ADD(p, v)    __atomic_add_fetch((p), (v), __ATOMIC_RELAXED)
+
+#define REC_HDR          16
+#define REC_WRAP         0xFFFFFFFFu
+#define REC_ALIGN(n)     (((uint64_t)(n) + 7u) & ~(uint64_t)7u)
+#define REC_IDLE_MS      20            /* writer poll interval when idle */
+#define REC_FLUSH_NS     1000000000LL  /* flush a quiet file once a second */
+
+struct RtcmRecorder {
+    /* Ring (producer: head, dropped; writer: everything else). */
+    unsigned char    *ring;
+    uint64_t          size;
+    uint64_t          head;
+    uint64_t          tail;
+    uint64_t          dropped;
+    int               stop;
+
+    /* Output, owned by the writer thread after open. */
+    RtcmRecorderOptions opt;
+    bool              native;
+    char              base[1024];       /* path as given */
+    char              path[1040];       /* current file */
+    RtcmCaptureWriter cap;              /* native output */
+    FILE             *raw;              /* raw output */
+    int64_t           t0_ns;            /* monotonic time at open */
+    int64_t           start_unix_ns;    /* wall clock at t0_ns */
+    int64_t           file_t0_ns;       /* monotonic start of current file */
+    uint64_t          file_bytes;
+    int64_t           last_flush_ns;
+
+    /* Counters published to rtcm_recorder_stats(). */
+    uint64_t          frames;
+    uint64_t          bytes;
+    uint32_t          files;
+    int               failed;
+
+#ifdef _WIN32
+    HANDLE            thread;
+#else
+    pthread_t         thread;
+#endif
+};
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void rec_sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { 0, (long)ms * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* ── Output files ─────────────────────────────────────────────────────── */
+
+/* Open the next output file.  Without rotation the path is used as given;
+ * with rotation every file gets a sequence number before the extension. */
+static bool rec_open_file(RtcmRecorder *r, int64_t now_ns)
+{
+    uint32_t seq = r->files + 1;
+    if (r->opt.rotate_bytes || r->opt.rotate_secs) {
+        const char *dot = strrchr(r->base, '.');
+        const char *sep = strrchr(r->base, '/');
+#ifdef _WIN32
+        const char *bsep = strrchr(r->base, '\\');
+        if (bsep && (!sep || bsep > sep)) sep = bsep;
+#endif
+        if (!dot || (sep && dot < sep)) dot = r->base + strlen(r->base);
+        snprintf(r->path, sizeof(r->path), "%.*s_%04u%s",
+                 (int)(dot - r->base), r->base, (unsigned)seq, dot);
+    } else {
+        snprintf(r->path, sizeof(r->path), "%s", r->base);
+    }
+
+    bool ok;
+    if (r->native) {
+        ok = rtcm_capture_writer_open(&r->cap, r->path,
+                                      r->start_unix_ns + (now_ns - r->t0_ns),
+                                      r->opt.compress ? RTCM_CAPTURE_COMPRESS : 0);
+        if (!ok && r->cap.f) {
+            fclose(r->cap.f);
+            r->cap.f = NULL;
+            free(r->cap.blk);
+            r->cap.blk = NULL;
+        }
+    } else {
+        r->raw = fopen(r->path, "wb");
+        if (r->raw) setvbuf(r->raw, NULL, _IOFBF, RTCM_RECORDER_IO_BUF);
+        ok = r->raw != NULL;
+    }
+    if (!ok) return false;
+    r->file_t0_ns    = now_ns;
+    r->file_bytes    = 0;
+    r->last_flush_ns = now_ns;
+    REC_STORE(&r->files, seq);
+    return true;
+}
+
+static bool rec_close_file(RtcmRecorder *r)
+{
+    bool ok = true;
+    if (r->native && r->cap.f) {
+        ok = rtcm_capture_writer_close(&r->cap);
+    } else if (r->raw) {
+        ok = fclose(r->raw) == 0;
+        r->raw = NULL;
+    }
+    return ok;
+}
+
+static void rec_flush_file(RtcmRecorder *r)
+{
+    FILE *f = r->native ? r->cap.f : r->raw;
+    if (f && fflush(f) != 0) REC_STORE(&r->failed, 1);
+}
+
+/* Write one frame, rotating first if the current file is full or old. */
+static void rec_write(RtcmRecorder *r, int64_t t_ns, const unsigned char *frame,
+                      uint32_t len)
+{
+    if (REC_LOAD(&r->failed)) return;
+
+    bool rotate =
+        (r->opt.rotate_bytes && r->file_bytes >= r->opt.rotate_bytes) ||
+        (r->opt.rotate_secs &&
+         t_ns - r->file_t0_ns >= (int64_t)r->opt.rotate_secs * 1000000000LL);
+    if (rotate) {
+        bool ok = rec_close_file(r);
+        if (!ok || !rec_open_file(r, t_ns)) {
+            REC_STORE(&r->failed, 1);
+            return;
+        }
+    }
+
+    uint64_t before, after;
+    bool ok;
+    if (r->native) {
+        before = r->cap.offset;
+        int64_t rel = t_ns - r->file_t0_ns;
+        ok = rtcm_capture_write_at(&r->cap, rel > 0 ? (uint64_t)rel : 0,
+                                   frame, (int)len);
+        after = r->cap.offset;
+    } else {
+        before = 0;
+        ok = fwrite(frame, 1, len, r->raw) == len;
+        after = len;
+    }
+    if (!ok) {
+        REC_STORE(&r->failed, 1);
+        return;
+    }
+    r->file_bytes += after - before;
+    REC_ADD(&r->bytes, after - before);
+    REC_ADD(&r->frames, 1);
+}
+
+/* ── Writer thread ────────────────────────────────────────────────────── */
+
+/* Write out every record queued so far.  Returns the number of frames. */
+static size_t rec_drain(RtcmRecorder *r)
+{
+    uint64_t tail = r->tail;
+    uint64_t head = REC_LOAD(&r->head);
+    size_t n = 0;
+    while (tail != head) {
+        uint64_t off = tail & (r->size - 1);
+        const unsigned char *p = r->ring + off;
+        uint32_t len = get_u32(p);
+        if (len == REC_WRAP) {
+            tail += r->size - off;
+            continue;
+        }
+        int64_t t_ns;
+        memcpy(&t_ns, p + 8, sizeof(t_ns));
+        rec_write(r, t_ns, p + REC_HDR, len);
+        tail += REC_ALIGN(REC_HDR + len);
+        n++;
+        /* Hand space back in batches rather than per frame. */
+        if ((n & 63) == 0) REC_STORE(&r->tail, tail);
+    }
+    REC_STORE(&r->tail, tail);
+    return n;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall rec_thread(void *arg)
+#else
+static void *rec_thread(void *arg)
+#endif
+{
+    RtcmRecorder *r = (RtcmRecorder *)arg;
+    for (;;) {
+        /* Sample stop before draining so the last records are written. */
+        int stop = REC_LOAD(&r->stop);
+        if (rec_drain(r) > 0) continue;
+        if (stop) break;
+        int64_t now = stream_clock_wall_ns();
+        if (now - r->last_flush_ns >= REC_FLUSH_NS) {
+            rec_flush_file(r);
+            r->last_flush_ns = now;
+        }
+        rec_sleep_ms(REC_IDLE_MS);
+    }
+    if (!rec_close_file(r)) REC_STORE(&r->failed, 1);
+    return 0;
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+RtcmRecorder *rtcm_recorder_open(const char *path, const RtcmRecorderOptions *opt)
+{
+    if (!path || strlen(path) >= sizeof(((RtcmRecorder *)0)->base)) return NULL;
+    RtcmRecorder *r = (RtcmRecorder *)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    if (opt) r->opt = *opt;
+
+    size_t size = r->opt.ring_bytes ? r->opt.ring_bytes : RTCM_RECORDER_RING_DEFAULT;
+    if (size < 65536 || (size & (size - 1)) != 0) {
+        free(r);
+        return NULL;
+    }
+    r->size = size;
+    r->ring = (unsigned char *)malloc(size);
+    if (!r->ring) {
+        free(r);
+        return NULL;
+    }
+
+    strcpy(r->base, path);
+    r->native = rtcm_capture_is_native_path(path);
+    r->t0_ns         = stream_clock_wall_ns();
+    r->start_unix_ns = (int64_t)time(NULL) * 1000000000LL;
+
+    if (!rec_open_file(r, r->t0_ns)) {
+        free(r->ring);
+        free(r);
+        return NULL;
+    }
+
+#ifdef _WIN32
+    r->thread = (HANDLE)_beginthreadex(NULL, 0, rec_thread, r, 0, NULL);
+    bool started = r->thread != NULL;
+#else
+    bool started = pthread_create(&r->thread, NULL, rec_thread, r) == 0;
+#endif
+    if (!started) {
+        rec_close_file(r);
+        free(r->ring);
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+bool rtcm_recorder_push(RtcmRecorder *r, const unsigned char *frame, int frame_len)
+{
+    if (frame_len <= 0 || frame_len > 0xFFFF) return false;
+
+    uint64_t need   = REC_ALIGN(REC_HDR + (uint64_t)frame_len);
+    uint64_t head   = r->head;
+    uint64_t tail   = REC_LOAD(&r->tail);
+    uint64_t off    = head & (r->size - 1);
+    uint64_t to_end = r->size - off;
+    uint64_t pad    = to_end < need ? to_end : 0;
+
+    if (r->size - (head - tail) < pad + need) {
+        REC_ADD(&r->dropped, 1);
+        return false;
+    }
+    if (pad) {
+        /* to_end is a multiple of 8, so the marker always fits. */
+        put_u32(r->ring + off, REC_WRAP);
+        head += pad;
+        off   = 0;
+    }
+    int64_t t_ns = stream_clock_wall_ns();
+    unsigned char *p = r->ring + off;
+    put_u32(p, (uint32_t)frame_len);
+    put_u32(p + 4, 0);
+    memcpy(p + 8, &t_ns, sizeof(t_ns));
+    memcpy(p + REC_HDR, frame, (size_t)frame_len);
+    REC_STORE(&r->head, head + need);
+    return true;
+}
+
+void rtcm_recorder_stats(const RtcmRecorder *r, RtcmRecorderStats *st)
+{
+    st->frames  = REC_LOAD(&r->frames);
+    st->dropped = REC_LOAD(&r->dropped);
+    st->bytes   = REC_LOAD(&r->bytes);
+    st->files   = REC_LOAD(&r->files);
+    st->failed  = REC_LOAD(&r->failed) != 0;
+}
+
+bool rtcm_recorder_close(RtcmRecorder *r, RtcmRecorderStats *st)
+{
+    if (!r) return false;
+    REC_STORE(&r->stop, 1);
+#ifdef _WIN32
+    WaitForSingleObject(r->thread, INFINITE);
+    CloseHandle(r->thread);
+#else
+    pthread_join(r->thread, NULL);
+#endif
+    RtcmRecorderStats s;
+    rtcm_recorder_stats(r, &s);
+    if (st) *st = s;
+    free(r->ring);
+    free(r);
+    return !s.failed;
+}
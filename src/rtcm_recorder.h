@@ -0,0 +1,126 @@
+/**
+ * @file rtcm_recorder.h
+ * @brief Asynchronous stream recorder: capture files written off the receive thread.
+ *
+ * Writing a capture with fwrite() from the thread that calls recv() ties
+ * the stream to the disk: a stall in the file system (an antivirus scan,
+ * a network share) stops the socket reads, and the caster eventually
+ * drops the connection.  @ref RtcmRecorder decouples the two:
+ *   - rtcm_recorder_push() stamps the frame with the receive time and
+ *     copies it into a lock-free single-producer / single-consumer byte
+ *     ring.  It never blocks and never touches the disk; if the ring is
+ *     full the frame is dropped and counted.
+ *   - A writer thread drains the ring in batches into a fully buffered
+ *     stream (1 MB stdio buffer), so the file system sees large
+ *     writes rather than one call per frame.  The file is flushed once a
+ *     second while the stream is quiet.
+ *   - Optionally the output is rotated by size or by age.  Rotated files
+ *     are named "<stem>_0001<ext>", "<stem>_0002<ext>", ...
+ *
+ * The output is a native capture (rtcm_capture.h), optionally compressed,
+ * or, for any other extension than @ref RTCM_CAPTURE_EXT, raw frames.
+ * Each rotated native file starts at t = 0 with its own start time in
+ * the header.  Compression runs on the writer thread too.
+ *
+ * One recorder serves one stream (one producer thread); record several
+ * streams with one recorder each.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_RECORDER_H
+#define RTCM_RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Default ring size: about four thousand maximum-size frames. */
+#define RTCM_RECORDER_RING_DEFAULT  (4u << 20)
+
+/** @brief stdio buffer of a raw output file (native: RTCM_CAPTURE_IO_BUF). */
+#define RTCM_RECORDER_IO_BUF        (1u << 20)
+
+/**
+ * @struct RtcmRecorderOptions
+ * @brief Recorder settings; zero-initialise for the defaults.
+ *
+ * Fields:
+ *   - rotate_bytes:  Start a new file once the current one reaches this
+ *                    size; 0 = never.
+ *   - rotate_secs:   Start a new file once the current one covers this
+ *                    many seconds; 0 = never.
+ *   - ring_bytes:    Ring size (power of two, >= 64 kB); 0 = default.
+ *   - compress:      Write compressed native captures (ignored for raw
+ *                    output).
+ */
+typedef struct {
+    uint64_t rotate_bytes;
+    uint32_t rotate_secs;
+    size_t   ring_bytes;
+    bool     compress;
+} RtcmRecorderOptions;
+
+/**
+ * @struct RtcmRecorderStats
+ * @brief Recorder counters, safe to read while recording.
+ *
+ * Fields:
+ *   - frames:   Frames written.
+ *   - dropped:  Frames lost because the ring was full.
+ *   - bytes:    Bytes written over all files.
+ *   - files:    Files opened.
+ *   - failed:   A file could not be opened or written; frames after
+ *               the failure are discarded.
+ */
+typedef struct {
+    uint64_t frames;
+    uint64_t dropped;
+    uint64_t bytes;
+    uint32_t files;
+    bool     failed;
+} RtcmRecorderStats;
+
+/** @brief Opaque recorder (owns its writer thread). */
+typedef struct RtcmRecorder RtcmRecorder;
+
+/**
+ * @brief Create the first output file and start the writer thread.
+ *
+ * @param path  Output path; a ".nacap" extension selects the native format.
+ * @param opt   Options, or NULL for the defaults.
+ * @return The recorder, or NULL if the file or the thread cannot be created.
+ */
+RtcmRecorder *rtcm_recorder_open(const char *path, const RtcmRecorderOptions *opt);
+
+/**
+ * @brief Queue a frame, stamped with the current monotonic time.
+ *
+ * Must always be called from the same thread.
+ *
+ * @return false if the frame was dropped (ring full).
+ */
+bool rtcm_recorder_push(RtcmRecorder *r, const unsigned char *frame, int frame_len);
+
+/** @brief Snapshot of the counters. */
+void rtcm_recorder_stats(const RtcmRecorder *r, RtcmRecorderStats *st);
+
+/**
+ * @brief Write out everything queued, close the file and free @p r.
+ *
+ * @param st  [out] Final counters (may be NULL).
+ * @return false if any open or write failed.
+ */
+bool rtcm_recorder_close(RtcmRecorder *r, RtcmRecorderStats *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_RECORDER_H */
@@ -0,0 +1,325 @@
+/**
+ * @file rtcm_replay.c
+ * @brief Memory-mapped, indexed replay of raw RTCM 3.x capture files.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_replay.h"
+#include "rtcm3x_parser.h"
+#include "stream_clock.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define WEEK_MS  604800000u
+
+/* Head of a file without RTCM frames that is sniffed for another format. */
+#define REPLAY_SNIFF_BYTES  (4 * STREAM_SNIFF_WINDOW)
+
+/* ── Sidecar index ────────────────────────────────────────────────────── */
+
+/* "<file>.rtidx": header followed by n_frames RtcmReplayFrame entries.
+ * Keyed on the capture's size and mtime. */
+#define IDX_MAGIC    "NARIDX\r\n"
+#define IDX_VERSION  1
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t src_size;
+    int64_t  src_mtime;
+    uint64_t n_frames;
+    uint32_t crc_errors;
+    uint32_t skipped_bytes;
+} IdxHeader;
+
+static char *idx_path(const char *path, const char *suffix)
+{
+    size_t n = strlen(path);
+    char *p = (char *)malloc(n + strlen(suffix) + 1);
+    if (!p) return NULL;
+    memcpy(p, path, n);
+    strcpy(p + n, suffix);
+    return p;
+}
+
+static void idx_header(IdxHeader *h, const struct stat *st)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, IDX_MAGIC, sizeof(h->magic));
+    h->version    = IDX_VERSION;
+    h->entry_size = (uint32_t)sizeof(RtcmReplayFrame);
+    h->src_size   = (uint64_t)st->st_size;
+    h->src_mtime  = (int64_t)st->st_mtime;
+}
+
+/* Map "<path>.rtidx" if it matches the capture.  The index is used in
+ * place from the mapping. */
+static bool idx_load(RtcmReplay *r, const char *path, const struct stat *st)
+{
+    char *ip = idx_path(path, ".rtidx");
+    if (!ip) return false;
+    bool ok = file_map_open(&r->idx_map, ip);
+    free(ip);
+    if (!ok) return false;
+
+    IdxHeader want, have;
+    idx_header(&want, st);
+    if (r->idx_map.size < sizeof(have)) goto reject;
+    memcpy(&have, r->idx_map.data, sizeof(have));
+    want.n_frames      = have.n_frames;
+    want.crc_errors    = have.crc_errors;
+    want.skipped_bytes = have.skipped_bytes;
+    if (memcmp(&want, &have, sizeof(want)) != 0) goto reject;
+    if (have.n_frames > (r->idx_map.size - sizeof(have)) / sizeof(RtcmReplayFrame) ||
+        r->idx_map.size != sizeof(have) + (size_t)have.n_frames * sizeof(RtcmReplayFrame))
+        goto reject;
+
+    /* Cheap sanity pass: every frame must lie inside the capture. */
+    const RtcmReplayFrame *fr =
+        (const RtcmReplayFrame *)(r->idx_map.data + sizeof(have));
+    for (size_t i = 0; i < (size_t)have.n_frames; i++)
+        if (fr[i].length < 6 || fr[i].offset > r->data.size ||
+            fr[i].length > r->data.size - fr[i].offset)
+            goto reject;
+
+    r->frames        = fr;
+    r->n_frames      = (size_t)have.n_frames;
+    r->crc_errors    = have.crc_errors;
+    r->skipped_bytes = have.skipped_bytes;
+    r->index_cached  = true;
+    return true;
+
+reject:
+    file_map_close(&r->idx_map);
+    return false;
+}
+
+/* Write the freshly built index to "<path>.rtidx" (via a temporary file,
+ * so a reader never sees a partial index).  Best effort. */
+static void idx_save(const RtcmReplay *r, const char *path, const struct stat *st)
+{
+    char *tmp = idx_path(path, ".rtidx.tmp");
+    char *ip  = idx_path(path, ".rtidx");
+    FILE *f = tmp ? fopen(tmp, "wb") : NULL;
+    if (f) {
+        IdxHeader h;
+        idx_header(&h, st);
+        h.n_frames      = r->n_frames;
+        h.crc_errors    = (uint32_t)r->crc_errors;
+        h.skipped_bytes = (uint32_t)r->skipped_bytes;
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(r->frames, sizeof(RtcmReplayFrame), r->n_frames, f)
+                      == r->n_frames;
+        if (fclose(f) != 0) ok = false;
+        if (ok && ip) {
+            remove(ip);                   /* rename() won't replace on Windows */
+            if (rename(tmp, ip) != 0) remove(tmp);
+        } else {
+            remove(tmp);
+        }
+    }
+    free(tmp);
+    free(ip);
+}
+
+/* ── Index build ──────────────────────────────────────────────────────── */
+
+static bool idx_push(RtcmReplay *r, size_t *cap, uint64_t off, uint32_t len,
+                     uint32_t t_ms)
+{
+    if (r->n_frames == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 4096;
+        RtcmReplayFrame *n = (RtcmReplayFrame *)realloc(r->owned,
+                                                        ncap * sizeof(*n));
+        if (!n) return false;
+        r->owned = n;
+        *cap = ncap;
+    }
+    RtcmReplayFrame *e = &r->owned[r->n_frames++];
+    e->offset = off;
+    e->length = len;
+    e->t_ms   = t_ms;
+    return true;
+}
+
+/* One pass over the mapping with rtcm_framer.c's framing rules. */
+static bool idx_build(RtcmReplay *r)
+{
+    const unsigned char *base = r->data.data;
+    size_t size = r->data.size, pos = 0, cap = 0;
+
+    long     last_tow = -1;      /* ms of week of the latest epoch seen */
+    uint64_t t_rel    = 0;       /* ms since the first epoch, unwrapped */
+
+    while (size - pos >= 6) {
+        const unsigned char *p = base + pos;
+        if (p[0] != 0xD3) {
+            const unsigned char *hit = memchr(p, 0xD3, size - pos);
+            size_t skip = hit ? (size_t)(hit - p) : size - pos;
+            r->skipped_bytes += skip;
+            pos += skip;
+            continue;
+        }
+        if (p[1] & 0xFC) {
+            r->skipped_bytes++;
+            pos++;
+            continue;
+        }
+        size_t payload_len = ((size_t)(p[1] & 0x03) << 8) | p[2];
+        size_t frame_len   = payload_len + 6;
+        if (size - pos < frame_len) break;
+
+        uint32_t crc_calc = crc24q(p, payload_len + 3);
+        uint32_t crc_recv = ((uint32_t)p[payload_len + 3] << 16) |
+                            ((uint32_t)p[payload_len + 4] << 8)  |
+                             (uint32_t)p[payload_len + 5];
+        if (crc_calc != crc_recv) {
+            r->crc_errors++;
+            r->skipped_bytes++;
+            pos++;
+            continue;
+        }
+
+        /* Advance the stream clock on forward steps only; constellations
+         * and multi-frame epochs interleave, so small backward steps are
+         * normal and must not move it. */
+        long tow = stream_clock_msm_epoch_ms(p, (int)frame_len);
+        if (tow >= 0) {
+            if (last_tow >= 0) {
+                long d = tow - last_tow;
+                if (d < -(long)(WEEK_MS / 2)) d += (long)WEEK_MS;
+                if (d >  (long)(WEEK_MS / 2)) d -= (long)WEEK_MS;
+                if (d > 0) {
+                    t_rel += (uint64_t)d;
+                    last_tow = tow;
+                }
+            } else {
+                last_tow = tow;
+            }
+        }
+        uint32_t t_ms = t_rel > UINT32_MAX ? UINT32_MAX : (uint32_t)t_rel;
+
+        if (!idx_push(r, &cap, pos, (uint32_t)frame_len, t_ms)) return false;
+        pos += frame_len;
+    }
+    r->skipped_bytes += size - pos;      /* truncated tail */
+    r->frames = r->owned;
+    return true;
+}
+
+/* Native capture: the frames are located by the record headers and their
+ * receive times become the stream time.  The CRC is still checked, so a
+ * damaged capture cannot hand a bad frame to the decoders.  A compressed
+ * capture keeps its reader to unpack blocks on demand later. */
+static bool idx_build_native(RtcmReplay *r)
+{
+    RtcmCaptureReader cr;
+    if (!rtcm_capture_reader_init(&cr, r->data.data, r->data.size)) return false;
+    r->start_unix_ns = cr.start_unix_ns;
+
+    size_t cap = 0;
+    uint64_t t_ns;
+    const unsigned char *p;
+    int len;
+    uint64_t off;
+    bool ok = true;
+    while (ok && rtcm_capture_next(&cr, &t_ns, &p, &len, &off)) {
+        size_t payload_len = len >= 3 ? ((size_t)(p[1] & 0x03) << 8) | p[2] : 0;
+        if (len < 6 || p[0] != 0xD3 || payload_len + 6 != (size_t)len ||
+            crc24q(p, payload_len + 3) !=
+                (((uint32_t)p[payload_len + 3] << 16) |
+                 ((uint32_t)p[payload_len + 4] << 8)  |
+                  (uint32_t)p[payload_len + 5])) {
+            r->crc_errors++;
+            r->skipped_bytes += (unsigned long)len;
+            continue;
+        }
+        uint64_t t_ms = t_ns / 1000000u;
+        ok = idx_push(r, &cap, off, (uint32_t)len,
+                      t_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)t_ms);
+    }
+    r->frames = r->owned;
+    r->crc_errors += cr.bad_blocks;   /* a block that won't unpack: one error */
+    if (ok && cr.compressed) {
+        r->packed = (RtcmCaptureReader *)malloc(sizeof(*r->packed));
+        if (r->packed) {
+            *r->packed = cr;
+            return true;
+        }
+        ok = false;
+    }
+    rtcm_capture_reader_free(&cr);
+    return ok;
+}
+
+/* ── Public API ───────────────────────────────────────────────────────── */
+
+bool rtcm_replay_open(RtcmReplay *r, const char *path)
+{
+    memset(r, 0, sizeof(*r));
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return false;
+    if (!file_map_open(&r->data, path)) return false;
+
+    r->format = STREAM_FMT_RTCM3;
+    r->native = rtcm_capture_is_native(r->data.data, r->data.size);
+    if (r->native) {
+        /* The record headers are the index; no sidecar. */
+        if (!idx_build_native(r)) {
+            rtcm_replay_close(r);
+            return false;
+        }
+        return true;
+    }
+
+    if (!idx_load(r, path, &st)) {
+        if (!idx_build(r)) {
+            rtcm_replay_close(r);
+            return false;
+        }
+        idx_save(r, path, &st);
+    }
+    /* A raw receiver log holds no RTCM: say what it is instead. */
+    if (r->n_frames == 0) {
+        size_t head = r->data.size < REPLAY_SNIFF_BYTES ? r->data.size : REPLAY_SNIFF_BYTES;
+        r->format = stream_format_sniff(r->data.data, head, NULL);
+    }
+    return true;
+}
+
+void rtcm_replay_close(RtcmReplay *r)
+{
+    if (!r) return;
+    if (r->packed) {
+        rtcm_capture_reader_free(r->packed);
+        free(r->packed);
+    }
+    free(r->owned);
+    file_map_close(&r->idx_map);
+    file_map_close(&r->data);
+    memset(r, 0, sizeof(*r));
+}
+
+uint32_t rtcm_replay_duration_ms(const RtcmReplay *r)
+{
+    return r->n_frames ? r->frames[r->n_frames - 1].t_ms : 0;
+}
+
+size_t rtcm_replay_find_time(const RtcmReplay *r, uint32_t t_ms)
+{
+    /* t_ms is non-decreasing along the index. */
+    size_t lo = 0, hi = r->n_frames;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r->frames[mid].t_ms < t_ms) lo = mid + 1;
+        else                            hi = mid;
+    }
+    return lo;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file rtcm_replay.h
+ * @brief Memory-mapped, indexed replay of raw RTCM 3.x capture files.
+ *
+ * A capture (.rtcm3, raw frames concatenated as the caster sent them) is
+ * mapped read-only and split into frames in one pass with the same rules
+ * as rtcm_framer.c: resync on the 0xD3 preamble, reserved bits zero,
+ * CRC-24Q checked.  The resulting frame index is saved next to the file
+ * as "<file>.rtidx", keyed on the capture's size and mtime, so opening
+ * the same capture again costs one mapping instead of a scan.
+ *
+ * Frames are handed out as pointers into the mapping (no copy), so the
+ * replay loop is bound by the decoders, not by read calls.  Each index
+ * entry also carries a stream time derived from the MSM epoch times
+ * (GPS / Galileo / QZSS / BeiDou MSM, unwrapped across week rollovers),
+ * which lets a caller start at frame N or at a time offset into the
+ * capture with a binary search.
+ *
+ * Native captures (rtcm_capture.h) are recognised by their header and
+ * indexed from their record headers instead; their stream time is the
+ * recorded receive time.  The frames of a compressed native capture are
+ * unpacked one block at a time as they are asked for.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_REPLAY_H
+#define RTCM_REPLAY_H
+
+#include "file_map.h"
+#include "rtcm_capture.h"
+#include "stream_format.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct RtcmReplayFrame
+ * @brief One index entry (16 bytes, also the on-disk layout).
+ *
+ * Fields:
+ *   - offset:  Byte offset of the frame's 0xD3 preamble in the capture;
+ *              for a compressed capture the location from
+ *              rtcm_capture_next().
+ *   - length:  Whole frame length (header + payload + CRC).
+ *   - t_ms:    Stream time in ms since the first MSM epoch of the
+ *              capture; frames without an epoch time carry the last one.
+ *              For a native capture: receive time in ms since its start.
+ */
+typedef struct {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t t_ms;
+} RtcmReplayFrame;
+
+/**
+ * @struct RtcmReplay
+ * @brief A mapped and indexed capture.
+ *
+ * Fields:
+ *   - data:           Mapping of the capture.
+ *   - idx_map:        Mapping of the sidecar index, when loaded from it.
+ *   - frames:         Frame index, @c n_frames entries.
+ *   - owned:          Heap copy of the index when built here, else NULL.
+ *   - n_frames:       Number of CRC-valid frames.
+ *   - crc_errors:     Preamble candidates rejected on CRC while indexing.
+ *   - skipped_bytes:  Bytes outside any valid frame.
+ *   - index_cached:   true if the index came from the sidecar.
+ *   - native:         true for a native (.nacap) capture.
+ *   - start_unix_ns:  Native capture start time (Unix ns), 0 if unknown.
+ *   - packed:         Reader of a compressed capture (heap), else NULL.
+ *   - format:         STREAM_FMT_RTCM3, or for a file without a single
+ *                     RTCM frame what its head looks like (UBX, SBF or
+ *                     STREAM_FMT_UNKNOWN).
+ */
+typedef struct {
+    FileMap                data;
+    FileMap                idx_map;
+    const RtcmReplayFrame *frames;
+    RtcmReplayFrame       *owned;
+    size_t                 n_frames;
+    unsigned long          crc_errors;
+    unsigned long          skipped_bytes;
+    bool                   index_cached;
+    bool                   native;
+    int64_t                start_unix_ns;
+    RtcmCaptureReader     *packed;
+    StreamFormat           format;
+} RtcmReplay;
+
+/**
+ * @brief Map @p path and load or build its frame index.
+ *
+ * A freshly built index is written to "<path>.rtidx" when the directory
+ * is writable; failure to write it is not an error.
+ *
+ * @return false if the capture cannot be mapped or memory runs out.
+ */
+bool rtcm_replay_open(RtcmReplay *r, const char *path);
+
+/** @brief Release the mappings and the index.  Safe on a failed open. */
+void rtcm_replay_close(RtcmReplay *r);
+
+/**
+ * @brief Frame @p i of the capture, as a pointer into the mapping.
+ *
+ * For a compressed capture the pointer is into the current unpacked
+ * block and is valid until the next call.
+ *
+ * @param len  [out] Frame length in bytes.
+ * @return NULL only if a compressed capture changed on disk since it
+ *         was indexed.
+ */
+static inline const unsigned char *rtcm_replay_frame(const RtcmReplay *r,
+                                                     size_t i, int *len)
+{
+    *len = (int)r->frames[i].length;
+    if (r->packed) return rtcm_capture_frame_at(r->packed, r->frames[i].offset);
+    return r->data.data + r->frames[i].offset;
+}
+
+/** @brief Stream time covered by the capture, in ms (0 without MSM). */
+uint32_t rtcm_replay_duration_ms(const RtcmReplay *r);
+
+/**
+ * @brief First frame whose stream time is at or after @p t_ms.
+ * @return Frame index, or @c n_frames if the capture ends before @p t_ms.
+ */
+size_t rtcm_replay_find_time(const RtcmReplay *r, uint32_t t_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_REPLAY_H */
@@ -0,0 +1,52 @@
+/**
+ * @file rtcm_unpack.c
+ * @brief AVX2 kernel for the bulk field unpackers in rtcm_unpack.h.
+ *
+ * Compiled with a target attribute and only called after
+ * __builtin_cpu_supports("avx2"), so the default build still runs on
+ * any x86.  Each lane gathers the four bytes holding its field, swaps
+ * them to big-endian order, shifts the field's offset out at the top and
+ * shifts it down again, arithmetically for the signed arrays.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "rtcm_unpack.h"
+
+#ifdef RTCM_UNPACK_AVX2
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+int rtcm_unpack_avx2(const unsigned char *buf, int start_bit, int bit_len,
+                     int n, uint32_t *out, int is_signed)
+{
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i seven = _mm256_set1_epi32(7);
+    const __m256i step  = _mm256_set1_epi32(8 * bit_len);
+    const __m128i rs    = _mm_cvtsi32_si128(32 - bit_len);
+    __m256i pos = _mm256_add_epi32(_mm256_set1_epi32(start_bit),
+                                   _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                      _mm256_set1_epi32(bit_len)));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_i32gather_epi32((const int *)buf, _mm256_srli_epi32(pos, 3), 1);
+        w = _mm256_shuffle_epi8(w, bswap);
+        w = _mm256_sllv_epi32(w, _mm256_and_si256(pos, seven));
+        w = is_signed ? _mm256_sra_epi32(w, rs) : _mm256_srl_epi32(w, rs);
+        _mm256_storeu_si256((__m256i *)(out + i), w);
+        pos = _mm256_add_epi32(pos, step);
+    }
+    return i;
+}
+#endif
+
+const char *rtcm_unpack_impl(void)
+{
+#ifdef RTCM_UNPACK_AVX2
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+    return "scalar";
+}
@@ -0,0 +1,150 @@
+/**
+ * @file rtcm_unpack.h
+ * @brief Bulk unpacking of fixed-width RTCM field arrays.
+ *
+ * The MSM satellite and signal blocks are arrays of one field per
+ * satellite or cell, packed back to back (RTCM 10403.3 §3.5.12): a
+ * 32-satellite MSM7 on three signals has close to a hundred 20-bit
+ * fine pseudoranges in a row, then as many 24-bit phase ranges, and so
+ * on.  Reading those one field at a time through @ref rtcm_br_read
+ * re-does the bounds check and the cursor update per field; the
+ * functions here take the whole array at once:
+ *
+ *   - AVX2 (x86 with GCC or Clang, chosen at run time): eight fields
+ *     per step with a gathered 32-bit load per lane, a byte swap and
+ *     per-lane shifts; signed arrays are sign-extended by the arithmetic
+ *     shift
+ *   - otherwise a scalar loop with one 64-bit big-endian load per field
+ *     and the bounds check hoisted out of it
+ *
+ * Both give exactly what @ref rtcm_bits_at would, including zero bits
+ * past the end of the payload.  Fields up to @ref RTCM_UNPACK_MAX_BITS
+ * wide take the fast paths (every MSM array field does); wider ones fall
+ * back to @ref rtcm_bits_at.  Build with -DNTRIP_NO_SIMD to keep to the
+ * scalar loop.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef RTCM_UNPACK_H
+#define RTCM_UNPACK_H
+
+#include <stdint.h>
+
+#include "rtcm_bitreader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Widest field for the fast paths: with up to 7 bits of offset
+ *         it still fits one 32-bit load. */
+#define RTCM_UNPACK_MAX_BITS   25
+
+#if !defined(NTRIP_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define RTCM_UNPACK_AVX2 1
+
+/**
+ * @brief AVX2 kernel behind rtcm_unpack_u32() / rtcm_unpack_i32(); only
+ *        call it when __builtin_cpu_supports("avx2").
+ *
+ * All @p n fields must be safe for a 4-byte load from their first byte.
+ * @return Fields done, a multiple of eight; the rest are left.
+ */
+int rtcm_unpack_avx2(const unsigned char *buf, int start_bit, int bit_len,
+                     int n, uint32_t *out, int is_signed);
+#endif
+
+/* Leading fields whose @p window -byte load from their first byte stays
+ * inside the payload. */
+static inline int rtcm_unpack_within(int len_bytes, int start_bit, int bit_len,
+                                     int n, int window)
+{
+    long last = (long)(len_bytes - window) * 8 + 7 - start_bit;
+    if (len_bytes < window || last < 0) return 0;
+    long k = last / bit_len + 1;
+    return k < n ? (int)k : n;
+}
+
+/* Inline so the scalar loop keeps a constant width where the caller has
+ * one (the per-subtype MSM decoders). */
+static inline void rtcm_unpack(const unsigned char *buf, int len_bytes, int start_bit,
+                               int bit_len, int n, uint32_t *out, int is_signed)
+{
+    if (n <= 0) return;
+    if (bit_len < 1 || bit_len > 32 || len_bytes < 0) {
+        for (int i = 0; i < n; i++) out[i] = 0;
+        return;
+    }
+
+    int i = 0;
+#ifdef RTCM_UNPACK_AVX2
+    if (bit_len <= RTCM_UNPACK_MAX_BITS && n >= 8 && __builtin_cpu_supports("avx2"))
+        i = rtcm_unpack_avx2(buf, start_bit, bit_len,
+                             rtcm_unpack_within(len_bytes, start_bit, bit_len, n, 4),
+                             out, is_signed);
+#endif
+
+    /* One 64-bit load per field; the field sits in its top bits after
+     * shifting out the offset.  The signed variant relies on >> of a
+     * negative int64_t being arithmetic, as on every supported compiler. */
+    const int fast = rtcm_unpack_within(len_bytes, start_bit, bit_len, n, 8);
+    const int rs   = 64 - bit_len;
+    int pos = start_bit + i * bit_len;
+    for (; i < fast; i++, pos += bit_len) {
+        uint64_t w = rtcm_bits_load_be64(buf + (pos >> 3)) << (pos & 7);
+        out[i] = is_signed ? (uint32_t)(int32_t)((int64_t)w >> rs) : (uint32_t)(w >> rs);
+    }
+
+    for (; i < n; i++, pos += bit_len) {
+        uint64_t v = rtcm_bits_at(buf, len_bytes, pos, bit_len);
+        out[i] = is_signed ? (uint32_t)(int32_t)rtcm_bits_sign_extend(v, bit_len)
+                           : (uint32_t)v;
+    }
+}
+
+/**
+ * @brief Unpack @p n unsigned @p bit_len-bit fields (1..32) starting at
+ *        bit @p start_bit into @p out.
+ *
+ * @param len_bytes  Payload length; bits past it read as 0.  Must be
+ *                   known (>= 0).
+ */
+static inline void rtcm_unpack_u32(const unsigned char *buf, int len_bytes, int start_bit,
+                                   int bit_len, int n, uint32_t *out)
+{
+    rtcm_unpack(buf, len_bytes, start_bit, bit_len, n, out, 0);
+}
+
+/** @brief As rtcm_unpack_u32(), sign-extending each two's-complement field. */
+static inline void rtcm_unpack_i32(const unsigned char *buf, int len_bytes, int start_bit,
+                                   int bit_len, int n, int32_t *out)
+{
+    rtcm_unpack(buf, len_bytes, start_bit, bit_len, n, (uint32_t *)out, 1);
+}
+
+/** @brief Name of the unpacker in use: "avx2" or "scalar". */
+const char *rtcm_unpack_impl(void);
+
+/** @brief Read @p n unsigned fields at the cursor and advance past them. */
+static inline void rtcm_br_read_u32s(RtcmBitReader *br, int bit_len, int n, uint32_t *out)
+{
+    rtcm_unpack_u32(br->buf, br->len_bytes, br->pos, bit_len, n, out);
+    br->pos += bit_len * n;
+}
+
+/** @brief Read @p n signed fields at the cursor and advance past them. */
+static inline void rtcm_br_read_i32s(RtcmBitReader *br, int bit_len, int n, int32_t *out)
+{
+    rtcm_unpack_i32(br->buf, br->len_bytes, br->pos, bit_len, n, out);
+    br->pos += bit_len * n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RTCM_UNPACK_H */
@@ -0,0 +1,79 @@
+/**
+ * @file sat_vis.c
+ * @brief Per-epoch satellite visibility history.
+ *
+ * Closing an epoch writes its mask to the ring and walks only the PRNs
+ * that rose or set against the epoch before it, so the cost per epoch is
+ * the number of changes, not the number of PRNs in view.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sat_vis.h"
+
+static void close_epoch(SatVisHistory *h)
+{
+    SatMask  prev = sat_vis_at(h, 0);
+    SatMask  cur  = h->open;
+    uint32_t e    = ++h->n;
+
+    h->ring[e % SAT_VIS_EPOCHS] = cur;
+    h->time[e % SAT_VIS_EPOCHS] = h->open_time;
+    h->open     = 0;
+    h->has_open = false;
+
+    SatMask m = cur & ~prev;
+    for (int prn; (prn = sat_mask_next(&m)) != 0; ) {
+        int i = prn - 1;
+        if (h->passes[i] && e - h->last_seen[i] - 1 <= SAT_VIS_DROPOUT_EPOCHS) {
+            if (h->dropouts[i] < UINT16_MAX) h->dropouts[i]++;
+            h->dropouts_total++;
+        } else {
+            if (h->passes[i] < UINT16_MAX) h->passes[i]++;
+            h->pass_start[i] = e;
+        }
+    }
+    m = prev & ~cur;
+    for (int prn; (prn = sat_mask_next(&m)) != 0; )
+        h->last_seen[prn - 1] = e - 1;
+}
+
+void sat_vis_add(SatVisHistory *h, uint32_t epoch_time, SatMask prns)
+{
+    if (h->has_open && h->open_time != epoch_time)
+        close_epoch(h);
+    h->open     |= prns;
+    h->open_time = epoch_time;
+    h->has_open  = true;
+}
+
+void sat_vis_flush(SatVisHistory *h)
+{
+    if (h->has_open) close_epoch(h);
+}
+
+uint32_t sat_vis_pass_epochs(const SatVisHistory *h, int prn)
+{
+    if (!sat_mask_has(sat_vis_at(h, 0), prn)) return 0;
+    return h->n - h->pass_start[prn - 1] + 1;
+}
+
+uint32_t sat_vis_last_seen(const SatVisHistory *h, int prn)
+{
+    if (prn < 1 || prn > 64) return 0;
+    if (sat_mask_has(sat_vis_at(h, 0), prn)) return h->n;
+    return h->last_seen[prn - 1];
+}
+
+unsigned sat_vis_dropouts(const SatVisHistory *h, int prn)
+{
+    if (prn >= 1 && prn <= 64) return h->dropouts[prn - 1];
+    return prn == 0 ? h->dropouts_total : 0;
+}
+
+unsigned sat_vis_passes(const SatVisHistory *h, int prn)
+{
+    return (prn >= 1 && prn <= 64) ? h->passes[prn - 1] : 0;
+}
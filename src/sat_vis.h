@@ -0,0 +1,168 @@
+/**
+ * @file sat_vis.h
+ * @brief Satellite sets as 64-bit masks, and per-epoch visibility history.
+ *
+ * A @ref SatMask holds one GNSS's PRNs 1..64 in the bit order of the MSM
+ * satellite mask (DF394): PRN 1 is the most significant bit, so the mask
+ * of an MSM frame is @c RtcmMsmObs::sat_mask as it is.  Counting is a
+ * popcount, unions and intersections are | and &.
+ *
+ * @ref SatVisHistory keeps the masks of the last @ref SAT_VIS_EPOCHS MSM
+ * epochs of one GNSS in a ring, plus a few counters per PRN that are
+ * only touched when a PRN rises or sets:
+ *
+ *   - which PRNs were in view, rose or set at any epoch in the ring
+ *   - per PRN: epochs since its pass started, the last epoch it was in
+ *     view, passes and dropouts (gone for at most @ref SAT_VIS_DROPOUT_EPOCHS
+ *     epochs, then back: the same pass, but the receiver lost it)
+ *
+ * all in O(1).  Frames of one epoch (several MSM types, multiple-message
+ * bit) are merged into the open epoch; the first frame of a new epoch
+ * closes it.  About 4 KB per GNSS.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SAT_VIS_H
+#define SAT_VIS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief PRNs 1..64 of one GNSS, PRN 1 in the top bit (as DF394). */
+typedef uint64_t SatMask;
+
+/** @brief Closed epochs kept per GNSS (4 min at 1 Hz; 1 min with
+ *         NTRIP_SMALL_FOOTPRINT). */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define SAT_VIS_EPOCHS          64
+#else
+#define SAT_VIS_EPOCHS          256
+#endif
+
+/** @brief A PRN back within this many epochs continues its pass. */
+#define SAT_VIS_DROPOUT_EPOCHS  10
+
+/** @brief Mask with only @p prn (1..64); 0 for anything else. */
+static inline SatMask sat_mask_bit(int prn)
+{
+    return (prn >= 1 && prn <= 64) ? (SatMask)1 << (64 - prn) : 0;
+}
+
+/** @brief Whether @p prn is in @p m. */
+static inline bool sat_mask_has(SatMask m, int prn)
+{
+    return (m & sat_mask_bit(prn)) != 0;
+}
+
+/** @brief PRNs in @p m. */
+static inline int sat_mask_count(SatMask m)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(m);
+#else
+    m = m - ((m >> 1) & 0x5555555555555555ULL);
+    m = (m & 0x3333333333333333ULL) + ((m >> 2) & 0x3333333333333333ULL);
+    m = (m + (m >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((m * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * @brief Lowest PRN left in @p *m, removed from it; 0 once it is empty.
+ *
+ * @code
+ * for (SatMask m = seen; (prn = sat_mask_next(&m)) != 0; ) ...
+ * @endcode
+ */
+static inline int sat_mask_next(SatMask *m)
+{
+    if (!*m) return 0;
+#if defined(__GNUC__)
+    int prn = __builtin_clzll(*m) + 1;
+#else
+    int prn = 1;
+    while (!(*m & sat_mask_bit(prn))) prn++;
+#endif
+    *m &= ~sat_mask_bit(prn);
+    return prn;
+}
+
+/**
+ * @struct SatVisHistory
+ * @brief Visibility of one GNSS per epoch.  All zero is empty.
+ *
+ * Epochs are numbered 1, 2, ... as they close; @c ring holds the last
+ * SAT_VIS_EPOCHS of them.  The per-PRN arrays are indexed by PRN - 1.
+ */
+typedef struct {
+    SatMask  open;                        /**< PRNs of the epoch being merged */
+    uint32_t open_time;                   /**< Its MSM epoch time (DF004 etc.) */
+    bool     has_open;
+    uint32_t n;                           /**< Epochs closed */
+    SatMask  ring[SAT_VIS_EPOCHS];        /**< Epoch e at ring[e % SAT_VIS_EPOCHS] */
+    uint32_t time[SAT_VIS_EPOCHS];        /**< MSM epoch time of the same */
+    uint32_t pass_start[64];              /**< Epoch the current / last pass started */
+    uint32_t last_seen[64];               /**< Last epoch in view before it set; 0 = never set */
+    uint16_t passes[64];
+    uint16_t dropouts[64];
+    unsigned dropouts_total;              /**< Sum of dropouts[] */
+} SatVisHistory;
+
+/**
+ * @brief Merge the PRNs of one MSM frame of epoch @p epoch_time; a
+ *        different epoch time closes the open epoch first.
+ */
+void sat_vis_add(SatVisHistory *h, uint32_t epoch_time, SatMask prns);
+
+/** @brief Close the open epoch, if any (end of stream). */
+void sat_vis_flush(SatVisHistory *h);
+
+/** @brief PRNs in view @p ago closed epochs back (0 = the newest); 0 past the ring. */
+static inline SatMask sat_vis_at(const SatVisHistory *h, uint32_t ago)
+{
+    if (ago >= h->n || ago >= SAT_VIS_EPOCHS) return 0;
+    return h->ring[(h->n - ago) % SAT_VIS_EPOCHS];
+}
+
+/** @brief PRNs in view now: the open epoch, else the newest closed one. */
+static inline SatMask sat_vis_now(const SatVisHistory *h)
+{
+    return h->has_open ? h->open : sat_vis_at(h, 0);
+}
+
+/** @brief PRNs that rose at the epoch @p ago back (in view there, not at the one before). */
+static inline SatMask sat_vis_rose(const SatVisHistory *h, uint32_t ago)
+{
+    return sat_vis_at(h, ago) & ~sat_vis_at(h, ago + 1);
+}
+
+/** @brief PRNs that set at the epoch @p ago back (gone there, in view the one before). */
+static inline SatMask sat_vis_set(const SatVisHistory *h, uint32_t ago)
+{
+    return ~sat_vis_at(h, ago) & sat_vis_at(h, ago + 1);
+}
+
+/** @brief Closed epochs @p prn has been in view in its current pass; 0 when not in view. */
+uint32_t sat_vis_pass_epochs(const SatVisHistory *h, int prn);
+
+/** @brief Last closed epoch @p prn was in view; 0 = never. */
+uint32_t sat_vis_last_seen(const SatVisHistory *h, int prn);
+
+/** @brief Dropouts of @p prn, summed over all PRNs for @p prn = 0. */
+unsigned sat_vis_dropouts(const SatVisHistory *h, int prn);
+
+/** @brief Passes of @p prn (rises after more than SAT_VIS_DROPOUT_EPOCHS away). */
+unsigned sat_vis_passes(const SatVisHistory *h, int prn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAT_VIS_H */
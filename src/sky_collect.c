@@ -8,10 +8,13 @@
  */
 
 #include "sky_collect.h"
+#include "sky_epoch.h"
+#include "sky_grid.h"
 #include "sky_render.h"
 #include "rtcm3x_parser.h"
 #include "sv_ephemeris.h"
 #include "sv_orbit.h"
+#include "stream_clock.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -22,46 +25,18 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-/* ── Time helpers (mirror gui_thread.c sky_get_gps_time / sky_get_glo_tod) */
-static void sky_get_gps_time_now(int *week, double *tow_s)
-{
-    const time_t GPS_EPOCH_UNIX = 315964800;   /* 1980-01-06 UTC */
-    time_t now = time(NULL);
-    double delta = (double)(now - GPS_EPOCH_UNIX);
-    int w = (int)(delta / 604800.0);
-    if (week)  *week  = w;
-    if (tow_s) *tow_s = delta - (double)w * 604800.0;
-}
+/* Geodetic position and ENU rotation of the last station fed in; only
+ * rebuilt when the ARP changes. */
+static StationFrame s_frame;
 
-static double sky_get_glo_tod_now(void)
-{
-    time_t now = time(NULL);
-    double utc_sod = (double)(now % 86400);
-    double msk = utc_sod + 10800.0;
-    while (msk >= 86400.0) msk -= 86400.0;
-    while (msk <    0.0)   msk += 86400.0;
-    return msk;
-}
+/* MSM frames are merged per (GNSS, epoch) before they reach the sectors;
+ * s_sx/s_sy/s_sz is the ARP of the latest frame, used by
+ * sky_collect_flush(). */
+static SkyEpochAssembler s_epochs;
+static double s_sx, s_sy, s_sz;
 
-/* ── Geometry helpers (mirror gui_state.h SKY_N_EL_BANDS layout) ─────── */
-static void azel_to_sector(double az_deg, double el_deg,
-                           int *band_out, int *bin_out)
-{
-    int band = (int)(el_deg / 10.0);
-    if (band < 0) band = 0;
-    if (band >= SKY_RENDER_N_EL_BANDS) band = SKY_RENDER_N_EL_BANDS - 1;
-    int n_bins = sky_render_az_bins_per_band[band];
-    int bin = 0;
-    if (n_bins > 1) {
-        if (az_deg < 0.0)   az_deg += 360.0;
-        if (az_deg >= 360.0) az_deg -= 360.0;
-        bin = (int)(az_deg * (double)n_bins / 360.0);
-        if (bin < 0) bin = 0;
-        if (bin >= n_bins) bin = n_bins - 1;
-    }
-    if (band_out) *band_out = band;
-    if (bin_out)  *bin_out  = bin;
-}
+/* sky_collect_set_observed_only(): `expected` comes from a baseline. */
+static bool s_observed_only;
 
 /* ── Public API ──────────────────────────────────────────────────────── */
 void sky_collect_reset(SkyRenderSector *sectors)
@@ -70,22 +45,15 @@ void sky_collect_reset(SkyRenderSector *sectors)
     memset(sectors, 0,
            sizeof(SkyRenderSector) *
            SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS);
+    sky_epoch_init(&s_epochs);
 }
 
-int sky_collect_feed_msm(SkyRenderSector *sectors,
-                         const unsigned char *payload, int payload_len,
-                         int msg_type,
-                         double sx, double sy, double sz)
+/* Sector update for one assembled epoch. */
+static int sky_collect_feed_mask(SkyRenderSector *sectors, int gnss_id,
+                                 uint64_t obs_mask,
+                                 double sx, double sy, double sz)
 {
-    if (!sectors || !payload || payload_len < 14) return 0;
-    int subtype = msg_type % 10;
-    if (msg_type < 1070 || msg_type > 1139 || subtype < 4 || subtype > 7) return 0;
-
-    int prns[64];
-    int gnss_id = 0;
-    int n_prns = msm_extract_prns(payload, payload_len, msg_type,
-                                  prns, 64, &gnss_id);
-    if (n_prns <= 0 || gnss_id == 0) return 0;
+    if (obs_mask == 0 || gnss_id == 0) return 0;
 
     /* The GUI gates the sky update to gnss_id in {1,2,3,4,5,7}; NavIC (7)
      * shares the GPS-style Keplerian propagator.  Anything else either
@@ -96,37 +64,136 @@ int sky_collect_feed_msm(SkyRenderSector *sectors,
 
     int gps_week;
     double gps_tow;
-    sky_get_gps_time_now(&gps_week, &gps_tow);
-    double glo_tod = sky_get_glo_tod_now();
+    stream_clock_gps_time(&gps_week, &gps_tow);
+    double glo_tod = stream_clock_glo_tod();
     double t_prop  = (gnss_id == 2) ? glo_tod : gps_tow;
 
-    /* O(1) "was this PRN observed this frame?" test. */
-    uint64_t obs_mask = 0;
-    for (int i = 0; i < n_prns; i++) {
-        int p = prns[i];
-        if (p >= 1 && p <= 64) obs_mask |= (uint64_t)1 << (p - 1);
-    }
-
-    int contributed = 0;
+    /* Every SV with a usable ephemeris, propagated in one batch. */
+    const SvEphemeris *ephs[SV_EPH_MAX_SATS_PER_GNSS];
+    int    eph_prn[SV_EPH_MAX_SATS_PER_GNSS];
+    double svx[SV_EPH_MAX_SATS_PER_GNSS], svy[SV_EPH_MAX_SATS_PER_GNSS];
+    double svz[SV_EPH_MAX_SATS_PER_GNSS];
+    bool   sv_ok[SV_EPH_MAX_SATS_PER_GNSS];
+    int    n_eph = 0;
     for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
-        const SvEphemeris *eph = sv_eph_get(gnss_id, p);
+        if (s_observed_only && !((obs_mask >> (p - 1)) & 1ULL)) continue;
+        const SvEphemeris *eph = sv_eph_get_at(gnss_id, p, gps_week, t_prop);
         if (!eph) continue;
-        if (!sv_eph_is_valid_at(eph, gps_week, t_prop)) continue;
+        ephs[n_eph]    = eph;
+        eph_prn[n_eph] = p;
+        n_eph++;
+    }
+    sv_to_ecef_cached_batch(ephs, n_eph, gps_week, t_prop,
+                            svx, svy, svz, sv_ok);
+    station_frame_set(&s_frame, sx, sy, sz);
 
-        double svx, svy, svz;
-        if (!sv_to_ecef(eph, gps_week, t_prop, &svx, &svy, &svz)) continue;
+    int contributed = 0;
+    for (int k = 0; k < n_eph; k++) {
+        if (!sv_ok[k]) continue;
+        int p = eph_prn[k];
 
         double az_d, el_d;
-        azel_from_ecef(sx, sy, sz, svx, svy, svz, &az_d, &el_d);
+        azel_from_ecef_frame(&s_frame, svx[k], svy[k], svz[k], &az_d, &el_d);
         if (el_d <= 0.0) continue;
 
-        int band, bin;
-        azel_to_sector(az_d, el_d, &band, &bin);
-        SkyRenderSector *s = &sectors[band * SKY_RENDER_MAX_AZ_BINS + bin];
-        s->expected++;
+        SkyRenderSector *s = &sectors[sky_grid_sector(az_d, el_d)];
+        if (!s_observed_only) s->expected++;
         if (p >= 1 && p <= 64 && ((obs_mask >> (p - 1)) & 1ULL))
             s->observed++;
         contributed++;
     }
     return contributed;
 }
+
+void sky_collect_set_observed_only(bool on)
+{
+    s_observed_only = on;
+}
+
+int sky_collect_feed_epoch(SkyRenderSector *sectors, const SkyEpoch *ep,
+                           double sx, double sy, double sz)
+{
+    if (!sectors || !ep) return 0;
+    return sky_collect_feed_mask(sectors, ep->gnss_id, ep->obs_mask,
+                                 sx, sy, sz);
+}
+
+/* Shared body of the two per-frame entry points: PRN list extracted. */
+static int sky_collect_feed_prns(SkyRenderSector *sectors, int gnss_id,
+                                 uint16_t station_id, uint32_t epoch_time,
+                                 const int *prns, int n_prns,
+                                 double sx, double sy, double sz)
+{
+    /* The epoch being closed is scored against the ARP it was collected
+     * with, normally equal to the current one. */
+    double psx = s_sx, psy = s_sy, psz = s_sz;
+    s_sx = sx;
+    s_sy = sy;
+    s_sz = sz;
+
+    if (n_prns <= 0) return 0;
+    SkyEpoch done;
+    if (!sky_epoch_add(&s_epochs, gnss_id, station_id, epoch_time,
+                       prns, NULL, n_prns, &done))
+        return 0;
+    return sky_collect_feed_epoch(sectors, &done, psx, psy, psz);
+}
+
+int sky_collect_feed_msm(SkyRenderSector *sectors,
+                         const unsigned char *payload, int payload_len,
+                         int msg_type,
+                         double sx, double sy, double sz)
+{
+    if (!sectors || !payload || payload_len < 14) return 0;
+    if (!rtcm_msg_is_msm(msg_type, 4, 7)) return 0;
+
+    int prns[64];
+    int gnss_id = 0;
+    int n_prns = msm_extract_prns(payload, payload_len, msg_type,
+                                  prns, 64, &gnss_id);
+    uint16_t station_id = 0;
+    uint32_t epoch_time = 0;
+    sky_epoch_read_header(payload, payload_len, &station_id, &epoch_time);
+    return sky_collect_feed_prns(sectors, gnss_id, station_id, epoch_time,
+                                 prns, n_prns, sx, sy, sz);
+}
+
+int sky_collect_feed_msm_obs(SkyRenderSector *sectors,
+                             const RtcmMsmObs *obs,
+                             double sx, double sy, double sz)
+{
+    if (!sectors || !obs) return 0;
+    if (obs->msm_subtype < 4 || obs->msm_subtype > 7) return 0;
+
+    int prns[RTCM_MSM_MAX_SATS];
+    int n_prns = rtcm_msm_obs_prns(obs, prns, RTCM_MSM_MAX_SATS);
+    return sky_collect_feed_prns(sectors, obs->gnss_id, obs->ref_station_id,
+                                 obs->epoch_time, prns, n_prns, sx, sy, sz);
+}
+
+int sky_collect_flush(SkyRenderSector *sectors)
+{
+    SkyEpoch eps[SKY_EPOCH_MAX_GNSS];
+    int n = sky_epoch_flush(&s_epochs, eps, SKY_EPOCH_MAX_GNSS);
+    int contributed = 0;
+    for (int i = 0; i < n; i++)
+        contributed += sky_collect_feed_epoch(sectors, &eps[i],
+                                              s_sx, s_sy, s_sz);
+    return contributed;
+}
+
+void sky_collect_save(SkyCollectState *st)
+{
+    st->epochs = s_epochs;
+    st->sx = s_sx;
+    st->sy = s_sy;
+    st->sz = s_sz;
+}
+
+void sky_collect_restore(const SkyCollectState *st)
+{
+    s_epochs = st->epochs;
+    s_sx = st->sx;
+    s_sy = st->sy;
+    s_sz = st->sz;
+}
@@ -4,12 +4,16 @@
  *
  * Accumulates observed/expected counts per sector of the polar sky grid
  * (mirroring gui_state.h SKY_N_EL_BANDS / sky_az_bins_per_band[]).  Each
- * incoming MSM4/5/6/7 RTCM frame is fed in via sky_collect_feed_msm(),
- * which walks all cached ephemerides for that GNSS, propagates them to
- * the station ARP frame, and bumps the corresponding sector counter.
+ * incoming MSM4/5/6/7 RTCM frame is fed in via sky_collect_feed_msm().
+ * Frames are merged per (GNSS, epoch) by a @ref SkyEpochAssembler; once
+ * an epoch is complete the collector walks all cached ephemerides for
+ * that GNSS, propagates them to the station ARP frame, and bumps the
+ * corresponding sector counter, so stations sending several MSM types per
+ * epoch are not counted once per type.
  *
- * No GUI / no threading state of its own.  Intended to be driven from
- * src/main.c when `-s --sky` is set.
+ * No GUI / no threading; the assembler is file-static, so one collector
+ * per process.  Intended to be driven from src/main.c when `-s --sky` is
+ * set.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -20,13 +24,27 @@
 #define SKY_COLLECT_H
 
 #include "sky_render.h"
+#include "rtcm3x_parser.h"
+#include "sky_epoch.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Reset all sector counters to zero.
+ * @struct SkyCollectState
+ * @brief What the collector carries from one frame to the next besides
+ *        the grid: the epochs being assembled and the ARP of the latest
+ *        frame.  Plain data, saved in replay keyframes.
+ */
+typedef struct {
+    SkyEpochAssembler epochs;
+    double            sx, sy, sz;
+} SkyCollectState;
+
+/**
+ * @brief Reset all sector counters to zero and drop any partly
+ *        assembled epoch.
  *
  * @param sectors Pointer to a SkyRenderSector grid of
  *   SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS slots.
@@ -34,26 +52,81 @@ extern "C" {
 void sky_collect_reset(SkyRenderSector *sectors);
 
 /**
- * @brief Update sector counters from one parsed MSM RTCM frame.
+ * @brief Count @c observed only, for a grid whose @c expected counts come
+ *        from a precomputed baseline (sky_expect.h, `--sky --expected`).
  *
- * Mirrors the obs-worker sky-update block in gui_thread.c: for every SV
- * in the same GNSS as this MSM that has a valid cached ephemeris and
- * lands above the horizon, increment that sector's `expected` counter
- * (and `observed` too if the SV's PRN was in the MSM sat mask).
+ * Only the SVs in an epoch's sat masks are then looked up and propagated
+ * -- typically half of those with a usable ephemeris or fewer -- and the
+ * return values count the observed SVs above the horizon.
+ */
+void sky_collect_set_observed_only(bool on);
+
+/**
+ * @brief Feed one parsed MSM RTCM frame into the epoch assembler.
+ *
+ * Mirrors the obs-worker sky-update block in gui_thread.c.  The frame is
+ * merged into the open epoch of its GNSS; when it starts a new epoch, the
+ * previous one is scored: for every SV in that GNSS that has a valid
+ * cached ephemeris and lands above the horizon, increment that sector's
+ * `expected` counter (and `observed` too if the SV's PRN was in any of
+ * the epoch's sat masks).  Call sky_collect_flush() after the last frame.
  *
  * @param sectors      Sector grid as for sky_collect_reset().
  * @param payload      Pointer to the RTCM frame payload (after 3-byte header).
  * @param payload_len  Payload length in bytes.
  * @param msg_type     RTCM message type (must be 1074..1137 with subtype 4..7).
  * @param sx,sy,sz     Station ARP position in ECEF metres.
- * @return number of SVs that contributed an above-horizon update, or 0 if
- *   the frame was ignored (not an MSM4..7, bad station ARP, no eph).
+ * @return number of SVs that contributed an above-horizon update for the
+ *   epoch this frame closed, or 0 if it closed none (or the frame was
+ *   ignored: not an MSM4..7, bad station ARP, no eph).
  */
 int sky_collect_feed_msm(SkyRenderSector *sectors,
                          const unsigned char *payload, int payload_len,
                          int msg_type,
                          double sx, double sy, double sz);
 
+/**
+ * @brief Same as sky_collect_feed_msm() for a frame already decoded with
+ *        rtcm_decode_msm(), so callers that also need the cells do not
+ *        parse the payload twice.
+ *
+ * @param sectors  Sector grid as for sky_collect_reset().
+ * @param obs      Decoded MSM frame (subtype 4..7).
+ * @param sx,sy,sz Station ARP position in ECEF metres.
+ * @return As sky_collect_feed_msm().
+ */
+int sky_collect_feed_msm_obs(SkyRenderSector *sectors,
+                             const RtcmMsmObs *obs,
+                             double sx, double sy, double sz);
+
+/**
+ * @brief Score one assembled epoch directly, bypassing the collector's
+ *        own assembler.
+ *
+ * @param sectors  Sector grid as for sky_collect_reset().
+ * @param ep       Epoch from sky_epoch_add() / sky_epoch_flush().
+ * @param sx,sy,sz Station ARP position in ECEF metres.
+ * @return As sky_collect_feed_msm().
+ */
+int sky_collect_feed_epoch(SkyRenderSector *sectors, const SkyEpoch *ep,
+                           double sx, double sy, double sz);
+
+/**
+ * @brief Score every epoch still being assembled (end of run).
+ *
+ * Uses the ARP passed with the most recent frame.
+ *
+ * @param sectors  Sector grid as for sky_collect_reset().
+ * @return Number of SV updates contributed.
+ */
+int sky_collect_flush(SkyRenderSector *sectors);
+
+/** @brief Copy the collector's state to @p st. */
+void sky_collect_save(SkyCollectState *st);
+
+/** @brief Continue from state saved by sky_collect_save(). */
+void sky_collect_restore(const SkyCollectState *st);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,78 @@
+/**
+ * @file sky_epoch.c
+ * @brief Per-GNSS MSM epoch assembler for the sky heatmap.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sky_epoch.h"
+#include "rtcm_bitreader.h"
+
+#include <string.h>
+
+void sky_epoch_init(SkyEpochAssembler *a)
+{
+    memset(a, 0, sizeof(*a));
+}
+
+bool sky_epoch_read_header(const unsigned char *payload, int payload_len,
+                           uint16_t *station_id, uint32_t *epoch_time)
+{
+    /* 12 msg_number, 12 ref_station_id, 30 epoch_time (RTCM 10403.3). */
+    if (!payload || payload_len < 7) return false;
+    if (station_id) *station_id = (uint16_t)get_bits(payload, 12, 12);
+    if (epoch_time) *epoch_time = (uint32_t)get_bits(payload, 24, 30);
+    return true;
+}
+
+bool sky_epoch_add(SkyEpochAssembler *a, int gnss_id,
+                   uint16_t station_id, uint32_t epoch_time,
+                   const int *prns, const float *cnr_dbhz, int n_prns,
+                   SkyEpoch *done)
+{
+    if (gnss_id <= 0 || gnss_id >= SKY_EPOCH_MAX_GNSS) return false;
+    a->frames++;
+
+    SkyEpoch *ep = &a->open[gnss_id];
+    bool closed = false;
+    if (a->is_open[gnss_id] &&
+        (ep->epoch_time != epoch_time || ep->station_id != station_id)) {
+        if (done) *done = *ep;
+        a->epochs++;
+        a->is_open[gnss_id] = false;
+        closed = true;
+    }
+    if (!a->is_open[gnss_id]) {
+        memset(ep, 0, sizeof(*ep));
+        ep->gnss_id    = gnss_id;
+        ep->station_id = station_id;
+        ep->epoch_time = epoch_time;
+        a->is_open[gnss_id] = true;
+    }
+
+    for (int i = 0; i < n_prns; i++) {
+        int p = prns[i];
+        if (p < 1 || p > 64) continue;
+        ep->obs_mask |= (uint64_t)1 << (p - 1);
+        if (cnr_dbhz && cnr_dbhz[i] > ep->cnr_dbhz[p])
+            ep->cnr_dbhz[p] = cnr_dbhz[i];
+    }
+    ep->n_frames++;
+    return closed;
+}
+
+int sky_epoch_flush(SkyEpochAssembler *a, SkyEpoch *out, int max_out)
+{
+    int n = 0;
+    for (int g = 0; g < SKY_EPOCH_MAX_GNSS; g++) {
+        if (!a->is_open[g]) continue;
+        if (n < max_out) {
+            out[n++] = a->open[g];
+            a->epochs++;
+        }
+        a->is_open[g] = false;
+    }
+    return n;
+}
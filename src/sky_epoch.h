@@ -0,0 +1,129 @@
+/**
+ * @file sky_epoch.h
+ * @brief Per-GNSS MSM epoch assembler for the sky heatmap.
+ *
+ * Many mountpoints send several MSM flavours for one constellation in the
+ * same epoch (e.g. 1074 + 1077), or split one epoch over several frames
+ * with the multiple-message bit set.  Running the sky update per frame
+ * then propagates every ephemeris several times and counts each sector's
+ * "expected" SVs once per frame instead of once per epoch.
+ *
+ * The assembler keys frames on (GNSS, reference station ID, MSM epoch
+ * time), merges their satellite masks and best per-SV CNR, and hands out
+ * one @ref SkyEpoch when the epoch is complete, so the caller runs the sky
+ * propagation once per epoch.
+ *
+ * An epoch is complete when a frame with a different epoch time (or
+ * station) arrives for the same GNSS, or when sky_epoch_flush() is called
+ * at the end of a stream.  The multiple-message bit is not relied on:
+ * casters that send 1074 and 1077 often clear it on both.  The cost is
+ * one epoch of latency per GNSS.
+ *
+ * Plain data, no locking: one assembler per producer thread.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_EPOCH_H
+#define SKY_EPOCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief GNSS IDs handled, indexed directly (see RtcmMsgInfo::gnss_id). */
+#define SKY_EPOCH_MAX_GNSS 8
+
+/**
+ * @struct SkyEpoch
+ * @brief All MSM frames of one GNSS for one epoch, merged.
+ *
+ * Fields:
+ *   - gnss_id:     GNSS ID (1..7).
+ *   - station_id:  Reference station ID (DF003).
+ *   - epoch_time:  MSM epoch time, 30 bits, GNSS-specific.
+ *   - obs_mask:    Bit (p-1) set if PRN p was in any frame's sat mask.
+ *   - cnr_dbhz:    Best CNR per PRN across the frames (index = PRN, 0 = none).
+ *   - n_frames:    Number of frames merged.
+ */
+typedef struct {
+    int      gnss_id;
+    uint16_t station_id;
+    uint32_t epoch_time;
+    uint64_t obs_mask;
+    float    cnr_dbhz[65];
+    int      n_frames;
+} SkyEpoch;
+
+/**
+ * @struct SkyEpochAssembler
+ * @brief One open epoch per GNSS plus counters.
+ *
+ * Fields:
+ *   - open:        Epoch being assembled, per GNSS ID.
+ *   - is_open:     Whether @c open[g] holds data.
+ *   - frames:      Frames fed in.
+ *   - epochs:      Epochs handed out.
+ */
+typedef struct {
+    SkyEpoch open[SKY_EPOCH_MAX_GNSS];
+    bool     is_open[SKY_EPOCH_MAX_GNSS];
+    long     frames;
+    long     epochs;
+} SkyEpochAssembler;
+
+/** @brief Clear @p a, discarding any open epoch. */
+void sky_epoch_init(SkyEpochAssembler *a);
+
+/**
+ * @brief Read the reference station ID and epoch time from an MSM header.
+ *
+ * @param payload      RTCM payload (starting at the message number).
+ * @param payload_len  Payload length in bytes.
+ * @param station_id   [out] DF003.
+ * @param epoch_time   [out] 30-bit GNSS epoch time.
+ * @return false if the payload is too short for the header.
+ */
+bool sky_epoch_read_header(const unsigned char *payload, int payload_len,
+                           uint16_t *station_id, uint32_t *epoch_time);
+
+/**
+ * @brief Add one MSM frame.
+ *
+ * @param a           Assembler.
+ * @param gnss_id     GNSS ID of the frame (1..7).
+ * @param station_id  Reference station ID (DF003).
+ * @param epoch_time  MSM epoch time.
+ * @param prns        PRNs in the frame's sat mask.
+ * @param cnr_dbhz    Best CNR per entry of @p prns, or NULL if the frame
+ *                    carries none.
+ * @param n_prns      Number of entries in @p prns.
+ * @param done        [out] Receives the previous epoch of this GNSS if this
+ *                    frame closed it.
+ * @return true if @p done was filled.
+ */
+bool sky_epoch_add(SkyEpochAssembler *a, int gnss_id,
+                   uint16_t station_id, uint32_t epoch_time,
+                   const int *prns, const float *cnr_dbhz, int n_prns,
+                   SkyEpoch *done);
+
+/**
+ * @brief Hand out every open epoch (end of stream).
+ *
+ * @param a        Assembler; left empty.
+ * @param out      Receives up to @p max_out epochs.
+ * @param max_out  Capacity of @p out; SKY_EPOCH_MAX_GNSS is always enough.
+ * @return Number of epochs written.
+ */
+int sky_epoch_flush(SkyEpochAssembler *a, SkyEpoch *out, int max_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_EPOCH_H */
@@ -0,0 +1,161 @@
+/**
+ * @file sky_expect.c
+ * @brief Expected-coverage grids computed without a stream (`--sky-expected`).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sky_expect.h"
+#include "stream_clock.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define SKYX_N_SECTORS  (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+#define SKYX_WEEK_MS    604800000LL
+#define SKYX_DAY_MS     86400000LL
+
+/* GNSS IDs with an ephemeris propagator, as sky_multi.c. */
+#define SKYX_GNSS_ALL   ((1u << 1) | (1u << 2) | (1u << 3) | (1u << 4) | (1u << 5) | (1u << 7))
+
+typedef struct {
+    const SkyExpectSpan *span;
+    long long            lo, hi;    /**< epoch indices */
+    SkyMulti            *m;         /**< this slice's stations */
+    long long            updates;
+} SkyExpectSlice;
+
+/* MSM epoch time of @p gnss_id at @p gps_ms (ms since the GPS epoch) and
+ * @p unix_ms. */
+static uint32_t skyx_epoch_time(int gnss_id, int64_t gps_ms, int64_t unix_ms)
+{
+    if (gnss_id == 2)                                  /* DF034: Moscow time of day */
+        return (uint32_t)((unix_ms + 3 * 3600000LL) % SKYX_DAY_MS);
+    int64_t tow = gps_ms % SKYX_WEEK_MS;
+    if (gnss_id == 5)                                  /* BDT = GPST - 14 s */
+        tow = (tow - 14000 + SKYX_WEEK_MS) % SKYX_WEEK_MS;
+    return (uint32_t)tow;
+}
+
+static void skyx_slice(SkyExpectSlice *w)
+{
+    const SkyExpectSpan *s = w->span;
+    uint32_t mask = s->gnss_mask ? s->gnss_mask & SKYX_GNSS_ALL : SKYX_GNSS_ALL;
+    for (long long k = w->lo; k < w->hi; k++) {
+        int64_t unix_ms = s->start_unix * 1000 + k * s->step_ms;
+        int64_t unix_s  = unix_ms / 1000;
+        int64_t gps_ms  = stream_clock_unix_to_gps_ms(unix_s) + (unix_ms - unix_s * 1000);
+        for (int g = 1; g < SKY_EPOCH_MAX_GNSS; g++) {
+            if (!((mask >> g) & 1u)) continue;
+            w->updates += sky_multi_expect(w->m, g, skyx_epoch_time(g, gps_ms, unix_ms));
+        }
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall skyx_thread(void *arg)
+{
+    skyx_slice((SkyExpectSlice *)arg);
+    return 0;
+}
+#else
+static void *skyx_thread(void *arg)
+{
+    skyx_slice((SkyExpectSlice *)arg);
+    return NULL;
+}
+#endif
+
+static int skyx_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+long long sky_expect_run(SkyMulti *m, const SkyExpectSpan *span)
+{
+    if (!m || !span || span->span_s <= 0 || span->step_ms <= 0) return 0;
+    long long n_epochs = ((long long)span->span_s * 1000 + span->step_ms - 1) / span->step_ms;
+    int jobs = span->jobs > 0 ? span->jobs : skyx_cpu_count();
+    if (jobs > SKY_EXPECT_MAX_JOBS) jobs = SKY_EXPECT_MAX_JOBS;
+    if (jobs > n_epochs) jobs = (int)n_epochs;
+
+    /* Every slice gets its own grids and position cache; the stations'
+     * frames are copied so the slices can project on their own. */
+    SkyExpectSlice w[SKY_EXPECT_MAX_JOBS];
+    memset(w, 0, sizeof(w));
+    for (int t = 0; t < jobs; t++) {
+        w[t].span = span;
+        w[t].lo   = n_epochs * t / jobs;
+        w[t].hi   = n_epochs * (t + 1) / jobs;
+        w[t].m    = sky_multi_new(m->n);
+        if (!w[t].m) {
+            fprintf(stderr, "[ERROR] Out of memory computing the expected grids\n");
+            for (int u = 0; u < t; u++) sky_multi_free(w[u].m);
+            return -1;
+        }
+        for (int i = 0; i < m->n; i++) w[t].m->st[i].frame = m->st[i].frame;
+    }
+
+#ifdef _WIN32
+    HANDLE threads[SKY_EXPECT_MAX_JOBS];
+#else
+    pthread_t threads[SKY_EXPECT_MAX_JOBS];
+#endif
+    bool started[SKY_EXPECT_MAX_JOBS] = { false };
+    /* Slice 0 is this thread's; a slice whose thread did not start is
+     * run here as well. */
+    for (int t = 1; t < jobs; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, skyx_thread, &w[t], 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, skyx_thread, &w[t]) == 0;
+#endif
+    }
+    skyx_slice(&w[0]);
+    for (int t = 1; t < jobs; t++) {
+        if (!started[t]) {
+            skyx_slice(&w[t]);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+
+    long long updates = 0;
+    for (int t = 0; t < jobs; t++) {
+        for (int i = 0; i < m->n; i++) {
+            const SkyRenderSector *src = w[t].m->st[i].sectors;
+            SkyRenderSector *dst = m->st[i].sectors;
+            for (int k = 0; k < SKYX_N_SECTORS; k++) dst[k].expected += src[k].expected;
+            m->st[i].updates += w[t].m->st[i].updates;
+        }
+        m->propagated += w[t].m->propagated;
+        updates += w[t].updates;
+        sky_multi_free(w[t].m);
+    }
+    return updates;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file sky_expect.h
+ * @brief Expected-coverage grids computed without a stream (`--sky-expected`).
+ *
+ * The @c expected count of a sector depends only on the orbits and the
+ * station: which SVs that have an ephemeris are above the horizon at each
+ * epoch.  sky_expect_run() computes it for a time span ahead of (or
+ * after) the collection, from the ephemerides in the store (loaded with
+ * `-R` or `--eph-cache`), so the live run only has to count what it
+ * observes (sky_collect_set_observed_only()) and propagates just the SVs
+ * in each epoch's masks.
+ *
+ * The epochs of the span are cut into contiguous slices, one per thread,
+ * each with its own SkyMulti -- the satellite positions of an epoch are
+ * still propagated once for all stations -- and the grids are summed at
+ * the end, so the result does not depend on the number of threads.
+ *
+ * What the store can cover bounds the span: each SV keeps
+ * SV_EPH_HISTORY versions, about a day of GPS or BeiDou uploads but two
+ * hours of Galileo's; outside them that SV is simply not expected.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_EXPECT_H
+#define SKY_EXPECT_H
+
+#include <stdint.h>
+
+#include "sky_multi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Upper bound on sky_expect_run() threads. */
+#define SKY_EXPECT_MAX_JOBS 64
+
+/**
+ * @struct SkyExpectSpan
+ * @brief The epochs to count.
+ */
+typedef struct {
+    int64_t  start_unix;    /**< first epoch, Unix s (UTC) */
+    int      span_s;        /**< length; epochs are start .. start + span_s exclusive */
+    int      step_ms;       /**< epoch interval, > 0 */
+    uint32_t gnss_mask;     /**< bit g: count GNSS ID g; 0 = every one with a propagator */
+    int      jobs;          /**< threads; <= 0 = one per CPU */
+} SkyExpectSpan;
+
+/**
+ * @brief Add the expected counts of every epoch in @p span to the grids of
+ *        the stations of @p m that have an ARP (sky_multi_set_arp()).
+ *
+ * Reads the ephemeris store without changing it; nothing else may be
+ * storing versions meanwhile.
+ *
+ * @return Sector updates over all stations, -1 when out of memory
+ *         (reported on stderr).
+ */
+long long sky_expect_run(SkyMulti *m, const SkyExpectSpan *span);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_EXPECT_H */
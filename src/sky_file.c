@@ -0,0 +1,380 @@
+/**
+ * @file sky_file.c
+ * @brief Sky-heatmap sector grid on disk (.sky): checkpoint, resume, merge.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sky_file.h"
+#include "file_map.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define SKYF_MAGIC        "NASKY\r\n\x1a"
+#define SKYF_VERSION      1
+#define SKYF_HEADER_SIZE  128
+#define SKYF_CELL_SIZE    12
+#define SKYF_FLAG_ARP     1u
+#define SKYF_N_SECTORS    (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+
+/* ── Little-endian helpers ────────────────────────────────────────────── */
+
+static void put_u16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_f64(unsigned char *p, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    put_u64(p, v);
+}
+
+static uint16_t get_u16(const unsigned char *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static double get_f64(const unsigned char *p)
+{
+    uint64_t v = get_u64(p);
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+/* CRC-32 (IEEE, reflected), bitwise: a grid is a few kB. */
+static uint32_t skyf_crc32(const unsigned char *p, size_t n)
+{
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; i++) {
+        c ^= p[i];
+        for (int k = 0; k < 8; k++)
+            c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1u)));
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+/* ── Write ────────────────────────────────────────────────────────────── */
+
+bool sky_file_write(const char *path, const SkyRenderSector *sectors,
+                    const SkyFileMeta *meta)
+{
+    size_t cap = SKYF_HEADER_SIZE + 4 + (size_t)SKYF_N_SECTORS * SKYF_CELL_SIZE + 4;
+    unsigned char *buf = (unsigned char *)calloc(1, cap);
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp = (char *)malloc(tmp_len);
+    if (!buf || !tmp) {
+        fprintf(stderr, "[ERROR] %s: out of memory\n", path);
+        free(buf);
+        free(tmp);
+        return false;
+    }
+    snprintf(tmp, tmp_len, "%s.tmp", path);
+
+    unsigned char *h = buf;
+    memcpy(h, SKYF_MAGIC, 8);
+    put_u32(h + 8,  SKYF_VERSION);
+    put_u32(h + 12, SKYF_HEADER_SIZE);
+    put_u16(h + 16, SKY_RENDER_N_EL_BANDS);
+    put_u16(h + 18, SKY_RENDER_MAX_AZ_BINS);
+    put_u32(h + 20, meta->gnss_mask);
+    put_u32(h + 24, meta->arp_valid ? SKYF_FLAG_ARP : 0);
+    put_u32(h + 28, meta->runs);
+    put_u64(h + 32, (uint64_t)meta->t_first);
+    put_u64(h + 40, (uint64_t)meta->t_last);
+    put_f64(h + 48, meta->arp_x);
+    put_f64(h + 56, meta->arp_y);
+    put_f64(h + 64, meta->arp_z);
+    const char *mp_end = (const char *)memchr(meta->mountpoint, '\0', sizeof(meta->mountpoint) - 1);
+    memcpy(h + 80, meta->mountpoint,
+           mp_end ? (size_t)(mp_end - meta->mountpoint) : sizeof(meta->mountpoint) - 1);
+
+    size_t at = SKYF_HEADER_SIZE + 4;
+    uint32_t n = 0;
+    for (int s = 0; s < SKYF_N_SECTORS; s++) {
+        if (sectors[s].expected <= 0 && sectors[s].observed <= 0) continue;
+        put_u32(buf + at,     (uint32_t)s);
+        put_u32(buf + at + 4, (uint32_t)(sectors[s].observed > 0 ? sectors[s].observed : 0));
+        put_u32(buf + at + 8, (uint32_t)(sectors[s].expected > 0 ? sectors[s].expected : 0));
+        at += SKYF_CELL_SIZE;
+        n++;
+    }
+    put_u32(buf + SKYF_HEADER_SIZE, n);
+    put_u32(buf + at, skyf_crc32(buf, at));
+    at += 4;
+
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && fwrite(buf, 1, at, f) == at;
+    if (f && fclose(f) != 0) ok = false;
+    if (ok) {
+        remove(path);                     /* rename() won't replace on Windows */
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "[ERROR] Cannot write %s\n", path);
+        remove(tmp);
+    }
+    free(buf);
+    free(tmp);
+    return ok;
+}
+
+/* ── Read ─────────────────────────────────────────────────────────────── */
+
+bool sky_file_read(const char *path, SkyRenderSector *sectors, SkyFileMeta *meta)
+{
+    FileMap m;
+    if (!file_map_open(&m, path)) {
+        fprintf(stderr, "[ERROR] Cannot read %s\n", path);
+        return false;
+    }
+    const unsigned char *p = m.data;
+    const char *why = NULL;
+    uint32_t hsize = 0, n = 0;
+    if (m.size < SKYF_HEADER_SIZE + 8 || memcmp(p, SKYF_MAGIC, 8) != 0) {
+        why = "not a sky grid file";
+    } else if (get_u32(p + 8) != SKYF_VERSION) {
+        why = "unsupported version";
+    } else if ((hsize = get_u32(p + 12)) < SKYF_HEADER_SIZE || hsize > m.size - 8) {
+        why = "bad header";
+    } else if (get_u16(p + 16) != SKY_RENDER_N_EL_BANDS ||
+               get_u16(p + 18) != SKY_RENDER_MAX_AZ_BINS) {
+        why = "different sector layout";
+    } else if ((n = get_u32(p + hsize)) > SKYF_N_SECTORS ||
+               m.size != (size_t)hsize + 4 + (size_t)n * SKYF_CELL_SIZE + 4) {
+        why = "truncated";
+    } else if (get_u32(p + m.size - 4) != skyf_crc32(p, m.size - 4)) {
+        why = "CRC mismatch";
+    }
+    if (why) {
+        fprintf(stderr, "[ERROR] %s: %s\n", path, why);
+        file_map_close(&m);
+        return false;
+    }
+
+    memset(meta, 0, sizeof(*meta));
+    meta->gnss_mask = get_u32(p + 20);
+    meta->arp_valid = (get_u32(p + 24) & SKYF_FLAG_ARP) != 0;
+    meta->runs      = get_u32(p + 28);
+    meta->t_first   = (int64_t)get_u64(p + 32);
+    meta->t_last    = (int64_t)get_u64(p + 40);
+    meta->arp_x     = get_f64(p + 48);
+    meta->arp_y     = get_f64(p + 56);
+    meta->arp_z     = get_f64(p + 64);
+    memcpy(meta->mountpoint, p + 80, sizeof(meta->mountpoint) - 1);
+
+    memset(sectors, 0, sizeof(SkyRenderSector) * SKYF_N_SECTORS);
+    const unsigned char *c = p + hsize + 4;
+    for (uint32_t i = 0; i < n; i++, c += SKYF_CELL_SIZE) {
+        uint32_t s = get_u32(c);
+        if (s >= SKYF_N_SECTORS) continue;
+        uint32_t obs = get_u32(c + 4), exp = get_u32(c + 8);
+        sectors[s].observed = obs > INT_MAX ? INT_MAX : (int)obs;
+        sectors[s].expected = exp > INT_MAX ? INT_MAX : (int)exp;
+    }
+    file_map_close(&m);
+    return true;
+}
+
+/* ── Merge ────────────────────────────────────────────────────────────── */
+
+static int sat_add(int a, int b)
+{
+    long long v = (long long)a + b;
+    return v > INT_MAX ? INT_MAX : (int)v;
+}
+
+bool sky_file_add(SkyRenderSector *dst, SkyFileMeta *dst_meta,
+                  const SkyRenderSector *src, const SkyFileMeta *src_meta)
+{
+    for (int s = 0; s < SKYF_N_SECTORS; s++) {
+        dst[s].observed = sat_add(dst[s].observed, src[s].observed);
+        dst[s].expected = sat_add(dst[s].expected, src[s].expected);
+    }
+
+    bool same = true;
+    if (!dst_meta->arp_valid) {
+        dst_meta->arp_valid = src_meta->arp_valid;
+        dst_meta->arp_x     = src_meta->arp_x;
+        dst_meta->arp_y     = src_meta->arp_y;
+        dst_meta->arp_z     = src_meta->arp_z;
+    } else if (src_meta->arp_valid) {
+        double dx = dst_meta->arp_x - src_meta->arp_x;
+        double dy = dst_meta->arp_y - src_meta->arp_y;
+        double dz = dst_meta->arp_z - src_meta->arp_z;
+        same = sqrt(dx * dx + dy * dy + dz * dz) <= SKY_FILE_ARP_TOL_M;
+    }
+    if (!dst_meta->mountpoint[0])
+        memcpy(dst_meta->mountpoint, src_meta->mountpoint, sizeof(dst_meta->mountpoint));
+    if (src_meta->t_first && (!dst_meta->t_first || src_meta->t_first < dst_meta->t_first))
+        dst_meta->t_first = src_meta->t_first;
+    if (src_meta->t_last > dst_meta->t_last)
+        dst_meta->t_last = src_meta->t_last;
+    dst_meta->gnss_mask |= src_meta->gnss_mask;
+    dst_meta->runs      += src_meta->runs;
+    return same;
+}
+
+/* One thread's slice of the file list, added up into its own grid. */
+typedef struct {
+    const char *const *paths;
+    int                lo, hi;
+    SkyRenderSector   *grid;
+    SkyFileMeta        meta;
+    SkyRenderSector   *tmp;
+    bool               ok;
+    bool               same;
+} SkyMergeSlice;
+
+static void skyf_merge_slice(SkyMergeSlice *w)
+{
+    SkyFileMeta meta;
+    for (int i = w->lo; i < w->hi; i++) {
+        if (!sky_file_read(w->paths[i], w->tmp, &meta)) {
+            w->ok = false;
+            continue;
+        }
+        if (!sky_file_add(w->grid, &w->meta, w->tmp, &meta)) w->same = false;
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall skyf_merge_thread(void *arg)
+{
+    skyf_merge_slice((SkyMergeSlice *)arg);
+    return 0;
+}
+#else
+static void *skyf_merge_thread(void *arg)
+{
+    skyf_merge_slice((SkyMergeSlice *)arg);
+    return NULL;
+}
+#endif
+
+static int skyf_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+int sky_file_merge(const char *const *paths, int n, int jobs,
+                   SkyRenderSector *out, SkyFileMeta *meta)
+{
+    memset(out, 0, sizeof(SkyRenderSector) * SKYF_N_SECTORS);
+    memset(meta, 0, sizeof(*meta));
+    if (n <= 0) return 0;
+    if (jobs <= 0) jobs = skyf_cpu_count();
+    if (jobs > SKY_FILE_MAX_JOBS) jobs = SKY_FILE_MAX_JOBS;
+    if (jobs > n) jobs = n;
+
+    SkyMergeSlice w[SKY_FILE_MAX_JOBS];
+    SkyRenderSector *mem = (SkyRenderSector *)calloc((size_t)jobs * 2 * SKYF_N_SECTORS,
+                                                     sizeof(SkyRenderSector));
+    if (!mem) {
+        fprintf(stderr, "[ERROR] Out of memory merging %d grids\n", n);
+        return -1;
+    }
+    /* Contiguous slices in file order, so "first file with an ARP" does
+     * not depend on the number of threads. */
+    for (int t = 0; t < jobs; t++) {
+        memset(&w[t], 0, sizeof(w[t]));
+        w[t].paths = paths;
+        w[t].lo    = (int)((long long)n * t / jobs);
+        w[t].hi    = (int)((long long)n * (t + 1) / jobs);
+        w[t].grid  = mem + (size_t)t * 2 * SKYF_N_SECTORS;
+        w[t].tmp   = w[t].grid + SKYF_N_SECTORS;
+        w[t].ok    = true;
+        w[t].same  = true;
+    }
+
+#ifdef _WIN32
+    HANDLE threads[SKY_FILE_MAX_JOBS];
+#else
+    pthread_t threads[SKY_FILE_MAX_JOBS];
+#endif
+    bool started[SKY_FILE_MAX_JOBS] = { false };
+    /* Slice 0 is this thread's; a slice whose thread did not start is
+     * run here as well. */
+    for (int t = 1; t < jobs; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, skyf_merge_thread, &w[t], 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, skyf_merge_thread, &w[t]) == 0;
+#endif
+    }
+    skyf_merge_slice(&w[0]);
+    for (int t = 1; t < jobs; t++) {
+        if (!started[t]) {
+            skyf_merge_slice(&w[t]);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+
+    bool ok = true, same = true;
+    for (int t = 0; t < jobs; t++) {
+        ok   = ok && w[t].ok;
+        same = same && w[t].same;
+        if (!sky_file_add(out, meta, w[t].grid, &w[t].meta)) same = false;
+    }
+    free(mem);
+    if (!ok) return -1;
+    if (!same)
+        fprintf(stderr, "[WARN] The grids were collected at ARPs more than %.0f m apart\n",
+                SKY_FILE_ARP_TOL_M);
+    return n;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file sky_file.h
+ * @brief Sky-heatmap sector grid on disk (.sky): checkpoint, resume, merge.
+ *
+ * The sky collection keeps its sector grid in memory and only renders a
+ * PNG at the end, so a crash loses the run and two runs cannot be added
+ * up.  A .sky file holds the observed / expected counts of every sector
+ * with what is needed to combine it with others:
+ *
+ *   - the station ARP (ECEF) the counts were collected at
+ *   - the time span of the data (Unix seconds, stream time)
+ *   - the GNSS that contributed, as a bit mask of GNSS IDs
+ *   - how many collection runs were merged into it, and the mountpoint
+ *
+ * `--sky --checkpoint FILE` rewrites it every @ref SKY_FILE_CHECKPOINT_S
+ * seconds and at the end of the run, `--sky --resume FILE` starts from
+ * it, and `--merge A.sky B.sky ...` adds any number of them up: a
+ * week-long heatmap from seven daily runs without replaying any RTCM.
+ *
+ * Sums are order independent, so sky_file_merge() reads and adds slices
+ * of the file list on several threads and then adds the partial grids;
+ * the result does not depend on --jobs.  Counts saturate at INT_MAX.
+ *
+ * Sectors that were never expected are left out, so a grid is a few kB.
+ * A file is written to "<file>.tmp" and renamed into place, so a
+ * checkpoint interrupted half way leaves the previous one intact.
+ *
+ * Layout (all integers little-endian, doubles as IEEE-754 bit patterns):
+ * @code
+ *   header      128 B  "NASKY\r\n\x1a", u32 version, u32 header size,
+ *                      u16 elevation bands, u16 azimuth bins per band,
+ *                      u32 GNSS mask (bit g = GNSS ID g),
+ *                      u32 flags (bit 0: ARP valid), u32 runs,
+ *                      i64 first, i64 last (Unix s; 0 = no data),
+ *                      f64 ARP x, y, z (m), 8 B reserved,
+ *                      char mountpoint[48] (NUL padded)
+ *   u32 sectors        then that many { u32 index, u32 observed, u32 expected }
+ *   u32 CRC-32         of everything before it
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_FILE_H
+#define SKY_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sky_render.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SKY_FILE_EXT           ".sky"
+
+/** @brief Seconds (wall clock) between two --checkpoint writes. */
+#define SKY_FILE_CHECKPOINT_S  60
+
+/** @brief ARPs closer than this are the same station when merging (m). */
+#define SKY_FILE_ARP_TOL_M     10.0
+
+/** @brief Upper bound on sky_file_merge() threads. */
+#define SKY_FILE_MAX_JOBS      64
+
+/**
+ * @struct SkyFileMeta
+ * @brief What a sector grid was collected from.  All zero is "nothing yet".
+ */
+typedef struct {
+    bool     arp_valid;
+    double   arp_x, arp_y, arp_z;   /**< ECEF, m */
+    int64_t  t_first, t_last;       /**< Unix s of the first and last update; 0 = none */
+    uint32_t gnss_mask;             /**< bit g set: GNSS ID g contributed */
+    uint32_t runs;                  /**< collection runs summed into the grid */
+    char     mountpoint[48];
+} SkyFileMeta;
+
+/**
+ * @brief Write @p sectors (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS
+ *        entries) and @p meta to @p path, replacing it atomically.
+ * @return false on an I/O error (reported on stderr); @p path is then
+ *         unchanged.
+ */
+bool sky_file_write(const char *path, const SkyRenderSector *sectors,
+                    const SkyFileMeta *meta);
+
+/**
+ * @brief Read a .sky file into @p sectors (overwritten) and @p meta.
+ * @return false if it cannot be read, is not a .sky file, was written
+ *         with a different sector layout or fails its CRC (reported on
+ *         stderr).
+ */
+bool sky_file_read(const char *path, SkyRenderSector *sectors, SkyFileMeta *meta);
+
+/**
+ * @brief Add grid @p src to @p dst and merge the metadata: time span and
+ *        GNSS mask widened, runs added, ARP and mountpoint kept from
+ *        @p dst unless it has none.
+ * @return false if both have an ARP and they are more than
+ *         @ref SKY_FILE_ARP_TOL_M apart; the grids are added anyway.
+ */
+bool sky_file_add(SkyRenderSector *dst, SkyFileMeta *dst_meta,
+                  const SkyRenderSector *src, const SkyFileMeta *src_meta);
+
+/**
+ * @brief Read and add up @p n files on @p jobs threads (0 = one per core).
+ *
+ * @param out   [out] The summed grid.
+ * @param meta  [out] Its metadata; ARP and mountpoint of the first file
+ *              that has them.
+ * @return Files merged, or -1 if any could not be read (nothing is
+ *         merged then).  A station mismatch is only warned about.
+ */
+int sky_file_merge(const char *const *paths, int n, int jobs,
+                   SkyRenderSector *out, SkyFileMeta *meta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_FILE_H */
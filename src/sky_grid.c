@@ -0,0 +1,48 @@
+/**
+ * @file sky_grid.c
+ * @brief Precomputed (azimuth, elevation) -> heatmap sector lookup.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sky_grid.h"
+
+/* Sector grid: band 0 = 0..10 deg elevation (horizon), band 8 = 80..90 deg
+ * (zenith).  Must mirror gui_sky_window.c sky_az_bins_per_band[] and
+ * sky_render.c sky_render_az_bins_per_band[]. */
+const int sky_grid_az_bins_per_band[SKY_GRID_N_EL_BANDS] = {
+    33,  /* 0..10  deg */
+    30,  /* 10..20 deg */
+    25,  /* 20..30 deg */
+    21,  /* 30..40 deg */
+    16,  /* 40..50 deg */
+    11,  /* 50..60 deg */
+     8,  /* 60..70 deg */
+     5,  /* 70..80 deg */
+     1,  /* 80..90 deg (zenith cap) */
+};
+
+uint8_t sky_grid_az_bin[SKY_GRID_N_EL_BANDS][SKY_GRID_N_AZ_CELLS];
+double  sky_grid_az_edge[SKY_GRID_N_EL_BANDS][SKY_GRID_MAX_AZ_BINS + 1];
+bool    sky_grid_ready;
+
+void sky_grid_init(void)
+{
+    if (sky_grid_ready) return;
+    for (int band = 0; band < SKY_GRID_N_EL_BANDS; band++) {
+        int n = sky_grid_az_bins_per_band[band];
+        for (int k = 0; k < n; k++)
+            sky_grid_az_edge[band][k] = (double)k * 360.0 / (double)n;
+        sky_grid_az_edge[band][n] = 361.0;
+
+        int bin = 0;
+        for (int c = 0; c < SKY_GRID_N_AZ_CELLS; c++) {
+            double az = (double)c / SKY_GRID_CELLS_PER_DEG;
+            while (bin + 1 < n && az >= sky_grid_az_edge[band][bin + 1]) bin++;
+            sky_grid_az_bin[band][c] = (uint8_t)bin;
+        }
+    }
+    sky_grid_ready = true;
+}
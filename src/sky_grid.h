@@ -0,0 +1,108 @@
+/**
+ * @file sky_grid.h
+ * @brief Precomputed (azimuth, elevation) -> heatmap sector lookup.
+ *
+ * The sky heatmap splits the sky into SKY_GRID_N_EL_BANDS elevation bands
+ * of 10 deg, each with its own number of azimuth bins (see
+ * sky_grid_az_bins_per_band[]).  Binning an (az, el) pair used to cost a
+ * band-table lookup and two floating-point divisions in every caller; it
+ * runs for each (epoch, SV) pair and for every pixel of a rendered
+ * heatmap.
+ *
+ * sky_grid_sector() instead quantises (az, el) to a 0.5 deg grid with two
+ * exact multiplications and reads the sector from a table.  Elevation
+ * band edges fall on grid lines, so the band is exact.  An azimuth grid
+ * cell holds at most one bin edge; the table stores the bin at the start
+ * of the cell and a single comparison against the edge picks the bin,
+ * so the result matches direct division up to rounding exactly at an edge.
+ *
+ * Sector indices are flat: band * SKY_GRID_MAX_AZ_BINS + bin, matching
+ * both SkyRenderSector grids (sky_render.h) and the GUI's
+ * SkySector sectors[SKY_N_EL_BANDS][SKY_MAX_AZ_BINS].
+ *
+ * The table (about 9 kB) is built on the first call.  Call
+ * sky_grid_init() first if more than one thread may bin concurrently.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_GRID_H
+#define SKY_GRID_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Elevation bands: 9 bands of 10 deg each (0..10, ..., 80..90). */
+#define SKY_GRID_N_EL_BANDS   9
+
+/** Widest azimuth-bin count (horizon band); stride of a flat sector index. */
+#define SKY_GRID_MAX_AZ_BINS  33
+
+/** Quantisation cells per degree (0.5 deg grid). */
+#define SKY_GRID_CELLS_PER_DEG 2
+
+/** Azimuth-bin count per elevation band (mirrors gui_state.h / sky_render.h). */
+extern const int sky_grid_az_bins_per_band[SKY_GRID_N_EL_BANDS];
+
+/** Azimuth quantisation cells over 0..360 deg. */
+#define SKY_GRID_N_AZ_CELLS (360 * SKY_GRID_CELLS_PER_DEG)
+
+/* Lookup tables filled by sky_grid_init(); read through sky_grid_sector().
+ *   sky_grid_az_bin[band][cell]:  bin containing the start of the cell.
+ *   sky_grid_az_edge[band][k]:    azimuth where bin k starts; [n] > 360. */
+extern uint8_t sky_grid_az_bin[SKY_GRID_N_EL_BANDS][SKY_GRID_N_AZ_CELLS];
+extern double  sky_grid_az_edge[SKY_GRID_N_EL_BANDS][SKY_GRID_MAX_AZ_BINS + 1];
+extern bool    sky_grid_ready;
+
+/** @brief Build the lookup table.  Idempotent. */
+void sky_grid_init(void);
+
+/**
+ * @brief Flat sector index for an (azimuth, elevation) pair.
+ *
+ * Inline so the per-SV and per-pixel loops in the callers stay free of
+ * function calls.
+ *
+ * @param az_deg  Azimuth in degrees; wrapped into 0..360.
+ * @param el_deg  Elevation in degrees; clamped to 0..90.
+ * @return band * SKY_GRID_MAX_AZ_BINS + bin.
+ */
+static inline int sky_grid_sector(double az_deg, double el_deg)
+{
+    if (!sky_grid_ready) sky_grid_init();
+
+    /* Written so that NaN lands in band 0. */
+    if (!(el_deg > 0.0)) el_deg = 0.0;
+    if (el_deg > 90.0)   el_deg = 90.0;
+    int band = (int)(el_deg * SKY_GRID_CELLS_PER_DEG) /
+               (10 * SKY_GRID_CELLS_PER_DEG);
+    if (band >= SKY_GRID_N_EL_BANDS) band = SKY_GRID_N_EL_BANDS - 1;
+
+    if (sky_grid_az_bins_per_band[band] <= 1)
+        return band * SKY_GRID_MAX_AZ_BINS;
+
+    if (!(az_deg >= 0.0 && az_deg < 360.0)) {
+        az_deg = fmod(az_deg, 360.0);
+        if (az_deg < 0.0) az_deg += 360.0;
+        if (!(az_deg < 360.0)) az_deg = 0.0;   /* -tiny + 360 rounds up; NaN */
+    }
+    int cell = (int)(az_deg * SKY_GRID_CELLS_PER_DEG);
+    if (cell >= SKY_GRID_N_AZ_CELLS) cell = SKY_GRID_N_AZ_CELLS - 1;
+
+    int bin = sky_grid_az_bin[band][cell];
+    if (az_deg >= sky_grid_az_edge[band][bin + 1]) bin++;
+    return band * SKY_GRID_MAX_AZ_BINS + bin;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_GRID_H */
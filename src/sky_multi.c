@@ -0,0 +1,245 @@
+/**
+ * @file sky_multi.c
+ * @brief Sky-heatmap collector for a network of reference stations.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sky_multi.h"
+#include "sky_grid.h"
+#include "sv_orbit.h"
+#include "stream_clock.h"
+
+#include <stdlib.h>
+
+#define SECTORS (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+#define WEEK_S  604800.0
+
+SkyMulti *sky_multi_new(int n)
+{
+    if (n <= 0) return NULL;
+    SkyMulti *m = (SkyMulti *)calloc(1, sizeof(SkyMulti));
+    if (!m) return NULL;
+    m->st = (SkyMultiStation *)calloc((size_t)n, sizeof(SkyMultiStation));
+    if (!m->st) {
+        free(m);
+        return NULL;
+    }
+    m->n = n;
+    for (int i = 0; i < n; i++) {
+        m->st[i].sectors = (SkyRenderSector *)calloc(SECTORS, sizeof(SkyRenderSector));
+        if (!m->st[i].sectors) {
+            sky_multi_free(m);
+            return NULL;
+        }
+        sky_epoch_init(&m->st[i].epochs);
+    }
+    return m;
+}
+
+void sky_multi_free(SkyMulti *m)
+{
+    if (!m) return;
+    for (int i = 0; i < m->n; i++) free(m->st[i].sectors);
+    free(m->st);
+    free(m);
+}
+
+void sky_multi_set_arp(SkyMulti *m, int i, double x, double y, double z)
+{
+    if (i < 0 || i >= m->n) return;
+    station_frame_set(&m->st[i].frame, x, y, z);
+}
+
+/* GNSS IDs with an ephemeris propagator, as sky_collect.c. */
+static bool sky_multi_gnss_ok(int g)
+{
+    return g == 1 || g == 2 || g == 3 || g == 4 || g == 5 || g == 7;
+}
+
+/* Propagate every SV of @p g with a usable ephemeris to @p epoch_time. */
+static void sky_multi_propagate(SkyMultiSvSet *set, int g, uint32_t epoch_time)
+{
+    int week;
+    double clock_tow;
+    stream_clock_gps_time(&week, &clock_tow);
+
+    double t;
+    if (g == 2) {
+        t = (double)(epoch_time & 0x7FFFFFF) / 1000.0;      /* DF034, Moscow time of day */
+    } else {
+        t = (double)epoch_time / 1000.0 + (g == 5 ? 14.0 : 0.0);  /* BDT -> GPST */
+        if (t >= WEEK_S) {
+            t -= WEEK_S;
+            week++;
+        }
+        /* The clock may have crossed the week boundary on the other side */
+        if (t - clock_tow > WEEK_S / 2)  week--;
+        if (clock_tow - t > WEEK_S / 2)  week++;
+    }
+
+    const SvEphemeris *ephs[SV_EPH_MAX_SATS_PER_GNSS];
+    int    prn[SV_EPH_MAX_SATS_PER_GNSS];
+    double x[SV_EPH_MAX_SATS_PER_GNSS], y[SV_EPH_MAX_SATS_PER_GNSS];
+    double z[SV_EPH_MAX_SATS_PER_GNSS];
+    bool   ok[SV_EPH_MAX_SATS_PER_GNSS];
+    int    n_eph = 0;
+    for (int p = 1; p <= SV_EPH_MAX_SATS_PER_GNSS; p++) {
+        const SvEphemeris *eph = sv_eph_get_at(g, p, week, t);
+        if (!eph) continue;
+        ephs[n_eph] = eph;
+        prn[n_eph]  = p;
+        n_eph++;
+    }
+    sv_to_ecef_cached_batch(ephs, n_eph, week, t, x, y, z, ok);
+
+    set->n = 0;
+    for (int k = 0; k < n_eph; k++) {
+        if (!ok[k]) continue;
+        set->prn[set->n] = prn[k];
+        set->x[set->n]   = x[k];
+        set->y[set->n]   = y[k];
+        set->z[set->n]   = z[k];
+        set->n++;
+    }
+    set->epoch_time = epoch_time;
+    set->valid      = true;
+}
+
+/* Positions of (@p g, @p epoch_time): from the cache, or propagated into
+ * its least recently used slot. */
+static const SkyMultiSvSet *sky_multi_positions(SkyMulti *m, int g, uint32_t epoch_time)
+{
+    SkyMultiSvSet *sets = m->pos[g];
+    SkyMultiSvSet *lru  = &sets[0];
+    m->tick++;
+    for (int k = 0; k < SKY_MULTI_POS_EPOCHS; k++) {
+        if (sets[k].valid && sets[k].epoch_time == epoch_time) {
+            sets[k].used = m->tick;
+            m->reused++;
+            return &sets[k];
+        }
+        if (!sets[k].valid || sets[k].used < lru->used) lru = &sets[k];
+    }
+    sky_multi_propagate(lru, g, epoch_time);
+    lru->used = m->tick;
+    m->propagated++;
+    return lru;
+}
+
+/* Bin the SVs of @p set above the horizon of station @p s. */
+static int sky_multi_project(const SkyMultiSvSet *set, SkyMultiStation *s,
+                             uint64_t obs_mask)
+{
+    const StationFrame *f = &s->frame;
+    const int n = set->n;
+    double e[SV_EPH_MAX_SATS_PER_GNSS];
+    double nn[SV_EPH_MAX_SATS_PER_GNSS];
+    double u[SV_EPH_MAX_SATS_PER_GNSS];
+
+    /* ENU of every SV in one branch-free loop the compiler vectorises;
+     * same arithmetic as azel_from_ecef_frame(). */
+    const double ox = f->x, oy = f->y, oz = f->z;
+    const double r00 = f->r[0][0], r01 = f->r[0][1];
+    const double r10 = f->r[1][0], r11 = f->r[1][1], r12 = f->r[1][2];
+    const double r20 = f->r[2][0], r21 = f->r[2][1], r22 = f->r[2][2];
+    for (int k = 0; k < n; k++) {
+        double dx = set->x[k] - ox;
+        double dy = set->y[k] - oy;
+        double dz = set->z[k] - oz;
+        e[k]  = r00 * dx + r01 * dy;
+        nn[k] = r10 * dx + r11 * dy + r12 * dz;
+        u[k]  = r20 * dx + r21 * dy + r22 * dz;
+    }
+
+    int contributed = 0;
+    for (int k = 0; k < n; k++) {
+        if (!(u[k] > 0.0)) continue;            /* below the horizon: no trig */
+        double az_d, el_d;
+        enu_to_azel(e[k], nn[k], u[k], &az_d, &el_d);
+        if (el_d <= 0.0) continue;
+
+        SkyRenderSector *sec = &s->sectors[sky_grid_sector(az_d, el_d)];
+        sec->expected++;
+        int p = set->prn[k];
+        if ((obs_mask >> (p - 1)) & 1ULL)
+            sec->observed++;
+        contributed++;
+    }
+    s->updates += contributed;
+    return contributed;
+}
+
+int sky_multi_feed_epoch(SkyMulti *m, int i, const SkyEpoch *ep)
+{
+    if (!m || !ep || i < 0 || i >= m->n) return 0;
+    SkyMultiStation *s = &m->st[i];
+    int g = ep->gnss_id;
+    if (ep->obs_mask == 0 || !s->frame.valid || !sky_multi_gnss_ok(g)) return 0;
+    return sky_multi_project(sky_multi_positions(m, g, ep->epoch_time), s, ep->obs_mask);
+}
+
+int sky_multi_score(SkyMulti *m, int gnss_id, uint32_t epoch_time,
+                    const uint64_t *obs_masks)
+{
+    if (!m || !obs_masks || !sky_multi_gnss_ok(gnss_id)) return 0;
+    const SkyMultiSvSet *set = NULL;
+    int contributed = 0;
+    for (int i = 0; i < m->n; i++) {
+        if (!obs_masks[i] || !m->st[i].frame.valid) continue;
+        if (!set) set = sky_multi_positions(m, gnss_id, epoch_time);
+        contributed += sky_multi_project(set, &m->st[i], obs_masks[i]);
+    }
+    return contributed;
+}
+
+int sky_multi_expect(SkyMulti *m, int gnss_id, uint32_t epoch_time)
+{
+    if (!m || !sky_multi_gnss_ok(gnss_id)) return 0;
+    const SkyMultiSvSet *set = NULL;
+    int contributed = 0;
+    for (int i = 0; i < m->n; i++) {
+        if (!m->st[i].frame.valid) continue;
+        if (!set) set = sky_multi_positions(m, gnss_id, epoch_time);
+        contributed += sky_multi_project(set, &m->st[i], 0);
+    }
+    return contributed;
+}
+
+int sky_multi_feed_msm(SkyMulti *m, int i, const unsigned char *payload,
+                       int payload_len, int msg_type)
+{
+    if (!m || i < 0 || i >= m->n || !payload || payload_len < 14) return 0;
+    if (!rtcm_msg_is_msm(msg_type, 4, 7)) return 0;
+
+    int prns[64];
+    int gnss_id = 0;
+    int n_prns = msm_extract_prns(payload, payload_len, msg_type, prns, 64, &gnss_id);
+    if (n_prns <= 0) return 0;
+    uint16_t station_id = 0;
+    uint32_t epoch_time = 0;
+    sky_epoch_read_header(payload, payload_len, &station_id, &epoch_time);
+
+    SkyEpoch done;
+    if (!sky_epoch_add(&m->st[i].epochs, gnss_id, station_id, epoch_time,
+                       prns, NULL, n_prns, &done))
+        return 0;
+    if (m->gov && !load_gov_keep(m->gov, LOAD_WORK_SKY, done.epoch_time / 1000))
+        return 0;
+    return sky_multi_feed_epoch(m, i, &done);
+}
+
+int sky_multi_flush(SkyMulti *m)
+{
+    if (!m) return 0;
+    int contributed = 0;
+    for (int i = 0; i < m->n; i++) {
+        SkyEpoch eps[SKY_EPOCH_MAX_GNSS];
+        int k = sky_epoch_flush(&m->st[i].epochs, eps, SKY_EPOCH_MAX_GNSS);
+        for (int j = 0; j < k; j++)
+            contributed += sky_multi_feed_epoch(m, i, &eps[j]);
+    }
+    return contributed;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file sky_multi.h
+ * @brief Sky-heatmap collector for a network of reference stations.
+ *
+ * sky_collect.h serves one station: every epoch it closes propagates all
+ * ephemerides of the GNSS to that station.  The stations of a network see
+ * the same satellites at the same epochs, so for N stations the same
+ * orbits would be propagated N times.  A @ref SkyMulti keeps one sector
+ * grid, epoch assembler and @ref StationFrame per station, and shares the
+ * satellite positions between them:
+ *
+ *   - the positions of one (GNSS, epoch) are propagated once, with the
+ *     batch propagator (sv_to_ecef_cached_batch()), to the epoch's own
+ *     time, and kept in a small per-GNSS cache of the last
+ *     @ref SKY_MULTI_POS_EPOCHS epochs
+ *   - every station that closes that epoch -- streams arrive with
+ *     different latencies, so not at the same moment -- takes them from
+ *     the cache; its cost is the projection alone: one pass over the
+ *     satellites in structure-of-arrays form for the ENU rotation, then
+ *     the binning of those above the horizon
+ *   - sky_multi_score() projects one epoch to all stations at once, for
+ *     drivers that already hold every station's satellite mask
+ *
+ * Propagating to the epoch time instead of the stream clock (as
+ * sky_collect.c does) is what makes the positions the same for every
+ * station; the GPS week still comes from stream_clock_gps_time().
+ *
+ * With a load governor set (@c gov), the epochs it sheds are assembled
+ * but not scored; they are picked by epoch second, so every station
+ * keeps the same epochs and the position cache still serves them all.
+ *
+ * Plain data, no locking: one collector per producer thread.  Driven by
+ * `--sky --mounts-file` through the multi-mountpoint monitor
+ * (ntrip_multi_set_frame_hook()).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_MULTI_H
+#define SKY_MULTI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "load_governor.h"
+#include "rtcm3x_parser.h"
+#include "sky_epoch.h"
+#include "sky_render.h"
+#include "sv_ephemeris.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Epochs whose satellite positions are kept per GNSS. */
+#define SKY_MULTI_POS_EPOCHS 4
+
+/**
+ * @struct SkyMultiStation
+ * @brief One station of the network.
+ *
+ * @c sectors is SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS entries,
+ * as the grid of sky_collect_reset(); hand it to sky_render_heatmap_png().
+ */
+typedef struct {
+    SkyRenderSector  *sectors;
+    StationFrame      frame;        /**< valid once an ARP was set */
+    SkyEpochAssembler epochs;
+    long              updates;      /**< sector updates */
+} SkyMultiStation;
+
+/** @brief Satellite positions of one (GNSS, epoch), structure of arrays. */
+typedef struct {
+    bool     valid;
+    uint32_t epoch_time;            /**< MSM epoch time they are for */
+    uint32_t used;                  /**< SkyMulti::tick of the last use */
+    int      n;
+    int      prn[SV_EPH_MAX_SATS_PER_GNSS];
+    double   x[SV_EPH_MAX_SATS_PER_GNSS];
+    double   y[SV_EPH_MAX_SATS_PER_GNSS];
+    double   z[SV_EPH_MAX_SATS_PER_GNSS];
+} SkyMultiSvSet;
+
+/**
+ * @struct SkyMulti
+ * @brief The collector: stations plus the shared position cache.
+ */
+typedef struct {
+    int              n;
+    SkyMultiStation *st;
+    SkyMultiSvSet    pos[SKY_EPOCH_MAX_GNSS][SKY_MULTI_POS_EPOCHS];
+    uint32_t         tick;
+    unsigned long    propagated;    /**< (GNSS, epoch) position sets propagated */
+    unsigned long    reused;        /**< ... taken from the cache instead */
+    LoadGovernor    *gov;           /**< load shedding of sky_multi_feed_msm(); NULL = none */
+} SkyMulti;
+
+/** @brief Allocate a collector for @p n stations with empty grids; NULL when out of memory. */
+SkyMulti *sky_multi_new(int n);
+
+/** @brief Free what sky_multi_new() returned (NULL is ignored). */
+void sky_multi_free(SkyMulti *m);
+
+/** @brief Set the ECEF ARP of station @p i (1005/1006, or the configured position). */
+void sky_multi_set_arp(SkyMulti *m, int i, double x, double y, double z);
+
+/**
+ * @brief Feed one MSM4..7 frame of station @p i into its epoch assembler;
+ *        an epoch it closes is scored as by sky_multi_feed_epoch().
+ *
+ * @param payload      RTCM payload (after the 3-byte header).
+ * @return Sector updates of the closed epoch; 0 if none was closed, the
+ *         frame is not an MSM4..7, the station has no ARP yet or
+ *         @c gov shed the epoch.
+ */
+int sky_multi_feed_msm(SkyMulti *m, int i, const unsigned char *payload,
+                       int payload_len, int msg_type);
+
+/** @brief Score one assembled epoch of station @p i. */
+int sky_multi_feed_epoch(SkyMulti *m, int i, const SkyEpoch *ep);
+
+/**
+ * @brief Score epoch @p epoch_time of @p gnss_id at every station in one
+ *        pass.
+ *
+ * @param obs_masks  Per station: bit (p-1) set if PRN p was observed, as
+ *                   SkyEpoch::obs_mask; 0 = the station has no such epoch.
+ * @return Sector updates over all stations.
+ */
+int sky_multi_score(SkyMulti *m, int gnss_id, uint32_t epoch_time,
+                    const uint64_t *obs_masks);
+
+/**
+ * @brief Add the SVs of @p gnss_id above each station's horizon at
+ *        @p epoch_time to its @c expected counts only, as if none had
+ *        been observed: a baseline that needs no stream (sky_expect.h).
+ *
+ * @param epoch_time  As the MSM epoch time of @p gnss_id (GLONASS: DF034,
+ *                    BeiDou: BDT).
+ * @return Sector updates over all stations.
+ */
+int sky_multi_expect(SkyMulti *m, int gnss_id, uint32_t epoch_time);
+
+/** @brief Score every epoch still being assembled (end of run). */
+int sky_multi_flush(SkyMulti *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_MULTI_H */
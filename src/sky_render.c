@@ -1,11 +1,17 @@
 /**
  * @file sky_render.c
- * @brief Portable polar sky-heatmap renderer + minimal PNG encoder.
+ * @brief Portable polar sky-heatmap renderer.
  *
  * Produces a PNG of the same sector heatmap the GUI draws (gui_sky_window.c
- * SKY_MODE_HEATMAP).  No external dependencies: the file embeds a small
- * PNG writer (PNG chunks + CRC32 + Adler32 + zlib stored-deflate blocks),
- * which is enough for the modest size of a sky-plot snapshot.
+ * SKY_MODE_HEATMAP), on a RasterImage with the primitives and the PNG
+ * writer of raster.c.  The disc fill and the colour ramp are exported
+ * for the GUI.
+ *
+ * sky_render_heatmap_svg() writes the same heatmap as an SVG document.
+ *
+ * sky_render_heatmap_batch() renders many heatmaps, of several sizes, on
+ * a pool of threads: the static layers are drawn once per size and each
+ * heatmap only paints its disc and footer over a copy of them.
  *
  * Project: NTRIP-Analyser
  * Author: Remko Welling, PE1MEW
@@ -13,6 +19,8 @@
  */
 
 #include "sky_render.h"
+#include "raster.h"
+#include "sky_grid.h"
 
 #include <ctype.h>
 #include <math.h>
@@ -21,11 +29,25 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
 /* ── Geometry: must mirror gui_state.h sky_az_bins_per_band[] ───────── */
+/* Pixels and SVs are binned with sky_grid_sector(), whose flat index
+ * assumes the same layout. */
+#if SKY_RENDER_N_EL_BANDS != SKY_GRID_N_EL_BANDS || \
+    SKY_RENDER_MAX_AZ_BINS != SKY_GRID_MAX_AZ_BINS
+#error "sky_render.h and sky_grid.h sector geometry differ"
+#endif
 const int sky_render_az_bins_per_band[SKY_RENDER_N_EL_BANDS] = {
     33,  /* 0..10  deg */
     30,  /* 10..20 deg */
@@ -38,188 +60,7 @@ const int sky_render_az_bins_per_band[SKY_RENDER_N_EL_BANDS] = {
      1,  /* 80..90 deg (zenith cap) */
 };
 
-/* ── RGB pixel helper ───────────────────────────────────────────────── */
-typedef struct {
-    uint8_t *pixels;   /* row-major: pixels[y*stride + x*3] = R,G,B */
-    int      w, h;
-    int      stride;   /* bytes per row = w*3 */
-} RGB;
-
-static void put_px(RGB *img, int x, int y, uint8_t r, uint8_t g, uint8_t b)
-{
-    if (x < 0 || x >= img->w || y < 0 || y >= img->h) return;
-    uint8_t *p = img->pixels + y * img->stride + x * 3;
-    p[0] = r; p[1] = g; p[2] = b;
-}
-
-static void fill_rect(RGB *img, int x0, int y0, int x1, int y1,
-                      uint8_t r, uint8_t g, uint8_t b)
-{
-    if (x0 > x1) { int t = x0; x0 = x1; x1 = t; }
-    if (y0 > y1) { int t = y0; y0 = y1; y1 = t; }
-    if (x0 < 0) x0 = 0;
-    if (y0 < 0) y0 = 0;
-    if (x1 >= img->w) x1 = img->w - 1;
-    if (y1 >= img->h) y1 = img->h - 1;
-    for (int y = y0; y <= y1; y++) {
-        uint8_t *row = img->pixels + y * img->stride + x0 * 3;
-        for (int x = x0; x <= x1; x++) {
-            row[0] = r; row[1] = g; row[2] = b;
-            row += 3;
-        }
-    }
-}
-
-static void fill_all(RGB *img, uint8_t r, uint8_t g, uint8_t b)
-{
-    fill_rect(img, 0, 0, img->w - 1, img->h - 1, r, g, b);
-}
-
-/* Bresenham line, 1-px wide. */
-static void draw_line(RGB *img, int x0, int y0, int x1, int y1,
-                      uint8_t r, uint8_t g, uint8_t b)
-{
-    int dx =  abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
-    int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
-    int err = dx + dy;
-    for (;;) {
-        put_px(img, x0, y0, r, g, b);
-        if (x0 == x1 && y0 == y1) break;
-        int e2 = 2 * err;
-        if (e2 >= dy) { err += dy; x0 += sx; }
-        if (e2 <= dx) { err += dx; y0 += sy; }
-    }
-}
-
-/* Bresenham midpoint circle, 1-px wide. */
-static void draw_circle(RGB *img, int cx, int cy, int radius,
-                        uint8_t r, uint8_t g, uint8_t b)
-{
-    int x = radius, y = 0;
-    int err = 1 - radius;
-    while (x >= y) {
-        put_px(img, cx + x, cy + y, r, g, b);
-        put_px(img, cx + y, cy + x, r, g, b);
-        put_px(img, cx - y, cy + x, r, g, b);
-        put_px(img, cx - x, cy + y, r, g, b);
-        put_px(img, cx - x, cy - y, r, g, b);
-        put_px(img, cx - y, cy - x, r, g, b);
-        put_px(img, cx + y, cy - x, r, g, b);
-        put_px(img, cx + x, cy - y, r, g, b);
-        y++;
-        if (err < 0) err += 2 * y + 1;
-        else        { x--; err += 2 * (y - x) + 1; }
-    }
-}
-
-/* ── 5x7 bitmap font (subset of printable ASCII) ────────────────────────
- * Each glyph: 7 bytes, one per row.  Bits 4..0 hold the 5 columns left-
- * to-right.  Missing chars render as a blank space. */
-typedef struct { char c; uint8_t rows[7]; } Glyph;
-
-static const Glyph g_font[] = {
-    {' ', {0x00,0x00,0x00,0x00,0x00,0x00,0x00}},
-    {'!', {0x04,0x04,0x04,0x04,0x00,0x00,0x04}},
-    {'(', {0x02,0x04,0x08,0x08,0x08,0x04,0x02}},
-    {')', {0x08,0x04,0x02,0x02,0x02,0x04,0x08}},
-    {'+', {0x00,0x04,0x04,0x1F,0x04,0x04,0x00}},
-    {',', {0x00,0x00,0x00,0x00,0x00,0x04,0x08}},
-    {'-', {0x00,0x00,0x00,0x1F,0x00,0x00,0x00}},
-    {'.', {0x00,0x00,0x00,0x00,0x00,0x00,0x04}},
-    {'/', {0x01,0x02,0x02,0x04,0x08,0x08,0x10}},
-    {'0', {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}},
-    {'1', {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E}},
-    {'2', {0x0E,0x11,0x01,0x06,0x08,0x10,0x1F}},
-    {'3', {0x0E,0x11,0x01,0x06,0x01,0x11,0x0E}},
-    {'4', {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}},
-    {'5', {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E}},
-    {'6', {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}},
-    {'7', {0x1F,0x01,0x02,0x04,0x08,0x08,0x08}},
-    {'8', {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}},
-    {'9', {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C}},
-    {':', {0x00,0x04,0x00,0x00,0x00,0x04,0x00}},
-    {'A', {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}},
-    {'B', {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E}},
-    {'C', {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}},
-    {'D', {0x1E,0x11,0x11,0x11,0x11,0x11,0x1E}},
-    {'E', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}},
-    {'F', {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10}},
-    {'G', {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}},
-    {'H', {0x11,0x11,0x11,0x1F,0x11,0x11,0x11}},
-    {'I', {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}},
-    {'J', {0x07,0x02,0x02,0x02,0x02,0x12,0x0C}},
-    {'K', {0x11,0x12,0x14,0x18,0x14,0x12,0x11}},
-    {'L', {0x10,0x10,0x10,0x10,0x10,0x10,0x1F}},
-    {'M', {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}},
-    {'N', {0x11,0x11,0x19,0x15,0x13,0x11,0x11}},
-    {'O', {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}},
-    {'P', {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10}},
-    {'Q', {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}},
-    {'R', {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11}},
-    {'S', {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}},
-    {'T', {0x1F,0x04,0x04,0x04,0x04,0x04,0x04}},
-    {'U', {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}},
-    {'V', {0x11,0x11,0x11,0x11,0x11,0x0A,0x04}},
-    {'W', {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}},
-    {'X', {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11}},
-    {'Y', {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}},
-    {'Z', {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F}},
-};
-
-static const Glyph *find_glyph(char c)
-{
-    /* Treat lowercase as uppercase for lookup. */
-    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
-    const int n = (int)(sizeof(g_font) / sizeof(g_font[0]));
-    for (int i = 0; i < n; i++)
-        if (g_font[i].c == c) return &g_font[i];
-    return NULL;
-}
-
-/* Draw a single 5x7 glyph at (x, y) (top-left). */
-static void draw_glyph(RGB *img, int x, int y, char c,
-                       uint8_t r, uint8_t g, uint8_t b)
-{
-    const Glyph *gl = find_glyph(c);
-    if (!gl) return;
-    for (int row = 0; row < 7; row++) {
-        uint8_t bits = gl->rows[row];
-        for (int col = 0; col < 5; col++) {
-            if (bits & (1 << (4 - col)))
-                put_px(img, x + col, y + row, r, g, b);
-        }
-    }
-}
-
-/* Draw a string left-aligned at (x, y).  Returns the x past the last glyph. */
-static int draw_text(RGB *img, int x, int y, const char *s,
-                     uint8_t r, uint8_t g, uint8_t b)
-{
-    if (!s) return x;
-    for (; *s; s++) {
-        draw_glyph(img, x, y, *s, r, g, b);
-        x += 6;     /* 5 px glyph + 1 px tracking */
-    }
-    return x;
-}
-
-/* Compute the rendered width of a string in pixels (used for right-align). */
-static int text_width(const char *s)
-{
-    if (!s) return 0;
-    return 6 * (int)strlen(s);
-}
-
-static int draw_text_right(RGB *img, int xr, int y, const char *s,
-                           uint8_t r, uint8_t g, uint8_t b)
-{
-    int w = text_width(s);
-    int x = xr - w;
-    draw_text(img, x, y, s, r, g, b);
-    return x;
-}
-
-/* ── Sector colour ramp (matches gui_sky_window.c heatmap_color) ─────── */
+/* ── Sector colour ramp (also the GUI's, via sky_render_heatmap_rgb) ─── */
 static void heatmap_color(int observed, int expected,
                           uint8_t *out_r, uint8_t *out_g, uint8_t *out_b)
 {
@@ -250,12 +91,62 @@ static void heatmap_color(int observed, int expected,
     *out_b = (uint8_t)b;
 }
 
+uint32_t sky_render_heatmap_rgb(int observed, int expected)
+{
+    uint8_t r, g, b;
+    heatmap_color(observed, expected, &r, &g, &b);
+    return RASTER_RGB(r, g, b);
+}
+
 /* ── Heatmap rasterizer ──────────────────────────────────────────────── */
-static void render_heatmap_disc(RGB *img, int cx, int cy, int radius,
-                                const SkyRenderSector *sectors)
+/* The pixel -> sector assignment only depends on the disc geometry, so it
+ * is computed once per (image size, centre, radius) and cached as spans
+ * of consecutive same-sector pixels per row.  A render is then one colour
+ * per sector and a fill per span: no sqrt / atan2 per pixel.  The cache of
+ * sky_render_heatmap_disc() (and so of sky_render_heatmap_png()) is kept
+ * until the geometry changes and is process-global, like the rest of the
+ * CLI sky state; the batch renderer builds its own map per size. */
+typedef struct {
+    uint16_t y, x0, x1;   /* inclusive pixel range on row y */
+    uint16_t sector;      /* flat index, see sky_grid_sector() */
+} DiscSpan;
+
+typedef struct {
+    int       w, h, cx, cy, radius;
+    DiscSpan *spans;
+    size_t    n, cap;
+} DiscMap;
+
+static DiscMap s_disc;
+
+static bool disc_span_add(DiscMap *m, int y, int x0, int x1, int sector)
+{
+    if (m->n == m->cap) {
+        size_t cap = m->cap ? m->cap * 2 : 4096;
+        DiscSpan *p = (DiscSpan *)realloc(m->spans, cap * sizeof(*p));
+        if (!p) return false;
+        m->spans = p;
+        m->cap   = cap;
+    }
+    DiscSpan *sp = &m->spans[m->n++];
+    sp->y      = (uint16_t)y;
+    sp->x0     = (uint16_t)x0;
+    sp->x1     = (uint16_t)x1;
+    sp->sector = (uint16_t)sector;
+    return true;
+}
+
+static bool build_disc_map(DiscMap *m, const RasterImage *img, int cx, int cy, int radius)
 {
+    if (m->spans && m->w == img->w && m->h == img->h &&
+        m->cx == cx && m->cy == cy && m->radius == radius)
+        return true;
+
+    m->n = 0;
+    m->radius = -1;   /* invalid until complete */
+
     /* Walk the bounding square; for each pixel inside the disc compute
-     * polar (r_norm, az_deg) and look up the sector. */
+     * polar (r_norm, az_deg) and look up the sector in the shared grid. */
     int x0 = cx - radius, x1 = cx + radius;
     int y0 = cy - radius, y1 = cy + radius;
     if (x0 < 0) x0 = 0;
@@ -266,54 +157,95 @@ static void render_heatmap_disc(RGB *img, int cx, int cy, int radius,
     double R = (double)radius;
     for (int y = y0; y <= y1; y++) {
         double dy = (double)y - (double)cy;
+        int run_x0 = -1, run_sector = -1;
         for (int x = x0; x <= x1; x++) {
             double dx = (double)x - (double)cx;
             double r_pix = sqrt(dx * dx + dy * dy);
-            if (r_pix > R) continue;       /* outside disc */
-            /* r_norm = 0 at zenith, 1 at horizon — same convention as the
-             * GUI: pixel-radius = (90 - el) / 90 * R. */
-            double el_deg = 90.0 - (r_pix / R) * 90.0;
-            if (el_deg < 0.0) el_deg = 0.0;
-            if (el_deg > 90.0) el_deg = 90.0;
-            int band = (int)(el_deg / 10.0);
-            if (band >= SKY_RENDER_N_EL_BANDS) band = SKY_RENDER_N_EL_BANDS - 1;
-
-            int n_bins = sky_render_az_bins_per_band[band];
-            int bin = 0;
-            if (n_bins > 1) {
+            int sector = -1;                   /* outside disc */
+            if (r_pix <= R) {
+                /* r_norm = 0 at zenith, 1 at horizon — same convention as
+                 * the GUI: pixel-radius = (90 - el) / 90 * R. */
+                double el_deg = 90.0 - (r_pix / R) * 90.0;
+                if (el_deg < 0.0) el_deg = 0.0;
+                if (el_deg > 90.0) el_deg = 90.0;
                 /* az = atan2(dx, -dy) so 0=N, +90=E, ±180=S, -90=W. */
-                double az_rad = atan2(dx, -dy);
-                double az_deg = az_rad * 180.0 / M_PI;
-                if (az_deg < 0.0) az_deg += 360.0;
-                bin = (int)floor(az_deg * (double)n_bins / 360.0);
-                if (bin < 0) bin = 0;
-                if (bin >= n_bins) bin = n_bins - 1;
+                double az_deg = atan2(dx, -dy) * 180.0 / M_PI;
+                sector = sky_grid_sector(az_deg, el_deg);
+            }
+            if (sector != run_sector) {
+                if (run_sector >= 0 &&
+                    !disc_span_add(m, y, run_x0, x - 1, run_sector))
+                    return false;
+                run_x0     = x;
+                run_sector = sector;
             }
-            const SkyRenderSector *s = &sectors[band * SKY_RENDER_MAX_AZ_BINS + bin];
-            uint8_t r, g, b;
-            heatmap_color(s->observed, s->expected, &r, &g, &b);
-            put_px(img, x, y, r, g, b);
         }
+        if (run_sector >= 0 && !disc_span_add(m, y, run_x0, x1, run_sector))
+            return false;
     }
+
+    m->w      = img->w;
+    m->h      = img->h;
+    m->cx     = cx;
+    m->cy     = cy;
+    m->radius = radius;
+    return true;
+}
+
+/* Paint the disc of @p m (already built for @p img) in the sector colours;
+ * of a band, the spans on its rows. */
+static void fill_disc(RasterImage *img, const DiscMap *m, const SkyRenderSector *sectors)
+{
+    /* heatmap_color() once per sector, then a fill per span. */
+    uint32_t rgb[SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS];
+    for (int i = 0; i < SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS; i++)
+        rgb[i] = sky_render_heatmap_rgb(sectors[i].observed, sectors[i].expected);
+
+    /* Spans are in row order: skip to the band's first row. */
+    size_t i = 0;
+    if (img->band_h > 0) {
+        size_t hi = m->n;
+        while (i < hi) {
+            size_t mid = i + (hi - i) / 2;
+            if (m->spans[mid].y < img->band_y0) i = mid + 1;
+            else                                hi = mid;
+        }
+    }
+    for (; i < m->n; i++) {
+        const DiscSpan *sp = &m->spans[i];
+        uint32_t *p = raster_row(img, sp->y);
+        if (!p) break;
+        uint32_t  c = rgb[sp->sector];
+        for (int x = sp->x0; x <= sp->x1; x++) p[x] = c;
+    }
+}
+
+bool sky_render_heatmap_disc(RasterImage *img, int cx, int cy, int radius,
+                             const SkyRenderSector *sectors)
+{
+    if (!img || !sectors || img->w > 0xFFFF || img->h > 0xFFFF) return false;
+    if (!build_disc_map(&s_disc, img, cx, cy, radius)) return false;
+    fill_disc(img, &s_disc, sectors);
+    return true;
 }
 
 /* Draw rings (0,15,30,45,60,75 deg elevation), the N-S / E-W axes, and
  * the per-ring elevation-in-degrees labels alongside the N axis. */
-static void draw_compass_rose(RGB *img, int cx, int cy, int radius)
+static void draw_compass_rose(RasterImage *img, int cx, int cy, int radius)
 {
-    const uint8_t rg = 140, gg = 140, bg = 140;   /* ring grey */
+    const uint32_t ring = RASTER_RGB(140, 140, 140);
 
     int el_lines[] = {0, 15, 30, 45, 60, 75};
     for (int i = 0; i < 6; i++) {
         int r_pix = (int)(((90.0 - (double)el_lines[i]) / 90.0) * (double)radius + 0.5);
         if (r_pix < 1) continue;
-        draw_circle(img, cx, cy, r_pix, rg, gg, bg);
+        raster_circle(img, cx, cy, r_pix, ring);
     }
 
     /* Dotted axes — sample every 3rd pixel. */
     for (int t = -radius; t <= radius; t += 3) {
-        put_px(img, cx + t, cy, 100, 100, 100);
-        put_px(img, cx, cy + t, 100, 100, 100);
+        raster_put(img, cx + t, cy, RASTER_RGB(100, 100, 100));
+        raster_put(img, cx, cy + t, RASTER_RGB(100, 100, 100));
     }
 
     /* Elevation labels in degrees, placed just right of the N axis where
@@ -327,33 +259,30 @@ static void draw_compass_rose(RGB *img, int cx, int cy, int radius)
         snprintf(buf, sizeof(buf), "%d", el_lines[i]);
         /* Glyph is 7 px tall; place top edge ~2 px above the ring so the
          * text sits cleanly outside the line. */
-        draw_text(img, cx + 3, cy - r_pix - 9, buf, 100, 100, 100);
+        raster_text(img, cx + 3, cy - r_pix - 9, buf, RASTER_RGB(100, 100, 100));
     }
 }
 
-static void draw_axis_labels(RGB *img, int cx, int cy, int radius)
+static void draw_axis_labels(RasterImage *img, int cx, int cy, int radius)
 {
-    const uint8_t r = 0, g = 0, b = 0;
+    const uint32_t c = RASTER_RGB(0, 0, 0);
     /* N: above ring */
-    draw_text(img, cx - 2, cy - radius - 10, "N", r, g, b);
+    raster_text(img, cx - 2, cy - radius - 10, "N", c);
     /* S: below ring */
-    draw_text(img, cx - 2, cy + radius + 3,  "S", r, g, b);
+    raster_text(img, cx - 2, cy + radius + 3,  "S", c);
     /* E: right of ring */
-    draw_text(img, cx + radius + 4, cy - 3,  "E", r, g, b);
+    raster_text(img, cx + radius + 4, cy - 3,  "E", c);
     /* W: left of ring */
-    draw_text(img, cx - radius - 10, cy - 3, "W", r, g, b);
+    raster_text(img, cx - radius - 10, cy - 3, "W", c);
 }
 
-static void draw_legend_and_footer(RGB *img,
-                                   bool have_arp,
-                                   double lat, double lon, double alt,
-                                   const char *mountpoint,
-                                   const char *utc_label)
+/* Title and gradient bar: the same on every heatmap of a size. */
+static void draw_legend(RasterImage *img)
 {
     /* Header: title at top-left */
-    draw_text(img, 8, 8,
-              "NTRIP-ANALYSER SKY HEATMAP (OBSERVED / EXPECTED)",
-              0, 0, 0);
+    raster_text(img, 8, 8,
+                "NTRIP-ANALYSER SKY HEATMAP (OBSERVED / EXPECTED)",
+                RASTER_RGB(0, 0, 0));
 
     /* Mini gradient bar in the top-right (0% .. 100%). */
     int bar_x = img->w - 230;
@@ -363,24 +292,31 @@ static void draw_legend_and_footer(RGB *img,
         double t = (double)i / (double)(bar_w - 1);
         int observed = (int)(t * 1000);
         int expected = 1000;
-        uint8_t cr, cg, cb;
-        heatmap_color(observed, expected, &cr, &cg, &cb);
-        for (int j = 0; j < bar_h; j++)
-            put_px(img, bar_x + i, bar_y + j, cr, cg, cb);
+        raster_fill_rect(img, bar_x + i, bar_y, bar_x + i, bar_y + bar_h - 1,
+                         sky_render_heatmap_rgb(observed, expected));
     }
     /* Outline */
-    draw_line(img, bar_x,           bar_y,         bar_x + bar_w, bar_y,         60, 60, 60);
-    draw_line(img, bar_x,           bar_y + bar_h, bar_x + bar_w, bar_y + bar_h, 60, 60, 60);
-    draw_line(img, bar_x,           bar_y,         bar_x,         bar_y + bar_h, 60, 60, 60);
-    draw_line(img, bar_x + bar_w,   bar_y,         bar_x + bar_w, bar_y + bar_h, 60, 60, 60);
-    draw_text(img, bar_x - 30,           bar_y, "0%",   0, 0, 0);
-    draw_text(img, bar_x + bar_w + 6,    bar_y, "100%", 0, 0, 0);
+    const uint32_t edge = RASTER_RGB(60, 60, 60);
+    raster_line(img, bar_x,           bar_y,         bar_x + bar_w, bar_y,         edge);
+    raster_line(img, bar_x,           bar_y + bar_h, bar_x + bar_w, bar_y + bar_h, edge);
+    raster_line(img, bar_x,           bar_y,         bar_x,         bar_y + bar_h, edge);
+    raster_line(img, bar_x + bar_w,   bar_y,         bar_x + bar_w, bar_y + bar_h, edge);
+    raster_text(img, bar_x - 30,           bar_y, "0%",   RASTER_RGB(0, 0, 0));
+    raster_text(img, bar_x + bar_w + 6,    bar_y, "100%", RASTER_RGB(0, 0, 0));
+}
 
+/* Timestamp, mountpoint and ARP: the per-heatmap part of the frame. */
+static void draw_footer(RasterImage *img,
+                        bool have_arp,
+                        double lat, double lon, double alt,
+                        const char *mountpoint,
+                        const char *utc_label)
+{
     /* Footer (bottom 12 px reserved). */
     int foot_y = img->h - 12;
 
     if (utc_label && utc_label[0]) {
-        draw_text(img, 8, foot_y, utc_label, 80, 80, 80);
+        raster_text(img, 8, foot_y, utc_label, RASTER_RGB(80, 80, 80));
     }
 
     /* Right-aligned: mountpoint + ARP block. */
@@ -397,222 +333,689 @@ static void draw_legend_and_footer(RGB *img,
                  mountpoint);
     }
     if (rbuf[0])
-        draw_text_right(img, img->w - 8, foot_y, rbuf, 80, 80, 80);
+        raster_text_right(img, img->w - 8, foot_y, rbuf, RASTER_RGB(80, 80, 80));
 }
 
-/* ─────────────────────────────────────────────────────────────────────
- * Minimal PNG writer — no external dependencies.
- *
- * Uses zlib stored (uncompressed) deflate blocks, which always work and
- * are sufficient for an 800x800 heatmap snapshot (~1.9 MB on disk).
- * ───────────────────────────────────────────────────────────────────── */
+/* Geometry: leave 60 px top margin (title + legend), 32 px elsewhere. */
+static void heatmap_geometry(int width, int height, int *cx, int *cy, int *radius)
+{
+    int margin_top   = 60;
+    int margin_other = 32;
+    int avail_w = width  - 2 * margin_other;
+    int avail_h = height - margin_top - 60;  /* 60 px bottom (axis label + footer) */
+    int diameter = (avail_w < avail_h) ? avail_w : avail_h;
+    if (diameter < 100) diameter = 100;
+    *cx = width  / 2;
+    *cy = margin_top + diameter / 2;
+    *radius = diameter / 2;
+}
 
-static uint32_t g_crc_table[256];
-static int      g_crc_init = 0;
+/* ── Banded output ──────────────────────────────────────────────────── */
+/* NTRIP_SMALL_FOOTPRINT builds never hold a whole heatmap: it is drawn
+ * RENDER_BAND_ROWS rows at a time -- every layer, clipped to the band --
+ * and each band goes to the PNG encoder before the next one reuses the
+ * buffer.  The pixels are those of the whole-image render. */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define RENDER_BAND_ROWS 32
+
+/* The whole heatmap of @p j on @p img (or the rows of a band). */
+static void heatmap_draw(RasterImage *img, const DiscMap *m, const SkyRenderJob *j)
+{
+    int cx, cy, radius;
+    heatmap_geometry(img->w, img->h, &cx, &cy, &radius);
+    raster_fill(img, RASTER_RGB(255, 255, 255));
+    fill_disc(img, m, j->sectors);
+    draw_compass_rose(img, cx, cy, radius);
+    draw_axis_labels(img, cx, cy, radius);
+    draw_legend(img);
+    draw_footer(img, j->have_arp, j->arp_lat_deg, j->arp_lon_deg,
+                j->arp_alt_m, j->mountpoint, j->utc_label);
+}
 
-static void crc_init(void)
+/* Write @p j band by band through @p band (width * RENDER_BAND_ROWS
+ * pixels); @p m is the disc map of its size. */
+static bool heatmap_write_banded(const SkyRenderJob *j, const DiscMap *m, uint32_t *band)
 {
-    if (g_crc_init) return;
-    for (uint32_t n = 0; n < 256; n++) {
-        uint32_t c = n;
-        for (int k = 0; k < 8; k++)
-            c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
-        g_crc_table[n] = c;
+    RasterPngWriter *pw = raster_png_begin(j->filename, j->width, j->height);
+    if (!pw) return false;
+    for (int y0 = 0; y0 < j->height; y0 += RENDER_BAND_ROWS) {
+        int rows = j->height - y0 < RENDER_BAND_ROWS ? j->height - y0 : RENDER_BAND_ROWS;
+        RasterImage img = { band, j->width, j->height, j->width, y0, rows };
+        heatmap_draw(&img, m, j);
+        raster_png_write_rows(pw, &img);
     }
-    g_crc_init = 1;
+    return raster_png_end(pw);
 }
+#endif
 
-static uint32_t crc32_update(uint32_t crc, const uint8_t *buf, size_t len)
+/* ── Public entry point ─────────────────────────────────────────────── */
+bool sky_render_heatmap_png(const char *filename,
+                            const SkyRenderSector *sectors,
+                            int  width, int height,
+                            bool have_arp,
+                            double arp_lat_deg,
+                            double arp_lon_deg,
+                            double arp_alt_m,
+                            const char *mountpoint,
+                            const char *utc_label)
 {
-    crc_init();
-    crc ^= 0xFFFFFFFFU;
-    for (size_t i = 0; i < len; i++)
-        crc = g_crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
-    return crc ^ 0xFFFFFFFFU;
+    if (!filename || !sectors || width < 100 || height < 100) return false;
+
+    int cx, cy, radius;
+    heatmap_geometry(width, height, &cx, &cy, &radius);
+
+#ifdef NTRIP_SMALL_FOOTPRINT
+    RasterImage dims = { NULL, width, height, width, 0, 0 };
+    if (width > 0xFFFF || height > 0xFFFF ||
+        !build_disc_map(&s_disc, &dims, cx, cy, radius))
+        return false;
+    uint32_t *band = (uint32_t *)malloc((size_t)width * RENDER_BAND_ROWS * sizeof(uint32_t));
+    if (!band) return false;
+    SkyRenderJob j = { filename, sectors, width, height, have_arp, arp_lat_deg,
+                       arp_lon_deg, arp_alt_m, mountpoint, utc_label, false };
+    bool ok = heatmap_write_banded(&j, &s_disc, band);
+    free(band);
+    return ok;
+#else
+    RasterImage img;
+    memset(&img, 0, sizeof(img));
+    img.w = width;
+    img.h = height;
+    img.stride = width;
+    img.px = (uint32_t *)malloc((size_t)img.h * (size_t)img.stride * sizeof(uint32_t));
+    if (!img.px) return false;
+
+    raster_fill(&img, RASTER_RGB(255, 255, 255));
+
+    if (!sky_render_heatmap_disc(&img, cx, cy, radius, sectors)) {
+        free(img.px);
+        return false;
+    }
+    draw_compass_rose(&img, cx, cy, radius);
+    draw_axis_labels(&img, cx, cy, radius);
+    draw_legend(&img);
+    draw_footer(&img, have_arp, arp_lat_deg, arp_lon_deg,
+                arp_alt_m, mountpoint, utc_label);
+
+    bool ok = raster_write_png(&img, filename);
+    free(img.px);
+    return ok;
+#endif
 }
 
-static uint32_t adler32_buf(const uint8_t *buf, size_t len)
+/* ── SVG writer ─────────────────────────────────────────────────────── */
+/* The same heatmap as vector graphics: one annular-sector path per sector
+ * in the heatmap_color() ramp, the rings / axes / labels / legend of the
+ * PNG as strokes and text, in the PNG's geometry.  A few kB at any size,
+ * and no rasterisation. */
+
+/* Text with the XML special characters escaped. */
+static void svg_text(FILE *f, double x, double y, const char *anchor,
+                     uint8_t r, uint8_t g, uint8_t b, const char *s)
 {
-    uint32_t a = 1, b = 0;
-    const uint32_t MOD = 65521;
-    for (size_t i = 0; i < len; i++) {
-        a = (a + buf[i]) % MOD;
-        b = (b + a) % MOD;
+    fprintf(f, "<text x=\"%.1f\" y=\"%.1f\"%s%s%s fill=\"rgb(%u,%u,%u)\">",
+            x, y, anchor ? " text-anchor=\"" : "", anchor ? anchor : "",
+            anchor ? "\"" : "", r, g, b);
+    for (; *s; s++) {
+        switch (*s) {
+        case '<':  fputs("&lt;", f);   break;
+        case '>':  fputs("&gt;", f);   break;
+        case '&':  fputs("&amp;", f);  break;
+        case '"':  fputs("&quot;", f); break;
+        default:
+            if ((unsigned char)*s >= 0x20) fputc(*s, f);
+        }
     }
-    return (b << 16) | a;
+    fputs("</text>\n", f);
 }
 
-static void write_be32(FILE *f, uint32_t v)
+/* Point at (az_deg, r_pix) from the centre: az 0 = up (N), 90 = right (E). */
+static void svg_polar(double cx, double cy, double r, double az_deg,
+                      double *x, double *y)
 {
-    uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16),
-                     (uint8_t)(v >> 8),  (uint8_t)(v) };
-    fwrite(b, 1, 4, f);
+    double a = az_deg * M_PI / 180.0;
+    *x = cx + r * sin(a);
+    *y = cy - r * cos(a);
 }
 
-static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+bool sky_render_heatmap_svg(const char *filename,
+                            const SkyRenderSector *sectors,
+                            int  width, int height,
+                            bool have_arp,
+                            double arp_lat_deg,
+                            double arp_lon_deg,
+                            double arp_alt_m,
+                            const char *mountpoint,
+                            const char *utc_label)
 {
-    write_be32(f, len);
-    fwrite(type, 1, 4, f);
-    if (len) fwrite(data, 1, len, f);
+    if (!filename || !sectors || width < 100 || height < 100) return false;
+    FILE *f = fopen(filename, "w");
+    if (!f) return false;
 
-    /* CRC over type + data. */
-    uint32_t c = crc32_update(0, (const uint8_t *)type, 4);
-    if (len) c = crc32_update(c, data, len);
-    /* crc32_update finalises by XOR with 0xFFFFFFFF; we need a fresh start
-     * because we passed crc=0 as the seed.  Re-do correctly: */
-    {
-        uint32_t crc = 0xFFFFFFFFU;
-        crc_init();
-        for (int i = 0; i < 4; i++)
-            crc = g_crc_table[(crc ^ (uint8_t)type[i]) & 0xFF] ^ (crc >> 8);
-        for (uint32_t i = 0; i < len; i++)
-            crc = g_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
-        write_be32(f, crc ^ 0xFFFFFFFFU);
+    int cx, cy, radius;
+    heatmap_geometry(width, height, &cx, &cy, &radius);
+    const double R = (double)radius;
+
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" "
+               "viewBox=\"0 0 %d %d\" font-family=\"monospace\" font-size=\"9\">\n"
+               "<rect width=\"100%%\" height=\"100%%\" fill=\"#ffffff\"/>\n",
+            width, height, width, height);
+
+    /* Sectors: band b spans elevation 10b..10b+10, i.e. radius
+     * (80-10b)/90 R .. (90-10b)/90 R.  Each sector is an arc along the
+     * middle of its band, stroked band-wide with butt ends -- exactly the
+     * annular sector; the zenith cap is a disc.  Sectors never expected
+     * are left to the light grey disc underneath. */
+    uint8_t gr, gg, gb;
+    heatmap_color(0, 0, &gr, &gg, &gb);
+    fprintf(f, "<circle cx=\"%d\" cy=\"%d\" r=\"%d\" fill=\"#%02x%02x%02x\"/>\n",
+            cx, cy, radius, gr, gg, gb);
+    const double band_w = R / 9.0;
+    for (int band = 0; band < SKY_RENDER_N_EL_BANDS; band++) {
+        int    n   = sky_render_az_bins_per_band[band];
+        double mid = (85.0 - 10.0 * band) / 90.0 * R;
+        if (n > 1)
+            fprintf(f, "<g fill=\"none\" stroke-width=\"%.2f\">\n", band_w);
+        for (int bin = 0; bin < n; bin++) {
+            const SkyRenderSector *s = &sectors[band * SKY_RENDER_MAX_AZ_BINS + bin];
+            if (s->expected <= 0) continue;
+            uint8_t cr, cg, cb;
+            heatmap_color(s->observed, s->expected, &cr, &cg, &cb);
+            if (n == 1) {
+                fprintf(f, "<circle cx=\"%d\" cy=\"%d\" r=\"%.2f\" fill=\"#%02x%02x%02x\"/>\n",
+                        cx, cy, band_w, cr, cg, cb);
+                continue;
+            }
+            double x0, y0, x1, y1;
+            svg_polar(cx, cy, mid, (double)bin * 360.0 / (double)n, &x0, &y0);
+            svg_polar(cx, cy, mid, (double)(bin + 1) * 360.0 / (double)n, &x1, &y1);
+            /* Clockwise on screen: sweep flag 1 */
+            fprintf(f, "<path d=\"M%.1f %.1fA%.1f %.1f 0 0 1 %.1f %.1f\" stroke=\"#%02x%02x%02x\"/>\n",
+                    x0, y0, mid, mid, x1, y1, cr, cg, cb);
+        }
+        if (n > 1) fputs("</g>\n", f);
     }
-    (void)c;
+
+    /* Compass rose, as draw_compass_rose(). */
+    static const int el_lines[] = {0, 15, 30, 45, 60, 75};
+    fputs("<g fill=\"none\" stroke=\"rgb(140,140,140)\">\n", f);
+    for (int i = 0; i < 6; i++)
+        fprintf(f, "<circle cx=\"%d\" cy=\"%d\" r=\"%.2f\"/>\n",
+                cx, cy, (90.0 - el_lines[i]) / 90.0 * R);
+    fputs("</g>\n", f);
+    fprintf(f, "<path d=\"M%d %dH%dM%d %dV%d\" stroke=\"rgb(100,100,100)\" "
+               "stroke-dasharray=\"1 2\"/>\n",
+            cx - radius, cy, cx + radius, cx, cy - radius, cy + radius);
+    for (int i = 1; i < 6; i++) {
+        double r_pix = (90.0 - el_lines[i]) / 90.0 * R;
+        if (r_pix < 4.0) continue;
+        char buf[8];
+        snprintf(buf, sizeof(buf), "%d", el_lines[i]);
+        svg_text(f, cx + 3, cy - r_pix - 2, NULL, 100, 100, 100, buf);
+    }
+
+    /* Axis labels, as draw_axis_labels(). */
+    svg_text(f, cx - 2,          cy - radius - 3, NULL, 0, 0, 0, "N");
+    svg_text(f, cx - 2,          cy + radius + 10, NULL, 0, 0, 0, "S");
+    svg_text(f, cx + radius + 4, cy + 4, NULL, 0, 0, 0, "E");
+    svg_text(f, cx - radius - 10, cy + 4, NULL, 0, 0, 0, "W");
+
+    /* Title and gradient bar, as draw_legend().  The ramp is linear
+     * between red, yellow and green, so three stops reproduce it. */
+    svg_text(f, 8, 15, NULL, 0, 0, 0, "NTRIP-ANALYSER SKY HEATMAP (OBSERVED / EXPECTED)");
+    uint8_t c0[3], c1[3], c2[3];
+    heatmap_color(0,    1000, &c0[0], &c0[1], &c0[2]);
+    heatmap_color(500,  1000, &c1[0], &c1[1], &c1[2]);
+    heatmap_color(1000, 1000, &c2[0], &c2[1], &c2[2]);
+    fprintf(f, "<defs><linearGradient id=\"ramp\">"
+               "<stop offset=\"0\" stop-color=\"rgb(%u,%u,%u)\"/>"
+               "<stop offset=\"0.5\" stop-color=\"rgb(%u,%u,%u)\"/>"
+               "<stop offset=\"1\" stop-color=\"rgb(%u,%u,%u)\"/>"
+               "</linearGradient></defs>\n",
+            c0[0], c0[1], c0[2], c1[0], c1[1], c1[2], c2[0], c2[1], c2[2]);
+    int bar_x = width - 230;
+    fprintf(f, "<rect x=\"%d\" y=\"10\" width=\"160\" height=\"8\" fill=\"url(#ramp)\" "
+               "stroke=\"rgb(60,60,60)\"/>\n", bar_x);
+    svg_text(f, bar_x - 30,  17, NULL, 0, 0, 0, "0%");
+    svg_text(f, bar_x + 166, 17, NULL, 0, 0, 0, "100%");
+
+    /* Footer, as draw_footer(). */
+    int foot_y = height - 5;
+    if (utc_label && utc_label[0])
+        svg_text(f, 8, foot_y, NULL, 80, 80, 80, utc_label);
+    char rbuf[512];
+    rbuf[0] = '\0';
+    if (have_arp) {
+        snprintf(rbuf, sizeof(rbuf), "%s   ARP: %.6f, %.6f, %.1f M",
+                 (mountpoint && mountpoint[0]) ? mountpoint : "(NONE)",
+                 arp_lat_deg, arp_lon_deg, arp_alt_m);
+    } else if (mountpoint && mountpoint[0]) {
+        snprintf(rbuf, sizeof(rbuf), "%s   ARP: (WAITING FOR RTCM 1005/1006)", mountpoint);
+    }
+    if (rbuf[0])
+        svg_text(f, width - 8, foot_y, "end", 80, 80, 80, rbuf);
+
+    fputs("</svg>\n", f);
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    return ok;
 }
 
-/* Build the IDAT payload: zlib stream of (filter=0 + scanline) per row,
- * encoded as one or more stored-deflate blocks. */
-static uint8_t *build_idat(const RGB *img, size_t *out_len)
+/* ── Batch renderer ─────────────────────────────────────────────────── */
+/* Everything but the disc colours and the footer text depends on the
+ * image size alone.  Per size, a layout holds the disc map and the static
+ * layers drawn over the disc (rings, axes, scale, compass letters, title,
+ * gradient bar) as runs of final pixel values: drawing them onto a black
+ * and onto a white canvas, a pixel is part of a layer exactly where the
+ * two agree.  A heatmap is then a white fill, the disc spans, one memcpy
+ * per overlay run and the footer -- the same pixels, in the same order,
+ * as sky_render_heatmap_png(). */
+typedef struct {
+    uint32_t off, len;          /* pixel offset into the image, pixels */
+} OverlayRun;
+
+typedef struct {
+    int         w, h;
+    DiscMap     disc;
+    OverlayRun *runs;
+    size_t      n_runs;
+    uint32_t   *px;             /* the runs' pixels, back to back */
+} HeatmapLayout;
+
+static bool layout_build(HeatmapLayout *L, int w, int h)
 {
-    /* Raw uncompressed image data: each row prefixed by filter byte 0. */
-    size_t row_bytes = (size_t)img->w * 3;
-    size_t raw_len   = (size_t)img->h * (1 + row_bytes);
-    uint8_t *raw = (uint8_t *)malloc(raw_len);
-    if (!raw) return NULL;
+    memset(L, 0, sizeof(*L));
+    L->w = w;
+    L->h = h;
+    int cx, cy, radius;
+    heatmap_geometry(w, h, &cx, &cy, &radius);
+
+#ifdef NTRIP_SMALL_FOOTPRINT
+    /* Banded output draws the layers on every band instead. */
+    RasterImage dims = { NULL, w, h, w, 0, 0 };
+    return build_disc_map(&L->disc, &dims, cx, cy, radius);
+#else
+    size_t size = (size_t)w * (size_t)h;
+    RasterImage a = { (uint32_t *)malloc(size * sizeof(uint32_t)), w, h, w, 0, 0 };
+    RasterImage b = { (uint32_t *)malloc(size * sizeof(uint32_t)), w, h, w, 0, 0 };
+    bool ok = a.px && b.px && build_disc_map(&L->disc, &a, cx, cy, radius);
+    if (ok) {
+        raster_fill(&a, RASTER_RGB(0, 0, 0));
+        raster_fill(&b, RASTER_RGB(255, 255, 255));
+        RasterImage *canvas[2] = { &a, &b };
+        for (int k = 0; k < 2; k++) {
+            draw_compass_rose(canvas[k], cx, cy, radius);
+            draw_axis_labels(canvas[k], cx, cy, radius);
+            draw_legend(canvas[k]);
+        }
 
-    {
-        uint8_t *p = raw;
-        for (int y = 0; y < img->h; y++) {
-            *p++ = 0;   /* filter "None" */
-            memcpy(p, img->pixels + (size_t)y * img->stride, row_bytes);
-            p += row_bytes;
+        /* Two passes over the canvases: count, then copy out. */
+        for (int pass = 0; pass < 2 && ok; pass++) {
+            size_t n = 0, n_px = 0;
+            bool   in_run = false;
+            for (size_t p = 0; p < size; p++) {
+                if (a.px[p] != b.px[p]) {
+                    in_run = false;
+                    continue;
+                }
+                if (!in_run) {
+                    if (pass) {
+                        L->runs[n].off = (uint32_t)p;
+                        L->runs[n].len = 0;
+                    }
+                    n++;
+                    in_run = true;
+                }
+                if (pass) {
+                    L->runs[n - 1].len++;
+                    L->px[n_px] = a.px[p];
+                }
+                n_px++;
+            }
+            if (!pass) {
+                L->n_runs = n;
+                L->runs = (OverlayRun *)malloc((n ? n : 1) * sizeof(*L->runs));
+                L->px   = (uint32_t *)malloc((n_px ? n_px : 1) * sizeof(uint32_t));
+                ok = L->runs && L->px;
+            }
         }
     }
+    free(a.px);
+    free(b.px);
+    return ok;
+#endif
+}
 
-    /* zlib wrapper: 2-byte header + deflate stream + 4-byte Adler32 (BE).
-     * Stored deflate overhead per block: 1 byte header + 4 bytes len/nlen
-     * = 5 bytes.  At most 65535 raw bytes per block. */
-    size_t n_blocks = (raw_len + 65534) / 65535;
-    if (n_blocks == 0) n_blocks = 1;
-    size_t zlib_len = 2 + n_blocks * 5 + raw_len + 4;
-    uint8_t *zlib = (uint8_t *)malloc(zlib_len);
-    if (!zlib) { free(raw); return NULL; }
-
-    uint8_t *p = zlib;
-    /* CMF + FLG -- CMF=0x78 (deflate, 32K window), FLG chosen so that
-     * (CMF<<8 | FLG) % 31 == 0.  0x78 0x01 satisfies that. */
-    *p++ = 0x78;
-    *p++ = 0x01;
-
-    size_t remain = raw_len;
-    const uint8_t *src = raw;
-    while (remain > 0) {
-        size_t chunk = (remain > 65535) ? 65535 : remain;
-        int is_last = (chunk == remain);
-        *p++ = (uint8_t)(is_last ? 0x01 : 0x00);  /* BFINAL | BTYPE=00 */
-        *p++ = (uint8_t)(chunk & 0xFF);
-        *p++ = (uint8_t)((chunk >> 8) & 0xFF);
-        uint16_t nlen = (uint16_t)~chunk;
-        *p++ = (uint8_t)(nlen & 0xFF);
-        *p++ = (uint8_t)((nlen >> 8) & 0xFF);
-        memcpy(p, src, chunk);
-        p += chunk;
-        src += chunk;
-        remain -= chunk;
+static void layout_free(HeatmapLayout *L)
+{
+    free(L->disc.spans);
+    free(L->runs);
+    free(L->px);
+}
+
+/* Copy the static layers of @p L over @p img. */
+static void layout_overlay(RasterImage *img, const HeatmapLayout *L)
+{
+    const uint32_t *src = L->px;
+    for (size_t r = 0; r < L->n_runs; r++) {
+        memcpy(img->px + L->runs[r].off, src, L->runs[r].len * sizeof(uint32_t));
+        src += L->runs[r].len;
     }
+}
 
-    /* Adler32 of the raw uncompressed data, big-endian. */
-    uint32_t adl = adler32_buf(raw, raw_len);
-    *p++ = (uint8_t)((adl >> 24) & 0xFF);
-    *p++ = (uint8_t)((adl >> 16) & 0xFF);
-    *p++ = (uint8_t)((adl >>  8) & 0xFF);
-    *p++ = (uint8_t)( adl        & 0xFF);
+#define LAYOUT_SVG (-2)                 /* vector job: no raster layout */
 
-    free(raw);
+typedef struct {
+    SkyRenderJob        *jobs;
+    int                  n;
+    const HeatmapLayout *layouts;
+    const int           *layout_of;     /* per job; -1 = invalid job, LAYOUT_SVG */
+    size_t               max_size;      /* largest image (band), pixels */
+    int                  next;
+} HeatmapBatch;
+
+static void batch_render_work(HeatmapBatch *q)
+{
+    uint32_t *pixels = (uint32_t *)malloc(q->max_size * sizeof(uint32_t));
+    for (;;) {
+        int k = __atomic_fetch_add(&q->next, 1, __ATOMIC_RELAXED);
+        if (k >= q->n) break;
+        SkyRenderJob *j = &q->jobs[k];
+        j->ok = false;
+        if (q->layout_of[k] == LAYOUT_SVG) {
+            j->ok = sky_render_heatmap_svg(j->filename, j->sectors, j->width, j->height,
+                                           j->have_arp, j->arp_lat_deg, j->arp_lon_deg,
+                                           j->arp_alt_m, j->mountpoint, j->utc_label);
+            continue;
+        }
+        if (!pixels || q->layout_of[k] < 0) continue;
 
-    *out_len = (size_t)(p - zlib);
-    return zlib;
+        const HeatmapLayout *L = &q->layouts[q->layout_of[k]];
+#ifdef NTRIP_SMALL_FOOTPRINT
+        j->ok = heatmap_write_banded(j, &L->disc, pixels);
+        continue;
+#endif
+        RasterImage img = { pixels, L->w, L->h, L->w, 0, 0 };
+        raster_fill(&img, RASTER_RGB(255, 255, 255));
+        fill_disc(&img, &L->disc, j->sectors);
+        layout_overlay(&img, L);
+        draw_footer(&img, j->have_arp, j->arp_lat_deg, j->arp_lon_deg,
+                    j->arp_alt_m, j->mountpoint, j->utc_label);
+        j->ok = raster_write_png(&img, j->filename);
+    }
+    free(pixels);
 }
 
-static bool write_png(const char *filename, const RGB *img)
+#ifdef _WIN32
+static unsigned __stdcall batch_render_thread(void *arg)
 {
-    FILE *f = fopen(filename, "wb");
-    if (!f) return false;
+    batch_render_work((HeatmapBatch *)arg);
+    return 0;
+}
+#else
+static void *batch_render_thread(void *arg)
+{
+    batch_render_work((HeatmapBatch *)arg);
+    return NULL;
+}
+#endif
 
-    static const uint8_t SIG[8] = { 0x89,'P','N','G',0x0D,0x0A,0x1A,0x0A };
-    fwrite(SIG, 1, 8, f);
-
-    /* IHDR: width(4 BE) height(4 BE) depth=8 colorType=2 (RGB) comp=0 filt=0 interlace=0 */
-    uint8_t ihdr[13];
-    ihdr[0] = (uint8_t)((img->w >> 24) & 0xFF);
-    ihdr[1] = (uint8_t)((img->w >> 16) & 0xFF);
-    ihdr[2] = (uint8_t)((img->w >>  8) & 0xFF);
-    ihdr[3] = (uint8_t)( img->w        & 0xFF);
-    ihdr[4] = (uint8_t)((img->h >> 24) & 0xFF);
-    ihdr[5] = (uint8_t)((img->h >> 16) & 0xFF);
-    ihdr[6] = (uint8_t)((img->h >>  8) & 0xFF);
-    ihdr[7] = (uint8_t)( img->h        & 0xFF);
-    ihdr[8]  = 8;     /* bit depth */
-    ihdr[9]  = 2;     /* color type: RGB */
-    ihdr[10] = 0;     /* compression */
-    ihdr[11] = 0;     /* filter */
-    ihdr[12] = 0;     /* interlace */
-    write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
-
-    size_t idat_len = 0;
-    uint8_t *idat = build_idat(img, &idat_len);
-    if (!idat) { fclose(f); return false; }
-    write_chunk(f, "IDAT", idat, (uint32_t)idat_len);
-    free(idat);
-
-    write_chunk(f, "IEND", NULL, 0);
-
-    fclose(f);
-    return true;
+static int render_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
 }
 
-/* ── Public entry point ─────────────────────────────────────────────── */
-bool sky_render_heatmap_png(const char *filename,
-                            const SkyRenderSector *sectors,
-                            int  width, int height,
-                            bool have_arp,
-                            double arp_lat_deg,
-                            double arp_lon_deg,
-                            double arp_alt_m,
-                            const char *mountpoint,
-                            const char *utc_label)
+int sky_render_heatmap_batch(SkyRenderJob *jobs, int n_jobs, int threads)
 {
-    if (!filename || !sectors || width < 100 || height < 100) return false;
+    if (!jobs || n_jobs <= 0) return 0;
+
+    /* One layout per distinct size, built here before any worker starts;
+     * so are the lazily built glyph, CRC and DEFLATE tables the workers
+     * share. */
+    HeatmapLayout layouts[SKY_RENDER_MAX_SIZES];
+    int n_layouts = 0;
+    int *layout_of = (int *)malloc((size_t)n_jobs * sizeof(int));
+    if (!layout_of) return 0;
+    size_t max_size = 0;
+    for (int k = 0; k < n_jobs; k++) {
+        SkyRenderJob *j = &jobs[k];
+        layout_of[k] = -1;
+        j->ok = false;
+        if (!j->filename || !j->sectors || j->width < 100 || j->height < 100 ||
+            j->width > 0xFFFF || j->height > 0xFFFF)
+            continue;
+        if (sky_render_is_svg(j->filename)) {
+            layout_of[k] = LAYOUT_SVG;
+            continue;
+        }
+        int l = 0;
+        while (l < n_layouts && (layouts[l].w != j->width || layouts[l].h != j->height)) l++;
+        if (l == n_layouts) {
+            if (n_layouts == SKY_RENDER_MAX_SIZES) continue;
+            if (!layout_build(&layouts[l], j->width, j->height)) {
+                layout_free(&layouts[l]);
+                continue;
+            }
+            n_layouts++;
+#ifdef NTRIP_SMALL_FOOTPRINT
+            size_t size = (size_t)j->width * RENDER_BAND_ROWS;
+#else
+            size_t size = (size_t)j->width * (size_t)j->height;
+#endif
+            if (size > max_size) max_size = size;
+        }
+        layout_of[k] = l;
+    }
+    raster_init();
+
+    HeatmapBatch q;
+    q.jobs      = jobs;
+    q.n         = n_jobs;
+    q.layouts   = layouts;
+    q.layout_of = layout_of;
+    q.max_size  = max_size ? max_size : 1;
+    q.next      = 0;
+
+    if (threads <= 0) threads = render_cpu_count();
+    if (threads > SKY_RENDER_MAX_THREADS) threads = SKY_RENDER_MAX_THREADS;
+    if (threads > n_jobs) threads = n_jobs;
+#ifdef _WIN32
+    HANDLE threads_h[SKY_RENDER_MAX_THREADS];
+#else
+    pthread_t threads_h[SKY_RENDER_MAX_THREADS];
+#endif
+    bool started[SKY_RENDER_MAX_THREADS] = { false };
+    for (int t = 1; t < threads; t++) {
+#ifdef _WIN32
+        threads_h[t] = (HANDLE)_beginthreadex(NULL, 0, batch_render_thread, &q, 0, NULL);
+        started[t] = threads_h[t] != NULL;
+#else
+        started[t] = pthread_create(&threads_h[t], NULL, batch_render_thread, &q) == 0;
+#endif
+    }
+    /* This thread works the queue too; threads that did not start only
+     * leave more jobs for the others. */
+    batch_render_work(&q);
+    for (int t = 1; t < threads; t++) {
+        if (!started[t]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads_h[t], INFINITE);
+        CloseHandle(threads_h[t]);
+#else
+        pthread_join(threads_h[t], NULL);
+#endif
+    }
 
-    RGB img;
-    img.w = width;
-    img.h = height;
-    img.stride = width * 3;
-    img.pixels = (uint8_t *)malloc((size_t)img.h * (size_t)img.stride);
-    if (!img.pixels) return false;
+    for (int l = 0; l < n_layouts; l++) layout_free(&layouts[l]);
+    free(layout_of);
+    int written = 0;
+    for (int k = 0; k < n_jobs; k++) written += jobs[k].ok;
+    return written;
+}
 
-    fill_all(&img, 255, 255, 255);
+/* ── Live renderer ──────────────────────────────────────────────────── */
+/* One image per job kept between updates.  An update repaints only the
+ * spans whose sector changed colour and the footer rows -- those back to
+ * white and whatever disc spans cross them -- then lays the static layers
+ * and the new footer over it: the pixels of a batch render of the same
+ * job, for the cost of the changed sectors and the overlay copy.  The
+ * rows it repainted are the only ones the PNG writer filters again. */
+typedef struct {
+    HeatmapLayout L;
+    bool          valid;
+    uint32_t     *px;
+    uint8_t      *dirty;        /* per row: repainted by this update */
+    RasterPngRows png;
+    uint32_t      rgb[SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS];
+} LiveImage;
+
+struct SkyRenderLive {
+    LiveImage img[SKY_RENDER_MAX_SIZES];
+};
 
-    /* Geometry: leave 80 px top margin (title + legend), 32 px elsewhere. */
-    int margin_top   = 60;
-    int margin_other = 32;
-    int avail_w = width  - 2 * margin_other;
-    int avail_h = height - margin_top - 60;  /* 60 px bottom (axis label + footer) */
-    int diameter = (avail_w < avail_h) ? avail_w : avail_h;
-    if (diameter < 100) diameter = 100;
-    int cx = width  / 2;
-    int cy = margin_top + diameter / 2;
-    int radius = diameter / 2;
+SkyRenderLive *sky_render_live_new(void)
+{
+    raster_init();
+    return (SkyRenderLive *)calloc(1, sizeof(SkyRenderLive));
+}
 
-    render_heatmap_disc(&img, cx, cy, radius, sectors);
-    draw_compass_rose(&img, cx, cy, radius);
-    draw_axis_labels(&img, cx, cy, radius);
-    draw_legend_and_footer(&img, have_arp, arp_lat_deg, arp_lon_deg,
-                           arp_alt_m, mountpoint, utc_label);
+static void live_image_free(LiveImage *li)
+{
+    if (li->valid) layout_free(&li->L);
+    free(li->px);
+    free(li->dirty);
+    raster_png_rows_free(&li->png);
+    memset(li, 0, sizeof(*li));
+}
 
-    bool ok = write_png(filename, &img);
-    free(img.pixels);
-    return ok;
+void sky_render_live_free(SkyRenderLive *lv)
+{
+    if (!lv) return;
+    for (int k = 0; k < SKY_RENDER_MAX_SIZES; k++) live_image_free(&lv->img[k]);
+    free(lv);
+}
+
+static bool live_render(LiveImage *li, SkyRenderJob *j)
+{
+#ifdef NTRIP_SMALL_FOOTPRINT
+    /* Only the disc map and one band are kept: each update is a banded
+     * render of the whole heatmap. */
+    if (!li->valid || li->L.w != j->width || li->L.h != j->height) {
+        live_image_free(li);
+        li->px = (uint32_t *)malloc((size_t)j->width * RENDER_BAND_ROWS * sizeof(uint32_t));
+        if (!li->px || !layout_build(&li->L, j->width, j->height)) {
+            layout_free(&li->L);
+            live_image_free(li);
+            return false;
+        }
+        li->valid = true;
+    }
+    return heatmap_write_banded(j, &li->L.disc, li->px);
+#else
+    bool full = false;
+    if (!li->valid || li->L.w != j->width || li->L.h != j->height) {
+        live_image_free(li);
+        size_t size = (size_t)j->width * (size_t)j->height;
+        li->px    = (uint32_t *)malloc(size * sizeof(uint32_t));
+        li->dirty = (uint8_t *)malloc((size_t)j->height);
+        if (!li->px || !li->dirty || !layout_build(&li->L, j->width, j->height)) {
+            layout_free(&li->L);        /* zeroed or partly built */
+            live_image_free(li);
+            return false;
+        }
+        li->valid = true;
+        full = true;
+    }
+    RasterImage img = { li->px, li->L.w, li->L.h, li->L.w, 0, 0 };
+    if (full) raster_fill(&img, RASTER_RGB(255, 255, 255));
+    memset(li->dirty, full, (size_t)img.h);
+
+    /* The rows draw_footer() writes. */
+    int foot_y0 = img.h - 12, foot_y1 = foot_y0 + RASTER_GLYPH_H - 1;
+    raster_fill_rect(&img, 0, foot_y0, img.w - 1, foot_y1, RASTER_RGB(255, 255, 255));
+    for (int y = foot_y0; y <= foot_y1; y++)
+        if (y >= 0 && y < img.h) li->dirty[y] = 1;
+
+    bool changed[SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS];
+    for (int i = 0; i < SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS; i++) {
+        uint32_t c = sky_render_heatmap_rgb(j->sectors[i].observed, j->sectors[i].expected);
+        changed[i] = full || c != li->rgb[i];
+        li->rgb[i] = c;
+    }
+    const DiscMap *m = &li->L.disc;
+    for (size_t i = 0; i < m->n; i++) {
+        const DiscSpan *sp = &m->spans[i];
+        if (!changed[sp->sector] && (sp->y < foot_y0 || sp->y > foot_y1)) continue;
+        uint32_t *p = img.px + (size_t)sp->y * img.stride;
+        uint32_t  c = li->rgb[sp->sector];
+        for (int x = sp->x0; x <= sp->x1; x++) p[x] = c;
+        li->dirty[sp->y] = 1;
+    }
+    layout_overlay(&img, &li->L);
+    draw_footer(&img, j->have_arp, j->arp_lat_deg, j->arp_lon_deg,
+                j->arp_alt_m, j->mountpoint, j->utc_label);
+    return raster_write_png_rows(&img, j->filename, &li->png, li->dirty);
+#endif
+}
+
+int sky_render_live_update(SkyRenderLive *lv, SkyRenderJob *jobs, int n_jobs)
+{
+    int written = 0;
+    for (int k = 0; k < n_jobs; k++) {
+        SkyRenderJob *j = &jobs[k];
+        j->ok = false;
+        if (!lv || k >= SKY_RENDER_MAX_SIZES || !j->filename || !j->sectors ||
+            j->width < 100 || j->height < 100 || j->width > 0xFFFF || j->height > 0xFFFF)
+            continue;
+        if (sky_render_is_svg(j->filename))
+            j->ok = sky_render_heatmap_svg(j->filename, j->sectors, j->width, j->height,
+                                           j->have_arp, j->arp_lat_deg, j->arp_lon_deg,
+                                           j->arp_alt_m, j->mountpoint, j->utc_label);
+        else
+            j->ok = live_render(&lv->img[k], j);
+        written += j->ok;
+    }
+    return written;
+}
+
+bool sky_render_is_svg(const char *filename)
+{
+    size_t len = filename ? strlen(filename) : 0;
+    return len >= 4 && (strcmp(filename + len - 4, ".svg") == 0 ||
+                        strcmp(filename + len - 4, ".SVG") == 0);
+}
+
+int sky_render_parse_sizes(const char *list, SkyRenderSize *out, int max)
+{
+    int n = 0;
+    const char *p = list;
+    while (p && *p) {
+        char *end;
+        long w = strtol(p, &end, 10);
+        long h = w;
+        if (end == p) return -1;
+        if (*end == 'x' || *end == 'X') {
+            p = end + 1;
+            h = strtol(p, &end, 10);
+            if (end == p) return -1;
+        }
+        if (w < 100 || h < 100 || w > SKY_RENDER_MAX_DIM || h > SKY_RENDER_MAX_DIM ||
+            n == max)
+            return -1;
+        out[n].width  = (int)w;
+        out[n].height = (int)h;
+        n++;
+        if (*end == ',') end++;
+        else if (*end) return -1;
+        p = end;
+    }
+    return n;
 }
@@ -3,11 +3,17 @@
  * @brief Portable polar sky-heatmap renderer and PNG writer.
  *
  * Generates the same Onocoy-style observed/expected sector heatmap as the
- * GUI's gui_sky_window.c (heatmap mode), but rendered into an in-memory
- * RGB buffer and serialised as a PNG file.  No GDI+ / no libpng / no zlib
- * dependency: the file embeds a minimal PNG encoder that uses stored
- * (uncompressed) deflate blocks, which is sufficient for the modest size
- * (~ a few MB at 800x800) of a sky-plot snapshot.
+ * GUI's gui_sky_window.c (heatmap mode), drawn with the software
+ * rasteriser of raster.h and saved with its PNG writer.  No GDI+ / no
+ * libpng / no zlib dependency; the flat sector colours of an 800x800
+ * snapshot compress to a few tens of kB.  The GUI fills its heatmap disc
+ * with sky_render_heatmap_disc() and colours its legend with
+ * sky_render_heatmap_rgb(), so both draw the sectors pixel for pixel
+ * alike.
+ *
+ * sky_render_heatmap_batch() renders a list of them -- many stations,
+ * several sizes each -- on a thread pool, drawing the legend, compass
+ * rose and labels once per size instead of once per image.
  *
  * Used by the CLI `-s` / `--sky` mode.  Geometry constants match
  * gui_state.h (SKY_N_EL_BANDS, sky_az_bins_per_band[]) so the GUI and
@@ -22,6 +28,9 @@
 #define SKY_RENDER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "raster.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,11 +54,42 @@ typedef struct {
     int expected;
 } SkyRenderSector;
 
+/** Distinct image sizes one sky_render_heatmap_batch() call renders. */
+#define SKY_RENDER_MAX_SIZES   8
+
+/** Upper bound on sky_render_heatmap_batch() threads. */
+#define SKY_RENDER_MAX_THREADS 64
+
+/** Largest width / height sky_render_parse_sizes() accepts, pixels. */
+#define SKY_RENDER_MAX_DIM     8192
+
 /** Azimuth-bin count per elevation band (must mirror gui_state.h). */
 extern const int sky_render_az_bins_per_band[SKY_RENDER_N_EL_BANDS];
 
 /**
- * @brief Save a sector-heatmap PNG to disk.
+ * @brief Colour of a sector on the observed / expected ramp
+ *        (red - yellow - green; light grey when nothing was expected).
+ * @return RASTER_RGB() pixel.
+ */
+uint32_t sky_render_heatmap_rgb(int observed, int expected);
+
+/**
+ * @brief Fill the heatmap disc of @p radius around (cx, cy) into @p img.
+ *
+ * Pixel (x, y) takes the colour of the sector holding its azimuth and
+ * elevation (elevation 90 at the centre, 0 at the rim).  The pixel-to-
+ * sector map is cached as spans and rebuilt only when the geometry
+ * changes, so a repaint is one colour per sector and a fill per span.
+ * Shares its cache with sky_render_heatmap_png(): call both from one
+ * thread (the CLI's, or the GUI's UI thread).
+ *
+ * @return false when the image is larger than 65535 px or out of memory.
+ */
+bool sky_render_heatmap_disc(RasterImage *img, int cx, int cy, int radius,
+                             const SkyRenderSector *sectors);
+
+/**
+ * @brief Save a sector-heatmap PNG to disk (see also sky_render_heatmap_svg()).
  *
  * @param filename     Path of the PNG file to create (overwrites if present).
  * @param sectors      Sector grid; indexed [band][bin], bin < sky_render_az_bins_per_band[band].
@@ -61,6 +101,10 @@ extern const int sky_render_az_bins_per_band[SKY_RENDER_N_EL_BANDS];
  * @param arp_alt_m    ARP altitude (metres ellipsoidal).
  * @param mountpoint   NTRIP mountpoint name for the footer (NULL or "" hides it).
  * @param utc_label    UTC timestamp string for the footer (e.g. "2026-05-29 18:42:01 UTC").
+ * Not thread-safe: the pixel-to-sector map of the disc is cached between
+ * calls and only rebuilt when @p width / @p height change, so rendering
+ * many heatmaps of one size costs one gather per image.
+ *
  * @return true on success, false on I/O or allocation failure.
  */
 bool sky_render_heatmap_png(const char *filename,
@@ -73,6 +117,103 @@ bool sky_render_heatmap_png(const char *filename,
                             const char *mountpoint,
                             const char *utc_label);
 
+/**
+ * @brief Save the same heatmap as an SVG document.
+ *
+ * One annular-sector path per sector in the PNG's colour ramp, plus the
+ * rings, axes, labels, legend and footer as vector strokes and text, in
+ * the PNG's layout for @p width x @p height.  A few kB at any size.
+ * Arguments as sky_render_heatmap_png(); thread-safe.
+ *
+ * @return true on success, false on I/O failure.
+ */
+bool sky_render_heatmap_svg(const char *filename,
+                            const SkyRenderSector *sectors,
+                            int  width, int height,
+                            bool have_arp,
+                            double arp_lat_deg,
+                            double arp_lon_deg,
+                            double arp_alt_m,
+                            const char *mountpoint,
+                            const char *utc_label);
+
+/** @brief true if @p filename ends in ".svg" (either case). */
+bool sky_render_is_svg(const char *filename);
+
+/**
+ * @struct SkyRenderJob
+ * @brief One PNG of a sky_render_heatmap_batch() call; the fields are the
+ *        arguments of sky_render_heatmap_png().
+ */
+typedef struct {
+    const char            *filename;
+    const SkyRenderSector *sectors;
+    int                    width, height;
+    bool                   have_arp;
+    double                 arp_lat_deg, arp_lon_deg, arp_alt_m;
+    const char            *mountpoint;
+    const char            *utc_label;
+    bool                   ok;          /**< [out] the PNG was written */
+} SkyRenderJob;
+
+/**
+ * @brief Render @p n_jobs heatmaps on @p threads threads (0 = one per core).
+ *
+ * The layers that only depend on the image size -- compass rose, axis
+ * labels, title, gradient bar and the pixel-to-sector map of the disc --
+ * are built once per distinct size (at most @ref SKY_RENDER_MAX_SIZES);
+ * each job then fills the disc, copies those layers over it and draws its
+ * footer.  The PNGs are byte-identical to sky_render_heatmap_png() ones.
+ * A job whose @c filename ends in ".svg" is written by
+ * sky_render_heatmap_svg() instead.
+ * Call it from one thread at a time.
+ *
+ * NTRIP_SMALL_FOOTPRINT builds keep only the disc map per size and draw
+ * every layer of each job band by band, never holding a whole image.
+ *
+ * @return Jobs written; see SkyRenderJob::ok for which.
+ */
+int sky_render_heatmap_batch(SkyRenderJob *jobs, int n_jobs, int threads);
+
+/** @brief Heatmaps kept between sky_render_live_update() calls. */
+typedef struct SkyRenderLive SkyRenderLive;
+
+/** @brief New live renderer; NULL when out of memory. */
+SkyRenderLive *sky_render_live_new(void);
+
+/**
+ * @brief Write the heatmaps of @p jobs again, reusing the images of the
+ *        previous call.
+ *
+ * Job k keeps its image and layout from one call to the next (rebuilt
+ * when its size changes): only the sectors whose colour changed and the
+ * footer are repainted before the PNG is encoded, so an update costs the
+ * encoding plus a few spans.  The PNGs equal sky_render_heatmap_batch()
+ * ones; ".svg" jobs are written by sky_render_heatmap_svg().  At most
+ * @ref SKY_RENDER_MAX_SIZES jobs; one thread per renderer.  In
+ * NTRIP_SMALL_FOOTPRINT builds nothing but the disc map is kept and each
+ * update renders the job band by band.
+ *
+ * @return Jobs written; see SkyRenderJob::ok for which.
+ */
+int sky_render_live_update(SkyRenderLive *lv, SkyRenderJob *jobs, int n_jobs);
+
+/** @brief Free @p lv (NULL is ignored). */
+void sky_render_live_free(SkyRenderLive *lv);
+
+/** @brief One output size: width x height pixels. */
+typedef struct {
+    int width, height;
+} SkyRenderSize;
+
+/**
+ * @brief Parse a size list such as "800,200" or "1024x768,320x240" (a
+ *        single number is a square), each side 100..@ref SKY_RENDER_MAX_DIM.
+ * @return Sizes stored in @p out, or -1 if @p list is malformed or holds
+ *         more than @p max.
+ */
+int sky_render_parse_sizes(const char *list, SkyRenderSize *out, int max);
+
 #ifdef __cplusplus
 }
 #endif
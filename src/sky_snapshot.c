@@ -0,0 +1,263 @@
+/**
+ * @file sky_snapshot.c
+ * @brief Live heatmaps of a sky collection, rendered on a thread of
+ *        their own.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <process.h>  // _beginthreadex
+#else
+    #include <pthread.h>
+    #include <time.h>
+#endif
+
+#include "sky_snapshot.h"
+#include "stream_clock.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAP_N_SECTORS (SKY_RENDER_N_EL_BANDS * SKY_RENDER_MAX_AZ_BINS)
+
+/* One submitted set of jobs and everything they point to. */
+typedef struct {
+    int             n;
+    SkyRenderJob    jobs[SKY_RENDER_MAX_SIZES];
+    char            names[SKY_RENDER_MAX_SIZES][512];
+    char            tmp[SKY_RENDER_MAX_SIZES][520];
+    SkyRenderSector sectors[SNAP_N_SECTORS];
+    char            mountpoint[64];
+    char            utc_label[64];
+} SnapshotFrame;
+
+struct SkySnapshot {
+    int            interval_s;
+    bool           quiet;
+    double         next;            /* submitter: wall time of the next snapshot */
+    SnapshotFrame *pending;         /* under lock: waiting when have_pending */
+    SnapshotFrame *out;             /* thread: the frame being rendered */
+    bool           have_pending;    /* under lock */
+    int            stop;            /* under lock */
+    uint64_t       written;         /* thread */
+    uint64_t       failed;          /* thread */
+    uint64_t       replaced;        /* under lock */
+    SkyRenderLive *live;            /* thread */
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    HANDLE           thread;
+#else
+    pthread_mutex_t  lock;
+    pthread_t        thread;
+#endif
+};
+
+static void snap_lock(SkySnapshot *s)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&s->lock);
+#else
+    pthread_mutex_lock(&s->lock);
+#endif
+}
+
+static void snap_unlock(SkySnapshot *s)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&s->lock);
+#else
+    pthread_mutex_unlock(&s->lock);
+#endif
+}
+
+static void snap_sleep_100ms(void)
+{
+#ifdef _WIN32
+    Sleep(100);
+#else
+    struct timespec ts = { 0, 100 * 1000 * 1000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* "<stem>.tmp<ext>": the extension stays last, so a ".svg" job is still
+ * written as SVG. */
+static void snap_tmp_name(const char *path, char *buf, size_t len)
+{
+    const char *base = path;
+    for (const char *p = path; *p; p++)
+        if (*p == '/' || *p == '\\') base = p + 1;
+    const char *dot = strrchr(base, '.');
+    if (!dot || dot == base) {
+        snprintf(buf, len, "%s.tmp", path);
+        return;
+    }
+    snprintf(buf, len, "%.*s.tmp%s", (int)(dot - path), path, dot);
+}
+
+/* Replace @p path by @p tmp in one step (rename() won't replace on Windows). */
+static bool snap_replace(const char *tmp, const char *path)
+{
+#ifdef _WIN32
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp, path) == 0;
+#endif
+}
+
+static void snap_render(SkySnapshot *s, SnapshotFrame *fr)
+{
+    sky_render_live_update(s->live, fr->jobs, fr->n);
+    bool ok = true;
+    for (int k = 0; k < fr->n; k++) {
+        if (fr->jobs[k].ok && snap_replace(fr->tmp[k], fr->names[k])) continue;
+        remove(fr->tmp[k]);
+        if (!s->quiet && s->failed == 0)
+            fprintf(stderr, "[SKY] Cannot write snapshot %s\n", fr->names[k]);
+        ok = false;
+    }
+    if (ok) s->written++;
+    else    s->failed++;
+}
+
+static void snap_loop(SkySnapshot *s)
+{
+    for (;;) {
+        bool take = false, stop;
+        snap_lock(s);
+        stop = s->stop != 0;
+        if (s->have_pending) {
+            SnapshotFrame *fr = s->out;
+            s->out          = s->pending;
+            s->pending      = fr;
+            s->have_pending = false;
+            take            = true;
+        }
+        snap_unlock(s);
+        if (take) {
+            snap_render(s, s->out);
+            continue;
+        }
+        if (stop) break;
+        snap_sleep_100ms();
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall snap_thread(void *arg)
+#else
+static void *snap_thread(void *arg)
+#endif
+{
+    snap_loop((SkySnapshot *)arg);
+    return 0;
+}
+
+SkySnapshot *sky_snapshot_open(int interval_s, bool quiet)
+{
+    SkySnapshot *s = (SkySnapshot *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->interval_s = interval_s;
+    s->quiet      = quiet;
+    s->next       = stream_clock_wall_seconds() + interval_s;
+    s->pending    = (SnapshotFrame *)calloc(1, sizeof(SnapshotFrame));
+    s->out        = (SnapshotFrame *)calloc(1, sizeof(SnapshotFrame));
+    s->live       = sky_render_live_new();
+    if (!s->pending || !s->out || !s->live) {
+        fprintf(stderr, "[ERROR] --snapshot-interval: out of memory\n");
+        sky_render_live_free(s->live);
+        free(s->pending);
+        free(s->out);
+        free(s);
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&s->lock);
+    s->thread = (HANDLE)_beginthreadex(NULL, 0, snap_thread, s, 0, NULL);
+    bool started = s->thread != NULL;
+#else
+    pthread_mutex_init(&s->lock, NULL);
+    bool started = pthread_create(&s->thread, NULL, snap_thread, s) == 0;
+#endif
+    if (!started) {
+        fprintf(stderr, "[ERROR] --snapshot-interval: cannot start the render thread\n");
+#ifdef _WIN32
+        DeleteCriticalSection(&s->lock);
+#else
+        pthread_mutex_destroy(&s->lock);
+#endif
+        sky_render_live_free(s->live);
+        free(s->pending);
+        free(s->out);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+bool sky_snapshot_due(const SkySnapshot *s)
+{
+    return s && stream_clock_wall_seconds() >= s->next;
+}
+
+void sky_snapshot_submit(SkySnapshot *s, const SkyRenderJob *jobs, int n_jobs)
+{
+    if (!s) return;
+    s->next = stream_clock_wall_seconds() + s->interval_s;
+    if (n_jobs > SKY_RENDER_MAX_SIZES) n_jobs = SKY_RENDER_MAX_SIZES;
+    if (n_jobs <= 0 || !jobs[0].sectors) return;
+
+    snap_lock(s);
+    if (s->have_pending) s->replaced++;
+    SnapshotFrame *fr = s->pending;
+    fr->n = n_jobs;
+    memcpy(fr->sectors, jobs[0].sectors, sizeof(fr->sectors));
+    snprintf(fr->mountpoint, sizeof(fr->mountpoint), "%s",
+             jobs[0].mountpoint ? jobs[0].mountpoint : "");
+    snprintf(fr->utc_label, sizeof(fr->utc_label), "%s",
+             jobs[0].utc_label ? jobs[0].utc_label : "");
+    for (int k = 0; k < n_jobs; k++) {
+        fr->jobs[k] = jobs[k];
+        snprintf(fr->names[k], sizeof(fr->names[k]), "%s",
+                 jobs[k].filename ? jobs[k].filename : "");
+        snap_tmp_name(fr->names[k], fr->tmp[k], sizeof(fr->tmp[k]));
+        fr->jobs[k].filename   = fr->tmp[k];
+        fr->jobs[k].sectors    = fr->sectors;
+        fr->jobs[k].mountpoint = fr->mountpoint;
+        fr->jobs[k].utc_label  = fr->utc_label;
+    }
+    s->have_pending = true;
+    snap_unlock(s);
+}
+
+void sky_snapshot_close(SkySnapshot *s)
+{
+    if (!s) return;
+    snap_lock(s);
+    if (s->have_pending) s->replaced++;
+    s->have_pending = false;            /* the final heatmap follows anyway */
+    s->stop = 1;
+    snap_unlock(s);
+#ifdef _WIN32
+    WaitForSingleObject(s->thread, INFINITE);
+    CloseHandle(s->thread);
+    DeleteCriticalSection(&s->lock);
+#else
+    pthread_join(s->thread, NULL);
+    pthread_mutex_destroy(&s->lock);
+#endif
+    if (!s->quiet && (s->written || s->failed))
+        fprintf(stderr, "[SKY] %llu snapshot%s written (%llu replaced before rendering, %llu failed)\n",
+                (unsigned long long)s->written, s->written == 1 ? "" : "s",
+                (unsigned long long)s->replaced, (unsigned long long)s->failed);
+    sky_render_live_free(s->live);
+    free(s->pending);
+    free(s->out);
+    free(s);
+}
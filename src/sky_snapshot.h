@@ -0,0 +1,63 @@
+/**
+ * @file sky_snapshot.h
+ * @brief Live heatmaps of a sky collection (`--snapshot-interval`).
+ *
+ * Every interval the collector submits its heatmap jobs (sky_render.h):
+ * the sector grid, the footer and the output names are copied into a
+ * slot -- a few kB, the only work on the collector's thread -- and a
+ * thread of its own renders them with sky_render_live_update() to
+ * `<name>.tmp.<ext>` and renames each over `<name>`, so a dashboard
+ * polling the file never reads half a PNG.  There is one slot: jobs not
+ * taken by the time the next ones are submitted are replaced by them.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SKY_SNAPSHOT_H
+#define SKY_SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include "sky_render.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Longest --snapshot-interval, seconds (one day). */
+#define SKY_SNAPSHOT_MAX_INTERVAL_S 86400
+
+/** @brief A snapshot writer and its thread. */
+typedef struct SkySnapshot SkySnapshot;
+
+/**
+ * @brief Start the render thread.
+ *
+ * @param interval_s  Seconds between two snapshots (wall clock).
+ * @param quiet       Suppress the summary of sky_snapshot_close().
+ * @return NULL if the thread cannot be started.
+ */
+SkySnapshot *sky_snapshot_open(int interval_s, bool quiet);
+
+/** @brief true once the interval since the last submit has passed. */
+bool sky_snapshot_due(const SkySnapshot *s);
+
+/**
+ * @brief Hand @p n_jobs heatmaps (at most @ref SKY_RENDER_MAX_SIZES) to
+ *        the render thread and start the next interval.
+ *
+ * Everything the jobs point to is copied; the call does not wait for the
+ * thread.
+ */
+void sky_snapshot_submit(SkySnapshot *s, const SkyRenderJob *jobs, int n_jobs);
+
+/** @brief Finish the snapshot being rendered, stop the thread and free @p s. */
+void sky_snapshot_close(SkySnapshot *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SKY_SNAPSHOT_H */
@@ -0,0 +1,163 @@
+/**
+ * @file sourcetable_cache.c
+ * @brief On-disk cache of caster sourcetables.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sourcetable_cache.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#define st_mkdir(p)  _mkdir(p)
+#define PATH_SEP     "\\"
+#else
+#include <utime.h>
+#define st_mkdir(p)  mkdir((p), 0755)
+#define PATH_SEP     "/"
+#endif
+
+/* Directory for the cache files; created (one level below an existing
+ * parent) if missing. */
+static bool cache_dir(char *out, size_t out_len)
+{
+    const char *env = getenv("NTRIP_ANALYSER_CACHE");
+    if (env && env[0]) {
+        snprintf(out, out_len, "%s", env);
+    } else {
+#ifdef _WIN32
+        const char *base = getenv("LOCALAPPDATA");
+        if (!base || !base[0]) return false;
+        snprintf(out, out_len, "%s" PATH_SEP "ntrip-analyser", base);
+#else
+        const char *xdg  = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (xdg && xdg[0]) {
+            snprintf(out, out_len, "%s/ntrip-analyser", xdg);
+        } else if (home && home[0]) {
+            char dot[512];
+            snprintf(dot, sizeof(dot), "%s/.cache", home);
+            st_mkdir(dot);
+            snprintf(out, out_len, "%s/.cache/ntrip-analyser", home);
+        } else {
+            return false;
+        }
+#endif
+    }
+    struct stat st;
+    if (stat(out, &st) == 0) return (st.st_mode & S_IFDIR) != 0;
+    return st_mkdir(out) == 0;
+}
+
+bool sourcetable_cache_path(const char *host, int port, const char *user,
+                            char *out, size_t out_len)
+{
+    char dir[512];
+    if (!host || !host[0] || !cache_dir(dir, sizeof(dir))) return false;
+
+    /* Host name made file-name safe; the user name only as a hash */
+    char name[128];
+    size_t n = 0;
+    for (const char *p = host; *p && n + 1 < sizeof(name); p++)
+        name[n++] = (isalnum((unsigned char)*p) || *p == '.' || *p == '-') ? *p : '_';
+    name[n] = '\0';
+
+    uint32_t h = 2166136261u;               /* FNV-1a */
+    for (const char *p = user ? user : ""; *p; p++)
+        h = (h ^ (unsigned char)*p) * 16777619u;
+
+    int w = snprintf(out, out_len, "%s" PATH_SEP "%s_%d_%08x.srctbl",
+                     dir, name, port, (unsigned)h);
+    return w > 0 && (size_t)w < out_len;
+}
+
+char *sourcetable_cache_load(const char *path, size_t *len, long *age_s)
+{
+    struct stat st;
+    if (!path || stat(path, &st) != 0 || st.st_size <= 0) return NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    char *buf = (char *)malloc((size_t)st.st_size + 1);
+    size_t got = buf ? fread(buf, 1, (size_t)st.st_size, f) : 0;
+    fclose(f);
+    if (!buf || got != (size_t)st.st_size) {
+        free(buf);
+        return NULL;
+    }
+    buf[got] = '\0';
+    if (len)   *len = got;
+    if (age_s) {
+        double age = difftime(time(NULL), st.st_mtime);
+        *age_s = age > 0 ? (long)age : 0;
+    }
+    return buf;
+}
+
+bool sourcetable_cache_store(const char *path, const char *data, size_t len)
+{
+    char tmp[600];
+    if (!path || snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return false;
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, len, f) == len;
+    if (fclose(f) != 0) ok = false;
+    if (ok) {
+        remove(path);                 /* rename() won't replace on Windows */
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+void sourcetable_cache_touch(const char *path)
+{
+    if (path) utime(path, NULL);
+}
+
+static bool prefix_ieq(const char *s, const char *prefix, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (tolower((unsigned char)s[i]) != tolower((unsigned char)prefix[i]))
+            return false;
+    return true;
+}
+
+/* Value of header `name` (case-insensitive) in the header block. */
+static bool header_value(const char *reply, const char *name, char *out, size_t out_len)
+{
+    size_t nlen = strlen(name);
+    const char *end = strstr(reply, "\r\n\r\n");
+    for (const char *p = strstr(reply, "\r\n"); p && (!end || p < end); p = strstr(p, "\r\n")) {
+        p += 2;
+        if (prefix_ieq(p, name, nlen) && p[nlen] == ':') {
+            const char *v = p + nlen + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            size_t vlen = strcspn(v, "\r\n");
+            if (vlen == 0 || vlen >= out_len) return false;
+            memcpy(out, v, vlen);
+            out[vlen] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sourcetable_cache_validator(const char *reply, char *out, size_t out_len)
+{
+    if (!reply) return false;
+    return header_value(reply, "Last-Modified", out, out_len) ||
+           header_value(reply, "Date", out, out_len);
+}
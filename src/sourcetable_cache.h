@@ -0,0 +1,68 @@
+/**
+ * @file sourcetable_cache.h
+ * @brief On-disk cache of caster sourcetables.
+ *
+ * receive_mount_table() keeps the last sourcetable of every caster in a
+ * file, keyed by host, port and user name (casters may list different
+ * mountpoints per account).  While the copy is younger than the
+ * SOURCETABLE_TTL config value it is used without connecting; after that
+ * the request carries If-Modified-Since, and a "304 Not Modified" reply
+ * renews the copy instead of sending the table again.
+ *
+ * The files hold the caster's reply byte for byte (status line, headers
+ * and table), so `-m -r` prints the same text either way.  They live in
+ * $NTRIP_ANALYSER_CACHE if set, else $XDG_CACHE_HOME/ntrip-analyser or
+ * ~/.cache/ntrip-analyser (%LOCALAPPDATA%\\ntrip-analyser on Windows).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SOURCETABLE_CACHE_H
+#define SOURCETABLE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cache file of @p host / @p port / @p user, creating the cache
+ *        directory if needed.
+ *
+ * @return false if no cache directory can be found or created.
+ */
+bool sourcetable_cache_path(const char *host, int port, const char *user,
+                            char *out, size_t out_len);
+
+/**
+ * @brief Read a cached reply.
+ *
+ * @param len    [out] Bytes read (the buffer is also NUL-terminated).
+ * @param age_s  [out] Seconds since the copy was stored or renewed.
+ * @return The reply (free() it), or NULL if there is no readable copy.
+ */
+char *sourcetable_cache_load(const char *path, size_t *len, long *age_s);
+
+/** @brief Replace the cached reply; written to a temporary file first. */
+bool sourcetable_cache_store(const char *path, const char *data, size_t len);
+
+/** @brief Mark the cached reply as current (after a 304). */
+void sourcetable_cache_touch(const char *path);
+
+/**
+ * @brief HTTP date to send as If-Modified-Since for a cached reply: its
+ *        Last-Modified header, else its Date header.
+ *
+ * @return false if the reply has neither.
+ */
+bool sourcetable_cache_validator(const char *reply, char *out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOURCETABLE_CACHE_H */
@@ -0,0 +1,523 @@
+/**
+ * @file sourcetable_crawl.c
+ * @brief Sourcetables of many casters, fetched in parallel and merged.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "sourcetable_crawl.h"
+#include "stream_clock.h"
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>  // _beginthreadex
+#else
+#include <pthread.h>
+#endif
+
+#define CRAWL_MAX_JOBS    64
+#define CRAWL_STR_FIELDS  19       /* STR;Mountpoint;...;Bitrate */
+
+/* One caster of the casters file and, once fetched, its sourcetable. */
+typedef struct {
+    NTRIP_Config   cfg;
+    char           label[300];      /* "host:port" */
+    char          *table;           /* reply, split in place while merging */
+    MountTableInfo info;
+    double         seconds;
+    int            rows;            /* STR entries */
+} CrawlCaster;
+
+/* One STR entry; the strings point into its caster's table. */
+typedef struct {
+    const char *mount, *ident, *format, *details, *nav, *network, *country;
+    int         carrier;
+    double      lat, lon;
+    int         caster;             /* index into the casters */
+} CrawlEntry;
+
+typedef struct {
+    CrawlCaster        *c;
+    int                 n;
+    int                 next;       /* next caster to fetch */
+    int                 done;
+    bool                quiet;
+    const volatile int *stop;
+#ifdef _WIN32
+    CRITICAL_SECTION    lock;
+#else
+    pthread_mutex_t     lock;
+#endif
+} CrawlQueue;
+
+static void crawl_lock(CrawlQueue *q)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&q->lock);
+#else
+    pthread_mutex_lock(&q->lock);
+#endif
+}
+
+static void crawl_unlock(CrawlQueue *q)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&q->lock);
+#else
+    pthread_mutex_unlock(&q->lock);
+#endif
+}
+
+/* ── Casters file ──────────────────────────────────────────────────── */
+
+static void json_copy_str(const cJSON *obj, const char *key, char *dst, size_t dst_len)
+{
+    const cJSON *it = cJSON_GetObjectItem(obj, key);
+    if (it && cJSON_IsString(it)) {
+        strncpy(dst, it->valuestring, dst_len - 1);
+        dst[dst_len - 1] = '\0';
+    }
+}
+
+static int crawl_load_casters(const NTRIP_Config *base, const char *path,
+                              CrawlCaster **out, int *out_n)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror("Failed to open casters file");
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = (char *)malloc((size_t)length + 1);
+    if (!data) {
+        fclose(file);
+        return -1;
+    }
+    size_t got = fread(data, 1, (size_t)length, file);
+    data[got] = '\0';
+    fclose(file);
+
+    cJSON *root = cJSON_Parse(data);
+    free(data);
+    if (!root) {
+        fprintf(stderr, "[ERROR] Failed to parse casters file %s near: %.32s\n",
+                path, cJSON_GetErrorPtr() ? cJSON_GetErrorPtr() : "");
+        return -1;
+    }
+
+    const cJSON *list = cJSON_IsArray(root) ? root : cJSON_GetObjectItem(root, "casters");
+    if (!list || !cJSON_IsArray(list)) {
+        fprintf(stderr, "[ERROR] %s: expected an array or {\"casters\": [...]}\n", path);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    int count = cJSON_GetArraySize(list);
+    if (count > SOURCETABLE_CRAWL_MAX_CASTERS) {
+        fprintf(stderr, "[WARN] %s: %d entries, only the first %d are used\n",
+                path, count, SOURCETABLE_CRAWL_MAX_CASTERS);
+        count = SOURCETABLE_CRAWL_MAX_CASTERS;
+    }
+    CrawlCaster *cs = count > 0 ? (CrawlCaster *)calloc((size_t)count, sizeof(CrawlCaster)) : NULL;
+    if (count > 0 && !cs) {
+        fprintf(stderr, "[ERROR] Out of memory for %d casters\n", count);
+        cJSON_Delete(root);
+        return -1;
+    }
+
+    int n = 0, pos = 0;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, list) {
+        if (n >= count) break;
+        pos++;
+        NTRIP_Config *c = &cs[n].cfg;
+        *c = *base;
+        c->NTRIP_CASTER[0] = '\0';
+
+        if (cJSON_IsString(item)) {
+            strncpy(c->NTRIP_CASTER, item->valuestring, sizeof(c->NTRIP_CASTER) - 1);
+            char *colon = strrchr(c->NTRIP_CASTER, ':');
+            if (colon && colon[1] && strspn(colon + 1, "0123456789") == strlen(colon + 1)) {
+                c->NTRIP_PORT = atoi(colon + 1);
+                *colon = '\0';
+            }
+        } else if (cJSON_IsObject(item)) {
+            json_copy_str(item, "NTRIP_CASTER", c->NTRIP_CASTER, sizeof(c->NTRIP_CASTER));
+            json_copy_str(item, "USERNAME",     c->USERNAME,     sizeof(c->USERNAME));
+            json_copy_str(item, "PASSWORD",     c->PASSWORD,     sizeof(c->PASSWORD));
+            const cJSON *port = cJSON_GetObjectItem(item, "NTRIP_PORT");
+            if (port && cJSON_IsNumber(port)) c->NTRIP_PORT = port->valueint;
+        }
+        if (!c->NTRIP_CASTER[0] || c->NTRIP_PORT <= 0) {
+            fprintf(stderr, "[WARN] %s: entry %d has no caster or port, skipped\n", path, pos);
+            continue;
+        }
+        char auth[300];
+        snprintf(auth, sizeof(auth), "%s:%s", c->USERNAME, c->PASSWORD);
+        base64_encode(auth, c->AUTH_BASIC);
+        snprintf(cs[n].label, sizeof(cs[n].label), "%s:%d", c->NTRIP_CASTER, c->NTRIP_PORT);
+        n++;
+    }
+    cJSON_Delete(root);
+    *out   = cs;
+    *out_n = n;
+    return 0;
+}
+
+/* ── Fetching ──────────────────────────────────────────────────────── */
+
+static int crawl_count_rows(const char *table)
+{
+    int rows = 0;
+    for (const char *p = table; p; p = strchr(p, '\n')) {
+        if (*p == '\n') p++;
+        if (strncmp(p, "STR;", 4) == 0) rows++;
+    }
+    return rows;
+}
+
+static const char *crawl_source_name(MountTableSource s)
+{
+    switch (s) {
+    case MOUNT_TABLE_CACHED:      return "cache";
+    case MOUNT_TABLE_REVALIDATED: return "not-modified";
+    case MOUNT_TABLE_STALE:       return "stale-cache";
+    default:                      return "network";
+    }
+}
+
+static void crawl_work(CrawlQueue *q)
+{
+    for (;;) {
+        crawl_lock(q);
+        int i = (q->stop && *q->stop) ? q->n : q->next;
+        if (i < q->n) q->next++;
+        crawl_unlock(q);
+        if (i >= q->n) return;
+
+        CrawlCaster *c = &q->c[i];
+        double t0 = stream_clock_wall_seconds();
+        c->table   = receive_mount_table_ex(&c->cfg, NULL, NULL, &c->info);
+        c->seconds = stream_clock_wall_seconds() - t0;
+        if (c->table) c->rows = crawl_count_rows(c->table);
+
+        crawl_lock(q);
+        q->done++;
+        if (!q->quiet) {
+            if (c->table)
+                fprintf(stderr, "[CRAWL] %3d/%d  %-40s %5d mountpoints  %6.2f s  (%s)\n",
+                        q->done, q->n, c->label, c->rows, c->seconds,
+                        crawl_source_name(c->info.source));
+            else
+                fprintf(stderr, "[CRAWL] %3d/%d  %-40s failed after %.2f s\n",
+                        q->done, q->n, c->label, c->seconds);
+        }
+        crawl_unlock(q);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall crawl_thread(void *arg)
+{
+    crawl_work((CrawlQueue *)arg);
+    return 0;
+}
+#else
+static void *crawl_thread(void *arg)
+{
+    crawl_work((CrawlQueue *)arg);
+    return NULL;
+}
+#endif
+
+/* ── Merging ───────────────────────────────────────────────────────── */
+
+/* Split the STR lines of a table in place and append them to @p v. */
+static bool crawl_collect(char *table, int caster, CrawlEntry **v, size_t *n, size_t *cap)
+{
+    for (char *p = table; p && *p; ) {
+        char *end = strchr(p, '\n');
+        char *next = end ? end + 1 : NULL;
+        if (end) {
+            if (end > p && end[-1] == '\r') end--;
+            *end = '\0';
+        }
+        if (strncmp(p, "STR;", 4) == 0) {
+            char *f[CRAWL_STR_FIELDS];
+            int nf = 0;
+            for (char *tok = p; tok && nf < CRAWL_STR_FIELDS; ) {
+                f[nf++] = tok;
+                tok = strchr(tok, ';');
+                if (tok) *tok++ = '\0';
+            }
+            if (nf >= 11) {
+                if (*n == *cap) {
+                    size_t nc = *cap ? *cap * 2 : 1024;
+                    CrawlEntry *nv = (CrawlEntry *)realloc(*v, nc * sizeof(CrawlEntry));
+                    if (!nv) return false;
+                    *v   = nv;
+                    *cap = nc;
+                }
+                CrawlEntry *e = &(*v)[(*n)++];
+                e->mount   = f[1];
+                e->ident   = f[2];
+                e->format  = f[3];
+                e->details = f[4];
+                e->carrier = atoi(f[5]);
+                e->nav     = f[6];
+                e->network = f[7];
+                e->country = f[8];
+                e->lat     = atof(f[9]);
+                e->lon     = atof(f[10]);
+                e->caster  = caster;
+            }
+        }
+        p = next;
+    }
+    return true;
+}
+
+static int crawl_stricmp(const char *a, const char *b)
+{
+    for (;; a++, b++) {
+        int d = tolower((unsigned char)*a) - tolower((unsigned char)*b);
+        if (d || !*a) return d;
+    }
+}
+
+/* Same stream: name, format and position to 0.01 degree. */
+static int crawl_cmp_key(const CrawlEntry *x, const CrawlEntry *y)
+{
+    int d = crawl_stricmp(x->mount, y->mount);
+    if (d) return d;
+    d = strcmp(x->format, y->format);
+    if (d) return d;
+    long xa = lround(x->lat * 100.0), ya = lround(y->lat * 100.0);
+    if (xa != ya) return xa < ya ? -1 : 1;
+    long xo = lround(x->lon * 100.0), yo = lround(y->lon * 100.0);
+    if (xo != yo) return xo < yo ? -1 : 1;
+    return 0;
+}
+
+static int crawl_cmp_entry(const void *a, const void *b)
+{
+    const CrawlEntry *x = (const CrawlEntry *)a, *y = (const CrawlEntry *)b;
+    int d = crawl_cmp_key(x, y);
+    if (d) return d;
+    return (x->caster > y->caster) - (x->caster < y->caster);
+}
+
+/* Array under @p key in @p obj, created on first use. */
+static cJSON *crawl_index_list(cJSON *obj, const char *key)
+{
+    cJSON *list = cJSON_GetObjectItem(obj, key);
+    if (!list) {
+        list = cJSON_CreateArray();
+        cJSON_AddItemToObject(obj, key, list);
+    }
+    return list;
+}
+
+/* Message numbers of an STR format-details field, "1005(10),1077(1)". */
+static cJSON *crawl_messages(const char *details, cJSON *index, int pos)
+{
+    cJSON *arr = cJSON_CreateArray();
+    for (const char *p = details; *p; ) {
+        if (isdigit((unsigned char)*p)) {
+            char *end;
+            long msg = strtol(p, &end, 10);
+            if (*end == '(' || *end == ',' || *end == '\0') {
+                if (msg >= 1 && msg <= 4095) {
+                    char key[8];
+                    snprintf(key, sizeof(key), "%ld", msg);
+                    cJSON_AddItemToArray(arr, cJSON_CreateNumber((double)msg));
+                    cJSON_AddItemToArray(crawl_index_list(index, key), cJSON_CreateNumber(pos));
+                }
+            }
+            p = end;
+            while (*p && *p != ',') p++;
+        } else {
+            p++;
+        }
+    }
+    return arr;
+}
+
+static cJSON *crawl_build_json(const CrawlCaster *cs, int ncasters,
+                               CrawlEntry *v, size_t n, int *unique)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *jc = cJSON_AddArrayToObject(root, "casters");
+    for (int i = 0; i < ncasters; i++) {
+        cJSON *o = cJSON_CreateObject();
+        cJSON_AddStringToObject(o, "caster", cs[i].label);
+        cJSON_AddBoolToObject(o, "ok", cs[i].table != NULL);
+        cJSON_AddNumberToObject(o, "mountpoints", cs[i].rows);
+        cJSON_AddNumberToObject(o, "seconds", floor(cs[i].seconds * 1000.0 + 0.5) / 1000.0);
+        if (cs[i].table)
+            cJSON_AddStringToObject(o, "source", crawl_source_name(cs[i].info.source));
+        cJSON_AddItemToArray(jc, o);
+    }
+
+    cJSON *jm      = cJSON_AddArrayToObject(root, "mountpoints");
+    cJSON *index   = cJSON_AddObjectToObject(root, "index");
+    cJSON *by_fmt  = cJSON_AddObjectToObject(index, "format");
+    cJSON *by_msg  = cJSON_AddObjectToObject(index, "message");
+    cJSON *by_cell = cJSON_AddObjectToObject(index, "cell");
+
+    int pos = 0;
+    for (size_t i = 0; i < n; ) {
+        size_t j = i + 1;
+        while (j < n && crawl_cmp_key(&v[i], &v[j]) == 0) j++;
+
+        const CrawlEntry *e = &v[i];
+        cJSON *o = cJSON_CreateObject();
+        cJSON_AddStringToObject(o, "mountpoint",  e->mount);
+        cJSON_AddStringToObject(o, "identifier",  e->ident);
+        cJSON_AddStringToObject(o, "format",      e->format);
+        cJSON_AddItemToObject(o, "messages", crawl_messages(e->details, by_msg, pos));
+        cJSON_AddNumberToObject(o, "carrier",     e->carrier);
+        cJSON_AddStringToObject(o, "nav_system",  e->nav);
+        cJSON_AddStringToObject(o, "network",     e->network);
+        cJSON_AddStringToObject(o, "country",     e->country);
+        cJSON_AddNumberToObject(o, "latitude",    e->lat);
+        cJSON_AddNumberToObject(o, "longitude",   e->lon);
+        cJSON *on = cJSON_AddArrayToObject(o, "casters");
+        for (size_t k = i; k < j; k++)
+            if (k == i || v[k].caster != v[k - 1].caster)
+                cJSON_AddItemToArray(on, cJSON_CreateString(cs[v[k].caster].label));
+        cJSON_AddItemToArray(jm, o);
+
+        cJSON_AddItemToArray(crawl_index_list(by_fmt, e->format[0] ? e->format : "-"),
+                             cJSON_CreateNumber(pos));
+        if (e->lat != 0.0 || e->lon != 0.0) {
+            char cell[32];
+            snprintf(cell, sizeof(cell), "%d,%d", (int)floor(e->lat), (int)floor(e->lon));
+            cJSON_AddItemToArray(crawl_index_list(by_cell, cell), cJSON_CreateNumber(pos));
+        }
+        pos++;
+        i = j;
+    }
+    *unique = pos;
+    return root;
+}
+
+/* ── Public API ───────────────────────────────────────────────────── */
+
+int sourcetable_crawl_run(const NTRIP_Config *base, const SourcetableCrawlOptions *opt,
+                          const volatile int *stop_flag)
+{
+    CrawlQueue q;
+    memset(&q, 0, sizeof(q));
+    if (crawl_load_casters(base, opt->casters_file, &q.c, &q.n) != 0) return -1;
+    if (q.n == 0) {
+        fprintf(stderr, "[ERROR] %s: no casters listed\n", opt->casters_file);
+        free(q.c);
+        return -1;
+    }
+    q.quiet = opt->quiet;
+    q.stop  = stop_flag;
+
+    int timeout = opt->timeout_s > 0 ? opt->timeout_s
+                : base->SOURCETABLE_TIMEOUT > 0 ? base->SOURCETABLE_TIMEOUT
+                : SOURCETABLE_CRAWL_DEFAULT_TIMEOUT;
+    for (int i = 0; i < q.n; i++) q.c[i].cfg.SOURCETABLE_TIMEOUT = timeout;
+
+    int jobs = opt->jobs > 0 ? opt->jobs : SOURCETABLE_CRAWL_DEFAULT_JOBS;
+    if (jobs > CRAWL_MAX_JOBS) jobs = CRAWL_MAX_JOBS;
+    if (jobs > q.n) jobs = q.n;
+    if (!opt->quiet)
+        fprintf(stderr, "[CRAWL] %d casters, %d in parallel, %d s limit each\n",
+                q.n, jobs, timeout);
+
+    double t0 = stream_clock_wall_seconds();
+#ifdef _WIN32
+    InitializeCriticalSection(&q.lock);
+    HANDLE threads[CRAWL_MAX_JOBS];
+#else
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_t threads[CRAWL_MAX_JOBS];
+#endif
+    bool started[CRAWL_MAX_JOBS] = { false };
+    /* Worker 0 is this thread. */
+    for (int t = 1; t < jobs; t++) {
+#ifdef _WIN32
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, crawl_thread, &q, 0, NULL);
+        started[t] = threads[t] != NULL;
+#else
+        started[t] = pthread_create(&threads[t], NULL, crawl_thread, &q) == 0;
+#endif
+    }
+    crawl_work(&q);
+    for (int t = 1; t < jobs; t++) {
+        if (!started[t]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&q.lock);
+#else
+    pthread_mutex_destroy(&q.lock);
+#endif
+    double elapsed = stream_clock_wall_seconds() - t0;
+
+    /* Merge the tables */
+    CrawlEntry *v = NULL;
+    size_t nv = 0, cap = 0;
+    int ok = 0;
+    for (int i = 0; i < q.n; i++) {
+        if (!q.c[i].table) continue;
+        ok++;
+        if (!crawl_collect(q.c[i].table, i, &v, &nv, &cap)) {
+            fprintf(stderr, "[ERROR] Out of memory merging the sourcetables\n");
+            break;
+        }
+    }
+    if (nv > 1) qsort(v, nv, sizeof(*v), crawl_cmp_entry);
+
+    int unique = 0;
+    cJSON *root = crawl_build_json(q.c, q.n, v, nv, &unique);
+    char *text = cJSON_Print(root);
+    cJSON_Delete(root);
+    free(v);
+    for (int i = 0; i < q.n; i++) free(q.c[i].table);
+    free(q.c);
+
+    int rc = ok > 0 ? 0 : 1;
+    bool to_stdout = !opt->output_path || strcmp(opt->output_path, "-") == 0;
+    FILE *f = to_stdout ? stdout : fopen(opt->output_path, "w");
+    if (!text || !f) {
+        fprintf(stderr, "[ERROR] Could not write %s\n", to_stdout ? "stdout" : opt->output_path);
+        rc = -1;
+    } else {
+        fputs(text, f);
+        fputc('\n', f);
+        if (!to_stdout && fclose(f) != 0) {
+            fprintf(stderr, "[ERROR] Could not write %s\n", opt->output_path);
+            rc = -1;
+        }
+    }
+    free(text);
+
+    if (!opt->quiet)
+        fprintf(stderr, "[CRAWL] %d of %d casters answered, %lu entries, %d unique, %.2f s%s%s\n",
+                ok, q.n, (unsigned long)nv, unique, elapsed,
+                to_stdout ? "" : " -> ", to_stdout ? "" : opt->output_path);
+    return rc;
+}
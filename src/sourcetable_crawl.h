@@ -0,0 +1,103 @@
+/**
+ * @file sourcetable_crawl.h
+ * @brief Sourcetables of many casters, fetched in parallel and merged.
+ *
+ * `--crawl FILE` fetches the sourcetable of every caster listed in FILE
+ * with up to --jobs requests in flight, each within its own time limit,
+ * so one caster that does not answer holds up one worker instead of the
+ * whole inventory.  The fetches go through receive_mount_table_ex(), so
+ * SOURCETABLE_TTL caching applies per caster.
+ *
+ * The STR entries of all tables are merged: a stream listed by more than
+ * one caster (same mountpoint name, format and position to 0.01 degree)
+ * becomes one entry that names every caster carrying it.  The result is
+ * written as JSON with lookup tables by format, by message type and by
+ * 1 x 1 degree cell:
+ * @code
+ * { "casters":     [ { "caster": "host:port", "ok": true, "mountpoints": 412,
+ *                      "seconds": 0.84, "source": "network" }, ... ],
+ *   "mountpoints": [ { "mountpoint": "AMS100NLD0", "format": "RTCM 3.3",
+ *                      "messages": [1005, 1077, ...], "latitude": 52.37, ...
+ *                      "casters": ["host:port", ...] }, ... ],
+ *   "index": { "format":  { "RTCM 3.3": [0, 4, ...] },
+ *              "message": { "1077": [0, 2, ...] },
+ *              "cell":    { "52,4": [0, ...] } } }
+ * @endcode
+ * The index lists hold positions in "mountpoints", which is sorted by
+ * mountpoint name.
+ *
+ * ## Casters file
+ * JSON, either a top-level array or an object with a "casters" array.
+ * Every entry is either "host" or "host:port", or an object using the
+ * config-file key names; missing keys are taken from the loaded config:
+ * @code
+ * { "casters": [
+ *     "rtk2go.com:2101",
+ *     { "NTRIP_CASTER": "caster.example.net", "NTRIP_PORT": 2101,
+ *       "USERNAME": "u", "PASSWORD": "p" }
+ * ] }
+ * @endcode
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef SOURCETABLE_CRAWL_H
+#define SOURCETABLE_CRAWL_H
+
+#include <stdbool.h>
+#include "ntrip_handler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Upper bound on the number of casters accepted from a casters file. */
+#define SOURCETABLE_CRAWL_MAX_CASTERS  1024
+
+/** @brief Fetches in flight when --jobs is not given. */
+#define SOURCETABLE_CRAWL_DEFAULT_JOBS  8
+
+/** @brief Per-caster time limit (s) when neither --timeout nor the config sets one. */
+#define SOURCETABLE_CRAWL_DEFAULT_TIMEOUT  15
+
+/**
+ * @struct SourcetableCrawlOptions
+ * @brief What to crawl and where the merged table goes.
+ *
+ * Fields:
+ *   - casters_file:  Path to the JSON casters file.
+ *   - output_path:   JSON output file; NULL or "-" = stdout.
+ *   - jobs:          Fetches in flight; 0 = SOURCETABLE_CRAWL_DEFAULT_JOBS.
+ *   - timeout_s:     Time limit per caster; 0 = the config's
+ *                    SOURCETABLE_TIMEOUT, else the default.
+ *   - quiet:         No per-caster progress lines on stderr.
+ */
+typedef struct {
+    const char *casters_file;
+    const char *output_path;
+    int         jobs;
+    int         timeout_s;
+    bool        quiet;
+} SourcetableCrawlOptions;
+
+/**
+ * @brief Crawl every caster in the casters file and write the merged table.
+ *
+ * Winsock must already be initialised on Windows.
+ *
+ * @param base       Loaded config; supplies defaults for every entry.
+ * @param opt        Crawl options.
+ * @param stop_flag  Non-zero: start no further fetches.
+ * @return 0 if at least one caster answered, 1 if none did, -1 if the
+ *         casters file could not be read or the output not written.
+ */
+int sourcetable_crawl_run(const NTRIP_Config *base, const SourcetableCrawlOptions *opt,
+                          const volatile int *stop_flag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOURCETABLE_CRAWL_H */
@@ -0,0 +1,67 @@
+/**
+ * @file stats_snapshot.c
+ * @brief Sequence-locked double-buffered snapshot of a statistics block.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "stats_snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool stats_snapshot_init(StatsSnapshot *s, size_t size)
+{
+    memset(s, 0, sizeof(*s));
+    s->slot[0] = (unsigned char *)calloc(1, size);
+    s->slot[1] = (unsigned char *)calloc(1, size);
+    if (!s->slot[0] || !s->slot[1]) {
+        stats_snapshot_free(s);
+        return false;
+    }
+    s->size = size;
+    return true;
+}
+
+void stats_snapshot_free(StatsSnapshot *s)
+{
+    free(s->slot[0]);
+    free(s->slot[1]);
+    memset(s, 0, sizeof(*s));
+}
+
+void stats_snapshot_publish(StatsSnapshot *s, const void *src)
+{
+    uint32_t v = s->version;            /* only the writer changes it */
+    int w = (int)((v + 1) & 1);         /* the slot not holding the newest copy */
+    uint32_t q = s->seq[w];
+
+    __atomic_store_n(&s->seq[w], q + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(s->slot[w], src, s->size);
+    __atomic_store_n(&s->seq[w], q + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->version, v + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t stats_snapshot_version(const StatsSnapshot *s)
+{
+    return __atomic_load_n(&s->version, __ATOMIC_ACQUIRE);
+}
+
+bool stats_snapshot_read(const StatsSnapshot *s, void *dst, uint32_t *seen)
+{
+    uint32_t v = __atomic_load_n(&s->version, __ATOMIC_ACQUIRE);
+    if (v == 0 || (seen && v == *seen)) return false;
+
+    int r = (int)(v & 1);
+    uint32_t q = __atomic_load_n(&s->seq[r], __ATOMIC_ACQUIRE);
+    if (q & 1) return false;            /* lapped: the writer is already back in it */
+    memcpy(dst, s->slot[r], s->size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&s->seq[r], __ATOMIC_RELAXED) != q) return false;
+
+    if (seen) *seen = v;
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file stats_snapshot.h
+ * @brief Sequence-locked double-buffered snapshot of a statistics block.
+ *
+ * A worker that updates a statistics struct in place cannot let another
+ * thread read it: a reader sees a count from one frame and a sketch from
+ * the next, or a table half way through an insert.  A StatsSnapshot
+ * carries a consistent copy across instead.  The worker keeps its own
+ * working struct, touches nothing shared per frame, and publishes a copy
+ * at a fixed cadence; readers copy the newest published block out when
+ * it suits them:
+ *
+ * @code
+ * StatsSnapshot snap;
+ * stats_snapshot_init(&snap, sizeof(MyStats));
+ *
+ * // worker, every N ms                 // reader, on its own timer
+ * stats_snapshot_publish(&snap, &work); if (stats_snapshot_read(&snap, &view, &seen))
+ *                                           redraw(&view);
+ * @endcode
+ *
+ * There are two slots.  A publish writes the slot that does not hold
+ * the newest copy, bracketed by a sequence count that is odd while the
+ * slot is written, then makes it the newest.  A reader copies the newest
+ * slot and checks its sequence count did not move.  Neither side waits
+ * or retries in a loop: the writer never looks at readers, and a read
+ * only fails if the writer published twice during one copy (a reader
+ * stalled for two publish periods); it then keeps what it had and tries
+ * again on its next tick.
+ *
+ * One writer per snapshot; any number of readers.  The block is copied
+ * with memcpy, so it must be plain data (pointers in it are copied, not
+ * followed).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef STATS_SNAPSHOT_H
+#define STATS_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct StatsSnapshot
+ * @brief Two copies of a block and the sequence counts that guard them.
+ */
+typedef struct {
+    size_t         size;        /**< bytes per copy */
+    unsigned char *slot[2];
+    uint32_t       seq[2];      /**< odd while the slot is written */
+    uint32_t       version;     /**< publishes so far; slot[version & 1] is the newest */
+} StatsSnapshot;
+
+/**
+ * @brief Allocate both copies of a @p size byte block (zeroed, version 0).
+ *
+ * @return false when out of memory.
+ */
+bool stats_snapshot_init(StatsSnapshot *s, size_t size);
+
+/** @brief Free the copies; @p s may have failed or never been initialised (zeroed). */
+void stats_snapshot_free(StatsSnapshot *s);
+
+/** @brief Writer: publish a copy of @p src (s->size bytes). */
+void stats_snapshot_publish(StatsSnapshot *s, const void *src);
+
+/** @brief Publishes so far (0 = nothing published yet). */
+uint32_t stats_snapshot_version(const StatsSnapshot *s);
+
+/**
+ * @brief Reader: copy the newest block to @p dst if it is newer than
+ *        @p *seen.
+ *
+ * @param seen  In: version the caller already holds (0 = none).  Out:
+ *              the version copied.  NULL copies whatever is newest.
+ * @return true if @p dst now holds a consistent, newer block; false if
+ *         nothing new was published or the copy raced two publishes
+ *         (@p dst may then be partly overwritten -- keep a separate
+ *         view if that matters).
+ */
+bool stats_snapshot_read(const StatsSnapshot *s, void *dst, uint32_t *seen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_SNAPSHOT_H */
@@ -0,0 +1,232 @@
+/**
+ * @file stream_clock.c
+ * @brief Wall-clock or virtual (stream-derived) time for stats and sky.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "stream_clock.h"
+#include "rtcm3x_parser.h"
+#include "rtcm_bitreader.h"
+
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define CLK_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CLK_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define WEEK_MS          604800000LL
+#define DAY_MS           86400000LL
+#define MOSCOW_MS        10800000LL     /* GLONASS time = UTC + 3 h */
+#define GPS_EPOCH_UNIX   315964800      /* 1980-01-06 UTC */
+
+/* Unix times (UTC) GPS - UTC stepped to 1 .. 18 s */
+static const int64_t k_leap_unix[] = {
+    362793600,  394329600,  425865600,  489024000,  567993600,  631152000,
+    662688000,  709948800,  741484800,  773020800,  820454400,  867715200,
+    915148800, 1136073600, 1230768000, 1341100800, 1435708800, 1483228800
+};
+
+static int     s_virtual;               /* 0 = wall, 1 = virtual */
+static int64_t s_gps_ms = -1;           /* virtual: GPS ms since GPS epoch, -1 = none */
+
+void stream_clock_set_virtual(bool virtual_time)
+{
+    CLK_STORE(&s_gps_ms, (int64_t)-1);
+    CLK_STORE(&s_virtual, virtual_time ? 1 : 0);
+}
+
+bool stream_clock_is_virtual(void)
+{
+    return CLK_LOAD(&s_virtual) != 0;
+}
+
+long stream_clock_msm_epoch_ms(const unsigned char *frame, int frame_len)
+{
+    if (!frame || frame_len < 6 + 7) return -1;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+    if (!rtcm_msg_is_msm(mt, 1, 7)) return -1;
+    uint32_t tow = (uint32_t)get_bits(&frame[3], 24, 30);
+    if (tow >= (uint32_t)WEEK_MS) return -1;
+    switch (mt / 10) {
+    case 107:                             /* GPS */
+    case 109:                             /* Galileo (GST = GPS time) */
+    case 111:                             /* QZSS */
+        return (long)tow;
+    case 112:                             /* BeiDou: BDT = GPST - 14 s */
+        return (long)((tow + 14000u) % (uint32_t)WEEK_MS);
+    default:
+        return -1;
+    }
+}
+
+void stream_clock_feed(const unsigned char *frame, int frame_len)
+{
+    if (!CLK_LOAD(&s_virtual)) return;
+    long tow = stream_clock_msm_epoch_ms(frame, frame_len);
+    if (tow < 0) return;
+
+    /* Single writer: the plain read of our own last store is enough. */
+    int64_t cur = CLK_LOAD(&s_gps_ms);
+    if (cur < 0) {
+        /* First epoch: the week comes from the system clock. */
+        int64_t week = ((int64_t)time(NULL) - GPS_EPOCH_UNIX) / 604800;
+        CLK_STORE(&s_gps_ms, week * WEEK_MS + tow);
+        return;
+    }
+    int64_t d = (int64_t)tow - cur % WEEK_MS;
+    if (d < -WEEK_MS / 2) d += WEEK_MS;
+    if (d >  WEEK_MS / 2) d -= WEEK_MS;
+    if (d > 0) CLK_STORE(&s_gps_ms, cur + d);
+}
+
+/* GPS ms since the GPS epoch from the virtual clock, or from the system
+ * clock (leap seconds ignored, as the sky plot always did). */
+static int64_t clock_gps_ms(void)
+{
+    if (CLK_LOAD(&s_virtual)) {
+        int64_t v = CLK_LOAD(&s_gps_ms);
+        if (v >= 0) return v;
+        int64_t week = ((int64_t)time(NULL) - GPS_EPOCH_UNIX) / 604800;
+        return week * WEEK_MS;
+    }
+    return ((int64_t)time(NULL) - GPS_EPOCH_UNIX) * 1000;
+}
+
+double stream_clock_seconds(void)
+{
+    if (CLK_LOAD(&s_virtual)) {
+        int64_t v = CLK_LOAD(&s_gps_ms);
+        return v >= 0 ? (double)v / 1000.0 : 0.0;
+    }
+    return stream_clock_wall_seconds();
+}
+
+int64_t stream_clock_virtual_ms(void)
+{
+    return CLK_LOAD(&s_virtual) ? CLK_LOAD(&s_gps_ms) : -1;
+}
+
+void stream_clock_set_virtual_ms(int64_t gps_ms)
+{
+    CLK_STORE(&s_gps_ms, gps_ms < 0 ? (int64_t)-1 : gps_ms);
+}
+
+double stream_clock_wall_seconds(void)
+{
+    return (double)stream_clock_wall_ns() / 1e9;
+}
+
+int64_t stream_clock_wall_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    static int freq_init = 0;
+    LARGE_INTEGER now;
+    if (!freq_init) {
+        QueryPerformanceFrequency(&freq);
+        freq_init = 1;
+    }
+    QueryPerformanceCounter(&now);
+    /* Split so count * 1e9 cannot overflow. */
+    int64_t q = now.QuadPart / freq.QuadPart;
+    int64_t r = now.QuadPart % freq.QuadPart;
+    return q * 1000000000LL + r * 1000000000LL / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+void stream_clock_gps_time(int *week, double *tow_s)
+{
+    int64_t ms = clock_gps_ms();
+    int64_t w  = ms / WEEK_MS;
+    if (week)  *week  = (int)w;
+    if (tow_s) *tow_s = (double)(ms - w * WEEK_MS) / 1000.0;
+}
+
+double stream_clock_glo_tod(void)
+{
+    /* GLONASS time = UTC + 3 h.  The wall clock is UTC already; virtual
+     * time is GPS time, so take the leap seconds off first. */
+    int64_t ms = clock_gps_ms();
+    if (CLK_LOAD(&s_virtual))
+        ms -= (int64_t)stream_clock_leap_seconds(ms / 1000 + GPS_EPOCH_UNIX) * 1000;
+    int64_t utc_unix_ms = ms + (int64_t)GPS_EPOCH_UNIX * 1000;
+    double msk = (double)(utc_unix_ms % 86400000LL) / 1000.0 + 10800.0;
+    while (msk >= 86400.0) msk -= 86400.0;
+    while (msk <    0.0)   msk += 86400.0;
+    return msk;
+}
+
+int stream_clock_leap_seconds(int64_t unix_s)
+{
+    int n = 0;
+    while (n < (int)(sizeof(k_leap_unix) / sizeof(k_leap_unix[0])) &&
+           unix_s >= k_leap_unix[n])
+        n++;
+    return n;
+}
+
+int64_t stream_clock_unix_to_gps_ms(int64_t unix_s)
+{
+    return (unix_s - GPS_EPOCH_UNIX + stream_clock_leap_seconds(unix_s)) * 1000LL;
+}
+
+/* The value congruent to @p v modulo @p period nearest to @p ref. */
+static int64_t near_mod(int64_t ref, int64_t v, int64_t period)
+{
+    int64_t base = ref - ((ref % period) + period) % period;
+    int64_t t = base + ((v % period) + period) % period;
+    if (t - ref > period / 2) t -= period;
+    if (ref - t > period / 2) t += period;
+    return t;
+}
+
+int64_t stream_clock_msm_gps_ms(int gnss_id, uint32_t epoch_time, int64_t ref_ms)
+{
+    if (gnss_id == 2) {
+        int64_t tod  = epoch_time & 0x7FFFFFF;          /* DF034, Moscow time */
+        int     leap = stream_clock_leap_seconds(ref_ms / 1000 + GPS_EPOCH_UNIX);
+        return near_mod(ref_ms, tod - MOSCOW_MS + leap * 1000LL, DAY_MS);
+    }
+    int64_t tow = epoch_time;
+    if (tow >= WEEK_MS) return -1;
+    if (gnss_id == 5) tow += 14000;                     /* BDT = GPST - 14 s */
+    return near_mod(ref_ms, tow, WEEK_MS);
+}
+
+#ifdef _WIN32
+typedef void (WINAPI *GetTimeFn)(FILETIME *);
+
+int64_t stream_clock_utc_ns(void)
+{
+    /* The precise variant (Windows 8+) is looked up once; older systems
+     * fall back to the tick-resolution clock. */
+    static GetTimeFn get_time;
+    if (!get_time) {
+        HMODULE k32 = GetModuleHandleA("kernel32.dll");
+        get_time = k32 ? (GetTimeFn)(void (*)(void))
+                         GetProcAddress(k32, "GetSystemTimePreciseAsFileTime") : NULL;
+        if (!get_time) get_time = GetSystemTimeAsFileTime;
+    }
+    FILETIME ft;
+    get_time(&ft);
+    int64_t t = (int64_t)(((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime);
+    return (t - 116444736000000000LL) * 100;    /* 100 ns since 1601 -> Unix ns */
+}
+#else
+int64_t stream_clock_utc_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+#endif
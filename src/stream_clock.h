@@ -0,0 +1,142 @@
+/**
+ * @file stream_clock.h
+ * @brief Wall-clock or virtual (stream-derived) time for stats and sky.
+ *
+ * Message inter-arrival statistics and the sky-plot orbit propagation
+ * used to read the system clock directly.  That is right for a live
+ * stream, but a replay is then either paced in real time or gets
+ * meaningless intervals and satellites propagated to "now" instead of to
+ * the time of the capture.
+ *
+ * Every such path reads the time from here instead.  In wall mode (the
+ * default) the clock is the system clock, exactly as before.  In virtual
+ * mode it is driven by the frames being processed: each GPS, Galileo,
+ * QZSS or BeiDou MSM frame fed in sets the clock to its epoch time
+ * (BeiDou shifted to GPS time), so a capture can be processed at any
+ * speed and still yields the intervals and sky positions of the
+ * recording.  The clock only moves forward: constellations and
+ * multi-message epochs interleave, so small backward steps are expected.
+ *
+ * Before the first MSM frame a virtual clock reads 0 s / the current
+ * wall-clock GPS week with ToW 0.  The GPS week is unknown from MSM
+ * headers; it is taken from the system clock, which is harmless because
+ * ephemeris matching and propagation use ToW only (see
+ * sv_eph_is_valid_at()).
+ *
+ * Threading: one writer (the thread that feeds frames); any number of
+ * readers.  The state is a single 64-bit value accessed with __atomic
+ * builtins, as in sv_ephemeris.c.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef STREAM_CLOCK_H
+#define STREAM_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Select wall-clock (false) or virtual (true) time.
+ *
+ * Switching to virtual resets the clock to "no epoch seen yet".
+ */
+void stream_clock_set_virtual(bool virtual_time);
+
+/** @brief true while the clock is virtual. */
+bool stream_clock_is_virtual(void);
+
+/**
+ * @brief Advance a virtual clock from an RTCM frame.
+ *
+ * No-op in wall mode and for frames without a usable epoch time, so it
+ * can be called for every frame.
+ *
+ * @param frame      Whole RTCM frame (starting at the 0xD3 preamble).
+ * @param frame_len  Frame length in bytes.
+ */
+void stream_clock_feed(const unsigned char *frame, int frame_len);
+
+/**
+ * @brief GPS time of an MSM frame in ms of week.
+ *
+ * GPS, Galileo and QZSS MSM epoch times are GPS ToW already; BeiDou's
+ * is shifted by 14 s.  GLONASS (day-of-week + Moscow time) and other
+ * frames return -1.
+ */
+long stream_clock_msm_epoch_ms(const unsigned char *frame, int frame_len);
+
+/**
+ * @brief Monotonic time in seconds, for intervals.
+ *
+ * Wall mode: a high-resolution monotonic counter.  Virtual mode: GPS
+ * seconds of the latest epoch.  Only differences are meaningful.
+ */
+double stream_clock_seconds(void);
+
+/**
+ * @brief The virtual clock as GPS ms since the GPS epoch; -1 before the
+ *        first epoch (or in wall mode).
+ */
+int64_t stream_clock_virtual_ms(void);
+
+/**
+ * @brief Set the virtual clock, to continue a replay from saved state
+ *        (replay_keyframe.h).  Feeding goes on from there.
+ */
+void stream_clock_set_virtual_ms(int64_t gps_ms);
+
+/** @brief The wall-clock monotonic counter, whatever the mode (for pacing). */
+double stream_clock_wall_seconds(void);
+
+/** @brief The same monotonic counter in ns (capture receive timestamps). */
+int64_t stream_clock_wall_ns(void);
+
+/** @brief GPS week and seconds of week (coarse: leap seconds ignored in wall mode). */
+void stream_clock_gps_time(int *week, double *tow_s);
+
+/** @brief Moscow seconds-of-day for GLONASS propagation (UTC + 3 h). */
+double stream_clock_glo_tod(void);
+
+/**
+ * @brief Wall-clock UTC in Unix ns, at the best resolution the platform
+ *        offers (CLOCK_REALTIME; GetSystemTimePreciseAsFileTime on
+ *        Windows 8 and later).
+ */
+int64_t stream_clock_utc_ns(void);
+
+/**
+ * @brief GPS - UTC in seconds at Unix time @p unix_s (leap second table,
+ *        1980 .. 2017-01-01; later dates keep the last value).
+ */
+int stream_clock_leap_seconds(int64_t unix_s);
+
+/** @brief GPS ms since the GPS epoch (1980-01-06) of Unix time @p unix_s. */
+int64_t stream_clock_unix_to_gps_ms(int64_t unix_s);
+
+/**
+ * @brief Absolute GPS time of an MSM epoch.
+ *
+ * MSM headers carry the time of week (GLONASS: day of week and Moscow
+ * time of day), so the week is taken from @p ref_ms: the result is the
+ * time nearest to it, within half a week (GLONASS: half a day).
+ *
+ * @param gnss_id     GNSS ID of the MSM (RtcmMsmObs::gnss_id).
+ * @param epoch_time  DF004 .. DF428 epoch time as sent (RtcmMsmObs::epoch_time).
+ * @param ref_ms      GPS ms near the epoch: the previous epoch, or
+ *                    stream_clock_unix_to_gps_ms() of the date of the data.
+ * @return GPS ms since the GPS epoch, or -1 for an invalid time of week.
+ */
+int64_t stream_clock_msm_gps_ms(int gnss_id, uint32_t epoch_time, int64_t ref_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_CLOCK_H */
@@ -0,0 +1,430 @@
+/**
+ * @file stream_compare.c
+ * @brief Epoch-aligned comparison of live streams (`--compare`).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "stream_compare.h"
+#include "corr_age.h"
+#include "event_out.h"
+#include "rtcm3x_parser.h"
+#include "stream_clock.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NS_PER_MS  1000000LL
+
+/* Scored epochs are swept out every 100 ms of receive time. */
+#define CMP_SWEEP_NS  (100 * NS_PER_MS)
+
+static const char k_gnss[CMP_GNSS][8] = { "?", "GPS", "GLONASS", "Galileo",
+                                          "QZSS", "BeiDou", "SBAS", "NavIC" };
+
+StreamCompare *stream_compare_new(int n, int window_ms, double report_s)
+{
+    if (n < 2 || n > CMP_MAX_STREAMS || window_ms <= 0) return NULL;
+    StreamCompare *c = (StreamCompare *)calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->n         = n;
+    c->window_ms = window_ms;
+    c->report_s  = report_s > 0.0 ? report_s : CMP_DEFAULT_REPORT_S;
+    /* The window at 10 Hz on four GNSS, plus a few epochs of slack. */
+    c->n_slots = 4 * (window_ms / 100) + 8;
+    c->slot = (CmpEpoch *)calloc((size_t)c->n_slots, sizeof(CmpEpoch));
+    c->side = (CmpSide *)calloc((size_t)c->n_slots * (size_t)n, sizeof(CmpSide));
+    if (!c->slot || !c->side) {
+        stream_compare_free(c);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) snprintf(c->st[i].name, sizeof(c->st[i].name), "#%d", i + 1);
+    return c;
+}
+
+void stream_compare_free(StreamCompare *c)
+{
+    if (!c) return;
+    free(c->slot);
+    free(c->side);
+    free(c);
+}
+
+void stream_compare_set_name(StreamCompare *c, int i, const char *name)
+{
+    if (i < 0 || i >= c->n || !name) return;
+    snprintf(c->st[i].name, sizeof(c->st[i].name), "%s", name);
+}
+
+/* ── Scoring ──────────────────────────────────────────────────────────── */
+
+static void tally_add(CmpTally *dst, const CmpTally *src)
+{
+    dst->epochs       += src->epochs;
+    dst->aligned      += src->aligned;
+    dst->missing      += src->missing;
+    dst->extra        += src->extra;
+    dst->sats_missing += src->sats_missing;
+    dst->sats_extra   += src->sats_extra;
+    dst->cells        += src->cells;
+    dst->cnr_sum      += src->cnr_sum;
+    dst->cnr_sum2     += src->cnr_sum2;
+    dst->dt_sum       += src->dt_sum;
+    dst->ahead        += src->ahead;
+}
+
+/* Score slot @p s against the reference and free it. */
+static void cmp_score(StreamCompare *c, int s)
+{
+    CmpEpoch *e = &c->slot[s];
+    const CmpSide *ref = &c->side[(size_t)s * c->n];
+    bool ref_has = (e->present & 1u) != 0;
+    int g = e->gnss_id;
+
+    /* Reference cells by (PRN, signal); 0 = none, else index + 1. */
+    uint8_t at[64][CMP_SIGS];
+    if (ref_has) {
+        memset(at, 0, sizeof(at));
+        for (int k = 0; k < ref->n_cells; k++)
+            at[ref->cell[k].prn - 1][ref->cell[k].sig] = (uint8_t)(k + 1);
+    }
+
+    for (int i = 0; i < c->n; i++) {
+        CmpStream *st = &c->st[i];
+        const CmpSide *d = &c->side[(size_t)s * c->n + i];
+        bool has = (e->present & (1u << i)) != 0;
+        CmpTally t;
+        memset(&t, 0, sizeof(t));
+        if (has) {
+            t.epochs = 1;
+            if (d->age_ms != INT32_MIN) qsketch_add(&st->age_ms, (double)d->age_ms);
+        }
+        if (i > 0) {
+            if (!ref_has) {
+                t.extra = has;
+            } else if (!has) {
+                t.missing = 1;
+            } else {
+                t.aligned      = 1;
+                t.sats_missing = (unsigned long)sat_mask_count(ref->sats & ~d->sats);
+                t.sats_extra   = (unsigned long)sat_mask_count(d->sats & ~ref->sats);
+                double dt = (double)(d->rx_ns - ref->rx_ns) / NS_PER_MS;
+                t.dt_sum = dt;
+                t.ahead  = dt < 0.0;
+                for (int k = 0; k < d->n_cells; k++) {
+                    const CmpCell *cl = &d->cell[k];
+                    int r = at[cl->prn - 1][cl->sig];
+                    if (!r) continue;
+                    double dc = (cl->cnr - ref->cell[r - 1].cnr) / 16.0;
+                    CmpSignal *sg = &st->sig[g][cl->sig];
+                    sg->n++;
+                    sg->sum  += dc;
+                    sg->sum2 += dc * dc;
+                    t.cells++;
+                    t.cnr_sum  += dc;
+                    t.cnr_sum2 += dc * dc;
+                }
+            }
+        }
+        tally_add(&st->total, &t);
+        tally_add(&st->recent, &t);
+    }
+
+    if (e->gps_ms > c->closed_ms[g]) c->closed_ms[g] = e->gps_ms;
+    c->scored++;
+    e->used = false;
+}
+
+/* Score every epoch whose window has passed at @p now_ns. */
+static void cmp_sweep(StreamCompare *c, int64_t now_ns)
+{
+    int64_t window_ns = (int64_t)c->window_ms * NS_PER_MS;
+    for (int s = 0; s < c->n_slots; s++)
+        if (c->slot[s].used && now_ns - c->slot[s].opened_ns >= window_ns)
+            cmp_score(c, s);
+}
+
+static int cmp_find(const StreamCompare *c, int gnss_id, int64_t gps_ms)
+{
+    for (int s = 0; s < c->n_slots; s++)
+        if (c->slot[s].used && c->slot[s].gnss_id == gnss_id && c->slot[s].gps_ms == gps_ms)
+            return s;
+    return -1;
+}
+
+/* A free slot for a new epoch; the oldest is scored early if none is. */
+static int cmp_open(StreamCompare *c, int gnss_id, int64_t gps_ms, int64_t rx_ns)
+{
+    int s = -1;
+    for (int k = 0; k < c->n_slots && s < 0; k++)
+        if (!c->slot[k].used) s = k;
+    if (s < 0) {
+        s = 0;
+        for (int k = 1; k < c->n_slots; k++)
+            if (c->slot[k].opened_ns < c->slot[s].opened_ns) s = k;
+        cmp_score(c, s);
+        c->evicted++;
+    }
+    CmpEpoch *e = &c->slot[s];
+    memset(e, 0, sizeof(*e));
+    e->used      = true;
+    e->gnss_id   = gnss_id;
+    e->gps_ms    = gps_ms;
+    e->opened_ns = rx_ns;
+    return s;
+}
+
+void stream_compare_frame(StreamCompare *c, int i, const unsigned char *frame,
+                          int frame_len, int64_t rx_utc_ns)
+{
+    if (i < 0 || i >= c->n || frame_len < 6 + 8) return;
+    int mt = ((int)frame[3] << 4) | ((int)frame[4] >> 4);
+    if (!rtcm_msg_is_msm(mt, 4, 7)) return;
+    if (!c->started_ns) {
+        c->started_ns     = rx_utc_ns;
+        c->next_report_ns = rx_utc_ns + (int64_t)(c->report_s * 1e9);
+    }
+    if (rx_utc_ns >= c->next_sweep_ns) {
+        cmp_sweep(c, rx_utc_ns);
+        c->next_sweep_ns = rx_utc_ns + CMP_SWEEP_NS;
+    }
+
+    RtcmMsmObs obs;
+    if (!rtcm_decode_msm(frame + 3, frame_len - 6, &obs) || obs.truncated) return;
+    int g = obs.gnss_id;
+    if (g <= 0 || g >= CMP_GNSS) return;
+    int64_t gps_ms = stream_clock_msm_gps_ms(g, obs.epoch_time,
+        stream_clock_unix_to_gps_ms(rx_utc_ns / 1000000000LL));
+    if (gps_ms < 0) return;
+
+    CmpStream *st = &c->st[i];
+    int s = cmp_find(c, g, gps_ms);
+    if (s < 0) {
+        if (gps_ms <= c->closed_ms[g]) {
+            /* Not just another MSM type of an epoch this stream sent. */
+            if (gps_ms != st->last_ms[g]) c->late++;
+            return;
+        }
+        s = cmp_open(c, g, gps_ms, rx_utc_ns);
+    }
+
+    CmpEpoch *e = &c->slot[s];
+    CmpSide *d = &c->side[(size_t)s * c->n + i];
+    unsigned bit = 1u << i;
+    if (!(e->present & bit)) {
+        e->present |= bit;
+        d->rx_ns   = rx_utc_ns;
+        d->sats    = 0;
+        d->n_cells = 0;
+        int64_t age_ns;
+        d->age_ms = corr_age_of_frame(frame, frame_len, rx_utc_ns, &age_ns)
+                    ? (int32_t)(age_ns / NS_PER_MS) : INT32_MIN;
+        if (gps_ms > st->last_ms[g]) st->last_ms[g] = gps_ms;
+    }
+    d->sats |= obs.sat_mask;
+
+    /* A signal sent twice (MSM4 and MSM7 of one epoch) counts once. */
+    for (int k = 0; k < obs.num_cells; k++) {
+        const RtcmMsmCell *cell = &obs.cells[k];
+        int prn = obs.sats[cell->sat].prn;
+        if (prn < 1 || prn > 64 || cell->sig_idx < 0 || cell->sig_idx >= CMP_SIGS ||
+            cell->cnr_dbhz <= 0.0f)
+            continue;
+        int j = 0;
+        while (j < d->n_cells && (d->cell[j].prn != prn || d->cell[j].sig != cell->sig_idx)) j++;
+        if (j < d->n_cells || d->n_cells == CMP_CELLS) continue;
+        d->cell[d->n_cells].prn = (uint8_t)prn;
+        d->cell[d->n_cells].sig = (uint8_t)cell->sig_idx;
+        d->cell[d->n_cells].cnr = (uint16_t)lrintf(cell->cnr_dbhz * 16.0f);
+        d->n_cells++;
+    }
+
+    if (!obs.mm_flag) e->done |= bit;
+    if (e->done == (1u << c->n) - 1u) cmp_score(c, s);
+}
+
+void stream_compare_flush(StreamCompare *c)
+{
+    for (int s = 0; s < c->n_slots; s++)
+        if (c->slot[s].used) cmp_score(c, s);
+}
+
+/* ── Reports ──────────────────────────────────────────────────────────── */
+
+static double tally_cnr_sd(const CmpTally *t)
+{
+    if (t->cells < 2) return 0.0;
+    double m = t->cnr_sum / t->cells;
+    double v = t->cnr_sum2 / t->cells - m * m;
+    return v > 0.0 ? sqrt(v) : 0.0;
+}
+
+static void tally_to_event(const CmpTally *t, struct EventOut *ev)
+{
+    event_uint(ev, "epochs", t->epochs);
+    event_uint(ev, "aligned", t->aligned);
+    event_uint(ev, "missing", t->missing);
+    event_uint(ev, "extra", t->extra);
+    event_uint(ev, "sats_missing", t->sats_missing);
+    event_uint(ev, "sats_extra", t->sats_extra);
+    event_uint(ev, "cells", t->cells);
+    if (t->cells) {
+        event_fixed(ev, "cnr_db", t->cnr_sum / t->cells, 2);
+        event_fixed(ev, "cnr_sd", tally_cnr_sd(t), 2);
+    }
+    if (t->aligned) {
+        event_fixed(ev, "arrival_ms", t->dt_sum / t->aligned, 1);
+        event_uint(ev, "ahead", t->ahead);
+    }
+}
+
+bool stream_compare_interval(StreamCompare *c, int64_t now_utc_ns, FILE *out,
+                             struct EventOut *ev)
+{
+    if (!c->started_ns || now_utc_ns < c->next_report_ns) return false;
+    c->next_report_ns = now_utc_ns + (int64_t)(c->report_s * 1e9);
+
+    char ts[16] = "--:--:--";
+    time_t now_t = (time_t)(now_utc_ns / 1000000000LL);
+    struct tm *gt = gmtime(&now_t);
+    if (gt) strftime(ts, sizeof(ts), "%H:%M:%S", gt);
+
+    const CmpStream *ref = &c->st[0];
+    for (int i = 1; out && i < c->n; i++) {
+        const CmpTally *t = &c->st[i].recent;
+        fprintf(out, "[CMP] %s %s vs %s: %lu/%lu epochs (-%lu +%lu)", ts,
+                c->st[i].name, ref->name, t->aligned, ref->recent.epochs,
+                t->missing, t->extra);
+        if (t->aligned) {
+            fprintf(out, ", sats -%.2f +%.2f", (double)t->sats_missing / t->aligned,
+                    (double)t->sats_extra / t->aligned);
+            if (t->cells)
+                fprintf(out, ", CNR %+.2f dB (sd %.2f)", t->cnr_sum / t->cells,
+                        tally_cnr_sd(t));
+            fprintf(out, ", arrival %+.0f ms (first in %.0f%%)", t->dt_sum / t->aligned,
+                    100.0 * t->ahead / t->aligned);
+        }
+        fprintf(out, "\n");
+    }
+    if (out) fflush(out);
+
+    if (ev) {
+        event_begin(ev, "compare");
+        event_int(ev, "t", now_t);
+        event_str(ev, "reference", ref->name);
+        event_uint(ev, "epochs", ref->recent.epochs);
+        event_arr(ev, "streams");
+        for (int i = 1; i < c->n; i++) {
+            event_obj(ev, NULL);
+            event_str(ev, "name", c->st[i].name);
+            tally_to_event(&c->st[i].recent, ev);
+            event_close(ev);
+        }
+        event_close(ev);
+        event_end(ev);
+    }
+
+    for (int i = 0; i < c->n; i++) memset(&c->st[i].recent, 0, sizeof(c->st[i].recent));
+    return true;
+}
+
+void stream_compare_report(const StreamCompare *c, FILE *out, struct EventOut *ev)
+{
+    const CmpStream *ref = &c->st[0];
+    if (out) {
+        fprintf(out, "\nEpoch-aligned comparison against %s (window %d ms)\n",
+                ref->name, c->window_ms);
+        fprintf(out, "  %lu epochs scored (%lu early, buffer full), %lu late frames dropped\n\n",
+                c->scored, c->evicted, c->late);
+        fprintf(out, "%-20s %8s %8s %8s %8s %9s %9s %8s %6s %10s %8s %8s\n",
+                "Stream", "Epochs", "Aligned", "Missing", "Extra", "Sats-/ep", "Sats+/ep",
+                "dCNR dB", "sd", "Arrival ms", "Age p50", "Age p95");
+        for (int i = 0; i < c->n; i++) {
+            const CmpStream *st = &c->st[i];
+            const CmpTally *t = &st->total;
+            char name[24];
+            snprintf(name, sizeof(name), i == 0 ? "%.14s (ref)" : "%.20s", st->name);
+            fprintf(out, "%-20s %8lu ", name, t->epochs);
+            if (i == 0)
+                fprintf(out, "%8s %8s %8s %9s %9s %8s %6s %10s", "-", "-", "-", "-", "-",
+                        "-", "-", "-");
+            else if (!t->aligned)
+                fprintf(out, "%8lu %8lu %8lu %9s %9s %8s %6s %10s", t->aligned, t->missing,
+                        t->extra, "-", "-", "-", "-", "-");
+            else
+                fprintf(out, "%8lu %8lu %8lu %9.2f %9.2f %+8.2f %6.2f %+10.1f", t->aligned,
+                        t->missing, t->extra, (double)t->sats_missing / t->aligned,
+                        (double)t->sats_extra / t->aligned,
+                        t->cells ? t->cnr_sum / t->cells : 0.0, tally_cnr_sd(t),
+                        t->dt_sum / t->aligned);
+            if (st->age_ms.count)
+                fprintf(out, " %8.0f %8.0f\n", qsketch_quantile(&st->age_ms, 0.50),
+                        qsketch_quantile(&st->age_ms, 0.95));
+            else
+                fprintf(out, " %8s %8s\n", "-", "-");
+        }
+
+        bool head = false;
+        for (int i = 1; i < c->n; i++) {
+            for (int g = 1; g < CMP_GNSS; g++) {
+                for (int k = 0; k < CMP_SIGS; k++) {
+                    const CmpSignal *sg = &c->st[i].sig[g][k];
+                    if (!sg->n) continue;
+                    if (!head) {
+                        fprintf(out, "\nCNR difference per signal (stream - reference, dB-Hz):\n");
+                        fprintf(out, "%-20s %-8s %-6s %8s %6s %9s\n",
+                                "Stream", "GNSS", "Signal", "Mean", "sd", "Signals");
+                        head = true;
+                    }
+                    double m = sg->sum / sg->n;
+                    double v = sg->n > 1 ? sg->sum2 / sg->n - m * m : 0.0;
+                    fprintf(out, "%-20.20s %-8s %-6s %+8.2f %6.2f %9lu\n", c->st[i].name,
+                            k_gnss[g], msm_signal_label(g, k), m, v > 0.0 ? sqrt(v) : 0.0,
+                            sg->n);
+                }
+            }
+        }
+        fflush(out);
+    }
+
+    if (ev) {
+        event_begin(ev, "compare_summary");
+        event_str(ev, "reference", ref->name);
+        event_int(ev, "window_ms", c->window_ms);
+        event_uint(ev, "scored", c->scored);
+        event_uint(ev, "evicted", c->evicted);
+        event_uint(ev, "late", c->late);
+        event_arr(ev, "streams");
+        for (int i = 0; i < c->n; i++) {
+            const CmpStream *st = &c->st[i];
+            event_obj(ev, NULL);
+            event_str(ev, "name", st->name);
+            tally_to_event(&st->total, ev);
+            qsketch_to_event(&st->age_ms, ev, "age_ms");
+            event_arr(ev, "signals");
+            for (int g = 1; i > 0 && g < CMP_GNSS; g++) {
+                for (int k = 0; k < CMP_SIGS; k++) {
+                    const CmpSignal *sg = &st->sig[g][k];
+                    if (!sg->n) continue;
+                    double m = sg->sum / sg->n;
+                    double v = sg->n > 1 ? sg->sum2 / sg->n - m * m : 0.0;
+                    event_obj(ev, NULL);
+                    event_str(ev, "gnss", k_gnss[g]);
+                    event_str(ev, "signal", msm_signal_label(g, k));
+                    event_fixed(ev, "cnr_db", m, 2);
+                    event_fixed(ev, "cnr_sd", v > 0.0 ? sqrt(v) : 0.0, 2);
+                    event_uint(ev, "n", sg->n);
+                    event_close(ev);
+                }
+            }
+            event_close(ev);
+            event_close(ev);
+        }
+        event_close(ev);
+        event_end(ev);
+    }
+}
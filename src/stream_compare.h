@@ -0,0 +1,203 @@
+/**
+ * @file stream_compare.h
+ * @brief Epoch-aligned comparison of live streams (`--compare`).
+ *
+ * A primary and a backup base station, or an own stream and a commercial
+ * one, are compared epoch by epoch: the first stream of the mounts file
+ * is the reference, every other one is held against it.  Frames reach
+ * the comparison through the multi-mountpoint monitor's frame hook
+ * (ntrip_multi_set_frame_hook()), so all streams run on one event loop
+ * and the differences are known while they stream.
+ *
+ * MSM frames are keyed by GNSS and epoch in GPS time
+ * (stream_clock_msm_gps_ms()), so streams with other MSM types or
+ * latencies still meet in the same epoch.  An epoch waits in a reorder
+ * buffer until every stream has sent it (the frame with the multiple
+ * message bit clear) or the alignment window has passed since its first
+ * frame; it is then scored and its slot reused.  The buffer holds
+ * enough slots for the window at 10 Hz on four GNSS -- memory follows
+ * the window, not the run time -- and when it is full the oldest epoch
+ * is scored early.  A frame of an epoch that was already scored is late
+ * and dropped.
+ *
+ * Per stream and epoch against the reference:
+ *
+ *   - whether either side lacks the epoch,
+ *   - the satellites only the reference has, and only the stream has,
+ *   - the CNR difference of every signal both carry, per GNSS and signal,
+ *   - the arrival time after the reference's, and the age of the epoch
+ *     at its arrival (corr_age.h) in a quantile sketch.
+ *
+ * Every report interval one line per stream sums up that interval;
+ * stream_compare_report() prints the totals and the CNR per signal.
+ *
+ * Plain data, no locking: one comparison per event-loop thread.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef STREAM_COMPARE_H
+#define STREAM_COMPARE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "quantile_sketch.h"
+#include "sat_vis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct EventOut;
+
+/** @brief Streams compared at once, the reference included. */
+#define CMP_MAX_STREAMS       8
+
+/** @brief Alignment window (ms) when --compare-window is not given. */
+#define CMP_DEFAULT_WINDOW_MS 2000
+
+/** @brief Report interval (s) when --compare has no value. */
+#define CMP_DEFAULT_REPORT_S  10
+
+/** @brief Signals kept per stream and epoch; more are not compared. */
+#define CMP_CELLS             128
+
+/** @brief GNSS IDs 0..7, as in the RTCM registry. */
+#define CMP_GNSS              8
+
+/** @brief MSM signal-mask positions per GNSS. */
+#define CMP_SIGS              32
+
+/**
+ * @struct CmpTally
+ * @brief Counts of one stream against the reference.  All zero is empty.
+ */
+typedef struct {
+    unsigned long epochs;         /**< epochs this stream sent */
+    unsigned long aligned;        /**< ... that the reference sent too */
+    unsigned long missing;        /**< reference epochs this stream lacks */
+    unsigned long extra;          /**< epochs of this stream the reference lacks */
+    unsigned long sats_missing;   /**< reference satellites not in this stream, over aligned epochs */
+    unsigned long sats_extra;     /**< satellites of this stream not in the reference */
+    unsigned long cells;          /**< signals in both, CNR compared */
+    double        cnr_sum;        /**< sum of this - reference, dB-Hz */
+    double        cnr_sum2;
+    double        dt_sum;         /**< sum of arrival after the reference's, ms */
+    unsigned long ahead;          /**< aligned epochs that arrived first here */
+} CmpTally;
+
+/** @brief CNR difference of one signal, this stream - reference. */
+typedef struct {
+    unsigned long n;
+    double        sum, sum2;
+} CmpSignal;
+
+/** @brief One stream of the comparison. */
+typedef struct {
+    char      name[64];
+    CmpTally  total;
+    CmpTally  recent;             /**< since the last report */
+    QSketch   age_ms;             /**< age of each epoch at its arrival */
+    CmpSignal sig[CMP_GNSS][CMP_SIGS];
+    int64_t   last_ms[CMP_GNSS];  /**< latest epoch seen, GPS ms; 0 = none */
+} CmpStream;
+
+/** @brief The signal data one stream sent for one epoch. */
+typedef struct {
+    uint8_t  prn;
+    uint8_t  sig;                 /**< 0-based MSM signal-mask position */
+    uint16_t cnr;                 /**< dB-Hz * 16 */
+} CmpCell;
+
+/** @brief One epoch in the reorder buffer. */
+typedef struct {
+    bool      used;
+    int       gnss_id;
+    int64_t   gps_ms;
+    int64_t   opened_ns;          /**< receive time of its first frame */
+    unsigned  present;            /**< bit per stream that sent it */
+    unsigned  done;               /**< bit per stream whose last frame of it came */
+} CmpEpoch;
+
+/** @brief Per stream and slot: what it sent of that epoch. */
+typedef struct {
+    int64_t  rx_ns;
+    int32_t  age_ms;
+    SatMask  sats;
+    int      n_cells;
+    CmpCell  cell[CMP_CELLS];
+} CmpSide;
+
+/**
+ * @struct StreamCompare
+ * @brief The comparison: streams plus the reorder buffer.
+ */
+typedef struct {
+    int           n;
+    CmpStream     st[CMP_MAX_STREAMS];
+    int           window_ms;
+    double        report_s;
+    int           n_slots;
+    CmpEpoch     *slot;
+    CmpSide      *side;           /**< n_slots * n, slot-major */
+    int64_t       closed_ms[CMP_GNSS];  /**< latest epoch scored, GPS ms */
+    unsigned long scored;         /**< epochs scored */
+    unsigned long evicted;        /**< ... early, because the buffer was full */
+    unsigned long late;           /**< frames of an epoch already scored */
+    int64_t       next_sweep_ns;
+    int64_t       next_report_ns;
+    int64_t       started_ns;
+} StreamCompare;
+
+/**
+ * @brief Allocate a comparison of @p n streams (2 .. CMP_MAX_STREAMS),
+ *        stream 0 being the reference.
+ *
+ * @param window_ms  How long an epoch waits for the streams that lack it.
+ * @param report_s   Seconds between two stream_compare_interval() reports.
+ * @return NULL if @p n is out of range or memory runs out.
+ */
+StreamCompare *stream_compare_new(int n, int window_ms, double report_s);
+
+/** @brief Free what stream_compare_new() returned (NULL is ignored). */
+void stream_compare_free(StreamCompare *c);
+
+/** @brief Name stream @p i in the reports (its mountpoint). */
+void stream_compare_set_name(StreamCompare *c, int i, const char *name);
+
+/**
+ * @brief Feed one CRC-checked frame of stream @p i, received at
+ *        @p rx_utc_ns (UTC, Unix ns).  Frames other than MSM4..7 are
+ *        ignored.  Epochs whose window has passed are scored first.
+ */
+void stream_compare_frame(StreamCompare *c, int i, const unsigned char *frame,
+                          int frame_len, int64_t rx_utc_ns);
+
+/**
+ * @brief If a report is due at @p now_utc_ns: one line per compared
+ *        stream on @p out (NULL = none) and a "compare" event on @p ev
+ *        (NULL = none), covering the interval since the last one.
+ * @return true if a report was made.
+ */
+bool stream_compare_interval(StreamCompare *c, int64_t now_utc_ns, FILE *out,
+                             struct EventOut *ev);
+
+/** @brief Score every epoch still in the buffer (end of run). */
+void stream_compare_flush(StreamCompare *c);
+
+/**
+ * @brief Print the totals of every stream and the CNR difference per
+ *        signal on @p out, and add them as a "compare_summary" event to
+ *        @p ev (NULL = none).
+ */
+void stream_compare_report(const StreamCompare *c, FILE *out, struct EventOut *ev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_COMPARE_H */
@@ -0,0 +1,242 @@
+/**
+ * @file stream_format.c
+ * @brief Stream formats on a mountpoint: per-format framing rules and a
+ *        one-pass sniffer that picks the format from the first bytes.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "stream_format.h"
+#include "rtcm3x_parser.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RTCM3_FRAME_MAX (3 + 1023 + 3)
+
+/* Byte @p i of a frame split as described in stream_format.h. */
+static unsigned char piece_at(const unsigned char *a, size_t na, const unsigned char *b, size_t i)
+{
+    return i < na ? a[i] : b[i - na];
+}
+
+/* ── RTCM 3.x: 0xD3, 6 reserved zero bits, 10-bit length, CRC-24Q ── */
+
+static size_t rtcm3_frame_len(const unsigned char *h)
+{
+    if (h[1] & 0xFC) return 0;
+    return ((((size_t)h[1] & 0x03) << 8) | h[2]) + 6;
+}
+
+static bool rtcm3_check(const unsigned char *a, size_t na, const unsigned char *b, size_t len)
+{
+    unsigned char flat[RTCM3_FRAME_MAX];
+    if (na < len) {                 /* crc24q() wants one piece */
+        memcpy(flat, a, na);
+        memcpy(flat + na, b, len - na);
+        a = flat;
+    }
+    uint32_t crc_recv = ((uint32_t)a[len - 3] << 16) | ((uint32_t)a[len - 2] << 8) | a[len - 1];
+    return crc24q(a, len - 3) == crc_recv;
+}
+
+/* ── UBX: 0xB5 0x62, class, ID, 16-bit LE length, 8-bit Fletcher ── */
+
+static size_t ubx_frame_len(const unsigned char *h)
+{
+    if (h[1] != 0x62) return 0;
+    return ((size_t)h[4] | ((size_t)h[5] << 8)) + 8;
+}
+
+static bool ubx_check(const unsigned char *a, size_t na, const unsigned char *b, size_t len)
+{
+    /* Over class .. end of payload, in at most two runs. */
+    unsigned ck_a = 0, ck_b = 0;
+    size_t end = len - 2;
+    size_t run = na < end ? na : end;
+    for (size_t i = 2; i < run; i++) {
+        ck_a += a[i];
+        ck_b += ck_a;
+    }
+    for (size_t i = run; i < end; i++) {
+        ck_a += b[i - na];
+        ck_b += ck_a;
+    }
+    return (ck_a & 0xFF) == piece_at(a, na, b, len - 2) &&
+           (ck_b & 0xFF) == piece_at(a, na, b, len - 1);
+}
+
+/* ── SBF: "$@", CRC-16 (LE), ID, 16-bit LE block length incl. header ── */
+
+static uint16_t sbf_crc_tab[256];
+static int      sbf_crc_ready;
+
+static void sbf_crc_init(void)
+{
+    for (int n = 0; n < 256; n++) {
+        uint16_t c = (uint16_t)(n << 8);
+        for (int k = 0; k < 8; k++)
+            c = (uint16_t)((c & 0x8000) ? (c << 1) ^ 0x1021 : c << 1);
+        sbf_crc_tab[n] = c;
+    }
+    __atomic_store_n(&sbf_crc_ready, 1, __ATOMIC_RELEASE);
+}
+
+static uint16_t sbf_crc(uint16_t crc, const unsigned char *p, size_t n)
+{
+    while (n--)
+        crc = (uint16_t)((crc << 8) ^ sbf_crc_tab[((crc >> 8) ^ *p++) & 0xFF]);
+    return crc;
+}
+
+static size_t sbf_frame_len(const unsigned char *h)
+{
+    if (h[1] != 0x40) return 0;
+    size_t len = (size_t)h[6] | ((size_t)h[7] << 8);
+    return (len >= 8 && (len & 3) == 0) ? len : 0;
+}
+
+static bool sbf_check(const unsigned char *a, size_t na, const unsigned char *b, size_t len)
+{
+    /* Building the table twice from two threads writes the same values. */
+    if (!__atomic_load_n(&sbf_crc_ready, __ATOMIC_ACQUIRE)) sbf_crc_init();
+    /* CRC-CCITT (0x1021, initial 0) over ID .. end of block. */
+    size_t run = na < len ? na : len;
+    uint16_t crc = sbf_crc(0, a + 4, run - 4);
+    if (run < len) crc = sbf_crc(crc, b, len - run);
+    return crc == (uint16_t)(a[2] | (a[3] << 8));
+}
+
+static const StreamFramerOps framer_ops[] = {
+    { STREAM_FMT_RTCM3, "RTCM 3.x",       0xD3, 3, rtcm3_frame_len, rtcm3_check },
+    { STREAM_FMT_UBX,   "UBX (u-blox)",   0xB5, 6, ubx_frame_len,   ubx_check   },
+    { STREAM_FMT_SBF,   "Septentrio SBF", 0x24, 8, sbf_frame_len,   sbf_check   },
+};
+
+#define N_FRAMER_OPS ((int)(sizeof(framer_ops) / sizeof(framer_ops[0])))
+
+typedef char sniff_syncs_match[N_FRAMER_OPS == STREAM_SNIFF_SYNCS ? 1 : -1];
+
+const StreamFramerOps *stream_framer_ops(StreamFormat fmt)
+{
+    for (int i = 0; i < N_FRAMER_OPS; i++)
+        if (framer_ops[i].format == fmt) return &framer_ops[i];
+    return NULL;
+}
+
+const char *stream_format_name(StreamFormat fmt)
+{
+    switch (fmt) {
+    case STREAM_FMT_RTCM3:   return "RTCM 3.x";
+    case STREAM_FMT_UBX:     return "UBX (u-blox)";
+    case STREAM_FMT_SBF:     return "Septentrio SBF";
+    case STREAM_FMT_RT27:    return "RAW Trimble RT27";
+    case STREAM_FMT_LB2:     return "RAW Leica LB2";
+    case STREAM_FMT_UNKNOWN: return "Unknown";
+    default:                 return "";
+    }
+}
+
+void stream_sniff_reset(StreamSniffer *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+/* Move s->pos to the next sync byte of any format; NULL if there is none
+ * before @p len.  Each format keeps where its memchr() stopped, so every
+ * byte is searched once per format. */
+static const StreamFramerOps *sniff_next(StreamSniffer *s, const unsigned char *buf, size_t len)
+{
+    int best = -1;
+    for (int k = 0; k < N_FRAMER_OPS; k++) {
+        size_t from;
+        if (s->next[k] < s->pos)
+            from = s->pos;
+        else if (s->next[k] >= s->upto[k] && s->upto[k] < len)
+            from = s->upto[k] > s->pos ? s->upto[k] : s->pos;   /* none found so far */
+        else
+            from = len;
+        if (from < len) {
+            const unsigned char *hit = memchr(buf + from, framer_ops[k].sync, len - from);
+            s->next[k] = hit ? (size_t)(hit - buf) : len;
+            s->upto[k] = len;
+        }
+        if (s->next[k] < s->upto[k] && (best < 0 || s->next[k] < s->next[best])) best = k;
+    }
+    if (best < 0) {
+        s->pos = len;
+        return NULL;
+    }
+    s->pos = s->next[best];
+    return &framer_ops[best];
+}
+
+StreamFormat stream_sniff_feed(StreamSniffer *s, const unsigned char *buf, size_t len,
+                               bool final)
+{
+    while (s->pos < len) {
+        const StreamFramerOps *ops = sniff_next(s, buf, len);
+        if (!ops) break;
+        size_t left = len - s->pos;
+        if (left < ops->header_len) {
+            if (!final) break;
+            s->pos++;
+            continue;
+        }
+        size_t n = ops->frame_len(buf + s->pos);
+        if (n == 0 || n > STREAM_FRAME_MAX) {
+            s->pos++;
+            continue;
+        }
+        if (left < n) {
+            if (!final) break;      /* wait for the rest of the candidate */
+            s->pos++;
+            continue;
+        }
+        if (!ops->check(buf + s->pos, n, NULL, n)) {
+            s->pos++;
+            continue;
+        }
+        s->score[ops->format]++;
+        if (ops->format == STREAM_FMT_RTCM3) return STREAM_FMT_RTCM3;
+        s->pos += n;
+    }
+    if (!final) return STREAM_FMT_NONE;
+
+    StreamFormat best = STREAM_FMT_UNKNOWN;
+    for (int f = STREAM_FMT_UBX; f < STREAM_FMT_COUNT; f++)
+        if (s->score[f] > 0 && (best == STREAM_FMT_UNKNOWN || s->score[f] > s->score[best]))
+            best = (StreamFormat)f;
+    return best;
+}
+
+StreamFormat stream_format_sniff(const unsigned char *buf, size_t len, unsigned *frames)
+{
+    StreamSniffer s;
+    stream_sniff_reset(&s);
+    StreamFormat fmt = stream_sniff_feed(&s, buf, len, true);
+    if (frames) *frames = fmt == STREAM_FMT_UNKNOWN ? 0 : s.score[fmt];
+    return fmt;
+}
+
+void stream_format_log(StreamFormat fmt, const char *label)
+{
+    const char *sep = label ? ": " : "";
+    if (!label) label = "";
+    switch (fmt) {
+    case STREAM_FMT_NONE:
+    case STREAM_FMT_RTCM3:
+        break;
+    case STREAM_FMT_UNKNOWN:
+        fprintf(stderr, "[WARN] %s%sNo RTCM 3.x, UBX or SBF frame in %d bytes; still looking\n",
+                label, sep, STREAM_SNIFF_WINDOW);
+        break;
+    default:
+        fprintf(stderr, "[INFO] %s%s%s stream; only RTCM 3.x is decoded, its frames are "
+                        "counted\n", label, sep, stream_format_name(fmt));
+        break;
+    }
+}
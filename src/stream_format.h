@@ -0,0 +1,134 @@
+/**
+ * @file stream_format.h
+ * @brief Stream formats on a mountpoint: per-format framing rules and a
+ *        one-pass sniffer that picks the format from the first bytes.
+ *
+ * Casters carry more than RTCM 3.x: u-blox UBX and Septentrio SBF
+ * receivers are often published raw.  Framed as RTCM such a stream is
+ * nothing but resync work -- every 0xD3 byte in it is a preamble
+ * candidate with a CRC to compute -- and nothing is ever decoded.
+ *
+ * Each format with a byte-level framing has a @ref StreamFramerOps: its
+ * sync byte, how a header gives the frame length, and its own checksum
+ * (CRC-24Q, the UBX 8-bit Fletcher pair, the SBF CRC-16).  The
+ * @ref StreamSniffer walks the first bytes of a stream once, scores every
+ * candidate sync of every format by whether a whole frame with a good
+ * checksum starts there, and names the winner; @ref RtcmFramer
+ * (rtcm_framer.h) runs it at the start of every stream and then frames
+ * with the winner only.
+ *
+ * RTCM 3.x wins as soon as a single frame checks out -- a receiver that
+ * interleaves UBX and RTCM is an RTCM stream here, since that is what is
+ * decoded.  The others need the whole @ref STREAM_SNIFF_WINDOW without
+ * RTCM.  Trimble RT27 and Leica LB2 travel inside RTCM 3.x frames and
+ * look like RTCM to the sniffer; only the sourcetable tells them apart.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef STREAM_FORMAT_H
+#define STREAM_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stream formats.  The values are those of the GUI's
+ *        @c AppState.streamFormat.
+ */
+typedef enum {
+    STREAM_FMT_NONE    = 0,     /**< not decided yet */
+    STREAM_FMT_RTCM3   = 1,
+    STREAM_FMT_UBX     = 2,
+    STREAM_FMT_SBF     = 3,
+    STREAM_FMT_RT27    = 4,     /**< RTCM-framed; named by the sourcetable only */
+    STREAM_FMT_LB2     = 5,     /**< RTCM-framed; named by the sourcetable only */
+    STREAM_FMT_UNKNOWN = 6,     /**< a window without any valid frame */
+    STREAM_FMT_COUNT
+} StreamFormat;
+
+/** @brief Bytes the sniffer sees before it settles on a format other than RTCM 3.x. */
+#define STREAM_SNIFF_WINDOW 2048
+
+/** @brief Formats with a StreamFramerOps (RTCM 3.x, UBX, SBF). */
+#define STREAM_SNIFF_SYNCS 3
+
+/** @brief Longest frame taken from a linear buffer; longer lengths are not a frame. */
+#define STREAM_FRAME_MAX 4096
+
+/**
+ * @struct StreamFramerOps
+ * @brief Framing rules of one format.
+ *
+ * A frame may be handed to @c check in two pieces, as it lies in a ring
+ * buffer: @p a holds the first @p na bytes, @p b the remaining
+ * @p len - @p na.  The first @c header_len bytes are always in @p a.
+ */
+typedef struct {
+    StreamFormat  format;
+    const char   *name;
+    unsigned char sync;             /**< first byte of every frame */
+    unsigned char header_len;       /**< bytes frame_len() looks at */
+    /** Length of the frame whose header is at @p hdr, 0 if no frame starts there. */
+    size_t      (*frame_len)(const unsigned char *hdr);
+    /** Whether the frame's own checksum is right. */
+    bool        (*check)(const unsigned char *a, size_t na,
+                         const unsigned char *b, size_t len);
+} StreamFramerOps;
+
+/** @brief Framing rules of @p fmt; NULL for formats without one of their own. */
+const StreamFramerOps *stream_framer_ops(StreamFormat fmt);
+
+/** @brief Display name ("RTCM 3.x", "UBX (u-blox)", ...); "" for STREAM_FMT_NONE. */
+const char *stream_format_name(StreamFormat fmt);
+
+/**
+ * @struct StreamSniffer
+ * @brief Incremental state of one sniffing pass over a window.
+ */
+typedef struct {
+    size_t   pos;                   /**< window bytes examined so far */
+    unsigned score[STREAM_FMT_COUNT];  /**< valid frames found per format */
+    size_t   next[STREAM_SNIFF_SYNCS]; /**< next sync byte of each framer ... */
+    size_t   upto[STREAM_SNIFF_SYNCS]; /**< ... as far as it was looked for */
+} StreamSniffer;
+
+/** @brief Start a new window. */
+void stream_sniff_reset(StreamSniffer *s);
+
+/**
+ * @brief Examine @p buf[s->pos .. len) of the window starting at @p buf.
+ *
+ * Every sync candidate is looked at once (memchr() finds them): one whose
+ * frame checks out is scored and jumped over, anything else is stepped
+ * past.  A candidate whose frame is not complete yet stops the pass until
+ * more bytes arrive, unless @p final.
+ *
+ * @param final  No more bytes will be added to this window.
+ * @return STREAM_FMT_RTCM3 once an RTCM frame checked out; with @p final
+ *         the best other format, or STREAM_FMT_UNKNOWN when none scored;
+ *         otherwise STREAM_FMT_NONE.
+ */
+StreamFormat stream_sniff_feed(StreamSniffer *s, const unsigned char *buf, size_t len,
+                               bool final);
+
+/** @brief One-shot sniff of a complete buffer (a file head, for instance). */
+StreamFormat stream_format_sniff(const unsigned char *buf, size_t len, unsigned *frames);
+
+/**
+ * @brief Report a format just settled on to stderr, prefixed with
+ *        @p label when not NULL.  Silent for RTCM 3.x and STREAM_FMT_NONE.
+ */
+void stream_format_log(StreamFormat fmt, const char *label);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_FORMAT_H */
@@ -1,28 +1,41 @@
 /**
  * @file sv_ephemeris.c
- * @brief Per-SV broadcast-ephemeris cache (lock-free double-buffer).
+ * @brief Per-SV broadcast-ephemeris cache (lock-free, multi-version).
  *
- * Each (gnss_id, prn) slot holds *two* SvEphemeris buffers plus an
- * atomic index that names the currently-active buffer.  Writers fill the
- * inactive buffer in place, issue a release-store of the active index,
- * and the swap is visible to readers atomically.  Readers do an
- * acquire-load of the active index, then read the named buffer -- with
+ * Each (gnss_id, prn) slot holds SV_EPH_HISTORY + 1 SvEphemeris buffers
+ * plus one atomic 64-bit index that names the buffers of the published
+ * versions, sorted by toe, and the most recently stored one.  Writers
+ * fill a buffer the index does not reference, build the new index, and
+ * publish it with a single release-store, so a new version (or the
+ * eviction of the oldest one) is visible to readers atomically.  Readers
+ * do an acquire-load of the index, then read the named buffers -- with
  * no lock.  This eliminates the "torn struct" race that affected
  * GLONASS, where a 268-byte non-atomic struct copy from one thread
  * could be interleaved with a read from another, producing a
  * physically-inconsistent (position, velocity, acceleration) tuple and
  * hundred-kilometre propagation errors on the sky plot.
  *
+ * A buffer is rewritten only after it has left the index, and the writer
+ * cycles through the free buffers, so a reader's pointer stays intact
+ * for at least one later store -- the same guarantee the former
+ * two-buffer slot gave.
+ *
  * Threading model assumed by this implementation:
  *   - ONE writer per slot at a time (per-PRN).  Multiple writers across
- *     different PRNs are fine.  The CLI eph worker thread is the only
- *     writer in CLI sky mode; the GUI's eph worker (gui_thread.c
- *     WorkerOpenEphStream) is the writer in GUI sky mode.  The GUI also
- *     decodes obs-side eph messages on the UI thread via
- *     WM_APP_MSG_RAW -> analyze_rtcm_message -- if your obs stream
- *     carries 1019/1020/etc.  In practice both decoders see the same
- *     broadcast and write the same values, so a multi-writer collision
- *     just wastes the work, not the correctness.
+ *     different PRNs are fine.  In CLI sky mode the writer is the eph
+ *     worker thread while it runs, else the obs loop, which decodes the
+ *     1019/1020/... its own stream carries (main.c sky_obs_eph()); the
+ *     obs loop closes the worker once its stream brings the ephemerides
+ *     of every constellation it observes.  The GUI does the same with
+ *     WorkerOpenEphStream and the obs decode thread (gui_thread.c
+ *     worker_obs_eph()); its UI thread decodes ephemeris frames for the
+ *     detail windows with the store switched off (rtcm_set_eph_store()).
+ *
+ * The table may also sit in shared memory (eph_shm.h): it holds no
+ * pointers, only buffer numbers, so any process mapping it can read it,
+ * and the 64-bit index is lock-free, so the acquire / release pairing
+ * works across processes as it does across threads.  The one writer is
+ * then the feeding process; readers have stores switched off.
  *
  * Atomic primitives use the GCC/Clang __atomic_* builtins so this file
  * compiles cleanly under both MinGW (GUI + CLI Windows) and Linux GCC
@@ -41,42 +54,142 @@
 #define EPH_ATOMIC_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
 #define EPH_ATOMIC_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
 
+/* One spare buffer beyond the history depth, so the writer always has a
+ * buffer the published index does not reference. */
+#define EPH_N_BUFS  (SV_EPH_HISTORY + 1)
+
+/* Packed slot index, published with a single 64-bit release-store:
+ *   bits 0..3   number of versions n (0..SV_EPH_HISTORY)
+ *   bits 4..7   buffer of the most recently stored version
+ *   bits 8..    n 4-bit buffer numbers, sorted by ascending toe */
+#define EPH_IDX_COUNT(o)      ((int)((o) & 0xFu))
+#define EPH_IDX_LATEST(o)     ((int)(((o) >> 4) & 0xFu))
+#define EPH_IDX_BUF(o, i)     ((int)(((o) >> (8 + 4 * (i))) & 0xFu))
+
+#if EPH_N_BUFS > 16 || 8 + 4 * SV_EPH_HISTORY > 64
+#error "SV_EPH_HISTORY too large for the packed 64-bit slot index"
+#endif
+
 typedef struct {
-    SvEphemeris  bufs[2];     /**< double buffer; writer fills the inactive one */
-    volatile int active;      /**< 0 or 1: index of the buffer readers should use */
+    SvEphemeris       bufs[EPH_N_BUFS]; /**< versions; writer fills an unreferenced one */
+    volatile uint64_t index;            /**< packed index, see EPH_IDX_* */
+    int               next_free;        /**< writer-only reuse cursor */
 } EphSlot;
 
 /* Zero-initialised at program start (BSS) so sv_eph_init() is purely
  * defensive between repeated stream sessions. */
-static EphSlot g_slots[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+static EphSlot g_local[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+
+/* The table in use: g_local, or one set by sv_eph_set_table(). */
+static EphSlot (*g_slots)[SV_EPH_MAX_SATS_PER_GNSS] = g_local;
+static int     g_read_only;             /* stores are dropped */
+
+/* Signed difference a - b for times of the given GNSS, wrapped into
+ * (-half, +half] of a week (GLONASS: of a day, toe is seconds-of-day). */
+static double eph_wrap_dt(int gnss_id, double a, double b)
+{
+    double wrap = (gnss_id == 2) ? 86400.0 : 604800.0;
+    double dt = a - b;
+    if (dt >  0.5 * wrap) dt -= wrap;
+    if (dt < -0.5 * wrap) dt += wrap;
+    return dt;
+}
 
 void sv_eph_init(void)
 {
-    memset(g_slots, 0, sizeof(g_slots));
+    if (EPH_ATOMIC_LOAD(&g_read_only)) return;
+    memset(g_slots, 0, sizeof(g_local));
+}
+
+size_t sv_eph_table_size(void)
+{
+    return sizeof(g_local);
+}
+
+void sv_eph_set_table(void *table, bool writable)
+{
+    g_slots = table ? (EphSlot (*)[SV_EPH_MAX_SATS_PER_GNSS])table : g_local;
+    EPH_ATOMIC_STORE(&g_read_only, writable ? 0 : 1);
 }
 
 void sv_eph_store(const SvEphemeris *eph)
 {
-    if (!eph) return;
+    if (!eph || EPH_ATOMIC_LOAD(&g_read_only)) return;
     if (eph->gnss_id < 0 || eph->gnss_id >= SV_EPH_MAX_GNSS) return;
     if (eph->prn < 1 || eph->prn > SV_EPH_MAX_SATS_PER_GNSS) return;
 
     EphSlot *slot = &g_slots[eph->gnss_id][eph->prn - 1];
 
-    /* Find the inactive buffer.  Acquire-load is overkill for the writer
-     * (we just need the value); use it anyway for symmetry with the
-     * reader path. */
-    int cur  = EPH_ATOMIC_LOAD(&slot->active);
-    int next = 1 - cur;
+    /* Only this writer changes the index, so a plain snapshot is enough;
+     * acquire anyway for symmetry with the reader path. */
+    uint64_t cur = EPH_ATOMIC_LOAD(&slot->index);
+    int n = EPH_IDX_COUNT(cur);
+    int list[SV_EPH_HISTORY + 1];
+    bool used[EPH_N_BUFS] = { false };
+    for (int i = 0; i < n; i++) {
+        list[i] = EPH_IDX_BUF(cur, i);
+        used[list[i]] = true;
+    }
+
+    /* Pick an unreferenced buffer, round-robin so a buffer that just left
+     * the index is reused as late as possible. */
+    int buf = slot->next_free;
+    while (used[buf]) buf = (buf + 1) % EPH_N_BUFS;
+    slot->next_free = (buf + 1) % EPH_N_BUFS;
 
-    /* Write the full struct into the inactive buffer.  Non-atomic --
-     * but readers won't see this until we publish the new index below. */
-    slot->bufs[next] = *eph;
-    slot->bufs[next].valid = true;
+    /* Write the full struct into the free buffer.  Non-atomic -- but
+     * readers won't see this until we publish the new index below. */
+    slot->bufs[buf] = *eph;
+    slot->bufs[buf].valid = true;
 
-    /* Release-store of the active index publishes the new buffer.  All
-     * the writes to bufs[next] above happen-before the swap is visible. */
-    EPH_ATOMIC_STORE(&slot->active, next);
+    /* Same toe: a repeat (or re-upload) of a version we hold; replace it.
+     * Otherwise add it, dropping the oldest version when full. */
+    int k;
+    for (k = 0; k < n; k++)
+        if (fabs(eph_wrap_dt(eph->gnss_id, slot->bufs[list[k]].toe,
+                             eph->toe)) < 0.5)
+            break;
+    if (k < n) {
+        list[k] = buf;
+    } else {
+        list[n++] = buf;
+        if (n > SV_EPH_HISTORY) {
+            int oldest = 0;
+            for (int i = 1; i < n - 1; i++)
+                if (eph_wrap_dt(eph->gnss_id, slot->bufs[list[i]].toe,
+                                slot->bufs[list[oldest]].toe) < 0.0)
+                    oldest = i;
+            memmove(&list[oldest], &list[oldest + 1],
+                    (size_t)(n - 1 - oldest) * sizeof(list[0]));
+            n--;
+        }
+    }
+
+    /* Sort by toe relative to the new version, which readers use as the
+     * reference of the wrap.  At most SV_EPH_HISTORY entries, nearly
+     * sorted already: insertion sort. */
+    double key[SV_EPH_HISTORY];
+    for (int i = 0; i < n; i++)
+        key[i] = eph_wrap_dt(eph->gnss_id, slot->bufs[list[i]].toe, eph->toe);
+    for (int i = 1; i < n; i++) {
+        int    b = list[i];
+        double v = key[i];
+        int j = i;
+        for (; j > 0 && key[j - 1] > v; j--) {
+            list[j] = list[j - 1];
+            key[j]  = key[j - 1];
+        }
+        list[j] = b;
+        key[j]  = v;
+    }
+
+    uint64_t next = (uint64_t)n | ((uint64_t)buf << 4);
+    for (int i = 0; i < n; i++)
+        next |= (uint64_t)list[i] << (8 + 4 * i);
+
+    /* Release-store of the index publishes the new buffer.  All the
+     * writes to bufs[buf] above happen-before the index is visible. */
+    EPH_ATOMIC_STORE(&slot->index, next);
 }
 
 const SvEphemeris* sv_eph_get(int gnss_id, int prn)
@@ -86,11 +199,58 @@ const SvEphemeris* sv_eph_get(int gnss_id, int prn)
 
     EphSlot *slot = &g_slots[gnss_id][prn - 1];
 
-    /* Acquire-load: any read of bufs[idx] below sees the writer's
-     * release-store from before its swap, i.e. a fully-written buffer. */
-    int idx = EPH_ATOMIC_LOAD(&slot->active);
-    const SvEphemeris *e = &slot->bufs[idx];
-    return e->valid ? e : NULL;
+    /* Acquire-load: any read of the buffers named by the index sees the
+     * writer's stores from before it published, i.e. fully-written data. */
+    uint64_t idx = EPH_ATOMIC_LOAD(&slot->index);
+    if (EPH_IDX_COUNT(idx) == 0) return NULL;
+    return &slot->bufs[EPH_IDX_LATEST(idx)];
+}
+
+int sv_eph_get_all(int gnss_id, int prn, const SvEphemeris *out[SV_EPH_HISTORY])
+{
+    if (gnss_id < 0 || gnss_id >= SV_EPH_MAX_GNSS) return 0;
+    if (prn < 1 || prn > SV_EPH_MAX_SATS_PER_GNSS) return 0;
+
+    EphSlot *slot = &g_slots[gnss_id][prn - 1];
+    uint64_t idx = EPH_ATOMIC_LOAD(&slot->index);
+    int n = EPH_IDX_COUNT(idx);
+    for (int i = 0; i < n; i++) out[i] = &slot->bufs[EPH_IDX_BUF(idx, i)];
+    return n;
+}
+
+const SvEphemeris* sv_eph_get_at(int gnss_id, int prn, int week, double tow_s)
+{
+    if (gnss_id < 0 || gnss_id >= SV_EPH_MAX_GNSS) return NULL;
+    if (prn < 1 || prn > SV_EPH_MAX_SATS_PER_GNSS) return NULL;
+
+    EphSlot *slot = &g_slots[gnss_id][prn - 1];
+    uint64_t idx = EPH_ATOMIC_LOAD(&slot->index);
+    int n = EPH_IDX_COUNT(idx);
+    if (n == 0) return NULL;
+
+    /* Keys are toe relative to the latest version, as sorted by the writer. */
+    double ref    = slot->bufs[EPH_IDX_LATEST(idx)].toe;
+    double target = eph_wrap_dt(gnss_id, tow_s, ref);
+
+    /* First version with toe >= target (binary search)... */
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        double k = eph_wrap_dt(gnss_id, slot->bufs[EPH_IDX_BUF(idx, mid)].toe, ref);
+        if (k < target) lo = mid + 1;
+        else            hi = mid;
+    }
+
+    /* ...or the one before it, whichever toe is nearer. */
+    int best = (lo < n) ? lo : n - 1;
+    if (lo > 0 && lo < n) {
+        double after  = eph_wrap_dt(gnss_id, slot->bufs[EPH_IDX_BUF(idx, lo)].toe, ref);
+        double before = eph_wrap_dt(gnss_id, slot->bufs[EPH_IDX_BUF(idx, lo - 1)].toe, ref);
+        if (target - before <= after - target) best = lo - 1;
+    }
+
+    const SvEphemeris *e = &slot->bufs[EPH_IDX_BUF(idx, best)];
+    return sv_eph_is_valid_at(e, week, tow_s) ? e : NULL;
 }
 
 bool sv_eph_is_valid_at(const SvEphemeris *eph, int week, double tow_s)
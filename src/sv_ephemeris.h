@@ -6,6 +6,15 @@
  * decoders as ephemerides arrive on the NTRIP stream, and consumed by
  * sv_orbit.c when computing satellite az/el for the Sky Plot window.
  *
+ * Each slot keeps the SV_EPH_HISTORY most recent versions (distinct toe),
+ * so a replay, or anything else that looks back in time, can pick the
+ * version that was current at the epoch it propagates to with
+ * sv_eph_get_at() instead of the latest upload.
+ *
+ * The slot table normally lives in this process.  sv_eph_set_table() can
+ * put it elsewhere -- a named shared-memory segment (eph_shm.h) that one
+ * process feeds and others only read, with the same lock-free protocol.
+ *
  * Threading: the cache is intended to be used from a single thread
  * (the worker thread that drives the parser).  The UI thread's
  * re-decode-for-display path also writes to it, but races are benign —
@@ -20,12 +29,21 @@
 #ifndef SV_EPHEMERIS_H
 #define SV_EPHEMERIS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 #define SV_EPH_MAX_GNSS          8
 #define SV_EPH_MAX_SATS_PER_GNSS 64
 
+/** Versions kept per SV: about 24 h of GPS uploads, 2 h of Galileo ones
+ *  (NTRIP_SMALL_FOOTPRINT: the current one and the few before it). */
+#ifdef NTRIP_SMALL_FOOTPRINT
+#define SV_EPH_HISTORY           4
+#else
+#define SV_EPH_HISTORY           12
+#endif
+
 /**
  * @brief Keplerian broadcast ephemeris, scaled to SI units.
  *
@@ -71,15 +89,54 @@ typedef struct {
 /** @brief Zero the entire cache.  Optional — static storage is already zeroed. */
 void sv_eph_init(void);
 
-/** @brief Insert or replace the slot for (eph->gnss_id, eph->prn). */
+/** @brief Bytes of the slot table, for placing it in shared memory. */
+size_t sv_eph_table_size(void);
+
+/**
+ * @brief Use @p table instead of the process's own slot table.
+ *
+ * @p table is sv_eph_table_size() bytes, 8-byte aligned, either zeroed or
+ * filled by a process of the same build; NULL returns to the built-in
+ * table.  With @p writable false, sv_eph_store() (and sv_eph_init()) do
+ * nothing, so a process that reads a table fed by another one never
+ * writes to it.  Switch before other threads use the cache; only the
+ * writable flag may change later (a reader taking over the feed).
+ */
+void sv_eph_set_table(void *table, bool writable);
+
+/**
+ * @brief Add a version for (eph->gnss_id, eph->prn).
+ *
+ * A version with the same toe as one already held replaces it; otherwise
+ * the oldest version is dropped once SV_EPH_HISTORY are held.
+ */
 void sv_eph_store(const SvEphemeris *eph);
 
 /**
- * @brief Look up the cached ephemeris for (gnss_id, prn).
- * @return Pointer to the cached slot, or NULL if no ephemeris stored.
+ * @brief Look up the most recently stored ephemeris for (gnss_id, prn).
+ * @return Pointer to the cached version, or NULL if no ephemeris stored.
  */
 const SvEphemeris* sv_eph_get(int gnss_id, int prn);
 
+/**
+ * @brief Every version held for (gnss_id, prn), by ascending toe.
+ *
+ * @param out  [out] Receives up to SV_EPH_HISTORY pointers into the cache,
+ *             with the same lifetime as those of sv_eph_get().
+ * @return Versions written to @p out; 0 if none (or out of range).
+ */
+int sv_eph_get_all(int gnss_id, int prn, const SvEphemeris *out[SV_EPH_HISTORY]);
+
+/**
+ * @brief Look up the best-fitting ephemeris for (gnss_id, prn) at a time.
+ *
+ * Binary search over the held versions for the toe nearest @p tow_s
+ * (GLONASS: Moscow seconds-of-day), wrapped like sv_eph_is_valid_at().
+ *
+ * @return The nearest version if it passes sv_eph_is_valid_at(), else NULL.
+ */
+const SvEphemeris* sv_eph_get_at(int gnss_id, int prn, int week, double tow_s);
+
 /**
  * @brief Test whether @p eph is usable for propagation at @p week / @p tow_s.
  *
@@ -10,6 +10,7 @@
 #include "sv_orbit.h"
 
 #include <math.h>
+#include <string.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -105,6 +106,31 @@ static void glo_rk4_step(double y[6], const double accel_ls[3], double h)
         y[i] += (h / 6.0) * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
 }
 
+/* Integrator checkpoint per GLONASS slot.  Queries from the sky update
+ * move forward in time, so instead of integrating from tb on every call
+ * we resume from the state reached last time.  The checkpoint is only
+ * ever taken on a whole-step boundary (t is a multiple of the 60 s step)
+ * and the trailing partial step is run on a copy, so a resumed result is
+ * bit-identical to a full integration from tb. */
+typedef struct {
+    bool   valid;
+    double tb_sod;                    /* ephemeris the state belongs to */
+    double pos[3], vel[3], acc[3];
+    double t;                         /* offset from tb of s[], seconds */
+    double s[6];                      /* inertial state at tb + t */
+} GloIntegState;
+
+static __thread GloIntegState g_glo_state[SV_EPH_MAX_SATS_PER_GNSS];
+
+static bool glo_state_matches(const GloIntegState *st, const SvEphemeris *eph)
+{
+    return st->valid &&
+           st->tb_sod == eph->glo_tb_sod &&
+           memcmp(st->pos, eph->glo_pos, sizeof(st->pos)) == 0 &&
+           memcmp(st->vel, eph->glo_vel, sizeof(st->vel)) == 0 &&
+           memcmp(st->acc, eph->glo_acc, sizeof(st->acc)) == 0;
+}
+
 bool glonass_to_ecef(const SvEphemeris *eph, double glo_tod_s,
                      double *x, double *y, double *z)
 {
@@ -138,22 +164,46 @@ bool glonass_to_ecef(const SvEphemeris *eph, double glo_tod_s,
      * propagating eph_A and eph_B from the same orbit gives the same
      * result and the trails are smooth. */
     double s[6];
-    s[0] = eph->glo_pos[0];
-    s[1] = eph->glo_pos[1];
-    s[2] = eph->glo_pos[2];
-    s[3] = eph->glo_vel[0] - GLO_OMEGA_E * eph->glo_pos[1];
-    s[4] = eph->glo_vel[1] + GLO_OMEGA_E * eph->glo_pos[0];
-    s[5] = eph->glo_vel[2];
-
-    /* RK4 integration with adaptive last step.  Step direction follows
-     * sign(dt). */
     double step = (dt >= 0.0) ? 60.0 : -60.0;
-    double t_remain = dt;
-    while (fabs(t_remain) > 1e-9) {
-        double h = (fabs(t_remain) < fabs(step)) ? t_remain : step;
-        glo_rk4_step(s, eph->glo_acc, h);
-        t_remain -= h;
+    double t_done = 0.0;
+
+    /* Resume from the checkpoint when it lies between tb and the target
+     * (same ephemeris, same direction, not past it); otherwise start
+     * over at tb. */
+    GloIntegState *ck = (eph->prn >= 1 && eph->prn <= SV_EPH_MAX_SATS_PER_GNSS)
+                      ? &g_glo_state[eph->prn - 1] : NULL;
+    if (ck && glo_state_matches(ck, eph) &&
+        ck->t * step >= 0.0 && fabs(ck->t) <= fabs(dt)) {
+        memcpy(s, ck->s, sizeof(s));
+        t_done = ck->t;
+    } else {
+        s[0] = eph->glo_pos[0];
+        s[1] = eph->glo_pos[1];
+        s[2] = eph->glo_pos[2];
+        s[3] = eph->glo_vel[0] - GLO_OMEGA_E * eph->glo_pos[1];
+        s[4] = eph->glo_vel[1] + GLO_OMEGA_E * eph->glo_pos[0];
+        s[5] = eph->glo_vel[2];
+    }
+
+    /* RK4 integration: whole steps up to the last step boundary before
+     * the target (checkpointed), then one partial step.  Step direction
+     * follows sign(dt). */
+    while (fabs(dt - t_done) >= fabs(step)) {
+        glo_rk4_step(s, eph->glo_acc, step);
+        t_done += step;
     }
+    if (ck) {
+        ck->valid  = true;
+        ck->tb_sod = eph->glo_tb_sod;
+        memcpy(ck->pos, eph->glo_pos, sizeof(ck->pos));
+        memcpy(ck->vel, eph->glo_vel, sizeof(ck->vel));
+        memcpy(ck->acc, eph->glo_acc, sizeof(ck->acc));
+        ck->t = t_done;
+        memcpy(ck->s, s, sizeof(s));
+    }
+    double t_remain = dt - t_done;
+    if (fabs(t_remain) > 1e-9)
+        glo_rk4_step(s, eph->glo_acc, t_remain);
 
     /* Rotate the inertial result by -omega_e * dt around Z to land in the
      * Earth-fixed frame at time t.  (The state vector at tb is defined in
@@ -258,3 +308,482 @@ bool sv_to_ecef(const SvEphemeris *eph,
     }
     return kepler_to_ecef(eph, week, tow_s, x, y, z);
 }
+
+/* ── Batched Keplerian propagation ────────────────────────────────────────
+ *
+ * Same maths as kepler_to_ecef(), but over a chunk of SVs held in
+ * structure-of-arrays form.  Every loop below is a straight pass over
+ * contiguous doubles with no data-dependent control flow -- the Kepler
+ * solve runs a fixed number of Newton iterations instead of breaking on
+ * convergence -- so the compiler can vectorise it (SSE2/AVX2/NEON,
+ * whichever the target enables; sin/cos vectorise where the libm has
+ * vector variants) and it still runs as plain scalar code elsewhere.
+ *
+ * Trig calls dominate the cost, so the kernel also saves a few: Newton
+ * starts from E = M + e*sin(M), where three iterations take any
+ * e <= 0.1 to full double precision (more eccentric orbits go through
+ * the scalar path), and the true anomaly / double-angle terms are formed
+ * algebraically from sin/cos E and sin/cos omega instead of atan2() and
+ * sin/cos(2*phi), and u_k = phi + du by the angle-sum identity.
+ *
+ * On x86 with AVX2 and FMA (checked with __builtin_cpu_supports(), as
+ * the unpacker in rtcm_unpack.c) kepler_batch_avx2() runs the same steps
+ * four SVs at a time.  Compilers only vectorise the loops above where
+ * the libm has vector sin/cos (glibc's libmvec, not MinGW), so the
+ * kernel brings its own: sincos4(). */
+#define KEPLER_BATCH_CHUNK   64
+#define KEPLER_BATCH_ITERS   3
+#define KEPLER_BATCH_MAX_E   0.1
+
+typedef struct {
+    int    n;
+    int    out[KEPLER_BATCH_CHUNK];   /* index into the caller's arrays */
+    double tk[KEPLER_BATCH_CHUNK], a[KEPLER_BATCH_CHUNK];
+    double mk[KEPLER_BATCH_CHUNK], e[KEPLER_BATCH_CHUNK];
+    double omega[KEPLER_BATCH_CHUNK];
+    double cuc[KEPLER_BATCH_CHUNK], cus[KEPLER_BATCH_CHUNK];
+    double crc[KEPLER_BATCH_CHUNK], crs[KEPLER_BATCH_CHUNK];
+    double cic[KEPLER_BATCH_CHUNK], cis[KEPLER_BATCH_CHUNK];
+    double i0[KEPLER_BATCH_CHUNK], idot[KEPLER_BATCH_CHUNK];
+    double omk0[KEPLER_BATCH_CHUNK], omk_rate[KEPLER_BATCH_CHUNK];
+} KeplerBatch;
+
+static void kepler_batch_add(KeplerBatch *b, const SvEphemeris *eph,
+                             double tow_s, int out)
+{
+    const double mu      = get_mu(eph->gnss_id);
+    const double omega_e = get_omega_e(eph->gnss_id);
+    const double a       = eph->sqrt_a * eph->sqrt_a;
+    const double n       = sqrt(mu / (a * a * a)) + eph->delta_n;
+
+    double tk = tow_s - eph->toe;
+    if (tk >  302400.0) tk -= 604800.0;
+    if (tk < -302400.0) tk += 604800.0;
+
+    int i = b->n++;
+    b->out[i]      = out;
+    b->tk[i]       = tk;
+    b->a[i]        = a;
+    b->mk[i]       = eph->m0 + n * tk;
+    b->e[i]        = eph->e;
+    b->omega[i]    = eph->omega;
+    b->cuc[i]      = eph->cuc;
+    b->cus[i]      = eph->cus;
+    b->crc[i]      = eph->crc;
+    b->crs[i]      = eph->crs;
+    b->cic[i]      = eph->cic;
+    b->cis[i]      = eph->cis;
+    b->i0[i]       = eph->i0;
+    b->idot[i]     = eph->idot;
+    b->omk0[i]     = eph->omega0 - omega_e * eph->toe;
+    b->omk_rate[i] = eph->omega_dot - omega_e;
+}
+
+#if !defined(NTRIP_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define KEPLER_BATCH_AVX2 1
+#include <immintrin.h>
+
+/* sin and cos of four angles (|x| < 2^30), to about 1 ulp: Cephes'
+ * reduction to an octant with pi/4 split in three parts, and its
+ * minimax polynomials on [-pi/4, pi/4]. */
+__attribute__((target("avx2,fma")))
+static inline void sincos4(__m256d x, __m256d *s, __m256d *c)
+{
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m256d ax = _mm256_andnot_pd(sign_bit, x);
+
+    /* Octant j, even: an odd one goes to the next, z = |x| - j*pi/4 */
+    __m128i j = _mm256_cvttpd_epi32(_mm256_mul_pd(ax, _mm256_set1_pd(4.0 / M_PI)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    const __m256d y = _mm256_cvtepi32_pd(j);
+    __m256d z = _mm256_fnmadd_pd(y, _mm256_set1_pd(7.85398125648498535156E-1), ax);
+    z = _mm256_fnmadd_pd(y, _mm256_set1_pd(3.77489470793079817668E-8), z);
+    z = _mm256_fnmadd_pd(y, _mm256_set1_pd(2.69515142907905952645E-15), z);
+    const __m256d zz = _mm256_mul_pd(z, z);
+
+    __m256d ps = _mm256_set1_pd(1.58962301576546568060E-10);
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-2.50507477628578072866E-8));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(2.75573136213857245213E-6));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-1.98412698295895385996E-4));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(8.33333333332211858878E-3));
+    ps = _mm256_fmadd_pd(ps, zz, _mm256_set1_pd(-1.66666666666666307295E-1));
+    ps = _mm256_fmadd_pd(_mm256_mul_pd(z, zz), ps, z);
+
+    __m256d pc = _mm256_set1_pd(-1.13585365213876817300E-11);
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(2.08757008419747316778E-9));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(-2.75573141792967388112E-7));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(2.48015872888517045348E-5));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(-1.38888888888730564116E-3));
+    pc = _mm256_fmadd_pd(pc, zz, _mm256_set1_pd(4.16666666666665929218E-2));
+    pc = _mm256_fmadd_pd(_mm256_mul_pd(zz, zz), pc,
+                         _mm256_fnmadd_pd(_mm256_set1_pd(0.5), zz, _mm256_set1_pd(1.0)));
+
+    /* Octants 2 and 6 swap the polynomials; sin is negative in 4 and 6
+     * (and for x < 0), cos in 2 and 4. */
+    const __m256i j64  = _mm256_cvtepi32_epi64(j);
+    const __m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(
+        _mm256_and_si256(j64, _mm256_set1_epi64x(2)), _mm256_set1_epi64x(2)));
+    const __m256d sneg = _mm256_castsi256_pd(_mm256_slli_epi64(
+        _mm256_and_si256(j64, _mm256_set1_epi64x(4)), 61));
+    const __m256d cneg = _mm256_castsi256_pd(_mm256_slli_epi64(
+        _mm256_and_si256(_mm256_add_epi64(j64, _mm256_set1_epi64x(2)),
+                         _mm256_set1_epi64x(4)), 61));
+    __m256d sv = _mm256_blendv_pd(ps, pc, swap);
+    __m256d cv = _mm256_blendv_pd(pc, ps, swap);
+    sv = _mm256_xor_pd(sv, _mm256_xor_pd(sneg, _mm256_and_pd(x, sign_bit)));
+    *s = sv;
+    *c = _mm256_xor_pd(cv, cneg);
+}
+
+/* kepler_batch_run() for the first multiple of four entries, four at a
+ * time; returns how many it did. */
+__attribute__((target("avx2,fma")))
+static int kepler_batch_avx2(const KeplerBatch *b, double *xo, double *yo, double *zo)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    int i = 0;
+    for (; i + 4 <= b->n; i += 4) {
+        const __m256d e  = _mm256_loadu_pd(&b->e[i]);
+        const __m256d mk = _mm256_loadu_pd(&b->mk[i]);
+        const __m256d tk = _mm256_loadu_pd(&b->tk[i]);
+        __m256d sE, cE;
+
+        sincos4(mk, &sE, &cE);
+        __m256d ek = _mm256_fmadd_pd(e, sE, mk);
+        for (int it = 0; it < KEPLER_BATCH_ITERS; it++) {
+            sincos4(ek, &sE, &cE);
+            __m256d f  = _mm256_sub_pd(_mm256_fnmadd_pd(e, sE, ek), mk);
+            __m256d fp = _mm256_fnmadd_pd(e, cE, one);
+            ek = _mm256_sub_pd(ek, _mm256_div_pd(f, fp));
+        }
+        sincos4(ek, &sE, &cE);
+
+        __m256d den   = _mm256_fnmadd_pd(e, cE, one);
+        __m256d sinNu = _mm256_div_pd(_mm256_mul_pd(_mm256_sqrt_pd(_mm256_fnmadd_pd(e, e, one)), sE), den);
+        __m256d cosNu = _mm256_div_pd(_mm256_sub_pd(cE, e), den);
+        __m256d sinW, cosW;
+        sincos4(_mm256_loadu_pd(&b->omega[i]), &sinW, &cosW);
+        __m256d sinPhi = _mm256_fmadd_pd(sinNu, cosW, _mm256_mul_pd(cosNu, sinW));
+        __m256d cosPhi = _mm256_fnmadd_pd(sinNu, sinW, _mm256_mul_pd(cosNu, cosW));
+
+        __m256d s2phi = _mm256_mul_pd(two, _mm256_mul_pd(sinPhi, cosPhi));
+        __m256d c2phi = _mm256_fnmadd_pd(sinPhi, sinPhi, _mm256_mul_pd(cosPhi, cosPhi));
+        __m256d du = _mm256_fmadd_pd(_mm256_loadu_pd(&b->cus[i]), s2phi,
+                                     _mm256_mul_pd(_mm256_loadu_pd(&b->cuc[i]), c2phi));
+        __m256d sinDu, cosDu;
+        sincos4(du, &sinDu, &cosDu);
+        __m256d rk = _mm256_mul_pd(_mm256_loadu_pd(&b->a[i]), den);
+        rk = _mm256_fmadd_pd(_mm256_loadu_pd(&b->crs[i]), s2phi, rk);
+        rk = _mm256_fmadd_pd(_mm256_loadu_pd(&b->crc[i]), c2phi, rk);
+        __m256d ik = _mm256_fmadd_pd(_mm256_loadu_pd(&b->idot[i]), tk, _mm256_loadu_pd(&b->i0[i]));
+        ik = _mm256_fmadd_pd(_mm256_loadu_pd(&b->cis[i]), s2phi, ik);
+        ik = _mm256_fmadd_pd(_mm256_loadu_pd(&b->cic[i]), c2phi, ik);
+
+        __m256d xp = _mm256_mul_pd(rk, _mm256_fnmadd_pd(sinPhi, sinDu, _mm256_mul_pd(cosPhi, cosDu)));
+        __m256d yp = _mm256_mul_pd(rk, _mm256_fmadd_pd(sinPhi, cosDu, _mm256_mul_pd(cosPhi, sinDu)));
+        __m256d omk = _mm256_fmadd_pd(_mm256_loadu_pd(&b->omk_rate[i]), tk,
+                                      _mm256_loadu_pd(&b->omk0[i]));
+        __m256d sinO, cosO, sinI, cosI;
+        sincos4(omk, &sinO, &cosO);
+        sincos4(ik, &sinI, &cosI);
+        __m256d ycI = _mm256_mul_pd(yp, cosI);
+
+        _mm256_storeu_pd(&xo[i], _mm256_fnmadd_pd(ycI, sinO, _mm256_mul_pd(xp, cosO)));
+        _mm256_storeu_pd(&yo[i], _mm256_fmadd_pd(ycI, cosO, _mm256_mul_pd(xp, sinO)));
+        _mm256_storeu_pd(&zo[i], _mm256_mul_pd(yp, sinI));
+    }
+    return i;
+}
+#endif
+
+static void kepler_batch_run(KeplerBatch *b, double *x, double *y, double *z)
+{
+    const int n = b->n;
+    double ek[KEPLER_BATCH_CHUNK];
+    double xo[KEPLER_BATCH_CHUNK], yo[KEPLER_BATCH_CHUNK], zo[KEPLER_BATCH_CHUNK];
+    int i0 = 0;
+
+#ifdef KEPLER_BATCH_AVX2
+    if (n >= 4 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        i0 = kepler_batch_avx2(b, xo, yo, zo);
+#endif
+
+    for (int i = i0; i < n; i++) ek[i] = b->mk[i] + b->e[i] * sin(b->mk[i]);
+    for (int it = 0; it < KEPLER_BATCH_ITERS; it++) {
+        for (int i = i0; i < n; i++) {
+            double f  = ek[i] - b->e[i] * sin(ek[i]) - b->mk[i];
+            double fp = 1.0 - b->e[i] * cos(ek[i]);
+            ek[i] -= f / fp;
+        }
+    }
+
+    for (int i = i0; i < n; i++) {
+        double e     = b->e[i];
+        double sinEk = sin(ek[i]), cosEk = cos(ek[i]);
+
+        /* True anomaly nu and argument of latitude phi = nu + omega,
+         * as sine/cosine pairs. */
+        double den   = 1.0 - e * cosEk;
+        double sinNu = sqrt(1.0 - e * e) * sinEk / den;
+        double cosNu = (cosEk - e) / den;
+        double sinW  = sin(b->omega[i]), cosW = cos(b->omega[i]);
+        double sinPhi = sinNu * cosW + cosNu * sinW;
+        double cosPhi = cosNu * cosW - sinNu * sinW;
+
+        double s2phi = 2.0 * sinPhi * cosPhi;
+        double c2phi = cosPhi * cosPhi - sinPhi * sinPhi;
+        double du = b->cus[i] * s2phi + b->cuc[i] * c2phi;
+        double sinDu = sin(du), cosDu = cos(du);
+        double rk = b->a[i] * (1.0 - e * cosEk)
+                  + b->crs[i] * s2phi + b->crc[i] * c2phi;
+        double ik = b->i0[i] + b->cis[i] * s2phi + b->cic[i] * c2phi
+                  + b->idot[i] * b->tk[i];
+
+        /* u_k = phi + du */
+        double xp  = rk * (cosPhi * cosDu - sinPhi * sinDu);
+        double yp  = rk * (sinPhi * cosDu + cosPhi * sinDu);
+        double omk = b->omk0[i] + b->omk_rate[i] * b->tk[i];
+        double sin_omk = sin(omk), cos_omk = cos(omk);
+        double sin_ik  = sin(ik),  cos_ik  = cos(ik);
+
+        xo[i] = xp * cos_omk - yp * cos_ik * sin_omk;
+        yo[i] = xp * sin_omk + yp * cos_ik * cos_omk;
+        zo[i] = yp * sin_ik;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int o = b->out[i];
+        x[o] = xo[i];
+        y[o] = yo[i];
+        z[o] = zo[i];
+    }
+    b->n = 0;
+}
+
+/* Batch core with one propagation time per entry. */
+static int sv_to_ecef_batch_at(const SvEphemeris *const *ephs, const double *tow_s,
+                               int n, int week,
+                               double *x, double *y, double *z, bool *ok)
+{
+    KeplerBatch b;
+    int n_ok = 0;
+
+    b.n = 0;
+    for (int i = 0; i < n; i++) {
+        const SvEphemeris *eph = ephs[i];
+        ok[i] = false;
+        if (!eph || !eph->valid) continue;
+
+        if (eph->gnss_id == 2 || eph->sqrt_a <= 0.0 ||
+            eph->e > KEPLER_BATCH_MAX_E) {
+            ok[i] = sv_to_ecef(eph, week, tow_s[i], &x[i], &y[i], &z[i]);
+        } else {
+            kepler_batch_add(&b, eph, tow_s[i], i);
+            if (b.n == KEPLER_BATCH_CHUNK) kepler_batch_run(&b, x, y, z);
+            ok[i] = true;
+        }
+        if (ok[i]) n_ok++;
+    }
+    if (b.n > 0) kepler_batch_run(&b, x, y, z);
+    return n_ok;
+}
+
+int sv_to_ecef_batch(const SvEphemeris *const *ephs, int n,
+                     int week, double tow_s,
+                     double *x, double *y, double *z, bool *ok)
+{
+    double t[KEPLER_BATCH_CHUNK];
+    int n_ok = 0;
+
+    for (int i = 0; i < KEPLER_BATCH_CHUNK; i++) t[i] = tow_s;
+    for (int base = 0; base < n; base += KEPLER_BATCH_CHUNK) {
+        int m = n - base < KEPLER_BATCH_CHUNK ? n - base : KEPLER_BATCH_CHUNK;
+        n_ok += sv_to_ecef_batch_at(ephs + base, t, m, week,
+                                    x + base, y + base, z + base, ok + base);
+    }
+    return n_ok;
+}
+
+/* ── Orbit cache ──────────────────────────────────────────────────────────
+ *
+ * Node j sits at time j * SV_ORBIT_NODE_STEP_S on the caller's time scale
+ * (GPS ToW, or Moscow ToD for GLONASS) and is stored in pos[j & 3], so
+ * moving the four-node window forward by one step overwrites only the
+ * oldest node.  Node times may fall just outside [0, week) or [0, day);
+ * both propagators wrap their time offset from toe / tb, so that is
+ * harmless -- a query after the rollover simply starts a new window. */
+#define ORBIT_NODES 4
+
+typedef struct {
+    bool   valid;
+    int    iode;               /* ephemeris the nodes were computed from */
+    double toe;
+    double glo_tb_sod;
+    long   node[ORBIT_NODES];  /* node index held in pos[i] */
+    bool   have[ORBIT_NODES];
+    double pos[ORBIT_NODES][3];
+} OrbitCacheSlot;
+
+static __thread OrbitCacheSlot g_orbit_cache[SV_EPH_MAX_GNSS][SV_EPH_MAX_SATS_PER_GNSS];
+
+/* Cache slot for @p eph, emptied first if it holds another ephemeris;
+ * NULL when (gnss_id, prn) is out of range. */
+static OrbitCacheSlot *orbit_cache_slot(const SvEphemeris *eph)
+{
+    if (eph->gnss_id < 0 || eph->gnss_id >= SV_EPH_MAX_GNSS ||
+        eph->prn < 1 || eph->prn > SV_EPH_MAX_SATS_PER_GNSS)
+        return NULL;
+
+    OrbitCacheSlot *c = &g_orbit_cache[eph->gnss_id][eph->prn - 1];
+    if (!c->valid || c->iode != eph->iode_iodnav ||
+        c->toe != eph->toe || c->glo_tb_sod != eph->glo_tb_sod) {
+        memset(c, 0, sizeof(*c));
+        c->valid      = true;
+        c->iode       = eph->iode_iodnav;
+        c->toe        = eph->toe;
+        c->glo_tb_sod = eph->glo_tb_sod;
+    }
+    return c;
+}
+
+/* Ring index of node @p j. */
+static int orbit_node_slot(long j)
+{
+    return (int)(((j % ORBIT_NODES) + ORBIT_NODES) % ORBIT_NODES);
+}
+
+/* Window: nodes k-1 .. k+2 with tow_s in [k, k+1) steps. */
+static long orbit_window(double tow_s)
+{
+    return (long)floor(tow_s / SV_ORBIT_NODE_STEP_S);
+}
+
+/* Cubic Lagrange interpolation through the (complete) window at k. */
+static void orbit_interp(const OrbitCacheSlot *c, long k, double tow_s,
+                         double *x, double *y, double *z)
+{
+    const double h = SV_ORBIT_NODE_STEP_S;
+    const double *p[ORBIT_NODES];
+    for (int i = 0; i < ORBIT_NODES; i++)
+        p[i] = c->pos[orbit_node_slot(k - 1 + i)];
+
+    /* Basis on equally spaced nodes, u in [1, 2). */
+    double u  = (tow_s - (double)(k - 1) * h) / h;
+    double l0 = -(u - 1.0) * (u - 2.0) * (u - 3.0) / 6.0;
+    double l1 =  u * (u - 2.0) * (u - 3.0) / 2.0;
+    double l2 = -u * (u - 1.0) * (u - 3.0) / 2.0;
+    double l3 =  u * (u - 1.0) * (u - 2.0) / 6.0;
+
+    if (x) *x = l0 * p[0][0] + l1 * p[1][0] + l2 * p[2][0] + l3 * p[3][0];
+    if (y) *y = l0 * p[0][1] + l1 * p[1][1] + l2 * p[2][1] + l3 * p[3][1];
+    if (z) *z = l0 * p[0][2] + l1 * p[1][2] + l2 * p[2][2] + l3 * p[3][2];
+}
+
+bool sv_to_ecef_cached(const SvEphemeris *eph,
+                       int week, double tow_s,
+                       double *x, double *y, double *z)
+{
+    if (!eph || !eph->valid) return false;
+    OrbitCacheSlot *c = orbit_cache_slot(eph);
+    if (!c) return sv_to_ecef(eph, week, tow_s, x, y, z);
+
+    long k = orbit_window(tow_s);
+    for (long j = k - 1; j <= k + 2; j++) {
+        int s = orbit_node_slot(j);
+        if (c->have[s] && c->node[s] == j) continue;
+        double *n = c->pos[s];
+        c->have[s] = false;
+        if (!sv_to_ecef(eph, week, (double)j * SV_ORBIT_NODE_STEP_S,
+                        &n[0], &n[1], &n[2]))
+            return false;
+        c->node[s] = j;
+        c->have[s] = true;
+    }
+    orbit_interp(c, k, tow_s, x, y, z);
+    return true;
+}
+
+/* Missing cache nodes queued for one batched propagation. */
+typedef struct {
+    int                n;
+    const SvEphemeris *eph[KEPLER_BATCH_CHUNK];
+    double             t[KEPLER_BATCH_CHUNK];
+    OrbitCacheSlot    *slot[KEPLER_BATCH_CHUNK];
+    long               node[KEPLER_BATCH_CHUNK];
+} OrbitJobs;
+
+static void orbit_jobs_run(OrbitJobs *jb, int week)
+{
+    double x[KEPLER_BATCH_CHUNK], y[KEPLER_BATCH_CHUNK], z[KEPLER_BATCH_CHUNK];
+    bool   ok[KEPLER_BATCH_CHUNK];
+
+    sv_to_ecef_batch_at(jb->eph, jb->t, jb->n, week, x, y, z, ok);
+    for (int q = 0; q < jb->n; q++) {
+        if (!ok[q]) continue;
+        OrbitCacheSlot *c = jb->slot[q];
+        int s = orbit_node_slot(jb->node[q]);
+        c->pos[s][0] = x[q];
+        c->pos[s][1] = y[q];
+        c->pos[s][2] = z[q];
+        c->node[s]   = jb->node[q];
+        c->have[s]   = true;
+    }
+    jb->n = 0;
+}
+
+int sv_to_ecef_cached_batch(const SvEphemeris *const *ephs, int n,
+                            int week, double tow_s,
+                            double *x, double *y, double *z, bool *ok)
+{
+    OrbitJobs jb;
+    long k = orbit_window(tow_s);
+    int  n_ok = 0;
+
+    /* Pass 1: queue every missing node of every SV and propagate them in
+     * batches.  In steady state all SVs cross a node boundary at the same
+     * instant, so a batch is "every SV at the new node time". */
+    jb.n = 0;
+    for (int i = 0; i < n; i++) {
+        const SvEphemeris *eph = ephs[i];
+        if (!eph || !eph->valid) continue;
+        OrbitCacheSlot *c = orbit_cache_slot(eph);
+        if (!c) continue;
+
+        for (long j = k - 1; j <= k + 2; j++) {
+            int s = orbit_node_slot(j);
+            if (c->have[s] && c->node[s] == j) continue;
+            c->have[s]      = false;
+            jb.eph[jb.n]    = eph;
+            jb.t[jb.n]      = (double)j * SV_ORBIT_NODE_STEP_S;
+            jb.slot[jb.n]   = c;
+            jb.node[jb.n]   = j;
+            if (++jb.n == KEPLER_BATCH_CHUNK) orbit_jobs_run(&jb, week);
+        }
+    }
+    if (jb.n > 0) orbit_jobs_run(&jb, week);
+
+    /* Pass 2: interpolate every SV whose window is now complete. */
+    for (int i = 0; i < n; i++) {
+        const SvEphemeris *eph = ephs[i];
+        ok[i] = false;
+        if (!eph || !eph->valid) continue;
+        OrbitCacheSlot *c = orbit_cache_slot(eph);
+        if (!c) {
+            ok[i] = sv_to_ecef(eph, week, tow_s, &x[i], &y[i], &z[i]);
+        } else {
+            bool complete = true;
+            for (long j = k - 1; j <= k + 2; j++) {
+                int s = orbit_node_slot(j);
+                if (!c->have[s] || c->node[s] != j) complete = false;
+            }
+            if (complete) {
+                orbit_interp(c, k, tow_s, &x[i], &y[i], &z[i]);
+                ok[i] = true;
+            }
+        }
+        if (ok[i]) n_ok++;
+    }
+    return n_ok;
+}
@@ -45,6 +45,12 @@ bool kepler_to_ecef(const SvEphemeris *eph,
  * luni-solar acceleration.  Final rotation by Earth's angular speed
  * gives the position in the Earth-fixed frame at @p glo_tod_s.
  *
+ * The integrator state reached by the previous call is kept per PRN, so
+ * a later query on the same ephemeris only integrates the time between
+ * the two calls; going back towards tb, or a new ephemeris, restarts
+ * from tb.  The result is identical either way.  The checkpoints are
+ * per thread (see @ref sv_to_ecef_cached).
+ *
  * @param eph         Ephemeris snapshot (gnss_id must be 2).
  * @param glo_tod_s   Target time in Moscow seconds-of-day (UTC+3, no leap
  *                    seconds applied — same scale as @c eph->glo_tb_sod).
@@ -72,4 +78,67 @@ bool sv_to_ecef(const SvEphemeris *eph,
                 int week, double tow_s,
                 double *x, double *y, double *z);
 
+/**
+ * @brief Propagate many SVs to the same time in one call.
+ *
+ * Equivalent to calling @ref sv_to_ecef for each entry, but the
+ * Keplerian entries are propagated together in structure-of-arrays form,
+ * four at a time with AVX2 / FMA where the CPU has them.  GLONASS entries (and the rare
+ * orbit the batch kernel does not take, e.g. e > 0.1) fall back to the
+ * scalar propagators.
+ *
+ * @param ephs   Ephemerides; NULL or invalid entries yield ok[i] = false.
+ * @param n      Number of entries.
+ * @param week   As @ref sv_to_ecef.
+ * @param tow_s  As @ref sv_to_ecef, shared by every entry (so GLONASS and
+ *               GPS-time systems need separate calls).
+ * @param x,y,z  [out] n ECEF positions in metres.
+ * @param ok     [out] n success flags.
+ * @return Number of entries with ok[i] set.
+ */
+int sv_to_ecef_batch(const SvEphemeris *const *ephs, int n,
+                     int week, double tow_s,
+                     double *x, double *y, double *z, bool *ok);
+
+/** @brief Spacing of the orbit-cache interpolation nodes, seconds. */
+#define SV_ORBIT_NODE_STEP_S 60.0
+
+/**
+ * @brief Cached, interpolated equivalent of @ref sv_to_ecef.
+ *
+ * Keeps, per (gnss_id, prn), the ECEF position at four nodes spaced
+ * @ref SV_ORBIT_NODE_STEP_S apart around @p tow_s and evaluates a cubic
+ * Lagrange polynomial through them.  A query only propagates (Kepler
+ * solve or GLONASS RK4) the nodes it does not have yet -- in steady
+ * state one new node per SV per minute, instead of one full propagation
+ * per SV per MSM frame.  Interpolation error is a few millimetres for
+ * MEO/IGSO/GEO orbits.
+ *
+ * The nodes belong to one broadcast ephemeris, identified by its IODE /
+ * IODnav, toe and (GLONASS) tb.  They are regenerated only when the
+ * ephemeris passed in differs, i.e. after sv_eph_store() installed a new
+ * one; rebroadcasts of the same ephemeris keep the cache.
+ *
+ * The cache is per thread, so several threads may propagate at once (the
+ * live sky update and the time slices of sky_expect_run()); each fills
+ * its own nodes.
+ *
+ * @param eph, week, tow_s, x, y, z  As @ref sv_to_ecef.
+ * @return As @ref sv_to_ecef.
+ */
+bool sv_to_ecef_cached(const SvEphemeris *eph,
+                       int week, double tow_s,
+                       double *x, double *y, double *z);
+
+/**
+ * @brief Batched form of @ref sv_to_ecef_cached.
+ *
+ * Missing interpolation nodes of all @p n SVs are propagated together
+ * with the @ref sv_to_ecef_batch kernel, then every SV is interpolated.
+ * Parameters and return value as @ref sv_to_ecef_batch.
+ */
+int sv_to_ecef_cached_batch(const SvEphemeris *const *ephs, int n,
+                            int week, double tow_s,
+                            double *x, double *y, double *z, bool *ok);
+
 #endif /* SV_ORBIT_H */
@@ -0,0 +1,137 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hashed timer wheel: O(1) timers for many streams on one loop.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "timer_wheel.h"
+
+#include <math.h>
+
+/* Every list is circular with a head node, so unlinking needs no head. */
+static void list_init(TimerWheelTimer *head)
+{
+    head->next = head->prev = head;
+}
+
+static void list_push_back(TimerWheelTimer *head, TimerWheelTimer *t)
+{
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void list_unlink(TimerWheelTimer *t)
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
+
+void timer_wheel_init(TimerWheel *w, double now, double resolution)
+{
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) list_init(&w->slot[i]);
+    w->tick       = 0;
+    w->t0         = now;
+    w->resolution = resolution > 0.0 ? resolution : 0.01;
+    w->pending    = 0;
+    w->fired      = 0;
+}
+
+void timer_init(TimerWheelTimer *t, TimerWheelFn fn, void *arg)
+{
+    t->next = t->prev = NULL;
+    t->due  = 0;
+    t->at   = 0.0;
+    t->fn   = fn;
+    t->arg  = arg;
+}
+
+void timer_wheel_schedule(TimerWheel *w, TimerWheelTimer *t, double at)
+{
+    if (timer_pending(t)) timer_wheel_cancel(w, t);
+
+    /* Round up: a timer fires at the first tick not before its time. */
+    double ticks = ceil((at - w->t0) / w->resolution);
+    uint64_t due = ticks > (double)w->tick ? (uint64_t)ticks : w->tick + 1;
+    t->due = due;
+    t->at  = at;
+    list_push_back(&w->slot[due % TIMER_WHEEL_SLOTS], t);
+    w->pending++;
+}
+
+void timer_wheel_cancel(TimerWheel *w, TimerWheelTimer *t)
+{
+    if (!timer_pending(t)) return;
+    list_unlink(t);
+    w->pending--;
+}
+
+/* Move the timers of @p slot due by tick @p by to @p out. */
+static void slot_collect(TimerWheelTimer *slot, uint64_t by, TimerWheelTimer *out)
+{
+    TimerWheelTimer *t = slot->next;
+    while (t != slot) {
+        TimerWheelTimer *next = t->next;
+        if (t->due <= by) {
+            list_unlink(t);
+            list_push_back(out, t);
+        }
+        t = next;
+    }
+}
+
+int timer_wheel_advance(TimerWheel *w, double now)
+{
+    double ticks = floor((now - w->t0) / w->resolution);
+    if (ticks <= (double)w->tick) return 0;
+    uint64_t to = (uint64_t)ticks;
+
+    /* Collect first, fire after, so callbacks that reschedule land on
+     * ticks after @p to and cannot loop within this call. */
+    TimerWheelTimer due;
+    list_init(&due);
+    if (to - w->tick >= TIMER_WHEEL_SLOTS) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++)
+            slot_collect(&w->slot[i], to, &due);
+    } else {
+        for (uint64_t k = w->tick + 1; k <= to; k++)
+            slot_collect(&w->slot[k % TIMER_WHEEL_SLOTS], k, &due);
+    }
+    w->tick = to;
+
+    int n = 0;
+    while (due.next != &due) {
+        TimerWheelTimer *t = due.next;
+        list_unlink(t);             /* a callback may cancel the ones after it */
+        w->pending--;
+        w->fired++;
+        n++;
+        if (t->fn) t->fn(t, t->arg, now);
+    }
+    return n;
+}
+
+int timer_wheel_timeout(const TimerWheel *w, double now, double max_s)
+{
+    int max_ms = max_s > 0.0 ? (int)ceil(max_s * 1000.0) : 0;
+    if (w->pending == 0) return max_ms;
+
+    uint64_t horizon = (uint64_t)ceil(max_s / w->resolution);
+    if (horizon > TIMER_WHEEL_SLOTS) horizon = TIMER_WHEEL_SLOTS;
+    for (uint64_t i = 1; i <= horizon; i++) {
+        uint64_t k = w->tick + i;
+        const TimerWheelTimer *slot = &w->slot[k % TIMER_WHEEL_SLOTS];
+        for (const TimerWheelTimer *t = slot->next; t != slot; t = t->next) {
+            if (t->due > k) continue;           /* a later turn of the wheel */
+            double ms = ceil((w->t0 + (double)k * w->resolution - now) * 1000.0);
+            if (ms <= 0.0) return 0;
+            return ms < max_ms ? (int)ms : max_ms;
+        }
+    }
+    return max_ms;
+}
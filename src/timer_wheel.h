@@ -0,0 +1,134 @@
+/**
+ * @file timer_wheel.h
+ * @brief Hashed timer wheel: O(1) timers for many streams on one loop.
+ *
+ * An event loop with hundreds of sessions has several deadlines per
+ * session -- the next GGA, the next statistics tick, the connect or idle
+ * timeout, the end of a reconnect backoff.  Walking every session once a
+ * second to compare clocks costs O(sessions) per second and fires late by
+ * up to that second; a sorted queue costs O(log n) per insert.  A hashed
+ * wheel does both in O(1):
+ *
+ *   - time is cut into ticks of @c resolution seconds; a timer due at
+ *     tick @c d is kept in slot d mod @ref TIMER_WHEEL_SLOTS, on an
+ *     intrusive doubly linked list (no allocation, cancel is an unlink)
+ *   - timer_wheel_advance() visits the slots of the ticks that passed
+ *     and fires the timers that are due; a timer more than one turn of
+ *     the wheel away stays in its slot until its turn comes
+ *   - timer_wheel_timeout() gives the poll()/epoll_wait() timeout up to
+ *     the next due tick, so the loop sleeps until there is work
+ *
+ * A timer fires at most one tick late and never early.  When the loop
+ * falls more than a whole turn behind, one pass over every slot fires
+ * all that is due, not in deadline order.
+ *
+ * @code
+ * TimerWheel w;
+ * timer_wheel_init(&w, now, 0.01);               // 10 ms ticks
+ * timer_init(&s->gga_timer, on_gga, s);
+ * timer_wheel_schedule(&w, &s->gga_timer, now + 1.0);
+ * for (;;) {
+ *     wait_for_events(timer_wheel_timeout(&w, now, 1.0));
+ *     timer_wheel_advance(&w, now = clock_now());  // calls on_gga(...)
+ * }
+ * @endcode
+ *
+ * A callback may schedule or cancel any timer, its own included.  One
+ * thread per wheel.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Slots per wheel; with 10 ms ticks one turn is 5.12 s. */
+#define TIMER_WHEEL_SLOTS 512
+
+struct TimerWheelTimer;
+
+/**
+ * @brief Called when a timer is due.
+ *
+ * @param t    The timer; no longer pending, so it can be rescheduled.
+ * @param arg  The argument given to timer_init().
+ * @param now  The time timer_wheel_advance() was called with.
+ */
+typedef void (*TimerWheelFn)(struct TimerWheelTimer *t, void *arg, double now);
+
+/**
+ * @struct TimerWheelTimer
+ * @brief One timer, embedded in its owner; start with timer_init().
+ */
+typedef struct TimerWheelTimer {
+    struct TimerWheelTimer *next;   /**< NULL = not pending */
+    struct TimerWheelTimer *prev;
+    uint64_t                due;    /**< tick it fires at */
+    double                  at;     /**< time it was scheduled for */
+    TimerWheelFn            fn;
+    void                   *arg;
+} TimerWheelTimer;
+
+/**
+ * @struct TimerWheel
+ * @brief The slots and the current tick.
+ */
+typedef struct {
+    TimerWheelTimer slot[TIMER_WHEEL_SLOTS];   /**< list heads */
+    uint64_t        tick;       /**< last tick processed */
+    double          t0;         /**< time of tick 0 */
+    double          resolution; /**< seconds per tick */
+    unsigned long   pending;    /**< timers scheduled */
+    unsigned long   fired;      /**< callbacks made so far */
+} TimerWheel;
+
+/** @brief Empty wheel whose tick 0 is @p now, with ticks of @p resolution s. */
+void timer_wheel_init(TimerWheel *w, double now, double resolution);
+
+/** @brief Set up @p t to call @p fn(@p t, @p arg, now) when due; not pending. */
+void timer_init(TimerWheelTimer *t, TimerWheelFn fn, void *arg);
+
+/**
+ * @brief (Re)schedule @p t to fire at time @p at; a pending @p t is moved.
+ *
+ * A time in the past fires on the next timer_wheel_advance().
+ */
+void timer_wheel_schedule(TimerWheel *w, TimerWheelTimer *t, double at);
+
+/** @brief Unschedule @p t; nothing happens if it is not pending. */
+void timer_wheel_cancel(TimerWheel *w, TimerWheelTimer *t);
+
+/** @brief true while @p t is scheduled and has not fired. */
+static inline bool timer_pending(const TimerWheelTimer *t)
+{
+    return t->next != NULL;
+}
+
+/**
+ * @brief Fire every timer due by @p now.
+ *
+ * @return Number of callbacks made.
+ */
+int timer_wheel_advance(TimerWheel *w, double now);
+
+/**
+ * @brief Milliseconds from @p now until the next timer is due, at most
+ *        @p max_s; 0 if one is due already.  For the poll timeout.
+ */
+int timer_wheel_timeout(const TimerWheel *w, double now, double max_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,282 @@
+/**
+ * @file uring_rx.c
+ * @brief Batched socket receives and sends through io_uring (Linux).
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "uring_rx.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && !defined(NTRIP_NO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+/* IORING_ASYNC_CANCEL_FD_FIXED came with IORING_REGISTER_SYNC_CANCEL (6.0). */
+#if defined(SYS_io_uring_setup) && defined(IORING_ASYNC_CANCEL_FD_FIXED)
+#define URING_RX_LINUX 1
+#endif
+#endif
+#endif
+
+#ifdef URING_RX_LINUX
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define UR_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define UR_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define UR_MIN_ENTRIES  64u
+#define UR_MAX_ENTRIES  4096u
+
+struct UringRx {
+    int                  fd;
+    unsigned            *sq_head, *sq_tail, *sq_mask;
+    unsigned             sq_entries;
+    unsigned             queued;        /* SQEs written but not yet submitted */
+    struct io_uring_sqe *sqes;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void                *sq_map, *cq_map;
+    size_t               sq_len, cq_len, sqe_len;
+    unsigned long long   requests, submits;
+};
+
+static int ur_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(SYS_io_uring_setup, entries, p);
+}
+
+static int ur_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int ur_register(int fd, unsigned op, void *arg, unsigned n)
+{
+    return (int)syscall(SYS_io_uring_register, fd, op, arg, n);
+}
+
+static int ur_sync_cancel(UringRx *u, int fd, unsigned flags)
+{
+    struct io_uring_sync_cancel_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.fd              = fd;
+    reg.flags           = flags;
+    reg.timeout.tv_sec  = -1;           /* no timeout */
+    reg.timeout.tv_nsec = -1;
+    return ur_register(u->fd, IORING_REGISTER_SYNC_CANCEL, &reg, 1);
+}
+
+UringRx *uring_rx_open(unsigned entries)
+{
+    unsigned n = UR_MIN_ENTRIES;
+    while (n < entries && n < UR_MAX_ENTRIES) n <<= 1;
+
+    UringRx *u = (UringRx *)calloc(1, sizeof(*u));
+    if (!u) return NULL;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    u->fd = ur_setup(n, &p);
+    if (u->fd < 0) {
+        free(u);
+        return NULL;
+    }
+    /* Completions must not be dropped when the loop falls behind. */
+    if (!(p.features & IORING_FEAT_NODROP)) goto fail;
+
+    u->sq_len  = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_len  = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && u->cq_len > u->sq_len)
+        u->sq_len = u->cq_len;
+    u->sq_map = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_map == MAP_FAILED) { u->sq_map = NULL; goto fail; }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_map = u->sq_map;
+    } else {
+        u->cq_map = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_map == MAP_FAILED) { u->cq_map = NULL; goto fail; }
+    }
+    u->sqes = (struct io_uring_sqe *)mmap(NULL, u->sqe_len, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) { u->sqes = NULL; goto fail; }
+
+    unsigned char *sq = (unsigned char *)u->sq_map;
+    unsigned char *cq = (unsigned char *)u->cq_map;
+    u->sq_head    = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail    = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask    = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    /* SQE i always sits in slot i: the index array never changes. */
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) array[i] = i;
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes    = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    /* Nothing to cancel yet: 0 or -ENOENT where synchronous cancel
+     * exists, -EINVAL on a kernel without it. */
+    if (ur_sync_cancel(u, -1, IORING_ASYNC_CANCEL_ANY) < 0 && errno != ENOENT) goto fail;
+    return u;
+
+fail:
+    uring_rx_close(u);
+    return NULL;
+}
+
+void uring_rx_close(UringRx *u)
+{
+    if (!u) return;
+    if (u->sqes) munmap(u->sqes, u->sqe_len);
+    if (u->cq_map && u->cq_map != u->sq_map) munmap(u->cq_map, u->cq_len);
+    if (u->sq_map) munmap(u->sq_map, u->sq_len);
+    close(u->fd);
+    free(u);
+}
+
+int uring_rx_fd(const UringRx *u)
+{
+    return u->fd;
+}
+
+int uring_rx_submit(UringRx *u)
+{
+    int done = 0;
+    while (u->queued > 0) {
+        int r = ur_enter(u->fd, u->queued, 0, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            /* EBUSY / EAGAIN: completions first; the rest goes next time */
+            return (errno == EBUSY || errno == EAGAIN) ? done : -1;
+        }
+        u->submits++;
+        u->queued -= (unsigned)r;
+        done += r;
+        if (r == 0) break;
+    }
+    return done;
+}
+
+/* The next free SQE, zeroed; submits the queue when it is full. */
+static struct io_uring_sqe *ur_get_sqe(UringRx *u)
+{
+    unsigned tail = *u->sq_tail;
+    if (tail - UR_LOAD(u->sq_head) >= u->sq_entries) {
+        uring_rx_submit(u);
+        if (tail - UR_LOAD(u->sq_head) >= u->sq_entries) return NULL;
+    }
+    struct io_uring_sqe *sqe = &u->sqes[tail & *u->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static void ur_push(UringRx *u)
+{
+    UR_STORE(u->sq_tail, *u->sq_tail + 1);
+    u->queued++;
+    u->requests++;
+}
+
+static bool ur_queue(UringRx *u, int op, int fd, const void *buf, size_t len,
+                     unsigned msg_flags, uint64_t tag)
+{
+    struct io_uring_sqe *sqe = ur_get_sqe(u);
+    if (!sqe) return false;
+    sqe->opcode    = (unsigned char)op;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = (unsigned)len;
+    sqe->msg_flags = msg_flags;
+    sqe->user_data = tag;
+    ur_push(u);
+    return true;
+}
+
+bool uring_rx_recv(UringRx *u, int fd, void *buf, size_t len, uint64_t tag)
+{
+    return ur_queue(u, IORING_OP_RECV, fd, buf, len, 0, tag);
+}
+
+bool uring_rx_send(UringRx *u, int fd, const void *buf, size_t len, uint64_t tag)
+{
+    return ur_queue(u, IORING_OP_SEND, fd, buf, len, MSG_NOSIGNAL, tag);
+}
+
+bool uring_rx_next(UringRx *u, uint64_t *tag, int *res)
+{
+    unsigned head = *u->cq_head;
+    if (head == UR_LOAD(u->cq_tail)) return false;
+    const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    *tag = cqe->user_data;
+    *res = cqe->res;
+    UR_STORE(u->cq_head, head + 1);
+    return true;
+}
+
+void uring_rx_cancel(UringRx *u, int fd)
+{
+    /* A request still in the queue would reach the kernel after the
+     * cancel and find the socket (or its successor) later. */
+    uring_rx_submit(u);
+    while (ur_sync_cancel(u, fd, IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL) < 0 &&
+           errno == EINTR) {}
+}
+
+void uring_rx_counts(const UringRx *u, unsigned long long *requests,
+                     unsigned long long *submits)
+{
+    *requests = u->requests;
+    *submits  = u->submits;
+}
+
+#else   /* !URING_RX_LINUX */
+
+UringRx *uring_rx_open(unsigned entries)
+{
+    (void)entries;
+    return NULL;
+}
+
+void uring_rx_close(UringRx *u) { (void)u; }
+int  uring_rx_fd(const UringRx *u) { (void)u; return -1; }
+int  uring_rx_submit(UringRx *u) { (void)u; return -1; }
+void uring_rx_cancel(UringRx *u, int fd) { (void)u; (void)fd; }
+
+bool uring_rx_recv(UringRx *u, int fd, void *buf, size_t len, uint64_t tag)
+{
+    (void)u; (void)fd; (void)buf; (void)len; (void)tag;
+    return false;
+}
+
+bool uring_rx_send(UringRx *u, int fd, const void *buf, size_t len, uint64_t tag)
+{
+    (void)u; (void)fd; (void)buf; (void)len; (void)tag;
+    return false;
+}
+
+bool uring_rx_next(UringRx *u, uint64_t *tag, int *res)
+{
+    (void)u; (void)tag; (void)res;
+    return false;
+}
+
+void uring_rx_counts(const UringRx *u, unsigned long long *requests,
+                     unsigned long long *submits)
+{
+    (void)u;
+    *requests = 0;
+    *submits  = 0;
+}
+
+#endif  /* URING_RX_LINUX */
@@ -0,0 +1,96 @@
+/**
+ * @file uring_rx.h
+ * @brief Batched socket receives and sends through io_uring (Linux).
+ *
+ * The multi-mountpoint loop (ntrip_multi.c) waits for readiness with
+ * epoll and then calls recv() on every stream that has data: one system
+ * call per event per socket, which at several hundred streams costs more
+ * than framing what they deliver.  A @ref UringRx instead keeps one
+ * receive queued per streaming socket, straight into that stream's
+ * framer ring, and hands the kernel every re-armed receive (and every
+ * due GGA sentence) in one io_uring_enter() per loop iteration; the
+ * completions are read from shared memory without a system call.  The
+ * ring's own descriptor is watched by the same epoll set, so sockets
+ * still connecting, in a TLS handshake or TLS-encrypted stay on the
+ * readiness path.
+ *
+ * No liburing: the three io_uring system calls are used directly.  It
+ * needs Linux 6.0 or later (IORING_REGISTER_SYNC_CANCEL, to take a
+ * socket off the ring before its buffer is reused); uring_rx_open()
+ * returns NULL on older kernels, when io_uring is disabled
+ * (kernel.io_uring_disabled, seccomp), on other systems and in builds
+ * with -DNTRIP_NO_URING, and the caller stays on recv().
+ *
+ * One thread only: the one that runs the loop.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef URING_RX_H
+#define URING_RX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct UringRx UringRx;
+
+/**
+ * @brief Set up a ring for about @p entries requests in flight.
+ * @return NULL if io_uring is not usable here (see above).
+ */
+UringRx *uring_rx_open(unsigned entries);
+
+/** @brief Close what uring_rx_open() returned (NULL is ignored). */
+void uring_rx_close(UringRx *u);
+
+/** @brief The ring descriptor: readable while completions wait. */
+int uring_rx_fd(const UringRx *u);
+
+/**
+ * @brief Queue a receive of up to @p len bytes from socket @p fd into
+ *        @p buf; its completion carries @p tag.
+ *
+ * @p buf must stay valid until the completion has been read or
+ * uring_rx_cancel() returned.  Queued requests go to the kernel with the
+ * next uring_rx_submit() (or earlier, when the queue is full).
+ * @return false if the request could not be queued.
+ */
+bool uring_rx_recv(UringRx *u, int fd, void *buf, size_t len, uint64_t tag);
+
+/** @brief Queue a send of @p len bytes of @p buf to @p fd, as uring_rx_recv(). */
+bool uring_rx_send(UringRx *u, int fd, const void *buf, size_t len, uint64_t tag);
+
+/** @brief Hand every queued request to the kernel; -1 on an error. */
+int uring_rx_submit(UringRx *u);
+
+/**
+ * @brief Take the next completion.
+ * @param res  [out] Result of the request: bytes, 0 (peer closed) or
+ *             -errno.
+ * @return false when none is waiting.
+ */
+bool uring_rx_next(UringRx *u, uint64_t *tag, int *res);
+
+/**
+ * @brief Cancel every request on socket @p fd and wait until the kernel
+ *        is done with them; their buffers may be reused afterwards.  The
+ *        completions still arrive (usually with -ECANCELED).
+ */
+void uring_rx_cancel(UringRx *u, int fd);
+
+/** @brief Requests queued and io_uring_enter() calls made so far. */
+void uring_rx_counts(const UringRx *u, unsigned long long *requests,
+                     unsigned long long *submits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* URING_RX_H */
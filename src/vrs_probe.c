@@ -0,0 +1,535 @@
+/**
+ * @file vrs_probe.c
+ * @brief VRS coverage probe: positions, report and GeoJSON map.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "vrs_probe.h"
+#include "quantile_sketch.h"
+#include "rtcm3x_parser.h"
+#include "cJSON.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define VRS_KM_PER_DEG_LAT  111.32
+#define VRS_VIRTUAL_KM      1.0     /* ARP this close to the GGA: a virtual station */
+#define VRS_REASONS         8       /* distinct failure reasons in the summary */
+#define VRS_LINE_MAX        512
+
+/* ── Positions ─────────────────────────────────────────────────────── */
+
+static void grid_fill(VrsProbePoint *pts, const VrsProbeGrid *g)
+{
+    for (int r = 0; r < g->rows; r++) {
+        for (int c = 0; c < g->cols; c++) {
+            VrsProbePoint *p = &pts[r * g->cols + c];
+            p->lat = g->lat0 + r * g->dlat;
+            p->lon = g->lon0 + c * g->dlon;
+            p->row = r;
+            p->col = c;
+        }
+    }
+}
+
+/* "S,W,N,E/STEP" or "RADIUS/STEP" after the "grid:" prefix. */
+static int parse_grid(const char *spec, double lat, double lon, int max_points,
+                      VrsProbePoint **out, int *n_out, VrsProbeGrid *g)
+{
+    double v[4], step;
+    int nv = 0;
+    const char *p = spec;
+    char *end;
+    for (;;) {
+        v[nv++] = strtod(p, &end);
+        if (end == p) goto bad;
+        if (*end == ',' && nv < 4) { p = end + 1; continue; }
+        break;
+    }
+    if (*end != '/' || (nv != 1 && nv != 4)) goto bad;
+    p = end + 1;
+    step = strtod(p, &end);
+    if (end == p || step <= 0.0 || (*end && strcmp(end, "km"))) goto bad;
+
+    double s, w, n, e;
+    if (nv == 4) {
+        s = v[0]; w = v[1]; n = v[2]; e = v[3];
+        if (s > n || w > e || s < -90.0 || n > 90.0 || w < -180.0 || e > 180.0) {
+            fprintf(stderr, "[ERROR] --vrs-probe: grid box must be S,W,N,E with S <= N and W <= E\n");
+            return -1;
+        }
+    } else {
+        if (v[0] <= 0.0) goto bad;
+        if (lat == 0.0 && lon == 0.0) {
+            fprintf(stderr, "[ERROR] --vrs-probe grid:RADIUS/STEP needs LATITUDE / LONGITUDE "
+                            "(or --lat / --lon)\n");
+            return -1;
+        }
+        double dlat = v[0] / VRS_KM_PER_DEG_LAT;
+        double dlon = dlat / cos(lat * M_PI / 180.0);
+        s = lat - dlat; n = lat + dlat;
+        w = lon - dlon; e = lon + dlon;
+    }
+
+    memset(g, 0, sizeof(*g));
+    g->step_km = step;
+    g->dlat    = step / VRS_KM_PER_DEG_LAT;
+    g->dlon    = g->dlat / cos((s + n) / 2.0 * M_PI / 180.0);
+    g->rows    = (int)floor((n - s) / g->dlat + 1e-9) + 1;
+    g->cols    = (int)floor((e - w) / g->dlon + 1e-9) + 1;
+    /* Centre the points in the box; the step rarely divides it. */
+    g->lat0    = s + ((n - s) - (g->rows - 1) * g->dlat) / 2.0;
+    g->lon0    = w + ((e - w) - (g->cols - 1) * g->dlon) / 2.0;
+    if ((double)g->rows * g->cols > max_points) {
+        fprintf(stderr, "[ERROR] --vrs-probe: %d x %d grid is more than %d positions; "
+                        "use a larger step\n", g->rows, g->cols, max_points);
+        return -1;
+    }
+    *n_out = g->rows * g->cols;
+    *out   = (VrsProbePoint *)calloc((size_t)*n_out, sizeof(VrsProbePoint));
+    if (!*out) {
+        fprintf(stderr, "[ERROR] Out of memory for %d positions\n", *n_out);
+        return -1;
+    }
+    grid_fill(*out, g);
+    return 0;
+
+bad:
+    fprintf(stderr, "[ERROR] --vrs-probe expects grid:S,W,N,E/STEP_KM, grid:RADIUS_KM/STEP_KM "
+                    "or a track file\n");
+    return -1;
+}
+
+/* NMEA "ddmm.mmmm" / "dddmm.mmmm" and hemisphere to degrees. */
+static bool nmea_coord(const char *field, char hemi, double *deg)
+{
+    char *end;
+    double v = strtod(field, &end);
+    if (end == field) return false;
+    double d = floor(v / 100.0);
+    *deg = d + (v - d * 100.0) / 60.0;
+    if (hemi == 'S' || hemi == 'W') *deg = -*deg;
+    return true;
+}
+
+/* One track line: an NMEA GGA sentence or "LAT,LON" / "LAT LON". */
+static bool parse_track_line(const char *line, double *lat, double *lon)
+{
+    if (line[0] == '$') {
+        if (strlen(line) < 6 || strncmp(line + 3, "GGA", 3) != 0) return false;
+        char f[15][24];
+        int nf = 0, k = 0;
+        for (const char *p = line + 1; *p && *p != '*' && nf < 15; p++) {
+            if (*p == ',') { f[nf++][k] = '\0'; k = 0; continue; }
+            if (k < 23) f[nf][k++] = *p;
+        }
+        if (nf < 15) f[nf++][k] = '\0';
+        if (nf < 6) return false;
+        return nmea_coord(f[2], f[3][0], lat) && nmea_coord(f[4], f[5][0], lon);
+    }
+    char *end;
+    *lat = strtod(line, &end);
+    if (end == line) return false;
+    while (*end == ',' || *end == ';' || isspace((unsigned char)*end)) end++;
+    const char *p = end;
+    *lon = strtod(p, &end);
+    return end != p;
+}
+
+static int parse_track(const char *path, int max_points, VrsProbePoint **out, int *n_out)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[ERROR] --vrs-probe: cannot open track file %s\n", path);
+        return -1;
+    }
+    VrsProbePoint *pts = NULL;
+    int n = 0, cap = 0, lineno = 0;
+    char line[VRS_LINE_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *s = line;
+        while (isspace((unsigned char)*s)) s++;
+        if (!*s || *s == '#') continue;
+        double lat, lon;
+        if (!parse_track_line(s, &lat, &lon) || fabs(lat) > 90.0 || fabs(lon) > 180.0) {
+            if (s[0] != '$')        /* other NMEA sentences are fine */
+                fprintf(stderr, "[WARN] %s:%d: not a position, skipped\n", path, lineno);
+            continue;
+        }
+        if (n == max_points) {
+            fprintf(stderr, "[ERROR] --vrs-probe: %s has more than %d positions\n", path, max_points);
+            fclose(f);
+            free(pts);
+            return -1;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            VrsProbePoint *np = (VrsProbePoint *)realloc(pts, (size_t)cap * sizeof(*pts));
+            if (!np) {
+                fprintf(stderr, "[ERROR] Out of memory reading %s\n", path);
+                fclose(f);
+                free(pts);
+                return -1;
+            }
+            pts = np;
+        }
+        memset(&pts[n], 0, sizeof(pts[n]));
+        pts[n].lat = lat;
+        pts[n].lon = lon;
+        pts[n].row = pts[n].col = -1;
+        n++;
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "[ERROR] --vrs-probe: no positions in %s\n", path);
+        free(pts);
+        return -1;
+    }
+    *out   = pts;
+    *n_out = n;
+    return 0;
+}
+
+int vrs_probe_parse(const char *spec, double lat, double lon, int max_points,
+                    VrsProbePoint **out, int *n_out, VrsProbeGrid *grid)
+{
+    memset(grid, 0, sizeof(*grid));
+    *out   = NULL;
+    *n_out = 0;
+    if (strncmp(spec, "grid:", 5) == 0)
+        return parse_grid(spec + 5, lat, lon, max_points, out, n_out, grid);
+    return parse_track(spec, max_points, out, n_out);
+}
+
+/* ── Stations ──────────────────────────────────────────────────────── */
+
+static double distance_km(double lat1, double lon1, double lat2, double lon2)
+{
+    double d, heading;
+    calc_distance_heading(lat1, lon1, lat2, lon2, &d, &heading);
+    return d;
+}
+
+/* Distinct ARPs served at the probe positions.  A station that serves a
+ * single position and sits on it is a virtual one, not listed apart. */
+typedef struct {
+    double lat, lon;
+    int    station;
+    int    positions;
+    double sum_km;
+    char   label;
+} VrsStation;
+
+static const char *outcome_name(VrsProbeOutcome o)
+{
+    switch (o) {
+    case VRS_PROBE_FAILED:   return "failed";
+    case VRS_PROBE_NO_ARP:   return "no ARP";
+    case VRS_PROBE_SAME:     return "same ARP";
+    case VRS_PROBE_SWITCHED: return "switched";
+    }
+    return "?";
+}
+
+/* Cluster the ARPs; @p of[i] is the station index of point i or -1. */
+static int collect_stations(const VrsProbePoint *pts, int n, VrsStation *st, int *of)
+{
+    int n_st = 0;
+    for (int i = 0; i < n; i++) {
+        of[i] = -1;
+        if (!pts[i].arp_valid) continue;
+        int s = 0;
+        while (s < n_st && (st[s].station != pts[i].station ||
+                            distance_km(st[s].lat, st[s].lon, pts[i].arp_lat, pts[i].arp_lon) * 1000.0
+                                >= VRS_PROBE_SAME_M))
+            s++;
+        if (s == n_st) {
+            memset(&st[s], 0, sizeof(st[s]));
+            st[s].lat     = pts[i].arp_lat;
+            st[s].lon     = pts[i].arp_lon;
+            st[s].station = pts[i].station;
+            n_st++;
+        }
+        st[s].positions++;
+        st[s].sum_km += distance_km(pts[i].lat, pts[i].lon, pts[i].arp_lat, pts[i].arp_lon);
+        of[i] = s;
+    }
+
+    /* Letters for the real stations, in order of first appearance. */
+    static const char labels[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    int next = 0;
+    for (int s = 0; s < n_st; s++) {
+        if (st[s].positions == 1 && st[s].sum_km < VRS_VIRTUAL_KM) st[s].label = '+';
+        else st[s].label = next < (int)sizeof(labels) - 1 ? labels[next++] : '#';
+    }
+    return n_st;
+}
+
+/* ── Report ────────────────────────────────────────────────────────── */
+
+static void print_dist_row(const char *name, const QSketch *s, FILE *out)
+{
+    if (s->count == 0) {
+        fprintf(out, "| %-24s | %7d | %9s | %9s | %9s | %9s | %9s | %9s |\n",
+                name, 0, "-", "-", "-", "-", "-", "-");
+        return;
+    }
+    fprintf(out, "| %-24s | %7llu | %9.2f | %9.2f | %9.2f | %9.2f | %9.2f | %9.2f |\n",
+            name, (unsigned long long)s->count, s->zero ? 0.0 : s->min,
+            qsketch_quantile(s, 0.50), qsketch_quantile(s, 0.90),
+            qsketch_quantile(s, 0.99), s->max, qsketch_mean(s));
+}
+
+static void format_mix(const VrsProbePoint *p, char *buf, size_t len)
+{
+    size_t k = 0;
+    buf[0] = '\0';
+    for (int t = 0; t < p->n_types && k + 8 < len; t++)
+        k += (size_t)snprintf(buf + k, len - k, "%s%d", t ? " " : "", p->types[t]);
+}
+
+static void print_map(const VrsProbePoint *pts, const VrsProbeGrid *g, const VrsStation *st,
+                      const int *of, FILE *out)
+{
+    fprintf(out, "\n[INFO] Coverage map, %d x %d positions %.1f km apart (north up)\n",
+            g->rows, g->cols, g->step_km);
+    char west[16], east[16];
+    snprintf(west, sizeof(west), "%.4f", g->lon0);
+    snprintf(east, sizeof(east), "%.4f", g->lon0 + (g->cols - 1) * g->dlon);
+    int width = g->cols * 2 - (int)strlen(west) - (int)strlen(east);
+    if (width >= 2) fprintf(out, "%11s %s%*s%s\n", "", west, width, "", east);
+    else            fprintf(out, "%11s %s .. %s\n", "", west, east);
+    for (int r = g->rows - 1; r >= 0; r--) {
+        fprintf(out, "%10.4f ", g->lat0 + r * g->dlat);
+        for (int c = 0; c < g->cols; c++) {
+            int i = r * g->cols + c;
+            char ch = pts[i].outcome == VRS_PROBE_FAILED ? '!' :
+                      of[i] < 0                          ? '?' : st[of[i]].label;
+            fprintf(out, " %c", ch);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "  + virtual station at the position   ? no ARP   ! failed   letters: stations below\n");
+}
+
+void vrs_probe_report(const VrsProbePoint *pts, int n, const VrsProbeGrid *grid,
+                      const char *mountpoint, double elapsed, FILE *out)
+{
+    VrsStation *st = (VrsStation *)calloc((size_t)n, sizeof(VrsStation));
+    int        *of = (int *)calloc((size_t)n, sizeof(int));
+    if (!st || !of) {
+        free(st);
+        free(of);
+        return;
+    }
+    int n_st = collect_stations(pts, n, st, of);
+
+    fprintf(out, "\n[INFO] VRS probe: %d positions on %s, %.0f s\n", n, mountpoint, elapsed);
+    fprintf(out, "+------+-----------------------+----------+---------+-----------------------+----------+----------+---------------------------+\n");
+    fprintf(out, "|    # | Position              | Outcome  | Station | ARP                   | Dist. km | Switch s | Messages                  |\n");
+    fprintf(out, "+------+-----------------------+----------+---------+-----------------------+----------+----------+---------------------------+\n");
+    for (int i = 0; i < n; i++) {
+        const VrsProbePoint *p = &pts[i];
+        char pos[32], arp[32], sta[16], dist[16], sw[16], mix[128];
+        snprintf(pos, sizeof(pos), "%.5f, %.5f", p->lat, p->lon);
+        if (p->arp_valid) {
+            snprintf(arp, sizeof(arp), "%.5f, %.5f", p->arp_lat, p->arp_lon);
+            snprintf(sta, sizeof(sta), "%c %d", st[of[i]].label, p->station);
+            snprintf(dist, sizeof(dist), "%.2f", distance_km(p->lat, p->lon, p->arp_lat, p->arp_lon));
+        } else {
+            snprintf(arp, sizeof(arp), "-");
+            snprintf(sta, sizeof(sta), "-");
+            snprintf(dist, sizeof(dist), "-");
+        }
+        if (p->switch_s >= 0.0) snprintf(sw, sizeof(sw), "%.2f", p->switch_s);
+        else                    snprintf(sw, sizeof(sw), "-");
+        if (p->outcome == VRS_PROBE_FAILED) snprintf(mix, sizeof(mix), "%s", p->note);
+        else                                format_mix(p, mix, sizeof(mix));
+        fprintf(out, "| %4d | %-21s | %-8s | %7s | %-21s | %8s | %8s | %-25.25s |\n",
+                i + 1, pos, outcome_name(p->outcome), sta, arp, dist, sw, mix);
+    }
+    fprintf(out, "+------+-----------------------+----------+---------+-----------------------+----------+----------+---------------------------+\n");
+
+    /* Outcomes, and why sessions failed, most common first */
+    int count[4] = { 0 };
+    const char *reason[VRS_REASONS];
+    int reason_n[VRS_REASONS], n_reasons = 0;
+    for (int i = 0; i < n; i++) {
+        count[pts[i].outcome]++;
+        if (pts[i].outcome != VRS_PROBE_FAILED) continue;
+        int r = 0;
+        while (r < n_reasons && strcmp(reason[r], pts[i].note) != 0) r++;
+        if (r == n_reasons) {
+            if (n_reasons == VRS_REASONS) continue;
+            reason[n_reasons] = pts[i].note;
+            reason_n[n_reasons++] = 0;
+        }
+        reason_n[r]++;
+    }
+    fprintf(out, "[INFO] Outcomes: %d switched, %d same ARP, %d no ARP, %d failed",
+            count[VRS_PROBE_SWITCHED], count[VRS_PROBE_SAME], count[VRS_PROBE_NO_ARP],
+            count[VRS_PROBE_FAILED]);
+    for (int r = 0; r < n_reasons; r++)
+        fprintf(out, "%s%d x %s", r ? ", " : " (", reason_n[r], reason[r]);
+    fprintf(out, "%s\n", n_reasons ? ")" : "");
+
+    QSketch sw, hdr, dist;
+    memset(&sw, 0, sizeof(sw));
+    memset(&hdr, 0, sizeof(hdr));
+    memset(&dist, 0, sizeof(dist));
+    for (int i = 0; i < n; i++) {
+        if (pts[i].switch_s >= 0.0) qsketch_add(&sw, pts[i].switch_s);
+        if (pts[i].header_s >= 0.0) qsketch_add(&hdr, pts[i].header_s);
+        if (pts[i].arp_valid)
+            qsketch_add(&dist, distance_km(pts[i].lat, pts[i].lon, pts[i].arp_lat, pts[i].arp_lon));
+    }
+    fprintf(out, "+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    fprintf(out, "| Per position             |   Count |       Min |       p50 |       p90 |       p99 |       Max |      Mean |\n");
+    fprintf(out, "+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+    print_dist_row("Response header (s)", &hdr, out);
+    print_dist_row("GGA switch to ARP (s)", &sw, out);
+    print_dist_row("Distance to ARP (km)", &dist, out);
+    fprintf(out, "+--------------------------+---------+-----------+-----------+-----------+-----------+-----------+-----------+\n");
+
+    int virt = 0;
+    for (int s = 0; s < n_st; s++) virt += st[s].label == '+';
+    fprintf(out, "[INFO] %d stations served the positions", n_st - virt);
+    if (virt) fprintf(out, ", plus %d virtual ones at the position itself", virt);
+    fprintf(out, "\n");
+    for (int s = 0; s < n_st; s++) {
+        if (st[s].label == '+') continue;
+        fprintf(out, "  %c  station %4d  %.6f, %.6f  %d positions, mean distance %.1f km\n",
+                st[s].label, st[s].station, st[s].lat, st[s].lon, st[s].positions,
+                st[s].sum_km / st[s].positions);
+    }
+
+    if (grid && grid->rows > 0) print_map(pts, grid, st, of, out);
+    free(st);
+    free(of);
+}
+
+/* ── GeoJSON ───────────────────────────────────────────────────────── */
+
+static cJSON *geo_point(double lat, double lon)
+{
+    cJSON *g = cJSON_CreateObject();
+    cJSON_AddStringToObject(g, "type", "Point");
+    cJSON *c = cJSON_AddArrayToObject(g, "coordinates");
+    cJSON_AddItemToArray(c, cJSON_CreateNumber(lon));
+    cJSON_AddItemToArray(c, cJSON_CreateNumber(lat));
+    return g;
+}
+
+static cJSON *geo_feature(cJSON *geometry, cJSON **props)
+{
+    cJSON *f = cJSON_CreateObject();
+    cJSON_AddStringToObject(f, "type", "Feature");
+    cJSON_AddItemToObject(f, "geometry", geometry);
+    *props = cJSON_AddObjectToObject(f, "properties");
+    return f;
+}
+
+int vrs_probe_write_geojson(const VrsProbePoint *pts, int n, const char *path)
+{
+    VrsStation *st = (VrsStation *)calloc((size_t)n, sizeof(VrsStation));
+    int        *of = (int *)calloc((size_t)n, sizeof(int));
+    if (!st || !of) {
+        free(st);
+        free(of);
+        return -1;
+    }
+    int n_st = collect_stations(pts, n, st, of);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "FeatureCollection");
+    cJSON *features = cJSON_AddArrayToObject(root, "features");
+    for (int i = 0; i < n; i++) {
+        const VrsProbePoint *p = &pts[i];
+        cJSON *props;
+        cJSON *f = geo_feature(geo_point(p->lat, p->lon), &props);
+        cJSON_AddStringToObject(props, "kind", "position");
+        if (p->row >= 0) {
+            cJSON_AddNumberToObject(props, "row", p->row);
+            cJSON_AddNumberToObject(props, "col", p->col);
+        }
+        cJSON_AddStringToObject(props, "outcome", outcome_name(p->outcome));
+        if (p->note[0]) cJSON_AddStringToObject(props, "note", p->note);
+        if (p->arp_valid) {
+            char label[2] = { st[of[i]].label, '\0' };
+            cJSON_AddStringToObject(props, "label", label);
+            cJSON_AddNumberToObject(props, "station", p->station);
+            cJSON *a = cJSON_AddArrayToObject(props, "arp");
+            cJSON_AddItemToArray(a, cJSON_CreateNumber(p->arp_lon));
+            cJSON_AddItemToArray(a, cJSON_CreateNumber(p->arp_lat));
+            cJSON_AddItemToArray(a, cJSON_CreateNumber(p->arp_alt));
+            cJSON_AddNumberToObject(props, "distance_km",
+                                    distance_km(p->lat, p->lon, p->arp_lat, p->arp_lon));
+        }
+        if (p->base_valid) cJSON_AddNumberToObject(props, "start_station", p->base_station);
+        if (p->header_s >= 0.0) cJSON_AddNumberToObject(props, "header_s", p->header_s);
+        if (p->switch_s >= 0.0) cJSON_AddNumberToObject(props, "switch_s", p->switch_s);
+        cJSON_AddNumberToObject(props, "bytes", (double)p->bytes);
+        cJSON *mix = cJSON_AddObjectToObject(props, "messages");
+        for (int t = 0; t < p->n_types; t++) {
+            char key[8];
+            snprintf(key, sizeof(key), "%d", p->types[t]);
+            cJSON_AddNumberToObject(mix, key, p->counts[t]);
+        }
+        cJSON_AddItemToArray(features, f);
+
+        if (p->outcome == VRS_PROBE_SWITCHED && p->arp_valid && st[of[i]].label != '+') {
+            cJSON *g = cJSON_CreateObject();
+            cJSON_AddStringToObject(g, "type", "LineString");
+            cJSON *c = cJSON_AddArrayToObject(g, "coordinates");
+            cJSON *a = cJSON_CreateArray(), *b = cJSON_CreateArray();
+            cJSON_AddItemToArray(a, cJSON_CreateNumber(p->lon));
+            cJSON_AddItemToArray(a, cJSON_CreateNumber(p->lat));
+            cJSON_AddItemToArray(b, cJSON_CreateNumber(p->arp_lon));
+            cJSON_AddItemToArray(b, cJSON_CreateNumber(p->arp_lat));
+            cJSON_AddItemToArray(c, a);
+            cJSON_AddItemToArray(c, b);
+            cJSON *lf = geo_feature(g, &props);
+            cJSON_AddStringToObject(props, "kind", "link");
+            cJSON_AddNumberToObject(props, "station", p->station);
+            cJSON_AddItemToArray(features, lf);
+        }
+    }
+    for (int s = 0; s < n_st; s++) {
+        if (st[s].label == '+') continue;
+        cJSON *props;
+        cJSON *f = geo_feature(geo_point(st[s].lat, st[s].lon), &props);
+        char label[2] = { st[s].label, '\0' };
+        cJSON_AddStringToObject(props, "kind", "station");
+        cJSON_AddStringToObject(props, "label", label);
+        cJSON_AddNumberToObject(props, "station", st[s].station);
+        cJSON_AddNumberToObject(props, "positions", st[s].positions);
+        cJSON_AddItemToArray(features, f);
+    }
+    free(st);
+    free(of);
+
+    char *text = cJSON_Print(root);
+    cJSON_Delete(root);
+    FILE *f = text ? fopen(path, "w") : NULL;
+    int rc = 0;
+    if (!f) {
+        rc = -1;
+    } else {
+        fputs(text, f);
+        fputc('\n', f);
+        if (fclose(f) != 0) rc = -1;
+    }
+    free(text);
+    if (rc != 0) fprintf(stderr, "[ERROR] Could not write %s\n", path);
+    return rc;
+}
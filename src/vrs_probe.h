@@ -0,0 +1,125 @@
+/**
+ * @file vrs_probe.h
+ * @brief VRS coverage probe: many GGA positions against one mountpoint.
+ *
+ * A VRS (or nearest-base) mountpoint answers the rover's GGA position
+ * with a reference station of its choosing, visible in the 1005 / 1006
+ * ARP it sends.  Checking that one position at a time (as the GUI's
+ * position-shift test does) takes hours for an area; the probe opens one
+ * session per position on the --mounts-file event loop
+ * (ntrip_multi_vrs_probe()) and does them all at once.
+ *
+ * Per position the session
+ *
+ *   1. sends GGA at the configured LATITUDE / LONGITUDE and waits for
+ *      the ARP served there (skipped when no position is configured),
+ *   2. switches its GGA to the probe position and times how long the
+ *      caster takes to serve a different ARP (the switch latency),
+ *   3. keeps the stream a little longer for the message mix.
+ *
+ * The positions come from a grid spec or a track file, see
+ * vrs_probe_parse().  vrs_probe_report() prints a table per position,
+ * the switch latency distribution and, for a grid, a character map of
+ * which station serves which cell; vrs_probe_write_geojson() saves the
+ * same as a GeoJSON map.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#ifndef VRS_PROBE_H
+#define VRS_PROBE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Message types kept per position for the mix. */
+#define VRS_PROBE_TYPES    32
+
+/** @brief Two ARPs closer than this are the same station, as in the GUI. */
+#define VRS_PROBE_SAME_M   10.0
+
+/** @brief How a probe session ended. */
+typedef enum {
+    VRS_PROBE_FAILED,      /**< No stream: DNS, connect, HTTP status, ... */
+    VRS_PROBE_NO_ARP,      /**< Streamed, but no 1005 / 1006 after the switch */
+    VRS_PROBE_SAME,        /**< ARP after the switch is the one served before it */
+    VRS_PROBE_SWITCHED     /**< A different ARP followed the GGA change */
+} VrsProbeOutcome;
+
+/** @brief One position to probe and what came back for it. */
+typedef struct {
+    double             lat, lon;        /**< GGA position probed */
+    int                row, col;        /**< Grid cell, row 0 south; -1 on a track */
+
+    VrsProbeOutcome    outcome;
+    char               note[96];        /**< Failure or end reason */
+    bool               base_valid;      /**< An ARP was served at the start position */
+    int                base_station;
+    double             base_lat, base_lon;
+    bool               arp_valid;       /**< An ARP was served at the probe position */
+    int                station;         /**< DF003 of that ARP */
+    double             arp_lat, arp_lon, arp_alt;
+    double             header_s;        /**< Request to response header; < 0 = none */
+    double             switch_s;        /**< GGA change to the new ARP; < 0 = none */
+    unsigned long long bytes;
+    int                n_types;         /**< Message mix after the switch */
+    int                types[VRS_PROBE_TYPES];
+    unsigned           counts[VRS_PROBE_TYPES];
+} VrsProbePoint;
+
+/** @brief Grid the points were laid out on; rows == 0 for a track. */
+typedef struct {
+    int    rows, cols;
+    double lat0, lon0;                  /**< South-west point */
+    double dlat, dlon;                  /**< Point spacing in degrees */
+    double step_km;
+} VrsProbeGrid;
+
+/**
+ * @brief Build the probe positions from @p spec:
+ *
+ *   - "grid:S,W,N,E/STEP_KM"  points STEP_KM apart over the box,
+ *   - "grid:RADIUS_KM/STEP_KM" the same over the square of that half
+ *     width around @p lat, @p lon (the configured position),
+ *   - anything else is a track file: one position per line, as
+ *     "LAT,LON", "LAT LON" or an NMEA GGA sentence; blank lines and
+ *     lines starting with '#' are skipped.
+ *
+ * At most @p max_points are accepted.
+ *
+ * @param out   [out] calloc()ed array of @p n_out points (free() it).
+ * @param grid  [out] The grid, or rows = 0 for a track.
+ * @return 0 on success, -1 (message on stderr) on a bad spec, an
+ *         unreadable file, no points or more than @p max_points.
+ */
+int vrs_probe_parse(const char *spec, double lat, double lon, int max_points,
+                    VrsProbePoint **out, int *n_out, VrsProbeGrid *grid);
+
+/**
+ * @brief Print the per-position table, the outcome counts, the switch
+ *        latency distribution, the stations seen and (grid) the map.
+ */
+void vrs_probe_report(const VrsProbePoint *pts, int n, const VrsProbeGrid *grid,
+                      const char *mountpoint, double elapsed, FILE *out);
+
+/**
+ * @brief Write the positions and the stations serving them as a GeoJSON
+ *        FeatureCollection (one Point per position with its results, one
+ *        Point per distinct station and a LineString joining each switched
+ *        position to its ARP).
+ *
+ * @return 0 on success, -1 if @p path cannot be written.
+ */
+int vrs_probe_write_geojson(const VrsProbePoint *pts, int n, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VRS_PROBE_H */
@@ -0,0 +1,113 @@
+/**
+ * @file test_quantile_sketch.c
+ * @brief Quantiles of a QSketch (quantile_sketch.h) against exact ones.
+ *
+ * Every quantile read back must lie within QSKETCH_ALPHA of the sample
+ * at its rank -- also with a stall far above the body of the
+ * distribution, which the sketch's window cannot cover together with it.
+ *
+ * Project: NTRIP-Analyser
+ * Author: Remko Welling, PE1MEW
+ * License: Apache License 2.0 with Commons Clause
+ */
+
+#include "quantile_sketch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SAMPLES  20000
+
+static int s_failed;
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* The quantile the sketch should approximate: the sample at its rank. */
+static double exact_quantile(const double *sorted, size_t n, double q)
+{
+    return sorted[(size_t)(q * (double)(n - 1))];
+}
+
+/* Feed @p x[0 .. n-1] one by one and compare p50 .. p99.9 and max. */
+static void check(const char *name, const double *x, size_t n)
+{
+    static const double qs[] = { 0.50, 0.95, 0.99, 0.999 };
+    static double sorted[MAX_SAMPLES];
+    QSketch s;
+    memset(&s, 0, sizeof(s));
+    for (size_t i = 0; i < n; i++) qsketch_add(&s, x[i]);
+    memcpy(sorted, x, n * sizeof(*x));
+    qsort(sorted, n, sizeof(*sorted), cmp_double);
+
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        double want = exact_quantile(sorted, n, qs[i]);
+        double got  = qsketch_quantile(&s, qs[i]);
+        if (fabs(got - want) > QSKETCH_ALPHA * want * 1.0001) {
+            printf("[FAIL] %s: p%g = %.6f, want %.6f\n", name, qs[i] * 100.0, got, want);
+            s_failed++;
+        }
+    }
+    if (s.max != sorted[n - 1] || s.count != n) {
+        printf("[FAIL] %s: max %.6f count %llu, want %.6f %zu\n", name, s.max,
+               (unsigned long long)s.count, sorted[n - 1], n);
+        s_failed++;
+    }
+}
+
+/* Deterministic 0 .. 1 */
+static double rnd(unsigned *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return (double)((*state >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+int main(void)
+{
+    static double x[MAX_SAMPLES];
+    unsigned seed = 1;
+    size_t n;
+
+    /* 10 Hz with jitter and one 60 s stall */
+    for (n = 0; n < 3000; n++) x[n] = 0.1 + 0.002 * (rnd(&seed) - 0.5);
+    x[1500] = 60.0;
+    check("10 Hz + 60 s stall", x, n);
+
+    /* 1 Hz and one 300 s stall */
+    for (n = 0; n < 3600; n++) x[n] = 1.0 + 0.01 * (rnd(&seed) - 0.5);
+    x[10] = 300.0;
+    check("1 Hz + 300 s stall", x, n);
+
+    /* The stall first: the window is placed on it */
+    for (n = 0; n < 2000; n++) x[n] = 0.2 + 0.01 * rnd(&seed);
+    x[0] = 120.0;
+    check("stall first", x, n);
+
+    /* Log-uniform over 1 ms .. 10 s */
+    for (n = 0; n < MAX_SAMPLES; n++) x[n] = 0.001 * pow(10.0, 4.0 * rnd(&seed));
+    check("log-uniform 1 ms .. 10 s", x, n);
+
+    /* Merging keeps the body of both */
+    QSketch a, b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < 1000; i++) qsketch_add(&a, 0.1);
+    qsketch_add(&b, 600.0);
+    for (int i = 0; i < 1000; i++) qsketch_add(&b, 0.1);
+    qsketch_merge(&a, &b);
+    double p99 = qsketch_quantile(&a, 0.99);
+    if (fabs(p99 - 0.1) > QSKETCH_ALPHA * 0.1 || a.max != 600.0 || a.count != 2001) {
+        printf("[FAIL] merge: p99 %.6f max %.3f count %llu\n", p99, a.max,
+               (unsigned long long)a.count);
+        s_failed++;
+    }
+
+    if (s_failed) return 1;
+    printf("[PASS] quantile_sketch\n");
+    return 0;
+}